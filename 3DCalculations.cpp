@@ -29,6 +29,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Angle.h"
 #include "CollectionOfPoints.h"
 #include "CrystalLattice.h"
+#include "Eigenvalue.h"
+#include "MathConstants.h"
 #include "MathFunctions.h"
 #include "Matrix3D.h"
 #include "MillerIndices.h"
@@ -38,6 +40,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "SymmetricMatrix3D.h"
 #include "Vector3DCalculations.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <stdexcept>
@@ -53,6 +56,80 @@ Vector3D reciprocal_lattice_point( const MillerIndices miller_indices, const Cry
 
 // ********************************************************************************
 
+ReciprocalBasis::ReciprocalBasis( const CrystalLattice & crystal_lattice )
+{
+    const Vector3D star_vectors[3] = { crystal_lattice.a_star_vector(), crystal_lattice.b_star_vector(), crystal_lattice.c_star_vector() };
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        x_[i] = star_vectors[i].x();
+        y_[i] = star_vectors[i].y();
+        z_[i] = star_vectors[i].z();
+    }
+}
+
+// ********************************************************************************
+
+Vector3D ReciprocalBasis::point( const MillerIndices & miller_indices ) const
+{
+    return point( miller_indices.h(), miller_indices.k(), miller_indices.l() );
+}
+
+// ********************************************************************************
+
+void ReciprocalBasis::lengths2( const int h, const int k, const int l_first, const size_t n, double * result ) const
+{
+    // The part that is constant along the row
+    const double x0 = h * x_[0] + k * x_[1];
+    const double y0 = h * y_[0] + k * y_[1];
+    const double z0 = h * z_[0] + k * z_[1];
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        const double l = static_cast< double >( l_first + static_cast< int >( i ) );
+        const double x = x0 + l * x_[2];
+        const double y = y0 + l * y_[2];
+        const double z = z0 + l * z_[2];
+        result[i] = x*x + y*y + z*z;
+    }
+}
+
+// ********************************************************************************
+
+void reciprocal_lattice_lengths2( const ReciprocalBasis & reciprocal_basis, const std::uint64_t * packed_hkl, const size_t n, double * lengths2 )
+{
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        int h;
+        int k;
+        int l;
+        unpack_miller_indices( packed_hkl[i], h, k, l );
+        lengths2[i] = reciprocal_basis.length2( h, k, l );
+    }
+}
+
+// ********************************************************************************
+
+void d_spacings_and_two_thetas( const ReciprocalBasis & reciprocal_basis,
+                                const std::uint64_t * packed_hkl,
+                                const size_t n,
+                                const double wavelength,
+                                double * lengths2,
+                                double * d_spacings,
+                                double * two_thetas )
+{
+    reciprocal_lattice_lengths2( reciprocal_basis, packed_hkl, n, lengths2 );
+    const double radians_to_degrees = 180.0 / CONSTANT_PI;
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        const double length = std::sqrt( lengths2[i] );
+        d_spacings[i] = 1.0 / length;
+        // sin( theta ) = lambda / 2d
+        const double sine_theta = 0.5 * wavelength * length;
+        two_thetas[i] = ( sine_theta <= 1.0 ) ? 2.0 * radians_to_degrees * std::asin( sine_theta ) : -1.0;
+    }
+}
+
+// ********************************************************************************
+
 NormalisedVector3D reciprocal_lattice_direction( const MillerIndices miller_indices, const CrystalLattice & crystal_lattice )
 {
     return normalised_vector( miller_indices.h() * crystal_lattice.a_star_vector() +
@@ -121,40 +198,116 @@ double root_mean_square_devation_from_mean_plane( const std::vector< Vector3D >
 
 SymmetricMatrix3D covariance_matrix( const std::vector< Vector3D > & points )
 {
-    SymmetricMatrix3D result( 0.0 );
-    Vector3D centre_of_mass = average( points );
-    // Calculate covariance matrix
-    for ( size_t iPoint( 0 ); iPoint != points.size(); ++iPoint )
-    {
-        Vector3D difference = points[iPoint] - centre_of_mass;
-        for ( size_t i( 0 ); i != 3; ++i )
-        {
-            for ( size_t j( i ); j != 3; ++j )
-            {
-                result.set_value( i, j, result.value( i, j ) + difference.value( i ) * difference.value( j ) );
-            }
-        }
-    }
-    return ( 1.0 / static_cast<double>( points.size() ) ) * result;
+    return PointMoments( points ).covariance_matrix();
 }
 
 // ********************************************************************************
 
 SymmetricMatrix3D covariance_matrix( const CollectionOfPoints & points )
 {
-    SymmetricMatrix3D result( 0.0 );
-    // Calculate covariance matrix
-    for ( size_t iPoint( 0 ); iPoint != points.size(); ++iPoint )
-    {
-        for ( size_t i( 0 ); i != 3; ++i )
-        {
-            for ( size_t j( i ); j != 3; ++j )
-            {
-                result.set_value( i, j, result.value( i, j ) + points.point_wrt_com( iPoint ).value( i ) * points.point_wrt_com( iPoint ).value( j ) );
-            }
-        }
-    }
-    return ( 1.0 / static_cast<double>( points.size() ) ) * result;
+    return points.moments().covariance_matrix();
+}
+
+// ********************************************************************************
+
+PointMoments::PointMoments():
+n_(0),
+sum_xx_(0.0),
+sum_xy_(0.0),
+sum_xz_(0.0),
+sum_yy_(0.0),
+sum_yz_(0.0),
+sum_zz_(0.0)
+{
+}
+
+// ********************************************************************************
+
+PointMoments::PointMoments( const std::vector< Vector3D > & points ):
+n_(0),
+sum_xx_(0.0),
+sum_xy_(0.0),
+sum_xz_(0.0),
+sum_yy_(0.0),
+sum_yz_(0.0),
+sum_zz_(0.0)
+{
+    for ( size_t i( 0 ); i != points.size(); ++i )
+        add_point( points[i] );
+}
+
+// ********************************************************************************
+
+void PointMoments::add_point( const Vector3D & point )
+{
+    if ( n_ == 0 )
+        origin_ = point;
+    const Vector3D d = point - origin_;
+    sum_ += d;
+    sum_xx_ += d.x() * d.x();
+    sum_xy_ += d.x() * d.y();
+    sum_xz_ += d.x() * d.z();
+    sum_yy_ += d.y() * d.y();
+    sum_yz_ += d.y() * d.z();
+    sum_zz_ += d.z() * d.z();
+    ++n_;
+}
+
+// ********************************************************************************
+
+Vector3D PointMoments::centroid() const
+{
+    if ( n_ == 0 )
+        throw std::runtime_error( "PointMoments::centroid(): no points." );
+    return origin_ + sum_ / static_cast<double>( n_ );
+}
+
+// ********************************************************************************
+
+SymmetricMatrix3D PointMoments::covariance_matrix() const
+{
+    if ( n_ == 0 )
+        throw std::runtime_error( "PointMoments::covariance_matrix(): no points." );
+    const double n = static_cast<double>( n_ );
+    const Vector3D m = sum_ / n;
+    return SymmetricMatrix3D( sum_xx_ / n - m.x() * m.x(),
+                              sum_yy_ / n - m.y() * m.y(),
+                              sum_zz_ / n - m.z() * m.z(),
+                              sum_xy_ / n - m.x() * m.y(),
+                              sum_xz_ / n - m.x() * m.z(),
+                              sum_yz_ / n - m.y() * m.z() );
+}
+
+// ********************************************************************************
+
+Plane PointMoments::best_plane() const
+{
+    Plane plane;
+    double root_mean_square_deviation;
+    best_plane( plane, root_mean_square_deviation );
+    return plane;
+}
+
+// ********************************************************************************
+
+double PointMoments::root_mean_square_deviation_from_best_plane() const
+{
+    Plane plane;
+    double root_mean_square_deviation;
+    best_plane( plane, root_mean_square_deviation );
+    return root_mean_square_deviation;
+}
+
+// ********************************************************************************
+
+void PointMoments::best_plane( Plane & plane, double & root_mean_square_deviation ) const
+{
+    std::vector< double > eigenvalues;
+    std::vector< NormalisedVector3D > eigenvectors;
+    calculate_eigenvalues( covariance_matrix(), eigenvalues, eigenvectors );
+    // The eigenvectors are sorted by eigenvalue, the smallest is the first
+    plane = Plane( eigenvectors[0], eigenvectors[0] * centroid() );
+    root_mean_square_deviation = sqrt( std::max( 0.0, eigenvalues[0] ) );
 }
 
 // ********************************************************************************
@@ -223,16 +376,6 @@ SymmetricMatrix3D Matrix3D2SymmetricMatrix3D( const Matrix3D & matrix, const dou
 
 // ********************************************************************************
 
-Vector3D operator*( const Matrix3D & matrix, const Vector3D & vector )
-{
-    return Vector3D( matrix.value( 0, 0 ) * vector.x() + matrix.value( 0, 1 ) * vector.y() + matrix.value( 0, 2 ) * vector.z(),
-                     matrix.value( 1, 0 ) * vector.x() + matrix.value( 1, 1 ) * vector.y() + matrix.value( 1, 2 ) * vector.z(),
-                     matrix.value( 2, 0 ) * vector.x() + matrix.value( 2, 1 ) * vector.y() + matrix.value( 2, 2 ) * vector.z()
-                   );
-}
-
-// ********************************************************************************
-
 Vector3D operator*( const SymmetricMatrix3D & matrix, const Vector3D & vector )
 {
     return Vector3D( matrix.value( 0, 0 ) * vector.x() + matrix.value( 0, 1 ) * vector.y() + matrix.value( 0, 2 ) * vector.z(),
@@ -243,16 +386,6 @@ Vector3D operator*( const SymmetricMatrix3D & matrix, const Vector3D & vector )
 
 // ********************************************************************************
 
-Vector3D operator*( const Vector3D & vector, const Matrix3D & matrix )
-{
-    return Vector3D( matrix.value( 0, 0 ) * vector.x() + matrix.value( 1, 0 ) * vector.y() + matrix.value( 2, 0 ) * vector.z(),
-                     matrix.value( 0, 1 ) * vector.x() + matrix.value( 1, 1 ) * vector.y() + matrix.value( 2, 1 ) * vector.z(),
-                     matrix.value( 0, 2 ) * vector.x() + matrix.value( 1, 2 ) * vector.y() + matrix.value( 2, 2 ) * vector.z()
-                   );
-}
-
-// ********************************************************************************
-
 Vector3D operator*( const Vector3D & vector, const SymmetricMatrix3D & matrix )
 {
     return vector * SymmetricMatrix3D2Matrix3D( matrix );
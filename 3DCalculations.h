@@ -31,17 +31,73 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 class Angle;
 class CollectionOfPoints;
 class CrystalLattice;
-class Matrix3D;
 class MillerIndices;
 class NormalisedVector3D;
 class Plane;
 class SymmetricMatrix3D;
-class Vector3D;
 
+#include "Matrix3D.h" // Matrix3D * Vector3D and Vector3D * Matrix3D are defined inline there
+#include "Vector3D.h"
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
 #include <vector>
 
 Vector3D reciprocal_lattice_point( const MillerIndices miller_indices, const CrystalLattice & crystal_lattice );
 
+/*
+  The reciprocal basis vectors a*, b*, c* of a lattice as plain arrays of Cartesian components, for when many reciprocal-lattice points
+  are needed: the star vectors are copied out of the CrystalLattice once instead of once per reflection.
+  H is evaluated as ( h a* + k b* ) + l c*, in the same order as reciprocal_lattice_point().
+*/
+class ReciprocalBasis
+{
+public:
+
+    explicit ReciprocalBasis( const CrystalLattice & crystal_lattice );
+
+    Vector3D point( const int h, const int k, const int l ) const
+    {
+        return Vector3D( ( h * x_[0] + k * x_[1] ) + l * x_[2],
+                         ( h * y_[0] + k * y_[1] ) + l * y_[2],
+                         ( h * z_[0] + k * z_[1] ) + l * z_[2] );
+    }
+
+    Vector3D point( const MillerIndices & miller_indices ) const;
+
+    // |H|^2 = 1/d^2
+    double length2( const int h, const int k, const int l ) const
+    {
+        const double x = ( h * x_[0] + k * x_[1] ) + l * x_[2];
+        const double y = ( h * y_[0] + k * y_[1] ) + l * y_[2];
+        const double z = ( h * z_[0] + k * z_[1] ) + l * z_[2];
+        return x*x + y*y + z*z;
+    }
+
+    // |H|^2 for the n reflections ( h, k, l_first ), ( h, k, l_first + 1 ), ..., as when enumerating reflections row by row.
+    // A loop over plain arrays without branches, so it vectorises.
+    void lengths2( const int h, const int k, const int l_first, const size_t n, double * result ) const;
+
+private:
+    // Component i of a*, b* and c*
+    double x_[3];
+    double y_[3];
+    double z_[3];
+};
+
+// Batch versions for n reflections given as packed Miller indices (see packed_miller_indices()).
+// |H|^2 = 1/d^2
+void reciprocal_lattice_lengths2( const ReciprocalBasis & reciprocal_basis, const std::uint64_t * packed_hkl, const size_t n, double * lengths2 );
+
+// |H|^2, d and 2theta in degrees; 2theta is set to -1.0 for reflections that do not diffract at this wavelength ( wavelength > 2d ).
+void d_spacings_and_two_thetas( const ReciprocalBasis & reciprocal_basis,
+                                const std::uint64_t * packed_hkl,
+                                const size_t n,
+                                const double wavelength,
+                                double * lengths2,
+                                double * d_spacings,
+                                double * two_thetas );
+
 NormalisedVector3D reciprocal_lattice_direction( const MillerIndices miller_indices, const CrystalLattice & crystal_lattice );
 
 // Gram-Schmidt orthogonalisation
@@ -57,6 +113,48 @@ double root_mean_square_devation_from_mean_plane( const CollectionOfPoints & poi
 
 double root_mean_square_devation_from_mean_plane( const std::vector< Vector3D > & points, const Plane & plane );
 
+/*
+  Single-pass accumulator of the zeroth, first and second moments of a set of points. The centroid, the covariance matrix,
+  the best (least-squares) plane and the root-mean-square deviation from that plane all follow from the moments,
+  without going over the points again. The moments are accumulated relative to the first point to limit cancellation.
+*/
+class PointMoments
+{
+public:
+    PointMoments();
+
+    explicit PointMoments( const std::vector< Vector3D > & points );
+
+    void add_point( const Vector3D & point );
+
+    size_t size() const { return n_; }
+
+    Vector3D centroid() const;
+
+    // Divided by the number of points, as covariance_matrix()
+    SymmetricMatrix3D covariance_matrix() const;
+
+    // The normal is the eigenvector of the covariance matrix with the smallest eigenvalue, the centroid lies in the plane.
+    Plane best_plane() const;
+
+    // The RMSD from best_plane() is the square root of the smallest eigenvalue of the covariance matrix.
+    double root_mean_square_deviation_from_best_plane() const;
+
+    // Both at once, with one eigenvalue decomposition.
+    void best_plane( Plane & plane, double & root_mean_square_deviation ) const;
+
+private:
+    size_t n_;
+    Vector3D origin_; // The first point
+    Vector3D sum_;    // Relative to origin_
+    double sum_xx_;
+    double sum_xy_;
+    double sum_xz_;
+    double sum_yy_;
+    double sum_yz_;
+    double sum_zz_;
+};
+
 // A major reason for the existence of this file is that it collects all functions that combine
 // Matrix3D, SymmetricMatrix3D, NormalisedVector3D and Vector3D, so that those classes do not need to know about each other.
 
@@ -86,11 +184,9 @@ Matrix3D SymmetricMatrix3D2Matrix3D( const SymmetricMatrix3D & matrix );
 // Throws if the matrix was not symmetric within tolerance.
 SymmetricMatrix3D Matrix3D2SymmetricMatrix3D( const Matrix3D & matrix, const double tolerance = 1.0E-6 );
 
-Vector3D operator*( const Matrix3D & matrix, const Vector3D & vector );
 Vector3D operator*( const SymmetricMatrix3D & matrix, const Vector3D & vector );
 
 // The transposition is implied.
-Vector3D operator*( const Vector3D & vector, const Matrix3D & matrix );
 Vector3D operator*( const Vector3D & vector, const SymmetricMatrix3D & matrix );
 
 Vector3D operator*( const NormalisedVector3D & vector, const Matrix3D & matrix );
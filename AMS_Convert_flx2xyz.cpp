@@ -26,11 +26,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "AMS_Convert_flx2xyz.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
 #include "FileName.h"
-#include "TextFileReader_2.h"
+#include "ParallelFor.h"
+#include "ReadCif.h"
 #include "TextFileWriter.h"
 #include "Utilities.h"
 
+#include <fstream>
 #include <stdexcept>
 
 // 3
@@ -53,30 +57,226 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //Rings
 //    0
 
+namespace
+{
+
+/*
+  Reads the whole file in one go and hands out the words of the atom lines as pointers into the buffer,
+  so no line or word is ever copied into a std::string. Only the first six words of an atom line are used:
+  element, number, label, x, y, z. Everything after the atoms is ignored.
+*/
+class FlxLexer
+{
+public:
+
+    explicit FlxLexer( const FileName & file_name ): file_name_(file_name), position_(0), natoms_(0), natoms_read_(0)
+    {
+        std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+        if ( ! input_file )
+            throw std::runtime_error( "FlxLexer::FlxLexer(): Could not open file " + file_name.full_name() );
+        input_file.seekg( 0, std::ios::end );
+        buffer_.resize( static_cast<size_t>( input_file.tellg() ) );
+        input_file.seekg( 0, std::ios::beg );
+        if ( ! buffer_.empty() )
+            input_file.read( &buffer_[0], buffer_.size() );
+        // Read number of atoms
+        if ( ( ! next_line( 1 ) ) || ( word_end_[0] != line_end_ ) )
+            throw std::runtime_error( "FlxLexer::FlxLexer(): unexpected file format in " + file_name_.full_name() );
+        natoms_begin_ = word_begin_[0];
+        natoms_end_ = word_end_[0];
+        // Technically an error here if number of atoms is negative
+        natoms_ = string2integer( std::string( natoms_begin_, natoms_end_ ) );
+        if ( natoms_ == 0 )
+            throw std::runtime_error( "FlxLexer::FlxLexer(): unexpected file format in " + file_name_.full_name() );
+        atoms_start_ = position_;
+    }
+
+    const FileName & file_name() const { return file_name_; }
+
+    size_t natoms() const { return natoms_; }
+
+    // The number of atoms as it is written in the file.
+    const char * natoms_begin() const { return natoms_begin_; }
+    const char * natoms_end() const { return natoms_end_; }
+
+    // Words 0 ... 5 of the next atom line are [ word_begin( i ), word_end( i ) ).
+    void next_atom()
+    {
+        if ( natoms_read_ == natoms_ )
+            throw std::runtime_error( "FlxLexer::next_atom(): all atoms have been read." );
+        if ( ! next_line( 6 ) )
+            throw std::runtime_error( "FlxLexer::next_atom(): unexpected file format in atom line " + size_t2string( natoms_read_ + 1 ) + " of " + file_name_.full_name() );
+        ++natoms_read_;
+    }
+
+    // The next call to next_atom() returns the first atom again.
+    void rewind()
+    {
+        position_ = atoms_start_;
+        natoms_read_ = 0;
+    }
+
+    const char * word_begin( const size_t i ) const { return word_begin_[i]; }
+    const char * word_end( const size_t i ) const { return word_end_[i]; }
+
+private:
+    FileName file_name_;
+    std::vector< char > buffer_;
+    size_t position_;
+    size_t atoms_start_;
+    size_t natoms_;
+    size_t natoms_read_;
+    const char * natoms_begin_;
+    const char * natoms_end_;
+    const char * line_end_;
+    const char * word_begin_[6];
+    const char * word_end_[6];
+
+    static bool is_white_space( const char c ) { return ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ); }
+
+    // Skips empty lines. Returns false at the end of the file or if the line has fewer than nwords words.
+    bool next_line( const size_t nwords )
+    {
+        const char * buffer_end = buffer_.empty() ? 0 : &buffer_[0] + buffer_.size();
+        while ( position_ < buffer_.size() )
+        {
+            const char * i = &buffer_[0] + position_;
+            line_end_ = i;
+            while ( ( line_end_ != buffer_end ) && ( *line_end_ != '\n' ) )
+                ++line_end_;
+            position_ = ( line_end_ == buffer_end ) ? buffer_.size() : ( line_end_ - &buffer_[0] ) + 1;
+            while ( ( line_end_ != i ) && is_white_space( *( line_end_ - 1 ) ) )
+                --line_end_;
+            size_t nwords_found( 0 );
+            while ( nwords_found != nwords )
+            {
+                while ( ( i != line_end_ ) && is_white_space( *i ) )
+                    ++i;
+                if ( i == line_end_ )
+                    break;
+                word_begin_[nwords_found] = i;
+                while ( ( i != line_end_ ) && ( ! is_white_space( *i ) ) )
+                    ++i;
+                word_end_[nwords_found] = i;
+                ++nwords_found;
+            }
+            if ( nwords_found == 0 )
+                continue;
+            return ( nwords_found == nwords );
+        }
+        return false;
+    }
+};
+
+// As pad_plus(), appends e.g. " 1.123  " or "-1.123  " to output.
+void append_pad_plus( std::string & output, const char * begin, const char * end, const size_t padded_length )
+{
+    const size_t start = output.size();
+    if ( ( begin != end ) && ( *begin != '-' ) && ( *begin != '+' ) )
+        output += ' ';
+    output.append( begin, end );
+    if ( output.size() - start < padded_length )
+        output.append( padded_length - ( output.size() - start ), ' ' );
+}
+
+void convert_flx2xyz( FlxLexer & input_file, const FileName & output_file_name )
+{
+    std::string output;
+    // An atom line is 2 + 3 * 16 characters plus a newline, with some room for long numbers
+    output.reserve( 32 + 64 * input_file.natoms() );
+    output.append( input_file.natoms_begin(), input_file.natoms_end() );
+    output += "\n\n";
+    for ( size_t i( 0 ); i != input_file.natoms(); ++i )
+    {
+        input_file.next_atom();
+        const size_t start = output.size();
+        output.append( input_file.word_begin( 0 ), input_file.word_end( 0 ) );
+        if ( output.size() - start < 2 )
+            output.append( 2 - ( output.size() - start ), ' ' );
+        for ( size_t j( 3 ); j != 6; ++j )
+        {
+            output += ' ';
+            append_pad_plus( output, input_file.word_begin( j ), input_file.word_end( j ), 15 );
+        }
+        output += '\n';
+    }
+    TextFileWriter output_file( output_file_name );
+    output_file.write( output );
+}
+
+void read_flx( FlxLexer & input_file, const CrystalLattice & crystal_lattice, CrystalStructure & crystal_structure )
+{
+    crystal_structure = CrystalStructure();
+    crystal_structure.set_name( input_file.file_name().file_name() );
+    crystal_structure.set_crystal_lattice( crystal_lattice );
+    crystal_structure.reserve_natoms( input_file.natoms() );
+    for ( size_t i( 0 ); i != input_file.natoms(); ++i )
+    {
+        input_file.next_atom();
+        Vector3D position( string2double( input_file.word_begin( 3 ), input_file.word_end( 3 ) ),
+                           string2double( input_file.word_begin( 4 ), input_file.word_end( 4 ) ),
+                           string2double( input_file.word_begin( 5 ), input_file.word_end( 5 ) ) );
+        crystal_structure.add_atom( Atom( Element( input_file.word_begin( 0 ), input_file.word_end( 0 ) ),
+                                          crystal_lattice.orthogonal_to_fractional( position ),
+                                          std::string( input_file.word_begin( 2 ), input_file.word_end( 2 ) ) ) );
+    }
+}
+
+} // namespace
+
+// ********************************************************************************
+
+void read_flx( const FileName & file_name, const CrystalLattice & crystal_lattice, CrystalStructure & crystal_structure )
+{
+    FlxLexer input_file( file_name );
+    read_flx( input_file, crystal_lattice, crystal_structure );
+}
+
 // ********************************************************************************
 
 void convert_flx2xyz( const FileName & input_file_name )
 {
-    TextFileReader_2 input_file( input_file_name );
-    TextFileWriter output_file( replace_extension( input_file_name, "xyz" ) );
-    // Read number of atoms
-    size_t iLine( 0 );
-    std::string line = input_file.line( iLine );
-    std::vector< std::string > words = split( line );
-    if ( words.size() != 1 )
-        throw std::runtime_error( "convert_flx2xyz(): unexpected file format." );
-    // Technically an error here if number of atoms is negative
-    size_t natoms = string2integer( words[0] );
-    if ( natoms == 0 )
-        throw std::runtime_error( "convert_flx2xyz(): unexpected file format." );
-    output_file.write_line( words[0] );
-    output_file.write_line();
-    for ( size_t i( 0 ); i != natoms; ++i )
+    FlxLexer input_file( input_file_name );
+    convert_flx2xyz( input_file, replace_extension( input_file_name, "xyz" ) );
+}
+
+// ********************************************************************************
+
+size_t convert_flx2xyz( const FileList & file_list,
+                        std::vector< std::string > & error_messages,
+                        const size_t nthreads,
+                        const bool write_binary_cache,
+                        const CrystalLattice & crystal_lattice )
+{
+    error_messages = std::vector< std::string >( file_list.size() );
+    parallel_for( file_list.size(), nthreads, [&]( const size_t i )
+    {
+        try
+        {
+            FlxLexer input_file( file_list.value( i ) );
+            convert_flx2xyz( input_file, replace_extension( input_file.file_name(), "xyz" ) );
+            if ( write_binary_cache )
+            {
+                input_file.rewind();
+                CrystalStructure crystal_structure;
+                read_flx( input_file, crystal_lattice, crystal_structure );
+                crystal_structure.save_binary( binary_cache_file_name( input_file.file_name() ) );
+            }
+        }
+        catch ( std::exception & e )
+        {
+            error_messages[i] = std::string( e.what() );
+            if ( error_messages[i].empty() )
+                error_messages[i] = "Unknown error.";
+        }
+    } );
+    size_t nerrors( 0 );
+    for ( size_t i( 0 ); i != error_messages.size(); ++i )
     {
-        ++iLine;
-        words = split( input_file.line( iLine ) );
-        output_file.write_line( pad( words[0], 2 ) + " " + pad_plus( words[3], 15 ) + " " + pad_plus( words[4], 15 ) + " " + pad_plus( words[5], 15 ) );
+        if ( ! error_messages[i].empty() )
+            ++nerrors;
     }
+    return nerrors;
 }
 
 // ********************************************************************************
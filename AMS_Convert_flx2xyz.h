@@ -28,9 +28,34 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+class CrystalStructure;
+class FileList;
+class FileName;
+
+#include "CrystalLattice.h"
+
+#include <cstddef> // For definition of size_t
 #include <string>
+#include <vector>
+
+// Reads the atoms of an AMS .flx file. The coordinates in the file are Cartesian, they are converted to fractional coordinates
+// with crystal_lattice, which becomes the lattice of crystal_structure. The space group is P1, the labels are those in the file.
+void read_flx( const FileName & file_name, const CrystalLattice & crystal_lattice, CrystalStructure & crystal_structure );
+
+// Writes the atoms as an .xyz file with the same name. The coordinates are copied as text, so no precision is lost.
+void convert_flx2xyz( const FileName & input_file_name );
 
-void convert_flx2xyz( const std::string & input_file_name );
+// Converts all files in file_list on nthreads threads (0 means one per core); file_list can be made from a wildcard pattern
+// with FileList::initialise_from_directory(). With write_binary_cache, each structure, as read by read_flx(),
+// is also saved as a binary snapshot next to the file (see binary_cache_file_name() and CrystalStructure::save_binary()).
+// A file that cannot be converted does not stop the others, the reason is stored in error_messages,
+// which is resized to the number of files and is empty for the files that were converted successfully.
+// Returns the number of files that could not be converted.
+size_t convert_flx2xyz( const FileList & file_list,
+                        std::vector< std::string > & error_messages,
+                        const size_t nthreads = 0,
+                        const bool write_binary_cache = false,
+                        const CrystalLattice & crystal_lattice = CrystalLattice() );
 
 #endif // AMS_CONVERT_FLX2XYZ_H
 
@@ -28,14 +28,25 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "AnalyseRings.h"
 //#include "CollectionOfPoints.h"
 #include "Angle.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
 #include "CyclicInteger.h"
+#include "FileList.h"
+#include "Logger.h"
+#include "MathConstants.h"
 #include "MathFunctions.h"
+#include "ParallelFor.h"
 #include "Plane.h"
+#include "ReadCif.h"
+#include "ScratchArena.h"
 #include "Vector3D.h"
 #include "Sort.h"
 #include "Vector3DCalculations.h"
 #include "3DCalculations.h"
 
+#include <algorithm>
+#include <memory_resource>
+#include <set>
 #include <stdexcept>
 #include <iostream> // For testing only
 #include <cmath>
@@ -371,3 +382,216 @@ SixMemberedRingAnalyser::GeometryType SixMemberedRingAnalyser::axial_or_equatori
 
 // ********************************************************************************
 
+std::string RingPuckering::conformation() const
+{
+    if ( nmembers_ == 5 )
+    {
+        if ( q2_ < 0.1 )
+            return "planar";
+        // phi2 = 0, 36, 72, ... is an envelope, phi2 = 18, 54, 90, ... is a twist
+        const double remainder = std::fmod( phi2_.value_in_degrees(), 36.0 );
+        if ( ( remainder < 9.0 ) || ( remainder > 27.0 ) )
+            return "envelope";
+        return "twist";
+    }
+    if ( nmembers_ != 6 )
+        throw std::runtime_error( "RingPuckering::conformation(): ring must have five or six members." );
+    if ( Q_ < 0.1 )
+        return "planar";
+    const double theta = theta_.value_in_degrees();
+    if ( ( theta < 22.5 ) || ( theta > 157.5 ) )
+        return "chair";
+    // phi2 = 0, 60, 120, ... is a boat (theta = 90) or an envelope, phi2 = 30, 90, 150, ... is a twist-boat or a half-chair
+    const double remainder = std::fmod( phi2_.value_in_degrees(), 60.0 );
+    const bool on_multiple_of_60 = ( remainder < 15.0 ) || ( remainder > 45.0 );
+    if ( ( 67.5 < theta ) && ( theta < 112.5 ) )
+        return on_multiple_of_60 ? "boat" : "twist-boat";
+    return on_multiple_of_60 ? "envelope" : "half-chair";
+}
+
+// ********************************************************************************
+
+RingPuckering Cremer_Pople( const Vector3D * points, const size_t n )
+{
+    if ( ( n != 5 ) && ( n != 6 ) )
+        throw std::runtime_error( "Cremer_Pople(): ring must have five or six members." );
+    Vector3D centroid;
+    for ( size_t j( 0 ); j != n; ++j )
+        centroid += points[j];
+    centroid /= static_cast< double >( n );
+    Vector3D r[6];
+    Vector3D R1;
+    Vector3D R2;
+    for ( size_t j( 0 ); j != n; ++j )
+    {
+        r[j] = points[j] - centroid;
+        const double angle = 2.0 * CONSTANT_PI * j / n;
+        R1 += sin( angle ) * r[j];
+        R2 += cos( angle ) * r[j];
+    }
+    Vector3D normal = cross_product( R1, R2 );
+    const double length = normal.length();
+    if ( length < 1.0E-6 )
+        throw std::runtime_error( "Cremer_Pople(): mean plane is undefined." );
+    normal /= length;
+    double z[6];
+    double c( 0.0 );
+    double s( 0.0 );
+    for ( size_t j( 0 ); j != n; ++j )
+    {
+        z[j] = r[j] * normal;
+        const double angle = 4.0 * CONSTANT_PI * j / n;
+        c += z[j] * cos( angle );
+        s += z[j] * sin( angle );
+    }
+    RingPuckering result;
+    result.nmembers_ = n;
+    result.q2_ = sqrt( 2.0 / n ) * sqrt( square( c ) + square( s ) );
+    result.phi2_ = ATAN2( -s, c );
+    if ( result.phi2_ < Angle() )
+        result.phi2_ += Angle::from_degrees( 360.0 );
+    if ( n == 6 )
+    {
+        double sum( 0.0 );
+        for ( size_t j( 0 ); j != n; ++j )
+            sum += ( j % 2 == 0 ) ? z[j] : -z[j];
+        result.q3_ = sqrt( 1.0 / 6.0 ) * sum;
+        result.Q_ = sqrt( square( result.q2_ ) + square( result.q3_ ) );
+        result.theta_ = ATAN2( result.q2_, result.q3_ );
+    }
+    else
+        result.Q_ = result.q2_;
+    return result;
+}
+
+// ********************************************************************************
+
+namespace
+{
+
+void extend_ring( const CrystalStructure & crystal_structure, std::vector< size_t > & path, std::vector< std::vector< size_t > > & rings )
+{
+    const size_t start = path.front();
+    const SmallVector< size_t, 4 > & neighbours = crystal_structure.bonded_atoms( path.back() );
+    for ( size_t i( 0 ); i != neighbours.size(); ++i )
+    {
+        const size_t next = neighbours[i];
+        if ( ( next == start ) && ( path.size() >= 5 ) && ( path[1] < path.back() ) )
+        {
+            rings.push_back( path );
+            continue;
+        }
+        // Only atoms with a higher index than the start atom, so that every ring is found from its lowest atom only
+        if ( ( next <= start ) || ( path.size() == 6 ) || ( std::find( path.begin(), path.end(), next ) != path.end() ) )
+            continue;
+        path.push_back( next );
+        extend_ring( crystal_structure, path, rings );
+        path.pop_back();
+    }
+}
+
+bool has_chord( const CrystalStructure & crystal_structure, const std::vector< size_t > & ring )
+{
+    const size_t n = ring.size();
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        const SmallVector< size_t, 4 > & neighbours = crystal_structure.bonded_atoms( ring[i] );
+        for ( size_t j( i + 2 ); j < n; ++j )
+        {
+            if ( ( i == 0 ) && ( j == n - 1 ) )
+                continue;
+            if ( std::find( neighbours.begin(), neighbours.end(), ring[j] ) != neighbours.end() )
+                return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+std::vector< std::vector< size_t > > find_five_and_six_membered_rings( const CrystalStructure & crystal_structure )
+{
+    if ( ( crystal_structure.natoms() != 0 ) && ( crystal_structure.nmolecules() == 0 ) )
+        throw std::runtime_error( "find_five_and_six_membered_rings(): perceive_molecules() must be called first." );
+    std::vector< std::vector< size_t > > candidates;
+    std::vector< size_t > path;
+    path.reserve( 6 );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        path.assign( 1, i );
+        extend_ring( crystal_structure, path, candidates );
+    }
+    std::vector< std::vector< size_t > > result;
+    for ( size_t i( 0 ); i != candidates.size(); ++i )
+    {
+        if ( ! has_chord( crystal_structure, candidates[i] ) )
+            result.push_back( candidates[i] );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+void ring_coordinates( const CrystalStructure & crystal_structure, const std::vector< size_t > & ring, Vector3D * points )
+{
+    if ( ring.empty() )
+        return;
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    Vector3D position = crystal_structure.atom( ring[0] ).position();
+    points[0] = crystal_lattice.fractional_to_orthogonal_matrix() * position;
+    for ( size_t j( 1 ); j != ring.size(); ++j )
+    {
+        double distance;
+        Vector3D difference_vector;
+        crystal_lattice.shortest_distance( position, crystal_structure.atom( ring[j] ).position(), distance, difference_vector );
+        position += difference_vector;
+        points[j] = crystal_lattice.fractional_to_orthogonal_matrix() * position;
+    }
+}
+
+// ********************************************************************************
+
+std::vector< RingConformation > analyse_ring_conformations( const FileList & file_list, const size_t nthreads )
+{
+    const size_t nfiles = file_list.size();
+    std::vector< std::vector< RingConformation > > per_file( nfiles );
+    parallel_for( nfiles, nthreads, [&]( const size_t i )
+    {
+        ScratchArenaScope scratch_arena_scope;
+        try
+        {
+            CrystalStructure crystal_structure;
+            read_cif( file_list.value( i ), crystal_structure );
+            crystal_structure.perceive_molecules();
+            const std::vector< std::vector< size_t > > rings = find_five_and_six_membered_rings( crystal_structure );
+            std::pmr::set< std::vector< std::string > > seen( scratch_resource() );
+            Vector3D points[6];
+            for ( size_t j( 0 ); j != rings.size(); ++j )
+            {
+                RingConformation ring_conformation;
+                ring_conformation.file_index_ = i;
+                for ( size_t k( 0 ); k != rings[j].size(); ++k )
+                    ring_conformation.labels_.push_back( crystal_structure.atom( rings[j][k] ).label() );
+                std::vector< std::string > key( ring_conformation.labels_ );
+                std::sort( key.begin(), key.end() );
+                if ( ! seen.insert( key ).second )
+                    continue;
+                ring_coordinates( crystal_structure, rings[j], points );
+                ring_conformation.puckering_ = Cremer_Pople( points, rings[j].size() );
+                per_file[i].push_back( ring_conformation );
+            }
+        }
+        catch ( std::exception & e )
+        {
+            per_file[i].clear();
+            log_warning( "analyse_ring_conformations(): skipping " + file_list.value( i ).full_name() + ": " + e.what() );
+        }
+    } );
+    std::vector< RingConformation > result;
+    for ( size_t i( 0 ); i != nfiles; ++i )
+        result.insert( result.end(), per_file[i].begin(), per_file[i].end() );
+    return result;
+}
+
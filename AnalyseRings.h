@@ -28,10 +28,15 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "Angle.h"
+
 //class CollectionOfPoints;
+class CrystalStructure;
+class FileList;
 class Vector3D;
 
 #include <cstddef> // For definition of size_t
+#include <string>
 #include <vector>
 
 class FiveMemberedRingAnalyser
@@ -135,5 +140,48 @@ private:
 
 };
 
+// Cremer-Pople puckering parameters (J. Am. Chem. Soc. (1975), 97, 1354-1358) of a five- or six-membered ring.
+// For a five-membered ring, q3 and theta are 0.
+struct RingPuckering
+{
+    RingPuckering() : nmembers_(0), Q_(0.0), q2_(0.0), q3_(0.0) {}
+
+    size_t nmembers_;
+    double Q_;     // Total puckering amplitude, in Angstrom
+    double q2_;
+    Angle phi2_;   // Between 0 and 360 degrees
+    double q3_;
+    Angle theta_;  // Between 0 and 180 degrees, 0 or 180 is a chair
+
+    // "planar", "envelope" or "twist" for five-membered rings; "planar", "chair", "boat", "twist-boat", "half-chair" or "envelope" for six-membered rings.
+    std::string conformation() const;
+};
+
+// The points must be in order around the ring, n must be 5 or 6. The mean plane is the Cremer-Pople plane, which follows
+// in closed form from the positions, and all intermediate results are kept in fixed-size arrays, so nothing is allocated.
+RingPuckering Cremer_Pople( const Vector3D * points, const size_t n );
+
+// The five- and six-membered rings in the bond graph found by CrystalStructure::perceive_molecules(), which must have been called.
+// Each ring is given as its atom indices in order around the ring. Rings with a bond between two non-neighbouring ring atoms
+// are left out because they consist of two smaller rings. Symmetry copies are included.
+std::vector< std::vector< size_t > > find_five_and_six_membered_rings( const CrystalStructure & crystal_structure );
+
+// The Cartesian coordinates of the atoms of a ring, each atom is placed at the shortest distance from its predecessor,
+// so that rings that straddle a cell boundary are not torn apart.
+void ring_coordinates( const CrystalStructure & crystal_structure, const std::vector< size_t > & ring, Vector3D * points );
+
+struct RingConformation
+{
+    size_t file_index_; // Index into the FileList
+    std::vector< std::string > labels_; // In order around the ring
+    RingPuckering puckering_;
+};
+
+// Reads each .cif file in the list, perceives the molecules and calculates the puckering of every five- and six-membered ring.
+// Rings that are symmetry copies of each other (the same set of atom labels) are only reported once.
+// The files are distributed over nthreads threads (0 means one per core), the results are in the order of the file list.
+// Files that cannot be read are skipped with a warning.
+std::vector< RingConformation > analyse_ring_conformations( const FileList & file_list, const size_t nthreads = 0 );
+
 #endif // ANALYSERINGS_H
 
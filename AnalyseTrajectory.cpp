@@ -28,13 +28,130 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "AnalyseTrajectory.h"
 #include "3DCalculations.h"
 #include "AnisotropicDisplacementParameters.h"
+#include "Checkpoint.h"
 #include "CrystalStructure.h"
 #include "DoubleWithESD.h"
 #include "Element.h"
-#include "ReadCif.h"
+#include "Logger.h"
+#include "ParallelFor.h"
+#include "RunningCovariance.h"
 #include "TextFileWriter.h"
+#include "TimeCorrelation.h"
+#include "TrajectorySource.h"
 #include "Utilities.h"
 
+namespace
+{
+
+// The result of reading and collapsing one frame.
+struct CollapsedFrame
+{
+    CrystalLattice crystal_lattice; // Of the supercell
+    Vector3D actual_centre;
+    std::vector< Vector3D > fractional_positions; // Atom-major, multiplicity copies per atom
+};
+
+// Adds the positions in one frame (atom-major, multiplicity copies per atom) to the accumulators.
+// If trajectory is not empty, the positions are also stored.
+void add_frame( const std::vector< Vector3D > & fractional_positions_frame,
+                const size_t multiplicity,
+                RunningAverageAndESDArray & average_positions,
+                std::vector< RunningCovariance > & position_covariances,
+                std::vector< std::vector< Vector3D > > & trajectory )
+{
+    average_positions.add_values( fractional_positions_frame, multiplicity );
+    for ( size_t i( 0 ); i != position_covariances.size(); ++i )
+    {
+        for ( size_t j( 0 ); j != multiplicity; ++j )
+        {
+            const Vector3D & position = fractional_positions_frame[ i * multiplicity + j ];
+            position_covariances[i].add_value( position );
+            if ( ! trajectory.empty() )
+                trajectory[i].push_back( position );
+        }
+    }
+}
+
+// Every n-th non-hydrogen atom, such that at most max_natoms atoms are used to track the drift.
+// Hydrogen atoms are excluded because they move most. If there are no heavy atoms, all atoms are candidates.
+std::vector< size_t > drift_reference_atoms( const CrystalStructure & crystal_structure, const size_t max_natoms )
+{
+    std::vector< size_t > candidates;
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        if ( ! crystal_structure.atom( i ).element().is_H_or_D() )
+            candidates.push_back( i );
+    }
+    if ( candidates.empty() )
+    {
+        for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+            candidates.push_back( i );
+    }
+    const size_t stride = ( candidates.size() + max_natoms - 1 ) / max_natoms;
+    std::vector< size_t > result;
+    for ( size_t i( 0 ); i < candidates.size(); i += stride )
+        result.push_back( candidates[i] );
+    return result;
+}
+
+// ********************************************************************************
+
+// Adds one frame to the position and velocity autocorrelation functions. The positions are converted to Cartesian coordinates
+// with the unit cell of the frame, the velocities are the differences with the previous frame, in A per frame.
+void add_frame_to_correlation_functions( const std::vector< Vector3D > & fractional_positions_frame,
+                                         const CrystalLattice & unit_cell,
+                                         std::vector< Vector3D > & previous_positions,
+                                         AutocorrelationAccumulator & position_autocorrelation,
+                                         AutocorrelationAccumulator & velocity_autocorrelation )
+{
+    std::vector< Vector3D > positions( fractional_positions_frame );
+    unit_cell.fractional_to_orthogonal( positions );
+    position_autocorrelation.add_values( positions );
+    if ( ! previous_positions.empty() )
+    {
+        std::vector< Vector3D > velocities( positions.size() );
+        for ( size_t i( 0 ); i != positions.size(); ++i )
+            velocities[i] = positions[i] - previous_positions[i];
+        velocity_autocorrelation.add_values( velocities );
+    }
+    previous_positions.swap( positions );
+}
+
+// ********************************************************************************
+
+void write_correlation_function( const FileName & file_name, const std::vector< double > & correlation_function )
+{
+    TextFileWriter text_file_writer( file_name );
+    text_file_writer.write_line( "# tau/frames C(tau) C(tau)/C(0)" );
+    for ( size_t i( 0 ); i != correlation_function.size(); ++i )
+        text_file_writer.write_line( size_t2string( i ) + " " + double2string( correlation_function[i] ) + " " +
+                                     double2string( ( correlation_function[0] == 0.0 ) ? 0.0 : correlation_function[i] / correlation_function[0] ) );
+}
+
+// ********************************************************************************
+
+// Returns M C M^T.
+SymmetricMatrix3D transform_covariance( const Matrix3D & M, const SymmetricMatrix3D & C )
+{
+    double values[3][3];
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( i ); j != 3; ++j )
+        {
+            double value( 0.0 );
+            for ( size_t k( 0 ); k != 3; ++k )
+            {
+                for ( size_t l( 0 ); l != 3; ++l )
+                    value += M.value( i, k ) * C.value( k, l ) * M.value( j, l );
+            }
+            values[i][j] = value;
+        }
+    }
+    return SymmetricMatrix3D( values[0][0], values[1][1], values[2][2], values[0][1], values[0][2], values[1][2] );
+}
+
+} // namespace
+
 // ********************************************************************************
 
 AnalyseTrajectory::AnalyseTrajectory( const FileList file_list,
@@ -42,8 +159,10 @@ AnalyseTrajectory::AnalyseTrajectory( const FileList file_list,
                                       const size_t v,
                                       const size_t w,
                                       const SpaceGroup & space_group,
-                                      const Matrix3D & transformation ) :
-file_list_(file_list),
+                                      const Matrix3D & transformation,
+                                      const size_t nthreads,
+                                      const size_t checkpoint_interval ) :
+directory_(file_list.base_directory()),
 u_(u),
 v_(v),
 w_(w),
@@ -54,30 +173,155 @@ write_lean_(false),
 write_average_(true),
 write_average_noH_(false),
 write_average_ESDs_(false),
-write_sum_(false)
+write_sum_(false),
+write_correlation_functions_(false),
+correlation_window_(100),
+nthreads_(nthreads),
+checkpoint_interval_(checkpoint_interval)
+{
+    analyse( CifTrajectory( file_list ) );
+}
+
+// ********************************************************************************
+
+AnalyseTrajectory::AnalyseTrajectory( const TrajectorySource & trajectory_source,
+                                      const size_t u,
+                                      const size_t v,
+                                      const size_t w,
+                                      const SpaceGroup & space_group,
+                                      const Matrix3D & transformation,
+                                      const size_t nthreads,
+                                      const size_t checkpoint_interval ) :
+directory_(trajectory_source.directory()),
+u_(u),
+v_(v),
+w_(w),
+space_group_(space_group),
+transformation_(transformation),
+write_lean_(false),
+write_average_(true),
+write_average_noH_(false),
+write_average_ESDs_(false),
+write_sum_(false),
+write_correlation_functions_(false),
+correlation_window_(100),
+nthreads_(nthreads),
+checkpoint_interval_(checkpoint_interval),
+drift_correction_(USE_FIRST_FRAME)
 {
-    analyse();
+    analyse( trajectory_source );
 }
 
 // ********************************************************************************
 
-void AnalyseTrajectory::analyse()
+void AnalyseTrajectory::analyse( const TrajectorySource & trajectory_source )
 {
-    file_list_.set_prepend_file_name_with_basedirectory( true );
-    std::string directory;
-    std::string file_name;
-    std::string extension;
+    const size_t ntotal_frames = trajectory_source.nframes();
+    if ( ntotal_frames == 0 )
+        throw std::runtime_error( "AnalyseTrajectory::analyse(): trajectory contains no frames." );
     std::vector< Element > elements;
-    std::vector< RunningAverageAndESD< Vector3D > > average_positions; // Fractional coordinates
+    RunningAverageAndESDArray average_positions; // Fractional coordinates
+    // The ADPs are needed in Cartesian coordinates with respect to the average unit cell, which is only known at the end.
+    // Because the transformation is linear, the covariance in fractional coordinates is accumulated instead.
+    std::vector< RunningCovariance > position_covariances; // Fractional coordinates
     size_t natoms;
+    // Only needed if all positions are written out
     std::vector< std::vector< Vector3D > > fractional_positions_trajectory;
-    // Read the first cif file and initialise everything
+    // Atom-major flat buffer with multiplicity copies per atom, reused for all frames
+    std::vector< Vector3D > fractional_positions_frame;
+    const size_t multiplicity = u_ * v_ * w_ * space_group_.nsymmetry_operators();
+    // Only needed if the time correlation functions are calculated. A window of n positions contains n-1 velocities.
+    const size_t correlation_window = std::min( correlation_window_, ntotal_frames - 1 );
+    const bool calculate_correlation_functions = write_correlation_functions_ && ( correlation_window != 0 );
+    AutocorrelationAccumulator position_autocorrelation;
+    AutocorrelationAccumulator velocity_autocorrelation;
+    std::vector< Vector3D > previous_positions;
+    // The drift is tracked using a subset of the atoms, chosen in the first frame.
+    std::vector< size_t > reference_atoms;
+    // The checkpoint is only used for the same frames and the same settings.
+    const FileName checkpoint_file_name( directory_, "trajectory_checkpoint", "bin" );
+    std::string checkpoint_key = "AnalyseTrajectory " + size_t2string( ntotal_frames ) + " " + trajectory_source.frame_name( 0 ) + " " + trajectory_source.frame_name( ntotal_frames - 1 ) + " " +
+                                 size_t2string( u_ ) + " " + size_t2string( v_ ) + " " + size_t2string( w_ ) + " " + space_group_.name() + " " + size_t2string( space_group_.nsymmetry_operators() ) + " " +
+                                 size_t2string( drift_correction_ ) + ( write_sum_ ? " sum " : " " ) + size_t2string( calculate_correlation_functions ? correlation_window : 0 );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+            checkpoint_key += " " + double2string( transformation_.value( i, j ) );
+    }
+    // Everything that has been accumulated after nframes_done frames.
+    auto save_checkpoint = [&]( const size_t nframes_done )
+    {
+        CheckpointWriter checkpoint_writer;
+        checkpoint_writer.write( nframes_done );
+        average_a_.save( checkpoint_writer );
+        average_b_.save( checkpoint_writer );
+        average_c_.save( checkpoint_writer );
+        average_alpha_.save( checkpoint_writer );
+        average_beta_.save( checkpoint_writer );
+        average_gamma_.save( checkpoint_writer );
+        average_volume_.save( checkpoint_writer );
+        checkpoint_writer.write( centres_of_mass_ );
+        checkpoint_writer.write( drift_correction_vector_ );
+        checkpoint_writer.write( reference_atoms );
+        checkpoint_writer.write( natoms );
+        for ( size_t i( 0 ); i != natoms; ++i )
+            checkpoint_writer.write( elements[i].symbol() );
+        average_positions.save( checkpoint_writer );
+        for ( size_t i( 0 ); i != natoms; ++i )
+            position_covariances[i].save( checkpoint_writer );
+        checkpoint_writer.write( fractional_positions_trajectory );
+        checkpoint_writer.write( previous_positions );
+        position_autocorrelation.save( checkpoint_writer );
+        velocity_autocorrelation.save( checkpoint_writer );
+        checkpoint_writer.save( checkpoint_file_name, checkpoint_key );
+    };
+    size_t nframes_done( 0 );
+    if ( checkpoint_interval_ != 0 )
+    {
+        CheckpointReader checkpoint_reader;
+        if ( checkpoint_reader.load( checkpoint_file_name, checkpoint_key ) )
+        {
+            checkpoint_reader.read( nframes_done );
+            average_a_.load( checkpoint_reader );
+            average_b_.load( checkpoint_reader );
+            average_c_.load( checkpoint_reader );
+            average_alpha_.load( checkpoint_reader );
+            average_beta_.load( checkpoint_reader );
+            average_gamma_.load( checkpoint_reader );
+            average_volume_.load( checkpoint_reader );
+            checkpoint_reader.read( centres_of_mass_ );
+            checkpoint_reader.read( drift_correction_vector_ );
+            checkpoint_reader.read( reference_atoms );
+            checkpoint_reader.read( natoms );
+            elements.reserve( natoms );
+            for ( size_t i( 0 ); i != natoms; ++i )
+            {
+                std::string symbol;
+                checkpoint_reader.read( symbol );
+                elements.push_back( Element( symbol ) );
+            }
+            average_positions.load( checkpoint_reader );
+            position_covariances = std::vector< RunningCovariance >( natoms );
+            for ( size_t i( 0 ); i != natoms; ++i )
+                position_covariances[i].load( checkpoint_reader );
+            checkpoint_reader.read( fractional_positions_trajectory );
+            checkpoint_reader.read( previous_positions );
+            position_autocorrelation.load( checkpoint_reader );
+            velocity_autocorrelation.load( checkpoint_reader );
+            if ( ( nframes_done == 0 ) || ( nframes_done > ntotal_frames ) || ( ! checkpoint_reader.at_end() ) )
+                throw std::runtime_error( "AnalyseTrajectory::analyse(): checkpoint " + checkpoint_file_name.full_name() + " is inconsistent." );
+            log_info( "Resuming from the checkpoint after " + size_t2string( nframes_done ) + " of " + size_t2string( ntotal_frames ) + " frames." );
+        }
+    }
+    ProgressReporter progress( "Now reading frame... ", ntotal_frames );
+    // Read the first frame and initialise everything
+    if ( nframes_done == 0 )
     {
     CrystalStructure crystal_structure;
-    std::cout << "Now reading cif... " + file_list_.value( 0 ).full_name() << std::endl;
-    read_cif( file_list_.value( 0 ), crystal_structure );
+    progress.tick( trajectory_source.frame_name( 0 ) );
+    trajectory_source.read_frame( 0, crystal_structure );
     if ( write_lean_ )
-        crystal_structure.save_cif( append_to_file_name( file_list_.value( 0 ), "_lean" ) );
+        crystal_structure.save_cif( FileName( directory_, trajectory_source.frame_name( 0 ) + "_lean", "cif" ) );
     CrystalLattice crystal_lattice = crystal_structure.crystal_lattice();
     crystal_structure.set_space_group( space_group_ );
     average_a_.add_value( crystal_lattice.a() / u_ );
@@ -87,68 +331,97 @@ void AnalyseTrajectory::analyse()
     average_beta_.add_value( crystal_lattice.beta() );
     average_gamma_.add_value( crystal_lattice.gamma() );
     average_volume_.add_value( crystal_lattice.volume() / ( u_ * v_ * w_ ) );
-    std::vector< std::vector< Vector3D > > fractional_positions_frame;
     Vector3D actual_centre;
+    reference_atoms = drift_reference_atoms( crystal_structure, 500 );
     // Returns a std::vector of atomic coordinates for each atom in the asymmetric unit
     if ( ( drift_correction_ == NONE ) ||
          ( drift_correction_ == USE_FIRST_FRAME ) )
     {
-        crystal_structure.collapse_supercell( u_, v_, w_, 0, drift_correction_vector_, transformation_, actual_centre, fractional_positions_frame );
+        crystal_structure.collapse_supercell( u_, v_, w_, 0, drift_correction_vector_, reference_atoms, transformation_, actual_centre, fractional_positions_frame );
         drift_correction_vector_ = actual_centre;
     }
     else
-        crystal_structure.collapse_supercell( u_, v_, w_, drift_correction_, drift_correction_vector_, transformation_, actual_centre, fractional_positions_frame );
+        crystal_structure.collapse_supercell( u_, v_, w_, drift_correction_, drift_correction_vector_, reference_atoms, transformation_, actual_centre, fractional_positions_frame );
     centres_of_mass_.push_back( actual_centre );
     crystal_structure.transform( transformation_ );
-    natoms = fractional_positions_frame.size();
+    natoms = fractional_positions_frame.size() / multiplicity;
     elements.reserve( natoms );
-    average_positions.reserve( natoms );
     for ( size_t i( 0 ); i != natoms; ++i )
-    {
         elements.push_back( crystal_structure.atom( i ).element() );
-        RunningAverageAndESD< Vector3D > average_position;
-        std::vector< Vector3D > temp_fractional_positions;
-        for ( size_t j( 0 ); j != fractional_positions_frame[i].size(); ++j )
+    average_positions = RunningAverageAndESDArray( natoms );
+    position_covariances = std::vector< RunningCovariance >( natoms );
+    if ( write_sum_ )
+    {
+        fractional_positions_trajectory = std::vector< std::vector< Vector3D > >( natoms );
+        for ( size_t i( 0 ); i != natoms; ++i )
+            fractional_positions_trajectory[i].reserve( multiplicity * ntotal_frames );
+    }
+    add_frame( fractional_positions_frame, multiplicity, average_positions, position_covariances, fractional_positions_trajectory );
+    if ( calculate_correlation_functions )
+    {
+        position_autocorrelation = AutocorrelationAccumulator( natoms * multiplicity, correlation_window, 0, true );
+        velocity_autocorrelation = AutocorrelationAccumulator( natoms * multiplicity, correlation_window );
+        add_frame_to_correlation_functions( fractional_positions_frame,
+                                            CrystalLattice( crystal_lattice.a() / u_, crystal_lattice.b() / v_, crystal_lattice.c() / w_, crystal_lattice.alpha(), crystal_lattice.beta(), crystal_lattice.gamma() ),
+                                            previous_positions, position_autocorrelation, velocity_autocorrelation );
+    }
+    nframes_done = 1;
+    }
+    // Read the remaining frames. The frames are independent, so batches of frames are read and collapsed in parallel,
+    // after which they are added to the accumulators in their original order, so the results do not depend on the number of threads.
+    const size_t nthreads = ( nthreads_ == 0 ) ? default_nthreads() : nthreads_;
+    const size_t batch_size = 2 * nthreads;
+    std::vector< CollapsedFrame > frames( std::min( batch_size, ntotal_frames - 1 ) );
+    size_t nframes_at_checkpoint( nframes_done );
+    for ( size_t batch_start( nframes_done ); batch_start < ntotal_frames; batch_start += batch_size )
+    {
+        const size_t nframes = std::min( batch_size, ntotal_frames - batch_start );
+        parallel_for( nframes, nthreads, [&]( const size_t i )
+        {
+            CrystalStructure crystal_structure;
+            progress.tick( trajectory_source.frame_name( batch_start + i ) );
+            trajectory_source.read_frame( batch_start + i, crystal_structure );
+            if ( write_lean_ )
+                crystal_structure.save_cif( FileName( directory_, trajectory_source.frame_name( batch_start + i ) + "_lean", "cif" ) );
+            frames[i].crystal_lattice = crystal_structure.crystal_lattice();
+            crystal_structure.set_space_group( space_group_ );
+            Matrix3D transformation( transformation_ ); // Passed by non-const reference
+            crystal_structure.collapse_supercell( u_, v_, w_, drift_correction_, drift_correction_vector_, reference_atoms, transformation, frames[i].actual_centre, frames[i].fractional_positions );
+        } );
+        for ( size_t i( 0 ); i != nframes; ++i )
         {
-            average_position.add_value( fractional_positions_frame[i][j] );
-            temp_fractional_positions.push_back( fractional_positions_frame[i][j] );
+            const CrystalLattice & crystal_lattice = frames[i].crystal_lattice;
+            average_a_.add_value( crystal_lattice.a() / u_ );
+            average_b_.add_value( crystal_lattice.b() / v_ );
+            average_c_.add_value( crystal_lattice.c() / w_ );
+            average_alpha_.add_value( crystal_lattice.alpha() );
+            average_beta_.add_value( crystal_lattice.beta() );
+            average_gamma_.add_value( crystal_lattice.gamma() );
+            average_volume_.add_value( crystal_lattice.volume() / ( u_ * v_ * w_ ) );
+            centres_of_mass_.push_back( frames[i].actual_centre );
+            if ( frames[i].fractional_positions.size() != natoms * multiplicity )
+                throw std::runtime_error( "AnalyseTrajectory::analyse(): The number of atoms in the frames is not the same, the average cif could not be generated." );
+            add_frame( frames[i].fractional_positions, multiplicity, average_positions, position_covariances, fractional_positions_trajectory );
+            if ( calculate_correlation_functions )
+                add_frame_to_correlation_functions( frames[i].fractional_positions,
+                                                    CrystalLattice( crystal_lattice.a() / u_, crystal_lattice.b() / v_, crystal_lattice.c() / w_, crystal_lattice.alpha(), crystal_lattice.beta(), crystal_lattice.gamma() ),
+                                                    previous_positions, position_autocorrelation, velocity_autocorrelation );
+        }
+        nframes_done = batch_start + nframes;
+        if ( ( checkpoint_interval_ != 0 ) && ( nframes_done != ntotal_frames ) && ( nframes_done - nframes_at_checkpoint >= checkpoint_interval_ ) )
+        {
+            save_checkpoint( nframes_done );
+            nframes_at_checkpoint = nframes_done;
         }
-        average_positions.push_back( average_position );
-        fractional_positions_trajectory.push_back( temp_fractional_positions );
-    }
     }
-    // Read the remaining cif files
-    for ( size_t i( 1 ); i != file_list_.size(); ++i )
+    if ( calculate_correlation_functions )
     {
-        std::cout << "Now reading cif... " + file_list_.value( i ).full_name() << std::endl;
-        CrystalStructure crystal_structure;
-        read_cif( file_list_.value( i ), crystal_structure );
-        if ( write_lean_ )
-            crystal_structure.save_cif( append_to_file_name( file_list_.value( i ), "_lean" ) );
-        CrystalLattice crystal_lattice = crystal_structure.crystal_lattice();
-        crystal_structure.set_space_group( space_group_ );
-        average_a_.add_value( crystal_lattice.a() / u_ );
-        average_b_.add_value( crystal_lattice.b() / v_ );
-        average_c_.add_value( crystal_lattice.c() / w_ );
-        average_alpha_.add_value( crystal_lattice.alpha() );
-        average_beta_.add_value( crystal_lattice.beta() );
-        average_gamma_.add_value( crystal_lattice.gamma() );
-        average_volume_.add_value( crystal_lattice.volume() / ( u_ * v_ * w_ ) );
-        std::vector< std::vector< Vector3D > > fractional_positions_frame;
-        // Returns a std::vector of atomic coordinates for each atom in the asymmetric unit
-        Vector3D actual_centre;
-        crystal_structure.collapse_supercell( u_, v_, w_, drift_correction_, drift_correction_vector_, transformation_, actual_centre, fractional_positions_frame );
-        centres_of_mass_.push_back( actual_centre );
-        crystal_structure.transform( transformation_ );
-        if ( fractional_positions_frame.size() != natoms )
-            throw std::runtime_error( "AnalyseTrajectory::analyse(): The number of atoms in the cif files is not the same, the average cif could not be generated." );
-        for ( size_t i( 0 ); i != natoms; ++i )
+        position_autocorrelation_ = position_autocorrelation.correlation_function();
+        write_correlation_function( FileName( directory_, "position_autocorrelation", "txt" ), position_autocorrelation_ );
+        if ( velocity_autocorrelation.nwindows() != 0 )
         {
-            for ( size_t j( 0 ); j != fractional_positions_frame[i].size(); ++j )
-            {
-                average_positions[i].add_value( fractional_positions_frame[i][j] );
-                fractional_positions_trajectory[i].push_back( fractional_positions_frame[i][j] );
-            }
+            velocity_autocorrelation_ = velocity_autocorrelation.correlation_function();
+            write_correlation_function( FileName( directory_, "velocity_autocorrelation", "txt" ), velocity_autocorrelation_ );
         }
     }
     CrystalLattice crystal_lattice_average( average_a_.average(),
@@ -157,9 +430,16 @@ void AnalyseTrajectory::analyse()
                                             average_alpha_.average(),
                                             average_beta_.average(),
                                             average_gamma_.average() );
+    std::vector< SymmetricMatrix3D > Ucifs;
+    Ucifs.reserve( natoms );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        AnisotropicDisplacementParameters adps( transform_covariance( crystal_lattice_average.fractional_to_orthogonal_matrix(), position_covariances[i].covariance_matrix() ) );
+        Ucifs.push_back( adps.U_cif( crystal_lattice_average ) );
+    }
     if ( write_average_ )
     {
-        TextFileWriter text_file_writer( FileName( file_list_.base_directory(), "average_adps", "cif" ) );
+        TextFileWriter text_file_writer( FileName( directory_, "average_adps", "cif" ) );
         text_file_writer.write_line( "data_average" );
         text_file_writer.write_line( "_symmetry_space_group_name_H-M  '" + space_group_.name() + "'" );
     //    text_file_writer.write_line( "_symmetry_Int_Tables_number     1" );
@@ -194,9 +474,9 @@ void AnalyseTrajectory::analyse()
             // This is just too weird, need std::vector< DoubleWithESD > for this.
             text_file_writer.write_line( elements[i].symbol() + size_t2string( i + 1, len, '0' ) + " " +
                                          elements[i].symbol() + " " +
-                                         double2string( adjust_for_translations( average_positions[ i ].average().x() ), 6 ) + " " +
-                                         double2string( adjust_for_translations( average_positions[ i ].average().y() ), 6 ) + " " +
-                                         double2string( adjust_for_translations( average_positions[ i ].average().z() ), 6 ) );
+                                         double2string( adjust_for_translations( average_positions.average( i ).x() ), 6 ) + " " +
+                                         double2string( adjust_for_translations( average_positions.average( i ).y() ), 6 ) + " " +
+                                         double2string( adjust_for_translations( average_positions.average( i ).z() ), 6 ) );
         }
         text_file_writer.write_line( "loop_" );
         text_file_writer.write_line( "_atom_site_aniso_label" );
@@ -208,11 +488,7 @@ void AnalyseTrajectory::analyse()
         text_file_writer.write_line( "_atom_site_aniso_U_23" );
         for ( size_t i( 0 ); i != natoms; ++i )
         {
-            std::vector< Vector3D > cartesian_positions;
-            for ( size_t j( 0 ); j != fractional_positions_trajectory[i].size(); ++j )
-                cartesian_positions.push_back( crystal_lattice_average.fractional_to_orthogonal_matrix() * fractional_positions_trajectory[i][j] );
-            AnisotropicDisplacementParameters adps( cartesian_positions );
-            SymmetricMatrix3D Ucif = adps.U_cif( crystal_lattice_average );
+            const SymmetricMatrix3D & Ucif = Ucifs[i];
             // This can go wrong if the ADP is very small, it may be printed like "1E-14" which will not be recognised in the cif.
             text_file_writer.write_line( elements[i].symbol() + size_t2string( i + 1, len, '0' ) + " " +
                                          double2string( Ucif.value( 0, 0 ), 6 ) + " " +
@@ -227,7 +503,7 @@ void AnalyseTrajectory::analyse()
     }
     if ( write_average_noH_ )
     {
-        TextFileWriter text_file_writer( FileName( file_list_.base_directory(), "average_noH", "cif" ) );
+        TextFileWriter text_file_writer( FileName( directory_, "average_noH", "cif" ) );
         text_file_writer.write_line( "data_average" );
         text_file_writer.write_line( "_symmetry_space_group_name_H-M  '" + space_group_.name() + "'" );
     //    text_file_writer.write_line( "_symmetry_Int_Tables_number     1" );
@@ -265,9 +541,9 @@ void AnalyseTrajectory::analyse()
             // This is just too weird, need std::vector< DoubleWithESD > for this.
             text_file_writer.write_line( elements[i].symbol() + size_t2string( i + 1, len, '0' ) + " " +
                                          elements[i].symbol() + " " +
-                                         double2string( adjust_for_translations( average_positions[ i ].average().x() ), 6 ) + " " +
-                                         double2string( adjust_for_translations( average_positions[ i ].average().y() ), 6 ) + " " +
-                                         double2string( adjust_for_translations( average_positions[ i ].average().z() ), 6 ) );
+                                         double2string( adjust_for_translations( average_positions.average( i ).x() ), 6 ) + " " +
+                                         double2string( adjust_for_translations( average_positions.average( i ).y() ), 6 ) + " " +
+                                         double2string( adjust_for_translations( average_positions.average( i ).z() ), 6 ) );
         }
         text_file_writer.write_line( "loop_" );
         text_file_writer.write_line( "_atom_site_aniso_label" );
@@ -281,11 +557,7 @@ void AnalyseTrajectory::analyse()
         {
             if ( elements[i] == hydrogen )
                 continue;
-            std::vector< Vector3D > cartesian_positions;
-            for ( size_t j( 0 ); j != fractional_positions_trajectory[i].size(); ++j )
-                cartesian_positions.push_back( crystal_lattice_average.fractional_to_orthogonal_matrix() * fractional_positions_trajectory[i][j] );
-            AnisotropicDisplacementParameters adps( cartesian_positions );
-            SymmetricMatrix3D Ucif = adps.U_cif( crystal_lattice_average );
+            const SymmetricMatrix3D & Ucif = Ucifs[i];
             // This can go wrong if the ADP is very small, it may be printed like "1E-14" which will not be recognised in the cif.
             text_file_writer.write_line( elements[i].symbol() + size_t2string( i + 1, len, '0' ) + " " +
                                          double2string( Ucif.value( 0, 0 ), 6 ) + " " +
@@ -300,7 +572,7 @@ void AnalyseTrajectory::analyse()
     }
     if ( write_average_ESDs_ )
     {
-        TextFileWriter text_file_writer( FileName( file_list_.base_directory(), "average_ESDs_adps", "cif" ) );
+        TextFileWriter text_file_writer( FileName( directory_, "average_ESDs_adps", "cif" ) );
         text_file_writer.write_line( "data_avg_ESDs" );
         text_file_writer.write_line( "_symmetry_space_group_name_H-M  '" + space_group_.name() + "'" );
     //    text_file_writer.write_line( "_symmetry_Int_Tables_number     1" );
@@ -335,9 +607,9 @@ void AnalyseTrajectory::analyse()
             // This is just too weird, need std::vector< DoubleWithESD > for this.
             text_file_writer.write_line( elements[i].symbol() + size_t2string( i + 1, len, '0' ) + " " +
                                          elements[i].symbol() + " " +
-                                         crystallographic_style( adjust_for_translations( average_positions[ i ].average().x() ), average_positions[ i ].estimated_standard_deviation().x() ) + " " +
-                                         crystallographic_style( adjust_for_translations( average_positions[ i ].average().y() ), average_positions[ i ].estimated_standard_deviation().y() ) + " " +
-                                         crystallographic_style( adjust_for_translations( average_positions[ i ].average().z() ), average_positions[ i ].estimated_standard_deviation().z() ) );
+                                         crystallographic_style( adjust_for_translations( average_positions.average( i ).x() ), average_positions.estimated_standard_deviation( i ).x() ) + " " +
+                                         crystallographic_style( adjust_for_translations( average_positions.average( i ).y() ), average_positions.estimated_standard_deviation( i ).y() ) + " " +
+                                         crystallographic_style( adjust_for_translations( average_positions.average( i ).z() ), average_positions.estimated_standard_deviation( i ).z() ) );
         }
         text_file_writer.write_line( "loop_" );
         text_file_writer.write_line( "_atom_site_aniso_label" );
@@ -349,11 +621,7 @@ void AnalyseTrajectory::analyse()
         text_file_writer.write_line( "_atom_site_aniso_U_23" );
         for ( size_t i( 0 ); i != natoms; ++i )
         {
-            std::vector< Vector3D > cartesian_positions;
-            for ( size_t j( 0 ); j != fractional_positions_trajectory[i].size(); ++j )
-                cartesian_positions.push_back( crystal_lattice_average.fractional_to_orthogonal_matrix() * fractional_positions_trajectory[i][j] );
-            AnisotropicDisplacementParameters adps( cartesian_positions );
-            SymmetricMatrix3D Ucif = adps.U_cif( crystal_lattice_average );
+            const SymmetricMatrix3D & Ucif = Ucifs[i];
             // This can go wrong if the ADP is very small, it may be printed like "1E-14" which will not be recognised in the cif.
             text_file_writer.write_line( elements[i].symbol() + size_t2string( i + 1, len, '0' ) + " " +
                                          double2string( Ucif.value( 0, 0 ), 6 ) + " " +
@@ -369,7 +637,7 @@ void AnalyseTrajectory::analyse()
 
     if ( write_sum_ )
     {
-        TextFileWriter text_file_writer( FileName( file_list_.base_directory(), "average_sum", "cif" ) );
+        TextFileWriter text_file_writer( FileName( directory_, "average_sum", "cif" ) );
         text_file_writer.write_line( "data_sum" );
         text_file_writer.write_line( "_symmetry_space_group_name_H-M  '" + space_group_.name() + "'" );
     //    text_file_writer.write_line( "_symmetry_Int_Tables_number     1" );
@@ -411,6 +679,8 @@ void AnalyseTrajectory::analyse()
         text_file_writer.write_line();
         text_file_writer.write_line( "#END" );
     }
+    if ( checkpoint_interval_ != 0 )
+        remove_checkpoint( checkpoint_file_name );
 }
 
 // ********************************************************************************
@@ -429,7 +699,7 @@ CrystalLattice AnalyseTrajectory::average_crystal_lattice() const
 
 void AnalyseTrajectory::save_centres_of_mass() const
 {
-    TextFileWriter text_file_writer( FileName( file_list_.base_directory(), "centres_of_mass", "txt" ) );
+    TextFileWriter text_file_writer( FileName( directory_, "centres_of_mass", "txt" ) );
     CrystalLattice average_crystal_lattice( this->average_crystal_lattice() );
     for ( size_t i( 0 ); i != centres_of_mass_.size(); ++i )
         text_file_writer.write_line( double2string( centres_of_mass_[i].x() ) + " " +
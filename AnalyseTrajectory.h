@@ -34,11 +34,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "SpaceGroup.h"
 #include "Vector3D.h"
 
+class TrajectorySource;
+
+#include <string>
 #include <vector>
 
 /*
-  Analyses an MD trajectory which must be provided as a set of cif files in the correct order.
-  Each cif file must have the same number of atoms, in the same order.
+  Analyses an MD trajectory which must be provided as a set of cif files in the correct order or as a TrajectorySource.
+  Each frame must have the same number of atoms, in the same order.
   u, v, w are the dimensions of the supercell with respect to the original unit cell.
   Collapse supercell, assume order *in the unit cell* (not in the molecule) can be trusted
   (if there are n atoms in a unit cell, then atom n+1 corresponds to atom 1 in unit cell 1).
@@ -46,6 +49,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
   The method assumes that we are dealing with a solid where atomic coordinates are fairly constant and symmetry-related copies can be
   easily identified from simple geometric considerations.
   Because it is assumed to be a solid, there is no provision for rotational drift.
+  The translational drift is tracked with the average position of a subset of at most 500 non-hydrogen atoms.
   Space-group symmetry is also used to group *all* symmetry copies of each atom--so make sure that the space group is correct,
   i.e. that no phase transition has taken place. Of course, if the space group is P1 there is no problem.
   You'll get horrible results when applying the space-group symmetry if you have manually repositioned the molecules so that all molecules were comfortably within the unit cell.
@@ -60,12 +64,29 @@ public:
 
     // Make sure the space group name is set properly: it is written to the cif file.
     // transformation does not work
+    // The frames are read on nthreads threads (0 means one per core), the results do not depend on the number of threads.
+    // With a checkpoint_interval, the state of the analysis is saved to trajectory_checkpoint.bin in the output directory
+    // whenever at least checkpoint_interval frames have been added since the last checkpoint. If the analysis is stopped, running it again resumes after the last checkpoint,
+    // with the same results as an uninterrupted run. The checkpoint is removed when the analysis has finished.
     explicit AnalyseTrajectory( const FileList file_list,
                                 const size_t u = 1,
                                 const size_t v = 1,
                                 const size_t w = 1,
                                 const SpaceGroup & space_group = SpaceGroup(),
-                                const Matrix3D & transformation = Matrix3D() );
+                                const Matrix3D & transformation = Matrix3D(),
+                                const size_t nthreads = 0,
+                                const size_t checkpoint_interval = 0 );
+
+    // For trajectories that are not a set of cif files, e.g. a .dcd or a DL_POLY HISTORY file.
+    // The output files are written to trajectory_source.directory().
+    explicit AnalyseTrajectory( const TrajectorySource & trajectory_source,
+                                const size_t u = 1,
+                                const size_t v = 1,
+                                const size_t w = 1,
+                                const SpaceGroup & space_group = SpaceGroup(),
+                                const Matrix3D & transformation = Matrix3D(),
+                                const size_t nthreads = 0,
+                                const size_t checkpoint_interval = 0 );
 
     enum DriftCorrection { NONE, USE_FIRST_FRAME, USE_VECTOR };
 
@@ -87,13 +108,20 @@ public:
 
     std::vector< Vector3D > centres_of_mass() const { return centres_of_mass_; }
     
-    // Convenience function for lazy people. Writes centres of mass to file in same directory as FileList.
+    // Convenience function for lazy people. Writes centres of mass to file in same directory as the trajectory.
     void save_centres_of_mass() const;
+
+    // Time autocorrelation functions in units of frames, calculated over a sliding window of correlation_window_ frames
+    // and averaged over all atoms in the supercell. Empty unless write_correlation_functions_ is set.
+    // The position autocorrelation function is that of the displacements from the average position within the window, in A^2.
+    // The velocities are the differences between consecutive frames, in A per frame.
+    std::vector< double > position_autocorrelation() const { return position_autocorrelation_; }
+    std::vector< double > velocity_autocorrelation() const { return velocity_autocorrelation_; }
     
 //  ADPs / ESDs / averages
 
 private:
-    FileList file_list_;
+    std::string directory_;
     size_t u_;
     size_t v_;
     size_t w_;
@@ -105,6 +133,10 @@ private:
     bool write_average_noH_;
     bool write_average_ESDs_;
     bool write_sum_;
+    bool write_correlation_functions_;
+    size_t correlation_window_;
+    size_t nthreads_;
+    size_t checkpoint_interval_;
     DriftCorrection drift_correction_;
     Vector3D drift_correction_vector_;
     RunningAverageAndESD<double> average_a_;
@@ -114,9 +146,11 @@ private:
     RunningAverageAndESD<Angle> average_beta_;
     RunningAverageAndESD<Angle> average_gamma_;
     RunningAverageAndESD<double> average_volume_;
-    std::vector< Vector3D > centres_of_mass_; // Monitors the drift.
+    std::vector< Vector3D > centres_of_mass_; // Monitors the drift. Of the reference atoms only.
+    std::vector< double > position_autocorrelation_;
+    std::vector< double > velocity_autocorrelation_;
 
-    void analyse();
+    void analyse( const TrajectorySource & trajectory_source );
 };
 
 #endif // ANALYSETRAJECTORY_H
@@ -31,6 +31,140 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Matrix3D.h"
 #include "Vector3D.h"
 
+#include <stdexcept>
+
+namespace
+{
+
+// Row-major copy of a Matrix3D, so that the kernels below work on plain doubles.
+void copy_matrix( const Matrix3D & matrix, double m[9] )
+{
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+            m[3*i+j] = matrix.value( i, j );
+    }
+}
+
+// result = M U M^T for one packed symmetric U (U11 U22 U33 U12 U13 U23). result may be equal to U.
+inline void sandwich( const double m[9], const double * U, double * result )
+{
+    const double u00 = U[0];
+    const double u11 = U[1];
+    const double u22 = U[2];
+    const double u01 = U[3];
+    const double u02 = U[4];
+    const double u12 = U[5];
+    // T = M U
+    const double t00 = m[0]*u00 + m[1]*u01 + m[2]*u02;
+    const double t01 = m[0]*u01 + m[1]*u11 + m[2]*u12;
+    const double t02 = m[0]*u02 + m[1]*u12 + m[2]*u22;
+    const double t10 = m[3]*u00 + m[4]*u01 + m[5]*u02;
+    const double t11 = m[3]*u01 + m[4]*u11 + m[5]*u12;
+    const double t12 = m[3]*u02 + m[4]*u12 + m[5]*u22;
+    const double t20 = m[6]*u00 + m[7]*u01 + m[8]*u02;
+    const double t21 = m[6]*u01 + m[7]*u11 + m[8]*u12;
+    const double t22 = m[6]*u02 + m[7]*u12 + m[8]*u22;
+    // T M^T, only the upper triangle
+    result[0] = t00*m[0] + t01*m[1] + t02*m[2];
+    result[1] = t10*m[3] + t11*m[4] + t12*m[5];
+    result[2] = t20*m[6] + t21*m[7] + t22*m[8];
+    result[3] = t00*m[3] + t01*m[4] + t02*m[5];
+    result[4] = t00*m[6] + t01*m[7] + t02*m[8];
+    result[5] = t10*m[6] + t11*m[7] + t12*m[8];
+}
+
+// result = N U N for one packed symmetric U and a diagonal N = diag( n[0], n[1], n[2] ). result may be equal to U.
+inline void scale( const double n[3], const double * U, double * result )
+{
+    result[0] = U[0] * n[0] * n[0];
+    result[1] = U[1] * n[1] * n[1];
+    result[2] = U[2] * n[2] * n[2];
+    result[3] = U[3] * n[0] * n[1];
+    result[4] = U[4] * n[0] * n[2];
+    result[5] = U[5] * n[1] * n[2];
+}
+
+void pack( const SymmetricMatrix3D & matrix, double U[6] )
+{
+    U[0] = matrix.value( 0, 0 );
+    U[1] = matrix.value( 1, 1 );
+    U[2] = matrix.value( 2, 2 );
+    U[3] = matrix.value( 0, 1 );
+    U[4] = matrix.value( 0, 2 );
+    U[5] = matrix.value( 1, 2 );
+}
+
+SymmetricMatrix3D unpack( const double U[6] )
+{
+    return SymmetricMatrix3D( U[0], U[1], U[2], U[3], U[4], U[5] );
+}
+
+SymmetricMatrix3D sandwich( const Matrix3D & matrix, const SymmetricMatrix3D & U )
+{
+    double m[9];
+    copy_matrix( matrix, m );
+    double U_packed[6];
+    pack( U, U_packed );
+    sandwich( m, U_packed, U_packed );
+    return unpack( U_packed );
+}
+
+SymmetricMatrix3D scale( const SymmetricMatrix3D & N, const SymmetricMatrix3D & U )
+{
+    double n[3] = { N.value( 0, 0 ), N.value( 1, 1 ), N.value( 2, 2 ) };
+    double U_packed[6];
+    pack( U, U_packed );
+    scale( n, U_packed, U_packed );
+    return unpack( U_packed );
+}
+
+void check_packed_size( const std::vector< double > & input, const std::string & function_name )
+{
+    if ( ( input.size() % 6 ) != 0 )
+        throw std::runtime_error( function_name + ": number of values must be a multiple of 6." );
+}
+
+void sandwich( const Matrix3D & matrix, const std::vector< double > & input, std::vector< double > & output, const std::string & function_name )
+{
+    check_packed_size( input, function_name );
+    double m[9];
+    copy_matrix( matrix, m );
+    output.resize( input.size() );
+    for ( size_t i( 0 ); i < input.size(); i += 6 )
+        sandwich( m, &input[i], &output[i] );
+}
+
+void scale( const SymmetricMatrix3D & N, const std::vector< double > & input, std::vector< double > & output, const std::string & function_name )
+{
+    check_packed_size( input, function_name );
+    double n[3] = { N.value( 0, 0 ), N.value( 1, 1 ), N.value( 2, 2 ) };
+    output.resize( input.size() );
+    for ( size_t i( 0 ); i < input.size(); i += 6 )
+        scale( n, &input[i], &output[i] );
+}
+
+// The matrix M for which U_cif_new = M U_cif M^T when the unit cell is transformed with transformation_matrix.
+Matrix3D adp_transformation_matrix( const Matrix3D & transformation_matrix, const CrystalLattice & crystal_lattice )
+{
+    // Routine was tested and is correct. What is going on is highly non-obvious...
+    // U_star_new = T^-T U_star T^-1
+    Matrix3D transformation_matrix_inverse_transpose( transformation_matrix );
+    transformation_matrix_inverse_transpose.invert();
+    transformation_matrix_inverse_transpose.transpose();
+    CrystalLattice new_crystal_lattice( crystal_lattice );
+    new_crystal_lattice.transform( transformation_matrix );
+    return new_crystal_lattice.N_inverse_matrix() * transformation_matrix_inverse_transpose * crystal_lattice.N_matrix();
+}
+
+// The matrix M for which U_cart_new = M U_cart M^T when rotation (fractional coordinates) is applied.
+Matrix3D adp_rotation_matrix( const Matrix3D & rotation, const CrystalLattice & crystal_lattice )
+{
+    return crystal_lattice.fractional_to_orthogonal_matrix() * rotation * crystal_lattice.orthogonal_to_fractional_matrix();
+}
+
+} // namespace
+
 // ********************************************************************************
 
 AnisotropicDisplacementParameters::AnisotropicDisplacementParameters()
@@ -63,8 +197,7 @@ AnisotropicDisplacementParameters::AnisotropicDisplacementParameters( const doub
 
 SymmetricMatrix3D AnisotropicDisplacementParameters::U_star( const CrystalLattice & crystal_lattice ) const
 {
-    Matrix3D result = crystal_lattice.orthogonal_to_fractional_matrix() * U_cart() * transpose( crystal_lattice.orthogonal_to_fractional_matrix() );
-    return Matrix3D2SymmetricMatrix3D( result );
+    return sandwich( crystal_lattice.orthogonal_to_fractional_matrix(), data_ );
 }
 
 // ********************************************************************************
@@ -78,12 +211,7 @@ SymmetricMatrix3D AnisotropicDisplacementParameters::U_cart() const
 
 SymmetricMatrix3D AnisotropicDisplacementParameters::U_cif( const CrystalLattice & crystal_lattice ) const
 {
-    SymmetricMatrix3D N;
-    N.set_value( 0, 0 , 1.0 / crystal_lattice.a_star() );
-    N.set_value( 1, 1 , 1.0 / crystal_lattice.b_star() );
-    N.set_value( 2, 2 , 1.0 / crystal_lattice.c_star() );
-    Matrix3D result = N * U_star( crystal_lattice ) * N;
-    return Matrix3D2SymmetricMatrix3D( result );
+    return U_cart_2_U_cif( data_, crystal_lattice );
 }
 
 // ********************************************************************************
@@ -116,26 +244,9 @@ void AnisotropicDisplacementParameters::clear()
 
 // The following is what is needed to transform the ADPs when the unit cell is transformed with a transformation matrix
 // The output is in U_cif format.
-SymmetricMatrix3D transform_adps( const SymmetricMatrix3D & U_cif, Matrix3D transformation_matrix, CrystalLattice crystal_lattice )
+SymmetricMatrix3D transform_adps( const SymmetricMatrix3D & U_cif, const Matrix3D & transformation_matrix, const CrystalLattice & crystal_lattice )
 {
-    Matrix3D original_transformation_matrix( transformation_matrix );
-    // Routine was tested and is correct. What is going on is highly non-obvious...
-    transformation_matrix.invert();
-    Matrix3D transformation_matrix_transpose( transformation_matrix );
-    transformation_matrix.transpose();
-
-    // We must convert U_cif to U_star
-    SymmetricMatrix3D N( crystal_lattice.a_star(), crystal_lattice.b_star(), crystal_lattice.c_star(), 0.0, 0.0, 0.0 );
-    Matrix3D U_star = N * U_cif * N;
-
-    // The actual transformation of the ADPs
-    Matrix3D U_star_new = transformation_matrix * U_star * transformation_matrix_transpose;
-
-    // Now convert the new U_star back to new U_cif
-    crystal_lattice.transform( original_transformation_matrix );
-    SymmetricMatrix3D N_2( 1.0 / crystal_lattice.a_star(), 1.0 / crystal_lattice.b_star(), 1.0 / crystal_lattice.c_star(), 0.0, 0.0, 0.0 );
-    Matrix3D U_cif_new = N_2 * U_star_new * N_2;
-    return Matrix3D2SymmetricMatrix3D( U_cif_new );
+    return sandwich( adp_transformation_matrix( transformation_matrix, crystal_lattice ), U_cif );
 }
 
 // ********************************************************************************
@@ -143,25 +254,21 @@ SymmetricMatrix3D transform_adps( const SymmetricMatrix3D & U_cif, Matrix3D tran
 // The following is what is needed to rotate the ADPs as part of a symmetry operation
 AnisotropicDisplacementParameters rotate_adps( const AnisotropicDisplacementParameters & ADPs, const Matrix3D & rotation, const CrystalLattice & crystal_lattice )
 {
-    SymmetricMatrix3D U_star = ADPs.U_star( crystal_lattice );
-    U_star = Matrix3D2SymmetricMatrix3D( rotation * U_star * transpose( rotation ) );
-    return AnisotropicDisplacementParameters( U_star_2_U_cart( U_star, crystal_lattice ) );
+    return AnisotropicDisplacementParameters( sandwich( adp_rotation_matrix( rotation, crystal_lattice ), ADPs.U_cart() ) );
 }
 
 // ********************************************************************************
 
 SymmetricMatrix3D U_star_2_U_cart( const SymmetricMatrix3D & U_star, const CrystalLattice & crystal_lattice )
 {
-    Matrix3D A = crystal_lattice.fractional_to_orthogonal_matrix();
-    return Matrix3D2SymmetricMatrix3D( A * U_star * transpose( A ) );
+    return sandwich( crystal_lattice.fractional_to_orthogonal_matrix(), U_star );
 }
 
 // ********************************************************************************
 
 SymmetricMatrix3D U_star_2_U_cif ( const SymmetricMatrix3D & U_star, const CrystalLattice & crystal_lattice )
 {
-    SymmetricMatrix3D N( 1.0 / crystal_lattice.a_star(), 1.0 / crystal_lattice.b_star(), 1.0 / crystal_lattice.c_star(), 0.0, 0.0, 0.0 );
-    return Matrix3D2SymmetricMatrix3D( N * U_star * N );
+    return scale( crystal_lattice.N_inverse_matrix(), U_star );
 }
 
 // ********************************************************************************
@@ -175,17 +282,14 @@ SymmetricMatrix3D U_cart_2_U_cif ( const SymmetricMatrix3D & U_cart, const Cryst
 
 SymmetricMatrix3D U_cart_2_U_star( const SymmetricMatrix3D & U_cart, const CrystalLattice & crystal_lattice )
 {
-    Matrix3D A = crystal_lattice.fractional_to_orthogonal_matrix();
-    A.invert();
-    return Matrix3D2SymmetricMatrix3D( A * U_cart * transpose( A ) );
+    return sandwich( crystal_lattice.orthogonal_to_fractional_matrix(), U_cart );
 }
 
 // ********************************************************************************
 
 SymmetricMatrix3D U_cif_2_U_star( const SymmetricMatrix3D & U_cif, const CrystalLattice & crystal_lattice )
 {
-    SymmetricMatrix3D N( crystal_lattice.a_star(), crystal_lattice.b_star(), crystal_lattice.c_star(), 0.0, 0.0, 0.0 );
-    return Matrix3D2SymmetricMatrix3D( N * U_cif * N );
+    return scale( crystal_lattice.N_matrix(), U_cif );
 }
 
 // ********************************************************************************
@@ -197,3 +301,60 @@ SymmetricMatrix3D U_cif_2_U_cart( const SymmetricMatrix3D & U_cif, const Crystal
 
 // ********************************************************************************
 
+void transform_adps( const std::vector< double > & U_cif, const Matrix3D & transformation_matrix, const CrystalLattice & crystal_lattice, std::vector< double > & U_cif_new )
+{
+    sandwich( adp_transformation_matrix( transformation_matrix, crystal_lattice ), U_cif, U_cif_new, "transform_adps()" );
+}
+
+// ********************************************************************************
+
+void rotate_adps( const std::vector< double > & U_cart, const Matrix3D & rotation, const CrystalLattice & crystal_lattice, std::vector< double > & U_cart_new )
+{
+    sandwich( adp_rotation_matrix( rotation, crystal_lattice ), U_cart, U_cart_new, "rotate_adps()" );
+}
+
+// ********************************************************************************
+
+void U_star_2_U_cart( const std::vector< double > & U_star, const CrystalLattice & crystal_lattice, std::vector< double > & U_cart )
+{
+    sandwich( crystal_lattice.fractional_to_orthogonal_matrix(), U_star, U_cart, "U_star_2_U_cart()" );
+}
+
+// ********************************************************************************
+
+void U_star_2_U_cif( const std::vector< double > & U_star, const CrystalLattice & crystal_lattice, std::vector< double > & U_cif )
+{
+    scale( crystal_lattice.N_inverse_matrix(), U_star, U_cif, "U_star_2_U_cif()" );
+}
+
+// ********************************************************************************
+
+void U_cart_2_U_cif( const std::vector< double > & U_cart, const CrystalLattice & crystal_lattice, std::vector< double > & U_cif )
+{
+    // A^-1 followed by N^-1 is a single matrix
+    sandwich( crystal_lattice.N_inverse_matrix() * crystal_lattice.orthogonal_to_fractional_matrix(), U_cart, U_cif, "U_cart_2_U_cif()" );
+}
+
+// ********************************************************************************
+
+void U_cart_2_U_star( const std::vector< double > & U_cart, const CrystalLattice & crystal_lattice, std::vector< double > & U_star )
+{
+    sandwich( crystal_lattice.orthogonal_to_fractional_matrix(), U_cart, U_star, "U_cart_2_U_star()" );
+}
+
+// ********************************************************************************
+
+void U_cif_2_U_star( const std::vector< double > & U_cif, const CrystalLattice & crystal_lattice, std::vector< double > & U_star )
+{
+    scale( crystal_lattice.N_matrix(), U_cif, U_star, "U_cif_2_U_star()" );
+}
+
+// ********************************************************************************
+
+void U_cif_2_U_cart( const std::vector< double > & U_cif, const CrystalLattice & crystal_lattice, std::vector< double > & U_cart )
+{
+    sandwich( crystal_lattice.fractional_to_orthogonal_matrix() * crystal_lattice.N_matrix(), U_cif, U_cart, "U_cif_2_U_cart()" );
+}
+
+// ********************************************************************************
+
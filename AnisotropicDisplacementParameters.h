@@ -91,7 +91,7 @@ private:
 // The following is what is needed to transform the ADPs when the unit cell is transformed with a transformation matrix
 // The output is in U_cif format.
 // @@@ Should probably be converted to working with u_cart, so that it can accept and return a AnisotropicDisplacementParameters object
-SymmetricMatrix3D transform_adps( const SymmetricMatrix3D & U_cif, Matrix3D transformation, CrystalLattice crystal_lattice );
+SymmetricMatrix3D transform_adps( const SymmetricMatrix3D & U_cif, const Matrix3D & transformation, const CrystalLattice & crystal_lattice );
 
 // The following is what is needed to rotate the ADPs as part of a symmetry operation
 AnisotropicDisplacementParameters rotate_adps( const AnisotropicDisplacementParameters & ADPs, const Matrix3D & rotation, const CrystalLattice & crystal_lattice );
@@ -105,5 +105,18 @@ SymmetricMatrix3D U_cart_2_U_star( const SymmetricMatrix3D & U_cart, const Cryst
 SymmetricMatrix3D U_cif_2_U_star ( const SymmetricMatrix3D & U_cif , const CrystalLattice & crystal_lattice );
 SymmetricMatrix3D U_cif_2_U_cart ( const SymmetricMatrix3D & U_cif , const CrystalLattice & crystal_lattice );
 
+// Batch versions of the above for many atoms at once. The ADPs are packed as six doubles per atom,
+// U11 U22 U33 U12 U13 U23 (the order of the .cif file and of the SymmetricMatrix3D constructor).
+// Each call reduces to a single 3x3 matrix M, applied as M U M^T (or as a diagonal scaling) to every atom.
+// The output is resized and may be the same vector as the input.
+void transform_adps( const std::vector< double > & U_cif, const Matrix3D & transformation, const CrystalLattice & crystal_lattice, std::vector< double > & U_cif_new );
+void rotate_adps( const std::vector< double > & U_cart, const Matrix3D & rotation, const CrystalLattice & crystal_lattice, std::vector< double > & U_cart_new );
+void U_star_2_U_cart( const std::vector< double > & U_star, const CrystalLattice & crystal_lattice, std::vector< double > & U_cart );
+void U_star_2_U_cif ( const std::vector< double > & U_star, const CrystalLattice & crystal_lattice, std::vector< double > & U_cif  );
+void U_cart_2_U_cif ( const std::vector< double > & U_cart, const CrystalLattice & crystal_lattice, std::vector< double > & U_cif  );
+void U_cart_2_U_star( const std::vector< double > & U_cart, const CrystalLattice & crystal_lattice, std::vector< double > & U_star );
+void U_cif_2_U_star ( const std::vector< double > & U_cif , const CrystalLattice & crystal_lattice, std::vector< double > & U_star );
+void U_cif_2_U_cart ( const std::vector< double > & U_cif , const CrystalLattice & crystal_lattice, std::vector< double > & U_cart );
+
 #endif // ANISOTROPICDISPLACEMENTPARAMETERS_H
 
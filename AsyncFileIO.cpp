@@ -0,0 +1,271 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "AsyncFileIO.h"
+#include "FileDescriptor.h"
+#include "FileList.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+// FileName::full_name() encloses names with spaces in quotes, the operating system must not see those.
+std::string path( const FileName & file_name )
+{
+    if ( is_enclosed_in_quotes( file_name.full_name() ) )
+        return extract_delimited_text( file_name.full_name(), "\"", "\"" );
+    return file_name.full_name();
+}
+
+} // namespace
+
+// ********************************************************************************
+
+void read_whole_file( const FileName & file_name, std::vector< char > & contents )
+{
+    FileDescriptor input( open( path( file_name ).c_str(), O_RDONLY ) );
+    if ( input.value() == -1 )
+        throw std::runtime_error( "read_whole_file(): could not open file " + file_name.full_name() + "." );
+    struct stat file_status;
+    if ( fstat( input.value(), &file_status ) != 0 )
+        throw std::runtime_error( "read_whole_file(): could not stat file " + file_name.full_name() + "." );
+    // The size is only a hint, the file may grow or shrink while it is being read
+    contents.resize( static_cast< size_t >( file_status.st_size ) + 1 );
+    size_t nread( 0 );
+    while ( true )
+    {
+        if ( nread == contents.size() )
+            contents.resize( 2 * contents.size() );
+        const ssize_t n = read( input.value(), &contents[nread], contents.size() - nread );
+        if ( n == 0 )
+            break;
+        if ( n == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            throw std::runtime_error( "read_whole_file(): could not read file " + file_name.full_name() + "." );
+        }
+        nread += n;
+    }
+    contents.resize( nread );
+}
+
+// ********************************************************************************
+
+void write_whole_file( const FileName & file_name, const char * contents, const size_t nbytes )
+{
+    FileDescriptor output( open( path( file_name ).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 ) );
+    if ( output.value() == -1 )
+        throw std::runtime_error( "write_whole_file(): could not open file " + file_name.full_name() + "." );
+    size_t nwritten( 0 );
+    while ( nwritten != nbytes )
+    {
+        const ssize_t n = write( output.value(), contents + nwritten, nbytes - nwritten );
+        if ( n == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            throw std::runtime_error( "write_whole_file(): could not write file " + file_name.full_name() + "." );
+        }
+        nwritten += n;
+    }
+}
+
+// ********************************************************************************
+
+FilePrefetcher::FilePrefetcher( const FileList & file_list, const size_t nahead, const size_t nthreads ):
+nahead_( std::max( nahead, size_t( 1 ) ) ),
+contents_( file_list.size() ),
+errors_( file_list.size() ),
+is_read_( file_list.size(), false ),
+next_to_read_(0),
+next_to_take_(0),
+stop_(false)
+{
+    file_names_.reserve( file_list.size() );
+    for ( size_t i( 0 ); i != file_list.size(); ++i )
+        file_names_.push_back( file_list.value( i ) );
+    const size_t nworkers = std::min( std::max( nthreads, size_t( 1 ) ), std::max( file_names_.size(), size_t( 1 ) ) );
+    threads_.reserve( nworkers );
+    for ( size_t i( 0 ); i != nworkers; ++i )
+        threads_.push_back( std::thread( &FilePrefetcher::read_files, this ) );
+}
+
+// ********************************************************************************
+
+FilePrefetcher::~FilePrefetcher()
+{
+    {
+    std::lock_guard< std::mutex > lock( mutex_ );
+    stop_ = true;
+    }
+    file_taken_.notify_all();
+    for ( size_t i( 0 ); i != threads_.size(); ++i )
+        threads_[i].join();
+}
+
+// ********************************************************************************
+
+bool FilePrefetcher::next( FileName & file_name, std::vector< char > & contents )
+{
+    std::unique_lock< std::mutex > lock( mutex_ );
+    if ( next_to_take_ == file_names_.size() )
+        return false;
+    const size_t i = next_to_take_;
+    file_read_.wait( lock, [this, i]() { return is_read_[i]; } );
+    ++next_to_take_;
+    file_name = file_names_[i];
+    contents.swap( contents_[i] );
+    std::vector< char >().swap( contents_[i] );
+    std::exception_ptr error = errors_[i];
+    errors_[i] = std::exception_ptr();
+    lock.unlock();
+    file_taken_.notify_all();
+    if ( error )
+        std::rethrow_exception( error );
+    return true;
+}
+
+// ********************************************************************************
+
+void FilePrefetcher::read_files()
+{
+    std::unique_lock< std::mutex > lock( mutex_ );
+    while ( true )
+    {
+        file_taken_.wait( lock, [this]() { return stop_ || ( next_to_read_ == file_names_.size() ) || ( next_to_read_ < next_to_take_ + nahead_ ); } );
+        if ( stop_ || ( next_to_read_ == file_names_.size() ) )
+            return;
+        const size_t i = next_to_read_;
+        ++next_to_read_;
+        lock.unlock();
+        std::vector< char > contents;
+        std::exception_ptr error;
+        try
+        {
+            read_whole_file( file_names_[i], contents );
+        }
+        catch ( ... )
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        contents_[i].swap( contents );
+        errors_[i] = error;
+        is_read_[i] = true;
+        file_read_.notify_all();
+    }
+}
+
+// ********************************************************************************
+
+BackgroundFileWriter::BackgroundFileWriter( const size_t capacity ):
+capacity_( std::max( capacity, size_t( 1 ) ) ),
+nbeing_written_(0),
+stop_(false),
+thread_( &BackgroundFileWriter::write_files, this )
+{
+}
+
+// ********************************************************************************
+
+BackgroundFileWriter::~BackgroundFileWriter()
+{
+    {
+    std::lock_guard< std::mutex > lock( mutex_ );
+    stop_ = true;
+    }
+    queue_changed_.notify_all();
+    thread_.join();
+}
+
+// ********************************************************************************
+
+void BackgroundFileWriter::write( const FileName & file_name, const std::string & contents )
+{
+    std::unique_lock< std::mutex > lock( mutex_ );
+    queue_changed_.wait( lock, [this]() { return queue_.size() < capacity_; } );
+    queue_.push_back( std::make_pair( file_name, contents ) );
+    lock.unlock();
+    queue_changed_.notify_all();
+}
+
+// ********************************************************************************
+
+void BackgroundFileWriter::wait()
+{
+    std::unique_lock< std::mutex > lock( mutex_ );
+    queue_changed_.wait( lock, [this]() { return queue_.empty() && ( nbeing_written_ == 0 ); } );
+    std::exception_ptr error = error_;
+    error_ = std::exception_ptr();
+    lock.unlock();
+    if ( error )
+        std::rethrow_exception( error );
+}
+
+// ********************************************************************************
+
+// The queue is emptied before the thread stops, also when stop_ has been set.
+void BackgroundFileWriter::write_files()
+{
+    std::unique_lock< std::mutex > lock( mutex_ );
+    while ( true )
+    {
+        queue_changed_.wait( lock, [this]() { return stop_ || ( ! queue_.empty() ); } );
+        if ( queue_.empty() )
+            return;
+        std::pair< FileName, std::string > file = std::move( queue_.front() );
+        queue_.pop_front();
+        ++nbeing_written_;
+        lock.unlock();
+        queue_changed_.notify_all();
+        std::exception_ptr error;
+        try
+        {
+            write_whole_file( file.first, file.second.data(), file.second.size() );
+        }
+        catch ( ... )
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        --nbeing_written_;
+        if ( error && ( ! error_ ) )
+            error_ = error;
+        queue_changed_.notify_all();
+    }
+}
+
+// ********************************************************************************
+
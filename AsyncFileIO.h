@@ -0,0 +1,133 @@
+#ifndef ASYNCFILEIO_H
+#define ASYNCFILEIO_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "FileName.h"
+
+#include <condition_variable>
+#include <cstddef> // For definition of size_t
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class FileList;
+
+// Reads the whole file into contents, with one open() and as few read() calls as possible.
+void read_whole_file( const FileName & file_name, std::vector< char > & contents );
+
+// Writes contents to the file, replacing it if it exists.
+void write_whole_file( const FileName & file_name, const char * contents, const size_t nbytes );
+
+/*
+  Reads the files of a FileList ahead of the code that processes them, so that the time spent waiting on opens
+  and small reads, which dominates on network storage, overlaps with the processing of earlier files.
+
+  nthreads threads read the files in order and keep at most nahead files that have been read but not yet taken
+  with next(). next() hands the files out in the order of the list. A file that could not be read is not
+  reported until it is taken, so next() rethrows the error for that file and the following files are unaffected.
+
+  The contents can be processed without touching the file system again, e.g. with
+  TextFileReader_2::read_buffer() or read_cif( std::vector< char > & ).
+*/
+class FilePrefetcher
+{
+public:
+
+    // Starts reading straight away. nthreads = 0 means one thread, nahead = 0 means nahead = 1.
+    explicit FilePrefetcher( const FileList & file_list, const size_t nahead = 8, const size_t nthreads = 4 );
+
+    // Waits for the files that are being read, the files that have not been started are not read.
+    ~FilePrefetcher();
+
+    size_t size() const { return file_names_.size(); }
+
+    // Blocks until the next file has been read. Returns false after the last file.
+    // The name is set before an error is rethrown, so the caller can report which file failed.
+    bool next( FileName & file_name, std::vector< char > & contents );
+
+private:
+    std::vector< FileName > file_names_;
+    size_t nahead_;
+    std::vector< std::vector< char > > contents_;
+    std::vector< std::exception_ptr > errors_;
+    std::vector< bool > is_read_;
+    size_t next_to_read_;
+    size_t next_to_take_;
+    bool stop_;
+    std::mutex mutex_;
+    std::condition_variable file_read_;
+    std::condition_variable file_taken_;
+    std::vector< std::thread > threads_;
+
+    void read_files();
+
+    FilePrefetcher( const FilePrefetcher & );
+    FilePrefetcher & operator=( const FilePrefetcher & );
+};
+
+/*
+  Writes files on a background thread, so that the code producing the output does not wait on the file system.
+  The contents are copied into a queue that holds at most capacity files; write() blocks while it is full.
+  wait() blocks until everything queued so far has been written and rethrows the first error since the last wait().
+  The destructor writes what is still queued, errors are then lost, so call wait() if they matter.
+*/
+class BackgroundFileWriter
+{
+public:
+
+    explicit BackgroundFileWriter( const size_t capacity = 64 );
+
+    ~BackgroundFileWriter();
+
+    void write( const FileName & file_name, const std::string & contents );
+
+    void wait();
+
+private:
+    size_t capacity_;
+    std::deque< std::pair< FileName, std::string > > queue_;
+    size_t nbeing_written_;
+    bool stop_;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable queue_changed_;
+    std::thread thread_;
+
+    void write_files();
+
+    BackgroundFileWriter( const BackgroundFileWriter & );
+    BackgroundFileWriter & operator=( const BackgroundFileWriter & );
+};
+
+#endif // ASYNCFILEIO_H
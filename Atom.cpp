@@ -31,6 +31,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // ********************************************************************************
 
+Atom::Atom():
+charge_(0.0),
+ADPs_type_(NONE),
+Uiso_(0.0),
+occupancy_(1.0)
+{
+}
+
+// ********************************************************************************
+
 Atom::Atom( const Element & element,
             const Vector3D & position,
             const std::string & label ):
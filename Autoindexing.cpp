@@ -0,0 +1,843 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Autoindexing.h"
+#include "3DCalculations.h"
+#include "Instrumentation.h"
+#include "MathFunctions.h"
+#include "NiggliReduction.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <stdexcept>
+
+namespace
+{
+
+const size_t maximum_nparameters = 4;
+
+// Bisections beyond the initial boxes of 1 A, 2^-40 is far below any tolerance.
+const size_t maximum_depth = 40;
+
+// The volume range is searched in shells of this size, in A^3, as in DICVOL.
+const double volume_shell = 400.0;
+
+// index() does not search lattice systems of lower symmetry once a solution with at least this M_N has been found.
+const double convincing_M = 10.0;
+
+size_t nparameters( const CrystalLattice::LatticeSystem lattice_system )
+{
+    switch ( lattice_system )
+    {
+        case CrystalLattice::CUBIC        : return 1;
+        case CrystalLattice::TETRAGONAL   : return 2;
+        case CrystalLattice::HEXAGONAL    : return 2;
+        case CrystalLattice::ORTHORHOMBIC : return 3;
+        case CrystalLattice::MONOCLINIC   : return 4;
+        default : throw std::runtime_error( "Autoindexing: lattice system " + LatticeSystem2string( lattice_system ) + " is not supported." );
+    }
+}
+
+// Lattices that are found in more than one lattice system are kept in the one with the highest symmetry.
+int symmetry_rank( const CrystalLattice::LatticeSystem lattice_system )
+{
+    switch ( lattice_system )
+    {
+        case CrystalLattice::MONOCLINIC   : return 1;
+        case CrystalLattice::ORTHORHOMBIC : return 2;
+        case CrystalLattice::TETRAGONAL   : return 3;
+        case CrystalLattice::HEXAGONAL    : return 3;
+        case CrystalLattice::CUBIC        : return 4;
+        default : return 0;
+    }
+}
+
+// ********************************************************************************
+
+// All reflections with the same coefficients have the same Q = sum_j coefficients_[j] * parameter_j, only one of them is stored.
+struct Term
+{
+    int coefficients_[ maximum_nparameters ];
+};
+
+struct Box
+{
+    double lower_[ maximum_nparameters ];
+    double upper_[ maximum_nparameters ];
+};
+
+// ********************************************************************************
+
+// The solutions found so far, each lattice once.
+class SolutionSet
+{
+public:
+
+    explicit SolutionSet( const size_t maximum_nsolutions ): maximum_nsolutions_(maximum_nsolutions) {}
+
+    void add( const IndexingSolution & solution )
+    {
+        const std::vector< double > G6 = G6_vector( Niggli_reduce( solution.crystal_lattice_ ) );
+        double norm2( 0.0 );
+        for ( size_t j( 0 ); j != G6.size(); ++j )
+            norm2 += square( G6[j] );
+        for ( size_t i( 0 ); i != solutions_.size(); ++i )
+        {
+            if ( G6_distance( G6, G6s_[i] ) > 0.002 * std::sqrt( norm2 ) )
+                continue;
+            const int rank = symmetry_rank( solution.crystal_lattice_.lattice_system() );
+            const int rank_i = symmetry_rank( solutions_[i].crystal_lattice_.lattice_system() );
+            if ( ( rank > rank_i ) || ( ( rank == rank_i ) && ( solution.M_ > solutions_[i].M_ ) ) )
+            {
+                solutions_[i] = solution;
+                G6s_[i] = G6;
+            }
+            return;
+        }
+        solutions_.push_back( solution );
+        G6s_.push_back( G6 );
+        // Many surviving supercells would make add() slow
+        if ( solutions_.size() > 4 * maximum_nsolutions_ )
+            truncate();
+    }
+
+    void add( const SolutionSet & rhs )
+    {
+        for ( size_t i( 0 ); i != rhs.solutions_.size(); ++i )
+            add( rhs.solutions_[i] );
+    }
+
+    std::vector< IndexingSolution > solutions()
+    {
+        truncate();
+        return solutions_;
+    }
+
+private:
+    size_t maximum_nsolutions_;
+    std::vector< IndexingSolution > solutions_;
+    std::vector< std::vector< double > > G6s_;
+
+    // Sorts by M, highest first, and keeps the first maximum_nsolutions_.
+    void truncate()
+    {
+        std::vector< size_t > order( solutions_.size() );
+        for ( size_t i( 0 ); i != order.size(); ++i )
+            order[i] = i;
+        std::stable_sort( order.begin(), order.end(), [&]( const size_t lhs, const size_t rhs ) { return solutions_[lhs].M_ > solutions_[rhs].M_; } );
+        order.resize( std::min( order.size(), maximum_nsolutions_ ) );
+        std::vector< IndexingSolution > solutions;
+        std::vector< std::vector< double > > G6s;
+        for ( size_t i( 0 ); i != order.size(); ++i )
+        {
+            solutions.push_back( solutions_[order[i]] );
+            G6s.push_back( G6s_[order[i]] );
+        }
+        solutions_.swap( solutions );
+        G6s_.swap( G6s );
+    }
+};
+
+// ********************************************************************************
+
+// The dichotomy for one lattice system.
+class DichotomySearch
+{
+public:
+
+    // Qs and tolerances are those of the peaks, in ascending order.
+    DichotomySearch( const Autoindexing & autoindexing, const CrystalLattice::LatticeSystem lattice_system,
+                     const std::vector< double > & Qs, const std::vector< double > & tolerances );
+
+    // Only lattices with a volume between minimum_volume and maximum_volume are searched.
+    void set_volume_shell( const double minimum_volume, const double maximum_volume ) { minimum_volume_ = minimum_volume; maximum_volume_ = maximum_volume; }
+
+    // The initial boxes of 1 A in each cell length.
+    std::vector< Box > initial_boxes() const;
+
+    // refined_parameters are the parameters, nparameters per lattice, that have been refined so far in this search,
+    // so that the many neighbouring boxes that refine to the same lattice are evaluated once.
+    void search( const Box & box, const std::vector< size_t > & terms, const size_t depth, SolutionSet & solutions, std::vector< double > & refined_parameters ) const;
+
+    const std::vector< size_t > & all_terms() const { return all_terms_; }
+
+private:
+    const Autoindexing & autoindexing_;
+    CrystalLattice::LatticeSystem lattice_system_;
+    size_t nparameters_;
+    std::vector< double > Qs_;
+    std::vector< double > tolerances_;
+    double Q_limit_;
+    double maximum_cos_beta_star_;
+    double minimum_volume_;
+    double maximum_volume_;
+    std::vector< Term > terms_;
+    std::vector< size_t > all_terms_;
+
+    void coefficients( const int h, const int k, const int l, int * result ) const;
+    void generate_terms();
+
+    double Q( const Term & term, const double * parameters ) const
+    {
+        double result( 0.0 );
+        for ( size_t j( 0 ); j != nparameters_; ++j )
+            result += term.coefficients_[j] * parameters[j];
+        return result;
+    }
+
+    void Q_range( const Term & term, const Box & box, double & Q_minimum, double & Q_maximum ) const
+    {
+        Q_minimum = 0.0;
+        Q_maximum = 0.0;
+        for ( size_t j( 0 ); j != nparameters_; ++j )
+        {
+            const double lower = term.coefficients_[j] * box.lower_[j];
+            const double upper = term.coefficients_[j] * box.upper_[j];
+            Q_minimum += std::min( lower, upper );
+            Q_maximum += std::max( lower, upper );
+        }
+    }
+
+    // The range of the reciprocal parameter for a range of cell lengths
+    void length_range( const double minimum_length, const double maximum_length, double & lower, double & upper ) const;
+
+    // False if the box cannot contain a lattice within the constraints
+    bool is_allowed( const Box & box ) const;
+
+    // Returns false if the parameters do not describe a lattice.
+    bool lattice( const double * parameters, CrystalLattice & crystal_lattice ) const;
+
+    void refine( const Box & box, const std::vector< size_t > & terms, SolutionSet & solutions, std::vector< double > & refined_parameters ) const;
+};
+
+// ********************************************************************************
+
+DichotomySearch::DichotomySearch( const Autoindexing & autoindexing, const CrystalLattice::LatticeSystem lattice_system,
+                                  const std::vector< double > & Qs, const std::vector< double > & tolerances ):
+autoindexing_(autoindexing),
+lattice_system_(lattice_system),
+nparameters_( nparameters( lattice_system ) ),
+Qs_(Qs),
+tolerances_(tolerances),
+Q_limit_( Qs.back() + tolerances.back() ),
+maximum_cos_beta_star_( -autoindexing.maximum_beta().cosine() ),
+minimum_volume_( 0.0 ),
+maximum_volume_( autoindexing.maximum_volume() )
+{
+    generate_terms();
+}
+
+// ********************************************************************************
+
+void DichotomySearch::coefficients( const int h, const int k, const int l, int * result ) const
+{
+    switch ( lattice_system_ )
+    {
+        case CrystalLattice::CUBIC        : result[0] = h*h + k*k + l*l; break;
+        case CrystalLattice::TETRAGONAL   : result[0] = h*h + k*k; result[1] = l*l; break;
+        case CrystalLattice::HEXAGONAL    : result[0] = h*h + h*k + k*k; result[1] = l*l; break;
+        case CrystalLattice::ORTHORHOMBIC : result[0] = h*h; result[1] = k*k; result[2] = l*l; break;
+        case CrystalLattice::MONOCLINIC   : result[0] = h*h; result[1] = k*k; result[2] = l*l; result[3] = h*l; break;
+        default : throw std::runtime_error( "DichotomySearch::coefficients(): lattice system not supported." );
+    }
+}
+
+// ********************************************************************************
+
+void DichotomySearch::generate_terms()
+{
+    // Q >= ( 1 - |cos(beta*)| ) ( h^2 G*_11 + l^2 G*_33 ) for a monoclinic lattice, and the cell lengths are at most maximum_length(),
+    // which limits the indices that can give a Q below Q_limit_.
+    const double factor = ( lattice_system_ == CrystalLattice::MONOCLINIC ) ? 1.0 - maximum_cos_beta_star_ : 1.0;
+    const int index_maximum = static_cast< int >( std::floor( std::sqrt( Q_limit_ / factor ) * autoindexing_.maximum_length() ) );
+    // Enough to generate every set of coefficients at least once: only the monoclinic system distinguishes the sign of h
+    const int h_minimum = ( lattice_system_ == CrystalLattice::MONOCLINIC ) ? -index_maximum : 0;
+    std::set< std::vector< int > > seen;
+    for ( int h( h_minimum ); h <= index_maximum; ++h )
+    {
+        for ( int k( 0 ); k <= index_maximum; ++k )
+        {
+            for ( int l( 0 ); l <= index_maximum; ++l )
+            {
+                if ( ( h == 0 ) && ( k == 0 ) && ( l == 0 ) )
+                    continue;
+                Term term;
+                coefficients( h, k, l, term.coefficients_ );
+                std::vector< int > key( term.coefficients_, term.coefficients_ + nparameters_ );
+                if ( ! seen.insert( key ).second )
+                    continue;
+                terms_.push_back( term );
+                all_terms_.push_back( terms_.size() - 1 );
+            }
+        }
+    }
+}
+
+// ********************************************************************************
+
+void DichotomySearch::length_range( const double minimum_length, const double maximum_length, double & lower, double & upper ) const
+{
+    // For the hexagonal system the first parameter is G*_11 = 4 / ( 3 a^2 )
+    const double factor = ( lattice_system_ == CrystalLattice::HEXAGONAL ) ? 4.0 / 3.0 : 1.0;
+    lower = factor / square( maximum_length );
+    upper = factor / square( minimum_length );
+}
+
+// ********************************************************************************
+
+std::vector< Box > DichotomySearch::initial_boxes() const
+{
+    std::vector< double > shells;
+    for ( double length = autoindexing_.minimum_length(); length < autoindexing_.maximum_length(); length += 1.0 )
+        shells.push_back( length );
+    const size_t nshells = shells.size();
+    std::vector< Box > result;
+    Box box;
+    for ( size_t i( 0 ); i != nshells; ++i )
+    {
+        length_range( shells[i], std::min( shells[i] + 1.0, autoindexing_.maximum_length() ), box.lower_[0], box.upper_[0] );
+        if ( nparameters_ == 1 )
+        {
+            if ( is_allowed( box ) )
+                result.push_back( box );
+            continue;
+        }
+        for ( size_t j( 0 ); j != nshells; ++j )
+        {
+            length_range( shells[j], std::min( shells[j] + 1.0, autoindexing_.maximum_length() ), box.lower_[1], box.upper_[1] );
+            if ( nparameters_ == 2 )
+            {
+                if ( is_allowed( box ) )
+                    result.push_back( box );
+                continue;
+            }
+            for ( size_t k( 0 ); k != nshells; ++k )
+            {
+                length_range( shells[k], std::min( shells[k] + 1.0, autoindexing_.maximum_length() ), box.lower_[2], box.upper_[2] );
+                if ( nparameters_ == 4 )
+                {
+                    // 2 G*_13 = 2 sqrt( G*_11 G*_33 ) cos(beta*), with cos(beta*) = -cos(beta) >= 0
+                    box.lower_[3] = 0.0;
+                    box.upper_[3] = 2.0 * std::sqrt( box.upper_[0] * box.upper_[2] ) * maximum_cos_beta_star_;
+                }
+                if ( is_allowed( box ) )
+                    result.push_back( box );
+            }
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+bool DichotomySearch::is_allowed( const Box & box ) const
+{
+    // The range of volumes in the box, V = 1 / sqrt( det( G* ) )
+    double minimum_determinant( 0.0 );
+    double maximum_determinant( 0.0 );
+    switch ( lattice_system_ )
+    {
+        case CrystalLattice::CUBIC :
+            minimum_determinant = std::pow( box.lower_[0], 3 );
+            maximum_determinant = std::pow( box.upper_[0], 3 );
+            break;
+        case CrystalLattice::TETRAGONAL :
+            minimum_determinant = square( box.lower_[0] ) * box.lower_[1];
+            maximum_determinant = square( box.upper_[0] ) * box.upper_[1];
+            break;
+        case CrystalLattice::HEXAGONAL :
+            minimum_determinant = 0.75 * square( box.lower_[0] ) * box.lower_[1];
+            maximum_determinant = 0.75 * square( box.upper_[0] ) * box.upper_[1];
+            break;
+        case CrystalLattice::ORTHORHOMBIC :
+            minimum_determinant = box.lower_[0] * box.lower_[1] * box.lower_[2];
+            maximum_determinant = box.upper_[0] * box.upper_[1] * box.upper_[2];
+            break;
+        case CrystalLattice::MONOCLINIC :
+            minimum_determinant = box.lower_[1] * ( box.lower_[0] * box.lower_[2] - square( box.upper_[3] ) / 4.0 );
+            maximum_determinant = box.upper_[1] * ( box.upper_[0] * box.upper_[2] - square( box.lower_[3] ) / 4.0 );
+            break;
+        default : break;
+    }
+    if ( ! ( maximum_determinant > 0.0 ) )
+        return false;
+    if ( 1.0 / std::sqrt( maximum_determinant ) > maximum_volume_ )
+        return false;
+    // A determinant of 0.0 is an infinite volume
+    if ( ( minimum_determinant > 0.0 ) && ( 1.0 / std::sqrt( minimum_determinant ) < minimum_volume_ ) )
+        return false;
+    // a <= b <= c
+    if ( lattice_system_ == CrystalLattice::ORTHORHOMBIC )
+    {
+        if ( ( box.upper_[0] < box.lower_[1] ) || ( box.upper_[1] < box.lower_[2] ) )
+            return false;
+    }
+    if ( lattice_system_ == CrystalLattice::MONOCLINIC )
+    {
+        // a <= c
+        if ( box.upper_[0] < box.lower_[2] )
+            return false;
+        // beta <= maximum_beta
+        if ( box.lower_[3] > 2.0 * std::sqrt( box.upper_[0] * box.upper_[2] ) * maximum_cos_beta_star_ )
+            return false;
+    }
+    return true;
+}
+
+// ********************************************************************************
+
+bool DichotomySearch::lattice( const double * parameters, CrystalLattice & crystal_lattice ) const
+{
+    for ( size_t j( 0 ); j != std::min( nparameters_, size_t( 3 ) ); ++j )
+    {
+        if ( ! ( parameters[j] > 0.0 ) )
+            return false;
+    }
+    switch ( lattice_system_ )
+    {
+        case CrystalLattice::CUBIC :
+        {
+            const double a = 1.0 / std::sqrt( parameters[0] );
+            crystal_lattice = CrystalLattice( a, a, a, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+            break;
+        }
+        case CrystalLattice::TETRAGONAL :
+        {
+            const double a = 1.0 / std::sqrt( parameters[0] );
+            crystal_lattice = CrystalLattice( a, a, 1.0 / std::sqrt( parameters[1] ), Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+            break;
+        }
+        case CrystalLattice::HEXAGONAL :
+        {
+            const double a = std::sqrt( 4.0 / ( 3.0 * parameters[0] ) );
+            crystal_lattice = CrystalLattice( a, a, 1.0 / std::sqrt( parameters[1] ), Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_120_degrees() );
+            break;
+        }
+        case CrystalLattice::ORTHORHOMBIC :
+        {
+            crystal_lattice = CrystalLattice( 1.0 / std::sqrt( parameters[0] ), 1.0 / std::sqrt( parameters[1] ), 1.0 / std::sqrt( parameters[2] ),
+                                              Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+            break;
+        }
+        case CrystalLattice::MONOCLINIC :
+        {
+            // G = inverse( G* ), with G*_13 = parameters[3] / 2
+            const double determinant = parameters[0] * parameters[2] - square( parameters[3] ) / 4.0;
+            if ( ! ( determinant > 0.0 ) )
+                return false;
+            const double a = std::sqrt( parameters[2] / determinant );
+            const double c = std::sqrt( parameters[0] / determinant );
+            const double cos_beta = -( parameters[3] / 2.0 ) / std::sqrt( parameters[0] * parameters[2] );
+            crystal_lattice = CrystalLattice( a, 1.0 / std::sqrt( parameters[1] ), c, Angle::angle_90_degrees(), arccosine( cos_beta ), Angle::angle_90_degrees() );
+            break;
+        }
+        default : return false;
+    }
+    crystal_lattice.set_lattice_system( lattice_system_ );
+    return true;
+}
+
+// ********************************************************************************
+
+void DichotomySearch::search( const Box & box, const std::vector< size_t > & terms, const size_t depth, SolutionSet & solutions, std::vector< double > & refined_parameters ) const
+{
+    // Only the terms that can still give a Q up to the last peak
+    std::vector< size_t > remaining_terms;
+    remaining_terms.reserve( terms.size() );
+    for ( size_t t( 0 ); t != terms.size(); ++t )
+    {
+        double Q_minimum;
+        double Q_maximum;
+        Q_range( terms_[terms[t]], box, Q_minimum, Q_maximum );
+        if ( Q_minimum <= Q_limit_ )
+            remaining_terms.push_back( terms[t] );
+    }
+    // For each parameter, the largest contribution to the width of a Q range relative to the tolerance
+    double relative_widths[ maximum_nparameters ] = { 0.0, 0.0, 0.0, 0.0 };
+    size_t nunindexed( 0 );
+    bool is_narrow( true );
+    for ( size_t i( 0 ); i != Qs_.size(); ++i )
+    {
+        double narrowest_width = std::numeric_limits< double >::max();
+        const Term * narrowest_term = 0;
+        for ( size_t t( 0 ); t != remaining_terms.size(); ++t )
+        {
+            double Q_minimum;
+            double Q_maximum;
+            Q_range( terms_[remaining_terms[t]], box, Q_minimum, Q_maximum );
+            if ( ( Q_minimum - tolerances_[i] <= Qs_[i] ) && ( Qs_[i] <= Q_maximum + tolerances_[i] ) && ( Q_maximum - Q_minimum < narrowest_width ) )
+            {
+                narrowest_width = Q_maximum - Q_minimum;
+                narrowest_term = &terms_[remaining_terms[t]];
+            }
+        }
+        if ( narrowest_term == 0 )
+        {
+            ++nunindexed;
+            if ( nunindexed > autoindexing_.maximum_nunindexed() )
+                return;
+            continue;
+        }
+        if ( narrowest_width > tolerances_[i] )
+            is_narrow = false;
+        for ( size_t j( 0 ); j != nparameters_; ++j )
+            relative_widths[j] = std::max( relative_widths[j], std::abs( narrowest_term->coefficients_[j] ) * ( box.upper_[j] - box.lower_[j] ) / tolerances_[i] );
+    }
+    if ( is_narrow || ( depth == maximum_depth ) )
+    {
+        refine( box, remaining_terms, solutions, refined_parameters );
+        return;
+    }
+    // Halve the parameters that contribute most to the widths
+    size_t widest( 0 );
+    for ( size_t j( 1 ); j != nparameters_; ++j )
+    {
+        if ( relative_widths[j] > relative_widths[widest] )
+            widest = j;
+    }
+    std::vector< size_t > halved;
+    for ( size_t j( 0 ); j != nparameters_; ++j )
+    {
+        if ( ( j == widest ) || ( relative_widths[j] > 1.0 / nparameters_ ) )
+            halved.push_back( j );
+    }
+    for ( size_t child( 0 ); child != ( size_t( 1 ) << halved.size() ); ++child )
+    {
+        Box child_box( box );
+        for ( size_t j( 0 ); j != halved.size(); ++j )
+        {
+            const double middle = ( box.lower_[halved[j]] + box.upper_[halved[j]] ) / 2.0;
+            if ( child & ( size_t( 1 ) << j ) )
+                child_box.lower_[halved[j]] = middle;
+            else
+                child_box.upper_[halved[j]] = middle;
+        }
+        if ( is_allowed( child_box ) )
+            search( child_box, remaining_terms, depth + 1, solutions, refined_parameters );
+    }
+}
+
+// ********************************************************************************
+
+void DichotomySearch::refine( const Box & box, const std::vector< size_t > & terms, SolutionSet & solutions, std::vector< double > & refined_parameters ) const
+{
+    double parameters[ maximum_nparameters ];
+    for ( size_t j( 0 ); j != nparameters_; ++j )
+        parameters[j] = ( box.lower_[j] + box.upper_[j] ) / 2.0;
+    // Assign each peak to the nearest term and fit Q = sum_j c_j p_j by weighted linear least squares, twice,
+    // the second time with the assignments from the refined parameters.
+    for ( size_t pass( 0 ); pass != 2; ++pass )
+    {
+        double normal_matrix[ maximum_nparameters ][ maximum_nparameters ] = {};
+        double right_hand_side[ maximum_nparameters ] = {};
+        for ( size_t i( 0 ); i != Qs_.size(); ++i )
+        {
+            const Term * nearest_term = 0;
+            double smallest_difference = std::numeric_limits< double >::max();
+            for ( size_t t( 0 ); t != terms.size(); ++t )
+            {
+                const double difference = std::abs( Q( terms_[terms[t]], parameters ) - Qs_[i] );
+                if ( difference < smallest_difference )
+                {
+                    smallest_difference = difference;
+                    nearest_term = &terms_[terms[t]];
+                }
+            }
+            if ( ( nearest_term == 0 ) || ( smallest_difference > 2.0 * tolerances_[i] ) )
+                continue;
+            const double weight = 1.0 / square( tolerances_[i] );
+            for ( size_t j( 0 ); j != nparameters_; ++j )
+            {
+                right_hand_side[j] += weight * nearest_term->coefficients_[j] * Qs_[i];
+                for ( size_t k( 0 ); k != nparameters_; ++k )
+                    normal_matrix[j][k] += weight * nearest_term->coefficients_[j] * nearest_term->coefficients_[k];
+            }
+        }
+        // A parameter that no assigned peak depends on, e.g. 2 G*_13 when all peaks have h = 0 or l = 0, keeps its value
+        for ( size_t j( 0 ); j != nparameters_; ++j )
+        {
+            if ( normal_matrix[j][j] == 0.0 )
+            {
+                for ( size_t k( 0 ); k != nparameters_; ++k )
+                    normal_matrix[j][k] = 0.0;
+                normal_matrix[j][j] = 1.0;
+                right_hand_side[j] = parameters[j];
+            }
+        }
+        // Gaussian elimination with partial pivoting
+        for ( size_t j( 0 ); j != nparameters_; ++j )
+        {
+            size_t pivot( j );
+            for ( size_t k( j + 1 ); k != nparameters_; ++k )
+            {
+                if ( std::abs( normal_matrix[k][j] ) > std::abs( normal_matrix[pivot][j] ) )
+                    pivot = k;
+            }
+            if ( normal_matrix[pivot][j] == 0.0 )
+                return;
+            for ( size_t k( 0 ); k != nparameters_; ++k )
+                std::swap( normal_matrix[j][k], normal_matrix[pivot][k] );
+            std::swap( right_hand_side[j], right_hand_side[pivot] );
+            for ( size_t k( j + 1 ); k != nparameters_; ++k )
+            {
+                const double factor = normal_matrix[k][j] / normal_matrix[j][j];
+                for ( size_t m( j ); m != nparameters_; ++m )
+                    normal_matrix[k][m] -= factor * normal_matrix[j][m];
+                right_hand_side[k] -= factor * right_hand_side[j];
+            }
+        }
+        for ( size_t j( nparameters_ ); j-- != 0; )
+        {
+            double sum = right_hand_side[j];
+            for ( size_t k( j + 1 ); k != nparameters_; ++k )
+                sum -= normal_matrix[j][k] * parameters[k];
+            parameters[j] = sum / normal_matrix[j][j];
+        }
+    }
+    for ( size_t i( 0 ); i != refined_parameters.size(); i += nparameters_ )
+    {
+        bool is_same( true );
+        for ( size_t j( 0 ); ( j != nparameters_ ) && is_same; ++j )
+            is_same = ( std::abs( parameters[j] - refined_parameters[i+j] ) <= 1.0E-6 * std::abs( parameters[j] ) );
+        if ( is_same )
+            return;
+    }
+    refined_parameters.insert( refined_parameters.end(), parameters, parameters + nparameters_ );
+    CrystalLattice crystal_lattice;
+    if ( ! lattice( parameters, crystal_lattice ) )
+        return;
+    if ( crystal_lattice.volume() > autoindexing_.maximum_volume() )
+        return;
+    const IndexingSolution solution = autoindexing_.evaluate( crystal_lattice );
+    if ( solution.nunindexed_ > autoindexing_.maximum_nunindexed() )
+        return;
+    solutions.add( solution );
+}
+
+// ********************************************************************************
+
+} // namespace
+
+// ********************************************************************************
+
+Autoindexing::Autoindexing( const std::vector< Angle > & peak_positions, const double wavelength ):
+two_thetas_(peak_positions),
+wavelength_(wavelength),
+tolerance_( Angle::from_degrees( 0.03 ) ),
+minimum_length_( 2.0 ),
+maximum_length_( 25.0 ),
+maximum_volume_( 2000.0 ),
+maximum_beta_( Angle::from_degrees( 125.0 ) ),
+maximum_nunindexed_( 0 ),
+maximum_nsolutions_( 10 ),
+nthreads_( 0 )
+{
+    if ( two_thetas_.empty() )
+        throw std::runtime_error( "Autoindexing::Autoindexing(): no peaks." );
+    std::sort( two_thetas_.begin(), two_thetas_.end() );
+}
+
+// ********************************************************************************
+
+void Autoindexing::observed_Qs( std::vector< double > & Qs, std::vector< double > & tolerances ) const
+{
+    Qs.resize( two_thetas_.size() );
+    tolerances.resize( two_thetas_.size() );
+    for ( size_t i( 0 ); i != two_thetas_.size(); ++i )
+    {
+        // Q = 4 sin^2(theta) / lambda^2, dQ/d(2theta) = 2 sin(2theta) / lambda^2
+        Qs[i] = square( 2.0 * ( two_thetas_[i] / 2.0 ).sine() / wavelength_ );
+        tolerances[i] = 2.0 * two_thetas_[i].sine() / square( wavelength_ ) * tolerance_.value_in_radians();
+    }
+}
+
+// ********************************************************************************
+
+std::vector< IndexingSolution > Autoindexing::index( const CrystalLattice::LatticeSystem lattice_system ) const
+{
+    MACRO_SCOPED_TIMER( "Autoindexing::index()" );
+    std::vector< double > Qs;
+    std::vector< double > tolerances;
+    observed_Qs( Qs, tolerances );
+    DichotomySearch dichotomy_search( *this, lattice_system, Qs, tolerances );
+    // Supercells index the same peaks, so the search stops at the first shell of volumes that gives solutions
+    for ( double minimum_volume( 0.0 ); minimum_volume < maximum_volume_; minimum_volume += volume_shell )
+    {
+        dichotomy_search.set_volume_shell( minimum_volume, std::min( minimum_volume + volume_shell, maximum_volume_ ) );
+        const std::vector< Box > boxes = dichotomy_search.initial_boxes();
+        std::vector< SolutionSet > solutions_per_box( boxes.size(), SolutionSet( maximum_nsolutions_ ) );
+        parallel_for( boxes.size(), nthreads_, [&]( const size_t i )
+        {
+            std::vector< double > refined_parameters;
+            dichotomy_search.search( boxes[i], dichotomy_search.all_terms(), 0, solutions_per_box[i], refined_parameters );
+        } );
+        SolutionSet result( maximum_nsolutions_ );
+        for ( size_t i( 0 ); i != solutions_per_box.size(); ++i )
+            result.add( solutions_per_box[i] );
+        const std::vector< IndexingSolution > solutions = result.solutions();
+        if ( ! solutions.empty() )
+            return solutions;
+    }
+    return std::vector< IndexingSolution >();
+}
+
+// ********************************************************************************
+
+std::vector< IndexingSolution > Autoindexing::index() const
+{
+    const CrystalLattice::LatticeSystem lattice_systems[ 5 ] = { CrystalLattice::CUBIC, CrystalLattice::HEXAGONAL, CrystalLattice::TETRAGONAL, CrystalLattice::ORTHORHOMBIC, CrystalLattice::MONOCLINIC };
+    SolutionSet result( maximum_nsolutions_ );
+    bool is_convincing( false );
+    for ( size_t i( 0 ); i != 5; ++i )
+    {
+        // Lower symmetries describe the same lattices with more lines and a lower M_N
+        if ( is_convincing && ( symmetry_rank( lattice_systems[i] ) < symmetry_rank( lattice_systems[i-1] ) ) )
+            break;
+        const std::vector< IndexingSolution > solutions = index( lattice_systems[i] );
+        for ( size_t j( 0 ); j != solutions.size(); ++j )
+        {
+            result.add( solutions[j] );
+            if ( solutions[j].M_ >= convincing_M )
+                is_convincing = true;
+        }
+    }
+    return result.solutions();
+}
+
+// ********************************************************************************
+
+IndexingSolution Autoindexing::evaluate( const CrystalLattice & crystal_lattice ) const
+{
+    std::vector< double > Qs;
+    std::vector< double > tolerances;
+    observed_Qs( Qs, tolerances );
+    const double Q_limit = Qs.back() + tolerances.back();
+    // |h| = |H . a| <= |H| a
+    const double H_maximum = std::sqrt( Q_limit );
+    const int h_maximum = static_cast< int >( std::floor( H_maximum * crystal_lattice.a() ) );
+    const int k_maximum = static_cast< int >( std::floor( H_maximum * crystal_lattice.b() ) );
+    const int l_maximum = static_cast< int >( std::floor( H_maximum * crystal_lattice.c() ) );
+    struct Line
+    {
+        double Q_;
+        int h_, k_, l_;
+    };
+    std::vector< Line > lines;
+    const ReciprocalBasis reciprocal_basis( crystal_lattice );
+    std::vector< double > row( 2 * l_maximum + 1 );
+    for ( int h( -h_maximum ); h <= h_maximum; ++h )
+    {
+        for ( int k( -k_maximum ); k <= k_maximum; ++k )
+        {
+            reciprocal_basis.lengths2( h, k, -l_maximum, row.size(), &row[0] );
+            for ( int l( -l_maximum ); l <= l_maximum; ++l )
+            {
+                const double Q = row[l+l_maximum];
+                if ( ( Q > 0.0 ) && ( Q <= Q_limit ) )
+                {
+                    Line line;
+                    line.Q_ = Q;
+                    line.h_ = h;
+                    line.k_ = k;
+                    line.l_ = l;
+                    lines.push_back( line );
+                }
+            }
+        }
+    }
+    std::sort( lines.begin(), lines.end(), []( const Line & lhs, const Line & rhs ) { return lhs.Q_ < rhs.Q_; } );
+    // Reflections with the same Q are one line, represented by the largest Miller indices, which are usually all positive
+    std::vector< Line > distinct_lines;
+    for ( size_t i( 0 ); i != lines.size(); ++i )
+    {
+        if ( ( ! distinct_lines.empty() ) && ( lines[i].Q_ - distinct_lines.back().Q_ <= 1.0E-9 * lines[i].Q_ ) )
+        {
+            Line & line = distinct_lines.back();
+            if ( ( lines[i].h_ > line.h_ ) ||
+                 ( ( lines[i].h_ == line.h_ ) && ( ( lines[i].k_ > line.k_ ) || ( ( lines[i].k_ == line.k_ ) && ( lines[i].l_ > line.l_ ) ) ) ) )
+            {
+                line.h_ = lines[i].h_;
+                line.k_ = lines[i].k_;
+                line.l_ = lines[i].l_;
+            }
+            continue;
+        }
+        distinct_lines.push_back( lines[i] );
+    }
+    IndexingSolution result;
+    result.crystal_lattice_ = crystal_lattice;
+    size_t nindexed( 0 );
+    double sum_Q_differences( 0.0 );
+    double sum_two_theta_differences( 0.0 );
+    for ( size_t i( 0 ); i != Qs.size(); ++i )
+    {
+        result.miller_indices_.push_back( MillerIndices( 0, 0, 0 ) );
+        // The nearest line in 2theta
+        size_t nearest( distinct_lines.size() );
+        double smallest_difference = std::numeric_limits< double >::max();
+        for ( size_t j( 0 ); j != distinct_lines.size(); ++j )
+        {
+            const double sine_theta = wavelength_ * std::sqrt( distinct_lines[j].Q_ ) / 2.0;
+            if ( sine_theta > 1.0 )
+                break;
+            const double difference = ( 2.0 * arcsine( sine_theta ) - two_thetas_[i] ).value_in_degrees();
+            if ( std::abs( difference ) < smallest_difference )
+            {
+                smallest_difference = std::abs( difference );
+                nearest = j;
+            }
+            else if ( difference > 0.0 )
+                break;
+        }
+        if ( ( nearest == distinct_lines.size() ) || ( smallest_difference > tolerance_.value_in_degrees() ) )
+        {
+            ++result.nunindexed_;
+            continue;
+        }
+        ++nindexed;
+        result.miller_indices_[i] = MillerIndices( distinct_lines[nearest].h_, distinct_lines[nearest].k_, distinct_lines[nearest].l_ );
+        sum_Q_differences += std::abs( distinct_lines[nearest].Q_ - Qs[i] );
+        sum_two_theta_differences += smallest_difference;
+    }
+    size_t ncalculated( 0 );
+    while ( ( ncalculated != distinct_lines.size() ) && ( distinct_lines[ncalculated].Q_ <= Qs.back() ) )
+        ++ncalculated;
+    if ( ( nindexed == 0 ) || ( ncalculated == 0 ) )
+        return result;
+    double average_tolerance( 0.0 );
+    for ( size_t i( 0 ); i != tolerances.size(); ++i )
+        average_tolerance += tolerances[i];
+    average_tolerance /= tolerances.size();
+    const double average_Q_difference = std::max( sum_Q_differences / nindexed, 0.001 * average_tolerance );
+    const double average_two_theta_difference = std::max( sum_two_theta_differences / nindexed, 0.001 * tolerance_.value_in_degrees() );
+    result.M_ = Qs.back() / ( 2.0 * average_Q_difference * ncalculated );
+    result.F_ = Qs.size() / ( average_two_theta_difference * ncalculated );
+    return result;
+}
@@ -0,0 +1,138 @@
+#ifndef AUTOINDEXING_H
+#define AUTOINDEXING_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Angle.h"
+#include "CrystalLattice.h"
+#include "MillerIndices.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+struct IndexingSolution
+{
+    IndexingSolution(): M_(0.0), F_(0.0), nunindexed_(0) {}
+
+    CrystalLattice crystal_lattice_; // Primitive, with its lattice system set
+    double M_; // De Wolff's M_N, N is the number of peaks
+    double F_; // Smith and Snyder's F_N
+    size_t nunindexed_;
+    std::vector< MillerIndices > miller_indices_; // For each peak, 0 0 0 if it is not indexed
+};
+
+/*
+  Autoindexing of a powder pattern by successive dichotomy (Louer and Boultif, DICVOL).
+
+  Q = 1/d^2 is linear in the elements of the reciprocal metric tensor G*, so for a box of values of those elements the range of Q
+  of every hkl follows directly from the corners of the box. A box survives if every peak (except at most maximum_nunindexed())
+  lies within tolerance() of the Q range of some hkl; a surviving box is halved along each parameter until the Q ranges are smaller
+  than the tolerance. The boxes that remain are refined by linear least squares on Q and ranked by de Wolff's M_N.
+  The search starts from boxes of 1 A in each cell length, which are searched in parallel; the d-spacings for the figures of merit
+  are generated with ReciprocalBasis::lengths2().
+
+  The parameters per lattice system are
+      CUBIC        G*_11
+      TETRAGONAL   G*_11, G*_33
+      HEXAGONAL    G*_11 (= G*_22 = -2 G*_12), G*_33
+      ORTHORHOMBIC G*_11, G*_22, G*_33, with a <= b <= c
+      MONOCLINIC   G*_11, G*_22, G*_33, 2 G*_13, with a <= c, b unique and 90 <= beta <= maximum_beta()
+  Only primitive cells are searched, a centred lattice is found as its primitive cell, which has the same lines,
+  or as a cell that has more lines and a lower M_N. The triclinic system, with six parameters, is not searched.
+  A zero-point error must have been corrected for.
+*/
+class Autoindexing
+{
+public:
+
+    // peak_positions are the 2theta values of the peaks, 20 is the usual number. They are sorted.
+    Autoindexing( const std::vector< Angle > & peak_positions, const double wavelength );
+
+    // The maximum difference between an observed and a calculated 2theta value. The default is 0.03 degrees.
+    Angle tolerance() const { return tolerance_; }
+    void set_tolerance( const Angle tolerance ) { tolerance_ = tolerance; }
+
+    // The range of a, b and c in Angstrom. The defaults are 2.0 and 25.0.
+    double minimum_length() const { return minimum_length_; }
+    void set_minimum_length( const double minimum_length ) { minimum_length_ = minimum_length; }
+    double maximum_length() const { return maximum_length_; }
+    void set_maximum_length( const double maximum_length ) { maximum_length_ = maximum_length; }
+
+    // In A^3. The default is 2000.0.
+    double maximum_volume() const { return maximum_volume_; }
+    void set_maximum_volume( const double maximum_volume ) { maximum_volume_ = maximum_volume; }
+
+    // The default is 125 degrees.
+    Angle maximum_beta() const { return maximum_beta_; }
+    void set_maximum_beta( const Angle maximum_beta ) { maximum_beta_ = maximum_beta; }
+
+    // The number of peaks that may be left unindexed, e.g. impurity peaks. The default is 0.
+    size_t maximum_nunindexed() const { return maximum_nunindexed_; }
+    void set_maximum_nunindexed( const size_t maximum_nunindexed ) { maximum_nunindexed_ = maximum_nunindexed; }
+
+    // The default is 10.
+    size_t maximum_nsolutions() const { return maximum_nsolutions_; }
+    void set_maximum_nsolutions( const size_t maximum_nsolutions ) { maximum_nsolutions_ = maximum_nsolutions; }
+
+    // 0 means one thread per core. Default 0.
+    size_t nthreads() const { return nthreads_; }
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; }
+
+    size_t npeaks() const { return two_thetas_.size(); }
+    Angle peak_position( const size_t i ) const { return two_thetas_[i]; }
+
+    // CUBIC, TETRAGONAL, HEXAGONAL, ORTHORHOMBIC or MONOCLINIC, other lattice systems throw.
+    // At most maximum_nsolutions() different lattices, highest M_N first.
+    std::vector< IndexingSolution > index( const CrystalLattice::LatticeSystem lattice_system ) const;
+
+    // All five lattice systems. A lattice that is found in more than one lattice system is kept once, with the highest symmetry.
+    std::vector< IndexingSolution > index() const;
+
+    // The figures of merit and the Miller indices of the peaks for a given lattice. A peak is indexed if the nearest calculated line
+    // is within tolerance(). The average discrepancy in the figures of merit is at least 0.001 times the tolerance,
+    // so that exact peak positions give finite figures of merit.
+    IndexingSolution evaluate( const CrystalLattice & crystal_lattice ) const;
+
+private:
+    std::vector< Angle > two_thetas_;
+    double wavelength_;
+    Angle tolerance_;
+    double minimum_length_;
+    double maximum_length_;
+    double maximum_volume_;
+    Angle maximum_beta_;
+    size_t maximum_nunindexed_;
+    size_t maximum_nsolutions_;
+    size_t nthreads_;
+
+    // Q = 1/d^2 and its tolerance for each peak
+    void observed_Qs( std::vector< double > & Qs, std::vector< double > & tolerances ) const;
+};
+
+#endif // AUTOINDEXING_H
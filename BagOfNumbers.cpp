@@ -67,21 +67,38 @@ void BagOfNumbers::add( const size_t value )
 
 // ********************************************************************************
 
+// Swap-and-pop: the drawn position is filled with the last number.
 size_t BagOfNumbers::draw()
 {
-    size_t result = draw_with_replace();
-    set_of_numbers_.remove( result );
+    if ( set_of_numbers_.empty() )
+        throw std::runtime_error( "BagOfNumbers::draw(): bag is empty." );
+    size_t iPos = RNG_int_.next_number( 0, set_of_numbers_.size() - 1 );
+    size_t result = set_of_numbers_.value_at_position( iPos );
+    set_of_numbers_.remove_position( iPos );
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< size_t > BagOfNumbers::draw( const size_t n )
+{
+    if ( set_of_numbers_.size() < n )
+        throw std::runtime_error( "BagOfNumbers::draw(): bag contains fewer than n numbers." );
+    std::vector< size_t > result;
+    result.reserve( n );
+    for ( size_t i( 0 ); i != n; ++i )
+        result.push_back( draw() );
     return result;
 }
 
 // ********************************************************************************
 
-size_t BagOfNumbers::draw_with_replace() const
+size_t BagOfNumbers::draw_with_replace()
 {
     if ( set_of_numbers_.empty() )
         throw std::runtime_error( "BagOfNumbers::draw_with_replace(): bag is empty." );
     size_t iPos = RNG_int_.next_number( 0, set_of_numbers_.size() - 1 );
-    return set_of_numbers_.value( iPos );
+    return set_of_numbers_.value_at_position( iPos );
 }
 
 // ********************************************************************************
@@ -68,18 +68,28 @@ public:
 
     // Returns the number of values in the bag.
     size_t size() const { return set_of_numbers_.size(); }
+
+    void reserve( const size_t desired_size ) { set_of_numbers_.reserve( desired_size ); }
     
-    // Returns one of the numbers at random and removes it from the bag.
+    // Returns one of the numbers at random and removes it from the bag, O(1).
     // Throws if the bag is empty.
     size_t draw();
+
+    // Draws n numbers without replacement (a partial Fisher-Yates shuffle), O(n).
+    // Throws if the bag contains fewer than n numbers.
+    std::vector< size_t > draw( const size_t n );
+
+    // Empties the bag and returns its contents in random order.
+    std::vector< size_t > draw_all() { return draw( size() ); }
     
     // Returns one of the numbers at random, it is NOT removed from the bag
     // Throws if the bag is empty.
-    size_t draw_with_replace() const;
+    // Not const, because it advances the random number generator.
+    size_t draw_with_replace();
 
 private:
     SetOfNumbers set_of_numbers_;
-    mutable RandomNumberGenerator_integer RNG_int_;
+    RandomNumberGenerator_integer RNG_int_;
 };
 
 #endif // BAGOFNUMBERS_H
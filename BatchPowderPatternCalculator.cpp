@@ -0,0 +1,159 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "BatchPowderPatternCalculator.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "ParallelFor.h"
+#include "PeakShapeFunction.h"
+#include "PowderPattern.h"
+#include "ReadCif.h"
+#include "ScratchArena.h"
+
+#include <stdexcept>
+
+// ********************************************************************************
+
+BatchPowderPatternCalculator::BatchPowderPatternCalculator():
+wavelength_(1.54056),
+two_theta_start_(5.0,Angle::DEGREES),
+two_theta_end_(30.0,Angle::DEGREES),
+two_theta_step_(0.01,Angle::DEGREES),
+FWHM_(0.1),
+peak_shape_function_(0),
+peak_convolution_(PowderPatternCalculator::DIRECT_SUMMATION),
+nthreads_(0),
+precision_(DOUBLE_PRECISION),
+npatterns_(0),
+npoints_(0)
+{
+}
+
+// ********************************************************************************
+
+void BatchPowderPatternCalculator::calculate( const FileList & file_list )
+{
+    initialise( file_list.size() );
+    parallel_for( file_list.size(), nthreads_, [&]( const size_t i )
+    {
+        ScratchArenaScope scratch_arena_scope;
+        CrystalStructure crystal_structure;
+        read_cif( file_list.value( i ), crystal_structure );
+        crystal_structure.apply_space_group_symmetry();
+        calculate( crystal_structure, i );
+    } );
+}
+
+// ********************************************************************************
+
+void BatchPowderPatternCalculator::calculate( const std::vector< CrystalStructure > & crystal_structures )
+{
+    initialise( crystal_structures.size() );
+    parallel_for( crystal_structures.size(), nthreads_, [&]( const size_t i )
+    {
+        ScratchArenaScope scratch_arena_scope;
+        calculate( crystal_structures[i], i );
+    } );
+}
+
+// ********************************************************************************
+
+const double * BatchPowderPatternCalculator::intensities( const size_t i ) const
+{
+    if ( precision_ != DOUBLE_PRECISION )
+        throw std::runtime_error( "BatchPowderPatternCalculator::intensities(): intensities are stored in single precision." );
+    return &intensities_[ i * npoints_ ];
+}
+
+// ********************************************************************************
+
+const float * BatchPowderPatternCalculator::single_precision_intensities( const size_t i ) const
+{
+    if ( precision_ != SINGLE_PRECISION )
+        throw std::runtime_error( "BatchPowderPatternCalculator::single_precision_intensities(): intensities are stored in double precision." );
+    return &single_precision_intensities_[ i * npoints_ ];
+}
+
+// ********************************************************************************
+
+PowderPattern BatchPowderPatternCalculator::powder_pattern( const size_t i ) const
+{
+    if ( i >= npatterns_ )
+        throw std::runtime_error( "BatchPowderPatternCalculator::powder_pattern(): index out of range." );
+    PowderPattern result( two_theta_start_, two_theta_end_, two_theta_step_ );
+    for ( size_t j( 0 ); j != npoints_; ++j )
+        result.set_intensity( j, intensity( i, j ) );
+    result.recalculate_estimated_standard_deviations();
+    result.set_wavelength( wavelength_ );
+    return result;
+}
+
+// ********************************************************************************
+
+void BatchPowderPatternCalculator::initialise( const size_t npatterns )
+{
+    npatterns_ = npatterns;
+    npoints_ = PowderPattern( two_theta_start_, two_theta_end_, two_theta_step_ ).size();
+    intensities_.clear();
+    single_precision_intensities_.clear();
+    if ( precision_ == DOUBLE_PRECISION )
+        intensities_.assign( npatterns_ * npoints_, 0.0 );
+    else
+        single_precision_intensities_.assign( npatterns_ * npoints_, 0.0f );
+}
+
+// ********************************************************************************
+
+void BatchPowderPatternCalculator::calculate( const CrystalStructure & crystal_structure, const size_t i )
+{
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_wavelength( wavelength_ );
+    powder_pattern_calculator.set_two_theta_start( two_theta_start_ );
+    powder_pattern_calculator.set_two_theta_end( two_theta_end_ );
+    powder_pattern_calculator.set_two_theta_step( two_theta_step_ );
+    powder_pattern_calculator.set_FWHM( FWHM_ );
+    if ( peak_shape_function_ )
+        powder_pattern_calculator.set_peak_shape_function( *peak_shape_function_ );
+    powder_pattern_calculator.set_peak_convolution( peak_convolution_ );
+    PowderPattern powder_pattern;
+    powder_pattern_calculator.calculate( powder_pattern );
+    if ( powder_pattern.size() != npoints_ )
+        throw std::runtime_error( "BatchPowderPatternCalculator::calculate(): unexpected number of points." );
+    if ( precision_ == DOUBLE_PRECISION )
+    {
+        for ( size_t j( 0 ); j != npoints_; ++j )
+            intensities_[ i * npoints_ + j ] = powder_pattern.intensity( j );
+    }
+    else
+    {
+        for ( size_t j( 0 ); j != npoints_; ++j )
+            single_precision_intensities_[ i * npoints_ + j ] = static_cast< float >( powder_pattern.intensity( j ) );
+    }
+}
+
+// ********************************************************************************
+
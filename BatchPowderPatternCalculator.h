@@ -0,0 +1,118 @@
+#ifndef BATCHPOWDERPATTERNCALCULATOR_H
+#define BATCHPOWDERPATTERNCALCULATOR_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+class FileList;
+class PeakShapeFunction;
+class PowderPattern;
+
+#include "Angle.h"
+#include "PowderPatternCalculator.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+/*
+  Calculates the powder patterns of many crystal structures with the same settings, in parallel.
+
+  The patterns are stored in one contiguous intensity matrix, one row per structure, with the rows in the
+  same order as the input. As with PowderPatternCalculator, each pattern is normalised to its highest peak.
+  With SINGLE_PRECISION the matrix is stored as floats, which halves the memory for large libraries of patterns;
+  the intensities are then only accessible through intensity(), single_precision_intensities() and powder_pattern().
+  The peak shape function is shared between all threads and must outlive the calculator.
+*/
+class BatchPowderPatternCalculator
+{
+public:
+
+    enum Precision { DOUBLE_PRECISION, SINGLE_PRECISION };
+
+    BatchPowderPatternCalculator();
+
+    double wavelength() const { return wavelength_; }
+    void set_wavelength( const double wavelength ) { wavelength_ = wavelength; }
+    Angle two_theta_start() const { return two_theta_start_; }
+    void set_two_theta_start( const Angle two_theta_start ) { two_theta_start_ = two_theta_start; }
+    Angle two_theta_end() const { return two_theta_end_; }
+    void set_two_theta_end( const Angle two_theta_end ) { two_theta_end_ = two_theta_end; }
+    Angle two_theta_step() const { return two_theta_step_; }
+    void set_two_theta_step( const Angle two_theta_step ) { two_theta_step_ = two_theta_step; }
+    double FWHM() const { return FWHM_; }
+    void set_FWHM( const double FWHM ) { FWHM_ = FWHM; }
+    void set_peak_shape_function( const PeakShapeFunction & peak_shape_function ) { peak_shape_function_ = &peak_shape_function; }
+    void set_peak_convolution( const PowderPatternCalculator::PeakConvolution peak_convolution ) { peak_convolution_ = peak_convolution; }
+
+    // 0 means one thread per core.
+    size_t nthreads() const { return nthreads_; }
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; }
+
+    // Must be set before calculate(). The default is DOUBLE_PRECISION.
+    Precision precision() const { return precision_; }
+    void set_precision( const Precision precision ) { precision_ = precision; }
+
+    // Expects file_list to contain .cif files, the space-group symmetry is applied after reading.
+    void calculate( const FileList & file_list );
+
+    // The space-group symmetry must have been applied.
+    void calculate( const std::vector< CrystalStructure > & crystal_structures );
+
+    size_t npatterns() const { return npatterns_; }
+    size_t npoints() const { return npoints_; }
+
+    double intensity( const size_t i, const size_t j ) const { return ( precision_ == DOUBLE_PRECISION ) ? intensities_[ i * npoints_ + j ] : single_precision_intensities_[ i * npoints_ + j ]; }
+
+    // Pointer to the npoints() intensities of pattern i. DOUBLE_PRECISION only.
+    const double * intensities( const size_t i ) const;
+
+    // Pointer to the npoints() intensities of pattern i. SINGLE_PRECISION only.
+    const float * single_precision_intensities( const size_t i ) const;
+
+    PowderPattern powder_pattern( const size_t i ) const;
+
+private:
+    double wavelength_;
+    Angle two_theta_start_;
+    Angle two_theta_end_;
+    Angle two_theta_step_;
+    double FWHM_;
+    const PeakShapeFunction * peak_shape_function_;
+    PowderPatternCalculator::PeakConvolution peak_convolution_;
+    size_t nthreads_;
+    Precision precision_;
+    size_t npatterns_;
+    size_t npoints_;
+    std::vector< double > intensities_;
+    std::vector< float > single_precision_intensities_;
+
+    void initialise( const size_t npatterns );
+    void calculate( const CrystalStructure & crystal_structure, const size_t i );
+};
+
+#endif // BATCHPOWDERPATTERNCALCULATOR_H
@@ -0,0 +1,145 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Benchmark.h"
+#include "FileName.h"
+#include "TextFileWriter.h"
+#include "Utilities.h"
+
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+
+// Enough digits for timings in seconds down to nanoseconds.
+std::string seconds2string( const double value )
+{
+    char buffer[32];
+    std::snprintf( buffer, sizeof( buffer ), "%.9g", value );
+    return std::string( buffer );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+double BenchmarkResult::minimum() const
+{
+    if ( timings_.empty() )
+        throw std::runtime_error( "BenchmarkResult::minimum(): no timings." );
+    return timings_.front();
+}
+
+// ********************************************************************************
+
+double BenchmarkResult::maximum() const
+{
+    if ( timings_.empty() )
+        throw std::runtime_error( "BenchmarkResult::maximum(): no timings." );
+    return timings_.back();
+}
+
+// ********************************************************************************
+
+double BenchmarkResult::median() const
+{
+    if ( timings_.empty() )
+        throw std::runtime_error( "BenchmarkResult::median(): no timings." );
+    const size_t n = timings_.size();
+    if ( n % 2 == 1 )
+        return timings_[ n / 2 ];
+    return ( timings_[ n / 2 - 1 ] + timings_[ n / 2 ] ) / 2.0;
+}
+
+// ********************************************************************************
+
+double BenchmarkResult::mean() const
+{
+    if ( timings_.empty() )
+        throw std::runtime_error( "BenchmarkResult::mean(): no timings." );
+    double sum( 0.0 );
+    for ( size_t i( 0 ); i != timings_.size(); ++i )
+        sum += timings_[i];
+    return sum / timings_.size();
+}
+
+// ********************************************************************************
+
+double BenchmarkResult::standard_deviation() const
+{
+    const double average = mean();
+    if ( timings_.size() == 1 )
+        return 0.0;
+    double sum( 0.0 );
+    for ( size_t i( 0 ); i != timings_.size(); ++i )
+        sum += ( timings_[i] - average ) * ( timings_[i] - average );
+    return std::sqrt( sum / ( timings_.size() - 1 ) );
+}
+
+// ********************************************************************************
+
+std::string BenchmarkResult::report() const
+{
+    return pad( name_, 40 ) + " " + size_t2string( size_, 8, ' ' ) +
+           "  median " + double2string( 1000.0 * median(), 4, 12 ) + " ms" +
+           "  mean " + double2string( 1000.0 * mean(), 4, 12 ) + " +/- " + double2string( 1000.0 * standard_deviation(), 4, 10 ) + " ms" +
+           "  min " + double2string( 1000.0 * minimum(), 4, 12 ) + " ms" +
+           "  n = " + size_t2string( nrepetitions() );
+}
+
+// ********************************************************************************
+
+std::string BenchmarkResult::to_JSON() const
+{
+    return "{\"name\":\"" + name_ + "\"" +
+           ",\"size\":" + size_t2string( size_ ) +
+           ",\"nwarmups\":" + size_t2string( nwarmups_ ) +
+           ",\"nrepetitions\":" + size_t2string( nrepetitions() ) +
+           ",\"median\":" + seconds2string( median() ) +
+           ",\"mean\":" + seconds2string( mean() ) +
+           ",\"standard_deviation\":" + seconds2string( standard_deviation() ) +
+           ",\"minimum\":" + seconds2string( minimum() ) +
+           ",\"maximum\":" + seconds2string( maximum() ) + "}";
+}
+
+// ********************************************************************************
+
+void save_benchmark_results( const std::vector< BenchmarkResult > & results, const FileName & file_name )
+{
+    TextFileWriter text_file_writer( file_name );
+    text_file_writer.write_line( "{\"nthreads\":" + size_t2string( std::thread::hardware_concurrency() ) + ",\"benchmarks\":[" );
+    for ( size_t i( 0 ); i != results.size(); ++i )
+        text_file_writer.write_line( results[i].to_JSON() + ( ( i + 1 != results.size() ) ? "," : "" ) );
+    text_file_writer.write_line( "]}" );
+}
+
+// ********************************************************************************
+
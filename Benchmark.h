@@ -0,0 +1,96 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class FileName;
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+/*
+  Timing of a piece of code for regression tracking, see RunBenchmarks.h for the benchmark suite itself.
+
+  The job is first run a number of times untimed (warm-up: caches, page faults, lazily initialised tables),
+  then each repetition is timed separately. The median is the headline number, it is insensitive to the occasional
+  repetition that is interrupted by the operating system; the mean, standard deviation and extremes are reported alongside.
+*/
+struct BenchmarkResult
+{
+    std::string name_;
+    size_t size_; // Problem size, e.g. the number of atoms; what it counts is part of the name
+    size_t nwarmups_;
+    std::vector< double > timings_; // In seconds, one per repetition, sorted in ascending order
+
+    size_t nrepetitions() const { return timings_.size(); }
+
+    // All throw if there are no timings.
+    double minimum() const;
+    double maximum() const;
+    double median() const;
+    double mean() const;
+    // Sample standard deviation, 0.0 for a single repetition.
+    double standard_deviation() const;
+
+    // One line: name, size, median, mean +/- standard deviation, minimum, number of repetitions.
+    std::string report() const;
+
+    // One JSON object, times in seconds.
+    std::string to_JSON() const;
+};
+
+// Calls job() nwarmups times, then nrepetitions times timing each call.
+template< class Job >
+BenchmarkResult run_benchmark( const std::string & name, const size_t size, Job job, const size_t nrepetitions = 10, const size_t nwarmups = 2 )
+{
+    BenchmarkResult result;
+    result.name_ = name;
+    result.size_ = size;
+    result.nwarmups_ = nwarmups;
+    for ( size_t i( 0 ); i != nwarmups; ++i )
+        job();
+    result.timings_.reserve( nrepetitions );
+    for ( size_t i( 0 ); i != nrepetitions; ++i )
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        job();
+        result.timings_.push_back( std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count() );
+    }
+    std::sort( result.timings_.begin(), result.timings_.end() );
+    return result;
+}
+
+// {"benchmarks":[ ... ]}, one object per result as in BenchmarkResult::to_JSON().
+void save_benchmark_results( const std::vector< BenchmarkResult > & results, const FileName & file_name );
+
+#endif // BENCHMARK_H
+
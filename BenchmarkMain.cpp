@@ -0,0 +1,61 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Benchmark.h"
+#include "FileName.h"
+#include "RunBenchmarks.h"
+#include "Utilities.h"
+
+#include <iostream>
+#include <stdexcept>
+
+// The entry point of FourierBenchmarks ("make benchmarks"): ./FourierBenchmarks [nrepetitions] [output.json]
+// The results are written as JSON so that they can be compared between releases.
+int main( int argc, char** argv )
+{
+    try
+    {
+        if ( argc > 3 )
+            throw std::runtime_error( "Usage: FourierBenchmarks [nrepetitions] [output.json]" );
+        const int nrepetitions = ( argc > 1 ) ? string2integer( argv[ 1 ] ) : 10;
+        if ( nrepetitions < 1 )
+            throw std::runtime_error( "The number of repetitions must be at least 1." );
+        const FileName output_file_name( ( argc > 2 ) ? argv[ 2 ] : "benchmarks.json" );
+        std::vector< BenchmarkResult > results = run_benchmarks( nrepetitions );
+        save_benchmark_results( results, output_file_name );
+        std::cout << "Results written to " + output_file_name.full_name() << std::endl;
+    }
+    catch ( std::exception & e )
+    {
+        std::cout << "An exception was thrown" << std::endl;
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
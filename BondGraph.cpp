@@ -0,0 +1,143 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "BondGraph.h"
+#include "ConnectivityTable.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// ********************************************************************************
+
+BondGraph::BondGraph( const size_t natoms, const std::vector< std::pair< size_t, size_t > > & bonds )
+{
+    build( natoms, bonds );
+}
+
+// ********************************************************************************
+
+BondGraph::BondGraph( const ConnectivityTable & connectivity_table )
+{
+    std::vector< std::pair< size_t, size_t > > bonds;
+    for ( size_t i( 0 ); i != connectivity_table.size(); ++i )
+    {
+        for ( size_t j( i+1 ); j != connectivity_table.size(); ++j )
+        {
+            if ( connectivity_table.value( i, j ) > 0 )
+                bonds.push_back( std::make_pair( i, j ) );
+        }
+    }
+    build( connectivity_table.size(), bonds );
+}
+
+// ********************************************************************************
+
+bool BondGraph::are_bonded( const size_t i, const size_t j ) const
+{
+    if ( ( i >= size() ) || ( j >= size() ) )
+        throw std::runtime_error( "BondGraph::are_bonded(): out of bounds." );
+    return std::binary_search( neighbours_.begin() + row_starts_[i], neighbours_.begin() + row_starts_[i+1], j );
+}
+
+// ********************************************************************************
+
+void BondGraph::build( const size_t natoms, const std::vector< std::pair< size_t, size_t > > & bonds )
+{
+    // Counting sort: each bond is stored twice, once for each atom
+    std::vector< size_t > counts( natoms + 1, 0 );
+    for ( size_t i( 0 ); i != bonds.size(); ++i )
+    {
+        if ( ( bonds[i].first >= natoms ) || ( bonds[i].second >= natoms ) )
+            throw std::runtime_error( "BondGraph::BondGraph(): atom index out of bounds ( " + size_t2string( std::max( bonds[i].first, bonds[i].second ) ) + " >= " + size_t2string( natoms ) + " )" );
+        if ( bonds[i].first == bonds[i].second )
+            continue;
+        ++counts[ bonds[i].first + 1 ];
+        ++counts[ bonds[i].second + 1 ];
+    }
+    for ( size_t i( 0 ); i != natoms; ++i )
+        counts[i+1] += counts[i];
+    std::vector< size_t > neighbours( counts[natoms] );
+    std::vector< size_t > next( counts.begin(), counts.end() - 1 );
+    for ( size_t i( 0 ); i != bonds.size(); ++i )
+    {
+        if ( bonds[i].first == bonds[i].second )
+            continue;
+        neighbours[ next[ bonds[i].first ]++ ] = bonds[i].second;
+        neighbours[ next[ bonds[i].second ]++ ] = bonds[i].first;
+    }
+    // Sort each row and remove duplicates
+    row_starts_.resize( natoms + 1 );
+    row_starts_[0] = 0;
+    neighbours_.clear();
+    neighbours_.reserve( neighbours.size() );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        std::sort( neighbours.begin() + counts[i], neighbours.begin() + counts[i+1] );
+        for ( size_t k( counts[i] ); k != counts[i+1]; ++k )
+        {
+            if ( ( k == counts[i] ) || ( neighbours[k] != neighbours[k-1] ) )
+                neighbours_.push_back( neighbours[k] );
+        }
+        row_starts_[i+1] = neighbours_.size();
+    }
+}
+
+// ********************************************************************************
+
+std::vector< std::vector< size_t > > split( const BondGraph & bond_graph )
+{
+    std::vector< std::vector< size_t > > result;
+    std::vector< bool > done( bond_graph.size(), false );
+    // Breadth-first search, the molecule being built doubles as the queue
+    for ( size_t i( 0 ); i != bond_graph.size(); ++i )
+    {
+        if ( done[ i ] )
+            continue;
+        std::vector< size_t > this_molecule( 1, i );
+        done[ i ] = true;
+        for ( size_t k( 0 ); k != this_molecule.size(); ++k )
+        {
+            const size_t j = this_molecule[k];
+            for ( size_t l( 0 ); l != bond_graph.degree( j ); ++l )
+            {
+                const size_t neighbour = bond_graph.neighbour( j, l );
+                if ( done[ neighbour ] )
+                    continue;
+                done[ neighbour ] = true;
+                this_molecule.push_back( neighbour );
+            }
+        }
+        std::sort( this_molecule.begin(), this_molecule.end() );
+        result.push_back( this_molecule );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
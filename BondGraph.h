@@ -0,0 +1,75 @@
+#ifndef BONDGRAPH_H
+#define BONDGRAPH_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <cstddef> // For definition of size_t
+#include <utility>
+#include <vector>
+
+class ConnectivityTable;
+
+/*
+  A sparse connectivity table: for each atom the list of atoms it is bonded to, stored in compressed sparse row (CSR) format.
+
+  Memory is O(N + number of bonds) instead of the O(N^2) of ConnectivityTable, which matters for MD snapshots
+  with tens of thousands of atoms. The graph is built once from a list of bonds and cannot be changed afterwards.
+*/
+class BondGraph
+{
+public:
+
+    // Duplicate bonds and bonds of an atom to itself are ignored.
+    BondGraph( const size_t natoms, const std::vector< std::pair< size_t, size_t > > & bonds );
+
+    explicit BondGraph( const ConnectivityTable & connectivity_table );
+
+    size_t size() const { return row_starts_.size() - 1; }
+
+    size_t nbonds() const { return neighbours_.size() / 2; }
+
+    size_t degree( const size_t i ) const { return row_starts_[i+1] - row_starts_[i]; }
+
+    // The neighbours of atom i are neighbour( i, 0 ) ... neighbour( i, degree( i ) - 1 ), in ascending order.
+    size_t neighbour( const size_t i, const size_t k ) const { return neighbours_[ row_starts_[i] + k ]; }
+
+    bool are_bonded( const size_t i, const size_t j ) const;
+
+private:
+    std::vector< size_t > row_starts_;
+    std::vector< size_t > neighbours_;
+
+    void build( const size_t natoms, const std::vector< std::pair< size_t, size_t > > & bonds );
+};
+
+// The connected components (molecules), each in ascending order, ordered by their lowest atom index.
+// Gives the same result as split( const ConnectivityTable & ) in O(N + number of bonds).
+std::vector< std::vector< size_t > > split( const BondGraph & bond_graph );
+
+#endif // BONDGRAPH_H
+
@@ -0,0 +1,94 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <condition_variable>
+#include <cstddef> // For definition of size_t
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/*
+  A first-in-first-out queue with a maximum size, to pass items between the threads of consecutive pipeline stages.
+  A full queue blocks the producers, so a fast stage cannot run arbitrarily far ahead of a slow one.
+  close() signals that no more items will be pushed: the consumers then empty the queue and pop() returns false.
+*/
+template< class T >
+class BoundedQueue
+{
+public:
+
+    explicit BoundedQueue( const size_t capacity ): capacity_( capacity == 0 ? 1 : capacity ), closed_(false) {}
+
+    size_t capacity() const { return capacity_; }
+
+    // Blocks while the queue is full. Returns false, and drops the item, if the queue has been closed.
+    bool push( T value )
+    {
+        std::unique_lock< std::mutex > lock( mutex_ );
+        not_full_.wait( lock, [this]() { return closed_ || ( items_.size() < capacity_ ); } );
+        if ( closed_ )
+            return false;
+        items_.push_back( std::move( value ) );
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Blocks while the queue is empty. Returns false when the queue has been closed and is empty.
+    bool pop( T & value )
+    {
+        std::unique_lock< std::mutex > lock( mutex_ );
+        not_empty_.wait( lock, [this]() { return closed_ || ( ! items_.empty() ); } );
+        if ( items_.empty() )
+            return false;
+        value = std::move( items_.front() );
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    bool closed_;
+    std::deque< T > items_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+#endif // BOUNDEDQUEUE_H
@@ -26,8 +26,142 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "CalculateBFDH.h"
+#include "3DCalculations.h"
+#include "CrystalLattice.h"
+#include "MathFunctions.h"
+#include "Sort.h"
+#include "SpaceGroup.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+
+// ********************************************************************************
+
+// Keeps the part of a convex polygon on the inside of the plane, i.e. where signed_distance() >= 0.
+std::vector< Vector3D > clip( const std::vector< Vector3D > & polygon, const Plane & plane )
+{
+    std::vector< Vector3D > result;
+    for ( size_t i( 0 ); i != polygon.size(); ++i )
+    {
+        const Vector3D & current = polygon[i];
+        const Vector3D & next = polygon[ ( i + 1 ) % polygon.size() ];
+        const double current_distance = plane.signed_distance( current );
+        const double next_distance = plane.signed_distance( next );
+        if ( current_distance >= 0.0 )
+            result.push_back( current );
+        if ( ( current_distance >= 0.0 ) != ( next_distance >= 0.0 ) )
+            result.push_back( current + ( current_distance / ( current_distance - next_distance ) ) * ( next - current ) );
+    }
+    return result;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+CalculateBFDH::CalculateBFDH( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group, const int max_index )
+{
+    if ( max_index < 1 )
+        throw std::runtime_error( "CalculateBFDH::CalculateBFDH(): max_index must be at least 1." );
+    std::vector< MillerIndices > candidates;
+    std::vector< Plane > planes;
+    std::vector< double > distances;
+    const ReciprocalBasis reciprocal_basis( crystal_lattice );
+    for ( int h( -max_index ); h <= max_index; ++h )
+    {
+        for ( int k( -max_index ); k <= max_index; ++k )
+        {
+            for ( int l( -max_index ); l <= max_index; ++l )
+            {
+                if ( greatest_common_divisor( greatest_common_divisor( std::abs( h ), std::abs( k ) ), std::abs( l ) ) != 1 )
+                    continue;
+                const MillerIndices miller_indices( h, k, l );
+                // The first order that is not systematically absent, at most the order of the longest translation
+                int n( 1 );
+                while ( space_group.is_systematic_absence( MillerIndices( n * h, n * k, n * l ) ) )
+                {
+                    ++n;
+                    if ( n > 12 )
+                        throw std::runtime_error( "CalculateBFDH::CalculateBFDH(): all orders of " + miller_indices.to_string() + " are absent." );
+                }
+                const Vector3D H = reciprocal_basis.point( miller_indices );
+                const double distance = n * H.length();
+                candidates.push_back( miller_indices );
+                planes.push_back( Plane( NormalisedVector3D( H.x(), H.y(), H.z() ), distance ) );
+                distances.push_back( distance );
+            }
+        }
+    }
+    // Planes close to the origin are the most likely to cut off a trial face, so try them first
+    const std::vector< size_t > sorted_map = sort( distances );
+    const double size = 1000.0 * distances[ sorted_map.back() ];
+    for ( size_t i( 0 ); i != sorted_map.size(); ++i )
+    {
+        const Plane & plane = planes[ sorted_map[i] ];
+        const Vector3D normal( plane.normal().x(), plane.normal().y(), plane.normal().z() );
+        // A large square in the plane, counterclockwise when seen from outside
+        const Vector3D axis = ( std::abs( normal.x() ) < 0.5 ) ? Vector3D( 1.0, 0.0, 0.0 ) : Vector3D( 0.0, 1.0, 0.0 );
+        Vector3D u = cross_product( normal, axis );
+        u /= u.length();
+        const Vector3D v = cross_product( normal, u );
+        const Vector3D centre = plane.constant() * normal;
+        std::vector< Vector3D > polygon;
+        polygon.push_back( centre + size * u + size * v );
+        polygon.push_back( centre - size * u + size * v );
+        polygon.push_back( centre - size * u - size * v );
+        polygon.push_back( centre + size * u - size * v );
+        for ( size_t j( 0 ); ( j != sorted_map.size() ) && ( polygon.size() > 2 ); ++j )
+        {
+            if ( j != i )
+                polygon = clip( polygon, planes[ sorted_map[j] ] );
+        }
+        if ( polygon.size() < 3 )
+            continue;
+        ConvexPolygon face( polygon );
+        // Faces that only touch the habit at an edge or a vertex
+        if ( face.area() < 1.0E-10 * square( plane.constant() ) )
+            continue;
+        miller_indices_.push_back( candidates[ sorted_map[i] ] );
+        d_spacings_.push_back( 1.0 / plane.constant() );
+        planes_.push_back( plane );
+        faces_.push_back( face );
+    }
+}
+
+// ********************************************************************************
+
+double CalculateBFDH::total_area() const
+{
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != faces_.size(); ++i )
+        result += faces_[i].area();
+    return result;
+}
 
 // ********************************************************************************
 
+double CalculateBFDH::volume() const
+{
+    // The sum of the pyramids with the origin as apex
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != faces_.size(); ++i )
+        result += faces_[i].area() * planes_[i].constant() / 3.0;
+    return result;
+}
+
+// ********************************************************************************
+
+void CalculateBFDH::show() const
+{
+    const double area = total_area();
+    for ( size_t i( 0 ); i != faces_.size(); ++i )
+        std::cout << miller_indices_[i] << " d = " << d_spacings_[i] << " area = " << 100.0 * faces_[i].area() / area << "%" << std::endl;
+}
+
 // ********************************************************************************
 
@@ -28,18 +28,57 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "ConvexPolygon.h"
+#include "MillerIndices.h"
+#include "Plane.h"
+
+class CrystalLattice;
+class SpaceGroup;
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
 /*
+  Bravais-Friedel-Donnay-Harker morphology.
+
+  The morphological importance of a face (hkl) increases with its interplanar spacing. Following Donnay and Harker,
+  the spacing is that of the first order n(hkl) that is not a systematic absence of the space group: d = d(hkl) / n.
+  The central distance of each face is taken proportional to 1/d, so face (hkl) lies in the plane H.r = n |H|^2
+  with H the reciprocal-lattice vector (the habit is in reciprocal Angstrom). The habit is the intersection of the
+  half spaces of all co-prime (hkl) up to max_index: each face is found by clipping a large polygon in its plane against
+  all other planes, trying the planes closest to the origin first. Faces that only touch the habit at an edge or a vertex are dropped.
 
+  Only the lattice and the space group are needed, not the atoms, and a structure takes about a millisecond.
 */
 class CalculateBFDH
 {
 public:
 
-    // Default constructor
-    CalculateBFDH();
+    CalculateBFDH( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group, const int max_index = 3 );
 
-private:
+    // The faces on the habit, sorted by decreasing d (most important first).
+    size_t nfaces() const { return faces_.size(); }
+
+    MillerIndices miller_indices( const size_t i ) const { return miller_indices_[i]; }
+
+    // d(hkl) / n(hkl).
+    double d_spacing( const size_t i ) const { return d_spacings_[i]; }
 
+    Plane plane( const size_t i ) const { return planes_[i]; }
+
+    const ConvexPolygon & face( const size_t i ) const { return faces_[i]; }
+
+    double total_area() const;
+
+    double volume() const;
+
+    void show() const;
+
+private:
+    std::vector< MillerIndices > miller_indices_;
+    std::vector< double > d_spacings_;
+    std::vector< Plane > planes_;
+    std::vector< ConvexPolygon > faces_;
 };
 
 #endif // CALCULATEBFDH_H
@@ -0,0 +1,127 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "CellList.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// ********************************************************************************
+
+CellList::CellList( const CrystalLattice & crystal_lattice, const std::vector< Vector3D > & positions, const double cutoff )
+{
+    if ( cutoff <= 0.0 )
+        throw std::runtime_error( "CellList::CellList(): cutoff must be positive." );
+    // A small margin, so that rounding errors cannot move a neighbour two bins away
+    const double margin = 1.0001;
+    const double reciprocal_lengths[3] = { crystal_lattice.a_star(), crystal_lattice.b_star(), crystal_lattice.c_star() };
+    for ( size_t i( 0 ); i != 3; ++i )
+        nbins_[i] = std::max( static_cast< size_t >( 1 ), static_cast< size_t >( floor( 1.0 / ( margin * cutoff * reciprocal_lengths[i] ) ) ) );
+    const size_t total_nbins = nbins_[0] * nbins_[1] * nbins_[2];
+    bins_.reserve( positions.size() );
+    bin_starts_ = std::vector< size_t >( total_nbins + 1, 0 );
+    for ( size_t i( 0 ); i != positions.size(); ++i )
+    {
+        bins_.push_back( bin( positions[i] ) );
+        ++bin_starts_[ bins_.back() + 1 ];
+    }
+    for ( size_t b( 0 ); b != total_nbins; ++b )
+        bin_starts_[b+1] += bin_starts_[b];
+    // Counting sort, which keeps the positions in each bin in ascending order
+    bin_contents_.resize( positions.size() );
+    std::vector< size_t > next( bin_starts_.begin(), bin_starts_.end() - 1 );
+    for ( size_t i( 0 ); i != positions.size(); ++i )
+        bin_contents_[ next[ bins_[i] ]++ ] = i;
+}
+
+// ********************************************************************************
+
+void CellList::candidates( const size_t i, std::vector< size_t > & result ) const
+{
+    candidates_for_bin( bins_[i], result );
+    result.erase( std::remove( result.begin(), result.end(), i ), result.end() );
+}
+
+// ********************************************************************************
+
+void CellList::candidates( const Vector3D & position, std::vector< size_t > & result ) const
+{
+    candidates_for_bin( bin( position ), result );
+}
+
+// ********************************************************************************
+
+size_t CellList::bin( const Vector3D & position ) const
+{
+    size_t index[3];
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        double x = position.value( i ) - floor( position.value( i ) );
+        index[i] = std::min( static_cast< size_t >( x * nbins_[i] ), nbins_[i] - 1 );
+    }
+    return ( index[0] * nbins_[1] + index[1] ) * nbins_[2] + index[2];
+}
+
+// ********************************************************************************
+
+void CellList::candidates_for_bin( const size_t b, std::vector< size_t > & result ) const
+{
+    result.clear();
+    const size_t index[3] = { b / ( nbins_[1] * nbins_[2] ), ( b / nbins_[2] ) % nbins_[1], b % nbins_[2] };
+    // The neighbouring bins along each direction, without duplicates if there are fewer than three bins
+    std::vector< size_t > neighbours[3];
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        if ( nbins_[i] < 4 )
+        {
+            for ( size_t j( 0 ); j != nbins_[i]; ++j )
+                neighbours[i].push_back( j );
+        }
+        else
+        {
+            neighbours[i].push_back( ( index[i] + nbins_[i] - 1 ) % nbins_[i] );
+            neighbours[i].push_back( index[i] );
+            neighbours[i].push_back( ( index[i] + 1 ) % nbins_[i] );
+        }
+    }
+    for ( size_t i( 0 ); i != neighbours[0].size(); ++i )
+    {
+        for ( size_t j( 0 ); j != neighbours[1].size(); ++j )
+        {
+            for ( size_t k( 0 ); k != neighbours[2].size(); ++k )
+            {
+                const size_t neighbour = ( neighbours[0][i] * nbins_[1] + neighbours[1][j] ) * nbins_[2] + neighbours[2][k];
+                result.insert( result.end(), bin_contents_.begin() + bin_starts_[neighbour], bin_contents_.begin() + bin_starts_[neighbour+1] );
+            }
+        }
+    }
+    std::sort( result.begin(), result.end() );
+}
+
+// ********************************************************************************
+
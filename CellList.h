@@ -0,0 +1,76 @@
+#ifndef CELLLIST_H
+#define CELLLIST_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "CrystalLattice.h"
+#include "Vector3D.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+/*
+  A periodic cell list for finding all positions within a cutoff distance of each other, in O(N) instead of O(N^2).
+
+  The unit cell is divided into bins along the three lattice directions, the number of bins along direction i is chosen
+  such that the bins are at least cutoff thick (the distance between lattice planes i being 1/|a*_i|).
+  A position within cutoff of another position must then lie in the same bin or one of its 26 neighbours, with periodic wrap.
+  The candidates still have to be checked with CrystalLattice::shortest_distance2().
+  
+  Positions are in fractional coordinates and need not be in [0,1>, because only the position modulo 1 is used, which also means that
+  the cell list remains valid if the positions are moved by lattice translations.
+*/
+class CellList
+{
+public:
+
+    // cutoff in Angstrom
+    CellList( const CrystalLattice & crystal_lattice, const std::vector< Vector3D > & positions, const double cutoff );
+
+    size_t size() const { return bins_.size(); }
+
+    // Indices of all positions that may be within cutoff of position i, excluding i, in ascending order.
+    void candidates( const size_t i, std::vector< size_t > & result ) const;
+
+    // Indices of all positions that may be within cutoff of an arbitrary position, in ascending order.
+    void candidates( const Vector3D & position, std::vector< size_t > & result ) const;
+
+    // Number of bins along each lattice direction.
+    size_t nbins( const size_t i ) const { return nbins_[i]; }
+
+private:
+    size_t nbins_[3];
+    std::vector< size_t > bins_;        // The bin of each position
+    std::vector< size_t > bin_starts_;  // Positions in bin b are bin_contents_[ bin_starts_[b] ] ... bin_contents_[ bin_starts_[b+1]-1 ]
+    std::vector< size_t > bin_contents_;
+
+    size_t bin( const Vector3D & position ) const;
+    void candidates_for_bin( const size_t b, std::vector< size_t > & result ) const;
+};
+
+#endif // CELLLIST_H
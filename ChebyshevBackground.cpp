@@ -26,6 +26,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "ChebyshevBackground.h"
+#include "PowderPattern.h"
 
 #include <cmath>
 #include <stdexcept>
@@ -54,3 +55,141 @@ double Chebyshev( const size_t order, const double x )
 
 // ********************************************************************************
 
+double Chebyshev_series( const std::vector< double > & coefficients, const double x )
+{
+    // Clenshaw: b_k = c_k + 2x b_{k+1} - b_{k+2}, result = c_0 + x b_1 - b_2
+    double b_1( 0.0 );
+    double b_2( 0.0 );
+    for ( size_t k( coefficients.size() ); k > 1; --k )
+    {
+        const double b_0 = coefficients[k-1] + 2.0 * x * b_1 - b_2;
+        b_2 = b_1;
+        b_1 = b_0;
+    }
+    if ( coefficients.empty() )
+        return 0.0;
+    return coefficients[0] + x * b_1 - b_2;
+}
+
+// ********************************************************************************
+
+namespace
+{
+
+// The 2theta values of powder_pattern mapped onto [-1, 1]
+std::vector< double > Chebyshev_x_values( const PowderPattern & powder_pattern )
+{
+    const size_t npoints = powder_pattern.size();
+    if ( npoints < 2 )
+        throw std::runtime_error( "Chebyshev_x_values(): at least two points needed." );
+    const double start = powder_pattern.two_theta( 0 ).value_in_degrees();
+    const double scale = 2.0 / ( powder_pattern.two_theta( npoints - 1 ).value_in_degrees() - start );
+    std::vector< double > result( npoints );
+    for ( size_t i( 0 ); i != npoints; ++i )
+        result[i] = scale * ( powder_pattern.two_theta( i ).value_in_degrees() - start ) - 1.0;
+    return result;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+std::vector< double > Chebyshev_background( const std::vector< double > & coefficients, const PowderPattern & powder_pattern )
+{
+    std::vector< double > result = Chebyshev_x_values( powder_pattern );
+    for ( size_t i( 0 ); i != result.size(); ++i )
+        result[i] = Chebyshev_series( coefficients, result[i] );
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< double > Chebyshev_basis( const size_t nterms, const PowderPattern & powder_pattern )
+{
+    const std::vector< double > x_values = Chebyshev_x_values( powder_pattern );
+    std::vector< double > result( x_values.size() * nterms );
+    for ( size_t i( 0 ); i != x_values.size(); ++i )
+    {
+        const double x = x_values[i];
+        double * row = &result[ i * nterms ];
+        for ( size_t j( 0 ); j != nterms; ++j )
+        {
+            if ( j == 0 )
+                row[j] = 1.0;
+            else if ( j == 1 )
+                row[j] = x;
+            else
+                row[j] = 2.0 * x * row[j-1] - row[j-2];
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< double > fit_Chebyshev_background( const std::vector< double > & basis, const size_t nterms, const std::vector< double > & values, const double * weights )
+{
+    const size_t npoints = values.size();
+    if ( basis.size() != npoints * nterms )
+        throw std::runtime_error( "fit_Chebyshev_background(): basis and values do not match." );
+    // Normal equations A^T W A c = A^T W y, lower triangle only
+    std::vector< double > normal_matrix( nterms * nterms, 0.0 );
+    std::vector< double > result( nterms, 0.0 );
+    for ( size_t i( 0 ); i != npoints; ++i )
+    {
+        const double * row = &basis[ i * nterms ];
+        const double weight = ( weights == 0 ) ? 1.0 : weights[i];
+        for ( size_t j( 0 ); j != nterms; ++j )
+        {
+            const double w_a = weight * row[j];
+            result[j] += w_a * values[i];
+            for ( size_t k( 0 ); k <= j; ++k )
+                normal_matrix[ j * nterms + k ] += w_a * row[k];
+        }
+    }
+    // Cholesky decomposition in place, L L^T
+    for ( size_t j( 0 ); j != nterms; ++j )
+    {
+        for ( size_t k( 0 ); k <= j; ++k )
+        {
+            double sum = normal_matrix[ j * nterms + k ];
+            for ( size_t l( 0 ); l != k; ++l )
+                sum -= normal_matrix[ j * nterms + l ] * normal_matrix[ k * nterms + l ];
+            if ( k == j )
+            {
+                if ( sum <= 0.0 )
+                    throw std::runtime_error( "fit_Chebyshev_background(): normal matrix is not positive definite." );
+                normal_matrix[ j * nterms + j ] = std::sqrt( sum );
+            }
+            else
+                normal_matrix[ j * nterms + k ] = sum / normal_matrix[ k * nterms + k ];
+        }
+    }
+    // Forward and back substitution
+    for ( size_t j( 0 ); j != nterms; ++j )
+    {
+        for ( size_t l( 0 ); l != j; ++l )
+            result[j] -= normal_matrix[ j * nterms + l ] * result[l];
+        result[j] /= normal_matrix[ j * nterms + j ];
+    }
+    for ( size_t j( nterms ); j != 0; --j )
+    {
+        for ( size_t l( j ); l != nterms; ++l )
+            result[j-1] -= normal_matrix[ l * nterms + ( j - 1 ) ] * result[l];
+        result[j-1] /= normal_matrix[ ( j - 1 ) * nterms + ( j - 1 ) ];
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< double > fit_Chebyshev_background( const PowderPattern & powder_pattern, const size_t nterms )
+{
+    std::vector< double > values( powder_pattern.size() );
+    for ( size_t i( 0 ); i != values.size(); ++i )
+        values[i] = powder_pattern.intensity( i );
+    return fit_Chebyshev_background( Chebyshev_basis( nterms, powder_pattern ), nterms, values, powder_pattern.weights() );
+}
+
+// ********************************************************************************
+
@@ -28,10 +28,32 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+class PowderPattern;
+
 #include <cstddef> // For definition of size_t
+#include <vector>
 
 // Returns a Chebyshev polynomial of the first kind.
 double Chebyshev( const size_t order, const double x );
 
+// Returns sum_i coefficients[i] * T_i( x ), evaluated with Clenshaw's recurrence, so in O( n ) for n terms. There is no limit on the number of terms.
+double Chebyshev_series( const std::vector< double > & coefficients, const double x );
+
+// In the functions below, the 2theta range of powder_pattern is mapped onto [-1, 1], as in TOPAS. Only the 2theta values are used.
+
+// The background sum_i coefficients[i] * T_i( x ) at every point of powder_pattern.
+std::vector< double > Chebyshev_background( const std::vector< double > & coefficients, const PowderPattern & powder_pattern );
+
+// T_0( x ) ... T_{nterms-1}( x ) at every point of powder_pattern, by the three-term recurrence,
+// stored as one row of nterms values per point. Only needs to be calculated once for a least-squares fit.
+std::vector< double > Chebyshev_basis( const size_t nterms, const PowderPattern & powder_pattern );
+
+// Weighted linear least-squares fit of the Chebyshev coefficients to values, with basis as calculated by Chebyshev_basis().
+// weights may be 0, in which case all points have weight 1.0.
+std::vector< double > fit_Chebyshev_background( const std::vector< double > & basis, const size_t nterms, const std::vector< double > & values, const double * weights = 0 );
+
+// As above, fits the intensities of powder_pattern with its weights (1/ESD^2).
+std::vector< double > fit_Chebyshev_background( const PowderPattern & powder_pattern, const size_t nterms );
+
 #endif // CHEBYSHEVBACKGROUND_H
 
@@ -0,0 +1,134 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Checkpoint.h"
+#include "FileName.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+
+const char magic[8] = { 'C', 'H', 'E', 'C', 'K', 'P', 'T', '1' };
+
+} // namespace
+
+// ********************************************************************************
+
+void CheckpointWriter::write( const std::string & value )
+{
+    write( value.size() );
+    buffer_.append( value );
+}
+
+// ********************************************************************************
+
+void CheckpointWriter::save( const FileName & file_name, const std::string & key ) const
+{
+    const std::string temporary_file_name = file_name.full_name() + ".tmp";
+    {
+        std::ofstream output_file( temporary_file_name.c_str(), std::ios::binary );
+        if ( ! output_file )
+            throw std::runtime_error( "CheckpointWriter::save(): could not open file " + temporary_file_name );
+        const size_t key_size = key.size();
+        output_file.write( magic, sizeof( magic ) );
+        output_file.write( reinterpret_cast< const char * >( &key_size ), sizeof( key_size ) );
+        output_file.write( key.data(), key.size() );
+        output_file.write( buffer_.data(), buffer_.size() );
+        output_file.flush();
+        if ( ! output_file )
+        {
+            output_file.close();
+            std::remove( temporary_file_name.c_str() );
+            throw std::runtime_error( "CheckpointWriter::save(): could not write file " + temporary_file_name );
+        }
+    }
+#ifdef _WIN32
+    // rename() does not replace an existing file on Windows
+    std::remove( file_name.full_name().c_str() );
+#endif
+    if ( std::rename( temporary_file_name.c_str(), file_name.full_name().c_str() ) != 0 )
+    {
+        std::remove( temporary_file_name.c_str() );
+        throw std::runtime_error( "CheckpointWriter::save(): could not rename file " + temporary_file_name );
+    }
+}
+
+// ********************************************************************************
+
+bool CheckpointReader::load( const FileName & file_name, const std::string & key )
+{
+    buffer_.clear();
+    position_ = 0;
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+        return false;
+    std::ostringstream contents;
+    contents << input_file.rdbuf();
+    buffer_ = contents.str();
+    if ( ( buffer_.size() < sizeof( magic ) ) || ( buffer_.compare( 0, sizeof( magic ), magic, sizeof( magic ) ) != 0 ) )
+        throw std::runtime_error( "CheckpointReader::load(): " + file_name.full_name() + " is not a checkpoint file." );
+    position_ = sizeof( magic );
+    std::string file_key;
+    read( file_key );
+    if ( file_key != key )
+    {
+        buffer_.clear();
+        position_ = 0;
+        return false;
+    }
+    return true;
+}
+
+// ********************************************************************************
+
+void CheckpointReader::read( std::string & value )
+{
+    size_t size;
+    read( size );
+    check( size );
+    value = buffer_.substr( position_, size );
+    position_ += size;
+}
+
+// ********************************************************************************
+
+void CheckpointReader::check( const size_t nbytes ) const
+{
+    if ( buffer_.size() - position_ < nbytes )
+        throw std::runtime_error( "CheckpointReader::read(): checkpoint is truncated." );
+}
+
+// ********************************************************************************
+
+void remove_checkpoint( const FileName & file_name )
+{
+    std::remove( file_name.full_name().c_str() );
+}
+
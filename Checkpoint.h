@@ -0,0 +1,127 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class FileName;
+
+#include <cstddef> // For definition of size_t
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+  Checkpoint files, so that a calculation that runs for hours can resume after the process has been stopped,
+  e.g. on a pre-emptible node.
+
+  The state of the calculation is appended to a CheckpointWriter and then saved in one go: it is written to a temporary
+  file which is then renamed, so a process that is killed while writing leaves the previous checkpoint intact.
+  The file starts with a key that describes the calculation (the input files, the settings); a checkpoint that was written
+  for a different key is ignored, so a calculation never resumes from the state of another calculation.
+  The values are written in the native byte order, a checkpoint is meant to be read back on the same kind of machine.
+*/
+class CheckpointWriter
+{
+public:
+
+    CheckpointWriter() {}
+
+    // For trivially copyable types such as size_t, double, Angle and Vector3D.
+    template< class T >
+    void write( const T & value )
+    {
+        static_assert( std::is_trivially_copyable< T >::value, "CheckpointWriter::write(): type cannot be written as bytes." );
+        buffer_.append( reinterpret_cast< const char * >( &value ), sizeof( T ) );
+    }
+
+    void write( const std::string & value );
+
+    template< class T >
+    void write( const std::vector< T > & values )
+    {
+        write( values.size() );
+        for ( size_t i( 0 ); i != values.size(); ++i )
+            write( values[i] );
+    }
+
+    // Atomically replaces the file, throws if it could not be written.
+    void save( const FileName & file_name, const std::string & key ) const;
+
+private:
+    std::string buffer_;
+};
+
+// Reads the values in the order in which they were written by a CheckpointWriter.
+class CheckpointReader
+{
+public:
+
+    CheckpointReader(): position_(0) {}
+
+    // Returns false if the file does not exist or was written for a different key.
+    bool load( const FileName & file_name, const std::string & key );
+
+    // Throws std::runtime_error if the checkpoint is truncated.
+    template< class T >
+    void read( T & value )
+    {
+        static_assert( std::is_trivially_copyable< T >::value, "CheckpointReader::read(): type cannot be read as bytes." );
+        check( sizeof( T ) );
+        std::memcpy( &value, buffer_.data() + position_, sizeof( T ) );
+        position_ += sizeof( T );
+    }
+
+    void read( std::string & value );
+
+    template< class T >
+    void read( std::vector< T > & values )
+    {
+        size_t size;
+        read( size );
+        // A corrupt size must not allocate terabytes
+        check( size );
+        values.resize( size );
+        for ( size_t i( 0 ); i != size; ++i )
+            read( values[i] );
+    }
+
+    bool at_end() const { return position_ == buffer_.size(); }
+
+private:
+    std::string buffer_;
+    size_t position_;
+
+    void check( const size_t nbytes ) const;
+};
+
+// Does nothing if the file does not exist.
+void remove_checkpoint( const FileName & file_name );
+
+#endif // CHECKPOINT_H
@@ -26,140 +26,175 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "ChemicalFormula.h"
+#include "CrystalStructure.h"
 #include "Utilities.h"
 
 #include <stdexcept>
 #include <algorithm>
 
+namespace
+{
+
+// The ids in the "usual" order, see elements_less().
+class UsualOrderTable
+{
+public:
+
+    UsualOrderTable()
+    {
+        std::vector< Element > elements;
+        for ( size_t i( 0 ); i != nelement_ids; ++i )
+            elements.push_back( Element::from_id( i ) );
+        std::sort( elements.begin(), elements.end(), elements_less );
+        for ( size_t i( 0 ); i != nelement_ids; ++i )
+            ids_[i] = elements[i].id();
+    }
+
+    size_t id( const size_t i ) const { return ids_[i]; }
+
+private:
+    size_t ids_[ nelement_ids ];
+};
+
+const UsualOrderTable & usual_order_table()
+{
+    static const UsualOrderTable table;
+    return table;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+ChemicalFormula::ChemicalFormula() :
+size_(0),
+sort_by_atomic_number_(false)
+{
+    std::fill( numbers_, numbers_ + nelement_ids, 0 );
+}
+
 // ********************************************************************************
 
 // @@ There are all sorts of special cases, e.g. C10C10H10. We do not deal with any of them.
 ChemicalFormula::ChemicalFormula( const std::string & input ) :
+size_(0),
 sort_by_atomic_number_(false)
 {
+    std::fill( numbers_, numbers_ + nelement_ids, 0 );
     if ( input.empty() )
         return;
     if ( ! is_upper_case_letter( input[0] ) )
         throw std::runtime_error( "ChemicalFormula::ChemicalFormula(): start of new element is not an upper case letter." );
-    size_t iPos( 0 );
-    while ( iPos < input.length() )
+    // A single pass over the characters, the symbols are looked up without creating strings.
+    const char * pos = input.data();
+    const char * const end = input.data() + input.length();
+    while ( pos != end )
     {
-        // Current character is an upper case letter
-        // Find the next upper case letter
-        size_t iPos2( iPos + 1 );
-        while ( ( iPos2 < input.length() ) && ( ! is_upper_case_letter( input[iPos2] ) ) )
-            ++iPos2;
-        // We must now have C, Cc, Cdd or Ccdd, where C is upper case letter, c is lower case letter, d is digit.
-        Element element;
-        size_t count( 1 );
-        if ( ( iPos2 > ( iPos + 1 ) ) && is_lower_case_letter( input[iPos+1] ) )
+        // Current character is an upper case letter. We must now have C, Cc, Cdd or Ccdd, where C is upper case letter, c is lower case letter, d is digit.
+        const char * symbol_end = pos + 1;
+        if ( ( symbol_end != end ) && is_lower_case_letter( *symbol_end ) )
+            ++symbol_end;
+        const Element element( pos, symbol_end );
+        pos = symbol_end;
+        size_t count( 0 );
+        if ( ( pos == end ) || ! is_digit( *pos ) )
+            count = 1;
+        while ( ( pos != end ) && is_digit( *pos ) )
         {
-            element = Element( input.substr( iPos, 2 ) );
-            iPos += 2;
-        }
-        else
-        {
-            element = Element( input.substr( iPos, 1 ) );
-            ++iPos;
+            count = 10 * count + ( *pos - '0' );
+            ++pos;
         }
-        if ( ( iPos2 - iPos ) > 0 )
-            count = string2integer( input.substr( iPos, iPos2-iPos ) );
+        // As written by to_string( true )
+        while ( ( pos != end ) && ( *pos == ' ' ) )
+            ++pos;
+        if ( ( pos != end ) && ! is_upper_case_letter( *pos ) )
+            throw std::runtime_error( "ChemicalFormula::ChemicalFormula(): start of new element is not an upper case letter." );
         if ( contains( element ) )
             throw std::runtime_error( "ChemicalFormula::ChemicalFormula(): element is present more than once." );
-        elements_[ element ] = count;
-        iPos = iPos2;
+        add_element( element, count );
     }
 }
 
 // ********************************************************************************
 
-void ChemicalFormula::add_element( const Element element )
+ChemicalFormula::ChemicalFormula( const CrystalStructure & crystal_structure ) :
+size_(0),
+sort_by_atomic_number_(false)
 {
-    if ( contains( element ) )
-        ++elements_[ element ];
-    else
-        elements_[ element ] = 1;
+    std::fill( numbers_, numbers_ + nelement_ids, 0 );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+        ++numbers_[ crystal_structure.atom( i ).element().id() ];
+    for ( size_t i( 0 ); i != nelement_ids; ++i )
+    {
+        if ( numbers_[i] != 0 )
+            ++size_;
+    }
+}
+
+// ********************************************************************************
+
+void ChemicalFormula::add_element( const Element element, const size_t number )
+{
+    if ( number == 0 )
+        return;
+    if ( numbers_[ element.id() ] == 0 )
+        ++size_;
+    numbers_[ element.id() ] += number;
 }
 
 // ********************************************************************************
 
 void ChemicalFormula::multiply( const Fraction fraction )
 {
-    for ( std::map< Element, size_t >::iterator pos( elements_.begin() ); pos != elements_.end(); ++pos )
+    for ( size_t i( 0 ); i != nelement_ids; ++i )
     {
-        Fraction result = pos->second * fraction;
+        if ( numbers_[i] == 0 )
+            continue;
+        Fraction result = static_cast< int >( numbers_[i] ) * fraction;
         if ( ! result.is_integer() )
             throw std::runtime_error( "ChemicalFormula::multiply(): result is not an integer." );
-        pos->second = result.integer_part();
+        numbers_[i] = result.integer_part();
+        if ( numbers_[i] == 0 )
+            --size_;
     }
 }
 
 // ********************************************************************************
 
-// See sort_by_atomic_number()
-Element ChemicalFormula::element( const size_t i ) const
+size_t ChemicalFormula::sorted_ids( size_t ids[ nelement_ids ] ) const
 {
-    if ( sort_by_atomic_number_ )
+    size_t result( 0 );
+    for ( size_t i( 0 ); i != nelement_ids; ++i )
     {
-        std::map< Element, size_t >::const_iterator pos = elements_.begin();
-        size_t j( 0 );
-        while ( j != i )
-        {
-            ++j;
-            ++pos;
-        }
-        return pos->first;
-    }
-    else
-    {
-        std::vector< Element > elements;
-        for ( std::map< Element, size_t >::const_iterator pos( elements_.begin() ); pos != elements_.end(); ++pos )
-        {
-            elements.push_back( pos->first );
-        }
-        std::sort( elements.begin(), elements.end(), elements_less );
-        return elements[i];
+        const size_t id = sort_by_atomic_number_ ? i : usual_order_table().id( i );
+        if ( numbers_[id] != 0 )
+            ids[ result++ ] = id;
     }
+    return result;
 }
 
 // ********************************************************************************
 
 // See sort_by_atomic_number()
-size_t ChemicalFormula::number( const size_t i ) const
+Element ChemicalFormula::element( const size_t i ) const
 {
-    if ( sort_by_atomic_number_ )
-    {
-        std::map< Element, size_t >::const_iterator pos = elements_.begin();
-        size_t j( 0 );
-        while ( j != i )
-        {
-            ++j;
-            ++pos;
-        }
-        return pos->second;
-    }
-    else
-    {
-        std::vector< Element > elements;
-        for ( std::map< Element, size_t >::const_iterator pos( elements_.begin() ); pos != elements_.end(); ++pos )
-        {
-            elements.push_back( pos->first );
-        }
-        std::sort( elements.begin(), elements.end(), elements_less );
-        for ( std::map< Element, size_t >::const_iterator pos( elements_.begin() ); pos != elements_.end(); ++pos )
-        {
-            if ( pos->first == elements[i] )
-                return pos->second;
-        }
-    }
-    throw std::runtime_error( "ChemicalFormula::number( size_t ): ." );
+    if ( i >= size_ )
+        throw std::runtime_error( "ChemicalFormula::element(): index out of range." );
+    size_t ids[ nelement_ids ];
+    sorted_ids( ids );
+    return Element::from_id( ids[i] );
 }
 
 // ********************************************************************************
 
-bool ChemicalFormula::contains( const Element element ) const
+// See sort_by_atomic_number()
+size_t ChemicalFormula::number( const size_t i ) const
 {
-    return ( elements_.find( element ) != elements_.end() );
+    if ( i >= size_ )
+        throw std::runtime_error( "ChemicalFormula::number( size_t ): index out of range." );
+    size_t ids[ nelement_ids ];
+    sorted_ids( ids );
+    return numbers_[ ids[i] ];
 }
 
 // ********************************************************************************
@@ -167,8 +202,11 @@ bool ChemicalFormula::contains( const Element element ) const
 double ChemicalFormula::molecular_weight() const
 {
     double result( 0.0 );
-    for ( std::map< Element, size_t >::const_iterator pos( elements_.begin() ); pos != elements_.end(); ++pos )
-        result += pos->first.atomic_weight() * pos->second;
+    for ( size_t i( 0 ); i != nelement_ids; ++i )
+    {
+        if ( numbers_[i] != 0 )
+            result += Element::from_id( i ).atomic_weight() * numbers_[i];
+    }
     return result;
 }
 
@@ -177,8 +215,11 @@ double ChemicalFormula::molecular_weight() const
 double ChemicalFormula::solid_state_volume() const
 {
     double result( 0.0 );
-    for ( std::map< Element, size_t >::const_iterator pos( elements_.begin() ); pos != elements_.end(); ++pos )
-        result += pos->first.solid_state_volume() * pos->second;
+    for ( size_t i( 0 ); i != nelement_ids; ++i )
+    {
+        if ( numbers_[i] != 0 )
+            result += Element::from_id( i ).solid_state_volume() * numbers_[i];
+    }
     return result;
 }
 
@@ -187,8 +228,8 @@ double ChemicalFormula::solid_state_volume() const
 size_t ChemicalFormula::nelectrons() const
 {
     size_t result( 0 );
-    for ( std::map< Element, size_t >::const_iterator pos( elements_.begin() ); pos != elements_.end(); ++pos )
-        result += pos->first.atomic_number() * pos->second;
+    for ( size_t i( 0 ); i != nelement_ids; ++i )
+        result += Element::from_id( i ).atomic_number() * numbers_[i];
     return result;
 }
 
@@ -196,14 +237,16 @@ size_t ChemicalFormula::nelectrons() const
 
 std::string ChemicalFormula::to_string( const bool insert_spaces, const bool explicit_1 ) const
 {
+    size_t ids[ nelement_ids ];
+    const size_t nids = sorted_ids( ids );
     std::string result;
-    for ( size_t i( 0 ); i != size(); ++i )
+    for ( size_t i( 0 ); i != nids; ++i )
     {
         if ( insert_spaces && ( i != 0 ) )
             result += " ";
-        result += element( i ).symbol();
-        if ( ( number( i ) != 1 ) || explicit_1 )
-            result += size_t2string( number( i ) );
+        result += Element::from_id( ids[i] ).symbol();
+        if ( ( numbers_[ ids[i] ] != 1 ) || explicit_1 )
+            result += size_t2string( numbers_[ ids[i] ] );
     }
     return result;
 }
@@ -28,19 +28,22 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+class CrystalStructure;
+
 #include "Element.h"
 #include "Fraction.h"
 
-#include <map>
 #include <string>
 
 /*
+  The number of atoms of each element, stored as a dense array indexed by Element::id() so that adding an atom and looking up
+  a count are O(1) and nothing is allocated.
 */
 class ChemicalFormula
 {
 public:
 
-    ChemicalFormula() : sort_by_atomic_number_(false) {}
+    ChemicalFormula();
     
     // There will always be ambiguity, e.g. "BI" can mean Bismut or Boron and Iodine.
     // A solution would be to insist on writing "BI" as "B1I1", but that is unusal
@@ -48,7 +51,10 @@ public:
     // The chemical formula must be well formed, so HCl *must* be HCl, not HCL. C10C10H10 is not possible either.
     explicit ChemicalFormula( const std::string & input );
 
-    void add_element( const Element element );
+    // All atoms of the crystal structure, in one pass. Symmetry is not applied.
+    explicit ChemicalFormula( const CrystalStructure & crystal_structure );
+
+    void add_element( const Element element, const size_t number = 1 );
     
     // Elements can be sorted by atomic number or in the "usual" order: C, H, D, rest alphabetical.
     // The default is: C, H, D, rest alphabetical.
@@ -70,17 +76,19 @@ public:
     // This probably should not be a member function
     void multiply( const Fraction fraction );
 
-    size_t size() const { return elements_.size(); }
+    // The number of different elements.
+    size_t size() const { return size_; }
     
     // See sort_by_atomic_number()
-    // Currently extremely wasteful but works and is safe
     Element element( const size_t i ) const;
 
     // See sort_by_atomic_number()
-    // Currently extremely wasteful but works and is safe
     size_t number( const size_t i ) const;
 
-    bool contains( const Element element ) const;
+    // 0 if the element is not present.
+    size_t number( const Element element ) const { return numbers_[ element.id() ]; }
+
+    bool contains( const Element element ) const { return ( numbers_[ element.id() ] != 0 ); }
     
     double molecular_weight() const;
 
@@ -92,8 +100,12 @@ public:
     std::string to_string( const bool insert_spaces = false, const bool explicit_1 = false ) const;
 
 private:
-    std::map< Element, size_t > elements_;
+    size_t numbers_[ nelement_ids ];
+    size_t size_;
     bool sort_by_atomic_number_;
+
+    // The ids of the elements that are present, in the order of sort_by_atomic_number(). Returns the number of ids.
+    size_t sorted_ids( size_t ids[ nelement_ids ] ) const;
 };
 
 #endif // CHEMICALFORMULA_H
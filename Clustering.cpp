@@ -0,0 +1,357 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Clustering.h"
+#include "CorrelationMatrix.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+
+// Numbers the sets in the order of their first member, as SymmetryOrbits does.
+std::vector< size_t > number_sets( const std::vector< size_t > & roots )
+{
+    const size_t n = roots.size();
+    std::vector< size_t > result( n, n );
+    std::vector< size_t > set_numbers( n, n );
+    size_t nsets( 0 );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        if ( set_numbers[ roots[i] ] == n )
+            set_numbers[ roots[i] ] = nsets++;
+        result[i] = set_numbers[ roots[i] ];
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+size_t find_root( std::vector< size_t > & parents, size_t i )
+{
+    while ( parents[i] != i )
+    {
+        parents[i] = parents[ parents[i] ];
+        i = parents[i];
+    }
+    return i;
+}
+
+// ********************************************************************************
+
+// Index of ( i, j ), i != j, in the packed lower triangle, as in CorrelationMatrix
+inline size_t packed_index( size_t i, size_t j )
+{
+    if ( i < j )
+        std::swap( i, j );
+    return ( ( i * ( i - 1 ) ) / 2 ) + j;
+}
+
+// ********************************************************************************
+
+bool more_similar( const ClusterMerge & lhs, const ClusterMerge & rhs )
+{
+    return lhs.similarity_ > rhs.similarity_;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+DuplicateGroups::DuplicateGroups( const size_t n, const double threshold ):
+threshold_(threshold),
+parents_(n)
+{
+    for ( size_t i( 0 ); i != n; ++i )
+        parents_[i] = i;
+}
+
+// ********************************************************************************
+
+size_t DuplicateGroups::find_root( size_t i ) const
+{
+    return ::find_root( parents_, i );
+}
+
+// ********************************************************************************
+
+void DuplicateGroups::add( const size_t i, const size_t j, const double value )
+{
+    if ( value < threshold_ )
+        return;
+    if ( ( i >= size() ) || ( j >= size() ) )
+        throw std::runtime_error( "DuplicateGroups::add(): index out of bounds." );
+    std::lock_guard< std::mutex > lock( mutex_ );
+    const size_t root_i = find_root( i );
+    const size_t root_j = find_root( j );
+    // The smallest index becomes the root, so that the root is the first member
+    if ( root_i < root_j )
+        parents_[ root_j ] = root_i;
+    else if ( root_j < root_i )
+        parents_[ root_i ] = root_j;
+}
+
+// ********************************************************************************
+
+void DuplicateGroups::add( const CorrelationMatrix & correlation_matrix )
+{
+    if ( correlation_matrix.size() != size() )
+        throw std::runtime_error( "DuplicateGroups::add(): dimension of the correlation matrix is not the number of items." );
+    for ( size_t i( 1 ); i < size(); ++i )
+    {
+        for ( size_t j( 0 ); j != i; ++j )
+            add( i, j, correlation_matrix.value( i, j ) );
+    }
+}
+
+// ********************************************************************************
+
+std::vector< size_t > DuplicateGroups::groups() const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    std::vector< size_t > roots( size() );
+    for ( size_t i( 0 ); i != size(); ++i )
+        roots[i] = find_root( i );
+    return number_sets( roots );
+}
+
+// ********************************************************************************
+
+size_t DuplicateGroups::ngroups() const
+{
+    return representatives().size();
+}
+
+// ********************************************************************************
+
+bool DuplicateGroups::are_in_same_group( const size_t i, const size_t j ) const
+{
+    if ( ( i >= size() ) || ( j >= size() ) )
+        throw std::runtime_error( "DuplicateGroups::are_in_same_group(): index out of bounds." );
+    std::lock_guard< std::mutex > lock( mutex_ );
+    return find_root( i ) == find_root( j );
+}
+
+// ********************************************************************************
+
+std::vector< size_t > DuplicateGroups::representatives() const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    std::vector< size_t > result;
+    for ( size_t i( 0 ); i != size(); ++i )
+    {
+        if ( find_root( i ) == i )
+            result.push_back( i );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< size_t > group_duplicates( const CorrelationMatrix & correlation_matrix, const double threshold )
+{
+    DuplicateGroups duplicate_groups( correlation_matrix.size(), threshold );
+    duplicate_groups.add( correlation_matrix );
+    return duplicate_groups.groups();
+}
+
+// ********************************************************************************
+
+Dendrogram::Dendrogram( const size_t nitems, const std::vector< ClusterMerge > & merges ):
+nitems_(nitems),
+merges_(merges)
+{
+    if ( ( nitems_ != 0 ) && ( merges_.size() > nitems_ - 1 ) )
+        throw std::runtime_error( "Dendrogram::Dendrogram(): too many merges." );
+    for ( size_t k( 0 ); k != merges_.size(); ++k )
+    {
+        if ( ( merges_[k].cluster_2_ >= nitems_ + k ) || ( merges_[k].cluster_1_ >= merges_[k].cluster_2_ ) )
+            throw std::runtime_error( "Dendrogram::Dendrogram(): merge " + size_t2string( k ) + " refers to a cluster that does not exist yet." );
+        if ( ( k != 0 ) && ( merges_[k].similarity_ > merges_[k-1].similarity_ ) )
+            throw std::runtime_error( "Dendrogram::Dendrogram(): merges are not in order of decreasing similarity." );
+    }
+}
+
+// ********************************************************************************
+
+std::vector< size_t > Dendrogram::clusters_after_merges( const size_t nmerges ) const
+{
+    // Every cluster points to the cluster it was merged into
+    std::vector< size_t > parents( nitems_ + nmerges );
+    for ( size_t i( 0 ); i != parents.size(); ++i )
+        parents[i] = i;
+    for ( size_t k( 0 ); k != nmerges; ++k )
+    {
+        parents[ merges_[k].cluster_1_ ] = nitems_ + k;
+        parents[ merges_[k].cluster_2_ ] = nitems_ + k;
+    }
+    std::vector< size_t > roots( nitems_ );
+    for ( size_t i( 0 ); i != nitems_; ++i )
+        roots[i] = find_root( parents, i );
+    // The roots can be merged clusters, number_sets() needs them to be items
+    std::vector< size_t > first_member( parents.size(), nitems_ );
+    for ( size_t i( 0 ); i != nitems_; ++i )
+    {
+        if ( first_member[ roots[i] ] == nitems_ )
+            first_member[ roots[i] ] = i;
+        roots[i] = first_member[ roots[i] ];
+    }
+    return number_sets( roots );
+}
+
+// ********************************************************************************
+
+std::vector< size_t > Dendrogram::clusters( const double threshold ) const
+{
+    size_t nmerges( 0 );
+    while ( ( nmerges != merges_.size() ) && ( merges_[ nmerges ].similarity_ >= threshold ) )
+        ++nmerges;
+    return clusters_after_merges( nmerges );
+}
+
+// ********************************************************************************
+
+std::vector< size_t > Dendrogram::clusters( const size_t nclusters ) const
+{
+    if ( ( nclusters == 0 ) && ( nitems_ != 0 ) )
+        throw std::runtime_error( "Dendrogram::clusters(): number of clusters must be at least 1." );
+    const size_t nmerges = ( nclusters >= nitems_ ) ? 0 : std::min( nitems_ - nclusters, merges_.size() );
+    return clusters_after_merges( nmerges );
+}
+
+// ********************************************************************************
+
+Dendrogram average_linkage_clustering( const CorrelationMatrix & correlation_matrix )
+{
+    const size_t n = correlation_matrix.size();
+    if ( n < 2 )
+        return Dendrogram( n, std::vector< ClusterMerge >() );
+    std::vector< double > similarities( ( n * ( n - 1 ) ) / 2 );
+    for ( size_t i( 1 ); i != n; ++i )
+    {
+        for ( size_t j( 0 ); j != i; ++j )
+            similarities[ packed_index( i, j ) ] = correlation_matrix.value( i, j );
+    }
+    // A cluster is stored in the slot of one of its items, the slot of the other cluster becomes inactive
+    std::vector< size_t > sizes( n, 1 );
+    std::vector< size_t > active;
+    active.reserve( n );
+    for ( size_t i( 0 ); i != n; ++i )
+        active.push_back( i );
+    std::vector< size_t > position_in_active( n );
+    for ( size_t i( 0 ); i != n; ++i )
+        position_in_active[i] = i;
+    // The merges as pairs of slots, in the order in which the chain finds them
+    std::vector< ClusterMerge > slot_merges;
+    slot_merges.reserve( n - 1 );
+    std::vector< size_t > chain;
+    chain.reserve( n );
+    while ( active.size() > 1 )
+    {
+        if ( chain.empty() )
+            chain.push_back( active[0] );
+        const size_t a = chain.back();
+        // The previous element of the chain wins ties, otherwise the chain could cycle
+        size_t b = n;
+        double best_similarity( 0.0 );
+        if ( chain.size() > 1 )
+        {
+            b = chain[ chain.size() - 2 ];
+            best_similarity = similarities[ packed_index( a, b ) ];
+        }
+        for ( size_t k( 0 ); k != active.size(); ++k )
+        {
+            const size_t c = active[k];
+            if ( c == a )
+                continue;
+            const double similarity = similarities[ packed_index( a, c ) ];
+            if ( ( b == n ) || ( similarity > best_similarity ) )
+            {
+                b = c;
+                best_similarity = similarity;
+            }
+        }
+        if ( ( chain.size() < 2 ) || ( b != chain[ chain.size() - 2 ] ) )
+        {
+            chain.push_back( b );
+            continue;
+        }
+        // a and b are reciprocal nearest neighbours: merge them into the slot with the smaller index
+        chain.pop_back();
+        chain.pop_back();
+        const size_t kept = std::min( a, b );
+        const size_t removed = std::max( a, b );
+        ClusterMerge merge;
+        merge.cluster_1_ = kept;
+        merge.cluster_2_ = removed;
+        merge.similarity_ = best_similarity;
+        merge.size_ = sizes[a] + sizes[b];
+        slot_merges.push_back( merge );
+        // Lance-Williams update for average linkage
+        for ( size_t k( 0 ); k != active.size(); ++k )
+        {
+            const size_t c = active[k];
+            if ( ( c == kept ) || ( c == removed ) )
+                continue;
+            double & similarity = similarities[ packed_index( kept, c ) ];
+            similarity = ( sizes[kept] * similarity + sizes[removed] * similarities[ packed_index( removed, c ) ] ) / ( sizes[kept] + sizes[removed] );
+        }
+        sizes[kept] += sizes[removed];
+        // Remove the slot from the active list by moving the last one into its place
+        const size_t position = position_in_active[ removed ];
+        active[ position ] = active.back();
+        position_in_active[ active[ position ] ] = position;
+        active.pop_back();
+    }
+    // Average linkage is reducible, so sorting the merges gives a valid dendrogram; a stable sort keeps ties in the order found
+    std::stable_sort( slot_merges.begin(), slot_merges.end(), more_similar );
+    // Slots are items, translate them to cluster numbers
+    std::vector< size_t > parents( n );
+    std::vector< size_t > cluster_numbers( n );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        parents[i] = i;
+        cluster_numbers[i] = i;
+    }
+    std::vector< ClusterMerge > merges( slot_merges.size() );
+    for ( size_t k( 0 ); k != slot_merges.size(); ++k )
+    {
+        const size_t root_1 = find_root( parents, slot_merges[k].cluster_1_ );
+        const size_t root_2 = find_root( parents, slot_merges[k].cluster_2_ );
+        merges[k] = slot_merges[k];
+        merges[k].cluster_1_ = std::min( cluster_numbers[ root_1 ], cluster_numbers[ root_2 ] );
+        merges[k].cluster_2_ = std::max( cluster_numbers[ root_1 ], cluster_numbers[ root_2 ] );
+        parents[ root_2 ] = root_1;
+        cluster_numbers[ root_1 ] = n + k;
+    }
+    return Dendrogram( n, merges );
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,133 @@
+#ifndef CLUSTERING_H
+#define CLUSTERING_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CorrelationMatrix;
+
+#include <cstddef> // For definition of size_t
+#include <mutex>
+#include <vector>
+
+/*
+  Analysis of a CorrelationMatrix: duplicates and hierarchical clustering, e.g. to collapse a crystal structure prediction
+  landscape to its unique polymorphs.
+
+  Clusters are always numbered in the order of their first member, so the numbering does not depend on the order of the merges.
+*/
+
+/*
+  Groups items whose similarity is at least threshold, transitively (if A is a duplicate of B and B of C, all three are one group),
+  with union-find, so the time is proportional to the number of pairs.
+
+  Pairs can be added in any order and from several threads, e.g. while calculate_correlation_matrix() is still running,
+  so that the duplicates are known the moment the matrix is finished. Only pairs with a value of at least threshold take the lock.
+*/
+class DuplicateGroups
+{
+public:
+
+    DuplicateGroups( const size_t n, const double threshold );
+
+    size_t size() const { return parents_.size(); }
+
+    double threshold() const { return threshold_; }
+
+    // Thread-safe.
+    void add( const size_t i, const size_t j, const double value );
+
+    // All pairs of the matrix, which must have dimension size().
+    void add( const CorrelationMatrix & correlation_matrix );
+
+    // The group number of every item.
+    std::vector< size_t > groups() const;
+
+    size_t ngroups() const;
+
+    // Thread-safe, so that expensive comparisons of pairs that are already known to be duplicates can be skipped.
+    bool are_in_same_group( const size_t i, const size_t j ) const;
+
+    // The first member of each group, in ascending order, e.g. the unique polymorphs.
+    std::vector< size_t > representatives() const;
+
+private:
+    double threshold_;
+    mutable std::vector< size_t > parents_;
+    mutable std::mutex mutex_;
+
+    // mutex_ must be locked.
+    size_t find_root( size_t i ) const;
+};
+
+// The group number of every item, see DuplicateGroups.
+std::vector< size_t > group_duplicates( const CorrelationMatrix & correlation_matrix, const double threshold );
+
+// Clusters 0 ... n-1 are the items, merge k creates cluster n + k.
+struct ClusterMerge
+{
+    size_t cluster_1_; // The smaller of the two
+    size_t cluster_2_;
+    double similarity_;
+    size_t size_; // Number of items in the new cluster
+};
+
+/*
+  The n-1 merges of hierarchical clustering of n items, in order of decreasing similarity.
+*/
+class Dendrogram
+{
+public:
+
+    Dendrogram(): nitems_(0) {}
+
+    // The merges must be in order of decreasing similarity and numbered as described for ClusterMerge.
+    Dendrogram( const size_t nitems, const std::vector< ClusterMerge > & merges );
+
+    size_t nitems() const { return nitems_; }
+
+    const std::vector< ClusterMerge > & merges() const { return merges_; }
+
+    // The cluster number of every item after all merges with a similarity of at least threshold.
+    std::vector< size_t > clusters( const double threshold ) const;
+
+    // The cluster number of every item when the dendrogram is cut into nclusters clusters.
+    std::vector< size_t > clusters( const size_t nclusters ) const;
+
+private:
+    size_t nitems_;
+    std::vector< ClusterMerge > merges_;
+
+    std::vector< size_t > clusters_after_merges( const size_t nmerges ) const;
+};
+
+// Average linkage (UPGMA): the similarity between two clusters is the average similarity of all pairs of their members.
+// Uses the nearest-neighbour-chain algorithm, which takes O(N^2) time, on a packed copy of the lower triangle of the matrix
+// (N(N-1)/2 doubles) that is updated in place as clusters are merged.
+Dendrogram average_linkage_clustering( const CorrelationMatrix & correlation_matrix );
+
+#endif // CLUSTERING_H
@@ -39,9 +39,9 @@ CollectionOfPoints::CollectionOfPoints()
 // ********************************************************************************
 
 CollectionOfPoints::CollectionOfPoints( const std::vector< Vector3D > & points ):
-points_(points)
+points_(points),
+moments_(points)
 {
-    update();
 }
 
 // ********************************************************************************
@@ -49,7 +49,8 @@ points_(points)
 void CollectionOfPoints::add_point( const Vector3D point )
 {
     points_.push_back( point );
-    update();
+    moments_.add_point( point );
+    points_wrt_com_.invalidate();
 }
 
 // ********************************************************************************
@@ -58,19 +59,25 @@ void CollectionOfPoints::add_points( const std::vector< Vector3D > & points )
 {
     points_.reserve( points_.size() + points.size() );
     for ( std::vector< Vector3D >::const_iterator it(points.begin()); it != points.end(); ++it )
+    {
         points_.push_back( *it );
-    update();
+        moments_.add_point( *it );
+    }
+    points_wrt_com_.invalidate();
 }
 
 // ********************************************************************************
 
-void CollectionOfPoints::update()
+const std::vector< Vector3D > & CollectionOfPoints::points_wrt_com() const
 {
-    average_ = ::average( points_ );
-    points_wrt_com_.clear();
-    points_wrt_com_.reserve( points_.size() );
-    for ( std::vector< Vector3D >::const_iterator it(points_.begin()); it != points_.end(); ++it )
-        points_wrt_com_.push_back( (*it) - average_ );
+    return points_wrt_com_.get( [this]( std::vector< Vector3D > & result )
+    {
+        const Vector3D average = this->average();
+        result.clear();
+        result.reserve( points_.size() );
+        for ( std::vector< Vector3D >::const_iterator it(points_.begin()); it != points_.end(); ++it )
+            result.push_back( (*it) - average );
+    } );
 }
 
 // ********************************************************************************
@@ -28,6 +28,8 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "3DCalculations.h"
+#include "LazyCache.h"
 #include "Vector3D.h"
 
 #include <vector>
@@ -35,7 +37,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /*
   Main purpose is two things:
   
-  - Allow for caching of results of calculations in the future (currently not done)
+  - Cache the results of calculations: the moments (see PointMoments) are updated with every point that is added,
+    the points with respect to the centre of mass are only recalculated when they are asked for after the points have changed
+    (in a LazyCache, so several threads can ask for them at the same time).
   - Make it easy and efficient to refer to the points with respect to their centre of mass.
 */
 class CollectionOfPoints
@@ -54,17 +58,21 @@ public:
     void reserve( const size_t value ) { points_.reserve( value ); }
 
     Vector3D point( const size_t i ) const { return points_[i]; }
-    Vector3D point_wrt_com( const size_t i ) const { return points_wrt_com_[i]; }
+    Vector3D point_wrt_com( const size_t i ) const { return points_wrt_com()[i]; }
     
-    Vector3D average() const { return average_; }
-    Vector3D centre_of_mass() const { return average_; }
+    Vector3D average() const { return points_.empty() ? Vector3D() : moments_.centroid(); }
+    Vector3D centre_of_mass() const { return average(); }
+
+    // Centroid, covariance matrix, best plane and RMSD from the best plane
+    const PointMoments & moments() const { return moments_; }
 
 private:
     std::vector< Vector3D > points_;
-    std::vector< Vector3D > points_wrt_com_;
-    Vector3D average_;
+    PointMoments moments_;
+    LazyCache< std::vector< Vector3D > > points_wrt_com_;
 
-    void update();
+    // Recalculates points_wrt_com_ if the points have changed since the last call
+    const std::vector< Vector3D > & points_wrt_com() const;
 };
 
 #endif // COLLECTIONOFPOINTS_H
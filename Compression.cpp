@@ -0,0 +1,418 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Compression.h"
+#include "FileName.h"
+#include "Utilities.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <zlib.h>
+
+#ifdef FOURIER_ZSTD
+#include <zstd.h>
+#endif
+
+namespace
+{
+
+const size_t block_size = 1 << 16;
+
+void throw_no_zstd( const std::string & function_name )
+{
+    throw std::runtime_error( function_name + ": zstd support was not compiled in, build with make ZSTD=1." );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+Compression detect_compression( const char * data, const size_t nbytes )
+{
+    const unsigned char * bytes = reinterpret_cast< const unsigned char * >( data );
+    if ( ( nbytes >= 2 ) && ( bytes[0] == 0x1F ) && ( bytes[1] == 0x8B ) )
+        return GZIP;
+    if ( ( nbytes >= 4 ) && ( bytes[0] == 0x28 ) && ( bytes[1] == 0xB5 ) && ( bytes[2] == 0x2F ) && ( bytes[3] == 0xFD ) )
+        return ZSTD;
+    return NO_COMPRESSION;
+}
+
+// ********************************************************************************
+
+Compression detect_compression( const FileName & file_name )
+{
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+        return NO_COMPRESSION;
+    char magic[4];
+    input_file.read( magic, 4 );
+    return detect_compression( magic, static_cast< size_t >( input_file.gcount() ) );
+}
+
+// ********************************************************************************
+
+Compression compression_from_extension( const FileName & file_name )
+{
+    const std::string extension = to_lower( file_name.extension() );
+    if ( extension == "gz" )
+        return GZIP;
+    if ( extension == "zst" )
+        return ZSTD;
+    return NO_COMPRESSION;
+}
+
+// ********************************************************************************
+
+void decompress_if_compressed( std::vector< char > & contents )
+{
+    const Compression compression = detect_compression( contents.data(), contents.size() );
+    if ( compression == NO_COMPRESSION )
+        return;
+    std::istringstream source( std::string( contents.begin(), contents.end() ) );
+    DecompressingStreamBuffer decompressing_stream_buffer( source, compression );
+    std::vector< char > result;
+    size_t nread( 0 );
+    while ( true )
+    {
+        result.resize( nread + block_size );
+        const std::streamsize n = decompressing_stream_buffer.sgetn( &result[nread], block_size );
+        nread += n;
+        if ( n != static_cast< std::streamsize >( block_size ) )
+            break;
+    }
+    result.resize( nread );
+    contents.swap( result );
+}
+
+// ********************************************************************************
+
+// Decompresses one block at a time, from gzip or zstd. Consecutive gzip members or zstd frames are treated as one stream.
+class DecompressingStreamBuffer::Decoder
+{
+public:
+
+    explicit Decoder( const Compression compression ): compression_(compression), is_at_end_of_frame_(true)
+    {
+        if ( compression_ == GZIP )
+        {
+            zlib_stream_.zalloc = Z_NULL;
+            zlib_stream_.zfree = Z_NULL;
+            zlib_stream_.opaque = Z_NULL;
+            zlib_stream_.next_in = Z_NULL;
+            zlib_stream_.avail_in = 0;
+            // 15 + 32: the largest window, and recognise the gzip header
+            if ( inflateInit2( &zlib_stream_, 15 + 32 ) != Z_OK )
+                throw std::runtime_error( "DecompressingStreamBuffer::Decoder::Decoder(): could not initialise zlib." );
+        }
+        else if ( compression_ == ZSTD )
+        {
+#ifdef FOURIER_ZSTD
+            zstd_stream_ = ZSTD_createDStream();
+            if ( zstd_stream_ == 0 )
+                throw std::runtime_error( "DecompressingStreamBuffer::Decoder::Decoder(): could not initialise zstd." );
+#else
+            throw_no_zstd( "DecompressingStreamBuffer::Decoder::Decoder()" );
+#endif
+        }
+        else
+            throw std::runtime_error( "DecompressingStreamBuffer::Decoder::Decoder(): no compression." );
+    }
+
+    ~Decoder()
+    {
+        if ( compression_ == GZIP )
+            inflateEnd( &zlib_stream_ );
+#ifdef FOURIER_ZSTD
+        else
+            ZSTD_freeDStream( zstd_stream_ );
+#endif
+    }
+
+    // Decompresses from [input, input_end) into [output, output + output_size), advances input past what has been used.
+    // Returns the number of bytes written.
+    size_t decompress( const char * & input, const char * input_end, char * output, const size_t output_size )
+    {
+        if ( compression_ == GZIP )
+        {
+            zlib_stream_.next_in = reinterpret_cast< Bytef * >( const_cast< char * >( input ) );
+            zlib_stream_.avail_in = static_cast< uInt >( input_end - input );
+            zlib_stream_.next_out = reinterpret_cast< Bytef * >( output );
+            zlib_stream_.avail_out = static_cast< uInt >( output_size );
+            const int return_code = inflate( &zlib_stream_, Z_NO_FLUSH );
+            if ( ( return_code != Z_OK ) && ( return_code != Z_STREAM_END ) && ( return_code != Z_BUF_ERROR ) )
+                throw std::runtime_error( "DecompressingStreamBuffer::Decoder::decompress(): corrupt gzip data." );
+            if ( reinterpret_cast< const char * >( zlib_stream_.next_in ) != input )
+                is_at_end_of_frame_ = false;
+            input = reinterpret_cast< const char * >( zlib_stream_.next_in );
+            if ( return_code == Z_STREAM_END )
+            {
+                is_at_end_of_frame_ = true;
+                inflateReset( &zlib_stream_ );
+            }
+            return output_size - zlib_stream_.avail_out;
+        }
+#ifdef FOURIER_ZSTD
+        ZSTD_inBuffer zstd_input = { input, static_cast< size_t >( input_end - input ), 0 };
+        ZSTD_outBuffer zstd_output = { output, output_size, 0 };
+        const size_t return_code = ZSTD_decompressStream( zstd_stream_, &zstd_output, &zstd_input );
+        if ( ZSTD_isError( return_code ) )
+            throw std::runtime_error( std::string( "DecompressingStreamBuffer::Decoder::decompress(): corrupt zstd data: " ) + ZSTD_getErrorName( return_code ) );
+        input += zstd_input.pos;
+        is_at_end_of_frame_ = ( return_code == 0 );
+        return zstd_output.pos;
+#else
+        return 0;
+#endif
+    }
+
+    // False if the input stopped in the middle of a gzip member or a zstd frame.
+    bool is_at_end_of_frame() const { return is_at_end_of_frame_; }
+
+private:
+    Compression compression_;
+    bool is_at_end_of_frame_;
+    z_stream zlib_stream_;
+#ifdef FOURIER_ZSTD
+    ZSTD_DStream * zstd_stream_;
+#endif
+
+    Decoder( const Decoder & );
+    Decoder & operator=( const Decoder & );
+};
+
+// ********************************************************************************
+
+DecompressingStreamBuffer::DecompressingStreamBuffer( std::istream & source, const Compression compression ):
+source_(source),
+decoder_( new Decoder( compression ) ),
+input_( block_size ),
+output_( block_size ),
+input_begin_(0),
+input_end_(0)
+{
+    setg( &output_[0], &output_[0], &output_[0] );
+}
+
+// ********************************************************************************
+
+DecompressingStreamBuffer::~DecompressingStreamBuffer()
+{
+    delete decoder_;
+}
+
+// ********************************************************************************
+
+DecompressingStreamBuffer::int_type DecompressingStreamBuffer::underflow()
+{
+    if ( gptr() < egptr() )
+        return traits_type::to_int_type( *gptr() );
+    while ( true )
+    {
+        if ( input_begin_ == input_end_ )
+        {
+            source_.read( &input_[0], input_.size() );
+            input_begin_ = 0;
+            input_end_ = static_cast< size_t >( source_.gcount() );
+            if ( input_end_ == 0 )
+            {
+                if ( ! decoder_->is_at_end_of_frame() )
+                    throw std::runtime_error( "DecompressingStreamBuffer::underflow(): compressed data ends unexpectedly." );
+                return traits_type::eof();
+            }
+        }
+        const char * input = &input_[0] + input_begin_;
+        const size_t nbytes = decoder_->decompress( input, &input_[0] + input_end_, &output_[0], output_.size() );
+        input_begin_ = input - &input_[0];
+        if ( nbytes != 0 )
+        {
+            setg( &output_[0], &output_[0], &output_[0] + nbytes );
+            return traits_type::to_int_type( output_[0] );
+        }
+    }
+}
+
+// ********************************************************************************
+
+// Compresses one block at a time, to gzip or zstd.
+class CompressingStreamBuffer::Encoder
+{
+public:
+
+    Encoder( const Compression compression, const int level ): compression_(compression)
+    {
+        if ( compression_ == GZIP )
+        {
+            zlib_stream_.zalloc = Z_NULL;
+            zlib_stream_.zfree = Z_NULL;
+            zlib_stream_.opaque = Z_NULL;
+            // 15 + 16: the largest window, and write a gzip header
+            if ( deflateInit2( &zlib_stream_, ( level == 0 ) ? Z_DEFAULT_COMPRESSION : level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+                throw std::runtime_error( "CompressingStreamBuffer::Encoder::Encoder(): could not initialise zlib." );
+        }
+        else if ( compression_ == ZSTD )
+        {
+#ifdef FOURIER_ZSTD
+            zstd_context_ = ZSTD_createCCtx();
+            if ( zstd_context_ == 0 )
+                throw std::runtime_error( "CompressingStreamBuffer::Encoder::Encoder(): could not initialise zstd." );
+            if ( level != 0 )
+                ZSTD_CCtx_setParameter( zstd_context_, ZSTD_c_compressionLevel, level );
+#else
+            throw_no_zstd( "CompressingStreamBuffer::Encoder::Encoder()" );
+#endif
+        }
+        else
+            throw std::runtime_error( "CompressingStreamBuffer::Encoder::Encoder(): no compression." );
+    }
+
+    ~Encoder()
+    {
+        if ( compression_ == GZIP )
+            deflateEnd( &zlib_stream_ );
+#ifdef FOURIER_ZSTD
+        else
+            ZSTD_freeCCtx( zstd_context_ );
+#endif
+    }
+
+    // mode is 0 (compress), 1 (flush) or 2 (end), output is scratch space.
+    void compress( const char * input, const size_t nbytes, const int mode, std::ostream & sink, std::vector< char > & output )
+    {
+        if ( compression_ == GZIP )
+        {
+            const int flush = ( mode == 0 ) ? Z_NO_FLUSH : ( ( mode == 1 ) ? Z_SYNC_FLUSH : Z_FINISH );
+            zlib_stream_.next_in = reinterpret_cast< Bytef * >( const_cast< char * >( input ) );
+            zlib_stream_.avail_in = static_cast< uInt >( nbytes );
+            int return_code;
+            do
+            {
+                zlib_stream_.next_out = reinterpret_cast< Bytef * >( &output[0] );
+                zlib_stream_.avail_out = static_cast< uInt >( output.size() );
+                return_code = deflate( &zlib_stream_, flush );
+                if ( return_code == Z_STREAM_ERROR )
+                    throw std::runtime_error( "CompressingStreamBuffer::Encoder::compress(): zlib error." );
+                sink.write( &output[0], output.size() - zlib_stream_.avail_out );
+            }
+            while ( ( zlib_stream_.avail_out == 0 ) || ( ( flush == Z_FINISH ) && ( return_code != Z_STREAM_END ) ) );
+            return;
+        }
+#ifdef FOURIER_ZSTD
+        const ZSTD_EndDirective directive = ( mode == 0 ) ? ZSTD_e_continue : ( ( mode == 1 ) ? ZSTD_e_flush : ZSTD_e_end );
+        ZSTD_inBuffer zstd_input = { input, nbytes, 0 };
+        while ( true )
+        {
+            ZSTD_outBuffer zstd_output = { &output[0], output.size(), 0 };
+            const size_t remaining = ZSTD_compressStream2( zstd_context_, &zstd_output, &zstd_input, directive );
+            if ( ZSTD_isError( remaining ) )
+                throw std::runtime_error( std::string( "CompressingStreamBuffer::Encoder::compress(): zstd error: " ) + ZSTD_getErrorName( remaining ) );
+            sink.write( &output[0], zstd_output.pos );
+            if ( ( directive == ZSTD_e_continue ) ? ( zstd_input.pos == zstd_input.size ) : ( remaining == 0 ) )
+                break;
+        }
+#endif
+    }
+
+private:
+    Compression compression_;
+    z_stream zlib_stream_;
+#ifdef FOURIER_ZSTD
+    ZSTD_CCtx * zstd_context_;
+#endif
+
+    Encoder( const Encoder & );
+    Encoder & operator=( const Encoder & );
+};
+
+// ********************************************************************************
+
+CompressingStreamBuffer::CompressingStreamBuffer( std::ostream & sink, const Compression compression, const int level ):
+sink_(sink),
+encoder_( new Encoder( compression, level ) ),
+input_( block_size ),
+output_( block_size ),
+finished_(false)
+{
+    setp( &input_[0], &input_[0] + input_.size() );
+}
+
+// ********************************************************************************
+
+CompressingStreamBuffer::~CompressingStreamBuffer()
+{
+    delete encoder_;
+}
+
+// ********************************************************************************
+
+void CompressingStreamBuffer::finish()
+{
+    if ( finished_ )
+        return;
+    compress_buffered( 2 );
+    finished_ = true;
+    sink_.flush();
+}
+
+// ********************************************************************************
+
+CompressingStreamBuffer::int_type CompressingStreamBuffer::overflow( int_type c )
+{
+    if ( finished_ )
+        return traits_type::eof();
+    compress_buffered( 0 );
+    if ( ! traits_type::eq_int_type( c, traits_type::eof() ) )
+    {
+        *pptr() = traits_type::to_char_type( c );
+        pbump( 1 );
+    }
+    return traits_type::not_eof( c );
+}
+
+// ********************************************************************************
+
+int CompressingStreamBuffer::sync()
+{
+    if ( finished_ )
+        return 0;
+    compress_buffered( 1 );
+    sink_.flush();
+    return sink_ ? 0 : -1;
+}
+
+// ********************************************************************************
+
+void CompressingStreamBuffer::compress_buffered( const int mode )
+{
+    encoder_->compress( pbase(), pptr() - pbase(), mode, sink_, output_ );
+    setp( &input_[0], &input_[0] + input_.size() );
+}
+
+// ********************************************************************************
+
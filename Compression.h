@@ -0,0 +1,127 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class FileName;
+
+#include <cstddef> // For definition of size_t
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+/*
+  Transparent gzip and zstd compression of text files, so that compressed cifs, .xye files etc. can be read
+  directly and large outputs can be written compressed, without a decompressed copy on disk.
+
+  Files are recognised as compressed by their magic bytes, so the extension does not matter for reading.
+  For writing, the extension chooses the compression: "gz" for gzip and "zst" for zstd.
+  Concatenated gzip members and zstd frames are read as one stream, as by gunzip and zstd -d.
+
+  gzip is always available (zlib). zstd needs "make ZSTD=1", which defines FOURIER_ZSTD and links libzstd;
+  without it, zstd files are still recognised but reading or writing them throws std::runtime_error.
+*/
+
+enum Compression { NO_COMPRESSION, GZIP, ZSTD };
+
+// From the magic bytes at the start of data.
+Compression detect_compression( const char * data, const size_t nbytes );
+
+// From the magic bytes at the start of the file, NO_COMPRESSION if the file cannot be opened.
+Compression detect_compression( const FileName & file_name );
+
+// The compression that a file with this name should be written with: "gz" or "zst", case-insensitive.
+Compression compression_from_extension( const FileName & file_name );
+
+// The contents of a file that has already been read, e.g. by FilePrefetcher. Does nothing if they are not compressed.
+void decompress_if_compressed( std::vector< char > & contents );
+
+// A read-only stream buffer that decompresses the data read from source in blocks.
+class DecompressingStreamBuffer : public std::streambuf
+{
+public:
+
+    // source must outlive this buffer.
+    DecompressingStreamBuffer( std::istream & source, const Compression compression );
+
+    ~DecompressingStreamBuffer();
+
+protected:
+    int_type underflow();
+
+private:
+    class Decoder;
+    std::istream & source_;
+    Decoder * decoder_;
+    std::vector< char > input_;
+    std::vector< char > output_;
+    size_t input_begin_; // The part of input_ that has not been decompressed yet
+    size_t input_end_;
+
+    DecompressingStreamBuffer( const DecompressingStreamBuffer & );
+    DecompressingStreamBuffer & operator=( const DecompressingStreamBuffer & );
+};
+
+// A write-only stream buffer that compresses the data in blocks and writes them to sink.
+// finish() must be called to write the end of the compressed stream, the destructor does not.
+class CompressingStreamBuffer : public std::streambuf
+{
+public:
+
+    // sink must outlive this buffer. level is as for gzip (1-9) or zstd (1-19), 0 means the default of the library.
+    CompressingStreamBuffer( std::ostream & sink, const Compression compression, const int level = 0 );
+
+    ~CompressingStreamBuffer();
+
+    // Compresses what is buffered and ends the compressed stream. No more data can be written afterwards.
+    void finish();
+
+protected:
+    int_type overflow( int_type c );
+
+    // Compresses what is buffered and flushes it to sink, so that everything written so far can be decompressed.
+    int sync();
+
+private:
+    class Encoder;
+    std::ostream & sink_;
+    Encoder * encoder_;
+    std::vector< char > input_;
+    std::vector< char > output_;
+    bool finished_;
+
+    // mode is 0 (compress), 1 (flush) or 2 (end)
+    void compress_buffered( const int mode );
+
+    CompressingStreamBuffer( const CompressingStreamBuffer & );
+    CompressingStreamBuffer & operator=( const CompressingStreamBuffer & );
+};
+
+#endif // COMPRESSION_H
@@ -0,0 +1,194 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ContactAnalysis.h"
+#include "3DCalculations.h"
+#include "CellList.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "Element.h"
+#include "FileList.h"
+#include "Logger.h"
+#include "MathFunctions.h"
+#include "ParallelFor.h"
+#include "ReadCif.h"
+#include "ScratchArena.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+bool is_donor_or_acceptor( const Element & element )
+{
+    return ( element == Element( "N" ) ) || ( element == Element( "O" ) ) || ( element == Element( "F" ) );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+ContactAnalysis::ContactAnalysis( const CrystalStructure & crystal_structure, const double delta, const Angle minimum_D_H_A_angle )
+{
+    const size_t natoms = crystal_structure.natoms();
+    if ( ( natoms != 0 ) && ( crystal_structure.nmolecules() == 0 ) )
+        throw std::runtime_error( "ContactAnalysis::ContactAnalysis(): perceive_molecules() must be called first." );
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    std::vector< Vector3D > positions;
+    std::vector< Element > elements;
+    std::vector< double > radii;
+    positions.reserve( natoms );
+    elements.reserve( natoms );
+    radii.reserve( natoms );
+    labels_.reserve( natoms );
+    double maximum_radius( 0.0 );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        positions.push_back( crystal_structure.atom( i ).position() );
+        elements.push_back( crystal_structure.atom( i ).element() );
+        radii.push_back( elements.back().Van_der_Waals_radius() );
+        labels_.push_back( crystal_structure.atom( i ).label() );
+        maximum_radius = std::max( maximum_radius, radii.back() );
+    }
+    if ( natoms == 0 )
+        return;
+    const CellList cell_list( crystal_lattice, positions, 2.0 * maximum_radius + delta );
+    std::vector< size_t > candidates;
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        cell_list.candidates( i, candidates );
+        for ( size_t k( 0 ); k != candidates.size(); ++k )
+        {
+            const size_t j = candidates[k];
+            if ( j <= i )
+                continue;
+            const double sum_of_radii = radii[i] + radii[j];
+            const double distance2 = crystal_lattice.shortest_distance2( positions[i], positions[j] );
+            if ( ( distance2 > square( sum_of_radii + delta ) ) || are_bonded( elements[i], elements[j], distance2 ) )
+                continue;
+            double distance;
+            Vector3D difference_vector;
+            crystal_lattice.shortest_distance( positions[i], positions[j], distance, difference_vector );
+            const Vector3D shift = difference_vector - ( positions[j] - positions[i] );
+            const Vector3D translation( std::round( shift.x() ), std::round( shift.y() ), std::round( shift.z() ) );
+            // Atoms of the same molecule are only in contact with each other if one of them is in a translated copy of the molecule
+            if ( ( crystal_structure.molecule_index( i ) == crystal_structure.molecule_index( j ) ) && translation.is_zero_vector() )
+                continue;
+            Contact contact;
+            contact.atom_1_ = i;
+            contact.atom_2_ = j;
+            contact.translation_ = translation;
+            contact.distance_ = distance;
+            contact.sum_of_Van_der_Waals_radii_ = sum_of_radii;
+            contacts_.push_back( contact );
+        }
+    }
+    // Hydrogen bonds
+    for ( size_t i( 0 ); i != contacts_.size(); ++i )
+    {
+        const Contact & contact = contacts_[i];
+        size_t hydrogen;
+        size_t acceptor;
+        if ( elements[ contact.atom_1_ ].is_H_or_D() && is_donor_or_acceptor( elements[ contact.atom_2_ ] ) )
+        {
+            hydrogen = contact.atom_1_;
+            acceptor = contact.atom_2_;
+        }
+        else if ( elements[ contact.atom_2_ ].is_H_or_D() && is_donor_or_acceptor( elements[ contact.atom_1_ ] ) )
+        {
+            hydrogen = contact.atom_2_;
+            acceptor = contact.atom_1_;
+        }
+        else
+            continue;
+        // Cartesian H->A vector
+        Vector3D H_A = crystal_lattice.fractional_to_orthogonal( positions[ contact.atom_2_ ] + contact.translation_ - positions[ contact.atom_1_ ] );
+        if ( hydrogen == contact.atom_2_ )
+            H_A = -H_A;
+        const SmallVector< size_t, 4 > & bonded_atoms = crystal_structure.bonded_atoms( hydrogen );
+        for ( size_t k( 0 ); k != bonded_atoms.size(); ++k )
+        {
+            const size_t donor = bonded_atoms[k];
+            if ( ( donor == acceptor ) || ( ! is_donor_or_acceptor( elements[ donor ] ) ) )
+                continue;
+            double distance;
+            Vector3D difference_vector;
+            crystal_lattice.shortest_distance( positions[ hydrogen ], positions[ donor ], distance, difference_vector );
+            const Vector3D H_D = crystal_lattice.fractional_to_orthogonal( difference_vector );
+            const Angle D_H_A_angle = angle( H_D, H_A );
+            if ( D_H_A_angle < minimum_D_H_A_angle )
+                continue;
+            HydrogenBond hydrogen_bond;
+            hydrogen_bond.donor_ = donor;
+            hydrogen_bond.hydrogen_ = hydrogen;
+            hydrogen_bond.acceptor_ = acceptor;
+            // The translation of the acceptor relative to the hydrogen atom
+            hydrogen_bond.translation_ = ( hydrogen == contact.atom_1_ ) ? contact.translation_ : -contact.translation_;
+            hydrogen_bond.H_A_distance_ = contact.distance_;
+            hydrogen_bond.D_A_distance_ = ( H_A - H_D ).length();
+            hydrogen_bond.D_H_A_angle_ = D_H_A_angle;
+            hydrogen_bonds_.push_back( hydrogen_bond );
+        }
+    }
+}
+
+// ********************************************************************************
+
+std::vector< ContactAnalysis > analyse_contacts( const FileList & file_list,
+                                                 std::vector< std::string > & error_messages,
+                                                 const double delta,
+                                                 const Angle minimum_D_H_A_angle,
+                                                 const size_t nthreads )
+{
+    const size_t nfiles = file_list.size();
+    std::vector< ContactAnalysis > result( nfiles );
+    error_messages = std::vector< std::string >( nfiles );
+    parallel_for( nfiles, nthreads, [&]( const size_t i )
+    {
+        ScratchArenaScope scratch_arena_scope;
+        try
+        {
+            CrystalStructure crystal_structure;
+            read_cif( file_list.value( i ), crystal_structure );
+            crystal_structure.perceive_molecules();
+            result[i] = ContactAnalysis( crystal_structure, delta, minimum_D_H_A_angle );
+        }
+        catch ( std::exception & e )
+        {
+            error_messages[i] = e.what();
+            if ( error_messages[i].empty() )
+                error_messages[i] = "unknown error";
+            log_warning( "analyse_contacts(): skipping " + file_list.value( i ).full_name() + ": " + e.what() );
+        }
+    } );
+    return result;
+}
+
+// ********************************************************************************
+
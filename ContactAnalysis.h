@@ -0,0 +1,110 @@
+#ifndef CONTACTANALYSIS_H
+#define CONTACTANALYSIS_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+class FileList;
+
+#include "Angle.h"
+#include "Vector3D.h"
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+// A contact between atom_1_ and a lattice translation of atom_2_.
+struct Contact
+{
+    size_t atom_1_;
+    size_t atom_2_;
+    Vector3D translation_; // The lattice translation that is added to the position of atom_2_, integers
+    double distance_;
+    double sum_of_Van_der_Waals_radii_;
+};
+
+// D-H...A, the distances are in A.
+struct HydrogenBond
+{
+    size_t donor_;
+    size_t hydrogen_;
+    size_t acceptor_;
+    Vector3D translation_; // The lattice translation that is added to the position of the acceptor
+    double H_A_distance_;
+    double D_A_distance_;
+    Angle D_H_A_angle_;
+};
+
+/*
+  All intermolecular contacts in a crystal structure that are shorter than the sum of the Van der Waals radii plus delta,
+  found with a CellList, so the time is linear in the number of atoms. Contacts between a molecule and a lattice translation
+  of itself count as intermolecular. Each pair of atoms is reported once, with atom_1_ < atom_2_. Pairs of atoms that are bonded
+  according to are_bonded() are never contacts.
+
+  From the contacts, hydrogen bonds D-H...A are found where D and A are N, O or F, H is bonded to D and the D-H...A angle
+  is at least minimum_D_H_A_angle.
+
+  The molecules must have been perceived with CrystalStructure::perceive_molecules(). The contacts are those in the unit cell,
+  so symmetry-equivalent contacts are all reported. Only the shortest lattice translation of each pair of atoms is considered,
+  which misses contacts only if a lattice plane spacing is smaller than twice the longest contact distance.
+*/
+class ContactAnalysis
+{
+public:
+
+    ContactAnalysis() {}
+
+    ContactAnalysis( const CrystalStructure & crystal_structure, const double delta = 0.0, const Angle minimum_D_H_A_angle = Angle::from_degrees( 120.0 ) );
+
+    size_t ncontacts() const { return contacts_.size(); }
+    const Contact & contact( const size_t i ) const { return contacts_[i]; }
+
+    size_t nhydrogen_bonds() const { return hydrogen_bonds_.size(); }
+    const HydrogenBond & hydrogen_bond( const size_t i ) const { return hydrogen_bonds_[i]; }
+
+    // The labels of the atoms, so that the contacts can be reported after the crystal structure has gone
+    const std::string & label( const size_t i ) const { return labels_[i]; }
+
+private:
+    std::vector< Contact > contacts_;
+    std::vector< HydrogenBond > hydrogen_bonds_;
+    std::vector< std::string > labels_;
+};
+
+// Reads each .cif file in file_list, perceives the molecules and analyses the contacts, distributed over nthreads threads (0 means one per core).
+// error_messages is resized to the size of file_list and is empty for the files that were processed successfully;
+// files that cannot be read are skipped with a warning.
+std::vector< ContactAnalysis > analyse_contacts( const FileList & file_list,
+                                                 std::vector< std::string > & error_messages,
+                                                 const double delta = 0.0,
+                                                 const Angle minimum_D_H_A_angle = Angle::from_degrees( 120.0 ),
+                                                 const size_t nthreads = 0 );
+
+#endif // CONTACTANALYSIS_H
+
@@ -35,17 +35,69 @@ ConvexPolygon::ConvexPolygon()
 
 // ********************************************************************************
 
+ConvexPolygon::ConvexPolygon( const std::vector< Vector3D > & vertices ):
+vertices_(vertices)
+{
+}
+
+// ********************************************************************************
+
+Vector3D ConvexPolygon::n() const
+{
+    Vector3D result;
+    for ( size_t i( 0 ); i != vertices_.size(); ++i )
+        result += cross_product( vertices_[i], vertices_[ ( i + 1 ) % vertices_.size() ] );
+    return result;
+}
+
+// ********************************************************************************
+
 double ConvexPolygon::area() const
 {
-    return 0.0;
+    return n().length() / 2.0;
 }
 
 // ********************************************************************************
 
 Vector3D ConvexPolygon::centroid() const
 {
-    return Vector3D();
+    if ( vertices_.size() < 3 )
+    {
+        Vector3D result;
+        for ( size_t i( 0 ); i != vertices_.size(); ++i )
+            result += vertices_[i];
+        return vertices_.empty() ? result : result / static_cast<double>( vertices_.size() );
+    }
+    // Area-weighted average of the centroids of a fan of triangles
+    Vector3D result;
+    double total_area( 0.0 );
+    for ( size_t i( 1 ); i + 1 < vertices_.size(); ++i )
+    {
+        double area = cross_product( vertices_[i] - vertices_[0], vertices_[i+1] - vertices_[0] ).length() / 2.0;
+        result += area * ( vertices_[0] + vertices_[i] + vertices_[i+1] ) / 3.0;
+        total_area += area;
+    }
+    return result / total_area;
 }
 
 // ********************************************************************************
 
+std::vector< Triangle > ConvexPolygon::triangles() const
+{
+    std::vector< Triangle > result;
+    append_triangles( result );
+    return result;
+}
+
+// ********************************************************************************
+
+void ConvexPolygon::append_triangles( std::vector< Triangle > & result ) const
+{
+    if ( vertices_.size() < 3 )
+        return;
+    // The centroid is calculated only once
+    const Vector3D polygon_centroid = centroid();
+    for ( size_t i( 0 ); i != vertices_.size(); ++i )
+        result.push_back( Triangle( vertices_[i], vertices_[ ( i + 1 ) % vertices_.size() ], polygon_centroid ) );
+}
+
@@ -42,10 +42,15 @@ public:
 
     // Default constructor
     ConvexPolygon();
-    
+
+    // The vertices must be in order around the polygon, they are not checked for convexity or coplanarity.
+    explicit ConvexPolygon( const std::vector< Vector3D > & vertices );
+
     size_t nvertices() const { return vertices_.size(); }
+
+    Vector3D vertex( const size_t i ) const { return vertices_[i]; }
     
-    // The normal to the plane.
+    // The normal to the plane, its length is twice the area and its sign follows from the order of the vertices.
     Vector3D n() const;
     
     double area() const;
@@ -55,6 +60,9 @@ public:
     // Divides the polygon into triangles. Each triangles consists of one edge of the polygon and the centroid of the polygon.
     std::vector< Triangle > triangles() const;
 
+    // As triangles(), but appends them to result, so that the triangles of many polygons can be collected without a vector per polygon.
+    void append_triangles( std::vector< Triangle > & result ) const;
+
 private:
 
     std::vector< Vector3D > vertices_;
@@ -26,8 +26,161 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "CopyTextFile.h"
+#include "FileDescriptor.h"
+#include "FileName.h"
+#include "ParallelFor.h"
 #include "TextFileReader.h"
 #include "TextFileWriter.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+namespace
+{
+
+const size_t copy_block_size = 1024 * 1024;
+
+// FileName::full_name() encloses names with spaces in quotes, the operating system must not see those.
+std::string path( const FileName & file_name )
+{
+    if ( is_enclosed_in_quotes( file_name.full_name() ) )
+        return extract_delimited_text( file_name.full_name(), "\"", "\"" );
+    return file_name.full_name();
+}
+
+// Copies at most nbytes bytes from the current position of input to the current position of output,
+// returns the number of bytes copied, 0 at the end of the input file.
+// The kernel copies are tried first, when one turns out not to be supported for this pair of files it is not tried again.
+ssize_t copy_block( const int input, const int output, const size_t nbytes, bool & try_copy_file_range, bool & try_sendfile, std::vector< char > & buffer )
+{
+#ifdef __linux__
+    if ( try_copy_file_range )
+    {
+        const ssize_t ncopied = copy_file_range( input, 0, output, 0, nbytes, 0 );
+        if ( ncopied != -1 )
+            return ncopied;
+        if ( ( errno != ENOSYS ) && ( errno != EXDEV ) && ( errno != EINVAL ) && ( errno != EOPNOTSUPP ) )
+            return -1;
+        try_copy_file_range = false;
+    }
+    if ( try_sendfile )
+    {
+        const ssize_t ncopied = sendfile( output, input, 0, nbytes );
+        if ( ncopied != -1 )
+            return ncopied;
+        if ( ( errno != ENOSYS ) && ( errno != EINVAL ) )
+            return -1;
+        try_sendfile = false;
+    }
+#else
+    try_copy_file_range = false;
+    try_sendfile = false;
+#endif
+    if ( buffer.empty() )
+        buffer.resize( copy_block_size );
+    const ssize_t nread = read( input, &buffer[0], std::min( nbytes, buffer.size() ) );
+    if ( nread <= 0 )
+        return nread;
+    ssize_t nwritten( 0 );
+    while ( nwritten != nread )
+    {
+        const ssize_t n = write( output, &buffer[nwritten], nread - nwritten );
+        if ( n == -1 )
+            return -1;
+        nwritten += n;
+    }
+    return nread;
+}
+
+// Appends the directories and the files below directory, relative to root, directories before their contents.
+void list_directory_tree( const std::string & root, const std::string & relative_path, std::vector< std::string > & directories, std::vector< std::string > & files )
+{
+    const std::string directory = relative_path.empty() ? root : root + "/" + relative_path;
+    DIR * dir = opendir( directory.c_str() );
+    if ( dir == 0 )
+        throw std::runtime_error( "copy_directory_tree(): could not open directory " + directory + "." );
+    std::vector< std::string > subdirectories;
+    for ( struct dirent * entry = readdir( dir ); entry != 0; entry = readdir( dir ) )
+    {
+        const std::string name( entry->d_name );
+        if ( ( name == "." ) || ( name == ".." ) )
+            continue;
+        const std::string relative_name = relative_path.empty() ? name : relative_path + "/" + name;
+        bool is_directory( false );
+#ifdef _DIRENT_HAVE_D_TYPE
+        if ( entry->d_type != DT_UNKNOWN )
+            is_directory = ( entry->d_type == DT_DIR );
+        else
+#endif
+        {
+            struct stat file_status;
+            if ( stat( ( root + "/" + relative_name ).c_str(), &file_status ) == 0 )
+                is_directory = S_ISDIR( file_status.st_mode );
+        }
+        if ( is_directory )
+            subdirectories.push_back( relative_name );
+        else
+            files.push_back( relative_name );
+    }
+    closedir( dir );
+    for ( size_t i( 0 ); i != subdirectories.size(); ++i )
+    {
+        directories.push_back( subdirectories[i] );
+        list_directory_tree( root, subdirectories[i], directories, files );
+    }
+}
+
+void make_directory( const std::string & directory )
+{
+    if ( ( mkdir( directory.c_str(), 0755 ) != 0 ) && ( errno != EEXIST ) )
+        throw std::runtime_error( "copy_directory_tree(): could not create directory " + directory + "." );
+}
+
+void copy_file( const std::string & input_path, const std::string & output_path )
+{
+    FileDescriptor input( open( input_path.c_str(), O_RDONLY ) );
+    if ( input.value() == -1 )
+        throw std::runtime_error( "copy_file(): could not open file " + input_path + "." );
+    struct stat input_status;
+    if ( fstat( input.value(), &input_status ) != 0 )
+        throw std::runtime_error( "copy_file(): could not stat file " + input_path + "." );
+    FileDescriptor output( open( output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, input_status.st_mode & 0777 ) );
+    if ( output.value() == -1 )
+        throw std::runtime_error( "copy_file(): could not open file " + output_path + "." );
+    bool try_copy_file_range( true );
+    bool try_sendfile( true );
+    std::vector< char > buffer;
+    for ( ;; )
+    {
+        const ssize_t ncopied = copy_block( input.value(), output.value(), copy_block_size, try_copy_file_range, try_sendfile, buffer );
+        if ( ncopied == 0 )
+            break;
+        if ( ncopied == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            throw std::runtime_error( "copy_file(): error copying " + input_path + " to " + output_path + "." );
+        }
+    }
+    struct timespec times[2];
+    times[0] = input_status.st_atim;
+    times[1] = input_status.st_mtim;
+    futimens( output.value(), times );
+}
+
+} // namespace
 
 // ********************************************************************************
 
@@ -42,3 +195,57 @@ void copy_text_file( const FileName & input_file, const FileName & output_file )
 
 // ********************************************************************************
 
+void copy_file( const FileName & input_file, const FileName & output_file )
+{
+    copy_file( path( input_file ), path( output_file ) );
+}
+
+// ********************************************************************************
+
+CopyStatistics copy_directory_tree( const std::string & source, const std::string & destination, const size_t nthreads, const bool incremental )
+{
+    const std::string source_path = source.empty() ? std::string( "." ) : replace( source, "\\", "/" );
+    const std::string destination_path = replace( destination, "\\", "/" );
+    if ( destination_path.empty() )
+        throw std::runtime_error( "copy_directory_tree(): no destination given." );
+    std::vector< std::string > directories;
+    std::vector< std::string > files;
+    list_directory_tree( source_path, "", directories, files );
+    // The directories are created first and on one thread, parents before children
+    make_directory( destination_path );
+    for ( size_t i( 0 ); i != directories.size(); ++i )
+        make_directory( destination_path + "/" + directories[i] );
+    std::atomic< size_t > nfiles_copied( 0 );
+    std::atomic< size_t > nfiles_skipped( 0 );
+    std::atomic< size_t > nbytes_copied( 0 );
+    parallel_for( files.size(), nthreads, [&]( const size_t i )
+    {
+        const std::string input_path = source_path + "/" + files[i];
+        const std::string output_path = destination_path + "/" + files[i];
+        struct stat input_status;
+        if ( stat( input_path.c_str(), &input_status ) != 0 )
+            throw std::runtime_error( "copy_directory_tree(): could not stat file " + input_path + "." );
+        if ( incremental )
+        {
+            struct stat output_status;
+            if ( ( stat( output_path.c_str(), &output_status ) == 0 ) &&
+                 ( output_status.st_size == input_status.st_size ) &&
+                 ( output_status.st_mtime == input_status.st_mtime ) )
+            {
+                ++nfiles_skipped;
+                return;
+            }
+        }
+        copy_file( input_path, output_path );
+        ++nfiles_copied;
+        nbytes_copied += input_status.st_size;
+    } );
+    CopyStatistics result;
+    result.nfiles_copied_ = nfiles_copied;
+    result.nfiles_skipped_ = nfiles_skipped;
+    result.nbytes_copied_ = nbytes_copied;
+    return result;
+}
+
+// ********************************************************************************
+
@@ -28,8 +28,32 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include <cstddef> // For definition of size_t
+#include <string>
+
 class FileName;
 
+// Line by line, so the line endings of the output are those of TextFileWriter.
 void copy_text_file( const FileName & input_file, const FileName & output_file );
 
+// Byte for byte, in large blocks that are copied inside the kernel with copy_file_range() or sendfile() where available,
+// otherwise with read() and write(). The permissions and the modification time are copied as well, so that
+// an incremental copy_directory_tree() recognises the copy as up to date.
+void copy_file( const FileName & input_file, const FileName & output_file );
+
+struct CopyStatistics
+{
+    CopyStatistics(): nfiles_copied_(0), nfiles_skipped_(0), nbytes_copied_(0) {}
+
+    size_t nfiles_copied_;
+    size_t nfiles_skipped_; // Unchanged, only in incremental mode
+    size_t nbytes_copied_;
+};
+
+// Copies all files in the directory tree source to destination with copy_file(), creating the directories as necessary.
+// The files are copied on nthreads threads (0 means one thread per core), which helps on network file systems
+// where every file has a long latency. If incremental is true, files for which the destination already exists
+// with the same size and modification time are skipped.
+CopyStatistics copy_directory_tree( const std::string & source, const std::string & destination, const size_t nthreads = 0, const bool incremental = true );
+
 #endif // COPYTEXTFILE_H
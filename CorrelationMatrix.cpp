@@ -26,51 +26,187 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "CorrelationMatrix.h"
+#include "FileName.h"
 #include "TextFileWriter.h"
 #include "Utilities.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include "FileDescriptor.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// The header of the binary format: "CORRMTX1", dimension, precision, value on the diagonal, padded to 64 bytes
+// so that the values after it are aligned. Numbers are stored in the native byte order.
+const size_t header_size = 64;
+const char magic[] = "CORRMTX1";
+
+// ********************************************************************************
+
+void fill_header( char * header, const size_t dimension, const CorrelationMatrix::Precision precision, const double value_on_diagonal )
+{
+    std::memset( header, 0, header_size );
+    std::memcpy( header, magic, 8 );
+    unsigned long long value = dimension;
+    std::memcpy( header + 8, &value, sizeof( value ) );
+    value = precision;
+    std::memcpy( header + 16, &value, sizeof( value ) );
+    std::memcpy( header + 24, &value_on_diagonal, sizeof( value_on_diagonal ) );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+CorrelationMatrix::CorrelationMatrix( const size_t dimension, const Precision precision ):
+data_ptr_(0),
+dimension_(dimension),
+value_on_diagonal_(1.0),
+precision_(precision),
+mapping_(0),
+mapping_size_(0),
+tracked_memory_("CorrelationMatrix")
+{
+    allocate();
+}
 
 // ********************************************************************************
 
-CorrelationMatrix::CorrelationMatrix( const size_t dimension ) : dimension_(dimension)
+CorrelationMatrix::CorrelationMatrix( const size_t dimension, const FileName & file_name, const Precision precision ):
+data_ptr_(0),
+dimension_(dimension),
+value_on_diagonal_(1.0),
+precision_(precision),
+mapping_(0),
+mapping_size_(0),
+tracked_memory_("CorrelationMatrix")
 {
-    data_ptr_ = new double[ ( dimension_ * ( dimension_ - 1 ) ) / 2 ];
-    value_on_diagonal_ = 1.0;
+    map_file( file_name.full_name(), true );
+}
+
+// ********************************************************************************
+
+CorrelationMatrix::CorrelationMatrix( const FileName & file_name ):
+data_ptr_(0),
+dimension_(0),
+value_on_diagonal_(1.0),
+precision_(DOUBLE_PRECISION),
+mapping_(0),
+mapping_size_(0),
+tracked_memory_("CorrelationMatrix")
+{
+    map_file( file_name.full_name(), false );
+}
+
+// ********************************************************************************
+
+CorrelationMatrix::CorrelationMatrix( const CorrelationMatrix & rhs ):
+data_ptr_(0),
+dimension_(rhs.dimension_),
+value_on_diagonal_(rhs.value_on_diagonal_),
+precision_(rhs.precision_),
+mapping_(0),
+mapping_size_(0),
+tracked_memory_("CorrelationMatrix")
+{
+    allocate();
+    if ( nbytes() != 0 )
+        std::memcpy( data_ptr_, rhs.data_ptr_, nbytes() );
+}
+
+// ********************************************************************************
+
+CorrelationMatrix & CorrelationMatrix::operator=( const CorrelationMatrix & rhs )
+{
+    CorrelationMatrix copy( rhs );
+    swap( copy );
+    return *this;
 }
 
 // ********************************************************************************
 
 CorrelationMatrix::~CorrelationMatrix()
 {
-    delete[] data_ptr_;
+#ifndef _WIN32
+    if ( mapping_ )
+    {
+        write_header();
+        munmap( mapping_, mapping_size_ );
+        return;
+    }
+#endif
+    std::free( data_ptr_ );
 }
 
 // ********************************************************************************
 
-double CorrelationMatrix::value( size_t i, size_t j ) const
+void CorrelationMatrix::swap( CorrelationMatrix & rhs )
+{
+    std::swap( data_ptr_, rhs.data_ptr_ );
+    std::swap( dimension_, rhs.dimension_ );
+    std::swap( value_on_diagonal_, rhs.value_on_diagonal_ );
+    std::swap( precision_, rhs.precision_ );
+    std::swap( mapping_, rhs.mapping_ );
+    std::swap( mapping_size_, rhs.mapping_size_ );
+    std::swap( file_name_, rhs.file_name_ );
+    tracked_memory_.swap( rhs.tracked_memory_ );
+}
+
+// ********************************************************************************
+
+size_t CorrelationMatrix::index( size_t i, size_t j, const std::string & function_name ) const
 {
     if ( i < j )
         std::swap( i, j );
     if ( dimension_ < (i+1) )
-        throw std::runtime_error( "CorrelationMatrix::element(): out of bounds ( " + size_t2string(i) + " > " + size_t2string(dimension_) + " )" );
+        throw std::runtime_error( "CorrelationMatrix::" + function_name + "(): out of bounds ( " + size_t2string(i) + " > " + size_t2string(dimension_) + " )" );
+    return ((i*(i-1))/2) + j;
+}
+
+// ********************************************************************************
+
+double CorrelationMatrix::value( size_t i, size_t j ) const
+{
+    size_t k = index( i, j, "element" );
     if ( i == j )
         return value_on_diagonal_;
-    return data_ptr_[ ((i*(i-1))/2) + j ];
+    return data( k );
 }
 
 // ********************************************************************************
 
 void CorrelationMatrix::set_value( size_t i, size_t j, const double value )
 {
-    if ( i < j )
-        std::swap( i, j );
-    if ( i > (dimension_-1) )
-        throw std::runtime_error( "CorrelationMatrix::set_element(): out of bounds ( " + size_t2string(i) + " > " + size_t2string(dimension_) + " )" );
+    size_t k = index( i, j, "set_element" );
     if ( i == j )
         return;
-    data_ptr_[ ((i*(i-1))/2) + j ] = value;
+    if ( precision_ == DOUBLE_PRECISION )
+        static_cast< double * >( data_ptr_ )[k] = value;
+    else
+        static_cast< float * >( data_ptr_ )[k] = static_cast< float >( value );
+}
+
+// ********************************************************************************
+
+void CorrelationMatrix::set_value_on_diagonal( const double value )
+{
+    value_on_diagonal_ = value;
+    if ( mapping_ )
+        write_header();
 }
 
 // ********************************************************************************
@@ -79,10 +215,10 @@ void CorrelationMatrix::set_value( size_t i, size_t j, const double value )
 double CorrelationMatrix::largest_value() const
 {
     double result( 0.0 );
-    for ( size_t i( 0 ); i != (( dimension_ * ( dimension_ - 1 ) ) / 2); ++i )
+    for ( size_t i( 0 ); i != nvalues(); ++i )
     {
-        if ( data_ptr_[i] > result )
-            result = data_ptr_[i];
+        if ( data( i ) > result )
+            result = data( i );
     }
     return result;
 }
@@ -93,10 +229,10 @@ double CorrelationMatrix::largest_value() const
 double CorrelationMatrix::smallest_value() const
 {
     double result( 1.0 );
-    for ( size_t i( 0 ); i != (( dimension_ * ( dimension_ - 1 ) ) / 2); ++i )
+    for ( size_t i( 0 ); i != nvalues(); ++i )
     {
-        if ( data_ptr_[i] < result )
-            result = data_ptr_[i];
+        if ( data( i ) < result )
+            result = data( i );
     }
     return result;
 }
@@ -118,3 +254,205 @@ void CorrelationMatrix::save( const FileName & file_name ) const
 
 // ********************************************************************************
 
+// ********************************************************************************
+
+void CorrelationMatrix::save_lower_triangle( const FileName & file_name ) const
+{
+    if ( mapping_ && ( file_name.full_name() == file_name_ ) )
+    {
+        flush();
+        return;
+    }
+    std::ofstream output_file( file_name.full_name().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+    if ( ! output_file )
+        throw std::runtime_error( "CorrelationMatrix::save_lower_triangle(): cannot open file " + file_name.full_name() );
+    char header[ header_size ];
+    fill_header( header, dimension_, precision_, value_on_diagonal_ );
+    output_file.write( header, header_size );
+    output_file.write( static_cast< const char * >( data_ptr_ ), nbytes() );
+    if ( ! output_file )
+        throw std::runtime_error( "CorrelationMatrix::save_lower_triangle(): error writing file " + file_name.full_name() );
+}
+
+// ********************************************************************************
+
+void CorrelationMatrix::flush() const
+{
+#ifndef _WIN32
+    if ( ! mapping_ )
+        return;
+    write_header();
+    if ( msync( mapping_, mapping_size_, MS_SYNC ) != 0 )
+        throw std::runtime_error( "CorrelationMatrix::flush(): msync() failed for file " + file_name_ );
+#endif
+}
+
+// ********************************************************************************
+
+void CorrelationMatrix::allocate()
+{
+    // calloc() also initialises the values to 0.0
+    data_ptr_ = std::calloc( std::max( nvalues(), size_t( 1 ) ), ( precision_ == DOUBLE_PRECISION ) ? sizeof( double ) : sizeof( float ) );
+    if ( ! data_ptr_ )
+        throw std::runtime_error( "CorrelationMatrix::allocate(): out of memory for dimension " + size_t2string( dimension_ ) );
+    tracked_memory_.set( nbytes() );
+}
+
+// ********************************************************************************
+
+void CorrelationMatrix::map_file( const std::string & file_name, const bool create )
+{
+#ifdef _WIN32
+    throw std::runtime_error( "CorrelationMatrix::map_file(): memory-mapped matrices are not supported on this platform." );
+#else
+    const FileDescriptor file_descriptor( open( file_name.c_str(), create ? ( O_RDWR | O_CREAT | O_TRUNC ) : O_RDWR, 0644 ) );
+    if ( file_descriptor.value() < 0 )
+        throw std::runtime_error( "CorrelationMatrix::map_file(): cannot open file " + file_name );
+    if ( create )
+    {
+        mapping_size_ = header_size + nbytes();
+        if ( ftruncate( file_descriptor.value(), mapping_size_ ) != 0 )
+            throw std::runtime_error( "CorrelationMatrix::map_file(): cannot resize file " + file_name );
+    }
+    else
+    {
+        char header[ header_size ];
+        if ( pread( file_descriptor.value(), header, header_size, 0 ) != static_cast< ssize_t >( header_size ) || ( std::memcmp( header, magic, 8 ) != 0 ) )
+            throw std::runtime_error( "CorrelationMatrix::map_file(): file is not a correlation matrix " + file_name );
+        unsigned long long value;
+        std::memcpy( &value, header + 8, sizeof( value ) );
+        dimension_ = value;
+        std::memcpy( &value, header + 16, sizeof( value ) );
+        precision_ = ( value == SINGLE_PRECISION ) ? SINGLE_PRECISION : DOUBLE_PRECISION;
+        std::memcpy( &value_on_diagonal_, header + 24, sizeof( value_on_diagonal_ ) );
+        mapping_size_ = header_size + nbytes();
+        struct stat file_status;
+        if ( ( fstat( file_descriptor.value(), &file_status ) != 0 ) || ( static_cast< size_t >( file_status.st_size ) < mapping_size_ ) )
+            throw std::runtime_error( "CorrelationMatrix::map_file(): file is too short " + file_name );
+    }
+    void * mapping = mmap( 0, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor.value(), 0 );
+    if ( mapping == MAP_FAILED )
+        throw std::runtime_error( "CorrelationMatrix::map_file(): mmap() failed for file " + file_name );
+    mapping_ = mapping;
+    data_ptr_ = static_cast< char * >( mapping_ ) + header_size;
+    file_name_ = file_name;
+    if ( create )
+        write_header();
+#endif
+}
+
+// ********************************************************************************
+
+void CorrelationMatrix::write_header() const
+{
+    fill_header( static_cast< char * >( mapping_ ), dimension_, precision_, value_on_diagonal_ );
+}
+
+// ********************************************************************************
+
+// ********************************************************************************
+
+CorrelationMatrixFileWriter::CorrelationMatrixFileWriter( const FileName & file_name, const size_t dimension, const CorrelationMatrix::Precision precision ):
+file_descriptor_(-1),
+dimension_(dimension),
+precision_(precision),
+file_name_(file_name.full_name())
+{
+#ifdef _WIN32
+    throw std::runtime_error( "CorrelationMatrixFileWriter::CorrelationMatrixFileWriter(): not supported on this platform." );
+#else
+    file_descriptor_ = open( file_name_.c_str(), O_RDWR | O_CREAT, 0644 );
+    if ( file_descriptor_ < 0 )
+        throw std::runtime_error( "CorrelationMatrixFileWriter::CorrelationMatrixFileWriter(): cannot open file " + file_name_ );
+    const size_t value_size = ( precision_ == CorrelationMatrix::DOUBLE_PRECISION ) ? sizeof( double ) : sizeof( float );
+    const size_t file_size = header_size + ( ( dimension_ * ( dimension_ - 1 ) ) / 2 ) * value_size;
+    char header[ header_size ];
+    fill_header( header, dimension_, precision_, 1.0 );
+    struct stat file_status;
+    if ( fstat( file_descriptor_, &file_status ) != 0 )
+    {
+        close( file_descriptor_ );
+        throw std::runtime_error( "CorrelationMatrixFileWriter::CorrelationMatrixFileWriter(): cannot stat file " + file_name_ );
+    }
+    if ( file_status.st_size == 0 )
+    {
+        // Another process may be doing the same right now, but it writes the same header and resizes to the same size.
+        if ( ( ftruncate( file_descriptor_, file_size ) != 0 ) || ( pwrite( file_descriptor_, header, header_size, 0 ) != static_cast< ssize_t >( header_size ) ) )
+        {
+            close( file_descriptor_ );
+            throw std::runtime_error( "CorrelationMatrixFileWriter::CorrelationMatrixFileWriter(): cannot create file " + file_name_ );
+        }
+        return;
+    }
+    char existing_header[ header_size ];
+    // The value on the diagonal is not compared
+    if ( ( static_cast< size_t >( file_status.st_size ) != file_size ) ||
+         ( pread( file_descriptor_, existing_header, header_size, 0 ) != static_cast< ssize_t >( header_size ) ) ||
+         ( std::memcmp( existing_header, header, 24 ) != 0 ) )
+    {
+        close( file_descriptor_ );
+        throw std::runtime_error( "CorrelationMatrixFileWriter::CorrelationMatrixFileWriter(): file exists with a different dimension or precision " + file_name_ );
+    }
+#endif
+}
+
+// ********************************************************************************
+
+CorrelationMatrixFileWriter::~CorrelationMatrixFileWriter()
+{
+#ifndef _WIN32
+    if ( file_descriptor_ >= 0 )
+        close( file_descriptor_ );
+#endif
+}
+
+// ********************************************************************************
+
+void CorrelationMatrixFileWriter::write_column( const size_t j, const size_t i_begin, const double * values, const size_t n )
+{
+    if ( n == 0 )
+        return;
+    if ( ( j >= dimension_ ) || ( i_begin + n > j ) )
+        throw std::runtime_error( "CorrelationMatrixFileWriter::write_column(): out of bounds." );
+#ifndef _WIN32
+    // Same layout as CorrelationMatrix::index(): ( j, i ) with j > i is at j(j-1)/2 + i
+    const size_t first_index = ( ( j * ( j - 1 ) ) / 2 ) + i_begin;
+    const char * buffer = reinterpret_cast< const char * >( values );
+    size_t nbytes = n * sizeof( double );
+    size_t offset = header_size + first_index * sizeof( double );
+    std::vector< float > single_precision_values;
+    if ( precision_ == CorrelationMatrix::SINGLE_PRECISION )
+    {
+        single_precision_values.assign( values, values + n );
+        buffer = reinterpret_cast< const char * >( &single_precision_values[0] );
+        nbytes = n * sizeof( float );
+        offset = header_size + first_index * sizeof( float );
+    }
+    while ( nbytes != 0 )
+    {
+        const ssize_t nwritten = pwrite( file_descriptor_, buffer, nbytes, offset );
+        if ( nwritten < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+            throw std::runtime_error( "CorrelationMatrixFileWriter::write_column(): cannot write to file " + file_name_ );
+        }
+        buffer += nwritten;
+        nbytes -= nwritten;
+        offset += nwritten;
+    }
+#endif
+}
+
+// ********************************************************************************
+
+void CorrelationMatrixFileWriter::sync()
+{
+#ifndef _WIN32
+    if ( fsync( file_descriptor_ ) != 0 )
+        throw std::runtime_error( "CorrelationMatrixFileWriter::sync(): cannot sync file " + file_name_ );
+#endif
+}
+
+// ********************************************************************************
+
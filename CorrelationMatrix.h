@@ -30,6 +30,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 class FileName;
 
+#include "Instrumentation.h"
+
 #include <cstddef> // For definition of size_t
 #include <string>
 
@@ -40,17 +42,40 @@ class FileName;
   Access is boundary-checked, even for the diagonal.
   
   The value that is used for the diagonal can be set (but it must be the same for all entries on the diagonal).
+
+  Only the lower triangle without the diagonal is stored, as doubles or, to halve the memory, as floats.
+  The matrix can also be stored in a file that is memory-mapped, so that matrices that do not fit in memory can be
+  calculated and so that e.g. clustering tools can open a matrix without reading all of it.
+  The file format is that of save_lower_triangle(): a header followed by the packed lower triangle.
 */
 class CorrelationMatrix
 {
 public:
 
-    explicit CorrelationMatrix( const size_t dimension );
-    
+    enum Precision { DOUBLE_PRECISION, SINGLE_PRECISION };
+
+    explicit CorrelationMatrix( const size_t dimension, const Precision precision = DOUBLE_PRECISION );
+
+    // Creates a memory-mapped matrix, an existing file is overwritten. Values are initialised to 0.0.
+    CorrelationMatrix( const size_t dimension, const FileName & file_name, const Precision precision = DOUBLE_PRECISION );
+
+    // Opens a file that was written by save_lower_triangle() or created by the constructor above as a memory-mapped matrix.
+    // Changes are written to the file.
+    explicit CorrelationMatrix( const FileName & file_name );
+
+    // The copy is always stored in memory.
+    CorrelationMatrix( const CorrelationMatrix & rhs );
+
+    CorrelationMatrix & operator=( const CorrelationMatrix & rhs );
+
     ~CorrelationMatrix();
 
     size_t size() const { return dimension_; }
 
+    Precision precision() const { return precision_; }
+
+    bool is_memory_mapped() const { return mapping_ != 0; }
+
     // In keeping with the silly C++ convention: zero-based
     double value( size_t i, size_t j ) const;
 
@@ -58,7 +83,7 @@ public:
 
     double value_on_diagonal() const { return value_on_diagonal_; }
     
-    void set_value_on_diagonal( const double value ) { value_on_diagonal_ = value; }
+    void set_value_on_diagonal( const double value );
 
     // Diagonal is not included
     double largest_value() const;
@@ -68,13 +93,67 @@ public:
 
     void save( const FileName & file_name ) const;
     
-    // @@@not yet implemented>
+    // Binary: a header followed by the packed lower triangle, written in one go.
+    // For a memory-mapped matrix saved to its own file, this only flushes the changes to disk.
     void save_lower_triangle( const FileName & file_name ) const;
 
+    // Flushes the changes of a memory-mapped matrix to disk, does nothing for a matrix in memory.
+    void flush() const;
+
+    void swap( CorrelationMatrix & rhs );
+
 private:
-    double* data_ptr_;
+    void * data_ptr_;
     size_t dimension_;
     double value_on_diagonal_;
+    Precision precision_;
+    // Memory-mapped matrices only
+    void * mapping_;
+    size_t mapping_size_;
+    std::string file_name_;
+    TrackedMemory tracked_memory_; // Matrices in memory only
+
+    size_t nvalues() const { return ( dimension_ * ( dimension_ - 1 ) ) / 2; }
+    size_t nbytes() const { return nvalues() * ( ( precision_ == DOUBLE_PRECISION ) ? sizeof( double ) : sizeof( float ) ); }
+    size_t index( size_t i, size_t j, const std::string & function_name ) const;
+    double data( const size_t i ) const { return ( precision_ == DOUBLE_PRECISION ) ? static_cast< double * >( data_ptr_ )[i] : static_cast< float * >( data_ptr_ )[i]; }
+    void allocate();
+    void map_file( const std::string & file_name, const bool create );
+    void write_header() const;
+};
+
+/*
+  Writes values into the file of a memory-mapped CorrelationMatrix with pwrite() instead of mapping it, so that only the bytes
+  of those values are touched. Several processes, also on different nodes sharing a network file system, can therefore
+  write different values of the same file at the same time. Open the file as a CorrelationMatrix to read it.
+*/
+class CorrelationMatrixFileWriter
+{
+public:
+
+    // Creates the file with all values 0.0 if it does not exist or is empty. An existing file is not changed,
+    // its dimension and precision must be those given.
+    CorrelationMatrixFileWriter( const FileName & file_name, const size_t dimension, const CorrelationMatrix::Precision precision = CorrelationMatrix::DOUBLE_PRECISION );
+
+    ~CorrelationMatrixFileWriter();
+
+    size_t size() const { return dimension_; }
+
+    // Writes the values ( i, j ) for i = i_begin, ..., i_begin + n - 1, which must all be less than j.
+    // These values are consecutive in the file, so this is a single write.
+    void write_column( const size_t j, const size_t i_begin, const double * values, const size_t n );
+
+    // Returns when everything that has been written is on disk.
+    void sync();
+
+private:
+    int file_descriptor_;
+    size_t dimension_;
+    CorrelationMatrix::Precision precision_;
+    std::string file_name_;
+
+    CorrelationMatrixFileWriter( const CorrelationMatrixFileWriter & );
+    CorrelationMatrixFileWriter & operator=( const CorrelationMatrixFileWriter & );
 };
 
 #endif // CORRELATIONMATRIX_H
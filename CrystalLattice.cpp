@@ -31,6 +31,50 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Utilities.h"
 
 #include <iostream>
+#include <stdexcept>
+
+namespace
+{
+
+// Transforms npositions positions stored as x0 y0 z0 x1 y1 z1 ..., in place.
+void transform_positions( const Matrix3D & matrix, double * xyz, const size_t npositions )
+{
+    const double m00 = matrix.value( 0, 0 );
+    const double m01 = matrix.value( 0, 1 );
+    const double m02 = matrix.value( 0, 2 );
+    const double m10 = matrix.value( 1, 0 );
+    const double m11 = matrix.value( 1, 1 );
+    const double m12 = matrix.value( 1, 2 );
+    const double m20 = matrix.value( 2, 0 );
+    const double m21 = matrix.value( 2, 1 );
+    const double m22 = matrix.value( 2, 2 );
+    if ( ( m10 == 0.0 ) && ( m20 == 0.0 ) && ( m21 == 0.0 ) )
+    {
+        for ( size_t i( 0 ); i != npositions; ++i )
+        {
+            double * p = xyz + 3*i;
+            const double x = p[0];
+            const double y = p[1];
+            const double z = p[2];
+            p[0] = m00 * x + m01 * y + m02 * z;
+            p[1] = m11 * y + m12 * z;
+            p[2] = m22 * z;
+        }
+        return;
+    }
+    for ( size_t i( 0 ); i != npositions; ++i )
+    {
+        double * p = xyz + 3*i;
+        const double x = p[0];
+        const double y = p[1];
+        const double z = p[2];
+        p[0] = m00 * x + m01 * y + m02 * z;
+        p[1] = m10 * x + m11 * y + m12 * z;
+        p[2] = m20 * x + m21 * y + m22 * z;
+    }
+}
+
+} // namespace
 
 // ********************************************************************************
 
@@ -80,6 +124,8 @@ alpha_(alpha), beta_(beta), gamma_(gamma)
     a_star_ = a_star_vector_.length();
     b_star_ = b_star_vector_.length();
     c_star_ = c_star_vector_.length();
+    N_matrix_ = SymmetricMatrix3D( a_star_, b_star_, c_star_, 0.0, 0.0, 0.0 );
+    N_inverse_matrix_ = SymmetricMatrix3D( 1.0 / a_star_, 1.0 / b_star_, 1.0 / c_star_, 0.0, 0.0, 0.0 );
     alpha_star_ = arccosine( (b_vector_*c_vector_) / (b*c) );
     beta_star_  = arccosine( (a_vector_*c_vector_) / (a*c) );
     gamma_star_ = arccosine( (a_vector_*b_vector_) / (a*b) );
@@ -212,6 +258,36 @@ Vector3D CrystalLattice::fractional_to_orthogonal( const Vector3D & input ) cons
 
 // ********************************************************************************
 
+void CrystalLattice::orthogonal_to_fractional( double * xyz, const size_t npositions ) const
+{
+    transform_positions( orthogonal_to_fractional_matrix_, xyz, npositions );
+}
+
+// ********************************************************************************
+
+void CrystalLattice::fractional_to_orthogonal( double * xyz, const size_t npositions ) const
+{
+    transform_positions( fractional_to_orthogonal_matrix_, xyz, npositions );
+}
+
+// ********************************************************************************
+
+void CrystalLattice::orthogonal_to_fractional( std::vector< Vector3D > & positions ) const
+{
+    for ( size_t i( 0 ); i != positions.size(); ++i )
+        positions[i] = orthogonal_to_fractional_matrix_ * positions[i];
+}
+
+// ********************************************************************************
+
+void CrystalLattice::fractional_to_orthogonal( std::vector< Vector3D > & positions ) const
+{
+    for ( size_t i( 0 ); i != positions.size(); ++i )
+        positions[i] = fractional_to_orthogonal_matrix_ * positions[i];
+}
+
+// ********************************************************************************
+
 void CrystalLattice::rescale_volume( const double target_volume, size_t Z )
 {
     size_t current_Z(1);
@@ -226,87 +302,102 @@ void CrystalLattice::rescale_volume( const double target_volume, size_t Z )
 // ********************************************************************************
 
 // Finds shortest distance, in Angstrom, between two positions given in fractional coordinates.
-double CrystalLattice::shortest_distance( const Vector3D & lhs, const Vector3D & rhs )
+double CrystalLattice::shortest_distance( const Vector3D & lhs, const Vector3D & rhs ) const
 {
     return sqrt( shortest_distance2( lhs, rhs ) );
 }
 
 // ********************************************************************************
 
-// Finds shortest distance, in Angstrom, between two positions given in fractional coordinates.
-double CrystalLattice::shortest_distance2( const Vector3D & lhs, const Vector3D & rhs )
+double CrystalLattice::shortest_distance2( const Vector3D & lhs, const Vector3D & rhs ) const
 {
-    Vector3D difference_vector = adjust_for_translations( rhs - lhs ); // In fractional coordinates
-    // Now we must find the shortest distance.
-    double shortest_distance2 = fractional_to_orthogonal( difference_vector ).norm2();
-    // "shortest_distance" may now be something like 0.95, which clearly should have been 0.05. Likewise,
-    // with very acute unit-cell angles, it may be necessary to add or subtract +/- 1 (fractional coordinates).
-    bool shortest_distance_changed( false );
-    do
+    Vector3D difference_vector;
+    return minimum_image( rhs - lhs, difference_vector );
+}
+
+// ********************************************************************************
+
+void CrystalLattice::shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & output_distance, Vector3D & output_difference_vector ) const
+{
+    output_distance = sqrt( minimum_image( rhs - lhs, output_difference_vector ) );
+}
+
+// ********************************************************************************
+
+std::vector< double > CrystalLattice::shortest_distances2( const Vector3D & lhs, const std::vector< Vector3D > & rhs ) const
+{
+    std::vector< double > result;
+    result.reserve( rhs.size() );
+    Vector3D difference_vector;
+    for ( size_t i( 0 ); i != rhs.size(); ++i )
+        result.push_back( minimum_image( rhs[i] - lhs, difference_vector ) );
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< double > CrystalLattice::shortest_distances2( const std::vector< Vector3D > & lhs, const std::vector< Vector3D > & rhs ) const
+{
+    if ( lhs.size() != rhs.size() )
+        throw std::runtime_error( "CrystalLattice::shortest_distances2(): lhs and rhs must have the same size." );
+    std::vector< double > result;
+    result.reserve( rhs.size() );
+    Vector3D difference_vector;
+    for ( size_t i( 0 ); i != rhs.size(); ++i )
+        result.push_back( minimum_image( rhs[i] - lhs[i], difference_vector ) );
+    return result;
+}
+
+// ********************************************************************************
+
+double CrystalLattice::minimum_image( const Vector3D & difference_vector, Vector3D & shortest_difference_vector ) const
+{
+    Vector3D adjusted = adjust_for_translations( difference_vector ); // In fractional coordinates, in [0,1>
+    // Round to the nearest image, all fractional coordinates are then in [-0.5,0.5]
+    int nearest[3];
+    double x[3];
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        nearest[i] = ( adjusted.value( i ) > 0.5 ) ? -1 : 0;
+        x[i] = adjusted.value( i ) + nearest[i];
+    }
+    shortest_difference_vector = adjusted + Vector3D( nearest[0], nearest[1], nearest[2] );
+    double shortest_distance2 = fractional_to_orthogonal( shortest_difference_vector ).norm2();
+    // With very acute unit-cell angles, the nearest image in fractional coordinates is not necessarily the shortest.
+    // Fractional coordinate i of a vector r is a*_i . r, so a shorter image x + n must satisfy |x_i + n_i| <= |a*_i| |r|,
+    // which for most distances leaves only n = 0 to check.
+    const double r = sqrt( shortest_distance2 ) * ( 1.0 + 1.0E-9 );
+    const double reciprocal_lengths[3] = { a_star_, b_star_, c_star_ };
+    int lower[3];
+    int upper[3];
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        lower[i] = static_cast< int >( ceil( -reciprocal_lengths[i] * r - x[i] ) );
+        upper[i] = static_cast< int >( floor( reciprocal_lengths[i] * r - x[i] ) );
+    }
+    for ( int i( lower[0] ); i <= upper[0]; ++i )
     {
-        shortest_distance_changed = false;
-        for ( int i( -1 ); i != 2; ++i )
+        for ( int j( lower[1] ); j <= upper[1]; ++j )
         {
-            for ( int j( -1 ); j != 2; ++j )
+            for ( int k( lower[2] ); k <= upper[2]; ++k )
             {
-                for ( int k( -1 ); k != 2; ++k )
+                if ( ( i == 0 ) && ( j == 0 ) && ( k == 0 ) )
+                    continue;
+                Vector3D new_difference_vector = adjusted + Vector3D( nearest[0] + i, nearest[1] + j, nearest[2] + k );
+                double distance2 = fractional_to_orthogonal( new_difference_vector ).norm2();
+                if ( distance2 < shortest_distance2 )
                 {
-                    Vector3D new_difference_vector = difference_vector + Vector3D( i, j, k );
-                    double distance2 = fractional_to_orthogonal( new_difference_vector ).norm2();
-                    if ( distance2 < shortest_distance2 )
-                    {
-                        difference_vector = new_difference_vector;
-                        shortest_distance2 = distance2;
-                        shortest_distance_changed = true;
-                    }
+                    shortest_difference_vector = new_difference_vector;
+                    shortest_distance2 = distance2;
                 }
             }
         }
     }
-    while ( shortest_distance_changed );
     return shortest_distance2;
 }
 
 // ********************************************************************************
 
-// Finds shortest distance, in Angstrom, between two positions given in fractional coordinates.
-// Returns the shortest distance and the shortest difference vector (in fractional coordinates).
-void CrystalLattice::shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & output_distance, Vector3D & output_difference_vector )
-{
-    Vector3D difference_vector = adjust_for_translations( rhs - lhs ); // In fractional coordinates
-    // Now we must find the shortest distance.
-    double shortest_distance = fractional_to_orthogonal( difference_vector ).norm2();
-    // "shortest_distance" may now be something like 0.95, which clearly should have been 0.05. Likewise,
-    // with very acute unit-cell angles, it may be necessary to add or subtract +/- 1 (fractional coordinates).
-    bool shortest_distance_changed( false );
-    do
-    {
-         shortest_distance_changed = false;
-         for ( int i( -1 ); i != 2; ++i )
-         {
-             for ( int j( -1 ); j != 2; ++j )
-             {
-                 for ( int k( -1 ); k != 2; ++k )
-                 {
-                     Vector3D new_difference_vector = difference_vector + Vector3D( i, j, k );
-                     double distance = fractional_to_orthogonal( new_difference_vector ).norm2();
-                     if ( distance < shortest_distance )
-                     {
-                         difference_vector = new_difference_vector;
-                         shortest_distance = distance;
-                         shortest_distance_changed = true;
-                     }
-                 }
-             }
-         }
-    }
-    while ( shortest_distance_changed );
-    output_distance = sqrt( shortest_distance );
-    output_difference_vector = difference_vector;
-}
-
-// ********************************************************************************
-
 void CrystalLattice::transform( const Matrix3D & m )
 {
     // In practice, the elements of the transformation matrix will be integers like 0, -1, 1 and it would be cleaner
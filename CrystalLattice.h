@@ -30,9 +30,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Vector3D.h"
 #include "Matrix3D.h"
+#include "SymmetricMatrix3D.h"
 #include "Angle.h"
 
 #include <string>
+#include <vector>
 
 // a along x, b in xy plane, right-handed coordinate frame
 // We also abuse this class for any functionality related to parallelepipeds
@@ -72,8 +74,14 @@ public:
     Vector3D b_star_vector() const { return b_star_vector_; }
     Vector3D c_star_vector() const { return c_star_vector_; }
     double volume() const { return volume_; }
-    Matrix3D fractional_to_orthogonal_matrix() const { return fractional_to_orthogonal_matrix_; }
-    Matrix3D orthogonal_to_fractional_matrix() const { return orthogonal_to_fractional_matrix_; }
+    const Matrix3D & fractional_to_orthogonal_matrix() const { return fractional_to_orthogonal_matrix_; }
+    const Matrix3D & orthogonal_to_fractional_matrix() const { return orthogonal_to_fractional_matrix_; }
+
+    // N = diag( a*, b*, c* ) and its inverse, converting between U_cif and U_star: U_star = N U_cif N.
+    // Together with A = fractional_to_orthogonal_matrix() (U_cart = A U_star A^T) these are all that is needed
+    // to convert ADPs, so they are calculated once when the lattice is set up.
+    const SymmetricMatrix3D & N_matrix() const { return N_matrix_; }
+    const SymmetricMatrix3D & N_inverse_matrix() const { return N_inverse_matrix_; }
 
     void enclosing_box( Vector3D & min_min_min, Vector3D & max_max_max ) const;
 
@@ -85,6 +93,16 @@ public:
     Vector3D orthogonal_to_fractional( const Vector3D & input ) const;
     Vector3D fractional_to_orthogonal( const Vector3D & input ) const;
 
+    // Batch conversions of npositions positions stored as x0 y0 z0 x1 y1 z1 ..., in place.
+    // Because a is along x and b is in the xy plane, both matrices are normally upper triangular, which is used if possible.
+    // These loops are vectorised, so with -Ofast the results can differ from the single-position versions in the last digit.
+    void orthogonal_to_fractional( double * xyz, const size_t npositions ) const;
+    void fractional_to_orthogonal( double * xyz, const size_t npositions ) const;
+
+    // Batch conversions, in place.
+    void orthogonal_to_fractional( std::vector< Vector3D > & positions ) const;
+    void fractional_to_orthogonal( std::vector< Vector3D > & positions ) const;
+
     // Rescales a, b and c isotropically so that the new unit cell volume becomes
     // equal to the specified target_volume. alpha, beta and gamma are not changed.
     // If Z is specified for the target_volume, tries to guess Z from the current unit-cell volume and
@@ -92,14 +110,20 @@ public:
     void rescale_volume( const double target_volume, size_t Z = 0 );
 
     // Finds shortest distance, in Angstrom, between two positions given in fractional coordinates.
-    double shortest_distance( const Vector3D & lhs, const Vector3D & rhs );
+    double shortest_distance( const Vector3D & lhs, const Vector3D & rhs ) const;
 
     // Finds shortest distance^2, in Angstrom^2, between two positions given in fractional coordinates.
-    double shortest_distance2( const Vector3D & lhs, const Vector3D & rhs );
+    double shortest_distance2( const Vector3D & lhs, const Vector3D & rhs ) const;
 
     // Finds shortest distance, in Angstrom, between two positions given in fractional coordinates.
     // Returns the shortest distance (in Angstrom) and the shortest difference vector (defined as rhs - lhs, in fractional coordinates).
-    void shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & distance, Vector3D & difference_vector );
+    void shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & distance, Vector3D & difference_vector ) const;
+
+    // Shortest distances^2, in Angstrom^2, from lhs to each of the positions in rhs, all in fractional coordinates.
+    std::vector< double > shortest_distances2( const Vector3D & lhs, const std::vector< Vector3D > & rhs ) const;
+
+    // Shortest distances^2, in Angstrom^2, between lhs[i] and rhs[i], all in fractional coordinates.
+    std::vector< double > shortest_distances2( const std::vector< Vector3D > & lhs, const std::vector< Vector3D > & rhs ) const;
 
     enum LatticeSystem { TRICLINIC, MONOCLINIC, ORTHORHOMBIC, TRIGONAL, TETRAGONAL, HEXAGONAL, RHOMBOHEDRAL, CUBIC };
     
@@ -144,7 +168,12 @@ private:
     double volume_;
     Matrix3D fractional_to_orthogonal_matrix_;
     Matrix3D orthogonal_to_fractional_matrix_;
+    SymmetricMatrix3D N_matrix_;
+    SymmetricMatrix3D N_inverse_matrix_;
     LatticeSystem lattice_system_;
+
+    // Returns the shortest distance^2 of all lattice translations of difference_vector (fractional coordinates), and that translation.
+    double minimum_image( const Vector3D & difference_vector, Vector3D & shortest_difference_vector ) const;
 };
 
 // Deduces the lattice system based on the unit-cell parameters.
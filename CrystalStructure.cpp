@@ -26,15 +26,28 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "3DCalculations.h"
+#include "BondGraph.h"
+#include "CellList.h"
 #include "ChemicalFormula.h"
 #include "ConnectivityTable.h"
 #include "CrystalStructure.h"
+#include "Instrumentation.h"
+#include "Logger.h"
 #include "MathFunctions.h"
+#include "ParallelFor.h"
 #include "PhysicalConstants.h"
 #include "RunningAverageAndESD.h"
+#include "ScratchArena.h"
+#include "SymmetryOrbits.h"
 #include "TextFileWriter.h"
 #include "Utilities.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory_resource>
 #include <stdexcept>
 
 #include <iostream>
@@ -47,7 +60,7 @@ CrystalStructure::CrystalStructure(): space_group_symmetry_has_been_applied_(fal
 
 // ********************************************************************************
 
-Atom CrystalStructure::atom( const size_t i ) const
+const Atom & CrystalStructure::atom( const size_t i ) const
 {
     if ( i >= atoms_.size() )
         throw std::runtime_error( "CrystalStructure::atom( size_t ): i >= atoms_.size()" );
@@ -62,6 +75,7 @@ void CrystalStructure::add_atoms( const std::vector< Atom > & atoms )
     atoms_.insert( atoms_.end(), atoms.begin(), atoms.end() );
     for ( size_t i( 0 ); i != atoms.size(); ++i )
         suppressed_.push_back( false );
+    label_index_.invalidate();
     basic_checks();
 }
 
@@ -69,6 +83,8 @@ void CrystalStructure::add_atoms( const std::vector< Atom > & atoms )
 
 void CrystalStructure::set_atom( const size_t i, const Atom & atom )
 {
+    if ( atoms_[i].label() != atom.label() )
+        label_index_.invalidate();
     atoms_[i] = atom;
     basic_checks();
 }
@@ -82,34 +98,65 @@ void CrystalStructure::basic_checks() const
 
 // ********************************************************************************
 
-size_t CrystalStructure::find_label( const std::string & label ) const
+const std::unordered_map< std::string, size_t > & CrystalStructure::label_index() const
 {
-    for ( size_t i( 0 ); i != atoms_.size(); ++i )
+    return label_index_.get( [this]( std::unordered_map< std::string, size_t > & result )
     {
-        if ( atoms_[i].label() == label )
-            return i;
-    }
-    return natoms();
+        result.clear();
+        result.reserve( atoms_.size() );
+        // emplace() does not overwrite, so the first atom with a label wins
+        for ( size_t i( 0 ); i != atoms_.size(); ++i )
+            result.emplace( atoms_[i].label(), i );
+    } );
+}
+
+// ********************************************************************************
+
+size_t CrystalStructure::find_label( const std::string & label ) const
+{
+    const std::unordered_map< std::string, size_t > & index = label_index();
+    std::unordered_map< std::string, size_t >::const_iterator it = index.find( label );
+    return ( it == index.end() ) ? natoms() : it->second;
 }
 
 // ********************************************************************************
 
 size_t CrystalStructure::atom( const std::string & atom_label ) const
 {
-    for ( size_t i( 0 ); i != atoms_.size(); ++i )
-    {
-        if ( atoms_[ i ].label() == atom_label )
-            return i;
-    }
-    throw std::runtime_error( "CrystalStructure::atom( const std::string & label ): label >" + atom_label + "< not found." );
+    const size_t result = find_label( atom_label );
+    if ( result == natoms() )
+        throw std::runtime_error( "CrystalStructure::atom( const std::string & label ): label >" + atom_label + "< not found." );
+    return result;
 }
 
 // ********************************************************************************
 
 void CrystalStructure::make_atom_labels_unique()
 {
+    // All labels in use, including those of atoms that come later and will keep their label
+    std::unordered_map< std::string, size_t > used_labels;
+    used_labels.reserve( atoms_.size() );
+    for ( size_t i( 0 ); i != atoms_.size(); ++i )
+        used_labels.emplace( atoms_[i].label(), i );
+    // The new labels for each element are numbered upwards, so the whole pass is O(N)
+    std::map< Element, size_t > counters;
     for ( size_t i( 0 ); i != atoms_.size(); ++i )
-        atoms_[ i ].set_label( atoms_[ i ].element().symbol() + size_t2string( i ) );
+    {
+        if ( used_labels[ atoms_[i].label() ] == i )
+            continue;
+        size_t & counter = counters[ atoms_[i].element() ];
+        std::string new_label;
+        do
+        {
+            ++counter;
+            new_label = atoms_[i].element().symbol() + size_t2string( counter );
+        } while ( used_labels.find( new_label ) != used_labels.end() );
+        atoms_[i].set_label( new_label );
+        used_labels.emplace( new_label, i );
+    }
+    // All labels are now unique and used_labels is exactly the label index
+    label_index_.value().swap( used_labels );
+    label_index_.set_valid();
 }
 
 // ********************************************************************************
@@ -127,24 +174,23 @@ std::set< Element > CrystalStructure::elements() const
 // Only the asymmetric unit is kept, everything else is deleted.
 void CrystalStructure::reduce_to_asymmetric_unit()
 {
+    const std::vector< size_t > asymmetric_unit = SymmetryOrbits( *this ).asymmetric_unit();
     std::vector< Atom > new_atoms;
-    std::vector< bool > is_duplicate( natoms(), false );
-    for ( size_t i( 0 ); i != natoms(); ++i )
+    std::vector< bool > new_suppressed;
+    new_atoms.reserve( asymmetric_unit.size() );
+    new_suppressed.reserve( asymmetric_unit.size() );
+    for ( size_t i( 0 ); i != asymmetric_unit.size(); ++i )
     {
-        if ( is_duplicate[i] )
-            continue;
-        for ( size_t j( i+1 ); j != natoms(); ++j )
-        {
-            if ( is_duplicate[j] )
-                continue;
-            if ( atom(i).element() != atom(j).element() )
-                continue;
-            if ( shortest_distance2( atom(i).position(), atom(j).position() ) < square( 0.001 ) )
-                is_duplicate[j] = true;
-        }
-        new_atoms.push_back( atom(i) );
+        new_atoms.push_back( atoms_[ asymmetric_unit[i] ] );
+        new_suppressed.push_back( ( asymmetric_unit[i] < suppressed_.size() ) && suppressed_[ asymmetric_unit[i] ] );
     }
-    atoms_ = new_atoms;
+    atoms_.swap( new_atoms );
+    suppressed_.swap( new_suppressed );
+    label_index_.invalidate();
+    // The atom indices have changed
+    bonded_atoms_.clear();
+    molecule_atoms_.clear();
+    molecule_indices_.clear();
     space_group_symmetry_has_been_applied_ = false;
 }
 
@@ -153,36 +199,84 @@ void CrystalStructure::reduce_to_asymmetric_unit()
 void CrystalStructure::apply_space_group_symmetry()
 {
     if ( space_group_symmetry_has_been_applied_ )
-        std::cout << "CrystalStructure::apply_space_group_symmetry(): WARNING: space group has already been applied." << std::endl;
-    std::vector< Atom > atoms;
-    for ( size_t i( 0 ); i != natoms(); ++i )
+        log_warning( "CrystalStructure::apply_space_group_symmetry(): WARNING: space group has already been applied." );
+    const size_t nsymmetry_operators = space_group_.nsymmetry_operators();
+    // The symmetry operators as plain arrays, 9 rotation elements followed by 3 translation elements.
+    std::vector< double > operators( 12 * nsymmetry_operators );
+    for ( size_t j( 0 ); j != nsymmetry_operators; ++j )
     {
-        Vector3D original_position = atom( i ).position();
-        for ( size_t j( 1 ); j != space_group_.nsymmetry_operators(); ++j )
+        const SymmetryOperator & symmetry_operator = space_group_.symmetry_operator( j );
+        for ( size_t k( 0 ); k != 3; ++k )
         {
-            Vector3D new_position = space_group_.symmetry_operator( j ) * original_position;
-            double distance = crystal_lattice_.shortest_distance( original_position, new_position );
+            for ( size_t l( 0 ); l != 3; ++l )
+                operators[ 12*j + 3*k + l ] = symmetry_operator.rotation().value( k, l );
+            operators[ 12*j + 9 + k ] = symmetry_operator.translation().value( k );
+        }
+    }
+    // The distance between lattice planes i is 1/|a*_i|, so a fractional difference d_i (modulo 1, nearest image)
+    // means that the distance is at least |d_i|/|a*_i| for all lattice translations.
+    // Only if that lower bound does not exclude a special position do we need the full shortest_distance().
+    const double special_position_distance = 0.1;
+    const double plane_distances[3] = { 1.0 / crystal_lattice_.a_star(), 1.0 / crystal_lattice_.b_star(), 1.0 / crystal_lattice_.c_star() };
+    std::vector< std::vector< Atom > > new_atoms( natoms() );
+    const size_t original_natoms = natoms();
+    const bool parallel = ( original_natoms * nsymmetry_operators > 100000 );
+    parallel_for( original_natoms, parallel ? 0 : 1, [&]( const size_t i )
+    {
+        const Atom & original_atom = atoms_[i];
+        const Vector3D original_position = original_atom.position();
+        const double x = original_position.x();
+        const double y = original_position.y();
+        const double z = original_position.z();
+        new_atoms[i].reserve( nsymmetry_operators - 1 );
+        for ( size_t j( 1 ); j < nsymmetry_operators; ++j )
+        {
+            const double * R = &operators[ 12*j ];
+            Vector3D new_position( ( R[0] * x + R[1] * y + R[2] * z ) + R[ 9],
+                                   ( R[3] * x + R[4] * y + R[5] * z ) + R[10],
+                                   ( R[6] * x + R[7] * y + R[8] * z ) + R[11] );
             // Is it a special position?
-            if ( distance > 0.1 )
+            bool is_special_position( true );
+            for ( size_t k( 0 ); k != 3; ++k )
             {
-                Atom new_atom = atom( i );
-                new_atom.set_position( new_position );
-                if ( new_atom.ADPs_type() == Atom::ANISOTROPIC )
+                double difference = new_position.value( k ) - original_position.value( k );
+                difference -= floor( difference + 0.5 );
+                if ( std::abs( difference ) * plane_distances[k] > special_position_distance * ( 1.0 + 1.0E-9 ) )
                 {
-                    new_atom.set_anisotropic_displacement_parameters( rotate_adps( new_atom.anisotropic_displacement_parameters(), space_group_.symmetry_operator( j ).rotation(), crystal_lattice_ ) );
+                    is_special_position = false;
+                    break;
                 }
-                atoms.push_back( new_atom );
             }
+            if ( is_special_position )
+                is_special_position = ! ( crystal_lattice_.shortest_distance( original_position, new_position ) > special_position_distance );
+            if ( is_special_position )
+                continue;
+            Atom new_atom = original_atom;
+            new_atom.set_position( new_position );
+            if ( new_atom.ADPs_type() == Atom::ANISOTROPIC )
+            {
+                new_atom.set_anisotropic_displacement_parameters( rotate_adps( new_atom.anisotropic_displacement_parameters(), space_group_.symmetry_operator( j ).rotation(), crystal_lattice_ ) );
+            }
+            new_atoms[i].push_back( new_atom );
         }
-    }
-    add_atoms( atoms );
+    } );
+    size_t nnew_atoms( 0 );
+    for ( size_t i( 0 ); i != new_atoms.size(); ++i )
+        nnew_atoms += new_atoms[i].size();
+    atoms_.reserve( atoms_.size() + nnew_atoms );
+    for ( size_t i( 0 ); i != new_atoms.size(); ++i )
+        atoms_.insert( atoms_.end(), new_atoms[i].begin(), new_atoms[i].end() );
+    suppressed_.resize( atoms_.size(), false );
+    label_index_.invalidate();
+    basic_checks();
     space_group_symmetry_has_been_applied_ = true;
 }
 
 // ********************************************************************************
 
-void CrystalStructure::perceive_molecules()
+void CrystalStructure::perceive_molecules( const bool use_dense_connectivity_table )
 {
+    MACRO_SCOPED_TIMER( "CrystalStructure::perceive_molecules()" );
     // The following two commands are absolutely necessary to avoid a number of difficult complications
     // 1. .cif files saved by Mercury probably have molecules on special positions expanded into full molecules.
     // So we cannot rely on the cif only containing the asymmetric unit, but we cannot rely on the cif containing
@@ -193,37 +287,201 @@ void CrystalStructure::perceive_molecules()
     // The following two commands guarantee that our list of atoms consists of exactly the atoms that fill one unit cell.
     reduce_to_asymmetric_unit();
     apply_space_group_symmetry();
-    ConnectivityTable connectivity_table( natoms() );
+    std::vector< std::pair< size_t, size_t > > bonds;
+    std::vector< Vector3D > positions;
+    std::pmr::vector< Element > elements( scratch_resource() );
+    positions.reserve( natoms() );
+    elements.reserve( natoms() );
+    double maximum_bond_length( 0.0 );
     for ( size_t i( 0 ); i != natoms(); ++i )
     {
-        Atom iAtom = atom( i );
-        for ( size_t j( i+1 ); j != natoms(); ++j )
+        positions.push_back( atoms_[i].position() );
+        elements.push_back( atoms_[i].element() );
+        maximum_bond_length = std::max( maximum_bond_length, elements.back().Van_der_Waals_radius() );
+    }
+    if ( ( natoms() != 0 ) && ( maximum_bond_length > 0.0 ) )
+    {
+        // Only atoms in neighbouring bins can be bonded. The cell list only uses the positions modulo 1,
+        // so it remains valid when atoms are moved by lattice translations below.
+        CellList cell_list( crystal_lattice_, positions, maximum_bond_length );
+        std::vector< size_t > candidates;
+        size_t ndistances( 0 );
+        for ( size_t i( 0 ); i != natoms(); ++i )
         {
-            Atom jAtom = atom( j );                
-            double distance2 = crystal_lattice_.shortest_distance2( iAtom.position(), jAtom.position() );
-            if ( are_bonded( iAtom.element(), jAtom.element(), distance2 ) )
+            cell_list.candidates( i, candidates );
+            for ( size_t k( 0 ); k != candidates.size(); ++k )
             {
-                // Add this one to the connectivity table.
-                connectivity_table.set_value( i, j, 1 );
-                // Move atom j so that it really bonds to atom i
-                double distance;
-                Vector3D difference_vector;
-                crystal_lattice_.shortest_distance( iAtom.position(), jAtom.position(), distance, difference_vector );
-                jAtom.set_position( iAtom.position() + difference_vector );
-                set_atom( j, jAtom );
+                const size_t j = candidates[k];
+                if ( j <= i )
+                    continue;
+                ++ndistances;
+                double distance2 = crystal_lattice_.shortest_distance2( positions[i], positions[j] );
+                if ( are_bonded( elements[i], elements[j], distance2 ) )
+                {
+                    bonds.push_back( std::make_pair( i, j ) );
+                    // Move atom j so that it really bonds to atom i
+                    double distance;
+                    Vector3D difference_vector;
+                    crystal_lattice_.shortest_distance( positions[i], positions[j], distance, difference_vector );
+                    positions[j] = positions[i] + difference_vector;
+                    atoms_[j].set_position( positions[j] );
+                }
             }
         }
+        MACRO_COUNT( "distance evaluations", ndistances );
+        basic_checks();
+    }
+    std::vector< std::vector< size_t > > molecules;
+    if ( use_dense_connectivity_table )
+    {
+        ConnectivityTable connectivity_table( natoms() );
+        for ( size_t i( 0 ); i != bonds.size(); ++i )
+            connectivity_table.set_value( bonds[i].first, bonds[i].second, 1 );
+        molecules = split( connectivity_table );
+    }
+    else
+        molecules = split( BondGraph( natoms(), bonds ) );
+    // Keep the bonds and the molecule membership for update_molecules()
+    bonded_atoms_ = std::vector< SmallVector< size_t, 4 > >( natoms() );
+    for ( size_t i( 0 ); i != bonds.size(); ++i )
+    {
+        bonded_atoms_[ bonds[i].first ].push_back( bonds[i].second );
+        bonded_atoms_[ bonds[i].second ].push_back( bonds[i].first );
     }
-    std::vector< std::vector< size_t > > molecules = split( connectivity_table );
+    molecule_atoms_ = molecules;
+    molecule_indices_ = std::vector< size_t >( natoms() );
     for ( size_t i( 0 ); i != molecules.size(); ++i )
     {
-        MoleculeInCrystal molecule_in_crystal;
         for ( size_t j( 0 ); j != molecules[i].size(); ++j )
+            molecule_indices_[ molecules[i][j] ] = i;
+    }
+}
+
+// ********************************************************************************
+
+void CrystalStructure::update_molecules( const std::vector< size_t > & changed_atoms )
+{
+    const size_t old_natoms = bonded_atoms_.size();
+    if ( old_natoms > natoms() )
+        throw std::runtime_error( "CrystalStructure::update_molecules(): the molecules must have been set by perceive_molecules() and atoms cannot have been removed." );
+    const size_t no_molecule = molecule_atoms_.size() + natoms();
+    bonded_atoms_.resize( natoms() );
+    molecule_indices_.resize( natoms(), no_molecule );
+    // Atoms added since the last update count as changed
+    std::vector< bool > changed( natoms(), false );
+    for ( size_t i( old_natoms ); i != natoms(); ++i )
+        changed[i] = true;
+    for ( size_t i( 0 ); i != changed_atoms.size(); ++i )
+    {
+        if ( changed_atoms[i] >= natoms() )
+            throw std::runtime_error( "CrystalStructure::update_molecules(): atom index out of bounds." );
+        changed[ changed_atoms[i] ] = true;
+    }
+    std::vector< bool > affected_molecules( molecule_atoms_.size(), false );
+    // Remove all bonds of the changed atoms
+    for ( size_t i( 0 ); i != natoms(); ++i )
+    {
+        if ( ! changed[i] )
+            continue;
+        if ( molecule_indices_[i] != no_molecule )
+            affected_molecules[ molecule_indices_[i] ] = true;
+        for ( size_t k( 0 ); k != bonded_atoms_[i].size(); ++k )
+        {
+            SmallVector< size_t, 4 > & partners = bonded_atoms_[ bonded_atoms_[i][k] ];
+            partners.erase( std::remove( partners.begin(), partners.end(), i ), partners.end() );
+            affected_molecules[ molecule_indices_[ bonded_atoms_[i][k] ] ] = true;
+        }
+        bonded_atoms_[i].clear();
+    }
+    // Find the new bonds of the changed atoms
+    std::vector< Vector3D > positions;
+    positions.reserve( natoms() );
+    double maximum_bond_length( 0.0 );
+    for ( size_t i( 0 ); i != natoms(); ++i )
+    {
+        positions.push_back( atoms_[i].position() );
+        maximum_bond_length = std::max( maximum_bond_length, atoms_[i].element().Van_der_Waals_radius() );
+    }
+    if ( maximum_bond_length > 0.0 )
+    {
+        CellList cell_list( crystal_lattice_, positions, maximum_bond_length );
+        std::vector< size_t > candidates;
+        for ( size_t i( 0 ); i != natoms(); ++i )
+        {
+            if ( ! changed[i] )
+                continue;
+            bool moved( false );
+            cell_list.candidates( i, candidates );
+            for ( size_t k( 0 ); k != candidates.size(); ++k )
+            {
+                const size_t j = candidates[k];
+                // Bonds between two changed atoms are found from the atom with the lower index
+                if ( changed[j] && ( j < i ) )
+                    continue;
+                if ( ! are_bonded( atoms_[i].element(), atoms_[j].element(), crystal_lattice_.shortest_distance2( positions[i], positions[j] ) ) )
+                    continue;
+                bonded_atoms_[i].push_back( j );
+                bonded_atoms_[j].push_back( i );
+                if ( molecule_indices_[j] != no_molecule )
+                    affected_molecules[ molecule_indices_[j] ] = true;
+                // Move the changed atom so that it really bonds to the first atom it is bonded to, as in perceive_molecules()
+                if ( ! moved )
+                {
+                    double distance;
+                    Vector3D difference_vector;
+                    crystal_lattice_.shortest_distance( positions[j], positions[i], distance, difference_vector );
+                    positions[i] = positions[j] + difference_vector;
+                    atoms_[i].set_position( positions[i] );
+                    moved = true;
+                }
+            }
+        }
+    }
+    // The atoms whose molecule has to be rebuilt: those in affected molecules and the changed atoms.
+    // Any atom bonded to one of these is itself in an affected molecule.
+    std::vector< bool > to_rebuild( changed );
+    for ( size_t i( 0 ); i != molecule_atoms_.size(); ++i )
+    {
+        if ( ! affected_molecules[i] )
+            continue;
+        for ( size_t j( 0 ); j != molecule_atoms_[i].size(); ++j )
+            to_rebuild[ molecule_atoms_[i][j] ] = true;
+    }
+    // Remove the affected molecules, keep the order of the others
+    std::vector< std::vector< size_t > > molecule_atoms;
+    for ( size_t i( 0 ); i != molecule_atoms_.size(); ++i )
+    {
+        if ( affected_molecules[i] )
+            continue;
+        molecule_atoms.push_back( molecule_atoms_[i] );
+        for ( size_t j( 0 ); j != molecule_atoms_[i].size(); ++j )
+            molecule_indices_[ molecule_atoms_[i][j] ] = molecule_atoms.size() - 1;
+    }
+    // Breadth-first search for the new molecules, added at the end
+    std::vector< bool > done( natoms(), false );
+    for ( size_t i( 0 ); i != natoms(); ++i )
+    {
+        if ( ( ! to_rebuild[i] ) || done[i] )
+            continue;
+        std::vector< size_t > this_molecule( 1, i );
+        done[i] = true;
+        for ( size_t k( 0 ); k != this_molecule.size(); ++k )
         {
-            molecule_in_crystal.add_atom( atom( molecules[i][j] ) );
+            const SmallVector< size_t, 4 > & partners = bonded_atoms_[ this_molecule[k] ];
+            for ( size_t l( 0 ); l != partners.size(); ++l )
+            {
+                if ( done[ partners[l] ] )
+                    continue;
+                done[ partners[l] ] = true;
+                this_molecule.push_back( partners[l] );
+            }
         }
-        molecules_.push_back( molecule_in_crystal );
+        std::sort( this_molecule.begin(), this_molecule.end() );
+        for ( size_t j( 0 ); j != this_molecule.size(); ++j )
+            molecule_indices_[ this_molecule[j] ] = molecule_atoms.size();
+        molecule_atoms.push_back( this_molecule );
     }
+    molecule_atoms_.swap( molecule_atoms );
 }
 
 // ********************************************************************************
@@ -231,46 +489,128 @@ void CrystalStructure::perceive_molecules()
 // @@ This requires that you run the molecule preception method first
 void CrystalStructure::remove_symmetry_related_molecules()
 {
+    if ( molecule_indices_.size() != natoms() )
+        throw std::runtime_error( "CrystalStructure::remove_symmetry_related_molecules(): perceive_molecules() must be called first." );
+    const SymmetryOrbits symmetry_orbits( *this );
+    // Keep the first molecule of each molecular orbit
+    std::vector< size_t > new_atom_indices( natoms(), natoms() );
+    std::vector< Atom > new_atoms;
+    std::vector< bool > new_suppressed;
+    std::vector< std::vector< size_t > > new_molecule_atoms;
+    for ( size_t m( 0 ); m != molecule_atoms_.size(); ++m )
+    {
+        if ( symmetry_orbits.molecule_orbit( m ) != new_molecule_atoms.size() )
+            continue;
+        new_molecule_atoms.push_back( std::vector< size_t >() );
+        for ( size_t j( 0 ); j != molecule_atoms_[m].size(); ++j )
+        {
+            const size_t i = molecule_atoms_[m][j];
+            new_atom_indices[i] = new_atoms.size();
+            new_molecule_atoms.back().push_back( new_atoms.size() );
+            new_atoms.push_back( atoms_[i] );
+            new_suppressed.push_back( ( i < suppressed_.size() ) && suppressed_[i] );
+        }
+    }
+    std::vector< SmallVector< size_t, 4 > > new_bonded_atoms( new_atoms.size() );
+    std::vector< size_t > new_molecule_indices( new_atoms.size() );
+    for ( size_t i( 0 ); i != natoms(); ++i )
+    {
+        if ( new_atom_indices[i] == natoms() )
+            continue;
+        for ( size_t k( 0 ); k != bonded_atoms_[i].size(); ++k )
+            new_bonded_atoms[ new_atom_indices[i] ].push_back( new_atom_indices[ bonded_atoms_[i][k] ] );
+    }
+    for ( size_t m( 0 ); m != new_molecule_atoms.size(); ++m )
+    {
+        for ( size_t j( 0 ); j != new_molecule_atoms[m].size(); ++j )
+            new_molecule_indices[ new_molecule_atoms[m][j] ] = m;
+    }
+    atoms_.swap( new_atoms );
+    suppressed_.swap( new_suppressed );
+    label_index_.invalidate();
+    molecule_atoms_.swap( new_molecule_atoms );
+    bonded_atoms_.swap( new_bonded_atoms );
+    molecule_indices_.swap( new_molecule_indices );
+    space_group_symmetry_has_been_applied_ = false;
 }
 
 // ********************************************************************************
 
-// This returns a copy, so would copy all atoms.
 MoleculeInCrystal CrystalStructure::molecule_in_crystal( const size_t i ) const
 {
-    if ( i >= molecules_.size() )
-        throw std::runtime_error( "CrystalStructure::molecule_in_crystal(): i >= molecules_.size()." );
-    return molecules_[i];
+    if ( i >= molecule_atoms_.size() )
+        throw std::runtime_error( "CrystalStructure::molecule_in_crystal(): i >= nmolecules()." );
+    return MoleculeInCrystal( atoms_.data(), molecule_atoms_[i].data(), molecule_atoms_[i].size() );
 }
 
 // ********************************************************************************
 
 bool CrystalStructure::molecule_is_on_special_position( const size_t i ) const
 {
-    throw std::runtime_error( "CrystalStructure::molecule_is_on_special_position(): not yet implemented." );
+    if ( i >= molecule_atoms_.size() )
+        throw std::runtime_error( "CrystalStructure::molecule_is_on_special_position(): i >= nmolecules()." );
+    // As in SymmetryOrbits: an atom within special_position_tolerance of its own image is its own image,
+    // otherwise the image must be within tolerance of an atom of the same element.
+    const double tolerance2 = square( 0.001 );
+    const double special_position_tolerance2 = square( 0.1 );
+    const std::vector< size_t > & molecule_atoms = molecule_atoms_[i];
+    size_t stabiliser_order( 0 );
+    for ( size_t j( 0 ); j != space_group_.nsymmetry_operators(); ++j )
+    {
+        const SymmetryOperator & symmetry_operator = space_group_.symmetry_operator( j );
+        bool maps_onto_itself( true );
+        for ( size_t k( 0 ); maps_onto_itself && ( k != molecule_atoms.size() ); ++k )
+        {
+            const Atom & atom = atoms_[ molecule_atoms[k] ];
+            const Vector3D image_position = symmetry_operator * atom.position();
+            if ( crystal_lattice_.shortest_distance2( atom.position(), image_position ) < special_position_tolerance2 )
+                continue;
+            maps_onto_itself = false;
+            for ( size_t l( 0 ); l != molecule_atoms.size(); ++l )
+            {
+                const Atom & candidate = atoms_[ molecule_atoms[l] ];
+                if ( ( candidate.element() == atom.element() ) && ( crystal_lattice_.shortest_distance2( image_position, candidate.position() ) < tolerance2 ) )
+                {
+                    maps_onto_itself = true;
+                    break;
+                }
+            }
+        }
+        if ( maps_onto_itself )
+            ++stabiliser_order;
+    }
+    return stabiliser_order > 1;
+}
+
+// ********************************************************************************
+
+double CrystalStructure::Z_prime() const
+{
+    if ( molecule_atoms_.empty() )
+        throw std::runtime_error( "CrystalStructure::Z_prime(): perceive_molecules() must be called first." );
+    return SymmetryOrbits( *this ).Z_prime();
 }
 
 // ********************************************************************************
 
 Vector3D CrystalStructure::molecular_centre_of_mass( const size_t i ) const
 {
+    const std::vector< size_t > & molecule_atoms = molecule_atoms_[i];
     Vector3D result;
-    for ( size_t j( 0 ); j != molecules_[i].natoms(); ++j )
-    {
-        result += molecules_[i].atom( j ).position();
-    }
-    return result / molecules_[i].natoms();
+    for ( size_t j( 0 ); j != molecule_atoms.size(); ++j )
+        result += atoms_[ molecule_atoms[j] ].position();
+    return result / molecule_atoms.size();
 }
 
 // ********************************************************************************
 
 void CrystalStructure::move_molecule( const size_t i, const Vector3D shift )
 {
-    for ( size_t j( 0 ); j != molecules_[i].natoms(); ++j )
+    const std::vector< size_t > & molecule_atoms = molecule_atoms_[i];
+    for ( size_t j( 0 ); j != molecule_atoms.size(); ++j )
     {
-        Atom new_atom( molecules_[i].atom( j ) );
-        new_atom.set_position( new_atom.position() + shift );
-        molecules_[i].set_atom( j, new_atom );
+        Atom & atom = atoms_[ molecule_atoms[j] ];
+        atom.set_position( atom.position() + shift );
     }
 }
 
@@ -289,33 +629,44 @@ void CrystalStructure::supercell( const size_t u, const size_t v, const size_t w
         throw std::runtime_error( "CrystalStructure::superstructure( u, v, w ): u, v, w cannot be 0." );
     if ( ! space_group_symmetry_has_been_applied() )
         apply_space_group_symmetry();
-    CrystalStructure result;
-    result.set_space_group( SpaceGroup() );
-    result.set_name( name() );
+    const size_t natoms_per_unit_cell = natoms();
+    const size_t nunit_cells = u * v * w;
     CrystalLattice new_crystal_lattice( crystal_lattice_.a() * u, crystal_lattice_.b() * v, crystal_lattice_.c() * w, crystal_lattice_.alpha(), crystal_lattice_.beta(), crystal_lattice_.gamma() );
-    result.set_crystal_lattice( new_crystal_lattice );
-    result.reserve_natoms( natoms() * u * v * w );
-    for ( size_t i( 0 ); i != u; ++i )
+    const Matrix3D fractional_to_orthogonal_matrix = crystal_lattice_.fractional_to_orthogonal_matrix();
+    // The copies are made in place. The atoms of unit cell (0,0,0) are the originals, so the unit cells are
+    // filled from the last to the first and the originals are overwritten last.
+    atoms_.reserve( natoms_per_unit_cell * nunit_cells );
+    for ( size_t n( 1 ); n != nunit_cells; ++n )
+    {
+        for ( size_t l( 0 ); l != natoms_per_unit_cell; ++l )
+            atoms_.push_back( atoms_[l] );
+    }
+    for ( size_t n( nunit_cells ); n != 0; --n )
     {
-        for ( size_t j( 0 ); j != v; ++j )
+        const size_t i = ( n - 1 ) / ( v * w );
+        const size_t j = ( ( n - 1 ) / w ) % v;
+        const size_t k = ( n - 1 ) % w;
+        const Vector3D translation = i * crystal_lattice_.a_vector() + j * crystal_lattice_.b_vector() + k * crystal_lattice_.c_vector();
+        const std::string label_suffix = "_" + size_t2string( i ) + "_" + size_t2string( j ) + "_" + size_t2string( k );
+        for ( size_t l( 0 ); l != natoms_per_unit_cell; ++l )
         {
-            for ( size_t k( 0 ); k != w; ++k )
-            {
-                for ( size_t l( 0 ); l != natoms(); ++l )
-                {
-                    Atom new_atom( atoms_[l] );
-                    Vector3D new_position = atoms_[l].position(); // Fractional coordinates in the old unit cell
-                    new_position = crystal_lattice_.fractional_to_orthogonal_matrix() * new_position; // Orthogonal coordinates (independent of unit cell)
-                    new_position += i * crystal_lattice_.a_vector() + j * crystal_lattice_.b_vector() + k * crystal_lattice_.c_vector();
-                    new_position = new_crystal_lattice.orthogonal_to_fractional( new_position ); // Fractional coordinates in the new unit cell
-                    new_atom.set_position( new_position );
-                    new_atom.set_label( atoms_[l].label() + "_" + size_t2string( i ) + "_" + size_t2string( j ) + "_" + size_t2string( k ) );
-                    result.add_atom( new_atom );
-                }
-            }
+            Vector3D new_position = atoms_[l].position(); // Fractional coordinates in the old unit cell
+            new_position = fractional_to_orthogonal_matrix * new_position; // Orthogonal coordinates (independent of unit cell)
+            new_position += translation;
+            new_position = new_crystal_lattice.orthogonal_to_fractional( new_position ); // Fractional coordinates in the new unit cell
+            Atom & new_atom = atoms_[ ( n - 1 ) * natoms_per_unit_cell + l ];
+            new_atom.set_position( new_position );
+            new_atom.set_label( new_atom.label() + label_suffix );
         }
     }
-    *this = result;
+    space_group_ = SpaceGroup();
+    crystal_lattice_ = new_crystal_lattice;
+    label_index_.invalidate();
+    bonded_atoms_.clear();
+    molecule_atoms_.clear();
+    molecule_indices_.clear();
+    suppressed_.assign( atoms_.size(), false );
+    space_group_symmetry_has_been_applied_ = false;
 }
 
 // ********************************************************************************
@@ -323,7 +674,7 @@ void CrystalStructure::supercell( const size_t u, const size_t v, const size_t w
 void CrystalStructure::transform( const Matrix3D & transformation_matrix )
 {
     if ( ! nearly_equal( transformation_matrix.determinant(), 1.0 ) )
-        std::cout << "Warning: CrystalStructure::transform(): the determinant of the transformation matrix is not 1." << std::endl;
+        log_warning( "Warning: CrystalStructure::transform(): the determinant of the transformation matrix is not 1." );
     std::vector< Atom > new_atoms;
     new_atoms.reserve( atoms_.size() );
     Matrix3D transformation_matrix_inverse_transpose( transformation_matrix );
@@ -417,7 +768,7 @@ double CrystalStructure::dipole_moment() const
     }
     centre_of_mass_negative_charge = -1.0*centre_of_mass_negative_charge;
     if ( natoms_zero_charge != 0 )
-        std::cout <<  "CrystalStructure::dipole_moment(): Warning: " + size_t2string( natoms_zero_charge ) + " atoms have a charge equal 0.0." << std::endl;
+        log_warning( "CrystalStructure::dipole_moment(): Warning: " + size_t2string( natoms_zero_charge ) + " atoms have a charge equal 0.0." );
     std::cout <<  "CrystalStructure::dipole_moment(): centre_of_mass_negative_charge: " << crystal_lattice_.orthogonal_to_fractional( centre_of_mass_negative_charge ) << std::endl;
     std::cout <<  "CrystalStructure::dipole_moment(): centre_of_mass_negative_charge: " << crystal_lattice_.orthogonal_to_fractional( centre_of_mass_negative_charge ) << std::endl;
     std::cout <<  "dipole moment: " << result << std::endl;
@@ -429,16 +780,14 @@ double CrystalStructure::dipole_moment() const
 double CrystalStructure::density() const
 {
     if ( ! space_group_symmetry_has_been_applied() )
-        std::cout << "CrystalStructure::density(): WARNING: space-group symmetry has not been applied, result will be nonsensical." << std::endl;
-    ChemicalFormula chemical_formula;
-    for ( size_t i( 0 ); i != atoms_.size(); ++i )
-        chemical_formula.add_element( atoms_[ i ].element() );
+        log_warning( "CrystalStructure::density(): WARNING: space-group symmetry has not been applied, result will be nonsensical." );
+    const ChemicalFormula chemical_formula( *this );
     return ( chemical_formula.molecular_weight() / crystal_lattice_.volume() ) / ( Avogadros_constant / 1.0E24 );
 }
 
 // ********************************************************************************
 
-void CrystalStructure::shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & shortest_distance, Vector3D & shortest_difference_vector )
+void CrystalStructure::shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & shortest_distance, Vector3D & shortest_difference_vector ) const
 {
     crystal_lattice_.shortest_distance( lhs, rhs, shortest_distance, shortest_difference_vector );
     // Loop over symmetry operators.
@@ -460,7 +809,7 @@ void CrystalStructure::shortest_distance( const Vector3D & lhs, const Vector3D &
 
 // ********************************************************************************
 
-void CrystalStructure::second_shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & second_shortest_distance, Vector3D & second_shortest_difference_vector )
+void CrystalStructure::second_shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & second_shortest_distance, Vector3D & second_shortest_difference_vector ) const
 {
     double shortest_distance;
     crystal_lattice_.shortest_distance( lhs, rhs, shortest_distance, second_shortest_difference_vector );
@@ -499,7 +848,7 @@ void CrystalStructure::second_shortest_distance( const Vector3D & lhs, const Vec
 
 // Finds shortest distance squared, in Angstrom squared, between two positions given in fractional coordinates.
 // All space-group symmetry operators are taken into account; if this is undesired, use CrystalLattice::shortest_distance2().
-double CrystalStructure::shortest_distance2( const Vector3D & lhs, const Vector3D & rhs )
+double CrystalStructure::shortest_distance2( const Vector3D & lhs, const Vector3D & rhs ) const
 {
     double shortest_distance2 = crystal_lattice_.shortest_distance2( lhs, rhs );
     // Loop over symmetry operators.
@@ -592,10 +941,10 @@ void CrystalStructure::collapse_supercell( const size_t u, const size_t v, const
                                     crystal_lattice_.beta(),
                                     crystal_lattice_.gamma() );
     crystal_lattice_ = crystal_lattice;
-    // Average the atomic coordinates.
-    std::vector< Atom > new_atoms;
+    // Average the atomic coordinates. The averaged atoms are stored in place: atom i is averaged after all atoms before it
+    // have been used, so writing to position nnew_atoms <= i is safe.
+    size_t nnew_atoms( 0 );
     size_t multiplicity = u * v * w;
-    new_atoms.reserve( atoms_.size() / multiplicity );
     std::vector< bool > done( atoms_.size(), false );
     for ( size_t i( 0 ); i != atoms_.size(); ++i )
     {
@@ -615,17 +964,20 @@ void CrystalStructure::collapse_supercell( const size_t u, const size_t v, const
             if ( distance < 0.3 )
             {
                 if ( atoms_[ i ].element() != atoms_[ j ].element() )
-                    std::cout << "CrystalStructure::collapse_supercell( ): Warning: the atoms to be averaged have different elements." << std::endl;
+                    log_warning( "CrystalStructure::collapse_supercell( ): Warning: the atoms to be averaged have different elements." );
                 ++natoms_for_average;
                 average_position.add_value( average_position.average() + difference_vector );
                 done[ j ] = true;
             }
         }
         if ( natoms_for_average != multiplicity )
-            std::cout << "CrystalStructure::collapse_supercell( ): Warning: the number of averaged atoms (" + size_t2string(natoms_for_average) + ") is not equal to the multiplicity (" + size_t2string(multiplicity) + ")." << std::endl;
-        new_atoms.push_back( Atom( atoms_[ i ].element(), average_position.average(), atoms_[ i ].label() ) );
+            log_warning( "CrystalStructure::collapse_supercell( ): Warning: the number of averaged atoms (" + size_t2string(natoms_for_average) + ") is not equal to the multiplicity (" + size_t2string(multiplicity) + ")." );
+        atoms_[ nnew_atoms ] = Atom( atoms_[ i ].element(), average_position.average(), atoms_[ i ].label() );
+        ++nnew_atoms;
     }
-    atoms_ = new_atoms;
+    atoms_.erase( atoms_.begin() + nnew_atoms, atoms_.end() );
+    suppressed_.resize( nnew_atoms );
+    label_index_.invalidate();
 }
 
 // ********************************************************************************
@@ -665,8 +1017,7 @@ void CrystalStructure::collapse_supercell( const size_t u, const size_t v, const
     // Average the atomic coordinates
     size_t multiplicity = u * v * w;
     size_t natoms_per_unit_cell = atoms_.size() / multiplicity;
-    std::vector< Atom > new_atoms;
-    new_atoms.reserve( natoms_per_unit_cell );
+    // The averaged atoms are stored in place, atom i is only overwritten after all its copies (which all come after it) have been averaged.
     for ( size_t i( 0 ); i != natoms_per_unit_cell; ++i )
     {
         RunningAverageAndESD< Vector3D > average_position;
@@ -682,11 +1033,13 @@ void CrystalStructure::collapse_supercell( const size_t u, const size_t v, const
             jatom_position = Vector3D( jatom_position.x() - i_u, jatom_position.y() - i_v, jatom_position.z() - i_w );
             average_position.add_value( jatom_position );
             if ( atoms_[ i ].element() != atoms_[ jatom ].element() )
-                std::cout << "CrystalStructure::collapse_supercell( ): Warning: the atoms to be averaged have different elements." << std::endl;
+                log_warning( "CrystalStructure::collapse_supercell( ): Warning: the atoms to be averaged have different elements." );
         }
-        new_atoms.push_back( Atom( atoms_[ i ].element(), average_position.average(), atoms_[ i ].label() ) );
+        atoms_[ i ] = Atom( atoms_[ i ].element(), average_position.average(), atoms_[ i ].label() );
     }
-    atoms_ = new_atoms;
+    atoms_.erase( atoms_.begin() + natoms_per_unit_cell, atoms_.end() );
+    suppressed_.resize( natoms_per_unit_cell );
+    label_index_.invalidate();
 }
 
 // ********************************************************************************
@@ -702,25 +1055,62 @@ void CrystalStructure::collapse_supercell( const size_t u,
                                            Vector3D & actual_centre,
                                            std::vector< std::vector< Vector3D > > & positions )
 {
+    std::vector< Vector3D > flat_positions;
+    collapse_supercell( u, v, w, drift_correction, target_centre, transformation, actual_centre, flat_positions );
+    const size_t multiplicity = u * v * w * space_group_.nsymmetry_operators();
     positions.clear();
+    positions.reserve( flat_positions.size() / multiplicity );
+    for ( size_t i( 0 ); i != flat_positions.size() / multiplicity; ++i )
+        positions.push_back( std::vector< Vector3D >( flat_positions.begin() + i * multiplicity, flat_positions.begin() + ( i + 1 ) * multiplicity ) );
+}
+
+// ********************************************************************************
+
+void CrystalStructure::collapse_supercell( const size_t u,
+                                           const size_t v,
+                                           const size_t w,
+                                           const int drift_correction,
+                                           const Vector3D & target_centre,
+                                           Matrix3D & transformation,
+                                           Vector3D & actual_centre,
+                                           std::vector< Vector3D > & positions )
+{
+    collapse_supercell( u, v, w, drift_correction, target_centre, std::vector< size_t >(), transformation, actual_centre, positions );
+}
+
+// ********************************************************************************
+
+void CrystalStructure::collapse_supercell( const size_t u,
+                                           const size_t v,
+                                           const size_t w,
+                                           const int drift_correction,
+                                           const Vector3D & target_centre,
+                                           const std::vector< size_t > & reference_atoms,
+                                           Matrix3D & transformation,
+                                           Vector3D & actual_centre,
+                                           std::vector< Vector3D > & positions )
+{
     // The following loop is necessary but screws up the current crystal structure;
     // this method should essentially be const...
     // Correct for drift.
     actual_centre = Vector3D();
-    for ( size_t i( 0 ); i != atoms_.size(); ++i )
-        actual_centre += atoms_[ i ].position();
-    actual_centre /= atoms_.size();
-    if ( drift_correction != 0 )
+    if ( reference_atoms.empty() )
     {
         for ( size_t i( 0 ); i != atoms_.size(); ++i )
-        {
-            Vector3D position = atoms_[ i ].position() - actual_centre + target_centre;
-            atoms_[ i ].set_position( position );
-        }
+            actual_centre += atoms_[ i ].position();
+        actual_centre /= atoms_.size();
+    }
+    else
+    {
+        for ( size_t i( 0 ); i != reference_atoms.size(); ++i )
+            actual_centre += atoms_[ reference_atoms[i] ].position();
+        actual_centre /= reference_atoms.size();
     }
     for ( size_t i( 0 ); i != atoms_.size(); ++i )
     {
         Vector3D position = atoms_[ i ].position();
+        if ( drift_correction != 0 )
+            position = position - actual_centre + target_centre;
         position.set_x( u * position.x() );
         position.set_y( v * position.y() );
         position.set_z( w * position.z() );
@@ -735,21 +1125,21 @@ void CrystalStructure::collapse_supercell( const size_t u,
     crystal_lattice_ = crystal_lattice;
     size_t multiplicity = u * v * w * space_group_.nsymmetry_operators();
     size_t natoms_per_asymmetric_unit = atoms_.size() / multiplicity;
-    positions.reserve( natoms_per_asymmetric_unit );
+    // resize() does not reallocate if the buffer is reused for a frame of the same size
+    positions.resize( natoms_per_asymmetric_unit * multiplicity );
     size_t ndistances_gt_5( 0 );
     for ( size_t i( 0 ); i != natoms_per_asymmetric_unit; ++i )
     {
         Vector3D iatom_position( atoms_[ i ].position() );
-        std::vector< Vector3D > positions_2;
-        positions_2.push_back( iatom_position );
+        positions[ i * multiplicity ] = iatom_position;
         for ( size_t j( 1 ); j != multiplicity; ++j )
         {
             size_t jatom = natoms_per_asymmetric_unit * j + i;
             if ( atoms_[ i ].element() != atoms_[ jatom ].element() )
-                    std::cout << "CrystalStructure::collapse_supercell( ): Warning: the atoms to be averaged have different elements." << std::endl;
+                    log_warning( "CrystalStructure::collapse_supercell( ): Warning: the atoms to be averaged have different elements." );
             double smallest_norm2 = 10000000.0;
             Vector3D smallest_norm2_position;
-            for ( size_t k( 0 ); k != space_group_.nsymmetry_operators(); ++k ) // SpaceGroup::symmetry_operator( i ) returns a copy, so this is extremely wasteful.
+            for ( size_t k( 0 ); k != space_group_.nsymmetry_operators(); ++k )
             {
                 Vector3D jatom_position = space_group_.symmetry_operator( k ) * atoms_[ jatom ].position();
                 // Determine u, v and w for x, y and z.
@@ -770,9 +1160,8 @@ void CrystalStructure::collapse_supercell( const size_t u,
                 ++ndistances_gt_5;
             if ( smallest_norm2 == 10000000.0 )
                     std::cout << "Oops..." << std::endl;
-            positions_2.push_back( smallest_norm2_position );
+            positions[ i * multiplicity + j ] = smallest_norm2_position;
         }
-        positions.push_back( positions_2 );
     }
     if ( ndistances_gt_5 > 0 )
         std::cout << "Number of distances > 5.0 A = " << size_t2string( ndistances_gt_5 ) << std::endl;
@@ -801,15 +1190,20 @@ void CrystalStructure::save_xyz( const FileName & file_name ) const
         text_file_writer.write_line( "Comment" );
     else
         text_file_writer.write_line( name_ );
+    std::string line;
     for ( size_t i( 0 ); i != atoms_.size(); ++i )
     {
         if ( suppressed_[i] )
             continue;
         Vector3D position = crystal_lattice_.fractional_to_orthogonal( atoms_[ i ].position() );
-        text_file_writer.write_line( atoms_[ i ].element().symbol() + " " +
-                                     double2string( position.x() ) + " " +
-                                     double2string( position.y() ) + " " +
-                                     double2string( position.z() ) );
+        line = atoms_[ i ].element().symbol();
+        line += ' ';
+        append_double( line, position.x() );
+        line += ' ';
+        append_double( line, position.y() );
+        line += ' ';
+        append_double( line, position.z() );
+        text_file_writer.write_line( line );
     }
 }
 
@@ -878,31 +1272,42 @@ void CrystalStructure::save_cif( const FileName & file_name ) const
         ++len;
         current_size = 10 * current_size + 9;
     }
+    // One line buffer is reused for all atoms
+    std::string line;
     for ( size_t i( 0 ); i != atoms_.size(); ++i )
     {
         if ( suppressed_[i] )
             continue;
-        std::string label;
         if ( atoms_[i].label().empty() )
-            label = atoms_[i].element().symbol() + size_t2string( i + 1, len, '0' );
+        {
+            line = atoms_[i].element().symbol();
+            append_size_t( line, i + 1, len, '0' );
+        }
         else
-            label = atoms_[i].label();
-        text_file_writer.write( label + " " +
-                                     atoms_[i].element().symbol() + " " +
-                                     double2string_pad_plus( atoms_[ i ].position().x(), 5, ' ' ) + " " +
-                                     double2string_pad_plus( atoms_[ i ].position().y(), 5, ' ' ) + " " +
-                                     double2string_pad_plus( atoms_[ i ].position().z(), 5, ' ' ) + " " +
-                                     double2string_2( atoms_[ i ].occupancy(), 4 ) );
+            line = atoms_[i].label();
+        line += ' ';
+        line += atoms_[i].element().symbol();
+        line += ' ';
+        append_double_pad_plus( line, atoms_[ i ].position().x(), 5, ' ' );
+        line += ' ';
+        append_double_pad_plus( line, atoms_[ i ].position().y(), 5, ' ' );
+        line += ' ';
+        append_double_pad_plus( line, atoms_[ i ].position().z(), 5, ' ' );
+        line += ' ';
+        append_double( line, atoms_[ i ].occupancy(), 4 );
         if ( at_least_one_atom_has_isotropic_ADPs )
-            text_file_writer.write( " " + double2string( atoms_[i].Uiso() ) );
+        {
+            line += ' ';
+            append_double( line, atoms_[i].Uiso() );
+        }
         if ( at_least_one_atom_has_anisotropic_ADPs )
         {
             if ( atoms_[i].ADPs_type() == Atom::ANISOTROPIC )
-                text_file_writer.write( " Uani" );
+                line += " Uani";
             else
-                text_file_writer.write( " Uiso" );
+                line += " Uiso";
         }
-        text_file_writer.write_line();
+        text_file_writer.write_line( line );
     }
     if ( at_least_one_atom_has_anisotropic_ADPs )
     {
@@ -920,19 +1325,27 @@ void CrystalStructure::save_cif( const FileName & file_name ) const
                 continue;
             if ( atoms_[i].ADPs_type() == Atom::ANISOTROPIC )
             {
-                std::string label;
                 if ( atoms_[i].label().empty() )
-                    label = atoms_[i].element().symbol() + size_t2string( i + 1, len, '0' );
+                {
+                    line = atoms_[i].element().symbol();
+                    append_size_t( line, i + 1, len, '0' );
+                }
                 else
-                    label = atoms_[i].label();
+                    line = atoms_[i].label();
                 SymmetricMatrix3D Ucif = atoms_[i].anisotropic_displacement_parameters().U_cif( crystal_lattice_ );
-                text_file_writer.write_line( label + " " +
-                                             double2string( Ucif.value( 0, 0 ) ) + " " +
-                                             double2string( Ucif.value( 1, 1 ) ) + " " +
-                                             double2string( Ucif.value( 2, 2 ) ) + " " +
-                                             double2string( Ucif.value( 0, 1 ) ) + " " +
-                                             double2string( Ucif.value( 0, 2 ) ) + " " +
-                                             double2string( Ucif.value( 1, 2 ) ) );
+                line += ' ';
+                append_double( line, Ucif.value( 0, 0 ) );
+                line += ' ';
+                append_double( line, Ucif.value( 1, 1 ) );
+                line += ' ';
+                append_double( line, Ucif.value( 2, 2 ) );
+                line += ' ';
+                append_double( line, Ucif.value( 0, 1 ) );
+                line += ' ';
+                append_double( line, Ucif.value( 0, 2 ) );
+                line += ' ';
+                append_double( line, Ucif.value( 1, 2 ) );
+                text_file_writer.write_line( line );
             }
         }
     }
@@ -941,6 +1354,312 @@ void CrystalStructure::save_cif( const FileName & file_name ) const
 
 // ********************************************************************************
 
+namespace
+{
+
+const char binary_magic[8] = { 'C', 'S', 'B', 'I', 'N', 'A', 'R', 'Y' };
+const unsigned int binary_version = 2;
+const unsigned int binary_byte_order = 0x01020304; // Written in native byte order, so a snapshot from a machine with a different byte order is rejected
+
+// Appends plain values in native byte order to a buffer
+class BinaryWriter
+{
+public:
+    template< class T >
+    void write( const T & value ) { buffer_.append( reinterpret_cast< const char * >( &value ), sizeof( T ) ); }
+    void write_size_t( const size_t value ) { write( static_cast< unsigned long long >( value ) ); }
+    void write_string( const std::string & value ) { write_size_t( value.length() ); buffer_.append( value ); }
+    template< class Container >
+    void write_indices( const Container & values )
+    {
+        write_size_t( values.size() );
+        for ( size_t i( 0 ); i != values.size(); ++i )
+            write_size_t( values[i] );
+    }
+    const std::string & buffer() const { return buffer_; }
+
+private:
+    std::string buffer_;
+};
+
+// Reads the values written by BinaryWriter, throws if the buffer is too short
+class BinaryReader
+{
+public:
+    explicit BinaryReader( const std::vector< char > & buffer ): current_( buffer.empty() ? 0 : &buffer[0] ), end_( current_ + buffer.size() ) {}
+    template< class T >
+    void read( T & value )
+    {
+        check( sizeof( T ) );
+        std::memcpy( &value, current_, sizeof( T ) );
+        current_ += sizeof( T );
+    }
+    size_t read_size_t() { unsigned long long value; read( value ); return static_cast< size_t >( value ); }
+    double read_double() { double value; read( value ); return value; }
+    std::string read_string()
+    {
+        const size_t length = read_size_t();
+        check( length );
+        std::string result( current_, current_ + length );
+        current_ += length;
+        return result;
+    }
+    template< class Container = std::vector< size_t > >
+    Container read_indices()
+    {
+        Container result( read_size_t() );
+        for ( size_t i( 0 ); i != result.size(); ++i )
+            result[i] = read_size_t();
+        return result;
+    }
+    bool at_end() const { return current_ == end_; }
+
+private:
+    const char * current_;
+    const char * end_;
+
+    void check( const size_t nbytes ) const
+    {
+        if ( static_cast< size_t >( end_ - current_ ) < nbytes )
+            throw std::runtime_error( "CrystalStructure::read_binary(): file is truncated." );
+    }
+};
+
+// The atoms are stored as a structure of arrays, the elements as indices into a table of symbols
+void write_atoms( BinaryWriter & writer, const std::vector< Atom > & atoms )
+{
+    std::vector< Element > elements;
+    std::vector< size_t > element_indices( atoms.size() );
+    for ( size_t i( 0 ); i != atoms.size(); ++i )
+    {
+        size_t j( 0 );
+        while ( ( j != elements.size() ) && ( elements[j] != atoms[i].element() ) )
+            ++j;
+        if ( j == elements.size() )
+            elements.push_back( atoms[i].element() );
+        element_indices[i] = j;
+    }
+    writer.write_size_t( atoms.size() );
+    writer.write_size_t( elements.size() );
+    for ( size_t i( 0 ); i != elements.size(); ++i )
+        writer.write_string( elements[i].symbol() );
+    for ( size_t i( 0 ); i != atoms.size(); ++i )
+        writer.write_size_t( element_indices[i] );
+    for ( size_t i( 0 ); i != atoms.size(); ++i )
+    {
+        writer.write( atoms[i].position().x() );
+        writer.write( atoms[i].position().y() );
+        writer.write( atoms[i].position().z() );
+    }
+    for ( size_t i( 0 ); i != atoms.size(); ++i )
+        writer.write_string( atoms[i].label() );
+    for ( size_t i( 0 ); i != atoms.size(); ++i )
+        writer.write( atoms[i].charge() );
+    for ( size_t i( 0 ); i != atoms.size(); ++i )
+        writer.write( atoms[i].occupancy() );
+    for ( size_t i( 0 ); i != atoms.size(); ++i )
+        writer.write_size_t( atoms[i].ADPs_type() );
+    for ( size_t i( 0 ); i != atoms.size(); ++i )
+    {
+        if ( atoms[i].ADPs_type() == Atom::ISOTROPIC )
+            writer.write( atoms[i].Uiso() );
+        else if ( atoms[i].ADPs_type() == Atom::ANISOTROPIC )
+        {
+            SymmetricMatrix3D U_cart = atoms[i].anisotropic_displacement_parameters().U_cart();
+            writer.write( U_cart.value( 0, 0 ) );
+            writer.write( U_cart.value( 1, 1 ) );
+            writer.write( U_cart.value( 2, 2 ) );
+            writer.write( U_cart.value( 0, 1 ) );
+            writer.write( U_cart.value( 0, 2 ) );
+            writer.write( U_cart.value( 1, 2 ) );
+        }
+    }
+}
+
+std::vector< Atom > read_atoms( BinaryReader & reader )
+{
+    const size_t natoms = reader.read_size_t();
+    std::vector< Element > elements( reader.read_size_t() );
+    for ( size_t i( 0 ); i != elements.size(); ++i )
+        elements[i] = Element( reader.read_string() );
+    std::vector< Atom > atoms;
+    atoms.reserve( natoms );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        const size_t element_index = reader.read_size_t();
+        if ( element_index >= elements.size() )
+            throw std::runtime_error( "CrystalStructure::read_binary(): file is corrupt." );
+        atoms.push_back( Atom( elements[element_index], Vector3D(), "" ) );
+    }
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        const double x = reader.read_double();
+        const double y = reader.read_double();
+        const double z = reader.read_double();
+        atoms[i].set_position( Vector3D( x, y, z ) );
+    }
+    for ( size_t i( 0 ); i != natoms; ++i )
+        atoms[i].set_label( reader.read_string() );
+    for ( size_t i( 0 ); i != natoms; ++i )
+        atoms[i].set_charge( reader.read_double() );
+    for ( size_t i( 0 ); i != natoms; ++i )
+        atoms[i].set_occupancy( reader.read_double() );
+    std::vector< size_t > ADPs_types( natoms );
+    for ( size_t i( 0 ); i != natoms; ++i )
+        ADPs_types[i] = reader.read_size_t();
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        if ( ADPs_types[i] == Atom::ISOTROPIC )
+            atoms[i].set_Uiso( reader.read_double() );
+        else if ( ADPs_types[i] == Atom::ANISOTROPIC )
+        {
+            const double U11 = reader.read_double();
+            const double U22 = reader.read_double();
+            const double U33 = reader.read_double();
+            const double U12 = reader.read_double();
+            const double U13 = reader.read_double();
+            const double U23 = reader.read_double();
+            atoms[i].set_anisotropic_displacement_parameters( AnisotropicDisplacementParameters( SymmetricMatrix3D( U11, U22, U33, U12, U13, U23 ) ) );
+        }
+        else if ( ADPs_types[i] != Atom::NONE )
+            throw std::runtime_error( "CrystalStructure::read_binary(): file is corrupt." );
+    }
+    return atoms;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+void CrystalStructure::save_binary( const FileName & file_name ) const
+{
+    BinaryWriter writer;
+    for ( size_t i( 0 ); i != sizeof( binary_magic ); ++i )
+        writer.write( binary_magic[i] );
+    writer.write( binary_version );
+    writer.write( binary_byte_order );
+    writer.write_string( name_ );
+    writer.write_string( space_group_.name() );
+    writer.write_size_t( space_group_.nsymmetry_operators() );
+    for ( size_t i( 0 ); i != space_group_.nsymmetry_operators(); ++i )
+    {
+        Matrix3D rotation = space_group_.symmetry_operator( i ).rotation();
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            for ( size_t k( 0 ); k != 3; ++k )
+                writer.write( rotation.value( j, k ) );
+        }
+        Vector3D translation = space_group_.symmetry_operator( i ).translation();
+        for ( size_t j( 0 ); j != 3; ++j )
+            writer.write( translation.value( j ) );
+    }
+    writer.write( crystal_lattice_.a() );
+    writer.write( crystal_lattice_.b() );
+    writer.write( crystal_lattice_.c() );
+    writer.write( crystal_lattice_.alpha().value_in_radians() );
+    writer.write( crystal_lattice_.beta().value_in_radians() );
+    writer.write( crystal_lattice_.gamma().value_in_radians() );
+    writer.write( space_group_symmetry_has_been_applied_ );
+    write_atoms( writer, atoms_ );
+    for ( size_t i( 0 ); i != atoms_.size(); ++i )
+        writer.write( static_cast< bool >( suppressed_[i] ) );
+    writer.write_size_t( bonded_atoms_.size() );
+    for ( size_t i( 0 ); i != bonded_atoms_.size(); ++i )
+        writer.write_indices( bonded_atoms_[i] );
+    writer.write_size_t( molecule_atoms_.size() );
+    for ( size_t i( 0 ); i != molecule_atoms_.size(); ++i )
+        writer.write_indices( molecule_atoms_[i] );
+    writer.write_indices( molecule_indices_ );
+    std::ofstream output_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! output_file )
+       throw std::runtime_error( std::string( "CrystalStructure::save_binary(): Could not open file " ) + file_name.full_name() );
+    output_file.write( writer.buffer().data(), writer.buffer().size() );
+    if ( ! output_file )
+       throw std::runtime_error( std::string( "CrystalStructure::save_binary(): Could not write file " ) + file_name.full_name() );
+}
+
+// ********************************************************************************
+
+void CrystalStructure::read_binary( const FileName & file_name )
+{
+    std::vector< char > buffer;
+    {
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+       throw std::runtime_error( std::string( "CrystalStructure::read_binary(): Could not open file " ) + file_name.full_name() );
+    input_file.seekg( 0, std::ios::end );
+    buffer.resize( static_cast< size_t >( input_file.tellg() ) );
+    input_file.seekg( 0, std::ios::beg );
+    if ( ! buffer.empty() )
+        input_file.read( &buffer[0], buffer.size() );
+    if ( ! input_file )
+       throw std::runtime_error( std::string( "CrystalStructure::read_binary(): Could not read file " ) + file_name.full_name() );
+    }
+    BinaryReader reader( buffer );
+    for ( size_t i( 0 ); i != sizeof( binary_magic ); ++i )
+    {
+        char c;
+        reader.read( c );
+        if ( c != binary_magic[i] )
+            throw std::runtime_error( "CrystalStructure::read_binary(): not a crystal structure snapshot: " + file_name.full_name() );
+    }
+    unsigned int version;
+    reader.read( version );
+    if ( version != binary_version )
+        throw std::runtime_error( "CrystalStructure::read_binary(): unsupported version of snapshot format: " + file_name.full_name() );
+    unsigned int byte_order;
+    reader.read( byte_order );
+    if ( byte_order != binary_byte_order )
+        throw std::runtime_error( "CrystalStructure::read_binary(): snapshot was written on a machine with a different byte order: " + file_name.full_name() );
+    // Read everything into a new object, so that *this is left unchanged if the file is corrupt
+    CrystalStructure result;
+    result.name_ = reader.read_string();
+    const std::string space_group_name = reader.read_string();
+    std::vector< SymmetryOperator > symmetry_operators( reader.read_size_t() );
+    for ( size_t i( 0 ); i != symmetry_operators.size(); ++i )
+    {
+        Matrix3D rotation;
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            for ( size_t k( 0 ); k != 3; ++k )
+                rotation.set_value( j, k, reader.read_double() );
+        }
+        const double x = reader.read_double();
+        const double y = reader.read_double();
+        const double z = reader.read_double();
+        symmetry_operators[i] = SymmetryOperator( rotation, Vector3D( x, y, z ) );
+    }
+    result.space_group_ = SpaceGroup( symmetry_operators, space_group_name );
+    const double a = reader.read_double();
+    const double b = reader.read_double();
+    const double c = reader.read_double();
+    const double alpha = reader.read_double();
+    const double beta = reader.read_double();
+    const double gamma = reader.read_double();
+    result.crystal_lattice_ = CrystalLattice( a, b, c, Angle::from_radians( alpha ), Angle::from_radians( beta ), Angle::from_radians( gamma ) );
+    reader.read( result.space_group_symmetry_has_been_applied_ );
+    result.atoms_ = read_atoms( reader );
+    result.suppressed_ = std::vector< bool >( result.atoms_.size() );
+    for ( size_t i( 0 ); i != result.atoms_.size(); ++i )
+    {
+        bool suppressed;
+        reader.read( suppressed );
+        result.suppressed_[i] = suppressed;
+    }
+    result.bonded_atoms_ = std::vector< SmallVector< size_t, 4 > >( reader.read_size_t() );
+    for ( size_t i( 0 ); i != result.bonded_atoms_.size(); ++i )
+        result.bonded_atoms_[i] = reader.read_indices< SmallVector< size_t, 4 > >();
+    result.molecule_atoms_ = std::vector< std::vector< size_t > >( reader.read_size_t() );
+    for ( size_t i( 0 ); i != result.molecule_atoms_.size(); ++i )
+        result.molecule_atoms_[i] = reader.read_indices();
+    result.molecule_indices_ = reader.read_indices();
+    if ( ! reader.at_end() )
+        throw std::runtime_error( "CrystalStructure::read_binary(): file is corrupt: " + file_name.full_name() );
+    *this = result;
+}
+
+// ********************************************************************************
+
 double root_mean_square_Cartesian_displacement( const CrystalStructure & lhs, const CrystalStructure & rhs )
 {
     // Check if the number of atoms is the same.
@@ -982,6 +1701,113 @@ double absolute_relative_difference( const double lhs, const double rhs )
 
 // ********************************************************************************
 
+namespace
+{
+
+struct ClosestImage
+{
+    ClosestImage(): distance_( 10000.0 ), atom_( 0 ), symmetry_operator_( 0 ), shift_( 0 ) {}
+
+    double distance_;
+    Vector3D position_;       // Fractional coordinates, the image of atom_ closest to the lhs atom
+    size_t atom_;             // Index in rhs
+    size_t symmetry_operator_;
+    size_t shift_;
+};
+
+// For each atom i in lhs, finds the closest position space_group.symmetry_operator( k ) * ( rhs.atom( j ).position() + shifts[m] ),
+// over all atoms j in rhs with the same element, all symmetry operators k and all shifts m.
+// All images are put in a cell list per element, so that each atom only has to be compared against a few images.
+// The result is the same as that of a loop over j, k and m (in that order) that keeps the first smallest distance.
+// If no image is found, atom_ is set to rhs.natoms() + 1.
+std::vector< ClosestImage > find_closest_images( const CrystalStructure & lhs,
+                                                 const CrystalStructure & rhs,
+                                                 const SpaceGroup & space_group,
+                                                 const std::vector< Vector3D > & shifts,
+                                                 const CrystalLattice & crystal_lattice,
+                                                 const bool skip_H_and_D )
+{
+    std::vector< ClosestImage > result( lhs.natoms() );
+    for ( size_t i( 0 ); i != result.size(); ++i )
+        result[i].atom_ = rhs.natoms() + 1;
+    const size_t nimages_per_atom = space_group.nsymmetry_operators() * shifts.size();
+    if ( nimages_per_atom == 0 )
+        return result;
+    std::map< Element, std::vector< size_t > > rhs_atoms;
+    for ( size_t j( 0 ); j != rhs.natoms(); ++j )
+        rhs_atoms[ rhs.atom( j ).element() ].push_back( j );
+    std::vector< Vector3D > images;
+    std::vector< size_t > candidates;
+    for ( std::map< Element, std::vector< size_t > >::const_iterator it = rhs_atoms.begin(); it != rhs_atoms.end(); ++it )
+    {
+        const std::vector< size_t > & atoms = it->second;
+        images.clear();
+        images.reserve( atoms.size() * nimages_per_atom );
+        for ( size_t j( 0 ); j != atoms.size(); ++j )
+        {
+            for ( size_t k( 0 ); k != space_group.nsymmetry_operators(); ++k )
+            {
+                for ( size_t m( 0 ); m != shifts.size(); ++m )
+                    images.push_back( space_group.symmetry_operator( k ) * ( rhs.atom( atoms[j] ).position() + shifts[m] ) );
+            }
+        }
+        // A cutoff for which there are on average a few images per bin
+        const double cutoff = 2.0 * cbrt( crystal_lattice.volume() / images.size() );
+        CellList cell_list( crystal_lattice, images, cutoff );
+        for ( size_t i( 0 ); i != lhs.natoms(); ++i )
+        {
+            if ( lhs.atom( i ).element() != it->first )
+                continue;
+            if ( skip_H_and_D && lhs.atom( i ).element().is_H_or_D() )
+                continue;
+            const Vector3D & position = lhs.atom( i ).position();
+            double smallest_distance( 10000.0 );
+            size_t best_image( images.size() );
+            // The candidates are in ascending order, so ties are resolved as in the full loop
+            cell_list.candidates( position, candidates );
+            for ( size_t c( 0 ); c != candidates.size(); ++c )
+            {
+                const double distance = crystal_lattice.shortest_distance( position, images[ candidates[c] ] );
+                if ( distance < smallest_distance )
+                {
+                    smallest_distance = distance;
+                    best_image = candidates[c];
+                }
+            }
+            // Every image within cutoff is a candidate, so only if nothing was found within cutoff must we look at all images
+            if ( ! ( smallest_distance < cutoff ) )
+            {
+                smallest_distance = 10000.0;
+                best_image = images.size();
+                for ( size_t n( 0 ); n != images.size(); ++n )
+                {
+                    const double distance = crystal_lattice.shortest_distance( position, images[n] );
+                    if ( distance < smallest_distance )
+                    {
+                        smallest_distance = distance;
+                        best_image = n;
+                    }
+                }
+            }
+            if ( best_image == images.size() )
+                continue;
+            result[i].distance_ = smallest_distance;
+            result[i].atom_ = atoms[ best_image / nimages_per_atom ];
+            result[i].symmetry_operator_ = ( best_image % nimages_per_atom ) / shifts.size();
+            result[i].shift_ = best_image % shifts.size();
+            double distance;
+            Vector3D difference_vector; // Fractional coordinates.
+            crystal_lattice.shortest_distance( position, images[ best_image ], distance, difference_vector );
+            result[i].position_ = position + difference_vector;
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+// ********************************************************************************
+
 double RMSCD_with_matching( const CrystalStructure & lhs, const CrystalStructure & rhs, const bool add_shifts )
 {
     // Some simple checks:
@@ -999,17 +1825,17 @@ double RMSCD_with_matching( const CrystalStructure & lhs, const CrystalStructure
                                     ( lhs_lattice.beta()  + rhs_lattice.beta()  ) / 2.0,
                                     ( lhs_lattice.gamma() + rhs_lattice.gamma() ) / 2.0 );
     if ( absolute_relative_difference( lhs_lattice.a(), rhs_lattice.a() ) > 0.10 )
-        std::cout << "RMSCD_with_matching(): WARNING: a parameters differ by more than 10%." << std::endl;
+        log_warning( "RMSCD_with_matching(): WARNING: a parameters differ by more than 10%." );
     if ( absolute_relative_difference( lhs_lattice.b(), rhs_lattice.b() ) > 0.10 )
-        std::cout << "RMSCD_with_matching(): WARNING: b parameters differ by more than 10%." << std::endl;
+        log_warning( "RMSCD_with_matching(): WARNING: b parameters differ by more than 10%." );
     if ( absolute_relative_difference( lhs_lattice.c(), rhs_lattice.c() ) > 0.10 )
-        std::cout << "RMSCD_with_matching(): WARNING: c parameters differ by more than 10%." << std::endl;
+        log_warning( "RMSCD_with_matching(): WARNING: c parameters differ by more than 10%." );
     if ( std::abs( lhs_lattice.alpha().value_in_degrees() - rhs_lattice.alpha().value_in_degrees() ) > 10.0 )
-        std::cout << "RMSCD_with_matching(): WARNING: alpha angles differ by more than 10 degrees." << std::endl;
+        log_warning( "RMSCD_with_matching(): WARNING: alpha angles differ by more than 10 degrees." );
     if ( std::abs( lhs_lattice.beta().value_in_degrees() - rhs_lattice.beta().value_in_degrees() ) > 10.0 )
-        std::cout << "RMSCD_with_matching(): WARNING: beta angles differ by more than 10 degrees." << std::endl;
+        log_warning( "RMSCD_with_matching(): WARNING: beta angles differ by more than 10 degrees." );
     if ( std::abs( lhs_lattice.gamma().value_in_degrees() - rhs_lattice.gamma().value_in_degrees() ) > 10.0 )
-        std::cout << "RMSCD_with_matching(): WARNING: gamma angles differ by more than 10 degrees." << std::endl;
+        log_warning( "RMSCD_with_matching(): WARNING: gamma angles differ by more than 10 degrees." );
         
     // Loop over all symmetry operators.
     // First find all floating axes; these are a problem if there is more than one residue in the asymmetric unit,
@@ -1021,7 +1847,7 @@ double RMSCD_with_matching( const CrystalStructure & lhs, const CrystalStructure
     std::vector< bool > done( natoms, false );
     // In principle, the two structures could have different space groups,
     // but for the moment they must have the same space group.
-    SpaceGroup space_group = rhs.space_group();
+    const SpaceGroup & space_group = rhs.space_group();
     // Add all combinations of shifts of 1/2 along a, b and c.
     std::vector< Vector3D > shifts;
     if ( add_shifts )
@@ -1037,42 +1863,12 @@ double RMSCD_with_matching( const CrystalStructure & lhs, const CrystalStructure
         shifts.push_back( Vector3D( 0.0, 0.0, 0.5 ) );
         shifts.push_back( Vector3D( 0.5, 0.5, 0.5 ) );
     }
+    std::vector< ClosestImage > closest_images = find_closest_images( lhs, rhs, space_group, shifts, average_lattice, false );
     for ( size_t i( 0 ); i != natoms; ++i )
     {
-        double smallest_distance( 10000.0 );
-        Vector3D best_match;
-        size_t best_symmetry_operator;
-        size_t best_shift;
-        size_t matching_index = natoms + 1;
-        // Loop over atoms.
-        for ( size_t j( 0 ); j != natoms; ++j )
-        {
-            // Check if element the same.
-            if ( lhs.atom( i ).element() != rhs.atom( j ).element() )
-                continue;
-            // Loop over symmetry operators.
-            for ( size_t k( 0 ); k != space_group.nsymmetry_operators(); ++k )
-            {
-                // Loop over shifts.
-                for ( size_t m( 0 ); m != shifts.size(); ++m )
-                {
-                    // Fractional coordinates.
-                    Vector3D current_position = space_group.symmetry_operator( k ) * ( rhs.atom( j ).position() + shifts[m] );
-                    // Adjust for translations and convert to Cartesian coordinates.
-                    double shortest_distance;
-                    Vector3D difference_vector; // Fractional coordinates.
-                    average_lattice.shortest_distance( lhs.atom( i ).position(), current_position, shortest_distance, difference_vector );
-                    if ( shortest_distance < smallest_distance )
-                    {
-                        smallest_distance = shortest_distance;
-                        matching_index = j;
-                        best_match = lhs.atom( i ).position() + difference_vector;
-                        best_symmetry_operator = k;
-                        best_shift = m;
-                    }
-                }
-            }
-        }
+        const double smallest_distance = closest_images[i].distance_;
+        const Vector3D best_match = closest_images[i].position_;
+        const size_t matching_index = closest_images[i].atom_;
         std::cout << lhs.atom( i ).element().symbol() << " smallest distance = " << smallest_distance << std::endl;
         if ( done[ matching_index ] && ( ! lhs.atom( i ).element().is_H_or_D() ) )
         {
@@ -1132,17 +1928,17 @@ SymmetryOperator find_match( const CrystalStructure & lhs, const CrystalStructur
                                     ( lhs_lattice.beta()  + rhs_lattice.beta()  ) / 2.0,
                                     ( lhs_lattice.gamma() + rhs_lattice.gamma() ) / 2.0 );
     if ( absolute_relative_difference( lhs_lattice.a(), rhs_lattice.a() ) > 0.10 )
-        std::cout << "find_match(): WARNING: a parameters differ by more than 10%." << std::endl;
+        log_warning( "find_match(): WARNING: a parameters differ by more than 10%." );
     if ( absolute_relative_difference( lhs_lattice.b(), rhs_lattice.b() ) > 0.10 )
-        std::cout << "find_match(): WARNING: b parameters differ by more than 10%." << std::endl;
+        log_warning( "find_match(): WARNING: b parameters differ by more than 10%." );
     if ( absolute_relative_difference( lhs_lattice.c(), rhs_lattice.c() ) > 0.10 )
-        std::cout << "find_match(): WARNING: c parameters differ by more than 10%." << std::endl;
+        log_warning( "find_match(): WARNING: c parameters differ by more than 10%." );
     if ( std::abs( lhs_lattice.alpha().value_in_degrees() - rhs_lattice.alpha().value_in_degrees() ) > 10.0 )
-        std::cout << "find_match(): WARNING: alpha angles differ by more than 10 degrees." << std::endl;
+        log_warning( "find_match(): WARNING: alpha angles differ by more than 10 degrees." );
     if ( std::abs( lhs_lattice.beta().value_in_degrees() - rhs_lattice.beta().value_in_degrees() ) > 10.0 )
-        std::cout << "find_match(): WARNING: beta angles differ by more than 10 degrees." << std::endl;
+        log_warning( "find_match(): WARNING: beta angles differ by more than 10 degrees." );
     if ( std::abs( lhs_lattice.gamma().value_in_degrees() - rhs_lattice.gamma().value_in_degrees() ) > 10.0 )
-        std::cout << "find_match(): WARNING: gamma angles differ by more than 10 degrees." << std::endl;
+        log_warning( "find_match(): WARNING: gamma angles differ by more than 10 degrees." );
     if ( natoms == 0 )
         return SymmetryOperator();
     // Find closest match
@@ -1150,7 +1946,7 @@ SymmetryOperator find_match( const CrystalStructure & lhs, const CrystalStructur
     // In principle, the two structures could have different space groups,
     // but for the moment they must have the same space group.
     if ( ! same_symmetry_operators( lhs.space_group(), rhs.space_group() ) )
-        std::cout << "find_match(): WARNING: Space groups are different, this will give non-sensical results." << std::endl;
+        log_warning( "find_match(): WARNING: Space groups are different, this will give non-sensical results." );
     SpaceGroup space_group = rhs.space_group();
     // First find all floating axes; @@ these are a problem if there is more than one residue in the asymmetric unit,
     // but we cannot detect that at the moment.
@@ -1195,44 +1991,15 @@ SymmetryOperator find_match( const CrystalStructure & lhs, const CrystalStructur
     std::vector< size_t > symmetry_operators_frequencies( space_group.nsymmetry_operators(), 0 );
     std::vector< size_t > shifts_frequencies( shifts.size(), 0 );
     std::vector< size_t > inversion_frequencies( 2, 0 );
+    std::vector< ClosestImage > closest_images = find_closest_images( lhs, rhs, space_group, shifts, average_lattice, true );
     for ( size_t i( 0 ); i != natoms; ++i )
     {
         if ( lhs.atom( i ).element().is_H_or_D() )
             continue;
-        double smallest_distance( 10000.0 );
-        Vector3D best_match;
-        size_t best_symmetry_operator( 0 ); // Stupid initialisation to silence compiler warnings
-        size_t best_shift( 0 ); // Stupid initialisation to silence compiler warnings
-        size_t matching_index = natoms + 1;
-        // Loop over atoms.
-        for ( size_t j( 0 ); j != natoms; ++j )
-        {
-            // Check if element the same.
-            if ( lhs.atom( i ).element() != rhs.atom( j ).element() )
-                continue;
-            // Loop over symmetry operators.
-            for ( size_t k( 0 ); k != space_group.nsymmetry_operators(); ++k )
-            {
-                // Loop over shifts.
-                for ( size_t m( 0 ); m != shifts.size(); ++m )
-                {
-                    // Fractional coordinates.
-                    Vector3D current_position = space_group.symmetry_operator( k ) * ( rhs.atom( j ).position() + shifts[m] );
-                    // Adjust for translations and convert to Cartesian coordinates.
-                    double shortest_distance;
-                    Vector3D difference_vector; // Fractional coordinates.
-                    average_lattice.shortest_distance( lhs.atom( i ).position(), current_position, shortest_distance, difference_vector );
-                    if ( shortest_distance < smallest_distance )
-                    {
-                        smallest_distance = shortest_distance;
-                        matching_index = j;
-                        best_match = lhs.atom( i ).position() + difference_vector;
-                        best_symmetry_operator = k;
-                        best_shift = m;
-                    }
-                }
-            }
-        }
+        const double smallest_distance = closest_images[i].distance_;
+        const size_t best_symmetry_operator = closest_images[i].symmetry_operator_;
+        const size_t best_shift = closest_images[i].shift_;
+        const size_t matching_index = closest_images[i].atom_;
         std::cout << lhs.atom( i ).element().symbol() << " smallest distance = " << smallest_distance << std::endl;
         if ( done[ matching_index ] && ( ! lhs.atom( i ).element().is_H_or_D() ) )
         {
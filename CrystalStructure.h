@@ -31,10 +31,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Atom.h"
 #include "CrystalLattice.h"
 #include "FileName.h"
+#include "LazyCache.h"
 #include "MoleculeInCrystal.h"
+#include "SmallVector.h"
 #include "SpaceGroup.h"
 
 #include <set>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 //enum DriftCorrection { NONE, USE_FIRST_FRAME, USE_VECTOR };
@@ -45,6 +49,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
   Class is schizofrenic regarding what is stored: asymmetric unit or all atoms in the unit cell
   (or anything in between or even more atoms)
 
+  The const member functions have no hidden state, so the threads of a parallel calculation can share one CrystalStructure
+  without copying it as long as nobody changes it (see LazyCache.h for the conventions).
+
 */
 class CrystalStructure
 {
@@ -58,20 +65,21 @@ public:
 
     size_t natoms() const { return atoms_.size(); }
 
-    Atom atom( const size_t i ) const;
+    const Atom & atom( const size_t i ) const;
 
-    // Returns natoms() when label not found.
+    // Returns natoms() when label not found. If a label occurs more than once, the first atom with that label is returned.
+    // Uses a hash table of the labels that is built on the first call and rebuilt after the atoms have changed.
     size_t find_label( const std::string & label ) const;
 
     // Label must be an exact match, i.e. "C11" does not match "C1" and "C1_0" does not match "C1".
     // Zero-based, throws if no match found.
     size_t atom( const std::string & atom_label ) const;
 
-    // This is an expensive method...
-    std::vector< Atom > atoms() const { return atoms_; }
+    // The reference is invalidated when atoms are added or removed.
+    const std::vector< Atom > & atoms() const { return atoms_; }
 
     void reserve_natoms( const size_t value ) { atoms_.reserve( value ); suppressed_.reserve( value ); }
-    void add_atom( const Atom & atom ) { atoms_.push_back( atom ); suppressed_.push_back( false ); }
+    void add_atom( const Atom & atom ) { atoms_.push_back( atom ); suppressed_.push_back( false ); label_index_.invalidate(); }
     void add_atoms( const std::vector< Atom > & atoms );
     
     // Replaces an existing atom, enables making changes to atoms in the crystal
@@ -91,15 +99,18 @@ public:
     // Checks if any atom labels are duplicate
     void basic_checks() const;
     
+    // Labels that occur only once are kept, as is the first atom with a duplicate label. The other atoms with a duplicate label
+    // are renamed to the element symbol followed by the lowest number for that element that is not in use, e.g. C1, C2, N1.
+    // O(N).
     void make_atom_labels_unique();
 
     std::set< Element > elements() const;
 
-    SpaceGroup space_group() const { return space_group_; }
+    const SpaceGroup & space_group() const { return space_group_; }
 
     void set_space_group( const SpaceGroup & space_group ) { space_group_ = space_group; }
 
-    CrystalLattice crystal_lattice() const { return crystal_lattice_; }
+    const CrystalLattice & crystal_lattice() const { return crystal_lattice_; }
 
     // This should somehow be cross-checked with the space group, which suggests that the two should be combined into a class.
     void set_crystal_lattice( const CrystalLattice & crystal_lattice ) { crystal_lattice_ = crystal_lattice; }
@@ -112,7 +123,7 @@ public:
     //
     // And some intermediate results may actually be very useful
 
-    // Only the asymmetric unit is kept, everything else is deleted.
+    // Only the asymmetric unit is kept, everything else is deleted. The molecules are cleared.
     void reduce_to_asymmetric_unit();
 
     bool space_group_symmetry_has_been_applied() const { return space_group_symmetry_has_been_applied_; }
@@ -128,20 +139,41 @@ public:
     // @@ Should this be made such that it can only be applied once? (I.e. is ignored when called again after first call.)
     void apply_space_group_symmetry();
 
-    void perceive_molecules();
+    // The bonds are stored in a sparse BondGraph, the dense ConnectivityTable (O(N^2) memory) is only meant for small systems.
+    void perceive_molecules( const bool use_dense_connectivity_table = false );
+
+    // Updates the molecules after perceive_molecules() without reducing to the asymmetric unit and reapplying the symmetry.
+    // changed_atoms are the indices of atoms that have been moved or changed, atoms added with add_atom() since the last
+    // update are included automatically. Only the bonds of these atoms are recalculated and only the molecules they were or
+    // are now part of are rebuilt; these are appended after the unaffected molecules. Atoms must not have been removed or reordered.
+    void update_molecules( const std::vector< size_t > & changed_atoms = std::vector< size_t >() );
 
-    // @@ This requires that you run the molecule preception method first
+    // Keeps the first molecule of each set of symmetry-related molecules, molecules on special positions are kept whole.
+    // This requires that you run the molecule preception method first
     void remove_symmetry_related_molecules();
 
-    // This returns a copy, so would copy all atoms.
+    size_t nmolecules() const { return molecule_atoms_.size(); }
+
+    // A view of the atoms of molecule i, the atoms are not copied. Only valid until the atoms or the molecules are changed.
     MoleculeInCrystal molecule_in_crystal( const size_t i ) const;
 
-    void set_molecule_in_crystal( const size_t i, const MoleculeInCrystal & molecule_in_crystal ) { molecules_[i] = molecule_in_crystal; }
+    // The atoms that atom i is bonded to, requires perceive_molecules().
+    const SmallVector< size_t, 4 > & bonded_atoms( const size_t i ) const { return bonded_atoms_[i]; }
 
+    // The index of the molecule that atom i belongs to, requires perceive_molecules().
+    size_t molecule_index( const size_t i ) const { return molecule_indices_[i]; }
+
+    // True if a symmetry operator other than the identity maps molecule i onto itself, with the same tolerances as SymmetryOrbits.
+    // Only the atoms of molecule i are searched and nothing is allocated. Requires perceive_molecules() to have been called.
     bool molecule_is_on_special_position( const size_t i ) const;
 
+    // Number of symmetry-independent molecules, e.g. 0.5 for a molecule on an inversion centre. Requires perceive_molecules() to have been called.
+    double Z_prime() const;
+
+    // The average of the fractional coordinates of the atoms of molecule i.
     Vector3D molecular_centre_of_mass( const size_t i ) const;
     
+    // Moves the atoms of molecule i in the crystal structure.
     void move_molecule( const size_t i, const Vector3D shift );
 
     void convert_to_P1();
@@ -168,13 +200,13 @@ public:
     // Finds shortest distance, in Angstrom, between two positions given in fractional coordinates.
     // All space-group symmetry operators are taken into account; if this is undesired, use CrystalLattice::shortest_distance().
     // Returns the shortest distance (in Angstrom) and the shortest difference vector (defined as rhs - lhs, in fractional coordinates).
-    void shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & distance, Vector3D & difference_vector );
+    void shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & distance, Vector3D & difference_vector ) const;
 
-    void second_shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & second_shortest_distance, Vector3D & second_shortest_difference_vector );
+    void second_shortest_distance( const Vector3D & lhs, const Vector3D & rhs, double & second_shortest_distance, Vector3D & second_shortest_difference_vector ) const;
 
     // Finds shortest distance squared, in Angstrom squared, between two positions given in fractional coordinates.
     // All space-group symmetry operators are taken into account; if this is undesired, use CrystalLattice::shortest_distance2().
-    double shortest_distance2( const Vector3D & lhs, const Vector3D & rhs );
+    double shortest_distance2( const Vector3D & lhs, const Vector3D & rhs ) const;
 
     // The current space group should be P1. u, v, w are the dimensions of the supercell with respect to
     // the original unit cell, space_group is the space group of the original unit cell.
@@ -224,18 +256,56 @@ public:
                              Vector3D & actual_centre,
                              std::vector< std::vector< Vector3D > > & positions );
 
+    // As above, but positions is a flat buffer: the copies of atom i are positions[ i * multiplicity ] ... positions[ ( i + 1 ) * multiplicity - 1 ],
+    // with multiplicity = u * v * w * space_group().nsymmetry_operators(). Pass the same buffer for each frame to avoid reallocations.
+    void collapse_supercell( const size_t u,
+                             const size_t v,
+                             const size_t w,
+                             const int drift_correction,
+                             const Vector3D & target_centre,
+                             Matrix3D & transformation,
+                             Vector3D & actual_centre,
+                             std::vector< Vector3D > & positions );
+
+    // As above, but the centre used for the drift correction is the average of the atoms in reference_atoms only,
+    // e.g. a subset of the heavy atoms, so that tracking the drift costs time proportional to the size of the subset.
+    // The correction is applied in the same pass over the atoms as the scaling to the unit cell.
+    // An empty reference_atoms means all atoms.
+    void collapse_supercell( const size_t u,
+                             const size_t v,
+                             const size_t w,
+                             const int drift_correction,
+                             const Vector3D & target_centre,
+                             const std::vector< size_t > & reference_atoms,
+                             Matrix3D & transformation,
+                             Vector3D & actual_centre,
+                             std::vector< Vector3D > & positions );
+
     void save_xyz( const FileName & file_name ) const;
     
     void save_cif( const FileName & file_name ) const;
 
+    // Binary snapshot of everything, including the molecules and bonds found by perceive_molecules() and the suppressed flags,
+    // so that a structure can be restored much faster than it can be read from a cif and processed again.
+    // The format is versioned and specific to the byte order of the machine, it is meant as a cache, not for archiving.
+    void save_binary( const FileName & file_name ) const;
+
+    // Throws if the file is not a snapshot with the current version of the format.
+    void read_binary( const FileName & file_name );
+
 private:
     SpaceGroup space_group_;
     CrystalLattice crystal_lattice_;
     std::vector< Atom > atoms_;
-    std::vector< MoleculeInCrystal > molecules_;
+    std::vector< SmallVector< size_t, 4 > > bonded_atoms_; // For each atom, the atoms it is bonded to, set by perceive_molecules()
+    std::vector< std::vector< size_t > > molecule_atoms_; // For each molecule, the indices of its atoms
+    std::vector< size_t > molecule_indices_;              // For each atom, the molecule it belongs to
     std::vector< bool > suppressed_; //
     std::string name_;
     bool space_group_symmetry_has_been_applied_;
+    LazyCache< std::unordered_map< std::string, size_t > > label_index_; // For each label, the first atom with that label. Every function that adds, removes, reorders or relabels atoms must invalidate it.
+
+    const std::unordered_map< std::string, size_t > & label_index() const;
 
 };
 
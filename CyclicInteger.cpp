@@ -63,7 +63,7 @@ int CyclicInteger::current_value() const
 
 // ********************************************************************************
 
-int CyclicInteger::next_value() const
+int CyclicInteger::next_value()
 {
     int old(value_);
     ++value_;
@@ -124,7 +124,7 @@ void CyclicInteger::initialise( const int start, const int end )
 
 // ********************************************************************************
 
-void CyclicInteger::adjust() const
+void CyclicInteger::adjust()
 {
     value_ = adjust( value_ );
 }
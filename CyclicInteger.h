@@ -56,7 +56,7 @@ public:
     int current_value() const;
 
     // Increments value by 1.
-    int next_value() const;
+    int next_value();
 
     // Returns current value + n, adjusted for cyclicity, leaves current value unchanged
     int plus_n( const int n ) const;
@@ -126,10 +126,10 @@ private:
 
     int offset_;
     unsigned int range_;
-    mutable int value_;
+    int value_;
 
     void initialise( const int start, const int end );
-    void adjust() const;
+    void adjust();
     int adjust( const int value ) const;
 
 };
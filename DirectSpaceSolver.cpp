@@ -0,0 +1,569 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "DirectSpaceSolver.h"
+#include "Checkpoint.h"
+#include "CrystalStructure.h"
+#include "Instrumentation.h"
+#include "Logger.h"
+#include "MathConstants.h"
+#include "MathFunctions.h"
+#include "MathKernels.h"
+#include "ParallelFor.h"
+#include "PeakShapeFunction.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "RandomNumberGenerator.h"
+#include "ReflectionList.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+
+// The same value as the default peak shape of PowderPatternCalculator.
+const double default_eta = 0.9;
+
+// ********************************************************************************
+
+// Wraps a fractional coordinate into [ 0, 1 ).
+double wrap( const double x )
+{
+    return x - std::floor( x );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+// The contribution of one molecule to the structure factors, for every reflection i and symmetry operator s (index i * nsymmetry_operators + s).
+struct DirectSpaceSolver::MoleculeTerms
+{
+    std::vector< double > transform_re_; // Molecular transform
+    std::vector< double > transform_im_;
+    std::vector< double > phase_re_; // exp( 2 pi i ( hR.c + h.t ) ), c is the centroid
+    std::vector< double > phase_im_;
+    std::vector< double > F_re_; // Sum over the symmetry operators, one per reflection
+    std::vector< double > F_im_;
+    // Work space
+    std::vector< Vector3D > positions_;
+    std::vector< double > phases_;
+    std::vector< double > sines_;
+    std::vector< double > cosines_;
+};
+
+// ********************************************************************************
+
+DirectSpaceSolver::DirectSpaceSolver( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group, const PowderPattern & experimental_pattern, const double FWHM ):
+crystal_lattice_(crystal_lattice),
+space_group_(space_group),
+nruns_(0),
+ntrials_(100000),
+nthreads_(0),
+seed_(1539),
+temperature_start_(0.05),
+temperature_end_(0.001),
+translation_step_(0.5),
+rotation_step_(Angle::from_degrees( 15.0 )),
+torsion_step_(Angle::from_degrees( 30.0 )),
+best_Rwp_(1.0),
+ntrials_total_(0),
+trials_per_second_per_thread_(0.0),
+sum_weighted_observed_squared_(0.0)
+{
+    const size_t npoints = experimental_pattern.size();
+    if ( npoints < 2 )
+        throw std::runtime_error( "DirectSpaceSolver::DirectSpaceSolver(): experimental pattern is empty." );
+    const double wavelength = experimental_pattern.wavelength();
+    // The reflection list
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( crystal_lattice );
+    crystal_structure.set_space_group( space_group );
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    powder_pattern_calculator.set_wavelength( wavelength );
+    powder_pattern_calculator.set_two_theta_start( experimental_pattern.two_theta( 0 ) );
+    powder_pattern_calculator.set_two_theta_end( experimental_pattern.two_theta( npoints - 1 ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    const ReflectionList reflection_list = powder_pattern_calculator.reflection_list();
+    const size_t nreflections = reflection_list.size();
+    const size_t noperators = space_group.nsymmetry_operators();
+    hR_x_.resize( nreflections * noperators );
+    hR_y_.resize( nreflections * noperators );
+    hR_z_.resize( nreflections * noperators );
+    ht_.resize( nreflections * noperators );
+    sine_theta_over_lambda_.resize( nreflections );
+    intensity_factors_.resize( nreflections );
+    // The peak profiles are evaluated at the 2theta values of the experimental pattern
+    observed_.resize( npoints );
+    weights_.resize( npoints );
+    for ( size_t k( 0 ); k != npoints; ++k )
+    {
+        observed_[k] = experimental_pattern.intensity( k );
+        weights_[k] = experimental_pattern.weights()[k];
+        sum_weighted_observed_squared_ += weights_[k] * square( observed_[k] );
+    }
+    const double two_theta_start = experimental_pattern.two_theta( 0 ).value_in_degrees();
+    const double step = experimental_pattern.average_two_theta_step().value_in_degrees();
+    const PseudoVoigtPeakShape peak_shape_function( FWHM, default_eta );
+    const double half_width = peak_shape_function.range( FWHM, default_eta );
+    profile_offsets_.push_back( 0 );
+    for ( size_t i( 0 ); i != nreflections; ++i )
+    {
+        const MillerIndices miller_indices = reflection_list.miller_indices( i );
+        const Vector3D h( miller_indices.h(), miller_indices.k(), miller_indices.l() );
+        for ( size_t s( 0 ); s != noperators; ++s )
+        {
+            const SymmetryOperator & symmetry_operator = space_group.symmetry_operator( s );
+            const Vector3D hR = h * symmetry_operator.rotation();
+            hR_x_[ i * noperators + s ] = hR.x();
+            hR_y_[ i * noperators + s ] = hR.y();
+            hR_z_[ i * noperators + s ] = hR.z();
+            ht_[ i * noperators + s ] = h * symmetry_operator.translation();
+        }
+        const double d = reflection_list.d_spacing( i );
+        sine_theta_over_lambda_[i] = 1.0 / ( 2.0 * d );
+        const Angle theta = arcsine( wavelength / ( 2.0 * d ) );
+        const Angle two_theta = 2.0 * theta;
+        const double LP_factor = ( 1.0 + square( two_theta.cosine() ) ) / ( 2.0 * two_theta.sine() * theta.sine() );
+        intensity_factors_[i] = reflection_list.multiplicity( i ) * LP_factor;
+        const double position = two_theta.value_in_degrees();
+        const int first = std::max( 0, static_cast<int>( std::ceil( ( position - half_width - two_theta_start ) / step ) ) );
+        const int last = std::min( static_cast<int>( npoints ) - 1, static_cast<int>( std::floor( ( position + half_width - two_theta_start ) / step ) ) );
+        profile_first_.push_back( first );
+        for ( int k( first ); k <= last; ++k )
+            profile_values_.push_back( peak_shape_function.value( experimental_pattern.two_theta( k ).value_in_degrees() - position, FWHM, default_eta ) );
+        profile_offsets_.push_back( profile_values_.size() );
+    }
+}
+
+// ********************************************************************************
+
+void DirectSpaceSolver::add_molecule( const FlexibleMolecule & molecule )
+{
+    molecules_.push_back( molecule );
+    // The scattering power of each atom for each reflection does not depend on where the molecule is
+    const size_t natoms = molecule.natoms();
+    std::vector< double > atom_weights( nreflections() * natoms );
+    for ( size_t i( 0 ); i != nreflections(); ++i )
+    {
+        const double s = sine_theta_over_lambda_[i];
+        for ( size_t j( 0 ); j != natoms; ++j )
+        {
+            const Atom & atom = molecule.atom( j );
+            atom_weights[ i * natoms + j ] = atom.occupancy() * atom.element().scattering_factor( s ) * std::exp( -8.0 * square( CONSTANT_PI ) * atom.Uiso() * square( s ) );
+        }
+    }
+    atom_weights_.push_back( atom_weights );
+}
+
+// ********************************************************************************
+
+void DirectSpaceSolver::calculate_transform( const size_t molecule, const MoleculeState & state, MoleculeTerms & terms ) const
+{
+    const FlexibleMolecule & flexible_molecule = molecules_[molecule];
+    const std::vector< double > & atom_weights = atom_weights_[molecule];
+    flexible_molecule.generate( state.orientation_.rotation_matrix(), state.torsion_changes_, terms.positions_ );
+    const size_t natoms = flexible_molecule.natoms();
+    const Matrix3D & orthogonal_to_fractional = crystal_lattice_.orthogonal_to_fractional_matrix();
+    for ( size_t j( 0 ); j != natoms; ++j )
+        terms.positions_[j] = orthogonal_to_fractional * terms.positions_[j];
+    const size_t nterms = hR_x_.size();
+    // All phases in one array, so that the sines and cosines are calculated in one vectorised call
+    terms.phases_.resize( nterms * natoms );
+    for ( size_t t( 0 ); t != nterms; ++t )
+    {
+        const double hx = hR_x_[t];
+        const double hy = hR_y_[t];
+        const double hz = hR_z_[t];
+        double * phases = &terms.phases_[ t * natoms ];
+        for ( size_t j( 0 ); j != natoms; ++j )
+            phases[j] = hx * terms.positions_[j].x() + hy * terms.positions_[j].y() + hz * terms.positions_[j].z();
+    }
+    sincos_2pi( terms.phases_, terms.sines_, terms.cosines_ );
+    terms.transform_re_.resize( nterms );
+    terms.transform_im_.resize( nterms );
+    const size_t noperators = space_group_.nsymmetry_operators();
+    for ( size_t t( 0 ); t != nterms; ++t )
+    {
+        const double * weights = &atom_weights[ ( t / noperators ) * natoms ];
+        const double * sines = &terms.sines_[ t * natoms ];
+        const double * cosines = &terms.cosines_[ t * natoms ];
+        double re( 0.0 );
+        double im( 0.0 );
+        for ( size_t j( 0 ); j != natoms; ++j )
+        {
+            re += weights[j] * cosines[j];
+            im += weights[j] * sines[j];
+        }
+        terms.transform_re_[t] = re;
+        terms.transform_im_[t] = im;
+    }
+}
+
+// ********************************************************************************
+
+void DirectSpaceSolver::calculate_phase_factors( const MoleculeState & state, MoleculeTerms & terms ) const
+{
+    const size_t nterms = hR_x_.size();
+    terms.phases_.resize( nterms );
+    const Vector3D & c = state.position_;
+    for ( size_t t( 0 ); t != nterms; ++t )
+        terms.phases_[t] = hR_x_[t] * c.x() + hR_y_[t] * c.y() + hR_z_[t] * c.z() + ht_[t];
+    sincos_2pi( terms.phases_, terms.phase_im_, terms.phase_re_ );
+}
+
+// ********************************************************************************
+
+void DirectSpaceSolver::calculate_contribution( MoleculeTerms & terms ) const
+{
+    const size_t noperators = space_group_.nsymmetry_operators();
+    terms.F_re_.resize( nreflections() );
+    terms.F_im_.resize( nreflections() );
+    for ( size_t i( 0 ); i != nreflections(); ++i )
+    {
+        double re( 0.0 );
+        double im( 0.0 );
+        for ( size_t t( i * noperators ); t != ( i + 1 ) * noperators; ++t )
+        {
+            re += terms.phase_re_[t] * terms.transform_re_[t] - terms.phase_im_[t] * terms.transform_im_[t];
+            im += terms.phase_re_[t] * terms.transform_im_[t] + terms.phase_im_[t] * terms.transform_re_[t];
+        }
+        terms.F_re_[i] = re;
+        terms.F_im_[i] = im;
+    }
+}
+
+// ********************************************************************************
+
+double DirectSpaceSolver::Rwp( const std::vector< MoleculeTerms > & terms, std::vector< double > & intensities, std::vector< double > & pattern ) const
+{
+    intensities.resize( nreflections() );
+    for ( size_t i( 0 ); i != nreflections(); ++i )
+    {
+        double re( 0.0 );
+        double im( 0.0 );
+        for ( size_t m( 0 ); m != terms.size(); ++m )
+        {
+            re += terms[m].F_re_[i];
+            im += terms[m].F_im_[i];
+        }
+        intensities[i] = ( square( re ) + square( im ) ) * intensity_factors_[i];
+    }
+    pattern.assign( observed_.size(), 0.0 );
+    for ( size_t i( 0 ); i != nreflections(); ++i )
+    {
+        const double * values = &profile_values_[ profile_offsets_[i] ];
+        double * points = &pattern[ profile_first_[i] ];
+        const size_t n = profile_offsets_[i+1] - profile_offsets_[i];
+        for ( size_t k( 0 ); k != n; ++k )
+            points[k] += intensities[i] * values[k];
+    }
+    // With the optimal scale factor c = sum( w yo yc ) / sum( w yc^2 ), Rwp^2 = 1 - sum( w yo yc )^2 / ( sum( w yo^2 ) sum( w yc^2 ) )
+    double sum_observed_calculated( 0.0 );
+    double sum_calculated_squared( 0.0 );
+    for ( size_t k( 0 ); k != pattern.size(); ++k )
+    {
+        sum_observed_calculated += weights_[k] * observed_[k] * pattern[k];
+        sum_calculated_squared  += weights_[k] * square( pattern[k] );
+    }
+    if ( ( sum_calculated_squared == 0.0 ) || ( sum_weighted_observed_squared_ == 0.0 ) )
+        return 1.0;
+    return std::sqrt( std::max( 0.0, 1.0 - square( sum_observed_calculated ) / ( sum_weighted_observed_squared_ * sum_calculated_squared ) ) );
+}
+
+// ********************************************************************************
+
+double DirectSpaceSolver::Rwp( const std::vector< MoleculeState > & states ) const
+{
+    if ( states.size() != molecules_.size() )
+        throw std::runtime_error( "DirectSpaceSolver::Rwp(): wrong number of molecules." );
+    std::vector< MoleculeTerms > terms( molecules_.size() );
+    for ( size_t m( 0 ); m != molecules_.size(); ++m )
+    {
+        calculate_transform( m, states[m], terms[m] );
+        calculate_phase_factors( states[m], terms[m] );
+        calculate_contribution( terms[m] );
+    }
+    std::vector< double > intensities;
+    std::vector< double > pattern;
+    return Rwp( terms, intensities, pattern );
+}
+
+// ********************************************************************************
+
+CrystalStructure DirectSpaceSolver::crystal_structure( const std::vector< MoleculeState > & states ) const
+{
+    if ( states.size() != molecules_.size() )
+        throw std::runtime_error( "DirectSpaceSolver::crystal_structure(): wrong number of molecules." );
+    CrystalStructure result;
+    result.set_crystal_lattice( crystal_lattice_ );
+    result.set_space_group( space_group_ );
+    std::vector< Vector3D > positions;
+    for ( size_t m( 0 ); m != molecules_.size(); ++m )
+    {
+        molecules_[m].generate( states[m].orientation_.rotation_matrix(), states[m].torsion_changes_, positions );
+        for ( size_t j( 0 ); j != positions.size(); ++j )
+        {
+            Atom atom = molecules_[m].atom( j );
+            atom.set_position( states[m].position_ + crystal_lattice_.orthogonal_to_fractional( positions[j] ) );
+            if ( molecules_.size() > 1 )
+                atom.set_label( atom.label() + "_" + size_t2string( m + 1 ) );
+            result.add_atom( atom );
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+MoleculeState DirectSpaceSolver::random_state( const size_t molecule, RandomNumberGenerator_double & random_number_generator ) const
+{
+    MoleculeState result;
+    const double x = random_number_generator.next_number();
+    const double y = random_number_generator.next_number();
+    const double z = random_number_generator.next_number();
+    result.position_ = Vector3D( x, y, z );
+    // A uniformly distributed orientation, as in RandomQuaternionGenerator
+    const double u1 = random_number_generator.next_number();
+    const double u2 = random_number_generator.next_number();
+    const double u3 = random_number_generator.next_number();
+    result.orientation_ = Quaternion( std::sqrt( 1.0 - u1 ) * std::sin( 2.0 * CONSTANT_PI * u2 ), std::sqrt( 1.0 - u1 ) * std::cos( 2.0 * CONSTANT_PI * u2 ),
+                                      std::sqrt( u1 ) * std::sin( 2.0 * CONSTANT_PI * u3 ), std::sqrt( u1 ) * std::cos( 2.0 * CONSTANT_PI * u3 ) );
+    for ( size_t i( 0 ); i != molecules_[molecule].ntorsions(); ++i )
+        result.torsion_changes_.push_back( Angle::from_degrees( 360.0 * random_number_generator.next_number() - 180.0 ) );
+    return result;
+}
+
+// ********************************************************************************
+
+std::string DirectSpaceSolver::checkpoint_key( const size_t nruns ) const
+{
+    std::string result = "DirectSpaceSolver " + space_group_.name() + " " + size_t2string( space_group_.nsymmetry_operators() ) + " " +
+                         double2string( crystal_lattice_.a(), 8 ) + " " + double2string( crystal_lattice_.b(), 8 ) + " " + double2string( crystal_lattice_.c(), 8 ) + " " +
+                         double2string( crystal_lattice_.alpha().value_in_degrees(), 8 ) + " " + double2string( crystal_lattice_.beta().value_in_degrees(), 8 ) + " " + double2string( crystal_lattice_.gamma().value_in_degrees(), 8 ) + " " +
+                         size_t2string( nreflections() ) + " " + size_t2string( observed_.size() ) + " " + double2string( sum_weighted_observed_squared_, 12 ) + " " +
+                         size_t2string( nruns ) + " " + size_t2string( ntrials_ ) + " " + int2string( seed_ ) + " " +
+                         double2string( temperature_start_, 8 ) + " " + double2string( temperature_end_, 8 ) + " " + double2string( translation_step_, 8 ) + " " +
+                         double2string( rotation_step_.value_in_degrees(), 8 ) + " " + double2string( torsion_step_.value_in_degrees(), 8 );
+    for ( size_t i( 0 ); i != molecules_.size(); ++i )
+        result += " " + size_t2string( molecules_[i].natoms() ) + " " + size_t2string( molecules_[i].ntorsions() );
+    return result;
+}
+
+// ********************************************************************************
+
+void DirectSpaceSolver::anneal( RandomNumberGenerator_double & random_number_generator, std::vector< MoleculeState > & best_states, double & best_Rwp ) const
+{
+    const size_t nmolecules = molecules_.size();
+    std::vector< MoleculeState > states( nmolecules );
+    std::vector< MoleculeTerms > terms( nmolecules );
+    for ( size_t m( 0 ); m != nmolecules; ++m )
+    {
+        states[m] = random_state( m, random_number_generator );
+        calculate_transform( m, states[m], terms[m] );
+        calculate_phase_factors( states[m], terms[m] );
+        calculate_contribution( terms[m] );
+    }
+    std::vector< double > intensities;
+    std::vector< double > pattern;
+    double current_Rwp = Rwp( terms, intensities, pattern );
+    best_states = states;
+    best_Rwp = current_Rwp;
+    const Matrix3D & orthogonal_to_fractional = crystal_lattice_.orthogonal_to_fractional_matrix();
+    const double cooling = ( ntrials_ > 1 ) ? std::pow( temperature_end_ / temperature_start_, 1.0 / ( ntrials_ - 1 ) ) : 1.0;
+    double temperature = temperature_start_;
+    MoleculeTerms trial_terms;
+    // The step sizes of translations, rotations and torsions are scaled to keep the acceptance ratio between 20% and 50%,
+    // so that the steps become smaller as the temperature drops and the structure settles into a minimum
+    double step_scales[3] = { 1.0, 1.0, 1.0 };
+    size_t nattempts[3] = { 0, 0, 0 };
+    size_t naccepted[3] = { 0, 0, 0 };
+    for ( size_t t( 0 ); t != ntrials_; ++t, temperature *= cooling )
+    {
+        const size_t m = std::min( nmolecules - 1, static_cast<size_t>( random_number_generator.next_number() * nmolecules ) );
+        MoleculeState trial_state = states[m];
+        trial_terms = terms[m];
+        // Move 0 is a translation, 1 a rotation and the others change one torsion angle
+        const size_t nmoves = 2 + molecules_[m].ntorsions();
+        const size_t move = std::min( nmoves - 1, static_cast<size_t>( random_number_generator.next_number() * nmoves ) );
+        const size_t move_type = std::min( move, size_t( 2 ) );
+        const double step_scale = step_scales[move_type];
+        if ( move == 0 )
+        {
+            const double dx = 2.0 * random_number_generator.next_number() - 1.0;
+            const double dy = 2.0 * random_number_generator.next_number() - 1.0;
+            const double dz = 2.0 * random_number_generator.next_number() - 1.0;
+            const Vector3D shift = orthogonal_to_fractional * ( ( step_scale * translation_step_ ) * Vector3D( dx, dy, dz ) );
+            const Vector3D & position = trial_state.position_;
+            trial_state.position_ = Vector3D( wrap( position.x() + shift.x() ), wrap( position.y() + shift.y() ), wrap( position.z() + shift.z() ) );
+            // Only the phase factors of the centroid change
+            calculate_phase_factors( trial_state, trial_terms );
+        }
+        else
+        {
+            if ( move == 1 )
+            {
+                Vector3D axis;
+                do
+                {
+                    const double x = 2.0 * random_number_generator.next_number() - 1.0;
+                    const double y = 2.0 * random_number_generator.next_number() - 1.0;
+                    const double z = 2.0 * random_number_generator.next_number() - 1.0;
+                    axis = Vector3D( x, y, z );
+                }
+                while ( ( axis.norm2() > 1.0 ) || ( axis.norm2() < 0.01 ) );
+                axis /= axis.length();
+                const Angle half_angle = 0.5 * step_scale * ( 2.0 * random_number_generator.next_number() - 1.0 ) * rotation_step_;
+                const double sine = half_angle.sine();
+                trial_state.orientation_ = Quaternion( half_angle.cosine(), sine * axis.x(), sine * axis.y(), sine * axis.z() ) * trial_state.orientation_;
+            }
+            else
+                trial_state.torsion_changes_[ move - 2 ] += step_scale * ( 2.0 * random_number_generator.next_number() - 1.0 ) * torsion_step_;
+            calculate_transform( m, trial_state, trial_terms );
+        }
+        calculate_contribution( trial_terms );
+        // The contributions of the other molecules are reused
+        std::swap( terms[m], trial_terms );
+        const double trial_Rwp = Rwp( terms, intensities, pattern );
+        ++nattempts[move_type];
+        if ( ( trial_Rwp <= current_Rwp ) || ( random_number_generator.next_number() < std::exp( -( trial_Rwp - current_Rwp ) / temperature ) ) )
+        {
+            ++naccepted[move_type];
+            states[m] = trial_state;
+            current_Rwp = trial_Rwp;
+            if ( current_Rwp < best_Rwp )
+            {
+                best_states = states;
+                best_Rwp = current_Rwp;
+            }
+        }
+        else
+            std::swap( terms[m], trial_terms );
+        if ( nattempts[move_type] == 50 )
+        {
+            if ( naccepted[move_type] < 10 )
+                step_scales[move_type] = std::max( 0.01, 0.8 * step_scales[move_type] );
+            else if ( naccepted[move_type] > 25 )
+                step_scales[move_type] = std::min( 1.0, 1.25 * step_scales[move_type] );
+            nattempts[move_type] = 0;
+            naccepted[move_type] = 0;
+        }
+    }
+}
+
+// ********************************************************************************
+
+void DirectSpaceSolver::solve()
+{
+    MACRO_SCOPED_TIMER( "DirectSpaceSolver::solve()" );
+    if ( molecules_.empty() )
+        throw std::runtime_error( "DirectSpaceSolver::solve(): no molecules." );
+    const size_t nthreads = ( nthreads_ == 0 ) ? default_nthreads() : nthreads_;
+    const size_t nruns = ( nruns_ == 0 ) ? nthreads : nruns_;
+    std::vector< RandomNumberGenerator_double > random_number_generators = RandomNumberGenerator_double( seed_, XOSHIRO256STARSTAR ).split( nruns );
+    std::vector< std::vector< MoleculeState > > states( nruns );
+    std::vector< double > Rwps( nruns );
+    // The runs are independent, so the runs in the checkpoint are simply not repeated.
+    const bool use_checkpoint = ! checkpoint_file_name_.full_name().empty();
+    const std::string key = use_checkpoint ? checkpoint_key( nruns ) : std::string();
+    std::vector< bool > is_done( nruns, false );
+    if ( use_checkpoint )
+    {
+        CheckpointReader checkpoint_reader;
+        if ( checkpoint_reader.load( checkpoint_file_name_, key ) )
+        {
+            while ( ! checkpoint_reader.at_end() )
+            {
+                size_t i;
+                checkpoint_reader.read( i );
+                if ( i >= nruns )
+                    throw std::runtime_error( "DirectSpaceSolver::solve(): checkpoint " + checkpoint_file_name_.full_name() + " is inconsistent." );
+                checkpoint_reader.read( Rwps[i] );
+                states[i] = std::vector< MoleculeState >( molecules_.size() );
+                for ( size_t j( 0 ); j != molecules_.size(); ++j )
+                {
+                    checkpoint_reader.read( states[i][j].position_ );
+                    checkpoint_reader.read( states[i][j].orientation_ );
+                    checkpoint_reader.read( states[i][j].torsion_changes_ );
+                }
+                is_done[i] = true;
+            }
+        }
+    }
+    std::vector< size_t > runs;
+    for ( size_t i( 0 ); i != nruns; ++i )
+    {
+        if ( ! is_done[i] )
+            runs.push_back( i );
+    }
+    if ( runs.size() != nruns )
+        log_info( "Resuming from the checkpoint, " + size_t2string( nruns - runs.size() ) + " of " + size_t2string( nruns ) + " runs have finished." );
+    std::mutex checkpoint_mutex;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    parallel_for( runs.size(), nthreads, [&]( const size_t k )
+    {
+        const size_t i = runs[k];
+        anneal( random_number_generators[i], states[i], Rwps[i] );
+        if ( ! use_checkpoint )
+            return;
+        std::lock_guard< std::mutex > lock( checkpoint_mutex );
+        is_done[i] = true;
+        CheckpointWriter checkpoint_writer;
+        for ( size_t j( 0 ); j != nruns; ++j )
+        {
+            if ( ! is_done[j] )
+                continue;
+            checkpoint_writer.write( j );
+            checkpoint_writer.write( Rwps[j] );
+            for ( size_t m( 0 ); m != molecules_.size(); ++m )
+            {
+                checkpoint_writer.write( states[j][m].position_ );
+                checkpoint_writer.write( states[j][m].orientation_ );
+                checkpoint_writer.write( states[j][m].torsion_changes_ );
+            }
+        }
+        checkpoint_writer.save( checkpoint_file_name_, key );
+    } );
+    const double elapsed = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    const size_t best = std::min_element( Rwps.begin(), Rwps.end() ) - Rwps.begin();
+    best_Rwp_ = Rwps[best];
+    best_states_ = states[best];
+    ntrials_total_ = nruns * ntrials_;
+    MACRO_COUNT( "direct-space trials", runs.size() * ntrials_ );
+    trials_per_second_per_thread_ = ( ( elapsed > 0.0 ) && ( ! runs.empty() ) ) ? ( runs.size() * ntrials_ ) / ( elapsed * std::min( nthreads, runs.size() ) ) : 0.0;
+    log_info( "Best Rwp " + double2string( best_Rwp_ ) + " after " + size_t2string( nruns ) + " runs of " + size_t2string( ntrials_ ) + " trials, " +
+              double2string( trials_per_second_per_thread_, 0 ) + " trials per second per thread." );
+}
+
+// ********************************************************************************
+
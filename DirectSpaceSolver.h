@@ -0,0 +1,161 @@
+#ifndef DIRECTSPACESOLVER_H
+#define DIRECTSPACESOLVER_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Angle.h"
+#include "CrystalLattice.h"
+#include "FileName.h"
+#include "FlexibleMolecule.h"
+#include "Quaternion.h"
+#include "SpaceGroup.h"
+#include "Vector3D.h"
+
+class CrystalStructure;
+class PowderPattern;
+class RandomNumberGenerator_double;
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+// The position, orientation and conformation of one molecule in the asymmetric unit.
+struct MoleculeState
+{
+    Vector3D position_; // Fractional coordinates of the centroid
+    Quaternion orientation_;
+    std::vector< Angle > torsion_changes_; // See FlexibleMolecule::generate()
+};
+
+/*
+  Direct-space structure solution by parallel simulated annealing against an experimental powder pattern.
+
+  The molecules in the asymmetric unit are moved as rigid bodies with torsional degrees of freedom, the cost function is Rwp
+  with the optimal scale factor. The lattice, and therefore the reflection list, the LP factors and the peak profiles, are fixed,
+  so they are calculated once. For each molecule and each symmetry operator the molecular transform ( sum over the atoms of
+  f_j * T_j * exp( 2 pi i hR.x_j ) with x_j relative to the centroid ) and the phase factor of the centroid are stored:
+  a translation of a molecule only recalculates its phase factors, a rotation or torsion change only recalculates the transform
+  of the molecule that moved, and the contributions of the other molecules are reused.
+
+  Each run is an independent annealing from a random starting point with its own random number generator (jumped xoshiro256**),
+  runs are distributed over the threads and the best run wins, so the result does not depend on the number of threads.
+
+  The experimental pattern must be background subtracted, its ESDs are used as weights. The peak shape is a pseudo-Voigt with eta = 0.9,
+  as in PowderPatternCalculator. The molecules are assumed to be on general positions; the temperature factors are the Uiso of the atoms.
+*/
+class DirectSpaceSolver
+{
+public:
+
+    DirectSpaceSolver( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group, const PowderPattern & experimental_pattern, const double FWHM = 0.1 );
+
+    // Call once for each molecule in the asymmetric unit.
+    void add_molecule( const FlexibleMolecule & molecule );
+    size_t nmolecules() const { return molecules_.size(); }
+
+    void set_nruns( const size_t nruns ) { nruns_ = nruns; }
+    void set_ntrials( const size_t ntrials ) { ntrials_ = ntrials; } // Per run
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; } // 0 means one per core
+    void set_seed( const int seed ) { seed_ = seed; }
+    // The temperature decreases geometrically from start to end, in units of Rwp.
+    void set_temperatures( const double start, const double end ) { temperature_start_ = start; temperature_end_ = end; }
+    // The maximum step sizes of a move, translation is in Angstrom. During a run the steps are scaled down
+    // to keep the acceptance ratio between 20% and 50%.
+    void set_step_sizes( const double translation, const Angle rotation, const Angle torsion ) { translation_step_ = translation; rotation_step_ = rotation; torsion_step_ = torsion; }
+    // Every finished run is saved to the checkpoint file. If solve() is stopped, calling it again with the same settings
+    // only does the runs that had not finished, the result is the same as that of an uninterrupted solve().
+    void set_checkpoint( const FileName & file_name ) { checkpoint_file_name_ = file_name; }
+
+    size_t nreflections() const { return intensity_factors_.size(); }
+
+    void solve();
+
+    double best_Rwp() const { return best_Rwp_; }
+    const std::vector< MoleculeState > & best_states() const { return best_states_; }
+    size_t ntrials_total() const { return ntrials_total_; }
+    double trials_per_second_per_thread() const { return trials_per_second_per_thread_; }
+
+    // Rwp calculated from scratch with the same model as the annealing.
+    double Rwp( const std::vector< MoleculeState > & states ) const;
+
+    // The asymmetric unit, the space-group symmetry has not been applied.
+    CrystalStructure crystal_structure( const std::vector< MoleculeState > & states ) const;
+
+private:
+    CrystalLattice crystal_lattice_;
+    SpaceGroup space_group_;
+    std::vector< FlexibleMolecule > molecules_;
+    size_t nruns_;
+    size_t ntrials_;
+    size_t nthreads_;
+    int seed_;
+    double temperature_start_;
+    double temperature_end_;
+    double translation_step_;
+    Angle rotation_step_;
+    Angle torsion_step_;
+    double best_Rwp_;
+    std::vector< MoleculeState > best_states_;
+    size_t ntrials_total_;
+    double trials_per_second_per_thread_;
+    FileName checkpoint_file_name_;
+
+    // Fixed tables. Per reflection i and symmetry operator s (index i * nsymmetry_operators + s): hR and h.t.
+    std::vector< double > hR_x_;
+    std::vector< double > hR_y_;
+    std::vector< double > hR_z_;
+    std::vector< double > ht_;
+    std::vector< double > sine_theta_over_lambda_;
+    std::vector< double > intensity_factors_; // Multiplicity times LP factor
+    // Peak profiles on the 2theta points of the experimental pattern
+    std::vector< size_t > profile_first_;
+    std::vector< size_t > profile_offsets_;
+    std::vector< double > profile_values_;
+    std::vector< double > observed_;
+    std::vector< double > weights_;
+    double sum_weighted_observed_squared_;
+    // Per molecule: f * T * occupancy, index i * natoms + j
+    std::vector< std::vector< double > > atom_weights_;
+
+    struct MoleculeTerms;
+
+    void calculate_transform( const size_t molecule, const MoleculeState & state, MoleculeTerms & terms ) const;
+    void calculate_phase_factors( const MoleculeState & state, MoleculeTerms & terms ) const;
+    void calculate_contribution( MoleculeTerms & terms ) const;
+    double Rwp( const std::vector< MoleculeTerms > & terms, std::vector< double > & intensities, std::vector< double > & pattern ) const;
+    MoleculeState random_state( const size_t molecule, RandomNumberGenerator_double & random_number_generator ) const;
+    // One simulated-annealing run.
+    void anneal( RandomNumberGenerator_double & random_number_generator, std::vector< MoleculeState > & best_states, double & best_Rwp ) const;
+
+    // Everything the result of a run depends on.
+    std::string checkpoint_key( const size_t nruns ) const;
+};
+
+#endif // DIRECTSPACESOLVER_H
+
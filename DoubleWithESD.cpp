@@ -34,34 +34,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // ********************************************************************************
 
 // At the moment, can only cope with "0.12345(6)"
-DoubleWithESD::DoubleWithESD( std::string input )
+DoubleWithESD::DoubleWithESD( const std::string_view input )
 {
     if ( input.empty() )
-        throw std::runtime_error( "DoubleWithESD::DoubleWithESD( const std::string & ): input is empty." );
-    // Check if there is a "("
-    size_t iPos = input.find_first_of( '(' );
-    // Check if last character is a ")"
-    bool ends_in_parenthesis = ( input[ input.length()-1 ] == ')' );
-    if ( iPos == std::string::npos )
-    {
-        if ( ends_in_parenthesis )
-            throw std::runtime_error( "DoubleWithESD::DoubleWithESD( const std::string & ): no opening parenthesis." );
-        no_esd_ = true;
-        estimated_standard_deviation_ = 0.0;
-    }
-    else
-    {
-        if ( ! ends_in_parenthesis )
-            throw std::runtime_error( "DoubleWithESD::DoubleWithESD( const std::string & ): no closing parenthesis." );
-        no_esd_ = false;
-        std::string esd_str = input.substr( iPos+1, (input.length()-1)-(iPos+1) );
-        input.erase( iPos );
-        iPos = input.find_first_of( '.' );
-        if ( iPos == std::string::npos )
-            throw std::runtime_error( "DoubleWithESD::DoubleWithESD( const std::string & ): value must be floating point." );
-        estimated_standard_deviation_ = string2integer( esd_str ) * std::pow( 10.0, -static_cast<double>(input.length() - 1 - iPos) );
-    }
-    value_ = string2double( input );
+        throw std::runtime_error( "DoubleWithESD::DoubleWithESD( std::string_view ): input is empty." );
+    const ParsedNumber parsed_number = parse_number( input );
+    value_ = parsed_number.value_;
+    estimated_standard_deviation_ = parsed_number.estimated_standard_deviation_;
+    no_esd_ = ! parsed_number.has_esd_;
 }
 
 // ********************************************************************************
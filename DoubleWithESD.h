@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include <string>
+#include <string_view>
 
 /*
   A value with an ESD.
@@ -45,8 +46,8 @@ public:
 
     DoubleWithESD( const double value, const double estimated_standard_deviation ): value_(value), estimated_standard_deviation_(estimated_standard_deviation), no_esd_(false) {}
 
-    // At the moment, can only cope with "0.12345(6)"
-    explicit DoubleWithESD( std::string input );
+    // "0.12345(6)", "1234(5)" or "0.12345", see parse_number().
+    explicit DoubleWithESD( const std::string_view input );
 
     double value() const { return value_;}
 
@@ -26,11 +26,22 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "DrunkardsWalk.h"
+#include "Histogram.h"
 #include "MathFunctions.h"
 
+#include <climits>
 #include <cmath>
 #include <stdexcept>
 
+namespace
+{
+
+// Two random bits per walker. 0 = -x, 1 = -y, 2 = +x, 3 = +y, as in DrunkardsWalk::next_step()
+inline int step_x( const uint64_t direction ) { return ( 1 - static_cast<int>( direction & 1 ) ) * ( static_cast<int>( direction & 2 ) - 1 ); }
+inline int step_y( const uint64_t direction ) { return static_cast<int>( direction & 1 ) * ( static_cast<int>( direction & 2 ) - 1 ); }
+
+} // namespace
+
 // ********************************************************************************
 
 DrunkardsWalk::DrunkardsWalk( const int idum ):bag_of_numbers_( 4, idum )
@@ -133,3 +144,169 @@ double DrunkardsWalk::displacement() const
 
 // ********************************************************************************
 
+DrunkardsWalkEnsemble::DrunkardsWalkEnsemble( const size_t nwalkers, const GridPoint2D start_position, const uint64_t seed ):
+start_position_(start_position),
+lower_left_( INT_MIN / 2, INT_MIN / 2 ),
+upper_right_( INT_MAX / 2, INT_MAX / 2 ),
+rng_(seed)
+{
+    initialise( nwalkers );
+}
+
+// ********************************************************************************
+
+DrunkardsWalkEnsemble::DrunkardsWalkEnsemble( const size_t nwalkers, const GridPoint2D lower_left, const GridPoint2D upper_right, const GridPoint2D start_position, const uint64_t seed ):
+start_position_(start_position),
+lower_left_(lower_left),
+upper_right_(upper_right),
+rng_(seed)
+{
+    if ( ( start_position.x_ < lower_left.x_ ) || ( start_position.x_ > upper_right.x_ ) ||
+         ( start_position.y_ < lower_left.y_ ) || ( start_position.y_ > upper_right.y_ ) )
+        throw std::runtime_error( "DrunkardsWalkEnsemble::DrunkardsWalkEnsemble(): boundaries inconsistent" );
+    if ( ( lower_left.x_ == upper_right.x_ ) && ( lower_left.y_ == upper_right.y_ ) )
+        throw std::runtime_error( "DrunkardsWalkEnsemble::DrunkardsWalkEnsemble(): boundaries inconsistent" );
+    initialise( nwalkers );
+}
+
+// ********************************************************************************
+
+void DrunkardsWalkEnsemble::initialise( const size_t nwalkers )
+{
+    if ( nwalkers == 0 )
+        throw std::runtime_error( "DrunkardsWalkEnsemble::initialise(): no walkers." );
+    x_ = std::vector< int >( nwalkers, start_position_.x_ );
+    y_ = std::vector< int >( nwalkers, start_position_.y_ );
+    first_passage_times_ = std::vector< uint32_t >( nwalkers, 0 );
+    first_passage_distance_squared_ = -1;
+    nsteps_ = 0;
+    random_bits_.resize( ( nwalkers + 31 ) / 32 );
+    redraw_.resize( nwalkers );
+}
+
+// ********************************************************************************
+
+void DrunkardsWalkEnsemble::run( const size_t nsteps )
+{
+    const size_t n = nwalkers();
+    const int x_min = lower_left_.x_;
+    const int x_max = upper_right_.x_;
+    const int y_min = lower_left_.y_;
+    const int y_max = upper_right_.y_;
+    int * x = &x_[0];
+    int * y = &y_[0];
+    const uint64_t * bits = &random_bits_[0];
+    uint32_t * redraw = &redraw_[0];
+    for ( size_t step( 0 ); step != nsteps; ++step )
+    {
+        rng_.fill( &random_bits_[0], random_bits_.size() );
+        size_t nredraw( 0 );
+        for ( size_t i( 0 ); i != n; ++i )
+        {
+            const uint64_t direction = ( bits[i >> 5] >> ( 2 * ( i & 31 ) ) ) & 3;
+            const int new_x = x[i] + step_x( direction );
+            const int new_y = y[i] + step_y( direction );
+            const bool valid = ( new_x >= x_min ) & ( new_x <= x_max ) & ( new_y >= y_min ) & ( new_y <= y_max );
+            x[i] = valid ? new_x : x[i];
+            y[i] = valid ? new_y : y[i];
+            // Branch-free compaction of the walkers that must draw again
+            redraw[nredraw] = static_cast<uint32_t>( i );
+            nredraw += ! valid;
+        }
+        // Only walkers at the boundary of a finite grid, which have at least one valid move
+        while ( nredraw != 0 )
+        {
+            const size_t nwords = ( nredraw + 31 ) / 32;
+            rng_.fill( &random_bits_[0], nwords );
+            size_t nstill_invalid( 0 );
+            for ( size_t j( 0 ); j != nredraw; ++j )
+            {
+                const size_t i = redraw[j];
+                const uint64_t direction = ( bits[j >> 5] >> ( 2 * ( j & 31 ) ) ) & 3;
+                const int new_x = x[i] + step_x( direction );
+                const int new_y = y[i] + step_y( direction );
+                const bool valid = ( new_x >= x_min ) & ( new_x <= x_max ) & ( new_y >= y_min ) & ( new_y <= y_max );
+                x[i] = valid ? new_x : x[i];
+                y[i] = valid ? new_y : y[i];
+                redraw[nstill_invalid] = static_cast<uint32_t>( i );
+                nstill_invalid += ! valid;
+            }
+            nredraw = nstill_invalid;
+        }
+        ++nsteps_;
+        if ( first_passage_distance_squared_ >= 0 )
+        {
+            const long long x0 = start_position_.x_;
+            const long long y0 = start_position_.y_;
+            const long long d2 = first_passage_distance_squared_;
+            const uint32_t current_step = static_cast<uint32_t>( nsteps_ );
+            uint32_t * times = &first_passage_times_[0];
+            for ( size_t i( 0 ); i != n; ++i )
+            {
+                const long long dx = x[i] - x0;
+                const long long dy = y[i] - y0;
+                const bool passed = ( times[i] == 0 ) & ( dx * dx + dy * dy >= d2 );
+                times[i] = passed ? current_step : times[i];
+            }
+        }
+    }
+}
+
+// ********************************************************************************
+
+double DrunkardsWalkEnsemble::displacement( const size_t i ) const
+{
+    const double dx = static_cast<double>( x_[i] ) - static_cast<double>( start_position_.x_ );
+    const double dy = static_cast<double>( y_[i] ) - static_cast<double>( start_position_.y_ );
+    return sqrt( dx * dx + dy * dy );
+}
+
+// ********************************************************************************
+
+double DrunkardsWalkEnsemble::mean_squared_displacement() const
+{
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != nwalkers(); ++i )
+    {
+        const double dx = static_cast<double>( x_[i] ) - static_cast<double>( start_position_.x_ );
+        const double dy = static_cast<double>( y_[i] ) - static_cast<double>( start_position_.y_ );
+        result += dx * dx + dy * dy;
+    }
+    return result / nwalkers();
+}
+
+// ********************************************************************************
+
+void DrunkardsWalkEnsemble::set_first_passage_distance( const double distance )
+{
+    if ( distance < 0.0 )
+        throw std::runtime_error( "DrunkardsWalkEnsemble::set_first_passage_distance(): distance must be positive." );
+    first_passage_distance_squared_ = static_cast<long long>( std::ceil( distance * distance ) );
+    first_passage_times_ = std::vector< uint32_t >( nwalkers(), 0 );
+}
+
+// ********************************************************************************
+
+void DrunkardsWalkEnsemble::add_displacements( Histogram & histogram ) const
+{
+    for ( size_t i( 0 ); i != nwalkers(); ++i )
+        histogram.add_data( displacement( i ) );
+}
+
+// ********************************************************************************
+
+size_t DrunkardsWalkEnsemble::add_first_passage_times( Histogram & histogram ) const
+{
+    size_t nskipped( 0 );
+    for ( size_t i( 0 ); i != nwalkers(); ++i )
+    {
+        if ( first_passage_times_[i] == 0 )
+            ++nskipped;
+        else
+            histogram.add_data( static_cast<double>( first_passage_times_[i] ) );
+    }
+    return nskipped;
+}
+
+// ********************************************************************************
+
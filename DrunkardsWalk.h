@@ -28,9 +28,14 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+class Histogram;
+
 #include "BagOfNumbers.h"
+#include "Xoshiro256StarStar.h"
 
 #include <cmath>
+#include <cstdint>
+#include <vector>
 
 struct GridPoint2D
 {
@@ -81,5 +86,64 @@ private:
     BagOfNumbers bag_of_numbers_;
 };
 
+/*
+  Many independent drunkards at once, for diffusion statistics.
+
+  The positions are stored as separate arrays of x and y. Each step draws 2 bits per walker in bulk (32 walkers per 64-bit number)
+  and the boundaries are applied with selects instead of branches. As in DrunkardsWalk::next_step(), a move that would leave
+  a finite grid is redrawn, so a walker never stands still; only the walkers at the boundary are redrawn.
+
+  Paths are not stored: the displacements and first-passage times are available at any moment and can be added to a Histogram.
+*/
+class DrunkardsWalkEnsemble
+{
+public:
+
+    // Infinite grid
+    DrunkardsWalkEnsemble( const size_t nwalkers, const GridPoint2D start_position, const uint64_t seed = 1539 );
+
+    // Finite grid
+    DrunkardsWalkEnsemble( const size_t nwalkers, const GridPoint2D lower_left, const GridPoint2D upper_right, const GridPoint2D start_position, const uint64_t seed = 1539 );
+
+    size_t nwalkers() const { return x_.size(); }
+    size_t nsteps() const { return nsteps_; }
+
+    // Every walker takes nsteps steps.
+    void run( const size_t nsteps );
+
+    GridPoint2D position( const size_t i ) const { return GridPoint2D( x_[i], y_[i] ); }
+
+    // Euclidean distance from the start.
+    double displacement( const size_t i ) const;
+
+    double mean_squared_displacement() const;
+
+    // From now on, records for each walker the first step at which its displacement is >= distance.
+    void set_first_passage_distance( const double distance );
+
+    // 0 if the walker has not reached the first-passage distance yet.
+    size_t first_passage_time( const size_t i ) const { return first_passage_times_[i]; }
+
+    void add_displacements( Histogram & histogram ) const;
+
+    // Walkers that have not reached the first-passage distance yet are skipped, returns how many were skipped.
+    size_t add_first_passage_times( Histogram & histogram ) const;
+
+private:
+    GridPoint2D start_position_;
+    GridPoint2D lower_left_;
+    GridPoint2D upper_right_;
+    std::vector< int > x_;
+    std::vector< int > y_;
+    std::vector< uint32_t > first_passage_times_;
+    long long first_passage_distance_squared_; // Negative if not set
+    size_t nsteps_;
+    Xoshiro256StarStar rng_;
+    std::vector< uint64_t > random_bits_;
+    std::vector< uint32_t > redraw_;
+
+    void initialise( const size_t nwalkers );
+};
+
 #endif // DRUNKARDSWALK_H
 
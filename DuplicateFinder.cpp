@@ -0,0 +1,189 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "DuplicateFinder.h"
+#include "Clustering.h"
+#include "CrystalStructure.h"
+#include "NiggliReduction.h"
+#include "ParallelFor.h"
+#include "PowderPattern.h"
+#include "PowderPatternIndex.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// ********************************************************************************
+
+DuplicateFinder::DuplicateFinder():
+density_tolerance_(0.02),
+volume_tolerance_(0.03),
+G6_tolerance_(5.0),
+fingerprint_margin_(0.05),
+similarity_threshold_(0.95),
+l_( Angle( 1.0, Angle::DEGREES ) ),
+RMSCD_threshold_(0.3),
+nthreads_(0),
+npairs_( RMSCD + 1, 0 ),
+nduplicates_(0)
+{
+    powder_pattern_calculator_.set_wavelength( 1.54056 );
+    powder_pattern_calculator_.set_two_theta_start( Angle( 3.0, Angle::DEGREES ) );
+    powder_pattern_calculator_.set_two_theta_end( Angle( 35.0, Angle::DEGREES ) );
+    powder_pattern_calculator_.set_two_theta_step( Angle( 0.01, Angle::DEGREES ) );
+    powder_pattern_calculator_.set_FWHM( 0.1 );
+}
+
+// ********************************************************************************
+
+std::vector< size_t > DuplicateFinder::find_duplicates( const std::vector< CrystalStructure > & crystal_structures )
+{
+    const size_t n = crystal_structures.size();
+    npairs_.assign( RMSCD + 1, 0 );
+    nduplicates_ = 0;
+    // The cheap descriptors
+    std::vector< double > densities( n );
+    std::vector< std::vector< double > > G6s( n );
+    parallel_for( n, nthreads_, [&]( const size_t i )
+    {
+        densities[i] = crystal_structures[i].density();
+        G6s[i] = G6_vector( Niggli_reduce( primitive_cell( crystal_structures[i].crystal_lattice(), crystal_structures[i].space_group() ) ) );
+    } );
+    std::vector< size_t > order( n );
+    for ( size_t i( 0 ); i != n; ++i )
+        order[i] = i;
+    std::sort( order.begin(), order.end(), [&]( const size_t lhs, const size_t rhs ) { return densities[lhs] < densities[rhs]; } );
+    // The powder patterns and their fingerprints, for all structures, linear in n
+    powder_pattern_calculator_.set_nthreads( nthreads_ );
+    powder_pattern_calculator_.calculate( crystal_structures );
+    std::vector< PowderPattern > powder_patterns( n );
+    PowderPatternIndex powder_pattern_index( l_ );
+    powder_pattern_index.reserve( n );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        powder_patterns[i] = powder_pattern_calculator_.powder_pattern( i );
+        powder_pattern_index.push_back( powder_patterns[i] );
+    }
+    DuplicateGroups duplicate_groups( n, 0.5 );
+    std::vector< std::atomic< size_t > > npairs( RMSCD + 1 );
+    for ( size_t stage( 0 ); stage != npairs.size(); ++stage )
+        npairs[ stage ] = 0;
+    std::atomic< size_t > nduplicates( 0 );
+    parallel_for( n, nthreads_, [&]( const size_t p )
+    {
+        const size_t i = order[p];
+        const double maximum_density = densities[i] * ( 1.0 + density_tolerance_ );
+        for ( size_t q( p + 1 ); ( q != n ) && ( densities[ order[q] ] <= maximum_density ); ++q )
+        {
+            const size_t j = order[q];
+            ++npairs[ CANDIDATES ];
+            if ( duplicate_groups.are_in_same_group( i, j ) )
+                continue;
+            ++npairs[ DESCRIPTORS ];
+            if ( crystal_structures[i].natoms() != crystal_structures[j].natoms() )
+                continue;
+            const double volume_i = crystal_structures[i].crystal_lattice().volume();
+            const double volume_j = crystal_structures[j].crystal_lattice().volume();
+            if ( std::abs( volume_i - volume_j ) > volume_tolerance_ * std::max( volume_i, volume_j ) )
+                continue;
+            if ( G6_distance( G6s[i], G6s[j] ) > G6_tolerance_ )
+                continue;
+            ++npairs[ FINGERPRINT ];
+            if ( powder_pattern_index.estimated_similarity( i, j ) < similarity_threshold_ - fingerprint_margin_ )
+                continue;
+            ++npairs[ PATTERN ];
+            if ( normalised_weighted_cross_correlation( powder_patterns[i], powder_patterns[j], l_ ) < similarity_threshold_ )
+                continue;
+            ++npairs[ RMSCD ];
+            const double RMSCD_ij = RMSCD_unit_cell( crystal_structures[i], crystal_structures[j] );
+            if ( RMSCD_ij >= RMSCD_threshold_ )
+                continue;
+            ++nduplicates;
+            duplicate_groups.add( i, j, 1.0 );
+        }
+    } );
+    for ( size_t stage( 0 ); stage != npairs.size(); ++stage )
+        npairs_[ stage ] = npairs[ stage ];
+    nduplicates_ = nduplicates;
+    return duplicate_groups.groups();
+}
+
+// ********************************************************************************
+
+std::string DuplicateFinder::report() const
+{
+    const char * names[] = { "candidates", "descriptors", "fingerprint", "pattern", "RMSCD" };
+    std::string result;
+    for ( size_t stage( 0 ); stage != npairs_.size(); ++stage )
+        result += std::string( names[ stage ] ) + ": " + size_t2string( npairs_[ stage ] ) + " pairs\n";
+    result += "duplicates: " + size_t2string( nduplicates_ ) + " pairs";
+    return result;
+}
+
+// ********************************************************************************
+
+// ********************************************************************************
+
+double RMSCD_unit_cell( const CrystalStructure & lhs, const CrystalStructure & rhs )
+{
+    const CrystalLattice & lhs_lattice = lhs.crystal_lattice();
+    const CrystalLattice & rhs_lattice = rhs.crystal_lattice();
+    const CrystalLattice average_lattice( ( lhs_lattice.a() + rhs_lattice.a() ) / 2.0,
+                                          ( lhs_lattice.b() + rhs_lattice.b() ) / 2.0,
+                                          ( lhs_lattice.c() + rhs_lattice.c() ) / 2.0,
+                                          ( lhs_lattice.alpha() + rhs_lattice.alpha() ) / 2.0,
+                                          ( lhs_lattice.beta()  + rhs_lattice.beta()  ) / 2.0,
+                                          ( lhs_lattice.gamma() + rhs_lattice.gamma() ) / 2.0 );
+    double result = std::numeric_limits< double >::infinity();
+    for ( size_t ishift( 0 ); ishift != 8; ++ishift )
+    {
+        const Vector3D shift( 0.5 * ( ishift & 1 ), 0.5 * ( ( ishift >> 1 ) & 1 ), 0.5 * ( ( ishift >> 2 ) & 1 ) );
+        double sum( 0.0 );
+        size_t nnon_H_atoms( 0 );
+        for ( size_t i( 0 ); i != lhs.natoms(); ++i )
+        {
+            if ( lhs.atom( i ).element().is_H_or_D() )
+                continue;
+            ++nnon_H_atoms;
+            double smallest_distance2 = std::numeric_limits< double >::infinity();
+            for ( size_t j( 0 ); j != rhs.natoms(); ++j )
+            {
+                if ( rhs.atom( j ).element() == lhs.atom( i ).element() )
+                    smallest_distance2 = std::min( smallest_distance2, average_lattice.shortest_distance2( lhs.atom( i ).position(), rhs.atom( j ).position() + shift ) );
+            }
+            sum += smallest_distance2;
+        }
+        if ( nnon_H_atoms == 0 )
+            return 0.0;
+        result = std::min( result, sum / nnon_H_atoms );
+    }
+    return sqrt( result );
+}
+
@@ -0,0 +1,137 @@
+#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+
+#include "Angle.h"
+#include "BatchPowderPatternCalculator.h"
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+/*
+  Finds the duplicates in a list of crystal structures, e.g. a crystal structure prediction landscape, with a cascade of
+  ever more expensive filters, each of which only sees the pairs that passed the previous one:
+
+    CANDIDATES   densities within density_tolerance(); the structures are sorted by density and each one is only paired
+                 with the structures in its density window, so not all N(N-1)/2 pairs are generated
+    DESCRIPTORS  same number of atoms, volumes within volume_tolerance(), G6 distance of the reduced primitive cells
+                 less than G6_tolerance()
+    FINGERPRINT  estimate of the powder pattern similarity from PowderPatternIndex fingerprints at least
+                 similarity_threshold() - fingerprint_margin()
+    PATTERN      normalised_weighted_cross_correlation() at least similarity_threshold()
+    RMSCD        root mean square Cartesian displacement less than RMSCD_threshold(), each atom is matched to the
+                 nearest atom of the same element in the unit cell of the other structure, H and D are ignored
+
+  The pairs are processed as they are generated, on nthreads() threads, and confirmed duplicates are merged into groups
+  straight away. A pair whose structures are already in the same group is not compared.
+  The powder patterns are calculated once for all structures, with the settings of powder_pattern_calculator().
+
+  The G6 distance is not continuous at the boundaries of the Niggli cone, so set G6_tolerance() to a large value
+  if duplicates may have been reduced to different cells.
+*/
+class DuplicateFinder
+{
+public:
+
+    enum Stage { CANDIDATES, DESCRIPTORS, FINGERPRINT, PATTERN, RMSCD };
+
+    DuplicateFinder();
+
+    // Relative, the default is 0.02.
+    double density_tolerance() const { return density_tolerance_; }
+    void set_density_tolerance( const double density_tolerance ) { density_tolerance_ = density_tolerance; }
+
+    // Relative, the default is 0.03.
+    double volume_tolerance() const { return volume_tolerance_; }
+    void set_volume_tolerance( const double volume_tolerance ) { volume_tolerance_ = volume_tolerance; }
+
+    // In A^2, the default is 5.0.
+    double G6_tolerance() const { return G6_tolerance_; }
+    void set_G6_tolerance( const double G6_tolerance ) { G6_tolerance_ = G6_tolerance; }
+
+    // The default is 0.05.
+    double fingerprint_margin() const { return fingerprint_margin_; }
+    void set_fingerprint_margin( const double fingerprint_margin ) { fingerprint_margin_ = fingerprint_margin; }
+
+    // The default is 0.95.
+    double similarity_threshold() const { return similarity_threshold_; }
+    void set_similarity_threshold( const double similarity_threshold ) { similarity_threshold_ = similarity_threshold; }
+
+    // l as in normalised_weighted_cross_correlation(), the default is 1.0 degrees.
+    Angle l() const { return l_; }
+    void set_l( const Angle l ) { l_ = l; }
+
+    // In A, the default is 0.3.
+    double RMSCD_threshold() const { return RMSCD_threshold_; }
+    void set_RMSCD_threshold( const double RMSCD_threshold ) { RMSCD_threshold_ = RMSCD_threshold; }
+
+    // 0 means one thread per core.
+    size_t nthreads() const { return nthreads_; }
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; }
+
+    // The defaults are those of calculate_correlation_matrix( FileList ).
+    BatchPowderPatternCalculator & powder_pattern_calculator() { return powder_pattern_calculator_; }
+
+    // The space-group symmetry must have been applied. Returns the group number of every structure,
+    // groups are numbered in the order of their first member.
+    std::vector< size_t > find_duplicates( const std::vector< CrystalStructure > & crystal_structures );
+
+    // Of the last find_duplicates(): the number of pairs that were passed to each stage.
+    size_t npairs( const Stage stage ) const { return npairs_[ stage ]; }
+
+    // Of the last find_duplicates(): the number of pairs that passed all stages.
+    size_t nduplicates() const { return nduplicates_; }
+
+    // One line per stage with the number of pairs that reached it.
+    std::string report() const;
+
+private:
+    double density_tolerance_;
+    double volume_tolerance_;
+    double G6_tolerance_;
+    double fingerprint_margin_;
+    double similarity_threshold_;
+    Angle l_;
+    double RMSCD_threshold_;
+    size_t nthreads_;
+    BatchPowderPatternCalculator powder_pattern_calculator_;
+    std::vector< size_t > npairs_;
+    size_t nduplicates_;
+};
+
+// The RMSCD used by DuplicateFinder. RMSCD_with_matching() works on the asymmetric unit and reports every match on std::cout,
+// so here the atoms of the full unit cells are matched instead: each non-H atom of lhs to the nearest atom of the same element
+// in rhs, for each of the eight origin shifts of 1/2. Uses the average of the two lattices. Infinite if an element is missing.
+// Both structures must have had their space-group symmetry applied.
+double RMSCD_unit_cell( const CrystalStructure & lhs, const CrystalStructure & rhs );
+
+#endif // DUPLICATEFINDER_H
@@ -28,15 +28,90 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Eigenvalue.h"
 
 #include "3DCalculations.h"
+#include "MathConstants.h"
 #include "MathFunctions.h"
 #include "Matrix3D.h"
 #include "NormalisedVector3D.h"
 #include "SymmetricMatrix3D.h"
 #include "Vector3D.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <cmath>
 
+namespace
+{
+
+// Two eigenvalues closer than this, relative to the size of the matrix, count as degenerate.
+const double degeneracy_tolerance = 1.0E-5;
+
+// Eigenvalues, smallest first, of the symmetric matrix with unique elements a00, a11, a22, a01, a02, a12.
+// Trigonometric solution of the characteristic polynomial (O.K. Smith, Comm. ACM 4, 168 (1961)).
+// There are no branches, so that a loop over many matrices can be vectorised.
+// Returns a measure of the size of the matrix for the degeneracy test.
+inline double trigonometric_eigenvalues( const double a00, const double a11, const double a22,
+                                         const double a01, const double a02, const double a12,
+                                         double & l0, double & l1, double & l2 )
+{
+    const double q = ( a00 + a11 + a22 ) / 3.0;
+    const double b00 = a00 - q;
+    const double b11 = a11 - q;
+    const double b22 = a22 - q;
+    const double p = std::sqrt( ( b00*b00 + b11*b11 + b22*b22 + 2.0 * ( a01*a01 + a02*a02 + a12*a12 ) ) / 6.0 );
+    // For a scalar matrix p = 0 and all three eigenvalues are q
+    const double p_safe = ( p > 0.0 ) ? p : 1.0;
+    // r = det( ( A - qI ) / p ) / 2
+    const double det = b00 * ( b11*b22 - a12*a12 ) - a01 * ( a01*b22 - a12*a02 ) + a02 * ( a01*a12 - b11*a02 );
+    const double r = std::min( std::max( det / ( 2.0 * p_safe * p_safe * p_safe ), -1.0 ), 1.0 );
+    const double phi = std::acos( r ) / 3.0;
+    l2 = q + 2.0 * p * std::cos( phi );
+    l0 = q + 2.0 * p * std::cos( phi + ( 2.0 * CONSTANT_PI / 3.0 ) );
+    l1 = 3.0 * q - l0 - l2;
+    return std::abs( q ) + p;
+}
+
+// Unnormalised eigenvector for eigenvalue lambda: the longest cross product of two rows of A - lambda I.
+Vector3D eigenvector( const double a00, const double a11, const double a22,
+                      const double a01, const double a02, const double a12,
+                      const double lambda )
+{
+    const Vector3D r0( a00 - lambda, a01, a02 );
+    const Vector3D r1( a01, a11 - lambda, a12 );
+    const Vector3D r2( a02, a12, a22 - lambda );
+    const Vector3D c01 = cross_product( r0, r1 );
+    const Vector3D c02 = cross_product( r0, r2 );
+    const Vector3D c12 = cross_product( r1, r2 );
+    const double n01 = c01.norm2();
+    const double n02 = c02.norm2();
+    const double n12 = c12.norm2();
+    if ( ( n01 >= n02 ) && ( n01 >= n12 ) )
+        return c01;
+    return ( n02 >= n12 ) ? c02 : c12;
+}
+
+// Normalised eigenvectors belonging to l0, l1 and l2.
+// Returns false if two eigenvalues are too close together for the cross products to be accurate.
+bool analytical_eigenvectors( const double a00, const double a11, const double a22,
+                              const double a01, const double a02, const double a12,
+                              const double l0, const double l1, const double l2, const double scale,
+                              Vector3D & v0, Vector3D & v1, Vector3D & v2 )
+{
+    if ( ( ( l1 - l0 ) < degeneracy_tolerance * scale ) || ( ( l2 - l1 ) < degeneracy_tolerance * scale ) )
+        return false;
+    v0 = eigenvector( a00, a11, a22, a01, a02, a12, l0 );
+    v2 = eigenvector( a00, a11, a22, a01, a02, a12, l2 );
+    const double n0 = v0.norm2();
+    const double n2 = v2.norm2();
+    if ( ( n0 == 0.0 ) || ( n2 == 0.0 ) )
+        return false;
+    v0 /= std::sqrt( n0 );
+    v2 /= std::sqrt( n2 );
+    v1 = cross_product( v2, v0 );
+    return true;
+}
+
+} // namespace
+
 // ********************************************************************************
 
 /** Eigenvalues and eigenvectors of a real matrix.
@@ -65,6 +140,98 @@ void calculate_eigenvalues( const SymmetricMatrix3D & input, std::vector< double
 
 // ********************************************************************************
 
+void calculate_eigenvalues_analytical( const SymmetricMatrix3D & input, std::vector< double > & eigenvalues, std::vector< NormalisedVector3D > & eigenvectors )
+{
+    const double a00 = input.value( 0, 0 );
+    const double a11 = input.value( 1, 1 );
+    const double a22 = input.value( 2, 2 );
+    const double a01 = input.value( 0, 1 );
+    const double a02 = input.value( 0, 2 );
+    const double a12 = input.value( 1, 2 );
+    double l0;
+    double l1;
+    double l2;
+    const double scale = trigonometric_eigenvalues( a00, a11, a22, a01, a02, a12, l0, l1, l2 );
+    Vector3D v0;
+    Vector3D v1;
+    Vector3D v2;
+    if ( ! analytical_eigenvectors( a00, a11, a22, a01, a02, a12, l0, l1, l2, scale, v0, v1, v2 ) )
+    {
+        calculate_eigenvalues( input, eigenvalues, eigenvectors );
+        return;
+    }
+    eigenvalues.clear();
+    eigenvalues.push_back( l0 );
+    eigenvalues.push_back( l1 );
+    eigenvalues.push_back( l2 );
+    eigenvectors.clear();
+    eigenvectors.push_back( NormalisedVector3D( v0.x(), v0.y(), v0.z() ) );
+    eigenvectors.push_back( NormalisedVector3D( v1.x(), v1.y(), v1.z() ) );
+    eigenvectors.push_back( NormalisedVector3D( v2.x(), v2.y(), v2.z() ) );
+}
+
+// ********************************************************************************
+
+size_t calculate_eigenvalues( const std::vector< SymmetricMatrix3D > & input, std::vector< double > & eigenvalues, std::vector< double > & eigenvectors )
+{
+    const size_t n = input.size();
+    eigenvalues.resize( 3 * n );
+    eigenvectors.resize( 9 * n );
+    if ( n == 0 )
+        return 0;
+    // Structure of arrays
+    std::vector< double > elements( 6 * n );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        elements[         i ] = input[i].value( 0, 0 );
+        elements[     n + i ] = input[i].value( 1, 1 );
+        elements[ 2 * n + i ] = input[i].value( 2, 2 );
+        elements[ 3 * n + i ] = input[i].value( 0, 1 );
+        elements[ 4 * n + i ] = input[i].value( 0, 2 );
+        elements[ 5 * n + i ] = input[i].value( 1, 2 );
+    }
+    const double * a00 = &elements[0];
+    const double * a11 = a00 + n;
+    const double * a22 = a11 + n;
+    const double * a01 = a22 + n;
+    const double * a02 = a01 + n;
+    const double * a12 = a02 + n;
+    double * l0 = &eigenvalues[0];
+    double * l1 = l0 + n;
+    double * l2 = l1 + n;
+    std::vector< double > scale( n );
+    for ( size_t i( 0 ); i != n; ++i )
+        scale[i] = trigonometric_eigenvalues( a00[i], a11[i], a22[i], a01[i], a02[i], a12[i], l0[i], l1[i], l2[i] );
+    size_t nfallbacks( 0 );
+    Vector3D v[3];
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        if ( ! analytical_eigenvectors( a00[i], a11[i], a22[i], a01[i], a02[i], a12[i], l0[i], l1[i], l2[i], scale[i], v[0], v[1], v[2] ) )
+        {
+            Matrix3D V = SymmetricMatrix3D2Matrix3D( input[i] );
+            Vector3D d;
+            Vector3D e;
+            tred2( V, d, e );
+            tql2( V, d, e );
+            for ( size_t k( 0 ); k != 3; ++k )
+            {
+                eigenvalues[ k * n + i ] = d.value( k );
+                v[k] = Vector3D( V.value( 0, k ), V.value( 1, k ), V.value( 2, k ) );
+                v[k] /= v[k].length();
+            }
+            ++nfallbacks;
+        }
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            for ( size_t j( 0 ); j != 3; ++j )
+                eigenvectors[ ( 3 * k + j ) * n + i ] = v[k].value( j );
+        }
+    }
+    return nfallbacks;
+}
+
+// ********************************************************************************
+
 // Symmetric Householder reduction to tridiagonal form.
 void tred2( Matrix3D & V, Vector3D & d, Vector3D & e )
 {
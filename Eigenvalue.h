@@ -33,12 +33,27 @@ class NormalisedVector3D;
 class SymmetricMatrix3D;
 class Vector3D;
 
+#include <cstddef> // For definition of size_t
 #include <vector>
 
 // Eigenvectors are orthonormal (mutually orthogonal and normalised to 1).
 // Eigenvalues are sorted, smallest value first.
 void calculate_eigenvalues( const SymmetricMatrix3D & input, std::vector< double > & eigenvalues, std::vector< NormalisedVector3D > & eigenvectors );
 
+// As calculate_eigenvalues(), but with the closed-form trigonometric solution of the characteristic polynomial and
+// eigenvectors from cross products of the rows of A - lambda I, which is several times faster.
+// Falls back to calculate_eigenvalues() if two eigenvalues are so close that the cross products would be inaccurate.
+// The sign of each eigenvector is arbitrary and can differ from that returned by calculate_eigenvalues().
+void calculate_eigenvalues_analytical( const SymmetricMatrix3D & input, std::vector< double > & eigenvalues, std::vector< NormalisedVector3D > & eigenvectors );
+
+// Batched version of calculate_eigenvalues_analytical() for many matrices, e.g. all ADPs in a trajectory.
+// The results are stored as structure of arrays, n = input.size():
+//     eigenvalues[ k * n + i ] is eigenvalue k (smallest first) of input[ i ],
+//     eigenvectors[ ( 3 * k + j ) * n + i ] is component j of the corresponding eigenvector.
+// The eigenvalues of all matrices are calculated in one loop without branches so that it can be vectorised.
+// Returns the number of matrices that had to be handed to tred2() and tql2().
+size_t calculate_eigenvalues( const std::vector< SymmetricMatrix3D > & input, std::vector< double > & eigenvalues, std::vector< double > & eigenvectors );
+
 void tred2( Matrix3D & V, Vector3D & d, Vector3D & e );
 
 void tql2( Matrix3D & V, Vector3D & d, Vector3D & e );
@@ -228,6 +228,32 @@ static const double c[113] =
                         0.0000000
                    };
 
+// m_e e^2 / ( 8 pi^2 epsilon_0 h^2 ) in Angstrom^-1, converts ( Z - f_x ) / (sin(theta)/lambda)^2 to an electron scattering factor in Angstrom
+static const double Mott_Bethe_constant = 0.023934;
+
+// Coherent neutron scattering lengths in fm, V. F. Sears, Neutron News 3 (1992) 26-37.
+// 0.0 means not in table (no element has a coherent scattering length of exactly zero).
+static const double neutron_scattering_lengths[113] =
+                   {
+                         6.6710,  -3.7390,   3.2600,  -1.9000,   7.7900,   5.3000,   6.6460,
+                         9.3600,   5.8030,   5.6540,   4.5660,   3.6300,   5.3750,   3.4490,
+                         4.1491,   5.1300,   2.8470,   9.5770,   1.9090,   3.6700,   4.7000,
+                        12.2900,  -3.4380,  -0.3824,   3.6350,  -3.7300,   9.4500,   2.4900,
+                        10.3000,   7.7180,   5.6800,   7.2880,   8.1850,   6.5800,   7.9700,
+                         6.7950,   7.8100,   7.0900,   7.0200,   7.7500,   7.1600,   7.0540,
+                         6.7150,   6.8000,   7.0300,   5.8800,   5.9100,   5.9220,   4.8700,
+                         4.0650,   6.2250,   5.5700,   5.8000,   5.2800,   4.9200,   5.4200,
+                         5.0700,   8.2400,   4.8400,   4.5800,   7.6900,  12.6000,   0.8000,
+                         7.2200,   6.5000,   7.3800,  16.9000,   8.0100,   7.7900,   7.0700,
+                        12.4300,   7.2100,   7.7000,   6.9100,   4.8600,   9.2000,  10.7000,
+                        10.6000,   9.6000,   7.6300,  12.6920,   8.7760,   9.4050,   8.5320,
+                         0.0000,   0.0000,   0.0000,   0.0000,  10.0000,   0.0000,  10.3100,
+                         9.1000,   8.4170,  10.5500,   0.0000,   0.0000,   0.0000,   0.0000,
+                         0.0000,   0.0000,   0.0000,   0.0000,   0.0000,   0.0000,   0.0000,
+                         0.0000,   0.0000,   0.0000,   0.0000,   0.0000,   0.0000,   0.0000,
+                         0.0000
+                   };
+
 static const double Van_der_Waals_radii[113] =
                    {
                        1.20, 1.20, 1.40, 1.82, 2.00, 2.00, 1.70, 1.55, 1.52, 1.47, 1.54,
@@ -263,6 +289,74 @@ static const char* element_symbols_1[113] =
 
 static std::vector< std::string > element_symbols( element_symbols_1, element_symbols_1+113 );
 
+// Maps a one- or two-letter symbol to its id without searching: the first letter and the second letter (or its absence)
+// index a 26 x 27 table. Both letters are case insensitive.
+class ElementSymbolTable
+{
+public:
+
+    ElementSymbolTable()
+    {
+        for ( size_t i( 0 ); i != 26*27; ++i )
+            ids_[i] = not_found;
+        for ( size_t i( 0 ); i != 113; ++i )
+            ids_[ index( element_symbols_1[i][0], element_symbols_1[i][1] ) ] = static_cast<unsigned char>( i );
+    }
+
+    // second is '\0' for one-letter symbols. Returns not_found if the symbol does not exist.
+    size_t id( const char first, const char second ) const
+    {
+        const size_t i = index( first, second );
+        return ( i == 26*27 ) ? not_found : ids_[i];
+    }
+
+    static const unsigned char not_found = 255;
+
+private:
+    unsigned char ids_[26*27];
+
+    // Returns 26*27 if the characters cannot form a symbol
+    static size_t index( const char first, const char second )
+    {
+        const size_t i = letter( first );
+        if ( i == 26 )
+            return 26*27;
+        if ( second == '\0' )
+            return i * 27;
+        const size_t j = letter( second );
+        if ( j == 26 )
+            return 26*27;
+        return i * 27 + j + 1;
+    }
+
+    // Returns 0-25 for a-z and A-Z, 26 otherwise
+    static size_t letter( const char c )
+    {
+        if ( ( 'a' <= c ) && ( c <= 'z' ) )
+            return c - 'a';
+        if ( ( 'A' <= c ) && ( c <= 'Z' ) )
+            return c - 'A';
+        return 26;
+    }
+};
+
+// Function-local static, so it is initialised on first use, also when elements are constructed during static initialisation
+const ElementSymbolTable & element_symbol_table()
+{
+    static const ElementSymbolTable table;
+    return table;
+}
+
+bool is_blank( const char c )
+{
+    return ( c == ' ' ) || ( c == '\t' );
+}
+
+bool is_alpha( const char c )
+{
+    return ( ( 'a' <= c ) && ( c <= 'z' ) ) || ( ( 'A' <= c ) && ( c <= 'Z' ) );
+}
+
 static const double atomic_weights[113] =
                    {
                          2.0,    1.008,   4.003,   6.941,   9.012,  10.811,  12.011,  14.007,  15.999,  18.998,  20.180,
@@ -307,28 +401,41 @@ Element::Element( const size_t atomic_number ) : id_(atomic_number)
 
 // ********************************************************************************
 
+Element Element::from_id( const size_t id )
+{
+    if ( id >= nelement_ids )
+        throw std::runtime_error( "Element::from_id(): id out of range." );
+    Element result;
+    result.id_ = id;
+    return result;
+}
+
+// ********************************************************************************
+
 Element::Element( std::string symbol )
+{
+    *this = Element( symbol.data(), symbol.data() + symbol.length() );
+}
+
+// ********************************************************************************
+
+Element::Element( const char * begin, const char * end )
 {
     // We should probably remove all leading and trailing whitespace
     // Check that length is one or two characters
-    if ( ( symbol.length() != 1 ) &&
-         ( symbol.length() != 2 ) )
+    const size_t length = end - begin;
+    if ( ( length != 1 ) &&
+         ( length != 2 ) )
         throw std::runtime_error( "Element::Element( std::string ): length of atomic symbol must be 1 or 2." );
-    // Get capitalisation right
-    symbol[0] = to_upper( symbol[0] );
-    if ( symbol.length() == 2 )
-        symbol[1] = to_lower( symbol[1] );
-    // Search list
     // Minor problem here if symbol = "H ", which will not match anything
-    for ( size_t i(0); i != element_symbols.size(); ++i )
-    {
-        if ( element_symbols[i] == symbol )
-        {
-            id_ = i;
-            return;
-        }
-    }
+    id_ = element_symbol_table().id( begin[0], ( length == 2 ) ? begin[1] : '\0' );
+    if ( id_ != ElementSymbolTable::not_found )
+        return;
     // If no match, throw an exception
+    std::string symbol( begin, end );
+    symbol[0] = to_upper( symbol[0] );
+    if ( length == 2 )
+        symbol[1] = to_lower( symbol[1] );
     throw std::runtime_error( "Element::Element( std::string ): could not interpret string " + symbol );
 }
 
@@ -369,19 +476,72 @@ double Element::solid_state_volume() const
 
 // ********************************************************************************
 
-double Element::scattering_factor( const double sine_theta_over_lambda ) const
+double Element::scattering_factor( const double sine_theta_over_lambda, const RadiationType radiation_type ) const
 {
+    if ( radiation_type == NEUTRONS )
+    {
+        if ( neutron_scattering_lengths[ id_ ] == 0.0 )
+            throw std::runtime_error( "Element::scattering_factor(): Neutron scattering length not yet in table." );
+        return neutron_scattering_lengths[ id_ ];
+    }
     if ( a1[ id_ ] == 0.0 )
         throw std::runtime_error( "Element::scattering_factor(): Scattering factor not yet in table." );
-    return a1[ id_ ] * exp(-b1[ id_ ]*square( sine_theta_over_lambda )) +
-           a2[ id_ ] * exp(-b2[ id_ ]*square( sine_theta_over_lambda )) +
-           a3[ id_ ] * exp(-b3[ id_ ]*square( sine_theta_over_lambda )) +
-           a4[ id_ ] * exp(-b4[ id_ ]*square( sine_theta_over_lambda )) +
+    const double s2 = square( sine_theta_over_lambda );
+    if ( radiation_type == ELECTRONS )
+    {
+        // Mott-Bethe: f_e = K ( Z - f_x ) / s^2. With Z = a1 + a2 + a3 + a4 + c, each term becomes a_i ( 1 - exp( -b_i s^2 ) ) / s^2,
+        // which tends to a_i b_i for s -> 0.
+        if ( s2 == 0.0 )
+            return Mott_Bethe_constant * ( a1[ id_ ] * b1[ id_ ] + a2[ id_ ] * b2[ id_ ] + a3[ id_ ] * b3[ id_ ] + a4[ id_ ] * b4[ id_ ] );
+        return -Mott_Bethe_constant * ( a1[ id_ ] * std::expm1( -b1[ id_ ]*s2 ) +
+                                        a2[ id_ ] * std::expm1( -b2[ id_ ]*s2 ) +
+                                        a3[ id_ ] * std::expm1( -b3[ id_ ]*s2 ) +
+                                        a4[ id_ ] * std::expm1( -b4[ id_ ]*s2 ) ) / s2;
+    }
+    return a1[ id_ ] * exp(-b1[ id_ ]*s2) +
+           a2[ id_ ] * exp(-b2[ id_ ]*s2) +
+           a3[ id_ ] * exp(-b3[ id_ ]*s2) +
+           a4[ id_ ] * exp(-b4[ id_ ]*s2) +
            c[ id_ ];
 }
 
 // ********************************************************************************
 
+double Element::scattering_factor_derivative( const double sine_theta_over_lambda, const RadiationType radiation_type ) const
+{
+    if ( radiation_type == NEUTRONS )
+    {
+        if ( neutron_scattering_lengths[ id_ ] == 0.0 )
+            throw std::runtime_error( "Element::scattering_factor_derivative(): Neutron scattering length not yet in table." );
+        return 0.0;
+    }
+    if ( a1[ id_ ] == 0.0 )
+        throw std::runtime_error( "Element::scattering_factor_derivative(): Scattering factor not yet in table." );
+    const double s2 = square( sine_theta_over_lambda );
+    if ( radiation_type == ELECTRONS )
+    {
+        const double a[4] = { a1[ id_ ], a2[ id_ ], a3[ id_ ], a4[ id_ ] };
+        const double b[4] = { b1[ id_ ], b2[ id_ ], b3[ id_ ], b4[ id_ ] };
+        double result( 0.0 );
+        for ( size_t i( 0 ); i != 4; ++i )
+        {
+            const double x = b[i] * s2;
+            // d/ds [ ( 1 - exp( -b s^2 ) ) / s^2 ] = 2 ( x exp( -x ) + expm1( -x ) ) / s^3, which cancels catastrophically for small x
+            if ( x < 1.0E-3 )
+                result += a[i] * ( -square( b[i] ) * sine_theta_over_lambda + ( 2.0 / 3.0 ) * b[i] * b[i] * b[i] * s2 * sine_theta_over_lambda );
+            else
+                result += a[i] * 2.0 * ( x * exp( -x ) + std::expm1( -x ) ) / ( s2 * sine_theta_over_lambda );
+        }
+        return Mott_Bethe_constant * result;
+    }
+    return -2.0 * sine_theta_over_lambda * ( a1[ id_ ] * b1[ id_ ] * exp(-b1[ id_ ]*s2) +
+                                             a2[ id_ ] * b2[ id_ ] * exp(-b2[ id_ ]*s2) +
+                                             a3[ id_ ] * b3[ id_ ] * exp(-b3[ id_ ]*s2) +
+                                             a4[ id_ ] * b4[ id_ ] * exp(-b4[ id_ ]*s2) );
+}
+
+// ********************************************************************************
+
 //namespace
 //{
 //
@@ -451,20 +611,31 @@ bool are_bonded( const Element & lhs, const Element & rhs, const double distance
 
 Element element_from_atom_label( std::string label )
 {
-    label = strip( label );
-    if ( label.empty() )
+    return element_from_atom_label( label.data(), label.data() + label.length() );
+}
+
+// ********************************************************************************
+
+Element element_from_atom_label( const char * begin, const char * end )
+{
+    while ( ( begin != end ) && is_blank( *begin ) )
+        ++begin;
+    while ( ( begin != end ) && is_blank( *(end-1) ) )
+        --end;
+    if ( begin == end )
         throw std::runtime_error( "element_from_atom_label(): string is empty." );
-    if ( ! std::isalpha( label[0] ) )
+    if ( ! is_alpha( begin[0] ) )
         throw std::runtime_error( "element_from_atom_label(): string must start with alphabetic character." );
-    if ( ( label.length() == 1 ) || ( ! std::isalpha( label[1] ) ) )
-        return Element( label.substr( 0, 1 ) );
-    if ( ( to_upper( label[0] ) == 'O' ) && ( to_lower( label[1] ) == 'w' ) )
-        return Element( "O" );
-    if ( ( label.length() == 2 ) || ( ! std::isalpha( label[2] ) ) )
-        return Element( label.substr( 0, 2 ) );
+    const size_t length = end - begin;
+    if ( ( length == 1 ) || ( ! is_alpha( begin[1] ) ) )
+        return Element( begin, begin + 1 );
+    if ( ( to_upper( begin[0] ) == 'O' ) && ( to_lower( begin[1] ) == 'w' ) )
+        return Element( 8 );
+    if ( ( length == 2 ) || ( ! is_alpha( begin[2] ) ) )
+        return Element( begin, begin + 2 );
     // We make the best of it, but someone made a booboo
-    std::cout << "Warning: element_from_atom_label(): unexpected format: " << label << std::endl;
-    return Element( label.substr( 0, 2 ) );
+    std::cout << "Warning: element_from_atom_label(): unexpected format: " << std::string( begin, end ) << std::endl;
+    return Element( begin, begin + 2 );
 }
 
 // ********************************************************************************
@@ -31,6 +31,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include <cstddef> // For definition of size_t
 
+// X-ray scattering factors are in electrons, from the Cromer-Mann coefficients.
+// Neutron scattering factors are the coherent scattering lengths in fm and do not depend on sin(theta)/lambda.
+// Electron scattering factors are in Angstrom, calculated from the X-ray scattering factors with the Mott-Bethe formula.
+enum RadiationType { X_RAYS, NEUTRONS, ELECTRONS };
+
+// Only the neutron scattering factors are independent of sin(theta)/lambda, they can be calculated once per element.
+inline bool scattering_factor_depends_on_angle( const RadiationType radiation_type ) { return ( radiation_type != NEUTRONS ); }
+
+// The number of different values of Element::id(), for arrays indexed by element.
+const size_t nelement_ids = 113;
+
 // H and D are two distinct elements
 class Element
 {
@@ -45,6 +56,13 @@ public:
 
     explicit Element( std::string symbol );
 
+    // As Element( std::string ), for the symbol in the character range [begin, end), which allows readers to
+    // construct elements straight from their input buffers without creating a std::string.
+    Element( const char * begin, const char * end );
+
+    // The inverse of id(), throws if id is not smaller than nelement_ids.
+    static Element from_id( const size_t id );
+
     // D = 0, others are atomic number
     size_t id() const { return id_; }
 
@@ -61,7 +79,11 @@ public:
     // Uses Hofmann's values
     double solid_state_volume() const;
 
-    double scattering_factor( const double sine_theta_over_lambda ) const;
+    // Throws if the element is not in the table for that radiation type.
+    double scattering_factor( const double sine_theta_over_lambda, const RadiationType radiation_type = X_RAYS ) const;
+
+    // d f / d( sin(theta)/lambda ), needed for the derivatives of the structure factors with respect to the unit-cell parameters.
+    double scattering_factor_derivative( const double sine_theta_over_lambda, const RadiationType radiation_type = X_RAYS ) const;
 
     bool operator<( const Element & rhs ) const { return ( id_ < rhs.id_ ); }
     
@@ -82,6 +104,9 @@ bool are_bonded( const Element & lhs, const Element & rhs, const double distance
 // "C_3" and "Ow14" are also interpreted correctly.
 Element element_from_atom_label( std::string label );
 
+// As above, for the label in the character range [begin, end).
+Element element_from_atom_label( const char * begin, const char * end );
+
 inline bool operator==( const Element & lhs, const Element & rhs ) { return ( lhs.id() == rhs.id() ); }
 
 inline bool operator!=( const Element & lhs, const Element & rhs ) { return ! ( lhs == rhs ); }
@@ -28,14 +28,18 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+// Messages from log_info(), log_warning() etc. are flushed first so that they come out in the right order.
 #define MACRO_END_GAME \
+    Logger::instance().flush(); \
     std::cout << "Done" << std::endl; \
     } \
     catch ( std::exception & e ) \
     { \
+        Logger::instance().flush(); \
         std::cout << "An exception was thrown" << std::endl; \
         std::cout << e.what() << std::endl; \
     } \
+    MACRO_INSTRUMENTATION_REPORT \
     return 0;
     
 //#define MACRO_END_GAME \
@@ -0,0 +1,411 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "EwaldSummation.h"
+#include "CellList.h"
+#include "CrystalStructure.h"
+#include "FFT.h"
+#include "MathConstants.h"
+#include "MathFunctions.h"
+#include "Matrix3D.h"
+#include "ParallelFor.h"
+#include "PhysicalConstants.h"
+#include "3DCalculations.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+
+namespace
+{
+
+const size_t maximum_interpolation_order = 16;
+
+// The cardinal B-spline of order n, M_n( x ), non-zero for 0 < x < n.
+double cardinal_B_spline( const double x, const size_t n )
+{
+    // values[t] = M_k( x - t ) for t = 0 ... n-k, starting from k = 2, with M_{k+1}( y ) = ( y M_k( y ) + ( k + 1 - y ) M_k( y - 1 ) ) / k
+    double values[ maximum_interpolation_order ];
+    for ( size_t t( 0 ); t != n - 1; ++t )
+        values[t] = std::max( 0.0, 1.0 - std::abs( x - t - 1.0 ) );
+    for ( size_t k( 2 ); k != n; ++k )
+    {
+        for ( size_t t( 0 ); t != n - k; ++t )
+            values[t] = ( ( x - t ) * values[t] + ( k + 1.0 - ( x - t ) ) * values[t+1] ) / k;
+    }
+    return values[0];
+}
+
+// ********************************************************************************
+
+// |b( m )|^2 of Essmann et al. for m = 0 ... K-1: 1 / | sum_k M_n( k + 1 ) exp( 2 pi i m k / K ) |^2, k = 0 ... n-2.
+// For odd n the sum vanishes at m = K/2, the average of the neighbours is used there.
+std::vector< double > B_spline_moduli( const size_t K, const size_t n )
+{
+    std::vector< double > result( K );
+    std::vector< bool > vanishes( K, false );
+    for ( size_t m( 0 ); m != K; ++m )
+    {
+        std::complex< double > sum( 0.0, 0.0 );
+        for ( size_t k( 0 ); k != n - 1; ++k )
+            sum += cardinal_B_spline( k + 1.0, n ) * std::polar( 1.0, 2.0 * CONSTANT_PI * m * k / K );
+        vanishes[m] = ( std::norm( sum ) < 1.0E-10 );
+        result[m] = vanishes[m] ? 0.0 : 1.0 / std::norm( sum );
+    }
+    for ( size_t m( 0 ); m != K; ++m )
+    {
+        if ( vanishes[m] )
+            result[m] = 0.5 * ( result[ ( m + K - 1 ) % K ] + result[ ( m + 1 ) % K ] );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+// In place, along each of the three dimensions in turn. Element ( k0, k1, k2 ) is grid[ ( k0 K1 + k1 ) K2 + k2 ].
+void Fourier_transform_3D( std::vector< std::complex< double > > & grid, const size_t K[3], const size_t nthreads )
+{
+    const size_t strides[3] = { K[1] * K[2], K[2], 1 };
+    for ( size_t axis( 0 ); axis != 3; ++axis )
+    {
+        const size_t other_1 = ( axis + 1 ) % 3;
+        const size_t other_2 = ( axis + 2 ) % 3;
+        parallel_for( K[other_1] * K[other_2], nthreads, [&]( const size_t line )
+        {
+            const size_t start = ( line / K[other_2] ) * strides[other_1] + ( line % K[other_2] ) * strides[other_2];
+            std::vector< std::complex< double > > values( K[axis] );
+            for ( size_t i( 0 ); i != K[axis]; ++i )
+                values[i] = grid[ start + i * strides[axis] ];
+            fast_Fourier_transform( values );
+            for ( size_t i( 0 ); i != K[axis]; ++i )
+                grid[ start + i * strides[axis] ] = values[i];
+        }, 16 );
+    }
+}
+
+} // namespace
+
+// ********************************************************************************
+
+EwaldSummation::EwaldSummation( const CrystalLattice & crystal_lattice, const std::vector< Vector3D > & positions, const std::vector< double > & charges ):
+crystal_lattice_(crystal_lattice),
+positions_(positions),
+charges_(charges),
+reciprocal_space_method_(SMOOTH_PME),
+real_space_cutoff_(9.0),
+accuracy_(1.0E-6),
+grid_spacing_(0.8),
+interpolation_order_(6),
+nthreads_(0),
+summation_mode_(FAST_SUMMATION)
+{
+    if ( positions_.size() != charges_.size() )
+        throw std::runtime_error( "EwaldSummation::EwaldSummation(): number of positions and number of charges differ." );
+}
+
+// ********************************************************************************
+
+EwaldSummation::EwaldSummation( const CrystalStructure & crystal_structure ):
+crystal_lattice_(crystal_structure.crystal_lattice()),
+reciprocal_space_method_(SMOOTH_PME),
+real_space_cutoff_(9.0),
+accuracy_(1.0E-6),
+grid_spacing_(0.8),
+interpolation_order_(6),
+nthreads_(0),
+summation_mode_(FAST_SUMMATION)
+{
+    positions_.reserve( crystal_structure.natoms() );
+    charges_.reserve( crystal_structure.natoms() );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        positions_.push_back( crystal_structure.atom( i ).position() );
+        charges_.push_back( crystal_structure.atom( i ).charge() );
+    }
+}
+
+// ********************************************************************************
+
+void EwaldSummation::set_interpolation_order( const size_t interpolation_order )
+{
+    if ( ( interpolation_order < 3 ) || ( interpolation_order > maximum_interpolation_order ) )
+        throw std::runtime_error( "EwaldSummation::set_interpolation_order(): order must be between 3 and " + size_t2string( maximum_interpolation_order ) + "." );
+    interpolation_order_ = interpolation_order;
+}
+
+// ********************************************************************************
+
+double EwaldSummation::alpha() const
+{
+    if ( ( accuracy_ <= 0.0 ) || ( accuracy_ >= 1.0 ) )
+        throw std::runtime_error( "EwaldSummation::alpha(): accuracy must be between 0.0 and 1.0." );
+    // erfc() decreases monotonically, bisect erfc( x ) = accuracy
+    double lower( 0.0 );
+    double upper( 30.0 );
+    for ( size_t i( 0 ); i != 100; ++i )
+    {
+        const double middle = 0.5 * ( lower + upper );
+        if ( std::erfc( middle ) > accuracy_ )
+            lower = middle;
+        else
+            upper = middle;
+    }
+    return 0.5 * ( lower + upper ) / real_space_cutoff_;
+}
+
+// ********************************************************************************
+
+EwaldEnergy EwaldSummation::energy() const
+{
+    const double alpha = this->alpha();
+    double sum_of_charges( 0.0 );
+    double sum_of_squared_charges( 0.0 );
+    for ( size_t i( 0 ); i != charges_.size(); ++i )
+    {
+        sum_of_charges += charges_[i];
+        sum_of_squared_charges += square( charges_[i] );
+    }
+    EwaldEnergy result;
+    result.real_space_ = Coulomb_constant * real_space_energy( alpha );
+    if ( reciprocal_space_method_ == EWALD )
+        result.reciprocal_space_ = Coulomb_constant * Ewald_reciprocal_space_energy( alpha );
+    else
+        result.reciprocal_space_ = Coulomb_constant * PME_reciprocal_space_energy( alpha );
+    result.self_ = -Coulomb_constant * ( alpha / std::sqrt( CONSTANT_PI ) ) * sum_of_squared_charges;
+    result.net_charge_ = -Coulomb_constant * CONSTANT_PI * square( sum_of_charges ) / ( 2.0 * crystal_lattice_.volume() * square( alpha ) );
+    return result;
+}
+
+// ********************************************************************************
+
+// 1/2 sum_i sum_j sum_n' q_i q_j erfc( alpha r ) / r over all lattice translations n with r < cutoff, without i = j for n = 0.
+double EwaldSummation::real_space_energy( const double alpha ) const
+{
+    const size_t natoms = positions_.size();
+    if ( natoms == 0 )
+        return 0.0;
+    const double cutoff = real_space_cutoff_;
+    const double cutoff2 = square( cutoff );
+    const Matrix3D & fractional_to_orthogonal = crystal_lattice_.fractional_to_orthogonal_matrix();
+    // The distance between lattice planes along direction k is 1 / |a*_k|, so | d_k + t_k | <= cutoff |a*_k| for an image within the cutoff
+    const double plane_densities[3] = { crystal_lattice_.a_star(), crystal_lattice_.b_star(), crystal_lattice_.c_star() };
+    // sum_t erfc( alpha r ) / r over all translations t of the fractional difference d, without r = 0
+    auto images_sum = [&]( const Vector3D & difference ) -> double
+    {
+        double d[3];
+        int first[3];
+        int last[3];
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            d[k] = difference.value( k ) - std::floor( difference.value( k ) + 0.5 );
+            first[k] = static_cast<int>( std::ceil( -cutoff * plane_densities[k] - d[k] ) );
+            last[k] = static_cast<int>( std::floor( cutoff * plane_densities[k] - d[k] ) );
+        }
+        double result( 0.0 );
+        for ( int t0( first[0] ); t0 <= last[0]; ++t0 )
+        {
+            for ( int t1( first[1] ); t1 <= last[1]; ++t1 )
+            {
+                for ( int t2( first[2] ); t2 <= last[2]; ++t2 )
+                {
+                    const double r2 = ( fractional_to_orthogonal * Vector3D( d[0] + t0, d[1] + t1, d[2] + t2 ) ).norm2();
+                    if ( ( r2 < cutoff2 ) && ( r2 != 0.0 ) )
+                    {
+                        const double r = std::sqrt( r2 );
+                        result += std::erfc( alpha * r ) / r;
+                    }
+                }
+            }
+        }
+        return result;
+    };
+    const CellList cell_list( crystal_lattice_, positions_, cutoff );
+    // Each pair i < j once with all its translations
+    double result = parallel_sum( natoms, nthreads_, 16, [&]( const size_t i ) -> double
+    {
+        std::vector< size_t > candidates;
+        cell_list.candidates( i, candidates );
+        double sum( 0.0 );
+        for ( size_t c( 0 ); c != candidates.size(); ++c )
+        {
+            const size_t j = candidates[c];
+            if ( j > i )
+                sum += charges_[j] * images_sum( positions_[j] - positions_[i] );
+        }
+        return charges_[i] * sum;
+    }, summation_mode_ );
+    // Each atom with its own translations, the same for all atoms
+    double sum_of_squared_charges( 0.0 );
+    for ( size_t i( 0 ); i != natoms; ++i )
+        sum_of_squared_charges += square( charges_[i] );
+    result += 0.5 * sum_of_squared_charges * images_sum( Vector3D() );
+    return result;
+}
+
+// ********************************************************************************
+
+double EwaldSummation::Ewald_reciprocal_space_energy( const double alpha ) const
+{
+    const size_t natoms = positions_.size();
+    if ( natoms == 0 )
+        return 0.0;
+    const double m_max = alpha * std::sqrt( -std::log( accuracy_ ) ) / CONSTANT_PI;
+    const double m_max2 = square( m_max );
+    // h = m.a, so |h| <= m_max |a|
+    const int h_max = static_cast<int>( m_max * crystal_lattice_.a() );
+    const int k_max = static_cast<int>( m_max * crystal_lattice_.b() );
+    const int l_max = static_cast<int>( m_max * crystal_lattice_.c() );
+    // exp( 2 pi i h x_j ) as phases_x[ ( h + h_max ) natoms + j ], etc.
+    auto phase_table = [&]( const int n_max, const size_t k ) -> std::vector< std::complex< double > >
+    {
+        std::vector< std::complex< double > > result( ( 2 * n_max + 1 ) * natoms );
+        for ( int n( -n_max ); n <= n_max; ++n )
+        {
+            for ( size_t j( 0 ); j != natoms; ++j )
+                result[ ( n + n_max ) * natoms + j ] = std::polar( 1.0, 2.0 * CONSTANT_PI * n * positions_[j].value( k ) );
+        }
+        return result;
+    };
+    const std::vector< std::complex< double > > phases_x = phase_table( h_max, 0 );
+    const std::vector< std::complex< double > > phases_y = phase_table( k_max, 1 );
+    const std::vector< std::complex< double > > phases_z = phase_table( l_max, 2 );
+    // Half of the reciprocal lattice, |S( -m )| = |S( m )|: h > 0, or h = 0 and k > 0, or h = k = 0 and l > 0
+    const ReciprocalBasis reciprocal_basis( crystal_lattice_ );
+    std::vector< int > hkl;
+    std::vector< double > lengths2;
+    for ( int h( 0 ); h <= h_max; ++h )
+    {
+        for ( int k( ( h == 0 ) ? 0 : -k_max ); k <= k_max; ++k )
+        {
+            for ( int l( ( ( h == 0 ) && ( k == 0 ) ) ? 1 : -l_max ); l <= l_max; ++l )
+            {
+                const double length2 = reciprocal_basis.length2( h, k, l );
+                if ( length2 > m_max2 )
+                    continue;
+                hkl.push_back( h );
+                hkl.push_back( k );
+                hkl.push_back( l );
+                lengths2.push_back( length2 );
+            }
+        }
+    }
+    const double factor = square( CONSTANT_PI / alpha );
+    const double sum = parallel_sum( lengths2.size(), nthreads_, 64, [&]( const size_t i ) -> double
+    {
+        const std::complex< double > * x = &phases_x[ ( hkl[3*i  ] + h_max ) * natoms ];
+        const std::complex< double > * y = &phases_y[ ( hkl[3*i+1] + k_max ) * natoms ];
+        const std::complex< double > * z = &phases_z[ ( hkl[3*i+2] + l_max ) * natoms ];
+        std::complex< double > structure_factor( 0.0, 0.0 );
+        for ( size_t j( 0 ); j != natoms; ++j )
+            structure_factor += charges_[j] * ( x[j] * y[j] * z[j] );
+        return std::exp( -factor * lengths2[i] ) * std::norm( structure_factor ) / lengths2[i];
+    }, summation_mode_ );
+    return 2.0 * sum / ( 2.0 * CONSTANT_PI * crystal_lattice_.volume() );
+}
+
+// ********************************************************************************
+
+double EwaldSummation::PME_reciprocal_space_energy( const double alpha ) const
+{
+    const size_t natoms = positions_.size();
+    if ( natoms == 0 )
+        return 0.0;
+    const size_t n = interpolation_order_;
+    const double lengths[3] = { crystal_lattice_.a(), crystal_lattice_.b(), crystal_lattice_.c() };
+    size_t K[3];
+    for ( size_t k( 0 ); k != 3; ++k )
+        K[k] = next_power_of_two( std::max( n, static_cast<size_t>( std::ceil( lengths[k] / grid_spacing_ ) ) ) );
+    // Atom j contributes to the grid points ( first - t ) mod K along direction k with weight M_n( w + t ), t = 0 ... n-1,
+    // u = K x = first + w being the position in grid units. Stored as weights[ ( 3 j + k ) n + t ] and indices[ ( 3 j + k ) n + t ].
+    std::vector< double > weights( 3 * natoms * n );
+    std::vector< size_t > indices( 3 * natoms * n );
+    for ( size_t j( 0 ); j != natoms; ++j )
+    {
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            const double u = K[k] * ( positions_[j].value( k ) - std::floor( positions_[j].value( k ) ) );
+            const double first = std::floor( u );
+            const double w = u - first;
+            for ( size_t t( 0 ); t != n; ++t )
+            {
+                weights[ ( 3 * j + k ) * n + t ] = cardinal_B_spline( w + t, n );
+                indices[ ( 3 * j + k ) * n + t ] = ( static_cast<size_t>( first ) + K[k] * n - t ) % K[k];
+            }
+        }
+    }
+    // Spread the charges one plane k0 at a time, so that each grid point is written by one thread and in the order of the atoms
+    std::vector< std::vector< size_t > > plane_contributions( K[0] ); // j n + t
+    for ( size_t j( 0 ); j != natoms; ++j )
+    {
+        for ( size_t t( 0 ); t != n; ++t )
+            plane_contributions[ indices[ 3 * j * n + t ] ].push_back( j * n + t );
+    }
+    std::vector< std::complex< double > > grid( K[0] * K[1] * K[2], std::complex< double >( 0.0, 0.0 ) );
+    parallel_for( K[0], nthreads_, [&]( const size_t k0 )
+    {
+        for ( size_t c( 0 ); c != plane_contributions[k0].size(); ++c )
+        {
+            const size_t j = plane_contributions[k0][c] / n;
+            const size_t t0 = plane_contributions[k0][c] % n;
+            const double w0 = charges_[j] * weights[ 3 * j * n + t0 ];
+            for ( size_t t1( 0 ); t1 != n; ++t1 )
+            {
+                const double w01 = w0 * weights[ ( 3 * j + 1 ) * n + t1 ];
+                std::complex< double > * row = &grid[ ( k0 * K[1] + indices[ ( 3 * j + 1 ) * n + t1 ] ) * K[2] ];
+                for ( size_t t2( 0 ); t2 != n; ++t2 )
+                    row[ indices[ ( 3 * j + 2 ) * n + t2 ] ] += w01 * weights[ ( 3 * j + 2 ) * n + t2 ];
+            }
+        }
+    } );
+    Fourier_transform_3D( grid, K, nthreads_ );
+    std::vector< double > moduli[3];
+    for ( size_t k( 0 ); k != 3; ++k )
+        moduli[k] = B_spline_moduli( K[k], n );
+    const ReciprocalBasis reciprocal_basis( crystal_lattice_ );
+    const double factor = square( CONSTANT_PI / alpha );
+    const double sum = parallel_sum( K[0], nthreads_, 1, [&]( const size_t m0 ) -> double
+    {
+        const int h = ( 2 * m0 <= K[0] ) ? static_cast<int>( m0 ) : static_cast<int>( m0 ) - static_cast<int>( K[0] );
+        double result( 0.0 );
+        for ( size_t m1( 0 ); m1 != K[1]; ++m1 )
+        {
+            const int k = ( 2 * m1 <= K[1] ) ? static_cast<int>( m1 ) : static_cast<int>( m1 ) - static_cast<int>( K[1] );
+            for ( size_t m2( 0 ); m2 != K[2]; ++m2 )
+            {
+                if ( ( m0 == 0 ) && ( m1 == 0 ) && ( m2 == 0 ) )
+                    continue;
+                const int l = ( 2 * m2 <= K[2] ) ? static_cast<int>( m2 ) : static_cast<int>( m2 ) - static_cast<int>( K[2] );
+                const double length2 = reciprocal_basis.length2( h, k, l );
+                result += std::exp( -factor * length2 ) / length2 * moduli[0][m0] * moduli[1][m1] * moduli[2][m2] * std::norm( grid[ ( m0 * K[1] + m1 ) * K[2] + m2 ] );
+            }
+        }
+        return result;
+    }, summation_mode_ );
+    return sum / ( 2.0 * CONSTANT_PI * crystal_lattice_.volume() );
+}
@@ -0,0 +1,136 @@
+#ifndef EWALDSUMMATION_H
+#define EWALDSUMMATION_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+
+#include "CrystalLattice.h"
+#include "ReproducibleSum.h"
+#include "Vector3D.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+// The terms of the electrostatic energy of a unit cell, in kcal/mol.
+struct EwaldEnergy
+{
+    EwaldEnergy(): real_space_(0.0), reciprocal_space_(0.0), self_(0.0), net_charge_(0.0) {}
+
+    double real_space_;
+    double reciprocal_space_;
+    double self_;       // - alpha / sqrt( pi ) sum q_i^2
+    double net_charge_; // - pi Q^2 / ( 2 V alpha^2 ) for a unit cell with a net charge Q, the neutralising background
+
+    double total() const { return real_space_ + reciprocal_space_ + self_ + net_charge_; }
+};
+
+/*
+  The electrostatic lattice energy of point charges in a periodic unit cell, e.g. the charges Atom::charge() of a crystal structure,
+  for ranking the structures of a crystal structure prediction.
+
+  The Coulomb sum is split by Ewald's method into a real-space sum of erfc( alpha r ) / r, which converges quickly, and a reciprocal-space sum
+  1 / ( 2 pi V ) sum_m exp( -pi^2 m^2 / alpha^2 ) / m^2 |S(m)|^2 with the structure factor S(m) = sum_j q_j exp( 2 pi i m.r_j ).
+  alpha follows from the real-space cutoff and the accuracy: erfc( alpha r_c ) = accuracy.
+
+  The real-space pairs come from a CellList; all lattice translations of a pair within the cutoff are included, so the cutoff may be larger than the unit cell.
+
+  The reciprocal-space sum is calculated either
+      EWALD       directly, over all m with exp( -pi^2 m^2 / alpha^2 ) >= accuracy. O(N^2) for a fixed cutoff, the reference.
+      SMOOTH_PME  by smooth particle-mesh Ewald (Essmann et al., J. Chem. Phys. 103, 8577 (1995)): the charges are spread on a grid with
+                  cardinal B-splines, the grid is Fourier transformed and the sum is taken over the grid. O(N log N).
+  Each dimension of the grid is the smallest power of two with a spacing of at most grid_spacing() and at least interpolation_order() points.
+
+  Both sums are calculated on nthreads() threads, the result does not depend on the number of threads. With REPRODUCIBLE_SUMMATION
+  it does not depend on the build either.
+*/
+class EwaldSummation
+{
+public:
+
+    enum ReciprocalSpaceMethod { EWALD, SMOOTH_PME };
+
+    // positions are fractional coordinates, charges in units of e.
+    EwaldSummation( const CrystalLattice & crystal_lattice, const std::vector< Vector3D > & positions, const std::vector< double > & charges );
+
+    // Uses Atom::charge(). The space-group symmetry must have been applied.
+    explicit EwaldSummation( const CrystalStructure & crystal_structure );
+
+    // The default is SMOOTH_PME.
+    ReciprocalSpaceMethod reciprocal_space_method() const { return reciprocal_space_method_; }
+    void set_reciprocal_space_method( const ReciprocalSpaceMethod reciprocal_space_method ) { reciprocal_space_method_ = reciprocal_space_method; }
+
+    // In Angstrom, the default is 9.0.
+    double real_space_cutoff() const { return real_space_cutoff_; }
+    void set_real_space_cutoff( const double real_space_cutoff ) { real_space_cutoff_ = real_space_cutoff; }
+
+    // The default is 1.0E-6.
+    double accuracy() const { return accuracy_; }
+    void set_accuracy( const double accuracy ) { accuracy_ = accuracy; }
+
+    // In Angstrom, the default is 0.8. Only for SMOOTH_PME. A shorter real-space cutoff gives a larger alpha and needs a finer grid.
+    double grid_spacing() const { return grid_spacing_; }
+    void set_grid_spacing( const double grid_spacing ) { grid_spacing_ = grid_spacing; }
+
+    // The order of the B-splines, the default is 6. Only for SMOOTH_PME.
+    size_t interpolation_order() const { return interpolation_order_; }
+    void set_interpolation_order( const size_t interpolation_order );
+
+    // 0 means one thread per core. Default 0.
+    size_t nthreads() const { return nthreads_; }
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; }
+
+    // The default is FAST_SUMMATION.
+    SummationMode summation_mode() const { return summation_mode_; }
+    void set_summation_mode( const SummationMode summation_mode ) { summation_mode_ = summation_mode; }
+
+    // In A^-1
+    double alpha() const;
+
+    // In kcal/mol per unit cell.
+    EwaldEnergy energy() const;
+
+private:
+    CrystalLattice crystal_lattice_;
+    std::vector< Vector3D > positions_;
+    std::vector< double > charges_;
+    ReciprocalSpaceMethod reciprocal_space_method_;
+    double real_space_cutoff_;
+    double accuracy_;
+    double grid_spacing_;
+    size_t interpolation_order_;
+    size_t nthreads_;
+    SummationMode summation_mode_;
+
+    double real_space_energy( const double alpha ) const;
+    double Ewald_reciprocal_space_energy( const double alpha ) const;
+    double PME_reciprocal_space_energy( const double alpha ) const;
+};
+
+#endif // EWALDSUMMATION_H
@@ -0,0 +1,89 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "FFT.h"
+#include "MathConstants.h"
+
+#include <cmath>
+#include <stdexcept>
+
+// ********************************************************************************
+
+size_t next_power_of_two( const size_t n )
+{
+    size_t result( 1 );
+    while ( result < n )
+        result *= 2;
+    return result;
+}
+
+// ********************************************************************************
+
+void fast_Fourier_transform( std::vector< std::complex< double > > & data, const bool inverse )
+{
+    const size_t n = data.size();
+    if ( n == 0 )
+        return;
+    if ( ( n & ( n - 1 ) ) != 0 )
+        throw std::runtime_error( "fast_Fourier_transform(): number of points must be a power of two." );
+    // Bit-reversal permutation
+    for ( size_t i( 1 ), j( 0 ); i < n; ++i )
+    {
+        size_t bit = n >> 1;
+        for ( ; j & bit; bit >>= 1 )
+            j ^= bit;
+        j ^= bit;
+        if ( i < j )
+            std::swap( data[i], data[j] );
+    }
+    const double direction = inverse ? 1.0 : -1.0;
+    for ( size_t length( 2 ); length <= n; length *= 2 )
+    {
+        const double phi = direction * 2.0 * CONSTANT_PI / length;
+        const std::complex< double > w_length( cos( phi ), sin( phi ) );
+        for ( size_t i( 0 ); i < n; i += length )
+        {
+            std::complex< double > w( 1.0, 0.0 );
+            for ( size_t j( 0 ); j < length / 2; ++j )
+            {
+                std::complex< double > u = data[i+j];
+                std::complex< double > v = data[i+j+length/2] * w;
+                data[i+j] = u + v;
+                data[i+j+length/2] = u - v;
+                w *= w_length;
+            }
+        }
+    }
+    if ( inverse )
+    {
+        for ( size_t i( 0 ); i != n; ++i )
+            data[i] /= static_cast< double >( n );
+    }
+}
+
+// ********************************************************************************
+
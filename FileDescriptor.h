@@ -0,0 +1,53 @@
+#ifndef FILEDESCRIPTOR_H
+#define FILEDESCRIPTOR_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include <unistd.h>
+
+/*
+  Owns a POSIX file descriptor and closes it when it goes out of scope, also when an exception is thrown,
+  so that the error paths do not need to close it by hand. A descriptor of -1, e.g. from a failed open(), is not closed.
+  Not copyable.
+*/
+class FileDescriptor
+{
+public:
+    explicit FileDescriptor( const int file_descriptor ): file_descriptor_(file_descriptor) {}
+    ~FileDescriptor() { if ( file_descriptor_ != -1 ) close( file_descriptor_ ); }
+    int value() const { return file_descriptor_; }
+private:
+    int file_descriptor_;
+    FileDescriptor( const FileDescriptor & );
+    FileDescriptor & operator=( const FileDescriptor & );
+};
+
+#endif // FILEDESCRIPTOR_H
+
@@ -27,10 +27,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "FileList.h"
 #include "FileName.h"
+#include "ParallelFor.h"
 #include "TextFileReader.h"
 #include "TextFileWriter.h"
 #include "Utilities.h"
 
+#include <algorithm>
+#include <dirent.h>
+#include <stdexcept>
+
 // ********************************************************************************
 
 FileList::FileList() : prepend_file_name_with_basedirectory_(true)
@@ -48,6 +53,7 @@ FileList::FileList( const FileName & file_name ) : prepend_file_name_with_basedi
 
 FileList::FileList( const std::vector< FileName > & file_names ) : file_names_(file_names), prepend_file_name_with_basedirectory_(true)
 {
+    update_values();
 }
 
 // ********************************************************************************
@@ -59,6 +65,7 @@ FileList::FileList( const std::string & base_directory, const FileName & file_na
         initialise_from_file_2( FileName( base_directory_, file_name.file_name(), file_name.extension() ) );
     else
         initialise_from_file_2( file_name );
+    update_values();
 }
 
 // ********************************************************************************
@@ -66,15 +73,42 @@ FileList::FileList( const std::string & base_directory, const FileName & file_na
 FileList::FileList( const std::string & base_directory, const std::vector< FileName > & file_names ) : base_directory_(base_directory), file_names_(file_names), prepend_file_name_with_basedirectory_(true)
 {
     base_directory_ = append_backslash( base_directory_ );
+    update_values();
+}
+
+// ********************************************************************************
+
+void FileList::push_back( const FileName & file_name )
+{
+    file_names_.push_back( file_name );
+    values_.push_back( make_value( file_name ) );
+}
+
+// ********************************************************************************
+
+void FileList::set_prepend_file_name_with_basedirectory( const bool prepend_file_name_with_basedirectory )
+{
+    prepend_file_name_with_basedirectory_ = prepend_file_name_with_basedirectory;
+    update_values();
 }
 
 // ********************************************************************************
 
-FileName FileList::value( const size_t i ) const
+FileName FileList::make_value( const FileName & file_name ) const
 {
-    if ( prepend_file_name_with_basedirectory_ && file_names_[ i ].directory().empty() )
-        return FileName( base_directory_, file_names_[ i ].file_name(), file_names_[ i ].extension() );
-    return file_names_[ i ];
+    if ( prepend_file_name_with_basedirectory_ && file_name.directory().empty() )
+        return FileName( base_directory_, file_name.file_name(), file_name.extension() );
+    return file_name;
+}
+
+// ********************************************************************************
+
+void FileList::update_values()
+{
+    values_.clear();
+    values_.reserve( file_names_.size() );
+    for ( size_t i( 0 ); i != file_names_.size(); ++i )
+        values_.push_back( make_value( file_names_[ i ] ) );
 }
 
 // ********************************************************************************
@@ -93,6 +127,7 @@ void FileList::initialise_from_file( const FileName & file_name )
     
     initialise_from_file_2( file_name );
     base_directory_ = file_name.directory();
+    update_values();
 }
 
 // ********************************************************************************
@@ -118,3 +153,68 @@ void FileList::initialise_from_file_2( const FileName & file_name )
 
 // ********************************************************************************
 
+// ********************************************************************************
+
+void FileList::initialise_from_directory( const std::string & directory, const std::string & pattern )
+{
+    base_directory_ = append_backslash( directory );
+    file_names_.clear();
+    const std::string path = directory.empty() ? std::string( "." ) : replace( directory, "\\", "/" );
+    DIR * dir = opendir( path.c_str() );
+    if ( dir == 0 )
+        throw std::runtime_error( "FileList::initialise_from_directory(): could not open directory " + directory );
+    const bool include_hidden_files = ( ( ! pattern.empty() ) && ( pattern[0] == '.' ) );
+    std::vector< std::string > names;
+    for ( struct dirent * entry = readdir( dir ); entry != 0; entry = readdir( dir ) )
+    {
+        const std::string name( entry->d_name );
+        if ( ( name == "." ) || ( name == ".." ) )
+            continue;
+        if ( ( name[0] == '.' ) && ( ! include_hidden_files ) )
+            continue;
+#ifdef _DIRENT_HAVE_D_TYPE
+        if ( entry->d_type == DT_DIR )
+            continue;
+#endif
+        if ( glob_match( pattern, name ) )
+            names.push_back( name );
+    }
+    closedir( dir );
+    std::sort( names.begin(), names.end(), natural_less );
+    file_names_.reserve( names.size() );
+    for ( size_t i( 0 ); i != names.size(); ++i )
+        file_names_.push_back( FileName( names[i] ) );
+    update_values();
+}
+
+// ********************************************************************************
+
+void FileList::sort_naturally()
+{
+    std::vector< std::string > names;
+    names.reserve( file_names_.size() );
+    for ( size_t i( 0 ); i != file_names_.size(); ++i )
+        names.push_back( file_names_[i].full_name() );
+    std::vector< size_t > order( names.size() );
+    for ( size_t i( 0 ); i != order.size(); ++i )
+        order[i] = i;
+    std::stable_sort( order.begin(), order.end(), [&]( const size_t lhs, const size_t rhs ) { return natural_less( names[lhs], names[rhs] ); } );
+    std::vector< FileName > sorted_file_names;
+    sorted_file_names.reserve( file_names_.size() );
+    for ( size_t i( 0 ); i != order.size(); ++i )
+        sorted_file_names.push_back( file_names_[ order[i] ] );
+    file_names_.swap( sorted_file_names );
+    update_values();
+}
+
+// ********************************************************************************
+
+std::vector< FileStatus > FileList::status( const size_t nthreads ) const
+{
+    std::vector< FileStatus > result( size() );
+    parallel_for( size(), nthreads, [&]( const size_t i ) { result[i] = FileStatus( value( i ) ); } );
+    return result;
+}
+
+// ********************************************************************************
+
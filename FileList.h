@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "FileName.h"
 
+#include <cstddef> // For definition of size_t
 #include <string>
 #include <vector>
 
@@ -48,6 +49,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
   If a base directory is supplied and the file name of the file list itself contains no path,
   then the base directory is taken to be the path of the file name.
   
+  Alternatively, initialise_from_directory() asks the operating system for the files in a directory that match a
+  wildcard pattern such as "*.cif".
+
   This class is becoming a bit of a Frankenclass. It is doing too many things and the implementation is not up to date with the documentation.
 */
 class FileList
@@ -69,14 +73,26 @@ public:
 
     void initialise_from_file( const FileName & file_name );
 
-    void push_back( const FileName & file_name ) { file_names_.push_back( file_name ); }
+    // Replaces the file names by those of the files in directory that match pattern ( * and ? wildcards, see glob_match() ),
+    // sorted with natural_less() so that frame_9.cif comes before frame_10.cif. Subdirectories are not included and
+    // hidden files are only included if pattern starts with a dot. The directory becomes the base directory.
+    void initialise_from_directory( const std::string & directory, const std::string & pattern = "*" );
+
+    // Sorts the file names with natural_less().
+    void sort_naturally();
+
+    // Existence, size and modification time of every file, checked on nthreads threads (0 means one thread per core),
+    // which helps on network file systems where every check has a long latency.
+    std::vector< FileStatus > status( const size_t nthreads = 1 ) const;
+
+    void push_back( const FileName & file_name );
 
-    void reserve( const size_t nvalues ) { file_names_.reserve( nvalues ); }
+    void reserve( const size_t nvalues ) { file_names_.reserve( nvalues ); values_.reserve( nvalues ); }
     size_t size() const { return file_names_.size(); }
     bool empty() const { return file_names_.empty(); }
 
     bool prepend_file_name_with_basedirectory() const { return prepend_file_name_with_basedirectory_; }
-    void set_prepend_file_name_with_basedirectory( const bool prepend_file_name_with_basedirectory ) { prepend_file_name_with_basedirectory_ = prepend_file_name_with_basedirectory; }
+    void set_prepend_file_name_with_basedirectory( const bool prepend_file_name_with_basedirectory );
 
     // Splits the file names into n lists of equal size that are stored as basename_i.
     // This provides a very quick and dirty parallelisation mechanism.
@@ -85,18 +101,22 @@ public:
     // Guaranteed to end in a backslash
     std::string base_directory() const { return base_directory_; }
 
-    // This is wasteful and an iterator would be much more elegant
-    FileName value( const size_t i ) const;
+    // The file name with the base directory prepended if required. The names are built when the list changes,
+    // so this is just a look-up.
+    const FileName & value( const size_t i ) const { return values_[ i ]; }
 
     // This really needs a flag to indicate if the directory name should explicitly be included / deleted / left as-is
     void save( const FileName & file_name ) const;
 
 private:
     std::string base_directory_;
-    std::vector< FileName > file_names_;
+    std::vector< FileName > file_names_; // As given
+    std::vector< FileName > values_;     // As returned by value()
     bool prepend_file_name_with_basedirectory_;
 
     void initialise_from_file_2( const FileName & file_name );
+    FileName make_value( const FileName & file_name ) const;
+    void update_values();
 };
 
 //FileList merge( const FileList & lhs, const FileList & rhs );
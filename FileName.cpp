@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <fstream>
 #include <stdexcept>
+#include <sys/stat.h>
 
 #include <iostream> // For debugging
 
@@ -40,9 +41,6 @@ const char default_slash_character = '/';
 FileName::FileName()
 {
     slash_character_ = default_slash_character;
-    set_directory( "" );
-    set_file_name( "" );
-    set_extension( "" );
 }
 
 // ********************************************************************************
@@ -54,9 +52,11 @@ FileName::FileName( std::string input )
     input = strip( input );
     input = remove_delimiters( input, "\"", "\"" );
     input = replace( input, "/", "\\" );
-    input = replace( input, "\\.\\", "\\" );
+    // Only paths that contain "\." can contain "\.\" or "\..\", most do not.
+    bool changed( input.find( "\\." ) != std::string::npos );
+    if ( changed )
+        input = replace( input, "\\.\\", "\\" );
     // Replace all occurrences of "\directory\..\" by "\"
-    bool changed( true );
     while ( changed )
     {
         changed = false;
@@ -79,12 +79,12 @@ FileName::FileName( std::string input )
     if ( iPos1 == std::string::npos )
     {
         iPos1 = 0;
-        set_directory( "" );
+        assign_directory( "" );
     }
     else
     {
         ++iPos1;
-        set_directory( "\"" + input.substr( 0, iPos1 ) + "\"" );
+        assign_directory( "\"" + input.substr( 0, iPos1 ) + "\"" );
     }
     // Find the last occurrence of "."
     // Three problem cases here:
@@ -95,14 +95,15 @@ FileName::FileName( std::string input )
     if ( ( iPos2 == std::string::npos ) ||
          ( iPos2 < iPos1 ) )
     {
-        set_file_name( "\"" + input.substr( iPos1 ) + "\"" );
-        set_extension( "" );
+        assign_file_name( "\"" + input.substr( iPos1 ) + "\"" );
+        assign_extension( "" );
     }
     else
     {
-        set_file_name( "\"" + input.substr( iPos1, iPos2-iPos1 ) + "\"" );
-        set_extension( "\"" + input.substr( iPos2+1 ) + "\"" );
+        assign_file_name( "\"" + input.substr( iPos1, iPos2-iPos1 ) + "\"" );
+        assign_extension( "\"" + input.substr( iPos2+1 ) + "\"" );
     }
+    full_name_ = assemble_file_name();
 }
 
 // ********************************************************************************
@@ -110,9 +111,10 @@ FileName::FileName( std::string input )
 FileName::FileName( const std::string & directory, const std::string & file_name, const std::string & extension )
 {
     slash_character_ = default_slash_character;
-    set_directory( directory );
-    set_file_name( file_name );
-    set_extension( extension );
+    assign_directory( directory );
+    assign_file_name( file_name );
+    assign_extension( extension );
+    full_name_ = assemble_file_name();
 }
 
 // ********************************************************************************
@@ -124,18 +126,37 @@ void FileName::set_full_name( const std::string & file_name )
     
 // ********************************************************************************
 
-std::string FileName::full_name() const
+void FileName::set_directory( const std::string & directory )
 {
-    return assemble_file_name();
+    assign_directory( directory );
+    full_name_ = assemble_file_name();
 }
 
 // ********************************************************************************
 
-void FileName::set_directory( const std::string & directory )
+// Extension is NOT included
+void FileName::set_file_name( const std::string & file_name )
+{
+    assign_file_name( file_name );
+    full_name_ = assemble_file_name();
+}
+
+// ********************************************************************************
+
+void FileName::set_extension( const std::string & extension )
+{
+    assign_extension( extension );
+    full_name_ = assemble_file_name();
+}
+
+// ********************************************************************************
+
+void FileName::assign_directory( const std::string & directory )
 {
     directory_ = strip( directory );
     directory_ = replace( directory_, "/", "\\" );
-    directory_ = replace( directory_, "\\.\\", "\\" );
+    if ( directory_.find( "\\." ) != std::string::npos )
+        directory_ = replace( directory_, "\\.\\", "\\" );
     if ( is_enclosed_in_quotes( directory_ ) )
         directory_ = extract_delimited_text( directory_, "\"", "\"" );
     if ( ! ( directory_.empty() || ( directory_.substr( directory_.length() - 1 ) == "\\" ) ) )
@@ -147,8 +168,7 @@ void FileName::set_directory( const std::string & directory )
 
 // ********************************************************************************
 
-// Extension is NOT included
-void FileName::set_file_name( const std::string & file_name )
+void FileName::assign_file_name( const std::string & file_name )
 {
     file_name_ = strip( file_name );
     file_name_ = replace( file_name_, "/", "\\" );
@@ -174,7 +194,7 @@ void FileName::set_file_name( const std::string & file_name )
 
 // ********************************************************************************
 
-void FileName::set_extension( const std::string & extension )
+void FileName::assign_extension( const std::string & extension )
 {
     extension_ = strip( extension );
     if ( is_enclosed_in_quotes( extension_ ) )
@@ -223,6 +243,7 @@ void FileName::set_slash_character( const char slash_character )
         slash_character_ = "\\";
     else
         throw std::runtime_error( "FileName::set_slash_character(): slash character must be / or \\." );
+    full_name_ = assemble_file_name();
 }
 
 // ********************************************************************************
@@ -284,7 +305,38 @@ FileName generate_unique_file_name( const FileName & file_name )
 
 std::string FileName::correct_slashes( const std::string & input ) const
 {
+    // replace() would never finish if the slash character is the backslash itself
+    if ( slash_character_ == "\\" )
+        return input;
     return replace( input, "\\", slash_character_ );
 }
 
 // ********************************************************************************
+
+// ********************************************************************************
+
+FileStatus::FileStatus( const FileName & file_name ): exists_(false), size_(0), modification_time_(0)
+{
+    struct stat file_status;
+    if ( stat( file_name.full_name().c_str(), &file_status ) != 0 )
+        return;
+    exists_ = true;
+    size_ = file_status.st_size;
+    modification_time_ = file_status.st_mtime;
+}
+
+// ********************************************************************************
+
+bool is_up_to_date( const FileName & lhs, const FileName & rhs )
+{
+    FileStatus lhs_status( lhs );
+    if ( ! lhs_status.exists() )
+        return false;
+    FileStatus rhs_status( rhs );
+    if ( ! rhs_status.exists() )
+        return true;
+    return ( lhs_status.modification_time() >= rhs_status.modification_time() );
+}
+
+// ********************************************************************************
+
@@ -28,6 +28,8 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include <cstddef> // For definition of size_t
+#include <ctime>
 #include <string>
 
 /*
@@ -64,15 +66,15 @@ public:
     FileName( const std::string & directory, const std::string & file_name, const std::string & extension );
 
     // always ends in backslash
-    std::string directory() const { return directory_; }
+    const std::string & directory() const { return directory_; }
 
     // Extension is NOT included, cannot end in a dot
-    std::string file_name() const { return file_name_; }
+    const std::string & file_name() const { return file_name_; }
 
 // @@ We need a file_name_plus_extension() const;
 
     // Does not include dot
-    std::string extension() const { return extension_; }
+    const std::string & extension() const { return extension_; }
     
     void set_directory( const std::string & directory );
 
@@ -85,8 +87,8 @@ public:
 
   // @@ Could add "force_quotes()" because some applications need that. Perhaps better, add "add_quotes()" to Utilities.h
 
-// @@ currently duplicate of assemble_file_name()
-    std::string full_name() const;
+    // Assembled once when one of the components changes, so calling this in a loop is cheap.
+    const std::string & full_name() const { return full_name_; }
 
     // Outputs full name with escaped slashes, i.e. turns "C:\Data\file_name.txt" into "C:\\Data\\file_name.txt",
     // necessary when writing input files for e.g. R.
@@ -105,7 +107,13 @@ private:
     std::string file_name_; // Extension is NOT included
     std::string extension_; // Does not include dot
     std::string slash_character_;
-    
+    std::string full_name_; // Cache of assemble_file_name()
+
+    // These three only normalise the component, they do not update full_name_.
+    void assign_directory( const std::string & directory );
+    void assign_file_name( const std::string & file_name );
+    void assign_extension( const std::string & extension );
+
     std::string assemble_file_name() const;
     std::string correct_slashes( const std::string & input ) const;
 };
@@ -129,4 +137,34 @@ FileName append_to_file_name( const FileName & file_name, const std::string & ad
 // to start searching.
 FileName generate_unique_file_name( const FileName & file_name );
 
+/*
+  Whether a file exists, its size and its last modification time, all from a single stat() call.
+  Meant for comparing the modification times of files and their caches.
+*/
+class FileStatus
+{
+public:
+
+    // A file that does not exist
+    FileStatus(): exists_(false), size_(0), modification_time_(0) {}
+
+    explicit FileStatus( const FileName & file_name );
+
+    bool exists() const { return exists_; }
+
+    // In bytes, 0 if the file does not exist.
+    size_t size() const { return size_; }
+
+    // 0 if the file does not exist.
+    time_t modification_time() const { return modification_time_; }
+
+private:
+    bool exists_;
+    size_t size_;
+    time_t modification_time_;
+};
+
+// True if lhs exists and was modified no earlier than rhs, or if lhs exists and rhs does not.
+bool is_up_to_date( const FileName & lhs, const FileName & rhs );
+
 #endif // FILENAME_H
@@ -0,0 +1,196 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "FlexibleMolecule.h"
+#include "CrystalStructure.h"
+#include "Element.h"
+#include "Matrix3D.h"
+#include "Quaternion.h"
+
+#include <stdexcept>
+
+// ********************************************************************************
+
+FlexibleMolecule::FlexibleMolecule( const CrystalStructure & crystal_structure )
+{
+    const size_t natoms = crystal_structure.natoms();
+    if ( natoms == 0 )
+        throw std::runtime_error( "FlexibleMolecule::FlexibleMolecule(): no atoms." );
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    atoms_.reserve( natoms );
+    Vector3D centroid;
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        Atom atom = crystal_structure.atom( i );
+        atom.set_position( crystal_lattice.fractional_to_orthogonal( atom.position() ) );
+        centroid += atom.position();
+        atoms_.push_back( atom );
+    }
+    centroid /= natoms;
+    for ( size_t i( 0 ); i != natoms; ++i )
+        atoms_[i].set_position( atoms_[i].position() - centroid );
+    neighbours_.resize( natoms );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        for ( size_t j( i + 1 ); j != natoms; ++j )
+        {
+            if ( are_bonded( atoms_[i].element(), atoms_[j].element(), ( atoms_[i].position() - atoms_[j].position() ).norm2() ) )
+            {
+                neighbours_[i].push_back( j );
+                neighbours_[j].push_back( i );
+            }
+        }
+    }
+}
+
+// ********************************************************************************
+
+void FlexibleMolecule::add_torsion( const size_t atom_1, const size_t atom_2 )
+{
+    if ( ( atom_1 >= natoms() ) || ( atom_2 >= natoms() ) )
+        throw std::runtime_error( "FlexibleMolecule::add_torsion(): atom index out of range." );
+    bool bonded( false );
+    for ( size_t i( 0 ); i != neighbours_[atom_1].size(); ++i )
+    {
+        if ( neighbours_[atom_1][i] == atom_2 )
+            bonded = true;
+    }
+    if ( ! bonded )
+        throw std::runtime_error( "FlexibleMolecule::add_torsion(): atoms " + atoms_[atom_1].label() + " and " + atoms_[atom_2].label() + " are not bonded." );
+    Torsion torsion;
+    torsion.atom_1_ = atom_1;
+    torsion.atom_2_ = atom_2;
+    if ( ! find_moving_atoms( atom_1, atom_2, torsion.moving_atoms_ ) )
+        throw std::runtime_error( "FlexibleMolecule::add_torsion(): bond " + atoms_[atom_1].label() + "-" + atoms_[atom_2].label() + " is part of a ring." );
+    torsions_.push_back( torsion );
+}
+
+// ********************************************************************************
+
+void FlexibleMolecule::add_rotatable_bonds()
+{
+    std::vector< size_t > nheavy_neighbours( natoms(), 0 );
+    for ( size_t i( 0 ); i != natoms(); ++i )
+    {
+        for ( size_t j( 0 ); j != neighbours_[i].size(); ++j )
+        {
+            if ( ! atoms_[ neighbours_[i][j] ].element().is_H_or_D() )
+                ++nheavy_neighbours[i];
+        }
+    }
+    for ( size_t i( 0 ); i != natoms(); ++i )
+    {
+        for ( size_t k( 0 ); k != neighbours_[i].size(); ++k )
+        {
+            const size_t j = neighbours_[i][k];
+            if ( j < i )
+                continue;
+            if ( atoms_[i].element().is_H_or_D() || atoms_[j].element().is_H_or_D() )
+                continue;
+            // Both atoms must have a non-hydrogen neighbour other than each other
+            if ( ( nheavy_neighbours[i] < 2 ) || ( nheavy_neighbours[j] < 2 ) )
+                continue;
+            std::vector< size_t > moving_atoms;
+            if ( ! find_moving_atoms( i, j, moving_atoms ) )
+                continue;
+            Torsion torsion;
+            torsion.atom_1_ = i;
+            torsion.atom_2_ = j;
+            torsion.moving_atoms_ = moving_atoms;
+            if ( 2 * moving_atoms.size() > natoms() )
+            {
+                torsion.atom_1_ = j;
+                torsion.atom_2_ = i;
+                find_moving_atoms( j, i, torsion.moving_atoms_ );
+            }
+            torsions_.push_back( torsion );
+        }
+    }
+}
+
+// ********************************************************************************
+
+void FlexibleMolecule::generate( const Matrix3D & rotation, const std::vector< Angle > & torsion_changes, std::vector< Vector3D > & positions ) const
+{
+    if ( torsion_changes.size() != torsions_.size() )
+        throw std::runtime_error( "FlexibleMolecule::generate(): wrong number of torsion angles." );
+    positions.resize( natoms() );
+    for ( size_t i( 0 ); i != natoms(); ++i )
+        positions[i] = atoms_[i].position();
+    for ( size_t i( 0 ); i != torsions_.size(); ++i )
+    {
+        if ( torsion_changes[i] == Angle() )
+            continue;
+        const Torsion & torsion = torsions_[i];
+        const Vector3D origin = positions[ torsion.atom_2_ ];
+        Vector3D axis = origin - positions[ torsion.atom_1_ ];
+        axis /= axis.length();
+        const Angle half_angle = 0.5 * torsion_changes[i];
+        const double sine = half_angle.sine();
+        const Matrix3D torsion_rotation = Quaternion( half_angle.cosine(), sine * axis.x(), sine * axis.y(), sine * axis.z() ).rotation_matrix();
+        for ( size_t j( 0 ); j != torsion.moving_atoms_.size(); ++j )
+        {
+            const size_t k = torsion.moving_atoms_[j];
+            positions[k] = origin + torsion_rotation * ( positions[k] - origin );
+        }
+    }
+    for ( size_t i( 0 ); i != natoms(); ++i )
+        positions[i] = rotation * positions[i];
+}
+
+// ********************************************************************************
+
+bool FlexibleMolecule::find_moving_atoms( const size_t atom_1, const size_t atom_2, std::vector< size_t > & moving_atoms ) const
+{
+    moving_atoms.clear();
+    std::vector< bool > visited( natoms(), false );
+    visited[atom_2] = true;
+    std::vector< size_t > stack( 1, atom_2 );
+    while ( ! stack.empty() )
+    {
+        const size_t current = stack.back();
+        stack.pop_back();
+        for ( size_t i( 0 ); i != neighbours_[current].size(); ++i )
+        {
+            const size_t neighbour = neighbours_[current][i];
+            if ( ( current == atom_2 ) && ( neighbour == atom_1 ) )
+                continue;
+            if ( neighbour == atom_1 )
+                return false;
+            if ( visited[neighbour] )
+                continue;
+            visited[neighbour] = true;
+            moving_atoms.push_back( neighbour );
+            stack.push_back( neighbour );
+        }
+    }
+    return true;
+}
+
+// ********************************************************************************
+
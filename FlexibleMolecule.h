@@ -0,0 +1,93 @@
+#ifndef FLEXIBLEMOLECULE_H
+#define FLEXIBLEMOLECULE_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Angle.h"
+#include "Atom.h"
+#include "SmallVector.h"
+
+class CrystalStructure;
+class Matrix3D;
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+/*
+  A molecule for direct-space structure solution: a rigid body plus a number of torsion angles.
+
+  The atoms are stored in Cartesian coordinates relative to the centroid of the starting conformation.
+  A torsion rotates the atoms on one side of a bond about that bond, the torsion angles are changes
+  relative to the starting conformation. Bonds are detected as in CrystalStructure::perceive_molecules().
+*/
+class FlexibleMolecule
+{
+public:
+
+    // All atoms of crystal_structure form the molecule, the space group is ignored.
+    explicit FlexibleMolecule( const CrystalStructure & crystal_structure );
+
+    size_t natoms() const { return atoms_.size(); }
+    const Atom & atom( const size_t i ) const { return atoms_[i]; }
+
+    // The atoms on the side of atom_2 rotate about the bond atom_1-atom_2.
+    // Throws if the two atoms are not bonded or if the bond is part of a ring.
+    void add_torsion( const size_t atom_1, const size_t atom_2 );
+
+    // Adds a torsion for every bond that is not part of a ring and where both atoms have at least one other non-hydrogen neighbour,
+    // the smaller side of the molecule is moved. Bond orders are not known, so bonds with double-bond character are included as well.
+    void add_rotatable_bonds();
+
+    size_t ntorsions() const { return torsions_.size(); }
+    size_t torsion_atom_1( const size_t i ) const { return torsions_[i].atom_1_; }
+    size_t torsion_atom_2( const size_t i ) const { return torsions_[i].atom_2_; }
+    const std::vector< size_t > & moving_atoms( const size_t i ) const { return torsions_[i].moving_atoms_; }
+
+    // The Cartesian coordinates after changing the torsion angles by torsion_changes (in the order in which the torsions were added)
+    // and then rotating the molecule about the origin.
+    void generate( const Matrix3D & rotation, const std::vector< Angle > & torsion_changes, std::vector< Vector3D > & positions ) const;
+
+private:
+    struct Torsion
+    {
+        size_t atom_1_;
+        size_t atom_2_;
+        std::vector< size_t > moving_atoms_;
+    };
+
+    std::vector< Atom > atoms_;
+    std::vector< SmallVector< size_t, 4 > > neighbours_;
+    std::vector< Torsion > torsions_;
+
+    // The atoms reachable from atom_2 without crossing the bond atom_2-atom_1. Returns false if atom_1 is reachable, i.e. the bond is in a ring.
+    bool find_moving_atoms( const size_t atom_1, const size_t atom_2, std::vector< size_t > & moving_atoms ) const;
+};
+
+#endif // FLEXIBLEMOLECULE_H
+
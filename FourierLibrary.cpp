@@ -0,0 +1,373 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "FourierLibrary.h"
+#include "BatchPowderPatternCalculator.h"
+#include "CorrelationMatrix.h"
+#include "CrystalStructure.h"
+#include "DuplicateFinder.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "ParallelFor.h"
+#include "PowderPattern.h"
+#include "ReadCif.h"
+#include "SimilarityAnalysis.h"
+#include "VoidsFinder.h"
+
+#include <stdexcept>
+
+namespace
+{
+
+FileList make_file_list( const std::vector< std::string > & file_names )
+{
+    std::vector< FileName > result;
+    result.reserve( file_names.size() );
+    for ( size_t i( 0 ); i != file_names.size(); ++i )
+        result.push_back( FileName( file_names[i] ) );
+    return FileList( result );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+class PowderPatternEngine::Implementation
+{
+public:
+    BatchPowderPatternCalculator batch_powder_pattern_calculator_;
+};
+
+// ********************************************************************************
+
+PowderPatternEngine::PowderPatternEngine():
+implementation_( new Implementation )
+{
+    BatchPowderPatternCalculator & calculator = implementation_->batch_powder_pattern_calculator_;
+    calculator.set_wavelength( 1.54056 );
+    calculator.set_two_theta_start( Angle( 3.0, Angle::DEGREES ) );
+    calculator.set_two_theta_end( Angle( 35.0, Angle::DEGREES ) );
+    calculator.set_two_theta_step( Angle( 0.01, Angle::DEGREES ) );
+    calculator.set_FWHM( 0.1 );
+}
+
+// ********************************************************************************
+
+PowderPatternEngine::~PowderPatternEngine()
+{
+    delete implementation_;
+}
+
+// ********************************************************************************
+
+void PowderPatternEngine::set_wavelength( const double wavelength )
+{
+    implementation_->batch_powder_pattern_calculator_.set_wavelength( wavelength );
+}
+
+// ********************************************************************************
+
+void PowderPatternEngine::set_two_theta_range( const double two_theta_start, const double two_theta_end, const double two_theta_step )
+{
+    if ( ( two_theta_step <= 0.0 ) || ( two_theta_end <= two_theta_start ) )
+        throw std::runtime_error( "PowderPatternEngine::set_two_theta_range(): invalid range." );
+    implementation_->batch_powder_pattern_calculator_.set_two_theta_start( Angle( two_theta_start, Angle::DEGREES ) );
+    implementation_->batch_powder_pattern_calculator_.set_two_theta_end( Angle( two_theta_end, Angle::DEGREES ) );
+    implementation_->batch_powder_pattern_calculator_.set_two_theta_step( Angle( two_theta_step, Angle::DEGREES ) );
+}
+
+// ********************************************************************************
+
+void PowderPatternEngine::set_FWHM( const double FWHM )
+{
+    implementation_->batch_powder_pattern_calculator_.set_FWHM( FWHM );
+}
+
+// ********************************************************************************
+
+void PowderPatternEngine::set_nthreads( const size_t nthreads )
+{
+    implementation_->batch_powder_pattern_calculator_.set_nthreads( nthreads );
+}
+
+// ********************************************************************************
+
+void PowderPatternEngine::calculate( const std::vector< std::string > & cif_file_names )
+{
+    implementation_->batch_powder_pattern_calculator_.calculate( make_file_list( cif_file_names ) );
+}
+
+// ********************************************************************************
+
+size_t PowderPatternEngine::npatterns() const
+{
+    return implementation_->batch_powder_pattern_calculator_.npatterns();
+}
+
+// ********************************************************************************
+
+size_t PowderPatternEngine::npoints() const
+{
+    return implementation_->batch_powder_pattern_calculator_.npoints();
+}
+
+// ********************************************************************************
+
+double PowderPatternEngine::two_theta( const size_t j ) const
+{
+    const BatchPowderPatternCalculator & calculator = implementation_->batch_powder_pattern_calculator_;
+    return ( calculator.two_theta_start() + j * calculator.two_theta_step() ).value_in_degrees();
+}
+
+// ********************************************************************************
+
+std::vector< double > PowderPatternEngine::intensities( const size_t i ) const
+{
+    const BatchPowderPatternCalculator & calculator = implementation_->batch_powder_pattern_calculator_;
+    if ( i >= calculator.npatterns() )
+        throw std::runtime_error( "PowderPatternEngine::intensities(): index out of range." );
+    return std::vector< double >( calculator.intensities( i ), calculator.intensities( i ) + calculator.npoints() );
+}
+
+// ********************************************************************************
+
+const double * PowderPatternEngine::intensity_matrix() const
+{
+    const BatchPowderPatternCalculator & calculator = implementation_->batch_powder_pattern_calculator_;
+    if ( calculator.npatterns() == 0 )
+        return 0;
+    return calculator.intensities( 0 );
+}
+
+// ********************************************************************************
+
+std::vector< double > PowderPatternEngine::similarity_matrix( const double l ) const
+{
+    std::vector< double > result( npatterns() * npatterns() );
+    if ( ! result.empty() )
+        similarity_matrix( l, &result[0] );
+    return result;
+}
+
+// ********************************************************************************
+
+void PowderPatternEngine::similarity_matrix( const double l, double * result ) const
+{
+    const BatchPowderPatternCalculator & calculator = implementation_->batch_powder_pattern_calculator_;
+    CorrelationMatrix correlation_matrix = calculate_correlation_matrix( calculator, Angle( l, Angle::DEGREES ), 0.0, calculator.nthreads() );
+    const size_t n = calculator.npatterns();
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        for ( size_t j( 0 ); j != n; ++j )
+            result[ i * n + j ] = correlation_matrix.value( i, j );
+    }
+}
+
+// ********************************************************************************
+
+class CrystalStructureEngine::Implementation
+{
+public:
+    Implementation(): nthreads_(0) {}
+    size_t nthreads_;
+    std::vector< CrystalStructure > crystal_structures_;
+};
+
+// ********************************************************************************
+
+CrystalStructureEngine::CrystalStructureEngine():
+implementation_( new Implementation )
+{
+}
+
+// ********************************************************************************
+
+CrystalStructureEngine::~CrystalStructureEngine()
+{
+    delete implementation_;
+}
+
+// ********************************************************************************
+
+void CrystalStructureEngine::set_nthreads( const size_t nthreads )
+{
+    implementation_->nthreads_ = nthreads;
+}
+
+// ********************************************************************************
+
+void CrystalStructureEngine::read( const std::vector< std::string > & cif_file_names )
+{
+    std::vector< CrystalStructure > crystal_structures( cif_file_names.size() );
+    parallel_for( cif_file_names.size(), implementation_->nthreads_, [&]( const size_t i )
+    {
+        read_cif( FileName( cif_file_names[i] ), crystal_structures[i] );
+        crystal_structures[i].apply_space_group_symmetry();
+    } );
+    implementation_->crystal_structures_.swap( crystal_structures );
+}
+
+// ********************************************************************************
+
+size_t CrystalStructureEngine::size() const
+{
+    return implementation_->crystal_structures_.size();
+}
+
+// ********************************************************************************
+
+size_t CrystalStructureEngine::natoms( const size_t i ) const
+{
+    if ( i >= size() )
+        throw std::runtime_error( "CrystalStructureEngine::natoms(): index out of range." );
+    return implementation_->crystal_structures_[i].natoms();
+}
+
+// ********************************************************************************
+
+double CrystalStructureEngine::density( const size_t i ) const
+{
+    if ( i >= size() )
+        throw std::runtime_error( "CrystalStructureEngine::density(): index out of range." );
+    return implementation_->crystal_structures_[i].density();
+}
+
+// ********************************************************************************
+
+std::vector< double > CrystalStructureEngine::void_volumes( const double probe_radius, const double grid_spacing ) const
+{
+    std::vector< double > result( size() );
+    if ( ! result.empty() )
+        void_volumes( probe_radius, grid_spacing, &result[0] );
+    return result;
+}
+
+// ********************************************************************************
+
+void CrystalStructureEngine::void_volumes( const double probe_radius, const double grid_spacing, double * result ) const
+{
+    parallel_for( size(), implementation_->nthreads_, [&]( const size_t i )
+    {
+        result[i] = find_voids( implementation_->crystal_structures_[i], probe_radius, grid_spacing );
+    } );
+}
+
+// ********************************************************************************
+
+void CrystalStructureEngine::lattice_parameters( const size_t i, double * result ) const
+{
+    if ( i >= size() )
+        throw std::runtime_error( "CrystalStructureEngine::lattice_parameters(): index out of range." );
+    const CrystalLattice & crystal_lattice = implementation_->crystal_structures_[i].crystal_lattice();
+    result[0] = crystal_lattice.a();
+    result[1] = crystal_lattice.b();
+    result[2] = crystal_lattice.c();
+    result[3] = crystal_lattice.alpha().value_in_degrees();
+    result[4] = crystal_lattice.beta().value_in_degrees();
+    result[5] = crystal_lattice.gamma().value_in_degrees();
+}
+
+// ********************************************************************************
+
+void CrystalStructureEngine::fractional_coordinates( const size_t i, double * result ) const
+{
+    if ( i >= size() )
+        throw std::runtime_error( "CrystalStructureEngine::fractional_coordinates(): index out of range." );
+    const CrystalStructure & crystal_structure = implementation_->crystal_structures_[i];
+    for ( size_t j( 0 ); j != crystal_structure.natoms(); ++j )
+    {
+        const Vector3D position = crystal_structure.atom( j ).position();
+        result[ 3 * j     ] = position.x();
+        result[ 3 * j + 1 ] = position.y();
+        result[ 3 * j + 2 ] = position.z();
+    }
+}
+
+// ********************************************************************************
+
+std::string CrystalStructureEngine::element( const size_t i, const size_t j ) const
+{
+    if ( ( i >= size() ) || ( j >= natoms( i ) ) )
+        throw std::runtime_error( "CrystalStructureEngine::element(): index out of range." );
+    return implementation_->crystal_structures_[i].atom( j ).element().symbol();
+}
+
+// ********************************************************************************
+
+double CrystalStructureEngine::RMSCD( const size_t i, const size_t j ) const
+{
+    if ( ( i >= size() ) || ( j >= size() ) )
+        throw std::runtime_error( "CrystalStructureEngine::RMSCD(): index out of range." );
+    return RMSCD_unit_cell( implementation_->crystal_structures_[i], implementation_->crystal_structures_[j] );
+}
+
+// ********************************************************************************
+
+void CrystalStructureEngine::RMSCD_matrix( double * result ) const
+{
+    const size_t n = size();
+    parallel_for( n, implementation_->nthreads_, [&]( const size_t i )
+    {
+        result[ i * n + i ] = 0.0;
+        for ( size_t j( i + 1 ); j < n; ++j )
+        {
+            result[ i * n + j ] = RMSCD_unit_cell( implementation_->crystal_structures_[i], implementation_->crystal_structures_[j] );
+            result[ j * n + i ] = result[ i * n + j ];
+        }
+    } );
+}
+
+// ********************************************************************************
+
+void similarity_matrix( const double * intensities, const size_t npatterns, const size_t npoints, const double two_theta_step,
+                        const double l, double * result, const size_t nthreads )
+{
+    if ( ( npoints < 2 ) || ( two_theta_step <= 0.0 ) )
+        throw std::runtime_error( "similarity_matrix(): invalid 2theta grid." );
+    // The similarity does not depend on where the grid starts.
+    const Angle step( two_theta_step, Angle::DEGREES );
+    std::vector< PowderPattern > powder_patterns( npatterns, PowderPattern( step, step * npoints, step ) );
+    if ( ( npatterns != 0 ) && ( powder_patterns[0].size() != npoints ) )
+        throw std::runtime_error( "similarity_matrix(): 2theta grid could not be reconstructed." );
+    parallel_for( npatterns, nthreads, [&]( const size_t i )
+    {
+        for ( size_t j( 0 ); j != npoints; ++j )
+            powder_patterns[i].set_intensity( j, intensities[ i * npoints + j ] );
+        powder_patterns[i].recalculate_estimated_standard_deviations();
+    } );
+    parallel_for( npatterns, nthreads, [&]( const size_t i )
+    {
+        result[ i * npatterns + i ] = 1.0;
+        for ( size_t j( i + 1 ); j < npatterns; ++j )
+        {
+            result[ i * npatterns + j ] = normalised_weighted_cross_correlation( powder_patterns[i], powder_patterns[j], Angle( l, Angle::DEGREES ) );
+            result[ j * npatterns + i ] = result[ i * npatterns + j ];
+        }
+    } );
+}
+
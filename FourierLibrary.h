@@ -0,0 +1,164 @@
+#ifndef FOURIERLIBRARY_H
+#define FOURIERLIBRARY_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+/*
+  The stable interface for programs that link against libFourier.a or libFourier.so ("make lib").
+
+  Only standard headers are included and the engines are opaque handles, so that programs that use them do not have
+  to be recompiled when the classes inside the library change. Structures are passed as the names of .cif files.
+  Errors are thrown as std::exception.
+  The functions that take a double * write their results into memory owned by the caller, e.g. a NumPy array (see FourierPython.cpp).
+*/
+
+// Incremented whenever this interface changes incompatibly.
+const int Fourier_library_version = 1;
+
+/*
+  Calculates the powder patterns of many crystal structures with the same settings, in parallel.
+  The defaults are those of calculate_correlation_matrix( FileList ): 1.54056 A, 3.0-35.0 degrees 2theta in steps of 0.01, FWHM 0.1.
+*/
+class PowderPatternEngine
+{
+public:
+
+    PowderPatternEngine();
+
+    ~PowderPatternEngine();
+
+    void set_wavelength( const double wavelength );
+
+    // In degrees.
+    void set_two_theta_range( const double two_theta_start, const double two_theta_end, const double two_theta_step );
+
+    // In degrees.
+    void set_FWHM( const double FWHM );
+
+    // 0 means one thread per core.
+    void set_nthreads( const size_t nthreads );
+
+    // Reads the .cif files, applies the space-group symmetry and calculates the patterns, each normalised to its highest peak.
+    void calculate( const std::vector< std::string > & cif_file_names );
+
+    size_t npatterns() const;
+    size_t npoints() const;
+
+    // In degrees.
+    double two_theta( const size_t j ) const;
+
+    std::vector< double > intensities( const size_t i ) const;
+
+    // The npatterns() x npoints() intensities, row by row, without copying. Valid until the next calculate().
+    const double * intensity_matrix() const;
+
+    // normalised_weighted_cross_correlation() of all pairs of patterns, npatterns() x npatterns() values row by row.
+    // l in degrees.
+    std::vector< double > similarity_matrix( const double l = 1.0 ) const;
+
+    // As above, result must hold npatterns() x npatterns() values.
+    void similarity_matrix( const double l, double * result ) const;
+
+private:
+    class Implementation;
+    Implementation * implementation_;
+
+    // Not copyable
+    PowderPatternEngine( const PowderPatternEngine & );
+    PowderPatternEngine & operator=( const PowderPatternEngine & );
+};
+
+/*
+  A set of crystal structures that are read once and then analysed, in parallel.
+*/
+class CrystalStructureEngine
+{
+public:
+
+    CrystalStructureEngine();
+
+    ~CrystalStructureEngine();
+
+    // 0 means one thread per core.
+    void set_nthreads( const size_t nthreads );
+
+    // Reads the .cif files and applies the space-group symmetry. Replaces any structures read before.
+    void read( const std::vector< std::string > & cif_file_names );
+
+    size_t size() const;
+
+    // Number of atoms in the unit cell.
+    size_t natoms( const size_t i ) const;
+
+    // In g/cm3.
+    double density( const size_t i ) const;
+
+    // The volumes, in A^3, of the voids accessible to a probe of probe_radius, as find_voids().
+    std::vector< double > void_volumes( const double probe_radius = 1.2, const double grid_spacing = 0.15 ) const;
+
+    // As above, result must hold size() values.
+    void void_volumes( const double probe_radius, const double grid_spacing, double * result ) const;
+
+    // a, b, c in A and alpha, beta, gamma in degrees, result must hold 6 values.
+    void lattice_parameters( const size_t i, double * result ) const;
+
+    // The fractional coordinates of the natoms( i ) atoms in the unit cell, result must hold natoms( i ) x 3 values.
+    void fractional_coordinates( const size_t i, double * result ) const;
+
+    // The element symbol of atom j of structure i.
+    std::string element( const size_t i, const size_t j ) const;
+
+    // RMSCD_unit_cell() of structures i and j, in A.
+    double RMSCD( const size_t i, const size_t j ) const;
+
+    // RMSCD_unit_cell() of all pairs of structures, result must hold size() x size() values.
+    void RMSCD_matrix( double * result ) const;
+
+private:
+    class Implementation;
+    Implementation * implementation_;
+
+    // Not copyable
+    CrystalStructureEngine( const CrystalStructureEngine & );
+    CrystalStructureEngine & operator=( const CrystalStructureEngine & );
+};
+
+/*
+  normalised_weighted_cross_correlation() of all pairs of npatterns patterns that are given as npatterns x npoints intensities,
+  row by row, on the same 2theta grid with step two_theta_step. result must hold npatterns x npatterns values.
+  two_theta_step and l in degrees. 0 threads means one thread per core.
+*/
+void similarity_matrix( const double * intensities, const size_t npatterns, const size_t npoints, const double two_theta_step,
+                        const double l, double * result, const size_t nthreads = 0 );
+
+#endif // FOURIERLIBRARY_H
@@ -0,0 +1,847 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+/*
+  The Python module "fourier" ("make python"), a thin layer over the engines of FourierLibrary.h.
+
+  Numbers are exchanged through the buffer protocol, without copying:
+    - a PowderPatternEngine exports its npatterns x npoints intensities itself, read-only;
+    - functions with an out argument write straight into it, any writable C-contiguous float64 buffer of the right size;
+    - without out they return a fourier.Array, which numpy.asarray() and memoryview() wrap without copying;
+    - fourier.similarity_matrix() reads its intensities from any C-contiguous float64 buffer.
+  The GIL is released while the engines calculate; an engine can only be used by one Python thread at a time.
+  Errors from the library are raised as RuntimeError.
+
+      import fourier, numpy
+      engine = fourier.PowderPatternEngine( two_theta_end = 40.0, nthreads = 8 )
+      engine.calculate( [ "a.cif", "b.cif" ] )
+      intensities = numpy.asarray( engine )
+      S = numpy.empty( ( engine.npatterns(), engine.npatterns() ) )
+      engine.similarity_matrix( l = 1.0, out = S )
+*/
+
+// Python.h must come before the standard headers
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "FourierLibrary.h"
+
+#include <cstring>
+#include <exception>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Used as the address of empty buffers.
+double no_values[1];
+
+// Calls f() with the GIL held. Converts C++ exceptions to RuntimeError, returns false if an exception was set.
+template< typename F >
+bool call( F f )
+{
+    try
+    {
+        f();
+    }
+    catch ( std::exception & e )
+    {
+        PyErr_SetString( PyExc_RuntimeError, e.what() );
+        return false;
+    }
+    return true;
+}
+
+// As call(), but releases the GIL while f() runs. f() must not touch any Python object.
+template< typename F >
+bool call_without_GIL( F f )
+{
+    std::string error_message;
+    bool failed( false );
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        f();
+    }
+    catch ( std::exception & e )
+    {
+        failed = true;
+        error_message = e.what();
+    }
+    Py_END_ALLOW_THREADS
+    if ( failed )
+        PyErr_SetString( PyExc_RuntimeError, error_message.c_str() );
+    return ! failed;
+}
+
+// ********************************************************************************
+
+bool is_double_format( const char * format )
+{
+    if ( format == 0 ) // Unsigned bytes
+        return false;
+    return ( strcmp( format, "d" ) == 0 ) || ( strcmp( format, "@d" ) == 0 ) || ( strcmp( format, "=d" ) == 0 ) ||
+#if PY_LITTLE_ENDIAN
+           ( strcmp( format, "<d" ) == 0 );
+#else
+           ( strcmp( format, ">d" ) == 0 );
+#endif
+}
+
+// ********************************************************************************
+
+bool check_index( const Py_ssize_t i, const size_t n )
+{
+    if ( ( i < 0 ) || ( static_cast< size_t >( i ) >= n ) )
+    {
+        PyErr_SetString( PyExc_IndexError, "index out of range" );
+        return false;
+    }
+    return true;
+}
+
+// ********************************************************************************
+
+// A str, bytes or os.PathLike object, or a sequence of them.
+bool file_names_from_sequence( PyObject * sequence, std::vector< std::string > & file_names )
+{
+    PyObject * items = PySequence_Fast( sequence, "expected a sequence of file names" );
+    if ( items == 0 )
+        return false;
+    const Py_ssize_t n = PySequence_Fast_GET_SIZE( items );
+    file_names.clear();
+    file_names.reserve( n );
+    for ( Py_ssize_t i( 0 ); i != n; ++i )
+    {
+        PyObject * bytes = 0;
+        if ( PyUnicode_FSConverter( PySequence_Fast_GET_ITEM( items, i ), &bytes ) == 0 )
+        {
+            Py_DECREF( items );
+            return false;
+        }
+        file_names.push_back( std::string( PyBytes_AS_STRING( bytes ), PyBytes_GET_SIZE( bytes ) ) );
+        Py_DECREF( bytes );
+    }
+    Py_DECREF( items );
+    return true;
+}
+
+// ********************************************************************************
+
+// fourier.Array: a one- or two-dimensional array of doubles that is owned by C++ and only accessible through the buffer protocol.
+struct ArrayObject
+{
+    PyObject_HEAD
+    std::vector< double > * values;
+    int ndim;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+};
+
+void Array_dealloc( ArrayObject * self )
+{
+    delete self->values;
+    Py_TYPE( self )->tp_free( reinterpret_cast< PyObject * >( self ) );
+}
+
+int Array_getbuffer( ArrayObject * self, Py_buffer * view, int flags )
+{
+    view->obj = reinterpret_cast< PyObject * >( self );
+    Py_INCREF( self );
+    view->buf = self->values->empty() ? no_values : &(*self->values)[0];
+    view->len = self->values->size() * sizeof( double );
+    view->readonly = 0;
+    view->itemsize = sizeof( double );
+    view->format = ( flags & PyBUF_FORMAT ) ? const_cast< char * >( "d" ) : 0;
+    view->ndim = self->ndim;
+    view->shape = ( flags & PyBUF_ND ) ? self->shape : 0;
+    view->strides = ( ( flags & PyBUF_STRIDES ) == PyBUF_STRIDES ) ? self->strides : 0;
+    view->suboffsets = 0;
+    view->internal = 0;
+    return 0;
+}
+
+PyObject * Array_shape( ArrayObject * self, void * )
+{
+    if ( self->ndim == 1 )
+        return Py_BuildValue( "(n)", self->shape[0] );
+    return Py_BuildValue( "(nn)", self->shape[0], self->shape[1] );
+}
+
+PyBufferProcs Array_as_buffer = { reinterpret_cast< getbufferproc >( Array_getbuffer ), 0 };
+
+PyGetSetDef Array_getset[] =
+{
+    { "shape", reinterpret_cast< getter >( Array_shape ), 0, "Tuple of the dimensions.", 0 },
+    { 0, 0, 0, 0, 0 }
+};
+
+PyTypeObject Array_type = { PyVarObject_HEAD_INIT( 0, 0 ) };
+
+// ncolumns == 0 means one dimension.
+ArrayObject * new_array( const Py_ssize_t nrows, const Py_ssize_t ncolumns = 0 )
+{
+    ArrayObject * result = PyObject_New( ArrayObject, &Array_type );
+    if ( result == 0 )
+        return 0;
+    result->ndim = ( ncolumns == 0 ) ? 1 : 2;
+    result->shape[0] = nrows;
+    result->shape[1] = ncolumns;
+    result->strides[0] = ( ncolumns == 0 ) ? sizeof( double ) : ncolumns * sizeof( double );
+    result->strides[1] = sizeof( double );
+    try
+    {
+        result->values = new std::vector< double >( ( ncolumns == 0 ) ? nrows : nrows * ncolumns );
+    }
+    catch ( std::bad_alloc & )
+    {
+        result->values = 0;
+        Py_DECREF( result );
+        PyErr_NoMemory();
+        return 0;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+/*
+  The destination of n results: the buffer of out if it is not None, otherwise a new fourier.Array
+  of nrows x ncolumns (ncolumns == 0 means one dimension).
+*/
+class Output
+{
+public:
+
+    Output(): array_(0), out_(0) { view_.obj = 0; }
+
+    ~Output()
+    {
+        if ( view_.obj != 0 )
+            PyBuffer_Release( &view_ );
+        Py_XDECREF( array_ );
+    }
+
+    bool initialise( PyObject * out, const Py_ssize_t nrows, const Py_ssize_t ncolumns = 0 )
+    {
+        const Py_ssize_t n = ( ncolumns == 0 ) ? nrows : nrows * ncolumns;
+        if ( ( out == 0 ) || ( out == Py_None ) )
+        {
+            array_ = new_array( nrows, ncolumns );
+            return array_ != 0;
+        }
+        if ( PyObject_GetBuffer( out, &view_, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE | PyBUF_FORMAT ) != 0 )
+            return false;
+        if ( ! is_double_format( view_.format ) )
+        {
+            PyErr_SetString( PyExc_TypeError, "out must hold float64 values" );
+            return false;
+        }
+        if ( view_.len != static_cast< Py_ssize_t >( n * sizeof( double ) ) )
+        {
+            PyErr_Format( PyExc_ValueError, "out must hold %zd values", n );
+            return false;
+        }
+        out_ = out;
+        return true;
+    }
+
+    double * data() const
+    {
+        if ( array_ != 0 )
+            return array_->values->empty() ? no_values : &(*array_->values)[0];
+        return static_cast< double * >( view_.buf );
+    }
+
+    // New reference to out or to the new array.
+    PyObject * result()
+    {
+        PyObject * result = ( array_ != 0 ) ? reinterpret_cast< PyObject * >( array_ ) : out_;
+        Py_INCREF( result );
+        return result;
+    }
+
+private:
+    ArrayObject * array_;
+    PyObject * out_;
+    Py_buffer view_;
+
+    // Not copyable
+    Output( const Output & );
+    Output & operator=( const Output & );
+};
+
+// ********************************************************************************
+
+// Engines are not thread-safe, busy is set while a method runs without the GIL.
+template< typename T >
+bool check_not_busy( T * self )
+{
+    if ( self->busy )
+    {
+        PyErr_SetString( PyExc_RuntimeError, "the engine is in use by another thread" );
+        return false;
+    }
+    return true;
+}
+
+// ********************************************************************************
+
+struct PowderPatternEngineObject
+{
+    PyObject_HEAD
+    PowderPatternEngine * engine;
+    bool busy;
+    // The number of exported buffers of intensities that have not been released; calculate() is refused while this is not 0.
+    Py_ssize_t nexports;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+};
+
+PyObject * PowderPatternEngine_new( PyTypeObject * type, PyObject *, PyObject * )
+{
+    PowderPatternEngineObject * self = reinterpret_cast< PowderPatternEngineObject * >( type->tp_alloc( type, 0 ) );
+    if ( self == 0 )
+        return 0;
+    if ( ! call( [&]() { self->engine = new PowderPatternEngine; } ) )
+    {
+        Py_DECREF( self );
+        return 0;
+    }
+    return reinterpret_cast< PyObject * >( self );
+}
+
+int PowderPatternEngine_init( PowderPatternEngineObject * self, PyObject * args, PyObject * kwargs )
+{
+    static const char * keywords[] = { "wavelength", "two_theta_start", "two_theta_end", "two_theta_step", "FWHM", "nthreads", 0 };
+    double wavelength( 1.54056 );
+    double two_theta_start( 3.0 );
+    double two_theta_end( 35.0 );
+    double two_theta_step( 0.01 );
+    double FWHM( 0.1 );
+    Py_ssize_t nthreads( 0 );
+    if ( ! PyArg_ParseTupleAndKeywords( args, kwargs, "|dddddn", const_cast< char ** >( keywords ),
+                                        &wavelength, &two_theta_start, &two_theta_end, &two_theta_step, &FWHM, &nthreads ) )
+        return -1;
+    if ( ! check_not_busy( self ) )
+        return -1;
+    if ( nthreads < 0 )
+    {
+        PyErr_SetString( PyExc_ValueError, "nthreads must not be negative" );
+        return -1;
+    }
+    const bool success = call( [&]()
+    {
+        self->engine->set_wavelength( wavelength );
+        self->engine->set_two_theta_range( two_theta_start, two_theta_end, two_theta_step );
+        self->engine->set_FWHM( FWHM );
+        self->engine->set_nthreads( nthreads );
+    } );
+    return success ? 0 : -1;
+}
+
+void PowderPatternEngine_dealloc( PowderPatternEngineObject * self )
+{
+    delete self->engine;
+    Py_TYPE( self )->tp_free( reinterpret_cast< PyObject * >( self ) );
+}
+
+PyObject * PowderPatternEngine_calculate( PowderPatternEngineObject * self, PyObject * file_names_object )
+{
+    if ( ! check_not_busy( self ) )
+        return 0;
+    if ( self->nexports != 0 )
+    {
+        PyErr_SetString( PyExc_BufferError, "the intensities are still exported, release them before calculating again" );
+        return 0;
+    }
+    std::vector< std::string > file_names;
+    if ( ! file_names_from_sequence( file_names_object, file_names ) )
+        return 0;
+    self->busy = true;
+    const bool success = call_without_GIL( [&]() { self->engine->calculate( file_names ); } );
+    self->busy = false;
+    if ( ! success )
+        return 0;
+    Py_RETURN_NONE;
+}
+
+PyObject * PowderPatternEngine_npatterns( PowderPatternEngineObject * self, PyObject * )
+{
+    if ( ! check_not_busy( self ) )
+        return 0;
+    return PyLong_FromSize_t( self->engine->npatterns() );
+}
+
+PyObject * PowderPatternEngine_npoints( PowderPatternEngineObject * self, PyObject * )
+{
+    if ( ! check_not_busy( self ) )
+        return 0;
+    return PyLong_FromSize_t( self->engine->npoints() );
+}
+
+PyObject * PowderPatternEngine_two_theta( PowderPatternEngineObject * self, PyObject * )
+{
+    if ( ! check_not_busy( self ) )
+        return 0;
+    const size_t npoints = self->engine->npoints();
+    ArrayObject * result = new_array( npoints );
+    if ( result == 0 )
+        return 0;
+    for ( size_t j( 0 ); j != npoints; ++j )
+        (*result->values)[j] = self->engine->two_theta( j );
+    return reinterpret_cast< PyObject * >( result );
+}
+
+PyObject * PowderPatternEngine_similarity_matrix( PowderPatternEngineObject * self, PyObject * args, PyObject * kwargs )
+{
+    static const char * keywords[] = { "l", "out", 0 };
+    double l( 1.0 );
+    PyObject * out( 0 );
+    if ( ! PyArg_ParseTupleAndKeywords( args, kwargs, "|dO", const_cast< char ** >( keywords ), &l, &out ) )
+        return 0;
+    if ( ! check_not_busy( self ) )
+        return 0;
+    const size_t n = self->engine->npatterns();
+    Output output;
+    if ( ! output.initialise( out, n, n ) )
+        return 0;
+    double * result = output.data();
+    self->busy = true;
+    const bool success = call_without_GIL( [&]() { self->engine->similarity_matrix( l, result ); } );
+    self->busy = false;
+    if ( ! success )
+        return 0;
+    return output.result();
+}
+
+int PowderPatternEngine_getbuffer( PowderPatternEngineObject * self, Py_buffer * view, int flags )
+{
+    if ( flags & PyBUF_WRITABLE )
+    {
+        PyErr_SetString( PyExc_BufferError, "the intensities are read-only" );
+        view->obj = 0;
+        return -1;
+    }
+    if ( ! check_not_busy( self ) )
+    {
+        view->obj = 0;
+        return -1;
+    }
+    const double * intensities = self->engine->intensity_matrix();
+    self->shape[0] = self->engine->npatterns();
+    self->shape[1] = self->engine->npoints();
+    self->strides[0] = self->shape[1] * sizeof( double );
+    self->strides[1] = sizeof( double );
+    view->obj = reinterpret_cast< PyObject * >( self );
+    Py_INCREF( self );
+    view->buf = ( intensities == 0 ) ? no_values : const_cast< double * >( intensities );
+    view->len = self->shape[0] * self->shape[1] * sizeof( double );
+    view->readonly = 1;
+    view->itemsize = sizeof( double );
+    view->format = ( flags & PyBUF_FORMAT ) ? const_cast< char * >( "d" ) : 0;
+    view->ndim = 2;
+    view->shape = ( flags & PyBUF_ND ) ? self->shape : 0;
+    view->strides = ( ( flags & PyBUF_STRIDES ) == PyBUF_STRIDES ) ? self->strides : 0;
+    view->suboffsets = 0;
+    view->internal = 0;
+    ++self->nexports;
+    return 0;
+}
+
+void PowderPatternEngine_releasebuffer( PowderPatternEngineObject * self, Py_buffer * )
+{
+    --self->nexports;
+}
+
+PyBufferProcs PowderPatternEngine_as_buffer =
+{
+    reinterpret_cast< getbufferproc >( PowderPatternEngine_getbuffer ),
+    reinterpret_cast< releasebufferproc >( PowderPatternEngine_releasebuffer )
+};
+
+PyMethodDef PowderPatternEngine_methods[] =
+{
+    { "calculate", reinterpret_cast< PyCFunction >( PowderPatternEngine_calculate ), METH_O,
+      "calculate(file_names)\n\nReads the .cif files and calculates their powder patterns, each normalised to its highest peak." },
+    { "npatterns", reinterpret_cast< PyCFunction >( PowderPatternEngine_npatterns ), METH_NOARGS, "npatterns()" },
+    { "npoints", reinterpret_cast< PyCFunction >( PowderPatternEngine_npoints ), METH_NOARGS, "npoints()" },
+    { "two_theta", reinterpret_cast< PyCFunction >( PowderPatternEngine_two_theta ), METH_NOARGS,
+      "two_theta()\n\nThe 2theta values of the points, in degrees." },
+    { "similarity_matrix", reinterpret_cast< PyCFunction >( reinterpret_cast< void (*)() >( PowderPatternEngine_similarity_matrix ) ), METH_VARARGS | METH_KEYWORDS,
+      "similarity_matrix(l=1.0, out=None)\n\nnormalised_weighted_cross_correlation() of all pairs of patterns, npatterns x npatterns, l in degrees." },
+    { 0, 0, 0, 0 }
+};
+
+PyTypeObject PowderPatternEngine_type = { PyVarObject_HEAD_INIT( 0, 0 ) };
+
+// ********************************************************************************
+
+struct CrystalStructureEngineObject
+{
+    PyObject_HEAD
+    CrystalStructureEngine * engine;
+    bool busy;
+};
+
+PyObject * CrystalStructureEngine_new( PyTypeObject * type, PyObject *, PyObject * )
+{
+    CrystalStructureEngineObject * self = reinterpret_cast< CrystalStructureEngineObject * >( type->tp_alloc( type, 0 ) );
+    if ( self == 0 )
+        return 0;
+    if ( ! call( [&]() { self->engine = new CrystalStructureEngine; } ) )
+    {
+        Py_DECREF( self );
+        return 0;
+    }
+    return reinterpret_cast< PyObject * >( self );
+}
+
+int CrystalStructureEngine_init( CrystalStructureEngineObject * self, PyObject * args, PyObject * kwargs )
+{
+    static const char * keywords[] = { "nthreads", 0 };
+    Py_ssize_t nthreads( 0 );
+    if ( ! PyArg_ParseTupleAndKeywords( args, kwargs, "|n", const_cast< char ** >( keywords ), &nthreads ) )
+        return -1;
+    if ( ! check_not_busy( self ) )
+        return -1;
+    if ( nthreads < 0 )
+    {
+        PyErr_SetString( PyExc_ValueError, "nthreads must not be negative" );
+        return -1;
+    }
+    self->engine->set_nthreads( nthreads );
+    return 0;
+}
+
+void CrystalStructureEngine_dealloc( CrystalStructureEngineObject * self )
+{
+    delete self->engine;
+    Py_TYPE( self )->tp_free( reinterpret_cast< PyObject * >( self ) );
+}
+
+PyObject * CrystalStructureEngine_read( CrystalStructureEngineObject * self, PyObject * file_names_object )
+{
+    if ( ! check_not_busy( self ) )
+        return 0;
+    std::vector< std::string > file_names;
+    if ( ! file_names_from_sequence( file_names_object, file_names ) )
+        return 0;
+    self->busy = true;
+    const bool success = call_without_GIL( [&]() { self->engine->read( file_names ); } );
+    self->busy = false;
+    if ( ! success )
+        return 0;
+    Py_RETURN_NONE;
+}
+
+Py_ssize_t CrystalStructureEngine_length( CrystalStructureEngineObject * self )
+{
+    if ( ! check_not_busy( self ) )
+        return -1;
+    return self->engine->size();
+}
+
+PyObject * CrystalStructureEngine_natoms( CrystalStructureEngineObject * self, PyObject * args )
+{
+    Py_ssize_t i;
+    if ( ! PyArg_ParseTuple( args, "n", &i ) || ! check_not_busy( self ) || ! check_index( i, self->engine->size() ) )
+        return 0;
+    return PyLong_FromSize_t( self->engine->natoms( i ) );
+}
+
+PyObject * CrystalStructureEngine_density( CrystalStructureEngineObject * self, PyObject * args )
+{
+    Py_ssize_t i;
+    if ( ! PyArg_ParseTuple( args, "n", &i ) || ! check_not_busy( self ) || ! check_index( i, self->engine->size() ) )
+        return 0;
+    return PyFloat_FromDouble( self->engine->density( i ) );
+}
+
+PyObject * CrystalStructureEngine_void_volumes( CrystalStructureEngineObject * self, PyObject * args, PyObject * kwargs )
+{
+    static const char * keywords[] = { "probe_radius", "grid_spacing", "out", 0 };
+    double probe_radius( 1.2 );
+    double grid_spacing( 0.15 );
+    PyObject * out( 0 );
+    if ( ! PyArg_ParseTupleAndKeywords( args, kwargs, "|ddO", const_cast< char ** >( keywords ), &probe_radius, &grid_spacing, &out ) )
+        return 0;
+    if ( ! check_not_busy( self ) )
+        return 0;
+    Output output;
+    if ( ! output.initialise( out, self->engine->size() ) )
+        return 0;
+    double * result = output.data();
+    self->busy = true;
+    const bool success = call_without_GIL( [&]() { self->engine->void_volumes( probe_radius, grid_spacing, result ); } );
+    self->busy = false;
+    if ( ! success )
+        return 0;
+    return output.result();
+}
+
+PyObject * CrystalStructureEngine_lattice_parameters( CrystalStructureEngineObject * self, PyObject * args, PyObject * kwargs )
+{
+    static const char * keywords[] = { "i", "out", 0 };
+    Py_ssize_t i;
+    PyObject * out( 0 );
+    if ( ! PyArg_ParseTupleAndKeywords( args, kwargs, "n|O", const_cast< char ** >( keywords ), &i, &out ) )
+        return 0;
+    if ( ! check_not_busy( self ) || ! check_index( i, self->engine->size() ) )
+        return 0;
+    Output output;
+    if ( ! output.initialise( out, 6 ) )
+        return 0;
+    if ( ! call( [&]() { self->engine->lattice_parameters( i, output.data() ); } ) )
+        return 0;
+    return output.result();
+}
+
+PyObject * CrystalStructureEngine_fractional_coordinates( CrystalStructureEngineObject * self, PyObject * args, PyObject * kwargs )
+{
+    static const char * keywords[] = { "i", "out", 0 };
+    Py_ssize_t i;
+    PyObject * out( 0 );
+    if ( ! PyArg_ParseTupleAndKeywords( args, kwargs, "n|O", const_cast< char ** >( keywords ), &i, &out ) )
+        return 0;
+    if ( ! check_not_busy( self ) || ! check_index( i, self->engine->size() ) )
+        return 0;
+    Output output;
+    if ( ! output.initialise( out, self->engine->natoms( i ), 3 ) )
+        return 0;
+    if ( ! call( [&]() { self->engine->fractional_coordinates( i, output.data() ); } ) )
+        return 0;
+    return output.result();
+}
+
+PyObject * CrystalStructureEngine_elements( CrystalStructureEngineObject * self, PyObject * args )
+{
+    Py_ssize_t i;
+    if ( ! PyArg_ParseTuple( args, "n", &i ) || ! check_not_busy( self ) || ! check_index( i, self->engine->size() ) )
+        return 0;
+    const size_t natoms = self->engine->natoms( i );
+    PyObject * result = PyList_New( natoms );
+    if ( result == 0 )
+        return 0;
+    for ( size_t j( 0 ); j != natoms; ++j )
+    {
+        std::string symbol;
+        PyObject * item = 0;
+        if ( call( [&]() { symbol = self->engine->element( i, j ); } ) )
+            item = PyUnicode_FromStringAndSize( symbol.c_str(), symbol.size() );
+        if ( item == 0 )
+        {
+            Py_DECREF( result );
+            return 0;
+        }
+        PyList_SET_ITEM( result, j, item );
+    }
+    return result;
+}
+
+PyObject * CrystalStructureEngine_RMSCD( CrystalStructureEngineObject * self, PyObject * args )
+{
+    Py_ssize_t i;
+    Py_ssize_t j;
+    if ( ! PyArg_ParseTuple( args, "nn", &i, &j ) || ! check_not_busy( self ) ||
+         ! check_index( i, self->engine->size() ) || ! check_index( j, self->engine->size() ) )
+        return 0;
+    double result( 0.0 );
+    self->busy = true;
+    const bool success = call_without_GIL( [&]() { result = self->engine->RMSCD( i, j ); } );
+    self->busy = false;
+    if ( ! success )
+        return 0;
+    return PyFloat_FromDouble( result );
+}
+
+PyObject * CrystalStructureEngine_RMSCD_matrix( CrystalStructureEngineObject * self, PyObject * args, PyObject * kwargs )
+{
+    static const char * keywords[] = { "out", 0 };
+    PyObject * out( 0 );
+    if ( ! PyArg_ParseTupleAndKeywords( args, kwargs, "|O", const_cast< char ** >( keywords ), &out ) )
+        return 0;
+    if ( ! check_not_busy( self ) )
+        return 0;
+    const size_t n = self->engine->size();
+    Output output;
+    if ( ! output.initialise( out, n, n ) )
+        return 0;
+    double * result = output.data();
+    self->busy = true;
+    const bool success = call_without_GIL( [&]() { self->engine->RMSCD_matrix( result ); } );
+    self->busy = false;
+    if ( ! success )
+        return 0;
+    return output.result();
+}
+
+PySequenceMethods CrystalStructureEngine_as_sequence = { reinterpret_cast< lenfunc >( CrystalStructureEngine_length ) };
+
+PyMethodDef CrystalStructureEngine_methods[] =
+{
+    { "read", reinterpret_cast< PyCFunction >( CrystalStructureEngine_read ), METH_O,
+      "read(file_names)\n\nReads the .cif files and applies the space-group symmetry. Replaces any structures read before." },
+    { "natoms", reinterpret_cast< PyCFunction >( CrystalStructureEngine_natoms ), METH_VARARGS,
+      "natoms(i)\n\nNumber of atoms in the unit cell." },
+    { "density", reinterpret_cast< PyCFunction >( CrystalStructureEngine_density ), METH_VARARGS,
+      "density(i)\n\nIn g/cm3." },
+    { "void_volumes", reinterpret_cast< PyCFunction >( reinterpret_cast< void (*)() >( CrystalStructureEngine_void_volumes ) ), METH_VARARGS | METH_KEYWORDS,
+      "void_volumes(probe_radius=1.2, grid_spacing=0.15, out=None)\n\nThe void volume of each structure, in A^3." },
+    { "lattice_parameters", reinterpret_cast< PyCFunction >( reinterpret_cast< void (*)() >( CrystalStructureEngine_lattice_parameters ) ), METH_VARARGS | METH_KEYWORDS,
+      "lattice_parameters(i, out=None)\n\na, b, c in A and alpha, beta, gamma in degrees." },
+    { "fractional_coordinates", reinterpret_cast< PyCFunction >( reinterpret_cast< void (*)() >( CrystalStructureEngine_fractional_coordinates ) ), METH_VARARGS | METH_KEYWORDS,
+      "fractional_coordinates(i, out=None)\n\nnatoms x 3 fractional coordinates of the atoms in the unit cell." },
+    { "elements", reinterpret_cast< PyCFunction >( CrystalStructureEngine_elements ), METH_VARARGS,
+      "elements(i)\n\nList of the element symbols of the atoms in the unit cell." },
+    { "RMSCD", reinterpret_cast< PyCFunction >( CrystalStructureEngine_RMSCD ), METH_VARARGS,
+      "RMSCD(i, j)\n\nRoot-mean-square Cartesian displacement of the non-H atoms of the unit cells, in A." },
+    { "RMSCD_matrix", reinterpret_cast< PyCFunction >( reinterpret_cast< void (*)() >( CrystalStructureEngine_RMSCD_matrix ) ), METH_VARARGS | METH_KEYWORDS,
+      "RMSCD_matrix(out=None)\n\nRMSCD() of all pairs of structures." },
+    { 0, 0, 0, 0 }
+};
+
+PyTypeObject CrystalStructureEngine_type = { PyVarObject_HEAD_INIT( 0, 0 ) };
+
+// ********************************************************************************
+
+PyObject * fourier_similarity_matrix( PyObject *, PyObject * args, PyObject * kwargs )
+{
+    static const char * keywords[] = { "intensities", "two_theta_step", "l", "out", "nthreads", 0 };
+    PyObject * intensities_object;
+    double two_theta_step;
+    double l( 1.0 );
+    PyObject * out( 0 );
+    Py_ssize_t nthreads( 0 );
+    if ( ! PyArg_ParseTupleAndKeywords( args, kwargs, "Od|dOn", const_cast< char ** >( keywords ),
+                                        &intensities_object, &two_theta_step, &l, &out, &nthreads ) )
+        return 0;
+    if ( nthreads < 0 )
+    {
+        PyErr_SetString( PyExc_ValueError, "nthreads must not be negative" );
+        return 0;
+    }
+    Py_buffer intensities;
+    if ( PyObject_GetBuffer( intensities_object, &intensities, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT ) != 0 )
+        return 0;
+    if ( ( intensities.ndim != 2 ) || ! is_double_format( intensities.format ) )
+    {
+        PyBuffer_Release( &intensities );
+        PyErr_SetString( PyExc_TypeError, "intensities must be a two-dimensional array of float64 values" );
+        return 0;
+    }
+    const size_t npatterns = intensities.shape[0];
+    const size_t npoints = intensities.shape[1];
+    Output output;
+    if ( ! output.initialise( out, npatterns, npatterns ) )
+    {
+        PyBuffer_Release( &intensities );
+        return 0;
+    }
+    const double * values = static_cast< const double * >( intensities.buf );
+    double * result = output.data();
+    const bool success = call_without_GIL( [&]() { similarity_matrix( values, npatterns, npoints, two_theta_step, l, result, nthreads ); } );
+    PyBuffer_Release( &intensities );
+    if ( ! success )
+        return 0;
+    return output.result();
+}
+
+PyMethodDef fourier_methods[] =
+{
+    { "similarity_matrix", reinterpret_cast< PyCFunction >( reinterpret_cast< void (*)() >( fourier_similarity_matrix ) ), METH_VARARGS | METH_KEYWORDS,
+      "similarity_matrix(intensities, two_theta_step, l=1.0, out=None, nthreads=0)\n\n"
+      "normalised_weighted_cross_correlation() of all pairs of rows of the npatterns x npoints intensities, in degrees." },
+    { 0, 0, 0, 0 }
+};
+
+PyModuleDef fourier_module = { PyModuleDef_HEAD_INIT, "fourier", "Powder patterns, similarities, voids and RMSCDs of crystal structures.", -1, fourier_methods };
+
+bool add_type( PyObject * module, PyTypeObject * type, const char * name )
+{
+    if ( PyType_Ready( type ) < 0 )
+        return false;
+    Py_INCREF( type );
+    if ( PyModule_AddObject( module, name, reinterpret_cast< PyObject * >( type ) ) < 0 )
+    {
+        Py_DECREF( type );
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+PyMODINIT_FUNC PyInit_fourier()
+{
+    Array_type.tp_name = "fourier.Array";
+    Array_type.tp_basicsize = sizeof( ArrayObject );
+    Array_type.tp_dealloc = reinterpret_cast< destructor >( Array_dealloc );
+    Array_type.tp_as_buffer = &Array_as_buffer;
+    Array_type.tp_flags = Py_TPFLAGS_DEFAULT;
+    Array_type.tp_doc = "Array of float64 values, use numpy.asarray() or memoryview() to access it without copying.";
+    Array_type.tp_getset = Array_getset;
+
+    PowderPatternEngine_type.tp_name = "fourier.PowderPatternEngine";
+    PowderPatternEngine_type.tp_basicsize = sizeof( PowderPatternEngineObject );
+    PowderPatternEngine_type.tp_dealloc = reinterpret_cast< destructor >( PowderPatternEngine_dealloc );
+    PowderPatternEngine_type.tp_as_buffer = &PowderPatternEngine_as_buffer;
+    PowderPatternEngine_type.tp_flags = Py_TPFLAGS_DEFAULT;
+    PowderPatternEngine_type.tp_doc = "PowderPatternEngine(wavelength=1.54056, two_theta_start=3.0, two_theta_end=35.0, two_theta_step=0.01, FWHM=0.1, nthreads=0)\n\n"
+                                      "Exports the npatterns x npoints intensities through the buffer protocol.";
+    PowderPatternEngine_type.tp_methods = PowderPatternEngine_methods;
+    PowderPatternEngine_type.tp_init = reinterpret_cast< initproc >( PowderPatternEngine_init );
+    PowderPatternEngine_type.tp_new = PowderPatternEngine_new;
+
+    CrystalStructureEngine_type.tp_name = "fourier.CrystalStructureEngine";
+    CrystalStructureEngine_type.tp_basicsize = sizeof( CrystalStructureEngineObject );
+    CrystalStructureEngine_type.tp_dealloc = reinterpret_cast< destructor >( CrystalStructureEngine_dealloc );
+    CrystalStructureEngine_type.tp_as_sequence = &CrystalStructureEngine_as_sequence;
+    CrystalStructureEngine_type.tp_flags = Py_TPFLAGS_DEFAULT;
+    CrystalStructureEngine_type.tp_doc = "CrystalStructureEngine(nthreads=0)";
+    CrystalStructureEngine_type.tp_methods = CrystalStructureEngine_methods;
+    CrystalStructureEngine_type.tp_init = reinterpret_cast< initproc >( CrystalStructureEngine_init );
+    CrystalStructureEngine_type.tp_new = CrystalStructureEngine_new;
+
+    PyObject * module = PyModule_Create( &fourier_module );
+    if ( module == 0 )
+        return 0;
+    if ( ! add_type( module, &Array_type, "Array" ) ||
+         ! add_type( module, &PowderPatternEngine_type, "PowderPatternEngine" ) ||
+         ! add_type( module, &CrystalStructureEngine_type, "CrystalStructureEngine" ) ||
+         ( PyModule_AddIntConstant( module, "library_version", Fourier_library_version ) < 0 ) )
+    {
+        Py_DECREF( module );
+        return 0;
+    }
+    return module;
+}
+
@@ -28,6 +28,52 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "GenerateCombinations.h"
 
 #include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+
+// Pascal's triangle up to n = 64, C(64,32) still fits in 64 bits.
+class BinomialCoefficients
+{
+public:
+    BinomialCoefficients()
+    {
+        for ( size_t n( 0 ); n != 65; ++n )
+        {
+            for ( size_t k( 0 ); k != 65; ++k )
+            {
+                if ( k > n )
+                    values_[n][k] = 0;
+                else if ( ( k == 0 ) || ( k == n ) )
+                    values_[n][k] = 1;
+                else
+                    values_[n][k] = values_[n-1][k-1] + values_[n-1][k];
+            }
+        }
+    }
+
+    uint64_t value( const size_t n, const size_t k ) const { return values_[n][k]; }
+
+private:
+    uint64_t values_[65][65];
+};
+
+const BinomialCoefficients & binomial_coefficients()
+{
+    static const BinomialCoefficients result;
+    return result;
+}
+
+void check_n_and_k( const size_t n, const size_t k )
+{
+    if ( n > 64 )
+        throw std::runtime_error( "CombinationBitmasks: n must be <= 64." );
+    if ( k > n )
+        throw std::runtime_error( "CombinationBitmasks: k must be <= n." );
+}
+
+} // namespace
 
 // ********************************************************************************
 
@@ -42,7 +88,7 @@ GenerateCombinations::GenerateCombinations( const std::vector< size_t > & values
 
 // ********************************************************************************
 
-bool GenerateCombinations::next_combination( std::vector< size_t > & result ) const
+bool GenerateCombinations::next_combination( std::vector< size_t > & result )
 {
     if ( ! another_one_is_available_ )
         return false;
@@ -58,3 +104,179 @@ bool GenerateCombinations::next_combination( std::vector< size_t > & result ) co
 
 // ********************************************************************************
 
+uint64_t binomial_coefficient( const size_t n, const size_t k )
+{
+    if ( n > 64 )
+        throw std::runtime_error( "binomial_coefficient(): n must be <= 64." );
+    if ( k > n )
+        return 0;
+    return binomial_coefficients().value( n, k );
+}
+
+// ********************************************************************************
+
+// The i-th smallest element c_i (i = 1 ... k) contributes C(c_i,i).
+uint64_t rank_combination_lexicographic( const uint64_t combination )
+{
+    uint64_t result( 0 );
+    size_t i( 1 );
+    for ( uint64_t bits( combination ); bits != 0; bits &= bits - 1 )
+    {
+        result += binomial_coefficients().value( __builtin_ctzll( bits ), i );
+        ++i;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+uint64_t unrank_combination_lexicographic( uint64_t rank, const size_t n, const size_t k )
+{
+    check_n_and_k( n, k );
+    if ( rank >= binomial_coefficient( n, k ) )
+        throw std::runtime_error( "unrank_combination_lexicographic(): rank out of range." );
+    uint64_t result( 0 );
+    size_t c( n );
+    for ( size_t i( k ); i != 0; --i )
+    {
+        // The largest c with C(c,i) <= rank
+        do
+        {
+            --c;
+        }
+        while ( binomial_coefficients().value( c, i ) > rank );
+        result |= ( uint64_t( 1 ) << c );
+        rank -= binomial_coefficients().value( c, i );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+// The revolving-door order R(n,k) is R(n-1,k) followed by R(n-1,k-1) in reverse order with element n-1 added.
+uint64_t rank_combination_revolving_door( const uint64_t combination, const size_t n, const size_t k )
+{
+    check_n_and_k( n, k );
+    uint64_t result( 0 );
+    bool reversed( false );
+    size_t kk( k );
+    for ( size_t nn( n ); ( kk != 0 ) && ( kk != nn ); --nn )
+    {
+        if ( combination & ( uint64_t( 1 ) << ( nn - 1 ) ) )
+        {
+            // In the second half, which is reversed
+            const uint64_t first_half = binomial_coefficients().value( nn - 1, kk );
+            const uint64_t second_half = binomial_coefficients().value( nn - 1, kk - 1 );
+            if ( reversed )
+                result -= first_half + second_half - 1;
+            else
+                result += first_half + second_half - 1;
+            reversed = ! reversed;
+            --kk;
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+uint64_t unrank_combination_revolving_door( uint64_t rank, const size_t n, const size_t k )
+{
+    check_n_and_k( n, k );
+    if ( rank >= binomial_coefficient( n, k ) )
+        throw std::runtime_error( "unrank_combination_revolving_door(): rank out of range." );
+    uint64_t result( 0 );
+    size_t kk( k );
+    for ( size_t nn( n ); ( kk != 0 ) && ( kk != nn ); --nn )
+    {
+        const uint64_t first_half = binomial_coefficients().value( nn - 1, kk );
+        if ( rank >= first_half )
+        {
+            result |= ( uint64_t( 1 ) << ( nn - 1 ) );
+            rank = binomial_coefficients().value( nn - 1, kk - 1 ) - 1 - ( rank - first_half );
+            --kk;
+        }
+    }
+    // Either no elements or all remaining elements
+    if ( kk != 0 )
+        result |= ( uint64_t( 1 ) << kk ) - 1;
+    return result;
+}
+
+// ********************************************************************************
+
+CombinationBitmasks::CombinationBitmasks( const size_t n, const size_t k, const Order order ):
+n_(n),
+k_(k),
+order_(order),
+begin_rank_(0),
+end_rank_(0),
+next_rank_(0),
+current_(0)
+{
+    check_n_and_k( n, k );
+    end_rank_ = binomial_coefficient( n, k );
+}
+
+// ********************************************************************************
+
+CombinationBitmasks::CombinationBitmasks( const size_t n, const size_t k, const uint64_t begin_rank, const uint64_t end_rank, const Order order ):
+n_(n),
+k_(k),
+order_(order),
+begin_rank_(begin_rank),
+end_rank_(end_rank),
+next_rank_(begin_rank),
+current_(0)
+{
+    check_n_and_k( n, k );
+    if ( ( begin_rank > end_rank ) || ( end_rank > binomial_coefficient( n, k ) ) )
+        throw std::runtime_error( "CombinationBitmasks::CombinationBitmasks(): invalid range of ranks." );
+}
+
+// ********************************************************************************
+
+bool CombinationBitmasks::next_combination( uint64_t & combination )
+{
+    uint64_t removed;
+    uint64_t added;
+    return next_combination( combination, removed, added );
+}
+
+// ********************************************************************************
+
+bool CombinationBitmasks::next_combination( uint64_t & combination, uint64_t & removed, uint64_t & added )
+{
+    if ( next_rank_ == end_rank_ )
+        return false;
+    uint64_t next;
+    if ( next_rank_ == begin_rank_ )
+        next = unrank( next_rank_ );
+    else if ( order_ == LEXICOGRAPHIC )
+        next = next_combination_bitmask( current_ );
+    else
+        next = unrank_combination_revolving_door( next_rank_, n_, k_ );
+    removed = current_ & ~next;
+    added = next & ~current_;
+    current_ = next;
+    combination = next;
+    ++next_rank_;
+    return true;
+}
+
+// ********************************************************************************
+
+uint64_t CombinationBitmasks::rank( const uint64_t combination ) const
+{
+    return ( order_ == LEXICOGRAPHIC ) ? rank_combination_lexicographic( combination ) : rank_combination_revolving_door( combination, n_, k_ );
+}
+
+// ********************************************************************************
+
+uint64_t CombinationBitmasks::unrank( const uint64_t rank ) const
+{
+    return ( order_ == LEXICOGRAPHIC ) ? unrank_combination_lexicographic( rank, n_, k_ ) : unrank_combination_revolving_door( rank, n_, k_ );
+}
+
+// ********************************************************************************
+
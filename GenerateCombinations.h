@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <vector>
 #include <cstddef> // For definition of size_t
+#include <cstdint>
 
 /*
     Given N numbers, generates k-in-N combinations.
@@ -45,14 +46,79 @@ public:
     
     // Returns true if another combination is available.
     // result returns the actual values, not indices into the vector of values.
-    bool next_combination( std::vector< size_t > & result ) const;
+    // Not const: the generator advances, so each thread needs its own GenerateCombinations.
+    bool next_combination( std::vector< size_t > & result );
     
 private:
     std::vector< size_t > values_;
     size_t k_;
-    mutable std::vector< size_t > bitmask_;
-    mutable bool another_one_is_available_;
+    std::vector< size_t > bitmask_;
+    bool another_one_is_available_;
 };
 
+/*
+    Combinations of k elements out of n <= 64 as bitmasks, bit i is set if element i is part of the combination.
+
+    Two orders are available:
+    LEXICOGRAPHIC : increasing numerical value of the bitmask (colexicographic order), stepped with Gosper's hack.
+    REVOLVING_DOOR: each combination differs from the previous one by exactly one element leaving and one entering,
+                    so that a sum or product over the elements can be updated incrementally.
+
+    Combinations are numbered (ranked) 0 ... C(n,k)-1 in either order, so that the range can be split over threads
+    by giving each thread its own [begin_rank, end_rank).
+*/
+class CombinationBitmasks
+{
+public:
+
+    enum Order { LEXICOGRAPHIC, REVOLVING_DOOR };
+
+    // All C(n,k) combinations.
+    CombinationBitmasks( const size_t n, const size_t k, const Order order = LEXICOGRAPHIC );
+
+    // The combinations with rank in [begin_rank, end_rank).
+    CombinationBitmasks( const size_t n, const size_t k, const uint64_t begin_rank, const uint64_t end_rank, const Order order = LEXICOGRAPHIC );
+
+    // Returns true if another combination is available.
+    bool next_combination( uint64_t & combination );
+
+    // In addition returns which elements were removed from and added to the previous combination.
+    // For the first combination, removed is 0 and added is the combination itself.
+    bool next_combination( uint64_t & combination, uint64_t & removed, uint64_t & added );
+
+    // Number of combinations still to come plus the ones already returned, i.e. end_rank - begin_rank.
+    uint64_t size() const { return end_rank_ - begin_rank_; }
+
+    uint64_t rank( const uint64_t combination ) const;
+    uint64_t unrank( const uint64_t rank ) const;
+
+private:
+    size_t n_;
+    size_t k_;
+    Order order_;
+    uint64_t begin_rank_;
+    uint64_t end_rank_;
+    uint64_t next_rank_;
+    uint64_t current_;
+};
+
+// Binomial coefficient C(n,k) for n <= 64, exact.
+uint64_t binomial_coefficient( const size_t n, const size_t k );
+
+// The next larger integer with the same number of bits set (Gosper's hack). combination must not be 0.
+inline uint64_t next_combination_bitmask( const uint64_t combination )
+{
+    const uint64_t t = combination | ( combination - 1 );
+    return ( t + 1 ) | ( ( ( ~t & ( t + 1 ) ) - 1 ) >> ( __builtin_ctzll( combination ) + 1 ) );
+}
+
+// Rank and unrank in colexicographic order (= the order of next_combination_bitmask()).
+uint64_t rank_combination_lexicographic( const uint64_t combination );
+uint64_t unrank_combination_lexicographic( uint64_t rank, const size_t n, const size_t k );
+
+// Rank and unrank in revolving-door order.
+uint64_t rank_combination_revolving_door( const uint64_t combination, const size_t n, const size_t k );
+uint64_t unrank_combination_revolving_door( uint64_t rank, const size_t n, const size_t k );
+
 #endif // GENERATECOMBINATIONS_H
 
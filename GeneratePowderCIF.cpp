@@ -220,24 +220,21 @@ void GeneratePowderCIF::generate()
 //_symmetry_equiv_pos_as_xyz
 //	 'x, y, z '
 //	 '-x, -y, -z '
-    iLine = file_cif_.find( "_cell_length_a" );
-    words = split( file_cif_.line( iLine ) );
-    DoubleWithESD a( words[1] );
-    iLine = file_cif_.find( "_cell_length_b" );
-    words = split( file_cif_.line( iLine ) );
-    DoubleWithESD b( words[1] );
-    iLine = file_cif_.find( "_cell_length_c" );
-    words = split( file_cif_.line( iLine ) );
-    DoubleWithESD c( words[1] );
-    iLine = file_cif_.find( "_cell_angle_alpha" );
-    words = split( file_cif_.line( iLine ) );
-    DoubleWithESD alpha( words[1] );
-    iLine = file_cif_.find( "_cell_angle_beta" );
-    words = split( file_cif_.line( iLine ) );
-    DoubleWithESD beta( words[1] );
-    iLine = file_cif_.find( "_cell_angle_gamma" );
-    words = split( file_cif_.line( iLine ) );
-    DoubleWithESD gamma( words[1] );
+    // Read once, written out verbatim further down
+    const char * cell_keywords[] = { "_cell_length_a", "_cell_length_b", "_cell_length_c", "_cell_angle_alpha", "_cell_angle_beta", "_cell_angle_gamma" };
+    std::string cell_values[6];
+    for ( size_t i( 0 ); i != 6; ++i )
+    {
+        iLine = file_cif_.find( cell_keywords[i] );
+        words = split( file_cif_.line( iLine ) );
+        cell_values[i] = words[1];
+    }
+    DoubleWithESD a( cell_values[0] );
+    DoubleWithESD b( cell_values[1] );
+    DoubleWithESD c( cell_values[2] );
+    DoubleWithESD alpha( cell_values[3] );
+    DoubleWithESD beta( cell_values[4] );
+    DoubleWithESD gamma( cell_values[5] );
     crystal_lattice_ = CrystalLattice( a.value(),
                                        b.value(),
                                        c.value(),
@@ -267,24 +264,8 @@ void GeneratePowderCIF::generate()
     crystal_structure_.set_space_group( space_group_ );
     PowderPatternCalculator powder_pattern_calculator( crystal_structure_ );
     powder_pattern_calculator.set_wavelength( wavelength_.wavelength_1() );
-    iLine = file_cif_.find( "_cell_length_a" );
-    words = split( file_cif_.line( iLine ) );
-    insert_keyword_and_value( "_cell_length_a", words[1] );
-    iLine = file_cif_.find( "_cell_length_b" );
-    words = split( file_cif_.line( iLine ) );
-    insert_keyword_and_value( "_cell_length_b", words[1] );
-    iLine = file_cif_.find( "_cell_length_c" );
-    words = split( file_cif_.line( iLine ) );
-    insert_keyword_and_value( "_cell_length_c", words[1] );
-    iLine = file_cif_.find( "_cell_angle_alpha" );
-    words = split( file_cif_.line( iLine ) );
-    insert_keyword_and_value( "_cell_angle_alpha", words[1] );
-    iLine = file_cif_.find( "_cell_angle_beta" );
-    words = split( file_cif_.line( iLine ) );
-    insert_keyword_and_value( "_cell_angle_beta", words[1] );
-    iLine = file_cif_.find( "_cell_angle_gamma" );
-    words = split( file_cif_.line( iLine ) );
-    insert_keyword_and_value( "_cell_angle_gamma", words[1] );
+    for ( size_t i( 0 ); i != 6; ++i )
+        insert_keyword_and_value( cell_keywords[i], cell_values[i] );
     iLine = file_cif_.find( "_cell_volume" );
     words = split( file_cif_.line( iLine ) );
     insert_keyword_and_value( "_cell_volume", words[1] );
@@ -500,7 +481,10 @@ void GeneratePowderCIF::generate()
     output_file_.write_line( "    _atom_site_symmetry_multiplicity" );
     double conversion_factor = 1.0 / ( 8.0 * CONSTANT_PI * CONSTANT_PI );
     if ( replace_hydrogen_atoms_ )
+    {
         file_Hmi_.read_file( FileName( directory_, base_name_ + "_Hmi", "cif" ) );
+        index_Hmi_atoms();
+    }
     iLine = file_cif_.find( "_atom_site_U_iso_or_equiv" );
     for ( size_t i( iLine + 1 ); i != file_cif_.size(); ++i )
     {
@@ -511,11 +495,11 @@ void GeneratePowderCIF::generate()
         DoubleWithESD dwe_2( conversion_factor * dwe_1.value(), conversion_factor * dwe_1.estimated_standard_deviation() );
         if ( replace_hydrogen_atoms_ && element_from_atom_label( words[0] ).is_H_or_D() )
         {
-            size_t iLine_Hmi = file_Hmi_.find_whole_word( words[0] );
+            const std::vector< std::string > * Hmi_atom = find_Hmi_atom( words[0] );
             // In Mercury, GRACE and Materials Studio, the x,y,z coordinates are columns 2,3,4 (zero-based)
-            if ( iLine_Hmi == std::string::npos )
+            if ( Hmi_atom == 0 )
                 throw std::runtime_error( "GeneratePowderCIF::generate(): H atom not found: >" + words[0] + "<" );
-            std::vector< std::string > words_2 = split( file_Hmi_.line( iLine_Hmi ) );
+            const std::vector< std::string > & words_2 = *Hmi_atom;
             output_file_.write_line( "    " + pad( words[1], 2 ) +
                                         " " + pad( relabel( words[0] ), longest_label_size_ ) +
                                         " " + pad_plus( words_2[2], longest_x_ ) +
@@ -792,7 +776,6 @@ void GeneratePowderCIF::write_bond_part()
         if ( words[i] == "Length" )
             length_index = i;
     }
-    size_t iLine = file_Hmi_.find( "_atom_site_label" );
     for ( size_t i( 1 ); i != file_bond_lengths_.size(); ++i )
     {
         words = split( file_bond_lengths_.line( i ) );
@@ -801,34 +784,18 @@ void GeneratePowderCIF::write_bond_part()
         {
             // In Mercury, GRACE and Materials Studio, the x,y,z coordinates are columns 2,3,4 (zero-based)
             // Calculate the bond length
-            Vector3D lhs;
-            Vector3D rhs;
-            bool atom_1_found( false );
-            bool atom_2_found( false );
-            for ( size_t j( iLine + 1 ); j != file_Hmi_.size(); ++j )
-            {
-                std::vector< std::string > words_2 = split( file_Hmi_.line( j ) );
-                if ( words_2.size() == 0 )
-                    continue;
-                if ( ( ! atom_1_found ) && ( words_2[0] == words[atom1_index] ) )
-                {
-                    lhs = Vector3D( string2double( words_2[2] ), string2double( words_2[3] ), string2double( words_2[4] ) );
-                    atom_1_found = true;
-                }
-                else if ( ( ! atom_2_found ) && ( words_2[0] == words[atom2_index] ) )
-                {
-                    rhs = Vector3D( string2double( words_2[2] ), string2double( words_2[3] ), string2double( words_2[4] ) );
-                    atom_2_found = true;
-                }
-                if ( atom_1_found && atom_2_found )
-                    break;
-            }
+            const std::vector< std::string > * Hmi_atom_1 = find_Hmi_atom( words[atom1_index] );
+            const std::vector< std::string > * Hmi_atom_2 = find_Hmi_atom( words[atom2_index] );
+            const bool atom_1_found = ( Hmi_atom_1 != 0 );
+            const bool atom_2_found = ( Hmi_atom_2 != 0 );
             if ( ! ( atom_1_found && atom_2_found ) )
                 std::cout << "Atom label mismatch. Hint: Mercury may change atom labels when adding hydrogen atoms."<< std::endl;
             if ( ! atom_1_found )
                 throw std::runtime_error( "GeneratePowderCIF::write_bond_part(): atom label not found >" + words[atom1_index] + "<" );
             if ( ! atom_2_found )
                 throw std::runtime_error( "GeneratePowderCIF::write_bond_part(): atom label not found >" + words[atom2_index] + "<" );
+            Vector3D lhs = Hmi_position( *Hmi_atom_1 );
+            Vector3D rhs = Hmi_position( *Hmi_atom_2 );
             double bond_length;
             Vector3D dummy;
             crystal_structure_.shortest_distance( lhs, rhs, bond_length, dummy );
@@ -870,7 +837,6 @@ void GeneratePowderCIF::write_angle_part()
         if ( words[i] == "Angle" )
             angle_index = i;
     }
-    size_t iLine = file_Hmi_.find( "_atom_site_label" );
     for ( size_t i( 1 ); i != file_valence_angles_.size(); ++i )
     {
         words = split( file_valence_angles_.line( i ) );
@@ -879,35 +845,12 @@ void GeneratePowderCIF::write_angle_part()
         {
             // In Mercury, GRACE and Materials Studio, the x,y,z coordinates are columns 2,3,4 (zero-based)
             // Calculate the valence angle
-            Vector3D atom_1;
-            Vector3D atom_2;
-            Vector3D atom_3;
-            bool atom_1_found( false );
-            bool atom_2_found( false );
-            bool atom_3_found( false );
-            for ( size_t j( iLine + 1 ); j != file_Hmi_.size(); ++j )
-            {
-                std::vector< std::string > words_2 = split( file_Hmi_.line( j ) );
-                if ( words_2.size() == 0 )
-                    continue;
-                if ( ( ! atom_1_found ) && ( words_2[0] == words[atom1_index] ) )
-                {
-                    atom_1 = Vector3D( string2double( words_2[2] ), string2double( words_2[3] ), string2double( words_2[4] ) );
-                    atom_1_found = true;
-                }
-                else if ( ( ! atom_2_found ) && ( words_2[0] == words[atom2_index] ) )
-                {
-                    atom_2 = Vector3D( string2double( words_2[2] ), string2double( words_2[3] ), string2double( words_2[4] ) );
-                    atom_2_found = true;
-                }
-                else if ( ( ! atom_3_found ) && ( words_2[0] == words[atom3_index] ) )
-                {
-                    atom_3 = Vector3D( string2double( words_2[2] ), string2double( words_2[3] ), string2double( words_2[4] ) );
-                    atom_3_found = true;
-                }
-                if ( atom_1_found && atom_2_found && atom_3_found )
-                    break;
-            }
+            const std::vector< std::string > * Hmi_atom_1 = find_Hmi_atom( words[atom1_index] );
+            const std::vector< std::string > * Hmi_atom_2 = find_Hmi_atom( words[atom2_index] );
+            const std::vector< std::string > * Hmi_atom_3 = find_Hmi_atom( words[atom3_index] );
+            const bool atom_1_found = ( Hmi_atom_1 != 0 );
+            const bool atom_2_found = ( Hmi_atom_2 != 0 );
+            const bool atom_3_found = ( Hmi_atom_3 != 0 );
             if ( ! ( atom_1_found && atom_2_found && atom_3_found ) )
                 std::cout << "Atom label mismatch. Hint: Mercury may change atom labels when adding hydrogen atoms."<< std::endl;
             if ( ! atom_1_found )
@@ -916,6 +859,9 @@ void GeneratePowderCIF::write_angle_part()
                 throw std::runtime_error( "GeneratePowderCIF::write_bond_part(): atom label not found >" + words[atom2_index] + "<" );
             if ( ! atom_3_found )
                 throw std::runtime_error( "GeneratePowderCIF::write_bond_part(): atom label not found >" + words[atom3_index] + "<" );
+            Vector3D atom_1 = Hmi_position( *Hmi_atom_1 );
+            Vector3D atom_2 = Hmi_position( *Hmi_atom_2 );
+            Vector3D atom_3 = Hmi_position( *Hmi_atom_3 );
             double dummy;
             Vector3D difference_vector_1;
             crystal_structure_.shortest_distance( atom_2, atom_1, dummy, difference_vector_1 );
@@ -950,3 +896,39 @@ std::string GeneratePowderCIF::relabel( const std::string & old_label ) const
 
 // ********************************************************************************
 
+void GeneratePowderCIF::index_Hmi_atoms()
+{
+    Hmi_atoms_.clear();
+    size_t iLine = file_Hmi_.find( "_atom_site_label" );
+    if ( iLine == std::string::npos )
+        return;
+    // Only the first occurrence of a label counts
+    for ( size_t i( iLine + 1 ); i != file_Hmi_.size(); ++i )
+    {
+        std::vector< std::string > words = split( file_Hmi_.line( i ) );
+        if ( words.size() < 5 )
+            continue;
+        if ( Hmi_atoms_.find( words[0] ) == Hmi_atoms_.end() )
+            Hmi_atoms_[ words[0] ] = words;
+    }
+}
+
+// ********************************************************************************
+
+const std::vector< std::string > * GeneratePowderCIF::find_Hmi_atom( const std::string & label ) const
+{
+    std::map< std::string, std::vector< std::string > >::const_iterator it = Hmi_atoms_.find( label );
+    if ( it == Hmi_atoms_.end() )
+        return 0;
+    return &(it->second);
+}
+
+// ********************************************************************************
+
+Vector3D GeneratePowderCIF::Hmi_position( const std::vector< std::string > & words ) const
+{
+    return Vector3D( string2double( words[2] ), string2double( words[3] ), string2double( words[4] ) );
+}
+
+// ********************************************************************************
+
@@ -38,6 +38,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TextFileWriter.h"
 #include "Wavelength.h"
 
+#include <map>
 #include <string>
 
 // TODO: relabel
@@ -77,6 +78,7 @@ private:
     bool replace_hydrogen_atoms_;
     bool relabel_;
     std::map< std::string, std::string > labels_;
+    std::map< std::string, std::vector< std::string > > Hmi_atoms_; // Label -> words of the atom line in the _Hmi.cif file
     size_t padding_length_;
     size_t longest_label_size_;
     size_t longest_x_;
@@ -96,6 +98,12 @@ void insert_keyword_and_value( const std::string & keyword, const std::string &
 void write_bond_part();
 void write_angle_part();
 std::string relabel( const std::string & old_label ) const;
+// Reads file_Hmi_ into Hmi_atoms_, once.
+void index_Hmi_atoms();
+// Returns 0 if the label is not in the _Hmi.cif file.
+const std::vector< std::string > * find_Hmi_atom( const std::string & label ) const;
+// In Mercury, GRACE and Materials Studio, the x,y,z coordinates are columns 2,3,4 (zero-based)
+Vector3D Hmi_position( const std::vector< std::string > & words ) const;
 
 };
 
@@ -26,6 +26,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "Histogram.h"
+#include "ParallelFor.h"
 
 #include <stdexcept>
 
@@ -33,22 +34,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // ********************************************************************************
 
-namespace
-{
-
-size_t round_to_size_t( const double x )
-{
-    return ( x < 0.0 ) ? ( static_cast<size_t>( x - 0.5 ) ) : ( static_cast<size_t>( x + 0.5 ) );
-}
-
-} // namespace
-
-// ********************************************************************************
-
 Histogram::Histogram( const double start, const double finish, const size_t number_of_bins ) :
 start_(start),
 finish_(finish),
 number_of_bins_(number_of_bins),
+bins_per_unit_(0.0),
 lower_than_start_(0),
 greater_than_finish_(0)
 {
@@ -56,34 +46,61 @@ greater_than_finish_(0)
         throw std::runtime_error( "Histogram::Histogram(): number_of_bins cannot be 0." );
     if ( start >= finish )
         throw std::runtime_error( "Histogram::Histogram(): start must be lower than finish." );
-    data_ = std::vector< size_t >( number_of_bins_, 0.0 );
+    bins_per_unit_ = number_of_bins_ / ( finish_ - start_ );
+    data_ = std::vector< size_t >( number_of_bins_, 0 );
+}
+
+// ********************************************************************************
+
+void Histogram::add_data( const std::vector<double> & data )
+{
+    if ( ! data.empty() )
+        add_data( &data[0], data.size() );
 }
 
 // ********************************************************************************
 
-void Histogram::add_data( const std::vector<double> data )
+void Histogram::add_data( const double * data, const size_t n )
 {
-    for ( size_t i( 0 ); i != data.size(); ++i )
+    for ( size_t i( 0 ); i != n; ++i )
         add_data( data[i] );
 }
 
 // ********************************************************************************
 
-void Histogram::add_data( const double data )
+void Histogram::add_data_in_parallel( const double * data, const size_t n, size_t nthreads )
 {
-    if ( data == start_ )
-        ++data_[0];
-    else if ( data < start_ )
-        ++lower_than_start_;
-    else if ( data > finish_ )
-        ++greater_than_finish_;
-    else if ( data == finish_ )
-        ++data_[number_of_bins_-1];
-    else
+    if ( nthreads == 0 )
+        nthreads = default_nthreads();
+    // Not worth starting threads for small batches
+    const size_t minimum_chunk_size( 10000 );
+    nthreads = std::min( nthreads, ( n + minimum_chunk_size - 1 ) / minimum_chunk_size );
+    if ( nthreads < 2 )
     {
-        size_t index = round_to_size_t( ( number_of_bins_ * ( ( data - start_ ) / ( finish_ - start_ ) ) ) - 0.5 );
-        ++data_[index];
+        add_data( data, n );
+        return;
     }
+    std::vector< Histogram > partial_histograms( nthreads, Histogram( start_, finish_, number_of_bins_ ) );
+    parallel_for( nthreads, nthreads, [&]( const size_t t )
+    {
+        const size_t begin = ( n * t ) / nthreads;
+        const size_t end = ( n * ( t + 1 ) ) / nthreads;
+        partial_histograms[t].add_data( data + begin, end - begin );
+    } );
+    for ( size_t t( 0 ); t != nthreads; ++t )
+        merge( partial_histograms[t] );
+}
+
+// ********************************************************************************
+
+void Histogram::merge( const Histogram & rhs )
+{
+    if ( ( start_ != rhs.start_ ) || ( finish_ != rhs.finish_ ) || ( number_of_bins_ != rhs.number_of_bins_ ) )
+        throw std::runtime_error( "Histogram::merge(): histograms have different bins." );
+    for ( size_t i( 0 ); i != number_of_bins_; ++i )
+        data_[i] += rhs.data_[i];
+    lower_than_start_ += rhs.lower_than_start_;
+    greater_than_finish_ += rhs.greater_than_finish_;
 }
 
 // ********************************************************************************
@@ -97,3 +114,13 @@ size_t Histogram::bin( const size_t i ) const
 
 // ********************************************************************************
 
+size_t Histogram::number_of_data_points() const
+{
+    size_t result = lower_than_start_ + greater_than_finish_;
+    for ( size_t i( 0 ); i != number_of_bins_; ++i )
+        result += data_[i];
+    return result;
+}
+
+// ********************************************************************************
+
@@ -62,18 +62,29 @@ public:
 
     Histogram( const double start, const double finish, const size_t number_of_bins );
 
-    void add_data( const std::vector<double> data );
-    
+    void add_data( const std::vector<double> & data );
+
+    // Batch version, the values are not copied.
+    void add_data( const double * data, const size_t n );
+
     void add_data( const double data );
 
+    // The values are split over nthreads threads (0 means one per core), each of which fills its own partial histogram.
+    // The partial histograms are merged at the end.
+    void add_data_in_parallel( const double * data, const size_t n, const size_t nthreads = 0 );
+
+    // Adds the counts of a histogram with the same start, finish and number of bins,
+    // e.g. one that was filled on another thread.
+    void merge( const Histogram & rhs );
+
     // The index is zero-based
     size_t bin( const size_t i ) const;
     
     size_t size() const { return number_of_bins_; }
     size_t number_of_bins() const { return number_of_bins_; }
 
-// Sum of all bins + lower_than_start + greater_than_finish
-//    size_t number_of_data_points() const;
+    // Sum of all bins + lower_than_start + greater_than_finish
+    size_t number_of_data_points() const;
 
     size_t lower_than_start() const { return lower_than_start_; }
     size_t greater_than_finish() const { return greater_than_finish_; }
@@ -82,10 +93,28 @@ private:
     double start_;
     double finish_;
     size_t number_of_bins_;
+    double bins_per_unit_; // number_of_bins_ / ( finish_ - start_ ), so that binning is a multiplication
     std::vector<size_t> data_;
     size_t lower_than_start_;
     size_t greater_than_finish_;
 };
 
+// Hot path, kept inline for the batch versions.
+inline void Histogram::add_data( const double data )
+{
+    if ( data < start_ )
+        ++lower_than_start_;
+    else if ( data > finish_ )
+        ++greater_than_finish_;
+    else
+    {
+        // The product can round up to number_of_bins_ for values at or just below finish
+        size_t index = static_cast<size_t>( ( data - start_ ) * bins_per_unit_ );
+        if ( index >= number_of_bins_ )
+            index = number_of_bins_ - 1;
+        ++data_[index];
+    }
+}
+
 #endif // HISTOGRAM_H
 
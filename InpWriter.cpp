@@ -26,10 +26,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "InpWriter.h"
-#include "CopyTextFile.h"
 #include "CrystalStructure.h"
+#include "FileList.h"
 #include "FileName.h"
-#include "PowderPattern.h"
+#include "ParallelFor.h"
 #include "ReadCif.h"
 #include "TextFileReader_2.h"
 #include "TextFileWriter.h"
@@ -40,295 +40,347 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdexcept>
 #include <vector>
 
+namespace
+{
+
+// Everything before the "xdd" line, the same for every structure and every data set.
+const char * const inp_header =
+    "penalties_weighting_K1 5\n"
+    "'do_errors_include_penalties\n"
+    "prm JvdS_shift = Get(refine_ls_shift_on_su_max); : 0.0\n"
+    "prm JvdS_numpar = Get(number_independent_parameters); :  0.0\n"
+    "r_exp  0.0\n"
+    "r_exp_dash  0.0\n"
+    "r_wp  0.0\n"
+    "r_wp_dash  0.0\n"
+    "r_p  0.0\n"
+    "r_p_dash  0.0\n"
+    "gof  0.0\n"
+    "'continue_after_convergence\n";
+
+const char * const inp_flatten =
+    "    prm !flatten_width 0\n"
+    "    prm !flatten_weight    100000\n"
+    "    'Flatten( C19 N11 N35 C47 H54 C50 H58 C45 H49 C34 C46, , 0.0, flatten_width, flatten_weight )\n";
+
+const char * const inp_profile_format =
+    " load out_record out_fmt out_eqn\n"
+    "    {\n"
+    "        \" %11.5f \" = X;\n"
+    "        \" %11.5f \" = Yobs;\n"
+    "        \" %11.5f \" = Ycalc;\n"
+    "        \" %11.5f\\n\" = SigmaYobs;\n"
+    "    }\n";
+
+const char * const inp_tickmarks_format =
+    " load out_record out_fmt out_eqn\n"
+    "    {\n"
+    "        \" %11.5f -200\\n\" = 2.0 * Rad * Th;\n"
+    "    }\n";
+
 // ********************************************************************************
 
-void inp_writer( const FileName & input_cif_file_name, const FileName & input_xye_file_name, const std::string & aal  )
+void append_line( std::string & output, const std::string & line )
 {
-    CrystalStructure crystal_structure;
-    std::cout << "Now reading cif... " + input_cif_file_name.full_name() << std::endl;
-    read_cif( input_cif_file_name, crystal_structure );
-    // The powder diffraction file must contain a third column with estimated standard deviations or TOPAS cannot read the file.
-    // So create that file now.
-    if ( FileName( input_cif_file_name.directory(), input_cif_file_name.file_name(), "xye" ).exists() )
-        throw std::runtime_error( "inp_writer(): can't create " + FileName( input_cif_file_name.directory(), input_cif_file_name.file_name(), "xye" ).full_name() + " because it already exists." );
-    PowderPattern powder_pattern( input_xye_file_name );
-    powder_pattern.recalculate_estimated_standard_deviations();
-    powder_pattern.save_xye( FileName( input_cif_file_name.directory(), input_cif_file_name.file_name(), "xye" ), false );
-    TextFileWriter text_file_writer( replace_extension( input_cif_file_name, "inp" ) );
-    bool file_00000001_Bonds_tsv_exists = FileName( input_cif_file_name.directory(), "00000001-Bonds", "tsv" ).exists();
-    bool file_00000001_AllAngles_tsv_exists = FileName( input_cif_file_name.directory(), "00000001-AllAngles", "tsv" ).exists();
-    std::vector< std::string > bond_labels_1;
-    std::vector< std::string > bond_labels_2;
-    std::vector< double > bond_target_values;
-    std::vector< std::string > angle_labels_1;
-    std::vector< std::string > angle_labels_2;
-    std::vector< std::string > angle_labels_3;
-    std::vector< double > angle_target_values;
-    if ( file_00000001_Bonds_tsv_exists )
+    output += line;
+    output += '\n';
+}
+
+// ********************************************************************************
+
+FileName xye_file_name( const FileName & input_cif_file_name )
+{
+    return FileName( input_cif_file_name.directory(), input_cif_file_name.file_name(), "xye" );
+}
+
+// ********************************************************************************
+
+void append_unit_cell( const CrystalStructure & crystal_structure, std::string & output )
+{
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    const std::string crystal_system = crystal_structure.space_group().crystal_system();
+    if ( crystal_system == "triclinic" )
     {
-        std::cout << "Bond restraints file found, bond restraints will be written out." << std::endl;
-        TextFileReader_2 file_bond_restraints( FileName( input_cif_file_name.directory(), "00000001-Bonds", "tsv" ) );
-        std::vector< std::string > words;
-        for ( size_t i( 1 ); i != file_bond_restraints.size(); ++i )
-        {
-            words = split( file_bond_restraints.line( i ) );
-            if ( words.size() != 4 )
-                throw std::runtime_error( "inp_writer(): unexpected format in bond restraints file: >" + file_bond_restraints.line( i ) + "<" );
-            bond_labels_1.push_back( words[1]+aal );
-            bond_labels_2.push_back( words[2]+aal );
-            bond_target_values.push_back( string2double( words[3] ) );
-        }
+        append_line( output, "    a  @ " + double2string( crystal_lattice.a() ) );
+        append_line( output, "    b  @ " + double2string( crystal_lattice.b() ) );
+        append_line( output, "    c  @ " + double2string( crystal_lattice.c() ) );
+        append_line( output, "    al @ " + double2string( crystal_lattice.alpha().value_in_degrees() ) );
+        append_line( output, "    be @ " + double2string( crystal_lattice.beta().value_in_degrees() ) );
+        append_line( output, "    ga @ " + double2string( crystal_lattice.gamma().value_in_degrees() ) );
     }
-    else
-        std::cout << "No bond restraints file found, no bond restraints will be written out." << std::endl;
-    if ( file_00000001_AllAngles_tsv_exists )
+    else if ( crystal_system == "monoclinic" )
     {
-        std::cout << "Angle restraints file found, angle restraints will be written out." << std::endl;
-        TextFileReader_2 file_angle_restraints( FileName( input_cif_file_name.directory(), "00000001-AllAngles", "tsv" ) );
-        std::vector< std::string > words;
-        for ( size_t i( 1 ); i != file_angle_restraints.size(); ++i )
-        {
-            words = split( file_angle_restraints.line( i ) );
-            if ( words.size() != 5 )
-                throw std::runtime_error( ".inp writer: unexpected format in angle restraints file: >" + file_angle_restraints.line( i ) + "<" );
-            angle_labels_1.push_back( words[1]+aal );
-            angle_labels_2.push_back( words[2]+aal );
-            angle_labels_3.push_back( words[3]+aal );
-            angle_target_values.push_back( string2double( words[4] ) );
-        }
+        append_line( output, "    a  @ " + double2string( crystal_lattice.a() ) );
+        append_line( output, "    b  @ " + double2string( crystal_lattice.b() ) );
+        append_line( output, "    c  @ " + double2string( crystal_lattice.c() ) );
+        append_line( output, "    al   90.0" );
+        append_line( output, "    be @ " + double2string( crystal_lattice.beta().value_in_degrees() ) );
+        append_line( output, "    ga   90.0" );
     }
-    else
-        std::cout << "No angle restraints file found, no angle restraints will be written out." << std::endl;
-    // We must find the unique combinations, e.g.:
-    // angle r1-r2-r3 and bond r3-r2 only require two combinations: r1-r2 and r3-r2
-    // Create list of unique bonds
-//    std::vector< std::string > unique_labels_1;
-//    std::vector< std::string > unique_labels_2;
-//    for ( size_t i( 0 ); i != angle_labels_1.size(); ++i )
-//    {
-//        bool found( false );
-//        // Find bond 1
-//        for ( size_t j( 0 ); j != unique_labels_1.size(); ++j )
-//        {
-//            if ( ( unique_labels_1[j] == angle_labels_1[i] ) && ( unique_labels_2[j] == angle_labels_2[i] ) )
-//            {
-//                 found = true;
-//                 break;
-//            }
-//        }
-//        if ( ! found )
-//        {
-//            unique_labels_1.push_back( angle_labels_1[i] );
-//            unique_labels_2.push_back( angle_labels_2[i] );
-//        }
-//        found = false;
-//        // Find bond 2
-//        for ( size_t j( 0 ); j != unique_labels_1.size(); ++j )
-//        {
-//            if ( ( unique_labels_1[j] == angle_labels_3[i] ) && ( unique_labels_2[j] == angle_labels_2[i] ) )
-//            {
-//                 found = true;
-//                 break;
-//            }
-//        }
-//        if ( ! found )
-//        {
-//            unique_labels_1.push_back( angle_labels_3[i] );
-//            unique_labels_2.push_back( angle_labels_2[i] );
-//        }
-//    }
-    text_file_writer.write_line( "penalties_weighting_K1 5" );
-    text_file_writer.write_line( "'do_errors_include_penalties" );
-    text_file_writer.write_line( "prm JvdS_shift = Get(refine_ls_shift_on_su_max); : 0.0" );
-    text_file_writer.write_line( "prm JvdS_numpar = Get(number_independent_parameters); :  0.0" );
-    text_file_writer.write_line( "r_exp  0.0" );
-    text_file_writer.write_line( "r_exp_dash  0.0" );
-    text_file_writer.write_line( "r_wp  0.0" );
-    text_file_writer.write_line( "r_wp_dash  0.0" );
-    text_file_writer.write_line( "r_p  0.0" );
-    text_file_writer.write_line( "r_p_dash  0.0" );
-    text_file_writer.write_line( "gof  0.0" );
-    text_file_writer.write_line( "'continue_after_convergence" );
-    text_file_writer.write_line( "xdd " + FileName( input_cif_file_name.directory(), input_cif_file_name.file_name(), "xye" ).full_name() + " xye_format" );
-    text_file_writer.write_line( "  bkg @" );
-    for ( size_t i( 0 ); i != 20; ++i )
-        text_file_writer.write_line( "    0.0" );
-    text_file_writer.write_line( "  start_X       " + double2string( powder_pattern.two_theta_start().value_in_degrees() ) );
-    text_file_writer.write_line( "  finish_X      " + double2string( powder_pattern.two_theta_end().value_in_degrees() ) );
-    text_file_writer.write_line( "  x_calculation_step " + double2string( powder_pattern.average_two_theta_step().value_in_degrees() ) );
-    text_file_writer.write_line( "'  Specimen_Displacement(@ , 0.0 )" );
-    text_file_writer.write_line( "'  Absorption(@ , 0,0 )" );
-    text_file_writer.write_line( "  Zero_Error(@ , 0.0 )" );
-    text_file_writer.write_line( "'Synchrotron use: LP_Factor( 90.0 )" );
-    text_file_writer.write_line( "'Neutrons use: LP_Factor( 90.0 )" );
-    text_file_writer.write_line( "'No monochromator use: LP_Factor( 0.0 )" );
-    text_file_writer.write_line( "'Ge Monochromator, Cu radiation, use LP_Factor( 27.3 )" );
-    text_file_writer.write_line( "'Graphite Monochromator, Cu radiation, use LP_Factor( 26.4 )" );
-    text_file_writer.write_line( "'Quartz Monochromator, Cu radiation, use LP_Factor( 26.6 )" );
-    text_file_writer.write_line( "  LP_Factor( 26.5 )" );
-    text_file_writer.write_line( "'  Variable_Divergence(@ , 30.0 )" );
-    text_file_writer.write_line( "  axial_conv" );
-    text_file_writer.write_line( "    filament_length @ 4.97890" );
-    text_file_writer.write_line( "    sample_length @ 2.43658" );
-    text_file_writer.write_line( "    receiving_slit_length @ 5.25714" );
-    text_file_writer.write_line( "    axial_n_beta 50" );
-    text_file_writer.write_line( "  lam" );
-    text_file_writer.write_line( "    ymin_on_ymax 0.001" );
-    text_file_writer.write_line( "    la 1 lo  1.540560" );
-    text_file_writer.write_line( "  str" );
-    text_file_writer.write_line( "    r_bragg  0.0" );
-    text_file_writer.write_line( "    CS_L(@ , 9999.99881`)" );
-    text_file_writer.write_line( "    CS_G(@ , 107.03272`)" );
-    text_file_writer.write_line( "    Strain_G(@ , 0.49554`)" );
-    text_file_writer.write_line( "    Strain_L(@ , 0.03347`)" );
-    text_file_writer.write_line( "    prm  sh_scale_l" + aal + "  0.01948" );
-    text_file_writer.write_line( "    spherical_harmonics_hkl sh_l" + aal );
-    text_file_writer.write_line( "      sh_order 6" );
-    text_file_writer.write_line( "    lor_fwhm = Abs( sh_scale_l" + aal + " * sh_l" + aal + " );" );
-    text_file_writer.write_line( "    prm  sh_scale_g" + aal + "  0.01948" );
-    text_file_writer.write_line( "    spherical_harmonics_hkl sh_g" + aal );
-    text_file_writer.write_line( "      sh_order 6" );
-    text_file_writer.write_line( "    gauss_fwhm = Abs( sh_scale_g" + aal + " * sh_g" + aal + " );" );
-    if ( crystal_structure.space_group().crystal_system() == "triclinic" )
+    else if ( crystal_system == "orthorhombic" )
     {
-        text_file_writer.write_line( "    a  @ " + double2string( crystal_structure.crystal_lattice().a() ) );
-        text_file_writer.write_line( "    b  @ " + double2string( crystal_structure.crystal_lattice().b() ) );
-        text_file_writer.write_line( "    c  @ " + double2string( crystal_structure.crystal_lattice().c() ) );
-        text_file_writer.write_line( "    al @ " + double2string( crystal_structure.crystal_lattice().alpha().value_in_degrees() ) );
-        text_file_writer.write_line( "    be @ " + double2string( crystal_structure.crystal_lattice().beta().value_in_degrees() ) );
-        text_file_writer.write_line( "    ga @ " + double2string( crystal_structure.crystal_lattice().gamma().value_in_degrees() ) );
+        append_line( output, "    a  @ " + double2string( crystal_lattice.a() ) );
+        append_line( output, "    b  @ " + double2string( crystal_lattice.b() ) );
+        append_line( output, "    c  @ " + double2string( crystal_lattice.c() ) );
+        output += "    al 90.0\n    be 90.0\n    ga 90.0\n";
     }
-    else if ( crystal_structure.space_group().crystal_system() == "monoclinic" )
+    else if ( crystal_system == "tetragonal" )
     {
-        text_file_writer.write_line( "    a  @ " + double2string( crystal_structure.crystal_lattice().a() ) );
-        text_file_writer.write_line( "    b  @ " + double2string( crystal_structure.crystal_lattice().b() ) );
-        text_file_writer.write_line( "    c  @ " + double2string( crystal_structure.crystal_lattice().c() ) );
-        text_file_writer.write_line( "    al   90.0" );
-        text_file_writer.write_line( "    be @ " + double2string( crystal_structure.crystal_lattice().beta().value_in_degrees() ) );
-        text_file_writer.write_line( "    ga   90.0" );
+        append_line( output, "    prm uc_a " + double2string( crystal_lattice.a() ) );
+        output += "    a = uc_a;\n    b = uc_a;\n";
+        append_line( output, "    c  @ " + double2string( crystal_lattice.c() ) );
+        output += "    al 90.0\n    be 90.0\n    ga 90.0\n";
     }
-    else if ( crystal_structure.space_group().crystal_system() == "orthorhombic" )
+    else if ( crystal_system == "cubic" )
     {
-        text_file_writer.write_line( "    a  @ " + double2string( crystal_structure.crystal_lattice().a() ) );
-        text_file_writer.write_line( "    b  @ " + double2string( crystal_structure.crystal_lattice().b() ) );
-        text_file_writer.write_line( "    c  @ " + double2string( crystal_structure.crystal_lattice().c() ) );
-        text_file_writer.write_line( "    al 90.0" );
-        text_file_writer.write_line( "    be 90.0" );
-        text_file_writer.write_line( "    ga 90.0" );
+        append_line( output, "    prm uc_a " + double2string( crystal_lattice.a() ) );
+        output += "    a = uc_a;\n    b = uc_a;\n    c = uc_a;\n";
+        output += "    al 90.0\n    be 90.0\n    ga 90.0\n";
     }
-    else if ( crystal_structure.space_group().crystal_system() == "tetragonal" )
+    else if ( ( crystal_system == "hexagonal" ) ||
+              // Two options: trigonal or rhombohedral
+              ( ( crystal_system == "trigonal" ) && nearly_equal( crystal_lattice.alpha(), Angle::angle_90_degrees() ) && nearly_equal( crystal_lattice.beta(), Angle::angle_120_degrees() ) ) )
     {
-        text_file_writer.write_line( "    prm uc_a " + double2string( crystal_structure.crystal_lattice().a() ) );
-        text_file_writer.write_line( "    a = uc_a;" );
-        text_file_writer.write_line( "    b = uc_a;" );
-        text_file_writer.write_line( "    c  @ " + double2string( crystal_structure.crystal_lattice().c() ) );
-        text_file_writer.write_line( "    al 90.0" );
-        text_file_writer.write_line( "    be 90.0" );
-        text_file_writer.write_line( "    ga 90.0" );
+        append_line( output, "    prm uc_a " + double2string( crystal_lattice.a() ) );
+        output += "    a = uc_a;\n    b = uc_a;\n";
+        append_line( output, "    c  @ " + double2string( crystal_lattice.c() ) );
+        output += "    al 90.0\n    be 90.0\n    ga 120.0\n";
     }
-    else if ( crystal_structure.space_group().crystal_system() == "cubic" )
+    else if ( crystal_system == "trigonal" )
     {
-        text_file_writer.write_line( "    prm uc_a " + double2string( crystal_structure.crystal_lattice().a() ) );
-        text_file_writer.write_line( "    a = uc_a;" );
-        text_file_writer.write_line( "    b = uc_a;" );
-        text_file_writer.write_line( "    c = uc_a;" );
-        text_file_writer.write_line( "    al 90.0" );
-        text_file_writer.write_line( "    be 90.0" );
-        text_file_writer.write_line( "    ga 90.0" );
+        append_line( output, "    prm uc_a " + double2string( crystal_lattice.a() ) );
+        output += "    a = uc_a;\n    b = uc_a;\n    c = uc_a;\n";
+        append_line( output, "    prm uc_alpha " + double2string( crystal_lattice.alpha().value_in_degrees() ) );
+        output += "    al = uc_alpha;\n    be = uc_alpha;\n    ga = uc_alpha;\n";
     }
-    else if ( crystal_structure.space_group().crystal_system() == "hexagonal" )
+    else
+        throw std::runtime_error( "inp_writer(): we should never be here." );
+}
+
+// ********************************************************************************
+
+void append_bond_restraints( const FileName & file_name, const std::string & aal, std::string & output )
+{
+    TextFileReader_2 file_bond_restraints( file_name );
+    output += "    prm !bond_width   0\n";
+    output += "    prm !bond_weight  10000\n";
+    std::vector< std::string > words;
+    for ( size_t i( 1 ); i != file_bond_restraints.size(); ++i )
     {
-        text_file_writer.write_line( "    prm uc_a " + double2string( crystal_structure.crystal_lattice().a() ) );
-        text_file_writer.write_line( "    a = uc_a;" );
-        text_file_writer.write_line( "    b = uc_a;" );
-        text_file_writer.write_line( "    c  @ " + double2string( crystal_structure.crystal_lattice().c() ) );
-        text_file_writer.write_line( "    al 90.0" );
-        text_file_writer.write_line( "    be 90.0" );
-        text_file_writer.write_line( "    ga 120.0" );
+        words = split( file_bond_restraints.line( i ) );
+        if ( words.size() != 4 )
+            throw std::runtime_error( "inp_writer(): unexpected format in bond restraints file: >" + file_bond_restraints.line( i ) + "<" );
+        const std::string label_1 = words[1] + aal;
+        const std::string label_2 = words[2] + aal;
+        const double target_value = string2double( words[3] );
+        if ( element_from_atom_label( label_1 ).is_H_or_D() || element_from_atom_label( label_2 ).is_H_or_D() )
+            append_line( output, "    Distance_Restrain( " + label_1 + " " + label_2 + ", 0.95, 0.0, bond_width, bond_weight )" );
+        else
+            append_line( output, "    Distance_Restrain( " + label_1 + " " + label_2 + ", " + double2string( target_value ) + ", 0.0, bond_width, bond_weight )" );
     }
-    else if ( crystal_structure.space_group().crystal_system() == "trigonal" )
+}
+
+// ********************************************************************************
+
+void append_angle_restraints( const FileName & file_name, const std::string & aal, std::string & output )
+{
+    TextFileReader_2 file_angle_restraints( file_name );
+    output += "    prm !angle_width  0\n";
+    output += "    prm !angle_weight 1\n";
+    std::vector< std::string > words;
+    for ( size_t i( 1 ); i != file_angle_restraints.size(); ++i )
     {
-        // Two options: trigonal or rhombohedral
-        if ( nearly_equal( crystal_structure.crystal_lattice().alpha(), Angle::angle_90_degrees() ) && nearly_equal( crystal_structure.crystal_lattice().beta(), Angle::angle_120_degrees() ) )
-        {
-            text_file_writer.write_line( "    prm uc_a " + double2string( crystal_structure.crystal_lattice().a() ) );
-            text_file_writer.write_line( "    a = uc_a;" );
-            text_file_writer.write_line( "    b = uc_a;" );
-            text_file_writer.write_line( "    c  @ " + double2string( crystal_structure.crystal_lattice().c() ) );
-            text_file_writer.write_line( "    al 90.0" );
-            text_file_writer.write_line( "    be 90.0" );
-            text_file_writer.write_line( "    ga 120.0" );
-        }
-        else
-        {
-            text_file_writer.write_line( "    prm uc_a " + double2string( crystal_structure.crystal_lattice().a() ) );
-            text_file_writer.write_line( "    a = uc_a;" );
-            text_file_writer.write_line( "    b = uc_a;" );
-            text_file_writer.write_line( "    c = uc_a;" );
-            text_file_writer.write_line( "    prm uc_alpha " + double2string( crystal_structure.crystal_lattice().alpha().value_in_degrees() ) );
-            text_file_writer.write_line( "    al = uc_alpha;" );
-            text_file_writer.write_line( "    be = uc_alpha;" );
-            text_file_writer.write_line( "    ga = uc_alpha;" );
-        }
+        words = split( file_angle_restraints.line( i ) );
+        if ( words.size() != 5 )
+            throw std::runtime_error( ".inp writer: unexpected format in angle restraints file: >" + file_angle_restraints.line( i ) + "<" );
+        append_line( output, "    Angle_Restrain( " + words[1] + aal + " " + words[2] + aal + " " + words[3] + aal + ", " + double2string( string2double( words[4] ) ) + ", 0.0, angle_width, angle_weight )" );
     }
-    else
-        throw std::runtime_error( "inp_writer(): we should never be here." );
-    text_file_writer.write_line( "    MVW( 0.0, 0.0, 0.0 )");
-    text_file_writer.write_line( "    space_group \"" + remove( remove( crystal_structure.space_group().name(), '_' ), ' ') + "\"");
-    text_file_writer.write_line( "    scale @  0.0001" );
-    text_file_writer.write_line( "'    PO(@ , 1.0, , 1 0 0 )" );
-    text_file_writer.write_line( "    macro ref_flag" + aal + " { @ }" );
-    text_file_writer.write_line( "    prm    bnonh" + aal + " 3.0" );
-    text_file_writer.write_line( "    prm bh" + aal + " = 1.2 * bnonh" + aal + ";" );
+}
+
+// ********************************************************************************
+
+void write_text( const FileName & file_name, const std::string & text )
+{
+    TextFileWriter text_file_writer( file_name );
+    text_file_writer.write( text );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+InpTemplate::InpTemplate( const FileName & input_xye_file_name, const std::string & aal ):
+powder_pattern_( input_xye_file_name ),
+aal_( aal ),
+site_begin_( " x ref_flag" + aal + " " ),
+site_y_( " y ref_flag" + aal + " " ),
+site_z_( " z ref_flag" + aal + " " ),
+beq_h_( "bh" + aal + ";\n" ),
+beq_non_h_( "bnonh" + aal + ";\n" )
+{
+    // The powder diffraction file must contain a third column with estimated standard deviations or TOPAS cannot read the file.
+    powder_pattern_.recalculate_estimated_standard_deviations();
+    xye_.reserve( 48 * powder_pattern_.size() );
+    for ( size_t i( 0 ); i != powder_pattern_.size(); ++i )
+        append_line( xye_, double2string( powder_pattern_.two_theta( i ).value_in_degrees() ) + "  " + double2string( powder_pattern_.intensity( i ) ) + "  " + double2string( powder_pattern_.estimated_standard_deviation( i ) ) );
+    data_block_ = "  bkg @\n";
+    for ( size_t i( 0 ); i != 20; ++i )
+        data_block_ += "    0.0\n";
+    append_line( data_block_, "  start_X       " + double2string( powder_pattern_.two_theta_start().value_in_degrees() ) );
+    append_line( data_block_, "  finish_X      " + double2string( powder_pattern_.two_theta_end().value_in_degrees() ) );
+    append_line( data_block_, "  x_calculation_step " + double2string( powder_pattern_.average_two_theta_step().value_in_degrees() ) );
+    data_block_ += "'  Specimen_Displacement(@ , 0.0 )\n"
+                   "'  Absorption(@ , 0,0 )\n"
+                   "  Zero_Error(@ , 0.0 )\n"
+                   "'Synchrotron use: LP_Factor( 90.0 )\n"
+                   "'Neutrons use: LP_Factor( 90.0 )\n"
+                   "'No monochromator use: LP_Factor( 0.0 )\n"
+                   "'Ge Monochromator, Cu radiation, use LP_Factor( 27.3 )\n"
+                   "'Graphite Monochromator, Cu radiation, use LP_Factor( 26.4 )\n"
+                   "'Quartz Monochromator, Cu radiation, use LP_Factor( 26.6 )\n"
+                   "  LP_Factor( 26.5 )\n"
+                   "'  Variable_Divergence(@ , 30.0 )\n"
+                   "  axial_conv\n"
+                   "    filament_length @ 4.97890\n"
+                   "    sample_length @ 2.43658\n"
+                   "    receiving_slit_length @ 5.25714\n"
+                   "    axial_n_beta 50\n"
+                   "  lam\n"
+                   "    ymin_on_ymax 0.001\n"
+                   "    la 1 lo  1.540560\n"
+                   "  str\n"
+                   "    r_bragg  0.0\n"
+                   "    CS_L(@ , 9999.99881`)\n"
+                   "    CS_G(@ , 107.03272`)\n"
+                   "    Strain_G(@ , 0.49554`)\n"
+                   "    Strain_L(@ , 0.03347`)\n";
+    append_line( data_block_, "    prm  sh_scale_l" + aal + "  0.01948" );
+    append_line( data_block_, "    spherical_harmonics_hkl sh_l" + aal );
+    append_line( data_block_, "      sh_order 6" );
+    append_line( data_block_, "    lor_fwhm = Abs( sh_scale_l" + aal + " * sh_l" + aal + " );" );
+    append_line( data_block_, "    prm  sh_scale_g" + aal + "  0.01948" );
+    append_line( data_block_, "    spherical_harmonics_hkl sh_g" + aal );
+    append_line( data_block_, "      sh_order 6" );
+    append_line( data_block_, "    gauss_fwhm = Abs( sh_scale_g" + aal + " * sh_g" + aal + " );" );
+}
+
+// ********************************************************************************
+
+std::string InpTemplate::fill( const FileName & input_cif_file_name, const CrystalStructure & crystal_structure ) const
+{
+    std::string result;
+    result.reserve( 2048 + data_block_.size() + 128 * crystal_structure.natoms() );
+    result += inp_header;
+    append_line( result, "xdd " + xye_file_name( input_cif_file_name ).full_name() + " xye_format" );
+    result += data_block_;
+    append_unit_cell( crystal_structure, result );
+    result += "    MVW( 0.0, 0.0, 0.0 )\n";
+    append_line( result, "    space_group \"" + remove( remove( crystal_structure.space_group().name(), '_' ), ' ') + "\"" );
+    result += "    scale @  0.0001\n";
+    result += "'    PO(@ , 1.0, , 1 0 0 )\n";
+    append_line( result, "    macro ref_flag" + aal_ + " { @ }" );
+    append_line( result, "    prm    bnonh" + aal_ + " 3.0" );
+    append_line( result, "    prm bh" + aal_ + " = 1.2 * bnonh" + aal_ + ";" );
     for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
     {
-        text_file_writer.write( "    site " + crystal_structure.atom( i ).label() + aal + " x ref_flag" + aal + " " + double2string_pad_plus( crystal_structure.atom( i ).position().x(), 5, ' ' ) +
-                                                                                          " y ref_flag" + aal + " " + double2string_pad_plus( crystal_structure.atom( i ).position().y(), 5, ' ' ) +
-                                                                                          " z ref_flag" + aal + " " + double2string_pad_plus( crystal_structure.atom( i ).position().z(), 5, ' ' ) +
-                                     " occ " + pad( crystal_structure.atom( i ).element().symbol(), 2, ' ' ) + " 1 beq = " );
-        if ( crystal_structure.atom( i ).element().is_H_or_D() )
-            text_file_writer.write_line( "bh" + aal + ";" );
-        else
-            text_file_writer.write_line( "bnonh" + aal + ";" );
+        const Atom & atom = crystal_structure.atom( i );
+        result += "    site ";
+        result += atom.label();
+        result += aal_;
+        result += site_begin_;
+        result += double2string_pad_plus( atom.position().x(), 5, ' ' );
+        result += site_y_;
+        result += double2string_pad_plus( atom.position().y(), 5, ' ' );
+        result += site_z_;
+        result += double2string_pad_plus( atom.position().z(), 5, ' ' );
+        result += " occ ";
+        result += pad( atom.element().symbol(), 2, ' ' );
+        result += " 1 beq = ";
+        result += atom.element().is_H_or_D() ? beq_h_ : beq_non_h_;
     }
-    if ( file_00000001_Bonds_tsv_exists )
+    const FileName bonds_file_name( input_cif_file_name.directory(), "00000001-Bonds", "tsv" );
+    if ( bonds_file_name.exists() )
+        append_bond_restraints( bonds_file_name, aal_, result );
+    const FileName angles_file_name( input_cif_file_name.directory(), "00000001-AllAngles", "tsv" );
+    if ( angles_file_name.exists() )
+        append_angle_restraints( angles_file_name, aal_, result );
+    result += inp_flatten;
+    append_line( result, "    Out_CIF_STR( " + FileName( input_cif_file_name.directory(), input_cif_file_name.file_name() + "_RR", "cif" ).full_name() + " )" );
+    result += "    xdd_out " + FileName( input_cif_file_name.directory(), input_cif_file_name.file_name() + "_profile", "txt" ).full_name();
+    result += inp_profile_format;
+    result += "    phase_out " + FileName( input_cif_file_name.directory(), input_cif_file_name.file_name() + "_tickmarks", "txt" ).full_name();
+    result += inp_tickmarks_format;
+    return result;
+}
+
+// ********************************************************************************
+
+void InpTemplate::write( const FileName & input_cif_file_name, const CrystalStructure & crystal_structure ) const
+{
+    if ( xye_file_name( input_cif_file_name ).exists() )
+        throw std::runtime_error( "inp_writer(): can't create " + xye_file_name( input_cif_file_name ).full_name() + " because it already exists." );
+    // Build the .inp file first, so that nothing is written if, say, a restraints file is corrupt.
+    const std::string inp = fill( input_cif_file_name, crystal_structure );
+    write_text( xye_file_name( input_cif_file_name ), xye_ );
+    write_text( replace_extension( input_cif_file_name, "inp" ), inp );
+    write_text( replace_extension( input_cif_file_name, "org" ), inp );
+}
+
+// ********************************************************************************
+
+void inp_writer( const FileName & input_cif_file_name, const FileName & input_xye_file_name, const std::string & aal  )
+{
+    CrystalStructure crystal_structure;
+    std::cout << "Now reading cif... " + input_cif_file_name.full_name() << std::endl;
+    read_cif( input_cif_file_name, crystal_structure );
+    if ( xye_file_name( input_cif_file_name ).exists() )
+        throw std::runtime_error( "inp_writer(): can't create " + xye_file_name( input_cif_file_name ).full_name() + " because it already exists." );
+    InpTemplate inp_template( input_xye_file_name, aal );
+    if ( FileName( input_cif_file_name.directory(), "00000001-Bonds", "tsv" ).exists() )
+        std::cout << "Bond restraints file found, bond restraints will be written out." << std::endl;
+    else
+        std::cout << "No bond restraints file found, no bond restraints will be written out." << std::endl;
+    if ( FileName( input_cif_file_name.directory(), "00000001-AllAngles", "tsv" ).exists() )
+        std::cout << "Angle restraints file found, angle restraints will be written out." << std::endl;
+    else
+        std::cout << "No angle restraints file found, no angle restraints will be written out." << std::endl;
+    inp_template.write( input_cif_file_name, crystal_structure );
+    std::cout << "DO NOT FORGET TO RESET THE SPACE GROUP." << std::endl;
+}
+
+// ********************************************************************************
+
+size_t inp_writer( const FileList & input_cif_file_names,
+                   const FileName & input_xye_file_name,
+                   std::vector< std::string > & error_messages,
+                   const std::string & aal,
+                   const size_t nthreads )
+{
+    const InpTemplate inp_template( input_xye_file_name, aal );
+    error_messages = std::vector< std::string >( input_cif_file_names.size() );
+    parallel_for( input_cif_file_names.size(), nthreads, [&]( const size_t i )
     {
-        text_file_writer.write_line( "    prm !bond_width   0" );
-        text_file_writer.write_line( "    prm !bond_weight  10000" );
-        for ( size_t i( 0 ); i != bond_labels_1.size(); ++i )
+        try
         {
-            if ( element_from_atom_label( bond_labels_1[i] ).is_H_or_D() || element_from_atom_label( bond_labels_2[i] ).is_H_or_D() )
-                text_file_writer.write_line( "    Distance_Restrain( " + bond_labels_1[i] + " " + bond_labels_2[i] + ", 0.95, 0.0, bond_width, bond_weight )" );
-            else
-                text_file_writer.write_line( "    Distance_Restrain( " + bond_labels_1[i] + " " + bond_labels_2[i] + ", " + double2string( bond_target_values[i] ) + ", 0.0, bond_width, bond_weight )" );
+            CrystalStructure crystal_structure;
+            read_cif( input_cif_file_names.value( i ), crystal_structure );
+            inp_template.write( input_cif_file_names.value( i ), crystal_structure );
         }
-    }
-    if ( file_00000001_AllAngles_tsv_exists )
-    {
-        text_file_writer.write_line( "    prm !angle_width  0" );
-        text_file_writer.write_line( "    prm !angle_weight 1" );
-        for ( size_t i( 0 ); i != angle_labels_1.size(); ++i )
+        catch ( std::exception & e )
         {
-           text_file_writer.write_line( "    Angle_Restrain( " + angle_labels_1[i] + " " + angle_labels_2[i] + " " + angle_labels_3[i] + ", " + double2string( angle_target_values[i] ) + ", 0.0, angle_width, angle_weight )" );
+            error_messages[i] = std::string( e.what() );
+            if ( error_messages[i].empty() )
+                error_messages[i] = "Unknown error.";
         }
+    } );
+    size_t nfailed( 0 );
+    for ( size_t i( 0 ); i != error_messages.size(); ++i )
+    {
+        if ( ! error_messages[i].empty() )
+            ++nfailed;
     }
-    text_file_writer.write_line( "    prm !flatten_width 0" );
-    text_file_writer.write_line( "    prm !flatten_weight    100000" );
-    text_file_writer.write_line( "    'Flatten( C19 N11 N35 C47 H54 C50 H58 C45 H49 C34 C46, , 0.0, flatten_width, flatten_weight )" );
-    text_file_writer.write_line( "    Out_CIF_STR( " + FileName( input_cif_file_name.directory(), input_cif_file_name.file_name() + "_RR", "cif" ).full_name() + " )" );
-    text_file_writer.write_line( "    xdd_out " + FileName( input_cif_file_name.directory(), input_cif_file_name.file_name() + "_profile", "txt" ).full_name() + " load out_record out_fmt out_eqn" );
-    text_file_writer.write_line( "    {" );
-    text_file_writer.write_line( "        \" %11.5f \" = X;" );
-    text_file_writer.write_line( "        \" %11.5f \" = Yobs;" );
-    text_file_writer.write_line( "        \" %11.5f \" = Ycalc;" );
-    text_file_writer.write_line( "        \" %11.5f\\n\" = SigmaYobs;" );
-    text_file_writer.write_line( "    }" );
-    text_file_writer.write_line( "    phase_out " + FileName( input_cif_file_name.directory(), input_cif_file_name.file_name() + "_tickmarks", "txt" ).full_name() + " load out_record out_fmt out_eqn" );
-    text_file_writer.write_line( "    {" );
-    text_file_writer.write_line( "        \" %11.5f -200\\n\" = 2.0 * Rad * Th;" );
-    text_file_writer.write_line( "    }" );
-    copy_text_file( replace_extension( input_cif_file_name, "inp" ), replace_extension( input_cif_file_name, "org" ) );
-    std::cout << "DO NOT FORGET TO RESET THE SPACE GROUP." << std::endl;
+    return nfailed;
 }
 
 // ********************************************************************************
+
@@ -28,13 +28,67 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+class CrystalStructure;
+class FileList;
 class FileName;
 
+#include "PowderPattern.h"
+
 #include <string>
+#include <vector>
+
+/*
+  The parts of a TOPAS .inp file that only depend on the powder pattern and on aal, prepared once per data set.
+  fill() then only has to add the parts that depend on the crystal structure, so that thousands of candidate
+  structures can be set up for Pawley or Rietveld refinement against the same .xye file without re-reading it.
+*/
+class InpTemplate
+{
+public:
+
+    // The .xye file is read once and its estimated standard deviations are recalculated once.
+    // aal = additional atom label, a string that is appended to each atom label
+    explicit InpTemplate( const FileName & input_xye_file_name, const std::string & aal = "" );
+
+    const PowderPattern & powder_pattern() const { return powder_pattern_; }
+
+    std::string aal() const { return aal_; }
+
+    // The contents of the .inp file for crystal_structure, which was read from input_cif_file_name.
+    // The .inp file refers to an .xye file with the same name as the .cif file.
+    // Bond and angle restraints are read from 00000001-Bonds.tsv and 00000001-AllAngles.tsv in the directory of the .cif file if they exist.
+    std::string fill( const FileName & input_cif_file_name, const CrystalStructure & crystal_structure ) const;
+
+    // Writes the .xye file, the .inp file and a copy of the .inp file with extension .org next to the .cif file.
+    // Throws if the .xye file already exists.
+    void write( const FileName & input_cif_file_name, const CrystalStructure & crystal_structure ) const;
+
+private:
+    PowderPattern powder_pattern_;
+    std::string aal_;
+    std::string xye_;            // The contents of the .xye file that TOPAS reads, with ESDs
+    std::string data_block_;     // From "bkg" up to and including the peak shape
+    std::string site_begin_;     // " x ref_flag" + aal + " ", and similar for y and z
+    std::string site_y_;
+    std::string site_z_;
+    std::string beq_h_;          // "bh" + aal + ";"
+    std::string beq_non_h_;
+};
 
 // From .cif file
 // aal = additional atom label, a string that is appended to each atom label
 void inp_writer( const FileName & input_cif_file_name, const FileName & input_xye_file_name, const std::string & aal = "" );
 
+// Writes an .inp file for each .cif file in input_cif_file_names on nthreads threads (0 means one per core),
+// all against the same .xye file, which is read only once.
+// A file that cannot be processed does not stop the others, the reason is stored in error_messages,
+// which is resized to the number of files and is empty for the files that were processed successfully.
+// Returns the number of files that could not be processed.
+size_t inp_writer( const FileList & input_cif_file_names,
+                   const FileName & input_xye_file_name,
+                   std::vector< std::string > & error_messages,
+                   const std::string & aal = "",
+                   const size_t nthreads = 0 );
+
 #endif // INPWRITER_H
 
@@ -0,0 +1,325 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Instrumentation.h"
+#include "FileName.h"
+#include "TextFileWriter.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// Beyond this, timed scopes are still added to the summary, but no longer stored as trace events.
+const size_t maximum_nevents = 1000000;
+
+std::string to_MB( const long long nbytes )
+{
+    return double2string( nbytes / ( 1024.0 * 1024.0 ), 3, 14 );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+Instrumentation & Instrumentation::instance()
+{
+    static Instrumentation instrumentation;
+    return instrumentation;
+}
+
+// ********************************************************************************
+
+Instrumentation::Instrumentation():
+epoch_( std::chrono::steady_clock::now() )
+{
+}
+
+// ********************************************************************************
+
+void Instrumentation::add_timing( const char * name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end )
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    Timing & timing = timings_[ name ];
+    ++timing.ncalls_;
+    timing.total_seconds_ += std::chrono::duration< double >( end - start ).count();
+    if ( events_.size() == maximum_nevents )
+        return;
+    std::map< std::thread::id, size_t >::const_iterator it = threads_.insert( std::make_pair( std::this_thread::get_id(), threads_.size() ) ).first;
+    TraceEvent event;
+    event.name_ = name;
+    event.thread_ = it->second;
+    event.start_ = std::chrono::duration_cast< std::chrono::microseconds >( start - epoch_ ).count();
+    event.duration_ = std::chrono::duration_cast< std::chrono::microseconds >( end - start ).count();
+    events_.push_back( event );
+}
+
+// ********************************************************************************
+
+void Instrumentation::add_count( const char * name, const size_t n )
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    counts_[ name ] += n;
+}
+
+// ********************************************************************************
+
+void Instrumentation::add_memory( const char * subsystem, const long long nbytes )
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    Memory & memory = memory_[ subsystem ];
+    memory.current_ += nbytes;
+    memory.peak_ = std::max( memory.peak_, memory.current_ );
+}
+
+// ********************************************************************************
+
+void Instrumentation::add_memory_checkpoint( const char * name )
+{
+    MemoryCheckpoint memory_checkpoint;
+    memory_checkpoint.name_ = name;
+    memory_checkpoint.resident_set_size_ = resident_set_size();
+    memory_checkpoint.peak_resident_set_size_ = peak_resident_set_size();
+    std::lock_guard< std::mutex > lock( mutex_ );
+    memory_checkpoint.time_ = std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now() - epoch_ ).count();
+    for ( std::map< std::string, Memory >::const_iterator it( memory_.begin() ); it != memory_.end(); ++it )
+        memory_checkpoint.subsystems_[ it->first ] = it->second.current_;
+    memory_checkpoints_.push_back( memory_checkpoint );
+}
+
+// ********************************************************************************
+
+size_t Instrumentation::ncalls( const std::string & name ) const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    std::map< std::string, Timing >::const_iterator it = timings_.find( name );
+    return ( it == timings_.end() ) ? 0 : it->second.ncalls_;
+}
+
+// ********************************************************************************
+
+double Instrumentation::total_seconds( const std::string & name ) const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    std::map< std::string, Timing >::const_iterator it = timings_.find( name );
+    return ( it == timings_.end() ) ? 0.0 : it->second.total_seconds_;
+}
+
+// ********************************************************************************
+
+size_t Instrumentation::count( const std::string & name ) const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    std::map< std::string, size_t >::const_iterator it = counts_.find( name );
+    return ( it == counts_.end() ) ? 0 : it->second;
+}
+
+// ********************************************************************************
+
+long long Instrumentation::current_memory( const std::string & subsystem ) const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    std::map< std::string, Memory >::const_iterator it = memory_.find( subsystem );
+    return ( it == memory_.end() ) ? 0 : it->second.current_;
+}
+
+// ********************************************************************************
+
+long long Instrumentation::peak_memory( const std::string & subsystem ) const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    std::map< std::string, Memory >::const_iterator it = memory_.find( subsystem );
+    return ( it == memory_.end() ) ? 0 : it->second.peak_;
+}
+
+// ********************************************************************************
+
+size_t Instrumentation::nmemory_checkpoints() const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    return memory_checkpoints_.size();
+}
+
+// ********************************************************************************
+
+std::string Instrumentation::summary() const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    size_t name_width( 7 );
+    for ( std::map< std::string, Timing >::const_iterator it( timings_.begin() ); it != timings_.end(); ++it )
+        name_width = std::max( name_width, it->first.size() );
+    for ( std::map< std::string, size_t >::const_iterator it( counts_.begin() ); it != counts_.end(); ++it )
+        name_width = std::max( name_width, it->first.size() );
+    for ( std::map< std::string, Memory >::const_iterator it( memory_.begin() ); it != memory_.end(); ++it )
+        name_width = std::max( name_width, it->first.size() );
+    for ( size_t i( 0 ); i != memory_checkpoints_.size(); ++i )
+        name_width = std::max( name_width, std::string( memory_checkpoints_[i].name_ ).size() );
+    name_width = std::max( name_width, size_t( 10 ) );
+    std::string result;
+    if ( ! timings_.empty() )
+    {
+        result += pad( "Timer", name_width ) + "       ncalls     total / s      mean / ms\n";
+        for ( std::map< std::string, Timing >::const_iterator it( timings_.begin() ); it != timings_.end(); ++it )
+        {
+            result += pad( it->first, name_width ) + " " + size_t2string( it->second.ncalls_, 12, ' ' ) + " " +
+                      double2string( it->second.total_seconds_, 6, 13 ) + " " +
+                      double2string( ( 1000.0 * it->second.total_seconds_ ) / it->second.ncalls_, 6, 14 ) + "\n";
+        }
+    }
+    if ( ! counts_.empty() )
+    {
+        result += pad( "Counter", name_width ) + "                total\n";
+        for ( std::map< std::string, size_t >::const_iterator it( counts_.begin() ); it != counts_.end(); ++it )
+            result += pad( it->first, name_width ) + " " + size_t2string( it->second, 20, ' ' ) + "\n";
+    }
+    if ( ! memory_.empty() )
+    {
+        result += pad( "Memory", name_width ) + "    current / MB      peak / MB\n";
+        for ( std::map< std::string, Memory >::const_iterator it( memory_.begin() ); it != memory_.end(); ++it )
+            result += pad( it->first, name_width ) + " " + to_MB( it->second.current_ ) + " " + to_MB( it->second.peak_ ) + "\n";
+    }
+    if ( ! memory_checkpoints_.empty() )
+    {
+        result += pad( "Checkpoint", name_width ) + "        time / s        RSS / MB   peak RSS / MB\n";
+        for ( size_t i( 0 ); i != memory_checkpoints_.size(); ++i )
+        {
+            result += pad( memory_checkpoints_[i].name_, name_width ) + " " + double2string( memory_checkpoints_[i].time_ / 1.0E6, 3, 15 ) + " " +
+                      to_MB( memory_checkpoints_[i].resident_set_size_ ) + "  " + to_MB( memory_checkpoints_[i].peak_resident_set_size_ ) + "\n";
+        }
+    }
+    if ( events_.size() == maximum_nevents )
+        result += "Only the first " + size_t2string( maximum_nevents ) + " timed scopes have been stored as trace events.\n";
+    return result;
+}
+
+// ********************************************************************************
+
+void Instrumentation::save_Chrome_trace( const FileName & file_name ) const
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    TextFileWriter text_file_writer( file_name );
+    std::string output;
+    output.reserve( 100 * ( events_.size() + 2 ) );
+    output += "{\"traceEvents\":[\n";
+    long long last_time( 0 );
+    for ( size_t i( 0 ); i != events_.size(); ++i )
+    {
+        if ( i != 0 )
+            output += ",\n";
+        output += "{\"name\":\"";
+        output += events_[i].name_;
+        output += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + size_t2string( events_[i].thread_ ) +
+                  ",\"ts\":" + std::to_string( events_[i].start_ ) +
+                  ",\"dur\":" + std::to_string( events_[i].duration_ ) + "}";
+        last_time = std::max( last_time, events_[i].start_ + events_[i].duration_ );
+    }
+    if ( ! counts_.empty() )
+    {
+        if ( ! events_.empty() )
+            output += ",\n";
+        output += "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" + std::to_string( last_time ) + ",\"args\":{";
+        for ( std::map< std::string, size_t >::const_iterator it( counts_.begin() ); it != counts_.end(); ++it )
+        {
+            if ( it != counts_.begin() )
+                output += ",";
+            output += "\"" + it->first + "\":" + size_t2string( it->second );
+        }
+        output += "}}";
+    }
+    // One counter event per memory checkpoint, in MB
+    for ( size_t i( 0 ); i != memory_checkpoints_.size(); ++i )
+    {
+        if ( ( i != 0 ) || ( ! events_.empty() ) || ( ! counts_.empty() ) )
+            output += ",\n";
+        const MemoryCheckpoint & memory_checkpoint = memory_checkpoints_[i];
+        output += "{\"name\":\"memory\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" + std::to_string( memory_checkpoint.time_ ) +
+                  ",\"args\":{\"RSS\":" + double2string( memory_checkpoint.resident_set_size_ / ( 1024.0 * 1024.0 ), 3 );
+        for ( std::map< std::string, long long >::const_iterator it( memory_checkpoint.subsystems_.begin() ); it != memory_checkpoint.subsystems_.end(); ++it )
+            output += ",\"" + it->first + "\":" + double2string( it->second / ( 1024.0 * 1024.0 ), 3 );
+        output += "}}";
+    }
+    output += "\n]}\n";
+    text_file_writer.write( output );
+}
+
+// ********************************************************************************
+
+void Instrumentation::clear()
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    timings_.clear();
+    counts_.clear();
+    memory_.clear();
+    memory_checkpoints_.clear();
+    events_.clear();
+    threads_.clear();
+    epoch_ = std::chrono::steady_clock::now();
+}
+
+// ********************************************************************************
+
+size_t resident_set_size()
+{
+#ifndef _WIN32
+    // The second field of /proc/self/statm is the resident set size in pages, Linux only
+    std::ifstream input_file( "/proc/self/statm" );
+    size_t size( 0 );
+    size_t resident( 0 );
+    if ( input_file >> size >> resident )
+        return resident * static_cast< size_t >( sysconf( _SC_PAGESIZE ) );
+#endif
+    return 0;
+}
+
+// ********************************************************************************
+
+size_t peak_resident_set_size()
+{
+#ifndef _WIN32
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) == 0 )
+    {
+#ifdef __APPLE__
+        return static_cast< size_t >( usage.ru_maxrss ); // In bytes
+#else
+        return static_cast< size_t >( usage.ru_maxrss ) * 1024; // In kilobytes
+#endif
+    }
+#endif
+    return 0;
+}
+
+// ********************************************************************************
+
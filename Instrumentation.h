@@ -0,0 +1,227 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class FileName;
+
+#include <chrono>
+#include <cstddef> // For definition of size_t
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+  Scoped timers and counters for the hot paths, switched on at compile time with -DFOURIER_INSTRUMENTATION
+  ("make INSTRUMENTATION=1", after "make clean"). Without it, MACRO_SCOPED_TIMER and MACRO_COUNT expand to nothing
+  and their arguments are not evaluated, so the instrumented code is exactly the uninstrumented code.
+
+  Every timed scope is also stored as an event, so the run can be inspected as a timeline in chrome://tracing or Perfetto.
+  At the end of a run, the summary is printed and the trace is saved as Fourier_trace.json in the current directory.
+
+  Memory is accounted per subsystem: the large containers hold a TrackedMemory that adds their bytes to the current and peak
+  usage of their subsystem, e.g. "CorrelationMatrix". MACRO_MEMORY_CHECKPOINT records the resident set size of the process,
+  its peak so far and the current usage of every subsystem; the checkpoints are part of the summary and appear as counters
+  in the trace. A checkpoint is taken at the end of every run. Without FOURIER_INSTRUMENTATION nothing is counted.
+*/
+class Instrumentation
+{
+public:
+
+    // The program-wide instance, safe to use from several threads.
+    static Instrumentation & instance();
+
+    Instrumentation();
+
+    void add_timing( const char * name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end );
+    void add_count( const char * name, const size_t n );
+
+    // nbytes is negative when memory is released.
+    void add_memory( const char * subsystem, const long long nbytes );
+
+    void add_memory_checkpoint( const char * name );
+
+    size_t ncalls( const std::string & name ) const;
+    double total_seconds( const std::string & name ) const;
+    size_t count( const std::string & name ) const;
+
+    // In bytes.
+    long long current_memory( const std::string & subsystem ) const;
+    long long peak_memory( const std::string & subsystem ) const;
+
+    size_t nmemory_checkpoints() const;
+
+    // One line per timer (number of calls, total and mean time), one line per counter, one line per subsystem (current and peak memory)
+    // and one line per memory checkpoint.
+    std::string summary() const;
+
+    // Chrome trace event format, one complete ("X") event per timed scope, one thread id per thread, the counters as a final counter ("C") event.
+    void save_Chrome_trace( const FileName & file_name ) const;
+
+    void clear();
+
+private:
+
+    struct Timing
+    {
+        Timing(): ncalls_(0), total_seconds_(0.0) {}
+        size_t ncalls_;
+        double total_seconds_;
+    };
+
+    struct TraceEvent
+    {
+        const char * name_;
+        size_t thread_;
+        long long start_; // Microseconds since epoch_
+        long long duration_; // Microseconds
+    };
+
+    struct Memory
+    {
+        Memory(): current_(0), peak_(0) {}
+        long long current_;
+        long long peak_;
+    };
+
+    struct MemoryCheckpoint
+    {
+        const char * name_;
+        long long time_; // Microseconds since epoch_
+        size_t resident_set_size_;
+        size_t peak_resident_set_size_;
+        std::map< std::string, long long > subsystems_; // The current memory of each subsystem
+    };
+
+    std::map< std::string, Timing > timings_;
+    std::map< std::string, size_t > counts_;
+    std::map< std::string, Memory > memory_;
+    std::vector< MemoryCheckpoint > memory_checkpoints_;
+    std::vector< TraceEvent > events_;
+    std::map< std::thread::id, size_t > threads_;
+    std::chrono::steady_clock::time_point epoch_;
+    mutable std::mutex mutex_;
+};
+
+class ScopedTimer
+{
+public:
+    // name must be a string literal, only the pointer is stored.
+    explicit ScopedTimer( const char * name ): name_(name), start_( std::chrono::steady_clock::now() ) {}
+
+    ~ScopedTimer() { Instrumentation::instance().add_timing( name_, start_, std::chrono::steady_clock::now() ); }
+
+private:
+    const char * name_;
+    std::chrono::steady_clock::time_point start_;
+
+    ScopedTimer( const ScopedTimer & );
+    ScopedTimer & operator=( const ScopedTimer & );
+};
+
+// The resident set size of the process and its peak so far, in bytes. 0 if not available on this platform.
+size_t resident_set_size();
+size_t peak_resident_set_size();
+
+/*
+  The bytes of one large container, counted towards a subsystem for the memory accounting of Instrumentation.
+  Make it a member of the class that owns the container and call set() whenever the container is (re)allocated.
+  A copy counts the same number of bytes again, the destructor releases them. Without FOURIER_INSTRUMENTATION only
+  the number of bytes is stored.
+*/
+class TrackedMemory
+{
+public:
+    // subsystem must be a string literal, only the pointer is stored.
+    explicit TrackedMemory( const char * subsystem ): subsystem_(subsystem), nbytes_(0) {}
+
+    TrackedMemory( const TrackedMemory & rhs ): subsystem_(rhs.subsystem_), nbytes_(0) { set( rhs.nbytes_ ); }
+
+    // The subsystem is not changed.
+    TrackedMemory & operator=( const TrackedMemory & rhs ) { set( rhs.nbytes_ ); return *this; }
+
+    ~TrackedMemory() { set( 0 ); }
+
+    size_t nbytes() const { return nbytes_; }
+
+    void set( const size_t nbytes )
+    {
+#ifdef FOURIER_INSTRUMENTATION
+        if ( nbytes != nbytes_ )
+            Instrumentation::instance().add_memory( subsystem_, static_cast< long long >( nbytes ) - static_cast< long long >( nbytes_ ) );
+#endif
+        nbytes_ = nbytes;
+    }
+
+    // For the swap() of the owner, the subsystems are not swapped.
+    void swap( TrackedMemory & rhs )
+    {
+        const size_t nbytes = nbytes_;
+        set( rhs.nbytes_ );
+        rhs.set( nbytes );
+    }
+
+private:
+    const char * subsystem_;
+    size_t nbytes_;
+};
+
+#define MACRO_INSTRUMENTATION_CONCATENATE_2( a, b ) a##b
+#define MACRO_INSTRUMENTATION_CONCATENATE( a, b ) MACRO_INSTRUMENTATION_CONCATENATE_2( a, b )
+
+#ifdef FOURIER_INSTRUMENTATION
+
+#define MACRO_SCOPED_TIMER( name ) ScopedTimer MACRO_INSTRUMENTATION_CONCATENATE( scoped_timer_, __LINE__ )( name )
+
+#define MACRO_COUNT( name, n ) Instrumentation::instance().add_count( name, n )
+
+// name must be a string literal.
+#define MACRO_MEMORY_CHECKPOINT( name ) Instrumentation::instance().add_memory_checkpoint( name )
+
+#define MACRO_INSTRUMENTATION_REPORT \
+    Instrumentation::instance().add_memory_checkpoint( "end of run" ); \
+    std::cout << Instrumentation::instance().summary(); \
+    Instrumentation::instance().save_Chrome_trace( FileName( "Fourier_trace.json" ) );
+
+#else
+
+#define MACRO_SCOPED_TIMER( name )
+
+#define MACRO_COUNT( name, n )
+
+#define MACRO_MEMORY_CHECKPOINT( name )
+
+#define MACRO_INSTRUMENTATION_REPORT
+
+#endif // FOURIER_INSTRUMENTATION
+
+#endif // INSTRUMENTATION_H
+
@@ -0,0 +1,234 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "IntegerSymmetryOperator.h"
+#include "Matrix3D.h"
+#include "SymmetryOperator.h"
+#include "Vector3D.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+
+// Returns false if x is not within tolerance of an integer.
+bool nearest_integer( const double x, int & result )
+{
+    const double rounded = std::floor( x + 0.5 );
+    if ( std::abs( x - rounded ) > 0.0001 )
+        return false;
+    result = static_cast< int >( rounded );
+    return true;
+}
+
+inline unsigned char modulo_24( const int x )
+{
+    return static_cast< unsigned char >( ( ( x % 24 ) + 24 ) % 24 );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+IntegerSymmetryOperator::IntegerSymmetryOperator()
+{
+    for ( size_t i( 0 ); i != 9; ++i )
+        rotation_[i] = ( ( i % 4 ) == 0 ) ? 1 : 0;
+    for ( size_t i( 0 ); i != 3; ++i )
+        translation_[i] = 0;
+}
+
+// ********************************************************************************
+
+IntegerSymmetryOperator::IntegerSymmetryOperator( const SymmetryOperator & symmetry_operator )
+{
+    if ( ! from_symmetry_operator( symmetry_operator, *this ) )
+        throw std::runtime_error( "IntegerSymmetryOperator::IntegerSymmetryOperator(): symmetry operator cannot be represented: " + symmetry_operator.to_string() );
+}
+
+// ********************************************************************************
+
+bool IntegerSymmetryOperator::from_symmetry_operator( const SymmetryOperator & symmetry_operator, IntegerSymmetryOperator & result )
+{
+    IntegerSymmetryOperator integer_symmetry_operator;
+    const Matrix3D rotation = symmetry_operator.rotation();
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            int value;
+            if ( ( ! nearest_integer( rotation.value( i, j ), value ) ) || ( value < -1 ) || ( 1 < value ) )
+                return false;
+            integer_symmetry_operator.rotation_[ 3*i + j ] = static_cast< signed char >( value );
+        }
+    }
+    const Vector3D translation = symmetry_operator.translation();
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        int value;
+        if ( ! nearest_integer( 24.0 * translation.value( i ), value ) )
+            return false;
+        integer_symmetry_operator.translation_[i] = modulo_24( value );
+    }
+    result = integer_symmetry_operator;
+    return true;
+}
+
+// ********************************************************************************
+
+SymmetryOperator IntegerSymmetryOperator::to_symmetry_operator() const
+{
+    return SymmetryOperator( Matrix3D( rotation_[0], rotation_[1], rotation_[2],
+                                       rotation_[3], rotation_[4], rotation_[5],
+                                       rotation_[6], rotation_[7], rotation_[8] ),
+                             Vector3D( translation_[0] / 24.0, translation_[1] / 24.0, translation_[2] / 24.0 ) );
+}
+
+// ********************************************************************************
+
+uint32_t IntegerSymmetryOperator::key() const
+{
+    // Nine base-3 digits for the rotation (3^9 < 2^15), three base-24 digits for the translation (24^3 < 2^15)
+    uint32_t rotation_key( 0 );
+    for ( size_t i( 0 ); i != 9; ++i )
+        rotation_key = 3 * rotation_key + static_cast< uint32_t >( rotation_[i] + 1 );
+    const uint32_t translation_key = ( 24 * translation_[0] + translation_[1] ) * 24 + translation_[2];
+    return ( rotation_key << 15 ) | translation_key;
+}
+
+// ********************************************************************************
+
+IntegerSymmetryOperator operator*( const IntegerSymmetryOperator & lhs, const IntegerSymmetryOperator & rhs )
+{
+    IntegerSymmetryOperator result;
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            int value( 0 );
+            for ( size_t k( 0 ); k != 3; ++k )
+                value += lhs.rotation_[ 3*i + k ] * rhs.rotation_[ 3*k + j ];
+            result.rotation_[ 3*i + j ] = static_cast< signed char >( value );
+        }
+        int translation = lhs.translation_[i];
+        for ( size_t k( 0 ); k != 3; ++k )
+            translation += lhs.rotation_[ 3*i + k ] * rhs.translation_[k];
+        result.translation_[i] = modulo_24( translation );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+bool to_integer_symmetry_operators( const std::vector< SymmetryOperator > & symmetry_operators, std::vector< IntegerSymmetryOperator > & result )
+{
+    std::vector< IntegerSymmetryOperator > integer_symmetry_operators( symmetry_operators.size() );
+    for ( size_t i( 0 ); i != symmetry_operators.size(); ++i )
+    {
+        if ( ! IntegerSymmetryOperator::from_symmetry_operator( symmetry_operators[i], integer_symmetry_operators[i] ) )
+            return false;
+    }
+    result.swap( integer_symmetry_operators );
+    return true;
+}
+
+// ********************************************************************************
+
+bool is_closed( const std::vector< IntegerSymmetryOperator > & symmetry_operators )
+{
+    std::unordered_map< IntegerSymmetryOperator, size_t, IntegerSymmetryOperatorHash > index;
+    for ( size_t i( 0 ); i != symmetry_operators.size(); ++i )
+        index[ symmetry_operators[i] ] = i;
+    for ( size_t i( 0 ); i != symmetry_operators.size(); ++i )
+    {
+        for ( size_t j( 0 ); j != symmetry_operators.size(); ++j )
+        {
+            if ( index.find( symmetry_operators[i] * symmetry_operators[j] ) == index.end() )
+                return false;
+        }
+    }
+    return true;
+}
+
+// ********************************************************************************
+
+std::vector< size_t > multiplication_table( const std::vector< IntegerSymmetryOperator > & symmetry_operators )
+{
+    const size_t n = symmetry_operators.size();
+    std::unordered_map< IntegerSymmetryOperator, size_t, IntegerSymmetryOperatorHash > index;
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        if ( ! index.insert( std::make_pair( symmetry_operators[i], i ) ).second )
+            throw std::runtime_error( "multiplication_table(): duplicate symmetry operator." );
+    }
+    std::vector< size_t > result( n * n );
+    std::vector< bool > seen( n );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        seen.assign( n, false );
+        for ( size_t j( 0 ); j != n; ++j )
+        {
+            std::unordered_map< IntegerSymmetryOperator, size_t, IntegerSymmetryOperatorHash >::const_iterator it = index.find( symmetry_operators[i] * symmetry_operators[j] );
+            if ( it == index.end() )
+                throw std::runtime_error( "multiplication_table(): symmetry operators are not closed." );
+            if ( seen[ it->second ] )
+                throw std::runtime_error( "multiplication_table(): element occurs twice in the same row." );
+            seen[ it->second ] = true;
+            result[ i * n + j ] = it->second;
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< IntegerSymmetryOperator > generate_group( const std::vector< IntegerSymmetryOperator > & generators )
+{
+    std::vector< IntegerSymmetryOperator > result( 1, IntegerSymmetryOperator() );
+    std::unordered_map< IntegerSymmetryOperator, size_t, IntegerSymmetryOperatorHash > index;
+    index[ result[0] ] = 0;
+    for ( size_t i( 0 ); i != result.size(); ++i )
+    {
+        for ( size_t j( 0 ); j != generators.size(); ++j )
+        {
+            const IntegerSymmetryOperator product = result[i] * generators[j];
+            if ( index.find( product ) != index.end() )
+                continue;
+            if ( result.size() == 192 )
+                throw std::runtime_error( "generate_group(): more than 192 symmetry operators." );
+            index[ product ] = result.size();
+            result.push_back( product );
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
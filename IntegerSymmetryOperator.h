@@ -0,0 +1,104 @@
+#ifndef INTEGERSYMMETRYOPERATOR_H
+#define INTEGERSYMMETRYOPERATOR_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class SymmetryOperator;
+
+#include <cstddef>
+#include <vector>
+
+#include <stdint.h>
+
+/*
+  A compact, exact representation of a crystallographic symmetry operator.
+
+  In the standard settings all elements of the rotation matrix are -1, 0 or +1 and all translations are multiples of 1/24,
+  so the operator can be stored as small integers: composition is exact, no tolerances are needed for comparisons
+  and the whole operator fits in a single 32-bit key that can be used for hashing.
+
+  The translations are canonicalised to [ 0, 24 >, i.e. [ 0, 1 >.
+*/
+class IntegerSymmetryOperator
+{
+public:
+
+    // Default constructor: identity operator
+    IntegerSymmetryOperator();
+
+    // Throws if the rotation matrix has elements other than -1, 0 or +1 or if the translations are not multiples of 1/24.
+    explicit IntegerSymmetryOperator( const SymmetryOperator & symmetry_operator );
+
+    // Returns false if symmetry_operator cannot be represented, in which case result is not changed.
+    static bool from_symmetry_operator( const SymmetryOperator & symmetry_operator, IntegerSymmetryOperator & result );
+
+    SymmetryOperator to_symmetry_operator() const;
+
+    int rotation( const size_t i, const size_t j ) const { return rotation_[ 3*i + j ]; }
+
+    // In units of 1/24, in the range [ 0, 24 >.
+    int translation( const size_t i ) const { return translation_[i]; }
+
+    // Unique for each operator, the translations are in the lowest 15 bits.
+    uint32_t key() const;
+
+    bool operator==( const IntegerSymmetryOperator & rhs ) const { return key() == rhs.key(); }
+    bool operator!=( const IntegerSymmetryOperator & rhs ) const { return ! ( *this == rhs ); }
+    bool operator< ( const IntegerSymmetryOperator & rhs ) const { return key() < rhs.key(); }
+
+    friend IntegerSymmetryOperator operator*( const IntegerSymmetryOperator & lhs, const IntegerSymmetryOperator & rhs );
+
+private:
+    signed char rotation_[9];
+    unsigned char translation_[3];
+};
+
+IntegerSymmetryOperator operator*( const IntegerSymmetryOperator & lhs, const IntegerSymmetryOperator & rhs );
+
+// For std::unordered_map and std::unordered_set.
+struct IntegerSymmetryOperatorHash
+{
+    size_t operator()( const IntegerSymmetryOperator & symmetry_operator ) const { return symmetry_operator.key(); }
+};
+
+// Converts all symmetry operators. Returns false if at least one of them cannot be represented.
+bool to_integer_symmetry_operators( const std::vector< SymmetryOperator > & symmetry_operators, std::vector< IntegerSymmetryOperator > & result );
+
+// Checks that all products are in the set, using a hash table: O( n^2 ).
+bool is_closed( const std::vector< IntegerSymmetryOperator > & symmetry_operators );
+
+// multiplication_table[ i * n + j ] is the index of symmetry_operators[i] * symmetry_operators[j].
+// Throws if the symmetry operators do not form a group, i.e. if the set is not closed or if an element occurs
+// more than once in a row (which also catches duplicate symmetry operators).
+std::vector< size_t > multiplication_table( const std::vector< IntegerSymmetryOperator > & symmetry_operators );
+
+// All products of the generators, the identity is the first element.
+// Throws if the group has more than 192 elements.
+std::vector< IntegerSymmetryOperator > generate_group( const std::vector< IntegerSymmetryOperator > & generators );
+
+#endif // INTEGERSYMMETRYOPERATOR_H
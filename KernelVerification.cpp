@@ -0,0 +1,348 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "KernelVerification.h"
+#include "Angle.h"
+#include "AnisotropicDisplacementParameters.h"
+#include "Atom.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "MathConstants.h"
+#include "MathFunctions.h"
+#include "MillerIndices.h"
+#include "PeakShapeFunction.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "ReflectionList.h"
+#include "SpaceGroup.h"
+#include "SymmetricMatrix3D.h"
+#include "Utilities.h"
+#include "Vector3D.h"
+#include "Xoshiro256StarStar.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+
+// Maps the doubles onto the integers such that consecutive doubles are consecutive integers, -0.0 and +0.0 both onto 0.
+int64_t ordered_bits( const double value )
+{
+    int64_t bits;
+    std::memcpy( &bits, &value, sizeof( bits ) );
+    return ( bits < 0 ) ? std::numeric_limits< int64_t >::min() - bits : bits;
+}
+
+double uniform( Xoshiro256StarStar & generator, const double minimum, const double maximum )
+{
+    return minimum + ( maximum - minimum ) * generator.next_double();
+}
+
+size_t random_index( Xoshiro256StarStar & generator, const size_t n )
+{
+    return std::min( static_cast< size_t >( generator.next_double() * n ), n - 1 );
+}
+
+// A unit cell that is compatible with the space group: triclinic, monoclinic (unique axis b) or orthorhombic
+CrystalLattice random_crystal_lattice( Xoshiro256StarStar & generator, const size_t space_group_number )
+{
+    const double a = uniform( generator, 4.0, 20.0 );
+    const double b = uniform( generator, 4.0, 20.0 );
+    const double c = uniform( generator, 4.0, 20.0 );
+    Angle alpha = Angle::angle_90_degrees();
+    Angle beta = Angle::angle_90_degrees();
+    Angle gamma = Angle::angle_90_degrees();
+    if ( space_group_number < 16 )
+        beta = Angle::from_degrees( uniform( generator, 90.0, 120.0 ) );
+    if ( space_group_number < 3 )
+    {
+        alpha = Angle::from_degrees( uniform( generator, 75.0, 105.0 ) );
+        gamma = Angle::from_degrees( uniform( generator, 75.0, 105.0 ) );
+    }
+    return CrystalLattice( a, b, c, alpha, beta, gamma );
+}
+
+// An asymmetric unit of 2 to 8 atoms on general positions, with a mix of elements, occupancies and ADP types
+CrystalStructure random_asymmetric_unit( Xoshiro256StarStar & generator )
+{
+    const size_t space_group_numbers[] = { 1, 2, 4, 14, 15, 19, 61 };
+    const size_t space_group_number = space_group_numbers[ random_index( generator, 7 ) ];
+    const char * elements[] = { "H", "C", "N", "O", "S", "Cl" };
+    CrystalStructure result;
+    result.set_crystal_lattice( random_crystal_lattice( generator, space_group_number ) );
+    result.set_space_group( SpaceGroup::from_number( space_group_number ) );
+    const size_t natoms = 2 + random_index( generator, 7 );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        Atom atom( Element( elements[ random_index( generator, 6 ) ] ), Vector3D( generator.next_double(), generator.next_double(), generator.next_double() ), "X" + size_t2string( i + 1 ) );
+        if ( generator.next_double() < 0.3 )
+            atom.set_occupancy( uniform( generator, 0.5, 1.0 ) );
+        const double ADPs_type = generator.next_double();
+        if ( ADPs_type < 0.3 )
+            atom.set_Uiso( uniform( generator, 0.01, 0.08 ) );
+        else if ( ADPs_type < 0.6 )
+            atom.set_anisotropic_displacement_parameters( AnisotropicDisplacementParameters( SymmetricMatrix3D( uniform( generator, 0.02, 0.06 ),
+                                                                                                                  uniform( generator, 0.02, 0.06 ),
+                                                                                                                  uniform( generator, 0.02, 0.06 ),
+                                                                                                                  uniform( generator, -0.005, 0.005 ),
+                                                                                                                  uniform( generator, -0.005, 0.005 ),
+                                                                                                                  uniform( generator, -0.005, 0.005 ) ) ) );
+        result.add_atom( atom );
+    }
+    return result;
+}
+
+// Compares the optimised F^2 values of calculator with the reference ones for the unit cell
+void compare_structure_factors( PowderPatternCalculator & powder_pattern_calculator, const CrystalStructure & unit_cell, KernelComparison & comparison )
+{
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 40.0 ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    const ReflectionList reflection_list = powder_pattern_calculator.reflection_list();
+    double scale( 0.0 );
+    for ( size_t i( 0 ); i != reflection_list.size(); ++i )
+        scale = std::max( scale, reflection_list.F_squared( i ) );
+    if ( scale == 0.0 )
+        scale = 1.0;
+    for ( size_t i( 0 ); i != reflection_list.size(); ++i )
+    {
+        const double optimised = reflection_list.F_squared( i );
+        const double reference = reference_F_squared( unit_cell, reflection_list.miller_indices( i ), reflection_list.d_spacing( i ), powder_pattern_calculator.radiation_type() );
+        comparison.add( optimised, reference, std::abs( optimised - reference ) / scale );
+    }
+}
+
+double relative_error( const double optimised, const double reference )
+{
+    if ( reference == 0.0 )
+        return std::abs( optimised );
+    return std::abs( ( optimised - reference ) / reference );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+uint64_t ulp_distance( const double a, const double b )
+{
+    if ( std::isnan( a ) || std::isnan( b ) )
+        return std::numeric_limits< uint64_t >::max();
+    const int64_t ordered_a = ordered_bits( a );
+    const int64_t ordered_b = ordered_bits( b );
+    // Unsigned arithmetic, the difference can exceed the range of int64_t
+    return ( ordered_a < ordered_b ) ? static_cast< uint64_t >( ordered_b ) - static_cast< uint64_t >( ordered_a ) :
+                                       static_cast< uint64_t >( ordered_a ) - static_cast< uint64_t >( ordered_b );
+}
+
+// ********************************************************************************
+
+double reference_F_squared( const CrystalStructure & crystal_structure, const MillerIndices & miller_indices, const double d_spacing, const RadiationType radiation_type )
+{
+    const double sine_theta_over_lambda = 1.0 / ( 2.0 * d_spacing );
+    double cosine_term( 0.0 );
+    double sine_term( 0.0 );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        const Atom & atom = crystal_structure.atom( i );
+        const double f0 = atom.element().scattering_factor( sine_theta_over_lambda, radiation_type ) * atom.occupancy();
+        double T;
+        if ( atom.ADPs_type() == Atom::ANISOTROPIC )
+        {
+            const SymmetricMatrix3D U_star = atom.anisotropic_displacement_parameters().U_star( crystal_structure.crystal_lattice() );
+            const int h[3] = { miller_indices.h(), miller_indices.k(), miller_indices.l() };
+            double hUh( 0.0 );
+            for ( size_t j( 0 ); j != 3; ++j )
+            {
+                for ( size_t k( 0 ); k != 3; ++k )
+                    hUh += h[j] * U_star.value( j, k ) * h[k];
+            }
+            T = std::exp( -2.0 * square( CONSTANT_PI ) * hUh );
+        }
+        else
+        {
+            double U;
+            if ( atom.ADPs_type() == Atom::ISOTROPIC )
+                U = atom.Uiso();
+            else if ( atom.element().atomic_number() == 1 )
+                U = 0.06;
+            else
+                U = 0.05;
+            T = std::exp( -8.0 * square( CONSTANT_PI ) * U * square( sine_theta_over_lambda ) );
+        }
+        const double argument = 2.0 * CONSTANT_PI * ( miller_indices.h() * atom.position().x() + miller_indices.k() * atom.position().y() + miller_indices.l() * atom.position().z() );
+        cosine_term += T * f0 * std::cos( argument );
+        sine_term   += T * f0 * std::sin( argument );
+    }
+    return square( cosine_term ) + square( sine_term );
+}
+
+// ********************************************************************************
+
+double reference_weighted_cross_correlation( const double * lhs, const double * rhs, const size_t npoints, const int m )
+{
+    const int n = static_cast<int>( npoints );
+    double result( 0.0 );
+    for ( int i( 0 ); i != n; ++i )
+    {
+        for ( int j( 1 - m ); j != m; ++j )
+        {
+            if ( ( i + j < 0 ) || ( i + j >= n ) )
+                continue;
+            result += lhs[i] * ( 1.0 - static_cast<double>( std::abs( j ) ) / m ) * rhs[i+j];
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+double reference_shortest_distance2( const CrystalLattice & crystal_lattice, const Vector3D & lhs, const Vector3D & rhs, const int n )
+{
+    const Vector3D difference = rhs - lhs;
+    // Start from the image nearest to the origin in fractional coordinates, so that n only needs to cover the cell shape
+    const Vector3D start( difference.x() - std::floor( difference.x() + 0.5 ), difference.y() - std::floor( difference.y() + 0.5 ), difference.z() - std::floor( difference.z() + 0.5 ) );
+    double result = std::numeric_limits< double >::max();
+    for ( int i( -n ); i <= n; ++i )
+    {
+        for ( int j( -n ); j <= n; ++j )
+        {
+            for ( int k( -n ); k <= n; ++k )
+                result = std::min( result, crystal_lattice.fractional_to_orthogonal( start + Vector3D( i, j, k ) ).norm2() );
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+void KernelComparison::add( const double optimised, const double reference, const double error )
+{
+    ++ncomparisons_;
+    // Written such that a NaN error fails the comparison
+    if ( ! ( error <= maximum_error_ ) )
+        maximum_error_ = std::isnan( error ) ? std::numeric_limits< double >::infinity() : error;
+    maximum_ulp_distance_ = std::max( maximum_ulp_distance_, ulp_distance( optimised, reference ) );
+}
+
+// ********************************************************************************
+
+std::string KernelComparison::report() const
+{
+    std::ostringstream result;
+    result << name_ << ": " << ncomparisons_ << " comparisons, maximum error " << maximum_error_ << " (tolerance " << tolerance_ << "), maximum " << maximum_ulp_distance_ << " ULPs, " << ( passed() ? "OK" : "FAILED" );
+    return result.str();
+}
+
+// ********************************************************************************
+
+std::vector< KernelComparison > verify_kernels( const size_t ncases, const uint64_t seed )
+{
+    Xoshiro256StarStar generator( seed );
+    std::vector< KernelComparison > result( 5 );
+    KernelComparison & unit_cell_comparison = result[0];
+    KernelComparison & asymmetric_unit_comparison = result[1];
+    KernelComparison & peak_shape_comparison = result[2];
+    KernelComparison & cross_correlation_comparison = result[3];
+    KernelComparison & shortest_distance_comparison = result[4];
+    unit_cell_comparison.name_ = "structure factors (unit cell)";
+    unit_cell_comparison.tolerance_ = 1.0E-9;
+    asymmetric_unit_comparison.name_ = "structure factors (asymmetric unit)";
+    asymmetric_unit_comparison.tolerance_ = 1.0E-9;
+    peak_shape_comparison.name_ = "peak shape";
+    peak_shape_comparison.tolerance_ = 1.0E-5;
+    cross_correlation_comparison.name_ = "weighted_cross_correlation()";
+    cross_correlation_comparison.tolerance_ = 1.0E-10;
+    shortest_distance_comparison.name_ = "shortest_distance2()";
+    shortest_distance_comparison.tolerance_ = 1.0E-12;
+    for ( size_t c( 0 ); c != ncases; ++c )
+    {
+        // Structure factors
+        {
+        const CrystalStructure asymmetric_unit = random_asymmetric_unit( generator );
+        CrystalStructure unit_cell( asymmetric_unit );
+        unit_cell.apply_space_group_symmetry();
+        PowderPatternCalculator unit_cell_calculator( unit_cell );
+        compare_structure_factors( unit_cell_calculator, unit_cell, unit_cell_comparison );
+        PowderPatternCalculator asymmetric_unit_calculator( asymmetric_unit, PowderPatternCalculator::ASYMMETRIC_UNIT );
+        compare_structure_factors( asymmetric_unit_calculator, unit_cell, asymmetric_unit_comparison );
+        }
+        // Peak shape
+        {
+        const double FWHM = uniform( generator, 0.02, 0.5 );
+        const double eta = generator.next_double();
+        PseudoVoigtPeakShape peak_shape( FWHM, eta );
+        const double maximum = peak_shape.value( 0.0, FWHM, eta );
+        const double range = peak_shape.range( FWHM, eta );
+        for ( size_t i( 0 ); i != 100; ++i )
+        {
+            const double delta = uniform( generator, -range, range );
+            const double optimised = peak_shape.value( delta, FWHM, eta );
+            double reference;
+            double d_delta;
+            double d_FWHM;
+            peak_shape.value_and_derivatives( delta, FWHM, eta, reference, d_delta, d_FWHM );
+            peak_shape_comparison.add( optimised, reference, std::abs( optimised - reference ) / maximum );
+        }
+        }
+        // Weighted cross correlation, on positive intensities as for powder patterns
+        {
+        const size_t npoints = 200 + random_index( generator, 2000 );
+        const int m = 2 + static_cast<int>( random_index( generator, 100 ) );
+        std::vector< double > lhs( npoints );
+        std::vector< double > rhs( npoints );
+        for ( size_t i( 0 ); i != npoints; ++i )
+        {
+            lhs[i] = uniform( generator, 0.0, 1000.0 );
+            rhs[i] = uniform( generator, 0.0, 1000.0 );
+        }
+        const double optimised = weighted_cross_correlation( &lhs[0], &rhs[0], npoints, m );
+        const double reference = reference_weighted_cross_correlation( &lhs[0], &rhs[0], npoints, m );
+        cross_correlation_comparison.add( optimised, reference, relative_error( optimised, reference ) );
+        }
+        // Shortest distances, including coordinates outside the unit cell
+        {
+        const CrystalLattice crystal_lattice = random_crystal_lattice( generator, 1 );
+        for ( size_t i( 0 ); i != 100; ++i )
+        {
+            const Vector3D lhs( uniform( generator, -1.0, 2.0 ), uniform( generator, -1.0, 2.0 ), uniform( generator, -1.0, 2.0 ) );
+            const Vector3D rhs( uniform( generator, -1.0, 2.0 ), uniform( generator, -1.0, 2.0 ), uniform( generator, -1.0, 2.0 ) );
+            const double optimised = crystal_lattice.shortest_distance2( lhs, rhs );
+            const double reference = reference_shortest_distance2( crystal_lattice, lhs, rhs );
+            shortest_distance_comparison.add( optimised, reference, relative_error( optimised, reference ) );
+        }
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
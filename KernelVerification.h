@@ -0,0 +1,103 @@
+#ifndef KERNELVERIFICATION_H
+#define KERNELVERIFICATION_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalLattice;
+class CrystalStructure;
+class MillerIndices;
+class Vector3D;
+
+#include "Element.h"
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+  Reference implementations of the numeric kernels and a harness that runs them side by side with the optimised
+  implementations on random inputs, so that it can be shown that optimisations (vectorisation, batching, FFTs,
+  reordered sums) do not change the results beyond rounding.
+
+  The reference implementations are the straightforward textbook versions: slow, but short enough to be checked by eye.
+  They are part of the library rather than of the tests, so the comparison can also be run on a production machine
+  ("Fourier verify-kernels"), and PowderPatternCalculator can be switched to the reference structure-factor
+  summation at run time.
+
+  Each comparison reports the largest error, scaled as described for each kernel, and the largest distance in
+  units in the last place (ULPs). Only the scaled error is checked against the tolerance: sums of terms with
+  different signs lose relative accuracy in the small results, so a ULP limit would have to be meaninglessly large.
+*/
+
+// The number of representable doubles between a and b, 0 if a == b (including +0.0 and -0.0).
+uint64_t ulp_distance( const double a, const double b );
+
+// F^2 of one reflection, summed over all atoms with std::cos() and std::sin().
+// The crystal structure must contain the whole unit cell. Atoms without ADPs get Uiso = 0.05, or 0.06 for hydrogen,
+// as in PowderPatternCalculator.
+double reference_F_squared( const CrystalStructure & crystal_structure, const MillerIndices & miller_indices, const double d_spacing, const RadiationType radiation_type = X_RAYS );
+
+// weighted_cross_correlation( lhs, rhs, npoints, m ) as the double sum sum_i sum_j lhs[i] ( 1 - |j|/m ) rhs[i+j], |j| < m.
+double reference_weighted_cross_correlation( const double * lhs, const double * rhs, const size_t npoints, const int m );
+
+// CrystalLattice::shortest_distance2() by trying all lattice translations -n...n along each axis.
+double reference_shortest_distance2( const CrystalLattice & crystal_lattice, const Vector3D & lhs, const Vector3D & rhs, const int n = 3 );
+
+struct KernelComparison
+{
+    KernelComparison(): ncomparisons_(0), maximum_error_(0.0), maximum_ulp_distance_(0), tolerance_(0.0) {}
+
+    std::string name_;
+    size_t ncomparisons_;
+    double maximum_error_;
+    uint64_t maximum_ulp_distance_;
+    double tolerance_;
+
+    bool passed() const { return maximum_error_ <= tolerance_; }
+
+    // Updates the maxima, error is the scaled error.
+    void add( const double optimised, const double reference, const double error );
+
+    // One line: name, number of comparisons, maximum error, tolerance, maximum ULP distance, "OK" or "FAILED".
+    std::string report() const;
+};
+
+/*
+  Runs ncases random inputs per kernel, the same seed gives the same inputs:
+  - structure factors, UNIT_CELL and ASYMMETRIC_UNIT, random structures in a few space groups:
+    |F^2 - F^2(reference)| / ( largest F^2 of the pattern ), tolerance 1.0E-9
+  - the tabulated peak shape against the exact pseudo-Voigt: error relative to the peak maximum, tolerance 1.0E-5
+  - weighted_cross_correlation(): relative error, tolerance 1.0E-10
+  - CrystalLattice::shortest_distance2() for random cells: relative error, tolerance 1.0E-12
+*/
+std::vector< KernelComparison > verify_kernels( const size_t ncases = 20, const uint64_t seed = 1 );
+
+#endif // KERNELVERIFICATION_H
+
@@ -30,6 +30,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Utilities.h"
 
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
 namespace {
 
@@ -74,26 +76,203 @@ void LabelsAndShieldings::push_back( const std::string & label, const double shi
     }
     elements_.push_back( Element( element_string ) );
     shieldings_.push_back( shielding );
-    sorted_map_.push_back( size() - 1 );
+    sorted_map_.invalidate();
 }
 
 // ********************************************************************************
 
-void LabelsAndShieldings::sort() const
+const std::vector< size_t > & LabelsAndShieldings::sorted_map() const
 {
-    // We don't actually sort the lists, but create a sorted map
-    // We use std::sort() with a functor
-    std::sort( sorted_map_.begin(), sorted_map_.end(), Compare( elements_, shieldings_ ) );
+    return sorted_map_.get( [this]( std::vector< size_t > & result )
+    {
+        // We don't actually sort the lists, but create a sorted map
+        // We use std::sort() with a functor
+        result.resize( size() );
+        for ( size_t i( 0 ); i != size(); ++i )
+            result[i] = i;
+        std::sort( result.begin(), result.end(), Compare( elements_, shieldings_ ) );
+    } );
 }
 
 // ********************************************************************************
 
 void LabelsAndShieldings::save( const FileName & output_file_name ) const
 {
-    sort();
     TextFileWriter text_file_writer( output_file_name );
     for ( size_t i( 0 ); i != size(); ++i )
         text_file_writer.write_line( label(i) + " " + double2string( shielding(i) ) );
 }
 
 // ********************************************************************************
+// ********************************************************************************
+// ********************************************************************************
+
+ShieldingTable::ShieldingTable( const std::vector< std::string > & labels ):
+labels_(labels),
+values_(labels.size())
+{
+    label_indices_.reserve( labels_.size() );
+    for ( size_t i( 0 ); i != labels_.size(); ++i )
+    {
+        if ( ! label_indices_.insert( std::make_pair( labels_[i], i ) ).second )
+            throw std::runtime_error( "ShieldingTable::ShieldingTable(): duplicate label " + labels_[i] );
+    }
+}
+
+// ********************************************************************************
+
+size_t ShieldingTable::label_index( const std::string & label ) const
+{
+    std::unordered_map< std::string, size_t >::const_iterator it = label_indices_.find( label );
+    if ( it == label_indices_.end() )
+        throw std::runtime_error( "ShieldingTable::label_index(): label not found: " + label );
+    return it->second;
+}
+
+// ********************************************************************************
+
+void ShieldingTable::add_structure( const std::string & name, const std::vector< double > & shieldings )
+{
+    if ( shieldings.size() != nlabels() )
+        throw std::runtime_error( "ShieldingTable::add_structure(): number of shieldings does not match number of labels." );
+    structure_names_.push_back( name );
+    for ( size_t i( 0 ); i != nlabels(); ++i )
+        values_[i].push_back( shieldings[i] );
+}
+
+// ********************************************************************************
+
+void ShieldingTable::add_structure( const std::string & name, const LabelsAndShieldings & labels_and_shieldings )
+{
+    if ( labels_and_shieldings.size() != nlabels() )
+        throw std::runtime_error( "ShieldingTable::add_structure(): number of shieldings does not match number of labels for " + name );
+    std::vector< double > shieldings( nlabels() );
+    std::vector< bool > found( nlabels(), false );
+    for ( size_t i( 0 ); i != labels_and_shieldings.size(); ++i )
+    {
+        size_t iLabel = label_index( labels_and_shieldings.label( i ) );
+        if ( found[iLabel] )
+            throw std::runtime_error( "ShieldingTable::add_structure(): duplicate label " + labels_and_shieldings.label( i ) + " in " + name );
+        found[iLabel] = true;
+        shieldings[iLabel] = labels_and_shieldings.shielding( i );
+    }
+    add_structure( name, shieldings );
+}
+
+// ********************************************************************************
+
+void ShieldingTable::scale( const double slope, const double intercept )
+{
+    scale( 0, nstructures(), slope, intercept );
+}
+
+// ********************************************************************************
+
+void ShieldingTable::scale( const size_t first, const size_t n, const double slope, const double intercept )
+{
+    if ( first + n > nstructures() )
+        throw std::runtime_error( "ShieldingTable::scale(): range exceeds the number of structures." );
+    for ( size_t i( 0 ); i != nlabels(); ++i )
+    {
+        double * values = n ? &values_[i][first] : 0;
+        for ( size_t j( 0 ); j != n; ++j )
+            values[j] = slope * values[j] + intercept;
+    }
+}
+
+// ********************************************************************************
+
+void ShieldingTable::match( const LabelsAndShieldings & measured, std::vector< size_t > & rows, std::vector< double > & values ) const
+{
+    rows.clear();
+    values.clear();
+    for ( size_t i( 0 ); i != measured.size(); ++i )
+    {
+        std::unordered_map< std::string, size_t >::const_iterator it = label_indices_.find( measured.label( i ) );
+        if ( it == label_indices_.end() )
+            continue;
+        rows.push_back( it->second );
+        values.push_back( measured.shielding( i ) );
+    }
+}
+
+// ********************************************************************************
+
+std::vector< double > ShieldingTable::RMSDs( const LabelsAndShieldings & measured ) const
+{
+    std::vector< size_t > rows;
+    std::vector< double > measured_values;
+    match( measured, rows, measured_values );
+    if ( rows.empty() )
+        throw std::runtime_error( "ShieldingTable::RMSDs(): no labels in common." );
+    const size_t ns = nstructures();
+    std::vector< double > result( ns, 0.0 );
+    double * sums = ns ? &result[0] : 0;
+    // One pass over each row, accumulating all structures at once
+    for ( size_t i( 0 ); i != rows.size(); ++i )
+    {
+        const double * values = ns ? &values_[ rows[i] ][0] : 0;
+        const double m = measured_values[i];
+        for ( size_t j( 0 ); j != ns; ++j )
+        {
+            const double difference = values[j] - m;
+            sums[j] += difference * difference;
+        }
+    }
+    const double n = static_cast<double>( rows.size() );
+    for ( size_t j( 0 ); j != ns; ++j )
+        result[j] = std::sqrt( result[j] / n );
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< double > ShieldingTable::RMSDs_after_linear_fit( const LabelsAndShieldings & measured ) const
+{
+    std::vector< size_t > rows;
+    std::vector< double > measured_values;
+    match( measured, rows, measured_values );
+    if ( rows.size() < 2 )
+        throw std::runtime_error( "ShieldingTable::RMSDs_after_linear_fit(): fewer than two labels in common." );
+    const double n = static_cast<double>( rows.size() );
+    // The measured values are centred, which keeps the sums small
+    double mean_measured( 0.0 );
+    for ( size_t i( 0 ); i != measured_values.size(); ++i )
+        mean_measured += measured_values[i];
+    mean_measured /= n;
+    double syy( 0.0 );
+    for ( size_t i( 0 ); i != measured_values.size(); ++i )
+    {
+        measured_values[i] -= mean_measured;
+        syy += measured_values[i] * measured_values[i];
+    }
+    const size_t ns = nstructures();
+    std::vector< double > sx( ns, 0.0 );
+    std::vector< double > sxx( ns, 0.0 );
+    std::vector< double > sxy( ns, 0.0 );
+    for ( size_t i( 0 ); i != rows.size(); ++i )
+    {
+        const double * values = ns ? &values_[ rows[i] ][0] : 0;
+        const double m = measured_values[i];
+        for ( size_t j( 0 ); j != ns; ++j )
+        {
+            sx[j]  += values[j];
+            sxx[j] += values[j] * values[j];
+            sxy[j] += values[j] * m;
+        }
+    }
+    // Because the centred measured values sum to zero, sxy is already the centred cross product
+    std::vector< double > result( ns );
+    for ( size_t j( 0 ); j != ns; ++j )
+    {
+        const double cxx = sxx[j] - sx[j] * sx[j] / n;
+        double residual = syy;
+        if ( cxx > 0.0 )
+            residual -= sxy[j] * sxy[j] / cxx;
+        result[j] = std::sqrt( std::max( residual, 0.0 ) / n );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
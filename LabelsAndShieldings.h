@@ -31,10 +31,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 class FileName;
 
 #include "Element.h"
+#include "LazyCache.h"
 
-#include <vector>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+// The pairs are returned sorted by element, then by shielding in descending order. The sorting is done when first needed and is thread-safe.
 class LabelsAndShieldings
 {
 public:
@@ -48,8 +51,8 @@ public:
 
     // The index is zero-based
     // We don't actually sort the lists, but create a sorted map
-    std::string label(     const size_t i ) const { return labels_[ sorted_map_[i] ]; }
-    double      shielding( const size_t i ) const { return shieldings_[ sorted_map_[i] ]; }
+    std::string label(     const size_t i ) const { return labels_[ sorted_map()[i] ]; }
+    double      shielding( const size_t i ) const { return shieldings_[ sorted_map()[i] ]; }
 
 
     // For debugging
@@ -62,11 +65,72 @@ private:
     std::vector< Element > elements_;
     std::vector< double > shieldings_;
     // We don't actually sort the lists, but create a sorted map
-    mutable std::vector< size_t > sorted_map_;
+    LazyCache< std::vector< size_t > > sorted_map_;
 
     // We don't actually sort the lists, but create a sorted map
     // We sort first by element, then by shieldings in descending order
-    void sort() const;
+    const std::vector< size_t > & sorted_map() const;
+};
+
+/*
+  The shieldings of many structures of the same molecule, e.g. GIPAW calculations on thousands of polymorphs.
+
+  The rows are the labels, which are fixed at construction and indexed once. The columns are the structures.
+  The shieldings are stored per label, contiguous over the structures, so that the transforms and the RMSDs
+  are simple loops that the compiler can vectorise.
+*/
+class ShieldingTable
+{
+public:
+
+    // Throws if a label occurs more than once.
+    explicit ShieldingTable( const std::vector< std::string > & labels );
+
+    size_t nlabels() const { return labels_.size(); }
+    size_t nstructures() const { return structure_names_.size(); }
+
+    const std::string & label( const size_t i ) const { return labels_[i]; }
+    const std::string & structure_name( const size_t i ) const { return structure_names_[i]; }
+
+    // Throws if the label is not in the table.
+    size_t label_index( const std::string & label ) const;
+
+    // The shieldings must be in the order of the labels of the table.
+    void add_structure( const std::string & name, const std::vector< double > & shieldings );
+
+    // Throws unless every label of the table occurs exactly once; the order does not matter.
+    void add_structure( const std::string & name, const LabelsAndShieldings & labels_and_shieldings );
+
+    double shielding( const size_t structure, const size_t label ) const { return values_[label][structure]; }
+
+    // The values of one label for all structures.
+    const std::vector< double > & row( const size_t label ) const { return values_[label]; }
+
+    // sigma := slope * sigma + intercept for all values.
+    // Referencing, delta = sigma_ref - sigma, is scale( -1.0, sigma_ref ).
+    void scale( const double slope, const double intercept );
+
+    // As above, only for the structures first ... first + n - 1, e.g. for a structure that has been calculated with different settings.
+    void scale( const size_t first, const size_t n, const double slope, const double intercept );
+
+    // The root-mean-square deviation between the measured values and the values of each structure.
+    // Only the labels that are present in measured are used, measured can contain labels that are not in the table.
+    // Throws if no labels are in common.
+    std::vector< double > RMSDs( const LabelsAndShieldings & measured ) const;
+
+    // As above, but for each structure the calculated values are first mapped onto the measured values with their own least-squares
+    // slope and intercept ( measured = intercept + slope * calculated ), which is how calculated shieldings are normally
+    // referenced against experiment. Throws if fewer than two labels are in common.
+    std::vector< double > RMSDs_after_linear_fit( const LabelsAndShieldings & measured ) const;
+
+private:
+    std::vector< std::string > labels_;
+    std::unordered_map< std::string, size_t > label_indices_;
+    std::vector< std::string > structure_names_;
+    std::vector< std::vector< double > > values_; // values_[label][structure]
+
+    // The row indices and the measured values of the labels that measured has in common with the table.
+    void match( const LabelsAndShieldings & measured, std::vector< size_t > & rows, std::vector< double > & values ) const;
 };
 
 #endif // LABELSANDSHIELDINGS_H
@@ -0,0 +1,225 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "LatticeIndex.h"
+#include "CrystalLattice.h"
+#include "MathFunctions.h"
+#include "NiggliReduction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// ********************************************************************************
+
+LatticeIndex::LatticeIndex():
+nlattices_(0)
+{
+    tree_.value().root_ = no_node;
+    tree_.set_valid();
+}
+
+// ********************************************************************************
+
+void LatticeIndex::reserve( const size_t nlattices )
+{
+    G6s_.reserve( 6 * nlattices );
+}
+
+// ********************************************************************************
+
+void LatticeIndex::push_back( const CrystalLattice & crystal_lattice )
+{
+    std::vector< double > result = reduced_G6( crystal_lattice );
+    G6s_.insert( G6s_.end(), result.begin(), result.end() );
+    ++nlattices_;
+    tree_.invalidate();
+}
+
+// ********************************************************************************
+
+std::vector< double > LatticeIndex::G6( const size_t i ) const
+{
+    if ( i >= nlattices_ )
+        throw std::runtime_error( "LatticeIndex::G6(): index out of range." );
+    return std::vector< double >( G6s_.begin() + 6 * i, G6s_.begin() + 6 * ( i + 1 ) );
+}
+
+// ********************************************************************************
+
+std::vector< size_t > LatticeIndex::find_nearest( const CrystalLattice & crystal_lattice, const size_t k, std::vector< double > & distances ) const
+{
+    std::vector< size_t > result;
+    distances.clear();
+    if ( ( k == 0 ) || ( nlattices_ == 0 ) )
+        return result;
+    const Tree & tree = this->tree();
+    std::vector< double > query = reduced_G6( crystal_lattice );
+    std::vector< std::pair< double, size_t > > heap;
+    heap.reserve( k + 1 );
+    search( tree, tree.root_, &query[0], k, heap );
+    std::sort_heap( heap.begin(), heap.end() );
+    result.reserve( heap.size() );
+    distances.reserve( heap.size() );
+    for ( size_t i( 0 ); i != heap.size(); ++i )
+    {
+        result.push_back( heap[i].second );
+        distances.push_back( heap[i].first );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< size_t > LatticeIndex::find_within( const CrystalLattice & crystal_lattice, const double radius ) const
+{
+    std::vector< size_t > result;
+    if ( nlattices_ == 0 )
+        return result;
+    const Tree & tree = this->tree();
+    std::vector< double > query = reduced_G6( crystal_lattice );
+    search( tree, tree.root_, &query[0], radius, result );
+    std::sort( result.begin(), result.end() );
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< double > LatticeIndex::reduced_G6( const CrystalLattice & crystal_lattice ) const
+{
+    return G6_vector( Niggli_reduce( crystal_lattice ) );
+}
+
+// ********************************************************************************
+
+double LatticeIndex::distance( const double * lhs, const double * rhs ) const
+{
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != 6; ++i )
+        result += square( lhs[i] - rhs[i] );
+    return std::sqrt( result );
+}
+
+// ********************************************************************************
+
+const LatticeIndex::Tree & LatticeIndex::tree() const
+{
+    return tree_.get( [this]( Tree & tree )
+    {
+        tree.nodes_.clear();
+        tree.nodes_.reserve( nlattices_ );
+        std::vector< size_t > lattices( nlattices_ );
+        for ( size_t i( 0 ); i != nlattices_; ++i )
+            lattices[i] = i;
+        tree.root_ = build_tree( tree, lattices, 0, nlattices_ );
+    } );
+}
+
+// ********************************************************************************
+
+size_t LatticeIndex::build_tree( Tree & tree, std::vector< size_t > & lattices, const size_t begin, const size_t end ) const
+{
+    if ( begin == end )
+        return no_node;
+    const size_t node = tree.nodes_.size();
+    Node new_node;
+    new_node.lattice = lattices[begin];
+    new_node.threshold = 0.0;
+    new_node.inner = no_node;
+    new_node.outer = no_node;
+    tree.nodes_.push_back( new_node );
+    if ( end - begin == 1 )
+        return node;
+    // The first lattice is the vantage point, the others are split at the median distance
+    const double * vantage_point = &G6s_[ 6 * lattices[begin] ];
+    const size_t median = ( begin + 1 + end ) / 2;
+    std::nth_element( lattices.begin() + begin + 1, lattices.begin() + median, lattices.begin() + end,
+                      [&]( const size_t lhs, const size_t rhs ) { return distance( vantage_point, &G6s_[ 6 * lhs ] ) <
+                                                                           distance( vantage_point, &G6s_[ 6 * rhs ] ); } );
+    const double threshold = distance( vantage_point, &G6s_[ 6 * lattices[median] ] );
+    const size_t inner = build_tree( tree, lattices, begin + 1, median );
+    const size_t outer = build_tree( tree, lattices, median, end );
+    // nodes_ may have been reallocated
+    tree.nodes_[node].threshold = threshold;
+    tree.nodes_[node].inner = inner;
+    tree.nodes_[node].outer = outer;
+    return node;
+}
+
+// ********************************************************************************
+
+void LatticeIndex::search( const Tree & tree, const size_t node, const double * query, const size_t k, std::vector< std::pair< double, size_t > > & heap ) const
+{
+    if ( node == no_node )
+        return;
+    const Node & current = tree.nodes_[node];
+    const double d = distance( query, &G6s_[ 6 * current.lattice ] );
+    if ( heap.size() < k )
+    {
+        heap.push_back( std::make_pair( d, current.lattice ) );
+        std::push_heap( heap.begin(), heap.end() );
+    }
+    else if ( d < heap.front().first )
+    {
+        std::pop_heap( heap.begin(), heap.end() );
+        heap.back() = std::make_pair( d, current.lattice );
+        std::push_heap( heap.begin(), heap.end() );
+    }
+    if ( d < current.threshold )
+    {
+        search( tree, current.inner, query, k, heap );
+        if ( ( heap.size() < k ) || ( d + heap.front().first >= current.threshold ) )
+            search( tree, current.outer, query, k, heap );
+    }
+    else
+    {
+        search( tree, current.outer, query, k, heap );
+        if ( ( heap.size() < k ) || ( d - heap.front().first <= current.threshold ) )
+            search( tree, current.inner, query, k, heap );
+    }
+}
+
+// ********************************************************************************
+
+void LatticeIndex::search( const Tree & tree, const size_t node, const double * query, const double radius, std::vector< size_t > & result ) const
+{
+    if ( node == no_node )
+        return;
+    const Node & current = tree.nodes_[node];
+    const double d = distance( query, &G6s_[ 6 * current.lattice ] );
+    if ( d <= radius )
+        result.push_back( current.lattice );
+    // The inner subtree has distances to the vantage point <= threshold, the outer subtree >= threshold
+    if ( d - radius <= current.threshold )
+        search( tree, current.inner, query, radius, result );
+    if ( d + radius >= current.threshold )
+        search( tree, current.outer, query, radius, result );
+}
+
+// ********************************************************************************
+
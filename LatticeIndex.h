@@ -0,0 +1,100 @@
+#ifndef LATTICEINDEX_H
+#define LATTICEINDEX_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalLattice;
+
+#include "LazyCache.h"
+
+#include <cstddef> // For definition of size_t
+#include <utility>
+#include <vector>
+
+/*
+  An index for finding similar unit cells in a large collection, e.g. to deduplicate a crystal structure prediction
+  landscape or to match a unit cell against a database.
+
+  Each lattice is Niggli reduced and stored as its G6 vector in a vantage-point tree with the Euclidean G6 distance (in A^2),
+  so a query costs O( log N ) distance calculations instead of O( N ) reductions and comparisons.
+  Lattices must be primitive.
+*/
+class LatticeIndex
+{
+public:
+
+    LatticeIndex();
+
+    void reserve( const size_t nlattices );
+
+    // The lattices are numbered in the order in which they are added.
+    void push_back( const CrystalLattice & crystal_lattice );
+
+    size_t size() const { return nlattices_; }
+
+    // G6 vector of the Niggli-reduced lattice i
+    std::vector< double > G6( const size_t i ) const;
+
+    // Returns the numbers of the k most similar lattices, most similar first. distances are the corresponding G6 distances.
+    std::vector< size_t > find_nearest( const CrystalLattice & crystal_lattice, const size_t k, std::vector< double > & distances ) const;
+
+    // Returns the numbers of all lattices with a G6 distance less than or equal to radius, in ascending order.
+    std::vector< size_t > find_within( const CrystalLattice & crystal_lattice, const double radius ) const;
+
+private:
+    static const size_t no_node = static_cast< size_t >( -1 );
+
+    struct Node
+    {
+        size_t lattice;
+        double threshold; // Distance to the vantage point that separates the inner from the outer subtree
+        size_t inner;     // no_node if there is no subtree
+        size_t outer;
+    };
+
+    size_t nlattices_;
+    std::vector< double > G6s_; // nlattices_ x 6
+    // The tree is built when it is first needed after lattices have been added, thread-safe
+    struct Tree
+    {
+        std::vector< Node > nodes_;
+        size_t root_;
+    };
+    LazyCache< Tree > tree_;
+
+    std::vector< double > reduced_G6( const CrystalLattice & crystal_lattice ) const;
+    double distance( const double * lhs, const double * rhs ) const;
+    const Tree & tree() const;
+    size_t build_tree( Tree & tree, std::vector< size_t > & lattices, const size_t begin, const size_t end ) const;
+    // heap is a max-heap of ( distance, lattice ) with at most k entries
+    void search( const Tree & tree, const size_t node, const double * query, const size_t k, std::vector< std::pair< double, size_t > > & heap ) const;
+    void search( const Tree & tree, const size_t node, const double * query, const double radius, std::vector< size_t > & result ) const;
+};
+
+#endif // LATTICEINDEX_H
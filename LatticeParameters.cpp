@@ -0,0 +1,189 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "LatticeParameters.h"
+#include "CrystalLattice.h"
+#include "MathFunctions.h"
+#include "MillerIndices.h"
+
+#include <cmath>
+
+// ********************************************************************************
+
+LatticeParameters::LatticeParameters():
+a_(10.0), b_(10.0), c_(10.0),
+alpha_(Angle::angle_90_degrees()), beta_(Angle::angle_90_degrees()), gamma_(Angle::angle_90_degrees())
+{
+}
+
+// ********************************************************************************
+
+LatticeParameters::LatticeParameters( const double a, const double b, const double c, const Angle alpha, const Angle beta, const Angle gamma ):
+a_(a), b_(b), c_(c),
+alpha_(alpha), beta_(beta), gamma_(gamma)
+{
+}
+
+// ********************************************************************************
+
+LatticeParameters::LatticeParameters( const CrystalLattice & crystal_lattice ):
+a_(crystal_lattice.a()), b_(crystal_lattice.b()), c_(crystal_lattice.c()),
+alpha_(crystal_lattice.alpha()), beta_(crystal_lattice.beta()), gamma_(crystal_lattice.gamma())
+{
+}
+
+// ********************************************************************************
+
+void LatticeParameters::set_parameters( const double a, const double b, const double c, const Angle alpha, const Angle beta, const Angle gamma )
+{
+    a_ = a;
+    b_ = b;
+    c_ = c;
+    alpha_ = alpha;
+    beta_ = beta;
+    gamma_ = gamma;
+}
+
+// ********************************************************************************
+
+void LatticeParameters::set_metric_tensor( const SymmetricMatrix3D & metric_tensor )
+{
+    const double a = sqrt( metric_tensor.value( 0, 0 ) );
+    const double b = sqrt( metric_tensor.value( 1, 1 ) );
+    const double c = sqrt( metric_tensor.value( 2, 2 ) );
+    set_parameters( a, b, c, arccosine( metric_tensor.value( 1, 2 ) / ( b * c ) ),
+                             arccosine( metric_tensor.value( 0, 2 ) / ( a * c ) ),
+                             arccosine( metric_tensor.value( 0, 1 ) / ( a * b ) ) );
+}
+
+// ********************************************************************************
+
+double LatticeParameters::volume() const
+{
+    const double cos_alpha = alpha_.cosine();
+    const double cos_beta  = beta_.cosine();
+    const double cos_gamma = gamma_.cosine();
+    return a_ * b_ * c_ * sqrt( 1.0 - square( cos_alpha ) - square( cos_beta ) - square( cos_gamma ) + 2.0 * cos_alpha * cos_beta * cos_gamma );
+}
+
+// ********************************************************************************
+
+double LatticeParameters::inverse_d_squared( const MillerIndices & miller_indices ) const
+{
+    const SymmetricMatrix3D G_star = reciprocal_metric_tensor();
+    const double h = miller_indices.h();
+    const double k = miller_indices.k();
+    const double l = miller_indices.l();
+    return h * h * G_star.value( 0, 0 ) + k * k * G_star.value( 1, 1 ) + l * l * G_star.value( 2, 2 ) +
+           2.0 * ( h * k * G_star.value( 0, 1 ) + h * l * G_star.value( 0, 2 ) + k * l * G_star.value( 1, 2 ) );
+}
+
+// ********************************************************************************
+
+void LatticeParameters::apply_strain( const SymmetricMatrix3D & strain )
+{
+    // G' = A^T ( 1 + strain )^T ( 1 + strain ) A
+    Matrix3D deformation( 1.0 );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+            deformation.set_value( i, j, deformation.value( i, j ) + strain.value( i, j ) );
+    }
+    const Matrix3D deformed_basis = deformation * fractional_to_orthogonal_matrix();
+    double G[3][3];
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( i ); j != 3; ++j )
+        {
+            G[i][j] = 0.0;
+            for ( size_t k( 0 ); k != 3; ++k )
+                G[i][j] += deformed_basis.value( k, i ) * deformed_basis.value( k, j );
+        }
+    }
+    set_metric_tensor( SymmetricMatrix3D( G[0][0], G[1][1], G[2][2], G[0][1], G[0][2], G[1][2] ) );
+}
+
+// ********************************************************************************
+
+CrystalLattice LatticeParameters::crystal_lattice() const
+{
+    return CrystalLattice( a_, b_, c_, alpha_, beta_, gamma_ );
+}
+
+// ********************************************************************************
+
+SymmetricMatrix3D LatticeParameters::metric_tensor() const
+{
+    return SymmetricMatrix3D( a_ * a_, b_ * b_, c_ * c_, a_ * b_ * gamma_.cosine(), a_ * c_ * beta_.cosine(), b_ * c_ * alpha_.cosine() );
+}
+
+// ********************************************************************************
+
+SymmetricMatrix3D LatticeParameters::reciprocal_metric_tensor() const
+{
+    SymmetricMatrix3D result = metric_tensor();
+    result.invert();
+    return result;
+}
+
+// ********************************************************************************
+
+Matrix3D LatticeParameters::fractional_to_orthogonal_matrix() const
+{
+    double b_x, b_y, c_x, c_y, c_z;
+    basis_vectors( b_x, b_y, c_x, c_y, c_z );
+    return Matrix3D(  a_, b_x, c_x,
+                     0.0, b_y, c_y,
+                     0.0, 0.0, c_z );
+}
+
+// ********************************************************************************
+
+Matrix3D LatticeParameters::orthogonal_to_fractional_matrix() const
+{
+    double b_x, b_y, c_x, c_y, c_z;
+    basis_vectors( b_x, b_y, c_x, c_y, c_z );
+    // The inverse of an upper triangular matrix
+    return Matrix3D( 1.0 / a_, -b_x / ( a_ * b_y ), ( b_x * c_y - b_y * c_x ) / ( a_ * b_y * c_z ),
+                          0.0,        1.0 / b_y,                          -c_y / ( b_y * c_z ),
+                          0.0,              0.0,                                    1.0 / c_z );
+}
+
+// ********************************************************************************
+
+void LatticeParameters::basis_vectors( double & b_x, double & b_y, double & c_x, double & c_y, double & c_z ) const
+{
+    // As in CrystalLattice: a along x, b in the xy plane
+    b_x = b_ * gamma_.cosine();
+    b_y = b_ * gamma_.sine();
+    c_x = c_ * beta_.cosine();
+    c_y = ( b_ * c_ * alpha_.cosine() - b_x * c_x ) / b_y;
+    c_z = sqrt( square( c_ ) - square( c_x ) - square( c_y ) );
+}
+
+// ********************************************************************************
+
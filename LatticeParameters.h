@@ -0,0 +1,104 @@
+#ifndef LATTICEPARAMETERS_H
+#define LATTICEPARAMETERS_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalLattice;
+class MillerIndices;
+
+#include "Angle.h"
+#include "Matrix3D.h"
+#include "SymmetricMatrix3D.h"
+
+/*
+  The six unit-cell parameters without the derived quantities that a CrystalLattice calculates in its constructor,
+  for code that handles very many lattices, e.g. lattice scans and cell-deformation searches, but needs little from each.
+
+  Only the six parameters are stored: sizeof( LatticeParameters ) is six doubles, 48 bytes, against several hundred for a CrystalLattice,
+  and copying one is copying those six doubles. Nothing is cached: volume(), the metric tensors and the conversion matrices are
+  calculated from the parameters each time they are called, so code that needs one of them repeatedly should keep the result.
+  The conventions are those of CrystalLattice: a along x, b in the xy plane. None of this allocates memory.
+*/
+class LatticeParameters
+{
+public:
+
+    // a = b = c = 10.0 A, all angles 90 degrees, as CrystalLattice().
+    LatticeParameters();
+
+    LatticeParameters( const double a, const double b, const double c, const Angle alpha, const Angle beta, const Angle gamma );
+
+    explicit LatticeParameters( const CrystalLattice & crystal_lattice );
+
+    double a() const { return a_; }
+    double b() const { return b_; }
+    double c() const { return c_; }
+    Angle alpha() const { return alpha_; }
+    Angle beta()  const { return beta_; }
+    Angle gamma() const { return gamma_; }
+
+    void set_parameters( const double a, const double b, const double c, const Angle alpha, const Angle beta, const Angle gamma );
+
+    // G, G_ij = a_i . a_j
+    SymmetricMatrix3D metric_tensor() const;
+
+    // Sets the parameters from G, e.g. after a step in the elements of G.
+    void set_metric_tensor( const SymmetricMatrix3D & metric_tensor );
+
+    // G* = G^-1
+    SymmetricMatrix3D reciprocal_metric_tensor() const;
+
+    Matrix3D fractional_to_orthogonal_matrix() const;
+    Matrix3D orthogonal_to_fractional_matrix() const;
+
+    double volume() const;
+
+    // 1/d^2 = h G* h^T.
+    double inverse_d_squared( const MillerIndices & miller_indices ) const;
+
+    // Deforms the lattice in place by a strain tensor in the Cartesian frame: a_i' = ( 1 + strain ) a_i.
+    // The parameters are recalculated from the deformed basis vectors, so the new lattice is again in the standard orientation.
+    void apply_strain( const SymmetricMatrix3D & strain );
+
+    // Calculates all derived quantities.
+    CrystalLattice crystal_lattice() const;
+
+private:
+    double a_;
+    double b_;
+    double c_;
+    Angle alpha_;
+    Angle beta_;
+    Angle gamma_;
+
+    // The Cartesian components of b and c that are not trivially zero.
+    void basis_vectors( double & b_x, double & b_y, double & c_x, double & c_y, double & c_z ) const;
+};
+
+#endif // LATTICEPARAMETERS_H
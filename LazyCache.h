@@ -0,0 +1,106 @@
+#ifndef LAZYCACHE_H
+#define LAZYCACHE_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <atomic>
+#include <mutex>
+
+/*
+  Thread safety in this library follows the convention of the standard library: any number of threads can call const
+  member functions of the same object at the same time, e.g. the threads of parallel_for() can share one CrystalStructure
+  without copying it, but a non-const member function must not run at the same time as any other member function of that object.
+  Exceptions are documented with the class; objects that read from a stream, such as TextFileReader, always belong to one thread.
+
+  A class that calculates something in a const member function when it is first needed, e.g. a sorted map or a search tree,
+  keeps the result in a LazyCache so that concurrent readers do not race. The value is calculated once, under a lock;
+  afterwards, reading it costs one atomic load.
+
+      const std::vector< size_t > & sorted_map() const
+      {
+          return sorted_map_.get( [this]( std::vector< size_t > & result ) { result = sort( values_ ); } );
+      }
+*/
+template< class T >
+class LazyCache
+{
+public:
+
+    LazyCache(): value_(), is_valid_(false) {}
+
+    LazyCache( const LazyCache & rhs ): value_(), is_valid_(false)
+    {
+        std::lock_guard< std::mutex > lock( rhs.mutex_ );
+        value_ = rhs.value_;
+        is_valid_.store( rhs.is_valid_.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+    }
+
+    LazyCache & operator=( const LazyCache & rhs )
+    {
+        if ( this != &rhs )
+        {
+            std::lock_guard< std::mutex > lock( rhs.mutex_ );
+            value_ = rhs.value_;
+            is_valid_.store( rhs.is_valid_.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+        }
+        return *this;
+    }
+
+    // Thread-safe. If the value is not valid, calculate( T & ) is called first, it must overwrite the old value completely.
+    template< class Calculate >
+    const T & get( Calculate calculate ) const
+    {
+        if ( ! is_valid_.load( std::memory_order_acquire ) )
+        {
+            std::lock_guard< std::mutex > lock( mutex_ );
+            if ( ! is_valid_.load( std::memory_order_relaxed ) )
+            {
+                calculate( value_ );
+                is_valid_.store( true, std::memory_order_release );
+            }
+        }
+        return value_;
+    }
+
+    bool is_valid() const { return is_valid_.load( std::memory_order_acquire ); }
+
+    // For the non-const member functions of the owner, which have exclusive access anyway: invalidate() when the object changes,
+    // or change value() along with the object and set_valid().
+    void invalidate() { is_valid_.store( false, std::memory_order_relaxed ); }
+    T & value() { return value_; }
+    void set_valid() { is_valid_.store( true, std::memory_order_relaxed ); }
+
+private:
+    mutable T value_;
+    mutable std::atomic< bool > is_valid_;
+    mutable std::mutex mutex_;
+};
+
+#endif // LAZYCACHE_H
+
@@ -0,0 +1,153 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Logger.h"
+#include "Utilities.h"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+
+// The buffer is written out once it is larger than this.
+const size_t buffer_capacity = 64 * 1024;
+
+} // namespace
+
+// ********************************************************************************
+
+Logger & Logger::instance()
+{
+    static Logger logger( std::cout );
+    return logger;
+}
+
+// ********************************************************************************
+
+Logger::Logger( std::ostream & sink, const Level level ):
+sink_(&sink),
+level_(level),
+flush_interval_(1.0),
+last_flush_( std::chrono::steady_clock::now() )
+{
+    buffer_.reserve( buffer_capacity + 1024 );
+}
+
+// ********************************************************************************
+
+Logger::~Logger()
+{
+    flush();
+}
+
+// ********************************************************************************
+
+void Logger::set_flush_interval( const double seconds )
+{
+    if ( seconds < 0.0 )
+        throw std::runtime_error( "Logger::set_flush_interval(): interval must be non-negative." );
+    std::lock_guard< std::mutex > lock( mutex_ );
+    flush_interval_ = seconds;
+}
+
+// ********************************************************************************
+
+void Logger::log( const Level level, const std::string & message )
+{
+    if ( ! is_enabled( level ) )
+        return;
+    std::lock_guard< std::mutex > lock( mutex_ );
+    buffer_ += message;
+    buffer_ += '\n';
+    // Errors usually precede the end of the program, so they are not held back.
+    if ( ( level == ERROR ) ||
+         ( buffer_.size() > buffer_capacity ) ||
+         ( std::chrono::duration< double >( std::chrono::steady_clock::now() - last_flush_ ).count() >= flush_interval_ ) )
+        write_buffer();
+}
+
+// ********************************************************************************
+
+void Logger::flush()
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    write_buffer();
+}
+
+// ********************************************************************************
+
+void Logger::write_buffer()
+{
+    if ( ! buffer_.empty() )
+    {
+        sink_->write( buffer_.data(), buffer_.size() );
+        sink_->flush();
+        buffer_.clear();
+    }
+    last_flush_ = std::chrono::steady_clock::now();
+}
+
+// ********************************************************************************
+// ********************************************************************************
+// ********************************************************************************
+
+ProgressReporter::ProgressReporter( const std::string & description, const size_t nitems, const double interval, Logger & logger ):
+description_(description),
+nitems_(nitems),
+interval_( std::chrono::duration_cast< std::chrono::steady_clock::duration >( std::chrono::duration< double >( interval ) ) ),
+logger_(&logger),
+ndone_(0),
+next_report_(0)
+{
+    if ( interval < 0.0 )
+        throw std::runtime_error( "ProgressReporter::ProgressReporter(): interval must be non-negative." );
+}
+
+// ********************************************************************************
+
+void ProgressReporter::tick( const std::string & item )
+{
+    const size_t ndone = ++ndone_;
+    if ( ! logger_->is_enabled( Logger::INFO ) )
+        return;
+    if ( ndone != nitems_ )
+    {
+        const std::chrono::steady_clock::rep now = std::chrono::steady_clock::now().time_since_epoch().count();
+        std::chrono::steady_clock::rep next_report = next_report_;
+        if ( now < next_report )
+            return;
+        // If several threads get here at the same time, only one of them reports.
+        if ( ! next_report_.compare_exchange_strong( next_report, now + interval_.count() ) )
+            return;
+    }
+    logger_->log( Logger::INFO, description_ + item + " (" + size_t2string( ndone ) + " of " + size_t2string( nitems_ ) + ")" );
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,120 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef> // For definition of size_t
+#include <iosfwd>
+#include <mutex>
+#include <string>
+
+/*
+  Buffered, thread-safe logging.
+
+  std::cout << ... << std::endl flushes the stream for every message, which shows up in profiles of batch jobs,
+  especially on network file systems. Messages are instead appended to one buffer under a mutex, so messages from different threads
+  are queued in the order in which they arrive and lines are never interleaved. The buffer is written to the sink when it is full,
+  when more than flush_interval() seconds have passed since the last write, when flush() is called and when the Logger is destroyed.
+*/
+class Logger
+{
+public:
+
+    enum Level { DEBUG, INFO, WARNING, ERROR, SILENT };
+
+    // The program-wide logger, writing to std::cout, flushed at program exit.
+    static Logger & instance();
+
+    // sink must outlive the Logger.
+    explicit Logger( std::ostream & sink, const Level level = INFO );
+
+    ~Logger();
+
+    Level level() const { return level_; }
+    // Messages below level are discarded.
+    void set_level( const Level level ) { level_ = level; }
+
+    bool is_enabled( const Level level ) const { return ( level >= level_ ) && ( level != SILENT ); }
+
+    double flush_interval() const { return flush_interval_; }
+    void set_flush_interval( const double seconds );
+
+    // A newline is added.
+    void log( const Level level, const std::string & message );
+
+    void flush();
+
+private:
+    std::ostream * sink_;
+    std::atomic< Level > level_;
+    double flush_interval_;
+    std::string buffer_;
+    std::chrono::steady_clock::time_point last_flush_;
+    std::mutex mutex_;
+
+    Logger( const Logger & );
+    Logger & operator=( const Logger & );
+
+    // mutex_ must be locked.
+    void write_buffer();
+};
+
+inline void log_debug( const std::string & message ) { Logger::instance().log( Logger::DEBUG, message ); }
+inline void log_info( const std::string & message ) { Logger::instance().log( Logger::INFO, message ); }
+inline void log_warning( const std::string & message ) { Logger::instance().log( Logger::WARNING, message ); }
+inline void log_error( const std::string & message ) { Logger::instance().log( Logger::ERROR, message ); }
+
+/*
+  Rate-limited progress messages for loops over many items, at most one every interval seconds, and always one for the last item.
+  A message reads description + item + " (i of n)". tick() may be called from within parallel_for().
+*/
+class ProgressReporter
+{
+public:
+
+    ProgressReporter( const std::string & description, const size_t nitems, const double interval = 1.0, Logger & logger = Logger::instance() );
+
+    // Call once for each item that is processed.
+    void tick( const std::string & item = "" );
+
+    size_t ndone() const { return ndone_; }
+
+private:
+    std::string description_;
+    size_t nitems_;
+    std::chrono::steady_clock::duration interval_;
+    Logger * logger_;
+    std::atomic< size_t > ndone_;
+    std::atomic< std::chrono::steady_clock::rep > next_report_;
+};
+
+#endif // LOGGER_H
+
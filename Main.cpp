@@ -36,45 +36,73 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "AnalyseTrajectory.h"
 #include "Angle.h"
 #include "AnisotropicDisplacementParameters.h"
-//#include "BFDH.h"
+#include "AsyncFileIO.h"
+#include "Autoindexing.h"
+#include "BatchPowderPatternCalculator.h"
 #include "BondDetector.h"
+#include "CalculateBFDH.h"
 #include "ChebyshevBackground.h"
 #include "CheckFoundItem.h"
 #include "ChemicalFormula.h"
+#include "Clustering.h"
 #include "CollectionOfPoints.h"
+#include "ContactAnalysis.h"
+#include "CopyTextFile.h"
 #include "CorrelationMatrix.h"
 #include "CrystalStructure.h"
 #include "CyclicInteger.h"
+#include "DirectSpaceSolver.h"
 #include "DoubleWithESD.h"
 #include "DrunkardsWalk.h"
+#include "DuplicateFinder.h"
 #include "Eigenvalue.h"
 #include "EndGame.h"
 #include "FileList.h"
 #include "FileName.h"
 #include "Finish_inp.h"
+#include "FlexibleMolecule.h"
 #include "Fraction.h"
 #include "GeneratePowderCIF.h"
 #include "Histogram.h"
 #include "InpWriter.h"
+#include "Instrumentation.h"
+#include "KernelVerification.h"
 #include "LabelsAndShieldings.h"
+#include "LatticeIndex.h"
+#include "Logger.h"
 #include "MathFunctions.h"
 #include "ModelBuilding.h"
+#include "NiggliReduction.h"
+#include "PairDistributionFunction.h"
+#include "ParallelFor.h"
+#include "PeakSearch.h"
 #include "Plane.h"
 #include "PowderMatchTable.h"
 #include "PowderPattern.h"
+#include "PowderPatternCache.h"
+#include "PeakShapeFunction.h"
 #include "PowderPatternCalculator.h"
+#include "PowderPatternServer.h"
 #include "RandomNumberGenerator.h"
 #include "ReadCif.h"
 #include "ReadXSD.h"
 #include "ReadXYZ.h"
 #include "Refcode.h"
+#include "RefcodeFamilyIndex.h"
 #include "ReflectionList.h"
+#include "ResultsContainer.h"
 #include "RunningAverageAndESD.h"
 #include "RunTests.h"
+#include "ScreeningPipeline.h"
 #include "SimilarityAnalysis.h"
+#include "SimulatedPowderPatternGenerator.h"
+#include "SingleCrystalData.h"
 #include "SkipBo.h"
 #include "Sort.h"
+#include "StructureDescriptors.h"
 #include "Sudoku.h"
+#include "SudokuBenchmark.h"
+#include "SudokuGenerator.h"
 #include "SudokuSolver.h"
 #include "SymmetryOperator.h"
 #include "TextFileReader.h"
@@ -82,8 +110,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TextFileWriter.h"
 #include "TLSWriter.h"
 #include "TOPAS.h"
+#include "TrajectorySource.h"
 #include "Utilities.h"
+#include "VariableCellMatch.h"
 #include "VoidsFinder.h"
+#include "WholePatternDecomposition.h"
 #include "WriteCASTEPFile.h"
 
 #include <vector>
@@ -91,6 +122,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <iostream>
 #include <cmath>
 #include <fstream>
+#include <limits>
 
 template<typename T>
 std::vector< T > convert_file_list_to_vector( const FileList & file_list )
@@ -123,31 +155,6 @@ struct C6Record
     double C6;
 };
 
-struct SimulatedPowderPatternCrystalStructure
-{
-    SimulatedPowderPatternCrystalStructure( CrystalStructure & crystal_structure ):
-    crystal_structure_(crystal_structure),
-    total_signal_normalisation_(10000.0),
-    include_PO_(false),
-    PO_direction_(MillerIndices(0,0,1)),
-    PO_extent_(1.0),
-    FWHM_(0.1),
-    include_background_(true),
-    background_total_signal_normalisation_(10000.0)
-    {}
-
-
-    // The PO does NOT apply to the amorphous contribution
-    CrystalStructure crystal_structure_;
-    double total_signal_normalisation_;
-    bool   include_PO_;
-    MillerIndices PO_direction_;
-    double PO_extent_;
-    double FWHM_;
-    bool   include_background_;
-    double background_total_signal_normalisation_;
-};
-
 #define MACRO_ONE_FILELISTNAME_AS_ARGUMENT \
         if ( argc != 2 ) \
             throw std::runtime_error( "Please give the name of a FileList.txt file." ); \
@@ -235,143 +242,1297 @@ std::string extract_variable_value( const std::string & line )
     return strip( words[1] );
 }
 
-int main( int argc, char** argv )
-{
+// ********************************************************************************
+
+// The subcommands, run as "Fourier <command> <arguments>". Each command gets the arguments after the command name,
+// with argv[ 0 ] the command name, so argv[ 1 ] is its first argument and the MACRO_..._AS_ARGUMENT macros work unchanged.
 
-    try // Run tests.
+int command_test( int argc, char** argv )
+{
+    size_t nerrors( 0 );
+    try // Run tests, optionally only those whose name contains one of the arguments.
     {
-        run_tests();
+        TestRunnerOptions options;
+        for ( int i( 1 ); i < argc; ++i )
+        {
+            const std::string option( argv[ i ] );
+            if ( ( option == "--jobs" ) || ( option == "--slowest" ) )
+            {
+                if ( i + 1 >= argc )
+                    throw std::runtime_error( option + " needs a value." );
+                const size_t value = string2integer( argv[ ++i ] );
+                if ( option == "--jobs" )
+                    options.nthreads_ = value;
+                else
+                    options.nslowest_ = value;
+            }
+            else if ( option == "--no-timing-assertions" )
+                options.check_timings_ = false;
+            else if ( option == "--list" )
+            {
+                const std::vector< std::string > names = test_names();
+                for ( size_t j( 0 ); j != names.size(); ++j )
+                    std::cout << names[j] << std::endl;
+                return 0;
+            }
+            else if ( ( ! option.empty() ) && ( option[0] == '-' ) )
+                throw std::runtime_error( "Unknown option " + option );
+            else
+                options.selection_.push_back( option );
+        }
+        nerrors = run_tests( options );
     }
     catch ( std::exception & e )
     {
         std::cout << "An exception was thrown" << std::endl;
         std::cout << e.what() << std::endl;
+        nerrors = 1;
     }
+    Logger::instance().flush();
+    return ( nerrors == 0 ) ? 0 : 1;
+}
 
-    try // Add class.
+int command_simulate_pattern( int argc, char** argv )
+{
+    try // Simulate experimental powder diffraction patterns, with the parameters drawn from ranges, e.g. as training data.
     {
-        add_class( "PowderMatchTable" );
+        if ( argc < 2 )
+            throw std::runtime_error( "Please give the name of a FileList.txt file, optionally followed by options." );
+        FileName file_list_file_name( argv[ 1 ] );
+        FileList file_list( file_list_file_name );
+        if ( file_list.empty() )
+            throw std::runtime_error( std::string( "No files in file list " ) + file_list_file_name.full_name() );
+        SimulatedPowderPatternGenerator generator;
+        size_t patterns_per_shard( 0 );
+        for ( int i( 2 ); i < argc; ++i )
+        {
+            const std::string option( argv[ i ] );
+            // Options with one value
+            if ( ( option == "--samples" ) || ( option == "--seed" ) || ( option == "--shard-size" ) || ( option == "--PO-probability" ) )
+            {
+                if ( i + 1 >= argc )
+                    throw std::runtime_error( option + " needs a value." );
+                const std::string value( argv[ ++i ] );
+                if ( option == "--samples" )
+                    generator.set_samples_per_structure( string2integer( value ) );
+                else if ( option == "--seed" )
+                    generator.set_seed( string2integer( value ) );
+                else if ( option == "--shard-size" )
+                    patterns_per_shard = string2integer( value );
+                else
+                    generator.set_PO_probability( string2double( value ) );
+            }
+            // Options with a range, min and max
+            else if ( ( option == "--zero-point" ) || ( option == "--FWHM" ) || ( option == "--PO-r" ) ||
+                      ( option == "--amorphous" ) || ( option == "--highest-peak" ) || ( option == "--background" ) )
+            {
+                if ( i + 2 >= argc )
+                    throw std::runtime_error( option + " needs a minimum and a maximum." );
+                const ParameterRange range( string2double( argv[ i + 1 ] ), string2double( argv[ i + 2 ] ) );
+                i += 2;
+                if ( option == "--zero-point" )
+                    generator.set_zero_point_error( range );
+                else if ( option == "--FWHM" )
+                    generator.set_FWHM( range );
+                else if ( option == "--PO-r" )
+                    generator.set_PO_r( range );
+                else if ( option == "--amorphous" )
+                    generator.set_amorphous_total_signal( range );
+                else if ( option == "--highest-peak" )
+                    generator.set_highest_peak( range );
+                else
+                    generator.set_constant_background( range );
+            }
+            else if ( option == "--no-background-subtraction" )
+                generator.set_subtract_background( false );
+            else
+                throw std::runtime_error( "Unknown option " + option );
+        }
+        // One .xye file per .cif file unless more than one sample or shards have been requested
+        if ( ( patterns_per_shard == 0 ) && ( generator.samples_per_structure() == 1 ) )
+        {
+            parallel_for( file_list.size(), 0, [&]( const size_t i )
+            {
+                CrystalStructure crystal_structure;
+                read_cif( file_list.value( i ), crystal_structure );
+                crystal_structure.apply_space_group_symmetry();
+                std::vector< PowderPattern > powder_patterns;
+                std::vector< SimulatedPowderPatternParameters > parameters;
+                generator.simulate( crystal_structure, i, powder_patterns, parameters );
+                powder_patterns[0].save_xye( replace_extension( file_list.value( i ), "xye" ), true );
+            } );
+        }
+        else
+        {
+            if ( patterns_per_shard == 0 )
+                patterns_per_shard = 100000;
+            const size_t nshards = generator.write_shards( file_list, FileName( file_list_file_name.directory(), "simulated", "pps" ), patterns_per_shard );
+            std::cout << "Written " << file_list.size() * generator.samples_per_structure() << " patterns to " << nshards << " shards." << std::endl;
+        }
     MACRO_END_GAME
+}
 
-    // Simulate an experimental powder diffraction pattern
-    try
+int command_calculate_pattern( int argc, char** argv )
+{
+    try // Calculate powder pattern.
+    {
+        if ( argc != 2 )
+            throw std::runtime_error( "Please give the name of a .cif file." );
+        FileName input_file_name( argv[ 1 ] );
+        CrystalStructure crystal_structure;
+        std::cout << "Now reading cif... " + input_file_name.full_name() << std::endl;
+        read_cif( input_file_name, crystal_structure );
+        crystal_structure.apply_space_group_symmetry();
+        Angle two_theta_start( 5.0, Angle::DEGREES );
+        Angle two_theta_end(  50.0, Angle::DEGREES );
+        Angle two_theta_step( 0.02, Angle::DEGREES );
+        double FWHM( 0.1 );
+        std::cout << "Now calculating powder pattern... " << std::endl;
+        PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+        powder_pattern_calculator.set_wavelength( 1.54056 );
+        powder_pattern_calculator.set_two_theta_start( two_theta_start );
+        powder_pattern_calculator.set_two_theta_end( two_theta_end );
+        powder_pattern_calculator.set_two_theta_step( two_theta_step );
+        powder_pattern_calculator.set_FWHM( FWHM );
+//        powder_pattern_calculator.set_preferred_orientation( MillerIndices( 0, 0, 1 ), 0.75 );
+        PowderPattern powder_pattern;
+        powder_pattern_calculator.calculate( powder_pattern );
+        powder_pattern.save_xye( FileName( input_file_name.directory(), input_file_name.file_name(), "xye" ), true );
+    MACRO_END_GAME
+}
+
+int command_similarity( int argc, char** argv )
+{
+    try // Calculate similarity matrix.
     {
-      //  MACRO_ONE_CIFFILENAME_AS_ARGUMENT
+        // "--checkpoint" at the end writes the values to SimilarityMatrix.bin as they are calculated, so that a calculation that is stopped can be resumed
+        bool use_checkpoint( false );
+        if ( ( argc > 2 ) && ( std::string( argv[ argc - 1 ] ) == "--checkpoint" ) )
+        {
+            use_checkpoint = true;
+            --argc;
+        }
         MACRO_ONE_FILELISTNAME_AS_ARGUMENT
-     //   std::vector< SimulatedPowderPatternCrystalStructure > crystal_structures;
-//    total_signal_normalisation_(10000.0),
-//    include_PO_(false),
-//    PO_direction_(MillerIndices(0,0,1)),
-//    PO_extent_(1.0),
-//    FWHM_(0.1),
-//    include_background_(true),
-//    background_total_signal_normalisation_(10000.0)
-      //  SimulatedPowderPatternCrystalStructure sim_XRPD_crystal_structure( crystal_structure );
-        double wavelength( 1.54056 );
-        // ######################## CHANGE THIS ##################################
-        double zero_point_error = 0.06; // 0.06;
-        Angle two_theta_start( 1.0, Angle::DEGREES );
-        Angle two_theta_end(  35.0, Angle::DEGREES );
-        Angle two_theta_step( 0.015, Angle::DEGREES );
-        for ( size_t i( 0 ); i != file_list.size(); ++i )
+        if ( use_checkpoint )
+        {
+            CorrelationMatrix similarity_matrix = calculate_correlation_matrix( file_list, FileName( file_list_file_name.directory(), "SimilarityMatrix", "bin" ) );
+            similarity_matrix.save( FileName( file_list_file_name.directory(), "SimilarityMatrix", "txt" ) );
+        }
+        else
+        {
+            CorrelationMatrix similarity_matrix = calculate_correlation_matrix( file_list );
+            similarity_matrix.save( FileName( file_list_file_name.directory(), "SimilarityMatrix", "txt" ) );
+        }
+    MACRO_END_GAME
+}
+
+int command_similarity_part( int argc, char** argv )
+{
+    try // One part of the similarity matrix, for running the calculation as several processes, e.g. one per node.
+    {
+        std::vector< std::string > arguments;
+        size_t nthreads( 0 );
+        for ( int i( 1 ); i != argc; ++i )
+        {
+            const std::string argument( argv[i] );
+            if ( ( argument == "--jobs" ) && ( i + 1 != argc ) )
+                nthreads = string2integer( argv[ ++i ] );
+            else
+                arguments.push_back( argument );
+        }
+        if ( arguments.size() != 4 )
+            throw std::runtime_error( "Please give the name of a FileList.txt file, the name of the matrix file, the part (0, 1, ...) and the number of parts." );
+        FileName file_list_file_name( arguments[0] );
+        FileList file_list( file_list_file_name );
+        if ( file_list.empty() )
+            throw std::runtime_error( std::string( "No files in file list " ) + file_list_file_name.full_name() );
+        const size_t ntiles = calculate_correlation_matrix_part( file_list, FileName( arguments[1] ), string2integer( arguments[2] ), string2integer( arguments[3] ), nthreads );
+        std::cout << ntiles << " tiles calculated" << std::endl;
+    MACRO_END_GAME
+}
+
+int command_cluster( int argc, char** argv )
+{
+    try // Cluster the items of a similarity matrix file, or only group the duplicates.
+    {
+        if ( ( argc != 3 ) && ( argc != 4 ) )
+            throw std::runtime_error( "Please give the name of a matrix file as written by similarity-part, a similarity threshold and optionally --duplicates." );
+        FileName matrix_file_name( argv[ 1 ] );
+        CorrelationMatrix correlation_matrix( matrix_file_name );
+        const double threshold = string2double( argv[ 2 ] );
+        std::vector< size_t > clusters;
+        if ( ( argc == 4 ) && ( std::string( argv[ 3 ] ) == "--duplicates" ) )
+            clusters = group_duplicates( correlation_matrix, threshold );
+        else if ( argc == 4 )
+            throw std::runtime_error( std::string( "Unknown option " ) + argv[ 3 ] );
+        else
+            clusters = average_linkage_clustering( correlation_matrix ).clusters( threshold );
+        TextFileWriter text_file_writer( FileName( matrix_file_name.directory(), matrix_file_name.file_name() + "_clusters", "txt" ) );
+        size_t nclusters( 0 );
+        for ( size_t i( 0 ); i != clusters.size(); ++i )
+        {
+            text_file_writer.write_line( size_t2string( i ) + " " + size_t2string( clusters[i] ) );
+            nclusters = std::max( nclusters, clusters[i] + 1 );
+        }
+        std::cout << correlation_matrix.size() << " items, " << nclusters << " clusters" << std::endl;
+    MACRO_END_GAME
+}
+
+int command_find_duplicates( int argc, char** argv )
+{
+    try // Find the duplicates in a list of crystal structures with a cascade of filters.
+    {
+        std::vector< std::string > arguments;
+        size_t nthreads( 0 );
+        for ( int i( 1 ); i != argc; ++i )
+        {
+            const std::string argument( argv[i] );
+            if ( ( argument == "--jobs" ) && ( i + 1 != argc ) )
+                nthreads = string2integer( argv[ ++i ] );
+            else
+                arguments.push_back( argument );
+        }
+        if ( arguments.size() != 1 )
+            throw std::runtime_error( "Please give the name of a FileList.txt file." );
+        FileName file_list_file_name( arguments[0] );
+        FileList file_list( file_list_file_name );
+        if ( file_list.empty() )
+            throw std::runtime_error( std::string( "No files in file list " ) + file_list_file_name.full_name() );
+        std::vector< CrystalStructure > crystal_structures( file_list.size() );
+        FilePrefetcher file_prefetcher( file_list );
+        FileName file_name;
+        std::vector< char > contents;
+        for ( size_t i( 0 ); file_prefetcher.next( file_name, contents ); ++i )
+        {
+            read_cif( contents, crystal_structures[i] );
+            crystal_structures[i].apply_space_group_symmetry();
+        }
+        DuplicateFinder duplicate_finder;
+        duplicate_finder.set_nthreads( nthreads );
+        std::vector< size_t > groups = duplicate_finder.find_duplicates( crystal_structures );
+        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "Duplicates", "txt" ) );
+        size_t ngroups( 0 );
+        for ( size_t i( 0 ); i != groups.size(); ++i )
+        {
+            text_file_writer.write_line( file_list.value( i ).full_name() + " " + size_t2string( groups[i] ) );
+            ngroups = std::max( ngroups, groups[i] + 1 );
+        }
+        std::cout << duplicate_finder.report() << std::endl;
+        std::cout << groups.size() << " structures, " << ngroups << " unique" << std::endl;
+    MACRO_END_GAME
+}
+
+int command_pattern_library( int argc, char** argv )
+{
+    try // Powder patterns of many cifs, and optionally their similarity matrix, in one results container instead of one file per pattern.
+    {
+        std::vector< std::string > arguments;
+        size_t nthreads( 0 );
+        bool include_similarity_matrix( false );
+        for ( int i( 1 ); i != argc; ++i )
+        {
+            const std::string argument( argv[i] );
+            if ( ( argument == "--jobs" ) && ( i + 1 != argc ) )
+                nthreads = string2integer( argv[ ++i ] );
+            else if ( argument == "--similarity" )
+                include_similarity_matrix = true;
+            else
+                arguments.push_back( argument );
+        }
+        if ( arguments.size() != 2 )
+            throw std::runtime_error( "Please give the name of a FileList.txt file and the name of the container file." );
+        FileName file_list_file_name( arguments[0] );
+        FileList file_list( file_list_file_name );
+        if ( file_list.empty() )
+            throw std::runtime_error( std::string( "No files in file list " ) + file_list_file_name.full_name() );
+        BatchPowderPatternCalculator batch_powder_pattern_calculator;
+        batch_powder_pattern_calculator.set_wavelength( 1.54056 );
+        batch_powder_pattern_calculator.set_two_theta_start( Angle( 3.0, Angle::DEGREES ) );
+        batch_powder_pattern_calculator.set_two_theta_end( Angle( 35.0, Angle::DEGREES ) );
+        batch_powder_pattern_calculator.set_two_theta_step( Angle( 0.01, Angle::DEGREES ) );
+        batch_powder_pattern_calculator.set_FWHM( 0.1 );
+        batch_powder_pattern_calculator.set_nthreads( nthreads );
+        batch_powder_pattern_calculator.calculate( file_list );
+        ResultsContainerWriter results_container_writer( FileName( arguments[1] ), batch_powder_pattern_calculator.npatterns(),
+                                                         batch_powder_pattern_calculator.two_theta_start(), batch_powder_pattern_calculator.two_theta_step(),
+                                                         batch_powder_pattern_calculator.npoints(), batch_powder_pattern_calculator.wavelength() );
+        parallel_for( batch_powder_pattern_calculator.npatterns(), nthreads, [&]( const size_t i )
+        {
+            results_container_writer.write_identifier( i, file_list.value( i ).full_name() );
+            results_container_writer.write_powder_pattern( i, batch_powder_pattern_calculator.intensities( i ) );
+        } );
+        if ( include_similarity_matrix )
+            results_container_writer.write_similarity_matrix( calculate_correlation_matrix( batch_powder_pattern_calculator, Angle::from_degrees( 1.0 ), 0.0, nthreads ) );
+        results_container_writer.close();
+        std::cout << batch_powder_pattern_calculator.npatterns() << " patterns written to " << arguments[1] << std::endl;
+    MACRO_END_GAME
+}
+
+int command_voids( int argc, char** argv )
+{
+    try // Find voids for FileList.txt.
+    {
+        MACRO_ONE_FILELISTNAME_AS_ARGUMENT
+        std::cout << "WARNING: the molecular volume is estimated assuming that the smallest molecular volume corresponds to Z'=1." << std::endl;
+        std::cout << "WARNING: if the smallest molecular volume corresponds to Z'>1 or Z'<1 then the results will be wrong." << std::endl;
+        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "Voids", "txt" ) );
+        std::vector< double > total_voids_volumes_per_symmetry_operator;
+        std::vector< std::string > identifiers;
+        std::vector< double > total_void_volumes;
+        std::vector< double > molecular_volumes;
+        std::vector< double > unit_cell_volumes;
+        text_file_writer.write_line( "Identifier | total void volume | ( unit-cell volume - total void volume) / number of symmetry operators" );
+        if ( file_list.empty() )
+            return 0;
+        size_t nfiles = file_list.size();
+        total_voids_volumes_per_symmetry_operator.reserve( nfiles );
+        identifiers.reserve( nfiles );
+        total_void_volumes.reserve( nfiles );
+        molecular_volumes.reserve( nfiles );
+        unit_cell_volumes.reserve( nfiles );
+        double smallest_molecular_volume( 0.0 );
+        ProgressReporter progress( "Now reading cif... ", nfiles );
+        FilePrefetcher file_prefetcher( file_list );
+        FileName file_name;
+        std::vector< char > contents;
+        for ( size_t i( 0 ); i != nfiles; ++i )
         {
+            identifiers.push_back( FileName( "", file_list.value( i ).file_name(), file_list.value( i ).extension() ).full_name() );
             CrystalStructure crystal_structure;
-            std::cout << "Now reading cif... " + file_list.value( i ).full_name() << std::endl;
-            read_cif( file_list.value( i ), crystal_structure );
-            SimulatedPowderPatternCrystalStructure sim_XRPD_crystal_structure( crystal_structure );
-            // ######################## CHANGE THIS ##################################
-            sim_XRPD_crystal_structure.background_total_signal_normalisation_ = 50000.0;
-            sim_XRPD_crystal_structure.include_PO_ = true;
-          //  sim_XRPD_crystal_structure.include_PO_ = false;
-            if ( sim_XRPD_crystal_structure.include_PO_ )
+            progress.tick( file_list.value( i ).full_name() );
+            file_prefetcher.next( file_name, contents );
+            read_cif( contents, crystal_structure );
+            unit_cell_volumes.push_back( crystal_structure.crystal_lattice().volume() );
+            crystal_structure.apply_space_group_symmetry();
+            double total_void_volume = find_voids( crystal_structure );
+            total_void_volumes.push_back( total_void_volume );
+            total_voids_volumes_per_symmetry_operator.push_back( total_void_volume / crystal_structure.space_group().nsymmetry_operators() );
+            double molecular_volume = ( crystal_structure.crystal_lattice().volume() - total_void_volume ) / crystal_structure.space_group().nsymmetry_operators();
+            molecular_volumes.push_back( molecular_volume );
+            if ( ( i == 0 ) || ( molecular_volume < smallest_molecular_volume ) )
+                smallest_molecular_volume = molecular_volume;
+            text_file_writer.write_line( FileName( "", file_list.value( i ).file_name(), file_list.value( i ).extension() ).full_name() + " " +
+                                         double2string( total_void_volume ) + " " +
+                                         double2string( molecular_volume ) );
+        }
+        std::vector< double > voids_volumes_per_Z;
+        for ( size_t i( 0 ); i != nfiles; ++i )
+        {
+            // round_to_int( molecular_volumes[i] / smallest_molecular_volume ) = Z'
+            voids_volumes_per_Z.push_back( total_voids_volumes_per_symmetry_operator[i] / round_to_int( molecular_volumes[i] / smallest_molecular_volume ) );
+        }
+        text_file_writer.write_line( "##### customer specific #####" );
+        text_file_writer.write_line( "Rank/Form Void volume Void fraction" );
+        text_file_writer.write_line( "              [A3/Z]              " );
+        for ( size_t i( 0 ); i != nfiles; ++i )
+        {
+            if ( voids_volumes_per_Z[i] < 0.000001 )
+                continue;
+            text_file_writer.write_line( FileName( "", file_list.value( i ).file_name(), "" ).full_name() + " " +
+                                         double2string_2( voids_volumes_per_Z[i], 0 ) + " " +
+                                         double2string_2( 100.0 * ( total_void_volumes[i]/unit_cell_volumes[i] ), 2 ) + "%" );
+        }
+        std::vector< size_t > sorted_map = sort( voids_volumes_per_Z );
+        size_t iStart;
+        for ( iStart = 0; iStart != nfiles; ++iStart )
+        {
+            if ( voids_volumes_per_Z[ sorted_map[iStart] ] > 20.0 )
+                break;
+        }
+
+        if ( iStart == nfiles )
+        {
+            text_file_writer.write_line( "There are no voids greater than 20 A3/Z." );
+        }
+        else
+        {
+            text_file_writer.write_line( "##### sorted #####" );
+            for ( size_t i( iStart ); i != nfiles; ++i )
+                text_file_writer.write_line( identifiers[ sorted_map[i] ] + " " + double2string( voids_volumes_per_Z[ sorted_map[i] ] ) );
+            text_file_writer.write_line();
+            if ( (nfiles - iStart) == 1 )
+            {
+                text_file_writer.write( "Rank " );
+                text_file_writer.write( size_t2string( sorted_map[iStart] + 1 ) );
+                text_file_writer.write( " contains voids amounting to " );
+                text_file_writer.write( double2string_2( voids_volumes_per_Z[sorted_map[iStart]], 0 ) );
+                text_file_writer.write( " A3/Z." );
+            }
+            else
             {
-                // ######################## CHANGE THIS ##################################
-                sim_XRPD_crystal_structure.PO_extent_= 0.7;
-                switch ( crystal_structure.crystal_lattice().lattice_system() )
+//        Ranks 12, 22 5, 17, 1, 9 and 10 contain voids amounting to 20, 21, 21, 24, 28, 40 and 45 �3/Z, respectively.
+                text_file_writer.write( "Ranks " );
+                for ( size_t i( iStart ); i != nfiles; ++i )
                 {
-                    case CrystalLattice::TRICLINIC    :
-                    case CrystalLattice::ORTHORHOMBIC : {
-                                                            CrystalLattice crystal_lattice = crystal_structure.crystal_lattice();
-                                                            if ( crystal_lattice.a() < crystal_lattice.b() )
-                                                            {
-                                                                if ( crystal_lattice.a() < crystal_lattice.c() )
-                                                                    sim_XRPD_crystal_structure.PO_direction_ = MillerIndices( 1, 0, 0 );
-                                                            }
-                                                            else // b < a
-                                                            {
-                                                                if ( crystal_lattice.b() < crystal_lattice.c() )
-                                                                    sim_XRPD_crystal_structure.PO_direction_ = MillerIndices( 0, 1, 0 );
-                                                            }
-                                                            break;
-                                                        }
-                    case CrystalLattice::MONOCLINIC   : {
-                                                            sim_XRPD_crystal_structure.PO_direction_ = MillerIndices( 0, 1, 0 );
-                                                            break;
-                                                        }
-                    case CrystalLattice::TRIGONAL     :
-                    case CrystalLattice::TETRAGONAL   :
-                    case CrystalLattice::HEXAGONAL    : break; // Nothing to do
-                    case CrystalLattice::RHOMBOHEDRAL :
-                    case CrystalLattice::CUBIC        : sim_XRPD_crystal_structure.include_PO_ = false;
+                    if ( i == nfiles - 1 )
+                        text_file_writer.write( " and "  );
+                    else if ( i != iStart )
+                        text_file_writer.write( ", "  );
+                    text_file_writer.write( size_t2string( sorted_map[i] + 1 ) );
                 }
-            }
-            // ######################## CHANGE THIS ##################################
-            sim_XRPD_crystal_structure.FWHM_ = 0.25; // 0.2; // ?
-      //      crystal_structures.push_back( sim_XRPD_crystal_structure );
-            PowderPattern result( two_theta_start, two_theta_end, two_theta_step );
-    //        for ( size_t i( 0 ); i != crystal_structures.size(); ++i )
-    //        {
-                sim_XRPD_crystal_structure.crystal_structure_.apply_space_group_symmetry();
-                std::cout << "Now calculating powder pattern... " << std::endl;
-                PowderPatternCalculator powder_pattern_calculator( sim_XRPD_crystal_structure.crystal_structure_ );
-                powder_pattern_calculator.set_wavelength( wavelength );
-                powder_pattern_calculator.set_two_theta_start( two_theta_start );
-                powder_pattern_calculator.set_two_theta_end( two_theta_end );
-                powder_pattern_calculator.set_two_theta_step( two_theta_step );
-                powder_pattern_calculator.set_FWHM( sim_XRPD_crystal_structure.FWHM_ );
-                if ( sim_XRPD_crystal_structure.include_PO_ )
-                    powder_pattern_calculator.set_preferred_orientation( sim_XRPD_crystal_structure.PO_direction_, sim_XRPD_crystal_structure.PO_extent_ );
-                PowderPattern powder_pattern;
-                powder_pattern_calculator.calculate( powder_pattern );
-                powder_pattern.normalise_total_signal( sim_XRPD_crystal_structure.total_signal_normalisation_ );
-                result += powder_pattern;
-                if ( sim_XRPD_crystal_structure.include_background_ )
+                text_file_writer.write( " contain voids amounting to " );
+                for ( size_t i( iStart ); i != nfiles; ++i )
                 {
-                    PowderPatternCalculator background_powder_pattern_calculator( sim_XRPD_crystal_structure.crystal_structure_ );
-                    background_powder_pattern_calculator.set_wavelength( wavelength );
-                    background_powder_pattern_calculator.set_two_theta_start( two_theta_start );
-                    background_powder_pattern_calculator.set_two_theta_end( two_theta_end );
-                    background_powder_pattern_calculator.set_two_theta_step( two_theta_step );
-                    background_powder_pattern_calculator.set_FWHM( 5.0 );
-                    // We never include PO for the amorphous background
-                    PowderPattern powder_pattern;
-                    background_powder_pattern_calculator.calculate( powder_pattern );
-                    powder_pattern.normalise_total_signal( sim_XRPD_crystal_structure.background_total_signal_normalisation_ );
-                    result += powder_pattern;
+                    if ( i == nfiles - 1 )
+                        text_file_writer.write( " and "  );
+                    else if ( i != iStart )
+                        text_file_writer.write( ", "  );
+                    text_file_writer.write( double2string_2( voids_volumes_per_Z[ sorted_map[i] ], 0 ) );
                 }
-    //        }
+                text_file_writer.write( " A3/Z, respectively." );
+            }
+            text_file_writer.write( " Of interest are voids that are greater than about 20 A3/Z: 21.5 A3/Z suffices to store a water molecule (at least in terms of volume), a chloride ion is about 25 A3/Z." );
+            text_file_writer.write_line( " Voids between 15 and 20 A3/Z are quite common, but voids over 25 A3/Z are rare." );
+        }
+    MACRO_END_GAME
+}
 
-          //  PowderPattern background_1;
-          //  background_1.read_xye( FileName( "W:\\GC\\Form_I_BKGR.xye" ) );
-          //  background_1.normalise( 1000.0 );
-          //  result += background_1;
+int command_density( int argc, char** argv )
+{
+    try // Calculate density for FileList.txt.
+    {
+        MACRO_ONE_FILELISTNAME_AS_ARGUMENT
+        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "densities", "txt" ) );
+        ProgressReporter progress( "Now reading cif... ", file_list.size() );
+        for ( size_t i( 0 ); i != file_list.size(); ++i )
+        {
+            CrystalStructure crystal_structure;
+            progress.tick( file_list.value( i ).full_name() );
+            read_cif( file_list.value( i ), crystal_structure );
+            crystal_structure.apply_space_group_symmetry();
+            double density = crystal_structure.density();
+            text_file_writer.write_line( FileName( "", file_list.value( i ).file_name(), file_list.value( i ).extension() ).full_name() + " " + double2string( density ) );
+        }
+    MACRO_END_GAME
+}
 
-            // ######################## CHANGE THIS ##################################
-            result.normalise_highest_peak( 300.0 );
-            result.add_constant_background( 20.0 );
-            result.recalculate_estimated_standard_deviations();
-            result.add_Poisson_noise();
-            result.correct_zero_point_error( Angle::from_degrees( -zero_point_error ) );
+int command_ring_conformations( int argc, char** argv )
+{
+    try // Cremer-Pople puckering of all five- and six-membered rings in the .cif files in FileList.txt.
+    {
+        MACRO_ONE_FILELISTNAME_AS_ARGUMENT
+        const std::vector< RingConformation > ring_conformations = analyse_ring_conformations( file_list );
+        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "ring_conformations", "txt" ) );
+        text_file_writer.write_line( "# file atoms N Q theta phi2 conformation" );
+        for ( size_t i( 0 ); i != ring_conformations.size(); ++i )
+        {
+            const RingConformation & ring_conformation = ring_conformations[i];
+            std::string labels;
+            for ( size_t j( 0 ); j != ring_conformation.labels_.size(); ++j )
+                labels += ( j == 0 ? "" : "-" ) + ring_conformation.labels_[j];
+            const RingPuckering & puckering = ring_conformation.puckering_;
+            text_file_writer.write_line( file_list.value( ring_conformation.file_index_ ).file_name() + " " +
+                                         labels + " " +
+                                         size_t2string( puckering.nmembers_ ) + " " +
+                                         double2string( puckering.Q_, 3 ) + " " +
+                                         double2string( puckering.theta_.value_in_degrees(), 1 ) + " " +
+                                         double2string( puckering.phi2_.value_in_degrees(), 1 ) + " " +
+                                         puckering.conformation() );
+        }
+        std::cout << size_t2string( ring_conformations.size() ) << " rings written." << std::endl;
+    MACRO_END_GAME
+}
 
-            PowderPattern background = calculate_Brueckner_background( result,
-                                                                       50, // niterations
-                                                                       round_to_int( 50.0 * ( Angle::from_degrees( 0.015 ) / result.average_two_theta_step() ) ), // window
-                                                                       true, // apply_smoothing
-                                                                       5 ); // smoothing_window
-            result -= background;
+int command_descriptors( int argc, char** argv )
+{
+    try // Density, packing coefficient, void fraction, formula, Z' and dipole moment for FileList.txt, as .csv.
+    {
+        MACRO_ONE_FILELISTNAME_AS_ARGUMENT
+        std::vector< std::string > error_messages;
+        const std::vector< StructureDescriptors > descriptors = calculate_structure_descriptors( file_list, error_messages );
+        write_structure_descriptors_csv( FileName( file_list_file_name.directory(), "descriptors", "csv" ), file_list, descriptors, error_messages );
+        size_t nfailed( 0 );
+        for ( size_t i( 0 ); i != error_messages.size(); ++i )
+        {
+            if ( ! error_messages[i].empty() )
+                ++nfailed;
+        }
+        std::cout << size_t2string( file_list.size() - nfailed ) << " of " << size_t2string( file_list.size() ) << " structures written." << std::endl;
+    MACRO_END_GAME
+}
+
+int command_contacts( int argc, char** argv )
+{
+    try // Intermolecular contacts and hydrogen bonds for FileList.txt.
+    {
+        if ( ( argc != 2 ) && ( argc != 3 ) )
+            throw std::runtime_error( "Please give the name of a FileList.txt file and optionally the tolerance added to the sum of the Van der Waals radii." );
+        FileName file_list_file_name( argv[ 1 ] );
+        FileList file_list( file_list_file_name );
+        const double delta = ( argc == 3 ) ? string2double( argv[ 2 ] ) : 0.0;
+        std::vector< std::string > error_messages;
+        const std::vector< ContactAnalysis > contact_analyses = analyse_contacts( file_list, error_messages, delta );
+        TextFileWriter contacts_writer( FileName( file_list_file_name.directory(), "contacts", "txt" ) );
+        TextFileWriter hydrogen_bonds_writer( FileName( file_list_file_name.directory(), "hydrogen_bonds", "txt" ) );
+        contacts_writer.write_line( "# file atom_1 atom_2 translation distance sum_of_vdW_radii" );
+        hydrogen_bonds_writer.write_line( "# file D H A translation H...A D...A D-H...A" );
+        for ( size_t i( 0 ); i != file_list.size(); ++i )
+        {
+            if ( ! error_messages[i].empty() )
+                continue;
+            const ContactAnalysis & contact_analysis = contact_analyses[i];
+            const std::string file_name = file_list.value( i ).file_name();
+            for ( size_t j( 0 ); j != contact_analysis.ncontacts(); ++j )
+            {
+                const Contact & contact = contact_analysis.contact( j );
+                contacts_writer.write_line( file_name + " " + contact_analysis.label( contact.atom_1_ ) + " " + contact_analysis.label( contact.atom_2_ ) + " " +
+                                            double2string( contact.translation_.x(), 0 ) + " " + double2string( contact.translation_.y(), 0 ) + " " + double2string( contact.translation_.z(), 0 ) + " " +
+                                            double2string( contact.distance_, 3 ) + " " + double2string( contact.sum_of_Van_der_Waals_radii_, 3 ) );
+            }
+            for ( size_t j( 0 ); j != contact_analysis.nhydrogen_bonds(); ++j )
+            {
+                const HydrogenBond & hydrogen_bond = contact_analysis.hydrogen_bond( j );
+                hydrogen_bonds_writer.write_line( file_name + " " + contact_analysis.label( hydrogen_bond.donor_ ) + " " + contact_analysis.label( hydrogen_bond.hydrogen_ ) + " " + contact_analysis.label( hydrogen_bond.acceptor_ ) + " " +
+                                                  double2string( hydrogen_bond.translation_.x(), 0 ) + " " + double2string( hydrogen_bond.translation_.y(), 0 ) + " " + double2string( hydrogen_bond.translation_.z(), 0 ) + " " +
+                                                  double2string( hydrogen_bond.H_A_distance_, 3 ) + " " + double2string( hydrogen_bond.D_A_distance_, 3 ) + " " + double2string( hydrogen_bond.D_H_A_angle_.value_in_degrees(), 1 ) );
+            }
+        }
+    MACRO_END_GAME
+}
+
+int command_niggli( int argc, char** argv )
+{
+    try // Niggli-reduced primitive cells of the .cif files in FileList.txt, and for each cell the first earlier file with the same cell.
+    {
+        if ( ( argc != 2 ) && ( argc != 3 ) )
+            throw std::runtime_error( "Please give the name of a FileList.txt file and optionally the G6 distance (in A^2) below which cells are the same." );
+        FileName file_list_file_name( argv[ 1 ] );
+        FileList file_list( file_list_file_name );
+        const double tolerance = ( argc == 3 ) ? string2double( argv[ 2 ] ) : 1.0;
+        std::vector< CrystalLattice > reduced_cells;
+        reduced_cells.reserve( file_list.size() );
+        LatticeIndex lattice_index;
+        lattice_index.reserve( file_list.size() );
+        for ( size_t i( 0 ); i != file_list.size(); ++i )
+        {
+            CrystalStructure crystal_structure;
+            read_cif( file_list.value( i ), crystal_structure );
+            reduced_cells.push_back( Niggli_reduce( primitive_cell( crystal_structure.crystal_lattice(), crystal_structure.space_group() ) ) );
+            lattice_index.push_back( reduced_cells.back() );
+        }
+        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "niggli", "txt" ) );
+        text_file_writer.write_line( "# file a b c alpha beta gamma same_cell_as" );
+        for ( size_t i( 0 ); i != file_list.size(); ++i )
+        {
+            // The matches are in ascending order, so the first one is the first file with this cell
+            const std::vector< size_t > matches = lattice_index.find_within( reduced_cells[i], tolerance );
+            const CrystalLattice & reduced_cell = reduced_cells[i];
+            text_file_writer.write_line( file_list.value( i ).file_name() + " " +
+                                         double2string_2( reduced_cell.a(), 4 ) + " " +
+                                         double2string_2( reduced_cell.b(), 4 ) + " " +
+                                         double2string_2( reduced_cell.c(), 4 ) + " " +
+                                         double2string_2( reduced_cell.alpha().value_in_degrees(), 3 ) + " " +
+                                         double2string_2( reduced_cell.beta().value_in_degrees(), 3 ) + " " +
+                                         double2string_2( reduced_cell.gamma().value_in_degrees(), 3 ) + " " +
+                                         ( ( matches.empty() || ( matches[0] == i ) ) ? std::string( "-" ) : file_list.value( matches[0] ).file_name() ) );
+        }
+    MACRO_END_GAME
+}
+
+int command_hkl_compare( int argc, char** argv )
+{
+    try // R1 and wR2 of the F^2 calculated from the .cif files in FileList.txt against the SHELX .hkl files with the same names.
+    {
+        if ( ( argc != 2 ) && ( argc != 3 ) )
+            throw std::runtime_error( "Please give the name of a FileList.txt file and optionally HKLF5." );
+        FileName file_list_file_name( argv[ 1 ] );
+        FileList file_list( file_list_file_name );
+        SingleCrystalData::HKLFFormat hklf_format = SingleCrystalData::HKLF4;
+        if ( argc == 3 )
+        {
+            if ( to_upper( argv[ 2 ] ) != "HKLF5" )
+                throw std::runtime_error( "Second argument must be HKLF5." );
+            hklf_format = SingleCrystalData::HKLF5;
+        }
+        std::vector< std::string > lines( file_list.size() );
+        parallel_for( file_list.size(), 0, [&]( const size_t i )
+        {
+            CrystalStructure crystal_structure;
+            read_cif( file_list.value( i ), crystal_structure );
+            const SingleCrystalData observed( replace_extension( file_list.value( i ), "hkl" ), crystal_structure.crystal_lattice(), crystal_structure.space_group().laue_class(), hklf_format );
+            PowderPatternCalculator powder_pattern_calculator( crystal_structure, crystal_structure.space_group_symmetry_has_been_applied() ? PowderPatternCalculator::UNIT_CELL : PowderPatternCalculator::ASYMMETRIC_UNIT );
+            powder_pattern_calculator.set_reflection_list( observed.reflection_list() );
+            powder_pattern_calculator.calculate_structure_factors();
+            const RFactors R_factors = calculate_R_factors( observed, powder_pattern_calculator.reflection_list() );
+            lines[i] = file_list.value( i ).file_name() + " " +
+                       size_t2string( R_factors.nreflections_ ) + " " +
+                       double2string_2( 100.0 * R_factors.R1_, 2 ) + " " +
+                       double2string_2( 100.0 * R_factors.wR2_, 2 ) + " " +
+                       double2string_2( R_factors.scale_, 6 );
+        } );
+        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "hkl_compare", "txt" ) );
+        text_file_writer.write_line( "# file nreflections R1(%) wR2(%) scale" );
+        for ( size_t i( 0 ); i != lines.size(); ++i )
+            text_file_writer.write_line( lines[i] );
+    MACRO_END_GAME
+}
+
+int command_match_table( int argc, char** argv )
+{
+    try // Filter and rank the rows of a crystal structure prediction match table, optionally joined with the structure files in a FileList.txt.
+    {
+        if ( argc < 2 )
+            throw std::runtime_error( "Please give the name of a match table, optionally followed by options." );
+        FileName table_file_name( argv[ 1 ] );
+        PowderMatchTableQuery query;
+        size_t k( std::numeric_limits< size_t >::max() );
+        FileName file_list_file_name;
+        bool join( false );
+        for ( int i( 2 ); i < argc; ++i )
+        {
+            const std::string option( argv[ i ] );
+            // Options with one value
+            if ( ( option == "--top" ) || ( option == "--status" ) || ( option == "--structures" ) )
+            {
+                if ( i + 1 >= argc )
+                    throw std::runtime_error( option + " needs a value." );
+                const std::string value( argv[ ++i ] );
+                if ( option == "--top" )
+                    k = string2integer( value );
+                else if ( option == "--status" )
+                    query.status_ = value;
+                else
+                {
+                    file_list_file_name = FileName( value );
+                    join = true;
+                }
+            }
+            // Options with a window, min and max
+            else if ( ( option == "--energy" ) || ( option == "--energy-with-penalty" ) || ( option == "--density" ) || ( option == "--FOM" ) )
+            {
+                if ( i + 2 >= argc )
+                    throw std::runtime_error( option + " needs a minimum and a maximum." );
+                const double min = string2double( argv[ i + 1 ] );
+                const double max = string2double( argv[ i + 2 ] );
+                i += 2;
+                if ( option == "--energy" )
+                {
+                    query.energy_min_ = min;
+                    query.energy_max_ = max;
+                }
+                else if ( option == "--energy-with-penalty" )
+                {
+                    query.energy_with_penalty_min_ = min;
+                    query.energy_with_penalty_max_ = max;
+                }
+                else if ( option == "--density" )
+                {
+                    query.density_min_ = min;
+                    query.density_max_ = max;
+                }
+                else
+                {
+                    query.FOM_min_ = min;
+                    query.FOM_max_ = max;
+                }
+            }
+            else
+                throw std::runtime_error( "Unknown option " + option );
+        }
+        const PowderMatchTable table( table_file_name );
+        const std::vector< size_t > rows = table.top_k( k, table.select( query ) );
+        std::vector< size_t > file_indices;
+        FileList file_list;
+        if ( join )
+        {
+            file_list = FileList( file_list_file_name );
+            file_indices = table.join( file_list );
+        }
+        TextFileWriter text_file_writer( append_to_file_name( table_file_name, "_selected" ) );
+        text_file_writer.write_line( "# rank name energy_with_penalty energy density FOM space_group file" );
+        for ( size_t i( 0 ); i != rows.size(); ++i )
+        {
+            const size_t row = rows[i];
+            std::string file;
+            if ( ! join )
+                file = table.structure_file( row ).full_name();
+            else if ( file_indices[row] != std::numeric_limits< size_t >::max() )
+                file = file_list.value( file_indices[row] ).full_name();
+            else
+                file = "-";
+            text_file_writer.write_line( size_t2string( i + 1 ) + " " +
+                                         table.name( row ) + " " +
+                                         double2string_2( table.energy_with_penalty( row ), 6 ) + " " +
+                                         double2string_2( table.energy( row ), 6 ) + " " +
+                                         double2string_2( table.density( row ), 4 ) + " " +
+                                         double2string_2( table.figure_of_merit( row ), 4 ) + " " +
+                                         "\"" + table.space_group_name( row ) + "\" " +
+                                         file );
+        }
+        std::cout << rows.size() << " of " << table.size() << " rows selected." << std::endl;
+    MACRO_END_GAME
+}
+
+int command_family_similarity( int argc, char** argv )
+{
+    try // Powder-pattern similarity between all pairs of entries within each refcode family in FileList.txt.
+    {
+        MACRO_ONE_FILELISTNAME_AS_ARGUMENT
+        const RefcodeFamilyIndex refcode_family_index( file_list );
+        const std::vector< std::pair< size_t, size_t > > pairs = refcode_family_index.within_family_pairs();
+        // Only the entries in families with more than one member are needed
+        std::vector< size_t > pattern_indices( file_list.size(), file_list.size() );
+        std::vector< FileName > file_names;
+        for ( size_t i( 0 ); i != file_list.size(); ++i )
+        {
+            const size_t family = refcode_family_index.family_of_entry( i );
+            if ( ( family == refcode_family_index.nfamilies() ) || ( refcode_family_index.family_size( family ) < 2 ) )
+                continue;
+            pattern_indices[i] = file_names.size();
+            file_names.push_back( file_list.value( i ) );
+        }
+        BatchPowderPatternCalculator batch_powder_pattern_calculator;
+        batch_powder_pattern_calculator.set_wavelength( 1.54056 );
+        batch_powder_pattern_calculator.set_two_theta_start( Angle( 3.0, Angle::DEGREES ) );
+        batch_powder_pattern_calculator.set_two_theta_end( Angle( 35.0, Angle::DEGREES ) );
+        batch_powder_pattern_calculator.set_two_theta_step( Angle( 0.01, Angle::DEGREES ) );
+        batch_powder_pattern_calculator.set_FWHM( 0.1 );
+        batch_powder_pattern_calculator.calculate( FileList( file_names ) );
+        std::vector< double > similarities( pairs.size() );
+        parallel_for( pairs.size(), 0, [&]( const size_t k )
+        {
+            similarities[k] = normalised_weighted_cross_correlation( batch_powder_pattern_calculator.powder_pattern( pattern_indices[ pairs[k].first ] ),
+                                                                     batch_powder_pattern_calculator.powder_pattern( pattern_indices[ pairs[k].second ] ),
+                                                                     Angle( 1.0, Angle::DEGREES ) );
+        } );
+        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "family_similarities", "txt" ) );
+        text_file_writer.write_line( "# family file_1 file_2 similarity" );
+        for ( size_t k( 0 ); k != pairs.size(); ++k )
+            text_file_writer.write_line( refcode_family_index.family( refcode_family_index.family_of_entry( pairs[k].first ) ) + " " +
+                                         file_list.value( pairs[k].first ).file_name() + " " +
+                                         file_list.value( pairs[k].second ).file_name() + " " +
+                                         double2string_2( similarities[k], 4 ) );
+        std::cout << size_t2string( pairs.size() ) << " pairs in " << size_t2string( refcode_family_index.nfamilies() ) << " families." << std::endl;
+    MACRO_END_GAME
+}
+
+int command_inp( int argc, char** argv )
+{
+    try // Write .inp from .cif + two _restraints.txt files + .xye file.
+    {
+        if ( argc != 3 )
+            throw std::runtime_error( "Please give the name of a .cif file (or a FileList.txt file with .cif files) and a .xye file that need to be converted to a .inp file." );
+        if ( FileName( argv[ 1 ] ).extension() == "txt" )
+        {
+            FileName file_list_file_name( argv[ 1 ] );
+            FileList file_list( file_list_file_name );
+            std::vector< std::string > error_messages;
+            size_t nfailed = inp_writer( file_list, FileName( argv[ 2 ] ), error_messages );
+            for ( size_t i( 0 ); i != error_messages.size(); ++i )
+            {
+                if ( ! error_messages[i].empty() )
+                    std::cout << file_list.value( i ).full_name() << ": " << error_messages[i] << std::endl;
+            }
+            std::cout << size_t2string( file_list.size() - nfailed ) << " of " << size_t2string( file_list.size() ) << " .inp files written." << std::endl;
+        }
+        else
+            inp_writer( FileName( argv[ 1 ] ), FileName( argv[ 2 ] ) );
+    MACRO_END_GAME
+}
+
+int command_tls( int argc, char** argv )
+{
+    try // Write .inp for TLS from .cif + two _restraints.txt files.
+    {
+        if ( argc < 2 )
+            throw std::runtime_error( "Please give the names of one or more .cif files that need to be converted to _TLS.inp files." );
+        std::vector< FileName > input_file_names;
+        for ( int i( 1 ); i != argc; ++i )
+            input_file_names.push_back( FileName( argv[ i ] ) );
+        TLSWriter( input_file_names );
+     MACRO_END_GAME
+}
+
+int command_tls_from_inp( int argc, char** argv )
+{
+    try // Write .inp for TLS from a .inp file.
+    {
+        if ( argc < 2 )
+            throw std::runtime_error( "Please give the names of one or more .inp files that need to be converted to _TLS.inp." );
+        std::vector< FileName > input_file_names;
+        for ( int i( 1 ); i != argc; ++i )
+            input_file_names.push_back( FileName( argv[ i ] ) );
+        TLSWriter_2( input_file_names );
+     MACRO_END_GAME
+}
+
+int command_raw2xye( int argc, char** argv )
+{
+    try // Convert powder pattern in ASCII .raw format to .xye.
+    {
+        if ( argc != 2 )
+            throw std::runtime_error( "Please give the name of a .raw file." );
+        FileName input_file_name( argv[ 1 ] );
+        PowderPattern powder_pattern;
+        powder_pattern.read_raw( input_file_name );
+        powder_pattern.save_xye( replace_extension( input_file_name, "xye" ), true );
+    MACRO_END_GAME
+}
+
+int command_xrdml2xye( int argc, char** argv )
+{
+    try // Convert powder pattern in .xrdml format to .xye.
+    {
+        if ( argc != 2 )
+            throw std::runtime_error( "Please give the name of a .xrdml file." );
+        FileName input_file_name( argv[ 1 ] );
+        PowderPattern powder_pattern;
+        powder_pattern.read_xrdml( input_file_name );
+        std::cout << powder_pattern.average_two_theta_step() << std::endl;
+        powder_pattern.save_xye( replace_extension( input_file_name, "xye" ), true );
+    MACRO_END_GAME
+}
+
+int command_brml2xye( int argc, char** argv )
+{
+    try // Convert powder pattern in .brml format to .xye.
+    {
+        // First, the user must change .brml to .zip and extract all files
+        if ( argc != 2 )
+            throw std::runtime_error( "Please give the name and path of the RawData0.xml file." );
+        FileName input_file_name( argv[ 1 ] );
+        PowderPattern powder_pattern;
+        powder_pattern.read_brml( input_file_name );
+        powder_pattern.save_xye( replace_extension( input_file_name, "xye" ), true );
+    MACRO_END_GAME
+}
+
+int command_mdi2xye( int argc, char** argv )
+{
+    try // Convert powder pattern in .MDI format to .xye.
+    {
+        if ( argc != 2 )
+            throw std::runtime_error( "Please give the name of a .mdi file." );
+        FileName input_file_name( argv[ 1 ] );
+        PowderPattern powder_pattern;
+        powder_pattern.read_mdi( input_file_name );
+        powder_pattern.save_xye( replace_extension( input_file_name, "xye" ), true );
+    MACRO_END_GAME
+}
+
+int command_recalculate_esds( int argc, char** argv )
+{
+    try // Recalculate ESDs XRPD pattern.
+    {
+        MACRO_ONE_XYEFILENAME_AS_ARGUMENT
+        powder_pattern.recalculate_estimated_standard_deviations();
+        std::cout << powder_pattern.average_two_theta_step() << std::endl;
+        powder_pattern.save_xye( append_to_file_name( input_file_name, "_new_ESDs" ), true );
+    MACRO_END_GAME
+}
+
+int command_sudoku_benchmark( int argc, char** argv )
+{
+    try // Sudoku batch benchmark: solve a file with one Sudoku per line with each strategy.
+    {
+        if ( argc != 2 )
+            throw std::runtime_error( "Please give the name of a file with one Sudoku per line." );
+        std::vector< Sudoku > sudokus = read_sudokus( FileName( argv[ 1 ] ) );
+        std::cout << benchmark( sudokus, BACKTRACKING      ).report() << std::endl;
+        std::cout << benchmark( sudokus, PROPAGATION_RULES ).report() << std::endl;
+    MACRO_END_GAME
+}
+
+int command_sudoku_generate( int argc, char** argv )
+{
+    try // Generate Sudokus with a unique solution, written to generated_sudokus.txt in the format of read_sudokus().
+    {
+        if ( ( argc < 2 ) || ( argc > 4 ) )
+            throw std::runtime_error( "Please give the number of Sudokus and optionally the difficulty (1-5, 0 is any) and the seed." );
+        SudokuGenerator generator;
+        if ( argc > 2 )
+            generator.set_target_difficulty( string2integer( argv[ 2 ] ) );
+        if ( argc > 3 )
+            generator.set_seed( string2integer( argv[ 3 ] ) );
+        const std::vector< GeneratedSudoku > sudokus = generator.generate( string2integer( argv[ 1 ] ) );
+        TextFileWriter text_file_writer( FileName( "generated_sudokus.txt" ) );
+        text_file_writer.write_line( "# One Sudoku per line, the comment above each Sudoku gives the number of clues and the difficulty" );
+        for ( size_t i( 0 ); i != sudokus.size(); ++i )
+        {
+            text_file_writer.write_line( "# " + size_t2string( sudokus[i].nclues_ ) + " " + size_t2string( sudokus[i].difficulty_ ) );
+            text_file_writer.write_line( sudokus[i].puzzle_ );
+        }
+    MACRO_END_GAME
+}
+
+int command_screen( int argc, char** argv )
+{
+    try // Rank the .cif files in a FileList.txt by the similarity of their powder patterns to a target pattern.
+    {
+        // "--cache <directory>" at the end keeps the calculated patterns in a PowderPatternCache
+        std::string cache_directory;
+        if ( ( argc > 2 ) && ( std::string( argv[ argc - 2 ] ) == "--cache" ) )
+        {
+            cache_directory = argv[ argc - 1 ];
+            argc -= 2;
+        }
+        if ( ( argc != 3 ) && ( argc != 7 ) )
+            throw std::runtime_error( "Please give the name of a .xye or .cif file and a FileList.txt file, optionally followed by the numbers of workers for the four stages and --cache <directory>." );
+        FileName target_file_name( argv[ 1 ] );
+        FileName file_list_file_name( argv[ 2 ] );
+        PowderPattern target_powder_pattern;
+        if ( to_lower( target_file_name.extension() ) == "cif" )
+        {
+            CrystalStructure target_crystal_structure;
+            read_cif( target_file_name, target_crystal_structure );
+            target_crystal_structure.apply_space_group_symmetry();
+            PowderPatternCalculator powder_pattern_calculator( target_crystal_structure );
+            powder_pattern_calculator.set_wavelength( 1.54056 );
+            powder_pattern_calculator.set_two_theta_start( Angle( 3.0, Angle::DEGREES ) );
+            powder_pattern_calculator.set_two_theta_end( Angle( 35.0, Angle::DEGREES ) );
+            powder_pattern_calculator.set_two_theta_step( Angle( 0.01, Angle::DEGREES ) );
+            powder_pattern_calculator.set_FWHM( 0.1 );
+            powder_pattern_calculator.calculate( target_powder_pattern );
+        }
+        else
+            target_powder_pattern.read_xye( target_file_name );
+        FileList file_list( file_list_file_name );
+        if ( file_list.empty() )
+            throw std::runtime_error( std::string( "No files in file list " ) + file_list_file_name.full_name() );
+        ScreeningPipeline screening_pipeline( target_powder_pattern );
+        PowderPatternCache powder_pattern_cache( cache_directory );
+        if ( ! cache_directory.empty() )
+            screening_pipeline.set_cache( powder_pattern_cache );
+        if ( argc == 7 )
+        {
+            for ( size_t s( 0 ); s != 4; ++s )
+            {
+                int nworkers = string2integer( argv[ s + 3 ] );
+                if ( nworkers < 1 )
+                    throw std::runtime_error( "Every stage needs at least one worker." );
+                screening_pipeline.set_nworkers( static_cast< ScreeningPipeline::Stage >( s ), nworkers );
+            }
+        }
+        std::vector< double > similarities;
+        std::vector< std::string > error_messages;
+        size_t nfailed = screening_pipeline.run( file_list, similarities, error_messages );
+        std::vector< size_t > ranking = rank( similarities );
+        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "Ranking", "txt" ) );
+        for ( size_t i( 0 ); i != ranking.size(); ++i )
+        {
+            if ( error_messages[ ranking[i] ].empty() )
+                text_file_writer.write_line( double2string( similarities[ ranking[i] ] ) + " " + file_list.value( ranking[i] ).full_name() );
+        }
+        for ( size_t i( 0 ); i != error_messages.size(); ++i )
+        {
+            if ( ! error_messages[i].empty() )
+                std::cout << file_list.value( i ).full_name() + ": " + error_messages[i] << std::endl;
+        }
+        std::cout << screening_pipeline.report() << std::endl;
+        if ( ! cache_directory.empty() )
+            std::cout << "Cache: " + size_t2string( powder_pattern_cache.nhits() ) + " hits, " + size_t2string( powder_pattern_cache.nmisses() ) + " misses." << std::endl;
+        if ( nfailed != 0 )
+            std::cout << size_t2string( nfailed ) + " of " + size_t2string( file_list.size() ) + " files failed." << std::endl;
+    MACRO_END_GAME
+}
+
+int command_variable_cell_screen( int argc, char** argv )
+{
+    try // Rank the .cif files in a FileList.txt by their similarity to an experimental powder pattern, allowing small changes of the unit cell.
+    {
+        if ( ( argc != 3 ) && ( argc != 4 ) )
+            throw std::runtime_error( "Please give the name of a .xye file and a FileList.txt file, optionally followed by the FWHM." );
+        FileName target_file_name( argv[ 1 ] );
+        FileName file_list_file_name( argv[ 2 ] );
+        PowderPattern target_powder_pattern;
+        target_powder_pattern.read_xye( target_file_name );
+        FileList file_list( file_list_file_name );
+        if ( file_list.empty() )
+            throw std::runtime_error( std::string( "No files in file list " ) + file_list_file_name.full_name() );
+        VariableCellMatch variable_cell_match( target_powder_pattern );
+        if ( argc == 4 )
+            variable_cell_match.set_FWHM( string2double( argv[ 3 ] ) );
+        std::vector< VariableCellMatchResult > results;
+        std::vector< std::string > error_messages;
+        size_t nfailed = variable_cell_match.match( file_list, results, error_messages );
+        std::vector< double > similarities( results.size() );
+        for ( size_t i( 0 ); i != results.size(); ++i )
+            similarities[i] = results[i].similarity_;
+        std::vector< size_t > ranking = rank( similarities );
+        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "VariableCellRanking", "txt" ) );
+        text_file_writer.write_line( "# similarity similarity_before cell_deformation zero_point a b c alpha beta gamma file" );
+        for ( size_t i( 0 ); i != ranking.size(); ++i )
+        {
+            if ( ! error_messages[ ranking[i] ].empty() )
+                continue;
+            const VariableCellMatchResult & result = results[ ranking[i] ];
+            text_file_writer.write_line( double2string( result.similarity_ ) + " " + double2string( result.similarity_before_ ) + " " +
+                                         double2string( result.cell_deformation_ ) + " " + double2string( result.zero_point_.value_in_degrees() ) + " " +
+                                         double2string( result.crystal_lattice_.a() ) + " " + double2string( result.crystal_lattice_.b() ) + " " + double2string( result.crystal_lattice_.c() ) + " " +
+                                         double2string( result.crystal_lattice_.alpha().value_in_degrees() ) + " " + double2string( result.crystal_lattice_.beta().value_in_degrees() ) + " " +
+                                         double2string( result.crystal_lattice_.gamma().value_in_degrees() ) + " " + file_list.value( ranking[i] ).full_name() );
+        }
+        for ( size_t i( 0 ); i != error_messages.size(); ++i )
+        {
+            if ( ! error_messages[i].empty() )
+                std::cout << file_list.value( i ).full_name() + ": " + error_messages[i] << std::endl;
+        }
+        if ( nfailed != 0 )
+            std::cout << size_t2string( nfailed ) + " of " + size_t2string( file_list.size() ) + " files failed." << std::endl;
+    MACRO_END_GAME
+}
+
+int command_serve( int argc, char** argv )
+{
+    try // Keep the powder patterns of a FileList.txt in memory and answer requests on a local socket.
+    {
+        if ( ( argc != 2 ) && ( argc != 3 ) )
+            throw std::runtime_error( "Please give the name of a FileList.txt file, optionally followed by the name of the socket." );
+        FileName file_list_file_name( argv[ 1 ] );
+        FileList file_list( file_list_file_name );
+        if ( file_list.empty() )
+            throw std::runtime_error( std::string( "No files in file list " ) + file_list_file_name.full_name() );
+        FileName socket_file_name( file_list_file_name.directory(), "Fourier", "socket" );
+        if ( argc == 3 )
+            socket_file_name = FileName( argv[ 2 ] );
+        PowderPatternServer powder_pattern_server( file_list );
+        powder_pattern_server.run( socket_file_name );
+    MACRO_END_GAME
+}
+
+int command_trajectory( int argc, char** argv )
+{
+    try // Average structure and ADPs from a set of frames (as cif files).
+    {
+        // "--checkpoint <n>" at the end saves the state every n frames, a stopped analysis resumes from it
+        size_t checkpoint_interval( 0 );
+        if ( ( argc > 2 ) && ( std::string( argv[ argc - 2 ] ) == "--checkpoint" ) )
+        {
+            const int n = string2integer( argv[ argc - 1 ] );
+            if ( n < 1 )
+                throw std::runtime_error( "The checkpoint interval must be positive." );
+            checkpoint_interval = n;
+            argc -= 2;
+        }
+        if ( ( argc != 2 ) && ( argc != 5 ) )
+            throw std::runtime_error( "Please give the name of a FileList.txt file, optionally followed by the supercell dimensions u v w and by --checkpoint <n>." );
+        FileName file_list_file_name( argv[ 1 ] );
+        FileList file_list( file_list_file_name );
+        if ( file_list.empty() )
+            throw std::runtime_error( std::string( "No files in file list " ) + file_list_file_name.full_name() );
+        int supercell[3] = { 1, 1, 1 };
+        if ( argc == 5 )
+        {
+            for ( size_t i( 0 ); i != 3; ++i )
+            {
+                supercell[i] = string2integer( argv[ i + 2 ] );
+                if ( supercell[i] < 1 )
+                    throw std::runtime_error( "The supercell dimensions must be positive." );
+            }
+        }
+        AnalyseTrajectory analyse_trajectory( file_list, supercell[0], supercell[1], supercell[2], SpaceGroup(), Matrix3D(), 0, checkpoint_interval );
+    MACRO_END_GAME
+}
+
+int command_pdf( int argc, char** argv )
+{
+    try // Pair-distribution function and total structure factor of a .cif file or of the frames of an MD trajectory.
+    {
+        if ( ( argc != 2 ) && ( argc != 3 ) && ( argc != 4 ) )
+            throw std::runtime_error( "Please give the name of a .cif, .xyz or FileList.txt file, optionally followed by r_max and by neutrons or electrons." );
+        FileName input_file_name( argv[ 1 ] );
+        const double r_max = ( argc > 2 ) ? string2double( argv[ 2 ] ) : 20.0;
+        RadiationType radiation_type = X_RAYS;
+        if ( argc == 4 )
+        {
+            if ( to_upper( argv[ 3 ] ) == "NEUTRONS" )
+                radiation_type = NEUTRONS;
+            else if ( to_upper( argv[ 3 ] ) == "ELECTRONS" )
+                radiation_type = ELECTRONS;
+            else
+                throw std::runtime_error( "Third argument must be neutrons or electrons." );
+        }
+        PairDistributionFunction pdf( r_max, 0.01, radiation_type );
+        if ( to_upper( input_file_name.extension() ) == "CIF" )
+        {
+            CrystalStructure crystal_structure;
+            read_cif( input_file_name, crystal_structure );
+            pdf.add_frame( crystal_structure, 0 );
+        }
+        else if ( to_upper( input_file_name.extension() ) == "XYZ" )
+            pdf.add_frames( XYZTrajectory( input_file_name ) );
+        else
+            pdf.add_frames( CifTrajectory( FileList( input_file_name ) ) );
+        std::cout << "Averaged over " << pdf.nframes() << " frames." << std::endl;
+        TextFileWriter pdf_writer( FileName( input_file_name.directory(), input_file_name.file_name() + "_pdf", "txt" ) );
+        pdf_writer.write_line( "# r g(r) G(r)" );
+        for ( size_t i( 0 ); i != pdf.nbins(); ++i )
+            pdf_writer.write_line( double2string_2( pdf.r( i ), 3 ) + " " + double2string_2( pdf.g( i ), 6 ) + " " + double2string_2( pdf.G( i ), 6 ) );
+        std::vector< double > Q;
+        std::vector< double > S;
+        pdf.structure_factor( Q, S );
+        TextFileWriter sq_writer( FileName( input_file_name.directory(), input_file_name.file_name() + "_sq", "txt" ) );
+        sq_writer.write_line( "# Q S(Q)" );
+        for ( size_t i( 0 ); i != Q.size(); ++i )
+            sq_writer.write_line( double2string_2( Q[i], 5 ) + " " + double2string_2( S[i], 6 ) );
+    MACRO_END_GAME
+}
+
+int command_solve( int argc, char** argv )
+{
+    try // Direct-space structure solution by simulated annealing.
+    {
+        // "--checkpoint" at the end saves every finished run, a stopped solution resumes with the runs that had not finished
+        bool use_checkpoint( false );
+        if ( ( argc > 3 ) && ( std::string( argv[ argc - 1 ] ) == "--checkpoint" ) )
+        {
+            use_checkpoint = true;
+            --argc;
+        }
+        if ( ( argc != 3 ) && ( argc != 4 ) && ( argc != 5 ) )
+            throw std::runtime_error( "Please give the name of a .cif file with the unit cell, the space group and one molecule, the name of a background-subtracted .xye file and optionally the number of trials per run, the number of runs and --checkpoint." );
+        FileName input_file_name( argv[ 1 ] );
+        CrystalStructure crystal_structure;
+        read_cif( input_file_name, crystal_structure );
+        FileName pattern_file_name( argv[ 2 ] );
+        PowderPattern experimental_pattern( pattern_file_name );
+        FlexibleMolecule molecule( crystal_structure );
+        molecule.add_rotatable_bonds();
+        std::cout << "Molecule with " << molecule.natoms() << " atoms and " << molecule.ntorsions() << " torsions." << std::endl;
+        DirectSpaceSolver solver( crystal_structure.crystal_lattice(), crystal_structure.space_group(), experimental_pattern );
+        solver.add_molecule( molecule );
+        if ( argc > 3 )
+            solver.set_ntrials( string2integer( argv[ 3 ] ) );
+        if ( argc > 4 )
+            solver.set_nruns( string2integer( argv[ 4 ] ) );
+        if ( use_checkpoint )
+            solver.set_checkpoint( FileName( input_file_name.directory(), input_file_name.file_name() + "_checkpoint", "bin" ) );
+        solver.solve();
+        CrystalStructure solution = solver.crystal_structure( solver.best_states() );
+        solution.save_cif( append_to_file_name( input_file_name, "_solved" ) );
+    MACRO_END_GAME
+}
+
+int command_BFDH( int argc, char** argv )
+{
+    try // BFDH morphology.
+    {
+        if ( argc < 2 )
+            throw std::runtime_error( "Please give the name of one or more .cif files." );
+        for ( int i( 1 ); i != argc; ++i )
+        {
+            FileName input_file_name( argv[ i ] );
+            CrystalStructure crystal_structure;
+            read_cif( input_file_name, crystal_structure );
+            CalculateBFDH BFDH( crystal_structure.crystal_lattice(), crystal_structure.space_group() );
+            std::cout << input_file_name.full_name() << ": " << BFDH.nfaces() << " faces" << std::endl;
+            BFDH.show();
+        }
+    MACRO_END_GAME
+}
+
+int command_decompose( int argc, char** argv )
+{
+    try // Le Bail and Pawley intensity extraction.
+    {
+        if ( ( argc != 3 ) && ( argc != 4 ) )
+            throw std::runtime_error( "Please give the name of a .cif file with the unit cell and the space group, the name of an .xye file and optionally the FWHM in degrees 2theta." );
+        FileName input_file_name( argv[ 1 ] );
+        CrystalStructure crystal_structure;
+        read_cif( input_file_name, crystal_structure );
+        FileName pattern_file_name( argv[ 2 ] );
+        PowderPattern experimental_pattern( pattern_file_name );
+        const double FWHM = ( argc > 3 ) ? string2double( argv[ 3 ] ) : 0.1;
+        // Only the unit cell and the space group are used, for the reflection list
+        PowderPatternCalculator powder_pattern_calculator( crystal_structure, crystal_structure.space_group_symmetry_has_been_applied() ? PowderPatternCalculator::UNIT_CELL : PowderPatternCalculator::ASYMMETRIC_UNIT );
+        powder_pattern_calculator.set_wavelength( experimental_pattern.wavelength() );
+        powder_pattern_calculator.set_two_theta_end( experimental_pattern.two_theta_end() );
+        powder_pattern_calculator.calculate_reflection_list();
+        PseudoVoigtPeakShape peak_shape_function( FWHM, 0.9 );
+        WholePatternDecomposition whole_pattern_decomposition( experimental_pattern, powder_pattern_calculator.reflection_list(), peak_shape_function );
+        whole_pattern_decomposition.set_nbackground_terms( 6 );
+        // Le Bail first, it is robust and gives the background, then Pawley for the least-squares intensities
+        whole_pattern_decomposition.le_bail();
+        std::cout << "Le Bail: " << whole_pattern_decomposition.nreflections() << " reflections, Rwp = " << whole_pattern_decomposition.Rwp() << std::endl;
+        whole_pattern_decomposition.Pawley();
+        std::cout << "Pawley: Rwp = " << whole_pattern_decomposition.Rwp() << std::endl;
+        whole_pattern_decomposition.reflection_list().save( replace_extension( pattern_file_name, "hkl" ) );
+        whole_pattern_decomposition.calculated_pattern().save_xye( append_to_file_name( pattern_file_name, "_Pawley" ), true );
+    MACRO_END_GAME
+}
+
+int command_index( int argc, char** argv )
+{
+    try // Peak search and autoindexing.
+    {
+        if ( ( argc != 2 ) && ( argc != 3 ) )
+            throw std::runtime_error( "Please give the name of an .xye file and optionally the 2theta tolerance in degrees." );
+        FileName input_file_name( argv[ 1 ] );
+        PowderPattern powder_pattern( input_file_name );
+        const std::vector< PowderPatternPeak > peaks = PeakSearch().find_peaks( powder_pattern );
+        std::cout << peaks.size() << " peaks found" << std::endl;
+        for ( size_t i( 0 ); i != peaks.size(); ++i )
+            std::cout << double2string( peaks[i].two_theta_.value_in_degrees(), 4 ) << " " << double2string( peaks[i].intensity_, 1 ) << std::endl;
+        if ( peaks.empty() )
+            throw std::runtime_error( "No peaks found." );
+        Autoindexing autoindexing( peak_positions( peaks, 20 ), powder_pattern.wavelength() );
+        if ( argc > 2 )
+            autoindexing.set_tolerance( Angle::from_degrees( string2double( argv[ 2 ] ) ) );
+        const std::vector< IndexingSolution > solutions = autoindexing.index();
+        std::cout << solutions.size() << " solutions" << std::endl;
+        for ( size_t i( 0 ); i != solutions.size(); ++i )
+        {
+            const CrystalLattice & crystal_lattice = solutions[i].crystal_lattice_;
+            std::cout << LatticeSystem2string( crystal_lattice.lattice_system() ) << " " <<
+                         double2string( crystal_lattice.a(), 4 ) << " " << double2string( crystal_lattice.b(), 4 ) << " " << double2string( crystal_lattice.c(), 4 ) << " " <<
+                         double2string( crystal_lattice.alpha().value_in_degrees(), 3 ) << " " << double2string( crystal_lattice.beta().value_in_degrees(), 3 ) << " " << double2string( crystal_lattice.gamma().value_in_degrees(), 3 ) << " " <<
+                         "V = " << double2string( crystal_lattice.volume(), 1 ) << " M = " << double2string( solutions[i].M_, 1 ) << " F = " << double2string( solutions[i].F_, 1 ) <<
+                         " unindexed = " << solutions[i].nunindexed_ << std::endl;
+        }
+    MACRO_END_GAME
+}
+
+int command_verify_kernels( int argc, char** argv )
+{
+    try // Compare the optimised numeric kernels with the reference implementations.
+    {
+        if ( argc > 3 )
+            throw std::runtime_error( "Please give at most the number of random cases and the seed." );
+        const size_t ncases = ( argc > 1 ) ? string2integer( argv[ 1 ] ) : 20;
+        const uint64_t seed = ( argc > 2 ) ? string2integer( argv[ 2 ] ) : 1;
+        std::vector< KernelComparison > comparisons = verify_kernels( ncases, seed );
+        bool all_passed( true );
+        for ( size_t i( 0 ); i != comparisons.size(); ++i )
+        {
+            std::cout << comparisons[i].report() << std::endl;
+            if ( ! comparisons[i].passed() )
+                all_passed = false;
+        }
+        if ( ! all_passed )
+            return 1;
+    MACRO_END_GAME
+}
+
+int command_copy_tree( int argc, char** argv )
+{
+    try // Copy a directory tree, e.g. a project directory on a network share.
+    {
+        std::vector< std::string > arguments;
+        size_t nthreads( 0 );
+        bool incremental( true );
+        for ( int i( 1 ); i != argc; ++i )
+        {
+            const std::string argument( argv[i] );
+            if ( ( argument == "--jobs" ) && ( i + 1 != argc ) )
+                nthreads = string2integer( argv[ ++i ] );
+            else if ( argument == "--full" )
+                incremental = false;
+            else
+                arguments.push_back( argument );
+        }
+        if ( arguments.size() != 2 )
+            throw std::runtime_error( "Please give the source directory and the destination directory." );
+        CopyStatistics statistics = copy_directory_tree( arguments[0], arguments[1], nthreads, incremental );
+        std::cout << statistics.nfiles_copied_ << " files copied (" << statistics.nbytes_copied_ << " bytes), " << statistics.nfiles_skipped_ << " unchanged files skipped" << std::endl;
+    MACRO_END_GAME
+}
 
-            result.save_xye( replace_extension( file_list.value( i ), "xye" ), true );
-        }
+// The original scratchpad: only the first block that is reached is run. Run with "Fourier scratchpad <arguments>".
+int command_scratchpad( int argc, char** argv )
+{
+    try // Add class.
+    {
+        add_class( "PowderMatchTable" );
     MACRO_END_GAME
 
     try // Sudoku.
@@ -1069,11 +2230,12 @@ int main( int argc, char** argv )
         std::string header_str( "Rank " );
         // Write header
         text_file_writer.write_line( header_str );
+        ProgressReporter progress( "Now reading cif... ", file_list.size() );
         for ( size_t i( 0 ); i != file_list.size(); ++i )
 //        for ( size_t i( 0 ); i != 10; ++i )
         {
             CrystalStructure crystal_structure;
-            std::cout << "Now reading cif... " + file_list.value( i ).full_name() << std::endl;
+            progress.tick( file_list.value( i ).full_name() );
             read_cif( file_list.value( i ), crystal_structure );
             CrystalLattice crystal_lattice = crystal_structure.crystal_lattice();
             bool Zprime_is_two( false );
@@ -1172,13 +2334,6 @@ int main( int argc, char** argv )
         }
     MACRO_END_GAME
 
-    try // Write .inp from .cif + two _restraints.txt files + .xye file.
-    {
-        if ( argc != 3 )
-            throw std::runtime_error( "Please give the name of a .cif file and a .xye file that need to be converted to a .inp file." );
-        inp_writer( FileName( argv[ 1 ] ), FileName( argv[ 2 ] ) );
-    MACRO_END_GAME
-
     try // Generate R input file for Pawley or Loopstra-Rietveld plot.
         {
         if ( argc != 3 )
@@ -1204,16 +2359,6 @@ int main( int argc, char** argv )
         std::cout << "Cumulative intensity = " << powder_pattern.cumulative_intensity() << std::endl;
     MACRO_END_GAME
 
-    try // Convert powder pattern in ASCII .raw format to .xye.
-    {
-        if ( argc != 2 )
-            throw std::runtime_error( "Please give the name of a .raw file." );
-        FileName input_file_name( argv[ 1 ] );
-        PowderPattern powder_pattern;
-        powder_pattern.read_raw( input_file_name );
-        powder_pattern.save_xye( replace_extension( input_file_name, "xye" ), true );
-    MACRO_END_GAME
-
     // Rotate group.
     try
     {
@@ -1756,117 +2901,6 @@ int main( int argc, char** argv )
         powder_pattern.save_xye( FileName( "/Volumes/Staff/jvds/AMS_ModelSystems/EthylenediamineTartrate/powder_pattern.xye" ), false );
     MACRO_END_GAME
 
-    try // Find voids for FileList.txt.
-    {
-        MACRO_ONE_FILELISTNAME_AS_ARGUMENT
-        std::cout << "WARNING: the molecular volume is estimated assuming that the smallest molecular volume corresponds to Z'=1." << std::endl;
-        std::cout << "WARNING: if the smallest molecular volume corresponds to Z'>1 or Z'<1 then the results will be wrong." << std::endl;
-        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "Voids", "txt" ) );
-        std::vector< double > total_voids_volumes_per_symmetry_operator;
-        std::vector< std::string > identifiers;
-        std::vector< double > total_void_volumes;
-        std::vector< double > molecular_volumes;
-        std::vector< double > unit_cell_volumes;
-        text_file_writer.write_line( "Identifier | total void volume | ( unit-cell volume - total void volume) / number of symmetry operators" );
-        if ( file_list.empty() )
-            return 0;
-        size_t nfiles = file_list.size();
-        total_voids_volumes_per_symmetry_operator.reserve( nfiles );
-        identifiers.reserve( nfiles );
-        total_void_volumes.reserve( nfiles );
-        molecular_volumes.reserve( nfiles );
-        unit_cell_volumes.reserve( nfiles );
-        double smallest_molecular_volume( 0.0 );
-        for ( size_t i( 0 ); i != nfiles; ++i )
-        {
-            identifiers.push_back( FileName( "", file_list.value( i ).file_name(), file_list.value( i ).extension() ).full_name() );
-            CrystalStructure crystal_structure;
-            std::cout << "Now reading cif... " + file_list.value( i ).full_name() << std::endl;
-            read_cif( file_list.value( i ), crystal_structure );
-            unit_cell_volumes.push_back( crystal_structure.crystal_lattice().volume() );
-            crystal_structure.apply_space_group_symmetry();
-            double total_void_volume = find_voids( crystal_structure );
-            total_void_volumes.push_back( total_void_volume );
-            total_voids_volumes_per_symmetry_operator.push_back( total_void_volume / crystal_structure.space_group().nsymmetry_operators() );
-            double molecular_volume = ( crystal_structure.crystal_lattice().volume() - total_void_volume ) / crystal_structure.space_group().nsymmetry_operators();
-            molecular_volumes.push_back( molecular_volume );
-            if ( ( i == 0 ) || ( molecular_volume < smallest_molecular_volume ) )
-                smallest_molecular_volume = molecular_volume;
-            text_file_writer.write_line( FileName( "", file_list.value( i ).file_name(), file_list.value( i ).extension() ).full_name() + " " +
-                                         double2string( total_void_volume ) + " " +
-                                         double2string( molecular_volume ) );
-        }
-        std::vector< double > voids_volumes_per_Z;
-        for ( size_t i( 0 ); i != nfiles; ++i )
-        {
-            // round_to_int( molecular_volumes[i] / smallest_molecular_volume ) = Z'
-            voids_volumes_per_Z.push_back( total_voids_volumes_per_symmetry_operator[i] / round_to_int( molecular_volumes[i] / smallest_molecular_volume ) );
-        }
-        text_file_writer.write_line( "##### customer specific #####" );
-        text_file_writer.write_line( "Rank/Form Void volume Void fraction" );
-        text_file_writer.write_line( "              [A3/Z]              " );
-        for ( size_t i( 0 ); i != nfiles; ++i )
-        {
-            if ( voids_volumes_per_Z[i] < 0.000001 )
-                continue;
-            text_file_writer.write_line( FileName( "", file_list.value( i ).file_name(), "" ).full_name() + " " +
-                                         double2string_2( voids_volumes_per_Z[i], 0 ) + " " +
-                                         double2string_2( 100.0 * ( total_void_volumes[i]/unit_cell_volumes[i] ), 2 ) + "%" );
-        }
-        std::vector< size_t > sorted_map = sort( voids_volumes_per_Z );
-        size_t iStart;
-        for ( iStart = 0; iStart != nfiles; ++iStart )
-        {
-            if ( voids_volumes_per_Z[ sorted_map[iStart] ] > 20.0 )
-                break;
-        }
-
-        if ( iStart == nfiles )
-        {
-            text_file_writer.write_line( "There are no voids greater than 20 A3/Z." );
-        }
-        else
-        {
-            text_file_writer.write_line( "##### sorted #####" );
-            for ( size_t i( iStart ); i != nfiles; ++i )
-                text_file_writer.write_line( identifiers[ sorted_map[i] ] + " " + double2string( voids_volumes_per_Z[ sorted_map[i] ] ) );
-            text_file_writer.write_line();
-            if ( (nfiles - iStart) == 1 )
-            {
-                text_file_writer.write( "Rank " );
-                text_file_writer.write( size_t2string( sorted_map[iStart] + 1 ) );
-                text_file_writer.write( " contains voids amounting to " );
-                text_file_writer.write( double2string_2( voids_volumes_per_Z[sorted_map[iStart]], 0 ) );
-                text_file_writer.write( " A3/Z." );
-            }
-            else
-            {
-//        Ranks 12, 22 5, 17, 1, 9 and 10 contain voids amounting to 20, 21, 21, 24, 28, 40 and 45 �3/Z, respectively.
-                text_file_writer.write( "Ranks " );
-                for ( size_t i( iStart ); i != nfiles; ++i )
-                {
-                    if ( i == nfiles - 1 )
-                        text_file_writer.write( " and "  );
-                    else if ( i != iStart )
-                        text_file_writer.write( ", "  );
-                    text_file_writer.write( size_t2string( sorted_map[i] + 1 ) );
-                }
-                text_file_writer.write( " contain voids amounting to " );
-                for ( size_t i( iStart ); i != nfiles; ++i )
-                {
-                    if ( i == nfiles - 1 )
-                        text_file_writer.write( " and "  );
-                    else if ( i != iStart )
-                        text_file_writer.write( ", "  );
-                    text_file_writer.write( double2string_2( voids_volumes_per_Z[ sorted_map[i] ], 0 ) );
-                }
-                text_file_writer.write( " A3/Z, respectively." );
-            }
-            text_file_writer.write( " Of interest are voids that are greater than about 20 A3/Z: 21.5 A3/Z suffices to store a water molecule (at least in terms of volume), a chloride ion is about 25 A3/Z." );
-            text_file_writer.write_line( " Voids between 15 and 20 A3/Z are quite common, but voids over 25 A3/Z are rare." );
-        }
-    MACRO_END_GAME
-
     // Calculate powder diffraction pattern.
     try
     {
@@ -1901,14 +2935,6 @@ int main( int argc, char** argv )
         std::cout << double2string( volume ) + " " + double2string( volume / crystal_structure.space_group().nsymmetry_operators() ) << std::endl;
     MACRO_END_GAME
 
-    try // Recalculate ESDs XRPD pattern.
-    {
-        MACRO_ONE_XYEFILENAME_AS_ARGUMENT
-        powder_pattern.recalculate_estimated_standard_deviations();
-        std::cout << powder_pattern.average_two_theta_step() << std::endl;
-        powder_pattern.save_xye( append_to_file_name( input_file_name, "_new_ESDs" ), true );
-    MACRO_END_GAME
-
     // Add OH hydrogen atom.
     try
     {
@@ -2335,32 +3361,6 @@ int main( int argc, char** argv )
             text_file_writer.write_line( "structure_" + size_t2string( i+1, 6, '0') + ".cif" );
     MACRO_END_GAME
 
-    try // Calculate powder pattern.
-    {
-        if ( argc != 2 )
-            throw std::runtime_error( "Please give the name of a .cif file." );
-        FileName input_file_name( argv[ 1 ] );
-        CrystalStructure crystal_structure;
-        std::cout << "Now reading cif... " + input_file_name.full_name() << std::endl;
-        read_cif( input_file_name, crystal_structure );
-        crystal_structure.apply_space_group_symmetry();
-        Angle two_theta_start( 5.0, Angle::DEGREES );
-        Angle two_theta_end(  50.0, Angle::DEGREES );
-        Angle two_theta_step( 0.02, Angle::DEGREES );
-        double FWHM( 0.1 );
-        std::cout << "Now calculating powder pattern... " << std::endl;
-        PowderPatternCalculator powder_pattern_calculator( crystal_structure );
-        powder_pattern_calculator.set_wavelength( 1.54056 );
-        powder_pattern_calculator.set_two_theta_start( two_theta_start );
-        powder_pattern_calculator.set_two_theta_end( two_theta_end );
-        powder_pattern_calculator.set_two_theta_step( two_theta_step );
-        powder_pattern_calculator.set_FWHM( FWHM );
-//        powder_pattern_calculator.set_preferred_orientation( MillerIndices( 0, 0, 1 ), 0.75 );
-        PowderPattern powder_pattern;
-        powder_pattern_calculator.calculate( powder_pattern );
-        powder_pattern.save_xye( FileName( input_file_name.directory(), input_file_name.file_name(), "xye" ), true );
-    MACRO_END_GAME
-
     try // Add class.
     {
         add_class( "Triangle" );
@@ -2372,17 +3372,6 @@ int main( int argc, char** argv )
         std::cout << "Average 2theta step: " << powder_pattern.average_two_theta_step() << std::endl;
     MACRO_END_GAME
 
-    try // Convert powder pattern in .xrdml format to .xye.
-    {
-        if ( argc != 2 )
-            throw std::runtime_error( "Please give the name of a .xrdml file." );
-        FileName input_file_name( argv[ 1 ] );
-        PowderPattern powder_pattern;
-        powder_pattern.read_xrdml( input_file_name );
-        std::cout << powder_pattern.average_two_theta_step() << std::endl;
-        powder_pattern.save_xye( replace_extension( input_file_name, "xye" ), true );
-    MACRO_END_GAME
-
     try // Repair XRPD pattern extracted from a .png
     {
         MACRO_ONE_XYEFILENAME_AS_ARGUMENT
@@ -2547,27 +3536,25 @@ int main( int argc, char** argv )
         crystal_structure.save_cif( append_to_file_name( input_file_name, "_H_added" ) );
     MACRO_END_GAME
 
-    try // Write .inp for TLS from .cif + two _restraints.txt files.
-    {
-        if ( argc != 2 )
-            throw std::runtime_error( "Please give the name of a .cif file that needs to be converted to a _TLS.inp file." );
-        FileName input_file_name( argv[ 1 ] );
-        TLSWriter( input_file_name );
-     MACRO_END_GAME
-
-    try // Write .inp for TLS from a .inp file.
-    {
-        if ( argc != 2 )
-            throw std::runtime_error( "Please give the name of a .inp file that needs to be converted to _TLS.inp." );
-        FileName input_file_name( argv[ 1 ] );
-        TLSWriter_2( input_file_name );
-     MACRO_END_GAME
-
     try // Write .inp from .cif + two _restraints.txt files + .xye file.
     {
         if ( argc != 3 )
-            throw std::runtime_error( "Please give the name of a .cif file and a .xye file that need to be converted to a .inp file." );
-        inp_writer( FileName( argv[ 1 ] ), FileName( argv[ 2 ] ) );
+            throw std::runtime_error( "Please give the name of a .cif file (or a FileList.txt file with .cif files) and a .xye file that need to be converted to a .inp file." );
+        if ( FileName( argv[ 1 ] ).extension() == "txt" )
+        {
+            FileName file_list_file_name( argv[ 1 ] );
+            FileList file_list( file_list_file_name );
+            std::vector< std::string > error_messages;
+            size_t nfailed = inp_writer( file_list, FileName( argv[ 2 ] ), error_messages );
+            for ( size_t i( 0 ); i != error_messages.size(); ++i )
+            {
+                if ( ! error_messages[i].empty() )
+                    std::cout << file_list.value( i ).full_name() << ": " << error_messages[i] << std::endl;
+            }
+            std::cout << size_t2string( file_list.size() - nfailed ) << " of " << size_t2string( file_list.size() ) << " .inp files written." << std::endl;
+        }
+        else
+            inp_writer( FileName( argv[ 1 ] ), FileName( argv[ 2 ] ) );
      MACRO_END_GAME
 
     try // Calculate all torsion angles and inversions for a list of cifs.
@@ -2652,10 +3639,11 @@ int main( int argc, char** argv )
             header_str += inversions[i][3] + " ";
         }
         text_file_writer.write_line( header_str );
+        ProgressReporter progress( "Now reading cif... ", file_list.size() );
         for ( size_t i( 0 ); i != file_list.size(); ++i )
         {
             CrystalStructure crystal_structure;
-            std::cout << "Now reading cif... " + file_list.value( i ).full_name() << std::endl;
+            progress.tick( file_list.value( i ).full_name() );
             read_cif( file_list.value( i ), crystal_structure );
             CrystalLattice crystal_lattice = crystal_structure.crystal_lattice();
             bool Zprime_is_two( false );
@@ -2773,13 +3761,6 @@ int main( int argc, char** argv )
         crystal_structure.save_cif( append_to_file_name( input_file_name, "_" + size_t2string( u ) + "_" + size_t2string( v ) + "_" + size_t2string( w ) ) );
     MACRO_END_GAME
 
-    try // Calculate similarity matrix.
-    {
-        MACRO_ONE_FILELISTNAME_AS_ARGUMENT
-        CorrelationMatrix similarity_matrix = calculate_correlation_matrix( file_list );
-        similarity_matrix.save( FileName( file_list_file_name.directory(), "SimilarityMatrix", "txt" ) );
-    MACRO_END_GAME
-
     try // Split reflections from SHELX .hkl file into +(hkl) and -(hkl).
     {
         // We need a CrystalLattice and a space group
@@ -3562,8 +4543,13 @@ int main( int argc, char** argv )
     try // Remove H atoms from a set of cif files.
     {
         MACRO_ONE_FILELISTNAME_AS_ARGUMENT
+        std::vector< std::string > error_messages;
+        strip_hydrogen_atoms( file_list, error_messages );
         for ( size_t i( 0 ); i != file_list.size(); ++i )
-            remove_hydrogen_atoms( file_list.value( i ) );
+        {
+            if ( ! error_messages[i].empty() )
+                std::cout << file_list.value( i ).full_name() << ": " << error_messages[i] << std::endl;
+        }
     MACRO_END_GAME
 
     try // Make atom labels unique.
@@ -3580,17 +4566,6 @@ int main( int argc, char** argv )
         check_if_closed( crystal_structure.space_group().symmetry_operators() );
     MACRO_END_GAME
 
-    try // Convert powder pattern in .brml format to .xye.
-    {
-        // First, the user must change .brml to .zip and extract all files
-        if ( argc != 2 )
-            throw std::runtime_error( "Please give the name and path of the RawData0.xml file." );
-        FileName input_file_name( argv[ 1 ] );
-        PowderPattern powder_pattern;
-        powder_pattern.read_brml( input_file_name );
-        powder_pattern.save_xye( replace_extension( input_file_name, "xye" ), true );
-    MACRO_END_GAME
-
     try // Read Norman's file.
     {
         TextFileReader text_file_reader( FileName( "C:\\Data_Win\\iwrgbihwrbghwirb.txt" ) );
@@ -3705,24 +4680,15 @@ int main( int argc, char** argv )
         finish_inp( input_file_name );
     MACRO_END_GAME
 
-    try // Convert powder pattern in .MDI format to .xye.
-    {
-        if ( argc != 2 )
-            throw std::runtime_error( "Please give the name of a .mdi file." );
-        FileName input_file_name( argv[ 1 ] );
-        PowderPattern powder_pattern;
-        powder_pattern.read_mdi( input_file_name );
-        powder_pattern.save_xye( replace_extension( input_file_name, "xye" ), true );
-    MACRO_END_GAME
-
     try // Calculate dipole moment for FileList.txt.
     {
         MACRO_ONE_FILELISTNAME_AS_ARGUMENT
         TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "dipole_results", "txt" ) );
+        ProgressReporter progress( "Now reading cif... ", file_list.size() );
         for ( size_t i( 0 ); i != file_list.size(); ++i )
         {
             CrystalStructure crystal_structure;
-            std::cout << "Now reading cif... " + file_list.value( i ).full_name() << std::endl;
+            progress.tick( file_list.value( i ).full_name() );
             read_cif( file_list.value( i ), crystal_structure );
             double dipole_moment_molecule = crystal_structure.dipole_moment();
             crystal_structure.apply_space_group_symmetry();
@@ -4367,7 +5333,7 @@ int main( int argc, char** argv )
         if ( argc != 2 )
             throw std::runtime_error( "Please give the name of a .inp file that needs to be converted to _EV.txt." );
         FileName input_file_name( argv[ 1 ] );
-        TextFileReader_2 input_file( input_file_name );
+        TOPASInputFile input_file( input_file_name );
         TextFileWriter text_file_writer( append_to_file_name( input_file_name, "_EV" ) );
  //   ' Origin of the molecule.
 //    prm !centx 0.0
@@ -4453,21 +5419,6 @@ int main( int argc, char** argv )
         std::cout << crystal_structure.density() << std::endl;
     MACRO_END_GAME
 
-    try // Calculate density for FileList.txt.
-    {
-        MACRO_ONE_FILELISTNAME_AS_ARGUMENT
-        TextFileWriter text_file_writer( FileName( file_list_file_name.directory(), "densities", "txt" ) );
-        for ( size_t i( 0 ); i != file_list.size(); ++i )
-        {
-            CrystalStructure crystal_structure;
-            std::cout << "Now reading cif... " + file_list.value( i ).full_name() << std::endl;
-            read_cif( file_list.value( i ), crystal_structure );
-            crystal_structure.apply_space_group_symmetry();
-            double density = crystal_structure.density();
-            text_file_writer.write_line( FileName( "", file_list.value( i ).file_name(), file_list.value( i ).extension() ).full_name() + " " + double2string( density ) );
-        }
-    MACRO_END_GAME
-
     try // Extract SGE identifiers.
     {
         FileName input_file_name( "C:\\Data_Win\\SGE.txt" );
@@ -4725,10 +5676,11 @@ int main( int argc, char** argv )
     {
         MACRO_ONE_FILELISTNAME_AS_ARGUMENT
         file_list.set_prepend_file_name_with_basedirectory( true );
+        ProgressReporter progress( "Now reading cif... ", file_list.size() );
         for ( size_t i( 0 ); i != file_list.size(); ++i )
         {
             CrystalStructure crystal_structure;
-            std::cout << "Now reading cif... " + file_list.value( i ).full_name() << std::endl;
+            progress.tick( file_list.value( i ).full_name() );
             read_cif( file_list.value( i ), crystal_structure );
             crystal_structure.save_cif( append_to_file_name( file_list.value( i ), "_lean" ) );
         }
@@ -4868,10 +5820,11 @@ int main( int argc, char** argv )
 //        powder_pattern_1.save( FileName( "C:\\Data\\Tatiana\\ADN\\dummy_exp_pattern.xye" ) );
         TextFileWriter text_file_writer( FileName( "C:\\Data\\GF\\matches.txt" ) );
         FileList file_list( FileName( "C:\\Data\\GF\\FileList.txt" ) );
+        ProgressReporter progress( "Now reading cif... ", file_list.size() );
         for ( size_t i( 0 ); i != file_list.size(); ++i )
         {
             CrystalStructure crystal_structure_2;
-            std::cout << "Now reading cif... " + file_list.value( i ).full_name() << std::endl;
+            progress.tick( file_list.value( i ).full_name() );
             read_cif( file_list.value( i ), crystal_structure_2 );
             PowderPatternCalculator powder_pattern_calculator_2( crystal_structure_2 );
             powder_pattern_calculator_2.set_wavelength( 1.54056 );
@@ -5518,10 +6471,11 @@ int main( int argc, char** argv )
         Angle two_theta_step( 0.01, Angle::DEGREES );
         double FWHM( 0.1 );
         PowderPattern powder_pattern_sum( two_theta_start, two_theta_end, two_theta_step );
+        ProgressReporter progress( "Now reading cif... ", file_list.size() );
         for ( size_t i( 0 ); i != file_list.size(); ++i )
         {
             CrystalStructure crystal_structure;
-            std::cout << "Now reading cif... " + file_list.value( i ).full_name() << std::endl;
+            progress.tick( file_list.value( i ).full_name() );
             read_cif( file_list.value( i ), crystal_structure );
             std::cout << "Now calculating powder pattern... " + size_t2string( i, 4, '0' ) << std::endl;
             PowderPatternCalculator powder_pattern_calculator( crystal_structure );
@@ -6401,3 +7355,96 @@ int main( int argc, char** argv )
     MACRO_END_GAME
 
 }
+
+
+struct Command
+{
+    const char * name_;
+    const char * arguments_;
+    const char * description_;
+    int ( *function_ )( int argc, char** argv );
+};
+
+const Command commands[] =
+{
+    { "test",              "[--jobs n] [--slowest n] [--no-timing-assertions] [--list] [name ...]", "Run the test suite, or only the tests whose name contains one of the names", command_test },
+    { "simulate-pattern",  "<FileList.txt> [--samples n] [--shard-size n] [--seed n] [--zero-point|--FWHM|--PO-r|--amorphous|--highest-peak|--background min max] [--PO-probability p] [--no-background-subtraction]", "Simulate experimental powder patterns (background, preferred orientation, noise) for .cif files, as .xye files or as binary .pps shards", command_simulate_pattern },
+    { "calculate-pattern", "<file.cif>", "Calculate the powder pattern of a .cif file", command_calculate_pattern },
+    { "similarity",        "<FileList.txt> [--checkpoint]", "Similarity matrix of the calculated powder patterns of .cif files; with --checkpoint a restart skips finished tiles", command_similarity },
+    { "cluster",           "<matrix_file> <threshold> [--duplicates]", "Average-linkage clusters of a similarity matrix file cut at threshold, or with --duplicates only the groups of duplicates, written to <matrix_file>_clusters.txt", command_cluster },
+    { "find-duplicates",   "<FileList.txt> [--jobs n]", "Groups the duplicates among the cifs in FileList.txt, filtering on density, cell, powder pattern and RMSCD, written to Duplicates.txt", command_find_duplicates },
+    { "pattern-library",   "<FileList.txt> <container_file> [--jobs n] [--similarity]", "Calculates the powder patterns of the cifs in FileList.txt and writes them, with --similarity also their similarity matrix, to one results container", command_pattern_library },
+    { "similarity-part",   "<FileList.txt> <matrix_file> <part> <nparts> [--jobs n]", "One part of the similarity matrix, written into a matrix file shared by all parts; restarts skip finished tiles", command_similarity_part },
+    { "voids",             "<FileList.txt>", "Void volumes of .cif files", command_voids },
+    { "screen",            "<target> <FileList.txt> [n n n n] [--cache <dir>]", "Rank .cif files by powder-pattern similarity to a target .xye or .cif; n = workers per stage", command_screen },
+    { "variable-cell-screen", "<file.xye> <FileList.txt> [FWHM]", "Rank .cif files by powder-pattern similarity to an experimental pattern, allowing small cell deformations and a zero-point error, written to VariableCellRanking.txt", command_variable_cell_screen },
+    { "serve",             "<FileList.txt> [socket]", "Keep the powder patterns of .cif files in memory and answer requests on a local socket", command_serve },
+    { "trajectory",        "<FileList.txt> [u v w] [--checkpoint n]", "Average structure and ADPs from MD frames (.cif files) in a u x v x w supercell; resumes from a checkpoint saved every n frames", command_trajectory },
+    { "pdf",               "<file.cif | file.xyz | FileList.txt> [r_max] [neutrons | electrons]", "Pair-distribution function g(r), G(r) and S(Q), averaged over MD frames", command_pdf },
+    { "solve",             "<file.cif> <file.xye> [ntrials] [nruns] [--checkpoint]", "Direct-space structure solution by simulated annealing against a powder pattern; with --checkpoint a restart skips finished runs", command_solve },
+    { "BFDH",              "<file.cif> [<file.cif> ...]", "Bravais-Friedel-Donnay-Harker morphology", command_BFDH },
+    { "copy-tree",         "<source> <destination> [--jobs n] [--full]", "Copy a directory tree with parallel block copies, skipping files with unchanged size and modification time unless --full is given", command_copy_tree },
+    { "index",             "<file.xye> [tolerance]", "Peak search and autoindexing of a powder pattern by successive dichotomy, ranked by M20", command_index },
+    { "verify-kernels",    "[ncases] [seed]", "Compare the optimised numeric kernels with the reference implementations on random inputs", command_verify_kernels },
+    { "decompose",         "<file.cif> <file.xye> [FWHM]", "Le Bail and Pawley intensity extraction, writes an .hkl file", command_decompose },
+    { "contacts",          "<FileList.txt> [delta]", "Intermolecular contacts shorter than the sum of the Van der Waals radii + delta and hydrogen bonds in .cif files", command_contacts },
+    { "density",           "<FileList.txt>", "Densities of .cif files", command_density },
+    { "descriptors",       "<FileList.txt>", "Density, packing coefficient, void fraction, formula, Z' and dipole moment of .cif files as .csv", command_descriptors },
+    { "match-table",       "<table.txt> [--energy|--energy-with-penalty|--density|--FOM min max] [--status s] [--top k] [--structures FileList.txt]", "Filter a crystal structure prediction match table and rank the rows by energy_with_penalty, written to <table>_selected.txt", command_match_table },
+    { "family-similarity", "<FileList.txt>", "Powder-pattern similarities within the refcode families of .cif files", command_family_similarity },
+    { "hkl-compare",       "<FileList.txt> [HKLF5]", "R1 and wR2 of .cif files against the SHELX .hkl files with the same names", command_hkl_compare },
+    { "niggli",            "<FileList.txt> [tolerance]", "Niggli-reduced primitive cells of .cif files, with duplicate cells marked", command_niggli },
+    { "ring-conformations", "<FileList.txt>", "Cremer-Pople puckering of the five- and six-membered rings in .cif files", command_ring_conformations },
+    { "inp",               "<file.cif | FileList.txt> <file.xye>", "Write TOPAS .inp files from .cif files and restraints", command_inp },
+    { "tls",               "<file.cif> ...", "Write TOPAS _TLS.inp files from .cif files and restraints", command_tls },
+    { "tls-from-inp",      "<file.inp> ...", "Write TOPAS _TLS.inp files from .inp files", command_tls_from_inp },
+    { "raw2xye",           "<file.raw>", "Convert a powder pattern in ASCII .raw format to .xye", command_raw2xye },
+    { "xrdml2xye",         "<file.xrdml>", "Convert a powder pattern in .xrdml format to .xye", command_xrdml2xye },
+    { "brml2xye",          "<RawData0.xml>", "Convert a powder pattern in .brml format (unzipped) to .xye", command_brml2xye },
+    { "mdi2xye",           "<file.mdi>", "Convert a powder pattern in .MDI format to .xye", command_mdi2xye },
+    { "recalculate-esds",  "<file.xye>", "Recalculate the ESDs of a powder pattern", command_recalculate_esds },
+    { "sudoku-benchmark",  "<file.txt>", "Solve a file with one Sudoku per line with each strategy", command_sudoku_benchmark },
+    { "sudoku-generate",   "<n> [difficulty] [seed]", "Generate n Sudokus with a unique solution, written to generated_sudokus.txt", command_sudoku_generate },
+    { "scratchpad",        "[arguments]", "The first block in command_scratchpad(), for one-off jobs", command_scratchpad },
+};
+
+void print_usage()
+{
+    std::cout << "Usage: Fourier [--run-tests] <command> [arguments]" << std::endl;
+    std::cout << std::endl;
+    for ( size_t i( 0 ); i != sizeof( commands ) / sizeof( commands[0] ); ++i )
+        std::cout << "  " << pad( std::string( commands[i].name_ ) + " " + commands[i].arguments_, 58 ) << " " << commands[i].description_ << std::endl;
+}
+
+// ********************************************************************************
+
+// The test suite is only run by the "test" command or with --run-tests, so that short batch jobs do not pay for it.
+int main( int argc, char** argv )
+{
+    bool run_tests_first( false );
+    if ( ( argc > 1 ) && ( std::string( argv[ 1 ] ) == "--run-tests" ) )
+    {
+        run_tests_first = true;
+        --argc;
+        ++argv;
+    }
+    if ( run_tests_first )
+        command_test( 1, argv );
+    if ( argc < 2 )
+    {
+        if ( run_tests_first )
+            return 0;
+        print_usage();
+        return 1;
+    }
+    const std::string command_name( argv[ 1 ] );
+    for ( size_t i( 0 ); i != sizeof( commands ) / sizeof( commands[0] ); ++i )
+    {
+        if ( command_name == commands[i].name_ )
+            return commands[i].function_( argc - 1, argv + 1 );
+    }
+    std::cout << "Unknown command: " + command_name << std::endl;
+    print_usage();
+    return 1;
+}
+
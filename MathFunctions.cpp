@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Sort.h"
 #include "Vector3D.h" // This is bound to give circular references later on
 
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
 #include <cstdlib>
@@ -101,6 +102,27 @@ int greatest_common_divisor( const int lhs, const int rhs )
 
 // ********************************************************************************
 
+uint64_t binary_greatest_common_divisor( uint64_t lhs, uint64_t rhs )
+{
+    if ( lhs == 0 )
+        return rhs;
+    if ( rhs == 0 )
+        return lhs;
+    // The common factors of two
+    const int shift = __builtin_ctzll( lhs | rhs );
+    lhs >>= __builtin_ctzll( lhs );
+    do
+    {
+        rhs >>= __builtin_ctzll( rhs );
+        if ( lhs > rhs )
+            std::swap( lhs, rhs );
+        rhs -= lhs;
+    } while ( rhs != 0 );
+    return lhs << shift;
+}
+
+// ********************************************************************************
+
 int round_to_int( const double x )
 {
     return ( x < 0 ) ? static_cast<int>( x - 0.5 ) : static_cast<int>( x + 0.5 );
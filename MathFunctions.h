@@ -32,6 +32,7 @@ class Vector3D;
 class Angle;
 
 #include <cstddef> // For definition of size_t
+#include <cstdint>
 #include <vector>
 
 // Adds a list of doubles trying to avoid adding very small to very large numbers
@@ -47,6 +48,9 @@ double calculate_average( const std::vector< double > & values );
 
 int greatest_common_divisor( const int lhs, const int rhs );
 
+// Binary (Stein's) algorithm, with shifts and subtractions instead of divisions. greatest_common_divisor( 0, 0 ) is 0.
+uint64_t binary_greatest_common_divisor( uint64_t lhs, uint64_t rhs );
+
 int round_to_int( const double x );
 
 size_t round_to_size_t( const double x );
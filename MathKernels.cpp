@@ -0,0 +1,184 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "MathKernels.h"
+#include "MathConstants.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <stdint.h>
+
+// The kernels are compiled for x86-64-v3 (AVX2, FMA) and x86-64-v4 (AVX-512) as well as for the baseline,
+// the version for the processor is chosen when the program is loaded. Not needed when the whole program is
+// compiled for a specific processor ("make ARCH=..."), and switched off by defining FOURIER_NO_MULTIVERSIONING.
+#if defined( __GNUC__ ) && ! defined( __clang__ ) && ( __GNUC__ >= 12 ) && defined( __x86_64__ ) && defined( __linux__ ) && ! defined( FOURIER_NO_MULTIVERSIONING )
+#define MACRO_TARGET_CLONES __attribute__(( target_clones( "default", "arch=x86-64-v3", "arch=x86-64-v4" ) ))
+#else
+#define MACRO_TARGET_CLONES
+#endif
+
+namespace
+{
+
+// pi/2 split in two parts, pi_over_2_1 has 33 significant bits so that q * pi_over_2_1 is exact for |q| < 2^20.
+const double pi_over_2_1 = 1.57079632673412561417e+00;
+const double pi_over_2_2 = 6.07710050650619224932e-11;
+const double two_over_pi = 6.36619772367581382433e-01;
+
+// ln(2) split in two parts, ln_2_1 has trailing zeros so that k * ln_2_1 is exact for all k for which exp() is finite.
+const double ln_2_1 = 6.93147180369123816490e-01;
+const double ln_2_2 = 1.90821492927058770002e-10;
+const double log2_e = 1.44269504088896338700e+00;
+
+// sin( x ) and cos( x ) for |x| <= pi/4, the Taylor series up to x^15 and x^16 have an error smaller than 1.0E-16.
+inline void sincos_kernel( const double x, double & s, double & c )
+{
+    const double x2 = x * x;
+    s = x * ( 1.0 + x2 * ( -1.0/6.0 + x2 * ( 1.0/120.0 + x2 * ( -1.0/5040.0 + x2 * ( 1.0/362880.0 + x2 * ( -1.0/39916800.0 +
+        x2 * ( 1.0/6227020800.0 + x2 * ( -1.0/1307674368000.0 ) ) ) ) ) ) ) );
+    c = 1.0 + x2 * ( -0.5 + x2 * ( 1.0/24.0 + x2 * ( -1.0/720.0 + x2 * ( 1.0/40320.0 + x2 * ( -1.0/3628800.0 +
+        x2 * ( 1.0/479001600.0 + x2 * ( -1.0/87178291200.0 + x2 * ( 1.0/20922789888000.0 ) ) ) ) ) ) ) );
+}
+
+// The angle is q*pi/2 + x, |x| <= pi/4.
+inline void sincos_quadrant( const double x, const double q, double & sine, double & cosine )
+{
+    double s;
+    double c;
+    sincos_kernel( x, s, c );
+    const int quadrant = static_cast<int>( static_cast<long long>( q ) & 3 );
+    const double sine_1   = ( quadrant & 1 ) ? c : s;
+    const double cosine_1 = ( quadrant & 1 ) ? s : c;
+    sine   = ( quadrant & 2 ) ? -sine_1 : sine_1;
+    cosine = ( ( quadrant + 1 ) & 2 ) ? -cosine_1 : cosine_1;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+MACRO_TARGET_CLONES
+void sincos( const std::vector< double > & x, std::vector< double > & sines, std::vector< double > & cosines )
+{
+    const size_t n = x.size();
+    sines.resize( n );
+    cosines.resize( n );
+    for ( size_t i( 0 ); i < n; ++i )
+    {
+        const double q = std::floor( x[i] * two_over_pi + 0.5 );
+        const double r = ( x[i] - q * pi_over_2_1 ) - q * pi_over_2_2;
+        sincos_quadrant( r, q, sines[i], cosines[i] );
+    }
+}
+
+// ********************************************************************************
+
+MACRO_TARGET_CLONES
+void sincos_reduced( const std::vector< double > & x, std::vector< double > & sines, std::vector< double > & cosines )
+{
+    const size_t n = x.size();
+    sines.resize( n );
+    cosines.resize( n );
+    for ( size_t i( 0 ); i < n; ++i )
+    {
+        // q is -2, -1, 0, 1 or 2, so the quadrant can be found without std::floor()
+        const double t = x[i] * two_over_pi;
+        const double q = static_cast<double>( static_cast<int>( t + ( ( t < 0.0 ) ? -0.5 : 0.5 ) ) );
+        const double r = ( x[i] - q * pi_over_2_1 ) - q * pi_over_2_2;
+        sincos_quadrant( r, q, sines[i], cosines[i] );
+    }
+}
+
+// ********************************************************************************
+
+MACRO_TARGET_CLONES
+void sincos_2pi( const std::vector< double > & t, std::vector< double > & sines, std::vector< double > & cosines )
+{
+    const size_t n = t.size();
+    sines.resize( n );
+    cosines.resize( n );
+    for ( size_t i( 0 ); i < n; ++i )
+    {
+        const double t4 = 4.0 * t[i];
+        const double q = std::floor( t4 + 0.5 );
+        sincos_quadrant( ( t4 - q ) * ( 0.5 * CONSTANT_PI ), q, sines[i], cosines[i] );
+    }
+}
+
+// ********************************************************************************
+
+MACRO_TARGET_CLONES
+void cos_2pi( const std::vector< double > & t, std::vector< double > & cosines )
+{
+    const size_t n = t.size();
+    cosines.resize( n );
+    for ( size_t i( 0 ); i < n; ++i )
+    {
+        const double t4 = 4.0 * t[i];
+        const double q = std::floor( t4 + 0.5 );
+        double s;
+        double c;
+        sincos_kernel( ( t4 - q ) * ( 0.5 * CONSTANT_PI ), s, c );
+        const int quadrant = static_cast<int>( static_cast<long long>( q ) & 3 );
+        const double cosine = ( quadrant & 1 ) ? s : c;
+        cosines[i] = ( ( quadrant + 1 ) & 2 ) ? -cosine : cosine;
+    }
+}
+
+// ********************************************************************************
+
+MACRO_TARGET_CLONES
+void exp( const std::vector< double > & x, std::vector< double > & result )
+{
+    const size_t n = x.size();
+    result.resize( n );
+    for ( size_t i( 0 ); i < n; ++i )
+    {
+        const double y = x[i];
+        // Clamp so that 2^k is a normal number, the result is replaced by 0.0 or infinity afterwards
+        const double y_clamped = std::min( std::max( y, -708.0 ), 709.0 );
+        // exp( y ) = 2^k * exp( r ), |r| <= ln(2)/2
+        const double k = std::floor( y_clamped * log2_e + 0.5 );
+        const double r = ( y_clamped - k * ln_2_1 ) - k * ln_2_2;
+        // Taylor series up to r^13, error smaller than 1.0E-16
+        const double p = 1.0 + r * ( 1.0 + r * ( 1.0/2.0 + r * ( 1.0/6.0 + r * ( 1.0/24.0 + r * ( 1.0/120.0 + r * ( 1.0/720.0 +
+                         r * ( 1.0/5040.0 + r * ( 1.0/40320.0 + r * ( 1.0/362880.0 + r * ( 1.0/3628800.0 + r * ( 1.0/39916800.0 +
+                         r * ( 1.0/479001600.0 + r * ( 1.0/6227020800.0 ) ) ) ) ) ) ) ) ) ) ) ) );
+        const int64_t bits = static_cast< int64_t >( static_cast< int >( k ) + 1023 ) << 52;
+        double two_to_the_k;
+        std::memcpy( &two_to_the_k, &bits, sizeof( double ) );
+        const double value = p * two_to_the_k;
+        result[i] = ( y < -708.0 ) ? 0.0 : ( ( y > 709.0 ) ? std::numeric_limits< double >::infinity() : value );
+    }
+}
+
+// ********************************************************************************
+
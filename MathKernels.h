@@ -0,0 +1,69 @@
+#ifndef MATHKERNELS_H
+#define MATHKERNELS_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <vector>
+
+/*
+  Vectorisable kernels for sine, cosine and exponential of whole arrays, for the innermost loops of e.g. the
+  structure-factor calculation.
+
+  The loops contain no branches and no calls to libm, so the compiler can vectorise them. The arguments are
+  reduced exactly (the sin_2pi family, whose argument is in cycles) or with a two-part Cody-Waite constant
+  (radians and exp), after which polynomials accurate to better than 1.0E-15 are used.
+  The accuracy is tested in TestMathKernels.cpp: the absolute error of the sines and cosines is smaller than
+  about 1.0E-15 * max( 1, |x| ), the relative error of exp() is smaller than about 1.0E-13.
+
+  The Cody-Waite reduction relies on the order in which the two parts are subtracted, so MathKernels.cpp
+  must be compiled with -fno-associative-math when -Ofast or -ffast-math is used (see the Makefile).
+  On x86-64 with GCC, versions for AVX2 and AVX-512 are compiled as well and chosen at run time.
+
+  result may be the same vector as the input, output vectors are resized to the size of the input.
+*/
+
+// sines[i] = sin( x[i] ), cosines[i] = cos( x[i] ), x in radians.
+// Accurate for |x| < 1.0E5, the error of the reduction grows slowly for larger arguments.
+void sincos( const std::vector< double > & x, std::vector< double > & sines, std::vector< double > & cosines );
+
+// Fast path for arguments that are already in [ -pi, pi ], e.g. angles from atan2().
+// Arguments outside that interval give wrong results.
+void sincos_reduced( const std::vector< double > & x, std::vector< double > & sines, std::vector< double > & cosines );
+
+// sines[i] = sin( 2*pi*t[i] ), cosines[i] = cos( 2*pi*t[i] ).
+// The argument is in cycles, so that h*x+k*y+l*z can be passed directly, and the reduction is exact for any t.
+void sincos_2pi( const std::vector< double > & t, std::vector< double > & sines, std::vector< double > & cosines );
+
+// As sincos_2pi(), but only the cosines. Used for centrosymmetric structures.
+void cos_2pi( const std::vector< double > & t, std::vector< double > & cosines );
+
+// result[i] = exp( x[i] ). Underflows to 0.0 below -708.0 and overflows to infinity above 709.0.
+void exp( const std::vector< double > & x, std::vector< double > & result );
+
+#endif // MATHKERNELS_H
+
@@ -34,35 +34,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // ********************************************************************************
 
-Matrix3D::Matrix3D()
-{
-    *this = Matrix3D( 1.0 );
-}
-
-// ********************************************************************************
-
-// Constructs a scalar matrix
-Matrix3D::Matrix3D( const double scalar )
-{
-    data_[0][0] = scalar; data_[0][1] = 0.0   ; data_[0][2] = 0.0   ;
-    data_[1][0] = 0.0   ; data_[1][1] = scalar; data_[1][2] = 0.0   ;
-    data_[2][0] = 0.0   ; data_[2][1] = 0.0   ; data_[2][2] = scalar;
-}
-
-// ********************************************************************************
-
-Matrix3D::Matrix3D( const double a00, const double a01, const double a02,
-                    const double a10, const double a11, const double a12,
-                    const double a20, const double a21, const double a22
-                  )
-{
-    data_[0][0] = a00; data_[0][1] = a01; data_[0][2] = a02;
-    data_[1][0] = a10; data_[1][1] = a11; data_[1][2] = a12;
-    data_[2][0] = a20; data_[2][1] = a21; data_[2][2] = a22;
-}
-
-// ********************************************************************************
-
 double Matrix3D::sum_of_elements() const
 {
     return data_[0][0] + data_[0][1] + data_[0][2] + data_[1][0] + data_[1][1] + data_[1][2] + data_[2][0] + data_[2][1] + data_[2][2];
@@ -111,13 +82,6 @@ double Matrix3D::determinant() const
 
 // ********************************************************************************
 
-double Matrix3D::trace() const
-{
-    return data_[0][0] + data_[1][1] + data_[2][2];
-}
-
-// ********************************************************************************
-
 double Matrix3D::minor_matrix_determinant( const size_t row, const size_t col ) const
 {
     double minor_matrix[2][2];
@@ -142,38 +106,6 @@ double Matrix3D::minor_matrix_determinant( const size_t row, const size_t col )
 
 // ********************************************************************************
 
-Matrix3D & Matrix3D::operator+=( const Matrix3D & rhs )
-{
-    *this = Matrix3D( value( 0, 0 ) + rhs.value( 0, 0 ), value( 0, 1 ) + rhs.value( 0, 1 ), value( 0, 2 ) + rhs.value( 0, 2 ),
-                      value( 1, 0 ) + rhs.value( 1, 0 ), value( 1, 1 ) + rhs.value( 1, 1 ), value( 1, 2 ) + rhs.value( 1, 2 ),
-                      value( 2, 0 ) + rhs.value( 2, 0 ), value( 2, 1 ) + rhs.value( 2, 1 ), value( 2, 2 ) + rhs.value( 2, 2 )
-                    );
-    return *this;
-}
-
-// ********************************************************************************
-
-Matrix3D & Matrix3D::operator-=( const Matrix3D & rhs )
-{
-    *this = Matrix3D( value( 0, 0 ) - rhs.value( 0, 0 ), value( 0, 1 ) - rhs.value( 0, 1 ), value( 0, 2 ) - rhs.value( 0, 2 ),
-                      value( 1, 0 ) - rhs.value( 1, 0 ), value( 1, 1 ) - rhs.value( 1, 1 ), value( 1, 2 ) - rhs.value( 1, 2 ),
-                      value( 2, 0 ) - rhs.value( 2, 0 ), value( 2, 1 ) - rhs.value( 2, 1 ), value( 2, 2 ) - rhs.value( 2, 2 )
-                    );
-    return *this;
-}
-
-// ********************************************************************************
-
-Matrix3D & Matrix3D::operator/=( const double value )
-{
-    data_[0][0] /= value; data_[0][1] /= value; data_[0][2] /= value;
-    data_[1][0] /= value; data_[1][1] /= value; data_[1][2] /= value;
-    data_[2][0] /= value; data_[2][1] /= value; data_[2][2] /= value;
-    return *this;
-}
-
-// ********************************************************************************
-
 bool Matrix3D::operator==( const Matrix3D & rhs ) const
 {
     return nearly_equal( *this, rhs );
@@ -209,61 +141,6 @@ bool nearly_equal( const Matrix3D & lhs, const Matrix3D & rhs, const double tole
 
 // ********************************************************************************
 
-Matrix3D operator+( const Matrix3D & lhs, const Matrix3D & rhs )
-{
-    return Matrix3D( lhs.value( 0, 0 ) + rhs.value( 0, 0 ), lhs.value( 0, 1 ) + rhs.value( 0, 1 ), lhs.value( 0, 2 ) + rhs.value( 0, 2 ),
-                     lhs.value( 1, 0 ) + rhs.value( 1, 0 ), lhs.value( 1, 1 ) + rhs.value( 1, 1 ), lhs.value( 1, 2 ) + rhs.value( 1, 2 ),
-                     lhs.value( 2, 0 ) + rhs.value( 2, 0 ), lhs.value( 2, 1 ) + rhs.value( 2, 1 ), lhs.value( 2, 2 ) + rhs.value( 2, 2 )
-                   );
-}
-
-// ********************************************************************************
-
-Matrix3D operator-( const Matrix3D & lhs, const Matrix3D & rhs )
-{
-    return Matrix3D( lhs.value( 0, 0 ) - rhs.value( 0, 0 ), lhs.value( 0, 1 ) - rhs.value( 0, 1 ), lhs.value( 0, 2 ) - rhs.value( 0, 2 ),
-                     lhs.value( 1, 0 ) - rhs.value( 1, 0 ), lhs.value( 1, 1 ) - rhs.value( 1, 1 ), lhs.value( 1, 2 ) - rhs.value( 1, 2 ),
-                     lhs.value( 2, 0 ) - rhs.value( 2, 0 ), lhs.value( 2, 1 ) - rhs.value( 2, 1 ), lhs.value( 2, 2 ) - rhs.value( 2, 2 )
-                   );
-}
-
-// ********************************************************************************
-
-Matrix3D operator*( const Matrix3D & lhs, const Matrix3D & rhs )
-{
-    Matrix3D result;
-    result.set_value( 0, 0, lhs.value(0,0) * rhs.value(0,0) + lhs.value(0,1) * rhs.value(1,0) + lhs.value(0,2) * rhs.value(2,0) );
-    result.set_value( 0, 1, lhs.value(0,0) * rhs.value(0,1) + lhs.value(0,1) * rhs.value(1,1) + lhs.value(0,2) * rhs.value(2,1) );
-    result.set_value( 0, 2, lhs.value(0,0) * rhs.value(0,2) + lhs.value(0,1) * rhs.value(1,2) + lhs.value(0,2) * rhs.value(2,2) );
-    result.set_value( 1, 0, lhs.value(1,0) * rhs.value(0,0) + lhs.value(1,1) * rhs.value(1,0) + lhs.value(1,2) * rhs.value(2,0) );
-    result.set_value( 1, 1, lhs.value(1,0) * rhs.value(0,1) + lhs.value(1,1) * rhs.value(1,1) + lhs.value(1,2) * rhs.value(2,1) );
-    result.set_value( 1, 2, lhs.value(1,0) * rhs.value(0,2) + lhs.value(1,1) * rhs.value(1,2) + lhs.value(1,2) * rhs.value(2,2) );
-    result.set_value( 2, 0, lhs.value(2,0) * rhs.value(0,0) + lhs.value(2,1) * rhs.value(1,0) + lhs.value(2,2) * rhs.value(2,0) );
-    result.set_value( 2, 1, lhs.value(2,0) * rhs.value(0,1) + lhs.value(2,1) * rhs.value(1,1) + lhs.value(2,2) * rhs.value(2,1) );
-    result.set_value( 2, 2, lhs.value(2,0) * rhs.value(0,2) + lhs.value(2,1) * rhs.value(1,2) + lhs.value(2,2) * rhs.value(2,2) );
-    return result;
-}
-
-// ********************************************************************************
-
-Matrix3D operator*( const double lhs, const Matrix3D & rhs )
-{
-    return Matrix3D( lhs * rhs.value( 0, 0 ), lhs * rhs.value( 0, 1 ), lhs * rhs.value( 0, 2 ),
-                     lhs * rhs.value( 1, 0 ), lhs * rhs.value( 1, 1 ), lhs * rhs.value( 1, 2 ),
-                     lhs * rhs.value( 2, 0 ), lhs * rhs.value( 2, 1 ), lhs * rhs.value( 2, 2 ) );
-}
-
-// ********************************************************************************
-
-Matrix3D operator/( const Matrix3D & lhs, const double rhs )
-{
-    return Matrix3D( lhs.value( 0, 0 ) / rhs, lhs.value( 0, 1 ) / rhs, lhs.value( 0, 2 ) / rhs,
-                     lhs.value( 1, 0 ) / rhs, lhs.value( 1, 1 ) / rhs, lhs.value( 1, 2 ) / rhs,
-                     lhs.value( 2, 0 ) / rhs, lhs.value( 2, 1 ) / rhs, lhs.value( 2, 2 ) / rhs );
-}
-
-// ********************************************************************************
-
 Matrix3D inverse( const Matrix3D & matrix3d )
 {
     Matrix3D result( matrix3d );
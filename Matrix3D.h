@@ -28,31 +28,36 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "Vector3D.h"
+
 #include <cstddef> // For definition of size_t
 #include <iosfwd>
 
 /*
   A 3x3 matrix.
+
+  As for Vector3D, the arithmetic is defined inline in this header and is constexpr. The products are written
+  as one row of the result at a time, three contiguous doubles, so that the compiler can vectorise them.
 */
 class Matrix3D
 {
 public:
 
     // Default constructor: identity matrix
-    Matrix3D();
+    constexpr Matrix3D(): data_{ { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } } {}
 
     // Constructs a scalar matrix
-    explicit Matrix3D( const double scalar );
+    constexpr explicit Matrix3D( const double scalar ): data_{ { scalar, 0.0, 0.0 }, { 0.0, scalar, 0.0 }, { 0.0, 0.0, scalar } } {}
 
-    Matrix3D( const double a00, const double a01, const double a02,
-              const double a10, const double a11, const double a12,
-              const double a20, const double a21, const double a22
-            );
+    constexpr Matrix3D( const double a00, const double a01, const double a02,
+                        const double a10, const double a11, const double a12,
+                        const double a20, const double a21, const double a22
+                      ): data_{ { a00, a01, a02 }, { a10, a11, a12 }, { a20, a21, a22 } } {}
 
     // In keeping with the silly C++ convention: zero-based
-    double value( const size_t i, const size_t j ) const { return data_[i][j]; }
+    constexpr double value( const size_t i, const size_t j ) const { return data_[i][j]; }
 
-    void set_value( const size_t i, const size_t j, const double value ) { data_[i][j] = value; }
+    constexpr void set_value( const size_t i, const size_t j, const double value ) { data_[i][j] = value; }
 
     double sum_of_elements() const;
     double sum_of_absolute_elements() const;
@@ -63,15 +68,41 @@ public:
 
     double determinant() const;
 
-    double trace() const;
+    constexpr double trace() const { return data_[0][0] + data_[1][1] + data_[2][2]; }
 
     // Returns the determinant of the minor matrix defined by element i,j.
     // In keeping with the silly C++ convention: zero-based
     double minor_matrix_determinant( const size_t i, const size_t j ) const;
 
-    Matrix3D & operator+=( const Matrix3D & rhs );
-    Matrix3D & operator-=( const Matrix3D & rhs );
-    Matrix3D & operator/=( const double value );
+    constexpr Matrix3D & operator+=( const Matrix3D & rhs )
+    {
+        for ( size_t i( 0 ); i != 3; ++i )
+        {
+            for ( size_t j( 0 ); j != 3; ++j )
+                data_[i][j] += rhs.data_[i][j];
+        }
+        return *this;
+    }
+
+    constexpr Matrix3D & operator-=( const Matrix3D & rhs )
+    {
+        for ( size_t i( 0 ); i != 3; ++i )
+        {
+            for ( size_t j( 0 ); j != 3; ++j )
+                data_[i][j] -= rhs.data_[i][j];
+        }
+        return *this;
+    }
+
+    constexpr Matrix3D & operator/=( const double value )
+    {
+        for ( size_t i( 0 ); i != 3; ++i )
+        {
+            for ( size_t j( 0 ); j != 3; ++j )
+                data_[i][j] /= value;
+        }
+        return *this;
+    }
 
     bool operator==( const Matrix3D & rhs ) const;
 
@@ -85,12 +116,64 @@ std::ostream & operator<<( std::ostream & os, const Matrix3D & matrix3d );
 
 bool nearly_equal( const Matrix3D & lhs, const Matrix3D & rhs, const double tolerance = 0.0000001 );
 
-Matrix3D operator+( const Matrix3D & lhs, const Matrix3D & rhs );
-Matrix3D operator-( const Matrix3D & lhs, const Matrix3D & rhs );
+constexpr Matrix3D operator+( const Matrix3D & lhs, const Matrix3D & rhs )
+{
+    return Matrix3D( lhs ) += rhs;
+}
+
+constexpr Matrix3D operator-( const Matrix3D & lhs, const Matrix3D & rhs )
+{
+    return Matrix3D( lhs ) -= rhs;
+}
 
-Matrix3D operator*( const Matrix3D & lhs, const Matrix3D & rhs );
+// Row i of the result is sum_k lhs(i,k) * row k of rhs.
+constexpr Matrix3D operator*( const Matrix3D & lhs, const Matrix3D & rhs )
+{
+    Matrix3D result( 0.0 );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            const double a = lhs.value( i, k );
+            for ( size_t j( 0 ); j != 3; ++j )
+                result.set_value( i, j, result.value( i, j ) + a * rhs.value( k, j ) );
+        }
+    }
+    return result;
+}
+
+constexpr Matrix3D operator*( const double lhs, const Matrix3D & rhs )
+{
+    Matrix3D result( rhs );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+            result.set_value( i, j, lhs * rhs.value( i, j ) );
+    }
+    return result;
+}
+
+constexpr Matrix3D operator/( const Matrix3D & lhs, const double rhs )
+{
+    return Matrix3D( lhs ) /= rhs;
+}
 
-Matrix3D operator*( const double lhs, const Matrix3D & rhs );
+constexpr Vector3D operator*( const Matrix3D & matrix, const Vector3D & vector )
+{
+    return Vector3D( matrix.value( 0, 0 ) * vector.x() + matrix.value( 0, 1 ) * vector.y() + matrix.value( 0, 2 ) * vector.z(),
+                     matrix.value( 1, 0 ) * vector.x() + matrix.value( 1, 1 ) * vector.y() + matrix.value( 1, 2 ) * vector.z(),
+                     matrix.value( 2, 0 ) * vector.x() + matrix.value( 2, 1 ) * vector.y() + matrix.value( 2, 2 ) * vector.z()
+                   );
+}
+
+// The transposition of vector is implied.
+constexpr Vector3D operator*( const Vector3D & vector, const Matrix3D & matrix )
+{
+    return Vector3D( matrix.value( 0, 0 ) * vector.x() + matrix.value( 1, 0 ) * vector.y() + matrix.value( 2, 0 ) * vector.z(),
+                     matrix.value( 0, 1 ) * vector.x() + matrix.value( 1, 1 ) * vector.y() + matrix.value( 2, 1 ) * vector.z(),
+                     matrix.value( 0, 2 ) * vector.x() + matrix.value( 1, 2 ) * vector.y() + matrix.value( 2, 2 ) * vector.z()
+                   );
+}
 
 Matrix3D inverse( const Matrix3D & matrix3d );
 Matrix3D transpose( const Matrix3D & matrix3d );
@@ -28,6 +28,7 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include <cstdint>
 #include <iosfwd>
 
 /*
@@ -72,5 +73,24 @@ bool operator==( const MillerIndices & lhs, const MillerIndices & rhs );
 // The transposition is implied
 int operator*( const MillerIndices & lhs, const MillerIndices & rhs );
 
+// Each index is stored in 21 bits with an offset, so |h|, |k|, |l| < 2^20.
+// For hash tables and for the batch calculations in 3DCalculations.h.
+inline std::uint64_t packed_miller_indices( const MillerIndices & miller_indices )
+{
+    const std::int64_t offset = 1 << 20;
+    return ( static_cast< std::uint64_t >( miller_indices.h() + offset ) << 42 ) |
+           ( static_cast< std::uint64_t >( miller_indices.k() + offset ) << 21 ) |
+             static_cast< std::uint64_t >( miller_indices.l() + offset );
+}
+
+inline void unpack_miller_indices( const std::uint64_t packed, int & h, int & k, int & l )
+{
+    const std::int64_t offset = 1 << 20;
+    const std::uint64_t mask = ( static_cast< std::uint64_t >( 1 ) << 21 ) - 1;
+    h = static_cast< int >( static_cast< std::int64_t >( ( packed >> 42 ) & mask ) - offset );
+    k = static_cast< int >( static_cast< std::int64_t >( ( packed >> 21 ) & mask ) - offset );
+    l = static_cast< int >( static_cast< std::int64_t >(   packed         & mask ) - offset );
+}
+
 #endif // MILLERINDICES_H
 
@@ -27,13 +27,19 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "ModelBuilding.h"
 #include "3DCalculations.h"
+#include "CellList.h"
+#include "CrystalLattice.h"
 #include "CrystalStructure.h"
+#include "Element.h"
+#include "MathFunctions.h"
 #include "NormalisedVector3D.h"
 #include "Utilities.h"
 #include "Vector3D.h"
 
+#include <cmath>
 #include <stdexcept>
 #include <iostream>
+#include <vector>
 
 // ********************************************************************************
 
@@ -121,67 +127,91 @@ Vector3D add_hydrogen_atom_to_sp2_atom( const Vector3D & central_atom, const Ele
     difference_vector_2.set_length( 1.0 );
     Vector3D average_vector = ( difference_vector_1 + difference_vector_2 ) / 2.0;
     average_vector *= -1.0;
-    double target_bond_length( 1.0 );
-    if ( element_central_atom == Element( "C" ) )
-        target_bond_length = 1.089;
-    else if ( element_central_atom == Element( "N" ) )
-        target_bond_length = 1.015;
-    else if ( element_central_atom == Element( "O" ) )
-        target_bond_length = 0.993;
-    average_vector.set_length( target_bond_length );
+    average_vector.set_length( X_H_bond_length( element_central_atom ) );
     return central_atom + average_vector;
 }
 
 // ********************************************************************************
 
+double X_H_bond_length( const Element & element )
+{
+    if ( element == Element( "C" ) )
+        return 1.089;
+    if ( element == Element( "N" ) )
+        return 1.015;
+    if ( element == Element( "O" ) )
+        return 0.993;
+    return 1.0;
+}
+
+// ********************************************************************************
+
 void normalise_X_H_bonds( CrystalStructure & crystal_structure )
 {
-    // Loop over all atoms.
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    // One cell list of all non-hydrogen atoms, the parent of each hydrogen atom must be within 3.0 A.
+    const double maximum_X_H_distance = 3.0;
+    std::vector< size_t > heavy_atoms;
+    std::vector< Vector3D > heavy_atom_positions;
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        if ( crystal_structure.atom( i ).element().is_H_or_D() )
+            continue;
+        heavy_atoms.push_back( i );
+        heavy_atom_positions.push_back( crystal_structure.atom( i ).position() );
+    }
+    const CellList cell_list( crystal_lattice, heavy_atom_positions, maximum_X_H_distance );
+    // Find all X-H pairs first, then set the bond lengths with batch conversions to and from Cartesian coordinates.
+    std::vector< size_t > hydrogen_atoms;
+    std::vector< size_t > parents; // Indices into heavy_atoms
+    std::vector< double > differences; // The X-H vectors, x0 y0 z0 x1 y1 z1 ...
+    std::vector< size_t > candidates;
     for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
     {
-        // If not hydrogen, continue.
         if ( ! crystal_structure.atom( i ).element().is_H_or_D() )
             continue;
+        const Vector3D H_position = crystal_structure.atom( i ).position();
         // Find the non-hydrogen atom nearest to it.
-        size_t smallest_distance_index = 0;
-        double smallest_distance2 = 10.0;
-        for ( size_t j( 0 ); j != crystal_structure.natoms(); ++j )
+        size_t smallest_distance_index = heavy_atoms.size();
+        double smallest_distance2 = square( maximum_X_H_distance );
+        if ( ! heavy_atoms.empty() )
+            cell_list.candidates( H_position, candidates );
+        for ( size_t k( 0 ); k != candidates.size(); ++k )
         {
-            // If hydrogen, continue.
-            if ( crystal_structure.atom( j ).element().is_H_or_D() )
-                continue;
-            double distance2 = crystal_structure.crystal_lattice().shortest_distance2( crystal_structure.atom( j ).position(), crystal_structure.atom( i ).position() );
+            const double distance2 = crystal_lattice.shortest_distance2( heavy_atom_positions[ candidates[k] ], H_position );
             if ( distance2 < smallest_distance2 )
             {
                 smallest_distance2 = distance2;
-                smallest_distance_index = j;
+                smallest_distance_index = candidates[k];
             }
         }
-        double smallest_distance = sqrt( smallest_distance2 );
-        if ( smallest_distance < 0.001 )
-            throw std::runtime_error( "normalise_X_H_bonds(): points too close together." );
-        if ( smallest_distance > 3.0 )
+        if ( smallest_distance_index == heavy_atoms.size() )
             throw std::runtime_error( "normalise_X_H_bonds(): atoms not bound." );
-        // We need to be able to set the length of the X-H bond, so we must work in Cartesian coordinates.
+        if ( smallest_distance2 < square( 0.001 ) )
+            throw std::runtime_error( "normalise_X_H_bonds(): points too close together." );
         Vector3D difference_frac;
         double distance;
-        crystal_structure.shortest_distance( crystal_structure.atom( smallest_distance_index ).position(), crystal_structure.atom( i ).position(), distance, difference_frac );
-        if ( ! nearly_equal( distance, smallest_distance ) )
-            throw std::runtime_error( "normalise_X_H_bonds() : distances differ." );
-        Vector3D difference_cart = crystal_structure.crystal_lattice().fractional_to_orthogonal( difference_frac );
-        double target_bond_length( 1.0 );
-        if ( crystal_structure.atom( smallest_distance_index ).element() == Element( "C" ) )
-            target_bond_length = 1.089;
-        else if ( crystal_structure.atom( smallest_distance_index ).element() == Element( "N" ) )
-            target_bond_length = 1.015;
-        else if ( crystal_structure.atom( smallest_distance_index ).element() == Element( "O" ) )
-            target_bond_length = 0.993;
-        difference_cart *= target_bond_length / distance;
-        difference_frac = crystal_structure.crystal_lattice().orthogonal_to_fractional( difference_cart );
-        Vector3D H_atom_frac = crystal_structure.atom( smallest_distance_index ).position() + difference_frac;
-        Atom new_atom = crystal_structure.atom( i );
-        new_atom.set_position( H_atom_frac );
-        crystal_structure.set_atom( i, new_atom );
+        crystal_lattice.shortest_distance( heavy_atom_positions[ smallest_distance_index ], H_position, distance, difference_frac );
+        hydrogen_atoms.push_back( i );
+        parents.push_back( smallest_distance_index );
+        for ( size_t j( 0 ); j != 3; ++j )
+            differences.push_back( difference_frac.value( j ) );
+    }
+    // We need to be able to set the length of the X-H bond, so we must work in Cartesian coordinates.
+    crystal_lattice.fractional_to_orthogonal( differences.data(), hydrogen_atoms.size() );
+    for ( size_t i( 0 ); i != hydrogen_atoms.size(); ++i )
+    {
+        double * difference = &differences[ 3 * i ];
+        const double scale = X_H_bond_length( crystal_structure.atom( heavy_atoms[ parents[i] ] ).element() ) / std::sqrt( square( difference[0] ) + square( difference[1] ) + square( difference[2] ) );
+        for ( size_t j( 0 ); j != 3; ++j )
+            difference[j] *= scale;
+    }
+    crystal_lattice.orthogonal_to_fractional( differences.data(), hydrogen_atoms.size() );
+    for ( size_t i( 0 ); i != hydrogen_atoms.size(); ++i )
+    {
+        Atom new_atom = crystal_structure.atom( hydrogen_atoms[i] );
+        new_atom.set_position( heavy_atom_positions[ parents[i] ] + Vector3D( differences[ 3 * i ], differences[ 3 * i + 1 ], differences[ 3 * i + 2 ] ) );
+        crystal_structure.set_atom( hydrogen_atoms[i], new_atom );
     }
 }
 
@@ -57,6 +57,11 @@ std::vector< Vector3D > add_2_hydrogen_atoms_to_sp3_nitrogen( const Vector3D & a
 
 Vector3D add_hydrogen_atom_to_sp2_atom( const Vector3D & central_atom, const Element element_central_atom, const Vector3D & neighbour_1, const Vector3D & neighbour_2 );
 
+// The standard X-H bond length for a hydrogen atom bonded to element: C-H 1.089, N-H 1.015, O-H 0.993 and 1.0 A for all other elements.
+double X_H_bond_length( const Element & element );
+
+// Moves every hydrogen atom along the line to the nearest non-hydrogen atom such that the X-H bond has the length given by X_H_bond_length().
+// The nearest non-hydrogen atom is found with a CellList and must be within 3.0 A, otherwise std::runtime_error is thrown.
 void normalise_X_H_bonds( CrystalStructure & crystal_structure );
 
 #endif // MODELBUILDING_H
@@ -0,0 +1,453 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "MolecularSurface.h"
+#include "CellList.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "Element.h"
+#include "MathFunctions.h"
+#include "MoleculeInCrystal.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+
+// The decay length of the approximate spherical atomic densities of the promolecule, in A.
+const double promolecule_decay_length = 0.5;
+
+// For HIRSHFELD, the distance beyond its Van der Waals radius at which an atom no longer contributes, in A.
+// At that distance its density has decayed by a factor of exp( -5 ).
+const double Hirshfeld_reach = 2.5;
+
+// The six tetrahedra of a cube with corners numbered x + 2y + 4z. They all share the diagonal 0-7,
+// so the tetrahedra of neighbouring cubes meet face to face and the surface is closed.
+const size_t tetrahedra[6][4] = { { 0, 1, 3, 7 }, { 0, 3, 2, 7 }, { 0, 2, 6, 7 }, { 0, 6, 4, 7 }, { 0, 4, 5, 7 }, { 0, 5, 1, 7 } };
+
+// An atom of the crystal at one lattice translation, Cartesian.
+struct AtomImage
+{
+    Vector3D position_;
+    double radius_;
+    bool is_in_molecule_;
+};
+
+// The point where the field is zero on the edge from a to b, the field has opposite signs at a and b.
+Vector3D interpolate( const Vector3D & a, const double f_a, const Vector3D & b, const double f_b )
+{
+    return a + ( f_a / ( f_a - f_b ) ) * ( b - a );
+}
+
+// Appends the triangle with its normal pointing along outward.
+void add_triangle( const Vector3D & vertex_0, const Vector3D & vertex_1, const Vector3D & vertex_2, const Vector3D & outward, std::vector< Triangle > & triangles )
+{
+    Triangle triangle( vertex_0, vertex_1, vertex_2 );
+    if ( triangle.area() == 0.0 )
+        return;
+    if ( triangle.n() * outward < 0.0 )
+        triangle = Triangle( vertex_0, vertex_2, vertex_1 );
+    triangles.push_back( triangle );
+}
+
+// The part of the surface f = 0 inside one tetrahedron, f < 0 is inside.
+void triangulate_tetrahedron( const Vector3D p[4], const double f[4], std::vector< Triangle > & triangles )
+{
+    size_t inside[4];
+    size_t outside[4];
+    size_t ninside( 0 );
+    size_t noutside( 0 );
+    for ( size_t k( 0 ); k != 4; ++k )
+    {
+        if ( f[k] < 0.0 )
+            inside[ ninside++ ] = k;
+        else
+            outside[ noutside++ ] = k;
+    }
+    if ( ( ninside == 0 ) || ( noutside == 0 ) )
+        return;
+    Vector3D inside_centre;
+    for ( size_t k( 0 ); k != ninside; ++k )
+        inside_centre += p[ inside[k] ];
+    Vector3D outside_centre;
+    for ( size_t k( 0 ); k != noutside; ++k )
+        outside_centre += p[ outside[k] ];
+    const Vector3D outward = outside_centre / static_cast< double >( noutside ) - inside_centre / static_cast< double >( ninside );
+    if ( ninside == 2 )
+    {
+        // A quadrilateral
+        const size_t a = inside[0];
+        const size_t b = inside[1];
+        const size_t c = outside[0];
+        const size_t d = outside[1];
+        const Vector3D p_ac = interpolate( p[a], f[a], p[c], f[c] );
+        const Vector3D p_ad = interpolate( p[a], f[a], p[d], f[d] );
+        const Vector3D p_bd = interpolate( p[b], f[b], p[d], f[d] );
+        const Vector3D p_bc = interpolate( p[b], f[b], p[c], f[c] );
+        add_triangle( p_ac, p_ad, p_bd, outward, triangles );
+        add_triangle( p_ac, p_bd, p_bc, outward, triangles );
+        return;
+    }
+    // One vertex is separated from the other three
+    const size_t single = ( ninside == 1 ) ? inside[0] : outside[0];
+    const size_t * others = ( ninside == 1 ) ? outside : inside;
+    add_triangle( interpolate( p[single], f[single], p[ others[0] ], f[ others[0] ] ),
+                  interpolate( p[single], f[single], p[ others[1] ], f[ others[1] ] ),
+                  interpolate( p[single], f[single], p[ others[2] ], f[ others[2] ] ), outward, triangles );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+FingerprintPlot::FingerprintPlot( const double minimum, const double maximum, const double bin_width ):
+minimum_(minimum),
+bin_width_(bin_width),
+nbins_(0)
+{
+    if ( ! ( ( bin_width > 0.0 ) && ( minimum < maximum ) ) )
+        throw std::runtime_error( "FingerprintPlot::FingerprintPlot(): invalid range." );
+    nbins_ = round_to_size_t( ( maximum - minimum ) / bin_width );
+    areas_.assign( nbins_ * nbins_, 0.0 );
+}
+
+// ********************************************************************************
+
+void FingerprintPlot::add( const double d_i, const double d_e, const double area )
+{
+    const double i = std::floor( ( d_i - minimum_ ) / bin_width_ );
+    const double e = std::floor( ( d_e - minimum_ ) / bin_width_ );
+    // Also false for infinite distances
+    if ( ( i >= 0.0 ) && ( i < nbins_ ) && ( e >= 0.0 ) && ( e < nbins_ ) )
+        areas_[ static_cast< size_t >( i ) * nbins_ + static_cast< size_t >( e ) ] += area;
+}
+
+// ********************************************************************************
+
+double FingerprintPlot::total_area() const
+{
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != areas_.size(); ++i )
+        result += areas_[i];
+    return result;
+}
+
+// ********************************************************************************
+
+MolecularSurface::MolecularSurface( const CrystalStructure & crystal_structure, const size_t molecule, const SurfaceType surface_type, const double grid_spacing ):
+area_(0.0),
+volume_(0.0)
+{
+    if ( molecule >= crystal_structure.nmolecules() )
+        throw std::runtime_error( "MolecularSurface::MolecularSurface(): molecule index out of range." );
+    if ( ! ( grid_spacing > 0.0 ) )
+        throw std::runtime_error( "MolecularSurface::MolecularSurface(): grid spacing must be positive." );
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    const size_t natoms = crystal_structure.natoms();
+    std::vector< Vector3D > positions;
+    std::vector< double > radii;
+    positions.reserve( natoms );
+    radii.reserve( natoms );
+    double maximum_radius( 0.0 );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        positions.push_back( crystal_structure.atom( i ).position() );
+        radii.push_back( crystal_structure.atom( i ).element().Van_der_Waals_radius() );
+        maximum_radius = std::max( maximum_radius, radii.back() );
+    }
+    // An atom contributes to the field up to reach beyond its Van der Waals radius. For VAN_DER_WAALS, the field is only needed
+    // at the corners of the cubes that the surface passes through.
+    const double reach = ( surface_type == VAN_DER_WAALS ) ? std::sqrt( 3.0 ) * grid_spacing : Hirshfeld_reach;
+    const double search_radius = std::max( maximum_radius + reach, FingerprintPlot().maximum() );
+    // The atoms that can contribute to the field at a grid point, or be nearest to a point on the surface, are within
+    // ( R_i + reach ) + search_radius of an atom i of the molecule. All their lattice translations within that distance are collected,
+    // the cell list finds the atoms of which the nearest image is within that distance.
+    const MoleculeInCrystal molecule_in_crystal = crystal_structure.molecule_in_crystal( molecule );
+    const double maximum_distance = maximum_radius + reach + search_radius;
+    const CellList cell_list( crystal_lattice, positions, maximum_distance );
+    int ntranslations[3];
+    const double reciprocal_lengths[3] = { crystal_lattice.a_star(), crystal_lattice.b_star(), crystal_lattice.c_star() };
+    for ( size_t k( 0 ); k != 3; ++k )
+        ntranslations[k] = static_cast< int >( std::ceil( maximum_distance * reciprocal_lengths[k] ) );
+    std::vector< AtomImage > images;
+    std::vector< size_t > image_atoms;
+    std::vector< Vector3D > image_translations;
+    std::vector< size_t > candidates;
+    Vector3D minimum_corner( std::numeric_limits< double >::max(), std::numeric_limits< double >::max(), std::numeric_limits< double >::max() );
+    Vector3D maximum_corner( -std::numeric_limits< double >::max(), -std::numeric_limits< double >::max(), -std::numeric_limits< double >::max() );
+    for ( size_t m( 0 ); m != molecule_in_crystal.natoms(); ++m )
+    {
+        const size_t i = molecule_in_crystal.atom_index( m );
+        const Vector3D position = crystal_lattice.fractional_to_orthogonal( positions[i] );
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            minimum_corner.set_value( k, std::min( minimum_corner.value( k ), position.value( k ) - radii[i] - reach ) );
+            maximum_corner.set_value( k, std::max( maximum_corner.value( k ), position.value( k ) + radii[i] + reach ) );
+        }
+        cell_list.candidates( positions[i], candidates );
+        for ( size_t c( 0 ); c != candidates.size(); ++c )
+        {
+            const size_t j = candidates[c];
+            double distance;
+            Vector3D difference_vector;
+            crystal_lattice.shortest_distance( positions[i], positions[j], distance, difference_vector );
+            const Vector3D nearest = difference_vector - ( positions[j] - positions[i] );
+            for ( int u( -ntranslations[0] ); u <= ntranslations[0]; ++u )
+            {
+                for ( int v( -ntranslations[1] ); v <= ntranslations[1]; ++v )
+                {
+                    for ( int w( -ntranslations[2] ); w <= ntranslations[2]; ++w )
+                    {
+                        const Vector3D translation( std::round( nearest.x() ) + u, std::round( nearest.y() ) + v, std::round( nearest.z() ) + w );
+                        const double distance2 = crystal_lattice.fractional_to_orthogonal( positions[j] + translation - positions[i] ).norm2();
+                        if ( distance2 > square( radii[i] + reach + search_radius ) )
+                            continue;
+                        image_atoms.push_back( j );
+                        image_translations.push_back( translation );
+                    }
+                }
+            }
+        }
+    }
+    // Remove the duplicates
+    {
+    std::vector< size_t > order( image_atoms.size() );
+    for ( size_t i( 0 ); i != order.size(); ++i )
+        order[i] = i;
+    std::sort( order.begin(), order.end(), [&]( const size_t lhs, const size_t rhs )
+    {
+        if ( image_atoms[lhs] != image_atoms[rhs] )
+            return image_atoms[lhs] < image_atoms[rhs];
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            if ( image_translations[lhs].value( k ) != image_translations[rhs].value( k ) )
+                return image_translations[lhs].value( k ) < image_translations[rhs].value( k );
+        }
+        return false;
+    } );
+    for ( size_t i( 0 ); i != order.size(); ++i )
+    {
+        const size_t j = order[i];
+        if ( ( i != 0 ) && ( image_atoms[j] == image_atoms[ order[i-1] ] ) && nearly_equal( image_translations[j], image_translations[ order[i-1] ] ) )
+            continue;
+        AtomImage image;
+        image.position_ = crystal_lattice.fractional_to_orthogonal( positions[ image_atoms[j] ] + image_translations[j] );
+        image.radius_ = radii[ image_atoms[j] ];
+        image.is_in_molecule_ = ( crystal_structure.molecule_index( image_atoms[j] ) == molecule ) && image_translations[j].is_zero_vector();
+        images.push_back( image );
+    }
+    }
+    // The grid, one spacing wider than the region where the molecule contributes, so that the border is outside
+    const Vector3D origin = minimum_corner - Vector3D( grid_spacing, grid_spacing, grid_spacing );
+    size_t n[3];
+    for ( size_t k( 0 ); k != 3; ++k )
+        n[k] = static_cast< size_t >( std::ceil( ( maximum_corner.value( k ) - minimum_corner.value( k ) ) / grid_spacing ) ) + 3;
+    const size_t npoints = n[0] * n[1] * n[2];
+    // Only the points within reach of an atom of the molecule are evaluated, the others are outside
+    std::vector< char > is_near( npoints, 0 );
+    std::vector< double > minimum_distances; // VAN_DER_WAALS: the distance to the nearest Van der Waals sphere of the molecule
+    std::vector< double > molecule_densities; // HIRSHFELD
+    std::vector< double > crystal_densities;
+    if ( surface_type == VAN_DER_WAALS )
+        minimum_distances.assign( npoints, reach );
+    else
+    {
+        molecule_densities.assign( npoints, 0.0 );
+        crystal_densities.assign( npoints, 0.0 );
+    }
+    // Each atom image is spread over the grid points within its reach
+    for ( size_t pass( 0 ); pass != 2; ++pass )
+    {
+        for ( size_t a( 0 ); a != images.size(); ++a )
+        {
+            const AtomImage & image = images[a];
+            // First the atoms of the molecule mark the points that are near, then the other atoms contribute only to those
+            if ( image.is_in_molecule_ != ( pass == 0 ) )
+                continue;
+            if ( ( surface_type == VAN_DER_WAALS ) && ( ! image.is_in_molecule_ ) )
+                continue;
+            const double radius = image.radius_ + reach;
+            size_t begin[3];
+            size_t end[3];
+            bool is_outside_grid( false );
+            for ( size_t k( 0 ); k != 3; ++k )
+            {
+                const double lower = std::ceil( ( image.position_.value( k ) - radius - origin.value( k ) ) / grid_spacing );
+                const double upper = std::floor( ( image.position_.value( k ) + radius - origin.value( k ) ) / grid_spacing );
+                if ( ( upper < 0.0 ) || ( lower > n[k] - 1 ) )
+                    is_outside_grid = true;
+                begin[k] = static_cast< size_t >( std::max( lower, 0.0 ) );
+                end[k] = static_cast< size_t >( std::min( upper, static_cast< double >( n[k] - 1 ) ) ) + 1;
+            }
+            if ( is_outside_grid )
+                continue;
+            for ( size_t i( begin[0] ); i != end[0]; ++i )
+            {
+                const double dx2 = square( origin.x() + i * grid_spacing - image.position_.x() );
+                for ( size_t j( begin[1] ); j != end[1]; ++j )
+                {
+                    const double dxy2 = dx2 + square( origin.y() + j * grid_spacing - image.position_.y() );
+                    for ( size_t k( begin[2] ); k != end[2]; ++k )
+                    {
+                        const double distance2 = dxy2 + square( origin.z() + k * grid_spacing - image.position_.z() );
+                        if ( distance2 > square( radius ) )
+                            continue;
+                        const size_t index = ( i * n[1] + j ) * n[2] + k;
+                        if ( pass == 0 )
+                            is_near[index] = 1;
+                        else if ( ! is_near[index] )
+                            continue;
+                        const double distance = std::sqrt( distance2 );
+                        if ( surface_type == VAN_DER_WAALS )
+                            minimum_distances[index] = std::min( minimum_distances[index], distance - image.radius_ );
+                        else
+                        {
+                            const double density = std::exp( -( distance - image.radius_ ) / promolecule_decay_length );
+                            crystal_densities[index] += density;
+                            if ( image.is_in_molecule_ )
+                                molecule_densities[index] += density;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    // The field, negative inside
+    std::vector< double > field( npoints );
+    for ( size_t i( 0 ); i != npoints; ++i )
+    {
+        if ( surface_type == VAN_DER_WAALS )
+            field[i] = minimum_distances[i];
+        else
+            field[i] = ( crystal_densities[i] == 0.0 ) ? 0.5 : 0.5 - molecule_densities[i] / crystal_densities[i];
+    }
+    // Marching tetrahedra
+    for ( size_t i( 0 ); i + 1 < n[0]; ++i )
+    {
+        for ( size_t j( 0 ); j + 1 < n[1]; ++j )
+        {
+            for ( size_t k( 0 ); k + 1 < n[2]; ++k )
+            {
+                Vector3D p[8];
+                double f[8];
+                bool has_inside( false );
+                bool has_outside( false );
+                for ( size_t c( 0 ); c != 8; ++c )
+                {
+                    const size_t di = c & 1;
+                    const size_t dj = ( c >> 1 ) & 1;
+                    const size_t dk = ( c >> 2 ) & 1;
+                    f[c] = field[ ( ( i + di ) * n[1] + ( j + dj ) ) * n[2] + ( k + dk ) ];
+                    if ( f[c] < 0.0 )
+                        has_inside = true;
+                    else
+                        has_outside = true;
+                }
+                if ( ! ( has_inside && has_outside ) )
+                    continue;
+                for ( size_t c( 0 ); c != 8; ++c )
+                    p[c] = origin + grid_spacing * Vector3D( i + ( c & 1 ), j + ( ( c >> 1 ) & 1 ), k + ( ( c >> 2 ) & 1 ) );
+                for ( size_t t( 0 ); t != 6; ++t )
+                {
+                    const Vector3D tetrahedron_p[4] = { p[ tetrahedra[t][0] ], p[ tetrahedra[t][1] ], p[ tetrahedra[t][2] ], p[ tetrahedra[t][3] ] };
+                    const double tetrahedron_f[4] = { f[ tetrahedra[t][0] ], f[ tetrahedra[t][1] ], f[ tetrahedra[t][2] ], f[ tetrahedra[t][3] ] };
+                    triangulate_tetrahedron( tetrahedron_p, tetrahedron_f, triangles_ );
+                }
+            }
+        }
+    }
+    area_ = total_area( triangles_ );
+    volume_ = enclosed_volume( triangles_ );
+    // d_i and d_e
+    d_i_.assign( triangles_.size(), std::numeric_limits< double >::infinity() );
+    d_e_.assign( triangles_.size(), std::numeric_limits< double >::infinity() );
+    for ( size_t t( 0 ); t != triangles_.size(); ++t )
+    {
+        const Vector3D centroid = triangles_[t].centroid();
+        double d_i2 = std::numeric_limits< double >::infinity();
+        double d_e2 = std::numeric_limits< double >::infinity();
+        for ( size_t a( 0 ); a != images.size(); ++a )
+        {
+            const double distance2 = ( images[a].position_ - centroid ).norm2();
+            if ( images[a].is_in_molecule_ )
+                d_i2 = std::min( d_i2, distance2 );
+            else
+                d_e2 = std::min( d_e2, distance2 );
+        }
+        d_i_[t] = std::sqrt( d_i2 );
+        if ( d_e2 <= square( search_radius ) )
+            d_e_[t] = std::sqrt( d_e2 );
+    }
+}
+
+// ********************************************************************************
+
+FingerprintPlot MolecularSurface::fingerprint_plot( const FingerprintPlot & empty_fingerprint_plot ) const
+{
+    FingerprintPlot result( empty_fingerprint_plot );
+    for ( size_t i( 0 ); i != triangles_.size(); ++i )
+        result.add( d_i_[i], d_e_[i], triangles_[i].area() );
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< MolecularSurfaceProperties > molecular_surface_properties( const std::vector< CrystalStructure > & crystal_structures,
+                                                                        const MolecularSurface::SurfaceType surface_type,
+                                                                        const double grid_spacing,
+                                                                        const size_t nthreads )
+{
+    // One job per molecule, so that a structure with many molecules does not hold up the others
+    std::vector< MolecularSurfaceProperties > result;
+    for ( size_t i( 0 ); i != crystal_structures.size(); ++i )
+    {
+        if ( ( crystal_structures[i].natoms() != 0 ) && ( crystal_structures[i].nmolecules() == 0 ) )
+            throw std::runtime_error( "molecular_surface_properties(): perceive_molecules() must be called first." );
+        for ( size_t j( 0 ); j != crystal_structures[i].nmolecules(); ++j )
+        {
+            MolecularSurfaceProperties properties;
+            properties.crystal_structure_ = i;
+            properties.molecule_ = j;
+            properties.area_ = 0.0;
+            properties.volume_ = 0.0;
+            result.push_back( properties );
+        }
+    }
+    parallel_for( result.size(), nthreads, [&]( const size_t i )
+    {
+        const MolecularSurface molecular_surface( crystal_structures[ result[i].crystal_structure_ ], result[i].molecule_, surface_type, grid_spacing );
+        result[i].area_ = molecular_surface.area();
+        result[i].volume_ = molecular_surface.volume();
+        result[i].fingerprint_plot_ = molecular_surface.fingerprint_plot();
+    } );
+    return result;
+}
+
@@ -0,0 +1,140 @@
+#ifndef MOLECULARSURFACE_H
+#define MOLECULARSURFACE_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+class CrystalStructure;
+
+#include "Triangle.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+/*
+  A 2D histogram of the surface area of a molecular surface over d_i, the distance from a point on the surface to the nearest
+  atom inside, and d_e, the distance to the nearest atom outside (Spackman & McKinnon, CrystEngComm 4, 378-392 (2002)).
+*/
+class FingerprintPlot
+{
+public:
+
+    // d_i and d_e from minimum to maximum in bins of bin_width, in A.
+    explicit FingerprintPlot( const double minimum = 0.4, const double maximum = 2.6, const double bin_width = 0.01 );
+
+    size_t nbins() const { return nbins_; }
+    double minimum() const { return minimum_; }
+    double maximum() const { return minimum_ + nbins_ * bin_width_; }
+    double bin_width() const { return bin_width_; }
+
+    // Ignored if d_i or d_e is outside the range.
+    void add( const double d_i, const double d_e, const double area );
+
+    // The surface area in bin i of d_i and bin e of d_e, in A^2.
+    double area( const size_t i, const size_t e ) const { return areas_[ i * nbins_ + e ]; }
+
+    // The surface area within the range.
+    double total_area() const;
+
+private:
+    double minimum_;
+    double bin_width_;
+    size_t nbins_;
+    std::vector< double > areas_;
+};
+
+/*
+  The surface of one molecule in a crystal structure, as a soup of triangles.
+
+      VAN_DER_WAALS  the surface of the union of the Van der Waals spheres of the atoms of the molecule.
+      HIRSHFELD      the surface where the promolecule density of the molecule is half the promolecule density of the crystal
+                     (Spackman & Byrom, Chem. Phys. Lett. 267, 215-220 (1997)). The spherical atomic densities are approximated by
+                     exp( -( r - R_vdW ) / 0.5 A ), so the surface lies halfway between the Van der Waals surfaces of neighbouring atoms.
+
+  The field that defines the surface is evaluated on a cubic grid around the molecule, but only at the grid points near its atoms;
+  the other points are outside by construction. The atoms that can contribute, the other molecules and the lattice translations
+  of the molecule itself, are found once per molecule with a CellList of all atoms in the unit cell. The isosurface is triangulated by marching tetrahedra, each grid cube is divided into six tetrahedra
+  along its main diagonal, which gives a closed surface without the ambiguous cases of marching cubes. The normals of the
+  triangles point outwards, so volume() follows from the divergence theorem.
+
+  The space-group symmetry must have been applied and the molecules perceived with CrystalStructure::perceive_molecules().
+*/
+class MolecularSurface
+{
+public:
+
+    enum SurfaceType { VAN_DER_WAALS, HIRSHFELD };
+
+    // grid_spacing in A.
+    MolecularSurface( const CrystalStructure & crystal_structure, const size_t molecule, const SurfaceType surface_type = HIRSHFELD, const double grid_spacing = 0.2 );
+
+    size_t ntriangles() const { return triangles_.size(); }
+    const Triangle & triangle( const size_t i ) const { return triangles_[i]; }
+    const std::vector< Triangle > & triangles() const { return triangles_; }
+
+    // In A^2.
+    double area() const { return area_; }
+
+    // In A^3.
+    double volume() const { return volume_; }
+
+    // The distances from the centroid of triangle i to the nearest atom of the molecule and to the nearest other atom, in A.
+    // d_e is infinite if there is no other atom within the largest of maximum() of the default FingerprintPlot and the reach of the field.
+    double d_i( const size_t i ) const { return d_i_[i]; }
+    double d_e( const size_t i ) const { return d_e_[i]; }
+
+    FingerprintPlot fingerprint_plot( const FingerprintPlot & empty_fingerprint_plot = FingerprintPlot() ) const;
+
+private:
+    std::vector< Triangle > triangles_;
+    std::vector< double > d_i_;
+    std::vector< double > d_e_;
+    double area_;
+    double volume_;
+};
+
+struct MolecularSurfaceProperties
+{
+    size_t crystal_structure_;
+    size_t molecule_;
+    double area_;   // A^2
+    double volume_; // A^3
+    FingerprintPlot fingerprint_plot_;
+};
+
+// The surfaces of all molecules of all crystal structures, e.g. a set of crystal structure predictions, in parallel over the molecules
+// on nthreads threads (0 means one thread per core). Ordered by crystal structure, then by molecule.
+// The space-group symmetry must have been applied and the molecules perceived.
+std::vector< MolecularSurfaceProperties > molecular_surface_properties( const std::vector< CrystalStructure > & crystal_structures,
+                                                                        const MolecularSurface::SurfaceType surface_type = MolecularSurface::HIRSHFELD,
+                                                                        const double grid_spacing = 0.2,
+                                                                        const size_t nthreads = 0 );
+
+#endif // MOLECULARSURFACE_H
+
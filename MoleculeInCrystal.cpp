@@ -29,21 +29,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // ********************************************************************************
 
-MoleculeInCrystal::MoleculeInCrystal()
+MoleculeInCrystal::MoleculeInCrystal():
+atoms_(0),
+atom_indices_(0),
+natoms_(0)
 {
 }
 
-
-//bool MoleculeInCrystal::is_on_special_position( const CrystalStructure & crystal_structure ) const
-//{
-//}
-
 // ********************************************************************************
 
-void MoleculeInCrystal::add_atoms( const std::vector< Atom > & atoms )
+MoleculeInCrystal::MoleculeInCrystal( const Atom * atoms, const size_t * atom_indices, const size_t natoms ):
+atoms_(atoms),
+atom_indices_(atom_indices),
+natoms_(natoms)
 {
-    atoms_.reserve( atoms_.size() + atoms.size() );
-    atoms_.insert( atoms_.end(), atoms.begin(), atoms.end() );
 }
 
 // ********************************************************************************
@@ -30,40 +30,43 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Atom.h"
 
-#include <vector>
+#include <cstddef> // For definition of size_t
 
 /*
     A molecule in a crystal, in other words, the atoms have 3D coordinates and these 3D coordinates are fractional coordinates.
-    It has a method "is_on_special_position()", which is also pretty specific to a molecule in a crystal.
     The crystal lattice is not stored with the molecule but must be kept track of by the user.
     
     I guess this means that this molecule can be disordered (whereas a Molecule2D or a Molecule3D cannot be disordered.
     A Molecule2D would be a chemical diagram, just a topology/connectivity, a Molecule3D would be the
     class that you would use in a conformer search, coordinates would be Cartesian and the molecule cannot be disordered.)
+
+    The atoms are not copied: a MoleculeInCrystal is a view of the atoms of the CrystalStructure it was obtained from with
+    CrystalStructure::molecule_in_crystal(), through the indices of its atoms. It is therefore cheap to create and it always
+    agrees with the crystal structure, but it is only valid as long as the atoms and molecules of the crystal structure are
+    not changed. The atom perception algorithm moves the atoms so that they form connected molecules, so no lattice translations
+    have to be stored with the indices.
 */
 class MoleculeInCrystal
 {
 public:
 
-    // Default constructor
+    // Default constructor, a molecule without atoms
     MoleculeInCrystal();
 
-    size_t natoms() const { return atoms_.size(); }
+    // atom_indices must point to natoms indices into atoms.
+    MoleculeInCrystal( const Atom * atoms, const size_t * atom_indices, const size_t natoms );
 
-    void add_atom( const Atom & atom ) { atoms_.push_back( atom ); }
-    void add_atoms( const std::vector< Atom > & atoms );
+    size_t natoms() const { return natoms_; }
 
-    // This should probably be a member function of CrystalStructure: molecule_is_on_special_position( const size_t i );
-  //  bool is_on_special_position( const CrystalStructure & crystal_structure ) const;
+    const Atom & atom( const size_t i ) const { return atoms_[ atom_indices_[i] ]; }
 
-    Atom atom( const size_t i ) const { return atoms_[i]; }
-    
-    void set_atom( const size_t i, const Atom & new_atom ) { atoms_[i] = new_atom; }
+    // The index of atom i in the crystal structure.
+    size_t atom_index( const size_t i ) const { return atom_indices_[i]; }
 
 private:
-    // The atom perception algorithm moves atoms so that they form connected molecules,
-    // so we cannot use indices but must really store entire atoms.
-    std::vector< Atom > atoms_;
+    const Atom * atoms_;
+    const size_t * atom_indices_;
+    size_t natoms_;
 };
 
 #endif // MOLECULEINCRYSTAL_H
@@ -0,0 +1,331 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "NiggliReduction.h"
+#include "3DCalculations.h"
+#include "MathFunctions.h"
+#include "SpaceGroup.h"
+#include "SymmetryOperator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace
+{
+
+// The G6 vector of the basis vectors given by the rows of transformation_matrix
+void G6_vector( const CrystalLattice & crystal_lattice, const Matrix3D & transformation_matrix, double * g6 )
+{
+    Vector3D basis_vectors[3];
+    for ( size_t i( 0 ); i != 3; ++i )
+        basis_vectors[i] = transformation_matrix.value( i, 0 ) * crystal_lattice.a_vector() +
+                           transformation_matrix.value( i, 1 ) * crystal_lattice.b_vector() +
+                           transformation_matrix.value( i, 2 ) * crystal_lattice.c_vector();
+    g6[0] = basis_vectors[0] * basis_vectors[0];
+    g6[1] = basis_vectors[1] * basis_vectors[1];
+    g6[2] = basis_vectors[2] * basis_vectors[2];
+    g6[3] = 2.0 * ( basis_vectors[1] * basis_vectors[2] );
+    g6[4] = 2.0 * ( basis_vectors[0] * basis_vectors[2] );
+    g6[5] = 2.0 * ( basis_vectors[0] * basis_vectors[1] );
+}
+
+// ********************************************************************************
+
+// Multiplies row i by factors[i]
+void scale_rows( Matrix3D & matrix, const int factors[3] )
+{
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+            matrix.set_value( i, j, factors[i] * matrix.value( i, j ) );
+    }
+}
+
+// ********************************************************************************
+
+// Row i += factor * row j
+void add_row( Matrix3D & matrix, const size_t i, const double factor, const size_t j )
+{
+    for ( size_t k( 0 ); k != 3; ++k )
+        matrix.set_value( i, k, matrix.value( i, k ) + factor * matrix.value( j, k ) );
+}
+
+// ********************************************************************************
+
+int sign_with_tolerance( const double x, const double tolerance )
+{
+    if ( x > tolerance )
+        return 1;
+    if ( x < -tolerance )
+        return -1;
+    return 0;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+Matrix3D Niggli_reduction_matrix( const CrystalLattice & crystal_lattice, const double relative_tolerance )
+{
+    const double e = relative_tolerance * std::pow( crystal_lattice.volume(), 2.0 / 3.0 );
+    Matrix3D result;
+    double g6[6];
+    const size_t maximum_niterations( 1000 );
+    for ( size_t iteration( 0 ); ; ++iteration )
+    {
+        if ( iteration == maximum_niterations )
+            throw std::runtime_error( "Niggli_reduction_matrix(): no convergence." );
+        G6_vector( crystal_lattice, result, g6 );
+        double & A = g6[0];
+        double & B = g6[1];
+        double & C = g6[2];
+        double & xi   = g6[3];
+        double & eta  = g6[4];
+        double & zeta = g6[5];
+        // A1: sort A <= B, a -> -b, b -> -a, c -> -c
+        if ( ( A > B + e ) || ( ( std::abs( A - B ) <= e ) && ( std::abs( xi ) > std::abs( eta ) + e ) ) )
+        {
+            result = Matrix3D( -result.value( 1, 0 ), -result.value( 1, 1 ), -result.value( 1, 2 ),
+                               -result.value( 0, 0 ), -result.value( 0, 1 ), -result.value( 0, 2 ),
+                               -result.value( 2, 0 ), -result.value( 2, 1 ), -result.value( 2, 2 ) );
+            G6_vector( crystal_lattice, result, g6 );
+        }
+        // A2: sort B <= C, a -> -a, b -> -c, c -> -b
+        if ( ( B > C + e ) || ( ( std::abs( B - C ) <= e ) && ( std::abs( eta ) > std::abs( zeta ) + e ) ) )
+        {
+            result = Matrix3D( -result.value( 0, 0 ), -result.value( 0, 1 ), -result.value( 0, 2 ),
+                               -result.value( 2, 0 ), -result.value( 2, 1 ), -result.value( 2, 2 ),
+                               -result.value( 1, 0 ), -result.value( 1, 1 ), -result.value( 1, 2 ) );
+            continue;
+        }
+        // A3 / A4: make xi, eta and zeta all positive (type I) or all non-positive (type II) by changing the signs of the basis vectors
+        {
+            int t_xi   = sign_with_tolerance( xi  , e );
+            int t_eta  = sign_with_tolerance( eta , e );
+            int t_zeta = sign_with_tolerance( zeta, e );
+            int factors[3];
+            if ( t_xi * t_eta * t_zeta == 1 )
+            {
+                factors[0] = t_zeta;
+                factors[1] = 1;
+                factors[2] = t_xi;
+            }
+            else
+            {
+                // Zeros can have either sign, choose them such that the product is negative
+                int * ts[3] = { &t_xi, &t_eta, &t_zeta };
+                int product( 1 );
+                for ( size_t i( 0 ); i != 3; ++i )
+                {
+                    if ( *ts[i] == 0 )
+                        *ts[i] = 1;
+                    product *= *ts[i];
+                }
+                if ( product == 1 )
+                {
+                    for ( size_t i( 0 ); i != 3; ++i )
+                    {
+                        if ( sign_with_tolerance( ( i == 0 ) ? xi : ( ( i == 1 ) ? eta : zeta ), e ) == 0 )
+                        {
+                            *ts[i] = -1;
+                            break;
+                        }
+                    }
+                }
+                factors[0] = -t_zeta;
+                factors[1] = 1;
+                factors[2] = -t_xi;
+            }
+            // Keep the basis right-handed, changing the signs of all three basis vectors does not change xi, eta or zeta
+            if ( factors[0] * factors[1] * factors[2] == -1 )
+            {
+                for ( size_t i( 0 ); i != 3; ++i )
+                    factors[i] = -factors[i];
+            }
+            scale_rows( result, factors );
+            G6_vector( crystal_lattice, result, g6 );
+        }
+        // A5: c -> c - sign(xi) b. In A5 to A7, the value whose sign is used is never zero.
+        if ( ( std::abs( xi ) > B + e ) ||
+             ( ( std::abs( xi - B ) <= e ) && ( 2.0 * eta < zeta - e ) ) ||
+             ( ( std::abs( xi + B ) <= e ) && ( zeta < -e ) ) )
+        {
+            add_row( result, 2, -sign( xi ), 1 );
+            continue;
+        }
+        // A6: c -> c - sign(eta) a
+        if ( ( std::abs( eta ) > A + e ) ||
+             ( ( std::abs( eta - A ) <= e ) && ( 2.0 * xi < zeta - e ) ) ||
+             ( ( std::abs( eta + A ) <= e ) && ( zeta < -e ) ) )
+        {
+            add_row( result, 2, -sign( eta ), 0 );
+            continue;
+        }
+        // A7: b -> b - sign(zeta) a
+        if ( ( std::abs( zeta ) > A + e ) ||
+             ( ( std::abs( zeta - A ) <= e ) && ( 2.0 * xi < eta - e ) ) ||
+             ( ( std::abs( zeta + A ) <= e ) && ( eta < -e ) ) )
+        {
+            add_row( result, 1, -sign( zeta ), 0 );
+            continue;
+        }
+        // A8: c -> a + b + c
+        const double sum = xi + eta + zeta + A + B;
+        if ( ( sum < -e ) || ( ( std::abs( sum ) <= e ) && ( 2.0 * ( A + eta ) + zeta > e ) ) )
+        {
+            add_row( result, 2, 1.0, 0 );
+            add_row( result, 2, 1.0, 1 );
+            continue;
+        }
+        return result;
+    }
+}
+
+// ********************************************************************************
+
+CrystalLattice Niggli_reduce( const CrystalLattice & crystal_lattice, const double relative_tolerance )
+{
+    CrystalLattice result( crystal_lattice );
+    result.transform( Niggli_reduction_matrix( crystal_lattice, relative_tolerance ) );
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< double > G6_vector( const CrystalLattice & crystal_lattice )
+{
+    std::vector< double > result( 6 );
+    G6_vector( crystal_lattice, Matrix3D(), &result[0] );
+    return result;
+}
+
+// ********************************************************************************
+
+double G6_distance( const std::vector< double > & lhs, const std::vector< double > & rhs )
+{
+    if ( ( lhs.size() != 6 ) || ( rhs.size() != 6 ) )
+        throw std::runtime_error( "G6_distance(): G6 vectors must have six elements." );
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != 6; ++i )
+        result += square( lhs[i] - rhs[i] );
+    return std::sqrt( result );
+}
+
+// ********************************************************************************
+
+double G6_distance( const CrystalLattice & lhs, const CrystalLattice & rhs )
+{
+    return G6_distance( G6_vector( Niggli_reduce( lhs ) ), G6_vector( Niggli_reduce( rhs ) ) );
+}
+
+// ********************************************************************************
+
+Matrix3D primitive_basis_matrix( const SpaceGroup & space_group )
+{
+    // The lattice vectors a, b, c and the centring vectors generate the primitive lattice. Centring vectors are multiples of 1/12,
+    // so the generators are integers in units of 1/12 and an integer row reduction (Euclid's algorithm on each column) gives a basis.
+    const int denominator( 12 );
+    std::vector< std::vector< long > > generators;
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        std::vector< long > generator( 3, 0 );
+        generator[i] = denominator;
+        generators.push_back( generator );
+    }
+    for ( size_t j( 0 ); j != space_group.nsymmetry_operators(); ++j )
+    {
+        const SymmetryOperator & symmetry_operator = space_group.symmetry_operator( j );
+        if ( ! ( symmetry_operator.rotation() == Matrix3D() ) )
+            continue;
+        std::vector< long > generator( 3 );
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            const double value = denominator * symmetry_operator.translation().value( k );
+            generator[k] = std::lround( value );
+            if ( std::abs( value - generator[k] ) > 1.0E-3 )
+                throw std::runtime_error( "primitive_basis_matrix(): centring vector is not a multiple of 1/12." );
+        }
+        generators.push_back( generator );
+    }
+    for ( size_t column( 0 ); column != 3; ++column )
+    {
+        // Reduce until only the pivot row has a non-zero entry in this column
+        for ( ; ; )
+        {
+            size_t pivot = generators.size();
+            for ( size_t i( column ); i != generators.size(); ++i )
+            {
+                if ( ( generators[i][column] != 0 ) && ( ( pivot == generators.size() ) || ( std::labs( generators[i][column] ) < std::labs( generators[pivot][column] ) ) ) )
+                    pivot = i;
+            }
+            if ( pivot == generators.size() )
+                throw std::runtime_error( "primitive_basis_matrix(): lattice is not three-dimensional." );
+            std::swap( generators[column], generators[pivot] );
+            bool is_reduced( true );
+            for ( size_t i( column + 1 ); i != generators.size(); ++i )
+            {
+                const long quotient = generators[i][column] / generators[column][column];
+                for ( size_t k( 0 ); k != 3; ++k )
+                    generators[i][k] -= quotient * generators[column][k];
+                if ( generators[i][column] != 0 )
+                    is_reduced = false;
+            }
+            if ( is_reduced )
+                break;
+        }
+    }
+    Matrix3D result( 0.0 );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t k( 0 ); k != 3; ++k )
+            result.set_value( i, k, static_cast< double >( generators[i][k] ) / denominator );
+    }
+    // Keep the basis right-handed
+    if ( result.determinant() < 0.0 )
+    {
+        for ( size_t k( 0 ); k != 3; ++k )
+            result.set_value( 2, k, -result.value( 2, k ) );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+CrystalLattice primitive_cell( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group )
+{
+    const Matrix3D m = primitive_basis_matrix( space_group );
+    Vector3D new_a = m.value( 0, 0 ) * crystal_lattice.a_vector() + m.value( 0, 1 ) * crystal_lattice.b_vector() + m.value( 0, 2 ) * crystal_lattice.c_vector();
+    Vector3D new_b = m.value( 1, 0 ) * crystal_lattice.a_vector() + m.value( 1, 1 ) * crystal_lattice.b_vector() + m.value( 1, 2 ) * crystal_lattice.c_vector();
+    Vector3D new_c = m.value( 2, 0 ) * crystal_lattice.a_vector() + m.value( 2, 1 ) * crystal_lattice.b_vector() + m.value( 2, 2 ) * crystal_lattice.c_vector();
+    return CrystalLattice( new_a.length(), new_b.length(), new_c.length(), angle( new_b, new_c ), angle( new_a, new_c ), angle( new_a, new_b ) );
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,73 @@
+#ifndef NIGGLIREDUCTION_H
+#define NIGGLIREDUCTION_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class SpaceGroup;
+
+#include "CrystalLattice.h"
+#include "Matrix3D.h"
+
+#include <vector>
+
+/*
+  Niggli reduction of a (primitive) lattice with the Krivy-Gruber algorithm, with the numerically stable
+  tolerances of Grosse-Kunstleve, Sauter and Adams (2004). The tolerance is relative to V^(2/3).
+
+  The steps are carried out on the integer transformation matrix, the G6 vector is recalculated from the
+  transformed basis vectors after each step, so the transformation matrix is exact. Centred lattices must be
+  transformed to a primitive lattice first.
+*/
+
+// Returns the transformation matrix in the convention of CrystalLattice::transform(): the rows are the new basis
+// vectors in terms of the old ones. The determinant is 1.
+Matrix3D Niggli_reduction_matrix( const CrystalLattice & crystal_lattice, const double relative_tolerance = 1.0E-5 );
+
+CrystalLattice Niggli_reduce( const CrystalLattice & crystal_lattice, const double relative_tolerance = 1.0E-5 );
+
+// The transformation matrix, in the convention of CrystalLattice::transform(), from the conventional cell to a primitive cell,
+// using the centring vectors (the symmetry operators with a unit rotation) of the space group. The unit matrix for a primitive space group.
+// The primitive cell is not reduced.
+Matrix3D primitive_basis_matrix( const SpaceGroup & space_group );
+
+// The primitive cell given by primitive_basis_matrix(). Unlike CrystalLattice::transform(), does not warn that the determinant is not 1.
+CrystalLattice primitive_cell( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group );
+
+// a^2, b^2, c^2, 2bc cos(alpha), 2ac cos(beta), 2ab cos(gamma), in A^2
+std::vector< double > G6_vector( const CrystalLattice & crystal_lattice );
+
+// Euclidean distance between two G6 vectors, in A^2
+double G6_distance( const std::vector< double > & lhs, const std::vector< double > & rhs );
+
+// Euclidean distance between the G6 vectors of the Niggli-reduced lattices, in A^2. Zero for the same lattice in a different setting.
+// The Niggli cell is not a continuous function of the lattice, so two lattices that are very similar but on
+// opposite sides of a boundary of the Niggli cone can have a larger distance than their similarity warrants.
+double G6_distance( const CrystalLattice & lhs, const CrystalLattice & rhs );
+
+#endif // NIGGLIREDUCTION_H
@@ -0,0 +1,211 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "NoiseGenerator.h"
+#include "MathConstants.h"
+#include "MathKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+// The uniform deviates for the exact Poisson methods: word 0 of the counter is j, words 1 and 2 are the position
+// of the sample, word 3 marks the counter as belonging to this sub-stream so it cannot collide with the blocks used by Philox4x32::block().
+class PoissonSubstream
+{
+public:
+    PoissonSubstream( const Philox4x32 & Philox, const uint64_t position ):
+    j_(0),
+    available_(0)
+    {
+        uint64_t seed = Philox.seed();
+        key_[0] = static_cast<uint32_t>( seed );
+        key_[1] = static_cast<uint32_t>( seed >> 32 );
+        // The stream number is mixed into the key, so that different streams give different sub-streams
+        key_[0] ^= static_cast<uint32_t>( Philox.stream() ) * 0x9E3779B9u;
+        key_[1] ^= static_cast<uint32_t>( Philox.stream() >> 32 ) * 0x85EBCA6Bu + 0x5BD1E995u;
+        counter_[1] = static_cast<uint32_t>( position );
+        counter_[2] = static_cast<uint32_t>( position >> 32 );
+        counter_[3] = 0x506F6973u; // "Pois"
+    }
+
+    double next()
+    {
+        if ( available_ == 0 )
+        {
+            counter_[0] = j_++;
+            Philox4x32::block( counter_, key_, r_ );
+            available_ = 2;
+        }
+        --available_;
+        return ( available_ == 1 ) ? Philox4x32::to_double( r_[0], r_[1] ) : Philox4x32::to_double( r_[2], r_[3] );
+    }
+
+private:
+    uint32_t key_[2];
+    uint32_t counter_[4];
+    uint32_t r_[4];
+    uint32_t j_;
+    size_t available_;
+};
+
+} // namespace
+
+// ********************************************************************************
+
+NoiseGenerator::NoiseGenerator( const uint64_t seed, const uint64_t stream ):
+Philox_( seed, stream ),
+normal_threshold_(1000.0)
+{
+}
+
+// ********************************************************************************
+
+double NoiseGenerator::Poisson( const double mean )
+{
+    if ( mean < 0.0 )
+        throw std::runtime_error( "NoiseGenerator::Poisson(): mean cannot be negative." );
+    uint64_t position = Philox_.position();
+    Philox_.set_position( position + 1 );
+    if ( mean < normal_threshold_ )
+        return Poisson_small( mean, position );
+    uint32_t r[4];
+    Philox_.block( position, r );
+    double z = std::sqrt( -2.0 * std::log( Philox4x32::to_double( r[0], r[1] ) ) ) * std::cos( 2.0 * CONSTANT_PI * Philox4x32::to_double( r[2], r[3] ) );
+    return std::max( 0.0, std::floor( mean + std::sqrt( mean ) * z + 0.5 ) );
+}
+
+// ********************************************************************************
+
+void NoiseGenerator::Poisson( const std::vector< double > & means, std::vector< double > & result )
+{
+    const size_t n = means.size();
+    const uint64_t start = Philox_.position();
+    Philox_.set_position( start + n );
+    // One block per sample, as for the single-value Poisson(), so the batch follows the same sequence.
+    // The normal deviates are calculated for all samples, it is cheaper than branching in the loops.
+    u1_.resize( n );
+    u2_.resize( n );
+    uint32_t r[4];
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        Philox_.block( start + i, r );
+        u1_[i] = Philox4x32::to_double( r[0], r[1] );
+        u2_[i] = Philox4x32::to_double( r[2], r[3] );
+    }
+    cos_2pi( u2_, cosines_ );
+    for ( size_t i( 0 ); i != n; ++i )
+        u1_[i] = std::sqrt( -2.0 * std::log( u1_[i] ) ) * cosines_[i];
+    result.resize( n );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        const double mean = means[i];
+        if ( mean < 0.0 )
+            throw std::runtime_error( "NoiseGenerator::Poisson(): mean cannot be negative." );
+        if ( mean < normal_threshold_ )
+            result[i] = Poisson_small( mean, start + i );
+        else
+            result[i] = std::max( 0.0, std::floor( mean + std::sqrt( mean ) * u1_[i] + 0.5 ) );
+    }
+}
+
+// ********************************************************************************
+
+double NoiseGenerator::normal( const double mean, const double sigma )
+{
+    double u1;
+    double u2;
+    Philox_.next_doubles( u1, u2 );
+    return mean + sigma * std::sqrt( -2.0 * std::log( u1 ) ) * std::cos( 2.0 * CONSTANT_PI * u2 );
+}
+
+// ********************************************************************************
+
+void NoiseGenerator::normal( std::vector< double > & values )
+{
+    const size_t npairs = ( values.size() + 1 ) / 2;
+    u1_.resize( npairs );
+    u2_.resize( npairs );
+    for ( size_t i( 0 ); i != npairs; ++i )
+        Philox_.next_doubles( u1_[i], u2_[i] );
+    sincos_2pi( u2_, sines_, cosines_ );
+    for ( size_t i( 0 ); i != npairs; ++i )
+    {
+        const double radius = std::sqrt( -2.0 * std::log( u1_[i] ) );
+        values[2*i] = radius * cosines_[i];
+        if ( 2*i+1 < values.size() )
+            values[2*i+1] = radius * sines_[i];
+    }
+}
+
+// ********************************************************************************
+
+double NoiseGenerator::Poisson_small( const double mean, const uint64_t position ) const
+{
+    PoissonSubstream uniform( Philox_, position );
+    if ( mean < 10.0 )
+    {
+        // Inversion: the number of uniform deviates whose product stays above exp( -mean )
+        const double limit = std::exp( -mean );
+        double product = uniform.next();
+        double k( 0.0 );
+        while ( product > limit )
+        {
+            k += 1.0;
+            product *= uniform.next();
+        }
+        return k;
+    }
+    // PTRS, W. Hoermann, "The transformed rejection method for generating Poisson random variables",
+    // Insurance: Mathematics and Economics 12, 39-45 (1993).
+    const double sqrt_mean = std::sqrt( mean );
+    const double log_mean = std::log( mean );
+    const double b = 0.931 + 2.53 * sqrt_mean;
+    const double a = -0.059 + 0.02483 * b;
+    const double inverse_alpha = 1.1239 + 1.1328 / ( b - 3.4 );
+    const double v_r = 0.9277 - 3.6224 / ( b - 2.0 );
+    while ( true )
+    {
+        const double u = uniform.next() - 0.5;
+        const double v = uniform.next();
+        const double us = 0.5 - std::abs( u );
+        const double k = std::floor( ( 2.0 * a / us + b ) * u + mean + 0.43 );
+        if ( ( us >= 0.07 ) && ( v <= v_r ) )
+            return k;
+        if ( ( k < 0.0 ) || ( ( us < 0.013 ) && ( v > us ) ) )
+            continue;
+        if ( ( std::log( v ) + std::log( inverse_alpha ) - std::log( a / ( us * us ) + b ) ) <= ( -mean + k * log_mean - std::lgamma( k + 1.0 ) ) )
+            return k;
+    }
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,84 @@
+#ifndef NOISEGENERATOR_H
+#define NOISEGENERATOR_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Philox.h"
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
+#include <vector>
+
+/*
+  Poisson and normal noise for large batches, e.g. for adding noise to millions of simulated powder patterns.
+
+  The random numbers come from the counter-based Philox4x32 generator: sample i of a call only depends on the seed,
+  the stream number and the position, so giving every thread (or every pattern) its own stream number gives
+  independent and reproducible noise regardless of the number of threads.
+
+  Poisson deviates are drawn with
+      mean < 10                 : inversion by sequential multiplication (exact)
+      10 <= mean < threshold    : PTRS, the transformed rejection method of W. Hoermann (1993), (exact)
+      mean >= threshold         : the normal approximation N( mean, sqrt( mean ) ), rounded, negative values set to 0.
+  The default threshold of 1000 counts gives a normal approximation whose skewness error is well below the noise.
+*/
+class NoiseGenerator
+{
+public:
+
+    explicit NoiseGenerator( const uint64_t seed = 1539, const uint64_t stream = 0 );
+
+    void set_normal_threshold( const double normal_threshold ) { normal_threshold_ = normal_threshold; }
+    double normal_threshold() const { return normal_threshold_; }
+
+    // One Poisson deviate with the given mean, mean must not be negative.
+    double Poisson( const double mean );
+
+    // result[i] is a Poisson deviate with mean means[i]. result may be the same vector as means.
+    void Poisson( const std::vector< double > & means, std::vector< double > & result );
+
+    // One normal deviate.
+    double normal( const double mean = 0.0, const double sigma = 1.0 );
+
+    // Replaces the values by standard normal deviates (Box-Muller, both deviates of each pair are used).
+    void normal( std::vector< double > & values );
+
+private:
+    Philox4x32 Philox_;
+    double normal_threshold_;
+    std::vector< double > u1_;
+    std::vector< double > u2_;
+    std::vector< double > sines_;
+    std::vector< double > cosines_;
+
+    // Draws one exact Poisson deviate, each sample uses its own position in the stream
+    double Poisson_small( const double mean, const uint64_t position ) const;
+};
+
+#endif // NOISEGENERATOR_H
+
@@ -106,10 +106,17 @@ SetOfNumbers OneSudokuSlice::collect_solved_numbers() const
 
 SetOfNumbers OneSudokuSlice::collect_all_possible_numbers() const
 {
-    OneSudokuSquare merged( square( 0 ) );
-    for ( size_t i( 1 ); i != size(); ++i )
-        merged = merge( merged, square( i ) );
-    return merged.values();
+    return OneSudokuSquare::from_candidates( collect_all_candidates() ).values();
+}
+
+// ********************************************************************************
+
+unsigned int OneSudokuSlice::collect_all_candidates() const
+{
+    unsigned int result( 0 );
+    for ( size_t i( 0 ); i != size(); ++i )
+        result |= values_[i].candidates();
+    return result;
 }
 
 // ********************************************************************************
@@ -68,6 +68,9 @@ public:
     // Only makes sense if size() == 6, otherwise it just returns 1 through 9
     SetOfNumbers collect_all_possible_numbers() const;
 
+    // The same as a mask, see OneSudokuSquare::candidates()
+    unsigned int collect_all_candidates() const;
+
     std::vector< size_t > indices_of_unsolved_squares() const;
 
     std::vector< size_t > indices_of_solved_squares() const;
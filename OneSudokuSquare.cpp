@@ -34,45 +34,78 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // ********************************************************************************
 
 OneSudokuSquare::OneSudokuSquare():
-values_( 1, 9, SetOfNumbers::THROW )
+candidates_(ALL_SUDOKU_CANDIDATES)
 {
-    values_.set_empty_is_allowed( false );
 }
 
 // ********************************************************************************
 
-OneSudokuSquare::OneSudokuSquare( const size_t value )
+OneSudokuSquare::OneSudokuSquare( const size_t value ):
+candidates_(ALL_SUDOKU_CANDIDATES)
 {
-    if ( value == 0 )
-        *this = OneSudokuSquare();
-    else
+    if ( value != 0 )
     {
         if ( ( value < 1 ) || ( value > 9 ) )
             throw std::runtime_error( "OneSudokuSquare::OneSudokuSquare( size_t ): incorrect value: " + int2string( value ) );
-        values_.add( value );
-        values_.set_duplicates_policy( SetOfNumbers::THROW );
-        values_.set_empty_is_allowed( false );
+        candidates_ = sudoku_candidate( value );
     }
 }
 
 // ********************************************************************************
 
 OneSudokuSquare::OneSudokuSquare( const SetOfNumbers & values ):
-values_(values)
+candidates_(0)
 {
-    values_.set_duplicates_policy( SetOfNumbers::THROW );
-    values_.set_empty_is_allowed( false );
-    if ( values_.value( 0 ) < 1 )
-        throw std::runtime_error( "OneSudokuSquare::OneSudokuSquare( std::vector< size_t > ): incorrect value: " + int2string( values_.value( 0 ) ) );
-    if ( values_.value( values_.size() - 1 ) > 9 )
-        throw std::runtime_error( "OneSudokuSquare::OneSudokuSquare( std::vector< size_t > ): incorrect value: " + int2string( values_.value( values_.size() - 1 ) ) );    
+    if ( values.empty() )
+        throw std::runtime_error( "OneSudokuSquare::OneSudokuSquare( SetOfNumbers ): set is empty." );
+    for ( size_t i( 0 ); i != values.size(); ++i )
+    {
+        const size_t value = values.value( i );
+        if ( ( value < 1 ) || ( value > 9 ) )
+            throw std::runtime_error( "OneSudokuSquare::OneSudokuSquare( SetOfNumbers ): incorrect value: " + int2string( value ) );
+        if ( candidates_ & sudoku_candidate( value ) )
+            throw std::runtime_error( "OneSudokuSquare::OneSudokuSquare( SetOfNumbers ): duplicates found." );
+        candidates_ |= sudoku_candidate( value );
+    }
+}
+
+// ********************************************************************************
+
+OneSudokuSquare OneSudokuSquare::from_candidates( const unsigned int candidates )
+{
+    if ( ( candidates & ~ALL_SUDOKU_CANDIDATES ) != 0 )
+        throw std::runtime_error( "OneSudokuSquare::from_candidates(): incorrect candidates." );
+    OneSudokuSquare result;
+    result.set_candidates( candidates );
+    return result;
+}
+
+// ********************************************************************************
+
+SetOfNumbers OneSudokuSquare::values() const
+{
+    SetOfNumbers result( SetOfNumbers::THROW );
+    result.reserve( size() );
+    for ( size_t value( 1 ); value != 10; ++value )
+    {
+        if ( candidates_ & sudoku_candidate( value ) )
+            result.add( value );
+    }
+    result.set_empty_is_allowed( false );
+    return result;
 }
 
 // ********************************************************************************
 
 size_t OneSudokuSquare::value( const size_t i ) const
 {
-    return values_.value( i );
+    // Clear the lowest set bit i times
+    unsigned int candidates = candidates_;
+    for ( size_t j( 0 ); ( j != i ) && ( candidates != 0 ); ++j )
+        candidates &= candidates - 1;
+    if ( candidates == 0 )
+        throw std::runtime_error( "OneSudokuSquare::value( size_t ): index out of range." );
+    return __builtin_ctz( candidates ) + 1;
 }
 
 // ********************************************************************************
@@ -81,16 +114,18 @@ size_t OneSudokuSquare::value() const
 {
     if ( ! this->solved() )
         throw std::runtime_error( "OneSudokuSquare::value(): square is not solved." );
-    return values_.value( 0 );
+    return __builtin_ctz( candidates_ ) + 1;
 }
 
 // ********************************************************************************
 
 bool OneSudokuSquare::set( const size_t value )
 {
+    if ( ( value < 1 ) || ( value > 9 ) )
+        throw std::runtime_error( "OneSudokuSquare::set(): incorrect value: " + int2string( value ) );
     if ( this->contains( value ) )
         return false;
-    values_.add( value );
+    candidates_ |= sudoku_candidate( value );
     return true;
 }
 
@@ -100,7 +135,7 @@ bool OneSudokuSquare::unset( const size_t value )
 {
     if ( ! this->contains( value ) )
         return false;
-    values_.remove( value );
+    set_candidates( candidates_ & ~sudoku_candidate( value ) );
     return true;
 }
 
@@ -108,16 +143,11 @@ bool OneSudokuSquare::unset( const size_t value )
 
 bool OneSudokuSquare::unset( const OneSudokuSquare & sudoku_square )
 {
-    SetOfNumbers new_values( SetOfNumbers::THROW );
-    for ( size_t i( 0 ); i != values_.size(); ++i )
-    {
-        if ( ! sudoku_square.contains( values_.value( i ) ) )
-            new_values.add( values_.value( i ) );
-    }
-    new_values.set_empty_is_allowed( false );
-    bool result = ( values_ != new_values );
-    values_ = new_values;
-    return result;
+    const unsigned int new_candidates = candidates_ & ~sudoku_square.candidates_;
+    if ( new_candidates == candidates_ )
+        return false;
+    set_candidates( new_candidates );
+    return true;
 }
 
 // ********************************************************************************
@@ -133,39 +163,47 @@ bool OneSudokuSquare::unset( const SetOfNumbers & values )
 
 bool OneSudokuSquare::contains( const size_t value ) const
 {
-    return values_.contains( value );
+    if ( ( value < 1 ) || ( value > 9 ) )
+        return false;
+    return ( candidates_ & sudoku_candidate( value ) ) != 0;
 }
 
 // ********************************************************************************
 
 size_t OneSudokuSquare::size() const
 {
-    return values_.size();
+    return number_of_candidates( candidates_ );
 }
 
 // ********************************************************************************
 
 bool OneSudokuSquare::solved() const
 {
-    return ( values_.size() == 1 );
+    // Exactly one bit set
+    return ( candidates_ & ( candidates_ - 1 ) ) == 0;
 }
 
 // ********************************************************************************
 
 void OneSudokuSquare::show() const
 {
-    values_.show();
+    values().show();
+}
+
+// ********************************************************************************
+
+void OneSudokuSquare::set_candidates( const unsigned int candidates )
+{
+    if ( candidates == 0 )
+        throw std::runtime_error( "OneSudokuSquare: set is empty." );
+    candidates_ = candidates;
 }
 
 // ********************************************************************************
 
 OneSudokuSquare merge( const OneSudokuSquare & lhs, const OneSudokuSquare & rhs )
 {
-    SetOfNumbers set_of_numbers( lhs.values() );
-    set_of_numbers.set_duplicates_policy( SetOfNumbers::AUTO_REMOVE );
-    set_of_numbers.add( rhs.values() );
-    set_of_numbers.set_duplicates_policy( SetOfNumbers::THROW );
-    return OneSudokuSquare( set_of_numbers );
+    return OneSudokuSquare::from_candidates( lhs.candidates() | rhs.candidates() );
 }
 
 // ********************************************************************************
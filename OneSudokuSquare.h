@@ -37,6 +37,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 Cannot be empty.
 No duplicates.
 Only 1 through 9.
+
+The candidates are stored as a 9-bit mask, bit value-1 is set if value is still possible,
+so that the set logic of the solver reduces to bitwise AND / OR and popcount.
 */
 class OneSudokuSquare
 {
@@ -49,8 +52,14 @@ public:
     explicit OneSudokuSquare( const size_t value );
 
     explicit OneSudokuSquare( const SetOfNumbers & values );
+
+    // Throws if the mask is 0 or has bits set other than the lowest nine.
+    static OneSudokuSquare from_candidates( const unsigned int candidates );
+
+    // Bit value-1 is set if value is possible.
+    unsigned int candidates() const { return candidates_; }
     
-    SetOfNumbers values() const { return values_; }
+    SetOfNumbers values() const;
     
     size_t value( const size_t i ) const;
     
@@ -83,13 +92,22 @@ public:
 
     void show() const;
 
-    bool operator==( const OneSudokuSquare & rhs ) const { return ( this->values_ == rhs.values_ ); }
+    bool operator==( const OneSudokuSquare & rhs ) const { return ( this->candidates_ == rhs.candidates_ ); }
 
 private:
-    // Should probably store a SetOfNumbers
-    SetOfNumbers values_; // Always stored in ascending order
+    unsigned int candidates_;
+    
+    // Throws if the result would be empty.
+    void set_candidates( const unsigned int candidates );
 };
 
+const unsigned int ALL_SUDOKU_CANDIDATES = 0x1FF;
+
+// The number of candidates in a mask.
+inline size_t number_of_candidates( const unsigned int candidates ) { return __builtin_popcount( candidates ); }
+
+inline unsigned int sudoku_candidate( const size_t value ) { return 1U << ( value - 1 ); }
+
 // @@ Should have been a member function?
 // @@ Should simply have used std::vector< size_t > ?
 OneSudokuSquare merge( const OneSudokuSquare & lhs, const OneSudokuSquare & rhs );
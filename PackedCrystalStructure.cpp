@@ -0,0 +1,142 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "PackedCrystalStructure.h"
+#include "AnisotropicDisplacementParameters.h"
+#include "CrystalStructure.h"
+#include "SymmetricMatrix3D.h"
+
+#include <stdexcept>
+
+// ********************************************************************************
+
+PackedCrystalStructure::PackedCrystalStructure()
+{
+}
+
+// ********************************************************************************
+
+PackedCrystalStructure::PackedCrystalStructure( const CrystalStructure & crystal_structure ):
+name_( crystal_structure.name() ),
+space_group_( crystal_structure.space_group() ),
+crystal_lattice_( crystal_structure.crystal_lattice() )
+{
+    reserve_natoms( crystal_structure.natoms() );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+        add_atom( crystal_structure.atom( i ) );
+}
+
+// ********************************************************************************
+
+void PackedCrystalStructure::reserve_natoms( const size_t value )
+{
+    x_.reserve( value );
+    y_.reserve( value );
+    z_.reserve( value );
+    elements_.reserve( value );
+    occupancies_.reserve( value );
+    Uisos_.reserve( value );
+    charges_.reserve( value );
+    ADPs_types_.reserve( value );
+    ADPs_indices_.reserve( value );
+    label_indices_.reserve( value );
+}
+
+// ********************************************************************************
+
+void PackedCrystalStructure::add_atom( const Atom & atom )
+{
+    x_.push_back( atom.position().x() );
+    y_.push_back( atom.position().y() );
+    z_.push_back( atom.position().z() );
+    elements_.push_back( atom.element() );
+    occupancies_.push_back( atom.occupancy() );
+    Uisos_.push_back( atom.Uiso() );
+    charges_.push_back( atom.charge() );
+    ADPs_types_.push_back( static_cast< unsigned char >( atom.ADPs_type() ) );
+    ADPs_indices_.push_back( ADPs_.size() / 6 );
+    if ( atom.ADPs_type() == Atom::ANISOTROPIC )
+    {
+        AnisotropicDisplacementParameters ADPs = atom.anisotropic_displacement_parameters();
+        ADPs_.push_back( ADPs.value( 0, 0 ) );
+        ADPs_.push_back( ADPs.value( 1, 1 ) );
+        ADPs_.push_back( ADPs.value( 2, 2 ) );
+        ADPs_.push_back( ADPs.value( 0, 1 ) );
+        ADPs_.push_back( ADPs.value( 0, 2 ) );
+        ADPs_.push_back( ADPs.value( 1, 2 ) );
+    }
+    label_indices_.push_back( intern_label( atom.label() ) );
+}
+
+// ********************************************************************************
+
+Atom PackedCrystalStructure::atom( const size_t i ) const
+{
+    if ( i >= natoms() )
+        throw std::runtime_error( "PackedCrystalStructure::atom(): i >= natoms()." );
+    Atom result( elements_[i], position( i ), label( i ) );
+    if ( ADPs_type( i ) == Atom::ANISOTROPIC )
+    {
+        const double * U = &ADPs_[ 6 * ADPs_indices_[i] ];
+        result.set_anisotropic_displacement_parameters( AnisotropicDisplacementParameters( SymmetricMatrix3D( U[0], U[1], U[2], U[3], U[4], U[5] ) ) );
+    }
+    else if ( ADPs_type( i ) == Atom::ISOTROPIC )
+        result.set_Uiso( Uisos_[i] );
+    result.set_occupancy( occupancies_[i] );
+    result.set_charge( charges_[i] );
+    return result;
+}
+
+// ********************************************************************************
+
+CrystalStructure PackedCrystalStructure::crystal_structure() const
+{
+    CrystalStructure result;
+    result.set_name( name_ );
+    result.set_space_group( space_group_ );
+    result.set_crystal_lattice( crystal_lattice_ );
+    result.reserve_natoms( natoms() );
+    for ( size_t i( 0 ); i != natoms(); ++i )
+        result.add_atom( atom( i ) );
+    return result;
+}
+
+// ********************************************************************************
+
+size_t PackedCrystalStructure::intern_label( const std::string & label )
+{
+    std::map< std::string, size_t >::const_iterator it = label_table_.find( label );
+    if ( it != label_table_.end() )
+        return it->second;
+    labels_.push_back( label );
+    label_table_[ label ] = labels_.size() - 1;
+    return labels_.size() - 1;
+}
+
+// ********************************************************************************
+
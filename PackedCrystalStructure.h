@@ -0,0 +1,123 @@
+#ifndef PACKEDCRYSTALSTRUCTURE_H
+#define PACKEDCRYSTALSTRUCTURE_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+
+#include "Atom.h"
+#include "CrystalLattice.h"
+#include "Element.h"
+#include "SpaceGroup.h"
+#include "Vector3D.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+  A compact structure-of-arrays store for the atoms of a crystal structure, for when very many structures must be
+  kept in memory at once, e.g. when screening generated structures.
+
+  Positions, elements, occupancies, Uiso values and charges are stored as plain arrays. Anisotropic displacement parameters
+  are only stored for atoms that have them (six U_cart values each). Each distinct label is stored once, in a table,
+  each atom only stores an index into that table. The disorder assembly and disorder group are not stored.
+
+  atom( i ) assembles a normal Atom, so code that works with Atom objects can still be used; crystal_structure() converts back.
+*/
+class PackedCrystalStructure
+{
+public:
+
+    PackedCrystalStructure();
+
+    explicit PackedCrystalStructure( const CrystalStructure & crystal_structure );
+
+    std::string name() const { return name_; }
+    void set_name( const std::string & name ) { name_ = name; }
+
+    const SpaceGroup & space_group() const { return space_group_; }
+    void set_space_group( const SpaceGroup & space_group ) { space_group_ = space_group; }
+
+    const CrystalLattice & crystal_lattice() const { return crystal_lattice_; }
+    void set_crystal_lattice( const CrystalLattice & crystal_lattice ) { crystal_lattice_ = crystal_lattice; }
+
+    size_t natoms() const { return x_.size(); }
+
+    void reserve_natoms( const size_t value );
+
+    void add_atom( const Atom & atom );
+
+    // Assembles the Atom, this is not a reference
+    Atom atom( const size_t i ) const;
+
+    CrystalStructure crystal_structure() const;
+
+    // Fractional coordinates
+    Vector3D position( const size_t i ) const { return Vector3D( x_[i], y_[i], z_[i] ); }
+    void set_position( const size_t i, const Vector3D & position ) { x_[i] = position.x(); y_[i] = position.y(); z_[i] = position.z(); }
+
+    // The fractional coordinates as contiguous arrays
+    const std::vector< double > & x() const { return x_; }
+    const std::vector< double > & y() const { return y_; }
+    const std::vector< double > & z() const { return z_; }
+
+    Element element( const size_t i ) const { return elements_[i]; }
+    double occupancy( const size_t i ) const { return occupancies_[i]; }
+    double Uiso( const size_t i ) const { return Uisos_[i]; }
+    double charge( const size_t i ) const { return charges_[i]; }
+    Atom::ADPsType ADPs_type( const size_t i ) const { return static_cast< Atom::ADPsType >( ADPs_types_[i] ); }
+
+    const std::string & label( const size_t i ) const { return labels_[ label_indices_[i] ]; }
+
+    // The number of distinct labels
+    size_t nlabels() const { return labels_.size(); }
+
+private:
+    std::string name_;
+    SpaceGroup space_group_;
+    CrystalLattice crystal_lattice_;
+    std::vector< double > x_;
+    std::vector< double > y_;
+    std::vector< double > z_;
+    std::vector< Element > elements_;
+    std::vector< double > occupancies_;
+    std::vector< double > Uisos_;
+    std::vector< double > charges_;
+    std::vector< unsigned char > ADPs_types_;
+    std::vector< size_t > ADPs_indices_; // Index into ADPs_ divided by 6, only meaningful for anisotropic atoms
+    std::vector< double > ADPs_;         // U_cart, in the order U11 U22 U33 U12 U13 U23
+    std::vector< size_t > label_indices_;
+    std::vector< std::string > labels_;
+    std::map< std::string, size_t > label_table_;
+
+    size_t intern_label( const std::string & label );
+};
+
+#endif // PACKEDCRYSTALSTRUCTURE_H
+
@@ -0,0 +1,300 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PairDistributionFunction.h"
+#include "CellList.h"
+#include "CrystalStructure.h"
+#include "FFT.h"
+#include "Histogram.h"
+#include "MathConstants.h"
+#include "ParallelFor.h"
+#include "TrajectorySource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <set>
+#include <stdexcept>
+
+// ********************************************************************************
+
+PairDistributionFunction::PairDistributionFunction( const double r_max, const double dr, const RadiationType radiation_type ):
+r_max_( r_max ),
+dr_( dr ),
+nbins_( 0 ),
+radiation_type_( radiation_type ),
+nframes_( 0 ),
+sum_number_density_( 0.0 )
+{
+    if ( dr <= 0.0 )
+        throw std::runtime_error( "PairDistributionFunction::PairDistributionFunction(): dr must be positive." );
+    if ( r_max < dr )
+        throw std::runtime_error( "PairDistributionFunction::PairDistributionFunction(): r_max must be at least dr." );
+    nbins_ = static_cast< size_t >( round( r_max / dr ) );
+    r_max_ = nbins_ * dr_;
+}
+
+// ********************************************************************************
+
+void PairDistributionFunction::add_frame( const CrystalStructure & crystal_structure, const size_t nthreads )
+{
+    Frame frame;
+    calculate_frame( crystal_structure, nthreads, frame );
+    add( frame );
+}
+
+// ********************************************************************************
+
+void PairDistributionFunction::add_frames( const TrajectorySource & trajectory_source, size_t nthreads )
+{
+    if ( nthreads == 0 )
+        nthreads = default_nthreads();
+    // Holding all frames in memory would not scale to long trajectories, so the frames are processed in batches
+    for ( size_t start( 0 ); start < trajectory_source.nframes(); start += nthreads )
+    {
+        std::vector< Frame > frames( std::min( nthreads, trajectory_source.nframes() - start ) );
+        parallel_for( frames.size(), nthreads, [&]( const size_t i )
+        {
+            CrystalStructure crystal_structure;
+            trajectory_source.read_frame( start + i, crystal_structure );
+            calculate_frame( crystal_structure, 1, frames[i] );
+        } );
+        for ( size_t i( 0 ); i != frames.size(); ++i )
+            add( frames[i] );
+    }
+}
+
+// ********************************************************************************
+
+double PairDistributionFunction::concentration( const size_t a ) const
+{
+    if ( nframes_ == 0 )
+        throw std::runtime_error( "PairDistributionFunction::concentration(): no frames have been added." );
+    double natoms( 0.0 );
+    for ( size_t i( 0 ); i != natoms_per_element_.size(); ++i )
+        natoms += natoms_per_element_[i];
+    return natoms_per_element_[a] / natoms;
+}
+
+// ********************************************************************************
+
+double PairDistributionFunction::number_density() const
+{
+    if ( nframes_ == 0 )
+        throw std::runtime_error( "PairDistributionFunction::number_density(): no frames have been added." );
+    return sum_number_density_ / nframes_;
+}
+
+// ********************************************************************************
+
+double PairDistributionFunction::partial_g( const size_t a, const size_t b, const size_t i ) const
+{
+    if ( nframes_ == 0 )
+        throw std::runtime_error( "PairDistributionFunction::partial_g(): no frames have been added." );
+    return sum_partial_g_[ ( a * elements_.size() + b ) * nbins_ + i ] / nframes_;
+}
+
+// ********************************************************************************
+
+double PairDistributionFunction::g( const size_t i ) const
+{
+    const size_t nelements = elements_.size();
+    std::vector< double > weights;
+    double average_weight( 0.0 );
+    for ( size_t a( 0 ); a != nelements; ++a )
+    {
+        weights.push_back( concentration( a ) * elements_[a].scattering_factor( 0.0, radiation_type_ ) );
+        average_weight += weights.back();
+    }
+    if ( average_weight == 0.0 )
+        throw std::runtime_error( "PairDistributionFunction::g(): average scattering factor is zero." );
+    double result( 0.0 );
+    for ( size_t a( 0 ); a != nelements; ++a )
+    {
+        for ( size_t b( 0 ); b != nelements; ++b )
+            result += weights[a] * weights[b] * partial_g( a, b, i );
+    }
+    return result / ( average_weight * average_weight );
+}
+
+// ********************************************************************************
+
+double PairDistributionFunction::G( const size_t i ) const
+{
+    return 4.0 * CONSTANT_PI * r( i ) * number_density() * ( g( i ) - 1.0 );
+}
+
+// ********************************************************************************
+
+void PairDistributionFunction::structure_factor( std::vector< double > & Q, std::vector< double > & S ) const
+{
+    const size_t n = next_power_of_two( 2 * nbins_ );
+    std::vector< std::complex< double > > data( n, std::complex< double >( 0.0, 0.0 ) );
+    for ( size_t i( 0 ); i != nbins_; ++i )
+        data[i] = G( i );
+    fast_Fourier_transform( data );
+    Q.clear();
+    S.clear();
+    Q.reserve( n / 2 );
+    S.reserve( n / 2 );
+    // At Q = 0, (1/Q) sin(Qr) -> r
+    double integral( 0.0 );
+    for ( size_t i( 0 ); i != nbins_; ++i )
+        integral += G( i ) * r( i ) * dr_;
+    Q.push_back( 0.0 );
+    S.push_back( 1.0 + integral );
+    for ( size_t k( 1 ); k != n / 2; ++k )
+    {
+        const double Q_k = ( 2.0 * CONSTANT_PI * k ) / ( n * dr_ );
+        // The FFT uses r = i dr, the bin centres are at ( i + 0.5 ) dr, which is a phase shift
+        integral = -std::imag( std::polar( 1.0, -0.5 * Q_k * dr_ ) * data[k] ) * dr_;
+        Q.push_back( Q_k );
+        S.push_back( 1.0 + integral / Q_k );
+    }
+}
+
+// ********************************************************************************
+
+void PairDistributionFunction::calculate_frame( const CrystalStructure & crystal_structure, size_t nthreads, Frame & frame ) const
+{
+    CrystalStructure copy;
+    const CrystalStructure * structure = &crystal_structure;
+    if ( ! crystal_structure.space_group_symmetry_has_been_applied() )
+    {
+        copy = crystal_structure;
+        copy.apply_space_group_symmetry();
+        structure = &copy;
+    }
+    const size_t natoms = structure->natoms();
+    if ( natoms == 0 )
+        throw std::runtime_error( "PairDistributionFunction::calculate_frame(): no atoms." );
+    const std::set< Element > element_set = structure->elements();
+    frame.elements_ = std::vector< Element >( element_set.begin(), element_set.end() );
+    const size_t nelements = frame.elements_.size();
+    std::vector< size_t > element_indices;
+    element_indices.reserve( natoms );
+    frame.natoms_per_element_ = std::vector< double >( nelements, 0.0 );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        element_indices.push_back( std::lower_bound( frame.elements_.begin(), frame.elements_.end(), structure->atom( i ).element() ) - frame.elements_.begin() );
+        frame.natoms_per_element_[ element_indices.back() ] += 1.0;
+    }
+    const CrystalLattice & crystal_lattice = structure->crystal_lattice();
+    frame.number_density_ = natoms / crystal_lattice.volume();
+    // The supercell must be more than 2 r_max thick along each direction, so that the minimum image of every pair within r_max is unique
+    const double reciprocal_lengths[3] = { crystal_lattice.a_star(), crystal_lattice.b_star(), crystal_lattice.c_star() };
+    size_t n[3];
+    for ( size_t i( 0 ); i != 3; ++i )
+        n[i] = static_cast< size_t >( floor( 2.0 * r_max_ * reciprocal_lengths[i] ) ) + 1;
+    const CrystalLattice supercell_lattice( n[0] * crystal_lattice.a(), n[1] * crystal_lattice.b(), n[2] * crystal_lattice.c(),
+                                           crystal_lattice.alpha(), crystal_lattice.beta(), crystal_lattice.gamma() );
+    // The original unit cell comes first, so its atoms are positions 0 ... natoms-1
+    std::vector< Vector3D > positions;
+    positions.reserve( natoms * n[0] * n[1] * n[2] );
+    for ( size_t u( 0 ); u != n[0]; ++u )
+    {
+        for ( size_t v( 0 ); v != n[1]; ++v )
+        {
+            for ( size_t w( 0 ); w != n[2]; ++w )
+            {
+                for ( size_t i( 0 ); i != natoms; ++i )
+                {
+                    const Vector3D position = structure->atom( i ).position();
+                    positions.push_back( Vector3D( ( position.x() + u ) / n[0], ( position.y() + v ) / n[1], ( position.z() + w ) / n[2] ) );
+                }
+            }
+        }
+    }
+    const CellList cell_list( supercell_lattice, positions, r_max_ );
+    // Counts are integers, so the result does not depend on how the centres are divided over the threads
+    if ( nthreads == 0 )
+        nthreads = default_nthreads();
+    nthreads = std::min( nthreads, natoms );
+    std::vector< std::vector< Histogram > > counts( nthreads, std::vector< Histogram >( nelements * nelements, Histogram( 0.0, r_max_, nbins_ ) ) );
+    const double r_max2 = r_max_ * r_max_;
+    parallel_for( nthreads, nthreads, [&]( const size_t t )
+    {
+        std::vector< size_t > candidates;
+        for ( size_t i = ( natoms * t ) / nthreads; i != ( natoms * ( t + 1 ) ) / nthreads; ++i )
+        {
+            cell_list.candidates( i, candidates );
+            const size_t offset = element_indices[i] * nelements;
+            for ( size_t c( 0 ); c != candidates.size(); ++c )
+            {
+                const size_t j = candidates[c];
+                const double distance2 = supercell_lattice.shortest_distance2( positions[i], positions[j] );
+                if ( distance2 < r_max2 )
+                    counts[t][ offset + element_indices[ j % natoms ] ].add_data( sqrt( distance2 ) );
+            }
+        }
+    } );
+    for ( size_t t( 1 ); t < counts.size(); ++t )
+    {
+        for ( size_t p( 0 ); p != counts[0].size(); ++p )
+            counts[0][p].merge( counts[t][p] );
+    }
+    // g_ab(r) = n_ab(r) / ( N_a rho_b 4/3 pi ( r2^3 - r1^3 ) )
+    frame.partial_g_ = std::vector< double >( nelements * nelements * nbins_ );
+    for ( size_t a( 0 ); a != nelements; ++a )
+    {
+        for ( size_t b( 0 ); b != nelements; ++b )
+        {
+            const double normalisation = frame.natoms_per_element_[a] * frame.natoms_per_element_[b] / crystal_lattice.volume();
+            for ( size_t i( 0 ); i != nbins_; ++i )
+            {
+                const double r1 = i * dr_;
+                const double r2 = ( i + 1 ) * dr_;
+                const double shell_volume = ( 4.0 / 3.0 ) * CONSTANT_PI * ( r2 * r2 * r2 - r1 * r1 * r1 );
+                frame.partial_g_[ ( a * nelements + b ) * nbins_ + i ] = counts[0][ a * nelements + b ].bin( i ) / ( normalisation * shell_volume );
+            }
+        }
+    }
+}
+
+// ********************************************************************************
+
+void PairDistributionFunction::add( const Frame & frame )
+{
+    if ( nframes_ == 0 )
+    {
+        elements_ = frame.elements_;
+        natoms_per_element_ = std::vector< double >( elements_.size(), 0.0 );
+        sum_partial_g_ = std::vector< double >( frame.partial_g_.size(), 0.0 );
+    }
+    else if ( frame.elements_ != elements_ )
+        throw std::runtime_error( "PairDistributionFunction::add(): all frames must contain the same elements." );
+    for ( size_t a( 0 ); a != elements_.size(); ++a )
+        natoms_per_element_[a] += frame.natoms_per_element_[a];
+    sum_number_density_ += frame.number_density_;
+    for ( size_t i( 0 ); i != sum_partial_g_.size(); ++i )
+        sum_partial_g_[i] += frame.partial_g_[i];
+    ++nframes_;
+}
+
+// ********************************************************************************
+
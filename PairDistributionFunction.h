@@ -0,0 +1,126 @@
+#ifndef PAIRDISTRIBUTIONFUNCTION_H
+#define PAIRDISTRIBUTIONFUNCTION_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Element.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+class CrystalStructure;
+class TrajectorySource;
+
+/*
+  Pair-distribution function g(r) of a periodic structure, averaged over one or more frames (e.g. of an MD trajectory).
+
+  The partial g_ab(r) are accumulated per pair of elements with a periodic cell list, so each frame costs O(N) rather than O(N^2).
+  r_max can be larger than half the unit cell: the unit cell is then expanded into a supercell that is large enough for the
+  minimum-image convention to find every pair up to r_max, only the atoms in the original unit cell are used as centres.
+  Occupancies and ADPs are ignored.
+
+  The total g(r) uses Faber-Ziman weights with the scattering factors at s = 0, i.e. the weights are independent of Q,
+  which is exact for neutrons and an approximation for X-rays and electrons.
+
+  Example:
+
+  PairDistributionFunction pdf( 10.0, 0.01, NEUTRONS );
+  pdf.add_frames( XYZTrajectory( FileName( "md.xyz" ) ) );
+  for ( size_t i( 0 ); i != pdf.nbins(); ++i )
+      std::cout << pdf.r( i ) << " " << pdf.G( i ) << std::endl;
+*/
+class PairDistributionFunction
+{
+public:
+
+    // r_max and dr in Angstrom
+    explicit PairDistributionFunction( const double r_max, const double dr = 0.01, const RadiationType radiation_type = X_RAYS );
+
+    // Space-group symmetry is applied to a copy if it has not been applied yet.
+    // nthreads = 0 means one thread per core. The result does not depend on the number of threads.
+    void add_frame( const CrystalStructure & crystal_structure, const size_t nthreads = 1 );
+
+    // Adds all frames, nthreads frames at a time. The frames are added in order, so the result does not depend on the number of threads.
+    void add_frames( const TrajectorySource & trajectory_source, const size_t nthreads = 0 );
+
+    size_t nframes() const { return nframes_; }
+    size_t nbins() const { return nbins_; }
+    double r_max() const { return r_max_; }
+    double dr() const { return dr_; }
+    RadiationType radiation_type() const { return radiation_type_; }
+
+    // Centre of bin i.
+    double r( const size_t i ) const { return ( i + 0.5 ) * dr_; }
+
+    // Sorted.
+    const std::vector< Element > & elements() const { return elements_; }
+
+    // Fraction of the atoms that are of element a, averaged over all frames.
+    double concentration( const size_t a ) const;
+
+    // Average number density N/V in atoms per cubic Angstrom.
+    double number_density() const;
+
+    // Partial pair-distribution function g_ab in bin i, a and b are indices into elements().
+    double partial_g( const size_t a, const size_t b, const size_t i ) const;
+
+    // Faber-Ziman weighted total pair-distribution function, tends to 1 at large r.
+    double g( const size_t i ) const;
+
+    // Reduced pair-distribution function G(r) = 4 pi r rho0 ( g(r) - 1 ), the Fourier partner of Q ( S(Q) - 1 ).
+    double G( const size_t i ) const;
+
+    // The total structure factor S(Q) = 1 + (1/Q) integral G(r) sin(Qr) dr at Q_k = 2 pi k / ( n dr ), computed with an FFT of
+    // the zero-padded G(r). n is the smallest power of two that is at least twice the number of bins, Q and S contain n/2 points.
+    void structure_factor( std::vector< double > & Q, std::vector< double > & S ) const;
+
+private:
+    double r_max_;
+    double dr_;
+    size_t nbins_;
+    RadiationType radiation_type_;
+    size_t nframes_;
+    std::vector< Element > elements_;
+    std::vector< double > natoms_per_element_; // Summed over all frames
+    double sum_number_density_;                // Summed over all frames
+    std::vector< double > sum_partial_g_;      // Summed over all frames, [ ( a * nelements + b ) * nbins_ + i ]
+
+    struct Frame
+    {
+        std::vector< Element > elements_;
+        std::vector< double > natoms_per_element_;
+        double number_density_;
+        std::vector< double > partial_g_;
+    };
+
+    void calculate_frame( const CrystalStructure & crystal_structure, const size_t nthreads, Frame & frame ) const;
+    void add( const Frame & frame );
+};
+
+#endif // PAIRDISTRIBUTIONFUNCTION_H
@@ -0,0 +1,144 @@
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ReproducibleSum.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef> // For definition of size_t
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Returns the number of threads to use if 0 ("one per core") is requested: max_concurrency(), which respects the cgroup CPU quota.
+inline size_t default_nthreads()
+{
+    return max_concurrency();
+}
+
+// Calls job( i ) for i = 0 ... njobs-1 on nthreads threads (0 means one thread per core) of the global ThreadPool, the calling thread is one of them.
+// nthreads is limited to max_concurrency(), so nested and concurrent calls share the cores instead of oversubscribing them.
+// The jobs are handed out grain_size consecutive indices at a time, so jobs that take very different amounts of time are still balanced;
+// a larger grain_size lowers the overhead for many small jobs.
+// The first exception that is thrown is re-thrown as std::runtime_error once all threads have finished, the remaining jobs are then skipped.
+template< class Job >
+void parallel_for( const size_t njobs, size_t nthreads, Job job, const size_t grain_size = 1 )
+{
+    const size_t grain = std::max( grain_size, size_t( 1 ) );
+    const size_t nchunks = ( njobs + grain - 1 ) / grain;
+    if ( nthreads == 0 )
+        nthreads = default_nthreads();
+    nthreads = std::min( std::min( nthreads, nchunks ), ThreadPool::global().nworkers() + 1 );
+    if ( nthreads < 2 )
+    {
+        for ( size_t i( 0 ); i != njobs; ++i )
+            job( i );
+        return;
+    }
+    std::atomic< size_t > next_chunk( 0 );
+    std::atomic< bool > error_occurred( false );
+    std::string error_message;
+    auto work = [&]()
+    {
+        for ( size_t chunk = next_chunk++; ( chunk < nchunks ) && ( ! error_occurred ); chunk = next_chunk++ )
+        {
+            const size_t end = std::min( ( chunk + 1 ) * grain, njobs );
+            for ( size_t i( chunk * grain ); ( i != end ) && ( ! error_occurred ); ++i )
+            {
+                try
+                {
+                    job( i );
+                }
+                catch ( std::exception & e )
+                {
+                    if ( ! error_occurred.exchange( true ) )
+                        error_message = e.what();
+                }
+            }
+        }
+    };
+    TaskGroup task_group;
+    for ( size_t t( 1 ); t != nthreads; ++t )
+        task_group.run( work );
+    work();
+    task_group.wait();
+    if ( error_occurred )
+        throw std::runtime_error( error_message );
+}
+
+// Returns identity reduced with map( i ) for i = 0 ... njobs-1, e.g. a sum with reduce = std::plus< double >() and identity 0.0.
+// The indices are processed in chunks of grain_size; each chunk is reduced in index order and the results of the chunks are then
+// reduced in chunk order, so for a given grain_size the result does not depend on the number of threads, not even with floating-point rounding.
+template< class T, class Map, class Reduce >
+T parallel_reduce( const size_t njobs, const size_t nthreads, const size_t grain_size, const T & identity, Map map, Reduce reduce )
+{
+    const size_t grain = std::max( grain_size, size_t( 1 ) );
+    const size_t nchunks = ( njobs + grain - 1 ) / grain;
+    std::vector< T > chunk_results( nchunks, identity );
+    parallel_for( nchunks, nthreads, [&]( const size_t chunk )
+    {
+        const size_t end = std::min( ( chunk + 1 ) * grain, njobs );
+        T chunk_result = identity;
+        for ( size_t i( chunk * grain ); i != end; ++i )
+            chunk_result = reduce( chunk_result, map( i ) );
+        chunk_results[ chunk ] = chunk_result;
+    } );
+    T result = identity;
+    for ( size_t chunk( 0 ); chunk != nchunks; ++chunk )
+        result = reduce( result, chunk_results[ chunk ] );
+    return result;
+}
+
+// Returns the sum of map( i ) for i = 0 ... njobs-1, map( i ) must return a double.
+// FAST_SUMMATION is parallel_reduce(): the result does not depend on the number of threads, but it does depend on grain_size.
+// REPRODUCIBLE_SUMMATION adds the values of each chunk to a ReproducibleSum, so the result does not depend on grain_size either.
+template< class Map >
+double parallel_sum( const size_t njobs, const size_t nthreads, const size_t grain_size, Map map, const SummationMode summation_mode = FAST_SUMMATION )
+{
+    if ( summation_mode == FAST_SUMMATION )
+        return parallel_reduce( njobs, nthreads, grain_size, 0.0, map, []( const double lhs, const double rhs ) { return lhs + rhs; } );
+    const size_t grain = std::max( grain_size, size_t( 1 ) );
+    const size_t nchunks = ( njobs + grain - 1 ) / grain;
+    std::vector< ReproducibleSum > chunk_sums( nchunks );
+    parallel_for( nchunks, nthreads, [&]( const size_t chunk )
+    {
+        const size_t end = std::min( ( chunk + 1 ) * grain, njobs );
+        for ( size_t i( chunk * grain ); i != end; ++i )
+            chunk_sums[ chunk ].add( map( i ) );
+    } );
+    ReproducibleSum result;
+    for ( size_t chunk( 0 ); chunk != nchunks; ++chunk )
+        result.add( chunk_sums[ chunk ] );
+    return result.sum();
+}
+
+#endif // PARALLELFOR_H
@@ -0,0 +1,167 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PeakSearch.h"
+#include "ChebyshevBackground.h"
+#include "MathFunctions.h"
+#include "PowderPattern.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ********************************************************************************
+
+PeakSearch::PeakSearch():
+smoothing_window_( Angle::from_degrees( 0.05 ) ),
+minimum_significance_( 3.0 ),
+background_method_( BRUECKNER ),
+brueckner_window_( Angle::from_degrees( 0.75 ) ),
+nbackground_terms_( 8 )
+{
+}
+
+// ********************************************************************************
+
+PowderPattern PeakSearch::background( const PowderPattern & powder_pattern ) const
+{
+    PowderPattern result( powder_pattern );
+    if ( powder_pattern.size() < 2 )
+        return result;
+    switch ( background_method_ )
+    {
+        case NONE :
+        {
+            for ( size_t i( 0 ); i != result.size(); ++i )
+                result.set_intensity( i, 0.0 );
+            break;
+        }
+        case BRUECKNER :
+        {
+            const int window = std::max( 1, round_to_int( brueckner_window_ / powder_pattern.average_two_theta_step() ) );
+            result = calculate_Brueckner_background( powder_pattern, 50, window, true, 5 );
+            break;
+        }
+        case CHEBYSHEV :
+        {
+            const std::vector< double > basis = Chebyshev_basis( nbackground_terms_, powder_pattern );
+            std::vector< double > values( powder_pattern.intensities(), powder_pattern.intensities() + powder_pattern.size() );
+            std::vector< double > background( values.size() );
+            // Points that are clipped stay clipped, so this converges from above in a few iterations
+            for ( size_t iteration( 0 ); iteration != 20; ++iteration )
+            {
+                const std::vector< double > coefficients = fit_Chebyshev_background( basis, nbackground_terms_, values, powder_pattern.weights() );
+                background = Chebyshev_background( coefficients, powder_pattern );
+                bool clipped( false );
+                for ( size_t i( 0 ); i != values.size(); ++i )
+                {
+                    if ( values[i] > background[i] )
+                    {
+                        values[i] = background[i];
+                        clipped = true;
+                    }
+                }
+                if ( ! clipped )
+                    break;
+            }
+            for ( size_t i( 0 ); i != result.size(); ++i )
+                result.set_intensity( i, background[i] );
+            break;
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< PowderPatternPeak > PeakSearch::find_peaks( const PowderPattern & powder_pattern ) const
+{
+    std::vector< PowderPatternPeak > result;
+    const size_t npoints = powder_pattern.size();
+    if ( npoints < 5 )
+        return result;
+    const size_t m = std::max( 1, round_to_int( smoothing_window_ / powder_pattern.average_two_theta_step() ) );
+    if ( npoints < 2 * m + 3 )
+        return result;
+    const PowderPattern background_pattern = background( powder_pattern );
+    std::vector< double > net( npoints );
+    for ( size_t i( 0 ); i != npoints; ++i )
+        net[i] = powder_pattern.intensity( i ) - background_pattern.intensity( i );
+    // Savitzky-Golay quadratic: the coefficient of j^2 is sum_j w_j y_j / sum_j w_j j^2 with w_j = j^2 - <j^2>.
+    // The second derivative is that times 2 / step^2, which cancels in the significance, so it is left out.
+    std::vector< double > weights( 2 * m + 1 );
+    const double average_j2 = m * ( m + 1.0 ) / 3.0;
+    for ( size_t j( 0 ); j != 2 * m + 1; ++j )
+        weights[j] = square( static_cast< double >( j ) - static_cast< double >( m ) ) - average_j2;
+    std::vector< double > second_derivative( npoints, 0.0 );
+    std::vector< double > variance( npoints, 0.0 );
+    const double * ESDs = powder_pattern.estimated_standard_deviations();
+    for ( size_t i( m ); i != npoints - m; ++i )
+    {
+        double sum( 0.0 );
+        double sum_of_variances( 0.0 );
+        for ( size_t j( 0 ); j != 2 * m + 1; ++j )
+        {
+            sum += weights[j] * net[i-m+j];
+            sum_of_variances += square( weights[j] * ESDs[i-m+j] );
+        }
+        second_derivative[i] = sum;
+        variance[i] = sum_of_variances;
+    }
+    for ( size_t i( m + 1 ); i != npoints - m - 1; ++i )
+    {
+        if ( ! ( ( second_derivative[i] < second_derivative[i-1] ) && ( second_derivative[i] <= second_derivative[i+1] ) ) )
+            continue;
+        const double significance = -second_derivative[i] / std::sqrt( variance[i] );
+        if ( ! ( significance > minimum_significance_ ) )
+            continue;
+        if ( ! ( net[i] > minimum_significance_ * ESDs[i] ) )
+            continue;
+        const double curvature = second_derivative[i-1] - 2.0 * second_derivative[i] + second_derivative[i+1];
+        double offset( 0.0 );
+        if ( curvature > 0.0 )
+            offset = std::max( -0.5, std::min( 0.5, 0.5 * ( second_derivative[i-1] - second_derivative[i+1] ) / curvature ) );
+        PowderPatternPeak peak;
+        if ( offset < 0.0 )
+            peak.two_theta_ = powder_pattern.two_theta( i ) + ( powder_pattern.two_theta( i ) - powder_pattern.two_theta( i - 1 ) ) * offset;
+        else
+            peak.two_theta_ = powder_pattern.two_theta( i ) + ( powder_pattern.two_theta( i + 1 ) - powder_pattern.two_theta( i ) ) * offset;
+        peak.intensity_ = net[i];
+        peak.significance_ = significance;
+        result.push_back( peak );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< Angle > peak_positions( const std::vector< PowderPatternPeak > & peaks, const size_t n )
+{
+    std::vector< Angle > result;
+    for ( size_t i( 0 ); ( i != peaks.size() ) && ( i != n ); ++i )
+        result.push_back( peaks[i].two_theta_ );
+    return result;
+}
@@ -0,0 +1,108 @@
+#ifndef PEAKSEARCH_H
+#define PEAKSEARCH_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class PowderPattern;
+
+#include "Angle.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+struct PowderPatternPeak
+{
+    PowderPatternPeak(): intensity_(0.0), significance_(0.0) {}
+
+    Angle two_theta_;
+    double intensity_;    // Above the background, at the point nearest to the peak position
+    double significance_; // Minus the smoothed second derivative divided by its ESD
+};
+
+/*
+  Peak picking on a powder pattern with the smoothed second derivative.
+
+  The background is subtracted first. The second derivative is the Savitzky-Golay quadratic with 2m+1 points, m = smoothing_window() / 2theta step,
+  and its ESD follows from the ESDs of the pattern. Each local minimum of the second derivative that is more than minimum_significance()
+  times its ESD below zero and whose intensity above the background is more than minimum_significance() times the ESD of the intensity is a peak.
+  Because the second derivative is sharper than the peak itself, shoulders of overlapping peaks are found as separate peaks.
+  The position is interpolated by a parabola through the second derivative at the minimum and its two neighbours.
+  The 2theta values are treated as equidistant; the points within m of either end are not searched.
+
+  O(N m).
+*/
+class PeakSearch
+{
+public:
+
+    // BRUECKNER: calculate_Brueckner_background() with a window of brueckner_window().
+    // CHEBYSHEV: a Chebyshev polynomial with nbackground_terms() terms, refitted while each point above it is replaced by the polynomial,
+    // so that the peaks do not pull it up.
+    enum BackgroundMethod { NONE, BRUECKNER, CHEBYSHEV };
+
+    PeakSearch();
+
+    // The default is 0.05 degrees, about half the FWHM of the peaks works best.
+    Angle smoothing_window() const { return smoothing_window_; }
+    void set_smoothing_window( const Angle smoothing_window ) { smoothing_window_ = smoothing_window; }
+
+    // The default is 3.0.
+    double minimum_significance() const { return minimum_significance_; }
+    void set_minimum_significance( const double minimum_significance ) { minimum_significance_ = minimum_significance; }
+
+    // The default is BRUECKNER.
+    BackgroundMethod background_method() const { return background_method_; }
+    void set_background_method( const BackgroundMethod background_method ) { background_method_ = background_method; }
+
+    // The default is 0.75 degrees.
+    Angle brueckner_window() const { return brueckner_window_; }
+    void set_brueckner_window( const Angle brueckner_window ) { brueckner_window_ = brueckner_window; }
+
+    // The default is 8.
+    size_t nbackground_terms() const { return nbackground_terms_; }
+    void set_nbackground_terms( const size_t nbackground_terms ) { nbackground_terms_ = nbackground_terms; }
+
+    // The background as subtracted by find_peaks(), with the 2theta values and the ESDs of powder_pattern.
+    PowderPattern background( const PowderPattern & powder_pattern ) const;
+
+    // In ascending order of 2theta.
+    std::vector< PowderPatternPeak > find_peaks( const PowderPattern & powder_pattern ) const;
+
+private:
+    Angle smoothing_window_;
+    double minimum_significance_;
+    BackgroundMethod background_method_;
+    Angle brueckner_window_;
+    size_t nbackground_terms_;
+};
+
+// The 2theta values of the first n peaks, the usual input for indexing.
+std::vector< Angle > peak_positions( const std::vector< PowderPatternPeak > & peaks, const size_t n );
+
+#endif // PEAKSEARCH_H
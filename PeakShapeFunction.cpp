@@ -0,0 +1,178 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PeakShapeFunction.h"
+#include "MathConstants.h"
+#include "MathFunctions.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+// The Gaussian with FWHM 1.0 and area 1.0 is tabulated up to this many FWHMs, beyond that it is less than 1.0E-10 of its maximum.
+const double Gaussian_table_range = 3.0;
+// Points per FWHM. The error of the linear interpolation is smaller than 1.0E-6 of the maximum.
+const double Gaussian_table_density = 1000.0;
+
+// ********************************************************************************
+
+std::vector< double > generate_Gaussian_table()
+{
+    std::vector< double > result;
+    size_t npoints = static_cast<size_t>( Gaussian_table_range * Gaussian_table_density ) + 2;
+    result.reserve( npoints );
+    const double normalisation = 2.0 * sqrt( log( 2.0 ) / CONSTANT_PI );
+    for ( size_t i( 0 ); i != npoints; ++i )
+        result.push_back( normalisation * exp( -4.0 * log( 2.0 ) * square( i / Gaussian_table_density ) ) );
+    return result;
+}
+
+// ********************************************************************************
+
+// Gaussian with FWHM 1.0 and area 1.0, u is in units of the FWHM.
+double unit_Gaussian( double u )
+{
+    static const std::vector< double > table = generate_Gaussian_table();
+    u = std::abs( u ) * Gaussian_table_density;
+    if ( u >= Gaussian_table_range * Gaussian_table_density )
+        return 0.0;
+    size_t i = static_cast<size_t>( u );
+    double fraction = u - i;
+    return ( 1.0 - fraction ) * table[i] + fraction * table[i+1];
+}
+
+// ********************************************************************************
+
+// Lorentzian with FWHM 1.0 and area 1.0, u is in units of the FWHM.
+inline double unit_Lorentzian( const double u )
+{
+    return ( 2.0 / CONSTANT_PI ) / ( 1.0 + 4.0 * square( u ) );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+double PeakShapeFunction::value( const double delta, const double FWHM, const double eta ) const
+{
+    double u = delta / FWHM;
+    double result( 0.0 );
+    if ( eta != 0.0 )
+        result += eta * unit_Lorentzian( u );
+    if ( eta != 1.0 )
+        result += ( 1.0 - eta ) * unit_Gaussian( u );
+    return result / FWHM;
+}
+
+// ********************************************************************************
+
+void PeakShapeFunction::value_and_derivatives( const double delta, const double FWHM, const double eta, double & value, double & d_delta, double & d_FWHM ) const
+{
+    const double u = delta / FWHM;
+    // The shape in units of the FWHM and its derivative with respect to u
+    const double Lorentzian = ( 2.0 / CONSTANT_PI ) / ( 1.0 + 4.0 * square( u ) );
+    const double Gaussian = 2.0 * sqrt( log( 2.0 ) / CONSTANT_PI ) * exp( -4.0 * log( 2.0 ) * square( u ) );
+    const double shape = eta * Lorentzian + ( 1.0 - eta ) * Gaussian;
+    const double d_shape = -8.0 * u * ( eta * square( Lorentzian ) * ( CONSTANT_PI / 2.0 ) + ( 1.0 - eta ) * log( 2.0 ) * Gaussian );
+    value = shape / FWHM;
+    d_delta = d_shape / square( FWHM );
+    d_FWHM = -( shape + u * d_shape ) / square( FWHM );
+}
+
+// ********************************************************************************
+
+double PeakShapeFunction::range( const double FWHM, const double eta ) const
+{
+    const double fraction = 0.001;
+    // The Gaussian part drops below the fraction at sqrt( ln( 1/fraction ) / ( 4 ln 2 ) ) FWHMs
+    double result = sqrt( log( 1.0 / fraction ) / ( 4.0 * log( 2.0 ) ) );
+    if ( eta > 0.0 )
+    {
+        // Solve eta * L( u ) = fraction * ( eta * L( 0 ) + ( 1 - eta ) * G( 0 ) ) for u
+        double maximum = eta * unit_Lorentzian( 0.0 ) + ( 1.0 - eta ) * unit_Gaussian( 0.0 );
+        double ratio = ( fraction * maximum ) / ( eta * unit_Lorentzian( 0.0 ) );
+        if ( ratio < 1.0 )
+            result = std::max( result, 0.5 * sqrt( 1.0 / ratio - 1.0 ) );
+    }
+    return result * FWHM;
+}
+
+// ********************************************************************************
+
+ThompsonCoxHastingsPeakShape::ThompsonCoxHastingsPeakShape( const double U, const double V, const double W, const double X, const double Y ):
+U_(U),
+V_(V),
+W_(W),
+X_(X),
+Y_(Y)
+{
+}
+
+// ********************************************************************************
+
+double ThompsonCoxHastingsPeakShape::FWHM( const Angle two_theta ) const
+{
+    double FWHM;
+    double eta;
+    calculate_FWHM_and_eta( two_theta, FWHM, eta );
+    return FWHM;
+}
+
+// ********************************************************************************
+
+double ThompsonCoxHastingsPeakShape::eta( const Angle two_theta ) const
+{
+    double FWHM;
+    double eta;
+    calculate_FWHM_and_eta( two_theta, FWHM, eta );
+    return eta;
+}
+
+// ********************************************************************************
+
+void ThompsonCoxHastingsPeakShape::calculate_FWHM_and_eta( const Angle two_theta, double & FWHM, double & eta ) const
+{
+    Angle theta = two_theta / 2.0;
+    double tangent = theta.tangent();
+    double FWHM_G2 = U_ * square( tangent ) + V_ * tangent + W_;
+    if ( FWHM_G2 < 0.0 )
+        throw std::runtime_error( "ThompsonCoxHastingsPeakShape::calculate_FWHM_and_eta(): Gaussian FWHM^2 is negative." );
+    double G = sqrt( FWHM_G2 );
+    double L = X_ * tangent + Y_ / theta.cosine();
+    FWHM = std::pow( std::pow( G, 5 ) + 2.69269 * std::pow( G, 4 ) * L + 2.42843 * std::pow( G, 3 ) * square( L ) +
+                     4.47163 * square( G ) * std::pow( L, 3 ) + 0.07842 * G * std::pow( L, 4 ) + std::pow( L, 5 ), 0.2 );
+    if ( FWHM <= 0.0 )
+        throw std::runtime_error( "ThompsonCoxHastingsPeakShape::calculate_FWHM_and_eta(): FWHM is not positive." );
+    double q = L / FWHM;
+    eta = 1.36603 * q - 0.47719 * square( q ) + 0.11116 * std::pow( q, 3 );
+}
+
+// ********************************************************************************
+
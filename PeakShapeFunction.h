@@ -0,0 +1,135 @@
+#ifndef PEAKSHAPEFUNCTION_H
+#define PEAKSHAPEFUNCTION_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Angle.h"
+
+/*
+  A peak shape function, centred around 0.0 and with its area normalised to 1.0.
+
+  All shapes are pseudo-Voigts, i.e. a linear combination eta * L + (1-eta) * G of a Lorentzian and a Gaussian
+  with the same FWHM; the derived classes only differ in how the FWHM and eta depend on 2theta.
+  The Gaussian is tabulated once, in units of the FWHM, and interpolated, so evaluating a peak does not require
+  a call to exp(). Because the function is evaluated at the exact distance from the peak position,
+  peaks are not shifted to the nearest 2theta point and larger 2theta steps remain accurate.
+
+  All values are in degrees 2theta.
+*/
+class PeakShapeFunction
+{
+public:
+
+    virtual ~PeakShapeFunction() {}
+
+    virtual double FWHM( const Angle two_theta ) const = 0;
+
+    // The fraction Lorentzian, between 0.0 and 1.0.
+    virtual double eta( const Angle two_theta ) const = 0;
+
+    // delta is the distance to the peak position.
+    double value( const double delta, const double FWHM, const double eta ) const;
+
+    double value( const double delta, const Angle two_theta ) const { return value( delta, FWHM( two_theta ), eta( two_theta ) ); }
+
+    // The value and its partial derivatives with respect to delta and to the FWHM, for refinement.
+    // The Gaussian is evaluated exactly rather than interpolated, so value can differ from value() by about 1.0E-6 of the maximum.
+    void value_and_derivatives( const double delta, const double FWHM, const double eta, double & value, double & d_delta, double & d_FWHM ) const;
+
+    // Half the width of the range outside which the peak is below 0.1% of its maximum.
+    double range( const double FWHM, const double eta ) const;
+};
+
+class GaussianPeakShape : public PeakShapeFunction
+{
+public:
+
+    explicit GaussianPeakShape( const double FWHM ) : FWHM_(FWHM) {}
+
+    double FWHM( const Angle /*two_theta*/ ) const override { return FWHM_; }
+    double eta( const Angle /*two_theta*/ ) const override { return 0.0; }
+
+private:
+    double FWHM_;
+};
+
+class LorentzianPeakShape : public PeakShapeFunction
+{
+public:
+
+    explicit LorentzianPeakShape( const double FWHM ) : FWHM_(FWHM) {}
+
+    double FWHM( const Angle /*two_theta*/ ) const override { return FWHM_; }
+    double eta( const Angle /*two_theta*/ ) const override { return 1.0; }
+
+private:
+    double FWHM_;
+};
+
+class PseudoVoigtPeakShape : public PeakShapeFunction
+{
+public:
+
+    PseudoVoigtPeakShape( const double FWHM, const double eta ) : FWHM_(FWHM), eta_(eta) {}
+
+    double FWHM( const Angle /*two_theta*/ ) const override { return FWHM_; }
+    double eta( const Angle /*two_theta*/ ) const override { return eta_; }
+
+private:
+    double FWHM_;
+    double eta_;
+};
+
+/*
+  Thompson-Cox-Hastings pseudo-Voigt (J. Appl. Cryst. (1987), 20, 79-83).
+
+  FWHM_G^2 = U tan^2(theta) + V tan(theta) + W
+  FWHM_L   = X tan(theta) + Y / cos(theta)
+
+  The FWHM and eta of the pseudo-Voigt are calculated from FWHM_G and FWHM_L with the TCH approximation.
+*/
+class ThompsonCoxHastingsPeakShape : public PeakShapeFunction
+{
+public:
+
+    ThompsonCoxHastingsPeakShape( const double U, const double V, const double W, const double X, const double Y );
+
+    double FWHM( const Angle two_theta ) const override;
+    double eta( const Angle two_theta ) const override;
+
+private:
+    double U_;
+    double V_;
+    double W_;
+    double X_;
+    double Y_;
+
+    void calculate_FWHM_and_eta( const Angle two_theta, double & FWHM, double & eta ) const;
+};
+
+#endif // PEAKSHAPEFUNCTION_H
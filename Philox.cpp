@@ -0,0 +1,148 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "Philox.h"
+
+namespace
+{
+
+const uint32_t PHILOX_M0 = 0xD2511F53;
+const uint32_t PHILOX_M1 = 0xCD9E8D57;
+const uint32_t PHILOX_W0 = 0x9E3779B9;
+const uint32_t PHILOX_W1 = 0xBB67AE85;
+
+inline void Philox_round( uint32_t c[4], const uint32_t k[2] )
+{
+    const uint64_t product_0 = static_cast<uint64_t>( PHILOX_M0 ) * c[0];
+    const uint64_t product_1 = static_cast<uint64_t>( PHILOX_M1 ) * c[2];
+    const uint32_t hi_0 = static_cast<uint32_t>( product_0 >> 32 );
+    const uint32_t lo_0 = static_cast<uint32_t>( product_0 );
+    const uint32_t hi_1 = static_cast<uint32_t>( product_1 >> 32 );
+    const uint32_t lo_1 = static_cast<uint32_t>( product_1 );
+    c[0] = hi_1 ^ c[1] ^ k[0];
+    c[1] = lo_1;
+    c[2] = hi_0 ^ c[3] ^ k[1];
+    c[3] = lo_0;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+Philox4x32::Philox4x32( const uint64_t seed, const uint64_t stream ):
+stream_(stream),
+position_(0)
+{
+    key_[0] = static_cast<uint32_t>( seed );
+    key_[1] = static_cast<uint32_t>( seed >> 32 );
+}
+
+// ********************************************************************************
+
+void Philox4x32::block( const uint64_t i, uint32_t result[4] ) const
+{
+    uint32_t counter[4];
+    counter[0] = static_cast<uint32_t>( i );
+    counter[1] = static_cast<uint32_t>( i >> 32 );
+    counter[2] = static_cast<uint32_t>( stream_ );
+    counter[3] = static_cast<uint32_t>( stream_ >> 32 );
+    block( counter, key_, result );
+}
+
+// ********************************************************************************
+
+void Philox4x32::block( const uint32_t counter[4], const uint32_t key[2], uint32_t result[4] )
+{
+    uint32_t k[2] = { key[0], key[1] };
+    for ( size_t i( 0 ); i != 4; ++i )
+        result[i] = counter[i];
+    for ( size_t i( 0 ); i != 10; ++i )
+    {
+        if ( i != 0 )
+        {
+            k[0] += PHILOX_W0;
+            k[1] += PHILOX_W1;
+        }
+        Philox_round( result, k );
+    }
+}
+
+// ********************************************************************************
+
+void Philox4x32::next_doubles( double & u1, double & u2 )
+{
+    uint32_t r[4];
+    next_block( r );
+    u1 = to_double( r[0], r[1] );
+    u2 = to_double( r[2], r[3] );
+}
+
+// ********************************************************************************
+
+void Philox4x32::fill( double * values, const size_t n )
+{
+    uint32_t r[4];
+    for ( size_t i( 0 ); i < n; i += 2 )
+    {
+        next_block( r );
+        values[i] = to_double( r[0], r[1] );
+        if ( i + 1 < n )
+            values[i+1] = to_double( r[2], r[3] );
+    }
+}
+
+// ********************************************************************************
+
+void Philox4x32::fill( uint32_t * values, const size_t n )
+{
+    uint32_t r[4];
+    for ( size_t i( 0 ); i < n; i += 4 )
+    {
+        next_block( r );
+        for ( size_t j( 0 ); ( j != 4 ) && ( i + j < n ); ++j )
+            values[i+j] = r[j];
+    }
+}
+
+// ********************************************************************************
+
+std::vector< Philox4x32 > Philox4x32::split( const size_t n ) const
+{
+    std::vector< Philox4x32 > result;
+    result.reserve( n );
+    Philox4x32 generator( *this );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        generator.jump();
+        result.push_back( generator );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
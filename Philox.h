@@ -0,0 +1,98 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
+#include <vector>
+
+/*
+  Philox4x32-10 counter-based random number generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC11).
+
+  A counter-based generator has no state other than its key: block( counter ) is a pure function that turns a 128-bit
+  counter into 128 random bits. Any element of the sequence can therefore be generated directly, and two different
+  keys or two different counters give statistically independent numbers, which makes it ideal for parallel code:
+  each thread or each job simply uses its own stream number, and the result does not depend on the number of threads.
+
+  The 64-bit seed is the key, words 2 and 3 of the counter are the 64-bit stream number and words 0 and 1 are the
+  position in the stream.
+*/
+class Philox4x32
+{
+public:
+
+    explicit Philox4x32( const uint64_t seed = 1539, const uint64_t stream = 0 );
+
+    uint64_t seed() const { return ( static_cast<uint64_t>( key_[1] ) << 32 ) | key_[0]; }
+    uint64_t stream() const { return stream_; }
+
+    // The four 32-bit words for position i of the stream. Does not change the generator.
+    void block( const uint64_t i, uint32_t result[4] ) const;
+
+    // Applies the ten Philox rounds to an arbitrary counter with an arbitrary key.
+    static void block( const uint32_t counter[4], const uint32_t key[2], uint32_t result[4] );
+
+    // Converts two 32-bit words to a double in the open interval ( 0.0, 1.0 ) with 53 random bits.
+    static double to_double( const uint32_t hi, const uint32_t lo )
+    {
+        const uint64_t bits = ( ( static_cast<uint64_t>( hi ) << 32 ) | lo ) >> 11;
+        return ( static_cast<double>( bits ) + 0.5 ) * ( 1.0 / 9007199254740992.0 );
+    }
+
+    // Sequential use: the next block and the next two doubles in ( 0.0, 1.0 ).
+    void next_block( uint32_t result[4] ) { block( position_++, result ); }
+    void next_doubles( double & u1, double & u2 );
+
+    // Fills with doubles in ( 0.0, 1.0 ) or with 32-bit words, continuing the sequence.
+    void fill( double * values, const size_t n );
+    void fill( uint32_t * values, const size_t n );
+    void fill( std::vector< double > & values ) { if ( ! values.empty() ) fill( &values[0], values.size() ); }
+
+    // Skips n blocks.
+    void discard( const uint64_t n ) { position_ += n; }
+
+    // Skips 2^48 blocks (2^49 doubles), for the same interface as Xoshiro256StarStar.
+    void jump() { discard( static_cast<uint64_t>( 1 ) << 48 ); }
+
+    // Returns n generators, generator i is this generator jumped i+1 times. For unrelated jobs it is simpler
+    // to use a different stream number for each job.
+    std::vector< Philox4x32 > split( const size_t n ) const;
+
+    // Position in the stream, in blocks.
+    uint64_t position() const { return position_; }
+    void set_position( const uint64_t position ) { position_ = position; }
+
+private:
+    uint32_t key_[2];
+    uint64_t stream_;
+    uint64_t position_;
+};
+
+#endif // PHILOX_H
+
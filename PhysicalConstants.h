@@ -34,5 +34,9 @@ const double Avogadros_constant = 6.022140857E23;
 // Unit: kcal / K / mol
 const double gas_constant = 1.9858775E-3;
 
+// e^2 / ( 4 pi epsilon_0 ), the Coulomb energy of two unit charges 1 A apart
+// Unit: kcal A / mol / e^2
+const double Coulomb_constant = 332.0637133;
+
 #endif // PHYSICALCONSTANTS_H
 
@@ -69,14 +69,7 @@ Plane::Plane( const Vector3D & r1, const Vector3D & r2, const Vector3D & r3 )
 
 Plane::Plane( const std::vector< Vector3D > & points )
 {
-    SymmetricMatrix3D covariance_matrix2 = covariance_matrix( points );
-    std::vector< double > eigenvalues;
-    std::vector< NormalisedVector3D > eigenvectors;
-    calculate_eigenvalues( covariance_matrix2, eigenvalues, eigenvectors );
-    // The eigenvectors are sorted by eigenvalue, the smallest is the first
-    n_ = eigenvectors[0];
-    // The centre of mass of the points lies in the plane
-    c_ = n_ * average( points );
+    *this = PointMoments( points ).best_plane();
 }
 
 // ********************************************************************************
@@ -26,6 +26,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "PointGroup.h"
+#include "IntegerSymmetryOperator.h"
+#include "SymmetryOperator.h"
 #include "Utilities.h"
 
 #include <stdexcept>
@@ -88,6 +90,18 @@ void PointGroup::add_inversion()
 
 void check_if_closed( const std::vector< Matrix3D > & symmetry_operators )
 {
+    // Crystallographic point groups can be represented exactly with integers, which allows a hash table to be used
+    std::vector< SymmetryOperator > symmetry_operators_2;
+    symmetry_operators_2.reserve( symmetry_operators.size() );
+    for ( size_t i( 0 ); i != symmetry_operators.size(); ++i )
+        symmetry_operators_2.push_back( SymmetryOperator( symmetry_operators[i], Vector3D() ) );
+    std::vector< IntegerSymmetryOperator > integer_symmetry_operators;
+    if ( to_integer_symmetry_operators( symmetry_operators_2, integer_symmetry_operators ) )
+    {
+        if ( ! is_closed( integer_symmetry_operators ) )
+            throw std::runtime_error( "check_if_closed( std::vector< Matrix3D > ): operator not found." );
+        return;
+    }
     for ( size_t i( 0 ); i != symmetry_operators.size(); ++i )
     {
         for ( size_t j( 0 ); j != symmetry_operators.size(); ++j )
@@ -74,7 +74,7 @@ private:
 };
 
 // Multiplies all combinations (both ways) and checks that the result is in the symmetry operators
-// This can take a lot of time
+// If the matrices can be represented as IntegerSymmetryOperators this is fast, otherwise it can take a lot of time
 void check_if_closed( const std::vector< Matrix3D > & symmetry_operators );
 
 std::ostream & operator<<( std::ostream & os, const PointGroup & point_group );
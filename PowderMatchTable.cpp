@@ -26,54 +26,268 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "PowderMatchTable.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "TextFileReader_2.h"
 #include "Utilities.h"
-#include "TextFileReader.h"
-#include "MillerIndices.h"
 
+#include <algorithm>
+#include <charconv>
 #include <stdexcept>
+#include <unordered_map>
 
 //  set_name |  structure_name  | directory  | status | comment |     energy      |       density      |     cell_volume    | reduced_cell_volume |  space_group  | number_of_dof |      penalty        | energy_with_penalty |        FOM         |          B             |    MarchDollase      |            h          |          k          |          l            |    CellDeformation   |        a           |        b           |        c           |      alpha       |        beta      |      gamma
 //           |                  |            |        |         | [kcal/mol/atom] |       [g/cm3]      |         [A3]       |       [A3]          |               |               |   [kcal/mol/atom]   |   [kcal/mol/atom]   |                    |                        |                      |                       |                     |                       |                      |                    |                    |                    |                  |                  |
 //-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 //    set1   | structure_000001 | jobs/job0  |  done  |  none   |       0         | 1.2529500320242304 | 1795.8846350943263 | 1795.8846350943263  | P 2_1 2_1 2_1 |       60      | 0.57516559613365126 | 0.57516559613365126 | 0.4316837101620814 | -0.037706868362922898  |  1.5513171064752962  |  -0.36060802990789309 |  0.9327174538765467 |          0            | 0.013636944428995774 | 8.2593307806227418 | 13.57628501823058  | 15.470539514891119 |        90        |        90        |         90
 
+namespace
+{
+
+const size_t ncolumns = 26;
+
+inline bool is_white_space( const char c )
+{
+    return ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' );
+}
+
+// A field of a row, [begin_,end_) without leading and trailing white space.
+struct Field
+{
+    const char * begin_;
+    const char * end_;
+    std::string to_string() const { return std::string( begin_, end_ ); }
+};
+
+// Splits [begin,end) at '|' into exactly ncolumns fields. Returns false if the number of fields is different.
+bool split_row( const char * begin, const char * end, Field * fields )
+{
+    size_t nfields( 0 );
+    const char * field_begin = begin;
+    for ( const char * iPos( begin ); ; ++iPos )
+    {
+        if ( ( iPos == end ) || ( *iPos == '|' ) )
+        {
+            if ( nfields == ncolumns )
+                return false;
+            const char * b = field_begin;
+            const char * e = iPos;
+            while ( ( b != e ) && is_white_space( *b ) )
+                ++b;
+            while ( ( e != b ) && is_white_space( *(e-1) ) )
+                --e;
+            fields[ nfields ].begin_ = b;
+            fields[ nfields ].end_ = e;
+            ++nfields;
+            if ( iPos == end )
+                break;
+            field_begin = iPos + 1;
+        }
+    }
+    return ( nfields == ncolumns );
+}
+
+double to_double( const Field & field, const size_t line_number, const size_t column )
+{
+    const char * begin = field.begin_;
+    if ( ( begin != field.end_ ) && ( *begin == '+' ) ) // from_chars() does not accept a leading '+'
+        ++begin;
+    double result;
+    std::from_chars_result from_chars_result = std::from_chars( begin, field.end_, result );
+    if ( ( from_chars_result.ec != std::errc() ) || ( from_chars_result.ptr != field.end_ ) )
+        throw std::runtime_error( "PowderMatchTable::read_file(): line " + size_t2string( line_number + 1 ) + ", column " + size_t2string( column + 1 ) +
+                                  ": cannot interpret \"" + field.to_string() + "\" as a number." );
+    return result;
+}
+
+inline bool inside( const double value, const double min, const double max )
+{
+    return ( min <= value ) && ( value <= max );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+PowderMatchTableQuery::PowderMatchTableQuery():
+energy_min_( -std::numeric_limits< double >::infinity() ),
+energy_max_( std::numeric_limits< double >::infinity() ),
+energy_with_penalty_min_( -std::numeric_limits< double >::infinity() ),
+energy_with_penalty_max_( std::numeric_limits< double >::infinity() ),
+density_min_( -std::numeric_limits< double >::infinity() ),
+density_max_( std::numeric_limits< double >::infinity() ),
+FOM_min_( -std::numeric_limits< double >::infinity() ),
+FOM_max_( std::numeric_limits< double >::infinity() )
+{
+}
+
 // ********************************************************************************
 
 PowderMatchTable::PowderMatchTable( const FileName & file_name )
 {
-    TextFileReader text_file_reader( file_name );
-    std::string line;
-    // Read the three header lines
-    if ( ! text_file_reader.get_next_line( line ) )
-        throw std::runtime_error( "PowderMatchTable::PowderMatchTable( FileName ): header line missing 1." );
-    if ( ! text_file_reader.get_next_line( line ) )
-        throw std::runtime_error( "PowderMatchTable::PowderMatchTable( FileName ): header line missing 2." );
-    if ( ! text_file_reader.get_next_line( line ) )
-        throw std::runtime_error( "PowderMatchTable::PowderMatchTable( FileName ): header line missing 3." );
-    Splitter splitter( "|" );
-    std::vector< std::string > words;
-    while ( text_file_reader.get_next_line( line ) )
+    read_file( file_name );
+}
+
+// ********************************************************************************
+
+void PowderMatchTable::read_file( const FileName & file_name )
+{
+    clear();
+    TextFileReader_2 text_file_reader( file_name );
+    // The three header lines
+    if ( text_file_reader.size() < 3 )
+        throw std::runtime_error( "PowderMatchTable::read_file(): header lines missing in " + file_name.full_name() );
+    const size_t nrows = text_file_reader.size() - 3;
+    set_names_.reserve( nrows );
+    names_.reserve( nrows );
+    directories_.reserve( nrows );
+    statuses_.reserve( nrows );
+    energies_.reserve( nrows );
+    densities_.reserve( nrows );
+    volumes_.reserve( nrows );
+    space_group_names_.reserve( nrows );
+    penalties_.reserve( nrows );
+    energies_with_penalty_.reserve( nrows );
+    figures_of_merit_.reserve( nrows );
+    Biso_values_.reserve( nrows );
+    MarchDollase_values_.reserve( nrows );
+    PO_directions_.reserve( nrows );
+    cell_deformations_.reserve( nrows );
+    cell_parameters_.reserve( 6 * nrows );
+    Field fields[ ncolumns ];
+    for ( size_t i( 3 ); i != text_file_reader.size(); ++i )
+    {
+        const char * begin = text_file_reader.line_begin( i );
+        const char * end = text_file_reader.line_end( i );
+        // Skip empty lines
+        const char * iPos = begin;
+        while ( ( iPos != end ) && is_white_space( *iPos ) )
+            ++iPos;
+        if ( iPos == end )
+            continue;
+        if ( ! split_row( begin, end, fields ) )
+            throw std::runtime_error( "PowderMatchTable::read_file(): line " + size_t2string( i + 1 ) + " does not have 26 columns." );
+        set_names_.push_back( fields[0].to_string() );
+        names_.push_back( fields[1].to_string() );
+        directories_.push_back( fields[2].to_string() );
+        statuses_.push_back( fields[3].to_string() );
+        // The comment in column 4 is not stored
+        energies_.push_back( to_double( fields[5], i, 5 ) );
+        densities_.push_back( to_double( fields[6], i, 6 ) );
+        volumes_.push_back( to_double( fields[7], i, 7 ) );
+        // The reduced-cell volume in column 8 is not stored
+        space_group_names_.push_back( fields[9].to_string() );
+        // The number of degrees of freedom in column 10 is not stored
+        penalties_.push_back( to_double( fields[11], i, 11 ) );
+        energies_with_penalty_.push_back( to_double( fields[12], i, 12 ) );
+        figures_of_merit_.push_back( to_double( fields[13], i, 13 ) );
+        Biso_values_.push_back( to_double( fields[14], i, 14 ) );
+        MarchDollase_values_.push_back( to_double( fields[15], i, 15 ) );
+        PO_directions_.push_back( Vector3D( to_double( fields[16], i, 16 ), to_double( fields[17], i, 17 ), to_double( fields[18], i, 18 ) ) );
+        cell_deformations_.push_back( to_double( fields[19], i, 19 ) );
+        for ( size_t j( 20 ); j != 26; ++j )
+            cell_parameters_.push_back( to_double( fields[j], i, j ) );
+    }
+}
+
+// ********************************************************************************
+
+CrystalLattice PowderMatchTable::crystal_lattice( const size_t i ) const
+{
+    const double * p = cell_parameters_.data() + 6 * i;
+    return CrystalLattice( p[0], p[1], p[2], Angle::from_degrees( p[3] ), Angle::from_degrees( p[4] ), Angle::from_degrees( p[5] ) );
+}
+
+// ********************************************************************************
+
+std::vector< size_t > PowderMatchTable::select( const PowderMatchTableQuery & query ) const
+{
+    std::vector< size_t > result;
+    for ( size_t i( 0 ); i != size(); ++i )
     {
-        words = splitter.split( line );
-        if ( words.size() != 26 )
-            throw std::runtime_error( "PowderMatchTable::PowderMatchTable( FileName ): words.size() != 26." );
-        strip( words );
-        names_.push_back( words[1] );
-        densities_.push_back( string2double( words[6] ) );
-        space_group_names_.push_back( words[9] );
-        figures_of_merit_.push_back( string2double( words[13] ) );
-        Biso_values_.push_back( string2double( words[14] ) );
-        MarchDollase_values_.push_back( string2double( words[15] ) );
-        PO_directions_.push_back( MillerIndices( ( std::stoi(words[16]) ), ( std::stoi(words[17]) ), ( std::stoi(words[18]) ) ) );
-        cell_deformations_.push_back( string2double( words[19] ) );
-        double a = string2double( words[20] );
-        double b = string2double( words[21] );
-        double c = string2double( words[22] );
-        Angle alpha = Angle::from_degrees( string2double( words[23] ) );
-        Angle beta  = Angle::from_degrees( string2double( words[24] ) );
-        Angle gamma = Angle::from_degrees( string2double( words[25] ) );
-        crystal_lattices_.push_back( CrystalLattice( a, b, c, alpha, beta, gamma ) );
+        if ( inside( energies_[i], query.energy_min_, query.energy_max_ ) &&
+             inside( energies_with_penalty_[i], query.energy_with_penalty_min_, query.energy_with_penalty_max_ ) &&
+             inside( densities_[i], query.density_min_, query.density_max_ ) &&
+             inside( figures_of_merit_[i], query.FOM_min_, query.FOM_max_ ) &&
+             ( query.status_.empty() || ( statuses_[i] == query.status_ ) ) )
+            result.push_back( i );
     }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< size_t > PowderMatchTable::top_k( const size_t k ) const
+{
+    std::vector< size_t > rows( size() );
+    for ( size_t i( 0 ); i != size(); ++i )
+        rows[i] = i;
+    return top_k( k, rows );
+}
+
+// ********************************************************************************
+
+std::vector< size_t > PowderMatchTable::top_k( const size_t k, const std::vector< size_t > & rows ) const
+{
+    std::vector< size_t > result( rows );
+    const size_t n = std::min( k, result.size() );
+    auto less = [&]( const size_t lhs, const size_t rhs )
+    {
+        if ( energies_with_penalty_[lhs] != energies_with_penalty_[rhs] )
+            return energies_with_penalty_[lhs] < energies_with_penalty_[rhs];
+        return lhs < rhs;
+    };
+    // partial_sort() is O( N log k ), much cheaper than sorting the whole table when k is small.
+    std::partial_sort( result.begin(), result.begin() + n, result.end(), less );
+    result.resize( n );
+    return result;
+}
+
+// ********************************************************************************
+
+FileName PowderMatchTable::structure_file( const size_t i, const std::string & extension ) const
+{
+    return FileName( directories_[i], names_[i], extension );
+}
+
+// ********************************************************************************
+
+std::vector< size_t > PowderMatchTable::join( const FileList & file_list ) const
+{
+    std::unordered_map< std::string, size_t > index;
+    index.reserve( file_list.size() );
+    for ( size_t i( 0 ); i != file_list.size(); ++i )
+        index.emplace( file_list.value( i ).file_name(), i ); // emplace() does not overwrite, so the first occurrence wins
+    std::vector< size_t > result( size(), std::numeric_limits< size_t >::max() );
+    for ( size_t i( 0 ); i != size(); ++i )
+    {
+        auto it = index.find( names_[i] );
+        if ( it != index.end() )
+            result[i] = it->second;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+void PowderMatchTable::clear()
+{
+    set_names_.clear();
+    names_.clear();
+    directories_.clear();
+    statuses_.clear();
+    energies_.clear();
+    densities_.clear();
+    volumes_.clear();
+    space_group_names_.clear();
+    penalties_.clear();
+    energies_with_penalty_.clear();
+    figures_of_merit_.clear();
+    Biso_values_.clear();
+    MarchDollase_values_.clear();
+    PO_directions_.clear();
+    cell_deformations_.clear();
+    cell_parameters_.clear();
 }
 
 // ********************************************************************************
@@ -1,6 +1,5 @@
 #ifndef POWDERMATCHTABLE_H
 #define POWDERMATCHTABLE_H
-#include <vector>
 
 /* *********************************************
 Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
@@ -29,41 +28,115 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+class FileList;
 class FileName;
 
 #include "CrystalLattice.h"
-//#include "Fraction.h"
-#include "MillerIndices.h"
+#include "Vector3D.h"
 
+#include <limits>
 #include <string>
+#include <vector>
+
+// Windows for PowderMatchTable::select(), the defaults let everything through. Bounds are inclusive.
+struct PowderMatchTableQuery
+{
+    PowderMatchTableQuery();
+
+    double energy_min_;
+    double energy_max_;
+    double energy_with_penalty_min_;
+    double energy_with_penalty_max_;
+    double density_min_;
+    double density_max_;
+    double FOM_min_;
+    double FOM_max_;
+    std::string status_; // Empty means any status
+};
 
 /*
+  A crystal structure prediction match table: 26 columns separated by '|' after three header lines.
+
+  The table is stored column by column, the whole file is read at once and the numbers are parsed with
+  std::from_chars() straight from the file buffer without creating a std::string per field.
+  The unit cell is stored as six doubles and only turned into a CrystalLattice by crystal_lattice( i ).
 
+  Rows are identified by their index in the file. select() and top_k() return row indices so that they can be chained:
+  table.top_k( 100, table.select( query ) ).
 */
 class PowderMatchTable
 {
 public:
 
     // Default constructor
-    PowderMatchTable();
+    PowderMatchTable() {}
+
+    explicit PowderMatchTable( const FileName & file_name );
+
+    void read_file( const FileName & file_name );
 
-    PowderMatchTable( const FileName & file_name );
+    size_t size() const { return names_.size(); }
+    bool empty() const { return names_.empty(); }
+
+    std::string set_name( const size_t i ) const { return set_names_[i]; }
+    std::string name( const size_t i ) const { return names_[i]; }
+    std::string directory( const size_t i ) const { return directories_[i]; }
+    std::string status( const size_t i ) const { return statuses_[i]; }
+    double energy( const size_t i ) const { return energies_[i]; }
+    double density( const size_t i ) const { return densities_[i]; }
+    double volume( const size_t i ) const { return volumes_[i]; }
+    std::string space_group_name( const size_t i ) const { return space_group_names_[i]; }
+    double penalty( const size_t i ) const { return penalties_[i]; }
+    double energy_with_penalty( const size_t i ) const { return energies_with_penalty_[i]; }
+    double figure_of_merit( const size_t i ) const { return figures_of_merit_[i]; }
+    double Biso( const size_t i ) const { return Biso_values_[i]; }
+    double MarchDollase( const size_t i ) const { return MarchDollase_values_[i]; }
+    // The PO direction is not necessarily integer
+    Vector3D PO_direction( const size_t i ) const { return PO_directions_[i]; }
+    double cell_deformation( const size_t i ) const { return cell_deformations_[i]; }
+    CrystalLattice crystal_lattice( const size_t i ) const;
+
+    // Whole columns, for when the caller wants to do its own statistics
+    const std::vector< double > & energies() const { return energies_; }
+    const std::vector< double > & energies_with_penalty() const { return energies_with_penalty_; }
+    const std::vector< double > & densities() const { return densities_; }
+    const std::vector< double > & figures_of_merit() const { return figures_of_merit_; }
+
+    // Indices of the rows that fall inside all windows of query, in table order.
+    std::vector< size_t > select( const PowderMatchTableQuery & query ) const;
+
+    // Indices of the k rows with the lowest energy_with_penalty, sorted from low to high. Ties are broken by row index.
+    std::vector< size_t > top_k( const size_t k ) const;
+    // Same, but only considers the given rows, e.g. the output of select().
+    std::vector< size_t > top_k( const size_t k, const std::vector< size_t > & rows ) const;
+
+    // directory( i ) + name( i ) + "." + extension.
+    FileName structure_file( const size_t i, const std::string & extension = "cif" ) const;
+
+    // For every row, the index into file_list of the file whose file name (without directory or extension)
+    // equals name( i ), or std::numeric_limits< size_t >::max() if there is none. If a name occurs more than once
+    // in file_list, the first occurrence is used.
+    std::vector< size_t > join( const FileList & file_list ) const;
 
 private:
+    std::vector< std::string > set_names_;
     std::vector< std::string > names_;
-//    std::vector<  > status
-//    std::vector<  > comment
-//    std::vector<  > energy
+    std::vector< std::string > directories_;
+    std::vector< std::string > statuses_;
+    std::vector< double > energies_;
     std::vector< double > densities_;
+    std::vector< double > volumes_;
     std::vector< std::string > space_group_names_;
-//    std::vector< Fraction > number_of_dof
+    std::vector< double > penalties_;
+    std::vector< double > energies_with_penalty_;
     std::vector< double > figures_of_merit_;
     std::vector< double > Biso_values_;
     std::vector< double > MarchDollase_values_;
-    std::vector< MillerIndices > PO_directions_;
+    std::vector< Vector3D > PO_directions_;
     std::vector< double > cell_deformations_;
-    std::vector< CrystalLattice > crystal_lattices_;
+    std::vector< double > cell_parameters_; // a, b, c, alpha, beta, gamma per row, angles in degrees
+
+    void clear();
 };
 
 #endif // POWDERMATCHTABLE_H
-
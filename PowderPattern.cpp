@@ -26,8 +26,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "PowderPattern.h"
+#include "Compression.h"
+#include "FileList.h"
 #include "FileName.h"
+#include "Logger.h"
 #include "MathFunctions.h"
+#include "NoiseGenerator.h"
+#include "ParallelFor.h"
 #include "RunningAverageAndESD.h"
 #include "TextFileReader.h"
 #include "TextFileReader_2.h"
@@ -35,14 +40,206 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Utilities.h"
 #include "Vector3D.h" // Should not have been necessary
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <stdexcept>
 
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include "FileDescriptor.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include <iostream> // for debugging
 
+namespace
+{
+
+// Neumaier's variant of Kahan summation.
+// t is volatile because with -ffast-math the compiler is allowed to simplify ( sum_ - t ) + value to 0.0.
+class CompensatedSum
+{
+public:
+    CompensatedSum(): sum_(0.0), compensation_(0.0) {}
+
+    void add( const double value )
+    {
+        volatile double t = sum_ + value;
+        if ( std::abs( sum_ ) >= std::abs( value ) )
+            compensation_ += ( sum_ - t ) + value;
+        else
+            compensation_ += ( value - t ) + sum_;
+        sum_ = t;
+    }
+
+    double sum() const { return sum_ + compensation_; }
+
+private:
+    double sum_;
+    double compensation_;
+};
+
+// Four independent partial sums, so that the additions need not wait for each other and can be vectorised.
+double add_doubles_unrolled( const double * values, const size_t nvalues )
+{
+    double sum_0( 0.0 );
+    double sum_1( 0.0 );
+    double sum_2( 0.0 );
+    double sum_3( 0.0 );
+    size_t i( 0 );
+    for ( ; i + 4 <= nvalues; i += 4 )
+    {
+        sum_0 += values[i  ];
+        sum_1 += values[i+1];
+        sum_2 += values[i+2];
+        sum_3 += values[i+3];
+    }
+    for ( ; i != nvalues; ++i )
+        sum_0 += values[i];
+    return ( sum_0 + sum_1 ) + ( sum_2 + sum_3 );
+}
+
+// The whole file as one string, for the readers that parse the text in place.
+std::string read_whole_file( const FileName & file_name )
+{
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+        throw std::runtime_error( std::string( "read_whole_file(): Could not open file " ) + file_name.full_name() );
+    input_file.seekg( 0, std::ios::end );
+    std::string result( static_cast<size_t>( input_file.tellg() ), '\0' );
+    input_file.seekg( 0, std::ios::beg );
+    input_file.read( &result[0], result.size() );
+    return result;
+}
+
+inline bool is_white_space( const char c )
+{
+    return ( c == ' ' ) || ( c == '\t' ) || ( c == '\n' ) || ( c == '\r' );
+}
+
+// Skips leading white space, parses a double and moves begin past it. Returns false if there is no number.
+bool parse_double( const char * & begin, const char * end, double & value )
+{
+    while ( ( begin != end ) && is_white_space( *begin ) )
+        ++begin;
+    if ( ( begin != end ) && ( *begin == '+' ) ) // from_chars() does not accept a leading '+'
+        ++begin;
+    std::from_chars_result result = std::from_chars( begin, end, value );
+    if ( result.ec != std::errc() )
+        return false;
+    begin = result.ptr;
+    return true;
+}
+
+// Parses a double that must be the only thing in [begin,end) apart from white space.
+double parse_field( const char * begin, const char * end, const std::string & function_name )
+{
+    double result;
+    const char * iPos = begin;
+    if ( ! parse_double( iPos, end, result ) )
+        throw std::runtime_error( function_name + ": cannot interpret \"" + std::string( begin, end ) + "\"" );
+    while ( ( iPos != end ) && is_white_space( *iPos ) )
+        ++iPos;
+    if ( iPos != end )
+        throw std::runtime_error( function_name + ": cannot interpret \"" + std::string( begin, end ) + "\"" );
+    return result;
+}
+
+// Parses the number directly after the first occurrence of tag after iPos.
+double parse_double_after( const std::string & contents, const std::string & tag, const size_t iPos, const std::string & function_name )
+{
+    size_t iPos2 = contents.find( tag, iPos );
+    if ( iPos2 == std::string::npos )
+        throw std::runtime_error( function_name + ": " + tag + " not found." );
+    const char * begin = contents.data() + iPos2 + tag.size();
+    double result;
+    if ( ! parse_double( begin, contents.data() + contents.size(), result ) )
+        throw std::runtime_error( function_name + ": cannot interpret value after " + tag );
+    return result;
+}
+
+inline double default_estimated_standard_deviation( const double intensity )
+{
+    return std::max( sqrt( intensity ), intensity / 100.0 );
+}
+
+// The .ppb header: magic, number of points, single precision, constant 2theta step, wavelength, 2theta start and step in radians.
+// Multi-byte values are stored in the native byte order.
+const size_t ppb_header_size = 64;
+const char ppb_magic[] = "POWDPPB1";
+
+// Reads the whole file, memory-mapped where possible, and decompresses it if it is compressed.
+// Returns false if the file could not be opened.
+bool read_binary_file( const FileName & file_name, std::vector< char > & contents )
+{
+#ifdef _WIN32
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+        return false;
+    input_file.seekg( 0, std::ios::end );
+    contents.resize( static_cast< size_t >( input_file.tellg() ) );
+    input_file.seekg( 0, std::ios::beg );
+    if ( ! contents.empty() )
+        input_file.read( &contents[0], contents.size() );
+    decompress_if_compressed( contents );
+    return true;
+#else
+    const FileDescriptor file_descriptor( open( file_name.full_name().c_str(), O_RDONLY ) );
+    if ( file_descriptor.value() < 0 )
+        return false;
+    struct stat file_status;
+    if ( fstat( file_descriptor.value(), &file_status ) != 0 )
+        return false;
+    contents.resize( static_cast< size_t >( file_status.st_size ) );
+    if ( contents.empty() )
+        return true;
+    void * mapping = mmap( 0, contents.size(), PROT_READ, MAP_PRIVATE, file_descriptor.value(), 0 );
+    if ( mapping == MAP_FAILED )
+        return false;
+    std::memcpy( &contents[0], mapping, contents.size() );
+    munmap( mapping, contents.size() );
+    decompress_if_compressed( contents );
+    return true;
+#endif
+}
+
+// Converts npoints values of type T starting at data into result, returns the position after the values.
+template< class T >
+const char * read_values( const char * data, const size_t npoints, std::vector< double > & result )
+{
+    result.resize( npoints );
+    for ( size_t i( 0 ); i != npoints; ++i )
+    {
+        T value;
+        std::memcpy( &value, data + i * sizeof( T ), sizeof( T ) );
+        result[i] = value;
+    }
+    return data + npoints * sizeof( T );
+}
+
+template< class T >
+void write_values( std::ofstream & output_file, const std::vector< double > & values )
+{
+    std::vector< T > converted( values.begin(), values.end() );
+    if ( ! converted.empty() )
+        output_file.write( reinterpret_cast< const char * >( &converted[0] ), converted.size() * sizeof( T ) );
+}
+
+} // namespace
+
 // ********************************************************************************
 
-PowderPattern::PowderPattern() : wavelength_(1.54056)
+PowderPattern::PowderPattern():
+wavelength_(1.54056),
+constant_two_theta_step_(false),
+noise_is_available_(false)
 {
 }
 
@@ -50,22 +247,89 @@ PowderPattern::PowderPattern() : wavelength_(1.54056)
 
 PowderPattern::PowderPattern( const Angle two_theta_start, const Angle two_theta_end, const Angle two_theta_step ):
 wavelength_(1.54056),
+constant_two_theta_step_(true),
+two_theta_start_(two_theta_start),
+two_theta_step_(two_theta_step),
 noise_is_available_(false)
 {
     size_t npoints = round_to_int( ( (two_theta_end-two_theta_start) / two_theta_step ) ) + 1;
+    intensities_ = std::vector<double>( npoints, 0.0 );
+    estimated_standard_deviations_ = std::vector<double>( npoints, 0.0 );
+    recalculate_weights();
+}
+
+// ********************************************************************************
+
+TwoThetaSegment::TwoThetaSegment( const Angle two_theta_start, const Angle two_theta_end, const Angle two_theta_step ):
+two_theta_start_(two_theta_start),
+two_theta_step_(two_theta_step),
+first_point_(0),
+npoints_( round_to_int( ( (two_theta_end-two_theta_start) / two_theta_step ) ) + 1 )
+{
+}
+
+// ********************************************************************************
+
+PowderPattern::PowderPattern( const std::vector< TwoThetaSegment > & segments ):
+wavelength_(1.54056),
+constant_two_theta_step_(false),
+noise_is_available_(false)
+{
+    if ( segments.size() == 1 )
+    {
+        constant_two_theta_step_ = true;
+        two_theta_start_ = segments[0].two_theta_start_;
+        two_theta_step_ = segments[0].two_theta_step_;
+        intensities_ = std::vector<double>( segments[0].npoints_, 0.0 );
+        estimated_standard_deviations_ = std::vector<double>( segments[0].npoints_, 0.0 );
+        recalculate_weights();
+        return;
+    }
+    size_t npoints( 0 );
+    for ( size_t i( 0 ); i != segments.size(); ++i )
+    {
+        if ( segments[i].two_theta_step_ <= Angle() )
+            throw std::runtime_error( "PowderPattern::PowderPattern( std::vector< TwoThetaSegment > ): 2theta step must be positive." );
+        if ( ( i != 0 ) && ( segments[i].two_theta_start_ <= segments[i-1].two_theta( segments[i-1].npoints_ - 1 ) ) )
+            throw std::runtime_error( "PowderPattern::PowderPattern( std::vector< TwoThetaSegment > ): segments overlap or are not in ascending order." );
+        npoints += segments[i].npoints_;
+    }
     two_theta_values_.reserve( npoints );
-    for ( size_t i( 0 ); i != npoints; ++i )
-        two_theta_values_.push_back( ( i * two_theta_step ) + two_theta_start );
+    for ( size_t i( 0 ); i != segments.size(); ++i )
+    {
+        for ( size_t j( 0 ); j != segments[i].npoints_; ++j )
+            two_theta_values_.push_back( segments[i].two_theta( j ) );
+    }
     intensities_ = std::vector<double>( npoints, 0.0 );
     estimated_standard_deviations_ = std::vector<double>( npoints, 0.0 );
+    recalculate_weights();
 }
 
 // ********************************************************************************
 
 PowderPattern::PowderPattern( const FileName & file_name ):
 wavelength_(1.54056),
+constant_two_theta_step_(false),
 noise_is_available_(false)
 {
+    if ( to_lower( file_name.extension() ) == "ppb" )
+    {
+        read_ppb( file_name );
+        return;
+    }
+    FileName cache_file_name = replace_extension( file_name, "ppb" );
+    if ( is_up_to_date( cache_file_name, file_name ) )
+    {
+        try
+        {
+            read_ppb( cache_file_name );
+            return;
+        }
+        catch ( std::exception & )
+        {
+            // Fall back to the text file
+        }
+    }
     read_xye( file_name );
 }
 
@@ -73,27 +337,33 @@ noise_is_available_(false)
 
 void PowderPattern::reserve( const size_t nvalues )
 {
-    two_theta_values_.reserve( nvalues );
+    if ( ! constant_two_theta_step_ )
+        two_theta_values_.reserve( nvalues );
     intensities_.reserve( nvalues );
     estimated_standard_deviations_.reserve( nvalues );
+    weights_.reserve( nvalues );
 }
 
 // ********************************************************************************
 
 void PowderPattern::push_back( const Angle two_theta, const double intensity )
 {
+    store_two_theta_values();
     two_theta_values_.push_back( two_theta );
     intensities_.push_back( intensity );
-    estimated_standard_deviations_.push_back( std::max( sqrt( intensity ), intensity / 100.0 ) );
+    estimated_standard_deviations_.push_back( default_estimated_standard_deviation( intensity ) );
+    weights_.push_back( 1.0 / square( estimated_standard_deviations_.back() ) );
 }
 
 // ********************************************************************************
 
 void PowderPattern::push_back( const Angle two_theta, const double intensity, const double estimated_standard_deviation )
 {
+    store_two_theta_values();
     two_theta_values_.push_back( two_theta );
     intensities_.push_back( intensity );
     estimated_standard_deviations_.push_back( estimated_standard_deviation );
+    weights_.push_back( 1.0 / square( estimated_standard_deviation ) );
 }
 
 // ********************************************************************************
@@ -165,12 +435,57 @@ size_t PowderPattern::find_two_theta( const Angle two_theta_value ) const
 
 // ********************************************************************************
 
+std::vector< TwoThetaSegment > PowderPattern::two_theta_segments() const
+{
+    std::vector< TwoThetaSegment > result;
+    if ( empty() )
+        return result;
+    if ( constant_two_theta_step_ )
+    {
+        TwoThetaSegment segment;
+        segment.two_theta_start_ = two_theta_start_;
+        segment.two_theta_step_ = two_theta_step_;
+        segment.npoints_ = size();
+        result.push_back( segment );
+        return result;
+    }
+    size_t first( 0 );
+    while ( first != size() )
+    {
+        size_t last( first );
+        if ( first + 1 != size() )
+        {
+            const double step = ( two_theta_values_[first+1] - two_theta_values_[first] ).value_in_degrees();
+            last = first + 1;
+            while ( ( last + 1 != size() ) && ( std::abs( ( two_theta_values_[last+1] - two_theta_values_[last] ).value_in_degrees() - step ) <= 0.01 * std::abs( step ) ) )
+                ++last;
+        }
+        TwoThetaSegment segment;
+        segment.two_theta_start_ = two_theta_values_[first];
+        if ( last != first )
+            segment.two_theta_step_ = ( two_theta_values_[last] - two_theta_values_[first] ) / static_cast<double>( last - first );
+        else if ( first != 0 )
+            segment.two_theta_step_ = two_theta_values_[first] - two_theta_values_[first-1];
+        else
+            segment.two_theta_step_ = Angle::from_degrees( 0.01 );
+        segment.first_point_ = first;
+        segment.npoints_ = last - first + 1;
+        result.push_back( segment );
+        first = last + 1;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
 Angle PowderPattern::average_two_theta_step() const
 {
     if ( empty() )
         throw std::runtime_error( "PowderPattern::average_two_theta_step(): no data points." );
     if ( size() == 1 )
         throw std::runtime_error( "PowderPattern::average_two_theta_step(): only one data point." );
+    if ( constant_two_theta_step_ )
+        return two_theta_step_;
     return ( ( two_theta( size()-1 ) - two_theta( 0 ) ) / ( size() - 1 ) );
 }
 
@@ -180,7 +495,7 @@ Angle PowderPattern::two_theta_start() const
 {
     if ( empty() )
         throw std::runtime_error( "PowderPattern::two_theta_start(): no data points." );
-    return two_theta_values_[ 0 ];
+    return two_theta( 0 );
 }
 
 // ********************************************************************************
@@ -189,7 +504,7 @@ Angle PowderPattern::two_theta_end() const
 {
     if ( empty() )
         throw std::runtime_error( "PowderPattern::two_theta_end(): no data points." );
-    return two_theta_values_[ size()-1 ];
+    return two_theta( size()-1 );
 }
 
 // ********************************************************************************
@@ -208,9 +523,16 @@ void PowderPattern::set_two_theta_end( const Angle two_theta_end ) const
 
 // ********************************************************************************
 
-double PowderPattern::cumulative_intensity() const
+double PowderPattern::cumulative_intensity( const bool compensated_summation ) const
 {
-    return add_doubles( intensities_ );
+    if ( compensated_summation )
+    {
+        CompensatedSum result;
+        for ( size_t i( 0 ); i != size(); ++i )
+            result.add( intensities_[i] );
+        return result.sum();
+    }
+    return add_doubles_unrolled( intensities(), size() );
 }
 
 // ********************************************************************************
@@ -240,12 +562,12 @@ void PowderPattern::read_xye( const FileName & file_name )
 {
     *this = PowderPattern();
     TextFileReader text_file_reader( file_name );
-    std::vector< std::string > words;
+    Tokens words;
     // The first line could contain the wavelength.
     if ( text_file_reader.get_next_line( words ) )
     {
         if ( words.size() == 1 )
-            wavelength_ = string2double( words[0] );
+            wavelength_ = words.to_double( 0 );
         else
             text_file_reader.push_back_last_line();
     }
@@ -255,13 +577,14 @@ void PowderPattern::read_xye( const FileName & file_name )
     {
         if ( ( words.size() < 2 ) || ( words.size() > 3 ) )
             throw std::runtime_error( "PowderPattern::read(): cannot interpret line \"" + text_file_reader.get_line() + "\"" );
-        two_theta_values_.push_back( Angle( string2double( words[0] ), Angle::DEGREES ) );
-        intensities_.push_back( string2double( words[1] ) );
+        two_theta_values_.push_back( Angle( words.to_double( 0 ), Angle::DEGREES ) );
+        intensities_.push_back( words.to_double( 1 ) );
         if ( words.size() == 2 )
             estimated_standard_deviations_.push_back( sqrt( intensities_[two_theta_values_.size()-1] ) );
         else
-            estimated_standard_deviations_.push_back( string2double( words[2] ) );
+            estimated_standard_deviations_.push_back( words.to_double( 2 ) );
     }
+    recalculate_weights();
 }
 
 // ********************************************************************************
@@ -269,26 +592,38 @@ void PowderPattern::read_xye( const FileName & file_name )
 void PowderPattern::read_xrdml( const FileName & file_name )
 {
     *this = PowderPattern();
-    TextFileReader_2 text_file_reader( file_name );
-	size_t iPos = text_file_reader.find( "<positions axis=\"2Theta\" unit=\"deg\">" );
-	if ( iPos == std::string::npos )
+    const std::string contents = read_whole_file( file_name );
+    size_t iPos = contents.find( "<positions axis=\"2Theta\" unit=\"deg\">" );
+    if ( iPos == std::string::npos )
         throw std::runtime_error( "PowderPattern::read_xrdml(): 2theta not found." );
-    std::string two_theta_start_str = extract_delimited_text( text_file_reader.line( iPos + 1 ), "<startPosition>", "</startPosition>");
-    std::string two_theta_end_str   = extract_delimited_text( text_file_reader.line( iPos + 2 ), "<endPosition>", "</endPosition>" );
-    Angle two_theta_start = Angle::from_degrees( string2double( two_theta_start_str ) );
-    Angle two_theta_end   = Angle::from_degrees( string2double( two_theta_end_str   ) );
-	iPos = text_file_reader.find( "<intensities unit=\"counts\">" );
-	if ( iPos == std::string::npos )
+    Angle two_theta_start = Angle::from_degrees( parse_double_after( contents, "<startPosition>", iPos, "PowderPattern::read_xrdml()" ) );
+    Angle two_theta_end   = Angle::from_degrees( parse_double_after( contents, "<endPosition>"  , iPos, "PowderPattern::read_xrdml()" ) );
+    const std::string intensities_tag( "<intensities unit=\"counts\">" );
+    iPos = contents.find( intensities_tag );
+    if ( iPos == std::string::npos )
         throw std::runtime_error( "PowderPattern::read_xrdml(): Counts not found." );
-    std::vector< std::string > counts = split( extract_delimited_text( text_file_reader.line( iPos ), "<intensities unit=\"counts\">", "</intensities>" ) );
+    size_t iPos2 = contents.find( "</intensities>", iPos );
+    if ( iPos2 == std::string::npos )
+        throw std::runtime_error( "PowderPattern::read_xrdml(): end of counts not found." );
+    // The counts are parsed straight from the file contents
+    const char * begin = contents.data() + iPos + intensities_tag.size();
+    const char * end = contents.data() + iPos2;
+    std::vector< double > counts;
+    double value;
+    while ( parse_double( begin, end, value ) )
+        counts.push_back( value );
+    while ( ( begin != end ) && is_white_space( *begin ) )
+        ++begin;
+    if ( begin != end )
+        throw std::runtime_error( "PowderPattern::read_xrdml(): cannot interpret counts." );
     if ( counts.empty() )
         throw std::runtime_error( "PowderPattern::read_xrdml(): no data points." );
     if ( counts.size() == 1 )
         throw std::runtime_error( "PowderPattern::read_xrdml(): only one data point." );
+    if ( two_theta_end == two_theta_start )
+        throw std::runtime_error( "PowderPattern::read_xrdml(): 2theta range is zero." );
     Angle two_theta_step = ( two_theta_end - two_theta_start ) / ( counts.size() - 1 );
-    reserve( counts.size() );
-    for ( size_t i( 0 ); i != counts.size(); ++i )
-        push_back( ( i * two_theta_step ) + two_theta_start, string2double( counts[i] ) );
+    set_constant_two_theta_step_data( two_theta_start, two_theta_step, counts, std::vector< double >() );
 }
 
 // ********************************************************************************
@@ -302,13 +637,16 @@ void PowderPattern::read_raw( const FileName & file_name )
 {
     *this = PowderPattern();
     // This is lab data (is that always true?), the wavelength is fine.
-    TextFileReader text_file_reader( file_name );
-    text_file_reader.set_skip_empty_lines( false );
-    std::vector< std::string > words;
-    if ( ! text_file_reader.get_next_line( words ) )
-        throw std::runtime_error( "PowderPattern::read_raw(): File is empty." );
-    if ( ! text_file_reader.get_next_line( words ) )
+    const std::string contents = read_whole_file( file_name );
+    const char * iPos = contents.data();
+    const char * end = contents.data() + contents.size();
+    // The first line is the title
+    iPos = std::find( iPos, end, '\n' );
+    if ( iPos == end )
         throw std::runtime_error( "PowderPattern::read_raw(): File is empty." );
+    ++iPos;
+    const char * end_of_line = std::find( iPos, end, '\n' );
+    std::vector< std::string > words = split( std::string( iPos, end_of_line ) );
     if ( words.size() != 10 )
         throw std::runtime_error( "PowderPattern::read_raw(): unexpected format 1." );
     if ( words[0] != "BANK" )
@@ -325,48 +663,48 @@ void PowderPattern::read_raw( const FileName & file_name )
         throw std::runtime_error( "PowderPattern::read_raw(): No data." );
     Angle two_theta_start = Angle::from_degrees( string2double( words[5] ) / 100.0 );
     Angle two_theta_step = Angle::from_degrees( string2double( words[6] ) / 100.0 );
-    size_t i( 0 );
-    std::string line;
-    Splitter splitter;
-    splitter.split_by_length( 8 );
-    while ( text_file_reader.get_next_line( line ) )
-    {
-        std::vector< std::string > temp_words = splitter.split( line );
-        words.clear();
-        bool one_word_was_empty( false );
-        for ( size_t j( 0 ); j != temp_words.size(); ++j )
-        {
-            temp_words[j] = strip( temp_words[j] );
-            if ( temp_words[j].empty() )
-                one_word_was_empty = true;
-            else
-            {
-                if ( one_word_was_empty )
-                    throw std::runtime_error( "PowderPattern::read_raw(): non-empty word after empty word." );
-                words.push_back( temp_words[j] );
-            }
-        }
-        if ( read_ESDs )
-        {
-            if ( is_odd( words.size() ) )
-                throw std::runtime_error( "PowderPattern::read_raw(): intensities plus ESDs stored, but number of values is odd." );
-            for ( size_t j( 0 ); j != words.size(); j += 2 )
-            {
-                push_back( ( i * two_theta_step ) + two_theta_start, string2double( words[j] ), string2double( words[j+1] ) );
-                ++i;
-            }
-        }
-        else
+    std::vector< double > intensities;
+    std::vector< double > estimated_standard_deviations;
+    intensities.reserve( ndata_points );
+    if ( read_ESDs )
+        estimated_standard_deviations.reserve( ndata_points );
+    // The data are in fields of eight characters, parsed in place
+    while ( end_of_line != end )
+    {
+        iPos = end_of_line + 1;
+        end_of_line = std::find( iPos, end, '\n' );
+        const char * end_of_data = end_of_line;
+        if ( ( end_of_data != iPos ) && ( *( end_of_data - 1 ) == '\r' ) )
+            --end_of_data;
+        size_t nvalues( 0 );
+        bool one_field_was_empty( false );
+        for ( const char * field = iPos; field < end_of_data; field += 8 )
         {
-            for ( size_t j( 0 ); j != words.size(); ++j )
+            const char * end_of_field = std::min( field + 8, end_of_data );
+            const char * first_character = field;
+            while ( ( first_character != end_of_field ) && is_white_space( *first_character ) )
+                ++first_character;
+            if ( first_character == end_of_field )
             {
-                push_back( ( i * two_theta_step ) + two_theta_start, string2double( words[j] ) );
-                ++i;
+                one_field_was_empty = true;
+                continue;
             }
+            if ( one_field_was_empty )
+                throw std::runtime_error( "PowderPattern::read_raw(): non-empty word after empty word." );
+            double value = parse_field( field, end_of_field, "PowderPattern::read_raw()" );
+            if ( read_ESDs && is_odd( nvalues ) )
+                estimated_standard_deviations.push_back( value );
+            else
+                intensities.push_back( value );
+            ++nvalues;
         }
+        if ( read_ESDs && is_odd( nvalues ) )
+            throw std::runtime_error( "PowderPattern::read_raw(): intensities plus ESDs stored, but number of values is odd." );
     }
-    if ( i != ndata_points )
-        std::cout << "PowderPattern::read_raw(): Warning: the number of data points in the file disagrees with the number in the header." << std::endl;
+    if ( intensities.size() != ndata_points )
+        log_warning( "PowderPattern::read_raw(): Warning: the number of data points in the file disagrees with the number in the header." );
+    if ( ! intensities.empty() )
+        set_constant_two_theta_step_data( two_theta_start, two_theta_step, intensities, estimated_standard_deviations );
 }
 
 // ********************************************************************************
@@ -421,7 +759,7 @@ void PowderPattern::read_mdi( const FileName & file_name )
         }
     }
     if ( i != ndata_points )
-        std::cout << "PowderPattern::read_mdi(): Warning: the number of data points in the file (" + size_t2string( i ) + ") disagrees with the number in the header (" + size_t2string( ndata_points ) + ")." << std::endl;
+        log_warning( "PowderPattern::read_mdi(): Warning: the number of data points in the file (" + size_t2string( i ) + ") disagrees with the number in the header (" + size_t2string( ndata_points ) + ")." );
     else
         std::cout << "PowderPattern::read_mdi(): the number of data points in the file (" + size_t2string( i ) + ") agrees with the number in the header (" + size_t2string( ndata_points ) + ")." << std::endl;
     std::cout << "PowderPattern::read_mdi(): two_theta_end as calculated     = " << ( i * two_theta_step ) + two_theta_start << std::endl;
@@ -440,19 +778,42 @@ void PowderPattern::read_brml( const FileName & file_name )
 {
     *this = PowderPattern();
     // This is lab data (is that always true?), the wavelength is fine.
-    TextFileReader text_file_reader( file_name );
-    text_file_reader.set_skip_empty_lines( false );
-    Splitter splitter( "," );
-    std::string line;
-    while ( text_file_reader.get_next_line( line ) )
+    const std::string contents = read_whole_file( file_name );
+    const char * iPos = contents.data();
+    const char * end = contents.data() + contents.size();
+    const std::string datum_tag( "<DATUM>" );
+    while ( true )
     {
-        line = strip( line );
-        line = to_upper( line );
-        if ( line.substr( 0, 7 ) != "<DATUM>" )
+        iPos = std::find( iPos, end, '<' );
+        if ( iPos == end )
+            break;
+        // The tag is compared case-insensitively
+        size_t i( 0 );
+        while ( ( i != datum_tag.size() ) && ( iPos + i != end ) && ( to_upper( iPos[i] ) == datum_tag[i] ) )
+            ++i;
+        if ( i != datum_tag.size() )
+        {
+            ++iPos;
             continue;
-        line = extract_delimited_text( line, "<DATUM>", "</DATUM>" );
-        std::vector< std::string > words = splitter.split( line );
-        push_back( Angle::from_degrees( string2double( words[2] ) ), string2double( words[4] ) );
+        }
+        iPos += datum_tag.size();
+        const char * end_of_datum = std::find( iPos, end, '<' );
+        // Five comma-separated fields, the third is 2theta and the fifth is the intensity
+        const char * fields[6];
+        fields[0] = iPos;
+        size_t nfields( 1 );
+        for ( const char * c = iPos; ( c != end_of_datum ) && ( nfields != 6 ); ++c )
+        {
+            if ( *c == ',' )
+                fields[nfields++] = c + 1;
+        }
+        if ( nfields < 5 )
+            throw std::runtime_error( "PowderPattern::read_brml(): cannot interpret datum \"" + std::string( iPos, end_of_datum ) + "\"" );
+        const char * end_of_fifth_field = ( nfields == 6 ) ? fields[5] - 1 : end_of_datum;
+        double two_theta = parse_field( fields[2], fields[3] - 1, "PowderPattern::read_brml()" );
+        double intensity = parse_field( fields[4], end_of_fifth_field, "PowderPattern::read_brml()" );
+        push_back( Angle::from_degrees( two_theta ), intensity );
+        iPos = end_of_datum;
     }
 }
 
@@ -506,13 +867,110 @@ void PowderPattern::read_txt( const FileName & file_name )
 
 // ********************************************************************************
 
+void PowderPattern::read_ppb( const FileName & file_name )
+{
+    *this = PowderPattern();
+    std::vector< char > contents;
+    if ( ! read_binary_file( file_name, contents ) )
+        throw std::runtime_error( "PowderPattern::read_ppb(): Could not open file " + file_name.full_name() );
+    if ( ( contents.size() < ppb_header_size ) || ( std::memcmp( &contents[0], ppb_magic, 8 ) != 0 ) )
+        throw std::runtime_error( "PowderPattern::read_ppb(): file is not a .ppb file " + file_name.full_name() );
+    unsigned long long npoints;
+    unsigned long long single_precision;
+    unsigned long long constant_two_theta_step;
+    double two_theta_start;
+    double two_theta_step;
+    std::memcpy( &npoints                , &contents[ 8], 8 );
+    std::memcpy( &single_precision       , &contents[16], 8 );
+    std::memcpy( &constant_two_theta_step, &contents[24], 8 );
+    std::memcpy( &wavelength_            , &contents[32], 8 );
+    std::memcpy( &two_theta_start        , &contents[40], 8 );
+    std::memcpy( &two_theta_step         , &contents[48], 8 );
+    const size_t value_size = single_precision ? sizeof( float ) : sizeof( double );
+    const size_t expected_size = ppb_header_size + ( constant_two_theta_step ? 0 : npoints * sizeof( double ) ) + 2 * npoints * value_size;
+    if ( contents.size() != expected_size )
+        throw std::runtime_error( "PowderPattern::read_ppb(): file has the wrong size " + file_name.full_name() );
+    const char * data = &contents[0] + ppb_header_size;
+    if ( ! constant_two_theta_step )
+    {
+        std::vector< double > two_theta_values;
+        data = read_values< double >( data, npoints, two_theta_values );
+        two_theta_values_.reserve( npoints );
+        for ( size_t i( 0 ); i != npoints; ++i )
+            two_theta_values_.push_back( Angle::from_radians( two_theta_values[i] ) );
+    }
+    else
+    {
+        constant_two_theta_step_ = true;
+        two_theta_start_ = Angle::from_radians( two_theta_start );
+        two_theta_step_ = Angle::from_radians( two_theta_step );
+    }
+    if ( single_precision )
+    {
+        data = read_values< float >( data, npoints, intensities_ );
+        data = read_values< float >( data, npoints, estimated_standard_deviations_ );
+    }
+    else
+    {
+        data = read_values< double >( data, npoints, intensities_ );
+        data = read_values< double >( data, npoints, estimated_standard_deviations_ );
+    }
+    recalculate_weights();
+}
+
+// ********************************************************************************
+
+void PowderPattern::save_ppb( const FileName & file_name, const bool single_precision ) const
+{
+    std::ofstream output_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! output_file )
+        throw std::runtime_error( "PowderPattern::save_ppb(): Could not open file " + file_name.full_name() );
+    char header[ ppb_header_size ];
+    std::memset( header, 0, ppb_header_size );
+    std::memcpy( header, ppb_magic, 8 );
+    unsigned long long value = size();
+    std::memcpy( header + 8, &value, 8 );
+    value = single_precision ? 1 : 0;
+    std::memcpy( header + 16, &value, 8 );
+    value = constant_two_theta_step_ ? 1 : 0;
+    std::memcpy( header + 24, &value, 8 );
+    std::memcpy( header + 32, &wavelength_, 8 );
+    double two_theta_start = constant_two_theta_step_ ? two_theta_start_.value_in_radians() : 0.0;
+    double two_theta_step = constant_two_theta_step_ ? two_theta_step_.value_in_radians() : 0.0;
+    std::memcpy( header + 40, &two_theta_start, 8 );
+    std::memcpy( header + 48, &two_theta_step, 8 );
+    output_file.write( header, ppb_header_size );
+    if ( ! constant_two_theta_step_ )
+    {
+        std::vector< double > two_theta_values;
+        two_theta_values.reserve( size() );
+        for ( size_t i( 0 ); i != size(); ++i )
+            two_theta_values.push_back( two_theta_values_[i].value_in_radians() );
+        write_values< double >( output_file, two_theta_values );
+    }
+    if ( single_precision )
+    {
+        write_values< float >( output_file, intensities_ );
+        write_values< float >( output_file, estimated_standard_deviations_ );
+    }
+    else
+    {
+        write_values< double >( output_file, intensities_ );
+        write_values< double >( output_file, estimated_standard_deviations_ );
+    }
+    if ( ! output_file )
+        throw std::runtime_error( "PowderPattern::save_ppb(): error writing file " + file_name.full_name() );
+}
+
+// ********************************************************************************
+
 void PowderPattern::save_xye( const FileName & file_name, const bool include_wave_length ) const
 {
     TextFileWriter text_file_writer( file_name );
     if ( include_wave_length )
         text_file_writer.write_line( double2string( wavelength_ ) );
     for ( size_t i( 0 ); i != size(); ++i )
-        text_file_writer.write_line( double2string( two_theta_values_[i].value_in_degrees() ) + "  " + double2string( intensities_[i] ) + "  " + double2string( estimated_standard_deviations_[i] ) );
+        text_file_writer.write_line( double2string( two_theta( i ).value_in_degrees() ) + "  " + double2string( intensities_[i] ) + "  " + double2string( estimated_standard_deviations_[i] ) );
 }
 
 // ********************************************************************************
@@ -539,8 +997,11 @@ PowderPattern & PowderPattern::operator+=( const PowderPattern & rhs )
 {
     if ( ! same_range( *this, rhs ) )
         throw std::runtime_error( "PowderPattern::operator+=( const PowderPattern & ): ranges not same." );
-    for ( size_t i( 0 ); i != size(); ++i )
-        intensities_[i] += rhs.intensities_[i];
+    double * lhs_intensities = intensities();
+    const double * rhs_intensities = rhs.intensities();
+    const size_t npoints = size();
+    for ( size_t i( 0 ); i != npoints; ++i )
+        lhs_intensities[i] += rhs_intensities[i];
     return *this;
 }
 
@@ -551,8 +1012,11 @@ PowderPattern & PowderPattern::operator-=( const PowderPattern & rhs )
 {
     if ( ! same_range( *this, rhs ) )
         throw std::runtime_error( "PowderPattern::operator-=( const PowderPattern & ): ranges not same." );
-    for ( size_t i( 0 ); i != size(); ++i )
-        intensities_[i] -= rhs.intensities_[i];
+    double * lhs_intensities = intensities();
+    const double * rhs_intensities = rhs.intensities();
+    const size_t npoints = size();
+    for ( size_t i( 0 ); i != npoints; ++i )
+        lhs_intensities[i] -= rhs_intensities[i];
     return *this;
 }
 
@@ -560,19 +1024,30 @@ PowderPattern & PowderPattern::operator-=( const PowderPattern & rhs )
 
 void PowderPattern::normalise_highest_peak( const double highest_peak )
 {
-    // Find the highest intensity
-    double max_intensity( 0.0 );
-    for ( size_t i( 0 ); i != size(); ++i )
+    // Find the highest intensity, four independent maxima so that the loop can be vectorised
+    double * values = intensities();
+    const size_t npoints = size();
+    double max_0( 0.0 );
+    double max_1( 0.0 );
+    double max_2( 0.0 );
+    double max_3( 0.0 );
+    size_t i( 0 );
+    for ( ; i + 4 <= npoints; i += 4 )
     {
-        if ( max_intensity < intensities_[i] )
-            max_intensity = intensities_[i];
+        max_0 = std::max( max_0, values[i  ] );
+        max_1 = std::max( max_1, values[i+1] );
+        max_2 = std::max( max_2, values[i+2] );
+        max_3 = std::max( max_3, values[i+3] );
     }
+    for ( ; i != npoints; ++i )
+        max_0 = std::max( max_0, values[i] );
+    double max_intensity = std::max( std::max( max_0, max_1 ), std::max( max_2, max_3 ) );
     if ( nearly_equal( max_intensity, 0.0 ) )
         throw std::runtime_error( "PowderPattern::normalise_highest_peak(): highest peak is 0.0." );
     // Scale to highest_peak
     double scale( highest_peak / max_intensity );
-    for ( size_t i( 0 ); i != size(); ++i )
-        intensities_[i] *= scale;
+    for ( i = 0; i != npoints; ++i )
+        values[i] *= scale;
 }
 
 // ********************************************************************************
@@ -593,6 +1068,11 @@ void PowderPattern::normalise_total_signal( const double total_signal )
 
 void PowderPattern::correct_zero_point_error( const Angle two_theta_value )
 {
+    if ( constant_two_theta_step_ )
+    {
+        two_theta_start_ -= two_theta_value;
+        return;
+    }
     for ( size_t i( 0 ); i != size(); ++i )
         two_theta_values_[i] -= two_theta_value;
 }
@@ -616,6 +1096,7 @@ void PowderPattern::recalculate_estimated_standard_deviations()
             estimated_standard_deviations_[i] = sqrt( intensities_[i] );
         }
     }
+    recalculate_weights();
 }
 
 // ********************************************************************************
@@ -625,9 +1106,10 @@ void PowderPattern::convert_to_fixed_slit()
 {
     for ( size_t i( 0 ); i != size(); ++i )
     {
-        intensities_[i] = intensities_[i] / ( two_theta_values_[i] / 2.0 ).sine(); // @@ We should check for divide by zero
-        estimated_standard_deviations_[i] = estimated_standard_deviations_[i] / ( two_theta_values_[i] / 2.0 ).sine();
+        intensities_[i] = intensities_[i] / ( two_theta( i ) / 2.0 ).sine(); // @@ We should check for divide by zero
+        estimated_standard_deviations_[i] = estimated_standard_deviations_[i] / ( two_theta( i ) / 2.0 ).sine();
     }
+    recalculate_weights();
 }
 
 // ********************************************************************************
@@ -637,9 +1119,10 @@ void PowderPattern::convert_to_variable_slit()
 {
     for ( size_t i( 0 ); i != size(); ++i )
     {
-        intensities_[i] = intensities_[i] * ( two_theta_values_[i] / 2.0 ).sine();
-        estimated_standard_deviations_[i] = estimated_standard_deviations_[i] * ( two_theta_values_[i] / 2.0 ).sine();
+        intensities_[i] = intensities_[i] * ( two_theta( i ) / 2.0 ).sine();
+        estimated_standard_deviations_[i] = estimated_standard_deviations_[i] * ( two_theta( i ) / 2.0 ).sine();
     }
+    recalculate_weights();
 }
 
 // ********************************************************************************
@@ -665,6 +1148,35 @@ void PowderPattern::add_Poisson_noise()
 
 // ********************************************************************************
 
+void PowderPattern::add_Poisson_noise( NoiseGenerator & noise_generator )
+{
+    // The means are rounded as in add_Poisson_noise()
+    std::vector< double > means( size() );
+    for ( size_t i( 0 ); i != size(); ++i )
+        means[i] = std::max( 0, round_to_int( intensities_[i] ) );
+    noise_generator.Poisson( means, means );
+    noise_.resize( size() );
+    for ( size_t i( 0 ); i != size(); ++i )
+    {
+        noise_[i] = means[i] - intensities_[i];
+        intensities_[i] = means[i];
+    }
+    noise_is_available_ = true;
+}
+
+// ********************************************************************************
+
+void add_Poisson_noise( std::vector< PowderPattern > & powder_patterns, const uint64_t seed, const size_t nthreads )
+{
+    parallel_for( powder_patterns.size(), nthreads, [&]( const size_t i )
+    {
+        NoiseGenerator noise_generator( seed, i );
+        powder_patterns[i].add_Poisson_noise( noise_generator );
+    } );
+}
+
+// ********************************************************************************
+
 // Check that the two patterns have the same range and 2theta step
 bool same_range( const PowderPattern & lhs, const PowderPattern & rhs )
 {
@@ -678,53 +1190,211 @@ bool same_range( const PowderPattern & lhs, const PowderPattern & rhs )
 
 // ********************************************************************************
 
-double weighted_cross_correlation( const PowderPattern & lhs, const PowderPattern & rhs, Angle l )
+std::vector< double > intensities_over_ESDs( const PowderPattern & powder_pattern )
 {
-    int m = round_to_int( l / lhs.average_two_theta_step() );
+    const size_t npoints = powder_pattern.size();
+    std::vector< double > result( npoints );
+    const double * intensities = powder_pattern.intensities();
+    const double * estimated_standard_deviations = powder_pattern.estimated_standard_deviations();
+    for ( size_t i( 0 ); i != npoints; ++i )
+        result[i] = intensities[i] / estimated_standard_deviations[i];
+    return result;
+}
+
+// ********************************************************************************
+
+int weighted_cross_correlation_window( const PowderPattern & powder_pattern, const Angle l )
+{
+    int m = round_to_int( l / powder_pattern.average_two_theta_step() );
     if ( m == 0 )
         m = 1;
+    return m;
+}
+
+// ********************************************************************************
+
+// The triangle is the convolution of two boxes of width m divided by m: sum_j ( 1 - |j|/m ) values[i+j] = (1/m) sum_s sum_t values[i+s-t],
+// with s and t running from 0 to m-1, so it is calculated with two running box sums.
+namespace
+{
+
+// The running sums are always in double, the sliding sums would otherwise drift.
+template< typename T >
+void triangle_filter_implementation( const T * values, const size_t npoints, const int m, T * result )
+{
+    const int n = static_cast<int>( npoints );
+    // box[k] = sum_t values[k-t] for k = 0 ... n+m-2, values is 0.0 outside [0,n>
+    std::vector< double > box( n + m - 1 );
+    double sum( 0.0 );
+    for ( int k( 0 ); k != n + m - 1; ++k )
+    {
+        if ( k < n )
+            sum += values[k];
+        if ( ( k - m >= 0 ) && ( k - m < n ) )
+            sum -= values[k-m];
+        box[k] = sum;
+    }
+    // sum_s box[i+s]
+    sum = 0.0;
+    for ( int k( 0 ); k != std::min( m, n + m - 1 ); ++k )
+        sum += box[k];
+    for ( int i( 0 ); i != n; ++i )
+    {
+        result[i] = static_cast< T >( sum / m );
+        sum -= box[i];
+        if ( i + m < n + m - 1 )
+            sum += box[i+m];
+    }
+}
+
+} // namespace
+
+// ********************************************************************************
+
+void triangle_filter( const double * values, const size_t npoints, const int m, double * result )
+{
+    triangle_filter_implementation( values, npoints, m, result );
+}
+
+// ********************************************************************************
+
+void triangle_filter( const float * values, const size_t npoints, const int m, float * result )
+{
+    triangle_filter_implementation( values, npoints, m, result );
+}
+
+// ********************************************************************************
+
+double weighted_cross_correlation( const double * lhs, const double * rhs, const size_t npoints, const int m )
+{
+    std::vector< double > filtered_rhs( npoints );
+    triangle_filter( rhs, npoints, m, &filtered_rhs[0] );
+    return dot_product( lhs, &filtered_rhs[0], npoints );
+}
+
+// ********************************************************************************
+
+double weighted_cross_correlation( const float * lhs, const float * rhs, const size_t npoints, const int m )
+{
+    std::vector< float > filtered_rhs( npoints );
+    triangle_filter( rhs, npoints, m, &filtered_rhs[0] );
+    return dot_product( lhs, &filtered_rhs[0], npoints );
+}
+
+// ********************************************************************************
+
+double dot_product( const double * lhs, const double * rhs, const size_t n )
+{
+    double result( 0.0 );
+    for ( size_t k( 0 ); k != n; ++k )
+        result += lhs[k] * rhs[k];
+    return result;
+}
+
+// ********************************************************************************
+
+double dot_product( const float * lhs, const float * rhs, const size_t n )
+{
+    const size_t block_size = 16;
     double result( 0.0 );
-    for ( int i( 0 ); i != lhs.size(); ++i )
+    size_t k( 0 );
+    for ( ; k + block_size <= n; k += block_size )
     {
-        for ( int j( -m + 1 ); j != m; ++j )
-        {
-            if ( ( ( i + j ) >= 0 ) && ( ( i + j ) < lhs.size() ) )
-            {
-                if ( (false) )
-                    result += (1.0-static_cast<double>(abs(j))/m) * lhs.intensity( i ) * rhs.intensity( i + j );
-                else
-                    result += (1.0-static_cast<double>(abs(j))/m) * ( lhs.intensity( i ) / lhs.estimated_standard_deviation( i ) ) * ( rhs.intensity( i + j ) / rhs.estimated_standard_deviation( i + j ) );
-            }
-        }
+        float block_sum( 0.0f );
+        for ( size_t t( 0 ); t != block_size; ++t )
+            block_sum += lhs[k+t] * rhs[k+t];
+        result += block_sum;
     }
+    for ( ; k != n; ++k )
+        result += static_cast< double >( lhs[k] ) * rhs[k];
     return result;
 }
 
 // ********************************************************************************
 
+double weighted_cross_correlation( const PowderPattern & lhs, const PowderPattern & rhs, Angle l )
+{
+    if ( rhs.size() < lhs.size() )
+        throw std::runtime_error( "weighted_cross_correlation( const PowderPattern &, const PowderPattern & ): right-hand side has fewer points" );
+    if ( lhs.empty() )
+        return 0.0;
+    std::vector< double > lhs_over_ESDs = intensities_over_ESDs( lhs );
+    std::vector< double > rhs_over_ESDs = intensities_over_ESDs( rhs );
+    return weighted_cross_correlation( &lhs_over_ESDs[0], &rhs_over_ESDs[0], lhs.size(), weighted_cross_correlation_window( lhs, l ) );
+}
+
+// ********************************************************************************
+
 double normalised_weighted_cross_correlation( const PowderPattern & lhs, const PowderPattern & rhs, Angle l )
 {
     if ( ! same_range( lhs, rhs ) )
         throw std::runtime_error( "normalised_weighted_cross_correlation( const PowderPattern &, const PowderPattern & ): ranges not same" );
-    return weighted_cross_correlation( lhs, rhs, l ) / sqrt( weighted_cross_correlation( lhs, lhs, l ) * weighted_cross_correlation( rhs, rhs, l ) );
+    if ( lhs.empty() )
+        throw std::runtime_error( "normalised_weighted_cross_correlation( const PowderPattern &, const PowderPattern & ): patterns are empty" );
+    std::vector< double > lhs_over_ESDs = intensities_over_ESDs( lhs );
+    std::vector< double > rhs_over_ESDs = intensities_over_ESDs( rhs );
+    const int m = weighted_cross_correlation_window( lhs, l );
+    return weighted_cross_correlation( &lhs_over_ESDs[0], &rhs_over_ESDs[0], lhs.size(), m ) /
+           sqrt( weighted_cross_correlation( &lhs_over_ESDs[0], &lhs_over_ESDs[0], lhs.size(), m ) * weighted_cross_correlation( &rhs_over_ESDs[0], &rhs_over_ESDs[0], lhs.size(), m ) );
 }
 
 // ********************************************************************************
 
-double Rwp( const PowderPattern & lhs, const PowderPattern & rhs )
+double Rwp( const PowderPattern & lhs, const PowderPattern & rhs, const bool compensated_summation )
 {
-    double numerator( 0.0 );
-    double denominator( 0.0 );
-    for ( size_t i( 0 ); i != lhs.size(); ++i )
+    const size_t npoints = lhs.size();
+    const double * lhs_intensities = lhs.intensities();
+    const double * rhs_intensities = rhs.intensities();
+    const double * weights = lhs.weights();
+    if ( compensated_summation )
     {
-        numerator   += square( lhs.intensity( i ) - rhs.intensity( i ) ) / square( lhs.estimated_standard_deviation( i ) );
-        denominator += square( lhs.intensity( i ) ) / square( lhs.estimated_standard_deviation( i ) );
+        CompensatedSum numerator;
+        CompensatedSum denominator;
+        for ( size_t i( 0 ); i != npoints; ++i )
+        {
+            numerator.add( square( lhs_intensities[i] - rhs_intensities[i] ) * weights[i] );
+            denominator.add( square( lhs_intensities[i] ) * weights[i] );
+        }
+        return sqrt( numerator.sum() / denominator.sum() );
+    }
+    // Two independent partial sums each, so that the additions need not wait for each other and can be vectorised
+    double numerator_0( 0.0 );
+    double numerator_1( 0.0 );
+    double denominator_0( 0.0 );
+    double denominator_1( 0.0 );
+    size_t i( 0 );
+    for ( ; i + 2 <= npoints; i += 2 )
+    {
+        numerator_0   += square( lhs_intensities[i  ] - rhs_intensities[i  ] ) * weights[i  ];
+        numerator_1   += square( lhs_intensities[i+1] - rhs_intensities[i+1] ) * weights[i+1];
+        denominator_0 += square( lhs_intensities[i  ] ) * weights[i  ];
+        denominator_1 += square( lhs_intensities[i+1] ) * weights[i+1];
     }
-    return sqrt( numerator / denominator );
+    for ( ; i != npoints; ++i )
+    {
+        numerator_0   += square( lhs_intensities[i] - rhs_intensities[i] ) * weights[i];
+        denominator_0 += square( lhs_intensities[i] ) * weights[i];
+    }
+    return sqrt( ( numerator_0 + numerator_1 ) / ( denominator_0 + denominator_1 ) );
 }
 
 // ********************************************************************************
 
+namespace
+{
+
+// padded holds the n values starting at position w, the w positions on either side are filled with the first and last value.
+void fill_padding( std::vector< double > & padded, const size_t n, const size_t w )
+{
+    for ( size_t j( 0 ); j != w; ++j )
+    {
+        padded[j] = padded[w];
+        padded[w+n+j] = padded[w+n-1];
+    }
+}
+
+} // namespace
+
 PowderPattern calculate_Brueckner_background( const PowderPattern & powder_pattern,
                                               const size_t niterations,
                                               const size_t window,
@@ -733,55 +1403,82 @@ PowderPattern calculate_Brueckner_background( const PowderPattern & powder_patte
 {
     if ( powder_pattern.size() == 0 )
         return powder_pattern;
-    PowderPattern pp_new( powder_pattern );
-    size_t size( powder_pattern.size() );
+    const size_t size( powder_pattern.size() );
+    // Two buffers, each padded with window copies of the end points so that the window never needs to be clamped
+    const size_t padding = std::max( window, apply_smoothing ? smoothing_window : 0 );
+    std::vector< double > current( size + 2 * padding );
+    std::vector< double > next( size + 2 * padding );
+    for ( size_t i( 0 ); i < size; ++i )
+        current[padding+i] = powder_pattern.intensity( i );
     if ( apply_smoothing )
     {
+        fill_padding( current, size, padding );
+        // Running sum over the 2*smoothing_window+1 points centred on i
+        const size_t offset = padding - smoothing_window;
+        double sum( 0.0 );
+        for ( size_t j( 0 ); j < 2 * smoothing_window + 1; ++j )
+            sum += current[offset+j];
         for ( size_t i( 0 ); i < size; ++i )
         {
-            double new_value = powder_pattern.intensity( i );
-            for ( size_t j( 1 ); j <= smoothing_window; ++j )
-            {
-                new_value += powder_pattern.intensity( std::max( int(i)-int(j), int(0) ) );
-                new_value += powder_pattern.intensity( std::min( i+j, size-1 ) );
-            }
-            pp_new.set_intensity( i, new_value / ( 2.0 * smoothing_window + 1.0 ) );
+            next[padding+i] = sum / ( 2.0 * smoothing_window + 1.0 );
+            if ( i + 1 < size )
+                sum += current[offset+i+2*smoothing_window+1] - current[offset+i];
         }
+        current.swap( next );
     }
     if ( true )
     {
         RunningAverageAndESD<double> I_average;
-        double I_minimum = pp_new.intensity( 0 );
+        double I_minimum = current[padding];
         for ( size_t i( 0 ); i < size; ++i )
         {
-            if ( pp_new.intensity( i ) < I_minimum )
-                I_minimum = pp_new.intensity( i );
-            I_average.add_value( pp_new.intensity( i ) );
+            if ( current[padding+i] < I_minimum )
+                I_minimum = current[padding+i];
+            I_average.add_value( current[padding+i] );
         }
+        const double I_maximum = I_average.average() + 2.0 * ( I_average.average() - I_minimum );
         for ( size_t i( 0 ); i < size; ++i )
         {
-            if ( pp_new.intensity( i ) > ( I_average.average() + 2.0 * ( I_average.average() - I_minimum ) ) )
-                pp_new.set_intensity( i, ( I_average.average() + 2.0 * ( I_average.average() - I_minimum ) ) );
+            if ( current[padding+i] > I_maximum )
+                current[padding+i] = I_maximum;
         }
     }
+    // Running sum over the 2*window+1 points centred on i, minus the point itself
+    const size_t offset = padding - window;
     for ( size_t iter( 0 ); iter < niterations; ++iter )
     {
-        PowderPattern pp_old = pp_new;
+        fill_padding( current, size, padding );
+        double sum( 0.0 );
+        for ( size_t j( 0 ); j < 2 * window + 1; ++j )
+            sum += current[offset+j];
         for ( size_t i( 0 ); i < size; ++i )
         {
-            double average_value( 0.0 );
-            for ( size_t j( 1 ); j <= window; ++j )
-            {
-                average_value += pp_old.intensity( std::max( int(i)-int(j), int(0) ) );
-                average_value += pp_old.intensity( std::min( i+j, size-1 ) );
-            }
-            average_value /= 2.0 * window;
-            pp_new.set_intensity( i, average_value );
+            const double average_value = ( sum - current[padding+i] ) / ( 2.0 * window );
+            next[padding+i] = std::min( current[padding+i], average_value );
+            if ( i + 1 < size )
+                sum += current[offset+i+2*window+1] - current[offset+i];
         }
-        for ( size_t i( 0 ); i < size; ++i )
-            pp_new.set_intensity( i, std::min( pp_old.intensity( i ), pp_new.intensity( i ) ) );
+        current.swap( next );
     }
-    return pp_new;
+    PowderPattern result( powder_pattern );
+    for ( size_t i( 0 ); i < size; ++i )
+        result.set_intensity( i, current[padding+i] );
+    return result;
+}
+
+// ********************************************************************************
+
+void build_ppb_caches( const FileList & file_list, const bool single_precision, const size_t nthreads )
+{
+    parallel_for( file_list.size(), nthreads, [&]( const size_t i )
+    {
+        FileName cache_file_name = replace_extension( file_list.value( i ), "ppb" );
+        if ( is_up_to_date( cache_file_name, file_list.value( i ) ) )
+            return;
+        PowderPattern powder_pattern;
+        powder_pattern.read_xye( file_list.value( i ) );
+        powder_pattern.save_ppb( cache_file_name, single_precision );
+    } );
 }
 
 // ********************************************************************************
@@ -833,7 +1530,7 @@ PowderPattern add_powder_patterns( const std::vector< PowderPattern > & powder_p
             result.set_estimated_standard_deviation( j, std::max( sqrt( sum_of_intensities ), sum_of_intensities / 100.0 ) / sum_of_noscp2ts );
         }
         else
-            std::cout << "add_powder_patterns(): Warning, no contribution." << std::endl;
+            log_warning( "add_powder_patterns(): Warning, no contribution." );
     }
     return result;
 }
@@ -845,6 +1542,7 @@ void PowderPattern::sort_two_theta()
 {
     if ( size() < 2 )
         return;
+    store_two_theta_values();
     bool changed( true );
     while ( changed )
     {
@@ -857,6 +1555,7 @@ void PowderPattern::sort_two_theta()
                 std::swap( two_theta_values_[i], two_theta_values_[i-1] );
                 std::swap( intensities_[i], intensities_[i-1] );
                 std::swap( estimated_standard_deviations_[i], estimated_standard_deviations_[i-1] );
+                std::swap( weights_[i], weights_[i-1] );
                 changed = true;
             }
         }
@@ -868,6 +1567,7 @@ void PowderPattern::sort_two_theta()
 // Should not be necessary. Introduced to manipulate data from a tool that extracted a powder pattern from a bitmap picture.
 void PowderPattern::average_if_two_theta_equal()
 {
+    store_two_theta_values();
     std::vector< Angle > new_two_theta_values;
     std::vector< double > new_intensities;
     std::vector< double > new_estimated_standard_deviations;
@@ -893,6 +1593,48 @@ void PowderPattern::average_if_two_theta_equal()
     two_theta_values_ = new_two_theta_values;
     intensities_ = new_intensities;
     estimated_standard_deviations_ = new_estimated_standard_deviations;
+    recalculate_weights();
+}
+
+// ********************************************************************************
+
+void PowderPattern::store_two_theta_values()
+{
+    if ( ! constant_two_theta_step_ )
+        return;
+    two_theta_values_.reserve( size() );
+    for ( size_t i( 0 ); i != size(); ++i )
+        two_theta_values_.push_back( ( i * two_theta_step_ ) + two_theta_start_ );
+    constant_two_theta_step_ = false;
+}
+
+// ********************************************************************************
+
+void PowderPattern::recalculate_weights()
+{
+    weights_.resize( estimated_standard_deviations_.size() );
+    for ( size_t i( 0 ); i != estimated_standard_deviations_.size(); ++i )
+        weights_[i] = 1.0 / square( estimated_standard_deviations_[i] );
+}
+
+// ********************************************************************************
+
+void PowderPattern::set_constant_two_theta_step_data( const Angle two_theta_start, const Angle two_theta_step, const std::vector< double > & intensities, const std::vector< double > & estimated_standard_deviations )
+{
+    constant_two_theta_step_ = true;
+    two_theta_start_ = two_theta_start;
+    two_theta_step_ = two_theta_step;
+    two_theta_values_.clear();
+    intensities_ = intensities;
+    if ( estimated_standard_deviations.empty() )
+    {
+        estimated_standard_deviations_.resize( intensities_.size() );
+        for ( size_t i( 0 ); i != intensities_.size(); ++i )
+            estimated_standard_deviations_[i] = default_estimated_standard_deviation( intensities_[i] );
+    }
+    else
+        estimated_standard_deviations_ = estimated_standard_deviations;
+    recalculate_weights();
 }
 
 // ********************************************************************************
@@ -28,11 +28,31 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+class FileList;
 class FileName;
+class NoiseGenerator;
 #include "Angle.h"
 
+#include <cstdint>
 #include <vector>
 
+// A range of npoints_ 2theta values two_theta_start_ + i * two_theta_step_ that starts at point first_point_ of a powder pattern.
+// Synchrotron and Variable Count Time data consist of several of these ranges.
+struct TwoThetaSegment
+{
+    TwoThetaSegment() : first_point_(0), npoints_(0) {}
+
+    // The number of points is calculated as in PowderPattern( two_theta_start, two_theta_end, two_theta_step ).
+    TwoThetaSegment( const Angle two_theta_start, const Angle two_theta_end, const Angle two_theta_step );
+
+    Angle two_theta( const size_t i ) const { return ( i * two_theta_step_ ) + two_theta_start_; }
+
+    Angle two_theta_start_;
+    Angle two_theta_step_;
+    size_t first_point_;
+    size_t npoints_;
+};
+
 class PowderPattern
 {
 public:
@@ -40,8 +60,15 @@ public:
     PowderPattern();
 
     // Initialises the 2theta values. Intensities and ESDs are initialised to 0.0.
+    // The 2theta values are not stored but generated from the start and the step, see has_constant_two_theta_step().
     PowderPattern( const Angle two_theta_start, const Angle two_theta_end, const Angle two_theta_step );
 
+    // Concatenates the segments, which must be in ascending order of 2theta and must not overlap; first_point_ is ignored.
+    // Intensities and ESDs are initialised to 0.0. A single segment gives a pattern with a constant 2theta step.
+    explicit PowderPattern( const std::vector< TwoThetaSegment > & segments );
+
+    // Reads an .xye file, or a .ppb file if that is the extension.
+    // If a .ppb file with the same name exists and is not older than the .xye file, the .ppb file is read instead.
     explicit PowderPattern( const FileName & file_name );
 
     void reserve( const size_t nvalues );
@@ -51,9 +78,19 @@ public:
     
     void push_back( const Angle two_theta, const double intensity, const double estimated_standard_deviation );
 
-    size_t size() const { return two_theta_values_.size(); }
+    size_t size() const { return intensities_.size(); }
 
-    bool empty() const { return two_theta_values_.empty(); }
+    bool empty() const { return intensities_.empty(); }
+
+    // If true, the 2theta values are not stored but calculated as two_theta_start() + i * average_two_theta_step().
+    // Anything that changes individual 2theta values, such as push_back() and set_two_theta(), switches to storing them explicitly.
+    bool has_constant_two_theta_step() const { return constant_two_theta_step_; }
+
+    // The 2theta values as consecutive ranges with a constant step. Consecutive points belong to the same segment as long as
+    // their 2theta difference is within 1% of the step of the segment, so rounding in the input file does not break up a segment.
+    // The step of a segment is its average step; a segment with only one point gets the distance to the previous point as its step.
+    // O(N) unless has_constant_two_theta_step(), in which case there is exactly one segment.
+    std::vector< TwoThetaSegment > two_theta_segments() const;
 
     // 2theta and intensity are recalculated as averages, the ESDs are recalculated as the square root of the sum of the squares.
     void rebin( const size_t bin_size );
@@ -61,17 +98,25 @@ public:
     // Returns the *nearest* 2theta value
     size_t find_two_theta( const Angle two_theta_value ) const;
 
-    Angle two_theta( const size_t i ) const { return two_theta_values_[i]; }
+    Angle two_theta( const size_t i ) const { return constant_two_theta_step_ ? ( i * two_theta_step_ ) + two_theta_start_ : two_theta_values_[i]; }
     double intensity( const size_t i ) const { return intensities_[i]; }
     double estimated_standard_deviation( const size_t i ) const { return estimated_standard_deviations_[i]; }
     double noise( const size_t i ) const { return noise_[i]; }
-    void set_two_theta( const size_t i, const Angle value ) { two_theta_values_[i] = value; }
+    void set_two_theta( const size_t i, const Angle value ) { store_two_theta_values(); two_theta_values_[i] = value; }
     double wavelength() const { return wavelength_; }
     void set_wavelength( const double wavelength ) { wavelength_ = wavelength; }
 
     // ESD is NOT updated.
     void set_intensity( const size_t i, const double value ) { intensities_[i] = value; }
-    void set_estimated_standard_deviation( const size_t i, const double value ) { estimated_standard_deviations_[i] = value; }
+    void set_estimated_standard_deviation( const size_t i, const double value ) { estimated_standard_deviations_[i] = value; weights_[i] = 1.0 / ( value * value ); }
+
+    // Contiguous arrays of size() values, for loops over the whole pattern.
+    // Invalidated by anything that changes the number of points.
+    const double * intensities() const { return intensities_.empty() ? 0 : &intensities_[0]; }
+    double * intensities() { return intensities_.empty() ? 0 : &intensities_[0]; }
+    const double * estimated_standard_deviations() const { return estimated_standard_deviations_.empty() ? 0 : &estimated_standard_deviations_[0]; }
+    // 1/ESD^2, kept up to date with the ESDs.
+    const double * weights() const { return weights_.empty() ? 0 : &weights_[0]; }
 
     Angle average_two_theta_step() const;
 
@@ -89,7 +134,8 @@ public:
     void set_two_theta_end( const Angle two_theta_end ) const;
 
     // Area under the pattern
-    double cumulative_intensity() const;
+    // With compensated_summation the result is accurate to about one rounding error, otherwise the summation is vectorised.
+    double cumulative_intensity( const bool compensated_summation = false ) const;
     double cumulative_noise() const;
     double cumulative_absolute_noise() const;
     double cumulative_squared_noise() const;
@@ -101,6 +147,12 @@ public:
     void read_brml( const FileName & file_name );
     void read_txt( const FileName & file_name );
     void save_xye( const FileName & file_name, const bool include_wave_length ) const;
+
+    // Binary format: a 64-byte header with the wavelength, number of points and, for a constant 2theta step, the 2theta start and step,
+    // followed by the 2theta values (only if the step is not constant), the intensities and the ESDs.
+    // The intensities and ESDs are stored as float if single_precision is true, which loses precision; the wavelength and 2theta are always doubles.
+    void read_ppb( const FileName & file_name );
+    void save_ppb( const FileName & file_name, const bool single_precision = false ) const;
     
     // Writes to std::cout the code that is necessary to generate the PowderPattern object.
     // Useful for writing test-suite code that does not rely on external files.
@@ -133,6 +185,10 @@ public:
     // makes all points of the pattern behave as Gaussian.
     // Returns the noise
     void add_Poisson_noise();
+
+    // As above, the random numbers are taken from noise_generator. Points with a large number of counts use the normal approximation,
+    // see NoiseGenerator. The noise replaces any noise stored previously.
+    void add_Poisson_noise( NoiseGenerator & noise_generator );
     
     // Should not be necessary. Introduced to manipulate data from a tool that extracted a powder pattern from a bitmap picture.
     void sort_two_theta();
@@ -142,11 +198,23 @@ public:
 
 private:
     double wavelength_;
-    std::vector< Angle > two_theta_values_;
+    bool constant_two_theta_step_;
+    Angle two_theta_start_; // Only used if constant_two_theta_step_
+    Angle two_theta_step_;  // Only used if constant_two_theta_step_
+    std::vector< Angle > two_theta_values_; // Empty if constant_two_theta_step_
     std::vector< double > intensities_;
     std::vector< double > estimated_standard_deviations_;
+    std::vector< double > weights_; // 1/ESD^2
     bool noise_is_available_;
     std::vector< double > noise_;
+
+    // Switches from a constant 2theta step to explicitly stored 2theta values.
+    void store_two_theta_values();
+
+    void recalculate_weights();
+
+    // If estimated_standard_deviations is empty, the ESDs are initialised as in push_back().
+    void set_constant_two_theta_step_data( const Angle two_theta_start, const Angle two_theta_step, const std::vector< double > & intensities, const std::vector< double > & estimated_standard_deviations );
 };
 
 // Assumes uniform 2theta step size
@@ -158,13 +226,40 @@ bool same_range( const PowderPattern & lhs, const PowderPattern & rhs );
 // Assumes uniform 2theta step size
 double weighted_cross_correlation( const PowderPattern & lhs, const PowderPattern & rhs, Angle l = Angle( 3.0, Angle::DEGREES ) );
 
+// The weighted cross correlation uses I/sigma, when many patterns are compared it pays to precalculate it.
+std::vector< double > intensities_over_ESDs( const PowderPattern & powder_pattern );
+
+// Half the width of the triangle in points, m = l / 2theta step.
+int weighted_cross_correlation_window( const PowderPattern & powder_pattern, const Angle l );
+
+// result[i] = sum_j ( 1 - |j|/m ) values[i+j], |j| < m, values outside the pattern are taken as 0.0. O(N) rather than O(N m).
+void triangle_filter( const double * values, const size_t npoints, const int m, double * result );
+
+// Single-precision version for libraries of patterns that are stored as floats. The running sums are in double.
+void triangle_filter( const float * values, const size_t npoints, const int m, float * result );
+
+// Same as above, with precalculated I/sigma and with the triangle window of 2m-1 points.
+// weighted_cross_correlation( lhs, rhs ) = sum_i lhs[i] * triangle_filter( rhs )[i].
+double weighted_cross_correlation( const double * lhs, const double * rhs, const size_t npoints, const int m );
+
+// Single-precision version, accumulated in double. Agrees with the double-precision version to about 1.0E-6 relative.
+double weighted_cross_correlation( const float * lhs, const float * rhs, const size_t npoints, const int m );
+
+// sum_i lhs[i] * rhs[i], the inner loop of weighted_cross_correlation() when triangle_filter( rhs ) has been precalculated.
+double dot_product( const double * lhs, const double * rhs, const size_t n );
+
+// The products are summed in float in blocks of 16 values, so that the loop is vectorised with twice as many values per
+// instruction as for doubles, and the blocks are summed in double.
+double dot_product( const float * lhs, const float * rhs, const size_t n );
+
 // Because powder patterns are always positive, returns a value between 0.0 and 1.0
 // Assumes uniform 2theta step size
 double normalised_weighted_cross_correlation( const PowderPattern & lhs, const PowderPattern & rhs, Angle l = Angle( 3.0, Angle::DEGREES ) );
 
 // The first pattern is supposed to be the experimental pattern, and its ESDs are used as "the" weights. The ESDs of the second pattern are ignored.
 // Since the background cannot be determined from the input, it cannot be subtracted.
-double Rwp( const PowderPattern & lhs, const PowderPattern & rhs );
+// With compensated_summation the sums are accurate to about one rounding error, otherwise the summation is vectorised.
+double Rwp( const PowderPattern & lhs, const PowderPattern & rhs, const bool compensated_summation = false );
 
 PowderPattern calculate_Brueckner_background( const PowderPattern & powder_pattern,
                                               const size_t niterations,
@@ -172,6 +267,14 @@ PowderPattern calculate_Brueckner_background( const PowderPattern & powder_patte
                                               const bool apply_smoothing,
                                               const size_t smoothing_window );
 
+// For each .xye file in the list, writes a .ppb file with the same name unless there is one already that is up to date.
+// nthreads = 0 means one thread per core.
+void build_ppb_caches( const FileList & file_list, const bool single_precision = false, const size_t nthreads = 0 );
+
+// Adds Poisson noise to each pattern, pattern i uses stream i of a NoiseGenerator with the given seed,
+// so the result does not depend on the number of threads. nthreads = 0 means one thread per core.
+void add_Poisson_noise( std::vector< PowderPattern > & powder_patterns, const uint64_t seed, const size_t nthreads = 0 );
+
 // Useful for Variable Count Time schemes
 // The 2theta values must currently be the same.
 // @@ Currently does not allow the "monitor" to be passed, so only suitable for laboratory data.
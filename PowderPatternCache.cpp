@@ -0,0 +1,422 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternCache.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "MathFunctions.h"
+#include "MillerIndices.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "ReflectionList.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+namespace
+{
+
+const char magic[8] = { 'P', 'P', 'C', 'A', 'C', 'H', 'E', '1' };
+
+// The directory is only checked for eviction every so many stores, listing it is not free.
+const size_t eviction_interval = 32;
+
+// ********************************************************************************
+
+// Numbers in the key are written as integer multiples of 1.0E-8, which avoids the formatting of doubles and
+// the distinction between 0.0 and -0.0.
+std::string fixed_point( const double value )
+{
+    return std::to_string( std::llround( value * 1.0E8 ) );
+}
+
+// ********************************************************************************
+
+// In [0,1>, so that atoms or translations that differ by a lattice translation give the same key.
+std::string fractional( const double value )
+{
+    long long result = std::llround( ( value - std::floor( value ) ) * 1.0E8 );
+    return std::to_string( result % 100000000LL );
+}
+
+// ********************************************************************************
+
+// FNV-1a
+unsigned long long hash( const std::string & input )
+{
+    unsigned long long result = 14695981039346656037ULL;
+    for ( size_t i( 0 ); i != input.size(); ++i )
+    {
+        result ^= static_cast< unsigned char >( input[i] );
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+template< class T >
+void append( std::string & buffer, const T value )
+{
+    buffer.append( reinterpret_cast< const char * >( &value ), sizeof( T ) );
+}
+
+// ********************************************************************************
+
+// Reads the values written by append(), throws if the buffer is too short.
+class CacheReader
+{
+public:
+
+    explicit CacheReader( const std::vector< char > & buffer ): current_( buffer.empty() ? 0 : &buffer[0] ), end_( current_ + buffer.size() ) {}
+
+    template< class T >
+    T read()
+    {
+        check( sizeof( T ) );
+        T result;
+        std::memcpy( &result, current_, sizeof( T ) );
+        current_ += sizeof( T );
+        return result;
+    }
+
+    std::string read_string( const size_t length )
+    {
+        check( length );
+        std::string result( current_, length );
+        current_ += length;
+        return result;
+    }
+
+private:
+    const char * current_;
+    const char * end_;
+
+    void check( const size_t nbytes ) const
+    {
+        if ( static_cast< size_t >( end_ - current_ ) < nbytes )
+            throw std::runtime_error( "PowderPatternCache::find(): file is truncated." );
+    }
+};
+
+// ********************************************************************************
+
+void mark_as_used( const FileName & file_name )
+{
+#ifdef _WIN32
+    _utime( file_name.full_name().c_str(), 0 );
+#else
+    utime( file_name.full_name().c_str(), 0 );
+#endif
+}
+
+// ********************************************************************************
+
+int process_id()
+{
+#ifdef _WIN32
+    return _getpid();
+#else
+    return getpid();
+#endif
+}
+
+} // namespace
+
+// ********************************************************************************
+
+PowderPatternCache::PowderPatternCache( const std::string & directory, const size_t maximum_size ):
+directory_(directory),
+maximum_size_(maximum_size),
+nhits_(0),
+nmisses_(0),
+nstores_(0)
+{
+}
+
+// ********************************************************************************
+
+std::string PowderPatternCache::key( const CrystalStructure & crystal_structure, const PowderPatternCalculator & powder_pattern_calculator )
+{
+    if ( powder_pattern_calculator.has_peak_shape_function() )
+        throw std::runtime_error( "PowderPatternCache::key(): a peak shape function cannot be part of the key." );
+    std::string result( "settings" );
+    result += " " + fixed_point( powder_pattern_calculator.wavelength() );
+    result += " " + fixed_point( powder_pattern_calculator.two_theta_start().value_in_degrees() );
+    result += " " + fixed_point( powder_pattern_calculator.two_theta_end().value_in_degrees() );
+    result += " " + fixed_point( powder_pattern_calculator.two_theta_step().value_in_degrees() );
+    result += " " + fixed_point( powder_pattern_calculator.FWHM() );
+    result += ( powder_pattern_calculator.atoms_stored() == PowderPatternCalculator::UNIT_CELL ) ? " unit_cell" : " asymmetric_unit";
+    if ( powder_pattern_calculator.peak_convolution() == PowderPatternCalculator::FFT )
+        result += " FFT " + fixed_point( powder_pattern_calculator.FFT_block_width().value_in_degrees() );
+    if ( powder_pattern_calculator.has_preferred_orientation() )
+    {
+        MillerIndices direction = powder_pattern_calculator.preferred_orientation_direction();
+        result += " PO " + std::to_string( direction.h() ) + " " + std::to_string( direction.k() ) + " " + std::to_string( direction.l() ) +
+                  " " + fixed_point( powder_pattern_calculator.preferred_orientation_r() );
+    }
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    result += "\nlattice " + fixed_point( crystal_lattice.a() ) + " " + fixed_point( crystal_lattice.b() ) + " " + fixed_point( crystal_lattice.c() ) + " " +
+              fixed_point( crystal_lattice.alpha().value_in_degrees() ) + " " + fixed_point( crystal_lattice.beta().value_in_degrees() ) + " " +
+              fixed_point( crystal_lattice.gamma().value_in_degrees() ) + "\n";
+    std::vector< std::string > lines;
+    const SpaceGroup & space_group = crystal_structure.space_group();
+    for ( size_t i( 0 ); i != space_group.nsymmetry_operators(); ++i )
+    {
+        std::string line( "operator" );
+        const Matrix3D rotation = space_group.symmetry_operator( i ).rotation();
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            for ( size_t k( 0 ); k != 3; ++k )
+                line += " " + std::to_string( round_to_int( rotation.value( j, k ) ) );
+        }
+        const Vector3D translation = space_group.symmetry_operator( i ).translation();
+        for ( size_t j( 0 ); j != 3; ++j )
+            line += " " + fractional( translation.value( j ) );
+        lines.push_back( line );
+    }
+    std::sort( lines.begin(), lines.end() );
+    for ( size_t i( 0 ); i != lines.size(); ++i )
+        result += lines[i] + "\n";
+    lines.clear();
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        const Atom & atom = crystal_structure.atom( i );
+        std::string line( "atom " + std::to_string( atom.element().atomic_number() ) );
+        for ( size_t j( 0 ); j != 3; ++j )
+            line += " " + fractional( atom.position().value( j ) );
+        line += " " + fixed_point( atom.occupancy() );
+        if ( atom.ADPs_type() == Atom::ANISOTROPIC )
+        {
+            SymmetricMatrix3D U_cart = atom.anisotropic_displacement_parameters().U_cart();
+            line += " U";
+            for ( size_t j( 0 ); j != 3; ++j )
+            {
+                for ( size_t k( j ); k != 3; ++k )
+                    line += " " + fixed_point( U_cart.value( j, k ) );
+            }
+        }
+        else if ( atom.ADPs_type() == Atom::ISOTROPIC )
+            line += " Uiso " + fixed_point( atom.Uiso() );
+        lines.push_back( line );
+    }
+    std::sort( lines.begin(), lines.end() );
+    for ( size_t i( 0 ); i != lines.size(); ++i )
+        result += lines[i] + "\n";
+    return result;
+}
+
+// ********************************************************************************
+
+FileName PowderPatternCache::file_name( const std::string & key ) const
+{
+    char hexadecimal[17];
+    std::snprintf( hexadecimal, sizeof( hexadecimal ), "%016llx", hash( key ) );
+    return FileName( directory_, hexadecimal, "ppcache" );
+}
+
+// ********************************************************************************
+
+bool PowderPatternCache::find( const std::string & key, PowderPattern & powder_pattern, ReflectionList & reflection_list ) const
+{
+    const FileName cache_file_name = file_name( key );
+    std::ifstream input_file( cache_file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+    {
+        ++nmisses_;
+        return false;
+    }
+    std::vector< char > buffer( ( std::istreambuf_iterator< char >( input_file ) ), std::istreambuf_iterator< char >() );
+    input_file.close();
+    try
+    {
+        CacheReader reader( buffer );
+        if ( reader.read_string( sizeof( magic ) ) != std::string( magic, sizeof( magic ) ) )
+            throw std::runtime_error( "PowderPatternCache::find(): not a cache file." );
+        // A different key with the same hash
+        if ( reader.read_string( reader.read< unsigned long long >() ) != key )
+        {
+            ++nmisses_;
+            return false;
+        }
+        const Angle two_theta_start = Angle::from_radians( reader.read< double >() );
+        const Angle two_theta_end = Angle::from_radians( reader.read< double >() );
+        const Angle two_theta_step = Angle::from_radians( reader.read< double >() );
+        const double wavelength = reader.read< double >();
+        const size_t npoints = reader.read< unsigned long long >();
+        PowderPattern result( two_theta_start, two_theta_end, two_theta_step );
+        if ( result.size() != npoints )
+            throw std::runtime_error( "PowderPatternCache::find(): file is corrupt." );
+        result.set_wavelength( wavelength );
+        for ( size_t i( 0 ); i != npoints; ++i )
+        {
+            result.set_intensity( i, reader.read< double >() );
+            result.set_estimated_standard_deviation( i, reader.read< double >() );
+        }
+        const size_t nreflections = reader.read< unsigned long long >();
+        ReflectionList result_reflection_list;
+        result_reflection_list.reserve( nreflections );
+        for ( size_t i( 0 ); i != nreflections; ++i )
+        {
+            const int h = reader.read< int >();
+            const int k = reader.read< int >();
+            const int l = reader.read< int >();
+            const double F_squared = reader.read< double >();
+            const double d_spacing = reader.read< double >();
+            const size_t multiplicity = reader.read< unsigned long long >();
+            result_reflection_list.push_back( MillerIndices( h, k, l ), F_squared, d_spacing, multiplicity );
+        }
+        result_reflection_list.finalise();
+        powder_pattern = result;
+        reflection_list = result_reflection_list;
+    }
+    catch ( std::exception & )
+    {
+        // A damaged file, e.g. from an older version, is treated as a miss and replaced by the next store().
+        ++nmisses_;
+        return false;
+    }
+    mark_as_used( cache_file_name );
+    ++nhits_;
+    return true;
+}
+
+// ********************************************************************************
+
+void PowderPatternCache::store( const std::string & key, const PowderPattern & powder_pattern, const ReflectionList & reflection_list ) const
+{
+    std::string buffer( magic, sizeof( magic ) );
+    append( buffer, static_cast< unsigned long long >( key.size() ) );
+    buffer += key;
+    append( buffer, powder_pattern.two_theta_start().value_in_radians() );
+    append( buffer, powder_pattern.two_theta_end().value_in_radians() );
+    append( buffer, powder_pattern.average_two_theta_step().value_in_radians() );
+    append( buffer, powder_pattern.wavelength() );
+    append( buffer, static_cast< unsigned long long >( powder_pattern.size() ) );
+    for ( size_t i( 0 ); i != powder_pattern.size(); ++i )
+    {
+        append( buffer, powder_pattern.intensity( i ) );
+        append( buffer, powder_pattern.estimated_standard_deviation( i ) );
+    }
+    append( buffer, static_cast< unsigned long long >( reflection_list.size() ) );
+    for ( size_t i( 0 ); i != reflection_list.size(); ++i )
+    {
+        const MillerIndices miller_indices = reflection_list.miller_indices( i );
+        append( buffer, miller_indices.h() );
+        append( buffer, miller_indices.k() );
+        append( buffer, miller_indices.l() );
+        append( buffer, reflection_list.F_squared( i ) );
+        append( buffer, reflection_list.d_spacing( i ) );
+        append( buffer, static_cast< unsigned long long >( reflection_list.multiplicity( i ) ) );
+    }
+    // Written under a name that is unique to this process and thread, then renamed, which is atomic.
+    const FileName cache_file_name = file_name( key );
+    const std::string temporary_file_name = cache_file_name.full_name() + ".tmp" + std::to_string( process_id() ) + "_" +
+                                            std::to_string( std::hash< std::thread::id >()( std::this_thread::get_id() ) );
+    {
+        std::ofstream output_file( temporary_file_name.c_str(), std::ios::binary );
+        if ( ! output_file )
+            throw std::runtime_error( "PowderPatternCache::store(): could not open file " + temporary_file_name );
+        output_file.write( buffer.data(), buffer.size() );
+        if ( ! output_file )
+        {
+            output_file.close();
+            std::remove( temporary_file_name.c_str() );
+            throw std::runtime_error( "PowderPatternCache::store(): could not write file " + temporary_file_name );
+        }
+    }
+    if ( std::rename( temporary_file_name.c_str(), cache_file_name.full_name().c_str() ) != 0 )
+    {
+        // E.g. on Windows if another process has just stored the same key, which is fine.
+        std::remove( temporary_file_name.c_str() );
+    }
+    if ( ( maximum_size_ != 0 ) && ( ( nstores_++ % eviction_interval ) == 0 ) )
+        evict();
+}
+
+// ********************************************************************************
+
+bool PowderPatternCache::calculate( const CrystalStructure & crystal_structure, PowderPatternCalculator & powder_pattern_calculator, PowderPattern & powder_pattern, ReflectionList & reflection_list ) const
+{
+    const std::string cache_key = key( crystal_structure, powder_pattern_calculator );
+    if ( find( cache_key, powder_pattern, reflection_list ) )
+        return true;
+    powder_pattern_calculator.calculate( powder_pattern );
+    reflection_list = powder_pattern_calculator.reflection_list();
+    store( cache_key, powder_pattern, reflection_list );
+    return false;
+}
+
+// ********************************************************************************
+
+void PowderPatternCache::evict() const
+{
+    if ( maximum_size_ == 0 )
+        return;
+    FileList file_list;
+    file_list.initialise_from_directory( directory_, "*.ppcache" );
+    file_list.set_prepend_file_name_with_basedirectory( true );
+    std::vector< FileStatus > file_status = file_list.status();
+    size_t total_size( 0 );
+    std::vector< std::pair< time_t, size_t > > files;
+    for ( size_t i( 0 ); i != file_status.size(); ++i )
+    {
+        // Another process may have removed the file in the meantime
+        if ( ! file_status[i].exists() )
+            continue;
+        total_size += file_status[i].size();
+        files.push_back( std::make_pair( file_status[i].modification_time(), i ) );
+    }
+    if ( total_size <= maximum_size_ )
+        return;
+    std::sort( files.begin(), files.end() );
+    const size_t target_size = maximum_size_ - maximum_size_ / 10;
+    for ( size_t i( 0 ); ( i != files.size() ) && ( total_size > target_size ); ++i )
+    {
+        std::remove( file_list.value( files[i].second ).full_name().c_str() );
+        total_size -= file_status[ files[i].second ].size();
+    }
+}
+
@@ -0,0 +1,93 @@
+#ifndef POWDERPATTERNCACHE_H
+#define POWDERPATTERNCACHE_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+class FileName;
+class PowderPattern;
+class PowderPatternCalculator;
+class ReflectionList;
+
+#include <atomic>
+#include <cstddef> // For definition of size_t
+#include <string>
+
+/*
+  An on-disk cache of calculated powder patterns and their reflection lists, so that repeated runs over the same
+  structures with the same settings skip the calculations.
+
+  The cache is content addressed: the key is a canonical text of everything the calculation depends on (the lattice,
+  the symmetry operators, the atoms and the settings of the calculator) and the file name is a 64-bit hash of the key.
+  The key is stored in the file as well and compared when the file is read, so a hash collision is a cache miss and
+  never a wrong result. Because the symmetry operators and atoms are sorted, the order in the cif does not matter.
+
+  Files are written to a temporary file and then renamed, so several processes can share one directory: a reader sees
+  either a complete file or no file. When the directory grows beyond the maximum size, the least recently used files
+  are removed; a file is marked as used by updating its modification time.
+  The reflection lists are stored without the equivalent directions.
+*/
+class PowderPatternCache
+{
+public:
+
+    // The directory must exist. maximum_size is in bytes, 0 means no limit.
+    explicit PowderPatternCache( const std::string & directory, const size_t maximum_size = 1024 * 1024 * 1024 );
+
+    // Throws if the calculator uses a PeakShapeFunction, which cannot be part of the key.
+    static std::string key( const CrystalStructure & crystal_structure, const PowderPatternCalculator & powder_pattern_calculator );
+
+    // The file in the cache directory for a key.
+    FileName file_name( const std::string & key ) const;
+
+    // Returns false if the key is not in the cache. Thread-safe.
+    bool find( const std::string & key, PowderPattern & powder_pattern, ReflectionList & reflection_list ) const;
+
+    // Thread-safe.
+    void store( const std::string & key, const PowderPattern & powder_pattern, const ReflectionList & reflection_list ) const;
+
+    // The calculator must refer to crystal_structure. Only calculates if the result is not in the cache, the reflection list then
+    // also contains the structure factors. Returns true if the result was found in the cache.
+    bool calculate( const CrystalStructure & crystal_structure, PowderPatternCalculator & powder_pattern_calculator, PowderPattern & powder_pattern, ReflectionList & reflection_list ) const;
+
+    size_t nhits() const { return nhits_; }
+    size_t nmisses() const { return nmisses_; }
+
+    // Removes the least recently used files until the directory is below 90% of the maximum size.
+    void evict() const;
+
+private:
+    std::string directory_;
+    size_t maximum_size_;
+    mutable std::atomic< size_t > nhits_;
+    mutable std::atomic< size_t > nmisses_;
+    mutable std::atomic< size_t > nstores_;
+};
+
+#endif // POWDERPATTERNCACHE_H
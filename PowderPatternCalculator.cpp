@@ -28,175 +28,452 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "PowderPatternCalculator.h"
 #include "Angle.h"
 #include "CrystalStructure.h"
+#include "FFT.h"
+#include "Instrumentation.h"
+#include "KernelVerification.h"
+#include "Logger.h"
 #include "MathConstants.h"
 #include "MathFunctions.h"
+#include "MathKernels.h"
+#include "ParallelFor.h"
+#include "PeakShapeFunction.h"
 #include "PointGroup.h"
 #include "PowderPattern.h"
 #include "ReflectionList.h"
+#include "ScratchArena.h"
+#include "SpaceGroup.h"
+#include "SymmetricMatrix3D.h"
+#include "SymmetryOperator.h"
 #include "Utilities.h"
+#include "Wavelength.h"
 #include "3DCalculations.h"
 
+#include <algorithm>
 #include <cmath>
+#include <complex>
+#include <map>
+#include <memory_resource>
+#include <set>
 #include <stdexcept>
+#include <vector>
 
 #include <iostream> // for debugging
 
-// This is of course not flexible enough. This should be a base class "PeakShapeFunction" with
-// instantiations like "pseudo_Voigt"
-
 namespace
 {
 
 // ********************************************************************************
 
-// Centered around 0.0, area normalised to 1.0.
-double Lorentzian( const double FWHM, const double x )
+// Adds one peak with area intensity to the npoints intensities at two_theta_start + i * two_theta_step,
+// each point is evaluated at its exact distance from the peak position.
+void add_peak( double * intensities, const size_t npoints, const Angle two_theta_start, const Angle two_theta_step, const Angle two_theta, const double intensity, const PeakShapeFunction & peak_shape_function )
 {
-    return (1.0/CONSTANT_PI) * ( ( 0.5*FWHM ) / ( square( x ) + square( 0.5*FWHM ) ) );
+    const double FWHM = peak_shape_function.FWHM( two_theta );
+    const double eta = peak_shape_function.eta( two_theta );
+    const double step = two_theta_step.value_in_degrees();
+    const double position = ( two_theta - two_theta_start ).value_in_degrees() / step;
+    const double half_width = peak_shape_function.range( FWHM, eta ) / step;
+    const int first = std::max( 0, static_cast<int>( std::ceil( position - half_width ) ) );
+    const int last = std::min( static_cast<int>( npoints ) - 1, static_cast<int>( std::floor( position + half_width ) ) );
+    for ( int index( first ); index <= last; ++index )
+        intensities[index] += intensity * peak_shape_function.value( ( index - position ) * step, FWHM, eta );
 }
 
 // ********************************************************************************
 
-// Centered around 0.0, area normalised to 1.0.
-double Gaussian( const double FWHM, const double x )
+// The sticks are distributed over a grid that is this many times finer than the 2theta step,
+// which makes the error caused by the binning 64 times smaller.
+const int FFT_oversampling = 4;
+
+// Adds all peaks at once: for each block of 2theta values, the sticks are binned onto a fine grid and
+// convoluted with the peak shape at the centre of the block.
+// This is an approximation if the peak shape depends on 2theta, but it is O( N log N ) instead of O( N_reflections * peak width ).
+// The result is added to the npoints values in pattern at two_theta_start + i * two_theta_step.
+void add_peaks_by_FFT( double * pattern, const size_t npoints_in_pattern, const Angle two_theta_start, const Angle two_theta_step, const Angle block_width,
+                       const std::vector< Angle > & two_thetas, const std::vector< double > & intensities, const PeakShapeFunction & peak_shape_function )
 {
-    double sigma = FWHM / 2.35482; // 2.35482 = 2*sqrt(2*ln(2))
-    return exp(-square(x)/(2.0*square(sigma))) / (sigma*sqrt(2.0*CONSTANT_PI));
+    const int npoints = static_cast<int>( npoints_in_pattern );
+    if ( npoints == 0 )
+        return;
+    const double step = two_theta_step.value_in_degrees() / FFT_oversampling; // Step of the fine grid
+    const int nfine = ( npoints - 1 ) * FFT_oversampling + 1;
+    const int block_size = std::max( 1, round_to_int( block_width.value_in_degrees() / step ) );
+    const int nblocks = ( nfine + block_size - 1 ) / block_size;
+    // Assign the sticks to the blocks, the positions are in units of the fine grid
+    std::vector< std::vector< size_t > > sticks_per_block( nblocks );
+    std::vector< double > positions( two_thetas.size() );
+    for ( size_t i( 0 ); i != two_thetas.size(); ++i )
+    {
+        positions[i] = ( two_thetas[i] - two_theta_start ).value_in_degrees() / step;
+        int block = static_cast<int>( std::floor( positions[i] / block_size ) );
+        sticks_per_block[ std::min( std::max( block, 0 ), nblocks - 1 ) ].push_back( i );
+    }
+    std::vector< std::complex< double > > sticks;
+    std::vector< std::complex< double > > kernel;
+    for ( int b( 0 ); b != nblocks; ++b )
+    {
+        if ( sticks_per_block[b].empty() )
+            continue;
+        const int block_start = b * block_size;
+        const int block_end = std::min( block_start + block_size, nfine );
+        const Angle two_theta = two_theta_start + Angle::from_degrees( 0.5 * ( block_start + block_end - 1 ) * step );
+        const double FWHM = peak_shape_function.FWHM( two_theta );
+        const double eta = peak_shape_function.eta( two_theta );
+        const int half_width = static_cast<int>( std::ceil( peak_shape_function.range( FWHM, eta ) / step ) );
+        // Sticks within half_width of the block boundaries are kept, the first and the last block also receive the sticks outside the pattern
+        const int origin = block_start - half_width - 1;
+        const int nsticks = ( block_end - block_start ) + 2 * half_width + 3;
+        const size_t n = next_power_of_two( nsticks + 2 * half_width );
+        sticks.assign( n, std::complex< double >( 0.0, 0.0 ) );
+        for ( size_t i( 0 ); i != sticks_per_block[b].size(); ++i )
+        {
+            const double position = positions[ sticks_per_block[b][i] ] - origin;
+            const int index = round_to_int( position );
+            if ( ( index < 1 ) || ( index >= nsticks - 1 ) )
+                continue;
+            // Quadratic Lagrange weights: the sum, the centroid and the second moment of the stick are preserved
+            const double fraction = position - index;
+            const double intensity = intensities[ sticks_per_block[b][i] ];
+            sticks[index-1] += 0.5 * fraction * ( fraction - 1.0 ) * intensity;
+            sticks[index]   += ( 1.0 - square( fraction ) ) * intensity;
+            sticks[index+1] += 0.5 * fraction * ( fraction + 1.0 ) * intensity;
+        }
+        // The kernel is stored with negative offsets wrapped around
+        kernel.assign( n, std::complex< double >( 0.0, 0.0 ) );
+        for ( int j( -half_width ); j <= half_width; ++j )
+            kernel[ ( j + n ) % n ] = peak_shape_function.value( j * step, FWHM, eta );
+        fast_Fourier_transform( sticks );
+        fast_Fourier_transform( kernel );
+        for ( size_t i( 0 ); i != n; ++i )
+            sticks[i] *= kernel[i];
+        fast_Fourier_transform( sticks, true );
+        // Only every FFT_oversampling-th point of the fine grid is a point of the powder pattern
+        for ( int m( -half_width ); m < nsticks + half_width; ++m )
+        {
+            const int fine_index = origin + m;
+            if ( ( fine_index < 0 ) || ( fine_index >= nfine ) || ( ( fine_index % FFT_oversampling ) != 0 ) )
+                continue;
+            const int index = fine_index / FFT_oversampling;
+            pattern[index] += sticks[ ( m + n ) % n ].real();
+        }
+    }
 }
 
 // ********************************************************************************
 
-//double global_FWHM;
-
-// function pointer
-//typedef double (* PenaltyFunction)( const double );
-//
-//double bisection( const PenaltyFunction f, const double target_value, const double initial_value )
-//{
-//    double result = initial_value;
-//    double increment( 0.01 );
-//    double left_bracket = initial_value - increment;
-//    double right_bracket = initial_value + increment;
-//    // Following line guarantees that neither f( left_bracket ) nor f( right_bracket ) can be 0.0
-//    double f_left_bracket  = f( left_bracket );
-//    double f_right_bracket = f( right_bracket );
-//
-//    
-//    while ( sign( f( left_bracket ) - target_value ) * sign( f( right_bracket ) - target_value ) > 0 )
-//    {
-//        left_bracket  -= increment;
-//        right_bracket += increment;
-//        f_left_bracket  = f( left_bracket );
-//        f_right_bracket = f( right_bracket );
-//   //     increment *= 2.0;
-//    }
-//    // Following line guarantees that f( result ) - target_value cannot be 0.0 within the loop.
-//    // Since we only assign result to left_bracket and right_bracket,
-//    // this guarantees that neither f( left_bracket ) - target_value nor f( right_bracket ) - target_value can be 0.0.
-//    while ( fabs( f( result ) - target_value ) > 0.000001 )
-//    {
-//        if ( sign( f( result ) - target_value ) * sign( f( right_bracket ) - target_value ) < 0 )
-//            left_bracket = result;
-//        else
-//            right_bracket = result;
-//        result = ( right_bracket + left_bracket ) / 2.0;
-//    }
-//    std::cout << "result = " << result << std::endl;
-//    return result;
-//}
-//
-//// ********************************************************************************
-//
-//double pseudo_Voigt_2( const double x )
-//{
-//    double eta( 0.8 );
-//    return eta * Lorentzian( global_FWHM, x ) + (1.0-eta) * Gaussian( global_FWHM, x );
-//}
-//
-//// Calculates actual FWHM for a pseudo Voigt given eta and FWHM of the L and G
-//double calculate_FWHM( const double FWHM )
-//{
-//    global_FWHM = FWHM;
-//    double maximum = pseudo_Voigt_2( 0.0 );
-//    return bisection( &pseudo_Voigt_2, maximum / 2.0, 0.05 );
-//}
-
-//// ********************************************************************************
-//
-//// This is the target function for the bisection algorithm
-//double target_function( const double x )
-//{
-//    return ( calculate_FWHM( x ) );
-//}
+// The structure factors are calculated in blocks of this many reflections, each block is one job for parallel_for()
+const size_t reflections_per_block = 32;
 
 // ********************************************************************************
 
-// Centered around 0.0, area normalised to 1.0.
-// Needs: FWHM (in degrees 2theta), eta, 2theta w.r.t. 0.0
-// eta should probably be 0.68 for the FWHM of the pseudo-Voigt to be the same as the
-// FWHM of the individual Lorentzian and Gaussian.
-double pseudo_Voigt( const Angle two_theta, const double FWHM )
+// The Cartesian unit vectors along all distinct equivalent reciprocal-lattice vectors hR, R runs over the Laue class (9 integers per operator).
+void calculate_equivalent_directions( const MillerIndices miller_indices, const std::vector< int > & rotations,
+                                      const Vector3D & a_star_vector, const Vector3D & b_star_vector, const Vector3D & c_star_vector,
+                                      std::vector< MillerIndices > & equivalent_reflections, std::vector< Vector3D > & directions )
 {
-    double eta( 0.9 );
-// For a *full* Voigt, when the FWHM is set to the same value for the Gaussian and the Lorentzian part, the FWHM of the
-// resulting full Voigt is also that same FWHM. This is no longer true for our pseudo Voigt, so we
-// must calculate the correct FWHM.
-//    FWHM = bisection( &calculate_FWHM, FWHM, FWHM );
-//    std::cout << "FWHM = " << FWHM << std::endl;
-    return eta * Lorentzian( FWHM, two_theta.value_in_degrees() ) + (1.0-eta) * Gaussian( FWHM, two_theta.value_in_degrees() );
+    const int h = miller_indices.h();
+    const int k = miller_indices.k();
+    const int l = miller_indices.l();
+    equivalent_reflections.clear();
+    directions.clear();
+    for ( size_t i( 0 ); i < rotations.size(); i += 9 )
+    {
+        const int * R = &rotations[i];
+        MillerIndices equivalent_reflection( h * R[0] + k * R[3] + l * R[6], h * R[1] + k * R[4] + l * R[7], h * R[2] + k * R[5] + l * R[8] );
+        if ( std::find( equivalent_reflections.begin(), equivalent_reflections.end(), equivalent_reflection ) != equivalent_reflections.end() )
+            continue;
+        equivalent_reflections.push_back( equivalent_reflection );
+        Vector3D H = equivalent_reflection.h() * a_star_vector + equivalent_reflection.k() * b_star_vector + equivalent_reflection.l() * c_star_vector;
+        directions.push_back( H / H.length() );
+    }
 }
 
 // ********************************************************************************
 
-// Precalculating the peak shape is a speed optimisation
-// Technically, it is an approximation, because the peak centre
-// is not exactly at one of the i*2theta_step points, so there is a slight shift of
-// on average 1/4 of a 2theta_step
-// This approximation should be fine if 2theta_step is small, such as 0.01 or 0.02.
-std::vector<double> peak_shape( const Angle two_theta_step, const double FWHM )
+// Structure-of-arrays copy of the atoms in a crystal structure.
+// Extracting the atoms once avoids copying each Atom (including its label and ADPs) for every reflection.
+// If asymmetric_unit is true, the atoms are assumed to be the asymmetric unit and the occupancies are divided by
+// the number of symmetry operators that map the atom onto itself, so that atoms on special positions are not counted twice
+// when the symmetry operators are summed explicitly.
+struct AtomTable
 {
-    // Find number of points out to the right that need to be calculated to reach 0.1% of intensity at 0.0
-    std::vector<double> values;
-    values.reserve( 137 ); // 44 for 1% of intensity, but the value also depends on eta.
-    double I100 = pseudo_Voigt( Angle(), FWHM );
-    values.push_back( I100 );
-    size_t i( 0 );
-    double value;
-    do
+    AtomTable( const CrystalStructure & crystal_structure, const bool asymmetric_unit )
     {
-        ++i;
-        value = pseudo_Voigt( i * two_theta_step, FWHM );
-        values.push_back( value );
+        std::vector< size_t > atom_indices( crystal_structure.natoms() );
+        std::vector< Vector3D > positions( crystal_structure.natoms() );
+        for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+        {
+            atom_indices[i] = i;
+            positions[i] = crystal_structure.atom( i ).position();
+        }
+        initialise( crystal_structure, asymmetric_unit, atom_indices, positions );
+    }
+
+    // Only the atoms in atom_indices, placed at the given fractional coordinates rather than at their current positions.
+    AtomTable( const CrystalStructure & crystal_structure, const bool asymmetric_unit, const std::vector< size_t > & atom_indices, const std::vector< Vector3D > & positions )
+    {
+        initialise( crystal_structure, asymmetric_unit, atom_indices, positions );
+    }
+
+    void initialise( const CrystalStructure & crystal_structure, const bool asymmetric_unit, const std::vector< size_t > & atom_indices, const std::vector< Vector3D > & positions )
+    {
+        const size_t natoms = atom_indices.size();
+        x_.reserve( natoms );
+        y_.reserve( natoms );
+        z_.reserve( natoms );
+        occupancy_.reserve( natoms );
+        element_index_.reserve( natoms );
+        // One entry per distinct element, so that scattering factors need only be calculated once per element per reflection
+        std::pmr::set< Element > elements( scratch_resource() );
+        for ( size_t i( 0 ); i != natoms; ++i )
+            elements.insert( crystal_structure.atom( atom_indices[i] ).element() );
+        elements_.assign( elements.begin(), elements.end() );
+        std::pmr::map< Element, size_t > element_indices( scratch_resource() );
+        for ( size_t i( 0 ); i != elements_.size(); ++i )
+            element_indices[ elements_[i] ] = i;
+        temperature_factor_index_.reserve( natoms );
+        // The isotropic temperature factors are grouped by Uiso, the indices for the anisotropic atoms are shifted by the number of distinct Uiso values afterwards
+        std::pmr::map< double, size_t > Uiso_indices( scratch_resource() );
+        std::pmr::vector< bool > is_anisotropic( scratch_resource() );
+        is_anisotropic.reserve( natoms );
+        const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+        const SpaceGroup & space_group = crystal_structure.space_group();
+        for ( size_t i( 0 ); i != natoms; ++i )
+        {
+            const Atom & atom = crystal_structure.atom( atom_indices[i] );
+            const Vector3D & position = positions[i];
+            x_.push_back( position.x() );
+            y_.push_back( position.y() );
+            z_.push_back( position.z() );
+            double occupancy = atom.occupancy();
+            if ( asymmetric_unit )
+            {
+                // Same criterion as in CrystalStructure::apply_space_group_symmetry()
+                size_t nstabilisers( 1 );
+                for ( size_t j( 1 ); j != space_group.nsymmetry_operators(); ++j )
+                {
+                    if ( crystal_lattice.shortest_distance( position, space_group.symmetry_operator( j ) * position ) < 0.1 )
+                        ++nstabilisers;
+                }
+                occupancy /= nstabilisers;
+            }
+            occupancy_.push_back( occupancy );
+            element_index_.push_back( element_indices[ atom.element() ] );
+            if ( atom.ADPs_type() == Atom::ANISOTROPIC )
+            {
+                // U* is calculated once per atom rather than once per atom per reflection
+                SymmetricMatrix3D U_star = atom.anisotropic_displacement_parameters().U_star( crystal_lattice );
+                is_anisotropic.push_back( true );
+                temperature_factor_index_.push_back( U11_star_.size() );
+                U11_star_.push_back( U_star.value( 0, 0 ) );
+                U22_star_.push_back( U_star.value( 1, 1 ) );
+                U33_star_.push_back( U_star.value( 2, 2 ) );
+                U12_star_.push_back( U_star.value( 0, 1 ) );
+                U13_star_.push_back( U_star.value( 0, 2 ) );
+                U23_star_.push_back( U_star.value( 1, 2 ) );
+                continue;
+            }
+            double Uiso;
+            if ( atom.ADPs_type() == Atom::ISOTROPIC )
+                Uiso = atom.Uiso();
+            else if ( atom.element().atomic_number() == 1 ) // This is what Mercury does according to the manual
+                Uiso = 0.06;
+            else
+                Uiso = 0.05;
+            std::map< double, size_t >::const_iterator it = Uiso_indices.find( Uiso );
+            if ( it == Uiso_indices.end() )
+            {
+                it = Uiso_indices.insert( std::make_pair( Uiso, Uisos_.size() ) ).first;
+                Uisos_.push_back( Uiso );
+            }
+            is_anisotropic.push_back( false );
+            temperature_factor_index_.push_back( it->second );
+        }
+        for ( size_t i( 0 ); i != natoms; ++i )
+        {
+            if ( is_anisotropic[i] )
+                temperature_factor_index_[i] += Uisos_.size();
+        }
+        phases_.resize( natoms );
+        sines_.resize( natoms );
+        cosines_.resize( natoms );
+        weights_.resize( natoms );
+    }
+
+    size_t size() const { return x_.size(); }
+
+    size_t ntemperature_factors() const { return Uisos_.size() + U11_star_.size(); }
+
+    // Calculates the Debije-Waller factors for one reflection: first one for each distinct Uiso, then one for each anisotropic atom.
+    void calculate_temperature_factors( const MillerIndices & miller_indices, const double sine_theta_over_lambda, std::vector< double > & temperature_factors ) const
+    {
+        const double B_factor = -8.0 * square( CONSTANT_PI ) * square( sine_theta_over_lambda );
+        for ( size_t i( 0 ); i != Uisos_.size(); ++i )
+            temperature_factors[i] = B_factor * Uisos_[i];
+        const double h = miller_indices.h();
+        const double k = miller_indices.k();
+        const double l = miller_indices.l();
+        const double two_pi_squared = 2.0 * square( CONSTANT_PI );
+        const size_t offset = Uisos_.size();
+        for ( size_t i( 0 ); i != U11_star_.size(); ++i )
+        {
+            double hUh = h*h*U11_star_[i] + k*k*U22_star_[i] + l*l*U33_star_[i] + 2.0 * ( h*k*U12_star_[i] + h*l*U13_star_[i] + k*l*U23_star_[i] );
+            temperature_factors[offset+i] = -two_pi_squared * hUh;
+        }
+        exp( temperature_factors, temperature_factors );
+    }
+
+    // Adds sum_j f_j * T_j * exp( 2*pi*i*( h.x_j + phase_offset ) ) to cosine_term and sine_term.
+    // If cosine_only is true, sine_term is not changed.
+    void add_contributions( const MillerIndices & miller_indices,
+                            const double phase_offset,
+                            const std::vector< double > & scattering_factors,
+                            const std::vector< double > & temperature_factors,
+                            const bool cosine_only,
+                            double & cosine_term,
+                            double & sine_term )
+    {
+        const size_t natoms = size();
+        const double h = miller_indices.h();
+        const double k = miller_indices.k();
+        const double l = miller_indices.l();
+        for ( size_t j( 0 ); j != natoms; ++j )
+            weights_[j] = temperature_factors[ temperature_factor_index_[j] ] * scattering_factors[ element_index_[j] ] * occupancy_[j];
+        // The following loops are branch-free and run over contiguous arrays, so that the compiler can vectorise them
+        for ( size_t j( 0 ); j < natoms; ++j )
+            phases_[j] = h*x_[j] + k*y_[j] + l*z_[j] + phase_offset;
+        if ( cosine_only )
+        {
+            cos_2pi( phases_, cosines_ );
+            for ( size_t j( 0 ); j < natoms; ++j )
+                cosine_term += weights_[j] * cosines_[j];
+            return;
+        }
+        sincos_2pi( phases_, sines_, cosines_ );
+        for ( size_t j( 0 ); j < natoms; ++j )
+        {
+            sine_term   += weights_[j] * sines_[j];
+            cosine_term += weights_[j] * cosines_[j];
+        }
     }
-    while ( (I100/1000.0) < value );
-    // The number of points is now 2*i + 1 (the 1 is 0.0)
-    std::vector<double> result;
-    result.reserve( 2*i+1 );
-    for ( size_t j(0); j < i; ++j )
-        result.push_back( values[i-j] );
-    result.push_back( values[0] );
-    for ( size_t j(0); j < i; ++j )
-        result.push_back( values[j+1] );
-    return result;
-}
+
+    std::vector< double > x_; // Fractional coordinates
+    std::vector< double > y_;
+    std::vector< double > z_;
+    std::vector< double > occupancy_;
+    std::vector< size_t > element_index_; // Index into elements_
+    std::vector< Element > elements_; // The distinct elements
+    std::vector< size_t > temperature_factor_index_; // Index into the array filled by calculate_temperature_factors()
+    std::vector< double > Uisos_; // The distinct values of Uiso, including the Mercury defaults for atoms without ADPs
+    std::vector< double > U11_star_; // U* of the anisotropic atoms
+    std::vector< double > U22_star_;
+    std::vector< double > U33_star_;
+    std::vector< double > U12_star_;
+    std::vector< double > U13_star_;
+    std::vector< double > U23_star_;
+    // Work space, to avoid reallocation for every reflection
+    std::vector< double > phases_;
+    std::vector< double > sines_;
+    std::vector< double > cosines_;
+    std::vector< double > weights_;
+};
 
 } // namespace
 
 // ********************************************************************************
 
-PowderPatternCalculator::PowderPatternCalculator( const CrystalStructure & crystal_structure ):
+PowderPatternCalculator::PowderPatternCalculator( const CrystalStructure & crystal_structure, const AtomsStored atoms_stored ):
 wavelength_(1.54056),
+wavelength_2_(0.0),
+doublet_intensity_ratio_(0.5),
+radiation_type_(X_RAYS),
+nthreads_(1),
 two_theta_start_(5.0,Angle::DEGREES),
 two_theta_end_(30.0,Angle::DEGREES),
 two_theta_step_(0.01,Angle::DEGREES),
 FWHM_(0.1),
 include_preferred_orientation_(false),
 preferred_orientation_direction_( 0, 0, 0 ),
-crystal_structure_(crystal_structure)
+peak_shape_function_(0),
+peak_convolution_(DIRECT_SUMMATION),
+FFT_block_width_(5.0,Angle::DEGREES),
+structure_factor_summation_(SYMMETRY_ADAPTED),
+crystal_structure_(crystal_structure),
+atoms_stored_(atoms_stored),
+reflection_list_is_up_to_date_(false),
+structure_factors_are_up_to_date_(false)
 {
-    if ( ! crystal_structure.space_group_symmetry_has_been_applied() )
+    if ( ( atoms_stored_ == UNIT_CELL ) && ( ! crystal_structure.space_group_symmetry_has_been_applied() ) )
         throw std::runtime_error( "PowderPatternCalculator::PowderPatternCalculator( CrystalStructure ):: space-group symmetry has not been applied for input crystal structure." );
+    if ( ( atoms_stored_ == ASYMMETRIC_UNIT ) && crystal_structure.space_group_symmetry_has_been_applied() )
+        throw std::runtime_error( "PowderPatternCalculator::PowderPatternCalculator( CrystalStructure ):: space-group symmetry has been applied but the atoms are supposed to be the asymmetric unit." );
     laue_class_ = crystal_structure_.space_group().laue_class();
+    precalculate_symmetry_tables();
+}
+
+// ********************************************************************************
+
+void PowderPatternCalculator::set_wavelength( const double wavelength )
+{
+    if ( ( wavelength != wavelength_ ) || has_doublet() )
+        reflection_list_is_up_to_date_ = false;
+    wavelength_ = wavelength;
+    wavelength_2_ = 0.0;
+}
+
+// ********************************************************************************
+
+void PowderPatternCalculator::set_wavelength( const Wavelength & wavelength, const double intensity_ratio )
+{
+    const double wavelength_2 = ( wavelength.monochromated() || ( wavelength.wavelength_2() <= 0.0 ) || ( wavelength.wavelength_2() == wavelength.wavelength_1() ) ) ? 0.0 : wavelength.wavelength_2();
+    if ( ( wavelength.wavelength_1() != wavelength_ ) || ( wavelength_2 != wavelength_2_ ) )
+        reflection_list_is_up_to_date_ = false;
+    wavelength_ = wavelength.wavelength_1();
+    wavelength_2_ = wavelength_2;
+    doublet_intensity_ratio_ = intensity_ratio;
+}
+
+// ********************************************************************************
+
+void PowderPatternCalculator::set_radiation_type( const RadiationType radiation_type )
+{
+    if ( radiation_type != radiation_type_ )
+        structure_factors_are_up_to_date_ = false;
+    radiation_type_ = radiation_type;
+}
+
+// ********************************************************************************
+
+void PowderPatternCalculator::set_two_theta_end( const Angle two_theta_end )
+{
+    if ( two_theta_end != two_theta_end_ )
+        reflection_list_is_up_to_date_ = false;
+    two_theta_end_ = two_theta_end;
+    two_theta_segments_.clear();
+}
+
+// ********************************************************************************
+
+void PowderPatternCalculator::set_two_theta_grid( const PowderPattern & powder_pattern )
+{
+    if ( powder_pattern.size() < 2 )
+        throw std::runtime_error( "PowderPatternCalculator::set_two_theta_grid(): pattern must have at least two points." );
+    std::vector< TwoThetaSegment > two_theta_segments = powder_pattern.two_theta_segments();
+    two_theta_start_ = powder_pattern.two_theta_start();
+    if ( powder_pattern.two_theta_end() != two_theta_end_ )
+        reflection_list_is_up_to_date_ = false;
+    two_theta_end_ = powder_pattern.two_theta_end();
+    two_theta_step_ = two_theta_segments[0].two_theta_step_;
+    two_theta_segments_ = two_theta_segments;
+}
+
+// ********************************************************************************
+
+void PowderPatternCalculator::invalidate_reflection_list()
+{
+    laue_class_ = crystal_structure_.space_group().laue_class();
+    precalculate_symmetry_tables();
+    reflection_list_is_up_to_date_ = false;
 }
 
 // ********************************************************************************
@@ -204,11 +481,9 @@ crystal_structure_(crystal_structure)
 void PowderPatternCalculator::set_two_theta_step( const Angle two_theta_step )
 {
     two_theta_step_ = two_theta_step;
-    // There is an approximation in the calculation of the power pattern that expects the 2theta step to be small
+    two_theta_segments_.clear();
     if ( two_theta_step_ < Angle::from_degrees( 0.000001 ) )
          throw std::runtime_error( "PowderPatternCalculator::set_two_theta_step(): must be positive." );
-    if ( two_theta_step_ > Angle::from_degrees( 0.05 ) )
-        std::cout << "PowderPatternCalculator::set_two_theta_step(): Warning: because of an internal approximation, 2theta step is expected to be small." << std::endl;
 }
 
 // ********************************************************************************
@@ -220,18 +495,19 @@ void PowderPatternCalculator::set_preferred_orientation( const MillerIndices & m
     r_ = r;
     // Check that the PO direction is commensurate with the space-group symmetry
     MillerIndices reflection( 37, -117, 3 );
-    Vector3D PO_vector = reciprocal_lattice_point( preferred_orientation_direction_, crystal_structure_.crystal_lattice() );
-    Vector3D H = reciprocal_lattice_point( reflection, crystal_structure_.crystal_lattice() );
+    const ReciprocalBasis reciprocal_basis( crystal_structure_.crystal_lattice() );
+    Vector3D PO_vector = reciprocal_basis.point( preferred_orientation_direction_ );
+    Vector3D H = reciprocal_basis.point( reflection );
     double reference_dot_product = std::fabs( PO_vector * H );
     for ( size_t i( 0 ); i != laue_class_.nsymmetry_operators(); ++i )
     {
         MillerIndices equivalent_reflection = reflection * laue_class_.symmetry_operator( i );
         // Now check that the March-Dollase PO corrections are the same for all of them
-        Vector3D H = reciprocal_lattice_point( equivalent_reflection, crystal_structure_.crystal_lattice() );
+        Vector3D H = reciprocal_basis.point( equivalent_reflection );
         double current_dot_product = std::fabs( PO_vector * H );
         if ( ! nearly_equal( current_dot_product, reference_dot_product ) )
         {
-            std::cout << "PowderPatternCalculator::set_preferred_orientation(): Warning: PO direction is not commensurate with space-group symmetry." << std::endl;
+            log_warning( "PowderPatternCalculator::set_preferred_orientation(): Warning: PO direction is not commensurate with space-group symmetry." );
             return;
         }
     }
@@ -241,8 +517,11 @@ void PowderPatternCalculator::set_preferred_orientation( const MillerIndices & m
 
 void PowderPatternCalculator::calculate( PowderPattern & powder_pattern )
 {
-    calculate_reflection_list();
-    calculate_structure_factors();
+    MACRO_SCOPED_TIMER( "PowderPatternCalculator::calculate()" );
+    if ( ! reflection_list_is_up_to_date() )
+        calculate_reflection_list();
+    if ( ! structure_factors_are_up_to_date_ )
+        calculate_structure_factors();
     calculate_powder_pattern( powder_pattern );
 }
 
@@ -250,12 +529,17 @@ void PowderPatternCalculator::calculate( PowderPattern & powder_pattern )
 
 void PowderPatternCalculator::calculate_reflection_list( const bool exact )
 {
+    MACRO_SCOPED_TIMER( "PowderPatternCalculator::calculate_reflection_list()" );
     // Get a list of all reflections
     // As in Mercury, we ignore two_theta_start_ here
 //    std::cout << "Now generating reflection list... " << std::endl;
+    reflection_list_ = ReflectionList();
     // We add a little extra at the end to avoid cut-off effects
+    // With a doublet, the shorter wavelength determines which reflections fall below two_theta_end_ and the longer one which fall above two_theta_start_
+    const double shortest_wavelength = has_doublet() ? std::min( wavelength_, wavelength_2_ ) : wavelength_;
+    const double longest_wavelength  = has_doublet() ? std::max( wavelength_, wavelength_2_ ) : wavelength_;
     Angle theta_end( ( two_theta_end_ / 2.0 ) + Angle::from_degrees( 1.0 ) );
-    double one_over_d_min = ( 2.0 * theta_end.sine() ) / wavelength_;
+    double one_over_d_min = ( 2.0 * theta_end.sine() ) / shortest_wavelength;
     double l_max_z = one_over_d_min / crystal_structure_.crystal_lattice().c_star_vector().z();
     double k_max_y = one_over_d_min / crystal_structure_.crystal_lattice().b_star_vector().y();
     double l_max_y = -k_max_y * ( crystal_structure_.crystal_lattice().b_star_vector().z() / crystal_structure_.crystal_lattice().c_star_vector().z() );
@@ -266,9 +550,7 @@ void PowderPatternCalculator::calculate_reflection_list( const bool exact )
     double h_max =           fabs( h_max_x );
     double k_max = std::max( fabs( k_max_x ),           fabs( k_max_y ) );
     double l_max = std::max( fabs( l_max_x ), std::max( fabs( l_max_y ), fabs( l_max_z ) ) );
-    // @@ This can be made more efficient because -h, -k, -l is never needed if programmed properly.
     int h_upper = round_to_int( h_max ) + 1;
-    int h_lower = -h_upper;
     int k_upper = round_to_int( k_max ) + 1;
     int k_lower = -k_upper;
     int l_upper = round_to_int( l_max ) + 1;
@@ -277,122 +559,268 @@ void PowderPatternCalculator::calculate_reflection_list( const bool exact )
     // This can be improved (current numbers are wrong)
     size_t cube_size = (2*h_upper+1) * (2*k_upper+1) * (l_upper+1);
     size_t sphere_size = static_cast<size_t>( cube_size/2.0 );
-    reflection_list_.reserve( sphere_size );
-    for ( int h(h_lower); h <= h_upper; ++h )
+    reflection_list_.reserve( sphere_size / laue_class_.nsymmetry_operators() );
+    const CrystalLattice & crystal_lattice = crystal_structure_.crystal_lattice();
+    const Vector3D a_star_vector = crystal_lattice.a_star_vector();
+    const Vector3D b_star_vector = crystal_lattice.b_star_vector();
+    const Vector3D c_star_vector = crystal_lattice.c_star_vector();
+    const ReciprocalBasis reciprocal_basis( crystal_lattice );
+    // Stored for the preferred-orientation correction
+    std::vector< MillerIndices > equivalent_reflections;
+    std::vector< Vector3D > equivalent_directions;
+    // |H|^2 of one row of l values at a time, screened against the largest |H|^2 that can pass the 2theta tests below.
+    // The screen has a small margin, the 2theta tests themselves are unchanged.
+    std::vector< double > lengths2( l_upper - l_lower + 1 );
+    const Angle largest_two_theta = exact ? two_theta_end_ : two_theta_end_ + Angle::from_degrees( 0.1 );
+    const double largest_sine_theta = ( largest_two_theta < Angle::from_degrees( 180.0 ) ) ? ( largest_two_theta / 2.0 ).sine() : 1.0;
+    const double largest_length2 = square( 2.0 * largest_sine_theta / shortest_wavelength ) * ( 1.0 + 1.0E-9 );
+    // The Laue class always contains the inversion, so (hkl) and (-h-k-l) are always equivalent.
+    // The representative reflection is the largest one according to operator<( MillerIndices, MillerIndices ),
+    // which is always in the half space h > 0, or h = 0 and k > 0, or h = k = 0 and l > 0. The other half is never visited.
+    for ( int h( 0 ); h <= h_upper; ++h )
     {
-        for ( int k(k_lower); k <= k_upper; ++k )
+        for ( int k( ( h == 0 ) ? 0 : k_lower ); k <= k_upper; ++k )
         {
-            for ( int l(l_lower); l <= l_upper; ++l )
+            const int l_first = ( ( h == 0 ) && ( k == 0 ) ) ? 1 : l_lower;
+            reciprocal_basis.lengths2( h, k, l_first, l_upper - l_first + 1, &lengths2[0] );
+            for ( int l( l_first ); l <= l_upper; ++l )
             {
-                MillerIndices current_reflection( h, k, l );
-                if ( current_reflection.is_000() )
-                    continue;
-                if ( is_systematic_absence( current_reflection ) )
+                // The 2theta test is cheap, so do it first
+                const double length2 = lengths2[ l - l_first ];
+                if ( length2 > largest_length2 )
                     continue;
-                // Get a list of all equivalent reflections
-                std::set< MillerIndices > equivalent_reflections = calculate_equivalent_reflections( current_reflection );
-                // Only keep the first one
-                if ( ! ( current_reflection == *equivalent_reflections.begin() ) )
-                    continue;
-                Vector3D H = reciprocal_lattice_point( current_reflection, crystal_structure_.crystal_lattice() );
-                double d = 1.0 / ( H.length() );
+                double d = 1.0 / std::sqrt( length2 );
                 // Some of the reflections that are generated lead to asin( x ) with x > 1.0, which is an ERROR.
-                if ( wavelength_ > 2.0 * d )
+                if ( shortest_wavelength > 2.0 * d )
                     continue;
-                Angle two_theta = 2.0 * arcsine( wavelength_ / ( 2.0 * d ) );
+                Angle two_theta = 2.0 * arcsine( shortest_wavelength / ( 2.0 * d ) );
                 if ( exact )
                 {
-                    if ( ( two_theta >= two_theta_start_ ) && ( two_theta <= two_theta_end_ ) )
-                        reflection_list_.push_back( current_reflection, 1.0, d, equivalent_reflections.size() );
+                    if ( two_theta > two_theta_end_ )
+                        continue;
+                    if ( ( longest_wavelength < 2.0 * d ) && ( 2.0 * arcsine( longest_wavelength / ( 2.0 * d ) ) < two_theta_start_ ) )
+                        continue;
                 }
                 else
                 {
-                    if ( two_theta < ( two_theta_end_ + Angle::from_degrees( 0.1 ) ) )
-                        reflection_list_.push_back( current_reflection, 1.0, d, equivalent_reflections.size() );
+                    if ( two_theta >= ( two_theta_end_ + Angle::from_degrees( 0.1 ) ) )
+                        continue;
                 }
+                // Only keep the representative reflection, the multiplicity follows from the number of operators that leave the reflection invariant
+                size_t nstabilisers( 0 );
+                if ( ! is_representative_reflection( h, k, l, nstabilisers ) )
+                    continue;
+                MillerIndices current_reflection( h, k, l );
+                if ( is_systematic_absence( current_reflection ) )
+                    continue;
+                calculate_equivalent_directions( current_reflection, laue_class_rotations_, a_star_vector, b_star_vector, c_star_vector, equivalent_reflections, equivalent_directions );
+                reflection_list_.push_back( current_reflection, 1.0, d, laue_class_.nsymmetry_operators() / nstabilisers, equivalent_directions );
             }
         }
     }
+    // The reflections are generated in hkl order, sort them once
+    reflection_list_.finalise();
+    MACRO_COUNT( "reflections generated", reflection_list_.size() );
+    // calculate() needs the list with the extra reflections
+    reflection_list_is_up_to_date_ = ( ! exact );
+    structure_factors_are_up_to_date_ = false;
+    reflection_list_crystal_lattice_ = crystal_lattice;
 //    reflection_list_.save( "C:\\Data\\for_testing\\PY110.hkl" );
 }
 
 // ********************************************************************************
 
+void PowderPatternCalculator::set_reflection_list( const ReflectionList & reflection_list )
+{
+    reflection_list_ = reflection_list;
+    reflection_list_.finalise();
+    reflection_list_is_up_to_date_ = true;
+    structure_factors_are_up_to_date_ = false;
+    reflection_list_crystal_lattice_ = crystal_structure_.crystal_lattice();
+}
+
+// ********************************************************************************
+
 void PowderPatternCalculator::calculate_structure_factors()
 {
+    MACRO_SCOPED_TIMER( "PowderPatternCalculator::calculate_structure_factors()" );
+    if ( structure_factor_summation_ == REFERENCE )
+    {
+        calculate_structure_factors_reference();
+        return;
+    }
 //    std::cout << "Now calculating F^2 values... " << std::endl;
-    // For each reflection, calculate an intensity
-    for ( size_t i( 0 ); i != reflection_list_.size(); ++i )
+    // Build the structure-of-arrays atom table once, the inner loop then only touches plain arrays
+    const bool asymmetric_unit = ( atoms_stored_ == ASYMMETRIC_UNIT );
+    AtomTable atom_table( crystal_structure_, asymmetric_unit );
+    std::vector< double > scattering_factors( atom_table.elements_.size() );
+    std::vector< double > temperature_factors( atom_table.ntemperature_factors() );
+    std::vector< Matrix3D > rotations;
+    std::vector< Vector3D > translations;
+    const bool cosine_only = structure_factor_symmetry_operators( rotations, translations );
+    cosine_terms_.assign( reflection_list_.size(), 0.0 );
+    sine_terms_.assign( reflection_list_.size(), 0.0 );
+    // The scattering factor only depends on the element and on sin(theta)/lambda, so calculate it once for each element,
+    // for neutrons it does not depend on sin(theta)/lambda at all and is calculated once
+    const bool per_reflection = scattering_factor_depends_on_angle( radiation_type_ );
+    if ( ! per_reflection )
     {
-        MillerIndices miller_indices( reflection_list_.miller_indices( i ) );
-        int h = miller_indices.h();
-        int k = miller_indices.k();
-        int l = miller_indices.l();
-        double d = reflection_list_.d_spacing( i );
-        double sine_theta_over_lambda = 1.0 / ( 2.0 * d );
-        double cosine_term( 0.0 );
-        double sine_term( 0.0 );
-        // This can be sped up by sorting the list into lists of atoms of the same element
-        double f0_H = Element( 1 ).scattering_factor( sine_theta_over_lambda );
-        double f0_C = Element( 6 ).scattering_factor( sine_theta_over_lambda );
-        double f0_N = Element( 7 ).scattering_factor( sine_theta_over_lambda );
-        double f0_O = Element( 8 ).scattering_factor( sine_theta_over_lambda );
-        for ( size_t j( 0 ); j != crystal_structure_.natoms(); ++j )
+        for ( size_t j( 0 ); j != scattering_factors.size(); ++j )
+            scattering_factors[j] = atom_table.elements_[j].scattering_factor( 0.0, radiation_type_ );
+    }
+    // Reading the list must not sort it while the threads are running
+    reflection_list_.finalise();
+    // Each block of reflections has its own work space, the reflections are independent so the result does not depend on the number of threads
+    const size_t nblocks = ( reflection_list_.size() + reflections_per_block - 1 ) / reflections_per_block;
+    parallel_for( nblocks, nthreads_, [&]( const size_t b )
+    {
+        AtomTable block_atom_table( atom_table );
+        std::vector< double > block_scattering_factors( scattering_factors );
+        std::vector< double > block_temperature_factors( temperature_factors );
+        const size_t end = std::min( ( b + 1 ) * reflections_per_block, reflection_list_.size() );
+        for ( size_t i( b * reflections_per_block ); i != end; ++i )
         {
-            double x = crystal_structure_.atom(j).position().x();
-            double y = crystal_structure_.atom(j).position().y();
-            double z = crystal_structure_.atom(j).position().z();
-            Angle argument = Angle::from_radians( 2.0 * CONSTANT_PI * ( h*x + k*y + l*z ) );
-            // Get the scattering factor from 2theta, the wavelength and the element of the atom
-            double f0;
-            switch ( crystal_structure_.atom(j).element().atomic_number() )
-            {
-                case  1 : f0 = f0_H; break;
-                case  6 : f0 = f0_C; break;
-                case  7 : f0 = f0_N; break;
-                case  8 : f0 = f0_O; break;
-                default : f0 = crystal_structure_.atom(j).element().scattering_factor( sine_theta_over_lambda );
-            }
-            f0 *= crystal_structure_.atom(j).occupancy();
-//            if ( ! nearly_equal( crystal_structure_.atom(j).occupancy(), 1.0 ) )
-//                std::cout << "occ = " << crystal_structure_.atom(j).occupancy() << std::endl;
-            // The Debije-Waller factor
-            double T( 1.0 );
-            if ( crystal_structure_.atom(j).ADPs_type() == Atom::ANISOTROPIC )
+            MillerIndices miller_indices( reflection_list_.miller_indices( i ) );
+            double d = reflection_list_.d_spacing( i );
+            double sine_theta_over_lambda = 1.0 / ( 2.0 * d );
+            if ( per_reflection )
             {
-                AnisotropicDisplacementParameters ADPs = crystal_structure_.atom(j).anisotropic_displacement_parameters();
-                T = exp( -2.0 * square( CONSTANT_PI ) * ( miller_indices * ADPs.U_star( crystal_structure_.crystal_lattice() ) * miller_indices ) );
+                for ( size_t j( 0 ); j != block_scattering_factors.size(); ++j )
+                    block_scattering_factors[j] = block_atom_table.elements_[j].scattering_factor( sine_theta_over_lambda, radiation_type_ );
             }
-            else if ( crystal_structure_.atom(j).ADPs_type() == Atom::ISOTROPIC )
+            double cosine_term( 0.0 );
+            double sine_term( 0.0 );
+            for ( size_t j( 0 ); j != rotations.size(); ++j )
             {
-                T = exp( -8.0 * square( CONSTANT_PI ) * crystal_structure_.atom(j).Uiso() * square( sine_theta_over_lambda ) );
+                // h.( Rx + t ) = ( hR ).x + h.t
+                MillerIndices rotated_miller_indices = miller_indices * rotations[j];
+                // The Debije-Waller factors
+                block_atom_table.calculate_temperature_factors( rotated_miller_indices, sine_theta_over_lambda, block_temperature_factors );
+                block_atom_table.add_contributions( rotated_miller_indices, miller_indices * translations[j], block_scattering_factors, block_temperature_factors, cosine_only, cosine_term, sine_term );
             }
-            else
+            cosine_terms_[i] = cosine_term;
+            sine_terms_[i] = sine_term;
+            if ( cosine_only )
+                cosine_term *= 2.0;
+            double F_squared = square( cosine_term ) + square( sine_term );
+            reflection_list_.set_F_squared( i, F_squared );
+        }
+    } );
+    MACRO_COUNT( "atom-reflection pairs", reflection_list_.size() * rotations.size() * atom_table.x_.size() );
+    positions_.resize( crystal_structure_.natoms() );
+    for ( size_t i( 0 ); i != crystal_structure_.natoms(); ++i )
+        positions_[i] = crystal_structure_.atom( i ).position();
+    structure_factors_are_up_to_date_ = true;
+//    reflection_list_.save( FileName( "C:\\Data_Win\\ReflectionList_Cpp.hkl" ) );
+}
+
+// ********************************************************************************
+
+void PowderPatternCalculator::calculate_structure_factors_reference()
+{
+    CrystalStructure unit_cell( crystal_structure_ );
+    if ( atoms_stored_ == ASYMMETRIC_UNIT )
+        unit_cell.apply_space_group_symmetry();
+    reflection_list_.finalise();
+    parallel_for( reflection_list_.size(), nthreads_, [&]( const size_t i )
+    {
+        reflection_list_.set_F_squared( i, reference_F_squared( unit_cell, reflection_list_.miller_indices( i ), reflection_list_.d_spacing( i ), radiation_type_ ) );
+    } );
+    // There are no partial sums that update_structure_factors() could start from
+    cosine_terms_.clear();
+    sine_terms_.clear();
+    positions_.resize( crystal_structure_.natoms() );
+    for ( size_t i( 0 ); i != crystal_structure_.natoms(); ++i )
+        positions_[i] = crystal_structure_.atom( i ).position();
+    structure_factors_are_up_to_date_ = true;
+}
+
+// ********************************************************************************
+
+void PowderPatternCalculator::update_structure_factors( const std::vector< size_t > & moved_atoms )
+{
+    MACRO_SCOPED_TIMER( "PowderPatternCalculator::update_structure_factors()" );
+    if ( ! reflection_list_is_up_to_date() )
+        calculate_reflection_list();
+    if ( ( ! structure_factors_are_up_to_date_ ) ||
+         ( cosine_terms_.size() != reflection_list_.size() ) ||
+         ( positions_.size() != crystal_structure_.natoms() ) )
+    {
+        calculate_structure_factors();
+        return;
+    }
+    if ( moved_atoms.empty() )
+        return;
+    for ( size_t i( 0 ); i != moved_atoms.size(); ++i )
+    {
+        if ( moved_atoms[i] >= crystal_structure_.natoms() )
+            throw std::runtime_error( "PowderPatternCalculator::update_structure_factors(): atom index out of range." );
+    }
+    const bool asymmetric_unit = ( atoms_stored_ == ASYMMETRIC_UNIT );
+    // The old contributions are calculated from the positions used in the previous calculation, the new ones from the current positions
+    std::vector< Vector3D > old_positions( moved_atoms.size() );
+    std::vector< Vector3D > new_positions( moved_atoms.size() );
+    for ( size_t i( 0 ); i != moved_atoms.size(); ++i )
+    {
+        old_positions[i] = positions_[ moved_atoms[i] ];
+        new_positions[i] = crystal_structure_.atom( moved_atoms[i] ).position();
+    }
+    AtomTable old_atom_table( crystal_structure_, asymmetric_unit, moved_atoms, old_positions );
+    AtomTable new_atom_table( crystal_structure_, asymmetric_unit, moved_atoms, new_positions );
+    std::vector< double > scattering_factors( old_atom_table.elements_.size() );
+    std::vector< double > old_temperature_factors( old_atom_table.ntemperature_factors() );
+    std::vector< double > new_temperature_factors( new_atom_table.ntemperature_factors() );
+    std::vector< Matrix3D > rotations;
+    std::vector< Vector3D > translations;
+    const bool cosine_only = structure_factor_symmetry_operators( rotations, translations );
+    // Both tables contain the same atoms, so they have the same elements
+    const bool per_reflection = scattering_factor_depends_on_angle( radiation_type_ );
+    if ( ! per_reflection )
+    {
+        for ( size_t j( 0 ); j != scattering_factors.size(); ++j )
+            scattering_factors[j] = old_atom_table.elements_[j].scattering_factor( 0.0, radiation_type_ );
+    }
+    reflection_list_.finalise();
+    const size_t nblocks = ( reflection_list_.size() + reflections_per_block - 1 ) / reflections_per_block;
+    parallel_for( nblocks, nthreads_, [&]( const size_t b )
+    {
+        AtomTable block_old_atom_table( old_atom_table );
+        AtomTable block_new_atom_table( new_atom_table );
+        std::vector< double > block_scattering_factors( scattering_factors );
+        std::vector< double > block_old_temperature_factors( old_temperature_factors );
+        std::vector< double > block_new_temperature_factors( new_temperature_factors );
+        const size_t end = std::min( ( b + 1 ) * reflections_per_block, reflection_list_.size() );
+        for ( size_t i( b * reflections_per_block ); i != end; ++i )
+        {
+            MillerIndices miller_indices( reflection_list_.miller_indices( i ) );
+            double sine_theta_over_lambda = 1.0 / ( 2.0 * reflection_list_.d_spacing( i ) );
+            if ( per_reflection )
             {
-                // This is what Mercury does according to the manual
-                if ( crystal_structure_.atom(j).element().atomic_number() == 1 )
-                    T = exp( -8.0 * square( CONSTANT_PI ) * 0.06 * square( sine_theta_over_lambda ) );
-                else
-                    T = exp( -8.0 * square( CONSTANT_PI ) * 0.05 * square( sine_theta_over_lambda ) );
+                for ( size_t j( 0 ); j != block_scattering_factors.size(); ++j )
+                    block_scattering_factors[j] = block_old_atom_table.elements_[j].scattering_factor( sine_theta_over_lambda, radiation_type_ );
             }
-            double sine;
-            double cosine;
-            bool use_sincos = true;
-            if ( use_sincos )
-                sincos( argument, sine, cosine );
-            else
+            double old_cosine_term( 0.0 );
+            double old_sine_term( 0.0 );
+            double new_cosine_term( 0.0 );
+            double new_sine_term( 0.0 );
+            for ( size_t j( 0 ); j != rotations.size(); ++j )
             {
-                sine   = argument.sine();
-                cosine = argument.cosine();
+                MillerIndices rotated_miller_indices = miller_indices * rotations[j];
+                const double phase_offset = miller_indices * translations[j];
+                block_old_atom_table.calculate_temperature_factors( rotated_miller_indices, sine_theta_over_lambda, block_old_temperature_factors );
+                block_old_atom_table.add_contributions( rotated_miller_indices, phase_offset, block_scattering_factors, block_old_temperature_factors, cosine_only, old_cosine_term, old_sine_term );
+                block_new_atom_table.calculate_temperature_factors( rotated_miller_indices, sine_theta_over_lambda, block_new_temperature_factors );
+                block_new_atom_table.add_contributions( rotated_miller_indices, phase_offset, block_scattering_factors, block_new_temperature_factors, cosine_only, new_cosine_term, new_sine_term );
             }
-      //      T = 1.0;
-            sine_term += T * f0 * sine;
-            cosine_term += T * f0 * cosine;
+            cosine_terms_[i] += new_cosine_term - old_cosine_term;
+            sine_terms_[i] += new_sine_term - old_sine_term;
+            double cosine_term = cosine_only ? 2.0 * cosine_terms_[i] : cosine_terms_[i];
+            reflection_list_.set_F_squared( i, square( cosine_term ) + square( sine_terms_[i] ) );
         }
-        double F_squared = square( cosine_term ) + square( sine_term );
-        reflection_list_.set_F_squared( i, F_squared );
-    }
-//    reflection_list_.save( FileName( "C:\\Data_Win\\ReflectionList_Cpp.hkl" ) );
+    } );
+    MACRO_COUNT( "atom-reflection pairs", 2 * reflection_list_.size() * rotations.size() * moved_atoms.size() );
+    for ( size_t i( 0 ); i != moved_atoms.size(); ++i )
+        positions_[ moved_atoms[i] ] = new_positions[i];
 }
 
 // ********************************************************************************
@@ -401,6 +829,10 @@ void PowderPatternCalculator::set_structure_factors_to_1()
 {
     for ( size_t i( 0 ); i != reflection_list_.size(); ++i )
         reflection_list_.set_F_squared( i, 1.0 );
+    // There are no partial sums that update_structure_factors() could start from
+    cosine_terms_.clear();
+    sine_terms_.clear();
+    structure_factors_are_up_to_date_ = true;
 }
 
 // ********************************************************************************
@@ -414,49 +846,87 @@ void PowderPatternCalculator::calculate_powder_pattern( PowderPattern & powder_p
 
 void PowderPatternCalculator::calculate( const ReflectionList & reflection_list, PowderPattern & powder_pattern )
 {
-    powder_pattern = PowderPattern( two_theta_start_, two_theta_end_, two_theta_step_ );
-    // Calculate one peak with area 1.0
-    std::vector< double > peak_points = peak_shape( two_theta_step_, FWHM_ );
+    MACRO_SCOPED_TIMER( "PowderPatternCalculator::calculate( ReflectionList )" );
+    if ( two_theta_segments_.empty() )
+        powder_pattern = PowderPattern( two_theta_start_, two_theta_end_, two_theta_step_ );
+    else
+        powder_pattern = PowderPattern( two_theta_segments_ );
+    // Each segment has a constant step, so the peaks are added one segment at a time
+    const std::vector< TwoThetaSegment > segments = powder_pattern.two_theta_segments();
+    PseudoVoigtPeakShape default_peak_shape_function( FWHM_, 0.9 );
+    const PeakShapeFunction & peak_shape_function = peak_shape_function_ ? *peak_shape_function_ : default_peak_shape_function;
+    const ReciprocalBasis reciprocal_basis( crystal_structure_.crystal_lattice() );
     Vector3D PO_vector;
     if ( include_preferred_orientation_ )
-        PO_vector = reciprocal_lattice_point( preferred_orientation_direction_, crystal_structure_.crystal_lattice() );
+    {
+        PO_vector = reciprocal_basis.point( preferred_orientation_direction_ );
+        PO_vector /= PO_vector.length();
+    }
+    // Only used for FFT
+    std::vector< Angle > two_thetas;
+    std::vector< double > peak_intensities;
     // For each reflection, convolute it with a peak shape
     for ( size_t i( 0 ); i != reflection_list.size(); ++i )
     {
         double d = reflection_list.d_spacing( i );
-        Angle theta = arcsine( wavelength_ / ( 2.0 * d ) );
-        Angle two_theta = 2.0 * theta;
-        int peak_centre = round_to_int( ( two_theta - two_theta_start_ ) / two_theta_step_ );
-        int index_offset = peak_centre - ((static_cast<int>(peak_points.size())-1)/2);
+        // With a doublet, a reflection may only exist for the shorter wavelength
+        const bool has_first_peak = ( wavelength_ < 2.0 * d );
+        const bool has_second_peak = has_doublet() && ( wavelength_2_ < 2.0 * d );
+        if ( ( ! has_first_peak ) && ( ! has_second_peak ) )
+            continue;
         double multiplicity( 0.0 );
         if ( include_preferred_orientation_ )
         {
       //      std::cout << "PO is included" << std::endl;
-            std::set< MillerIndices > equivalent_reflections = calculate_equivalent_reflections( reflection_list.miller_indices( i ) );
-            for ( std::set< MillerIndices >::const_iterator it( equivalent_reflections.begin() ); it != equivalent_reflections.end(); ++it )
+            if ( reflection_list.nequivalent_directions( i ) != 0 )
             {
-                Vector3D H = reciprocal_lattice_point( *it, crystal_structure_.crystal_lattice() );
-                Angle alpha = angle( PO_vector, H );
-                multiplicity += std::pow( square(r_) * square(alpha.cosine()) + square(alpha.sine())/r_, -3.0/2.0 );
+                for ( size_t j( 0 ); j != reflection_list.nequivalent_directions( i ); ++j )
+                {
+                    double cosine_squared = square( PO_vector * reflection_list.equivalent_direction( i, j ) );
+                    multiplicity += std::pow( square(r_) * cosine_squared + ( 1.0 - cosine_squared )/r_, -3.0/2.0 );
+                }
+            }
+            else // E.g. a reflection list that was read from file
+            {
+                const SmallVector< MillerIndices, 48 > equivalent_reflections = calculate_equivalent_reflections( reflection_list.miller_indices( i ) );
+                for ( SmallVector< MillerIndices, 48 >::const_iterator it( equivalent_reflections.begin() ); it != equivalent_reflections.end(); ++it )
+                {
+                    Vector3D H = reciprocal_basis.point( *it );
+                    Angle alpha = angle( PO_vector, H );
+                    multiplicity += std::pow( square(r_) * square(alpha.cosine()) + square(alpha.sine())/r_, -3.0/2.0 );
+                }
             }
         }
         else
             multiplicity = reflection_list.multiplicity( i );
-        double peak_intensity = reflection_list.F_squared( i ) * multiplicity;
-        // Multiply by the LP factor
-        double LP_factor = ( 1.0 + square( two_theta.cosine() ) ) / ( 2.0 * two_theta.sine() * theta.sine() );
-        peak_intensity *= LP_factor;
-        for ( size_t j ( 0 ); j != peak_points.size(); ++j )
+        const double F_squared_times_multiplicity = reflection_list.F_squared( i ) * multiplicity;
+        for ( size_t j( 0 ); j != 2; ++j )
         {
-            // Calculate new index
-            int index = index_offset + j;
-            if ( ( index < 0 ) || ( index >= powder_pattern.size() ) )
+            if ( ! ( ( j == 0 ) ? has_first_peak : has_second_peak ) )
                 continue;
-            double intensity = powder_pattern.intensity( index );
-            intensity += peak_intensity * peak_points[j];
-            powder_pattern.set_intensity( index, intensity );
+            Angle theta = arcsine( ( ( j == 0 ) ? wavelength_ : wavelength_2_ ) / ( 2.0 * d ) );
+            Angle two_theta = 2.0 * theta;
+            double peak_intensity = ( j == 0 ) ? F_squared_times_multiplicity : doublet_intensity_ratio_ * F_squared_times_multiplicity;
+            // Multiply by the LP factor
+            double LP_factor = ( 1.0 + square( two_theta.cosine() ) ) / ( 2.0 * two_theta.sine() * theta.sine() );
+            peak_intensity *= LP_factor;
+            if ( peak_convolution_ == DIRECT_SUMMATION )
+            {
+                for ( size_t k( 0 ); k != segments.size(); ++k )
+                    add_peak( powder_pattern.intensities() + segments[k].first_point_, segments[k].npoints_, segments[k].two_theta_start_, segments[k].two_theta_step_, two_theta, peak_intensity, peak_shape_function );
+            }
+            else
+            {
+                two_thetas.push_back( two_theta );
+                peak_intensities.push_back( peak_intensity );
+            }
         }
     }
+    if ( peak_convolution_ == FFT )
+    {
+        for ( size_t k( 0 ); k != segments.size(); ++k )
+            add_peaks_by_FFT( powder_pattern.intensities() + segments[k].first_point_, segments[k].npoints_, segments[k].two_theta_start_, segments[k].two_theta_step_, FFT_block_width_, two_thetas, peak_intensities, peak_shape_function );
+    }
     powder_pattern.normalise_highest_peak();
     powder_pattern.recalculate_estimated_standard_deviations();
     powder_pattern.set_wavelength( wavelength_ );
@@ -467,56 +937,75 @@ void PowderPatternCalculator::calculate( const ReflectionList & reflection_list,
 void PowderPatternCalculator::calculate_for_testing( PowderPattern & powder_pattern )
 {
     powder_pattern = PowderPattern( two_theta_start_, two_theta_end_, two_theta_step_ );
-    // Calculate one peak with area 1.0
-    std::vector< double > peak_points = peak_shape( two_theta_step_, FWHM_ );
-    // For each reflection, convolute it with a peak shape
-    {
-    Angle two_theta = Angle::from_degrees( 12.5 );
-    int peak_centre = round_to_int( ( two_theta - two_theta_start_ ) / two_theta_step_ );
-    int index_offset = peak_centre - ((static_cast<int>(peak_points.size())-1)/2);
-    double peak_intensity = 100.0;
-    for ( int j ( 0 ); j != peak_points.size(); ++j )
+    PseudoVoigtPeakShape default_peak_shape_function( FWHM_, 0.9 );
+    const PeakShapeFunction & peak_shape_function = peak_shape_function_ ? *peak_shape_function_ : default_peak_shape_function;
+    add_peak( powder_pattern.intensities(), powder_pattern.size(), two_theta_start_, two_theta_step_, Angle::from_degrees( 12.5 ), 100.0, peak_shape_function );
+    add_peak( powder_pattern.intensities(), powder_pattern.size(), two_theta_start_, two_theta_step_, Angle::from_degrees( 27.5 ),  10.0, peak_shape_function );
+    powder_pattern.normalise_highest_peak();
+    powder_pattern.recalculate_estimated_standard_deviations();
+    powder_pattern.set_wavelength( wavelength_ );
+}
+
+// ********************************************************************************
+
+bool PowderPatternCalculator::structure_factor_symmetry_operators( std::vector< Matrix3D > & rotations, std::vector< Vector3D > & translations ) const
+{
+    rotations.clear();
+    translations.clear();
+    if ( atoms_stored_ == UNIT_CELL )
     {
-        // Calculate new index
-        int index = index_offset + j;
-        if ( ( index < 0 ) || ( index >= powder_pattern.size() ) )
-            continue;
-        double intensity = powder_pattern.intensity( index );
-        intensity += peak_intensity * peak_points[j];
-        powder_pattern.set_intensity( index, intensity );
+        rotations.push_back( Matrix3D() );
+        translations.push_back( Vector3D() );
+        return false;
     }
-    }
-    {
-    Angle two_theta = Angle::from_degrees( 27.5 );
-    int peak_centre = round_to_int( ( two_theta - two_theta_start_ ) / two_theta_step_ );
-    int index_offset = peak_centre - ((static_cast<int>(peak_points.size())-1)/2);
-    double peak_intensity = 10.0;
-    for ( int j ( 0 ); j != peak_points.size(); ++j )
+    // For the asymmetric unit, we sum over the symmetry operators explicitly.
+    // With an inversion centre at the origin, the symmetry operators S and -S give complex-conjugate contributions,
+    // so only one of each pair is needed and only the cosine terms survive.
+    const SpaceGroup & space_group = crystal_structure_.space_group();
+    const bool cosine_only = space_group.has_inversion_at_origin();
+    std::vector< SymmetryOperator > representatives;
+    const SymmetryOperator inversion( Matrix3D( -1.0 ), Vector3D() );
+    for ( size_t i( 0 ); i != space_group.nsymmetry_operators(); ++i )
     {
-        // Calculate new index
-        int index = index_offset + j;
-        if ( ( index < 0 ) || ( index >= powder_pattern.size() ) )
-            continue;
-        double intensity = powder_pattern.intensity( index );
-        intensity += peak_intensity * peak_points[j];
-        powder_pattern.set_intensity( index, intensity );
-    }
+        const SymmetryOperator & symmetry_operator = space_group.symmetry_operator( i );
+        if ( cosine_only )
+        {
+            SymmetryOperator partner = inversion * symmetry_operator;
+            bool found( false );
+            for ( size_t j( 0 ); j != representatives.size(); ++j )
+            {
+                if ( nearly_equal( partner, representatives[j] ) )
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if ( found )
+                continue;
+        }
+        representatives.push_back( symmetry_operator );
+        rotations.push_back( symmetry_operator.rotation() );
+        translations.push_back( symmetry_operator.translation() );
     }
-    powder_pattern.normalise_highest_peak();
-    powder_pattern.recalculate_estimated_standard_deviations();
-    powder_pattern.set_wavelength( wavelength_ );
+    return cosine_only;
 }
 
 // ********************************************************************************
 
 bool PowderPatternCalculator::is_systematic_absence( const MillerIndices H ) const
 {
+    const int h = H.h();
+    const int k = H.k();
+    const int l = H.l();
     // Note that we skip the first symmetry operator, which is guaranteed to be the identity
-    for ( size_t i( 1 ); i != crystal_structure_.space_group().nsymmetry_operators(); ++i )
+    for ( size_t i( 1 ); i < space_group_translations_.size(); ++i )
     {
-        if ( H*crystal_structure_.space_group().symmetry_operator(i).rotation() == H )
+        const int * R = &space_group_rotations_[9*i];
+        if ( ( h * R[0] + k * R[3] + l * R[6] == h ) &&
+             ( h * R[1] + k * R[4] + l * R[7] == k ) &&
+             ( h * R[2] + k * R[5] + l * R[8] == l ) )
         {
-            double HT( H * crystal_structure_.space_group().symmetry_operator(i).translation() );
+            double HT( H * space_group_translations_[i] );
             if ( ! nearly_equal( HT, round_to_int( HT ), 0.05 ) )
             {
                 return true;
@@ -528,11 +1017,96 @@ bool PowderPatternCalculator::is_systematic_absence( const MillerIndices H ) con
 
 // ********************************************************************************
 
-std::set< MillerIndices > PowderPatternCalculator::calculate_equivalent_reflections( const MillerIndices miller_indices ) const
+bool PowderPatternCalculator::reflection_list_is_up_to_date() const
+{
+    if ( ! reflection_list_is_up_to_date_ )
+        return false;
+    const CrystalLattice & crystal_lattice = crystal_structure_.crystal_lattice();
+    return ( ( crystal_lattice.a() == reflection_list_crystal_lattice_.a() ) &&
+             ( crystal_lattice.b() == reflection_list_crystal_lattice_.b() ) &&
+             ( crystal_lattice.c() == reflection_list_crystal_lattice_.c() ) &&
+             ( crystal_lattice.alpha() == reflection_list_crystal_lattice_.alpha() ) &&
+             ( crystal_lattice.beta()  == reflection_list_crystal_lattice_.beta() ) &&
+             ( crystal_lattice.gamma() == reflection_list_crystal_lattice_.gamma() ) );
+}
+
+// ********************************************************************************
+
+bool PowderPatternCalculator::is_representative_reflection( const int h, const int k, const int l, size_t & nstabilisers ) const
+{
+    nstabilisers = 0;
+    const size_t noperators = laue_class_.nsymmetry_operators();
+    for ( size_t i( 0 ); i != noperators; ++i )
+    {
+        const int * R = &laue_class_rotations_[9*i];
+        int h_equivalent = h * R[0] + k * R[3] + l * R[6];
+        int k_equivalent = h * R[1] + k * R[4] + l * R[7];
+        int l_equivalent = h * R[2] + k * R[5] + l * R[8];
+        // Same ordering as operator<( MillerIndices, MillerIndices ), the representative is the largest
+        if ( h_equivalent != h )
+        {
+            if ( h_equivalent > h )
+                return false;
+            continue;
+        }
+        if ( k_equivalent != k )
+        {
+            if ( k_equivalent > k )
+                return false;
+            continue;
+        }
+        if ( l_equivalent != l )
+        {
+            if ( l_equivalent > l )
+                return false;
+            continue;
+        }
+        ++nstabilisers;
+    }
+    return true;
+}
+
+// ********************************************************************************
+
+void PowderPatternCalculator::precalculate_symmetry_tables()
+{
+    laue_class_rotations_.clear();
+    laue_class_rotations_.reserve( 9 * laue_class_.nsymmetry_operators() );
+    for ( size_t i( 0 ); i != laue_class_.nsymmetry_operators(); ++i )
+    {
+        Matrix3D rotation = laue_class_.symmetry_operator( i );
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            for ( size_t k( 0 ); k != 3; ++k )
+                laue_class_rotations_.push_back( round_to_int( rotation.value( j, k ) ) );
+        }
+    }
+    const SpaceGroup & space_group = crystal_structure_.space_group();
+    space_group_rotations_.clear();
+    space_group_rotations_.reserve( 9 * space_group.nsymmetry_operators() );
+    space_group_translations_.clear();
+    space_group_translations_.reserve( space_group.nsymmetry_operators() );
+    for ( size_t i( 0 ); i != space_group.nsymmetry_operators(); ++i )
+    {
+        const SymmetryOperator & symmetry_operator = space_group.symmetry_operator( i );
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            for ( size_t k( 0 ); k != 3; ++k )
+                space_group_rotations_.push_back( round_to_int( symmetry_operator.rotation().value( j, k ) ) );
+        }
+        space_group_translations_.push_back( symmetry_operator.translation() );
+    }
+}
+
+// ********************************************************************************
+
+SmallVector< MillerIndices, 48 > PowderPatternCalculator::calculate_equivalent_reflections( const MillerIndices miller_indices ) const
 {
-    std::set< MillerIndices > result;
+    SmallVector< MillerIndices, 48 > result;
     for ( size_t i( 0 ); i != laue_class_.nsymmetry_operators(); ++i )
-        result.insert( miller_indices * laue_class_.symmetry_operator( i ) );
+        result.push_back( miller_indices * laue_class_.symmetry_operator( i ) );
+    std::sort( result.begin(), result.end() );
+    result.erase( std::unique( result.begin(), result.end() ), result.end() );
     return result;
 }
 
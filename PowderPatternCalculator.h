@@ -29,42 +29,112 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "Angle.h"
+#include "CrystalLattice.h"
+#include "Element.h"
+#include "Matrix3D.h"
 #include "PointGroup.h"
+#include "PowderPattern.h"
 #include "ReflectionList.h"
+#include "SmallVector.h"
+#include "Vector3D.h"
 
-class PowderPattern;
 class CrystalStructure;
+class PeakShapeFunction;
+class Wavelength;
 
 #include <set>
+#include <vector>
 
 class PowderPatternCalculator
 {
 public:
 
-    PowderPatternCalculator( const CrystalStructure & crystal_structure );
+    // UNIT_CELL: the space-group symmetry must have been applied, all atoms in the unit cell are summed over.
+    // ASYMMETRIC_UNIT: the space-group symmetry must not have been applied, the structure factors are calculated
+    // by summing over the symmetry operators explicitly. This is faster, especially for centrosymmetric space groups.
+    enum AtomsStored { UNIT_CELL, ASYMMETRIC_UNIT };
 
-    // @@@@ We now have a Wavelength class
+    PowderPatternCalculator( const CrystalStructure & crystal_structure, const AtomsStored atoms_stored = UNIT_CELL );
+
+    // The first wavelength if there is a doublet
     double wavelength() const { return wavelength_; }
-    void set_wavelength( const double wavelength ) { wavelength_ = wavelength; }
+    // Changing the wavelength or the 2theta range invalidates the reflection list, the profile parameters
+    // (FWHM, 2theta step, preferred orientation) only require the peaks to be convoluted again.
+    // A single wavelength, removes a doublet.
+    void set_wavelength( const double wavelength );
+    // If the wavelength is not monochromated and has a second wavelength (e.g. CuKa1 / CuKa2), every reflection gives two peaks,
+    // the second with intensity_ratio times the intensity of the first (before the LP factor). The structure factors are
+    // independent of the wavelength, so they are calculated once and both peaks are placed in the same convolution pass.
+    void set_wavelength( const Wavelength & wavelength, const double intensity_ratio = 0.5 );
+    bool has_doublet() const { return wavelength_2_ != 0.0; }
+    // 0.0 if there is no doublet
+    double wavelength_2() const { return wavelength_2_; }
+    double doublet_intensity_ratio() const { return doublet_intensity_ratio_; }
+    // Default X_RAYS. Changing the radiation type invalidates the structure factors.
+    // For NEUTRONS the scattering factors are calculated only once per element, not once per element per reflection.
+    RadiationType radiation_type() const { return radiation_type_; }
+    void set_radiation_type( const RadiationType radiation_type );
+    // The structure factors are calculated on nthreads threads, 0 means one thread per core. Default 1.
+    // The reflections are independent, so the F^2 values are identical for any number of threads.
+    size_t nthreads() const { return nthreads_; }
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; }
     Angle two_theta_start() const { return two_theta_start_; }
-    void set_two_theta_start( const Angle two_theta_start ) { two_theta_start_ = two_theta_start; }
+    void set_two_theta_start( const Angle two_theta_start ) { two_theta_start_ = two_theta_start; two_theta_segments_.clear(); }
     Angle two_theta_end() const { return two_theta_end_; }
-    void set_two_theta_end( const Angle two_theta_end ) { two_theta_end_ = two_theta_end; }
+    void set_two_theta_end( const Angle two_theta_end );
     Angle two_theta_step() const { return two_theta_step_; }
     void set_two_theta_step( const Angle two_theta_step );
+    // The FWHM is only used if no peak shape function has been set, the peak shape is then a pseudo-Voigt with eta = 0.9.
+    // Calculates the pattern on the 2theta values of an experimental pattern, which may consist of several ranges, each with its own step
+    // (synchrotron data, Variable Count Time data), see PowderPattern::two_theta_segments(). The calculated pattern then has the same
+    // 2theta values as the experimental pattern, so Rwp() can be calculated without resampling or rebinning either of them.
+    // Sets the 2theta start and end to those of the pattern, set_two_theta_start(), set_two_theta_end() or set_two_theta_step()
+    // switch back to a single range with a constant step.
+    void set_two_theta_grid( const PowderPattern & powder_pattern );
+    bool has_two_theta_grid() const { return ! two_theta_segments_.empty(); }
     double FWHM() const { return FWHM_; }
     void set_FWHM( const double FWHM ) { FWHM_ = FWHM; }
+    // The peak shape function is not copied and must outlive the calculator.
+    void set_peak_shape_function( const PeakShapeFunction & peak_shape_function ) { peak_shape_function_ = &peak_shape_function; }
+
+    // DIRECT_SUMMATION: each peak is added point by point, this is the reference implementation.
+    // FFT: the peaks are binned onto the 2theta grid and convoluted with the peak shape by FFT, which is faster for dense reflection lists.
+    // The peak shape is evaluated once per block of FFT_block_width, which is only an approximation if the peak shape depends on 2theta.
+    enum PeakConvolution { DIRECT_SUMMATION, FFT };
+    PeakConvolution peak_convolution() const { return peak_convolution_; }
+    Angle FFT_block_width() const { return FFT_block_width_; }
+    void set_peak_convolution( const PeakConvolution peak_convolution, const Angle FFT_block_width = Angle::from_degrees( 5.0 ) ) { peak_convolution_ = peak_convolution; FFT_block_width_ = FFT_block_width; }
+    
+    // SYMMETRY_ADAPTED: the optimised summation, over the symmetry operators explicitly for ASYMMETRIC_UNIT, with the vectorised kernels.
+    // REFERENCE: reference_F_squared() (see KernelVerification.h) for each reflection, summed over the whole unit cell with std::cos() and std::sin().
+    // Much slower, for checking the optimised summation on real data. update_structure_factors() then always recalculates everything.
+    enum StructureFactorSummation { SYMMETRY_ADAPTED, REFERENCE };
+    StructureFactorSummation structure_factor_summation() const { return structure_factor_summation_; }
+    void set_structure_factor_summation( const StructureFactorSummation structure_factor_summation ) { structure_factor_summation_ = structure_factor_summation; structure_factors_are_up_to_date_ = false; }
     
     ReflectionList reflection_list() const { return reflection_list_; }
     
     // A March-Dollase model is used
     void set_preferred_orientation( const MillerIndices & miller_indices, const double r );
+    void clear_preferred_orientation() { include_preferred_orientation_ = false; }
 
-// @@ We need getters for the PO
+    bool has_preferred_orientation() const { return include_preferred_orientation_; }
+    MillerIndices preferred_orientation_direction() const { return preferred_orientation_direction_; }
+    double preferred_orientation_r() const { return r_; }
 
-// Same for eta and/or peak shape
+    bool has_peak_shape_function() const { return peak_shape_function_ != 0; }
+    AtomsStored atoms_stored() const { return atoms_stored_; }
 
+    // Only recalculates the reflection list and the structure factors if they are out of date,
+    // so e.g. a sweep over the FWHM only pays for the convolution with the peak shape.
     void calculate( PowderPattern & powder_pattern );
+
+    // The calculator cannot see changes made to the atoms of the CrystalStructure it refers to,
+    // call this after changing them so that calculate() recalculates the structure factors.
+    void invalidate_structure_factors() { structure_factors_are_up_to_date_ = false; }
+
+    // Idem for changes to the space group. Changes to the unit-cell parameters are detected automatically.
+    void invalidate_reflection_list();
     
     // Calculates d, multiplicity and h,k,l.
     // Only stores one representative reflection if multiplicity > 1 (which is always the case because of Friedel's law).
@@ -75,6 +145,18 @@ public:
     
     void calculate_structure_factors();
 
+    // Replaces the reflection list, e.g. by the reflections of a single-crystal data set, so that calculate_structure_factors()
+    // calculates F^2 for exactly those reflections. The d-spacings must be those of the current unit cell.
+    void set_reflection_list( const ReflectionList & reflection_list );
+
+    // For when only a few atoms have moved, e.g. one molecule during a global optimisation: the contributions of these
+    // atoms at the positions used in the previous calculation are subtracted and their contributions at their current
+    // positions are added, so the cost is proportional to the number of atoms that moved rather than to the total number of atoms.
+    // Only the positions of the atoms may have changed; after any other change call invalidate_structure_factors() instead.
+    // Falls back to calculate_structure_factors() if there are no up-to-date structure factors to start from.
+    // Rounding errors accumulate, so an occasional full recalculation is advisable after very many updates.
+    void update_structure_factors( const std::vector< size_t > & moved_atoms );
+
     // Sets all structure factors to 1, to get an artificial powder pattern to compare lattices.
     // There is no need for this to be in the class, the same could be achieved through a combination
     // of other member functions.
@@ -86,20 +168,51 @@ public:
 
 private:
     double wavelength_;
+    double wavelength_2_;
+    double doublet_intensity_ratio_;
+    RadiationType radiation_type_;
+    size_t nthreads_;
     Angle two_theta_start_;
     Angle two_theta_end_;
     Angle two_theta_step_;
+    std::vector< TwoThetaSegment > two_theta_segments_; // Empty means a single range from two_theta_start_ to two_theta_end_ with step two_theta_step_
     double FWHM_;
     ReflectionList reflection_list_;
     bool include_preferred_orientation_;
     MillerIndices preferred_orientation_direction_;
     double r_;
+    const PeakShapeFunction * peak_shape_function_; // 0 means pseudo-Voigt with FWHM_
+    PeakConvolution peak_convolution_;
+    Angle FFT_block_width_;
+    StructureFactorSummation structure_factor_summation_;
     const CrystalStructure & crystal_structure_; // Creating a copy would be too expensive given that we have tens of thousands of atoms
     // But what if the crystal structure goes out of scope and the destructor is called? We need a smart pointer here.
     PointGroup laue_class_;
-    
+    AtomsStored atoms_stored_;
+    bool reflection_list_is_up_to_date_;
+    bool structure_factors_are_up_to_date_;
+    CrystalLattice reflection_list_crystal_lattice_; // The unit cell for which the reflection list was calculated
+    // Integer copies of the rotation matrices (row-major, 9 per operator) and the translations, because they are needed for every hkl
+    std::vector< int > laue_class_rotations_;
+    std::vector< int > space_group_rotations_;
+    std::vector< Vector3D > space_group_translations_;
+    // The partial sums A and B for each reflection (before the factor of two for a centrosymmetric asymmetric unit)
+    // and the fractional coordinates of the atoms they were calculated for, so that update_structure_factors()
+    // can subtract the old contributions of the atoms that moved.
+    std::vector< double > cosine_terms_;
+    std::vector< double > sine_terms_;
+    std::vector< Vector3D > positions_;
+
+    void precalculate_symmetry_tables();
+    void calculate_structure_factors_reference();
+    bool reflection_list_is_up_to_date() const;
     bool is_systematic_absence( const MillerIndices miller_indices ) const;
-    std::set< MillerIndices > calculate_equivalent_reflections( const MillerIndices miller_indices ) const;
+    // The symmetry operators that calculate_structure_factors() sums over explicitly, returns true if only the cosine terms are needed.
+    bool structure_factor_symmetry_operators( std::vector< Matrix3D > & rotations, std::vector< Vector3D > & translations ) const;
+    // Returns false if an equivalent reflection is larger according to operator<( MillerIndices, MillerIndices ).
+    // nstabilisers is the number of operators of the Laue class that leave the reflection invariant.
+    bool is_representative_reflection( const int h, const int k, const int l, size_t & nstabilisers ) const;
+    SmallVector< MillerIndices, 48 > calculate_equivalent_reflections( const MillerIndices miller_indices ) const;
 };
 
 #endif // POWDERPATTERNCALCULATOR_H
@@ -0,0 +1,209 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternComparator.h"
+#include "MathFunctions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+// The partial sums are compared with the threshold after every block of points, an even number so that the two interleaved sums of Rwp() stay in step.
+const size_t block_size = 512;
+
+// result[k] = sum_j ( 1 - j/m ) values[k-j], 0 < j < m, values before the start are taken as 0.0. O(N) with two running sums.
+void preceding_triangle_sums( const double * values, const size_t npoints, const int m, double * result )
+{
+    const double inverse_m = 1.0 / m;
+    double triangle_sum( 0.0 );
+    double box_sum( 0.0 ); // sum_j values[k-j], 0 < j < m
+    for ( size_t k( 0 ); k != npoints; ++k )
+    {
+        result[k] = triangle_sum;
+        triangle_sum += ( 1.0 - inverse_m ) * values[k] - inverse_m * box_sum;
+        box_sum += values[k];
+        if ( k + 1 >= static_cast<size_t>( m ) )
+            box_sum -= values[ k + 1 - m ];
+    }
+}
+
+} // namespace
+
+// ********************************************************************************
+
+PowderPatternComparator::PowderPatternComparator( const PowderPattern & experimental_pattern, const Angle l ):
+experimental_pattern_(experimental_pattern),
+m_(1),
+coarse_bin_size_(0),
+denominator_(0.0),
+self_correlation_(0.0)
+{
+    if ( ! experimental_pattern_.has_constant_two_theta_step() )
+        throw std::runtime_error( "PowderPatternComparator::PowderPatternComparator(): the experimental pattern must have a constant 2theta step." );
+    if ( experimental_pattern_.empty() )
+        throw std::runtime_error( "PowderPatternComparator::PowderPatternComparator(): the experimental pattern is empty." );
+    const size_t npoints = experimental_pattern_.size();
+    const double * intensities = experimental_pattern_.intensities();
+    const double * weights = experimental_pattern_.weights();
+    // Summed in the same order as in Rwp()
+    double denominator_0( 0.0 );
+    double denominator_1( 0.0 );
+    size_t i( 0 );
+    for ( ; i + 2 <= npoints; i += 2 )
+    {
+        denominator_0 += square( intensities[i  ] ) * weights[i  ];
+        denominator_1 += square( intensities[i+1] ) * weights[i+1];
+    }
+    for ( ; i != npoints; ++i )
+        denominator_0 += square( intensities[i] ) * weights[i];
+    denominator_ = denominator_0 + denominator_1;
+    m_ = weighted_cross_correlation_window( experimental_pattern_, l );
+    const std::vector< double > intensities_over_ESDs = ::intensities_over_ESDs( experimental_pattern_ );
+    filtered_intensities_over_ESDs_.resize( npoints );
+    triangle_filter( &intensities_over_ESDs[0], npoints, m_, &filtered_intensities_over_ESDs_[0] );
+    self_correlation_ = weighted_cross_correlation( &intensities_over_ESDs[0], &intensities_over_ESDs[0], npoints, m_ );
+    // E(s) = ã T ã for ã the points [s,N), from the back: E(s) = E(s+1) + a_s^2 + 2 a_s sum_j ( 1 - j/m ) a_{s+j}
+    std::vector< double > reversed( intensities_over_ESDs.rbegin(), intensities_over_ESDs.rend() );
+    std::vector< double > following_triangle_sums( npoints );
+    preceding_triangle_sums( &reversed[0], npoints, m_, &following_triangle_sums[0] );
+    std::reverse( following_triangle_sums.begin(), following_triangle_sums.end() );
+    std::vector< double > suffix_self_correlations( npoints + 1, 0.0 );
+    for ( size_t s( npoints ); s != 0; --s )
+        suffix_self_correlations[s-1] = suffix_self_correlations[s] + intensities_over_ESDs[s-1] * ( intensities_over_ESDs[s-1] + 2.0 * following_triangle_sums[s-1] );
+    // After the points [0,c), the points of the experimental pattern from c-m+1 onwards still contribute to the numerator
+    for ( size_t c( block_size ); c < npoints; c += block_size )
+        remaining_self_correlations_.push_back( std::max( 0.0, suffix_self_correlations[ c + 1 - std::min( c + 1, static_cast<size_t>( m_ ) ) ] ) );
+}
+
+// ********************************************************************************
+
+void PowderPatternComparator::set_coarse_bin_size( const size_t coarse_bin_size )
+{
+    coarse_bin_size_ = coarse_bin_size;
+    coarse_sums_.clear();
+    coarse_weights_.clear();
+    if ( coarse_bin_size_ < 2 )
+        return;
+    PowderPattern coarse_pattern( experimental_pattern_ );
+    coarse_pattern.rebin( coarse_bin_size_ );
+    // rebin() averages the intensities, the bound needs their sums
+    const size_t npoints = experimental_pattern_.size();
+    for ( size_t j( 0 ); j != coarse_pattern.size(); ++j )
+    {
+        const size_t nvalues = std::min( npoints, ( j + 1 ) * coarse_bin_size_ ) - j * coarse_bin_size_;
+        coarse_sums_.push_back( nvalues * coarse_pattern.intensity( j ) );
+        coarse_weights_.push_back( coarse_pattern.weights()[j] );
+    }
+}
+
+// ********************************************************************************
+
+double PowderPatternComparator::Rwp( const PowderPattern & calculated_pattern, const double maximum_Rwp ) const
+{
+    const size_t npoints = experimental_pattern_.size();
+    if ( calculated_pattern.size() != npoints )
+        throw std::runtime_error( "PowderPatternComparator::Rwp(): the calculated pattern has a different number of points." );
+    const double * observed = experimental_pattern_.intensities();
+    const double * calculated = calculated_pattern.intensities();
+    const double * weights = experimental_pattern_.weights();
+    const double maximum_numerator = square( maximum_Rwp ) * denominator_;
+    if ( coarse_bin_size_ > 1 )
+    {
+        double lower_bound( 0.0 );
+        for ( size_t j( 0 ); j != coarse_sums_.size(); ++j )
+        {
+            const size_t end = std::min( npoints, ( j + 1 ) * coarse_bin_size_ );
+            double sum( 0.0 );
+            for ( size_t i( j * coarse_bin_size_ ); i != end; ++i )
+                sum += calculated[i];
+            lower_bound += square( coarse_sums_[j] - sum ) * coarse_weights_[j];
+            if ( lower_bound > maximum_numerator )
+                return std::sqrt( lower_bound / denominator_ );
+        }
+    }
+    // Two independent partial sums, as in Rwp( PowderPattern, PowderPattern )
+    double numerator_0( 0.0 );
+    double numerator_1( 0.0 );
+    size_t i( 0 );
+    while ( i + 2 <= npoints )
+    {
+        const size_t end = i + std::min( block_size, ( npoints - i ) & ~static_cast<size_t>( 1 ) );
+        for ( ; i != end; i += 2 )
+        {
+            numerator_0 += square( observed[i  ] - calculated[i  ] ) * weights[i  ];
+            numerator_1 += square( observed[i+1] - calculated[i+1] ) * weights[i+1];
+        }
+        if ( numerator_0 + numerator_1 > maximum_numerator )
+            return std::sqrt( ( numerator_0 + numerator_1 ) / denominator_ );
+    }
+    for ( ; i != npoints; ++i )
+        numerator_0 += square( observed[i] - calculated[i] ) * weights[i];
+    return std::sqrt( ( numerator_0 + numerator_1 ) / denominator_ );
+}
+
+// ********************************************************************************
+
+double PowderPatternComparator::normalised_weighted_cross_correlation( const PowderPattern & calculated_pattern, const double minimum_similarity ) const
+{
+    const size_t npoints = experimental_pattern_.size();
+    if ( calculated_pattern.size() != npoints )
+        throw std::runtime_error( "PowderPatternComparator::normalised_weighted_cross_correlation(): the calculated pattern has a different number of points." );
+    const double * intensities = calculated_pattern.intensities();
+    const double * estimated_standard_deviations = calculated_pattern.estimated_standard_deviations();
+    const double * filtered = &filtered_intensities_over_ESDs_[0];
+    const double inverse_m = 1.0 / m_;
+    const bool can_terminate = ( minimum_similarity > 0.0 ) && ( self_correlation_ > 0.0 );
+    double numerator( 0.0 );         // p = sum_k (Ta)_k b_k
+    double self_correlation( 0.0 );  // q = b T b for the points so far
+    double triangle_sum( 0.0 );      // sum_j ( 1 - j/m ) b_{k-j}, 0 < j < m, as in preceding_triangle_sums()
+    double box_sum( 0.0 );
+    size_t k( 0 );
+    for ( size_t block( 0 ); k != npoints; ++block )
+    {
+        const size_t end = std::min( k + block_size, npoints );
+        for ( ; k != end; ++k )
+        {
+            const double b = intensities[k] / estimated_standard_deviations[k];
+            numerator += filtered[k] * b;
+            self_correlation += b * ( b + 2.0 * triangle_sum );
+            triangle_sum += ( 1.0 - inverse_m ) * b - inverse_m * box_sum;
+            box_sum += b;
+            if ( k + 1 >= static_cast<size_t>( m_ ) )
+                box_sum -= intensities[ k + 1 - m_ ] / estimated_standard_deviations[ k + 1 - m_ ];
+        }
+        if ( can_terminate && ( k != npoints ) && ( self_correlation > 0.0 ) )
+        {
+            const double upper_bound_squared = ( square( numerator ) / self_correlation + remaining_self_correlations_[block] ) / self_correlation_;
+            if ( upper_bound_squared < square( minimum_similarity ) )
+                return std::sqrt( upper_bound_squared );
+        }
+    }
+    return numerator / std::sqrt( self_correlation_ * self_correlation );
+}
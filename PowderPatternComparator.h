@@ -0,0 +1,90 @@
+#ifndef POWDERPATTERNCOMPARATOR_H
+#define POWDERPATTERNCOMPARATOR_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Angle.h"
+#include "PowderPattern.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+/*
+  Rwp() and normalised_weighted_cross_correlation() against a fixed experimental pattern, for the inner loop of an optimisation
+  in which most trial patterns are much worse than the best one so far. Everything that depends only on the experimental pattern
+  is calculated once, and each evaluation takes a threshold and stops as soon as the partial sums prove that the trial is worse.
+
+  If the trial is not worse than the threshold, the value is the same as that of the free functions, up to rounding. Otherwise the value that is returned is a bound that is itself worse than the threshold:
+  a lower bound on Rwp, an upper bound on the correlation. So "value > maximum_Rwp" gives the right answer either way.
+
+  Rwp: the numerator only grows, so the sum stops when it exceeds maximum_Rwp^2 times the denominator.
+  With a coarse bin size, a first pass compares the sums of bins of the calculated pattern with the experimental pattern after rebin().
+  By Cauchy-Schwarz, ( sum_bin d )^2 / sum_bin sigma^2 <= sum_bin d^2 / sigma^2, so the coarse pass gives a lower bound on the numerator
+  and can reject a trial after reading only the calculated intensities. Pays off when most trials are rejected.
+
+  Correlation: the numerator sum_i a_i (Tb)_i equals sum_i (Ta)_i b_i, T being the triangle filter, so the experimental pattern is
+  filtered once. After the points [0,c) of the calculated pattern b, with p the partial numerator and q the partial b T b,
+  the correlation is at most sqrt( p^2 / ( q aTa ) + E(c) / aTa ), where E(c) is ã T ã for the part ã of the experimental pattern
+  that can still contribute. This holds because T is positive semi-definite and b >= 0, which is true for a calculated pattern.
+  Powder patterns are strongest at low angles, so E(c) falls quickly. The bound is looser for a wider window: with l = 1 degree a clearly
+  different pattern is usually rejected within the first blocks, with l = 3 degrees only patterns with a low correlation are.
+*/
+class PowderPatternComparator
+{
+public:
+
+    // The experimental pattern must have a constant 2theta step. l as in normalised_weighted_cross_correlation().
+    explicit PowderPatternComparator( const PowderPattern & experimental_pattern, const Angle l = Angle( 3.0, Angle::DEGREES ) );
+
+    // 0 or 1 switches the coarse pass for Rwp() off, which is the default.
+    size_t coarse_bin_size() const { return coarse_bin_size_; }
+    void set_coarse_bin_size( const size_t coarse_bin_size );
+
+    // Same as Rwp( experimental_pattern, calculated_pattern ) if that is at most maximum_Rwp, otherwise a lower bound that is greater than maximum_Rwp.
+    double Rwp( const PowderPattern & calculated_pattern, const double maximum_Rwp ) const;
+
+    // Same as normalised_weighted_cross_correlation( experimental_pattern, calculated_pattern, l ) if that is at least minimum_similarity,
+    // otherwise an upper bound that is less than minimum_similarity. The intensities of the calculated pattern must not be negative.
+    double normalised_weighted_cross_correlation( const PowderPattern & calculated_pattern, const double minimum_similarity ) const;
+
+private:
+    PowderPattern experimental_pattern_;
+    int m_;
+    size_t coarse_bin_size_;
+    // Rwp
+    double denominator_;
+    std::vector< double > coarse_sums_;
+    std::vector< double > coarse_weights_;
+    // Correlation
+    std::vector< double > filtered_intensities_over_ESDs_; // Ta
+    double self_correlation_; // aTa
+    std::vector< double > remaining_self_correlations_; // E(c) at the end of each block
+};
+
+#endif // POWDERPATTERNCOMPARATOR_H
@@ -0,0 +1,426 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternDerivatives.h"
+#include "CrystalStructure.h"
+#include "Element.h"
+#include "Instrumentation.h"
+#include "MathConstants.h"
+#include "MathFunctions.h"
+#include "PeakShapeFunction.h"
+#include "PointGroup.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "ReflectionList.h"
+#include "SpaceGroup.h"
+#include "SparseJacobian.h"
+#include "SymmetryOperator.h"
+#include "3DCalculations.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+// The same value as the default peak shape of PowderPatternCalculator.
+const double default_eta = 0.9;
+
+// ********************************************************************************
+
+// lhs^T M rhs
+double bilinear_form( const double * lhs, const Matrix3D & matrix, const double * rhs )
+{
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+            result += lhs[i] * matrix.value( i, j ) * rhs[j];
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+// The derivatives of the metric tensor G with respect to a, b, c, alpha, beta, gamma; the angles per degree.
+void metric_tensor_derivatives( const CrystalLattice & crystal_lattice, Matrix3D * derivatives )
+{
+    const double a = crystal_lattice.a();
+    const double b = crystal_lattice.b();
+    const double c = crystal_lattice.c();
+    const double cos_alpha = crystal_lattice.alpha().cosine();
+    const double cos_beta  = crystal_lattice.beta().cosine();
+    const double cos_gamma = crystal_lattice.gamma().cosine();
+    const double per_degree = CONSTANT_PI / 180.0;
+    derivatives[0] = Matrix3D( 2.0 * a      , b * cos_gamma, c * cos_beta,
+                               b * cos_gamma, 0.0          , 0.0         ,
+                               c * cos_beta , 0.0          , 0.0          );
+    derivatives[1] = Matrix3D( 0.0          , a * cos_gamma, 0.0          ,
+                               a * cos_gamma, 2.0 * b      , c * cos_alpha,
+                               0.0          , c * cos_alpha, 0.0           );
+    derivatives[2] = Matrix3D( 0.0         , 0.0          , a * cos_beta ,
+                               0.0         , 0.0          , b * cos_alpha,
+                               a * cos_beta, b * cos_alpha, 2.0 * c       );
+    const double d_alpha = -b * c * crystal_lattice.alpha().sine() * per_degree;
+    const double d_beta  = -a * c * crystal_lattice.beta().sine()  * per_degree;
+    const double d_gamma = -a * b * crystal_lattice.gamma().sine() * per_degree;
+    derivatives[3] = Matrix3D( 0.0, 0.0, 0.0, 0.0, 0.0, d_alpha, 0.0, d_alpha, 0.0 );
+    derivatives[4] = Matrix3D( 0.0, 0.0, d_beta, 0.0, 0.0, 0.0, d_beta, 0.0, 0.0 );
+    derivatives[5] = Matrix3D( 0.0, d_gamma, 0.0, d_gamma, 0.0, 0.0, 0.0, 0.0, 0.0 );
+}
+
+// ********************************************************************************
+
+// The peak shape in the points of one peak.
+struct PeakProfile
+{
+    size_t first_;
+    std::vector< double > values_;
+    std::vector< double > d_delta_;
+    std::vector< double > d_FWHM_;
+};
+
+} // namespace
+
+// ********************************************************************************
+
+PowderPatternDerivatives::PowderPatternDerivatives( const CrystalStructure & crystal_structure, PowderPatternCalculator & powder_pattern_calculator ):
+crystal_structure_(crystal_structure),
+powder_pattern_calculator_(powder_pattern_calculator)
+{
+}
+
+// ********************************************************************************
+
+size_t PowderPatternDerivatives::nparameters() const
+{
+    return NGLOBAL_PARAMETERS + 4 * crystal_structure_.natoms();
+}
+
+// ********************************************************************************
+
+std::string PowderPatternDerivatives::parameter_name( const size_t i ) const
+{
+    switch ( i )
+    {
+        case PARAMETER_A          : return "a";
+        case PARAMETER_B          : return "b";
+        case PARAMETER_C          : return "c";
+        case PARAMETER_ALPHA      : return "alpha";
+        case PARAMETER_BETA       : return "beta";
+        case PARAMETER_GAMMA      : return "gamma";
+        case PARAMETER_ZERO_POINT : return "zero point";
+        case PARAMETER_FWHM       : return "FWHM";
+        case PARAMETER_R          : return "r";
+    }
+    if ( i >= nparameters() )
+        throw std::runtime_error( "PowderPatternDerivatives::parameter_name(): index out of range." );
+    const char * names[] = { "x", "y", "z", "Uiso" };
+    return std::string( names[ ( i - NGLOBAL_PARAMETERS ) % 4 ] ) + "(" + crystal_structure_.atom( ( i - NGLOBAL_PARAMETERS ) / 4 ).label() + ")";
+}
+
+// ********************************************************************************
+
+void PowderPatternDerivatives::calculate( PowderPattern & powder_pattern, SparseJacobian & jacobian ) const
+{
+    MACRO_SCOPED_TIMER( "PowderPatternDerivatives::calculate()" );
+    PowderPatternCalculator & calculator = powder_pattern_calculator_;
+    if ( calculator.has_peak_shape_function() )
+        throw std::runtime_error( "PowderPatternDerivatives::calculate(): derivatives for a PeakShapeFunction are not supported." );
+    calculator.calculate_reflection_list();
+    const ReflectionList reflection_list = calculator.reflection_list();
+    const size_t nreflections = reflection_list.size();
+    const size_t natoms = crystal_structure_.natoms();
+    const size_t nparameters = this->nparameters();
+    const double wavelength = calculator.wavelength();
+    const RadiationType radiation_type = calculator.radiation_type();
+    const double radians2degrees = 180.0 / CONSTANT_PI;
+    // d( 1/d^2 ) / d parameter = h^T ( dG* / d parameter ) h with dG* = -G* dG G*
+    const CrystalLattice & crystal_lattice = crystal_structure_.crystal_lattice();
+    const Matrix3D G_star = inverse( crystal_lattice.Downs_G() );
+    Matrix3D dG_star[6];
+    metric_tensor_derivatives( crystal_lattice, dG_star );
+    for ( size_t k( 0 ); k != 6; ++k )
+        dG_star[k] = -1.0 * ( G_star * dG_star[k] * G_star );
+    // The symmetry operators that are summed explicitly
+    std::vector< Matrix3D > rotations;
+    std::vector< Vector3D > translations;
+    const bool asymmetric_unit = ( calculator.atoms_stored() == PowderPatternCalculator::ASYMMETRIC_UNIT );
+    const SpaceGroup & space_group = crystal_structure_.space_group();
+    if ( asymmetric_unit )
+    {
+        for ( size_t i( 0 ); i != space_group.nsymmetry_operators(); ++i )
+        {
+            rotations.push_back( space_group.symmetry_operator( i ).rotation() );
+            translations.push_back( space_group.symmetry_operator( i ).translation() );
+        }
+    }
+    else
+    {
+        rotations.push_back( Matrix3D() );
+        translations.push_back( Vector3D() );
+    }
+    // The atoms
+    std::set< Element > element_set = crystal_structure_.elements();
+    std::vector< Element > elements( element_set.begin(), element_set.end() );
+    std::map< Element, size_t > element_indices;
+    for ( size_t i( 0 ); i != elements.size(); ++i )
+        element_indices[ elements[i] ] = i;
+    std::vector< Vector3D > positions( natoms );
+    std::vector< size_t > element_index( natoms );
+    std::vector< double > occupancies( natoms );
+    std::vector< double > Uisos( natoms );
+    for ( size_t j( 0 ); j != natoms; ++j )
+    {
+        const Atom & atom = crystal_structure_.atom( j );
+        if ( atom.ADPs_type() == Atom::ANISOTROPIC )
+            throw std::runtime_error( "PowderPatternDerivatives::calculate(): anisotropic ADPs are not supported." );
+        positions[j] = atom.position();
+        element_index[j] = element_indices[ atom.element() ];
+        Uisos[j] = atom.Uiso();
+        occupancies[j] = atom.occupancy();
+        if ( asymmetric_unit )
+        {
+            // Same criterion as in PowderPatternCalculator::calculate_structure_factors()
+            size_t nstabilisers( 1 );
+            for ( size_t k( 1 ); k != space_group.nsymmetry_operators(); ++k )
+            {
+                if ( crystal_lattice.shortest_distance( atom.position(), space_group.symmetry_operator( k ) * atom.position() ) < 0.1 )
+                    ++nstabilisers;
+            }
+            occupancies[j] /= nstabilisers;
+        }
+    }
+    // March-Dollase
+    const bool preferred_orientation = calculator.has_preferred_orientation();
+    const double r = calculator.preferred_orientation_r();
+    const MillerIndices PO_miller_indices = calculator.preferred_orientation_direction();
+    const double PO_direction[3] = { static_cast<double>( PO_miller_indices.h() ), static_cast<double>( PO_miller_indices.k() ), static_cast<double>( PO_miller_indices.l() ) };
+    const PointGroup & laue_class = space_group.laue_class();
+    // Per reflection: the integrated intensity, the peak position in degrees and their derivatives
+    std::vector< double > intensities( nreflections );
+    std::vector< double > peak_positions( nreflections );
+    std::vector< double > d_intensities( nreflections * nparameters, 0.0 );
+    std::vector< double > d_peak_positions( nreflections * 6 );
+    std::vector< double > scattering_factors( elements.size() );
+    std::vector< double > d_scattering_factors( elements.size() );
+    std::vector< double > dA( 4 * natoms );
+    std::vector< double > dB( 4 * natoms );
+    const double two_pi = 2.0 * CONSTANT_PI;
+    const double two_pi_squared = 2.0 * square( CONSTANT_PI );
+    for ( size_t i( 0 ); i != nreflections; ++i )
+    {
+        const MillerIndices miller_indices = reflection_list.miller_indices( i );
+        const double h[3] = { static_cast<double>( miller_indices.h() ), static_cast<double>( miller_indices.k() ), static_cast<double>( miller_indices.l() ) };
+        // Q = 1/d^2
+        const double Q = bilinear_form( h, G_star, h );
+        double dQ[6];
+        for ( size_t k( 0 ); k != 6; ++k )
+            dQ[k] = bilinear_form( h, dG_star[k], h );
+        const double sine_theta_over_lambda = 0.5 * std::sqrt( Q );
+        const Angle theta = arcsine( wavelength * sine_theta_over_lambda );
+        const double dtheta_dQ = wavelength / ( 4.0 * std::sqrt( Q ) * theta.cosine() );
+        for ( size_t j( 0 ); j != elements.size(); ++j )
+        {
+            scattering_factors[j] = elements[j].scattering_factor( sine_theta_over_lambda, radiation_type );
+            // d s / d Q = 1 / ( 8 s )
+            d_scattering_factors[j] = elements[j].scattering_factor_derivative( sine_theta_over_lambda, radiation_type ) / ( 8.0 * sine_theta_over_lambda );
+        }
+        // F = A + iB, dA and dB hold the derivatives with respect to x, y, z, Uiso of each atom
+        double A( 0.0 );
+        double B( 0.0 );
+        double dA_dQ( 0.0 );
+        double dB_dQ( 0.0 );
+        std::fill( dA.begin(), dA.end(), 0.0 );
+        std::fill( dB.begin(), dB.end(), 0.0 );
+        for ( size_t s( 0 ); s != rotations.size(); ++s )
+        {
+            // h.( Rx + t ) = ( hR ).x + h.t
+            const Vector3D hR = Vector3D( h[0], h[1], h[2] ) * rotations[s];
+            const double ht = h[0] * translations[s].x() + h[1] * translations[s].y() + h[2] * translations[s].z();
+            for ( size_t j( 0 ); j != natoms; ++j )
+            {
+                const double phase = two_pi * ( hR * positions[j] + ht );
+                const double cosine = std::cos( phase );
+                const double sine = std::sin( phase );
+                const double temperature_factor = std::exp( -two_pi_squared * Uisos[j] * Q );
+                const double weight = occupancies[j] * scattering_factors[ element_index[j] ] * temperature_factor;
+                A += weight * cosine;
+                B += weight * sine;
+                const double dweight_dQ = occupancies[j] * temperature_factor * ( d_scattering_factors[ element_index[j] ] - two_pi_squared * Uisos[j] * scattering_factors[ element_index[j] ] );
+                dA_dQ += dweight_dQ * cosine;
+                dB_dQ += dweight_dQ * sine;
+                dA[4*j  ] -= two_pi * hR.x() * weight * sine;
+                dA[4*j+1] -= two_pi * hR.y() * weight * sine;
+                dA[4*j+2] -= two_pi * hR.z() * weight * sine;
+                dB[4*j  ] += two_pi * hR.x() * weight * cosine;
+                dB[4*j+1] += two_pi * hR.y() * weight * cosine;
+                dB[4*j+2] += two_pi * hR.z() * weight * cosine;
+                const double dweight_dUiso = -two_pi_squared * Q * weight;
+                dA[4*j+3] += dweight_dUiso * cosine;
+                dB[4*j+3] += dweight_dUiso * sine;
+            }
+        }
+        const double F_squared = square( A ) + square( B );
+        // The multiplicity, with preferred orientation the sum of the March-Dollase factors of the equivalent reflections
+        double multiplicity( 0.0 );
+        double d_multiplicity[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        double d_multiplicity_dr( 0.0 );
+        if ( preferred_orientation )
+        {
+            std::set< MillerIndices > equivalent_reflections;
+            for ( size_t s( 0 ); s != laue_class.nsymmetry_operators(); ++s )
+                equivalent_reflections.insert( miller_indices * laue_class.symmetry_operator( s ) );
+            const double P2 = bilinear_form( PO_direction, G_star, PO_direction );
+            for ( std::set< MillerIndices >::const_iterator it( equivalent_reflections.begin() ); it != equivalent_reflections.end(); ++it )
+            {
+                const double e[3] = { static_cast<double>( it->h() ), static_cast<double>( it->k() ), static_cast<double>( it->l() ) };
+                const double N = bilinear_form( PO_direction, G_star, e );
+                const double cosine = N / std::sqrt( P2 * Q );
+                const double cosine_squared = square( cosine );
+                const double t = square( r ) * cosine_squared + ( 1.0 - cosine_squared ) / r;
+                multiplicity += std::pow( t, -3.0/2.0 );
+                const double dt = -1.5 * std::pow( t, -5.0/2.0 );
+                d_multiplicity_dr += dt * ( 2.0 * r * cosine_squared - ( 1.0 - cosine_squared ) / square( r ) );
+                for ( size_t k( 0 ); k != 6; ++k )
+                {
+                    const double dcosine = bilinear_form( PO_direction, dG_star[k], e ) / std::sqrt( P2 * Q ) -
+                                           0.5 * cosine * ( bilinear_form( PO_direction, dG_star[k], PO_direction ) / P2 + dQ[k] / Q );
+                    d_multiplicity[k] += dt * ( square( r ) - 1.0 / r ) * 2.0 * cosine * dcosine;
+                }
+            }
+        }
+        else
+            multiplicity = reflection_list.multiplicity( i );
+        // The LP factor and its derivative with respect to theta
+        const Angle two_theta = 2.0 * theta;
+        const double numerator = 1.0 + square( two_theta.cosine() );
+        const double denominator = 2.0 * two_theta.sine() * theta.sine();
+        const double LP_factor = numerator / denominator;
+        const double d_numerator = -4.0 * two_theta.cosine() * two_theta.sine();
+        const double d_denominator = 2.0 * ( 2.0 * two_theta.cosine() * theta.sine() + two_theta.sine() * theta.cosine() );
+        const double dLP_factor = ( d_numerator * denominator - numerator * d_denominator ) / square( denominator );
+        intensities[i] = F_squared * multiplicity * LP_factor;
+        peak_positions[i] = two_theta.value_in_degrees() + zero_point_.value_in_degrees();
+        double * d_intensity = &d_intensities[ i * nparameters ];
+        const double dI_dQ = 2.0 * ( A * dA_dQ + B * dB_dQ ) * multiplicity * LP_factor + F_squared * multiplicity * dLP_factor * dtheta_dQ;
+        for ( size_t k( 0 ); k != 6; ++k )
+        {
+            d_intensity[k] = dI_dQ * dQ[k] + F_squared * d_multiplicity[k] * LP_factor;
+            d_peak_positions[ i * 6 + k ] = 2.0 * radians2degrees * dtheta_dQ * dQ[k];
+        }
+        d_intensity[PARAMETER_R] = F_squared * d_multiplicity_dr * LP_factor;
+        for ( size_t j( 0 ); j != 4 * natoms; ++j )
+            d_intensity[ NGLOBAL_PARAMETERS + j ] = 2.0 * ( A * dA[j] + B * dB[j] ) * multiplicity * LP_factor;
+    }
+    // The peak profiles
+    powder_pattern = PowderPattern( calculator.two_theta_start(), calculator.two_theta_end(), calculator.two_theta_step() );
+    const size_t npoints = powder_pattern.size();
+    const double FWHM = calculator.FWHM();
+    const double start = calculator.two_theta_start().value_in_degrees();
+    const double step = calculator.two_theta_step().value_in_degrees();
+    const PseudoVoigtPeakShape peak_shape_function( FWHM, default_eta );
+    const double half_width = peak_shape_function.range( FWHM, default_eta ) / step;
+    std::vector< PeakProfile > profiles( nreflections );
+    std::vector< double > pattern( npoints, 0.0 );
+    for ( size_t i( 0 ); i != nreflections; ++i )
+    {
+        // The same range as in PowderPatternCalculator
+        const double position = ( peak_positions[i] - start ) / step;
+        const int first = std::max( 0, static_cast<int>( std::ceil( position - half_width ) ) );
+        const int last = std::min( static_cast<int>( npoints ) - 1, static_cast<int>( std::floor( position + half_width ) ) );
+        PeakProfile & profile = profiles[i];
+        profile.first_ = first;
+        for ( int index( first ); index <= last; ++index )
+        {
+            double value;
+            double d_delta;
+            double d_FWHM;
+            peak_shape_function.value_and_derivatives( ( index - position ) * step, FWHM, default_eta, value, d_delta, d_FWHM );
+            profile.values_.push_back( value );
+            profile.d_delta_.push_back( d_delta );
+            profile.d_FWHM_.push_back( d_FWHM );
+            pattern[index] += intensities[i] * value;
+        }
+    }
+    for ( size_t k( 0 ); k != npoints; ++k )
+        powder_pattern.set_intensity( k, pattern[k] );
+    powder_pattern.recalculate_estimated_standard_deviations();
+    powder_pattern.set_wavelength( wavelength );
+    // Assemble the Jacobian column by column, only the points within the peaks that depend on the parameter are stored
+    jacobian = SparseJacobian( npoints );
+    std::vector< double > column( npoints, 0.0 );
+    std::vector< bool > is_touched( npoints, false );
+    std::vector< size_t > touched;
+    std::vector< double > values;
+    for ( size_t p( 0 ); p != nparameters; ++p )
+    {
+        for ( size_t i( 0 ); i != nreflections; ++i )
+        {
+            const PeakProfile & profile = profiles[i];
+            // y = I * value( 2theta - position ), the derivative of value with respect to the peak position is -d_delta
+            const double d_intensity = d_intensities[ i * nparameters + p ];
+            double d_position( 0.0 );
+            if ( p < 6 )
+                d_position = d_peak_positions[ i * 6 + p ];
+            else if ( p == PARAMETER_ZERO_POINT )
+                d_position = 1.0;
+            const double d_FWHM = ( p == PARAMETER_FWHM ) ? 1.0 : 0.0;
+            if ( ( d_intensity == 0.0 ) && ( d_position == 0.0 ) && ( d_FWHM == 0.0 ) )
+                continue;
+            for ( size_t m( 0 ); m != profile.values_.size(); ++m )
+            {
+                const size_t index = profile.first_ + m;
+                column[index] += d_intensity * profile.values_[m] + intensities[i] * ( d_FWHM * profile.d_FWHM_[m] - d_position * profile.d_delta_[m] );
+                if ( ! is_touched[index] )
+                {
+                    is_touched[index] = true;
+                    touched.push_back( index );
+                }
+            }
+        }
+        std::sort( touched.begin(), touched.end() );
+        values.resize( touched.size() );
+        for ( size_t m( 0 ); m != touched.size(); ++m )
+        {
+            values[m] = column[ touched[m] ];
+            column[ touched[m] ] = 0.0;
+            is_touched[ touched[m] ] = false;
+        }
+        jacobian.append_column( touched, values );
+        touched.clear();
+    }
+    MACRO_COUNT( "atom-reflection pairs (derivatives)", nreflections * rotations.size() * natoms );
+}
+
+// ********************************************************************************
+
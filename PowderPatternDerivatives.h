@@ -0,0 +1,93 @@
+#ifndef POWDERPATTERNDERIVATIVES_H
+#define POWDERPATTERNDERIVATIVES_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Angle.h"
+
+class CrystalStructure;
+class PowderPattern;
+class PowderPatternCalculator;
+class SparseJacobian;
+
+#include <cstddef> // For definition of size_t
+#include <string>
+
+/*
+  The calculated powder pattern together with its analytical derivatives with respect to the parameters of a Rietveld refinement:
+  the unit-cell parameters, the zero point, the FWHM, the March-Dollase r and the fractional coordinates and Uiso of each atom.
+  The derivatives are calculated in the same pass over the reflections and atoms as the pattern itself,
+  so the full Jacobian costs about as much as a few calculations of the pattern instead of one calculation per parameter.
+
+  The model is that of PowderPatternCalculator::calculate() with direct summation, with two differences:
+  the pattern is NOT normalised (a refinement refines a scale factor instead) and a zero-point shift is added to all peak positions.
+  The Gaussian part of the peak shape is evaluated exactly, so the shape of the pattern differs from that of PowderPatternCalculator
+  by about 1.0E-6 of the highest peak.
+
+  The unit-cell parameters are treated as independent, constraints imposed by the crystal system must be applied by the caller.
+  The angles, the zero point and the FWHM are in degrees. The derivatives with respect to the atoms are for the atoms as stored:
+  for PowderPatternCalculator::ASYMMETRIC_UNIT the symmetry-equivalent atoms move with them.
+  Atoms with anisotropic ADPs and user-supplied PeakShapeFunctions are not supported.
+  The reflection list (which reflections contribute) is taken as fixed.
+*/
+class PowderPatternDerivatives
+{
+public:
+
+    // The order of the parameters, the atom parameters x, y, z, Uiso of each atom follow after NGLOBAL_PARAMETERS.
+    enum Parameter { PARAMETER_A, PARAMETER_B, PARAMETER_C, PARAMETER_ALPHA, PARAMETER_BETA, PARAMETER_GAMMA,
+                     PARAMETER_ZERO_POINT, PARAMETER_FWHM, PARAMETER_R, NGLOBAL_PARAMETERS };
+
+    // The wavelength, 2theta range, FWHM, preferred orientation and the way the atoms are stored are taken from
+    // powder_pattern_calculator, which must refer to crystal_structure. Both must outlive this object.
+    PowderPatternDerivatives( const CrystalStructure & crystal_structure, PowderPatternCalculator & powder_pattern_calculator );
+
+    Angle zero_point() const { return zero_point_; }
+    void set_zero_point( const Angle zero_point ) { zero_point_ = zero_point; }
+
+    size_t nparameters() const;
+    static size_t x_index( const size_t atom ) { return NGLOBAL_PARAMETERS + 4 * atom; }
+    static size_t y_index( const size_t atom ) { return NGLOBAL_PARAMETERS + 4 * atom + 1; }
+    static size_t z_index( const size_t atom ) { return NGLOBAL_PARAMETERS + 4 * atom + 2; }
+    static size_t Uiso_index( const size_t atom ) { return NGLOBAL_PARAMETERS + 4 * atom + 3; }
+    // E.g. "a", "zero point", "x(C1)".
+    std::string parameter_name( const size_t i ) const;
+
+    // jacobian has one row per 2theta point and nparameters() columns.
+    // Recalculates the reflection list of the calculator.
+    void calculate( PowderPattern & powder_pattern, SparseJacobian & jacobian ) const;
+
+private:
+    const CrystalStructure & crystal_structure_;
+    PowderPatternCalculator & powder_pattern_calculator_;
+    Angle zero_point_;
+};
+
+#endif // POWDERPATTERNDERIVATIVES_H
+
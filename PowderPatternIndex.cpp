@@ -0,0 +1,241 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternIndex.h"
+#include "PowderPattern.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// ********************************************************************************
+
+PowderPatternIndex::PowderPatternIndex( const Angle l ):
+l_(l),
+npoints_(0),
+m_(0),
+bin_size_(0),
+fingerprint_size_(0),
+npatterns_(0)
+{
+    tree_.value().root_ = no_node;
+    tree_.set_valid();
+}
+
+// ********************************************************************************
+
+void PowderPatternIndex::reserve( const size_t npatterns )
+{
+    if ( fingerprint_size_ != 0 )
+        fingerprints_.reserve( npatterns * fingerprint_size_ );
+}
+
+// ********************************************************************************
+
+void PowderPatternIndex::push_back( const PowderPattern & powder_pattern )
+{
+    if ( npatterns_ == 0 )
+    {
+        npoints_ = powder_pattern.size();
+        m_ = weighted_cross_correlation_window( powder_pattern, l_ );
+        bin_size_ = static_cast<size_t>( std::max( 1, m_ / 4 ) );
+        fingerprint_size_ = ( npoints_ + m_ - 1 + bin_size_ - 1 ) / bin_size_;
+    }
+    std::vector< double > result = fingerprint( powder_pattern );
+    fingerprints_.insert( fingerprints_.end(), result.begin(), result.end() );
+    ++npatterns_;
+    tree_.invalidate();
+}
+
+// ********************************************************************************
+
+std::vector< size_t > PowderPatternIndex::find_most_similar( const PowderPattern & powder_pattern, const size_t k, std::vector< double > & estimated_similarities ) const
+{
+    std::vector< size_t > result;
+    estimated_similarities.clear();
+    if ( ( k == 0 ) || ( npatterns_ == 0 ) )
+        return result;
+    const Tree & tree = this->tree();
+    std::vector< double > query = fingerprint( powder_pattern );
+    std::vector< std::pair< double, size_t > > heap;
+    heap.reserve( k + 1 );
+    search( tree, tree.root_, &query[0], k, heap );
+    std::sort_heap( heap.begin(), heap.end() );
+    result.reserve( heap.size() );
+    estimated_similarities.reserve( heap.size() );
+    for ( size_t i( 0 ); i != heap.size(); ++i )
+    {
+        result.push_back( heap[i].second );
+        estimated_similarities.push_back( 1.0 - 0.5 * heap[i].first * heap[i].first );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+double PowderPatternIndex::estimated_similarity( const PowderPattern & powder_pattern, const size_t i ) const
+{
+    if ( i >= npatterns_ )
+        throw std::runtime_error( "PowderPatternIndex::estimated_similarity(): index out of range." );
+    std::vector< double > query = fingerprint( powder_pattern );
+    double d = distance( &query[0], &fingerprints_[ i * fingerprint_size_ ] );
+    return 1.0 - 0.5 * d * d;
+}
+
+// ********************************************************************************
+
+double PowderPatternIndex::estimated_similarity( const size_t i, const size_t j ) const
+{
+    if ( ( i >= npatterns_ ) || ( j >= npatterns_ ) )
+        throw std::runtime_error( "PowderPatternIndex::estimated_similarity(): index out of range." );
+    double d = distance( &fingerprints_[ i * fingerprint_size_ ], &fingerprints_[ j * fingerprint_size_ ] );
+    return 1.0 - 0.5 * d * d;
+}
+
+// ********************************************************************************
+
+std::vector< double > PowderPatternIndex::fingerprint( const PowderPattern & powder_pattern ) const
+{
+    if ( powder_pattern.size() != npoints_ )
+        throw std::runtime_error( "PowderPatternIndex::fingerprint(): all patterns must have the same number of points." );
+    std::vector< double > intensities = intensities_over_ESDs( powder_pattern );
+    std::vector< double > result( fingerprint_size_, 0.0 );
+    // Running box sum A[k] = sum_{s=0}^{m-1} intensities[k-s]
+    const int n = static_cast<int>( npoints_ );
+    double sum( 0.0 );
+    for ( int k( 0 ); k != n + m_ - 1; ++k )
+    {
+        if ( k < n )
+            sum += intensities[k];
+        if ( k - m_ >= 0 )
+            sum -= intensities[k-m_];
+        result[ static_cast<size_t>( k ) / bin_size_ ] += sum;
+    }
+    double norm( 0.0 );
+    for ( size_t i( 0 ); i != fingerprint_size_; ++i )
+        norm += result[i] * result[i];
+    norm = sqrt( norm );
+    if ( norm > 0.0 )
+    {
+        for ( size_t i( 0 ); i != fingerprint_size_; ++i )
+            result[i] /= norm;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+double PowderPatternIndex::distance( const double * lhs, const double * rhs ) const
+{
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != fingerprint_size_; ++i )
+        result += ( lhs[i] - rhs[i] ) * ( lhs[i] - rhs[i] );
+    return sqrt( result );
+}
+
+// ********************************************************************************
+
+const PowderPatternIndex::Tree & PowderPatternIndex::tree() const
+{
+    return tree_.get( [this]( Tree & tree )
+    {
+        tree.nodes_.clear();
+        tree.nodes_.reserve( npatterns_ );
+        std::vector< size_t > patterns( npatterns_ );
+        for ( size_t i( 0 ); i != npatterns_; ++i )
+            patterns[i] = i;
+        tree.root_ = build_tree( tree, patterns, 0, npatterns_ );
+    } );
+}
+
+// ********************************************************************************
+
+size_t PowderPatternIndex::build_tree( Tree & tree, std::vector< size_t > & patterns, const size_t begin, const size_t end ) const
+{
+    if ( begin == end )
+        return no_node;
+    const size_t node = tree.nodes_.size();
+    Node new_node;
+    new_node.pattern = patterns[begin];
+    new_node.threshold = 0.0;
+    new_node.inner = no_node;
+    new_node.outer = no_node;
+    tree.nodes_.push_back( new_node );
+    if ( end - begin == 1 )
+        return node;
+    // The first pattern is the vantage point, the others are split at the median distance
+    const double * vantage_point = &fingerprints_[ patterns[begin] * fingerprint_size_ ];
+    const size_t median = ( begin + 1 + end ) / 2;
+    std::nth_element( patterns.begin() + begin + 1, patterns.begin() + median, patterns.begin() + end,
+                      [&]( const size_t lhs, const size_t rhs ) { return distance( vantage_point, &fingerprints_[ lhs * fingerprint_size_ ] ) <
+                                                                           distance( vantage_point, &fingerprints_[ rhs * fingerprint_size_ ] ); } );
+    const double threshold = distance( vantage_point, &fingerprints_[ patterns[median] * fingerprint_size_ ] );
+    const size_t inner = build_tree( tree, patterns, begin + 1, median );
+    const size_t outer = build_tree( tree, patterns, median, end );
+    // nodes_ may have been reallocated
+    tree.nodes_[node].threshold = threshold;
+    tree.nodes_[node].inner = inner;
+    tree.nodes_[node].outer = outer;
+    return node;
+}
+
+// ********************************************************************************
+
+void PowderPatternIndex::search( const Tree & tree, const size_t node, const double * query, const size_t k, std::vector< std::pair< double, size_t > > & heap ) const
+{
+    if ( node == no_node )
+        return;
+    const Node & current = tree.nodes_[node];
+    const double d = distance( query, &fingerprints_[ current.pattern * fingerprint_size_ ] );
+    if ( heap.size() < k )
+    {
+        heap.push_back( std::make_pair( d, current.pattern ) );
+        std::push_heap( heap.begin(), heap.end() );
+    }
+    else if ( d < heap.front().first )
+    {
+        std::pop_heap( heap.begin(), heap.end() );
+        heap.back() = std::make_pair( d, current.pattern );
+        std::push_heap( heap.begin(), heap.end() );
+    }
+    // The k-th distance so far, a subtree can only be skipped if it cannot contain anything closer
+    if ( d < current.threshold )
+    {
+        search( tree, current.inner, query, k, heap );
+        if ( ( heap.size() < k ) || ( d + heap.front().first >= current.threshold ) )
+            search( tree, current.outer, query, k, heap );
+    }
+    else
+    {
+        search( tree, current.outer, query, k, heap );
+        if ( ( heap.size() < k ) || ( d - heap.front().first <= current.threshold ) )
+            search( tree, current.inner, query, k, heap );
+    }
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,113 @@
+#ifndef POWDERPATTERNINDEX_H
+#define POWDERPATTERNINDEX_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class PowderPattern;
+
+#include "Angle.h"
+#include "LazyCache.h"
+
+#include <cstddef> // For definition of size_t
+#include <utility>
+#include <vector>
+
+/*
+  An index for finding the most similar patterns in a large collection of powder patterns, to pre-screen the
+  candidates before calculating normalised_weighted_cross_correlation() in full.
+
+  With A[k] = sum_{s=0}^{m-1} ( I/sigma )[k-s], the weighted cross correlation of two patterns is exactly the
+  dot product of their A vectors, so the normalised weighted cross correlation is the cosine of the angle between them.
+  A is smooth on the scale of the triangle, so binning A by a quarter of the triangle width gives a short fingerprint
+  whose cosine is a good estimate of the normalised weighted cross correlation.
+  The fingerprints are normalised and stored in a vantage-point tree with the Euclidean distance, 2 - 2 cos.
+
+  All patterns must have the same 2theta range and step.
+*/
+class PowderPatternIndex
+{
+public:
+
+    // l is the same as in normalised_weighted_cross_correlation().
+    explicit PowderPatternIndex( const Angle l = Angle( 3.0, Angle::DEGREES ) );
+
+    void reserve( const size_t npatterns );
+
+    // The patterns are numbered in the order in which they are added.
+    void push_back( const PowderPattern & powder_pattern );
+
+    size_t size() const { return npatterns_; }
+
+    size_t fingerprint_size() const { return fingerprint_size_; }
+
+    // Returns the numbers of the k patterns with the most similar fingerprints, most similar first.
+    // estimated_similarities are the corresponding estimates of the normalised weighted cross correlation.
+    std::vector< size_t > find_most_similar( const PowderPattern & powder_pattern, const size_t k, std::vector< double > & estimated_similarities ) const;
+
+    // The estimate of the normalised weighted cross correlation with pattern i.
+    double estimated_similarity( const PowderPattern & powder_pattern, const size_t i ) const;
+
+    // The estimate of the normalised weighted cross correlation between patterns i and j of the index,
+    // from the stored fingerprints only, so this is much cheaper than the overload above.
+    double estimated_similarity( const size_t i, const size_t j ) const;
+
+private:
+    static const size_t no_node = static_cast< size_t >( -1 );
+
+    struct Node
+    {
+        size_t pattern;
+        double threshold; // Distance to the vantage point that separates the inner from the outer subtree
+        size_t inner;     // no_node if there is no subtree
+        size_t outer;
+    };
+
+    Angle l_;
+    size_t npoints_;
+    int m_;
+    size_t bin_size_;
+    size_t fingerprint_size_;
+    size_t npatterns_;
+    std::vector< double > fingerprints_; // npatterns_ x fingerprint_size_
+    // The tree is built when it is first needed after patterns have been added, thread-safe
+    struct Tree
+    {
+        std::vector< Node > nodes_;
+        size_t root_;
+    };
+    LazyCache< Tree > tree_;
+
+    std::vector< double > fingerprint( const PowderPattern & powder_pattern ) const;
+    double distance( const double * lhs, const double * rhs ) const;
+    const Tree & tree() const;
+    size_t build_tree( Tree & tree, std::vector< size_t > & patterns, const size_t begin, const size_t end ) const;
+    // heap is a max-heap of ( distance, pattern ) with at most k entries
+    void search( const Tree & tree, const size_t node, const double * query, const size_t k, std::vector< std::pair< double, size_t > > & heap ) const;
+};
+
+#endif // POWDERPATTERNINDEX_H
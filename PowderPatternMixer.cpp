@@ -0,0 +1,282 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternMixer.h"
+#include "FileName.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+
+const size_t header_size = 64;
+const char magic[] = "PPMIXES1";
+
+// Number of mixtures per parallel job and number of 2theta points per tile,
+// a tile of all phases then fits comfortably in the L2 cache.
+const size_t mixtures_per_block = 16;
+const size_t points_per_tile = 256;
+
+// The header: magic, number of points, number of mixtures, single precision, wavelength, 2theta start and 2theta step in radians.
+// Multi-byte values are stored in the native byte order.
+struct Header
+{
+    unsigned long long npoints;
+    unsigned long long nmixtures;
+    unsigned long long single_precision;
+    double wavelength;
+    double two_theta_start;
+    double two_theta_step;
+};
+
+Header read_header( std::ifstream & input_file, const FileName & file_name )
+{
+    char header[ header_size ];
+    if ( ( ! input_file.read( header, header_size ) ) || ( std::memcmp( header, magic, 8 ) != 0 ) )
+        throw std::runtime_error( "read_mixture(): file is not a mixtures file " + file_name.full_name() );
+    Header result;
+    std::memcpy( &result.npoints         , header +  8, 8 );
+    std::memcpy( &result.nmixtures       , header + 16, 8 );
+    std::memcpy( &result.single_precision, header + 24, 8 );
+    std::memcpy( &result.wavelength      , header + 32, 8 );
+    std::memcpy( &result.two_theta_start , header + 40, 8 );
+    std::memcpy( &result.two_theta_step  , header + 48, 8 );
+    return result;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+PowderPatternMixer::PowderPatternMixer( const std::vector< PowderPattern > & phases ):
+nphases_( phases.size() ),
+npoints_(0),
+wavelength_(1.54056),
+add_Poisson_noise_(false),
+seed_(1),
+nthreads_(0)
+{
+    if ( phases.empty() )
+        throw std::runtime_error( "PowderPatternMixer::PowderPatternMixer(): no phases." );
+    npoints_ = phases[0].size();
+    if ( npoints_ < 2 )
+        throw std::runtime_error( "PowderPatternMixer::PowderPatternMixer(): phases must have at least two points." );
+    for ( size_t i( 1 ); i != nphases_; ++i )
+    {
+        if ( ! same_range( phases[0], phases[i] ) )
+            throw std::runtime_error( "PowderPatternMixer::PowderPatternMixer(): phases must have the same 2theta range." );
+    }
+    wavelength_ = phases[0].wavelength();
+    two_theta_start_ = phases[0].two_theta_start();
+    two_theta_step_ = phases[0].average_two_theta_step();
+    phases_.resize( nphases_ * npoints_ );
+    for ( size_t i( 0 ); i != nphases_; ++i )
+        std::copy( phases[i].intensities(), phases[i].intensities() + npoints_, phases_.begin() + i * npoints_ );
+    background_ = std::vector< double >( npoints_, 0.0 );
+}
+
+// ********************************************************************************
+
+void PowderPatternMixer::set_background( const PowderPattern & background )
+{
+    if ( ( background.size() != npoints_ ) || ( ! nearly_equal( background.two_theta_start(), two_theta_start_ ) ) )
+        throw std::runtime_error( "PowderPatternMixer::set_background(): background must have the same 2theta range as the phases." );
+    background_.assign( background.intensities(), background.intensities() + npoints_ );
+}
+
+// ********************************************************************************
+
+void PowderPatternMixer::set_constant_background( const double background )
+{
+    background_ = std::vector< double >( npoints_, background );
+}
+
+// ********************************************************************************
+
+void PowderPatternMixer::mix( const std::vector< double > & weights, std::vector< double > & intensities, const size_t first_mixture ) const
+{
+    if ( ( weights.size() % nphases_ ) != 0 )
+        throw std::runtime_error( "PowderPatternMixer::mix(): number of weights is not a multiple of the number of phases." );
+    const size_t nmixtures = weights.size() / nphases_;
+    intensities.resize( nmixtures * npoints_ );
+    const size_t nblocks = ( nmixtures + mixtures_per_block - 1 ) / mixtures_per_block;
+    parallel_for( nblocks, nthreads_, [&]( const size_t block )
+    {
+        const size_t first = block * mixtures_per_block;
+        const size_t n = std::min( mixtures_per_block, nmixtures - first );
+        mix_block( &weights[ first * nphases_ ], n, first_mixture + first, &intensities[ first * npoints_ ] );
+    } );
+}
+
+// ********************************************************************************
+
+PowderPattern PowderPatternMixer::mix( const std::vector< double > & weights, const size_t mixture ) const
+{
+    if ( weights.size() < ( mixture + 1 ) * nphases_ )
+        throw std::runtime_error( "PowderPatternMixer::mix(): not enough weights." );
+    PowderPattern result( two_theta_start_, two_theta_start_ + ( npoints_ - 1 ) * two_theta_step_, two_theta_step_ );
+    result.set_wavelength( wavelength_ );
+    mix_block( &weights[ mixture * nphases_ ], 1, mixture, result.intensities() );
+    result.recalculate_estimated_standard_deviations();
+    return result;
+}
+
+// ********************************************************************************
+
+void PowderPatternMixer::mix_to_file( const std::vector< double > & weights, const FileName & file_name, const bool single_precision ) const
+{
+    if ( ( weights.size() % nphases_ ) != 0 )
+        throw std::runtime_error( "PowderPatternMixer::mix_to_file(): number of weights is not a multiple of the number of phases." );
+    const size_t nmixtures = weights.size() / nphases_;
+    std::ofstream output_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! output_file )
+        throw std::runtime_error( "PowderPatternMixer::mix_to_file(): Could not open file " + file_name.full_name() );
+    char header[ header_size ];
+    std::memset( header, 0, header_size );
+    std::memcpy( header, magic, 8 );
+    unsigned long long value = npoints_;
+    std::memcpy( header + 8, &value, 8 );
+    value = nmixtures;
+    std::memcpy( header + 16, &value, 8 );
+    value = single_precision ? 1 : 0;
+    std::memcpy( header + 24, &value, 8 );
+    std::memcpy( header + 32, &wavelength_, 8 );
+    double angle = two_theta_start_.value_in_radians();
+    std::memcpy( header + 40, &angle, 8 );
+    angle = two_theta_step_.value_in_radians();
+    std::memcpy( header + 48, &angle, 8 );
+    output_file.write( header, header_size );
+    // Batches of a few blocks per thread: enough to keep all threads busy, small enough to bound the memory
+    const size_t batch_size = mixtures_per_block * 4 * ( ( nthreads_ == 0 ) ? default_nthreads() : nthreads_ );
+    std::vector< double > batch_weights;
+    std::vector< double > intensities;
+    std::vector< float > single_precision_intensities;
+    for ( size_t first( 0 ); first < nmixtures; first += batch_size )
+    {
+        const size_t n = std::min( batch_size, nmixtures - first );
+        batch_weights.assign( weights.begin() + first * nphases_, weights.begin() + ( first + n ) * nphases_ );
+        mix( batch_weights, intensities, first );
+        if ( single_precision )
+        {
+            single_precision_intensities.assign( intensities.begin(), intensities.end() );
+            output_file.write( reinterpret_cast< const char * >( &single_precision_intensities[0] ), single_precision_intensities.size() * sizeof( float ) );
+        }
+        else
+            output_file.write( reinterpret_cast< const char * >( &intensities[0] ), intensities.size() * sizeof( double ) );
+    }
+    if ( ! output_file )
+        throw std::runtime_error( "PowderPatternMixer::mix_to_file(): error writing file " + file_name.full_name() );
+}
+
+// ********************************************************************************
+
+void PowderPatternMixer::mix_block( const double * weights, const size_t nmixtures, const size_t first_mixture, double * result ) const
+{
+    for ( size_t tile_start( 0 ); tile_start < npoints_; tile_start += points_per_tile )
+    {
+        const size_t tile_end = std::min( tile_start + points_per_tile, npoints_ );
+        for ( size_t i( 0 ); i != nmixtures; ++i )
+        {
+            double * row = result + i * npoints_;
+            std::copy( background_.begin() + tile_start, background_.begin() + tile_end, row + tile_start );
+            for ( size_t k( 0 ); k != nphases_; ++k )
+            {
+                const double weight = weights[ i * nphases_ + k ];
+                if ( weight == 0.0 )
+                    continue;
+                const double * phase = &phases_[ k * npoints_ ];
+                for ( size_t j( tile_start ); j != tile_end; ++j )
+                    row[j] += weight * phase[j];
+            }
+        }
+    }
+    if ( ! add_Poisson_noise_ )
+        return;
+    for ( size_t i( 0 ); i != nmixtures; ++i )
+    {
+        // One generator per mixture, so that the noise does not depend on how the mixtures are distributed over the threads
+        std::seed_seq seed_sequence{ seed_, static_cast< unsigned int >( first_mixture + i ), static_cast< unsigned int >( static_cast< unsigned long long >( first_mixture + i ) >> 32 ) };
+        std::mt19937 generator( seed_sequence );
+        double * row = result + i * npoints_;
+        for ( size_t j( 0 ); j != npoints_; ++j )
+        {
+            if ( row[j] > 0.0 )
+            {
+                std::poisson_distribution< long > poisson_distribution( row[j] );
+                row[j] = static_cast< double >( poisson_distribution( generator ) );
+            }
+        }
+    }
+}
+
+// ********************************************************************************
+
+size_t nmixtures_in_file( const FileName & file_name )
+{
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+        throw std::runtime_error( "nmixtures_in_file(): Could not open file " + file_name.full_name() );
+    return read_header( input_file, file_name ).nmixtures;
+}
+
+// ********************************************************************************
+
+PowderPattern read_mixture( const FileName & file_name, const size_t i )
+{
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+        throw std::runtime_error( "read_mixture(): Could not open file " + file_name.full_name() );
+    Header header = read_header( input_file, file_name );
+    if ( i >= header.nmixtures )
+        throw std::runtime_error( "read_mixture(): mixture index out of range." );
+    const size_t value_size = header.single_precision ? sizeof( float ) : sizeof( double );
+    Angle two_theta_start = Angle::from_radians( header.two_theta_start );
+    Angle two_theta_step = Angle::from_radians( header.two_theta_step );
+    PowderPattern result( two_theta_start, two_theta_start + ( header.npoints - 1.0 ) * two_theta_step, two_theta_step );
+    result.set_wavelength( header.wavelength );
+    input_file.seekg( header_size + i * header.npoints * value_size );
+    if ( header.single_precision )
+    {
+        std::vector< float > values( header.npoints );
+        input_file.read( reinterpret_cast< char * >( &values[0] ), header.npoints * sizeof( float ) );
+        std::copy( values.begin(), values.end(), result.intensities() );
+    }
+    else
+        input_file.read( reinterpret_cast< char * >( result.intensities() ), header.npoints * sizeof( double ) );
+    if ( ! input_file )
+        throw std::runtime_error( "read_mixture(): error reading file " + file_name.full_name() );
+    result.recalculate_estimated_standard_deviations();
+    return result;
+}
+
+// ********************************************************************************
+
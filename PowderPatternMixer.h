@@ -0,0 +1,100 @@
+#ifndef POWDERPATTERNMIXER_H
+#define POWDERPATTERNMIXER_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class FileName;
+
+#include "Angle.h"
+#include "PowderPattern.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+/*
+  Generates many mixtures of a library of phases, e.g. as training sets for quantitative phase analysis.
+
+  The phase patterns are stored as one dense matrix, one row per phase, and a batch of mixtures is the product of
+  the weight matrix (one row per mixture) and this matrix, plus the background, plus optionally Poisson noise.
+  The product is calculated in tiles over the 2theta points, in parallel over blocks of mixtures.
+  The noise for mixture i only depends on the seed and on i, so the results do not depend on the number of threads.
+*/
+class PowderPatternMixer
+{
+public:
+
+    // All phases must have the same 2theta range and step.
+    explicit PowderPatternMixer( const std::vector< PowderPattern > & phases );
+
+    size_t nphases() const { return nphases_; }
+    size_t npoints() const { return npoints_; }
+
+    // Added to every mixture before the noise is added. Must have the same 2theta range and step as the phases.
+    void set_background( const PowderPattern & background );
+    void set_constant_background( const double background );
+
+    void set_Poisson_noise( const bool add_Poisson_noise, const unsigned int seed = 1 ) { add_Poisson_noise_ = add_Poisson_noise; seed_ = seed; }
+
+    // 0 means one thread per core.
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; }
+
+    // weights contains nmixtures x nphases() values, one row per mixture.
+    // On return, intensities contains nmixtures x npoints() values, one row per mixture.
+    // first_mixture is the number of the first mixture, which determines the noise.
+    void mix( const std::vector< double > & weights, std::vector< double > & intensities, const size_t first_mixture = 0 ) const;
+
+    // A single mixture as a PowderPattern, the same as row mixture of mix().
+    PowderPattern mix( const std::vector< double > & weights, const size_t mixture ) const;
+
+    // Writes all mixtures to one binary file, in batches, so that the mixtures never need to be in memory at the same time.
+    // The file consists of a 64-byte header and then the intensities as one row per mixture, see read_mixture().
+    void mix_to_file( const std::vector< double > & weights, const FileName & file_name, const bool single_precision = true ) const;
+
+private:
+    size_t nphases_;
+    size_t npoints_;
+    double wavelength_;
+    Angle two_theta_start_;
+    Angle two_theta_step_;
+    std::vector< double > phases_; // nphases_ x npoints_
+    std::vector< double > background_;
+    bool add_Poisson_noise_;
+    unsigned int seed_;
+    size_t nthreads_;
+
+    // Calculates nmixtures mixtures from nmixtures rows of weights into nmixtures rows of result, first_mixture is the number of the first one.
+    void mix_block( const double * weights, const size_t nmixtures, const size_t first_mixture, double * result ) const;
+};
+
+// Number of mixtures in a file written by PowderPatternMixer::mix_to_file().
+size_t nmixtures_in_file( const FileName & file_name );
+
+// Reads mixture i from a file written by PowderPatternMixer::mix_to_file().
+PowderPattern read_mixture( const FileName & file_name, const size_t i );
+
+#endif // POWDERPATTERNMIXER_H
@@ -0,0 +1,212 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternSeries.h"
+#include "3DCalculations.h"
+#include "Eigenvalue.h"
+#include "Matrix3D.h"
+#include "MillerIndices.h"
+#include "NormalisedVector3D.h"
+#include "Pressure.h"
+#include "ReflectionList.h"
+#include "SymmetricMatrix3D.h"
+#include "Temperature.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+CrystalLattice interpolate( const CrystalLattice & lhs, const CrystalLattice & rhs, const double t )
+{
+    return CrystalLattice( ( 1.0 - t ) * lhs.a() + t * rhs.a(),
+                           ( 1.0 - t ) * lhs.b() + t * rhs.b(),
+                           ( 1.0 - t ) * lhs.c() + t * rhs.c(),
+                           Angle::from_degrees( ( 1.0 - t ) * lhs.alpha().value_in_degrees() + t * rhs.alpha().value_in_degrees() ),
+                           Angle::from_degrees( ( 1.0 - t ) * lhs.beta().value_in_degrees()  + t * rhs.beta().value_in_degrees()  ),
+                           Angle::from_degrees( ( 1.0 - t ) * lhs.gamma().value_in_degrees() + t * rhs.gamma().value_in_degrees() ) );
+}
+
+// ********************************************************************************
+
+// A copy of reflection_list with the d-spacings for crystal_lattice and F^2 multiplied by exp( -delta_B / 2d^2 ).
+ReflectionList adapt_reflection_list( const ReflectionList & reflection_list, const CrystalLattice & crystal_lattice, const double delta_B )
+{
+    const ReciprocalBasis reciprocal_basis( crystal_lattice );
+    ReflectionList result;
+    result.reserve( reflection_list.size() );
+    std::vector< Vector3D > equivalent_directions;
+    for ( size_t i( 0 ); i != reflection_list.size(); ++i )
+    {
+        const MillerIndices miller_indices = reflection_list.miller_indices( i );
+        const double length2 = reciprocal_basis.length2( miller_indices.h(), miller_indices.k(), miller_indices.l() );
+        const double F_squared = reflection_list.F_squared( i ) * std::exp( -0.5 * delta_B * length2 );
+        equivalent_directions.clear();
+        for ( size_t j( 0 ); j != reflection_list.nequivalent_directions( i ); ++j )
+            equivalent_directions.push_back( reflection_list.equivalent_direction( i, j ) );
+        result.push_back( miller_indices, F_squared, 1.0 / std::sqrt( length2 ), reflection_list.multiplicity( i ), equivalent_directions );
+    }
+    return result;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+LatticeExpansion::LatticeExpansion( const CrystalLattice & crystal_lattice, const double reference_value,
+                                    const Vector3D & linear_coefficients, const Vector3D & quadratic_coefficients, const Vector3D & angle_coefficients ):
+crystal_lattice_(crystal_lattice),
+reference_value_(reference_value),
+linear_coefficients_(linear_coefficients),
+quadratic_coefficients_(quadratic_coefficients),
+angle_coefficients_(angle_coefficients)
+{
+}
+
+// ********************************************************************************
+
+LatticeExpansion::LatticeExpansion( const std::vector< double > & values, const std::vector< CrystalLattice > & crystal_lattices ):
+reference_value_(0.0),
+values_(values),
+crystal_lattices_(crystal_lattices)
+{
+    if ( values_.size() != crystal_lattices_.size() )
+        throw std::runtime_error( "LatticeExpansion::LatticeExpansion(): number of values and number of unit cells differ." );
+    if ( values_.size() < 2 )
+        throw std::runtime_error( "LatticeExpansion::LatticeExpansion(): at least two unit cells are needed for an interpolation." );
+    for ( size_t i( 1 ); i != values_.size(); ++i )
+    {
+        if ( ! ( values_[i-1] < values_[i] ) )
+            throw std::runtime_error( "LatticeExpansion::LatticeExpansion(): values must be sorted in increasing order." );
+    }
+}
+
+// ********************************************************************************
+
+CrystalLattice LatticeExpansion::crystal_lattice( const double value ) const
+{
+    if ( values_.empty() )
+    {
+        const double dx = value - reference_value_;
+        return CrystalLattice( crystal_lattice_.a() * ( 1.0 + linear_coefficients_.x() * dx + quadratic_coefficients_.x() * dx * dx ),
+                               crystal_lattice_.b() * ( 1.0 + linear_coefficients_.y() * dx + quadratic_coefficients_.y() * dx * dx ),
+                               crystal_lattice_.c() * ( 1.0 + linear_coefficients_.z() * dx + quadratic_coefficients_.z() * dx * dx ),
+                               crystal_lattice_.alpha() + Angle::from_degrees( angle_coefficients_.x() * dx ),
+                               crystal_lattice_.beta()  + Angle::from_degrees( angle_coefficients_.y() * dx ),
+                               crystal_lattice_.gamma() + Angle::from_degrees( angle_coefficients_.z() * dx ) );
+    }
+    // The segment [i,i+1] that contains value, the first or the last segment beyond the ends
+    const size_t i = std::min( static_cast<size_t>( std::upper_bound( values_.begin(), values_.end(), value ) - values_.begin() ), values_.size() - 1 );
+    const size_t first = ( i == 0 ) ? 0 : i - 1;
+    return interpolate( crystal_lattices_[first], crystal_lattices_[first+1], ( value - values_[first] ) / ( values_[first+1] - values_[first] ) );
+}
+
+// ********************************************************************************
+
+PowderPatternSeries::PowderPatternSeries( const CrystalStructure & crystal_structure, const LatticeExpansion & lattice_expansion, const double reference_value ):
+crystal_structure_(crystal_structure),
+crystal_lattice_(crystal_structure.crystal_lattice()),
+lattice_expansion_(lattice_expansion),
+reference_value_(reference_value),
+powder_pattern_calculator_(crystal_structure_),
+structure_factors_(CACHED),
+dB_dx_(0.0)
+{
+}
+
+// ********************************************************************************
+
+std::vector< PowderPattern > PowderPatternSeries::calculate( const std::vector< double > & values )
+{
+    std::vector< PowderPattern > result( values.size() );
+    std::vector< CrystalLattice > crystal_lattices;
+    for ( size_t i( 0 ); i != values.size(); ++i )
+        crystal_lattices.push_back( lattice_expansion_.crystal_lattice( values[i] ) );
+    if ( structure_factors_ == RECALCULATED )
+    {
+        for ( size_t i( 0 ); i != values.size(); ++i )
+        {
+            crystal_structure_.set_crystal_lattice( crystal_lattices[i] );
+            powder_pattern_calculator_.calculate_reflection_list();
+            powder_pattern_calculator_.calculate_structure_factors();
+            powder_pattern_calculator_.calculate( adapt_reflection_list( powder_pattern_calculator_.reflection_list(), crystal_lattices[i], dB_dx_ * ( values[i] - reference_value_ ) ), result[i] );
+        }
+        crystal_structure_.set_crystal_lattice( crystal_lattice_ );
+        powder_pattern_calculator_.invalidate_reflection_list();
+        return result;
+    }
+    // A reciprocal-lattice vector changes as H(x) = T H(x0), with T = B(x) B(x0)^-1 and B the reciprocal basis vectors as columns,
+    // so |H(x)| >= sqrt( lambda ) |H(x0)| with lambda the smallest eigenvalue of T^T T. A reflection can only fall in the 2theta range
+    // for one of the unit cells if |H(x0)| <= scale |H|max with scale the largest 1 / sqrt( lambda ). Multiplying the unit-cell
+    // lengths by scale divides all |H| by scale, so the reflection list of the scaled unit cell contains all those reflections.
+    double scale( 1.0 );
+    std::vector< double > eigenvalues;
+    std::vector< NormalisedVector3D > eigenvectors;
+    for ( size_t i( 0 ); i != values.size(); ++i )
+    {
+        const Matrix3D T = transpose( crystal_lattice_.fractional_to_orthogonal_matrix() * crystal_lattices[i].orthogonal_to_fractional_matrix() );
+        const Matrix3D TT = transpose( T ) * T;
+        calculate_eigenvalues_analytical( SymmetricMatrix3D( TT.value( 0, 0 ), TT.value( 1, 1 ), TT.value( 2, 2 ), TT.value( 0, 1 ), TT.value( 0, 2 ), TT.value( 1, 2 ) ), eigenvalues, eigenvectors );
+        scale = std::max( scale, 1.0 / std::sqrt( eigenvalues[0] ) );
+    }
+    scale *= 1.000001;
+    crystal_structure_.set_crystal_lattice( CrystalLattice( scale * crystal_lattice_.a(), scale * crystal_lattice_.b(), scale * crystal_lattice_.c(),
+                                                            crystal_lattice_.alpha(), crystal_lattice_.beta(), crystal_lattice_.gamma() ) );
+    powder_pattern_calculator_.calculate_reflection_list();
+    const ReflectionList scaled_reflection_list = powder_pattern_calculator_.reflection_list();
+    crystal_structure_.set_crystal_lattice( crystal_lattice_ );
+    // The structure factors for the unit cell as given
+    powder_pattern_calculator_.set_reflection_list( adapt_reflection_list( scaled_reflection_list, crystal_lattice_, 0.0 ) );
+    powder_pattern_calculator_.calculate_structure_factors();
+    const ReflectionList reflection_list = powder_pattern_calculator_.reflection_list();
+    for ( size_t i( 0 ); i != values.size(); ++i )
+        powder_pattern_calculator_.calculate( adapt_reflection_list( reflection_list, crystal_lattices[i], dB_dx_ * ( values[i] - reference_value_ ) ), result[i] );
+    powder_pattern_calculator_.invalidate_reflection_list();
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< PowderPattern > PowderPatternSeries::calculate( const std::vector< Temperature > & temperatures )
+{
+    std::vector< double > values;
+    for ( size_t i( 0 ); i != temperatures.size(); ++i )
+        values.push_back( temperatures[i].value_in_Kelvin() );
+    return calculate( values );
+}
+
+// ********************************************************************************
+
+std::vector< PowderPattern > PowderPatternSeries::calculate( const std::vector< Pressure > & pressures )
+{
+    std::vector< double > values;
+    for ( size_t i( 0 ); i != pressures.size(); ++i )
+        values.push_back( pressures[i].value_in_GPa() );
+    return calculate( values );
+}
@@ -0,0 +1,135 @@
+#ifndef POWDERPATTERNSERIES_H
+#define POWDERPATTERNSERIES_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class Pressure;
+class Temperature;
+
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "Vector3D.h"
+
+#include <vector>
+
+/*
+  The unit cell as a function of one variable x, the temperature in K or the pressure in GPa.
+
+  Either an expansion model around the unit cell at a reference value x0, with dx = x - x0:
+      a(x) = a(x0) ( 1 + alpha_a dx + beta_a dx^2 ), the same for b and c,
+      alpha(x) = alpha(x0) + gamma_alpha dx, with gamma in degrees per unit of x, the same for beta and gamma.
+  Negative coefficients describe a compression, e.g. as a function of pressure.
+  Or an interpolation between unit cells at two or more values of x: the six unit-cell parameters are interpolated linearly
+  between neighbouring values, and extrapolated linearly from the first or last two beyond the ends.
+*/
+class LatticeExpansion
+{
+public:
+
+    // linear_coefficients and quadratic_coefficients are alpha and beta for a, b and c, angle_coefficients are gamma in degrees for alpha, beta and gamma.
+    LatticeExpansion( const CrystalLattice & crystal_lattice, const double reference_value,
+                      const Vector3D & linear_coefficients, const Vector3D & quadratic_coefficients = Vector3D(), const Vector3D & angle_coefficients = Vector3D() );
+
+    // values must be sorted in increasing order.
+    LatticeExpansion( const std::vector< double > & values, const std::vector< CrystalLattice > & crystal_lattices );
+
+    CrystalLattice crystal_lattice( const double value ) const;
+
+private:
+    // Expansion model
+    CrystalLattice crystal_lattice_;
+    double reference_value_;
+    Vector3D linear_coefficients_;
+    Vector3D quadratic_coefficients_;
+    Vector3D angle_coefficients_;
+    // Interpolation, empty for the expansion model
+    std::vector< double > values_;
+    std::vector< CrystalLattice > crystal_lattices_;
+};
+
+/*
+  Powder patterns of one crystal structure at a series of temperatures or pressures, e.g. to compare with a variable-temperature
+  experiment. The fractional coordinates are kept fixed and only the unit cell changes.
+
+  With CACHED structure factors, F^2 is calculated once for the crystal structure as given, for all reflections that can fall
+  in the 2theta range for any of the unit cells of the series. For each pattern only the d-spacings are recalculated and the
+  peaks are placed again, so a series costs little more than a single pattern. The scattering factors are not recalculated for
+  the new d-spacings, which is a small approximation. RECALCULATED calculates the reflection list and the structure factors
+  for each unit cell from scratch.
+
+  For both, an isotropic change of the Debye-Waller factor B(x) = B(x0) + dB/dx ( x - x0 ) can be applied to F^2,
+  as exp( -( B(x) - B(x0) ) / 2d^2 ). The default dB/dx is 0.0, no correction.
+  The preferred-orientation correction, if any, uses the unit cell of the crystal structure as given.
+*/
+class PowderPatternSeries
+{
+public:
+
+    enum StructureFactors { CACHED, RECALCULATED };
+
+    // The crystal structure is copied, the space-group symmetry must have been applied. reference_value is the x of the crystal structure as given,
+    // the unit cells of the series come from lattice_expansion.
+    PowderPatternSeries( const CrystalStructure & crystal_structure, const LatticeExpansion & lattice_expansion, const double reference_value );
+
+    // For the wavelength, the 2theta range, the peak shape etc. The unit cell of its crystal structure is changed by calculate().
+    PowderPatternCalculator & powder_pattern_calculator() { return powder_pattern_calculator_; }
+
+    StructureFactors structure_factors() const { return structure_factors_; }
+    void set_structure_factors( const StructureFactors structure_factors ) { structure_factors_ = structure_factors; }
+
+    // In A^2 per unit of x. The default is 0.0.
+    double dB_dx() const { return dB_dx_; }
+    void set_dB_dx( const double dB_dx ) { dB_dx_ = dB_dx; }
+
+    // One pattern per value, each normalised as by PowderPatternCalculator::calculate().
+    std::vector< PowderPattern > calculate( const std::vector< double > & values );
+
+    // In K.
+    std::vector< PowderPattern > calculate( const std::vector< Temperature > & temperatures );
+
+    // In GPa.
+    std::vector< PowderPattern > calculate( const std::vector< Pressure > & pressures );
+
+private:
+    CrystalStructure crystal_structure_;
+    CrystalLattice crystal_lattice_; // As given, crystal_structure_ gets the unit cells of the series
+    LatticeExpansion lattice_expansion_;
+    double reference_value_;
+    PowderPatternCalculator powder_pattern_calculator_; // Refers to crystal_structure_
+    StructureFactors structure_factors_;
+    double dB_dx_;
+
+    // Not copyable
+    PowderPatternSeries( const PowderPatternSeries & );
+    PowderPatternSeries & operator=( const PowderPatternSeries & );
+};
+
+#endif // POWDERPATTERNSERIES_H
@@ -0,0 +1,314 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternServer.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "Logger.h"
+#include "ReadCif.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// Number of candidates from the fingerprint index for which the similarity is calculated in full, per match requested.
+const size_t candidates_per_match = 4;
+
+// Requests longer than this are rejected.
+const size_t maximum_request_length = 65536;
+
+// How often, in milliseconds, run() and the connections check whether a shutdown was requested.
+const int poll_interval = 200;
+
+// ********************************************************************************
+
+std::string JSON_string( const std::string & input )
+{
+    std::string result( "\"" );
+    for ( size_t i( 0 ); i != input.size(); ++i )
+    {
+        if ( ( input[i] == '"' ) || ( input[i] == '\\' ) )
+            result += '\\';
+        if ( static_cast< unsigned char >( input[i] ) < 0x20 )
+            result += ' ';
+        else
+            result += input[i];
+    }
+    return result + "\"";
+}
+
+// ********************************************************************************
+
+std::string JSON_error( const std::string & message )
+{
+    return "{\"status\":\"error\",\"message\":" + JSON_string( message ) + "}";
+}
+
+} // namespace
+
+// ********************************************************************************
+
+PowderPatternServer::PowderPatternServer( const FileList & file_list ):
+index_( Angle( 1.0, Angle::DEGREES ) ),
+shutdown_requested_(false)
+{
+    for ( size_t i( 0 ); i != file_list.size(); ++i )
+        names_.push_back( file_list.value( i ).full_name() );
+    BatchPowderPatternCalculator batch_powder_pattern_calculator;
+    configure( batch_powder_pattern_calculator );
+    log_info( "Now calculating " + size_t2string( file_list.size() ) + " powder patterns... " );
+    batch_powder_pattern_calculator.calculate( file_list );
+    build_library( batch_powder_pattern_calculator );
+}
+
+// ********************************************************************************
+
+PowderPatternServer::PowderPatternServer( const std::vector< CrystalStructure > & crystal_structures, const std::vector< std::string > & names ):
+names_(names),
+index_( Angle( 1.0, Angle::DEGREES ) ),
+shutdown_requested_(false)
+{
+    if ( names_.size() != crystal_structures.size() )
+        throw std::runtime_error( "PowderPatternServer::PowderPatternServer(): numbers of structures and names differ." );
+    BatchPowderPatternCalculator batch_powder_pattern_calculator;
+    configure( batch_powder_pattern_calculator );
+    batch_powder_pattern_calculator.calculate( crystal_structures );
+    build_library( batch_powder_pattern_calculator );
+}
+
+// ********************************************************************************
+
+std::string PowderPatternServer::handle_request( const std::string & request ) const
+{
+    try
+    {
+        std::vector< std::string > words = split( strip( request ) );
+        if ( words.empty() )
+            return JSON_error( "Empty request." );
+        if ( ( words[0] == "ping" ) && ( words.size() == 1 ) )
+            return "{\"status\":\"ok\",\"npatterns\":" + size_t2string( size() ) + "}";
+        if ( ( words[0] == "shutdown" ) && ( words.size() == 1 ) )
+        {
+            shutdown_requested_ = true;
+            return "{\"status\":\"ok\"}";
+        }
+        if ( ( words[0] == "pattern" ) && ( words.size() == 2 ) )
+        {
+            PowderPattern powder_pattern = calculate_powder_pattern( words[1] );
+            std::string result = "{\"status\":\"ok\",\"two_theta_start\":" + double2string( powder_pattern.two_theta_start().value_in_degrees() ) +
+                                 ",\"two_theta_step\":" + double2string( powder_pattern.average_two_theta_step().value_in_degrees() ) + ",\"intensities\":[";
+            for ( size_t i( 0 ); i != powder_pattern.size(); ++i )
+                result += ( i == 0 ? "" : "," ) + double2string( powder_pattern.intensity( i ) );
+            return result + "]}";
+        }
+        if ( ( words[0] == "compare" ) && ( ( words.size() == 2 ) || ( words.size() == 3 ) ) )
+        {
+            size_t k( 10 );
+            if ( words.size() == 3 )
+            {
+                int value = string2integer( words[2] );
+                if ( value < 1 )
+                    throw std::runtime_error( "The number of matches must be positive." );
+                k = value;
+            }
+            PowderPattern powder_pattern = calculate_powder_pattern( words[1] );
+            // Pre-screen with the fingerprints, then calculate the similarities of the candidates in full.
+            std::vector< double > estimated_similarities;
+            std::vector< size_t > candidates = index_.find_most_similar( powder_pattern, candidates_per_match * k, estimated_similarities );
+            std::vector< std::pair< double, size_t > > matches;
+            matches.reserve( candidates.size() );
+            for ( size_t i( 0 ); i != candidates.size(); ++i )
+                matches.push_back( std::make_pair( -normalised_weighted_cross_correlation( powder_pattern, library_[ candidates[i] ], Angle( 1.0, Angle::DEGREES ) ), candidates[i] ) );
+            std::sort( matches.begin(), matches.end() );
+            matches.resize( std::min( k, matches.size() ) );
+            std::string result( "{\"status\":\"ok\",\"matches\":[" );
+            for ( size_t i( 0 ); i != matches.size(); ++i )
+                result += std::string( i == 0 ? "" : "," ) + "{\"index\":" + size_t2string( matches[i].second ) + ",\"name\":" + JSON_string( names_[ matches[i].second ] ) +
+                          ",\"similarity\":" + double2string( -matches[i].first ) + "}";
+            return result + "]}";
+        }
+        if ( ( words[0] == "rmscd" ) && ( words.size() == 3 ) )
+        {
+            CrystalStructure crystal_structure_1;
+            read_cif( FileName( words[1] ), crystal_structure_1 );
+            CrystalStructure crystal_structure_2;
+            read_cif( FileName( words[2] ), crystal_structure_2 );
+            return "{\"status\":\"ok\",\"rmscd\":" + double2string( root_mean_square_Cartesian_displacement( crystal_structure_1, crystal_structure_2 ) ) + "}";
+        }
+        return JSON_error( "Unknown request: " + words[0] );
+    }
+    catch ( std::exception & e )
+    {
+        return JSON_error( e.what() );
+    }
+}
+
+// ********************************************************************************
+
+void PowderPatternServer::run( const FileName & socket_file_name )
+{
+#ifdef _WIN32
+    throw std::runtime_error( "PowderPatternServer::run(): local sockets are not supported on this platform." );
+#else
+    const std::string path = socket_file_name.full_name();
+    sockaddr_un address;
+    if ( path.size() >= sizeof( address.sun_path ) )
+        throw std::runtime_error( "PowderPatternServer::run(): socket file name too long: " + path );
+    std::memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    std::strcpy( address.sun_path, path.c_str() );
+    int listening_socket = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( listening_socket < 0 )
+        throw std::runtime_error( "PowderPatternServer::run(): cannot create socket." );
+    // A socket file left behind by a previous run would make bind() fail.
+    unlink( path.c_str() );
+    if ( ( bind( listening_socket, reinterpret_cast< sockaddr * >( &address ), sizeof( address ) ) != 0 ) || ( listen( listening_socket, 16 ) != 0 ) )
+    {
+        close( listening_socket );
+        throw std::runtime_error( "PowderPatternServer::run(): cannot listen on socket " + path );
+    }
+    log_info( "Now serving " + size_t2string( size() ) + " powder patterns on " + path );
+    shutdown_requested_ = false;
+    std::vector< std::thread > threads;
+    while ( ! shutdown_requested_ )
+    {
+        pollfd poll_fd;
+        poll_fd.fd = listening_socket;
+        poll_fd.events = POLLIN;
+        if ( poll( &poll_fd, 1, poll_interval ) <= 0 )
+            continue;
+        int connection = accept( listening_socket, 0, 0 );
+        if ( connection < 0 )
+            continue;
+        threads.push_back( std::thread( &PowderPatternServer::serve_connection, this, connection ) );
+    }
+    close( listening_socket );
+    unlink( path.c_str() );
+    for ( size_t i( 0 ); i != threads.size(); ++i )
+        threads[i].join();
+    Logger::instance().flush();
+#endif
+}
+
+// ********************************************************************************
+
+void PowderPatternServer::configure( BatchPowderPatternCalculator & batch_powder_pattern_calculator ) const
+{
+    batch_powder_pattern_calculator.set_wavelength( 1.54056 );
+    batch_powder_pattern_calculator.set_two_theta_start( Angle( 3.0, Angle::DEGREES ) );
+    batch_powder_pattern_calculator.set_two_theta_end( Angle( 35.0, Angle::DEGREES ) );
+    batch_powder_pattern_calculator.set_two_theta_step( Angle( 0.01, Angle::DEGREES ) );
+    batch_powder_pattern_calculator.set_FWHM( 0.1 );
+}
+
+// ********************************************************************************
+
+void PowderPatternServer::build_library( const BatchPowderPatternCalculator & batch_powder_pattern_calculator )
+{
+    library_.reserve( batch_powder_pattern_calculator.npatterns() );
+    index_.reserve( batch_powder_pattern_calculator.npatterns() );
+    for ( size_t i( 0 ); i != batch_powder_pattern_calculator.npatterns(); ++i )
+    {
+        library_.push_back( batch_powder_pattern_calculator.powder_pattern( i ) );
+        index_.push_back( library_.back() );
+    }
+    // The vantage-point tree is built by the first search, do that now so that searches from several threads do not race.
+    if ( ! library_.empty() )
+    {
+        std::vector< double > estimated_similarities;
+        index_.find_most_similar( library_[0], 1, estimated_similarities );
+    }
+}
+
+// ********************************************************************************
+
+PowderPattern PowderPatternServer::calculate_powder_pattern( const std::string & cif_file_name ) const
+{
+    std::vector< CrystalStructure > crystal_structures( 1 );
+    read_cif( FileName( cif_file_name ), crystal_structures[0] );
+    crystal_structures[0].apply_space_group_symmetry();
+    // The same code path as for the library, with one thread because the requests themselves are served in parallel.
+    BatchPowderPatternCalculator batch_powder_pattern_calculator;
+    configure( batch_powder_pattern_calculator );
+    batch_powder_pattern_calculator.set_nthreads( 1 );
+    batch_powder_pattern_calculator.calculate( crystal_structures );
+    return batch_powder_pattern_calculator.powder_pattern( 0 );
+}
+
+// ********************************************************************************
+
+void PowderPatternServer::serve_connection( const int socket ) const
+{
+#ifndef _WIN32
+    std::string buffer;
+    char data[4096];
+    while ( ! shutdown_requested_ )
+    {
+        pollfd poll_fd;
+        poll_fd.fd = socket;
+        poll_fd.events = POLLIN;
+        if ( poll( &poll_fd, 1, poll_interval ) == 0 )
+            continue;
+        ssize_t nbytes = recv( socket, data, sizeof( data ), 0 );
+        if ( nbytes <= 0 )
+            break;
+        buffer.append( data, nbytes );
+        size_t iPos;
+        while ( ( iPos = buffer.find( '\n' ) ) != std::string::npos )
+        {
+            std::string response = handle_request( buffer.substr( 0, iPos ) ) + "\n";
+            buffer.erase( 0, iPos + 1 );
+            size_t nsent( 0 );
+            while ( nsent != response.size() )
+            {
+                ssize_t n = send( socket, response.data() + nsent, response.size() - nsent, MSG_NOSIGNAL );
+                if ( n <= 0 )
+                    break;
+                nsent += n;
+            }
+        }
+        if ( buffer.size() > maximum_request_length )
+            break;
+    }
+    close( socket );
+#endif
+}
+
@@ -0,0 +1,99 @@
+#ifndef POWDERPATTERNSERVER_H
+#define POWDERPATTERNSERVER_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+class FileList;
+class FileName;
+
+#include "BatchPowderPatternCalculator.h"
+#include "PowderPattern.h"
+#include "PowderPatternIndex.h"
+
+#include <atomic>
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+/*
+  Keeps a library of calculated reference powder patterns and their fingerprint index in memory and answers
+  requests for it, so that a front end does not have to re-read and recalculate the library for every query.
+
+  One request per line, one response per line, the response is a JSON object with "status" either "ok" or "error":
+
+    pattern <file.cif>
+        The calculated powder pattern: "two_theta_start", "two_theta_step" and "intensities".
+    compare <file.cif> [k]
+        The k (default 10) most similar reference patterns: "matches", each with "index", "name" and "similarity".
+    rmscd <file_1.cif> <file_2.cif>
+        The root-mean-square Cartesian displacement: "rmscd".
+    ping
+        The number of reference patterns: "npatterns".
+    shutdown
+        Stops run(), open connections are closed after their current request.
+
+  The patterns are calculated with the settings of calculate_correlation_matrix( FileList ), the similarity is
+  normalised_weighted_cross_correlation() with l = 1 degree.
+  The library is not changed after construction, so handle_request() can be called from several threads at once.
+*/
+class PowderPatternServer
+{
+public:
+
+    // Reads the .cif files and calculates their powder patterns, the names are the file names.
+    explicit PowderPatternServer( const FileList & file_list );
+
+    // The space-group symmetry must have been applied.
+    PowderPatternServer( const std::vector< CrystalStructure > & crystal_structures, const std::vector< std::string > & names );
+
+    size_t size() const { return library_.size(); }
+
+    std::string name( const size_t i ) const { return names_[i]; }
+
+    // Returns the response without the terminating newline. Errors are returned as a response, never thrown.
+    std::string handle_request( const std::string & request ) const;
+
+    // Listens on a local (Unix-domain) socket, each connection is served by its own thread.
+    // Returns when a "shutdown" request has been received. Not supported on Windows.
+    void run( const FileName & socket_file_name );
+
+private:
+    std::vector< std::string > names_;
+    std::vector< PowderPattern > library_;
+    PowderPatternIndex index_;
+    mutable std::atomic< bool > shutdown_requested_;
+
+    void configure( BatchPowderPatternCalculator & batch_powder_pattern_calculator ) const;
+    void build_library( const BatchPowderPatternCalculator & batch_powder_pattern_calculator );
+    PowderPattern calculate_powder_pattern( const std::string & cif_file_name ) const;
+    void serve_connection( const int socket ) const;
+};
+
+#endif // POWDERPATTERNSERVER_H
@@ -28,10 +28,39 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Quaternion.h"
 #include "Matrix3D.h"
 #include "Utilities.h"
+#include "Vector3D.h"
 
+#include <cmath>
 #include <iostream> // For debugging
 #include <stdexcept>
 
+namespace
+{
+
+// The rotation matrix of the normalised quaternion a + b*i + c*j + d*k, stored row by row.
+inline void rotation_matrix_elements( const double a, const double b, const double c, const double d, double r[9] )
+{
+    const double ab = a*b;
+    const double ac = a*c;
+    const double ad = a*d;
+    const double bb = b*b;
+    const double bc = b*c;
+    const double bd = b*d;
+    const double cc = c*c;
+    const double cd = c*d;
+    const double dd = d*d;
+    r[0] = 1.0 - 2.0*( cc + dd );
+    r[1] = 2.0*( bc - ad );
+    r[2] = 2.0*( bd + ac );
+    r[3] = 2.0*( bc + ad );
+    r[4] = 1.0 - 2.0*( bb + dd );
+    r[5] = 2.0*( cd - ab );
+    r[6] = 2.0*( bd - ac );
+    r[7] = 2.0*( cd + ab );
+    r[8] = 1.0 - 2.0*( bb + cc );
+}
+
+} // namespace
 
 // ********************************************************************************
 
@@ -48,15 +77,57 @@ Quaternion::Quaternion( const double a, const double b, const double c, const do
 
 // ********************************************************************************
 
+// Shepperd's method: the largest of the four components is calculated from the diagonal, the others from the off-diagonal elements.
 Quaternion::Quaternion( const Matrix3D & rotation_matrix )
 {
+    const double m00 = rotation_matrix.value( 0, 0 );
+    const double m11 = rotation_matrix.value( 1, 1 );
+    const double m22 = rotation_matrix.value( 2, 2 );
+    const double trace = m00 + m11 + m22;
+    if ( ( trace > m00 ) && ( trace > m11 ) && ( trace > m22 ) )
+    {
+        const double s = 2.0 * std::sqrt( 1.0 + trace );
+        a_ = 0.25 * s;
+        b_ = ( rotation_matrix.value( 2, 1 ) - rotation_matrix.value( 1, 2 ) ) / s;
+        c_ = ( rotation_matrix.value( 0, 2 ) - rotation_matrix.value( 2, 0 ) ) / s;
+        d_ = ( rotation_matrix.value( 1, 0 ) - rotation_matrix.value( 0, 1 ) ) / s;
+    }
+    else if ( ( m00 > m11 ) && ( m00 > m22 ) )
+    {
+        const double s = 2.0 * std::sqrt( 1.0 + m00 - m11 - m22 );
+        a_ = ( rotation_matrix.value( 2, 1 ) - rotation_matrix.value( 1, 2 ) ) / s;
+        b_ = 0.25 * s;
+        c_ = ( rotation_matrix.value( 0, 1 ) + rotation_matrix.value( 1, 0 ) ) / s;
+        d_ = ( rotation_matrix.value( 0, 2 ) + rotation_matrix.value( 2, 0 ) ) / s;
+    }
+    else if ( m11 > m22 )
+    {
+        const double s = 2.0 * std::sqrt( 1.0 + m11 - m00 - m22 );
+        a_ = ( rotation_matrix.value( 0, 2 ) - rotation_matrix.value( 2, 0 ) ) / s;
+        b_ = ( rotation_matrix.value( 0, 1 ) + rotation_matrix.value( 1, 0 ) ) / s;
+        c_ = 0.25 * s;
+        d_ = ( rotation_matrix.value( 1, 2 ) + rotation_matrix.value( 2, 1 ) ) / s;
+    }
+    else
+    {
+        const double s = 2.0 * std::sqrt( 1.0 + m22 - m00 - m11 );
+        a_ = ( rotation_matrix.value( 1, 0 ) - rotation_matrix.value( 0, 1 ) ) / s;
+        b_ = ( rotation_matrix.value( 0, 2 ) + rotation_matrix.value( 2, 0 ) ) / s;
+        c_ = ( rotation_matrix.value( 1, 2 ) + rotation_matrix.value( 2, 1 ) ) / s;
+        d_ = 0.25 * s;
+    }
+    normalise();
 }
 
 // ********************************************************************************
 
 Matrix3D Quaternion::rotation_matrix() const
 {
-    return Matrix3D();
+    double r[9];
+    rotation_matrix_elements( a_, b_, c_, d_, r );
+    return Matrix3D( r[0], r[1], r[2],
+                     r[3], r[4], r[5],
+                     r[6], r[7], r[8] );
 }
 
 // ********************************************************************************
@@ -197,3 +268,91 @@ bool nearly_equal( const Quaternion lhs, const Quaternion rhs, const double tole
 
 // ********************************************************************************
 
+void QuaternionList::resize( const size_t n )
+{
+    a_.resize( n, 1.0 );
+    b_.resize( n, 0.0 );
+    c_.resize( n, 0.0 );
+    d_.resize( n, 0.0 );
+}
+
+// ********************************************************************************
+
+void QuaternionList::push_back( const Quaternion & quaternion )
+{
+    a_.push_back( quaternion.a() );
+    b_.push_back( quaternion.b() );
+    c_.push_back( quaternion.c() );
+    d_.push_back( quaternion.d() );
+}
+
+// ********************************************************************************
+
+void QuaternionList::set_quaternion( const size_t i, const Quaternion & quaternion )
+{
+    a_[i] = quaternion.a();
+    b_[i] = quaternion.b();
+    c_[i] = quaternion.c();
+    d_[i] = quaternion.d();
+}
+
+// ********************************************************************************
+
+void rotation_matrices( const QuaternionList & quaternions, std::vector< double > & elements )
+{
+    const size_t n = quaternions.size();
+    elements.resize( 9 * n );
+    const double * a = quaternions.a().data();
+    const double * b = quaternions.b().data();
+    const double * c = quaternions.c().data();
+    const double * d = quaternions.d().data();
+    double * r = elements.data();
+    for ( size_t i( 0 ); i < n; ++i )
+    {
+        double m[9];
+        rotation_matrix_elements( a[i], b[i], c[i], d[i], m );
+        for ( size_t j( 0 ); j != 9; ++j )
+            r[ j * n + i ] = m[j];
+    }
+}
+
+// ********************************************************************************
+
+void rotate( const Quaternion & quaternion, const std::vector< Vector3D > & input, std::vector< Vector3D > & output )
+{
+    double r[9];
+    rotation_matrix_elements( quaternion.a(), quaternion.b(), quaternion.c(), quaternion.d(), r );
+    output.resize( input.size() );
+    for ( size_t i( 0 ); i != input.size(); ++i )
+    {
+        const double x = input[i].x();
+        const double y = input[i].y();
+        const double z = input[i].z();
+        output[i] = Vector3D( r[0]*x + r[1]*y + r[2]*z,
+                              r[3]*x + r[4]*y + r[5]*z,
+                              r[6]*x + r[7]*y + r[8]*z );
+    }
+}
+
+// ********************************************************************************
+
+void rotate( const Quaternion & quaternion, std::vector< double > & x, std::vector< double > & y, std::vector< double > & z )
+{
+    if ( ( y.size() != x.size() ) || ( z.size() != x.size() ) )
+        throw std::runtime_error( "rotate(): x, y and z must have the same size." );
+    double r[9];
+    rotation_matrix_elements( quaternion.a(), quaternion.b(), quaternion.c(), quaternion.d(), r );
+    const size_t n = x.size();
+    for ( size_t i( 0 ); i < n; ++i )
+    {
+        const double x_i = x[i];
+        const double y_i = y[i];
+        const double z_i = z[i];
+        x[i] = r[0]*x_i + r[1]*y_i + r[2]*z_i;
+        y[i] = r[3]*x_i + r[4]*y_i + r[5]*z_i;
+        z[i] = r[6]*x_i + r[7]*y_i + r[8]*z_i;
+    }
+}
+
+// ********************************************************************************
+
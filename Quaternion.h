@@ -32,7 +32,11 @@ class Matrix3D; // It would be cleaner if Quaternion did not have to know about
                 // this Quaternion class is not really a general quaternion class but a rotation class,
                 // it makes sense to add the conversion to and from a rotation matrix in here.
 
+class Vector3D;
+
+#include <cstddef>
 #include <string>
+#include <vector>
 
 /*
   This is a "unit quaternion" or a "normalised quaternion" or "versor" used for representing rotations, not a general quaternion.
@@ -95,5 +99,57 @@ private:
 
 bool nearly_equal( const Quaternion lhs, const Quaternion rhs, const double tolerance = 0.000001 );
 
+/*
+  Structure-of-arrays storage for many quaternions, so that batches can be generated and converted in loops that the compiler can vectorise.
+  The quaternions are assumed to be normalised, the storage does not enforce that.
+*/
+class QuaternionList
+{
+public:
+
+    QuaternionList() {}
+
+    // n identity quaternions
+    explicit QuaternionList( const size_t n ): a_(n,1.0), b_(n,0.0), c_(n,0.0), d_(n,0.0) {}
+
+    size_t size() const { return a_.size(); }
+    bool empty() const { return a_.empty(); }
+
+    // New quaternions are identity quaternions
+    void resize( const size_t n );
+
+    void push_back( const Quaternion & quaternion );
+
+    Quaternion quaternion( const size_t i ) const { return Quaternion( a_[i], b_[i], c_[i], d_[i] ); }
+    void set_quaternion( const size_t i, const Quaternion & quaternion );
+
+    const std::vector< double > & a() const { return a_; }
+    const std::vector< double > & b() const { return b_; }
+    const std::vector< double > & c() const { return c_; }
+    const std::vector< double > & d() const { return d_; }
+
+    std::vector< double > & a() { return a_; }
+    std::vector< double > & b() { return b_; }
+    std::vector< double > & c() { return c_; }
+    std::vector< double > & d() { return d_; }
+
+private:
+    std::vector< double > a_;
+    std::vector< double > b_;
+    std::vector< double > c_;
+    std::vector< double > d_;
+};
+
+// Converts all quaternions to rotation matrices at once.
+// Element ( row, column ) of the rotation matrix of quaternion i is stored in elements[ ( 3*row + column ) * n + i ].
+void rotation_matrices( const QuaternionList & quaternions, std::vector< double > & elements );
+
+// Rotates a block of points, e.g. the coordinates of a molecule, without constructing a Matrix3D.
+// output may be the same vector as input.
+void rotate( const Quaternion & quaternion, const std::vector< Vector3D > & input, std::vector< Vector3D > & output );
+
+// As above, for coordinates stored as separate arrays. The coordinates are rotated in place.
+void rotate( const Quaternion & quaternion, std::vector< double > & x, std::vector< double > & y, std::vector< double > & z );
+
 #endif // QUATERNION_H
 
@@ -27,11 +27,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "RandomNumberGenerator.h"
 
-#include <cstddef> // For definition of size_t
+#include <stdexcept>
 
 // ********************************************************************************
 
-RandomNumberGenerator_integer::RandomNumberGenerator_integer( const int idum )
+RandomNumberGenerator_integer::RandomNumberGenerator_integer( const int idum, const RandomNumberEngine engine ):
+engine_(engine),
+xoshiro_( static_cast<uint64_t>( idum ) ),
+Philox_( static_cast<uint64_t>( idum ) ),
+Philox_available_(0)
 {
     IM1 = 2147483563; // 2,147,483,563
     IM2 = 2147483399;
@@ -74,6 +78,12 @@ RandomNumberGenerator_integer::RandomNumberGenerator_integer( const int idum )
 
 int RandomNumberGenerator_integer::next_number( const int start, const int end )
 {
+    if ( engine_ != LECUYER )
+    {
+        // Multiply-shift instead of a modulo, 32 random bits are plenty for the ranges used
+        const uint64_t range = static_cast<uint64_t>( static_cast<int64_t>( end ) - start + 1 );
+        return start + static_cast<int>( ( next_32_bits() * range ) >> 32 );
+    }
     int k = idum_ / IQ1;
     idum_ = IA1*(idum_-k*IQ1)-k*IR1;
     if ( idum_ < 0 )
@@ -92,7 +102,65 @@ int RandomNumberGenerator_integer::next_number( const int start, const int end )
 
 // ********************************************************************************
 
-RandomNumberGenerator_double::RandomNumberGenerator_double( const int idum )
+void RandomNumberGenerator_integer::fill( int * values, const size_t n, const int start, const int end )
+{
+    for ( size_t i( 0 ); i != n; ++i )
+        values[i] = next_number( start, end );
+}
+
+// ********************************************************************************
+
+void RandomNumberGenerator_integer::jump()
+{
+    if ( engine_ == XOSHIRO256STARSTAR )
+        xoshiro_.jump();
+    else if ( engine_ == PHILOX4X32 )
+    {
+        Philox_.jump();
+        Philox_available_ = 0;
+    }
+    else
+        throw std::runtime_error( "RandomNumberGenerator_integer::jump(): the L'Ecuyer generator cannot jump." );
+}
+
+// ********************************************************************************
+
+std::vector< RandomNumberGenerator_integer > RandomNumberGenerator_integer::split( const size_t n ) const
+{
+    std::vector< RandomNumberGenerator_integer > result;
+    result.reserve( n );
+    RandomNumberGenerator_integer generator( *this );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        generator.jump();
+        result.push_back( generator );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+uint32_t RandomNumberGenerator_integer::next_32_bits()
+{
+    if ( engine_ == XOSHIRO256STARSTAR )
+        return static_cast<uint32_t>( xoshiro_.next() >> 32 );
+    if ( Philox_available_ == 0 )
+    {
+        Philox_.next_block( Philox_buffer_ );
+        Philox_available_ = 4;
+    }
+    --Philox_available_;
+    return Philox_buffer_[ 3 - Philox_available_ ];
+}
+
+// ********************************************************************************
+
+RandomNumberGenerator_double::RandomNumberGenerator_double( const int idum, const RandomNumberEngine engine ):
+engine_(engine),
+xoshiro_( static_cast<uint64_t>( idum ) ),
+Philox_( static_cast<uint64_t>( idum ) ),
+Philox_buffer_(0.0),
+Philox_buffer_available_(false)
 {
     IM1 = 2147483563;
     IM2 = 2147483399;
@@ -135,6 +203,27 @@ RandomNumberGenerator_double::RandomNumberGenerator_double( const int idum )
 // ********************************************************************************
 
 double RandomNumberGenerator_double::next_number()
+{
+    if ( engine_ == XOSHIRO256STARSTAR )
+        return xoshiro_.next_double();
+    if ( engine_ == PHILOX4X32 )
+    {
+        if ( Philox_buffer_available_ )
+        {
+            Philox_buffer_available_ = false;
+            return Philox_buffer_;
+        }
+        double result;
+        Philox_.next_doubles( result, Philox_buffer_ );
+        Philox_buffer_available_ = true;
+        return result;
+    }
+    return next_number_LEcuyer();
+}
+
+// ********************************************************************************
+
+double RandomNumberGenerator_double::next_number_LEcuyer()
 {
     int k = idum_ / IQ1;
     idum_ = IA1*(idum_-k*IQ1)-k*IR1;
@@ -154,3 +243,46 @@ double RandomNumberGenerator_double::next_number()
 
 // ********************************************************************************
 
+void RandomNumberGenerator_double::fill( double * values, const size_t n )
+{
+    if ( engine_ == XOSHIRO256STARSTAR )
+    {
+        xoshiro_.fill( values, n );
+        return;
+    }
+    for ( size_t i( 0 ); i != n; ++i )
+        values[i] = next_number();
+}
+
+// ********************************************************************************
+
+void RandomNumberGenerator_double::jump()
+{
+    if ( engine_ == XOSHIRO256STARSTAR )
+        xoshiro_.jump();
+    else if ( engine_ == PHILOX4X32 )
+    {
+        Philox_.jump();
+        Philox_buffer_available_ = false;
+    }
+    else
+        throw std::runtime_error( "RandomNumberGenerator_double::jump(): the L'Ecuyer generator cannot jump." );
+}
+
+// ********************************************************************************
+
+std::vector< RandomNumberGenerator_double > RandomNumberGenerator_double::split( const size_t n ) const
+{
+    std::vector< RandomNumberGenerator_double > result;
+    result.reserve( n );
+    RandomNumberGenerator_double generator( *this );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        generator.jump();
+        result.push_back( generator );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
@@ -28,8 +28,19 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "Philox.h"
+#include "Xoshiro256StarStar.h"
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
 #include <vector>
 
+// LECUYER is the combined L'Ecuyer generator with a Bays-Durham shuffle table that has always been used here,
+// and it is the default, so that existing idum seeds give bit-for-bit the same sequences as before.
+// It cannot jump or be split. XOSHIRO256STARSTAR and PHILOX4X32 are seeded with idum, are faster,
+// and support jump() and split() for parallel use (e.g. one generator per thread).
+enum RandomNumberEngine { LECUYER, XOSHIRO256STARSTAR, PHILOX4X32 };
+
 // The classes for integers and for doubles are virtually identical, the decision to split them
 // was deliberate: if both are combined into one class, the integer random number generator is used
 // for both the integers and the doubles and this gives a correlation between the two. The way it is
@@ -40,11 +51,30 @@ class RandomNumberGenerator_integer
 public:
     
     // idum should be positive and not zero
-    RandomNumberGenerator_integer( const int idum = 1539 );
+    RandomNumberGenerator_integer( const int idum = 1539, const RandomNumberEngine engine = LECUYER );
 
+    RandomNumberEngine engine() const { return engine_; }
+
+    // Returns a number in the range [start, end].
     int next_number( const int start, const int end );
 
+    void fill( int * values, const size_t n, const int start, const int end );
+
+    // Advances the generator by 2^128 (xoshiro256**) or 2^48 (Philox) steps. Throws for LECUYER.
+    void jump();
+
+    // Returns n generators with non-overlapping sequences, generator i is this generator jumped i+1 times. Throws for LECUYER.
+    std::vector< RandomNumberGenerator_integer > split( const size_t n ) const;
+
 private:
+    RandomNumberEngine engine_;
+    Xoshiro256StarStar xoshiro_;
+    Philox4x32 Philox_;
+    uint32_t Philox_buffer_[4];
+    size_t Philox_available_;
+
+    uint32_t next_32_bits();
+
     int idum_;
     int idum2_;
     int iy_;
@@ -63,17 +93,37 @@ private:
     int NDIV;
 };
 
-// Returns a random number in the range [0.0, 1.0].
+// Returns a random number in the range [0.0, 1.0] (see next_number()).
 class RandomNumberGenerator_double
 {
 public:
     
     // idum should be positive and not zero
-    explicit RandomNumberGenerator_double( const int idum = 7381 );
+    explicit RandomNumberGenerator_double( const int idum = 7381, const RandomNumberEngine engine = LECUYER );
+
+    RandomNumberEngine engine() const { return engine_; }
 
+    // [0.0, 1.0] for LECUYER, ( 0.0, 1.0 ) with 53 random bits for the other engines.
     double next_number();
 
+    void fill( double * values, const size_t n );
+    void fill( std::vector< double > & values ) { if ( ! values.empty() ) fill( &values[0], values.size() ); }
+
+    // Advances the generator by 2^128 (xoshiro256**) or 2^48 (Philox) steps. Throws for LECUYER.
+    void jump();
+
+    // Returns n generators with non-overlapping sequences, generator i is this generator jumped i+1 times. Throws for LECUYER.
+    std::vector< RandomNumberGenerator_double > split( const size_t n ) const;
+
 private:
+    RandomNumberEngine engine_;
+    Xoshiro256StarStar xoshiro_;
+    Philox4x32 Philox_;
+    double Philox_buffer_;
+    bool Philox_buffer_available_;
+
+    double next_number_LEcuyer();
+
     int idum_;
     int idum2_;
     int iy_;
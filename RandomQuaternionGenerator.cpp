@@ -27,6 +27,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "RandomQuaternionGenerator.h"
 #include "MathConstants.h"
+#include "MathKernels.h"
 #include "Quaternion.h"
 
 #include <cmath>
@@ -50,3 +51,37 @@ Quaternion RandomQuaternionGenerator::next_quaternion()
 
 // ********************************************************************************
 
+void RandomQuaternionGenerator::next_quaternions( const size_t n, QuaternionList & quaternions )
+{
+    u1_.resize( n );
+    u2_.resize( n );
+    u3_.resize( n );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        u1_[i] = RNG_double_.next_number();
+        u2_[i] = RNG_double_.next_number();
+        u3_[i] = RNG_double_.next_number();
+    }
+    quaternions.resize( n );
+    double * a = quaternions.a().data();
+    double * b = quaternions.b().data();
+    double * c = quaternions.c().data();
+    double * d = quaternions.d().data();
+    sincos_2pi( u2_, sines_, cosines_ );
+    for ( size_t i( 0 ); i < n; ++i )
+    {
+        const double r = std::sqrt( 1.0 - u1_[i] );
+        a[i] = r * sines_[i];
+        b[i] = r * cosines_[i];
+    }
+    sincos_2pi( u3_, sines_, cosines_ );
+    for ( size_t i( 0 ); i < n; ++i )
+    {
+        const double r = std::sqrt( u1_[i] );
+        c[i] = r * sines_[i];
+        d[i] = r * cosines_[i];
+    }
+}
+
+// ********************************************************************************
+
@@ -29,9 +29,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 class Quaternion;
+class QuaternionList;
 
 #include "RandomNumberGenerator.h"
 
+#include <cstddef>
+#include <vector>
+
 /*
 
 */
@@ -45,8 +49,17 @@ public:
     
     Quaternion next_quaternion();
 
+    // Throughput mode: overwrites quaternions with the next n quaternions.
+    // Consumes the random numbers in the same order as n calls to next_quaternion(), the results agree to within rounding.
+    void next_quaternions( const size_t n, QuaternionList & quaternions );
+
 private:
     RandomNumberGenerator_double RNG_double_;
+    std::vector< double > u1_;
+    std::vector< double > u2_;
+    std::vector< double > u3_;
+    std::vector< double > sines_;
+    std::vector< double > cosines_;
 
 };
 
@@ -26,18 +26,190 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "ReadCif.h"
+#include "AsyncFileIO.h"
 #include "CheckFoundItem.h"
+#include "Compression.h"
 #include "CrystalStructure.h"
+#include "FileName.h"
+#include "Instrumentation.h"
 #include "TextFileReader.h"
 #include "TextFileWriter.h"
 #include "Utilities.h"
 
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <set>
 #include <stdexcept>
 
 #include <iostream> // For debugging
 
 namespace {
 
+// A word in the buffer of a CifLexer, i.e. a pair of pointers rather than a copy.
+class CifWord
+{
+public:
+    CifWord(): begin_(0), end_(0) {}
+    CifWord( const char * begin, const char * end ): begin_(begin), end_(end) {}
+
+    const char * begin() const { return begin_; }
+    const char * end() const { return end_; }
+    size_t length() const { return end_ - begin_; }
+    char operator[]( const size_t i ) const { return begin_[i]; }
+    bool operator==( const char * rhs ) const { return ( std::strlen( rhs ) == length() ) && ( std::strncmp( begin_, rhs, length() ) == 0 ); }
+    bool operator!=( const char * rhs ) const { return ! ( *this == rhs ); }
+    bool starts_with( const char * rhs ) const { const size_t n = std::strlen( rhs ); return ( n <= length() ) && ( std::strncmp( begin_, rhs, n ) == 0 ); }
+    std::string str() const { return std::string( begin_, end_ ); }
+    bool starts_with_ignoring_case( const char * rhs ) const
+    {
+        const size_t n = std::strlen( rhs );
+        if ( n > length() )
+            return false;
+        for ( size_t i( 0 ); i != n; ++i )
+        {
+            if ( std::tolower( begin_[i] ) != std::tolower( rhs[i] ) )
+                return false;
+        }
+        return true;
+    }
+    double to_double() const { return string2double( begin_, end_ ); }
+
+private:
+    const char * begin_;
+    const char * end_;
+};
+
+// ********************************************************************************
+
+/*
+  Reads the whole file into memory with a single read and then splits it into lines of words without copying,
+  replaces TextFileReader + split(), which allocate a std::string for every line and every word.
+  Same conventions as TextFileReader with set_skip_empty_lines( true ) and "#" as comment identifier.
+*/
+class CifLexer
+{
+public:
+
+    explicit CifLexer( const FileName & file_name ): position_(0), last_line_start_(0)
+    {
+        std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+        if ( ! input_file )
+            throw std::runtime_error( std::string( "read_cif(): Could not open file " ) + file_name.full_name() );
+        input_file.seekg( 0, std::ios::end );
+        buffer_.resize( static_cast<size_t>( input_file.tellg() ) );
+        input_file.seekg( 0, std::ios::beg );
+        if ( ! buffer_.empty() )
+            input_file.read( &buffer_[0], buffer_.size() );
+        decompress_if_compressed( buffer_ );
+    }
+
+    // Takes over the contents of buffer, e.g. one data block of a larger file.
+    explicit CifLexer( std::vector< char > & buffer ): position_(0), last_line_start_(0)
+    {
+        buffer_.swap( buffer );
+        decompress_if_compressed( buffer_ );
+    }
+
+    // Skips empty lines and comment lines. Returns false at the end of the file.
+    bool get_next_line( std::vector< CifWord > & words )
+    {
+        while ( true )
+        {
+            if ( position_ == buffer_.size() )
+                return false;
+            last_line_start_ = position_;
+            const char * line_begin = &buffer_[0] + position_;
+            const char * buffer_end = &buffer_[0] + buffer_.size();
+            const char * line_end = static_cast< const char * >( std::memchr( line_begin, '\n', buffer_end - line_begin ) );
+            if ( line_end == 0 )
+                line_end = buffer_end;
+            position_ = ( line_end == buffer_end ) ? buffer_.size() : ( line_end - &buffer_[0] ) + 1;
+            if ( ( line_begin != line_end ) && ( *line_begin == '#' ) )
+                continue;
+            split( line_begin, line_end, words );
+            if ( ! words.empty() )
+                return true;
+        }
+    }
+
+    // The next call to get_next_line() returns the same line again.
+    void push_back_last_line() { position_ = last_line_start_; }
+
+    // The number of lines from the current position onwards that do not start with a keyword, i.e. the number of rows in the current loop.
+    size_t count_loop_rows()
+    {
+        const size_t position = position_;
+        const size_t last_line_start = last_line_start_;
+        std::vector< CifWord > words;
+        size_t result( 0 );
+        while ( get_next_line( words ) && ( words[0][0] != '_' ) && ( words[0] != "loop_" ) )
+            ++result;
+        position_ = position;
+        last_line_start_ = last_line_start;
+        return result;
+    }
+
+    static bool is_white_space( const char c ) { return ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ); }
+
+    // Same rules as split() in Utilities.h.
+    static void split( const char * begin, const char * end, std::vector< CifWord > & words )
+    {
+        words.clear();
+        const char * i( begin );
+        while ( i < end )
+        {
+            while ( ( i < end ) && is_white_space( *i ) )
+                ++i;
+            if ( i == end )
+                break;
+            if ( ( *i == '"' ) || ( *i == '\'' ) )
+            {
+                const char quote = *i;
+                ++i;
+                const char * word_begin( i );
+                while ( ( i < end ) && ( *i != quote ) )
+                    ++i;
+                if ( i == end )
+                    throw std::runtime_error( "read_cif(): quote is not terminated properly: |" + std::string( begin, end ) + "|" );
+                if ( i != word_begin )
+                    words.push_back( CifWord( word_begin, i ) );
+                ++i; // Read past the quote
+                // We must now hit the end of the line or whitespace
+                if ( ( i < end ) && ( ! is_white_space( *i ) ) )
+                    throw std::runtime_error( "read_cif(): quote inside string is not allowed: |" + std::string( begin, end ) + "|" );
+            }
+            else
+            {
+                const char * word_begin( i );
+                while ( ( i < end ) && ( ! is_white_space( *i ) ) )
+                    ++i;
+                words.push_back( CifWord( word_begin, i ) );
+            }
+        }
+    }
+
+private:
+    std::vector< char > buffer_;
+    size_t position_;
+    size_t last_line_start_;
+};
+
+// ********************************************************************************
+
+// The same rule as read_cif() uses for the element of an atom: a type symbol or label of which the second character is a letter is a two-letter element.
+bool is_hydrogen_symbol( const CifWord & word )
+{
+    if ( word.length() == 0 )
+        return false;
+    const char first = static_cast< char >( std::toupper( word[0] ) );
+    if ( ( first != 'H' ) && ( first != 'D' ) )
+        return false;
+    return ( word.length() == 1 ) || ( ! isalpha( word[1] ) );
+}
+
+// ********************************************************************************
+
 class AtomLineInterpreter
 {
 public:
@@ -82,7 +254,7 @@ public:
             all_items_found_ = false; // throw std::runtime_error( "read_cif(): need one of _atom_site_label and _atom_site_type_symbol." );
     }
     
-    void interpret( const std::vector< std::string > & words, CrystalStructure & crystal_structure ) const
+    void interpret( const std::vector< CifWord > & words, CrystalStructure & crystal_structure ) const
     {
         if ( ! all_items_found_ )
             return;
@@ -95,36 +267,26 @@ public:
 //            }
             throw std::runtime_error( "read_cif(): atom line must have same number of items as specified in loop." );
         }
-        double x = string2double( words[x_coordinate_index_] );
-        double y = string2double( words[y_coordinate_index_] );
-        double z = string2double( words[z_coordinate_index_] );
-        std::string label;
-        if ( site_label_index_ != loop_items_size_ )
-            label = words[site_label_index_];
-        std::string element_string;
+        double x = words[x_coordinate_index_].to_double();
+        double y = words[y_coordinate_index_].to_double();
+        double z = words[z_coordinate_index_].to_double();
+        const CifWord & label_word = ( site_label_index_ != loop_items_size_ ) ? words[site_label_index_] : words[site_type_symbol_index_];
+        // The element is constructed directly from the words in the buffer
+        Element element;
         if ( site_type_symbol_index_ != loop_items_size_ )
-            element_string = words[site_type_symbol_index_];
-        if ( site_label_index_ == loop_items_size_ )
-            label = element_string;
-        if ( site_type_symbol_index_ == loop_items_size_ )
-        {
-            if ( label.size() == 1 )
-                element_string = label;
-            else
-            {
-                if ( isalpha( label[1] ) )
-                    element_string = label.substr( 0, 2 );
-                else
-                    element_string = label.substr( 0, 1 );
-            }
-        }
-        Atom new_atom( Element( element_string ), Vector3D( x, y, z ), label );
+            element = Element( words[site_type_symbol_index_].begin(), words[site_type_symbol_index_].end() );
+        else if ( ( label_word.length() > 1 ) && isalpha( label_word[1] ) )
+            element = Element( label_word.begin(), label_word.begin() + 2 );
+        else
+            element = Element( label_word.begin(), label_word.begin() + 1 );
+        const std::string label = label_word.str();
+        Atom new_atom( element, Vector3D( x, y, z ), label );
         if ( charge_index_ != loop_items_size_ )
-            new_atom.set_charge( string2double( words[charge_index_] ) );
+            new_atom.set_charge( words[charge_index_].to_double() );
         if ( Uiso_index_ != loop_items_size_ )
-            new_atom.set_Uiso( string2double( words[Uiso_index_] ) );
+            new_atom.set_Uiso( words[Uiso_index_].to_double() );
         if ( occupancy_index_ != loop_items_size_ )
-            new_atom.set_occupancy( string2double( words[occupancy_index_] ) );
+            new_atom.set_occupancy( words[occupancy_index_].to_double() );
         crystal_structure.add_atom( new_atom );
     }
 
@@ -188,27 +350,27 @@ public:
             throw std::runtime_error( "read_cif(): _atom_site_aniso_U_23 missing from _atom_site_aniso loop_." );
     }
 
-    void interpret( const std::vector< std::string > & words, CrystalStructure & crystal_structure ) const
+    void interpret( const std::vector< CifWord > & words, CrystalStructure & crystal_structure ) const
     {
         if ( words.size() != loop_items_size_ )
         {
             std::cout << "loop_items_size_ = " << loop_items_size_ << std::endl;
             for ( size_t i( 0 ); i != words.size(); ++i )
             {
-                std::cout << words[i] << std::endl;
+                std::cout << words[i].str() << std::endl;
             }
             throw std::runtime_error( "read_cif(): atom aniso line must have same number of items as specified in loop." );
         }
-        double U11 = string2double( words[U11_index_] );
-        double U22 = string2double( words[U22_index_] );
-        double U33 = string2double( words[U33_index_] );
-        double U12 = string2double( words[U12_index_] );
-        double U13 = string2double( words[U13_index_] );
-        double U23 = string2double( words[U23_index_] );
+        double U11 = words[U11_index_].to_double();
+        double U22 = words[U22_index_].to_double();
+        double U33 = words[U33_index_].to_double();
+        double U12 = words[U12_index_].to_double();
+        double U13 = words[U13_index_].to_double();
+        double U23 = words[U23_index_].to_double();
         SymmetricMatrix3D U_cif( U11, U22, U33, U12, U13, U23 );
         SymmetricMatrix3D U_cart = U_cif_2_U_cart( U_cif, crystal_structure.crystal_lattice() );
         AnisotropicDisplacementParameters adps = AnisotropicDisplacementParameters( U_cart );
-        size_t i = crystal_structure.find_label( words[label_index_] );
+        size_t i = crystal_structure.find_label( words[label_index_].str() );
         if ( i == crystal_structure.natoms() )
             throw std::runtime_error( "read_cif(): atom not found." );
         Atom new_atom = crystal_structure.atom( i );
@@ -231,7 +393,7 @@ private:
 
 // ********************************************************************************
 
-void deal_with_atom_loop( TextFileReader & text_file_reader, const std::vector< std::string > & loop_items, CrystalStructure & crystal_structure )
+void deal_with_atom_loop( CifLexer & cif_lexer, const std::vector< std::string > & loop_items, CrystalStructure & crystal_structure )
 {
 // We need:
 //_atom_site_label
@@ -241,14 +403,15 @@ void deal_with_atom_loop( TextFileReader & text_file_reader, const std::vector<
 //_atom_site_fract_z
 
     AtomLineInterpreter atom_line_interpreter( loop_items );
-    std::vector< std::string > words;
+    crystal_structure.reserve_natoms( crystal_structure.natoms() + cif_lexer.count_loop_rows() );
+    std::vector< CifWord > words;
     do // Read the atoms
     {
-        if ( ! text_file_reader.get_next_line( words ) )
+        if ( ! cif_lexer.get_next_line( words ) )
             return;
         if ( ( words[0][0] == '_' ) || ( words[0] == "loop_" ) )
         {
-            text_file_reader.push_back_last_line();
+            cif_lexer.push_back_last_line();
             return;
         }
         // When we are here, we have an atom line
@@ -258,7 +421,7 @@ void deal_with_atom_loop( TextFileReader & text_file_reader, const std::vector<
 
 // ********************************************************************************
 
-void deal_with_symmetry_loop( TextFileReader & text_file_reader, const std::vector< std::string > & loop_items, CrystalStructure & crystal_structure )
+void deal_with_symmetry_loop( CifLexer & cif_lexer, const std::vector< std::string > & loop_items, CrystalStructure & crystal_structure )
 {
 //loop_
 //_symmetry_equiv_pos_site_id
@@ -275,15 +438,15 @@ void deal_with_symmetry_loop( TextFileReader & text_file_reader, const std::vect
     if ( symmetry_equiv_pos_as_xyz_index == loop_items.size() )
         throw std::runtime_error( "read_cif(): _symmetry_equiv_pos_as_xyz must be present." );
     std::vector< SymmetryOperator > symmetry_operators;
-    std::vector< std::string > words;
+    std::vector< CifWord > words;
     bool finished( false );
     do // Read the symmetry operators
     {
-        if ( ! text_file_reader.get_next_line( words ) )
+        if ( ! cif_lexer.get_next_line( words ) )
             finished = true;
         else if ( ( words[0][0] == '_' ) || ( words[0] == "loop_" ) )
         {
-            text_file_reader.push_back_last_line();
+            cif_lexer.push_back_last_line();
             finished = true;
         }
         // When we are here, we have a symmetry line
@@ -291,8 +454,7 @@ void deal_with_symmetry_loop( TextFileReader & text_file_reader, const std::vect
         {
             if ( words.size() != loop_items.size() )
                 throw std::runtime_error( "read_cif(): symmetry line must have same number of items as specified in loop." );
-            SymmetryOperator symmetry_operator( words[symmetry_equiv_pos_as_xyz_index] );
-            symmetry_operators.push_back( symmetry_operator );
+            symmetry_operators.push_back( cached_symmetry_operator( words[symmetry_equiv_pos_as_xyz_index].str() ) );
         }
     } while ( ! finished );
     SpaceGroup space_group( symmetry_operators, "P21/c" );
@@ -301,7 +463,7 @@ void deal_with_symmetry_loop( TextFileReader & text_file_reader, const std::vect
 
 // ********************************************************************************
 
-void deal_with_aniso_loop( TextFileReader & text_file_reader, const std::vector< std::string > & loop_items, CrystalStructure & crystal_structure )
+void deal_with_aniso_loop( CifLexer & cif_lexer, const std::vector< std::string > & loop_items, CrystalStructure & crystal_structure )
 {
 //    loop_
 //    _atom_site_aniso_label
@@ -314,14 +476,14 @@ void deal_with_aniso_loop( TextFileReader & text_file_reader, const std::vector<
 //    Cl1 0.1071(7) 0.1580(10) 0.0482(5) -0.0068(7) 0.0000(5) -0.0108(5)
 
     AnisoLineInterpreter aniso_line_interpreter( loop_items );
-    std::vector< std::string > words;
+    std::vector< CifWord > words;
     do // Read the ADPs
     {
-        if ( ! text_file_reader.get_next_line( words ) )
+        if ( ! cif_lexer.get_next_line( words ) )
             return;
         if ( ( words[0][0] == '_' ) || ( words[0] == "loop_" ) || ( words[0] == "#END" ) )
         {
-            text_file_reader.push_back_last_line();
+            cif_lexer.push_back_last_line();
             return;
         }
         // When we are here, we have an aniso line
@@ -331,23 +493,23 @@ void deal_with_aniso_loop( TextFileReader & text_file_reader, const std::vector<
 
 // ********************************************************************************
 
-void get_loop_items( TextFileReader & text_file_reader, std::vector< std::string > & loop_items )
+void get_loop_items( CifLexer & cif_lexer, std::vector< std::string > & loop_items )
 {
-    std::vector< std::string > words;
+    std::vector< CifWord > words;
     bool OK( true );
     do // Read the loop item keywords
     {
-        if ( ! text_file_reader.get_next_line( words ) )
+        if ( ! cif_lexer.get_next_line( words ) )
             throw std::runtime_error( "read_cif(): loop empty." );
         if ( words[0][0] == '_' )
         {
             if ( words.size() != 1 )
                 throw std::runtime_error( "read_cif(): loop_ item cannot have value." );
-            loop_items.push_back( words[0] );
+            loop_items.push_back( words[0].str() );
         }
         else
         {
-            text_file_reader.push_back_last_line();
+            cif_lexer.push_back_last_line();
             return;
         }
     } while ( OK );
@@ -355,31 +517,31 @@ void get_loop_items( TextFileReader & text_file_reader, std::vector< std::string
 
 // ********************************************************************************
 
-void deal_with_loop( TextFileReader & text_file_reader, CrystalStructure & crystal_structure )
+void deal_with_loop( CifLexer & cif_lexer, CrystalStructure & crystal_structure )
 {
-    std::vector< std::string > words;
-    if ( ! text_file_reader.get_next_line( words ) )
+    std::vector< CifWord > words;
+    if ( ! cif_lexer.get_next_line( words ) )
         throw std::runtime_error( "read_cif(): loop empty." );
     if ( words[0].length() < 5 )
         throw std::runtime_error( "read_cif(): unrecognised loop keyword." );
     if ( words[0][0] != '_' )
         throw std::runtime_error( "read_cif(): no keyword after loop keyword." );
-    text_file_reader.push_back_last_line();
+    cif_lexer.push_back_last_line();
     std::vector< std::string > loop_items;
-    get_loop_items( text_file_reader, loop_items );
-    if ( words[0].substr( 0, 16 ) == "_atom_site_aniso" )
+    get_loop_items( cif_lexer, loop_items );
+    if ( loop_items[0].substr( 0, 16 ) == "_atom_site_aniso" )
     {
-        deal_with_aniso_loop( text_file_reader, loop_items, crystal_structure );
+        deal_with_aniso_loop( cif_lexer, loop_items, crystal_structure );
         return;
     }
-    if ( words[0].substr( 0, 5 ) == "_atom" )
+    if ( loop_items[0].substr( 0, 5 ) == "_atom" )
     {
-        deal_with_atom_loop( text_file_reader, loop_items, crystal_structure );
+        deal_with_atom_loop( cif_lexer, loop_items, crystal_structure );
         return;
     }
-    if ( words[0].substr( 0, 9 ) == "_symmetry" )
+    if ( loop_items[0].substr( 0, 9 ) == "_symmetry" )
     {
-        deal_with_symmetry_loop( text_file_reader, loop_items, crystal_structure );
+        deal_with_symmetry_loop( cif_lexer, loop_items, crystal_structure );
         return;
     }
     // For the moment we ignore everything else
@@ -422,15 +584,11 @@ void deal_with_loop( TextFileReader & text_file_reader, CrystalStructure & cryst
 
 // ********************************************************************************
 
-// A very simple cif reader, can essentially only read cifs from MD trajectories
-// from Materials Studio.
-void read_cif( const FileName & file_name, CrystalStructure & crystal_structure )
+namespace {
+
+// Interprets everything that cif_lexer returns as one data block.
+void parse_cif( CifLexer & cif_lexer, CrystalStructure & crystal_structure )
 {
-    TextFileReader text_file_reader( file_name );
-    text_file_reader.set_skip_empty_lines( true ); // This is crucial
-    std::vector< std::string > comment_identifiers;
-    comment_identifiers.push_back( "#" );
-    text_file_reader.set_comment_identifiers( comment_identifiers );
     std::string name;
     std::string space_group_str;
     bool found_a( false );
@@ -445,66 +603,66 @@ void read_cif( const FileName & file_name, CrystalStructure & crystal_structure
     Angle alpha;
     Angle beta;
     Angle gamma;
-    std::vector< std::string > words;
-    while ( text_file_reader.get_next_line( words ) )
+    std::vector< CifWord > words;
+    while ( cif_lexer.get_next_line( words ) )
     {
 
         // According to the cif standard, data_ and loop_ are case-insensitive.
 
-        if ( ( words[0].length() > 4 ) && ( to_lower( words[0].substr( 0, 5 ) ) == "data_" ) )
+        if ( words[0].starts_with_ignoring_case( "data_" ) )
         {
             if ( words.size() != 1 )
                 throw std::runtime_error( "read_cif(): data_ keyword cannot have a value." );
-            name = words[0].substr( 5, std::string::npos );
+            name = words[0].str().substr( 5, std::string::npos );
             continue;
         }
-        if ( to_lower( words[0] == "loop_" ) )
+        if ( words[0].starts_with_ignoring_case( "loop_" ) && ( words[0].length() == 5 ) )
         {
             if ( words.size() != 1 )
                 throw std::runtime_error( "read_cif(): loop_ keyword cannot have a value." );
-            deal_with_loop( text_file_reader, crystal_structure );
+            deal_with_loop( cif_lexer, crystal_structure );
             continue;
         }
         if ( words.size() == 2 )
         {
             if ( words[0] == "_symmetry_space_group_name_H-M" )
             {
-                space_group_str = words[1];
+                space_group_str = words[1].str();
                 continue;
             }
             if ( words[0] == "_cell_length_a" )
             {
-                a = string2double( words[1] );
+                a = words[1].to_double();
                 found_a = true;
                 continue;
             }
             if ( words[0] == "_cell_length_b" )
             {
-                b = string2double( words[1] );
+                b = words[1].to_double();
                 found_b = true;
                 continue;
             }
             if ( words[0] == "_cell_length_c" )
             {
-                c = string2double( words[1] );
+                c = words[1].to_double();
                 found_c = true;
                 continue;
             }
             if ( words[0] == "_cell_angle_alpha" )
             {
-                alpha = Angle::from_degrees( string2double( words[1] ) );
+                alpha = Angle::from_degrees( words[1].to_double() );
                 found_alpha = true;
                 continue;
             }
             if ( words[0] == "_cell_angle_beta" )
             {
-                beta = Angle::from_degrees( string2double( words[1] ) );
+                beta = Angle::from_degrees( words[1].to_double() );
                 found_beta = true;
                 continue;
             }
             if ( words[0] == "_cell_angle_gamma" )
             {
-                gamma = Angle::from_degrees( string2double( words[1] ) );
+                gamma = Angle::from_degrees( words[1].to_double() );
                 found_gamma = true;
                 continue;
             }
@@ -525,6 +683,216 @@ void read_cif( const FileName & file_name, CrystalStructure & crystal_structure
 
 // ********************************************************************************
 
+bool is_data_line( const std::string & line )
+{
+    size_t i( 0 );
+    while ( ( i != line.length() ) && ( ( line[i] == ' ' ) || ( line[i] == '\t' ) ) )
+        ++i;
+    if ( line.length() < i + 5 )
+        return false;
+    for ( size_t j( 0 ); j != 5; ++j )
+    {
+        if ( std::tolower( line[i+j] ) != "data_"[j] )
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+// A very simple cif reader, can essentially only read cifs from MD trajectories
+// from Materials Studio.
+void read_cif( const FileName & file_name, CrystalStructure & crystal_structure )
+{
+    MACRO_SCOPED_TIMER( "read_cif()" );
+    CifLexer cif_lexer( file_name );
+    parse_cif( cif_lexer, crystal_structure );
+}
+
+// ********************************************************************************
+
+void read_cif( std::vector< char > & contents, CrystalStructure & crystal_structure )
+{
+    MACRO_SCOPED_TIMER( "read_cif()" );
+    CifLexer cif_lexer( contents );
+    parse_cif( cif_lexer, crystal_structure );
+}
+
+// ********************************************************************************
+
+FileName binary_cache_file_name( const FileName & file_name )
+{
+    return FileName( file_name.directory(), file_name.file_name(), "csbin" );
+}
+
+// ********************************************************************************
+
+void read_cif_cached( const FileName & file_name, CrystalStructure & crystal_structure )
+{
+    const FileName cache_file_name = binary_cache_file_name( file_name );
+    const FileStatus cif_status( file_name );
+    const FileStatus cache_status( cache_file_name );
+    if ( cif_status.exists() && cache_status.exists() && ( cif_status.modification_time() <= cache_status.modification_time() ) )
+    {
+        try
+        {
+            crystal_structure.read_binary( cache_file_name );
+            return;
+        }
+        catch ( std::exception & )
+        {
+            // Fall through and rebuild the snapshot
+        }
+    }
+    read_cif( file_name, crystal_structure );
+    crystal_structure.save_binary( cache_file_name );
+}
+
+// ********************************************************************************
+
+CifBlockReader::CifBlockReader( const FileName & file_name, const bool build_index ):
+file_name_(file_name),
+input_file_( file_name.full_name().c_str(), std::ios::binary ),
+found_first_block_(false),
+nblocks_read_(0)
+{
+    if ( ! input_file_ )
+        throw std::runtime_error( "CifBlockReader::CifBlockReader(): Could not open file " + file_name_.full_name() );
+    if ( ! build_index )
+        return;
+    // Keep track of the position ourselves, tellg() is slow
+    std::ifstream input_file( file_name_.full_name().c_str(), std::ios::binary );
+    std::string line;
+    std::streamoff position( 0 );
+    while ( std::getline( input_file, line ) )
+    {
+        if ( is_data_line( line ) )
+            offsets_.push_back( position );
+        position += line.length() + 1;
+    }
+    offsets_.push_back( position );
+}
+
+// ********************************************************************************
+
+bool CifBlockReader::read_next_block( CrystalStructure & crystal_structure )
+{
+    std::string line;
+    if ( ! found_first_block_ )
+    {
+        while ( std::getline( input_file_, line ) && ( ! is_data_line( line ) ) )
+            ;
+        if ( ! input_file_ )
+            return false;
+        found_first_block_ = true;
+        pending_line_ = line;
+    }
+    if ( pending_line_.empty() )
+        return false;
+    std::vector< char > buffer( pending_line_.begin(), pending_line_.end() );
+    buffer.push_back( '\n' );
+    pending_line_.clear();
+    while ( std::getline( input_file_, line ) )
+    {
+        if ( is_data_line( line ) )
+        {
+            pending_line_ = line;
+            break;
+        }
+        buffer.insert( buffer.end(), line.begin(), line.end() );
+        buffer.push_back( '\n' );
+    }
+    CifLexer cif_lexer( buffer );
+    crystal_structure = CrystalStructure();
+    parse_cif( cif_lexer, crystal_structure );
+    ++nblocks_read_;
+    return true;
+}
+
+// ********************************************************************************
+
+size_t CifBlockReader::nblocks() const
+{
+    if ( offsets_.empty() )
+        throw std::runtime_error( "CifBlockReader::nblocks(): no index was built." );
+    return offsets_.size() - 1;
+}
+
+// ********************************************************************************
+
+void CifBlockReader::read_block( const size_t i, CrystalStructure & crystal_structure ) const
+{
+    if ( i >= nblocks() )
+        throw std::runtime_error( "CifBlockReader::read_block(): index out of range." );
+    std::ifstream input_file( file_name_.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+        throw std::runtime_error( "CifBlockReader::read_block(): Could not open file " + file_name_.full_name() );
+    input_file.seekg( offsets_[i] );
+    std::vector< char > buffer( static_cast<size_t>( offsets_[i+1] - offsets_[i] ) );
+    // The last line of the file need not end with a newline, so fewer characters may be available
+    input_file.read( &buffer[0], buffer.size() );
+    buffer.resize( static_cast<size_t>( input_file.gcount() ) );
+    CifLexer cif_lexer( buffer );
+    crystal_structure = CrystalStructure();
+    parse_cif( cif_lexer, crystal_structure );
+}
+
+// ********************************************************************************
+
+size_t read_cifs( const FileList & file_list,
+                  const size_t first,
+                  const size_t n,
+                  std::vector< CrystalStructure > & crystal_structures,
+                  std::vector< std::string > & error_messages,
+                  const size_t nthreads,
+                  const bool use_binary_cache )
+{
+    if ( first + n > file_list.size() )
+        throw std::runtime_error( "read_cifs(): range exceeds the number of files." );
+    crystal_structures = std::vector< CrystalStructure >( n );
+    error_messages = std::vector< std::string >( n );
+    parallel_for( n, nthreads, [&]( const size_t i )
+    {
+        try
+        {
+            if ( use_binary_cache )
+                read_cif_cached( file_list.value( first + i ), crystal_structures[i] );
+            else
+                read_cif( file_list.value( first + i ), crystal_structures[i] );
+        }
+        catch ( std::exception & e )
+        {
+            crystal_structures[i] = CrystalStructure();
+            error_messages[i] = std::string( e.what() );
+            if ( error_messages[i].empty() )
+                error_messages[i] = "Unknown error.";
+        }
+    } );
+    MACRO_MEMORY_CHECKPOINT( "read_cifs()" );
+    size_t nerrors( 0 );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        if ( ! error_messages[i].empty() )
+            ++nerrors;
+    }
+    return nerrors;
+}
+
+// ********************************************************************************
+
+size_t read_cifs( const FileList & file_list,
+                  std::vector< CrystalStructure > & crystal_structures,
+                  std::vector< std::string > & error_messages,
+                  const size_t nthreads,
+                  const bool use_binary_cache )
+{
+    return read_cifs( file_list, 0, file_list.size(), crystal_structures, error_messages, nthreads, use_binary_cache );
+}
+
+// ********************************************************************************
+
 // Entirely text based: removes all lines with five fields or more of which the first field starts with H, the second field is "H" and the third fourth and fifth field are floating point numbers
 void remove_hydrogen_atoms( const FileName & input_file_name, const FileName & output_file_name )
 {
@@ -569,3 +937,155 @@ void remove_hydrogen_atoms( const FileName & input_file_name )
 }
 
 // ********************************************************************************
+
+size_t strip_hydrogen_atoms( const char * begin, const char * end, std::string & output )
+{
+    enum LoopType { OTHER_LOOP, ATOM_SITE_LOOP, ATOM_SITE_ANISO_LOOP };
+    output.clear();
+    output.reserve( end - begin );
+    size_t result( 0 );
+    std::vector< CifWord > words;
+    std::vector< CifWord > loop_items;
+    bool is_in_loop_header( false );
+    bool is_in_loop( false );
+    LoopType loop_type( OTHER_LOOP );
+    size_t label_index( 0 );
+    size_t type_symbol_index( 0 );
+    // Per data block
+    std::set< std::string > removed_labels;
+    bool atom_site_loop_found( false );
+    bool is_in_text_field( false );
+    const char * line_begin = begin;
+    while ( line_begin != end )
+    {
+        const char * newline = static_cast< const char * >( std::memchr( line_begin, '\n', end - line_begin ) );
+        if ( newline == 0 )
+            newline = end;
+        const char * line_end = ( newline == end ) ? end : newline + 1;
+        bool keep( true );
+        // Text fields delimited by lines starting with ';' are copied without looking at them
+        if ( *line_begin == ';' )
+            is_in_text_field = ! is_in_text_field;
+        if ( ( *line_begin != '#' ) && ( *line_begin != ';' ) && ( ! is_in_text_field ) )
+            CifLexer::split( line_begin, newline, words );
+        else
+            words.clear();
+        if ( words.empty() )
+        {
+            // Empty lines and comments are copied, they do not end a loop
+        }
+        else if ( words[0].starts_with_ignoring_case( "data_" ) )
+        {
+            is_in_loop_header = false;
+            is_in_loop = false;
+            removed_labels.clear();
+            atom_site_loop_found = false;
+        }
+        else if ( words[0] == "loop_" )
+        {
+            is_in_loop_header = true;
+            is_in_loop = false;
+            loop_items.clear();
+        }
+        else if ( words[0][0] == '_' )
+        {
+            if ( is_in_loop_header )
+                loop_items.push_back( words[0] );
+            else
+                is_in_loop = false;
+        }
+        else if ( is_in_loop_header || is_in_loop )
+        {
+            if ( is_in_loop_header )
+            {
+                // The first row of the loop
+                is_in_loop_header = false;
+                is_in_loop = true;
+                loop_type = OTHER_LOOP;
+                label_index = loop_items.size();
+                type_symbol_index = loop_items.size();
+                for ( size_t i( 0 ); i != loop_items.size(); ++i )
+                {
+                    if ( loop_items[i] == "_atom_site_label" )
+                        label_index = i;
+                    else if ( loop_items[i] == "_atom_site_type_symbol" )
+                        type_symbol_index = i;
+                    else if ( loop_items[i] == "_atom_site_aniso_label" )
+                        label_index = i;
+                }
+                if ( ( label_index != loop_items.size() ) || ( type_symbol_index != loop_items.size() ) )
+                {
+                    if ( loop_items[0].starts_with( "_atom_site_aniso_" ) )
+                        loop_type = ATOM_SITE_ANISO_LOOP;
+                    else
+                    {
+                        loop_type = ATOM_SITE_LOOP;
+                        atom_site_loop_found = true;
+                    }
+                }
+            }
+            // Rows that do not have one value per item, e.g. rows spread over several lines, are copied
+            if ( ( loop_type != OTHER_LOOP ) && ( words.size() == loop_items.size() ) )
+            {
+                if ( loop_type == ATOM_SITE_LOOP )
+                {
+                    keep = ! is_hydrogen_symbol( ( type_symbol_index != loop_items.size() ) ? words[type_symbol_index] : words[label_index] );
+                    if ( ( ! keep ) && ( label_index != loop_items.size() ) )
+                        removed_labels.insert( words[label_index].str() );
+                }
+                else if ( atom_site_loop_found )
+                    keep = ( removed_labels.find( words[label_index].str() ) == removed_labels.end() );
+                else
+                    keep = ! is_hydrogen_symbol( words[label_index] );
+            }
+        }
+        if ( keep )
+            output.append( line_begin, line_end );
+        else if ( loop_type == ATOM_SITE_LOOP )
+            ++result;
+        line_begin = line_end;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+size_t strip_hydrogen_atoms( const FileName & input_file_name, const FileName & output_file_name )
+{
+    std::vector< char > contents;
+    read_whole_file( input_file_name, contents );
+    decompress_if_compressed( contents );
+    std::string output;
+    const size_t result = contents.empty() ? 0 : strip_hydrogen_atoms( &contents[0], &contents[0] + contents.size(), output );
+    write_whole_file( output_file_name, output.data(), output.size() );
+    return result;
+}
+
+// ********************************************************************************
+
+size_t strip_hydrogen_atoms( const FileList & file_list, std::vector< std::string > & error_messages, const size_t nthreads )
+{
+    error_messages = std::vector< std::string >( file_list.size() );
+    parallel_for( file_list.size(), nthreads, [&]( const size_t i )
+    {
+        try
+        {
+            strip_hydrogen_atoms( file_list.value( i ), append_to_file_name( file_list.value( i ), "_noH" ) );
+        }
+        catch ( std::exception & e )
+        {
+            error_messages[i] = std::string( e.what() );
+            if ( error_messages[i].empty() )
+                error_messages[i] = "Unknown error.";
+        }
+    } );
+    size_t nerrors( 0 );
+    for ( size_t i( 0 ); i != error_messages.size(); ++i )
+    {
+        if ( ! error_messages[i].empty() )
+            ++nerrors;
+    }
+    return nerrors;
+}
+
+// ********************************************************************************
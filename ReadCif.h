@@ -28,12 +28,135 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
-class CrystalStructure;
-class FileName;
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "ParallelFor.h"
+
+#include <cstddef> // For definition of size_t
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Can only read extremely simple cifs such as those written out by Mercury, GRACE or the MD in MS.
 void read_cif( const FileName & file_name, CrystalStructure & crystal_structure );
 
+// As above, for the contents of a cif file that has already been read, e.g. by FilePrefetcher. Takes over the contents.
+void read_cif( std::vector< char > & contents, CrystalStructure & crystal_structure );
+
+// The name of the binary snapshot that read_cif_cached() keeps next to a cif file: the same name with the extension "csbin".
+FileName binary_cache_file_name( const FileName & file_name );
+
+// As read_cif(), but keeps a binary snapshot (see CrystalStructure::save_binary()) next to the cif file.
+// If the snapshot is at least as recent as the cif file it is read instead, otherwise the cif file is read
+// and the snapshot is (re)written. A snapshot that cannot be read, e.g. one from an older version, is simply replaced.
+void read_cif_cached( const FileName & file_name, CrystalStructure & crystal_structure );
+
+/*
+  Reads a cif file with many data_ blocks, e.g. CSP output or a CSD export, one block at a time,
+  so that only one block is ever held in memory. Each block is interpreted as by read_cif().
+
+  With build_index, the file is scanned once up front for the start of each block, after which any block
+  can be read with read_block(). read_block() is const and opens its own file handle, so different threads
+  can read different blocks at the same time.
+*/
+class CifBlockReader
+{
+public:
+
+    explicit CifBlockReader( const FileName & file_name, const bool build_index = false );
+
+    // Sequential access. Returns false when there are no more blocks.
+    bool read_next_block( CrystalStructure & crystal_structure );
+
+    // The number of blocks returned by read_next_block() so far.
+    size_t nblocks_read() const { return nblocks_read_; }
+
+    // Random access, only if an index was built. Throws std::runtime_error otherwise.
+    size_t nblocks() const;
+    void read_block( const size_t i, CrystalStructure & crystal_structure ) const;
+
+private:
+    FileName file_name_;
+    std::ifstream input_file_;
+    bool found_first_block_;
+    std::string pending_line_; // The data_ line of the next block
+    size_t nblocks_read_;
+    std::vector< std::streamoff > offsets_; // Start of each block, plus the size of the file
+};
+
+// Calls callback( crystal_structure, i ) for every data block in the file, in order, with only one block in memory at a time.
+template< class Callback >
+void for_each_cif_block( const FileName & file_name, Callback callback )
+{
+    CifBlockReader cif_block_reader( file_name );
+    CrystalStructure crystal_structure;
+    while ( cif_block_reader.read_next_block( crystal_structure ) )
+        callback( crystal_structure, cif_block_reader.nblocks_read() - 1 );
+}
+
+// Reads the files first ... first + n - 1 of file_list on nthreads threads (0 means one per core) into crystal_structures,
+// which is resized to n. A file that cannot be read does not stop the others: its crystal structure is left empty
+// and the reason is stored in error_messages, which is resized to n and is empty for the files that were read successfully.
+// With use_binary_cache the files are read with read_cif_cached(), which builds the cache as a side effect.
+// Returns the number of files that could not be read.
+size_t read_cifs( const FileList & file_list,
+                  const size_t first,
+                  const size_t n,
+                  std::vector< CrystalStructure > & crystal_structures,
+                  std::vector< std::string > & error_messages,
+                  const size_t nthreads = 0,
+                  const bool use_binary_cache = false );
+
+// As above, for all files in file_list.
+size_t read_cifs( const FileList & file_list,
+                  std::vector< CrystalStructure > & crystal_structures,
+                  std::vector< std::string > & error_messages,
+                  const size_t nthreads = 0,
+                  const bool use_binary_cache = false );
+
+// For file lists that are too large to hold in memory. Calls callback( crystal_structure, i, error_message ) on the calling thread
+// for every file in file_list, in the order of the list. error_message is empty if the file was read successfully.
+// The files are read in batches of batch_size (0 means two per thread) on nthreads threads, the next batch is read while
+// callback processes the current one. At most two batches are in memory, so a slow callback throttles the readers.
+// use_binary_cache is as for read_cifs().
+template< class Callback >
+void for_each_cif( const FileList & file_list, Callback callback, const size_t nthreads = 0, size_t batch_size = 0, const bool use_binary_cache = false )
+{
+    const size_t nfiles = file_list.size();
+    if ( batch_size == 0 )
+        batch_size = 2 * ( ( nthreads == 0 ) ? default_nthreads() : nthreads );
+    std::vector< CrystalStructure > current_batch;
+    std::vector< std::string > current_errors;
+    std::vector< CrystalStructure > next_batch;
+    std::vector< std::string > next_errors;
+    read_cifs( file_list, 0, std::min( batch_size, nfiles ), current_batch, current_errors, nthreads, use_binary_cache );
+    for ( size_t start( 0 ); start < nfiles; start += batch_size )
+    {
+        const size_t next_start = start + batch_size;
+        std::thread reader;
+        if ( next_start < nfiles )
+            reader = std::thread( [&]() { read_cifs( file_list, next_start, std::min( batch_size, nfiles - next_start ), next_batch, next_errors, nthreads, use_binary_cache ); } );
+        try
+        {
+            for ( size_t i( 0 ); i != current_batch.size(); ++i )
+                callback( current_batch[i], start + i, current_errors[i] );
+        }
+        catch ( ... )
+        {
+            if ( reader.joinable() )
+                reader.join();
+            throw;
+        }
+        if ( reader.joinable() )
+            reader.join();
+        current_batch.swap( next_batch );
+        current_errors.swap( next_errors );
+        next_batch.clear();
+    }
+}
+
 // Entirely text based: removes all lines with five fields or more of which the first field starts with "H" or "D",
 // the second field is "H" or "D" and the third, fourth and fifth field are floating point numbers.
 void remove_hydrogen_atoms( const FileName & input_file_name, const FileName & output_file_name );
@@ -41,5 +164,23 @@ void remove_hydrogen_atoms( const FileName & input_file_name, const FileName & o
 // As above. The output file_name is the input file name with ".cif" replaced by "_noH.cif"
 void remove_hydrogen_atoms( const FileName & input_file_name );
 
+/*
+  Streaming removal of H and D atoms for heavy-atom-only comparisons of whole databases, without building a CrystalStructure.
+  Only the rows of the _atom_site_ loops are removed, plus the rows of the _atom_site_aniso_ loops with the labels of the removed atoms;
+  every other line, including comments and line endings, is copied byte for byte. Files may contain any number of data_ blocks.
+  Hydrogen atoms are recognised by _atom_site_type_symbol, or by _atom_site_label if there is no type symbol, with the same rule
+  as read_cif(). As in read_cif(), each row of a loop must be on one line; rows that are not are copied.
+  The number of atoms that were removed is returned.
+*/
+size_t strip_hydrogen_atoms( const char * begin, const char * end, std::string & output );
+
+// The file is read and written in one go, compressed input is decompressed.
+size_t strip_hydrogen_atoms( const FileName & input_file_name, const FileName & output_file_name );
+
+// All files of file_list on nthreads threads (0 means one per core), each written to the input file name with "_noH" appended.
+// A file that cannot be processed does not stop the others, the reason is stored in error_messages, which is resized to the
+// number of files and is empty for the files that were processed successfully. Returns the number of files that failed.
+size_t strip_hydrogen_atoms( const FileList & file_list, std::vector< std::string > & error_messages, const size_t nthreads = 0 );
+
 #endif // READCIF_H
 
@@ -28,12 +28,31 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ReadXSD.h"
 #include "3DCalculations.h"
 #include "CrystalStructure.h"
-#include "TextFileReader.h"
 #include "Utilities.h"
+#include "XMLPullParser.h"
 
-#include <iostream>
+#include <algorithm>
 #include <stdexcept>
 
+namespace
+{
+
+// Parses "x,y,z"
+Vector3D parse_vector( const XMLString & value, const std::string & error_message )
+{
+    const char * first_comma = std::find( value.begin(), value.end(), ',' );
+    if ( first_comma == value.end() )
+        throw std::runtime_error( error_message );
+    const char * second_comma = std::find( first_comma + 1, value.end(), ',' );
+    if ( ( second_comma == value.end() ) || ( std::find( second_comma + 1, value.end(), ',' ) != value.end() ) )
+        throw std::runtime_error( error_message );
+    return Vector3D( string2double( value.begin(), first_comma ),
+                     string2double( first_comma + 1, second_comma ),
+                     string2double( second_comma + 1, value.end() ) );
+}
+
+} // namespace
+
 // ********************************************************************************
 
 void read_xsd( const FileName & file_name, CrystalStructure & crystal_structure )
@@ -44,140 +63,45 @@ void read_xsd( const FileName & file_name, CrystalStructure & crystal_structure
 //                            <Properties NMRShielding="563.67" EFGQuadrupolarCoupling="-72.78" EFGAsymmetry="0.22" Force="-0.214441360892478,1.32464677237851,1.59841007334931"/>
 //                        </Atom3d>
 //
-// If the user only assigned the NMR shieldings and not the EFG etc., the lines look like this:
-//                        <Atom3d ID="4" HasProperties="1" Mapping="135" Parent="2" Children="137,393,394,395" Name="C1" UserID="1" XYZ="0.004362191714,0.464087446874054,0.655927752421914" Connections="69,70,100" TemperatureType="Isotropic" AnisotropicTemperature="0,0,0,0,0,0,0,0,0" Components="C">
-//                            <Properties NMRShielding="8.93"/>
-//                        </Atom3d>
-//
-// Beware of lines of this type:
+// Beware of lines of this type, which are images of atoms in neighbouring unit cells:
 //                        <Atom3d ID="566" Mapping="952" ImageOf="4"/>
 //
+//  <SpaceGroup ID="352" Parent="2" Children="356" Name="P1" DisplayStyle="Solid" Color="255,255,255,255"
+// AVector="14.4767680982048,0,-8.07646527115057" BVector="0,5.24594832057182,0" CVector="0,0,16.3107460377921" OrientationBase="C along Z, B in YZ plane"
+// Centering="3D Primitive-Centered" Lattice="3D Triclinic" GroupName="P1" Operators="1,0,0,0,0,1,0,0,0,0,1,0" DisplayRange="0,1,0,1,0,1" LineThickness="2"
+// CylinderRadius="0.2" LabelAxes="1" ActiveSystem="2" ITNumber="1" LongName="P 1" Qualifier="Origin-1" SchoenfliesName="C1-1" System="Triclinic" Class="1"/>
 
-    TextFileReader text_file_reader( file_name );
-    text_file_reader.set_skip_empty_lines( true );
-    Splitter splitter_comma( "," );
-    std::vector< std::string > words;
+    XMLPullParser parser( file_name );
     std::vector< Atom > atoms;
     bool unit_cell_found( false );
-    while ( text_file_reader.get_next_line( words ) )
+    XMLString value;
+    while ( parser.next() != XMLPullParser::END_OF_DOCUMENT )
     {
-        if ( words[0] == "<Atom3d" )
+        if ( parser.event() != XMLPullParser::START_ELEMENT )
+            continue;
+        if ( parser.name() == "Atom3d" )
         {
-            if ( ( words.size() == 4 ) && ( words[3].substr( words[3].length() - 2 ) == "/>" ) )
+            if ( parser.attribute( "ImageOf", value ) )
                 continue;
-            std::string total_line = text_file_reader.get_line();
-            std::string line;
-            size_t line_counter( 1 );
-            while ( text_file_reader.get_next_line( line ) )
-            {
-                ++line_counter;
-                line = strip( line );
-                if ( line == "</Atom3d>" )
-                    break;
-                else
-                    total_line += " " + line;
-            }
-            if ( line_counter != 3 )
-                std::cout << "WARNING: number of lines for one atom not equal three." << std::endl;
-            words = split( total_line );
-
-//		<Atom3d ID="42" HasProperties="1" Mapping="355" Parent="2" Name="H23" XYZ="-0.129725828307252,0.460163887977488,0.106616484219332" Connections="84" ForcefieldType="h1" Charge="0.053" TemperatureType="Isotropic" AnisotropicTemperature="0,0,0,0,0,0,0,0,0" Components="H" Visible="0">
-//			<Properties Force="0.0051914800946029,-0.00371354061100781,-0.0309962205299153"/>
-//		</Atom3d>
-
-            // Find "Name="
-            bool name_found( false );
-            std::string label;
-            for ( size_t i( 0 ); i != words.size(); ++i )
-            {
-                if ( words[i].substr( 0, 5 ) == "Name=" )
-                {
-                    label = words[i].substr( 6, words[i].length() - 7 );
-                    name_found = true;
-                    break;
-                }
-            }
-            if ( ! name_found )
+            XMLString label;
+            if ( ! parser.attribute( "Name", label ) )
                 throw std::runtime_error( "read_xsd(): name not found." );
-            // Find "XYZ="
-            bool xyz_found( false );
-            Vector3D position;
-            for ( size_t i( 0 ); i != words.size(); ++i )
-            {
-                if ( words[i].substr( 0, 4 ) == "XYZ=" )
-                {
-                    std::string xyz_string = extract_delimited_text( words[i], "\"", "\"" );
-                    std::vector< std::string > words_2 = splitter_comma.split( xyz_string );
-                    if ( words_2.size() != 3 )
-                        throw std::runtime_error( "read_xsd(): xyz coordinates not found 2." );
-                    position = Vector3D( string2double( words_2[0] ), string2double( words_2[1] ), string2double( words_2[2] ) );
-                    xyz_found = true;
-                    break;
-                }
-            }
-            if ( ! xyz_found )
+            if ( ! parser.attribute( "XYZ", value ) )
                 throw std::runtime_error( "read_xsd(): xyz coordinates not found 1." );
-            atoms.push_back( Atom( element_from_atom_label( label ), position, label ) );
+            Vector3D position = parse_vector( value, "read_xsd(): xyz coordinates not found 2." );
+            atoms.push_back( Atom( element_from_atom_label( label.begin(), label.end() ), position, label.str() ) );
         }
-        else if ( words[0] == "<SpaceGroup" )
+        else if ( parser.name() == "SpaceGroup" )
         {
-            
-//  <SpaceGroup ID="352" Parent="2" Children="356" Name="P1" DisplayStyle="Solid" Color="255,255,255,255"
-// AVector="14.4767680982048,0,-8.07646527115057" BVector="0,5.24594832057182,0" CVector="0,0,16.3107460377921" OrientationBase="C along Z, B in YZ plane"
-// Centering="3D Primitive-Centered" Lattice="3D Triclinic" GroupName="P1" Operators="1,0,0,0,0,1,0,0,0,0,1,0" DisplayRange="0,1,0,1,0,1" LineThickness="2"
-// CylinderRadius="0.2" LabelAxes="1" ActiveSystem="2" ITNumber="1" LongName="P 1" Qualifier="Origin-1" SchoenfliesName="C1-1" System="Triclinic" Class="1"/>
-
-            bool avector_found( false );
-            Vector3D a_vector;
-            for ( size_t i( 0 ); i != words.size(); ++i )
-            {
-                if ( words[i].substr( 0, 8 ) == "AVector=" )
-                {
-                    std::string xyz_string = extract_delimited_text( words[i], "\"", "\"" );
-                    std::vector< std::string > words_2 = splitter_comma.split( xyz_string );
-                    if ( words_2.size() != 3 )
-                        throw std::runtime_error( "read_xsd(): AVector not found 2." );
-                    a_vector = Vector3D( string2double( words_2[0] ), string2double( words_2[1] ), string2double( words_2[2] ) );
-                    avector_found = true;
-                    break;
-                }
-            }
-            if ( ! avector_found )
+            if ( ! parser.attribute( "AVector", value ) )
                 throw std::runtime_error( "read_xsd(): AVector not found 1." );
-            bool bvector_found( false );
-            Vector3D b_vector;
-            for ( size_t i( 0 ); i != words.size(); ++i )
-            {
-                if ( words[i].substr( 0, 8 ) == "BVector=" )
-                {
-                    std::string xyz_string = extract_delimited_text( words[i], "\"", "\"" );
-                    std::vector< std::string > words_2 = splitter_comma.split( xyz_string );
-                    if ( words_2.size() != 3 )
-                        throw std::runtime_error( "read_xsd(): BVector not found 2." );
-                    b_vector = Vector3D( string2double( words_2[0] ), string2double( words_2[1] ), string2double( words_2[2] ) );
-                    bvector_found = true;
-                    break;
-                }
-            }
-            if ( ! bvector_found )
+            Vector3D a_vector = parse_vector( value, "read_xsd(): AVector not found 2." );
+            if ( ! parser.attribute( "BVector", value ) )
                 throw std::runtime_error( "read_xsd(): BVector not found 1." );
-            bool cvector_found( false );
-            Vector3D c_vector;
-            for ( size_t i( 0 ); i != words.size(); ++i )
-            {
-                if ( words[i].substr( 0, 8 ) == "CVector=" )
-                {
-                    std::string xyz_string = extract_delimited_text( words[i], "\"", "\"" );
-                    std::vector< std::string > words_2 = splitter_comma.split( xyz_string );
-                    if ( words_2.size() != 3 )
-                        throw std::runtime_error( "read_xsd(): CVector not found 2." );
-                    c_vector = Vector3D( string2double( words_2[0] ), string2double( words_2[1] ), string2double( words_2[2] ) );
-                    cvector_found = true;
-                    break;
-                }
-            }
-            if ( ! cvector_found )
+            Vector3D b_vector = parse_vector( value, "read_xsd(): BVector not found 2." );
+            if ( ! parser.attribute( "CVector", value ) )
                 throw std::runtime_error( "read_xsd(): CVector not found 1." );
+            Vector3D c_vector = parse_vector( value, "read_xsd(): CVector not found 2." );
             crystal_structure.set_crystal_lattice( CrystalLattice( a_vector.length(), b_vector.length(), c_vector.length(), angle( b_vector, c_vector ), angle( a_vector, c_vector ), angle( a_vector, b_vector ) ) );
             unit_cell_found = true;
         }
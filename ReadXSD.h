@@ -31,7 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 class CrystalStructure;
 class FileName;
 
-// Can only read extremely simple .xsd files.
+// Reads the unit cell and the atoms (label and position) from a Materials Studio .xsd file.
 void read_xsd( const FileName & file_name, CrystalStructure & crystal_structure );
 
 #endif // READXSD_H
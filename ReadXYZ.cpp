@@ -28,16 +28,35 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ReadXYZ.h"
 #include "Atom.h"
 #include "Element.h"
+#include "MathFunctions.h"
 #include "TextFileReader.h"
 #include "Utilities.h"
 #include "Vector3D.h"
 
-//#include <fstream>
 #include <stdexcept>
 #include <iostream>
 
 //#include <iostream> // For debugging
 
+namespace
+{
+
+// Finds the next word in [begin, end) and moves begin past it. Returns false if there are no more words.
+bool next_word( const char * & begin, const char * end, const char * & word_begin, const char * & word_end )
+{
+    while ( ( begin != end ) && ( ( *begin == ' ' ) || ( *begin == '\t' ) || ( *begin == '\r' ) ) )
+        ++begin;
+    if ( begin == end )
+        return false;
+    word_begin = begin;
+    while ( ( begin != end ) && ( *begin != ' ' ) && ( *begin != '\t' ) && ( *begin != '\r' ) )
+        ++begin;
+    word_end = begin;
+    return true;
+}
+
+} // namespace
+
 /*
 160
 WUBDOM
@@ -83,14 +102,203 @@ void read_xyz( const FileName & file_name, std::vector< Atom > & atoms )
         {
             if ( words.size() != 4 )
                 throw std::runtime_error( "read_xyz(): atom line does not contain four items." );
-            Atom atom( Element( words[ 0 ]), Vector3D( string2double( words[ 1 ] ),
-                                                       string2double( words[ 2 ] ),
-                                                       string2double( words[ 3 ] ) ),
-                                                       words[ 0 ]+size_t2string(atom_number) );
-            atoms.push_back( atom );
+            atoms.push_back( xyz_words_to_atom( words, atom_number ) );
         }
         ++atom_number;
     }
     if ( atom_number != ( number_of_atoms + 1 ) )
         std::cout << "read_xyz(): WARNING: actual number of atoms (" + size_t2string( atom_number-1 ) + ") not equal to number specified (" + size_t2string( number_of_atoms ) + ")." << std::endl;
 }
+
+// ********************************************************************************
+
+Atom xyz_words_to_atom( const std::vector< std::string > & words, const size_t atom_number )
+{
+    if ( words.size() < 4 )
+        throw std::runtime_error( "xyz_words_to_atom(): atom line does not contain four items." );
+    return Atom( Element( words[ 0 ] ), Vector3D( string2double( words[ 1 ] ),
+                                                  string2double( words[ 2 ] ),
+                                                  string2double( words[ 3 ] ) ),
+                                                  words[ 0 ] + size_t2string( atom_number ) );
+}
+
+// ********************************************************************************
+
+void xyz_line_to_atom( const std::string & line, const size_t atom_number, Atom & atom )
+{
+    const char * iPos = line.c_str();
+    const char * end = iPos + line.size();
+    const char * word_begin[4];
+    const char * word_end[4];
+    for ( size_t i( 0 ); i != 4; ++i )
+    {
+        if ( ! next_word( iPos, end, word_begin[i], word_end[i] ) )
+            throw std::runtime_error( "xyz_line_to_atom(): atom line does not contain four items." );
+    }
+    atom.set_element( Element( word_begin[0], word_end[0] ) );
+    atom.set_position( Vector3D( string2double( word_begin[1], word_end[1] ),
+                                 string2double( word_begin[2], word_end[2] ),
+                                 string2double( word_begin[3], word_end[3] ) ) );
+    // Short enough for the small-string optimisation, so no memory is allocated
+    std::string label( word_begin[0], word_end[0] );
+    append_size_t( label, atom_number );
+    atom.set_label( label );
+}
+
+// ********************************************************************************
+// ********************************************************************************
+// ********************************************************************************
+
+XYZFrameReader::XYZFrameReader( const FileName & file_name ):
+file_name_(file_name),
+index_end_(0),
+index_complete_(false),
+next_frame_(0),
+positioned_(true)
+{
+    input_file_.open( file_name_.full_name().c_str(), std::ios::binary );
+    if ( ! input_file_ )
+        throw std::runtime_error( "XYZFrameReader::XYZFrameReader(): Could not open file " + file_name_.full_name() );
+}
+
+// ********************************************************************************
+
+bool XYZFrameReader::read_next_frame( std::vector< Atom > & atoms )
+{
+    if ( ! positioned_ )
+    {
+        extend_index( next_frame_ + 1 );
+        if ( next_frame_ == offsets_.size() )
+            return false;
+        seek( offsets_[ next_frame_ ] );
+        positioned_ = true;
+    }
+    size_t natoms;
+    std::streampos offset;
+    if ( ! read_number_of_atoms( natoms, offset ) )
+    {
+        index_complete_ = true;
+        return false;
+    }
+    if ( ! std::getline( input_file_, comment_ ) )
+        throw std::runtime_error( "XYZFrameReader::read_next_frame(): last frame is incomplete in " + file_name_.full_name() );
+    if ( ( ! comment_.empty() ) && ( comment_[ comment_.size() - 1 ] == '\r' ) )
+        comment_.erase( comment_.size() - 1 );
+    atoms.resize( natoms );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        if ( ! std::getline( input_file_, line_ ) )
+            throw std::runtime_error( "XYZFrameReader::read_next_frame(): last frame is incomplete in " + file_name_.full_name() );
+        xyz_line_to_atom( line_, i + 1, atoms[i] );
+    }
+    if ( next_frame_ == offsets_.size() )
+    {
+        offsets_.push_back( offset );
+        if ( input_file_.eof() )
+            index_complete_ = true;
+        else
+            index_end_ = input_file_.tellg();
+    }
+    ++next_frame_;
+    return true;
+}
+
+// ********************************************************************************
+
+void XYZFrameReader::read_frame( const size_t i, std::vector< Atom > & atoms )
+{
+    extend_index( i + 1 );
+    if ( i >= offsets_.size() )
+        throw std::runtime_error( "XYZFrameReader::read_frame(): frame " + size_t2string( i + 1 ) + " does not exist in " + file_name_.full_name() );
+    seek( offsets_[i] );
+    positioned_ = true;
+    next_frame_ = i;
+    read_next_frame( atoms );
+}
+
+// ********************************************************************************
+
+size_t XYZFrameReader::nframes()
+{
+    return frame_offsets().size();
+}
+
+// ********************************************************************************
+
+const std::vector< std::streampos > & XYZFrameReader::frame_offsets()
+{
+    while ( ! index_complete_ )
+        extend_index( offsets_.size() + 1 );
+    return offsets_;
+}
+
+// ********************************************************************************
+
+bool XYZFrameReader::read_number_of_atoms( size_t & natoms, std::streampos & offset )
+{
+    while ( true )
+    {
+        offset = input_file_.tellg();
+        if ( ! std::getline( input_file_, line_ ) )
+            return false;
+        const char * iPos = line_.c_str();
+        const char * end = iPos + line_.size();
+        const char * word_begin;
+        const char * word_end;
+        if ( ! next_word( iPos, end, word_begin, word_end ) )
+            continue;
+        const char * extra_begin;
+        const char * extra_end;
+        if ( next_word( iPos, end, extra_begin, extra_end ) )
+            throw std::runtime_error( "XYZFrameReader::read_number_of_atoms(): expected the number of atoms in " + file_name_.full_name() );
+        const int number_of_atoms = round_to_int( string2double_2( word_begin, word_end, false ) );
+        if ( number_of_atoms < 0 )
+            throw std::runtime_error( "XYZFrameReader::read_number_of_atoms(): negative number of atoms in " + file_name_.full_name() );
+        natoms = number_of_atoms;
+        return true;
+    }
+}
+
+// ********************************************************************************
+
+void XYZFrameReader::extend_index( const size_t n )
+{
+    if ( index_complete_ || ( offsets_.size() >= n ) )
+        return;
+    positioned_ = false;
+    seek( index_end_ );
+    size_t natoms;
+    std::streampos offset;
+    while ( offsets_.size() < n )
+    {
+        if ( ! read_number_of_atoms( natoms, offset ) )
+        {
+            index_complete_ = true;
+            return;
+        }
+        // Comment line + one line per atom
+        for ( size_t i( 0 ); i != natoms + 1; ++i )
+        {
+            if ( ! std::getline( input_file_, line_ ) )
+                throw std::runtime_error( "XYZFrameReader::extend_index(): last frame is incomplete in " + file_name_.full_name() );
+        }
+        offsets_.push_back( offset );
+        if ( input_file_.eof() )
+        {
+            index_complete_ = true;
+            return;
+        }
+        index_end_ = input_file_.tellg();
+    }
+}
+
+// ********************************************************************************
+
+void XYZFrameReader::seek( const std::streampos position )
+{
+    input_file_.clear();
+    input_file_.seekg( position );
+}
+
+// ********************************************************************************
+
@@ -29,12 +29,75 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 class Atom;
-class FileName;
 
+#include "FileName.h"
+
+#include <cstddef> // For definition of size_t
+#include <fstream>
 #include <string>
 #include <vector>
 
 // The coordinates of the atoms are Cartesian...
 void read_xyz( const FileName & file_name, std::vector< Atom > & atoms );
 
+// Converts the words of one atom line "El x y z" into an atom labelled El + atom_number.
+// Words after the first four are ignored.
+Atom xyz_words_to_atom( const std::vector< std::string > & words, const size_t atom_number );
+
+// As above, for an atom line that has not been split into words. Overwrites element, position and label of atom.
+void xyz_line_to_atom( const std::string & line, const size_t atom_number, Atom & atom );
+
+/*
+  Streams the frames of a multi-frame .xyz file (number of atoms, comment, one line "El x y z" per atom,
+  repeated for every frame) one at a time. Coordinates are Cartesian, extra columns after x y z are ignored.
+
+  The caller passes the same std::vector< Atom > for every frame; it is only resized when the number of atoms changes,
+  and only the element, position and label of each atom are overwritten, so memory use is fixed by the largest frame.
+  The start of every frame that has been passed is remembered, so read_frame() can jump to any frame;
+  frames beyond the ones seen so far are indexed on demand by skipping lines without parsing them.
+*/
+class XYZFrameReader
+{
+public:
+
+    explicit XYZFrameReader( const FileName & file_name );
+
+    // Returns false if there are no more frames, atoms is then left untouched.
+    bool read_next_frame( std::vector< Atom > & atoms );
+
+    // Zero-based. read_next_frame() continues with frame i + 1.
+    void read_frame( const size_t i, std::vector< Atom > & atoms );
+
+    // Indexes the rest of the file if that has not been done yet.
+    size_t nframes();
+
+    // Start of every frame in the file. Indexes the rest of the file if that has not been done yet.
+    const std::vector< std::streampos > & frame_offsets();
+
+    // Zero-based index of the frame that read_next_frame() will read.
+    size_t next_frame() const { return next_frame_; }
+
+    // The comment line of the frame that was read last.
+    const std::string & comment() const { return comment_; }
+
+private:
+    FileName file_name_;
+    std::ifstream input_file_;
+    std::string line_;
+    std::string comment_;
+    std::vector< std::streampos > offsets_;
+    std::streampos index_end_; // End of the last frame in offsets_
+    bool index_complete_;
+    size_t next_frame_;
+    bool positioned_; // Whether input_file_ is at the start of frame next_frame_
+
+    // Skips empty lines. Returns false at the end of the file.
+    bool read_number_of_atoms( size_t & natoms, std::streampos & offset );
+
+    // Makes sure that the first n frames are in offsets_, or that the whole file has been indexed.
+    void extend_index( const size_t n );
+
+    void seek( const std::streampos position );
+};
+
 #endif // READXYZ_H
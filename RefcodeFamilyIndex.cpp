@@ -0,0 +1,175 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "RefcodeFamilyIndex.h"
+#include "FileList.h"
+
+#include <cctype>
+#include <stdexcept>
+
+// ********************************************************************************
+
+RefcodeFamilyIndex::RefcodeFamilyIndex():
+offsets_( 1, 0 )
+{
+}
+
+// ********************************************************************************
+
+RefcodeFamilyIndex::RefcodeFamilyIndex( const std::vector< std::string > & refcodes )
+{
+    initialise( refcodes );
+}
+
+// ********************************************************************************
+
+RefcodeFamilyIndex::RefcodeFamilyIndex( const FileList & file_list )
+{
+    std::vector< std::string > refcodes;
+    refcodes.reserve( file_list.size() );
+    for ( size_t i( 0 ); i != file_list.size(); ++i )
+        refcodes.push_back( file_list.value( i ).file_name() );
+    initialise( refcodes );
+}
+
+// ********************************************************************************
+
+std::string RefcodeFamilyIndex::family( const size_t i ) const
+{
+    if ( i >= nfamilies() )
+        throw std::runtime_error( "RefcodeFamilyIndex::family(): index out of range." );
+    std::string result( 6, 'A' );
+    std::uint32_t key = keys_[i];
+    for ( size_t j( 0 ); j != 6; ++j )
+    {
+        result[5-j] = static_cast< char >( 'A' + key % 26 );
+        key /= 26;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< size_t > RefcodeFamilyIndex::members( const size_t i ) const
+{
+    if ( i >= nfamilies() )
+        throw std::runtime_error( "RefcodeFamilyIndex::members(): index out of range." );
+    return std::vector< size_t >( members_.begin() + offsets_[i], members_.begin() + offsets_[i+1] );
+}
+
+// ********************************************************************************
+
+size_t RefcodeFamilyIndex::find( const std::string & refcode ) const
+{
+    std::uint32_t key;
+    if ( ! family_key( refcode, key ) )
+        return nfamilies();
+    std::unordered_map< std::uint32_t, size_t >::const_iterator it = family_numbers_.find( key );
+    return ( it == family_numbers_.end() ) ? nfamilies() : it->second;
+}
+
+// ********************************************************************************
+
+std::vector< std::pair< size_t, size_t > > RefcodeFamilyIndex::within_family_pairs() const
+{
+    size_t npairs( 0 );
+    for ( size_t i( 0 ); i != nfamilies(); ++i )
+        npairs += ( family_size( i ) * ( family_size( i ) - 1 ) ) / 2;
+    std::vector< std::pair< size_t, size_t > > result;
+    result.reserve( npairs );
+    for ( size_t i( 0 ); i != nfamilies(); ++i )
+    {
+        for ( size_t j( offsets_[i] ); j != offsets_[i+1]; ++j )
+        {
+            for ( size_t k( j + 1 ); k != offsets_[i+1]; ++k )
+                result.push_back( std::make_pair( members_[j], members_[k] ) );
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+void RefcodeFamilyIndex::initialise( const std::vector< std::string > & refcodes )
+{
+    const size_t nentries = refcodes.size();
+    keys_.clear();
+    family_numbers_.clear();
+    entry_families_.assign( nentries, 0 );
+    // One pass to number the families and count their members, then the members are placed with a prefix sum.
+    std::vector< size_t > counts;
+    for ( size_t i( 0 ); i != nentries; ++i )
+    {
+        std::uint32_t key;
+        if ( ! family_key( refcodes[i], key ) )
+        {
+            entry_families_[i] = static_cast< size_t >( -1 );
+            continue;
+        }
+        std::pair< std::unordered_map< std::uint32_t, size_t >::iterator, bool > inserted = family_numbers_.insert( std::make_pair( key, keys_.size() ) );
+        if ( inserted.second )
+        {
+            keys_.push_back( key );
+            counts.push_back( 0 );
+        }
+        entry_families_[i] = inserted.first->second;
+        ++counts[ inserted.first->second ];
+    }
+    offsets_.assign( nfamilies() + 1, 0 );
+    for ( size_t i( 0 ); i != nfamilies(); ++i )
+        offsets_[i+1] = offsets_[i] + counts[i];
+    members_.resize( offsets_.back() );
+    std::vector< size_t > next( offsets_.begin(), offsets_.end() - 1 );
+    for ( size_t i( 0 ); i != nentries; ++i )
+    {
+        if ( entry_families_[i] == static_cast< size_t >( -1 ) )
+            entry_families_[i] = nfamilies();
+        else
+            members_[ next[ entry_families_[i] ]++ ] = i;
+    }
+}
+
+// ********************************************************************************
+
+bool RefcodeFamilyIndex::family_key( const std::string & refcode, std::uint32_t & key )
+{
+    if ( refcode.length() < 6 )
+        return false;
+    key = 0;
+    for ( size_t i( 0 ); i != 6; ++i )
+    {
+        const char c = refcode[i];
+        if ( ! std::isalpha( static_cast< unsigned char >( c ) ) )
+            return false;
+        key = 26 * key + static_cast< std::uint32_t >( std::toupper( static_cast< unsigned char >( c ) ) - 'A' );
+    }
+    return true;
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,96 @@
+#ifndef REFCODEFAMILYINDEX_H
+#define REFCODEFAMILYINDEX_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class FileList;
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+  Groups CSD entries into refcode families (e.g. a polymorph series ABCDEF, ABCDEF01, ABCDEF02) in one pass.
+
+  The family of an entry is the first six characters of its name, which must be letters (capitalisation is ignored),
+  so file names such as ABCDEF01_optimised are grouped as well. Entries whose name does not start with six letters
+  do not belong to any family. The six letters are stored as one 32-bit number (26^6 < 2^32), the members of all families
+  are stored contiguously.
+
+  Families are numbered in the order of their first entry, the members of each family are in ascending order.
+*/
+class RefcodeFamilyIndex
+{
+public:
+
+    RefcodeFamilyIndex();
+
+    explicit RefcodeFamilyIndex( const std::vector< std::string > & refcodes );
+
+    // Uses the file names without extension
+    explicit RefcodeFamilyIndex( const FileList & file_list );
+
+    size_t nentries() const { return entry_families_.size(); }
+    size_t nfamilies() const { return keys_.size(); }
+
+    // The six capitalised letters of family i
+    std::string family( const size_t i ) const;
+
+    size_t family_size( const size_t i ) const { return offsets_[i+1] - offsets_[i]; }
+
+    // The entries of family i
+    std::vector< size_t > members( const size_t i ) const;
+
+    // nfamilies() if entry i does not belong to a family
+    size_t family_of_entry( const size_t i ) const { return entry_families_[i]; }
+
+    // The family of a refcode or a six-letter family name, nfamilies() if it is not in the index
+    size_t find( const std::string & refcode ) const;
+
+    // All pairs of entries within the same family, as ( i, j ) with i < j, family by family.
+    // Meant as the list of jobs for parallel_for() for family-wise comparisons.
+    std::vector< std::pair< size_t, size_t > > within_family_pairs() const;
+
+private:
+    std::vector< std::uint32_t > keys_;      // For each family, the six letters as a base-26 number
+    std::vector< size_t > offsets_;          // nfamilies() + 1, the members of family i are members_[ offsets_[i] ] ... members_[ offsets_[i+1] - 1 ]
+    std::vector< size_t > members_;
+    std::vector< size_t > entry_families_;
+    std::unordered_map< std::uint32_t, size_t > family_numbers_;
+
+    void initialise( const std::vector< std::string > & refcodes );
+
+    // Returns false if the first six characters are not all letters
+    static bool family_key( const std::string & refcode, std::uint32_t & key );
+};
+
+#endif // REFCODEFAMILYINDEX_H
@@ -26,6 +26,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "ReflectionList.h"
+#include "3DCalculations.h"
+#include "PointGroup.h"
 #include "Sort.h"
 #include "TextFileReader.h"
 #include "TextFileWriter.h"
@@ -36,10 +38,27 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <fstream>
 #include <stdexcept>
 
+namespace
+{
+
+// Lexicographic on h, then k, then l. Note that operator<( MillerIndices, MillerIndices ) sorts in the opposite direction.
+bool is_lexicographically_smaller( const MillerIndices & lhs, const MillerIndices & rhs )
+{
+    if ( lhs.h() != rhs.h() )
+        return lhs.h() < rhs.h();
+    if ( lhs.k() != rhs.k() )
+        return lhs.k() < rhs.k();
+    return lhs.l() < rhs.l();
+}
+
+} // namespace
+
 // ********************************************************************************
 
-ReflectionList::ReflectionList()
+ReflectionList::ReflectionList():
+equivalent_directions_offsets_( 1, 0 )
 {
+    sorted_map_.set_valid();
 }
 
 // ********************************************************************************
@@ -50,8 +69,22 @@ void ReflectionList::push_back( const MillerIndices & miller_indices, const doub
     F_squared_.push_back( F_squared );
     d_spacings_.push_back( d_spacing );
     multiplicity_.push_back( multiplicity );
-    sorted_map_.push_back( size() - 1 );
-    sort_by_d_spacing();
+    equivalent_directions_offsets_.push_back( equivalent_directions_.size() );
+    index_map_.invalidate();
+    // The list stays sorted if the reflections are added in order of decreasing d-spacing
+    if ( sorted_map_.is_valid() && ( sorted_map_.value().empty() || ! ( d_spacings_[ sorted_map_.value().back() ] < d_spacing ) ) )
+        sorted_map_.value().push_back( size() - 1 );
+    else
+        sorted_map_.invalidate();
+}
+
+// ********************************************************************************
+
+void ReflectionList::push_back( const MillerIndices & miller_indices, const double F_squared, const double d_spacing, const size_t multiplicity,
+                                const std::vector< Vector3D > & equivalent_directions )
+{
+    equivalent_directions_.insert( equivalent_directions_.end(), equivalent_directions.begin(), equivalent_directions.end() );
+    push_back( miller_indices, F_squared, d_spacing, multiplicity );
 }
 
 // ********************************************************************************
@@ -62,26 +95,61 @@ void ReflectionList::reserve( const size_t nvalues )
     F_squared_.reserve( nvalues );
     d_spacings_.reserve( nvalues );
     multiplicity_.reserve( nvalues );
+    equivalent_directions_offsets_.reserve( nvalues + 1 );
+    sorted_map_.value().reserve( nvalues );
 }
 
 // ********************************************************************************
 
-size_t ReflectionList::index( const MillerIndices & miller_indices )
+void ReflectionList::finalise( const bool build_index ) const
 {
-    for ( size_t i( 0 ); i != size(); ++i )
+    sorted_map();
+    if ( build_index )
+        index_map_.get( [this]( std::unordered_map< std::uint64_t, size_t > & result ) { build_index_map( result ); } );
+}
+
+// ********************************************************************************
+
+size_t ReflectionList::index( const MillerIndices & miller_indices ) const
+{
+    const std::unordered_map< std::uint64_t, size_t > & index_map = index_map_.get( [this]( std::unordered_map< std::uint64_t, size_t > & result ) { build_index_map( result ); } );
+    std::unordered_map< std::uint64_t, size_t >::const_iterator it = index_map.find( packed_miller_indices( miller_indices ) );
+    return ( it == index_map.end() ) ? size() : it->second;
+}
+
+// ********************************************************************************
+
+size_t ReflectionList::index( const MillerIndices & miller_indices, const PointGroup & laue_class ) const
+{
+    size_t result = size();
+    for ( size_t i( 0 ); i != laue_class.nsymmetry_operators(); ++i )
     {
-        if ( this->miller_indices( i ) == miller_indices )
-            return i;
+        const MillerIndices equivalent_reflection = miller_indices * laue_class.symmetry_operator( i );
+        result = std::min( result, index( equivalent_reflection ) );
+        result = std::min( result, index( MillerIndices( -equivalent_reflection.h(), -equivalent_reflection.k(), -equivalent_reflection.l() ) ) );
     }
-    return size();
+    // The identity may not be the first operator, and an empty point group should still find the reflection itself
+    return std::min( result, index( miller_indices ) );
 }
 
 // ********************************************************************************
 
-void ReflectionList::sort_by_d_spacing()
+void ReflectionList::sort_by_d_spacing( std::vector< size_t > & sorted_map ) const
 {
     // We don't actually sort the lists, but create a sorted map
-    sorted_map_ = sort( d_spacings_, true );
+    sorted_map = sort( d_spacings_, true );
+}
+
+// ********************************************************************************
+
+void ReflectionList::build_index_map( std::unordered_map< std::uint64_t, size_t > & index_map ) const
+{
+    const std::vector< size_t > & sorted_map = this->sorted_map();
+    index_map.clear();
+    index_map.reserve( size() );
+    // In sorted order, so that emplace() keeps the first of duplicate (hkl)
+    for ( size_t i( 0 ); i != size(); ++i )
+        index_map.emplace( packed_miller_indices( miller_indices_[ sorted_map[i] ] ), i );
 }
 
 // ********************************************************************************
@@ -103,6 +171,7 @@ void ReflectionList::read_hkl( const FileName & file_name )
             throw std::runtime_error( "ReflectionList::read_hkl(): cannot interpret line \"" + text_file_reader.get_line() + "\"" );
         push_back( MillerIndices( string2integer( words[0] ), string2integer( words[1] ), string2integer( words[2] ) ), string2double( words[3] ), 0.0, 0 );
     }
+    finalise();
 }
 
 // ********************************************************************************
@@ -134,3 +203,23 @@ void ReflectionList::save( const FileName & file_name ) const
 
 // ********************************************************************************
 
+MillerIndices Laue_class_representative( const MillerIndices & miller_indices, const PointGroup & laue_class )
+{
+    MillerIndices result( miller_indices );
+    for ( size_t i( 0 ); i != laue_class.nsymmetry_operators(); ++i )
+    {
+        const MillerIndices equivalent_reflection = miller_indices * laue_class.symmetry_operator( i );
+        const MillerIndices Friedel_mate( -equivalent_reflection.h(), -equivalent_reflection.k(), -equivalent_reflection.l() );
+        if ( is_lexicographically_smaller( result, equivalent_reflection ) )
+            result = equivalent_reflection;
+        if ( is_lexicographically_smaller( result, Friedel_mate ) )
+            result = Friedel_mate;
+    }
+    const MillerIndices Friedel_mate( -miller_indices.h(), -miller_indices.k(), -miller_indices.l() );
+    if ( is_lexicographically_smaller( result, Friedel_mate ) )
+        result = Friedel_mate;
+    return result;
+}
+
+// ********************************************************************************
+
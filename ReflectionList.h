@@ -29,9 +29,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 class FileName;
+class PointGroup;
 
+#include "LazyCache.h"
 #include "MillerIndices.h"
+#include "Vector3D.h"
 
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 // We deliberately store d-spacing and not 2 theta, because d-spacing is not wavelength dependent.
@@ -43,26 +48,48 @@ public:
 
     ReflectionList();
 
+    // Reflections can be added in any order. The list is sorted by d-spacing only once, when it is next read or when finalise() is called,
+    // so building a list of n reflections costs O( n log n ). If the reflections are added in order of decreasing d-spacing, no sorting is necessary.
     void push_back( const MillerIndices & miller_indices, const double F_squared, const double d_spacing, const size_t multiplicity );
 
+    // Also stores the Cartesian unit vectors along the reciprocal-lattice vectors of all equivalent reflections,
+    // so that e.g. a preferred-orientation correction does not have to generate them for every evaluation.
+    void push_back( const MillerIndices & miller_indices, const double F_squared, const double d_spacing, const size_t multiplicity,
+                    const std::vector< Vector3D > & equivalent_directions );
+
     void reserve( const size_t nvalues );
+
+    // Sorts the list by d-spacing if it has changed. Reading sorts the list as well, thread-safely (see LazyCache), so finalise()
+    // only does it in advance. With build_index, the hash table for index() is built as well.
+    void finalise( const bool build_index = false ) const;
+
     size_t size() const { return miller_indices_.size(); }
 
     // Does not understand anything about equivalence, so (100) is not the same as (-100).
-    // Returns size() if not found.
-    size_t index( const MillerIndices & miller_indices );
+    // Returns size() if not found. If the same (hkl) occurs more than once, the first one is returned.
+    // A hash table from the packed (hkl) to the index is built at the first call, so each look-up is O(1).
+    size_t index( const MillerIndices & miller_indices ) const;
+
+    // As index(), but any reflection that is equivalent under the Laue class (including Friedel's law) is found.
+    // If several equivalent reflections are in the list, the first one is returned.
+    size_t index( const MillerIndices & miller_indices, const PointGroup & laue_class ) const;
 
     // The index is zero-based
     // We don't actually sort the lists, but create a sorted map
-    MillerIndices miller_indices( const size_t i ) const { return miller_indices_[ sorted_map_[i] ];   }
-    double        F_squared(      const size_t i ) const { return F_squared_[ sorted_map_[i] ];      }
-    double        d_spacing(      const size_t i ) const { return d_spacings_[ sorted_map_[i] ]; }
-    size_t        multiplicity(   const size_t i ) const { return multiplicity_[ sorted_map_[i] ]; }
+    MillerIndices miller_indices( const size_t i ) const { return miller_indices_[ sorted_index(i) ]; }
+    double        F_squared(      const size_t i ) const { return F_squared_[ sorted_index(i) ]; }
+    double        d_spacing(      const size_t i ) const { return d_spacings_[ sorted_index(i) ]; }
+    size_t        multiplicity(   const size_t i ) const { return multiplicity_[ sorted_index(i) ]; }
 
-    void set_miller_indices( const size_t i, const MillerIndices & miller_indices ) { miller_indices_[ sorted_map_[i] ] = miller_indices; }
-    void set_F_squared(      const size_t i, const double F_squared ) { F_squared_[ sorted_map_[i] ] = F_squared; }
-    void set_d_spacing(      const size_t i, const double d_spacing ) { d_spacings_[ sorted_map_[i] ] = d_spacing; sort_by_d_spacing(); }
-    void set_multiplicity(   const size_t i, const size_t multiplicity ) { multiplicity_[ sorted_map_[i] ] = multiplicity; }
+    // 0 if the equivalent directions were not stored.
+    size_t nequivalent_directions( const size_t i ) const { return equivalent_directions_offsets_[ sorted_index(i) + 1 ] - equivalent_directions_offsets_[ sorted_index(i) ]; }
+    const Vector3D & equivalent_direction( const size_t i, const size_t j ) const { return equivalent_directions_[ equivalent_directions_offsets_[ sorted_index(i) ] + j ]; }
+
+    void set_miller_indices( const size_t i, const MillerIndices & miller_indices ) { miller_indices_[ sorted_index(i) ] = miller_indices; index_map_.invalidate(); }
+    void set_F_squared(      const size_t i, const double F_squared ) { F_squared_[ sorted_index(i) ] = F_squared; }
+    // The list is sorted again when it is next read, so the indices may change.
+    void set_d_spacing(      const size_t i, const double d_spacing ) { d_spacings_[ sorted_index(i) ] = d_spacing; sorted_map_.invalidate(); index_map_.invalidate(); }
+    void set_multiplicity(   const size_t i, const size_t multiplicity ) { multiplicity_[ sorted_index(i) ] = multiplicity; }
 
     // A ReflectionsList and a SHELX .hkl file are quite different, so this is a bit of an abuse of the class...
     void read_hkl( const FileName & file_name );
@@ -77,12 +104,27 @@ private:
     std::vector< double >        F_squared_;
     std::vector< double >        d_spacings_;
     std::vector< size_t >        multiplicity_;
+    // The equivalent directions of reflection i are equivalent_directions_[ equivalent_directions_offsets_[i] ] up to equivalent_directions_[ equivalent_directions_offsets_[i+1] ]
+    std::vector< Vector3D >      equivalent_directions_;
+    std::vector< size_t >        equivalent_directions_offsets_;
     // We don't actually sort the lists, but create a sorted map
-    std::vector< size_t > sorted_map_;
+    // The map is brought up to date lazily, it is invalid if d-spacings have been added or changed since the last sort.
+    LazyCache< std::vector< size_t > > sorted_map_;
+    // From the packed (hkl) to the sorted index, built lazily by index(), invalidated when the list changes.
+    LazyCache< std::unordered_map< std::uint64_t, size_t > > index_map_;
+
+    const std::vector< size_t > & sorted_map() const { return sorted_map_.get( [this]( std::vector< size_t > & result ) { sort_by_d_spacing( result ); } ); }
+    size_t sorted_index( const size_t i ) const { return sorted_map()[i]; }
 
     // We don't actually sort the lists, but create a sorted map
-    void sort_by_d_spacing();
+    void sort_by_d_spacing( std::vector< size_t > & sorted_map ) const;
+
+    void build_index_map( std::unordered_map< std::uint64_t, size_t > & index_map ) const;
 };
 
+// The representative of the reflections that are equivalent under the Laue class (including Friedel's law): the largest h, then k, then l,
+// the same choice as in PowderPatternCalculator::calculate_reflection_list(), so h > 0, or h = 0 and k > 0, or h = k = 0 and l > 0.
+MillerIndices Laue_class_representative( const MillerIndices & miller_indices, const PointGroup & laue_class );
+
 #endif // REFLECTIONLIST_H
 
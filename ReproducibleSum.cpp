@@ -0,0 +1,156 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ReproducibleSum.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+// Bit 0 of the accumulator has weight 2^-bias, the weight of the least significant bit of the smallest subnormal.
+const int bias = 1074;
+
+// After this many additions, each of at most 2^32 in absolute value, the carries must be propagated.
+const size_t maximum_nadditions = size_t( 1 ) << 30;
+
+// By inspecting the bits, because -Ofast may assume that there are no infinities and NaNs
+bool is_finite( const double value )
+{
+    uint64_t bits;
+    std::memcpy( &bits, &value, sizeof( bits ) );
+    return ( ( bits >> 52 ) & 0x7FF ) != 0x7FF;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+ReproducibleSum::ReproducibleSum():
+non_finite_(0.0),
+nadditions_(0)
+{
+    for ( size_t i( 0 ); i != ndigits_; ++i )
+        digits_[i] = 0;
+}
+
+// ********************************************************************************
+
+void ReproducibleSum::add( const double value )
+{
+    // The bits of value: sign, 11 bits of biased exponent and 52 bits of mantissa
+    uint64_t bits;
+    std::memcpy( &bits, &value, sizeof( bits ) );
+    const unsigned int biased_exponent = static_cast< unsigned int >( ( bits >> 52 ) & 0x7FF );
+    uint64_t magnitude = bits & 0xFFFFFFFFFFFFFull;
+    if ( biased_exponent == 0x7FF )
+    {
+        non_finite_ += value;
+        return;
+    }
+    // value = magnitude * 2^( position - bias ), subnormals (and zero) have position 0
+    int position( 0 );
+    if ( biased_exponent != 0 )
+    {
+        magnitude |= ( uint64_t( 1 ) << 52 );
+        position = biased_exponent - 1;
+    }
+    else if ( magnitude == 0 )
+        return;
+    const bool is_negative = ( ( bits >> 63 ) != 0 );
+    const size_t digit = position / 32;
+    const int shift = position % 32;
+    // magnitude << shift has at most 85 bits, spread over three digits
+    const uint64_t low = ( magnitude << shift ) & 0xFFFFFFFFu;
+    const uint64_t middle = ( magnitude >> ( 32 - shift ) ) & 0xFFFFFFFFu;
+    const uint64_t high = ( shift == 0 ) ? 0 : ( magnitude >> ( 64 - shift ) );
+    const int64_t sign = is_negative ? -1 : 1;
+    digits_[digit    ] += sign * static_cast< int64_t >( low );
+    digits_[digit + 1] += sign * static_cast< int64_t >( middle );
+    digits_[digit + 2] += sign * static_cast< int64_t >( high );
+    if ( ++nadditions_ == maximum_nadditions )
+        normalise();
+}
+
+// ********************************************************************************
+
+void ReproducibleSum::add( const ReproducibleSum & rhs )
+{
+    ReproducibleSum normalised( rhs );
+    normalised.normalise();
+    normalise();
+    for ( size_t i( 0 ); i != ndigits_; ++i )
+        digits_[i] += normalised.digits_[i];
+    non_finite_ += rhs.non_finite_;
+    nadditions_ = 2;
+}
+
+// ********************************************************************************
+
+double ReproducibleSum::sum() const
+{
+    if ( ( non_finite_ != 0.0 ) || ( ! is_finite( non_finite_ ) ) )
+        return non_finite_;
+    ReproducibleSum exact( *this );
+    exact.normalise();
+    // After normalisation all digits are in [0,2^32) except the most significant one, which carries the sign
+    const bool is_negative = ( exact.digits_[ndigits_-1] < 0 );
+    if ( is_negative )
+    {
+        for ( size_t i( 0 ); i != ndigits_; ++i )
+            exact.digits_[i] = -exact.digits_[i];
+        exact.normalise();
+    }
+    size_t top( ndigits_ );
+    while ( ( top != 0 ) && ( exact.digits_[top-1] == 0 ) )
+        --top;
+    if ( top == 0 )
+        return 0.0;
+    // The three most significant digits hold at least 65 significant bits, the rest cannot change the result by more than a rounding error
+    const size_t first = ( top >= 3 ) ? top - 3 : 0;
+    double result( 0.0 );
+    for ( size_t i( top ); i != first; --i )
+        result = result * 4294967296.0 + static_cast< double >( exact.digits_[i-1] );
+    result = std::ldexp( result, static_cast< int >( 32 * first ) - bias );
+    return is_negative ? -result : result;
+}
+
+// ********************************************************************************
+
+void ReproducibleSum::normalise()
+{
+    for ( size_t i( 0 ); i != ndigits_ - 1; ++i )
+    {
+        // Arithmetic shift, so that negative digits borrow from the next one
+        const int64_t carry = digits_[i] >> 32;
+        digits_[i] -= carry * 4294967296LL;
+        digits_[i+1] += carry;
+    }
+    nadditions_ = 0;
+}
+
@@ -0,0 +1,78 @@
+#ifndef REPRODUCIBLESUM_H
+#define REPRODUCIBLESUM_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
+
+/*
+  Exact summation of doubles, so that the result does not depend on the order in which the values are added:
+  not on the number of threads, on how the values are divided into chunks, or on the vector width the compiler chooses.
+
+  The sum is accumulated exactly in a fixed-point number that covers the whole range of double (a superaccumulator),
+  stored as 32-bit digits in 64-bit words so that the carries need only be propagated every 2^30 additions.
+  sum() converts the exact sum to double with an error of at most about one rounding error, so it is also more accurate than
+  any ordinary summation.
+  An add() costs a few integer operations on three words, about five times a plain floating-point addition
+  when the plain addition is vectorised; the accumulator itself is about 550 bytes.
+  Infinities and NaNs are summed separately and dominate the result as in ordinary floating-point arithmetic.
+*/
+class ReproducibleSum
+{
+public:
+
+    ReproducibleSum();
+
+    void add( const double value );
+
+    // Adds the sum of another accumulator, e.g. that of another thread.
+    void add( const ReproducibleSum & rhs );
+
+    double sum() const;
+
+private:
+    // Enough 32-bit digits for the smallest subnormal up to the largest double, plus headroom for sums that overflow double
+    static const size_t ndigits_ = 68;
+    int64_t digits_[ndigits_];
+    double non_finite_;
+    size_t nadditions_;
+
+    void normalise();
+};
+
+// For classes that sum in parallel, selectable at run time.
+// FAST_SUMMATION: the values are summed in chunks of a fixed size, so the result does not depend on the number of threads,
+//     but it may change in the last bits with the chunk size, the compiler and its flags (e.g. -Ofast vectorises in a different order).
+// REPRODUCIBLE_SUMMATION: every value is added to a ReproducibleSum, so the result is bit-identical for any number of threads,
+//     any chunk size and any build. Costs about five times as much per value as a vectorised sum,
+//     which is negligible when each value is expensive, e.g. a sum over the neighbours of an atom.
+enum SummationMode { FAST_SUMMATION, REPRODUCIBLE_SUMMATION };
+
+#endif // REPRODUCIBLESUM_H
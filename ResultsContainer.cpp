@@ -0,0 +1,536 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ResultsContainer.h"
+#include "CorrelationMatrix.h"
+#include "FileName.h"
+#include "MillerIndices.h"
+#include "PowderPattern.h"
+#include "ReflectionList.h"
+#include "Utilities.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#include <zlib.h>
+
+namespace
+{
+
+const size_t header_size = 64;
+const char magic[] = "FOURRC01";
+// The number of values of the similarity matrix per chunk
+const size_t similarity_chunk_size = 1 << 20;
+
+void write_all( const int file_descriptor, const char * data, const size_t nbytes, const size_t offset, const std::string & function_name, const std::string & file_name )
+{
+    size_t nwritten( 0 );
+    while ( nwritten != nbytes )
+    {
+        const ssize_t n = pwrite( file_descriptor, data + nwritten, nbytes - nwritten, offset + nwritten );
+        if ( n == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            throw std::runtime_error( function_name + ": could not write to file " + file_name + "." );
+        }
+        nwritten += n;
+    }
+}
+
+void read_all( const int file_descriptor, char * data, const size_t nbytes, const size_t offset, const std::string & function_name, const std::string & file_name )
+{
+    size_t nread( 0 );
+    while ( nread != nbytes )
+    {
+        const ssize_t n = pread( file_descriptor, data + nread, nbytes - nread, offset + nread );
+        if ( n == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            throw std::runtime_error( function_name + ": could not read from file " + file_name + "." );
+        }
+        if ( n == 0 )
+            throw std::runtime_error( function_name + ": unexpected end of file " + file_name + "." );
+        nread += n;
+    }
+}
+
+template< class T >
+void append( std::vector< char > & buffer, const T & value )
+{
+    const size_t position = buffer.size();
+    buffer.resize( position + sizeof( T ) );
+    std::memcpy( &buffer[position], &value, sizeof( T ) );
+}
+
+template< class T >
+T extract( const std::vector< char > & buffer, size_t & position )
+{
+    if ( position + sizeof( T ) > buffer.size() )
+        throw std::runtime_error( "ResultsContainer: corrupt chunk or index." );
+    T value;
+    std::memcpy( &value, &buffer[position], sizeof( T ) );
+    position += sizeof( T );
+    return value;
+}
+
+void append( std::vector< char > & buffer, const ResultsContainerChunk & chunk )
+{
+    append( buffer, static_cast< uint64_t >( chunk.offset_ ) );
+    append( buffer, static_cast< uint64_t >( chunk.compressed_size_ ) );
+    append( buffer, static_cast< uint64_t >( chunk.size_ ) );
+}
+
+ResultsContainerChunk extract_chunk( const std::vector< char > & buffer, size_t & position )
+{
+    ResultsContainerChunk result;
+    result.offset_ = extract< uint64_t >( buffer, position );
+    result.compressed_size_ = extract< uint64_t >( buffer, position );
+    result.size_ = extract< uint64_t >( buffer, position );
+    return result;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+ResultsContainerWriter::ResultsContainerWriter( const FileName & file_name, const size_t nstructures,
+                                                const Angle two_theta_start, const Angle two_theta_step, const size_t npoints,
+                                                const double wavelength, const int compression_level ):
+file_name_( file_name.full_name() ),
+file_descriptor_(-1),
+nstructures_(nstructures),
+two_theta_start_(two_theta_start),
+two_theta_step_(two_theta_step),
+npoints_(npoints),
+wavelength_(wavelength),
+compression_level_(compression_level),
+end_of_file_(header_size),
+powder_patterns_(nstructures),
+reflection_lists_(nstructures),
+identifiers_(nstructures),
+similarity_matrix_dimension_(0)
+{
+    file_descriptor_ = open( file_name_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    if ( file_descriptor_ == -1 )
+        throw std::runtime_error( "ResultsContainerWriter::ResultsContainerWriter(): could not open file " + file_name_ + "." );
+    // The header is written by close(), until then the file is recognisably incomplete
+    const std::vector< char > header( header_size, 0 );
+    write_all( file_descriptor_, &header[0], header_size, 0, "ResultsContainerWriter::ResultsContainerWriter()", file_name_ );
+}
+
+// ********************************************************************************
+
+ResultsContainerWriter::~ResultsContainerWriter()
+{
+    try
+    {
+        close();
+    }
+    catch ( std::exception & )
+    {
+    }
+}
+
+// ********************************************************************************
+
+void ResultsContainerWriter::write_powder_pattern( const size_t i, const PowderPattern & powder_pattern )
+{
+    if ( powder_pattern.size() != npoints_ )
+        throw std::runtime_error( "ResultsContainerWriter::write_powder_pattern(): number of points does not match." );
+    if ( ( std::abs( ( powder_pattern.two_theta( 0 ) - two_theta_start_ ).value_in_degrees() ) > 0.01 * two_theta_step_.value_in_degrees() ) ||
+         ( std::abs( ( powder_pattern.two_theta( npoints_ - 1 ) - ( two_theta_start_ + ( npoints_ - 1 ) * two_theta_step_ ) ).value_in_degrees() ) > 0.01 * two_theta_step_.value_in_degrees() ) )
+        throw std::runtime_error( "ResultsContainerWriter::write_powder_pattern(): pattern is not on the shared 2theta grid." );
+    write_powder_pattern( i, powder_pattern.intensities() );
+}
+
+// ********************************************************************************
+
+void ResultsContainerWriter::write_powder_pattern( const size_t i, const double * intensities )
+{
+    const ResultsContainerChunk chunk = write_chunk( reinterpret_cast< const char * >( intensities ), npoints_ * sizeof( double ) );
+    store( powder_patterns_, i, chunk, "ResultsContainerWriter::write_powder_pattern()" );
+}
+
+// ********************************************************************************
+
+void ResultsContainerWriter::write_reflection_list( const size_t i, const ReflectionList & reflection_list )
+{
+    const size_t n = reflection_list.size();
+    std::vector< char > buffer;
+    buffer.reserve( sizeof( uint64_t ) + n * ( 3 * sizeof( int32_t ) + 2 * sizeof( double ) + sizeof( uint64_t ) ) );
+    append( buffer, static_cast< uint64_t >( n ) );
+    for ( size_t j( 0 ); j != n; ++j )
+        append( buffer, static_cast< int32_t >( reflection_list.miller_indices( j ).h() ) );
+    for ( size_t j( 0 ); j != n; ++j )
+        append( buffer, static_cast< int32_t >( reflection_list.miller_indices( j ).k() ) );
+    for ( size_t j( 0 ); j != n; ++j )
+        append( buffer, static_cast< int32_t >( reflection_list.miller_indices( j ).l() ) );
+    for ( size_t j( 0 ); j != n; ++j )
+        append( buffer, reflection_list.F_squared( j ) );
+    for ( size_t j( 0 ); j != n; ++j )
+        append( buffer, reflection_list.d_spacing( j ) );
+    for ( size_t j( 0 ); j != n; ++j )
+        append( buffer, static_cast< uint64_t >( reflection_list.multiplicity( j ) ) );
+    const ResultsContainerChunk chunk = write_chunk( &buffer[0], buffer.size() );
+    store( reflection_lists_, i, chunk, "ResultsContainerWriter::write_reflection_list()" );
+}
+
+// ********************************************************************************
+
+void ResultsContainerWriter::write_identifier( const size_t i, const std::string & identifier )
+{
+    const ResultsContainerChunk chunk = write_chunk( identifier.data(), identifier.size() );
+    store( identifiers_, i, chunk, "ResultsContainerWriter::write_identifier()" );
+}
+
+// ********************************************************************************
+
+void ResultsContainerWriter::write_similarity_matrix( const CorrelationMatrix & similarity_matrix )
+{
+    if ( similarity_matrix.size() != nstructures_ )
+        throw std::runtime_error( "ResultsContainerWriter::write_similarity_matrix(): dimension does not match the number of structures." );
+    {
+    std::lock_guard< std::mutex > lock( mutex_ );
+    if ( similarity_matrix_dimension_ != 0 )
+        throw std::runtime_error( "ResultsContainerWriter::write_similarity_matrix(): similarity matrix has already been written." );
+    similarity_matrix_dimension_ = nstructures_;
+    }
+    // The lower triangle, row by row, the first value is the value on the diagonal
+    std::vector< double > values;
+    values.reserve( similarity_chunk_size );
+    values.push_back( similarity_matrix.value_on_diagonal() );
+    std::vector< ResultsContainerChunk > chunks;
+    for ( size_t i( 1 ); i < nstructures_; ++i )
+    {
+        for ( size_t j( 0 ); j != i; ++j )
+        {
+            values.push_back( similarity_matrix.value( i, j ) );
+            if ( values.size() == similarity_chunk_size )
+            {
+                chunks.push_back( write_chunk( reinterpret_cast< const char * >( &values[0] ), values.size() * sizeof( double ) ) );
+                values.clear();
+            }
+        }
+    }
+    if ( ! values.empty() )
+        chunks.push_back( write_chunk( reinterpret_cast< const char * >( &values[0] ), values.size() * sizeof( double ) ) );
+    std::lock_guard< std::mutex > lock( mutex_ );
+    similarity_matrix_.swap( chunks );
+}
+
+// ********************************************************************************
+
+void ResultsContainerWriter::close()
+{
+    std::lock_guard< std::mutex > lock( mutex_ );
+    if ( file_descriptor_ == -1 )
+        return;
+    std::vector< char > index;
+    for ( size_t i( 0 ); i != nstructures_; ++i )
+        append( index, powder_patterns_[i] );
+    for ( size_t i( 0 ); i != nstructures_; ++i )
+        append( index, reflection_lists_[i] );
+    for ( size_t i( 0 ); i != nstructures_; ++i )
+        append( index, identifiers_[i] );
+    append( index, static_cast< uint64_t >( similarity_matrix_dimension_ ) );
+    append( index, static_cast< uint64_t >( similarity_matrix_.size() ) );
+    for ( size_t i( 0 ); i != similarity_matrix_.size(); ++i )
+        append( index, similarity_matrix_[i] );
+    const size_t index_offset = end_of_file_;
+    std::vector< char > header;
+    header.insert( header.end(), magic, magic + 8 );
+    append( header, static_cast< uint64_t >( nstructures_ ) );
+    append( header, static_cast< uint64_t >( npoints_ ) );
+    append( header, two_theta_start_.value_in_degrees() );
+    append( header, two_theta_step_.value_in_degrees() );
+    append( header, wavelength_ );
+    append( header, static_cast< uint64_t >( index_offset ) );
+    append( header, static_cast< uint64_t >( index.size() ) );
+    const int file_descriptor = file_descriptor_;
+    file_descriptor_ = -1;
+    try
+    {
+        write_all( file_descriptor, &index[0], index.size(), index_offset, "ResultsContainerWriter::close()", file_name_ );
+        write_all( file_descriptor, &header[0], header.size(), 0, "ResultsContainerWriter::close()", file_name_ );
+    }
+    catch ( std::exception & )
+    {
+        ::close( file_descriptor );
+        throw;
+    }
+    if ( ::close( file_descriptor ) != 0 )
+        throw std::runtime_error( "ResultsContainerWriter::close(): could not close file " + file_name_ + "." );
+}
+
+// ********************************************************************************
+
+ResultsContainerChunk ResultsContainerWriter::write_chunk( const char * data, const size_t nbytes )
+{
+    if ( file_descriptor_ == -1 )
+        throw std::runtime_error( "ResultsContainerWriter::write_chunk(): container has been closed." );
+    uLongf compressed_size = compressBound( nbytes );
+    std::vector< char > compressed( compressed_size );
+    if ( compress2( reinterpret_cast< Bytef * >( &compressed[0] ), &compressed_size, reinterpret_cast< const Bytef * >( data ), nbytes, compression_level_ ) != Z_OK )
+        throw std::runtime_error( "ResultsContainerWriter::write_chunk(): compression failed." );
+    ResultsContainerChunk result;
+    result.offset_ = end_of_file_.fetch_add( compressed_size );
+    result.compressed_size_ = compressed_size;
+    result.size_ = nbytes;
+    write_all( file_descriptor_, &compressed[0], compressed_size, result.offset_, "ResultsContainerWriter::write_chunk()", file_name_ );
+    return result;
+}
+
+// ********************************************************************************
+
+void ResultsContainerWriter::store( std::vector< ResultsContainerChunk > & chunks, const size_t i, const ResultsContainerChunk & chunk, const std::string & function_name )
+{
+    if ( i >= nstructures_ )
+        throw std::runtime_error( function_name + ": index out of range." );
+    std::lock_guard< std::mutex > lock( mutex_ );
+    if ( chunks[i].compressed_size_ != 0 )
+        throw std::runtime_error( function_name + ": item " + size_t2string( i ) + " has already been written." );
+    chunks[i] = chunk;
+}
+
+// ********************************************************************************
+
+ResultsContainer::ResultsContainer( const FileName & file_name ):
+file_name_( file_name.full_name() ),
+file_descriptor_(-1),
+nstructures_(0),
+npoints_(0),
+wavelength_(0.0),
+similarity_matrix_dimension_(0)
+{
+    file_descriptor_ = open( file_name_.c_str(), O_RDONLY );
+    if ( file_descriptor_ == -1 )
+        throw std::runtime_error( "ResultsContainer::ResultsContainer(): could not open file " + file_name_ + "." );
+    try
+    {
+        std::vector< char > header( header_size );
+        read_all( file_descriptor_, &header[0], header_size, 0, "ResultsContainer::ResultsContainer()", file_name_ );
+        if ( std::memcmp( &header[0], magic, 8 ) != 0 )
+            throw std::runtime_error( "ResultsContainer::ResultsContainer(): file " + file_name_ + " is not a results container or was not closed." );
+        size_t position( 8 );
+        nstructures_ = extract< uint64_t >( header, position );
+        npoints_ = extract< uint64_t >( header, position );
+        two_theta_start_ = Angle::from_degrees( extract< double >( header, position ) );
+        two_theta_step_ = Angle::from_degrees( extract< double >( header, position ) );
+        wavelength_ = extract< double >( header, position );
+        const size_t index_offset = extract< uint64_t >( header, position );
+        const size_t index_size = extract< uint64_t >( header, position );
+        std::vector< char > index( index_size );
+        if ( index_size != 0 )
+            read_all( file_descriptor_, &index[0], index_size, index_offset, "ResultsContainer::ResultsContainer()", file_name_ );
+        position = 0;
+        powder_patterns_.reserve( nstructures_ );
+        for ( size_t i( 0 ); i != nstructures_; ++i )
+            powder_patterns_.push_back( extract_chunk( index, position ) );
+        reflection_lists_.reserve( nstructures_ );
+        for ( size_t i( 0 ); i != nstructures_; ++i )
+            reflection_lists_.push_back( extract_chunk( index, position ) );
+        identifiers_.reserve( nstructures_ );
+        for ( size_t i( 0 ); i != nstructures_; ++i )
+            identifiers_.push_back( extract_chunk( index, position ) );
+        similarity_matrix_dimension_ = extract< uint64_t >( index, position );
+        const size_t nchunks = extract< uint64_t >( index, position );
+        for ( size_t i( 0 ); i != nchunks; ++i )
+            similarity_matrix_.push_back( extract_chunk( index, position ) );
+    }
+    catch ( std::exception & )
+    {
+        close( file_descriptor_ );
+        throw;
+    }
+}
+
+// ********************************************************************************
+
+ResultsContainer::~ResultsContainer()
+{
+    close( file_descriptor_ );
+}
+
+// ********************************************************************************
+
+bool ResultsContainer::has_powder_pattern( const size_t i ) const
+{
+    return ( i < nstructures_ ) && ( powder_patterns_[i].compressed_size_ != 0 );
+}
+
+// ********************************************************************************
+
+std::vector< double > ResultsContainer::intensities( const size_t i ) const
+{
+    const std::vector< char > buffer = read_chunk( chunk( powder_patterns_, i, "ResultsContainer::intensities()" ) );
+    if ( buffer.size() != npoints_ * sizeof( double ) )
+        throw std::runtime_error( "ResultsContainer::intensities(): corrupt chunk." );
+    std::vector< double > result( npoints_ );
+    if ( npoints_ != 0 )
+        std::memcpy( &result[0], &buffer[0], buffer.size() );
+    return result;
+}
+
+// ********************************************************************************
+
+PowderPattern ResultsContainer::powder_pattern( const size_t i ) const
+{
+    const std::vector< double > values = intensities( i );
+    PowderPattern result( two_theta_start_, two_theta_start_ + ( npoints_ - 1 ) * two_theta_step_, two_theta_step_ );
+    if ( result.size() != npoints_ )
+        throw std::runtime_error( "ResultsContainer::powder_pattern(): 2theta grid could not be reconstructed." );
+    for ( size_t j( 0 ); j != npoints_; ++j )
+        result.set_intensity( j, values[j] );
+    result.set_wavelength( wavelength_ );
+    result.recalculate_estimated_standard_deviations();
+    return result;
+}
+
+// ********************************************************************************
+
+bool ResultsContainer::has_reflection_list( const size_t i ) const
+{
+    return ( i < nstructures_ ) && ( reflection_lists_[i].compressed_size_ != 0 );
+}
+
+// ********************************************************************************
+
+ReflectionList ResultsContainer::reflection_list( const size_t i ) const
+{
+    const std::vector< char > buffer = read_chunk( chunk( reflection_lists_, i, "ResultsContainer::reflection_list()" ) );
+    size_t position( 0 );
+    const size_t n = extract< uint64_t >( buffer, position );
+    // Column j starts at position + offset of column j
+    const size_t h_position = position;
+    const size_t k_position = h_position + n * sizeof( int32_t );
+    const size_t l_position = k_position + n * sizeof( int32_t );
+    const size_t F_squared_position = l_position + n * sizeof( int32_t );
+    const size_t d_spacing_position = F_squared_position + n * sizeof( double );
+    const size_t multiplicity_position = d_spacing_position + n * sizeof( double );
+    if ( multiplicity_position + n * sizeof( uint64_t ) != buffer.size() )
+        throw std::runtime_error( "ResultsContainer::reflection_list(): corrupt chunk." );
+    ReflectionList result;
+    for ( size_t j( 0 ); j != n; ++j )
+    {
+        size_t h( h_position + j * sizeof( int32_t ) );
+        size_t k( k_position + j * sizeof( int32_t ) );
+        size_t l( l_position + j * sizeof( int32_t ) );
+        size_t F_squared( F_squared_position + j * sizeof( double ) );
+        size_t d_spacing( d_spacing_position + j * sizeof( double ) );
+        size_t multiplicity( multiplicity_position + j * sizeof( uint64_t ) );
+        result.push_back( MillerIndices( extract< int32_t >( buffer, h ), extract< int32_t >( buffer, k ), extract< int32_t >( buffer, l ) ),
+                          extract< double >( buffer, F_squared ),
+                          extract< double >( buffer, d_spacing ),
+                          extract< uint64_t >( buffer, multiplicity ) );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::string ResultsContainer::identifier( const size_t i ) const
+{
+    if ( i >= nstructures_ )
+        throw std::runtime_error( "ResultsContainer::identifier(): index out of range." );
+    if ( identifiers_[i].compressed_size_ == 0 )
+        return std::string();
+    const std::vector< char > buffer = read_chunk( identifiers_[i] );
+    return std::string( buffer.begin(), buffer.end() );
+}
+
+// ********************************************************************************
+
+CorrelationMatrix ResultsContainer::similarity_matrix() const
+{
+    if ( similarity_matrix_dimension_ == 0 )
+        throw std::runtime_error( "ResultsContainer::similarity_matrix(): no similarity matrix has been written." );
+    CorrelationMatrix result( similarity_matrix_dimension_ );
+    size_t i( 1 );
+    size_t j( 0 );
+    bool is_first_value( true );
+    for ( size_t c( 0 ); c != similarity_matrix_.size(); ++c )
+    {
+        const std::vector< char > buffer = read_chunk( similarity_matrix_[c] );
+        size_t position( 0 );
+        while ( position != buffer.size() )
+        {
+            const double value = extract< double >( buffer, position );
+            if ( is_first_value )
+            {
+                result.set_value_on_diagonal( value );
+                is_first_value = false;
+                continue;
+            }
+            if ( i >= similarity_matrix_dimension_ )
+                throw std::runtime_error( "ResultsContainer::similarity_matrix(): corrupt chunk." );
+            result.set_value( i, j, value );
+            ++j;
+            if ( j == i )
+            {
+                ++i;
+                j = 0;
+            }
+        }
+    }
+    if ( ( similarity_matrix_dimension_ > 1 ) && ( i != similarity_matrix_dimension_ ) )
+        throw std::runtime_error( "ResultsContainer::similarity_matrix(): similarity matrix is incomplete." );
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< char > ResultsContainer::read_chunk( const ResultsContainerChunk & chunk ) const
+{
+    std::vector< char > compressed( chunk.compressed_size_ );
+    read_all( file_descriptor_, &compressed[0], chunk.compressed_size_, chunk.offset_, "ResultsContainer::read_chunk()", file_name_ );
+    std::vector< char > result( chunk.size_ );
+    uLongf size = chunk.size_;
+    if ( ( uncompress( reinterpret_cast< Bytef * >( result.empty() ? 0 : &result[0] ), &size, reinterpret_cast< const Bytef * >( &compressed[0] ), chunk.compressed_size_ ) != Z_OK ) || ( size != chunk.size_ ) )
+        throw std::runtime_error( "ResultsContainer::read_chunk(): corrupt chunk in file " + file_name_ + "." );
+    return result;
+}
+
+// ********************************************************************************
+
+const ResultsContainerChunk & ResultsContainer::chunk( const std::vector< ResultsContainerChunk > & chunks, const size_t i, const std::string & function_name ) const
+{
+    if ( i >= nstructures_ )
+        throw std::runtime_error( function_name + ": index out of range." );
+    if ( chunks[i].compressed_size_ == 0 )
+        throw std::runtime_error( function_name + ": item " + size_t2string( i ) + " has not been written." );
+    return chunks[i];
+}
+
+// ********************************************************************************
+
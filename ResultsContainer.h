@@ -0,0 +1,194 @@
+#ifndef RESULTSCONTAINER_H
+#define RESULTSCONTAINER_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CorrelationMatrix;
+class FileName;
+class PowderPattern;
+class ReflectionList;
+
+#include "Angle.h"
+
+#include <atomic>
+#include <cstddef> // For definition of size_t
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+  One file for the results of a batch of N structures, instead of thousands of .xye, .hkl and .txt files:
+
+    a library of powder patterns on a shared 2theta grid, i.e. an N x M intensity matrix
+    a reflection list per structure (without the equivalent directions)
+    an identifier per structure, e.g. the name of the cif file
+    a similarity matrix of the N structures
+
+  The data are stored in chunks that are compressed with zlib: one chunk per pattern, per reflection list and per
+  identifier, and chunks of about a million values for the similarity matrix. The reflection lists are stored
+  column by column (all h, all k, ..., all multiplicities), which compresses better than row by row.
+  The offsets of the chunks are kept in an index at the end of the file, so any item can be read on its own.
+
+  The file starts with a header of header_size bytes:
+    "FOURRC01", N, M, 2theta start, 2theta step (degrees), wavelength, offset of the index, size of the index
+  Integers are 64 bits, multi-byte values are stored in the native byte order.
+*/
+
+// The position of one compressed chunk in the file. A compressed size of 0 means that the item has not been written.
+struct ResultsContainerChunk
+{
+    ResultsContainerChunk(): offset_(0), compressed_size_(0), size_(0) {}
+    size_t offset_;
+    size_t compressed_size_;
+    size_t size_; // Uncompressed
+};
+
+/*
+  Creates a results container. The items can be written in any order and from several threads at the same time:
+  each chunk is compressed by the calling thread and written with pwrite() at its own offset.
+  The container can only be read after close() has written the index.
+*/
+class ResultsContainerWriter
+{
+public:
+
+    // An existing file is overwritten. compression_level is as for gzip, 1-9.
+    ResultsContainerWriter( const FileName & file_name, const size_t nstructures,
+                            const Angle two_theta_start, const Angle two_theta_step, const size_t npoints,
+                            const double wavelength = 1.54056, const int compression_level = 6 );
+
+    // Calls close() if that has not been done, errors are then lost.
+    ~ResultsContainerWriter();
+
+    size_t nstructures() const { return nstructures_; }
+    size_t npoints() const { return npoints_; }
+
+    // Thread-safe. Each item can be written only once. The pattern must be on the shared 2theta grid.
+    void write_powder_pattern( const size_t i, const PowderPattern & powder_pattern );
+
+    // Thread-safe. npoints() intensities, e.g. a row of a BatchPowderPatternCalculator.
+    void write_powder_pattern( const size_t i, const double * intensities );
+
+    // Thread-safe.
+    void write_reflection_list( const size_t i, const ReflectionList & reflection_list );
+
+    // Thread-safe.
+    void write_identifier( const size_t i, const std::string & identifier );
+
+    // The dimension must be nstructures(). Can be written only once.
+    void write_similarity_matrix( const CorrelationMatrix & similarity_matrix );
+
+    // Writes the index and closes the file. No items can be written afterwards.
+    void close();
+
+private:
+    std::string file_name_;
+    int file_descriptor_;
+    size_t nstructures_;
+    Angle two_theta_start_;
+    Angle two_theta_step_;
+    size_t npoints_;
+    double wavelength_;
+    int compression_level_;
+    std::atomic< size_t > end_of_file_;
+    std::mutex mutex_; // For the index
+    std::vector< ResultsContainerChunk > powder_patterns_;
+    std::vector< ResultsContainerChunk > reflection_lists_;
+    std::vector< ResultsContainerChunk > identifiers_;
+    std::vector< ResultsContainerChunk > similarity_matrix_;
+    size_t similarity_matrix_dimension_;
+
+    // Compresses and writes one chunk, thread-safe.
+    ResultsContainerChunk write_chunk( const char * data, const size_t nbytes );
+
+    // Thread-safe. Throws if the item has already been written.
+    void store( std::vector< ResultsContainerChunk > & chunks, const size_t i, const ResultsContainerChunk & chunk, const std::string & function_name );
+
+    ResultsContainerWriter( const ResultsContainerWriter & );
+    ResultsContainerWriter & operator=( const ResultsContainerWriter & );
+};
+
+/*
+  Reads a file written by ResultsContainerWriter. All functions are const and read with pread(), so they are thread-safe.
+  Only the index is read when the container is opened.
+*/
+class ResultsContainer
+{
+public:
+
+    explicit ResultsContainer( const FileName & file_name );
+
+    ~ResultsContainer();
+
+    size_t nstructures() const { return nstructures_; }
+    size_t npoints() const { return npoints_; }
+    Angle two_theta_start() const { return two_theta_start_; }
+    Angle two_theta_step() const { return two_theta_step_; }
+    double wavelength() const { return wavelength_; }
+
+    bool has_powder_pattern( const size_t i ) const;
+    // The estimated standard deviations are recalculated from the intensities.
+    PowderPattern powder_pattern( const size_t i ) const;
+    // npoints() values.
+    std::vector< double > intensities( const size_t i ) const;
+
+    bool has_reflection_list( const size_t i ) const;
+    ReflectionList reflection_list( const size_t i ) const;
+
+    // Empty if not written.
+    std::string identifier( const size_t i ) const;
+
+    bool has_similarity_matrix() const { return similarity_matrix_dimension_ != 0; }
+    CorrelationMatrix similarity_matrix() const;
+
+private:
+    std::string file_name_;
+    int file_descriptor_;
+    size_t nstructures_;
+    size_t npoints_;
+    Angle two_theta_start_;
+    Angle two_theta_step_;
+    double wavelength_;
+    std::vector< ResultsContainerChunk > powder_patterns_;
+    std::vector< ResultsContainerChunk > reflection_lists_;
+    std::vector< ResultsContainerChunk > identifiers_;
+    std::vector< ResultsContainerChunk > similarity_matrix_;
+    size_t similarity_matrix_dimension_;
+
+    // Reads and decompresses one chunk.
+    std::vector< char > read_chunk( const ResultsContainerChunk & chunk ) const;
+
+    // Throws if i is out of range or the item was not written.
+    const ResultsContainerChunk & chunk( const std::vector< ResultsContainerChunk > & chunks, const size_t i, const std::string & function_name ) const;
+
+    ResultsContainer( const ResultsContainer & );
+    ResultsContainer & operator=( const ResultsContainer & );
+};
+
+#endif // RESULTSCONTAINER_H
@@ -0,0 +1,183 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "RunBenchmarks.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "FileName.h"
+#include "MathConstants.h"
+#include "MathFunctions.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "RandomNumberGenerator.h"
+#include "ReadCif.h"
+#include "Sudoku.h"
+#include "SudokuBenchmark.h"
+#include "SudokuSolver.h"
+#include "VoidsFinder.h"
+#include "Utilities.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+// Results are added to this so that the compiler cannot optimise the benchmarked code away.
+volatile double benchmark_sink;
+
+void print( const BenchmarkResult & result, std::vector< BenchmarkResult > & results )
+{
+    std::cout << result.report() << std::endl;
+    results.push_back( result );
+}
+
+// A pattern with npoints points and a peak every 50 points.
+PowderPattern synthetic_powder_pattern( const size_t npoints, const double shift )
+{
+    PowderPattern result( Angle::from_degrees( 5.0 ), Angle::from_degrees( 5.0 + 0.01 * ( npoints - 1 ) ), Angle::from_degrees( 0.01 ) );
+    for ( size_t i( 0 ); i != result.size(); ++i )
+        result.set_intensity( i, 10.0 + 1000.0 * std::exp( -square( std::fmod( i + shift, 50.0 ) - 25.0 ) / 8.0 ) );
+    result.recalculate_estimated_standard_deviations();
+    return result;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+CrystalStructure synthetic_molecular_crystal( const size_t nmolecules_per_axis )
+{
+    const double n = static_cast< double >( nmolecules_per_axis );
+    CrystalStructure result;
+    result.set_crystal_lattice( CrystalLattice( 6.8 * n, 7.1 * n, 7.4 * n, Angle::angle_90_degrees(), Angle::from_degrees( 95.0 ), Angle::angle_90_degrees() ) );
+    result.reserve_natoms( 12 * nmolecules_per_axis * nmolecules_per_axis * nmolecules_per_axis );
+    const Matrix3D & orthogonal_to_fractional = result.crystal_lattice().orthogonal_to_fractional_matrix();
+    size_t imolecule( 0 );
+    for ( size_t i( 0 ); i != nmolecules_per_axis; ++i )
+    {
+        for ( size_t j( 0 ); j != nmolecules_per_axis; ++j )
+        {
+            for ( size_t k( 0 ); k != nmolecules_per_axis; ++k )
+            {
+                const Vector3D centre( ( i + 0.5 ) / n, ( j + 0.5 ) / n, ( k + 0.5 ) / n );
+                // Tilt the plane of each molecule differently
+                const double tilt = 0.7 * imolecule;
+                const std::string suffix = "_" + size_t2string( imolecule );
+                for ( size_t m( 0 ); m != 6; ++m )
+                {
+                    const double phi = ( CONSTANT_PI / 3.0 ) * m + 0.3 * imolecule;
+                    const Vector3D in_plane( std::cos( phi ), std::sin( phi ) * std::cos( tilt ), std::sin( phi ) * std::sin( tilt ) );
+                    result.add_atom( Atom( Element( "C" ), centre + orthogonal_to_fractional * ( 1.39 * in_plane ), "C" + size_t2string( m + 1 ) + suffix ) );
+                    result.add_atom( Atom( Element( "H" ), centre + orthogonal_to_fractional * ( 2.47 * in_plane ), "H" + size_t2string( m + 1 ) + suffix ) );
+                }
+                ++imolecule;
+            }
+        }
+    }
+    result.apply_space_group_symmetry();
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< BenchmarkResult > run_benchmarks( const size_t nrepetitions, const size_t nwarmups )
+{
+    std::vector< BenchmarkResult > results;
+    std::vector< size_t > nmolecules_per_axis;
+    nmolecules_per_axis.push_back( 1 );
+    nmolecules_per_axis.push_back( 2 );
+    nmolecules_per_axis.push_back( 3 );
+    for ( size_t s( 0 ); s != nmolecules_per_axis.size(); ++s )
+    {
+        const CrystalStructure crystal_structure = synthetic_molecular_crystal( nmolecules_per_axis[s] );
+        const size_t natoms = crystal_structure.natoms();
+        {
+        PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+        print( run_benchmark( "calculate_reflection_list( natoms )", natoms, [&]() { powder_pattern_calculator.calculate_reflection_list(); }, nrepetitions, nwarmups ), results );
+        print( run_benchmark( "calculate_structure_factors( natoms )", natoms, [&]() { powder_pattern_calculator.calculate_structure_factors(); }, nrepetitions, nwarmups ), results );
+        }
+        print( run_benchmark( "perceive_molecules( natoms )", natoms, [&]() { CrystalStructure copy( crystal_structure ); copy.perceive_molecules(); benchmark_sink = benchmark_sink + copy.nmolecules(); }, nrepetitions, nwarmups ), results );
+        print( run_benchmark( "find_voids( natoms )", natoms, [&]() { benchmark_sink = benchmark_sink + find_voids( crystal_structure ); }, nrepetitions, nwarmups ), results );
+        const FileName file_name( "benchmark_" + size_t2string( natoms ) + ".cif" );
+        crystal_structure.save_cif( file_name );
+        print( run_benchmark( "read_cif( natoms )", natoms, [&]() { CrystalStructure read; read_cif( file_name, read ); benchmark_sink = benchmark_sink + read.natoms(); }, nrepetitions, nwarmups ), results );
+        std::remove( file_name.full_name().c_str() );
+    }
+    {
+    const CrystalLattice crystal_lattice( 7.3, 9.1, 11.2, Angle::from_degrees( 81.0 ), Angle::from_degrees( 97.0 ), Angle::from_degrees( 103.0 ) );
+    RandomNumberGenerator_double random_number_generator;
+    for ( size_t npairs( 10000 ); npairs <= 1000000; npairs *= 10 )
+    {
+        std::vector< Vector3D > points;
+        points.reserve( 2 * npairs );
+        for ( size_t i( 0 ); i != 2 * npairs; ++i )
+            points.push_back( Vector3D( 3.0 * random_number_generator.next_number() - 1.0, 3.0 * random_number_generator.next_number() - 1.0, 3.0 * random_number_generator.next_number() - 1.0 ) );
+        print( run_benchmark( "shortest_distance2( npairs )", npairs, [&]()
+        {
+            double sum( 0.0 );
+            for ( size_t i( 0 ); i != npairs; ++i )
+                sum += crystal_lattice.shortest_distance2( points[ 2 * i ], points[ 2 * i + 1 ] );
+            benchmark_sink = benchmark_sink + sum;
+        }, nrepetitions, nwarmups ), results );
+    }
+    }
+    for ( size_t npoints( 1000 ); npoints <= 16000; npoints *= 4 )
+    {
+        const PowderPattern lhs = synthetic_powder_pattern( npoints, 0.0 );
+        const PowderPattern rhs = synthetic_powder_pattern( npoints, 3.0 );
+        print( run_benchmark( "weighted_cross_correlation( npoints )", npoints, [&]() { benchmark_sink = benchmark_sink + weighted_cross_correlation( lhs, rhs ); }, nrepetitions, nwarmups ), results );
+    }
+    {
+    // Coordinates with ESDs as found in a .cif file, e.g. "0.26115(23)"
+    const size_t nnumbers( 100000 );
+    std::vector< std::string > numbers;
+    numbers.reserve( nnumbers );
+    for ( size_t i( 0 ); i != nnumbers; ++i )
+        numbers.push_back( double2string( ( i % 9973 ) / 9973.0, 5 ) + "(" + size_t2string( 1 + i % 37 ) + ")" );
+    print( run_benchmark( "parse_number( nnumbers )", nnumbers, [&]()
+    {
+        for ( size_t i( 0 ); i != nnumbers; ++i )
+            benchmark_sink = benchmark_sink + parse_number( numbers[i] ).estimated_standard_deviation_;
+    }, nrepetitions, nwarmups ), results );
+    }
+    {
+    const std::vector< Sudoku > sudokus = benchmark_sudokus();
+    print( run_benchmark( "SudokuSolver solve( nsudokus )", sudokus.size(), [&]()
+    {
+        for ( size_t i( 0 ); i != sudokus.size(); ++i )
+            benchmark_sink = benchmark_sink + Sudoku2string( solve( sudokus[i] ) ).size();
+    }, nrepetitions, nwarmups ), results );
+    }
+    return results;
+}
+
+// ********************************************************************************
+
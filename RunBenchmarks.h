@@ -0,0 +1,52 @@
+#ifndef RUNBENCHMARKS_H
+#define RUNBENCHMARKS_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+
+#include "Benchmark.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+// n x n x n benzene molecules (12 atoms each) in a monoclinic P1 cell of about 7 x 7 x 7 n^3 Angstrom^3,
+// each molecule rotated differently. Space-group symmetry has been applied (trivially, P1), so it can be passed to find_voids().
+CrystalStructure synthetic_molecular_crystal( const size_t nmolecules_per_axis );
+
+/*
+  The benchmark suite: the powder-pattern calculation, the cross-correlation, the distance and molecule perception,
+  the voids, the cif reader, number parsing and the Sudoku solver, each on synthetic inputs at several problem sizes.
+  One line per benchmark is printed as it finishes.
+  Run with "make benchmarks" and "./FourierBenchmarks [nrepetitions] [output.json]".
+*/
+std::vector< BenchmarkResult > run_benchmarks( const size_t nrepetitions = 10, const size_t nwarmups = 2 );
+
+#endif // RUNBENCHMARKS_H
+
@@ -28,34 +28,217 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //#include "TestMath.h"
 #include "TestSuite.h"
 #include "RunTests.h"
+#include "ParallelFor.h"
+#include "Sort.h"
 
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <stdexcept>
 
-void run_tests()
+namespace
 {
-    TestSuite test_suite;
-    try
+
+struct RegisteredTest
+{
+    const char * name_;
+    void (* function_)( TestSuite & );
+};
+
+// In the order in which they are run, the name is the name of the function without "test_".
+const RegisteredTest registered_tests[] =
+{
+    { "analyse_rings", test_analyse_rings },
+    { "angle", test_angle },
+    { "async_file_IO", test_async_file_IO },
+    { "autoindexing", test_autoindexing },
+    { "benchmark", test_benchmark },
+    { "bond_graph", test_bond_graph },
+    { "bounded_queue", test_bounded_queue },
+    { "CalculateBFDH", test_CalculateBFDH },
+    { "Chebyshev_background", test_Chebyshev_background },
+    { "cell_list", test_cell_list },
+    { "checkpoint", test_checkpoint },
+    { "chemical_formula", test_chemical_formula },
+    { "clustering", test_clustering },
+    { "contact_analysis", test_contact_analysis },
+    { "ConvexPolygon", test_ConvexPolygon },
+    { "compression", test_compression },
+    { "copy_text_file", test_copy_text_file },
+    { "correlation_matrix", test_correlation_matrix },
+    { "crystal_lattice", test_crystal_lattice },
+    { "crystal_structure", test_crystal_structure },
+    { "direct_space_solver", test_direct_space_solver },
+    { "duplicate_finder", test_duplicate_finder },
+    { "element", test_element },
+    { "Ewald_summation", test_Ewald_summation },
+    { "fraction", test_fraction },
+    { "file_list", test_file_list },
+    { "file_name", test_file_name },
+    { "flexible_molecule", test_flexible_molecule },
+    { "Fourier_library", test_Fourier_library },
+    { "instrumentation", test_instrumentation },
+    { "integer_symmetry_operator", test_integer_symmetry_operator },
+    { "kernel_verification", test_kernel_verification },
+    { "labels_and_shieldings", test_labels_and_shieldings },
+    { "lattice_index", test_lattice_index },
+    { "lattice_parameters", test_lattice_parameters },
+    { "logger", test_logger },
+    { "matrix3D", test_matrix3D },
+    { "molecular_surface", test_molecular_surface },
+    { "ModelBuilding", test_ModelBuilding },
+    { "OneSudokuSquare", test_OneSudokuSquare },
+    { "Niggli_reduction", test_Niggli_reduction },
+    { "noise_generator", test_noise_generator },
+    { "math_kernels", test_math_kernels },
+    { "packed_crystal_structure", test_packed_crystal_structure },
+    { "pair_distribution_function", test_pair_distribution_function },
+    { "peak_search", test_peak_search },
+    { "peak_shape_function", test_peak_shape_function },
+    { "powder_match_table", test_powder_match_table },
+    { "powder_pattern", test_powder_pattern },
+    { "powder_pattern_cache", test_powder_pattern_cache },
+    { "powder_pattern_calculator", test_powder_pattern_calculator },
+    { "powder_pattern_comparator", test_powder_pattern_comparator },
+    { "powder_pattern_derivatives", test_powder_pattern_derivatives },
+    { "powder_pattern_index", test_powder_pattern_index },
+    { "powder_pattern_mixer", test_powder_pattern_mixer },
+    { "powder_pattern_series", test_powder_pattern_series },
+    { "powder_pattern_server", test_powder_pattern_server },
+    { "screening_pipeline", test_screening_pipeline },
+    { "similarity_analysis", test_similarity_analysis },
+    { "quaternion", test_quaternion },
+    { "random_number_generator", test_random_number_generator },
+    { "RandomQuaternionGenerator", test_RandomQuaternionGenerator },
+    { "read_cif", test_read_cif },
+    { "ReadXSD", test_ReadXSD },
+    { "read_xyz", test_read_xyz },
+    { "refcode_family_index", test_refcode_family_index },
+    { "reflection_list", test_reflection_list },
+    { "reproducible_sum", test_reproducible_sum },
+    { "results_container", test_results_container },
+    { "running_average_and_ESD", test_running_average_and_ESD },
+    { "running_covariance", test_running_covariance },
+    { "scratch_arena", test_scratch_arena },
+    { "simulated_powder_pattern_generator", test_simulated_powder_pattern_generator },
+    { "single_crystal_data", test_single_crystal_data },
+    { "small_vector", test_small_vector },
+    { "space_group", test_space_group },
+    { "space_group_determination", test_space_group_determination },
+    { "sparse_jacobian", test_sparse_jacobian },
+    { "Stack", test_Stack },
+    { "structure_descriptors", test_structure_descriptors },
+    { "sort", test_sort },
+    { "TOPAS", test_TOPAS },
+    { "Triangle", test_Triangle },
+    { "TriangularPyramid", test_TriangularPyramid },
+    { "Histogram", test_Histogram },
+    { "DrunkardsWalk", test_DrunkardsWalk },
+    { "SkipBoTournament", test_SkipBoTournament },
+    { "BagOfNumbers", test_BagOfNumbers },
+    { "SetOfNumbers", test_SetOfNumbers },
+    { "GenerateCombinations", test_GenerateCombinations },
+    { "SudokuSolver", test_SudokuSolver },
+    { "symmetry_operator", test_symmetry_operator },
+    { "symmetry_orbits", test_symmetry_orbits },
+    { "utilities", test_utilities },
+    { "variable_cell_match", test_variable_cell_match },
+    { "VoidsFinder", test_VoidsFinder },
+    { "whole_pattern_decomposition", test_whole_pattern_decomposition },
+    { "XML_pull_parser", test_XML_pull_parser },
+    { "3D_calculations", test_3D_calculations },
+    { "text_file_reader_2", test_text_file_reader_2 },
+    { "thread_pool", test_thread_pool },
+    { "time_correlation", test_time_correlation },
+    { "TLS_ADPs", test_TLS_ADPs },
+    { "TLS_fit", test_TLS_fit },
+    { "trajectory_RMSCD", test_trajectory_RMSCD },
+    { "trajectory_source", test_trajectory_source }
+};
+
+const size_t nregistered_tests = sizeof( registered_tests ) / sizeof( registered_tests[0] );
+
+bool is_selected( const std::string & name, const std::vector< std::string > & selection )
+{
+    if ( selection.empty() )
+        return true;
+    for ( size_t i( 0 ); i != selection.size(); ++i )
     {
-        test_angle( test_suite );
-        test_Chebyshev_background( test_suite );
-        test_correlation_matrix( test_suite );
-        test_crystal_lattice( test_suite );
-        test_crystal_structure( test_suite );
-        test_fraction( test_suite );
-        test_file_name( test_suite );
-        test_matrix3D( test_suite );
-        test_quaternion( test_suite );
-        test_sort( test_suite );
-        test_utilities( test_suite );
-        test_3D_calculations( test_suite );
-        test_TLS_ADPs( test_suite );
+        if ( name.find( selection[i] ) != std::string::npos )
+            return true;
     }
-    catch ( std::exception& e )
+    return false;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+std::vector< std::string > test_names()
+{
+    std::vector< std::string > result;
+    result.reserve( nregistered_tests );
+    for ( size_t i( 0 ); i != nregistered_tests; ++i )
+        result.push_back( registered_tests[i].name_ );
+    return result;
+}
+
+// ********************************************************************************
+
+size_t run_tests( const TestRunnerOptions & options )
+{
+    std::vector< size_t > selected;
+    for ( size_t i( 0 ); i != nregistered_tests; ++i )
     {
-        std::cout << "An exception was thrown" << std::endl;
-        std::cout << e.what() << std::endl;
+        if ( is_selected( registered_tests[i].name_, options.selection_ ) )
+            selected.push_back( i );
     }
+    if ( selected.empty() )
+        throw std::runtime_error( "run_tests(): no test matches the selection." );
+    // One TestSuite per test, so that tests on different threads do not share anything; the errors are reported in the order of the tests.
+    std::vector< TestSuite > test_suites( selected.size() );
+    std::vector< double > timings( selected.size(), 0.0 );
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    parallel_for( selected.size(), options.nthreads_, [&]( const size_t i )
+    {
+        const RegisteredTest & registered_test = registered_tests[ selected[i] ];
+        test_suites[i].set_check_timings( options.check_timings_ );
+        const std::chrono::steady_clock::time_point test_start = std::chrono::steady_clock::now();
+        try
+        {
+            registered_test.function_( test_suites[i] );
+        }
+        catch ( std::exception & e )
+        {
+            test_suites[i].log_error( std::string( "test_" ) + registered_test.name_ + "(): an exception was thrown: " + e.what() );
+        }
+        timings[i] = std::chrono::duration< double >( std::chrono::steady_clock::now() - test_start ).count();
+    } );
+    const double total_time = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    TestSuite test_suite;
+    for ( size_t i( 0 ); i != test_suites.size(); ++i )
+        test_suite.append( test_suites[i] );
     test_suite.report();
+    if ( options.nslowest_ != 0 )
+    {
+        const std::vector< size_t > sorted_map = argsort< true >( timings );
+        char line[ 256 ];
+        std::snprintf( line, sizeof( line ), "Slowest tests (%zu tests, %.3f s wall time):", selected.size(), total_time );
+        std::cout << line << std::endl;
+        for ( size_t i( 0 ); ( i != sorted_map.size() ) && ( i != options.nslowest_ ); ++i )
+        {
+            std::snprintf( line, sizeof( line ), "%10.3f s  %s", timings[ sorted_map[i] ], registered_tests[ selected[ sorted_map[i] ] ].name_ );
+            std::cout << line << std::endl;
+        }
+    }
     std::cout << "Test suite done" << std::endl;
+    return test_suite.nerrors();
+}
+
+// ********************************************************************************
+
+void run_tests()
+{
+    run_tests( TestRunnerOptions() );
 }
 
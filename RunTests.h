@@ -30,20 +30,141 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 class TestSuite;
 
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+void test_analyse_rings( TestSuite & test_suite );
 void test_angle( TestSuite & test_suite );
+void test_async_file_IO( TestSuite & test_suite );
+void test_autoindexing( TestSuite & test_suite );
+void test_benchmark( TestSuite & test_suite );
+void test_bond_graph( TestSuite & test_suite );
+void test_bounded_queue( TestSuite & test_suite );
+void test_CalculateBFDH( TestSuite & test_suite );
 void test_Chebyshev_background( TestSuite & test_suite );
+void test_cell_list( TestSuite & test_suite );
+void test_checkpoint( TestSuite & test_suite );
+void test_chemical_formula( TestSuite & test_suite );
+void test_clustering( TestSuite & test_suite );
+void test_contact_analysis( TestSuite & test_suite );
+void test_ConvexPolygon( TestSuite & test_suite );
+void test_compression( TestSuite & test_suite );
+void test_copy_text_file( TestSuite & test_suite );
 void test_correlation_matrix( TestSuite & test_suite );
 void test_crystal_lattice( TestSuite & test_suite );
 void test_crystal_structure( TestSuite & test_suite );
+void test_direct_space_solver( TestSuite & test_suite );
+void test_duplicate_finder( TestSuite & test_suite );
+void test_element( TestSuite & test_suite );
+void test_Ewald_summation( TestSuite & test_suite );
+void test_file_list( TestSuite & test_suite );
 void test_file_name( TestSuite & test_suite );
+void test_flexible_molecule( TestSuite & test_suite );
+void test_Fourier_library( TestSuite & test_suite );
+void test_instrumentation( TestSuite & test_suite );
 void test_fraction( TestSuite & test_suite );
+void test_integer_symmetry_operator( TestSuite & test_suite );
+void test_kernel_verification( TestSuite & test_suite );
+void test_labels_and_shieldings( TestSuite & test_suite );
+void test_lattice_index( TestSuite & test_suite );
+void test_lattice_parameters( TestSuite & test_suite );
+void test_logger( TestSuite & test_suite );
 void test_matrix3D( TestSuite & test_suite );
+void test_molecular_surface( TestSuite & test_suite );
+void test_ModelBuilding( TestSuite & test_suite );
+void test_OneSudokuSquare( TestSuite & test_suite );
+void test_Niggli_reduction( TestSuite & test_suite );
+void test_noise_generator( TestSuite & test_suite );
+void test_math_kernels( TestSuite & test_suite );
+void test_packed_crystal_structure( TestSuite & test_suite );
+void test_pair_distribution_function( TestSuite & test_suite );
+void test_peak_search( TestSuite & test_suite );
+void test_peak_shape_function( TestSuite & test_suite );
+void test_powder_match_table( TestSuite & test_suite );
+void test_powder_pattern( TestSuite & test_suite );
+void test_powder_pattern_cache( TestSuite & test_suite );
+void test_powder_pattern_calculator( TestSuite & test_suite );
+void test_powder_pattern_comparator( TestSuite & test_suite );
+void test_powder_pattern_derivatives( TestSuite & test_suite );
+void test_powder_pattern_index( TestSuite & test_suite );
+void test_powder_pattern_mixer( TestSuite & test_suite );
+void test_powder_pattern_series( TestSuite & test_suite );
+void test_powder_pattern_server( TestSuite & test_suite );
+void test_screening_pipeline( TestSuite & test_suite );
+void test_similarity_analysis( TestSuite & test_suite );
 void test_quaternion( TestSuite & test_suite );
+void test_random_number_generator( TestSuite & test_suite );
+void test_RandomQuaternionGenerator( TestSuite & test_suite );
+void test_read_cif( TestSuite & test_suite );
+void test_ReadXSD( TestSuite & test_suite );
+void test_read_xyz( TestSuite & test_suite );
+void test_refcode_family_index( TestSuite & test_suite );
+void test_reflection_list( TestSuite & test_suite );
+void test_reproducible_sum( TestSuite & test_suite );
+void test_results_container( TestSuite & test_suite );
+void test_running_average_and_ESD( TestSuite & test_suite );
+void test_running_covariance( TestSuite & test_suite );
+void test_scratch_arena( TestSuite & test_suite );
+void test_simulated_powder_pattern_generator( TestSuite & test_suite );
+void test_single_crystal_data( TestSuite & test_suite );
+void test_small_vector( TestSuite & test_suite );
+void test_space_group( TestSuite & test_suite );
+void test_space_group_determination( TestSuite & test_suite );
+void test_sparse_jacobian( TestSuite & test_suite );
+void test_Stack( TestSuite & test_suite );
+void test_structure_descriptors( TestSuite & test_suite );
 void test_sort( TestSuite & test_suite );
+void test_TOPAS( TestSuite & test_suite );
+void test_Triangle( TestSuite & test_suite );
+void test_TriangularPyramid( TestSuite & test_suite );
+void test_Histogram( TestSuite & test_suite );
+void test_DrunkardsWalk( TestSuite & test_suite );
+void test_SkipBoTournament( TestSuite & test_suite );
+void test_BagOfNumbers( TestSuite & test_suite );
+void test_SetOfNumbers( TestSuite & test_suite );
+void test_GenerateCombinations( TestSuite & test_suite );
+void test_SudokuSolver( TestSuite & test_suite );
+void test_symmetry_operator( TestSuite & test_suite );
+void test_symmetry_orbits( TestSuite & test_suite );
 void test_utilities( TestSuite & test_suite );
+void test_variable_cell_match( TestSuite & test_suite );
+void test_VoidsFinder( TestSuite & test_suite );
+void test_whole_pattern_decomposition( TestSuite & test_suite );
+void test_XML_pull_parser( TestSuite & test_suite );
 void test_3D_calculations( TestSuite & test_suite );
+void test_text_file_reader_2( TestSuite & test_suite );
+void test_thread_pool( TestSuite & test_suite );
+void test_time_correlation( TestSuite & test_suite );
 void test_TLS_ADPs( TestSuite & test_suite );
+void test_TLS_fit( TestSuite & test_suite );
+void test_trajectory_RMSCD( TestSuite & test_suite );
+void test_trajectory_source( TestSuite & test_suite );
+
+struct TestRunnerOptions
+{
+    TestRunnerOptions(): nthreads_(1), nslowest_(0), check_timings_(true) {}
+
+    // The test functions are run on this many threads (0 means one per core).
+    // With more than one thread, their "Now running tests for" lines can appear in any order, the errors are still reported in the
+    // order of the tests. Tests that write files with the same name must then not be selected together.
+    size_t nthreads_;
+    // If not 0, the wall times of the nslowest_ slowest tests are printed.
+    size_t nslowest_;
+    // The performance assertions, TestSuite::test_timing(), are skipped if false.
+    bool check_timings_;
+    // Only the tests whose name contains one of these strings are run, all tests if empty.
+    std::vector< std::string > selection_;
+};
+
+// The names by which tests can be selected, in the order in which they are run.
+std::vector< std::string > test_names();
+
+// Returns the number of errors. Throws if no test matches the selection.
+// An exception thrown by a test is reported as an error for that test, the other tests still run.
+size_t run_tests( const TestRunnerOptions & options );
 
+// All tests, one at a time.
 void run_tests();
 
 #endif // RUNTESTS_H
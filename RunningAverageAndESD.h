@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "Angle.h"
+#include "Checkpoint.h"
 #include "MathFunctions.h"
 #include "Vector3D.h"
 
@@ -85,6 +86,41 @@ public:
             add_value( *it );
     }
 
+    // For a contiguous array. The batch is accumulated separately with two independent passes, which the compiler
+    // can vectorise, and then merged, so the result can differ from calling add_value() in the last few digits.
+    void add_values( const T * values, const size_t nvalues )
+    {
+        if ( nvalues == 0 )
+            return;
+        T sum( 0.0 );
+        for ( size_t i( 0 ); i != nvalues; ++i )
+            sum = sum + values[i];
+        RunningAverageAndESD batch;
+        batch.n_ = nvalues;
+        batch.A_ = sum / static_cast<double>( nvalues );
+        for ( size_t i( 0 ); i != nvalues; ++i )
+            batch.Q_ = batch.Q_ + square( values[i] - batch.A_ );
+        merge( batch );
+    }
+
+    // Afterwards, *this is as if all values that were added to rhs had also been added to *this (Chan et al.).
+    // Allows partial results from different threads to be combined.
+    void merge( const RunningAverageAndESD & rhs )
+    {
+        if ( rhs.n_ == 0 )
+            return;
+        if ( n_ == 0 )
+        {
+            *this = rhs;
+            return;
+        }
+        const size_t n = n_ + rhs.n_;
+        const T delta = rhs.A_ - A_;
+        Q_ = Q_ + rhs.Q_ + ( ( static_cast<double>( n_ ) * static_cast<double>( rhs.n_ ) ) / n ) * square( delta );
+        A_ = A_ + ( static_cast<double>( rhs.n_ ) / n ) * delta;
+        n_ = n;
+    }
+
     // Throws std::runtime_error if no values have been added.
     T average() const
     {
@@ -108,6 +144,21 @@ public:
 
     size_t nvalues() const { return n_; }
 
+    // The state, for a checkpoint of a long calculation.
+    void save( CheckpointWriter & checkpoint_writer ) const
+    {
+        checkpoint_writer.write( A_ );
+        checkpoint_writer.write( Q_ );
+        checkpoint_writer.write( n_ );
+    }
+
+    void load( CheckpointReader & checkpoint_reader )
+    {
+        checkpoint_reader.read( A_ );
+        checkpoint_reader.read( Q_ );
+        checkpoint_reader.read( n_ );
+    }
+
 private:
     T A_;
     T Q_;
@@ -145,6 +196,29 @@ public:
             add_value( *it );
     }
 
+    void add_values( const Angle * values, const size_t nvalues )
+    {
+        for ( size_t i( 0 ); i != nvalues; ++i )
+            add_value( values[i] );
+    }
+
+    // Afterwards, *this is as if all values that were added to rhs had also been added to *this (Chan et al.).
+    void merge( const RunningAverageAndESD & rhs )
+    {
+        if ( rhs.n_ == 0 )
+            return;
+        if ( n_ == 0 )
+        {
+            *this = rhs;
+            return;
+        }
+        const size_t n = n_ + rhs.n_;
+        const double delta = ( rhs.A_ - A_ ).value_in_radians();
+        Q_ = Q_ + rhs.Q_ + Angle::from_radians( ( ( static_cast<double>( n_ ) * static_cast<double>( rhs.n_ ) ) / n ) * delta * delta );
+        A_ = A_ + Angle::from_radians( ( static_cast<double>( rhs.n_ ) / n ) * delta );
+        n_ = n;
+    }
+
     // Throws std::runtime_error if no values have been added.
     Angle average() const
     {
@@ -168,6 +242,21 @@ public:
 
     size_t nvalues() const { return n_; }
 
+    // The state, for a checkpoint of a long calculation.
+    void save( CheckpointWriter & checkpoint_writer ) const
+    {
+        checkpoint_writer.write( A_ );
+        checkpoint_writer.write( Q_ );
+        checkpoint_writer.write( n_ );
+    }
+
+    void load( CheckpointReader & checkpoint_reader )
+    {
+        checkpoint_reader.read( A_ );
+        checkpoint_reader.read( Q_ );
+        checkpoint_reader.read( n_ );
+    }
+
 private:
     Angle A_;
     Angle Q_;
@@ -205,6 +294,41 @@ public:
             add_value( *it );
     }
 
+    // For a contiguous array. The batch is accumulated separately with two independent passes, which the compiler
+    // can vectorise, and then merged, so the result can differ from calling add_value() in the last few digits.
+    void add_values( const Vector3D * values, const size_t nvalues )
+    {
+        if ( nvalues == 0 )
+            return;
+        Vector3D sum;
+        for ( size_t i( 0 ); i != nvalues; ++i )
+            sum = sum + values[i];
+        RunningAverageAndESD batch;
+        batch.n_ = nvalues;
+        batch.A_ = sum / static_cast<double>( nvalues );
+        for ( size_t i( 0 ); i != nvalues; ++i )
+            batch.Q_ = batch.Q_ + square( values[i] - batch.A_ );
+        merge( batch );
+    }
+
+    // Afterwards, *this is as if all values that were added to rhs had also been added to *this (Chan et al.).
+    // Allows partial results from different threads to be combined.
+    void merge( const RunningAverageAndESD & rhs )
+    {
+        if ( rhs.n_ == 0 )
+            return;
+        if ( n_ == 0 )
+        {
+            *this = rhs;
+            return;
+        }
+        const size_t n = n_ + rhs.n_;
+        const Vector3D delta = rhs.A_ - A_;
+        Q_ = Q_ + rhs.Q_ + ( ( static_cast<double>( n_ ) * static_cast<double>( rhs.n_ ) ) / n ) * square( delta );
+        A_ = A_ + ( static_cast<double>( rhs.n_ ) / n ) * delta;
+        n_ = n;
+    }
+
     // Throws std::runtime_error if no values have been added.
     Vector3D average() const
     {
@@ -228,6 +352,21 @@ public:
 
     size_t nvalues() const { return n_; }
 
+    // The state, for a checkpoint of a long calculation.
+    void save( CheckpointWriter & checkpoint_writer ) const
+    {
+        checkpoint_writer.write( A_ );
+        checkpoint_writer.write( Q_ );
+        checkpoint_writer.write( n_ );
+    }
+
+    void load( CheckpointReader & checkpoint_reader )
+    {
+        checkpoint_reader.read( A_ );
+        checkpoint_reader.read( Q_ );
+        checkpoint_reader.read( n_ );
+    }
+
 private:
     Vector3D A_;
     Vector3D Q_;
@@ -235,5 +374,133 @@ private:
 
 };
 
+/*
+  A fixed number of RunningAverageAndESD< Vector3D >, e.g. one for each atom in a trajectory, stored as a structure of arrays
+  so that adding one frame is a loop over contiguous doubles.
+  Every accumulator always contains the same number of values.
+  The results are identical to those of a std::vector< RunningAverageAndESD< Vector3D > > to which the same values are added in the same order.
+*/
+class RunningAverageAndESDArray
+{
+public:
+
+    RunningAverageAndESDArray() : size_(0), n_(0) {}
+
+    explicit RunningAverageAndESDArray( const size_t size ) : size_(size), n_(0)
+    {
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            A_[k] = std::vector< double >( size_, 0.0 );
+            Q_[k] = std::vector< double >( size_, 0.0 );
+        }
+    }
+
+    size_t size() const { return size_; }
+
+    // values must contain size() * multiplicity values, multiplicity consecutive values for each accumulator.
+    void add_values( const std::vector< Vector3D > & values, const size_t multiplicity = 1 )
+    {
+        if ( values.size() != size_ * multiplicity )
+            throw std::runtime_error( "RunningAverageAndESDArray::add_values(): wrong number of values." );
+        for ( size_t j( 0 ); j != multiplicity; ++j )
+        {
+            ++n_;
+            const double weight = static_cast<double>( n_-1 ) / n_;
+            for ( size_t k( 0 ); k != 3; ++k )
+            {
+                double * A = A_[k].empty() ? 0 : &A_[k][0];
+                double * Q = Q_[k].empty() ? 0 : &Q_[k][0];
+                for ( size_t i( 0 ); i != size_; ++i )
+                {
+                    const double difference = values[ i * multiplicity + j ].value( k ) - A[i];
+                    Q[i] = Q[i] + weight * ( difference * difference );
+                    A[i] = A[i] + ( difference / n_ );
+                }
+            }
+        }
+    }
+
+    // Afterwards, *this is as if all values that were added to rhs had also been added to *this (Chan et al.).
+    void merge( const RunningAverageAndESDArray & rhs )
+    {
+        if ( rhs.size_ != size_ )
+            throw std::runtime_error( "RunningAverageAndESDArray::merge(): sizes are different." );
+        if ( rhs.n_ == 0 )
+            return;
+        if ( n_ == 0 )
+        {
+            *this = rhs;
+            return;
+        }
+        const size_t n = n_ + rhs.n_;
+        const double weight_Q = ( static_cast<double>( n_ ) * static_cast<double>( rhs.n_ ) ) / n;
+        const double weight_A = static_cast<double>( rhs.n_ ) / n;
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            for ( size_t i( 0 ); i != size_; ++i )
+            {
+                const double delta = rhs.A_[k][i] - A_[k][i];
+                Q_[k][i] = Q_[k][i] + rhs.Q_[k][i] + weight_Q * ( delta * delta );
+                A_[k][i] = A_[k][i] + weight_A * delta;
+            }
+        }
+        n_ = n;
+    }
+
+    // Throws std::runtime_error if no values have been added.
+    Vector3D average( const size_t i ) const
+    {
+        if ( n_ == 0 )
+            throw std::runtime_error( "RunningAverageAndESDArray::average(): no values added yet." );
+        return Vector3D( A_[0][i], A_[1][i], A_[2][i] );
+    }
+
+    // Returns the estimated standard deviation of the sample (not the population)
+    // i.e. the "n-1" ESD. Throws std::runtime_error if 0 or 1 values have been added.
+    Vector3D estimated_standard_deviation( const size_t i ) const
+    {
+        if ( n_ == 0 )
+            throw std::runtime_error( "RunningAverageAndESDArray::estimated_standard_deviation(): no values added yet." );
+        if ( n_ == 1 )
+            throw std::runtime_error( "RunningAverageAndESDArray::estimated_standard_deviation(): only one value added." );
+        return Vector3D( std::sqrt( Q_[0][i] / (n_-1) ), std::sqrt( Q_[1][i] / (n_-1) ), std::sqrt( Q_[2][i] / (n_-1) ) );
+    }
+
+    // The number of values in each accumulator.
+    size_t nvalues() const { return n_; }
+
+    // The state, for a checkpoint of a long calculation.
+    void save( CheckpointWriter & checkpoint_writer ) const
+    {
+        checkpoint_writer.write( size_ );
+        checkpoint_writer.write( n_ );
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            checkpoint_writer.write( A_[k] );
+            checkpoint_writer.write( Q_[k] );
+        }
+    }
+
+    void load( CheckpointReader & checkpoint_reader )
+    {
+        checkpoint_reader.read( size_ );
+        checkpoint_reader.read( n_ );
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            checkpoint_reader.read( A_[k] );
+            checkpoint_reader.read( Q_[k] );
+            if ( ( A_[k].size() != size_ ) || ( Q_[k].size() != size_ ) )
+                throw std::runtime_error( "RunningAverageAndESDArray::load(): checkpoint is inconsistent." );
+        }
+    }
+
+private:
+    size_t size_;
+    size_t n_;
+    std::vector< double > A_[3];
+    std::vector< double > Q_[3];
+
+};
+
 #endif // RUNNINGAVERAGEANDESD_H
 
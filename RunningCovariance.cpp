@@ -0,0 +1,125 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "RunningCovariance.h"
+#include "Checkpoint.h"
+
+#include <stdexcept>
+
+// ********************************************************************************
+
+RunningCovariance::RunningCovariance(): n_(0), average_(0.0, 0.0, 0.0)
+{
+    for ( size_t i( 0 ); i != 6; ++i )
+        co_moments_[i] = 0.0;
+}
+
+// ********************************************************************************
+
+void RunningCovariance::add_value( const Vector3D & value )
+{
+    ++n_;
+    const Vector3D old_difference = value - average_;
+    average_ += old_difference / static_cast<double>( n_ );
+    const Vector3D new_difference = value - average_;
+    co_moments_[0] += old_difference.x() * new_difference.x();
+    co_moments_[1] += old_difference.y() * new_difference.y();
+    co_moments_[2] += old_difference.z() * new_difference.z();
+    co_moments_[3] += old_difference.x() * new_difference.y();
+    co_moments_[4] += old_difference.x() * new_difference.z();
+    co_moments_[5] += old_difference.y() * new_difference.z();
+}
+
+// ********************************************************************************
+
+void RunningCovariance::merge( const RunningCovariance & rhs )
+{
+    if ( rhs.n_ == 0 )
+        return;
+    if ( n_ == 0 )
+    {
+        *this = rhs;
+        return;
+    }
+    const size_t n = n_ + rhs.n_;
+    const Vector3D delta = rhs.average_ - average_;
+    const double weight = ( static_cast<double>( n_ ) * static_cast<double>( rhs.n_ ) ) / n;
+    co_moments_[0] += rhs.co_moments_[0] + weight * delta.x() * delta.x();
+    co_moments_[1] += rhs.co_moments_[1] + weight * delta.y() * delta.y();
+    co_moments_[2] += rhs.co_moments_[2] + weight * delta.z() * delta.z();
+    co_moments_[3] += rhs.co_moments_[3] + weight * delta.x() * delta.y();
+    co_moments_[4] += rhs.co_moments_[4] + weight * delta.x() * delta.z();
+    co_moments_[5] += rhs.co_moments_[5] + weight * delta.y() * delta.z();
+    average_ += ( static_cast<double>( rhs.n_ ) / n ) * delta;
+    n_ = n;
+}
+
+// ********************************************************************************
+
+Vector3D RunningCovariance::average() const
+{
+    if ( n_ == 0 )
+        throw std::runtime_error( "RunningCovariance::average(): no values added yet." );
+    return average_;
+}
+
+// ********************************************************************************
+
+SymmetricMatrix3D RunningCovariance::covariance_matrix() const
+{
+    if ( n_ == 0 )
+        throw std::runtime_error( "RunningCovariance::covariance_matrix(): no values added yet." );
+    const double factor = 1.0 / static_cast<double>( n_ );
+    return SymmetricMatrix3D( factor * co_moments_[0], factor * co_moments_[1], factor * co_moments_[2],
+                              factor * co_moments_[3], factor * co_moments_[4], factor * co_moments_[5] );
+}
+
+// ********************************************************************************
+
+// ********************************************************************************
+
+void RunningCovariance::save( CheckpointWriter & checkpoint_writer ) const
+{
+    checkpoint_writer.write( n_ );
+    checkpoint_writer.write( average_ );
+    for ( size_t i( 0 ); i != 6; ++i )
+        checkpoint_writer.write( co_moments_[i] );
+}
+
+// ********************************************************************************
+
+void RunningCovariance::load( CheckpointReader & checkpoint_reader )
+{
+    checkpoint_reader.read( n_ );
+    checkpoint_reader.read( average_ );
+    for ( size_t i( 0 ); i != 6; ++i )
+        checkpoint_reader.read( co_moments_[i] );
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,74 @@
+#ifndef RUNNINGCOVARIANCE_H
+#define RUNNINGCOVARIANCE_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CheckpointReader;
+class CheckpointWriter;
+
+#include "SymmetricMatrix3D.h"
+#include "Vector3D.h"
+
+#include <cstddef> // For definition of size_t
+
+/*
+  A running average and covariance matrix of a series of 3D points, i.e. the same as average() and covariance_matrix()
+  from 3DCalculations.h but without having to store the points.
+  
+  Uses Welford's algorithm to reduce rounding errors.
+*/
+class RunningCovariance
+{
+public:
+
+    RunningCovariance();
+
+    void add_value( const Vector3D & value );
+
+    // Afterwards, *this is as if all values that were added to rhs had also been added to *this (Chan et al.).
+    void merge( const RunningCovariance & rhs );
+
+    // Throws std::runtime_error if no values have been added.
+    Vector3D average() const;
+
+    // Divided by n, not n-1, like covariance_matrix(). Throws std::runtime_error if no values have been added.
+    SymmetricMatrix3D covariance_matrix() const;
+
+    size_t nvalues() const { return n_; }
+
+    // The state, for a checkpoint of a long calculation.
+    void save( CheckpointWriter & checkpoint_writer ) const;
+    void load( CheckpointReader & checkpoint_reader );
+
+private:
+    size_t n_;
+    Vector3D average_;
+    double co_moments_[6]; // Sum of products of deviations, same order as u11 etc. in .cif file
+};
+
+#endif // RUNNINGCOVARIANCE_H
@@ -0,0 +1,93 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ScratchArena.h"
+
+#include <memory>
+
+namespace
+{
+
+// Created on first use on each thread, lives until the thread ends.
+class ThreadArena
+{
+public:
+    ThreadArena():
+    block_( new char[ scratch_arena_block_size ] ),
+    resource_( block_.get(), scratch_arena_block_size, std::pmr::new_delete_resource() )
+    {
+    }
+
+    std::pmr::memory_resource * resource() { return &resource_; }
+
+    void release() { resource_.release(); }
+
+private:
+    std::unique_ptr< char[] > block_;
+    std::pmr::monotonic_buffer_resource resource_;
+};
+
+ThreadArena & thread_arena()
+{
+    thread_local ThreadArena arena;
+    return arena;
+}
+
+thread_local std::pmr::memory_resource * current_scratch_resource = nullptr;
+
+} // namespace
+
+// ********************************************************************************
+
+std::pmr::memory_resource * scratch_resource()
+{
+    if ( current_scratch_resource == nullptr )
+        return std::pmr::new_delete_resource();
+    return current_scratch_resource;
+}
+
+// ********************************************************************************
+
+ScratchArenaScope::ScratchArenaScope(): outermost_( current_scratch_resource == nullptr )
+{
+    if ( outermost_ )
+        current_scratch_resource = thread_arena().resource();
+}
+
+// ********************************************************************************
+
+ScratchArenaScope::~ScratchArenaScope()
+{
+    if ( ! outermost_ )
+        return;
+    current_scratch_resource = nullptr;
+    thread_arena().release();
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,85 @@
+#ifndef SCRATCHARENA_H
+#define SCRATCHARENA_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <cstddef> // For definition of size_t
+#include <memory_resource>
+
+/*
+  A per-thread monotonic arena for the short-lived temporaries that are created while one crystal structure is processed
+  (element sets, visited flags, work queues, ...).
+
+  A batch loop puts a ScratchArenaScope around the work for one structure:
+
+      parallel_for( nfiles, nthreads, [&]( const size_t i )
+      {
+          ScratchArenaScope scratch_arena_scope;
+          ...
+      } );
+
+  and the code that is called uses scratch_resource() for its internal pmr containers:
+
+      std::pmr::vector< char > visited( n, 0, scratch_resource() );
+
+  Allocation is then a pointer bump and deallocation a no-op; everything is released in one go when the outermost scope on
+  that thread ends. The first block of the arena is kept, so the next structure on the same thread usually does not call
+  malloc at all. Outside a ScratchArenaScope, scratch_resource() is the ordinary heap, so the same code works unchanged
+  when it is not called from a batch loop.
+
+  Nothing that is allocated from scratch_resource() may outlive the scope, so it must only be used for temporaries that
+  are local to a function, never for member variables or return values. Memory is not reused before the scope ends,
+  so it is also not meant for functions that are called many times per structure, such as
+  CrystalStructure::update_molecules() inside a simulated-annealing loop.
+*/
+
+// The memory resource for temporaries on the current thread: the arena if a ScratchArenaScope is active, the heap otherwise.
+std::pmr::memory_resource * scratch_resource();
+
+class ScratchArenaScope
+{
+public:
+
+    // Scopes can be nested, only the outermost one releases the memory.
+    ScratchArenaScope();
+
+    ~ScratchArenaScope();
+
+    ScratchArenaScope( const ScratchArenaScope & ) = delete;
+    ScratchArenaScope & operator=( const ScratchArenaScope & ) = delete;
+
+private:
+    bool outermost_;
+};
+
+// The size of the block that each thread's arena keeps between structures.
+const size_t scratch_arena_block_size = 256 * 1024;
+
+#endif // SCRATCHARENA_H
+
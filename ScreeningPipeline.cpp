@@ -0,0 +1,341 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ScreeningPipeline.h"
+#include "BoundedQueue.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "ParallelFor.h"
+#include "PowderPatternCache.h"
+#include "PowderPatternCalculator.h"
+#include "ReadCif.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+
+struct StructureItem
+{
+    size_t index_;
+    CrystalStructure crystal_structure_;
+};
+
+struct PatternItem
+{
+    size_t index_;
+    PowderPattern powder_pattern_;
+};
+
+// ********************************************************************************
+
+// The time of one worker, split into busy and waiting, added to the statistics of its stage when the worker finishes.
+class WorkerClock
+{
+public:
+
+    WorkerClock(): nitems_(0), busy_seconds_(0.0), input_wait_seconds_(0.0), output_wait_seconds_(0.0), last_( std::chrono::steady_clock::now() ) {}
+
+    void add_busy() { busy_seconds_ += lap(); }
+    void add_input_wait() { input_wait_seconds_ += lap(); }
+    void add_output_wait() { output_wait_seconds_ += lap(); }
+    void add_item() { ++nitems_; }
+
+    void add_to( PipelineStageStatistics & statistics, std::mutex & mutex ) const
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        statistics.nitems_ += nitems_;
+        statistics.busy_seconds_ += busy_seconds_;
+        statistics.input_wait_seconds_ += input_wait_seconds_;
+        statistics.output_wait_seconds_ += output_wait_seconds_;
+    }
+
+private:
+    size_t nitems_;
+    double busy_seconds_;
+    double input_wait_seconds_;
+    double output_wait_seconds_;
+    std::chrono::steady_clock::time_point last_;
+
+    double lap()
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double result = std::chrono::duration< double >( now - last_ ).count();
+        last_ = now;
+        return result;
+    }
+};
+
+// ********************************************************************************
+
+void store_error_message( std::vector< std::string > & error_messages, const size_t i, const std::exception & e )
+{
+    error_messages[i] = std::string( e.what() );
+    if ( error_messages[i].empty() )
+        error_messages[i] = "Unknown error.";
+}
+
+} // namespace
+
+// ********************************************************************************
+
+std::string PipelineStageStatistics::report() const
+{
+    return pad( name_, 9 ) + " " + size_t2string( nworkers_, 3, ' ' ) + " workers " + size_t2string( nitems_, 7, ' ' ) + " items " +
+           double2string( throughput(), 2, 10 ) + " items/s/worker  busy " + double2string( busy_seconds_, 2, 8 ) +
+           " s  waiting for input " + double2string( input_wait_seconds_, 2, 8 ) + " s  waiting for output " + double2string( output_wait_seconds_, 2, 8 ) + " s";
+}
+
+// ********************************************************************************
+
+ScreeningPipeline::ScreeningPipeline( const PowderPattern & target ):
+target_(target),
+FWHM_(0.1),
+l_( 3.0, Angle::DEGREES ),
+nworkers_( 4 ),
+queue_capacity_(16),
+powder_pattern_cache_(0),
+wall_clock_seconds_(0.0)
+{
+    if ( target_.empty() )
+        throw std::runtime_error( "ScreeningPipeline::ScreeningPipeline(): target pattern is empty." );
+    nworkers_[ READ ] = 2;
+    nworkers_[ SYMMETRY ] = 1;
+    nworkers_[ PATTERN ] = default_nthreads();
+    nworkers_[ COMPARE ] = 1;
+}
+
+// ********************************************************************************
+
+void ScreeningPipeline::set_nworkers( const Stage stage, const size_t nworkers )
+{
+    if ( nworkers == 0 )
+        throw std::runtime_error( "ScreeningPipeline::set_nworkers(): every stage needs at least one worker." );
+    nworkers_[ stage ] = nworkers;
+}
+
+// ********************************************************************************
+
+void ScreeningPipeline::set_queue_capacity( const size_t queue_capacity )
+{
+    if ( queue_capacity == 0 )
+        throw std::runtime_error( "ScreeningPipeline::set_queue_capacity(): capacity must be at least 1." );
+    queue_capacity_ = queue_capacity;
+}
+
+// ********************************************************************************
+
+size_t ScreeningPipeline::run( const FileList & file_list, std::vector< double > & similarities, std::vector< std::string > & error_messages )
+{
+    const size_t nfiles = file_list.size();
+    similarities = std::vector< double >( nfiles, 0.0 );
+    error_messages = std::vector< std::string >( nfiles );
+    const char * names[] = { "read", "symmetry", "pattern", "compare" };
+    statistics_ = std::vector< PipelineStageStatistics >( 4 );
+    for ( size_t s( 0 ); s != 4; ++s )
+    {
+        statistics_[s].name_ = names[s];
+        statistics_[s].nworkers_ = nworkers_[s];
+    }
+    BoundedQueue< StructureItem > read_structures( queue_capacity_ );
+    BoundedQueue< StructureItem > expanded_structures( queue_capacity_ );
+    BoundedQueue< PatternItem > powder_patterns( queue_capacity_ );
+    // The last worker of a stage to finish closes the queue to the next stage.
+    std::atomic< size_t > nactive_workers[3];
+    for ( size_t s( 0 ); s != 3; ++s )
+        nactive_workers[s] = nworkers_[s];
+    std::atomic< size_t > next_file( 0 );
+    std::mutex statistics_mutex;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector< std::thread > threads;
+    for ( size_t t( 0 ); t != nworkers_[ READ ]; ++t )
+    {
+        threads.push_back( std::thread( [&]()
+        {
+            WorkerClock clock;
+            for ( size_t i = next_file++; i < nfiles; i = next_file++ )
+            {
+                StructureItem item;
+                item.index_ = i;
+                try
+                {
+                    read_cif( file_list.value( i ), item.crystal_structure_ );
+                }
+                catch ( std::exception & e )
+                {
+                    store_error_message( error_messages, i, e );
+                    clock.add_busy();
+                    continue;
+                }
+                clock.add_busy();
+                clock.add_item();
+                read_structures.push( std::move( item ) );
+                clock.add_output_wait();
+            }
+            clock.add_to( statistics_[ READ ], statistics_mutex );
+            if ( --nactive_workers[ READ ] == 0 )
+                read_structures.close();
+        } ) );
+    }
+    for ( size_t t( 0 ); t != nworkers_[ SYMMETRY ]; ++t )
+    {
+        threads.push_back( std::thread( [&]()
+        {
+            WorkerClock clock;
+            StructureItem item;
+            while ( read_structures.pop( item ) )
+            {
+                clock.add_input_wait();
+                try
+                {
+                    item.crystal_structure_.apply_space_group_symmetry();
+                }
+                catch ( std::exception & e )
+                {
+                    store_error_message( error_messages, item.index_, e );
+                    clock.add_busy();
+                    continue;
+                }
+                clock.add_busy();
+                clock.add_item();
+                expanded_structures.push( std::move( item ) );
+                clock.add_output_wait();
+            }
+            clock.add_input_wait();
+            clock.add_to( statistics_[ SYMMETRY ], statistics_mutex );
+            if ( --nactive_workers[ SYMMETRY ] == 0 )
+                expanded_structures.close();
+        } ) );
+    }
+    for ( size_t t( 0 ); t != nworkers_[ PATTERN ]; ++t )
+    {
+        threads.push_back( std::thread( [&]()
+        {
+            WorkerClock clock;
+            StructureItem item;
+            while ( expanded_structures.pop( item ) )
+            {
+                clock.add_input_wait();
+                PatternItem pattern_item;
+                pattern_item.index_ = item.index_;
+                try
+                {
+                    PowderPatternCalculator powder_pattern_calculator( item.crystal_structure_ );
+                    powder_pattern_calculator.set_wavelength( target_.wavelength() );
+                    powder_pattern_calculator.set_two_theta_start( target_.two_theta_start() );
+                    powder_pattern_calculator.set_two_theta_end( target_.two_theta_end() );
+                    powder_pattern_calculator.set_two_theta_step( target_.average_two_theta_step() );
+                    powder_pattern_calculator.set_FWHM( FWHM_ );
+                    if ( powder_pattern_cache_ )
+                    {
+                        ReflectionList reflection_list;
+                        powder_pattern_cache_->calculate( item.crystal_structure_, powder_pattern_calculator, pattern_item.powder_pattern_, reflection_list );
+                    }
+                    else
+                        powder_pattern_calculator.calculate( pattern_item.powder_pattern_ );
+                }
+                catch ( std::exception & e )
+                {
+                    store_error_message( error_messages, item.index_, e );
+                    clock.add_busy();
+                    continue;
+                }
+                clock.add_busy();
+                clock.add_item();
+                powder_patterns.push( std::move( pattern_item ) );
+                clock.add_output_wait();
+            }
+            clock.add_input_wait();
+            clock.add_to( statistics_[ PATTERN ], statistics_mutex );
+            if ( --nactive_workers[ PATTERN ] == 0 )
+                powder_patterns.close();
+        } ) );
+    }
+    for ( size_t t( 0 ); t != nworkers_[ COMPARE ]; ++t )
+    {
+        threads.push_back( std::thread( [&]()
+        {
+            WorkerClock clock;
+            PatternItem item;
+            while ( powder_patterns.pop( item ) )
+            {
+                clock.add_input_wait();
+                try
+                {
+                    similarities[ item.index_ ] = normalised_weighted_cross_correlation( target_, item.powder_pattern_, l_ );
+                    clock.add_item();
+                }
+                catch ( std::exception & e )
+                {
+                    store_error_message( error_messages, item.index_, e );
+                }
+                clock.add_busy();
+            }
+            clock.add_input_wait();
+            clock.add_to( statistics_[ COMPARE ], statistics_mutex );
+        } ) );
+    }
+    for ( size_t t( 0 ); t != threads.size(); ++t )
+        threads[t].join();
+    wall_clock_seconds_ = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    size_t nfailed( 0 );
+    for ( size_t i( 0 ); i != error_messages.size(); ++i )
+    {
+        if ( ! error_messages[i].empty() )
+            ++nfailed;
+    }
+    return nfailed;
+}
+
+// ********************************************************************************
+
+std::string ScreeningPipeline::report() const
+{
+    std::string result;
+    for ( size_t s( 0 ); s != statistics_.size(); ++s )
+        result += statistics_[s].report() + "\n";
+    return result + "Wall-clock time " + double2string( wall_clock_seconds_, 2 ) + " s";
+}
+
+// ********************************************************************************
+
+std::vector< size_t > rank( const std::vector< double > & similarities )
+{
+    std::vector< size_t > result( similarities.size() );
+    for ( size_t i( 0 ); i != result.size(); ++i )
+        result[i] = i;
+    std::stable_sort( result.begin(), result.end(), [&]( const size_t lhs, const size_t rhs ) { return similarities[ lhs ] > similarities[ rhs ]; } );
+    return result;
+}
+
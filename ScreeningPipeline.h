@@ -0,0 +1,125 @@
+#ifndef SCREENINGPIPELINE_H
+#define SCREENINGPIPELINE_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class FileList;
+class PowderPatternCache;
+
+#include "Angle.h"
+#include "PowderPattern.h"
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+/*
+  Time spent by the workers of one stage of ScreeningPipeline, summed over the workers.
+  A stage with a high throughput that spends most of its time waiting for input can give workers to a slower stage.
+*/
+class PipelineStageStatistics
+{
+public:
+
+    PipelineStageStatistics(): nworkers_(0), nitems_(0), busy_seconds_(0.0), input_wait_seconds_(0.0), output_wait_seconds_(0.0) {}
+
+    std::string name_;
+    size_t nworkers_;
+    size_t nitems_;
+    double busy_seconds_;
+    double input_wait_seconds_;  // Waiting for the previous stage
+    double output_wait_seconds_; // Waiting for the next stage, because the queue was full
+
+    // Items per second per worker while busy.
+    double throughput() const { return ( busy_seconds_ > 0.0 ) ? nitems_ / busy_seconds_ : 0.0; }
+
+    // One line: name, workers, items, throughput and where the time went.
+    std::string report() const;
+};
+
+/*
+  Screens a list of .cif files against a target powder pattern as four overlapping stages:
+
+    read      read_cif()
+    symmetry  apply_space_group_symmetry()
+    pattern   PowderPatternCalculator, with the 2theta range, step and wavelength of the target
+    compare   normalised_weighted_cross_correlation() with the target
+
+  Each stage has its own number of worker threads and the stages are connected by BoundedQueues, so file I/O,
+  symmetry expansion and pattern calculation overlap while at most a few structures per stage are held in memory.
+*/
+class ScreeningPipeline
+{
+public:
+
+    enum Stage { READ, SYMMETRY, PATTERN, COMPARE };
+
+    // The target must have a constant 2theta step.
+    explicit ScreeningPipeline( const PowderPattern & target );
+
+    void set_FWHM( const double FWHM ) { FWHM_ = FWHM; }
+
+    // l as in normalised_weighted_cross_correlation().
+    void set_l( const Angle l ) { l_ = l; }
+
+    // The defaults are 2 readers, 1 symmetry worker, one pattern worker per core and 1 comparer.
+    size_t nworkers( const Stage stage ) const { return nworkers_[ stage ]; }
+    void set_nworkers( const Stage stage, const size_t nworkers );
+
+    // The pattern stage then only calculates patterns that are not in the cache. The cache must outlive the pipeline.
+    void set_cache( const PowderPatternCache & powder_pattern_cache ) { powder_pattern_cache_ = &powder_pattern_cache; }
+
+    // Maximum number of items in each queue between two stages, the default is 16.
+    void set_queue_capacity( const size_t queue_capacity );
+
+    // similarities are in the order of file_list. If a file fails, its error message is stored, its similarity is 0.0,
+    // and the other files are processed as normal. Returns the number of files that failed.
+    size_t run( const FileList & file_list, std::vector< double > & similarities, std::vector< std::string > & error_messages );
+
+    // Of the last run(), one per stage.
+    const std::vector< PipelineStageStatistics > & statistics() const { return statistics_; }
+
+    // The statistics of all stages and the wall-clock time.
+    std::string report() const;
+
+private:
+    PowderPattern target_;
+    double FWHM_;
+    Angle l_;
+    std::vector< size_t > nworkers_;
+    size_t queue_capacity_;
+    const PowderPatternCache * powder_pattern_cache_; // 0 means no cache
+    std::vector< PipelineStageStatistics > statistics_;
+    double wall_clock_seconds_;
+};
+
+// The indices of similarities in order of decreasing similarity.
+std::vector< size_t > rank( const std::vector< double > & similarities );
+
+#endif // SCREENINGPIPELINE_H
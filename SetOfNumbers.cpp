@@ -25,152 +25,88 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+
 #include "SetOfNumbers.h"
 #include "Sort.h"
 
-#include <iostream>
-#include <stdexcept>
-
-// ********************************************************************************
+#include <algorithm>
 
-SetOfNumbers::SetOfNumbers( const DuplicatesPolicy duplicates_policy ):
-duplicates_policy_(duplicates_policy),
-empty_is_allowed_(true)
-{
-}
 // ********************************************************************************
 
-SetOfNumbers::SetOfNumbers( const size_t nvalues, const DuplicatesPolicy duplicates_policy ):
-duplicates_policy_(duplicates_policy),
-empty_is_allowed_(true)
+size_t UnsortedNumbers::value( const size_t i ) const
 {
-    values_.reserve( nvalues );
-    for ( size_t i( 0 ); i != nvalues; ++i )
-        values_.push_back( i );
-    sorted_map_ = values_;
-    is_sorted_ = true;
+    return values_[ sorted_map()[i] ];
 }
 
 // ********************************************************************************
 
-// Fills the set with the numbers [begin,end]
-SetOfNumbers::SetOfNumbers( const size_t begin, const size_t end, const DuplicatesPolicy duplicates_policy ):
-duplicates_policy_(duplicates_policy),
-empty_is_allowed_(true)
+size_t UnsortedNumbers::frequency( const size_t value ) const
 {
-    if ( end < begin )
-        throw std::runtime_error( "SetOfNumbers::SetOfNumbers(): end < begin." );
-    size_t nvalues( end-begin+1 );
-    values_.reserve( nvalues );
-    sorted_map_.reserve( nvalues );
-    for ( size_t i( 0 ); i != nvalues; ++i )
+    size_t result( 0 );
+    for ( size_t i( 0 ); i != values_.size(); ++i )
     {
-        values_.push_back( begin+i );
-        sorted_map_.push_back( i );
+        if ( values_[i] == value )
+            ++result;
     }
-    is_sorted_ = true;
-}
-
-// ********************************************************************************
-
-SetOfNumbers::SetOfNumbers( const std::vector< size_t > & values, const DuplicatesPolicy duplicates_policy ):
-duplicates_policy_(duplicates_policy),
-empty_is_allowed_(true)
-{
-    values_ = values;
-    is_sorted_ = false;
-    check_for_duplicates();
-}
-
-// ********************************************************************************
-
-void SetOfNumbers::set_duplicates_policy( const DuplicatesPolicy duplicates_policy )
-{
-    duplicates_policy_ = duplicates_policy;
-    check_for_duplicates();
-}
-
-// ********************************************************************************
-
-void SetOfNumbers::set_empty_is_allowed( const bool empty_is_allowed )
-{
-    empty_is_allowed_ = empty_is_allowed;
-    check_if_empty();
-}
-
-// ********************************************************************************
-
-size_t SetOfNumbers::value( const size_t index ) const
-{
-    if ( ! ( index < values_.size() ) )
-        throw std::runtime_error( "SetOfNumbers::value(): index out of range." );
-    sort();
-    return values_[sorted_map_[index]];
-}
-
-// ********************************************************************************
-
-std::vector< size_t > SetOfNumbers::values() const
-{
-    std::vector< size_t > result;
-    result.reserve( size() );
-    for ( size_t i( 0 ); i != size(); ++i )
-        result.push_back( value( i ) );
     return result;
 }
 
 // ********************************************************************************
 
-SetOfNumbers SetOfNumbers::unique_values() const
-{
-    return SetOfNumbers( values(), AUTO_REMOVE );
-}
-
-// ********************************************************************************
-
-// Returns how often value occurs in the set.
-size_t SetOfNumbers::frequency( const size_t value ) const
+bool UnsortedNumbers::contains( const size_t value ) const
 {
-    size_t result( 0 );
-    for ( size_t i( 0 ); i != size(); ++i )
+    for ( size_t i( 0 ); i != values_.size(); ++i )
     {
         if ( values_[i] == value )
-            ++result;
+            return true;
     }
-    return result;
+    return false;
 }
 
 // ********************************************************************************
 
-void SetOfNumbers::add( const size_t value )
+void UnsortedNumbers::add( const size_t value )
 {
+    // Appending in ascending order keeps the values sorted
+    if ( sorted_map_.is_valid() && ( values_.empty() || ( values_[ sorted_map_.value().back() ] <= value ) ) )
+        sorted_map_.value().push_back( values_.size() );
+    else
+        sorted_map_.invalidate();
     values_.push_back( value );
-    is_sorted_ = false;
-    check_for_duplicates();
 }
 
 // ********************************************************************************
 
-void SetOfNumbers::remove( const size_t value )
+bool UnsortedNumbers::remove( const size_t value )
 {
-    for ( size_t i( 0 ); i != size(); ++i )
+    for ( size_t i( 0 ); i != values_.size(); ++i )
     {
         if ( values_[i] == value )
         {
             remove_position( i );
-            check_if_empty();
-            return;
+            return true;
         }
     }
+    return false;
 }
 
 // ********************************************************************************
 
-bool SetOfNumbers::contains( const size_t value ) const
+void UnsortedNumbers::remove_position( const size_t i )
 {
-    for ( size_t i( 0 ); i != size(); ++i )
+    values_[i] = values_.back();
+    values_.pop_back();
+    sorted_map_.invalidate();
+}
+
+// ********************************************************************************
+
+bool UnsortedNumbers::contains_duplicates() const
+{
+    const std::vector< size_t > & sorted_map = this->sorted_map();
+    for ( size_t i( 1 ); i < values_.size(); ++i )
     {
-        if ( values_[i] == value )
+        if ( values_[ sorted_map[i] ] == values_[ sorted_map[i-1] ] )
             return true;
     }
     return false;
@@ -178,160 +114,139 @@ bool SetOfNumbers::contains( const size_t value ) const
 
 // ********************************************************************************
 
-bool SetOfNumbers::contains_duplicates() const
+void UnsortedNumbers::remove_duplicates()
 {
-    if ( duplicates_policy_ != ALLOWED )
-        return false;
-    sort();
-    for ( size_t i( 1 ); i < size(); ++i )
+    const std::vector< size_t > & sorted_map = this->sorted_map();
+    std::vector< size_t > unique_values;
+    unique_values.reserve( values_.size() );
+    for ( size_t i( 0 ); i != values_.size(); ++i )
     {
-        if ( values_[ sorted_map_[i] ] == values_[ sorted_map_[i-1] ] )
-            return true;
+        if ( ( i == 0 ) || ( values_[ sorted_map[i] ] != values_[ sorted_map[i-1] ] ) )
+            unique_values.push_back( values_[ sorted_map[i] ] );
     }
-    return false;
+    values_.swap( unique_values );
+    sorted_map_.value().resize( values_.size() );
+    for ( size_t i( 0 ); i != values_.size(); ++i )
+        sorted_map_.value()[i] = i;
+    sorted_map_.set_valid();
 }
 
 // ********************************************************************************
 
-// The attributes duplicates_allowed_ and empty_is_allowed_ of the
-// argument values are ignored, the values of *this are kept.
-void SetOfNumbers::add( const SetOfNumbers & set_of_numbers )
+const std::vector< size_t > & UnsortedNumbers::sorted_map() const
 {
-    for ( size_t i( 0 ); i != set_of_numbers.size(); ++i )
-        this->add( set_of_numbers.value( i ) );
+    return sorted_map_.get( [this]( std::vector< size_t > & result ) { result = ::sort( values_ ); } );
 }
 
 // ********************************************************************************
 
-// The attributes duplicates_allowed_ and empty_is_allowed_ of the
-// argument values are ignored, the values of *this are kept.
-void SetOfNumbers::remove( const SetOfNumbers & set_of_numbers )
+size_t SortedNumbers::frequency( const size_t value ) const
 {
-    for ( size_t i( 0 ); i != set_of_numbers.size(); ++i )
-        this->remove( set_of_numbers.value( i ) );
+    std::pair< std::vector< size_t >::const_iterator, std::vector< size_t >::const_iterator > range = std::equal_range( values_.begin(), values_.end(), value );
+    return range.second - range.first;
 }
 
 // ********************************************************************************
 
-SetOfNumbers SetOfNumbers::in_common( const SetOfNumbers & set_of_numbers )
+bool SortedNumbers::contains( const size_t value ) const
 {
-    SetOfNumbers result( duplicates_policy() );
-    for ( size_t i( 0 ); i != size(); ++i )
-    {
-        if ( result.contains( value( i ) ) )
-            continue;
-        if ( ! set_of_numbers.contains( value( i ) ) )
-            continue;
-        size_t nvalues = std::min( frequency( value( i ) ), set_of_numbers.frequency( value( i ) ) );
-        for ( size_t j( 0 ); j != nvalues; ++j )
-            result.add( value( i ) );
-    }
-    return result;
+    return std::binary_search( values_.begin(), values_.end(), value );
 }
 
 // ********************************************************************************
 
-bool SetOfNumbers::operator==( const SetOfNumbers & rhs ) const
+void SortedNumbers::add( const size_t value )
 {
-    if ( this->size() != rhs.size() )
-        return false;
-    if ( this->duplicates_policy() != rhs.duplicates_policy() )
-        return false;
-    if ( this->empty_is_allowed() != rhs.empty_is_allowed() )
+    // Appending in ascending order, as in the constructors, is O(1)
+    if ( values_.empty() || ( values_.back() <= value ) )
+        values_.push_back( value );
+    else
+        values_.insert( std::upper_bound( values_.begin(), values_.end(), value ), value );
+}
+
+// ********************************************************************************
+
+bool SortedNumbers::remove( const size_t value )
+{
+    std::vector< size_t >::iterator it = std::lower_bound( values_.begin(), values_.end(), value );
+    if ( ( it == values_.end() ) || ( *it != value ) )
         return false;
-    for ( size_t i( 0 ); i != this->size(); ++i )
-    {
-        if ( this->value( i ) != rhs.value( i ) )
-            return false;
-    }
+    values_.erase( it );
     return true;
 }
 
 // ********************************************************************************
 
-bool SetOfNumbers::operator!=( const SetOfNumbers & rhs ) const
+bool SortedNumbers::contains_duplicates() const
 {
-    return ( ! ( this->values_ == rhs.values_ ) ); 
+    return ( std::adjacent_find( values_.begin(), values_.end() ) != values_.end() );
 }
-    
+
 // ********************************************************************************
 
-void SetOfNumbers::show() const
+void SortedNumbers::remove_duplicates()
 {
-    for ( size_t i( 0 ); i != size(); ++i )
-        std::cout << value( i ) << " ";
-    std::cout << std::endl;
+    values_.erase( std::unique( values_.begin(), values_.end() ), values_.end() );
 }
 
 // ********************************************************************************
 
-void SetOfNumbers::remove_position( const size_t index )
+size_t CountedNumbers::value( const size_t i ) const
 {
-    if ( index < values_.size() )
+    size_t nseen( 0 );
+    for ( size_t j( 0 ); j != counts_.size(); ++j )
     {
-        is_sorted_ = false;
-        values_[index] = values_[size()-1];
-        values_.pop_back();
+        nseen += counts_[j];
+        if ( i < nseen )
+            return j;
     }
-    else
-        throw std::runtime_error( "SetOfNumbers::remove_position(): index out of range." );
-    
+    throw std::runtime_error( "CountedNumbers::value(): index out of range." );
 }
 
 // ********************************************************************************
 
-void SetOfNumbers::sort() const
+void CountedNumbers::add( const size_t value )
 {
-    if ( is_sorted_ )
-        return;
-    sorted_map_ = ::sort( values_ );
-    is_sorted_ = true;
+    if ( ! ( value < counts_.size() ) )
+        counts_.resize( value + 1, 0 );
+    ++counts_[value];
+    ++size_;
 }
 
 // ********************************************************************************
 
-void SetOfNumbers::check_for_duplicates()
+bool CountedNumbers::remove( const size_t value )
 {
-    if ( duplicates_policy_ == ALLOWED )
-        return;
-    sort();
-    for ( size_t i( 1 ); i < size(); ++i )
-    {
-        if ( values_[ sorted_map_[i] ] == values_[ sorted_map_[i-1] ] )
-        {
-            if ( duplicates_policy_ == THROW )
-                throw std::runtime_error( "SetOfNumbers: duplicates found." );
-            else
-            {
-                remove_position( sorted_map_[i] );
-                check_for_duplicates();
-                return;
-            }
-        }
-    }
+    if ( ! contains( value ) )
+        return false;
+    --counts_[value];
+    --size_;
+    return true;
 }
 
 // ********************************************************************************
 
-void SetOfNumbers::check_if_empty() const
+bool CountedNumbers::contains_duplicates() const
 {
-    if ( empty_is_allowed_ )
-        return;
-    if ( empty() )
-        throw std::runtime_error( "SetOfNumbers: set is empty." );
+    for ( size_t i( 0 ); i != counts_.size(); ++i )
+    {
+        if ( counts_[i] > 1 )
+            return true;
+    }
+    return false;
 }
 
 // ********************************************************************************
 
-// The attributes duplicates_allowed_ and empty_is_allowed_ of the
-// arguments are ignored
-// duplicates_allowed_ is set to true, empty_is_allowed_ is set to true
-SetOfNumbers merge( const SetOfNumbers & lhs, const SetOfNumbers & rhs )
+void CountedNumbers::remove_duplicates()
 {
-    SetOfNumbers result;
-    result.add( lhs );
-    result.add( rhs );
-    return result;
+    size_ = 0;
+    for ( size_t i( 0 ); i != counts_.size(); ++i )
+    {
+        if ( counts_[i] > 1 )
+            counts_[i] = 1;
+        size_ += counts_[i];
+    }
 }
 
 // ********************************************************************************
@@ -28,87 +28,258 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "LazyCache.h"
+
+#include <algorithm>
 #include <cstddef> // For definition of size_t
+#include <iostream>
+#include <stdexcept>
 #include <vector>
 
 /*
- * This class represents a set of numbers.
- *
- * Numbers are not necessarily unique, this is configurable.
- *
- *  @@ Add permutations, and "k-in-N"
+ * Storage policies for BasicSetOfNumbers. All three store a multiset of numbers and return
+ * the values in ascending order through value( i ); they differ in which operations are cheap.
  *
+ * UnsortedNumbers: values in order of insertion, sorted lazily when value( i ) is needed (thread-safe, see LazyCache).
+ *                  add() is O(1), contains(), frequency() and remove() are linear. For append-heavy use.
+ * SortedNumbers  : a sorted vector. contains() and frequency() are O(log n), add() and remove() are O(n) (one memmove).
+ *                  For large sets that are mostly queried.
+ * CountedNumbers : one counter per possible value, so the memory is proportional to the largest value.
+ *                  contains(), frequency(), add() and remove() are O(1), value( i ) is O(largest value).
+ *                  For small universes, e.g. the numbers 1-9 of a Sudoku or the cards of a game.
  */
+class UnsortedNumbers
+{
+public:
+    UnsortedNumbers() { sorted_map_.set_valid(); }
+    size_t size() const { return values_.size(); }
+    void reserve( const size_t desired_size ) { values_.reserve( desired_size ); }
+    void clear() { values_.clear(); sorted_map_.value().clear(); sorted_map_.set_valid(); }
+    // The i-th smallest value, i is not checked.
+    size_t value( const size_t i ) const;
+    size_t frequency( const size_t value ) const;
+    bool contains( const size_t value ) const;
+    void add( const size_t value );
+    // Removes one occurrence, returns false if value not present.
+    bool remove( const size_t value );
+    bool contains_duplicates() const;
+    void remove_duplicates();
+    // Access in storage order, O(1). remove_position() moves the last value into position i.
+    size_t value_at_position( const size_t i ) const { return values_[i]; }
+    void remove_position( const size_t i );
+private:
+    std::vector< size_t > values_;
+    LazyCache< std::vector< size_t > > sorted_map_;
+    const std::vector< size_t > & sorted_map() const;
+};
+
+class SortedNumbers
+{
+public:
+    size_t size() const { return values_.size(); }
+    void reserve( const size_t desired_size ) { values_.reserve( desired_size ); }
+    void clear() { values_.clear(); }
+    size_t value( const size_t i ) const { return values_[i]; }
+    size_t frequency( const size_t value ) const;
+    bool contains( const size_t value ) const;
+    void add( const size_t value );
+    bool remove( const size_t value );
+    bool contains_duplicates() const;
+    void remove_duplicates();
+private:
+    std::vector< size_t > values_;
+};
+
+class CountedNumbers
+{
+public:
+    CountedNumbers(): size_(0) {}
+    size_t size() const { return size_; }
+    void reserve( const size_t ) {}
+    void clear() { counts_.clear(); size_ = 0; }
+    size_t value( const size_t i ) const;
+    size_t frequency( const size_t value ) const { return ( value < counts_.size() ) ? counts_[value] : 0; }
+    bool contains( const size_t value ) const { return ( frequency( value ) != 0 ); }
+    void add( const size_t value );
+    bool remove( const size_t value );
+    bool contains_duplicates() const;
+    void remove_duplicates();
+private:
+    std::vector< size_t > counts_;
+    size_t size_;
+};
 
-class SetOfNumbers
+// Holds the enum, so that it is the same type for all storage policies.
+class SetOfNumbersPolicy
 {
 public:
-    
-    
     // ALLOWED: duplicates are allowed
     // AUTO_REMOVE: duplicates are not allowed and are silently removed
     // THROW: Throw if a duplicate is encountered
     enum DuplicatesPolicy { ALLOWED, AUTO_REMOVE, THROW };
+};
+
+/*
+ * This class represents a set of numbers.
+ *
+ * Numbers are not necessarily unique, this is configurable.
+ * value( i ) returns the values in ascending order.
+ *
+ *  @@ Add permutations, and "k-in-N"
+ *
+ */
+template< class Storage >
+class BasicSetOfNumbers : public SetOfNumbersPolicy
+{
+public:
 
     // Default constructor, creates an empty set,
-    explicit SetOfNumbers( const DuplicatesPolicy duplicates_policy = ALLOWED );
+    explicit BasicSetOfNumbers( const DuplicatesPolicy duplicates_policy = ALLOWED ):
+    duplicates_policy_(duplicates_policy), empty_is_allowed_(true) {}
 
     // In keeping with C++ convention: zero-based.
     // Fills the set with the numbers 0, 1, ..., nvalues-1.
-    explicit SetOfNumbers( const size_t nvalues, const DuplicatesPolicy duplicates_policy = ALLOWED );
+    explicit BasicSetOfNumbers( const size_t nvalues, const DuplicatesPolicy duplicates_policy = ALLOWED ):
+    duplicates_policy_(duplicates_policy), empty_is_allowed_(true)
+    {
+        storage_.reserve( nvalues );
+        for ( size_t i( 0 ); i != nvalues; ++i )
+            storage_.add( i );
+    }
 
     // Fills the set with the numbers [begin,end]
-    SetOfNumbers( const size_t begin, const size_t end, const DuplicatesPolicy duplicates_policy = ALLOWED );
-
-    explicit SetOfNumbers( const std::vector< size_t > & values, const DuplicatesPolicy duplicates_policy = ALLOWED );
+    BasicSetOfNumbers( const size_t begin, const size_t end, const DuplicatesPolicy duplicates_policy = ALLOWED ):
+    duplicates_policy_(duplicates_policy), empty_is_allowed_(true)
+    {
+        if ( end < begin )
+            throw std::runtime_error( "SetOfNumbers::SetOfNumbers(): end < begin." );
+        storage_.reserve( end - begin + 1 );
+        for ( size_t i( begin ); i <= end; ++i )
+            storage_.add( i );
+    }
+
+    explicit BasicSetOfNumbers( const std::vector< size_t > & values, const DuplicatesPolicy duplicates_policy = ALLOWED ):
+    duplicates_policy_(duplicates_policy), empty_is_allowed_(true)
+    {
+        storage_.reserve( values.size() );
+        for ( size_t i( 0 ); i != values.size(); ++i )
+            storage_.add( values[i] );
+        check_for_duplicates();
+    }
 
     // Throws if set to THROW and set contains duplicates
     // If set to AUTO_REMOVE, duplicates are removed
-    void set_duplicates_policy( const DuplicatesPolicy duplicates_policy );
+    void set_duplicates_policy( const DuplicatesPolicy duplicates_policy )
+    {
+        duplicates_policy_ = duplicates_policy;
+        check_for_duplicates();
+    }
 
     DuplicatesPolicy duplicates_policy() const { return duplicates_policy_; }
 
     // Throws if set to true and set currently empty
-    void set_empty_is_allowed( const bool empty_is_allowed );
+    void set_empty_is_allowed( const bool empty_is_allowed )
+    {
+        empty_is_allowed_ = empty_is_allowed;
+        check_if_empty();
+    }
 
     bool empty_is_allowed() const { return empty_is_allowed_; }
 
-    bool empty() const { return values_.empty(); }
-    
-    // Returns the number of numbers in the set.
-    size_t size() const { return values_.size(); }
-
-    void reserve( const size_t desired_size ) { values_.reserve( desired_size ); }
-
-    size_t value( const size_t index ) const;
+    bool empty() const { return ( storage_.size() == 0 ); }
 
-    std::vector< size_t > values() const;
+    // Returns the number of numbers in the set.
+    size_t size() const { return storage_.size(); }
+
+    void reserve( const size_t desired_size ) { storage_.reserve( desired_size ); }
+
+    // The index-th smallest value.
+    size_t value( const size_t index ) const
+    {
+        if ( ! ( index < size() ) )
+            throw std::runtime_error( "SetOfNumbers::value(): index out of range." );
+        return storage_.value( index );
+    }
+
+    std::vector< size_t > values() const
+    {
+        std::vector< size_t > result;
+        result.reserve( size() );
+        for ( size_t i( 0 ); i != size(); ++i )
+            result.push_back( storage_.value( i ) );
+        return result;
+    }
 
     // DuplicatesPolicy is set to AUTO_REMOVE
-    SetOfNumbers unique_values() const;
+    BasicSetOfNumbers unique_values() const { return BasicSetOfNumbers( values(), AUTO_REMOVE ); }
 
     // Returns how often value occurs in the set.
-    size_t frequency( const size_t value ) const;
-
-    // If value currently already in the set, adds it again
-    void add( const size_t value );
+    size_t frequency( const size_t value ) const { return storage_.frequency( value ); }
+
+    // If value currently already in the set, behaviour depends on duplicates_policy().
+    void add( const size_t value )
+    {
+        if ( ( duplicates_policy_ != ALLOWED ) && storage_.contains( value ) )
+        {
+            if ( duplicates_policy_ == THROW )
+                throw std::runtime_error( "SetOfNumbers: duplicates found." );
+            return;
+        }
+        storage_.add( value );
+    }
 
     // Does nothing if value currently not in the set.
     // If multiple occurrences present, only removes one.
-    void remove( const size_t value );
-
-    bool contains( const size_t value ) const;
-
-    bool contains_duplicates() const;
+    void remove( const size_t value )
+    {
+        if ( storage_.remove( value ) )
+            check_if_empty();
+    }
+
+    bool contains( const size_t value ) const { return storage_.contains( value ); }
+
+    // Only for storages that have positions (UnsortedNumbers). The positions are in the order of storage, not sorted.
+    size_t value_at_position( const size_t index ) const
+    {
+        if ( ! ( index < size() ) )
+            throw std::runtime_error( "SetOfNumbers::value_at_position(): index out of range." );
+        return storage_.value_at_position( index );
+    }
+
+    // O(1), changes the order of the positions.
+    void remove_position( const size_t index )
+    {
+        if ( ! ( index < size() ) )
+            throw std::runtime_error( "SetOfNumbers::remove_position(): index out of range." );
+        storage_.remove_position( index );
+        check_if_empty();
+    }
+
+    bool contains_duplicates() const
+    {
+        if ( duplicates_policy_ != ALLOWED )
+            return false;
+        return storage_.contains_duplicates();
+    }
 
     // In a normal set, would be called union
     // The attributes duplicates_allowed_ and empty_is_allowed_ of the
     // argument values are ignored, the values of *this are kept.
-    void add( const SetOfNumbers & set_of_numbers );
+    template< class OtherStorage >
+    void add( const BasicSetOfNumbers< OtherStorage > & set_of_numbers )
+    {
+        for ( size_t i( 0 ); i != set_of_numbers.size(); ++i )
+            this->add( set_of_numbers.value( i ) );
+    }
 
     // The attributes duplicates_allowed_ and empty_is_allowed_ of the
     // argument values are ignored, the values of *this are kept.
-    void remove( const SetOfNumbers & set_of_numbers );
+    template< class OtherStorage >
+    void remove( const BasicSetOfNumbers< OtherStorage > & set_of_numbers )
+    {
+        for ( size_t i( 0 ); i != set_of_numbers.size(); ++i )
+            this->remove( set_of_numbers.value( i ) );
+    }
 
     // In a normal set, would be called intersection
     // The attribute duplicates_allowed_ of the
@@ -116,30 +287,91 @@ public:
     // The attribute empty_is_allowed_ is true
     // If *this contains three times the same value and the argument contains two times that same value, they have two in common.
     // If the argument contains three times the same value and *this contains two times that same value, they have two in common.
-    SetOfNumbers in_common( const SetOfNumbers & set_of_numbers );
-
-    bool operator==( const SetOfNumbers & rhs ) const;
-    bool operator!=( const SetOfNumbers & rhs ) const;
-
-    void show() const;
+    template< class OtherStorage >
+    BasicSetOfNumbers in_common( const BasicSetOfNumbers< OtherStorage > & set_of_numbers ) const
+    {
+        BasicSetOfNumbers result( duplicates_policy() );
+        for ( size_t i( 0 ); i != size(); ++i )
+        {
+            const size_t current_value = storage_.value( i );
+            // The values are sorted, so each value is only considered once
+            if ( ( i != 0 ) && ( current_value == storage_.value( i - 1 ) ) )
+                continue;
+            const size_t nvalues = std::min( frequency( current_value ), set_of_numbers.frequency( current_value ) );
+            for ( size_t j( 0 ); j != nvalues; ++j )
+                result.add( current_value );
+        }
+        return result;
+    }
+
+    bool operator==( const BasicSetOfNumbers & rhs ) const
+    {
+        if ( this->size() != rhs.size() )
+            return false;
+        if ( this->duplicates_policy() != rhs.duplicates_policy() )
+            return false;
+        if ( this->empty_is_allowed() != rhs.empty_is_allowed() )
+            return false;
+        for ( size_t i( 0 ); i != this->size(); ++i )
+        {
+            if ( this->storage_.value( i ) != rhs.storage_.value( i ) )
+                return false;
+        }
+        return true;
+    }
+
+    bool operator!=( const BasicSetOfNumbers & rhs ) const { return ! ( *this == rhs ); }
+
+    void show() const
+    {
+        for ( size_t i( 0 ); i != size(); ++i )
+            std::cout << storage_.value( i ) << " ";
+        std::cout << std::endl;
+    }
+
+    const Storage & storage() const { return storage_; }
 
 private:
-    std::vector< size_t > values_;
-    mutable std::vector< size_t > sorted_map_;
+    Storage storage_;
     DuplicatesPolicy duplicates_policy_;
     bool empty_is_allowed_;
-    mutable bool is_sorted_;
-    
-    void remove_position( const size_t index );
-    void sort() const;
-    void check_for_duplicates();
-    void check_if_empty() const;
+
+    void check_for_duplicates()
+    {
+        if ( duplicates_policy_ == ALLOWED )
+            return;
+        if ( ! storage_.contains_duplicates() )
+            return;
+        if ( duplicates_policy_ == THROW )
+            throw std::runtime_error( "SetOfNumbers: duplicates found." );
+        storage_.remove_duplicates();
+    }
+
+    void check_if_empty() const
+    {
+        if ( empty_is_allowed_ )
+            return;
+        if ( empty() )
+            throw std::runtime_error( "SetOfNumbers: set is empty." );
+    }
 };
 
+typedef BasicSetOfNumbers< UnsortedNumbers > SetOfNumbers;
+typedef BasicSetOfNumbers< SortedNumbers >   SortedSetOfNumbers;
+typedef BasicSetOfNumbers< CountedNumbers >  CountedSetOfNumbers;
+
 // The attributes duplicates_allowed_ and empty_is_allowed_ of the
 // arguments are ignored
 // duplicates_allowed_ is set to true, empty_is_allowed_ is set to true
-SetOfNumbers merge( const SetOfNumbers & lhs, const SetOfNumbers & rhs );
+template< class Storage >
+BasicSetOfNumbers< Storage > merge( const BasicSetOfNumbers< Storage > & lhs, const BasicSetOfNumbers< Storage > & rhs )
+{
+    BasicSetOfNumbers< Storage > result;
+    result.reserve( lhs.size() + rhs.size() );
+    result.add( lhs );
+    result.add( rhs );
+    return result;
+}
 
 #endif // SETOFNUMBERS_H
 
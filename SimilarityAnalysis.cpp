@@ -27,68 +27,305 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "SimilarityAnalysis.h"
 
+#include "BatchPowderPatternCalculator.h"
+#include "Clustering.h"
 #include "CorrelationMatrix.h"
-#include "CrystalStructure.h"
 #include "FileList.h"
+#include "FileName.h"
+#include "Logger.h"
+#include "MathFunctions.h"
+#include "ParallelFor.h"
 #include "PowderPattern.h"
-#include "PowderPatternCalculator.h"
-#include "ReadCif.h"
 #include "Utilities.h"
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
 #include <vector>
 
+namespace
+{
+
+// Number of patterns along each side of a tile of pairs.
+const size_t tile_size = 64;
+
 // ********************************************************************************
 
-CorrelationMatrix calculate_correlation_matrix( const FileList & file_list )
+// The settings of calculate_correlation_matrix( FileList ).
+void set_default_settings( BatchPowderPatternCalculator & batch_powder_pattern_calculator )
+{
+    batch_powder_pattern_calculator.set_wavelength( 1.54056 );
+    batch_powder_pattern_calculator.set_two_theta_start( Angle( 3.0, Angle::DEGREES ) );
+    batch_powder_pattern_calculator.set_two_theta_end( Angle( 35.0, Angle::DEGREES ) );
+    batch_powder_pattern_calculator.set_two_theta_step( Angle( 0.01, Angle::DEGREES ) );
+    batch_powder_pattern_calculator.set_FWHM( 0.1 );
+}
+
+// ********************************************************************************
+
+// weighted_cross_correlation( A, B ) = sum_i A[i] * triangle_filter( B )[i] with A = I/sigma, so both are stored for all patterns.
+// T is double or, for a BatchPowderPatternCalculator in single precision, float.
+// The rows are padded with zeros to a multiple of 64 bytes so that all rows start at the same alignment.
+template< typename T >
+class PreparedPatterns
 {
-    std::vector< PowderPattern > powder_patterns;
-    powder_patterns.reserve( file_list.size() );
-    Angle two_theta_start( 3.0, Angle::DEGREES );
-    Angle two_theta_end(  35.0, Angle::DEGREES );
-    Angle two_theta_step( 0.01, Angle::DEGREES );
-    double FWHM( 0.1 );
-    for ( size_t i( 0 ); i != file_list.size(); ++i )
+public:
+
+    PreparedPatterns( const BatchPowderPatternCalculator & powder_patterns, const int m, const size_t nthreads ):
+    npoints_(powder_patterns.npoints()),
+    stride_( ( ( powder_patterns.npoints() + values_per_line - 1 ) / values_per_line ) * values_per_line ),
+    intensities_( powder_patterns.npatterns() * stride_, T( 0 ) ),
+    filtered_intensities_( powder_patterns.npatterns() * stride_, T( 0 ) ),
+    norms_( powder_patterns.npatterns() )
     {
-        CrystalStructure crystal_structure;
-        std::cout << "Now reading cif... " + file_list.value( i ).full_name() << std::endl;
-        read_cif( file_list.value( i ), crystal_structure );
-        crystal_structure.apply_space_group_symmetry();
-        std::cout << "Now calculating powder pattern... " + size_t2string( i, 4, '0' ) << std::endl;
-        PowderPatternCalculator powder_pattern_calculator( crystal_structure );
-        powder_pattern_calculator.set_wavelength( 1.54056 );
-        powder_pattern_calculator.set_two_theta_start( two_theta_start );
-        powder_pattern_calculator.set_two_theta_end( two_theta_end );
-        powder_pattern_calculator.set_two_theta_step( two_theta_step );
-        powder_pattern_calculator.set_FWHM( FWHM );
-        PowderPattern powder_pattern;
-        powder_pattern_calculator.calculate( powder_pattern );
-        ReflectionList reflection_list = powder_pattern_calculator.reflection_list();
-        powder_patterns.push_back( powder_pattern );
+        parallel_for( powder_patterns.npatterns(), nthreads, [&]( const size_t i )
+        {
+            std::vector< double > intensities_over_ESDs_i = intensities_over_ESDs( powder_patterns.powder_pattern( i ) );
+            T * row = &intensities_[ i * stride_ ];
+            T * filtered_row = &filtered_intensities_[ i * stride_ ];
+            for ( size_t k( 0 ); k != npoints_; ++k )
+                row[k] = static_cast< T >( intensities_over_ESDs_i[k] );
+            triangle_filter( row, npoints_, m, filtered_row );
+            norms_[i] = sqrt( dot_product( row, filtered_row, npoints_ ) );
+        } );
     }
-    CorrelationMatrix result( powder_patterns.size() );
-    // To speed things up, for each powder pattern pre-calculate the weighted cross-correlation function
-    std::vector< double > sqrt_weighted_cross_correlations;
-    sqrt_weighted_cross_correlations.reserve( powder_patterns.size() );
-    // When experimental patterns are involved, the default value is 3.0.
-    Angle l = Angle( 1.0, Angle::DEGREES );
-    std::cout << "Now starting the precalculations" << std::endl;
-    for ( size_t i( 0 ); i != powder_patterns.size(); ++i )
-        sqrt_weighted_cross_correlations.push_back( sqrt( weighted_cross_correlation( powder_patterns[i], powder_patterns[i], l ) ) );
-    std::cout << "Precalculations done" << std::endl;
-    size_t iTotal( 0 );
-    for ( size_t i( 0 ); i != powder_patterns.size(); ++i )
+
+    size_t npoints() const { return npoints_; }
+    const T * intensities( const size_t i ) const { return &intensities_[ i * stride_ ]; }
+    const T * filtered_intensities( const size_t i ) const { return &filtered_intensities_[ i * stride_ ]; }
+
+    double normalised_weighted_cross_correlation( const size_t i, const size_t j ) const
     {
-        for ( size_t j( i+1 ); j != powder_patterns.size(); ++j )
+        return dot_product( intensities( i ), filtered_intensities( j ), stride_ ) / ( norms_[i] * norms_[j] );
+    }
+
+    double norm( const size_t i ) const { return norms_[i]; }
+
+private:
+    static const size_t values_per_line = 64 / sizeof( T );
+    size_t npoints_;
+    size_t stride_;
+    std::vector< T > intensities_;
+    std::vector< T > filtered_intensities_;
+    std::vector< double > norms_;
+};
+
+// ********************************************************************************
+
+// Tiles ( I, J ) with J >= I of the upper triangle, row by row, and the number of pairs in each tile.
+void upper_triangle_tiles( const size_t npatterns, const size_t tile_size, std::vector< size_t > & tiles_I, std::vector< size_t > & tiles_J, std::vector< size_t > & npairs )
+{
+    const size_t ntiles = ( npatterns + tile_size - 1 ) / tile_size;
+    for ( size_t I( 0 ); I != ntiles; ++I )
+    {
+        const size_t n_I = std::min( ( I + 1 ) * tile_size, npatterns ) - I * tile_size;
+        for ( size_t J( I ); J != ntiles; ++J )
         {
-            double value = weighted_cross_correlation( powder_patterns[i], powder_patterns[j], l ) / ( sqrt_weighted_cross_correlations[i] * sqrt_weighted_cross_correlations[j] );
-            result.set_value( i, j, value );
-            ++iTotal;
-            if ( (iTotal % 100) == 0 )
-                std::cout << size_t2string( iTotal ) + " comparisons done" << std::endl;
+            const size_t n_J = std::min( ( J + 1 ) * tile_size, npatterns ) - J * tile_size;
+            tiles_I.push_back( I );
+            tiles_J.push_back( J );
+            npairs.push_back( ( I == J ) ? ( n_I * ( n_I - 1 ) ) / 2 : n_I * n_J );
         }
     }
+}
+
+// ********************************************************************************
+
+// The pairs of calculate_correlation_matrix( BatchPowderPatternCalculator ), result must have the right size.
+template< typename T >
+void fill_correlation_matrix( const BatchPowderPatternCalculator & powder_patterns, const int m, const double cutoff, const size_t nthreads, DuplicateGroups * duplicate_groups, CorrelationMatrix & result )
+{
+    const size_t npatterns = powder_patterns.npatterns();
+    const size_t npoints = powder_patterns.npoints();
+    const PreparedPatterns< T > prepared_patterns( powder_patterns, m, nthreads );
+    // The estimates for the cutoff use patterns that are binned by a factor r, which is small compared to the width of the triangle.
+    const size_t r = std::max( 1, m / 8 );
+    const size_t coarse_npoints = ( npoints + r - 1 ) / r;
+    const size_t coarse_stride = ( ( coarse_npoints + 7 ) / 8 ) * 8;
+    std::vector< T > coarse_intensities;
+    std::vector< T > coarse_filtered_intensities;
+    if ( cutoff > 0.0 )
+    {
+        coarse_intensities.assign( npatterns * coarse_stride, T( 0 ) );
+        coarse_filtered_intensities.assign( npatterns * coarse_stride, T( 0 ) );
+        parallel_for( npatterns, nthreads, [&]( const size_t i )
+        {
+            // Sum of I/sigma, average of the filtered values
+            const T * row = prepared_patterns.intensities( i );
+            const T * filtered_row = prepared_patterns.filtered_intensities( i );
+            for ( size_t k( 0 ); k != npoints; ++k )
+            {
+                coarse_intensities[ i * coarse_stride + k / r ] += row[k];
+                coarse_filtered_intensities[ i * coarse_stride + k / r ] += filtered_row[k] / r;
+            }
+        } );
+    }
+    // Tiles (I,J) with J >= I of the upper triangle, dealt out to the threads one at a time
+    std::vector< size_t > tiles_I;
+    std::vector< size_t > tiles_J;
+    std::vector< size_t > npairs;
+    upper_triangle_tiles( npatterns, tile_size, tiles_I, tiles_J, npairs );
+    parallel_for( tiles_I.size(), nthreads, [&]( const size_t t )
+    {
+        const size_t i_end = std::min( ( tiles_I[t] + 1 ) * tile_size, npatterns );
+        const size_t j_end = std::min( ( tiles_J[t] + 1 ) * tile_size, npatterns );
+        for ( size_t i( tiles_I[t] * tile_size ); i != i_end; ++i )
+        {
+            for ( size_t j( std::max( tiles_J[t] * tile_size, i + 1 ) ); j < j_end; ++j )
+            {
+                const double normalisation = prepared_patterns.norm( i ) * prepared_patterns.norm( j );
+                if ( cutoff > 0.0 )
+                {
+                    double estimate = dot_product( &coarse_intensities[ i * coarse_stride ], &coarse_filtered_intensities[ j * coarse_stride ], coarse_npoints ) / normalisation;
+                    if ( estimate < cutoff )
+                    {
+                        result.set_value( i, j, estimate );
+                        if ( duplicate_groups != 0 )
+                            duplicate_groups->add( i, j, estimate );
+                        continue;
+                    }
+                }
+                const double value = prepared_patterns.normalised_weighted_cross_correlation( i, j );
+                result.set_value( i, j, value );
+                if ( duplicate_groups != 0 )
+                    duplicate_groups->add( i, j, value );
+            }
+        }
+    } );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+CorrelationMatrix calculate_correlation_matrix( const FileList & file_list )
+{
+    BatchPowderPatternCalculator batch_powder_pattern_calculator;
+    set_default_settings( batch_powder_pattern_calculator );
+    log_info( "Now calculating " + size_t2string( file_list.size() ) + " powder patterns... " );
+    batch_powder_pattern_calculator.calculate( file_list );
+    log_info( "Now calculating the correlation matrix... " );
+    // When experimental patterns are involved, the default value is 3.0.
+    return calculate_correlation_matrix( batch_powder_pattern_calculator, Angle( 1.0, Angle::DEGREES ) );
+}
+
+// ********************************************************************************
+
+CorrelationMatrix calculate_correlation_matrix( const FileList & file_list, const FileName & matrix_file_name, const size_t nthreads )
+{
+    calculate_correlation_matrix_part( file_list, matrix_file_name, 0, 1, nthreads );
+    return CorrelationMatrix( matrix_file_name );
+}
+
+// ********************************************************************************
+
+CorrelationMatrix calculate_correlation_matrix( const BatchPowderPatternCalculator & powder_patterns, const Angle l, const double cutoff, const size_t nthreads, DuplicateGroups * duplicate_groups )
+{
+    const bool single_precision = ( powder_patterns.precision() == BatchPowderPatternCalculator::SINGLE_PRECISION );
+    CorrelationMatrix result( powder_patterns.npatterns(), single_precision ? CorrelationMatrix::SINGLE_PRECISION : CorrelationMatrix::DOUBLE_PRECISION );
+    if ( ( powder_patterns.npatterns() < 2 ) || ( powder_patterns.npoints() == 0 ) )
+        return result;
+    const int m = std::max( 1, round_to_int( l / powder_patterns.two_theta_step() ) );
+    if ( single_precision )
+        fill_correlation_matrix< float >( powder_patterns, m, cutoff, nthreads, duplicate_groups, result );
+    else
+        fill_correlation_matrix< double >( powder_patterns, m, cutoff, nthreads, duplicate_groups, result );
     return result;
 }
-    
+
+// ********************************************************************************
+
+size_t calculate_correlation_matrix_part( const FileList & file_list, const FileName & matrix_file_name, const size_t ipart, const size_t nparts, const size_t nthreads, const size_t part_tile_size )
+{
+    if ( ( nparts == 0 ) || ( ipart >= nparts ) )
+        throw std::runtime_error( "calculate_correlation_matrix_part(): part " + size_t2string( ipart ) + " of " + size_t2string( nparts ) + " does not exist." );
+    if ( part_tile_size == 0 )
+        throw std::runtime_error( "calculate_correlation_matrix_part(): tile size is 0." );
+    const size_t npatterns = file_list.size();
+    CorrelationMatrixFileWriter writer( matrix_file_name, npatterns );
+    std::vector< size_t > tiles_I;
+    std::vector< size_t > tiles_J;
+    std::vector< size_t > npairs;
+    upper_triangle_tiles( npatterns, part_tile_size, tiles_I, tiles_J, npairs );
+    size_t total_npairs( 0 );
+    for ( size_t t( 0 ); t != npairs.size(); ++t )
+        total_npairs += npairs[t];
+    // The tiles are in row order, each part gets the tiles whose middle pair falls in its 1/nparts of all pairs.
+    // A band of consecutive tiles shares its rows, so each part needs only a fraction of the patterns.
+    std::vector< bool > is_done( tiles_I.size(), false );
+    const FileName checkpoint_file_name = append_to_file_name( matrix_file_name, "_part_" + size_t2string( ipart ) );
+    {
+        std::ifstream checkpoint_file( checkpoint_file_name.full_name().c_str() );
+        size_t t;
+        while ( checkpoint_file >> t )
+        {
+            if ( t < is_done.size() )
+                is_done[t] = true;
+        }
+    }
+    std::vector< size_t > tiles;
+    size_t npairs_so_far( 0 );
+    for ( size_t t( 0 ); t != tiles_I.size(); ++t )
+    {
+        const size_t part = std::min( nparts - 1, ( ( npairs_so_far + npairs[t] / 2 ) * nparts ) / std::max( total_npairs, size_t( 1 ) ) );
+        npairs_so_far += npairs[t];
+        if ( ( part == ipart ) && ( npairs[t] != 0 ) && ( ! is_done[t] ) )
+            tiles.push_back( t );
+    }
+    if ( tiles.empty() )
+        return 0;
+    // Only the patterns in the rows and columns of the remaining tiles are calculated
+    std::vector< bool > is_needed( ( npatterns + part_tile_size - 1 ) / part_tile_size, false );
+    for ( size_t k( 0 ); k != tiles.size(); ++k )
+    {
+        is_needed[ tiles_I[ tiles[k] ] ] = true;
+        is_needed[ tiles_J[ tiles[k] ] ] = true;
+    }
+    FileList needed_files;
+    std::vector< size_t > local_index( npatterns, npatterns );
+    for ( size_t i( 0 ); i != npatterns; ++i )
+    {
+        if ( is_needed[ i / part_tile_size ] )
+        {
+            local_index[i] = needed_files.size();
+            needed_files.push_back( file_list.value( i ) );
+        }
+    }
+    BatchPowderPatternCalculator batch_powder_pattern_calculator;
+    set_default_settings( batch_powder_pattern_calculator );
+    batch_powder_pattern_calculator.set_nthreads( nthreads );
+    log_info( "Now calculating " + size_t2string( needed_files.size() ) + " of " + size_t2string( npatterns ) + " powder patterns for " + size_t2string( tiles.size() ) + " tiles... " );
+    batch_powder_pattern_calculator.calculate( needed_files );
+    const int m = std::max( 1, round_to_int( Angle( 1.0, Angle::DEGREES ) / batch_powder_pattern_calculator.two_theta_step() ) );
+    const PreparedPatterns< double > prepared_patterns( batch_powder_pattern_calculator, m, nthreads );
+    std::ofstream checkpoint_file( checkpoint_file_name.full_name().c_str(), std::ios::app );
+    std::mutex checkpoint_mutex;
+    parallel_for( tiles.size(), nthreads, [&]( const size_t k )
+    {
+        const size_t t = tiles[k];
+        const size_t i_begin = tiles_I[t] * part_tile_size;
+        const size_t i_end = std::min( i_begin + part_tile_size, npatterns );
+        const size_t j_begin = tiles_J[t] * part_tile_size;
+        const size_t j_end = std::min( j_begin + part_tile_size, npatterns );
+        std::vector< double > column( part_tile_size );
+        // For fixed j the values ( i, j ) are consecutive in the file
+        for ( size_t j( std::max( j_begin, i_begin + 1 ) ); j < j_end; ++j )
+        {
+            const size_t n = std::min( i_end, j ) - i_begin;
+            for ( size_t i( i_begin ); i != i_begin + n; ++i )
+                column[ i - i_begin ] = prepared_patterns.normalised_weighted_cross_correlation( local_index[i], local_index[j] );
+            writer.write_column( j, i_begin, &column[0], n );
+        }
+        // The tile is only recorded once its values are on disk
+        std::lock_guard< std::mutex > lock( checkpoint_mutex );
+        writer.sync();
+        checkpoint_file << t << std::endl;
+    } );
+    return tiles.size();
+}
+
 // ********************************************************************************
+
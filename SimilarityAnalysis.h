@@ -28,10 +28,40 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+class BatchPowderPatternCalculator;
 class CorrelationMatrix;
+class DuplicateGroups;
 class FileList;
+class FileName;
+
+#include "Angle.h"
+
+#include <cstddef> // For definition of size_t
 
 // Uses powder patterns and Rene de Gelder's similarity measure, expects file_list to contain .cif files.
 CorrelationMatrix calculate_correlation_matrix( const FileList & file_list );
 
+// As calculate_correlation_matrix( file_list ), but the values are written into matrix_file_name as they are calculated and the finished
+// tiles are recorded in a checkpoint, as by calculate_correlation_matrix_part() with one part. If the calculation is stopped, calling this
+// again resumes where it stopped. Returns the matrix, memory-mapped from matrix_file_name.
+CorrelationMatrix calculate_correlation_matrix( const FileList & file_list, const FileName & matrix_file_name, const size_t nthreads = 0 );
+
+// normalised_weighted_cross_correlation() for all pairs of calculated patterns, without creating PowderPattern objects for all patterns.
+// The pairs are calculated in tiles on nthreads threads (0 means one thread per core).
+// If cutoff is greater than 0.0, the value of each pair is first estimated from patterns with a lower resolution;
+// pairs for which the estimate is below the cutoff are not calculated in full and are set to the estimate.
+// If duplicate_groups is not 0, every value is also added to it as soon as it has been calculated.
+// If the patterns are stored in single precision, the I/sigma values and the result are as well and the dot products are
+// calculated in float with double accumulators, which halves the memory traffic; the values agree to about 1.0E-6.
+CorrelationMatrix calculate_correlation_matrix( const BatchPowderPatternCalculator & powder_patterns, const Angle l, const double cutoff = 0.0, const size_t nthreads = 0, DuplicateGroups * duplicate_groups = 0 );
+
+// One part of calculate_correlation_matrix( file_list ), for running the calculation as nparts independent processes,
+// e.g. one per node of a cluster, that share a file system. The pairs are divided into tiles of tile_size x tile_size patterns
+// and part ipart (zero-based) gets a band of consecutive tiles with about 1/nparts of all pairs. Only the patterns in the rows
+// and columns of its tiles are calculated. The values are written straight into matrix_file_name with a CorrelationMatrixFileWriter,
+// the file is created by whichever part comes first and can be opened as a memory-mapped CorrelationMatrix once all parts have finished.
+// Finished tiles are recorded in a checkpoint file, matrix_file_name with "_part_<ipart>" appended; a part that is started again
+// skips those tiles, so a job that was killed resumes where it stopped. Returns the number of tiles that were calculated.
+size_t calculate_correlation_matrix_part( const FileList & file_list, const FileName & matrix_file_name, const size_t ipart, const size_t nparts, const size_t nthreads = 0, const size_t tile_size = 64 );
+
 #endif // SIMILARITYANALYSIS_H
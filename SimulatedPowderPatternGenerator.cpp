@@ -0,0 +1,452 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SimulatedPowderPatternGenerator.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "MathFunctions.h"
+#include "NoiseGenerator.h"
+#include "ParallelFor.h"
+#include "Philox.h"
+#include "PowderPatternCalculator.h"
+#include "ReadCif.h"
+#include "ReflectionList.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+
+const size_t pps_header_size = 64;
+const char pps_magic[] = "POWDPPS1";
+const size_t pps_nparameters = 11;
+// The crystalline contribution is normalised to this total signal before the amorphous contribution is added
+const double crystalline_total_signal = 10000.0;
+const double amorphous_FWHM = 5.0;
+
+void write_pps_header( std::ofstream & output_file, const unsigned long long npatterns, const unsigned long long npoints,
+                       const double wavelength, const double two_theta_start, const double two_theta_step )
+{
+    char header[ pps_header_size ];
+    std::memset( header, 0, pps_header_size );
+    std::memcpy( header, pps_magic, 8 );
+    std::memcpy( header +  8, &npatterns, 8 );
+    std::memcpy( header + 16, &npoints, 8 );
+    const unsigned long long nparameters = pps_nparameters;
+    std::memcpy( header + 24, &nparameters, 8 );
+    std::memcpy( header + 32, &wavelength, 8 );
+    std::memcpy( header + 40, &two_theta_start, 8 );
+    std::memcpy( header + 48, &two_theta_step, 8 );
+    output_file.write( header, pps_header_size );
+}
+
+void write_pps_pattern( std::ofstream & output_file, const SimulatedPowderPatternParameters & parameters, const PowderPattern & powder_pattern )
+{
+    const double values[ pps_nparameters ] = { static_cast< double >( parameters.structure_ ),
+                                               static_cast< double >( parameters.sample_ ),
+                                               parameters.zero_point_error_,
+                                               parameters.FWHM_,
+                                               parameters.include_PO_ ? parameters.PO_r_ : 0.0,
+                                               static_cast< double >( parameters.PO_direction_.h() ),
+                                               static_cast< double >( parameters.PO_direction_.k() ),
+                                               static_cast< double >( parameters.PO_direction_.l() ),
+                                               parameters.amorphous_total_signal_,
+                                               parameters.highest_peak_,
+                                               parameters.constant_background_ };
+    output_file.write( reinterpret_cast< const char * >( values ), sizeof( values ) );
+    std::vector< float > intensities( powder_pattern.size() );
+    for ( size_t i( 0 ); i != powder_pattern.size(); ++i )
+        intensities[i] = static_cast< float >( powder_pattern.intensity( i ) );
+    if ( ! intensities.empty() )
+        output_file.write( reinterpret_cast< const char * >( &intensities[0] ), intensities.size() * sizeof( float ) );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+ParameterRange::ParameterRange( const double min, const double max ):
+min_(min),
+max_(max)
+{
+    if ( max < min )
+        throw std::runtime_error( "ParameterRange::ParameterRange(): max must not be smaller than min." );
+}
+
+// ********************************************************************************
+
+SimulatedPowderPatternParameters::SimulatedPowderPatternParameters():
+structure_(0),
+sample_(0),
+zero_point_error_(0.0),
+FWHM_(0.0),
+include_PO_(false),
+PO_direction_(0,0,1),
+PO_r_(1.0),
+amorphous_total_signal_(0.0),
+highest_peak_(0.0),
+constant_background_(0.0)
+{
+}
+
+// ********************************************************************************
+
+bool default_PO_direction( const CrystalLattice & crystal_lattice, MillerIndices & PO_direction )
+{
+    PO_direction = MillerIndices( 0, 0, 1 );
+    switch ( crystal_lattice.lattice_system() )
+    {
+        case CrystalLattice::TRICLINIC    :
+        case CrystalLattice::ORTHORHOMBIC : {
+                                                if ( crystal_lattice.a() < crystal_lattice.b() )
+                                                {
+                                                    if ( crystal_lattice.a() < crystal_lattice.c() )
+                                                        PO_direction = MillerIndices( 1, 0, 0 );
+                                                }
+                                                else // b < a
+                                                {
+                                                    if ( crystal_lattice.b() < crystal_lattice.c() )
+                                                        PO_direction = MillerIndices( 0, 1, 0 );
+                                                }
+                                                return true;
+                                            }
+        case CrystalLattice::MONOCLINIC   : PO_direction = MillerIndices( 0, 1, 0 ); return true;
+        case CrystalLattice::TRIGONAL     :
+        case CrystalLattice::TETRAGONAL   :
+        case CrystalLattice::HEXAGONAL    : return true;
+        case CrystalLattice::RHOMBOHEDRAL :
+        case CrystalLattice::CUBIC        : return false;
+    }
+    return false;
+}
+
+// ********************************************************************************
+
+SimulatedPowderPatternGenerator::SimulatedPowderPatternGenerator():
+wavelength_(1.54056),
+two_theta_start_(1.0,Angle::DEGREES),
+two_theta_end_(35.0,Angle::DEGREES),
+two_theta_step_(0.015,Angle::DEGREES),
+zero_point_error_(0.06),
+FWHM_(0.25),
+PO_probability_(1.0),
+PO_r_(0.7),
+amorphous_total_signal_(50000.0),
+highest_peak_(300.0),
+constant_background_(20.0),
+add_noise_(true),
+subtract_background_(true),
+samples_per_structure_(1),
+seed_(1539),
+nthreads_(0)
+{
+}
+
+// ********************************************************************************
+
+void SimulatedPowderPatternGenerator::set_FWHM( const ParameterRange & FWHM )
+{
+    if ( FWHM.min_ <= 0.0 )
+        throw std::runtime_error( "SimulatedPowderPatternGenerator::set_FWHM(): FWHM must be positive." );
+    FWHM_ = FWHM;
+}
+
+// ********************************************************************************
+
+void SimulatedPowderPatternGenerator::set_PO_probability( const double PO_probability )
+{
+    if ( ( PO_probability < 0.0 ) || ( PO_probability > 1.0 ) )
+        throw std::runtime_error( "SimulatedPowderPatternGenerator::set_PO_probability(): probability must be between 0 and 1." );
+    PO_probability_ = PO_probability;
+}
+
+// ********************************************************************************
+
+void SimulatedPowderPatternGenerator::set_PO_r( const ParameterRange & PO_r )
+{
+    if ( PO_r.min_ <= 0.0 )
+        throw std::runtime_error( "SimulatedPowderPatternGenerator::set_PO_r(): r must be positive." );
+    PO_r_ = PO_r;
+}
+
+// ********************************************************************************
+
+void SimulatedPowderPatternGenerator::set_samples_per_structure( const size_t samples_per_structure )
+{
+    if ( samples_per_structure == 0 )
+        throw std::runtime_error( "SimulatedPowderPatternGenerator::set_samples_per_structure(): must be at least 1." );
+    samples_per_structure_ = samples_per_structure;
+}
+
+// ********************************************************************************
+
+size_t SimulatedPowderPatternGenerator::npoints() const
+{
+    return PowderPattern( two_theta_start_, two_theta_end_, two_theta_step_ ).size();
+}
+
+// ********************************************************************************
+
+void SimulatedPowderPatternGenerator::simulate( const CrystalStructure & crystal_structure,
+                                                const size_t structure_index,
+                                                std::vector< PowderPattern > & powder_patterns,
+                                                std::vector< SimulatedPowderPatternParameters > & parameters ) const
+{
+    powder_patterns.clear();
+    parameters.clear();
+    PowderPattern nominal_grid( two_theta_start_, two_theta_end_, two_theta_step_ );
+    nominal_grid.set_wavelength( wavelength_ );
+    const size_t npoints = nominal_grid.size();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_wavelength( wavelength_ );
+    powder_pattern_calculator.set_two_theta_start( two_theta_start_ );
+    powder_pattern_calculator.set_two_theta_step( two_theta_step_ );
+    // The reflection list must cover the largest shift of the 2theta grid
+    const double largest_zero_point_error = std::max( std::abs( zero_point_error_.min_ ), std::abs( zero_point_error_.max_ ) );
+    powder_pattern_calculator.set_two_theta_end( two_theta_end_ + Angle::from_degrees( largest_zero_point_error ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    const ReflectionList reflection_list = powder_pattern_calculator.reflection_list();
+    // The amorphous contribution does not depend on the sample, apart from its scale
+    powder_pattern_calculator.set_two_theta_end( two_theta_end_ );
+    powder_pattern_calculator.set_FWHM( amorphous_FWHM );
+    PowderPattern amorphous;
+    powder_pattern_calculator.calculate( reflection_list, amorphous );
+    MillerIndices PO_direction( 0, 0, 1 );
+    const bool PO_is_possible = default_PO_direction( crystal_structure.crystal_lattice(), PO_direction );
+    powder_patterns.reserve( samples_per_structure_ );
+    parameters.reserve( samples_per_structure_ );
+    for ( size_t j( 0 ); j != samples_per_structure_; ++j )
+    {
+        // Even streams for the parameters, odd streams for the noise
+        const uint64_t index = static_cast< uint64_t >( structure_index ) * samples_per_structure_ + j;
+        Philox4x32 Philox( seed_, 2 * index );
+        double u[8];
+        Philox.fill( u, 8 );
+        SimulatedPowderPatternParameters sample_parameters;
+        sample_parameters.structure_ = structure_index;
+        sample_parameters.sample_ = j;
+        sample_parameters.zero_point_error_ = zero_point_error_.value( u[0] );
+        sample_parameters.FWHM_ = FWHM_.value( u[1] );
+        sample_parameters.include_PO_ = PO_is_possible && ( u[2] < PO_probability_ );
+        sample_parameters.PO_direction_ = PO_direction;
+        sample_parameters.PO_r_ = PO_r_.value( u[3] );
+        sample_parameters.amorphous_total_signal_ = amorphous_total_signal_.value( u[4] );
+        sample_parameters.highest_peak_ = highest_peak_.value( u[5] );
+        sample_parameters.constant_background_ = constant_background_.value( u[6] );
+        powder_pattern_calculator.set_FWHM( sample_parameters.FWHM_ );
+        if ( sample_parameters.include_PO_ )
+            powder_pattern_calculator.set_preferred_orientation( sample_parameters.PO_direction_, sample_parameters.PO_r_ );
+        else
+            powder_pattern_calculator.clear_preferred_orientation();
+        // A peak at 2theta is observed at 2theta + zero-point error, so the observed point at 2theta is the calculated point at 2theta - zero-point error
+        const Angle zero_point_error = Angle::from_degrees( sample_parameters.zero_point_error_ );
+        powder_pattern_calculator.set_two_theta_start( two_theta_start_ - zero_point_error );
+        powder_pattern_calculator.set_two_theta_end( two_theta_end_ - zero_point_error );
+        powder_pattern_calculator.set_two_theta_step( two_theta_step_ );
+        PowderPattern crystalline;
+        powder_pattern_calculator.calculate( reflection_list, crystalline );
+        if ( crystalline.size() != npoints )
+            throw std::runtime_error( "SimulatedPowderPatternGenerator::simulate(): unexpected number of points." );
+        PowderPattern result( nominal_grid );
+        for ( size_t i( 0 ); i != npoints; ++i )
+            result.set_intensity( i, crystalline.intensity( i ) );
+        result.normalise_total_signal( crystalline_total_signal );
+        if ( sample_parameters.amorphous_total_signal_ > 0.0 )
+        {
+            PowderPattern scaled_amorphous( amorphous );
+            scaled_amorphous.normalise_total_signal( sample_parameters.amorphous_total_signal_ );
+            result += scaled_amorphous;
+        }
+        result.normalise_highest_peak( sample_parameters.highest_peak_ );
+        result.add_constant_background( sample_parameters.constant_background_ );
+        result.recalculate_estimated_standard_deviations();
+        if ( add_noise_ )
+        {
+            NoiseGenerator noise_generator( seed_, 2 * index + 1 );
+            result.add_Poisson_noise( noise_generator );
+        }
+        if ( subtract_background_ )
+        {
+            PowderPattern background = calculate_Brueckner_background( result,
+                                                                       50, // niterations
+                                                                       round_to_int( 50.0 * ( Angle::from_degrees( 0.015 ) / two_theta_step_ ) ), // window
+                                                                       true, // apply_smoothing
+                                                                       5 ); // smoothing_window
+            result -= background;
+        }
+        powder_patterns.push_back( result );
+        parameters.push_back( sample_parameters );
+    }
+}
+
+// ********************************************************************************
+
+size_t SimulatedPowderPatternGenerator::write_shards( const FileList & file_list, const FileName & base_name, const size_t patterns_per_shard ) const
+{
+    return write_shards( file_list.size(), [&]( const size_t i, CrystalStructure & storage ) -> const CrystalStructure &
+    {
+        read_cif( file_list.value( i ), storage );
+        storage.apply_space_group_symmetry();
+        return storage;
+    }, base_name, patterns_per_shard );
+}
+
+// ********************************************************************************
+
+size_t SimulatedPowderPatternGenerator::write_shards( const std::vector< CrystalStructure > & crystal_structures, const FileName & base_name, const size_t patterns_per_shard ) const
+{
+    return write_shards( crystal_structures.size(), [&]( const size_t i, CrystalStructure & ) -> const CrystalStructure & { return crystal_structures[i]; }, base_name, patterns_per_shard );
+}
+
+// ********************************************************************************
+
+template< class GetStructure >
+size_t SimulatedPowderPatternGenerator::write_shards( const size_t nstructures, GetStructure get_structure, const FileName & base_name, const size_t patterns_per_shard ) const
+{
+    if ( patterns_per_shard == 0 )
+        throw std::runtime_error( "SimulatedPowderPatternGenerator::write_shards(): patterns_per_shard must be at least 1." );
+    const size_t nthreads = ( nthreads_ == 0 ) ? default_nthreads() : nthreads_;
+    const size_t npoints = this->npoints();
+    // A few structures per thread per batch, so that the threads stay busy while the memory use stays bounded
+    const size_t batch_size = 4 * nthreads;
+    size_t nshards( 0 );
+    size_t npatterns_in_shard( 0 );
+    std::ofstream output_file;
+    FileName shard_file_name;
+    for ( size_t batch_start( 0 ); batch_start < nstructures; batch_start += batch_size )
+    {
+        const size_t batch_end = std::min( batch_start + batch_size, nstructures );
+        std::vector< std::vector< PowderPattern > > powder_patterns( batch_end - batch_start );
+        std::vector< std::vector< SimulatedPowderPatternParameters > > parameters( batch_end - batch_start );
+        parallel_for( batch_end - batch_start, nthreads, [&]( const size_t i )
+        {
+            CrystalStructure storage;
+            simulate( get_structure( batch_start + i, storage ), batch_start + i, powder_patterns[i], parameters[i] );
+        } );
+        for ( size_t i( 0 ); i != powder_patterns.size(); ++i )
+        {
+            for ( size_t j( 0 ); j != powder_patterns[i].size(); ++j )
+            {
+                if ( npatterns_in_shard == 0 )
+                {
+                    shard_file_name = FileName( base_name.directory(), base_name.file_name() + "_" + size_t2string( nshards, 6 ), "pps" );
+                    output_file.open( shard_file_name.full_name().c_str(), std::ios::binary );
+                    if ( ! output_file )
+                        throw std::runtime_error( "SimulatedPowderPatternGenerator::write_shards(): Could not open file " + shard_file_name.full_name() );
+                    write_pps_header( output_file, 0, npoints, wavelength_, two_theta_start_.value_in_degrees(), two_theta_step_.value_in_degrees() );
+                    ++nshards;
+                }
+                write_pps_pattern( output_file, parameters[i][j], powder_patterns[i][j] );
+                ++npatterns_in_shard;
+                if ( npatterns_in_shard == patterns_per_shard )
+                {
+                    output_file.seekp( 0 );
+                    write_pps_header( output_file, npatterns_in_shard, npoints, wavelength_, two_theta_start_.value_in_degrees(), two_theta_step_.value_in_degrees() );
+                    output_file.close();
+                    if ( ! output_file )
+                        throw std::runtime_error( "SimulatedPowderPatternGenerator::write_shards(): error writing file " + shard_file_name.full_name() );
+                    npatterns_in_shard = 0;
+                }
+            }
+        }
+    }
+    if ( npatterns_in_shard != 0 )
+    {
+        output_file.seekp( 0 );
+        write_pps_header( output_file, npatterns_in_shard, npoints, wavelength_, two_theta_start_.value_in_degrees(), two_theta_step_.value_in_degrees() );
+        output_file.close();
+        if ( ! output_file )
+            throw std::runtime_error( "SimulatedPowderPatternGenerator::write_shards(): error writing file " + shard_file_name.full_name() );
+    }
+    return nshards;
+}
+
+// ********************************************************************************
+
+void read_pps( const FileName & file_name,
+               std::vector< SimulatedPowderPatternParameters > & parameters,
+               std::vector< float > & intensities,
+               size_t & npoints,
+               double & wavelength,
+               double & two_theta_start,
+               double & two_theta_step )
+{
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+        throw std::runtime_error( "read_pps(): Could not open file " + file_name.full_name() );
+    char header[ pps_header_size ];
+    input_file.read( header, pps_header_size );
+    if ( ( ! input_file ) || ( std::memcmp( header, pps_magic, 8 ) != 0 ) )
+        throw std::runtime_error( "read_pps(): file is not a .pps file " + file_name.full_name() );
+    unsigned long long npatterns;
+    unsigned long long npoints_in_file;
+    unsigned long long nparameters;
+    std::memcpy( &npatterns      , header +  8, 8 );
+    std::memcpy( &npoints_in_file, header + 16, 8 );
+    std::memcpy( &nparameters    , header + 24, 8 );
+    std::memcpy( &wavelength     , header + 32, 8 );
+    std::memcpy( &two_theta_start, header + 40, 8 );
+    std::memcpy( &two_theta_step , header + 48, 8 );
+    if ( nparameters != pps_nparameters )
+        throw std::runtime_error( "read_pps(): unexpected number of parameters in file " + file_name.full_name() );
+    npoints = npoints_in_file;
+    parameters.clear();
+    parameters.reserve( npatterns );
+    intensities.resize( npatterns * npoints );
+    for ( size_t i( 0 ); i != npatterns; ++i )
+    {
+        double values[ pps_nparameters ];
+        input_file.read( reinterpret_cast< char * >( values ), sizeof( values ) );
+        if ( npoints != 0 )
+            input_file.read( reinterpret_cast< char * >( &intensities[ i * npoints ] ), npoints * sizeof( float ) );
+        if ( ! input_file )
+            throw std::runtime_error( "read_pps(): file is too short " + file_name.full_name() );
+        SimulatedPowderPatternParameters sample_parameters;
+        sample_parameters.structure_ = static_cast< size_t >( values[0] );
+        sample_parameters.sample_ = static_cast< size_t >( values[1] );
+        sample_parameters.zero_point_error_ = values[2];
+        sample_parameters.FWHM_ = values[3];
+        sample_parameters.include_PO_ = ( values[4] != 0.0 );
+        sample_parameters.PO_r_ = sample_parameters.include_PO_ ? values[4] : 1.0;
+        sample_parameters.PO_direction_ = MillerIndices( round_to_int( values[5] ), round_to_int( values[6] ), round_to_int( values[7] ) );
+        sample_parameters.amorphous_total_signal_ = values[8];
+        sample_parameters.highest_peak_ = values[9];
+        sample_parameters.constant_background_ = values[10];
+        parameters.push_back( sample_parameters );
+    }
+}
+
+// ********************************************************************************
+
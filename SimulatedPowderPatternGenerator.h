@@ -0,0 +1,194 @@
+#ifndef SIMULATEDPOWDERPATTERNGENERATOR_H
+#define SIMULATEDPOWDERPATTERNGENERATOR_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalLattice;
+class CrystalStructure;
+class FileList;
+
+#include "Angle.h"
+#include "FileName.h"
+#include "MillerIndices.h"
+#include "PowderPattern.h"
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
+#include <vector>
+
+// A parameter that is drawn uniformly from [min, max] for every simulated pattern. min == max gives a fixed value.
+struct ParameterRange
+{
+    ParameterRange( const double value ): min_(value), max_(value) {}
+    ParameterRange( const double min, const double max );
+
+    // u in [0, 1]
+    double value( const double u ) const { return min_ + u * ( max_ - min_ ); }
+
+    double min_;
+    double max_;
+};
+
+// The parameters that were drawn for one simulated pattern.
+struct SimulatedPowderPatternParameters
+{
+    SimulatedPowderPatternParameters();
+
+    size_t structure_;         // Index of the crystal structure
+    size_t sample_;            // Index of the sample for this crystal structure
+    double zero_point_error_;  // In degrees, a peak at 2theta is observed at 2theta + zero_point_error_
+    double FWHM_;              // In degrees
+    bool include_PO_;
+    MillerIndices PO_direction_;
+    double PO_r_;              // March-Dollase
+    double amorphous_total_signal_;
+    double highest_peak_;
+    double constant_background_;
+};
+
+// The default preferred-orientation direction for a lattice: the shortest axis for triclinic and orthorhombic lattices, b for monoclinic
+// and c otherwise. Returns false for cubic and rhombohedral lattices, for which preferred orientation is not included.
+bool default_PO_direction( const CrystalLattice & crystal_lattice, MillerIndices & PO_direction );
+
+/*
+  Generates "experimental" powder patterns from crystal structures, e.g. as training data for machine learning.
+
+  For every sample, the zero-point error, the FWHM, the preferred orientation, the amount of amorphous background,
+  the highest peak (and therefore the noise level) and the constant background are drawn from their ParameterRanges.
+  A sample is then: the crystalline pattern, normalised to a total signal of 10000, plus an amorphous contribution
+  (the pattern of the same structure with a FWHM of 5 degrees, without preferred orientation), scaled to the highest peak,
+  plus the constant background, plus Poisson noise, optionally followed by subtraction of a Brueckner background.
+
+  The reflection list and the structure factors are calculated only once per structure, every sample only pays for the
+  convolution with the peak shape. The zero-point error is applied by calculating the pattern on the shifted 2theta grid,
+  so all samples share the same 2theta values.
+  The random numbers for sample j of structure i only depend on the seed and on i and j (counter-based Philox streams),
+  so the output does not depend on the number of threads.
+
+  The defaults reproduce the settings that were hard-coded in the simulate-pattern command.
+*/
+class SimulatedPowderPatternGenerator
+{
+public:
+
+    SimulatedPowderPatternGenerator();
+
+    double wavelength() const { return wavelength_; }
+    void set_wavelength( const double wavelength ) { wavelength_ = wavelength; }
+
+    Angle two_theta_start() const { return two_theta_start_; }
+    void set_two_theta_start( const Angle two_theta_start ) { two_theta_start_ = two_theta_start; }
+
+    Angle two_theta_end() const { return two_theta_end_; }
+    void set_two_theta_end( const Angle two_theta_end ) { two_theta_end_ = two_theta_end; }
+
+    Angle two_theta_step() const { return two_theta_step_; }
+    void set_two_theta_step( const Angle two_theta_step ) { two_theta_step_ = two_theta_step; }
+
+    // In degrees
+    void set_zero_point_error( const ParameterRange & zero_point_error ) { zero_point_error_ = zero_point_error; }
+    void set_FWHM( const ParameterRange & FWHM );
+    // The probability that a sample has preferred orientation, if the lattice allows it (see default_PO_direction()).
+    void set_PO_probability( const double PO_probability );
+    void set_PO_r( const ParameterRange & PO_r );
+    // Total signal of the amorphous contribution, the crystalline contribution has a total signal of 10000.
+    void set_amorphous_total_signal( const ParameterRange & amorphous_total_signal ) { amorphous_total_signal_ = amorphous_total_signal; }
+    // Counts in the highest point before noise is added, this determines the signal-to-noise ratio.
+    void set_highest_peak( const ParameterRange & highest_peak ) { highest_peak_ = highest_peak; }
+    void set_constant_background( const ParameterRange & constant_background ) { constant_background_ = constant_background; }
+    void set_add_noise( const bool add_noise ) { add_noise_ = add_noise; }
+    void set_subtract_background( const bool subtract_background ) { subtract_background_ = subtract_background; }
+
+    size_t samples_per_structure() const { return samples_per_structure_; }
+    void set_samples_per_structure( const size_t samples_per_structure );
+
+    uint64_t seed() const { return seed_; }
+    void set_seed( const uint64_t seed ) { seed_ = seed; }
+
+    // 0 means one thread per core.
+    size_t nthreads() const { return nthreads_; }
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; }
+
+    size_t npoints() const;
+
+    // All samples of one crystal structure, the space-group symmetry must have been applied.
+    // structure_index determines the random numbers.
+    void simulate( const CrystalStructure & crystal_structure,
+                   const size_t structure_index,
+                   std::vector< PowderPattern > & powder_patterns,
+                   std::vector< SimulatedPowderPatternParameters > & parameters ) const;
+
+    // Simulates all samples of all structures (.cif files, the space-group symmetry is applied after reading) in parallel and writes them
+    // to binary shards of at most patterns_per_shard patterns, named base_name_000000.pps, base_name_000001.pps, ..., in the order
+    // structure 0 sample 0, structure 0 sample 1, ... Only a few structures per thread are held in memory at any time.
+    // Returns the number of shards.
+    size_t write_shards( const FileList & file_list, const FileName & base_name, const size_t patterns_per_shard ) const;
+
+    // As above, the space-group symmetry must have been applied.
+    size_t write_shards( const std::vector< CrystalStructure > & crystal_structures, const FileName & base_name, const size_t patterns_per_shard ) const;
+
+private:
+    double wavelength_;
+    Angle two_theta_start_;
+    Angle two_theta_end_;
+    Angle two_theta_step_;
+    ParameterRange zero_point_error_;
+    ParameterRange FWHM_;
+    double PO_probability_;
+    ParameterRange PO_r_;
+    ParameterRange amorphous_total_signal_;
+    ParameterRange highest_peak_;
+    ParameterRange constant_background_;
+    bool add_noise_;
+    bool subtract_background_;
+    size_t samples_per_structure_;
+    uint64_t seed_;
+    size_t nthreads_;
+
+    template< class GetStructure >
+    size_t write_shards( const size_t nstructures, GetStructure get_structure, const FileName & base_name, const size_t patterns_per_shard ) const;
+};
+
+/*
+  Binary shard format (.pps), native byte order:
+  a 64-byte header: "POWDPPS1", the number of patterns, the number of points, the number of parameters per pattern (11)
+  as 64-bit integers, then the wavelength, the 2theta start and the 2theta step (in degrees) as doubles;
+  then for each pattern the 11 parameters as doubles (structure, sample, zero-point error, FWHM, PO r (0.0 if there is no PO),
+  PO h, k, l, amorphous total signal, highest peak, constant background), followed by the intensities as floats.
+*/
+// Reads a shard. two_theta_start and two_theta_step are in degrees.
+void read_pps( const FileName & file_name,
+               std::vector< SimulatedPowderPatternParameters > & parameters,
+               std::vector< float > & intensities,
+               size_t & npoints,
+               double & wavelength,
+               double & two_theta_start,
+               double & two_theta_step );
+
+#endif // SIMULATEDPOWDERPATTERNGENERATOR_H
@@ -0,0 +1,207 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SingleCrystalData.h"
+#include "3DCalculations.h"
+#include "CrystalLattice.h"
+#include "FileName.h"
+#include "MathFunctions.h"
+#include "PointGroup.h"
+#include "TextFileReader_2.h"
+#include "Utilities.h"
+#include "Vector3D.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+
+// ********************************************************************************
+
+// The value in columns [first, first + width) of the line, 0.0 if the field is blank or beyond the end of the line.
+double fixed_column_value( const char * line_begin, const char * line_end, const size_t first, const size_t width )
+{
+    const char * begin = line_begin + std::min( first, static_cast<size_t>( line_end - line_begin ) );
+    const char * end = line_begin + std::min( first + width, static_cast<size_t>( line_end - line_begin ) );
+    while ( ( begin != end ) && ( *begin == ' ' ) )
+        ++begin;
+    while ( ( begin != end ) && ( *(end-1) == ' ' ) )
+        --end;
+    if ( begin == end )
+        return 0.0;
+    return string2double( begin, end );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+SingleCrystalData::SingleCrystalData( const FileName & file_name, const CrystalLattice & crystal_lattice, const PointGroup & laue_class, const HKLFFormat hklf_format ):
+nobservations_(0)
+{
+    TextFileReader_2 text_file_reader( file_name );
+    // Per unique reflection: the representative, sum w F^2, sum w and the number of observations
+    std::vector< MillerIndices > representatives;
+    std::vector< double > sums_wF2;
+    std::vector< double > sums_w;
+    std::vector< size_t > counts;
+    std::unordered_map< std::uint64_t, size_t > unique_index;
+    bool previous_overlaps( false );
+    for ( size_t i( 0 ); i != text_file_reader.size(); ++i )
+    {
+        const char * begin = text_file_reader.line_begin( i );
+        const char * end = text_file_reader.line_end( i );
+        if ( text_file_reader.line_length( i ) == 0 )
+            continue;
+        const int h = round_to_int( fixed_column_value( begin, end,  0, 4 ) );
+        const int k = round_to_int( fixed_column_value( begin, end,  4, 4 ) );
+        const int l = round_to_int( fixed_column_value( begin, end,  8, 4 ) );
+        if ( ( h == 0 ) && ( k == 0 ) && ( l == 0 ) )
+            break;
+        const double F_squared = fixed_column_value( begin, end, 12, 8 );
+        const double sigma = fixed_column_value( begin, end, 20, 8 );
+        if ( hklf_format == HKLF5 )
+        {
+            const int batch = round_to_int( fixed_column_value( begin, end, 28, 4 ) );
+            const bool overlaps = previous_overlaps;
+            previous_overlaps = ( batch < 0 );
+            if ( ( batch != 1 ) || overlaps )
+                continue;
+        }
+        ++nobservations_;
+        const MillerIndices representative = Laue_class_representative( MillerIndices( h, k, l ), laue_class );
+        const double weight = ( sigma > 0.0 ) ? 1.0 / square( sigma ) : 1.0;
+        std::pair< std::unordered_map< std::uint64_t, size_t >::iterator, bool > result = unique_index.emplace( packed_miller_indices( representative ), representatives.size() );
+        if ( result.second )
+        {
+            representatives.push_back( representative );
+            sums_wF2.push_back( 0.0 );
+            sums_w.push_back( 0.0 );
+            counts.push_back( 0 );
+        }
+        const size_t j = result.first->second;
+        sums_wF2[j] += weight * F_squared;
+        sums_w[j] += weight;
+        ++counts[j];
+    }
+    // Adding the reflections in order of decreasing d-spacing means that the list need not be sorted
+    std::vector< std::uint64_t > packed_representatives( representatives.size() );
+    std::vector< size_t > order( representatives.size() );
+    for ( size_t i( 0 ); i != representatives.size(); ++i )
+    {
+        packed_representatives[i] = packed_miller_indices( representatives[i] );
+        order[i] = i;
+    }
+    std::vector< double > lengths2( representatives.size() );
+    reciprocal_lattice_lengths2( ReciprocalBasis( crystal_lattice ), packed_representatives.data(), packed_representatives.size(), lengths2.data() );
+    std::vector< double > d_spacings( representatives.size() );
+    for ( size_t i( 0 ); i != representatives.size(); ++i )
+        d_spacings[i] = 1.0 / std::sqrt( lengths2[i] );
+    std::stable_sort( order.begin(), order.end(), [&]( const size_t lhs, const size_t rhs ) { return d_spacings[lhs] > d_spacings[rhs]; } );
+    reflection_list_.reserve( representatives.size() );
+    sigmas_.reserve( representatives.size() );
+    nmerged_.reserve( representatives.size() );
+    for ( size_t i( 0 ); i != order.size(); ++i )
+    {
+        const size_t j = order[i];
+        reflection_list_.push_back( representatives[j], sums_wF2[j] / sums_w[j], d_spacings[j], 0 );
+        // With unit weights (no sigmas in the file) this is 1/sqrt(n)
+        sigmas_.push_back( 1.0 / std::sqrt( sums_w[j] ) );
+        nmerged_.push_back( counts[j] );
+    }
+    reflection_list_.finalise( true );
+}
+
+// ********************************************************************************
+
+RFactors calculate_R_factors( const SingleCrystalData & observed, const ReflectionList & calculated )
+{
+    RFactors result;
+    const ReflectionList & observed_reflections = observed.reflection_list();
+    std::vector< double > F_squared_observed;
+    std::vector< double > F_squared_calculated;
+    std::vector< double > weights;
+    F_squared_observed.reserve( observed.size() );
+    F_squared_calculated.reserve( observed.size() );
+    weights.reserve( observed.size() );
+    std::vector< size_t > observed_indices;
+    for ( size_t i( 0 ); i != observed.size(); ++i )
+    {
+        const size_t j = calculated.index( observed_reflections.miller_indices( i ) );
+        if ( j == calculated.size() )
+        {
+            ++result.nunmatched_;
+            continue;
+        }
+        F_squared_observed.push_back( observed.F_squared( i ) );
+        F_squared_calculated.push_back( calculated.F_squared( j ) );
+        weights.push_back( 1.0 / square( observed.sigma_F_squared( i ) ) );
+        observed_indices.push_back( i );
+    }
+    result.nreflections_ = F_squared_observed.size();
+    if ( result.nreflections_ == 0 )
+        throw std::runtime_error( "calculate_R_factors(): no observed reflections in calculated list." );
+    // k = sum w Fo^2 Fc^2 / sum w Fc^4 minimises sum w ( Fo^2 - k Fc^2 )^2
+    double sum_w_Fo2_Fc2( 0.0 );
+    double sum_w_Fc4( 0.0 );
+    for ( size_t i( 0 ); i != result.nreflections_; ++i )
+    {
+        sum_w_Fo2_Fc2 += weights[i] * F_squared_observed[i] * F_squared_calculated[i];
+        sum_w_Fc4 += weights[i] * square( F_squared_calculated[i] );
+    }
+    if ( sum_w_Fc4 == 0.0 )
+        throw std::runtime_error( "calculate_R_factors(): all calculated F^2 are zero." );
+    result.scale_ = sum_w_Fo2_Fc2 / sum_w_Fc4;
+    double numerator_wR2( 0.0 );
+    double denominator_wR2( 0.0 );
+    double numerator_R1( 0.0 );
+    double denominator_R1( 0.0 );
+    for ( size_t i( 0 ); i != result.nreflections_; ++i )
+    {
+        numerator_wR2 += weights[i] * square( F_squared_observed[i] - result.scale_ * F_squared_calculated[i] );
+        denominator_wR2 += weights[i] * square( F_squared_observed[i] );
+        if ( F_squared_observed[i] > 2.0 * observed.sigma_F_squared( observed_indices[i] ) )
+        {
+            const double F_observed = std::sqrt( F_squared_observed[i] );
+            numerator_R1 += std::abs( F_observed - std::sqrt( result.scale_ * std::max( F_squared_calculated[i], 0.0 ) ) );
+            denominator_R1 += F_observed;
+            ++result.nR1_reflections_;
+        }
+    }
+    result.wR2_ = std::sqrt( numerator_wR2 / denominator_wR2 );
+    if ( denominator_R1 > 0.0 )
+        result.R1_ = numerator_R1 / denominator_R1;
+    return result;
+}
+
+// ********************************************************************************
+
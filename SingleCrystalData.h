@@ -0,0 +1,106 @@
+#ifndef SINGLECRYSTALDATA_H
+#define SINGLECRYSTALDATA_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalLattice;
+class FileName;
+class PointGroup;
+
+#include "MillerIndices.h"
+#include "ReflectionList.h"
+
+#include <vector>
+
+/*
+  Observed F^2 values from a SHELX .hkl file, merged and with d-spacings.
+
+  The file is read in fixed columns (3I4,2F8.2,I4): h, k, l, F^2, sigma(F^2) and the batch number. A line with h = k = l = 0 ends the data.
+  HKLF 4: the batch number is ignored.
+  HKLF 5: the batch number is the twin component, a negative batch number means that the reflection overlaps with the next reflection.
+          Only the reflections of component 1 that do not overlap with any other reflection are kept.
+  Reflections that are equivalent under the Laue class (including Friedel's law) are merged with weights 1/sigma^2,
+  use the Laue class -1 to merge Friedel pairs only.
+*/
+class SingleCrystalData
+{
+public:
+
+    enum HKLFFormat { HKLF4, HKLF5 };
+
+    SingleCrystalData() : nobservations_(0) {}
+
+    SingleCrystalData( const FileName & file_name, const CrystalLattice & crystal_lattice, const PointGroup & laue_class, const HKLFFormat hklf_format = HKLF4 );
+
+    size_t size() const { return sigmas_.size(); }
+
+    // Sorted by decreasing d-spacing, the (hkl) are those given by Laue_class_representative(), the multiplicities are 0.
+    // The index of a reflection in the reflection list is the same as in this class.
+    const ReflectionList & reflection_list() const { return reflection_list_; }
+
+    MillerIndices miller_indices( const size_t i ) const { return reflection_list_.miller_indices( i ); }
+    double F_squared( const size_t i ) const { return reflection_list_.F_squared( i ); }
+    double sigma_F_squared( const size_t i ) const { return sigmas_[i]; }
+    double d_spacing( const size_t i ) const { return reflection_list_.d_spacing( i ); }
+
+    // The number of observations that were merged into reflection i
+    size_t nmerged( const size_t i ) const { return nmerged_[i]; }
+
+    // The number of observations that were kept before merging
+    size_t nobservations() const { return nobservations_; }
+
+private:
+    ReflectionList reflection_list_;
+    std::vector< double > sigmas_;
+    std::vector< size_t > nmerged_;
+    size_t nobservations_;
+};
+
+// Agreement between observed and calculated F^2, as in SHELXL.
+// The calculated F^2 are first put on the scale of the observed F^2 with the scale factor k that minimises wR2.
+// wR2 = sqrt( sum w ( Fo^2 - k Fc^2 )^2 / sum w ( Fo^2 )^2 ) with w = 1 / sigma^2( Fo^2 ), over all reflections.
+// R1 = sum | Fo - sqrt( k ) Fc | / sum Fo, over the reflections with Fo^2 > 2 sigma( Fo^2 ).
+struct RFactors
+{
+    RFactors() : R1_(0.0), wR2_(0.0), scale_(0.0), nreflections_(0), nR1_reflections_(0), nunmatched_(0) {}
+
+    double R1_;
+    double wR2_;
+    double scale_;
+    size_t nreflections_;     // The reflections used for wR2
+    size_t nR1_reflections_;  // The reflections with Fo^2 > 2 sigma( Fo^2 )
+    size_t nunmatched_;       // Observed reflections that are not in the calculated list, these are skipped
+};
+
+// The calculated reflections are looked up with ReflectionList::index(), so their (hkl) must be the same representatives,
+// e.g. because the calculated list was made with PowderPatternCalculator::set_reflection_list( observed.reflection_list() ).
+RFactors calculate_R_factors( const SingleCrystalData & observed, const ReflectionList & calculated );
+
+#endif // SINGLECRYSTALDATA_H
+
@@ -47,7 +47,7 @@ nplayers_(nplayers)
     for ( size_t i(0); i != nplayers_; ++i )
         hands_.push_back( empty_hand );
     // Populate draw pile
-// @@    draw_pile_.reserve( 162 );
+    draw_pile_.reserve( 162 );
     for ( size_t i( 0 ); i != 18; ++i )
         draw_pile_.add( 13 );
     for ( size_t i( 0 ); i != 12; ++i )
@@ -60,15 +60,7 @@ nplayers_(nplayers)
     if ( draw_pile_.size() != 162 )
         throw std::runtime_error( "SkipBoGame::SkipBoGame(): draw_pile_.size() != 162." );
     for ( size_t i(0); i != nplayers_; ++i )
-    {
-        std::vector< size_t > stock_pile;
-        stock_pile.reserve( 20 );
-        for ( size_t j(0); j != stock_pile_size; ++j )
-        {
-            stock_pile.push_back( draw_pile_.draw() );
-        }
-        stock_piles_.push_back( stock_pile );
-    }
+        stock_piles_.push_back( draw_pile_.draw( stock_pile_size ) );
 }
 
 // ********************************************************************************
@@ -0,0 +1,469 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "SkipBoTournament.h"
+#include "ParallelFor.h"
+#include "Philox.h"
+#include "Utilities.h"
+#include "Xoshiro256StarStar.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+// Uniform in [0,n), n < 2^32.
+size_t uniform( Xoshiro256StarStar & rng, const size_t n )
+{
+    return static_cast<size_t>( ( ( rng.next() >> 32 ) * n ) >> 32 );
+}
+
+// ********************************************************************************
+
+void shuffle( unsigned char * cards, const size_t n, Xoshiro256StarStar & rng )
+{
+    for ( size_t i( n ); i > 1; --i )
+        std::swap( cards[i-1], cards[ uniform( rng, i ) ] );
+}
+
+// ********************************************************************************
+
+// Returns false if there are no cards left at all.
+bool draw_card( SkipBoState & state, unsigned char & card, Xoshiro256StarStar & rng )
+{
+    if ( state.draw_pile_size_ == 0 )
+    {
+        if ( state.ncompleted_cards_ == 0 )
+            return false;
+        for ( size_t i( 0 ); i != state.ncompleted_cards_; ++i )
+            state.draw_pile_[i] = state.completed_cards_[i];
+        state.draw_pile_size_ = state.ncompleted_cards_;
+        state.ncompleted_cards_ = 0;
+        shuffle( state.draw_pile_, state.draw_pile_size_, rng );
+    }
+    card = state.draw_pile_[ --state.draw_pile_size_ ];
+    return true;
+}
+
+// ********************************************************************************
+
+void fill_hand( SkipBoState & state, Xoshiro256StarStar & rng )
+{
+    unsigned char * hand = state.hands_[ state.current_player_ ];
+    for ( size_t i( 0 ); i != 5; ++i )
+    {
+        if ( ( hand[i] == 0 ) && ( ! draw_card( state, hand[i], rng ) ) )
+            return;
+    }
+}
+
+// ********************************************************************************
+
+bool hand_is_empty( const SkipBoState & state )
+{
+    const unsigned char * hand = state.hands_[ state.current_player_ ];
+    return ( hand[0] == 0 ) && ( hand[1] == 0 ) && ( hand[2] == 0 ) && ( hand[3] == 0 ) && ( hand[4] == 0 );
+}
+
+// ********************************************************************************
+
+// 0 if the source is empty or the index is out of range.
+size_t source_card( const SkipBoState & state, const SkipBoMove & move )
+{
+    const size_t player = state.current_player_;
+    switch ( move.source_ )
+    {
+        case SkipBoMove::HAND         : return ( move.source_index_ < 5 ) ? state.hand( player, move.source_index_ ) : 0;
+        case SkipBoMove::STOCK_PILE   : return state.stock_top( player );
+        case SkipBoMove::DISCARD_PILE : return ( move.source_index_ < 4 ) ? state.discard_top( player, move.source_index_ ) : 0;
+    }
+    return 0;
+}
+
+// ********************************************************************************
+
+void remove_source_card( SkipBoState & state, const SkipBoMove & move )
+{
+    const size_t player = state.current_player_;
+    switch ( move.source_ )
+    {
+        case SkipBoMove::HAND         : state.hands_[player][ move.source_index_ ] = 0; return;
+        case SkipBoMove::STOCK_PILE   : --state.stock_pile_sizes_[player]; return;
+        case SkipBoMove::DISCARD_PILE : --state.discard_pile_sizes_[player][ move.source_index_ ]; return;
+    }
+}
+
+// ********************************************************************************
+
+bool is_legal( const SkipBoState & state, const SkipBoMove & move )
+{
+    if ( move.target_index_ > 3 )
+        return false;
+    const size_t card = source_card( state, move );
+    if ( card == 0 )
+        return false;
+    if ( move.kind_ == SkipBoMove::DISCARD )
+        return ( move.source_ == SkipBoMove::HAND );
+    return skip_bo_fits( card, state.next_value( move.target_index_ ) );
+}
+
+// ********************************************************************************
+
+enum MoveResult { CONTINUE_TURN, END_OF_TURN, GAME_WON };
+
+MoveResult apply_move( SkipBoState & state, const SkipBoMove & move, Xoshiro256StarStar & rng )
+{
+    if ( ! is_legal( state, move ) )
+        throw std::runtime_error( "play_skip_bo_game(): strategy returned an illegal move." );
+    const size_t player = state.current_player_;
+    const unsigned char card = static_cast<unsigned char>( source_card( state, move ) );
+    remove_source_card( state, move );
+    const size_t target = move.target_index_;
+    if ( move.kind_ == SkipBoMove::DISCARD )
+    {
+        state.discard_piles_[player][target][ state.discard_pile_sizes_[player][target]++ ] = card;
+        return END_OF_TURN;
+    }
+    state.build_piles_[target][ state.build_pile_sizes_[target]++ ] = card;
+    if ( state.build_pile_sizes_[target] == 12 )
+    {
+        for ( size_t i( 0 ); i != 12; ++i )
+            state.completed_cards_[ state.ncompleted_cards_++ ] = state.build_piles_[target][i];
+        state.build_pile_sizes_[target] = 0;
+    }
+    if ( state.stock_pile_sizes_[player] == 0 )
+        return GAME_WON;
+    if ( hand_is_empty( state ) )
+    {
+        fill_hand( state, rng );
+        // No cards left to draw, so nothing to discard either
+        if ( hand_is_empty( state ) )
+            return END_OF_TURN;
+    }
+    return CONTINUE_TURN;
+}
+
+// ********************************************************************************
+
+// A stream of its own for each game, the state words are taken from Philox with the game as the stream number.
+Xoshiro256StarStar game_generator( const uint64_t seed, const uint64_t game )
+{
+    Philox4x32 philox( seed, game );
+    uint32_t r[8];
+    philox.block( 0, r );
+    philox.block( 1, r + 4 );
+    uint64_t s[4];
+    for ( size_t i( 0 ); i != 4; ++i )
+        s[i] = ( static_cast<uint64_t>( r[2*i] ) << 32 ) | r[2*i+1];
+    if ( ( s[0] | s[1] | s[2] | s[3] ) == 0 )
+        s[0] = 1;
+    return Xoshiro256StarStar( s[0], s[1], s[2], s[3] );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+size_t SkipBoState::ncards() const
+{
+    size_t result = draw_pile_size_ + ncompleted_cards_;
+    for ( size_t i( 0 ); i != 4; ++i )
+        result += build_pile_sizes_[i];
+    for ( size_t i( 0 ); i != nplayers_; ++i )
+    {
+        result += stock_pile_sizes_[i];
+        for ( size_t j( 0 ); j != 5; ++j )
+        {
+            if ( hands_[i][j] != 0 )
+                ++result;
+        }
+        for ( size_t j( 0 ); j != 4; ++j )
+            result += discard_pile_sizes_[i][j];
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< SkipBoMove > legal_skip_bo_moves( const SkipBoState & state )
+{
+    std::vector< SkipBoMove > result;
+    const size_t player = state.current_player_;
+    for ( size_t k( 0 ); k != 4; ++k )
+    {
+        const size_t value = state.next_value( k );
+        if ( ( state.stock_top( player ) != 0 ) && skip_bo_fits( state.stock_top( player ), value ) )
+            result.push_back( SkipBoMove( SkipBoMove::PLAY, SkipBoMove::STOCK_PILE, 0, k ) );
+        for ( size_t i( 0 ); i != 4; ++i )
+        {
+            if ( ( state.discard_top( player, i ) != 0 ) && skip_bo_fits( state.discard_top( player, i ), value ) )
+                result.push_back( SkipBoMove( SkipBoMove::PLAY, SkipBoMove::DISCARD_PILE, i, k ) );
+        }
+        for ( size_t i( 0 ); i != 5; ++i )
+        {
+            if ( ( state.hand( player, i ) != 0 ) && skip_bo_fits( state.hand( player, i ), value ) )
+                result.push_back( SkipBoMove( SkipBoMove::PLAY, SkipBoMove::HAND, i, k ) );
+        }
+    }
+    for ( size_t i( 0 ); i != 5; ++i )
+    {
+        if ( state.hand( player, i ) == 0 )
+            continue;
+        for ( size_t k( 0 ); k != 4; ++k )
+            result.push_back( SkipBoMove( SkipBoMove::DISCARD, SkipBoMove::HAND, i, k ) );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+SkipBoMove SkipBoGreedyStrategy::choose_move( const SkipBoState & state, Xoshiro256StarStar & ) const
+{
+    const size_t player = state.current_player_;
+    const size_t stock_card = state.stock_top( player );
+    // The stock card
+    for ( size_t k( 0 ); k != 4; ++k )
+    {
+        if ( skip_bo_fits( stock_card, state.next_value( k ) ) )
+            return SkipBoMove( SkipBoMove::PLAY, SkipBoMove::STOCK_PILE, 0, k );
+    }
+    // Numbers from the discard piles and the hand
+    for ( size_t k( 0 ); k != 4; ++k )
+    {
+        const size_t value = state.next_value( k );
+        for ( size_t i( 0 ); i != 4; ++i )
+        {
+            if ( state.discard_top( player, i ) == value )
+                return SkipBoMove( SkipBoMove::PLAY, SkipBoMove::DISCARD_PILE, i, k );
+        }
+        for ( size_t i( 0 ); i != 5; ++i )
+        {
+            if ( state.hand( player, i ) == value )
+                return SkipBoMove( SkipBoMove::PLAY, SkipBoMove::HAND, i, k );
+        }
+    }
+    // A Skip-Bo card if that makes the stock card playable
+    if ( stock_card != SKIP_BO_CARD )
+    {
+        for ( size_t k( 0 ); k != 4; ++k )
+        {
+            if ( state.next_value( k ) + 1 != stock_card )
+                continue;
+            for ( size_t i( 0 ); i != 5; ++i )
+            {
+                if ( state.hand( player, i ) == SKIP_BO_CARD )
+                    return SkipBoMove( SkipBoMove::PLAY, SkipBoMove::HAND, i, k );
+            }
+            for ( size_t i( 0 ); i != 4; ++i )
+            {
+                if ( state.discard_top( player, i ) == SKIP_BO_CARD )
+                    return SkipBoMove( SkipBoMove::PLAY, SkipBoMove::DISCARD_PILE, i, k );
+            }
+        }
+    }
+    // Discard the highest number, Skip-Bo cards only if there is nothing else
+    size_t card_index( 5 );
+    for ( size_t i( 0 ); i != 5; ++i )
+    {
+        const size_t card = state.hand( player, i );
+        if ( card == 0 )
+            continue;
+        if ( ( card_index == 5 ) || ( state.hand( player, card_index ) == SKIP_BO_CARD ) || ( ( card != SKIP_BO_CARD ) && ( card > state.hand( player, card_index ) ) ) )
+            card_index = i;
+    }
+    if ( card_index == 5 )
+        throw std::runtime_error( "SkipBoGreedyStrategy::choose_move(): hand is empty." );
+    const size_t card = state.hand( player, card_index );
+    size_t best_pile( 0 );
+    size_t best_score( 0 );
+    for ( size_t i( 0 ); i != 4; ++i )
+    {
+        const size_t top = state.discard_top( player, i );
+        size_t score( 1 );
+        if ( top == card )
+            score = 4;
+        else if ( top == 0 )
+            score = 3;
+        else if ( top > card )
+            score = 2;
+        if ( score > best_score )
+        {
+            best_score = score;
+            best_pile = i;
+        }
+    }
+    return SkipBoMove( SkipBoMove::DISCARD, SkipBoMove::HAND, card_index, best_pile );
+}
+
+// ********************************************************************************
+
+SkipBoMove SkipBoRandomStrategy::choose_move( const SkipBoState & state, Xoshiro256StarStar & rng ) const
+{
+    std::vector< SkipBoMove > moves = legal_skip_bo_moves( state );
+    if ( moves.empty() )
+        throw std::runtime_error( "SkipBoRandomStrategy::choose_move(): no legal moves." );
+    // The PLAY moves come first
+    size_t nplays( 0 );
+    while ( ( nplays != moves.size() ) && ( moves[nplays].kind_ == SkipBoMove::PLAY ) )
+        ++nplays;
+    if ( nplays != 0 )
+        return moves[ uniform( rng, nplays ) ];
+    return moves[ uniform( rng, moves.size() ) ];
+}
+
+// ********************************************************************************
+
+void deal_skip_bo( SkipBoState & state, const size_t nplayers, const size_t stock_pile_size, const size_t first_player, Xoshiro256StarStar & rng )
+{
+    if ( ( nplayers < 2 ) || ( nplayers > SKIP_BO_MAX_PLAYERS ) )
+        throw std::runtime_error( "deal_skip_bo(): number of players must be 2-6." );
+    if ( ( stock_pile_size == 0 ) || ( stock_pile_size > SKIP_BO_MAX_STOCK_PILE_SIZE ) )
+        throw std::runtime_error( "deal_skip_bo(): stock pile size must be 1-30." );
+    if ( first_player >= nplayers )
+        throw std::runtime_error( "deal_skip_bo(): first player out of range." );
+    state.nplayers_ = nplayers;
+    state.current_player_ = first_player;
+    size_t n( 0 );
+    for ( size_t i( 0 ); i != 18; ++i )
+        state.draw_pile_[n++] = SKIP_BO_CARD;
+    for ( size_t i( 0 ); i != 12; ++i )
+    {
+        for ( size_t j( 1 ); j != 13; ++j )
+            state.draw_pile_[n++] = static_cast<unsigned char>( j );
+    }
+    state.draw_pile_size_ = SKIP_BO_NCARDS;
+    shuffle( state.draw_pile_, state.draw_pile_size_, rng );
+    state.ncompleted_cards_ = 0;
+    for ( size_t i( 0 ); i != 4; ++i )
+        state.build_pile_sizes_[i] = 0;
+    for ( size_t i( 0 ); i != nplayers; ++i )
+    {
+        for ( size_t j( 0 ); j != stock_pile_size; ++j )
+            state.stock_piles_[i][j] = state.draw_pile_[ --state.draw_pile_size_ ];
+        state.stock_pile_sizes_[i] = stock_pile_size;
+        for ( size_t j( 0 ); j != 5; ++j )
+            state.hands_[i][j] = 0;
+        for ( size_t j( 0 ); j != 4; ++j )
+            state.discard_pile_sizes_[i][j] = 0;
+    }
+}
+
+// ********************************************************************************
+
+size_t play_skip_bo_game( const std::vector< const SkipBoStrategy * > & strategies, const size_t stock_pile_size, const size_t first_player,
+                          Xoshiro256StarStar & rng, const size_t max_turns, size_t & nturns )
+{
+    SkipBoState state;
+    deal_skip_bo( state, strategies.size(), stock_pile_size, first_player, rng );
+    size_t nturns_without_play( 0 );
+    for ( nturns = 1; nturns <= max_turns; ++nturns )
+    {
+        fill_hand( state, rng );
+        MoveResult result = hand_is_empty( state ) ? END_OF_TURN : CONTINUE_TURN;
+        bool card_played( false );
+        while ( result == CONTINUE_TURN )
+        {
+            const SkipBoMove move = strategies[ state.current_player_ ]->choose_move( state, rng );
+            card_played = card_played || ( move.kind_ == SkipBoMove::PLAY );
+            result = apply_move( state, move, rng );
+        }
+        if ( result == GAME_WON )
+            return state.current_player_;
+        // Blocked: no cards left to draw and a whole round without a card being played
+        nturns_without_play = card_played ? 0 : nturns_without_play + 1;
+        if ( ( state.draw_pile_size_ == 0 ) && ( state.ncompleted_cards_ == 0 ) && ( nturns_without_play >= state.nplayers_ ) )
+            return state.nplayers_;
+        state.current_player_ = ( state.current_player_ + 1 ) % state.nplayers_;
+    }
+    nturns = max_turns;
+    return state.nplayers_;
+}
+
+// ********************************************************************************
+
+std::string SkipBoTournamentResult::report( const std::vector< const SkipBoStrategy * > & strategies ) const
+{
+    std::string result = size_t2string( ngames_ ) + " games, " + size_t2string( nunfinished_games_ ) + " unfinished, average number of turns " + double2string( nturns_.average() );
+    for ( size_t i( 0 ); i != win_rates_.size(); ++i )
+    {
+        const double esd = ( ngames_ > 1 ) ? win_rates_[i].estimated_standard_deviation() / std::sqrt( static_cast<double>( ngames_ ) ) : 0.0;
+        result += "\nPlayer " + size_t2string( i ) + " (" + strategies[i]->name() + "): win rate " + double2string( win_rates_[i].average() ) + " (" + double2string( esd ) + ")";
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+SkipBoTournamentResult skip_bo_tournament( const std::vector< const SkipBoStrategy * > & strategies, const size_t stock_pile_size, const size_t ngames,
+                                          const uint64_t seed, const size_t nthreads, const size_t max_turns )
+{
+    const size_t nplayers = strategies.size();
+    if ( ( nplayers < 2 ) || ( nplayers > SKIP_BO_MAX_PLAYERS ) )
+        throw std::runtime_error( "skip_bo_tournament(): number of players must be 2-6." );
+    if ( ngames == 0 )
+        throw std::runtime_error( "skip_bo_tournament(): no games." );
+    // Fixed chunks, so that the order of merging does not depend on the number of threads
+    const size_t chunk_size( 256 );
+    const size_t nchunks = ( ngames + chunk_size - 1 ) / chunk_size;
+    std::vector< SkipBoTournamentResult > partial_results( nchunks );
+    parallel_for( nchunks, nthreads, [&]( const size_t chunk )
+    {
+        SkipBoTournamentResult & partial_result = partial_results[chunk];
+        const size_t end = std::min( ngames, ( chunk + 1 ) * chunk_size );
+        partial_result.win_rates_.resize( nplayers );
+        partial_result.ngames_ = end - chunk * chunk_size;
+        partial_result.nunfinished_games_ = 0;
+        for ( size_t game( chunk * chunk_size ); game != end; ++game )
+        {
+            Xoshiro256StarStar rng = game_generator( seed, game );
+            size_t nturns;
+            const size_t winner = play_skip_bo_game( strategies, stock_pile_size, game % nplayers, rng, max_turns, nturns );
+            for ( size_t i( 0 ); i != nplayers; ++i )
+                partial_result.win_rates_[i].add_value( ( i == winner ) ? 1.0 : 0.0 );
+            partial_result.nturns_.add_value( static_cast<double>( nturns ) );
+            if ( winner == nplayers )
+                ++partial_result.nunfinished_games_;
+        }
+    } );
+    SkipBoTournamentResult result;
+    result.win_rates_.resize( nplayers );
+    result.ngames_ = ngames;
+    result.nunfinished_games_ = 0;
+    for ( size_t chunk( 0 ); chunk != nchunks; ++chunk )
+    {
+        for ( size_t i( 0 ); i != nplayers; ++i )
+            result.win_rates_[i].merge( partial_results[chunk].win_rates_[i] );
+        result.nturns_.merge( partial_results[chunk].nturns_ );
+        result.nunfinished_games_ += partial_results[chunk].nunfinished_games_;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,155 @@
+#ifndef SKIPBOTOURNAMENT_H
+#define SKIPBOTOURNAMENT_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class Xoshiro256StarStar;
+
+#include "RunningAverageAndESD.h"
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+  Monte-Carlo engine for evaluating Skip-Bo strategies over many games.
+
+  Cards are 1-12 and 13 for a Skip-Bo (wild) card, 0 is no card, as in SkipBo.h. There are 162 cards: 12 of each number plus 18 Skip-Bo cards.
+  Each turn the player fills the hand up to five cards, then plays cards from the hand, the top of the stock pile or the tops
+  of the own four discard piles onto the four shared build piles (1 up to 12, a Skip-Bo card is any number), and ends
+  the turn by putting a card from the hand on one of the own discard piles. If the hand is emptied during the turn, five new cards are drawn.
+  Completed build piles are shuffled back when the draw pile runs out. The first player to empty the stock pile wins.
+*/
+
+const size_t SKIP_BO_CARD = 13;
+const size_t SKIP_BO_NCARDS = 162;
+const size_t SKIP_BO_MAX_PLAYERS = 6;
+const size_t SKIP_BO_MAX_STOCK_PILE_SIZE = 30;
+
+inline bool skip_bo_fits( const size_t card, const size_t value ) { return ( card == SKIP_BO_CARD ) || ( card == value ); }
+
+// The complete state of one game in fixed-size arrays, so that a game never allocates. The top of a pile is the last card.
+struct SkipBoState
+{
+    size_t nplayers_;
+    size_t current_player_;
+    unsigned char draw_pile_[SKIP_BO_NCARDS];
+    size_t draw_pile_size_;
+    unsigned char completed_cards_[SKIP_BO_NCARDS]; // From completed build piles
+    size_t ncompleted_cards_;
+    unsigned char build_piles_[4][12];
+    size_t build_pile_sizes_[4];
+    unsigned char stock_piles_[SKIP_BO_MAX_PLAYERS][SKIP_BO_MAX_STOCK_PILE_SIZE];
+    size_t stock_pile_sizes_[SKIP_BO_MAX_PLAYERS];
+    unsigned char hands_[SKIP_BO_MAX_PLAYERS][5]; // 0 is an empty slot
+    unsigned char discard_piles_[SKIP_BO_MAX_PLAYERS][4][SKIP_BO_NCARDS];
+    size_t discard_pile_sizes_[SKIP_BO_MAX_PLAYERS][4];
+
+    // The number that must be played next on build pile i.
+    size_t next_value( const size_t i ) const { return build_pile_sizes_[i] + 1; }
+    // 0 if empty
+    size_t stock_top( const size_t player ) const { return ( stock_pile_sizes_[player] == 0 ) ? 0 : stock_piles_[player][ stock_pile_sizes_[player] - 1 ]; }
+    // 0 if empty
+    size_t discard_top( const size_t player, const size_t i ) const { return ( discard_pile_sizes_[player][i] == 0 ) ? 0 : discard_piles_[player][i][ discard_pile_sizes_[player][i] - 1 ]; }
+    size_t hand( const size_t player, const size_t i ) const { return hands_[player][i]; }
+    // Total number of cards in the game, always SKIP_BO_NCARDS.
+    size_t ncards() const;
+};
+
+struct SkipBoMove
+{
+    // PLAY moves a card from source to build pile target_index_, DISCARD moves card source_index_ of the hand to discard pile target_index_ and ends the turn.
+    enum Kind { PLAY, DISCARD };
+    enum Source { HAND, STOCK_PILE, DISCARD_PILE };
+
+    SkipBoMove( const Kind kind, const Source source, const size_t source_index, const size_t target_index ):
+    kind_(kind), source_(source), source_index_(source_index), target_index_(target_index) {}
+
+    Kind kind_;
+    Source source_;
+    size_t source_index_; // Index into the hand or the discard piles, ignored for the stock pile
+    size_t target_index_;
+};
+
+// All legal moves of the current player, the PLAY moves first.
+std::vector< SkipBoMove > legal_skip_bo_moves( const SkipBoState & state );
+
+// A strategy is called repeatedly during a turn until it returns a DISCARD move. It must be thread-safe, i.e. choose_move()
+// may only use the random number generator that is passed in. The engine throws if the move is not legal.
+class SkipBoStrategy
+{
+public:
+    virtual ~SkipBoStrategy() {}
+    virtual std::string name() const = 0;
+    virtual SkipBoMove choose_move( const SkipBoState & state, Xoshiro256StarStar & rng ) const = 0;
+};
+
+// Plays the stock card if possible, then any number that fits (discard piles first), a Skip-Bo card only if it makes the stock card playable.
+// Discards the highest number onto the same number, an empty discard pile or a higher number.
+class SkipBoGreedyStrategy : public SkipBoStrategy
+{
+public:
+    std::string name() const { return "greedy"; }
+    SkipBoMove choose_move( const SkipBoState & state, Xoshiro256StarStar & rng ) const;
+};
+
+// Plays a random card that fits if there is one, otherwise discards a random card onto a random discard pile.
+class SkipBoRandomStrategy : public SkipBoStrategy
+{
+public:
+    std::string name() const { return "random"; }
+    SkipBoMove choose_move( const SkipBoState & state, Xoshiro256StarStar & rng ) const;
+};
+
+// Shuffles and deals, the hands are empty.
+void deal_skip_bo( SkipBoState & state, const size_t nplayers, const size_t stock_pile_size, const size_t first_player, Xoshiro256StarStar & rng );
+
+// Plays one game, strategy i plays for player i. Returns the winner, or nplayers if nobody has won after max_turns turns
+// or if the game is blocked: no cards left to draw and no card played for a whole round.
+size_t play_skip_bo_game( const std::vector< const SkipBoStrategy * > & strategies, const size_t stock_pile_size, const size_t first_player,
+                          Xoshiro256StarStar & rng, const size_t max_turns, size_t & nturns );
+
+struct SkipBoTournamentResult
+{
+    // win_rates_[i] has one value per game, 1.0 if player i won and 0.0 otherwise,
+    // so average() is the win rate and estimated_standard_deviation() / sqrt( ngames ) its ESD.
+    std::vector< RunningAverageAndESD< double > > win_rates_;
+    RunningAverageAndESD< double > nturns_;
+    size_t ngames_;
+    size_t nunfinished_games_;
+    std::string report( const std::vector< const SkipBoStrategy * > & strategies ) const;
+};
+
+// Plays ngames games on nthreads threads (0 means one per core). The starting player rotates. Game i uses its own random stream
+// derived from seed and i, and the statistics are merged in a fixed order, so the result does not depend on the number of threads.
+SkipBoTournamentResult skip_bo_tournament( const std::vector< const SkipBoStrategy * > & strategies, const size_t stock_pile_size, const size_t ngames,
+                                          const uint64_t seed, const size_t nthreads = 0, const size_t max_turns = 10000 );
+
+#endif // SKIPBOTOURNAMENT_H
+
@@ -0,0 +1,274 @@
+#ifndef SMALLVECTOR_H
+#define SMALLVECTOR_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+/*
+  A std::vector-like container that stores up to N elements inside the object itself and only goes to the heap
+  when it grows beyond that. Meant for the many short lists in the project (the atoms bonded to an atom,
+  the equivalents of a reflection, the stack of a backtracking algorithm) where one heap allocation per list
+  dominates the cost.
+
+  Only the part of the std::vector interface that we actually use is provided.
+  As for std::vector, pointers and iterators are invalidated when the size exceeds the capacity.
+  Unlike std::vector, they are also invalidated when a SmallVector is moved while its elements are stored inline.
+  T does not need a default constructor.
+*/
+template< class T, size_t N >
+class SmallVector
+{
+public:
+    static_assert( N != 0, "SmallVector: N must be at least 1." );
+
+    typedef T value_type;
+    typedef T * iterator;
+    typedef const T * const_iterator;
+
+    // Default constructor
+    SmallVector(): data_( inline_data() ), size_(0), capacity_(N) {}
+
+    explicit SmallVector( const size_t n, const T & value = T() ): data_( inline_data() ), size_(0), capacity_(N)
+    {
+        reserve( n );
+        for ( size_t i( 0 ); i != n; ++i )
+            push_back( value );
+    }
+
+    SmallVector( const SmallVector & rhs ): data_( inline_data() ), size_(0), capacity_(N)
+    {
+        reserve( rhs.size_ );
+        for ( size_t i( 0 ); i != rhs.size_; ++i )
+            ::new ( static_cast< void * >( data_ + i ) ) T( rhs.data_[i] );
+        size_ = rhs.size_;
+    }
+
+    SmallVector( SmallVector && rhs ) noexcept : data_( inline_data() ), size_(0), capacity_(N)
+    {
+        take( rhs );
+    }
+
+    SmallVector & operator=( const SmallVector & rhs )
+    {
+        if ( this != &rhs )
+        {
+            clear();
+            reserve( rhs.size_ );
+            for ( size_t i( 0 ); i != rhs.size_; ++i )
+                ::new ( static_cast< void * >( data_ + i ) ) T( rhs.data_[i] );
+            size_ = rhs.size_;
+        }
+        return *this;
+    }
+
+    SmallVector & operator=( SmallVector && rhs ) noexcept
+    {
+        if ( this != &rhs )
+        {
+            clear();
+            release();
+            take( rhs );
+        }
+        return *this;
+    }
+
+    ~SmallVector() { clear(); release(); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return ( size_ == 0 ); }
+    size_t capacity() const { return capacity_; }
+    // True if the elements are stored inside the object, i.e. no heap memory is in use
+    bool is_inline() const { return ( data_ == inline_data() ); }
+
+    T & operator[]( const size_t i ) { return data_[i]; }
+    const T & operator[]( const size_t i ) const { return data_[i]; }
+    T & at( const size_t i ) { check_index( i ); return data_[i]; }
+    const T & at( const size_t i ) const { check_index( i ); return data_[i]; }
+    T & front() { return data_[0]; }
+    const T & front() const { return data_[0]; }
+    T & back() { return data_[size_-1]; }
+    const T & back() const { return data_[size_-1]; }
+    T * data() { return data_; }
+    const T * data() const { return data_; }
+
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+
+    void push_back( const T & value )
+    {
+        if ( size_ == capacity_ )
+        {
+            // value may refer to one of our own elements
+            T copy( value );
+            grow( 2 * capacity_ );
+            ::new ( static_cast< void * >( data_ + size_ ) ) T( std::move( copy ) );
+        }
+        else
+            ::new ( static_cast< void * >( data_ + size_ ) ) T( value );
+        ++size_;
+    }
+
+    void push_back( T && value )
+    {
+        if ( size_ == capacity_ )
+        {
+            T copy( std::move( value ) );
+            grow( 2 * capacity_ );
+            ::new ( static_cast< void * >( data_ + size_ ) ) T( std::move( copy ) );
+        }
+        else
+            ::new ( static_cast< void * >( data_ + size_ ) ) T( std::move( value ) );
+        ++size_;
+    }
+
+    template< class... Args >
+    T & emplace_back( Args &&... args )
+    {
+        if ( size_ == capacity_ )
+        {
+            T copy( std::forward< Args >( args )... );
+            grow( 2 * capacity_ );
+            ::new ( static_cast< void * >( data_ + size_ ) ) T( std::move( copy ) );
+        }
+        else
+            ::new ( static_cast< void * >( data_ + size_ ) ) T( std::forward< Args >( args )... );
+        ++size_;
+        return back();
+    }
+
+    void pop_back()
+    {
+        if ( empty() )
+            throw std::runtime_error( "SmallVector::pop_back(): container empty." );
+        --size_;
+        data_[size_].~T();
+    }
+
+    // Removes the elements in [first, last) and returns an iterator to the element that followed them
+    iterator erase( iterator first, iterator last )
+    {
+        iterator new_end = std::move( last, end(), first );
+        for ( iterator it( new_end ); it != end(); ++it )
+            it->~T();
+        size_ -= ( last - first );
+        return first;
+    }
+
+    void clear()
+    {
+        for ( size_t i( 0 ); i != size_; ++i )
+            data_[i].~T();
+        size_ = 0;
+    }
+
+    void reserve( const size_t n )
+    {
+        if ( n > capacity_ )
+            grow( n );
+    }
+
+    void resize( const size_t n, const T & value = T() )
+    {
+        while ( n < size_ )
+            pop_back();
+        reserve( n );
+        while ( size_ < n )
+            push_back( value );
+    }
+
+private:
+    alignas( T ) unsigned char inline_storage_[ N * sizeof( T ) ];
+    T * data_;
+    size_t size_;
+    size_t capacity_;
+
+    T * inline_data() { return reinterpret_cast< T * >( inline_storage_ ); }
+    const T * inline_data() const { return reinterpret_cast< const T * >( inline_storage_ ); }
+
+    void check_index( const size_t i ) const
+    {
+        if ( i >= size_ )
+            throw std::runtime_error( "SmallVector::at(): index out of bounds." );
+    }
+
+    // Moves the elements to a heap buffer of new_capacity elements
+    void grow( const size_t new_capacity )
+    {
+        T * new_data = std::allocator< T >().allocate( new_capacity );
+        for ( size_t i( 0 ); i != size_; ++i )
+        {
+            ::new ( static_cast< void * >( new_data + i ) ) T( std::move( data_[i] ) );
+            data_[i].~T();
+        }
+        release();
+        data_ = new_data;
+        capacity_ = new_capacity;
+    }
+
+    // Frees the heap buffer, if any. Assumes the elements have already been destroyed.
+    void release()
+    {
+        if ( ! is_inline() )
+            std::allocator< T >().deallocate( data_, capacity_ );
+        data_ = inline_data();
+        capacity_ = N;
+    }
+
+    // Takes over the elements of rhs, leaves rhs empty. Assumes *this is empty and inline.
+    void take( SmallVector & rhs )
+    {
+        if ( rhs.is_inline() )
+        {
+            for ( size_t i( 0 ); i != rhs.size_; ++i )
+                ::new ( static_cast< void * >( data_ + i ) ) T( std::move( rhs.data_[i] ) );
+            size_ = rhs.size_;
+            rhs.clear();
+        }
+        else
+        {
+            data_ = rhs.data_;
+            size_ = rhs.size_;
+            capacity_ = rhs.capacity_;
+            rhs.data_ = rhs.inline_data();
+            rhs.size_ = 0;
+            rhs.capacity_ = N;
+        }
+    }
+};
+
+#endif // SMALLVECTOR_H
+
@@ -0,0 +1,94 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Sort.h"
+
+namespace
+{
+
+inline bool key_and_index_less( const KeyAndIndex & lhs, const KeyAndIndex & rhs )
+{
+    return ( lhs.key_ < rhs.key_ ) || ( ( lhs.key_ == rhs.key_ ) && ( lhs.index_ < rhs.index_ ) );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+// A least-significant-digit radix sort needs six scatter passes over all the data for a 64-bit key, and each scatter
+// to 2^8 or more places in memory turns out to be much slower than a copy. So we do one most-significant-digit pass
+// on the range that is actually used by the keys and sort the buckets with std::sort(). The index breaks ties, so the result
+// is the same as that of a stable sort.
+void radix_sort( std::vector< KeyAndIndex > & keys_and_indices, std::vector< KeyAndIndex > & buffer )
+{
+    const size_t n = keys_and_indices.size();
+    // The histogram costs more than sorting a short list
+    if ( n < 256 )
+    {
+        std::sort( keys_and_indices.begin(), keys_and_indices.end(), key_and_index_less );
+        return;
+    }
+    std::uint64_t min_key = keys_and_indices[0].key_;
+    std::uint64_t max_key = keys_and_indices[0].key_;
+    for ( size_t i( 1 ); i != n; ++i )
+    {
+        min_key = std::min( min_key, keys_and_indices[i].key_ );
+        max_key = std::max( max_key, keys_and_indices[i].key_ );
+    }
+    // All keys equal: the indices are already in order
+    if ( min_key == max_key )
+        return;
+    // About 16 keys per bucket, with at most 2^16 buckets so that the counters fit in the L2 cache
+    size_t radix_bits( 8 );
+    while ( ( radix_bits < 16 ) && ( ( n >> ( radix_bits + 4 ) ) != 0 ) )
+        ++radix_bits;
+    const size_t radix_size = size_t( 1 ) << radix_bits;
+    // The smallest shift for which ( max_key - min_key ) >> shift fits in radix_bits
+    size_t shift( 0 );
+    while ( ( ( max_key - min_key ) >> shift ) >= radix_size )
+        ++shift;
+    std::vector< size_t > offsets( radix_size + 1, 0 );
+    for ( size_t i( 0 ); i != n; ++i )
+        ++offsets[ ( ( keys_and_indices[i].key_ - min_key ) >> shift ) + 1 ];
+    for ( size_t i( 0 ); i != radix_size; ++i )
+        offsets[i+1] += offsets[i];
+    // offsets[i] is now the start of bucket i
+    buffer.resize( n );
+    std::vector< size_t > positions( offsets.begin(), offsets.end() - 1 );
+    for ( size_t i( 0 ); i != n; ++i )
+        buffer[ positions[ ( keys_and_indices[i].key_ - min_key ) >> shift ]++ ] = keys_and_indices[i];
+    for ( size_t i( 0 ); i != radix_size; ++i )
+    {
+        if ( offsets[i+1] - offsets[i] > 1 )
+            std::sort( buffer.begin() + offsets[i], buffer.begin() + offsets[i+1], key_and_index_less );
+    }
+    keys_and_indices.swap( buffer );
+}
+
+// ********************************************************************************
+
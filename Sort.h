@@ -39,28 +39,158 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // at the expense of some slight overhead in the form of a std::vector< size_t >
 // and the requirement that all elements in the original data structure must now be addressed as:
 // value = values[ sorted_map[i] ]; and values[ sorted_map[i] ] = value;
+//
+// For numbers, argsort() copies the keys next to their indices and sorts those (key, index) pairs,
+// so that the comparisons do not have to look up values[ sorted_map[i] ] all over memory. Keys of type
+// double and size_t are radix sorted. Equal keys always keep their original order, so the result is the
+// same as that of a std::stable_sort() on the indices. NaNs are not allowed.
 
+#include "ParallelFor.h"
 #include "Utilities.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
 
-template <class T>
-class Compare
+// For internal use only.
+struct KeyAndIndex
 {
-public:
+    std::uint64_t key_;
+    size_t index_;
+};
 
-    Compare( const std::vector< T > & values, const bool reverse_order = false ): values_(values),reverse_order_(reverse_order) {}
+// For internal use only.
+// Sorts on key_, ties are broken by index_: one most-significant-digit radix pass into buckets, then std::sort() per bucket.
+// buffer is scratch space.
+void radix_sort( std::vector< KeyAndIndex > & keys_and_indices, std::vector< KeyAndIndex > & buffer );
 
-    bool operator()( const size_t lhs, const size_t rhs ) { if ( reverse_order_ )
-                                                                return ( values_[rhs] < values_[lhs] );
-                                                            else
-                                                                return ( values_[lhs] < values_[rhs] );
-                                                          }
+// For internal use only.
+// Maps a number onto an unsigned integer with the same order.
+inline std::uint64_t radix_key( const size_t value ) { return value; }
 
-private:
-    const std::vector< T > & values_;
-    bool reverse_order_;
-};
+inline std::uint64_t radix_key( const double value )
+{
+    std::uint64_t bits;
+    std::memcpy( &bits, &value, sizeof( bits ) );
+    const std::uint64_t sign_bit = std::uint64_t( 1 ) << 63;
+    if ( bits == sign_bit ) // -0.0 == 0.0
+        bits = 0;
+    // Negative numbers: reverse the order, positive numbers: put them above the negative ones
+    return ( bits & sign_bit ) ? ~bits : ( bits | sign_bit );
+}
+
+template< class T >
+constexpr bool has_radix_key = std::is_same_v< T, double > || std::is_same_v< T, size_t >;
+
+// ********************************************************************************
+
+// For internal use only.
+// The sorted map of values[begin, end), written to result[0, end-begin).
+template< bool reverse_order, class T >
+void argsort_range( const std::vector< T > & values, const size_t begin, const size_t end, size_t * result )
+{
+    const size_t n = end - begin;
+    if constexpr ( has_radix_key< T > )
+    {
+        std::vector< KeyAndIndex > keys_and_indices( n );
+        for ( size_t i( 0 ); i != n; ++i )
+        {
+            keys_and_indices[i].key_ = reverse_order ? ~radix_key( values[begin+i] ) : radix_key( values[begin+i] );
+            keys_and_indices[i].index_ = begin + i;
+        }
+        std::vector< KeyAndIndex > buffer;
+        radix_sort( keys_and_indices, buffer );
+        for ( size_t i( 0 ); i != n; ++i )
+            result[i] = keys_and_indices[i].index_;
+    }
+    else if constexpr ( std::is_arithmetic_v< T > )
+    {
+        std::vector< std::pair< T, size_t > > keys_and_indices( n );
+        for ( size_t i( 0 ); i != n; ++i )
+            keys_and_indices[i] = std::make_pair( values[begin+i], begin + i );
+        // The index breaks ties, so std::sort() gives the same result as std::stable_sort()
+        std::sort( keys_and_indices.begin(), keys_and_indices.end(), []( const std::pair< T, size_t > & lhs, const std::pair< T, size_t > & rhs )
+        {
+            if ( lhs.first != rhs.first )
+                return reverse_order ? ( rhs.first < lhs.first ) : ( lhs.first < rhs.first );
+            return lhs.second < rhs.second;
+        } );
+        for ( size_t i( 0 ); i != n; ++i )
+            result[i] = keys_and_indices[i].second;
+    }
+    else
+    {
+        // Do not copy large objects
+        for ( size_t i( 0 ); i != n; ++i )
+            result[i] = begin + i;
+        std::stable_sort( result, result + n, [&values]( const size_t lhs, const size_t rhs )
+        {
+            return reverse_order ? ( values[rhs] < values[lhs] ) : ( values[lhs] < values[rhs] );
+        } );
+    }
+}
+
+// ********************************************************************************
+
+// The order is chosen at compile time: argsort< false >( values ) is ascending, argsort< true >( values ) descending.
+template< bool reverse_order, class T >
+std::vector< size_t > argsort( const std::vector< T > & values )
+{
+    std::vector< size_t > sorted_map( values.size() );
+    argsort_range< reverse_order >( values, 0, values.size(), sorted_map.data() );
+    return sorted_map;
+}
+
+// ********************************************************************************
+
+// Same result as argsort(), for millions of elements: blocks are sorted on nthreads threads (0 means one thread per core)
+// and then merged pairwise, also in parallel.
+template< bool reverse_order, class T >
+std::vector< size_t > parallel_argsort( const std::vector< T > & values, size_t nthreads = 0 )
+{
+    if ( nthreads == 0 )
+        nthreads = default_nthreads();
+    const size_t n = values.size();
+    const size_t nblocks = std::max( size_t( 1 ), std::min( nthreads, n / 10000 ) );
+    if ( nblocks == 1 )
+        return argsort< reverse_order >( values );
+    std::vector< size_t > block_starts( nblocks + 1 );
+    for ( size_t i( 0 ); i != nblocks + 1; ++i )
+        block_starts[i] = ( i * n ) / nblocks;
+    std::vector< size_t > sorted_map( n );
+    parallel_for( nblocks, nthreads, [&]( const size_t i )
+    {
+        argsort_range< reverse_order >( values, block_starts[i], block_starts[i+1], sorted_map.data() + block_starts[i] );
+    } );
+    // Merge neighbouring blocks until there is one left. The left block wins ties, and it has the lower indices.
+    std::vector< size_t > buffer( n );
+    auto less = [&values]( const size_t lhs, const size_t rhs )
+    {
+        return reverse_order ? ( values[rhs] < values[lhs] ) : ( values[lhs] < values[rhs] );
+    };
+    while ( block_starts.size() > 2 )
+    {
+        const size_t nmerges = ( block_starts.size() - 1 ) / 2;
+        parallel_for( nmerges, nthreads, [&]( const size_t i )
+        {
+            std::merge( sorted_map.begin() + block_starts[2*i], sorted_map.begin() + block_starts[2*i+1],
+                        sorted_map.begin() + block_starts[2*i+1], sorted_map.begin() + block_starts[2*i+2],
+                        buffer.begin() + block_starts[2*i], less );
+        } );
+        // An odd block out is copied as is
+        if ( ( block_starts.size() - 1 ) % 2 == 1 )
+            std::copy( sorted_map.begin() + block_starts[ block_starts.size() - 2 ], sorted_map.end(), buffer.begin() + block_starts[ block_starts.size() - 2 ] );
+        sorted_map.swap( buffer );
+        std::vector< size_t > new_block_starts;
+        for ( size_t i( 0 ); i < block_starts.size() - 1; i += 2 )
+            new_block_starts.push_back( block_starts[i] );
+        new_block_starts.push_back( n );
+        block_starts.swap( new_block_starts );
+    }
+    return sorted_map;
+}
 
 // ********************************************************************************
 
@@ -68,13 +198,9 @@ template <class T>
 std::vector< size_t > sort( const std::vector< T > & values, const bool reverse_order = false )
 {
     // We don't actually sort the list, but create a sorted map
-    // We use std::stable_sort() with a functor
-    std::vector< size_t > sorted_map = initialise_with_sequential_values( values.size() );
-    std::stable_sort( sorted_map.begin(), sorted_map.end(), Compare<T>( values, reverse_order ) );
-    return sorted_map;
+    return reverse_order ? argsort< true >( values ) : argsort< false >( values );
 }
 
 // ********************************************************************************
 
 #endif // SORT_H
-
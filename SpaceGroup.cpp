@@ -26,13 +26,80 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "SpaceGroup.h"
+#include "3DCalculations.h"
+#include "IntegerSymmetryOperator.h"
+#include "MathFunctions.h"
+#include "MillerIndices.h"
 #include "PointGroup.h"
+#include "SpaceGroupTables.h"
 #include "Utilities.h"
 
+#include <mutex>
 #include <stdexcept>
 
 #include <iostream> // for debugging
 
+namespace
+{
+
+// The rotation matrices of the Hall symbols. axis is 'x', 'y', 'z' or '*' (the body diagonal),
+// prime is ' ' or one of the face diagonals '\'' ( a-b for axis z ) and '"' ( a+b for axis z ).
+Matrix3D Hall_rotation( const char axis, const char prime, const char order, const std::string & Hall_symbol )
+{
+    if ( order == '1' )
+        return Matrix3D();
+    if ( axis == '*' )
+    {
+        if ( order == '3' )
+            return Matrix3D( 0.0, 0.0, 1.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0 );
+    }
+    else if ( prime != ' ' )
+    {
+        if ( order == '2' )
+        {
+            const double sign = ( prime == '"' ) ? 1.0 : -1.0;
+            if ( axis == 'x' )
+                return Matrix3D( -1.0, 0.0, 0.0, 0.0, 0.0, sign, 0.0, sign, 0.0 );
+            if ( axis == 'y' )
+                return Matrix3D( 0.0, 0.0, sign, 0.0, -1.0, 0.0, sign, 0.0, 0.0 );
+            return Matrix3D( 0.0, sign, 0.0, sign, 0.0, 0.0, 0.0, 0.0, -1.0 );
+        }
+    }
+    else if ( axis == 'x' )
+    {
+        switch ( order )
+        {
+            case '2' : return Matrix3D( 1.0, 0.0, 0.0, 0.0, -1.0,  0.0, 0.0, 0.0, -1.0 );
+            case '3' : return Matrix3D( 1.0, 0.0, 0.0, 0.0,  0.0, -1.0, 0.0, 1.0, -1.0 );
+            case '4' : return Matrix3D( 1.0, 0.0, 0.0, 0.0,  0.0, -1.0, 0.0, 1.0,  0.0 );
+            case '6' : return Matrix3D( 1.0, 0.0, 0.0, 0.0,  1.0, -1.0, 0.0, 1.0,  0.0 );
+        }
+    }
+    else if ( axis == 'y' )
+    {
+        switch ( order )
+        {
+            case '2' : return Matrix3D( -1.0, 0.0, 0.0, 0.0, 1.0, 0.0,  0.0, 0.0, -1.0 );
+            case '3' : return Matrix3D( -1.0, 0.0, 1.0, 0.0, 1.0, 0.0, -1.0, 0.0,  0.0 );
+            case '4' : return Matrix3D(  0.0, 0.0, 1.0, 0.0, 1.0, 0.0, -1.0, 0.0,  0.0 );
+            case '6' : return Matrix3D(  0.0, 0.0, 1.0, 0.0, 1.0, 0.0, -1.0, 0.0,  1.0 );
+        }
+    }
+    else
+    {
+        switch ( order )
+        {
+            case '2' : return Matrix3D( -1.0,  0.0, 0.0,  0.0, -1.0, 0.0, 0.0, 0.0, 1.0 );
+            case '3' : return Matrix3D(  0.0, -1.0, 0.0,  1.0, -1.0, 0.0, 0.0, 0.0, 1.0 );
+            case '4' : return Matrix3D(  0.0, -1.0, 0.0,  1.0,  0.0, 0.0, 0.0, 0.0, 1.0 );
+            case '6' : return Matrix3D(  1.0, -1.0, 0.0,  1.0,  0.0, 0.0, 0.0, 0.0, 1.0 );
+        }
+    }
+    throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): rotation not allowed along this axis: " + Hall_symbol );
+}
+
+} // namespace
+
 // ********************************************************************************
 
 SpaceGroup::SpaceGroup()
@@ -85,6 +152,156 @@ SpaceGroup SpaceGroup::P21c()
 
 // ********************************************************************************
 
+SpaceGroup SpaceGroup::from_number( const size_t number )
+{
+    const SpaceGroupData & data = space_group_data( number );
+    static std::mutex cache_mutex;
+    static std::vector< SpaceGroup > cache( 230 );
+    static std::vector< bool > is_cached( 230, false );
+    std::lock_guard< std::mutex > lock( cache_mutex );
+    if ( ! is_cached[ number - 1 ] )
+    {
+        cache[ number - 1 ] = from_Hall_symbol( data.Hall, data.Hermann_Mauguin );
+        is_cached[ number - 1 ] = true;
+    }
+    return cache[ number - 1 ];
+}
+
+// ********************************************************************************
+
+SpaceGroup SpaceGroup::from_Hall_symbol( const std::string & Hall_symbol, const std::string & name )
+{
+    const size_t iPos = Hall_symbol.find( '(' );
+    std::vector< std::string > words = split( Hall_symbol.substr( 0, iPos ) );
+    if ( words.empty() )
+        throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): empty Hall symbol." );
+    std::vector< SymmetryOperator > generators;
+    // The lattice symbol, preceded by a minus sign if the space group is centrosymmetric
+    std::string lattice_symbol = words[0];
+    if ( ( lattice_symbol.length() == 2 ) && ( lattice_symbol[0] == '-' ) )
+    {
+        generators.push_back( SymmetryOperator( Matrix3D( -1.0 ), Vector3D() ) );
+        lattice_symbol.erase( 0, 1 );
+    }
+    if ( lattice_symbol.length() != 1 )
+        throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): lattice symbol not recognised: " + Hall_symbol );
+    std::vector< Vector3D > centring_vectors;
+    switch ( to_upper( lattice_symbol[0] ) )
+    {
+        case 'P' : break;
+        case 'A' : centring_vectors.push_back( Vector3D( 0.0, 0.5, 0.5 ) ); break;
+        case 'B' : centring_vectors.push_back( Vector3D( 0.5, 0.0, 0.5 ) ); break;
+        case 'C' : centring_vectors.push_back( Vector3D( 0.5, 0.5, 0.0 ) ); break;
+        case 'I' : centring_vectors.push_back( Vector3D( 0.5, 0.5, 0.5 ) ); break;
+        case 'R' : centring_vectors.push_back( Vector3D( 2.0/3.0, 1.0/3.0, 1.0/3.0 ) );
+                   centring_vectors.push_back( Vector3D( 1.0/3.0, 2.0/3.0, 2.0/3.0 ) ); break;
+        case 'F' : centring_vectors.push_back( Vector3D( 0.0, 0.5, 0.5 ) );
+                   centring_vectors.push_back( Vector3D( 0.5, 0.0, 0.5 ) );
+                   centring_vectors.push_back( Vector3D( 0.5, 0.5, 0.0 ) ); break;
+        default  : throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): lattice symbol not recognised: " + Hall_symbol );
+    }
+    for ( size_t i( 0 ); i != centring_vectors.size(); ++i )
+        generators.push_back( SymmetryOperator( Matrix3D(), centring_vectors[i] ) );
+    // The matrix symbols: [-]N[axis][screw][translations]
+    char previous_order( ' ' );
+    char previous_axis( ' ' );
+    for ( size_t i( 1 ); i != words.size(); ++i )
+    {
+        const std::string & word = words[i];
+        size_t j( 0 );
+        const bool improper = ( word[j] == '-' );
+        if ( improper )
+            ++j;
+        if ( ( j == word.length() ) || ( std::string( "12346" ).find( word[j] ) == std::string::npos ) )
+            throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): rotation order not recognised: " + Hall_symbol );
+        const char order = word[j++];
+        char axis( ' ' );
+        char prime( ' ' );
+        if ( ( j != word.length() ) && ( std::string( "xyz" ).find( word[j] ) != std::string::npos ) )
+            axis = word[j++];
+        if ( ( j != word.length() ) && ( std::string( "'\"*" ).find( word[j] ) != std::string::npos ) )
+        {
+            if ( word[j] == '*' )
+                axis = '*';
+            else
+                prime = word[j];
+            ++j;
+        }
+        // Default axes
+        if ( axis == ' ' )
+        {
+            if ( i == 1 )
+                axis = 'z';
+            else if ( prime != ' ' )
+                axis = previous_axis;
+            else if ( ( i == 2 ) && ( order == '2' ) && ( ( previous_order == '2' ) || ( previous_order == '4' ) ) )
+                axis = 'x';
+            else if ( ( i == 2 ) && ( order == '2' ) && ( ( previous_order == '3' ) || ( previous_order == '6' ) ) )
+            {
+                axis = previous_axis;
+                prime = '\'';
+            }
+            else if ( ( i == 3 ) && ( order == '3' ) )
+                axis = '*';
+            else if ( order != '1' )
+                throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): axis cannot be deduced: " + Hall_symbol );
+        }
+        Matrix3D rotation = Hall_rotation( axis, prime, order, Hall_symbol );
+        if ( improper )
+            rotation = -1.0 * rotation;
+        Vector3D translation;
+        if ( ( j != word.length() ) && ( word[j] >= '1' ) && ( word[j] <= '5' ) )
+        {
+            if ( ( axis != 'x' ) && ( axis != 'y' ) && ( axis != 'z' ) )
+                throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): screw component only allowed along x, y or z: " + Hall_symbol );
+            translation.set_value( axis - 'x', static_cast< double >( word[j] - '0' ) / static_cast< double >( order - '0' ) );
+            ++j;
+        }
+        for ( ; j != word.length(); ++j )
+        {
+            switch ( word[j] )
+            {
+                case 'a' : translation += Vector3D( 0.5 , 0.0 , 0.0  ); break;
+                case 'b' : translation += Vector3D( 0.0 , 0.5 , 0.0  ); break;
+                case 'c' : translation += Vector3D( 0.0 , 0.0 , 0.5  ); break;
+                case 'n' : translation += Vector3D( 0.5 , 0.5 , 0.5  ); break;
+                case 'u' : translation += Vector3D( 0.25, 0.0 , 0.0  ); break;
+                case 'v' : translation += Vector3D( 0.0 , 0.25, 0.0  ); break;
+                case 'w' : translation += Vector3D( 0.0 , 0.0 , 0.25 ); break;
+                case 'd' : translation += Vector3D( 0.25, 0.25, 0.25 ); break;
+                default  : throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): translation symbol not recognised: " + Hall_symbol );
+            }
+        }
+        generators.push_back( SymmetryOperator( rotation, translation ) );
+        previous_order = order;
+        previous_axis = axis;
+    }
+    std::vector< IntegerSymmetryOperator > integer_generators;
+    if ( ! to_integer_symmetry_operators( generators, integer_generators ) )
+        throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): unexpected generator: " + Hall_symbol );
+    const std::vector< IntegerSymmetryOperator > integer_symmetry_operators = generate_group( integer_generators );
+    std::vector< SymmetryOperator > symmetry_operators;
+    symmetry_operators.reserve( integer_symmetry_operators.size() );
+    for ( size_t i( 0 ); i != integer_symmetry_operators.size(); ++i )
+        symmetry_operators.push_back( integer_symmetry_operators[i].to_symmetry_operator() );
+    SpaceGroup result( symmetry_operators, name );
+    // The change-of-origin vector
+    if ( iPos != std::string::npos )
+    {
+        const size_t iPos2 = Hall_symbol.find( ')', iPos );
+        if ( iPos2 == std::string::npos )
+            throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): missing ): " + Hall_symbol );
+        std::vector< std::string > shift = split( Hall_symbol.substr( iPos + 1, iPos2 - ( iPos + 1 ) ) );
+        if ( shift.size() != 3 )
+            throw std::runtime_error( "SpaceGroup::from_Hall_symbol(): change-of-origin vector must have three elements: " + Hall_symbol );
+        Vector3D origin_shift( string2integer( shift[0] ) / 12.0, string2integer( shift[1] ) / 12.0, string2integer( shift[2] ) / 12.0 );
+        result.apply_similarity_transformation( SymmetryOperator( Matrix3D(), origin_shift ) );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
 void SpaceGroup::add_inversion_at_origin()
 {
     if ( has_inversion_at_origin_ )
@@ -154,33 +371,18 @@ void SpaceGroup::remove_duplicate_symmetry_operators()
 
 // ********************************************************************************
 
-// The point group of a space group is the sum of all symmetry operators with the translations removed
-PointGroup SpaceGroup::point_group() const
+bool SpaceGroup::is_systematic_absence( const MillerIndices & miller_indices ) const
 {
-    std::vector< Matrix3D > rotations;
-    if ( has_inversion_ )
-        rotations.reserve( 2 * representative_symmetry_operators_.size() );
-    else
-        rotations.reserve( representative_symmetry_operators_.size() );
-    for ( size_t i( 0 ); i != representative_symmetry_operators_.size(); ++i )
+    // The first symmetry operator is the identity
+    for ( size_t i( 1 ); i != symmetry_operators_.size(); ++i )
     {
-        rotations.push_back( representative_symmetry_operators_[i].rotation() );
-        if ( has_inversion_ )
-            rotations.push_back( -1.0 * representative_symmetry_operators_[i].rotation() );
+        if ( ! ( miller_indices * symmetry_operators_[i].rotation() == miller_indices ) )
+            continue;
+        double phase_shift = miller_indices * symmetry_operators_[i].translation();
+        if ( ! nearly_equal( phase_shift, round_to_int( phase_shift ), 0.05 ) )
+            return true;
     }
-    PointGroup result( rotations );
-    return result;
-}
-
-// ********************************************************************************
-
-// The point group augmented with the inversion.
-PointGroup SpaceGroup::laue_class() const
-{
-    PointGroup result = point_group();
-    if ( ! has_inversion_ )
-        result.add_inversion();
-    return result;
+    return false;
 }
 
 // ********************************************************************************
@@ -308,6 +510,18 @@ void SpaceGroup::decompose()
         if ( ! found )
             representative_symmetry_operators_.push_back( symmetry_operators_[i] );
     }
+    // The point group is the sum of all symmetry operators with the translations removed
+    std::vector< Matrix3D > rotations;
+    rotations.reserve( ( has_inversion_ ? 2 : 1 ) * representative_symmetry_operators_.size() );
+    for ( size_t i( 0 ); i != representative_symmetry_operators_.size(); ++i )
+    {
+        rotations.push_back( representative_symmetry_operators_[i].rotation() );
+        if ( has_inversion_ )
+            rotations.push_back( -1.0 * representative_symmetry_operators_[i].rotation() );
+    }
+    point_group_ = PointGroup( rotations );
+    laue_class_ = point_group_;
+    laue_class_.add_inversion();
 }
 
 // ********************************************************************************
@@ -350,6 +564,14 @@ bool same_symmetry_operators( const SpaceGroup & lhs, const SpaceGroup & rhs )
 
 void check_if_closed( const std::vector< SymmetryOperator > & symmetry_operators )
 {
+    // Nearly all space groups can be represented exactly with integers, which allows a hash table to be used
+    std::vector< IntegerSymmetryOperator > integer_symmetry_operators;
+    if ( to_integer_symmetry_operators( symmetry_operators, integer_symmetry_operators ) )
+    {
+        if ( ! is_closed( integer_symmetry_operators ) )
+            throw std::runtime_error( "check_if_closed( std::vector< SymmetryOperator > ): operator not found." );
+        return;
+    }
     for ( size_t i( 0 ); i != symmetry_operators.size(); ++i )
     {
         for ( size_t j( 0 ); j != symmetry_operators.size(); ++j )
@@ -28,13 +28,14 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "PointGroup.h"
 #include "SymmetryOperator.h"
 
 #include <vector>
 #include <string>
 #include <iosfwd>
 
-class PointGroup;
+class MillerIndices;
 
 /*
   A space group.
@@ -43,6 +44,8 @@ class PointGroup;
 
   SpaceGroup space_group = SpaceGroup::P21c();
 
+  Any of the 230 space groups in its standard setting can be obtained with e.g. SpaceGroup::from_number( 62 ).
+
   For e.g. space group P-1, use:
 
   SpaceGroup space_group;
@@ -62,6 +65,13 @@ public:
 
     static SpaceGroup P21c();
 
+    // Space group 1-230 in its standard setting, see SpaceGroupTables.h.
+    // Each space group is generated once, later calls return a copy of the cached space group.
+    static SpaceGroup from_number( const size_t number );
+
+    // E.g. "-P 2ybc" for P21/c or "P 31 2c (0 0 1)" for P3112. The origin shift is in units of 1/12.
+    static SpaceGroup from_Hall_symbol( const std::string & Hall_symbol, const std::string & name = "" );
+
     // Allows quick building of space groups
     void add_inversion_at_origin();
 
@@ -70,12 +80,9 @@ public:
 
     size_t nsymmetry_operators() const { return symmetry_operators_.size(); }
 
-    SymmetryOperator symmetry_operator( const size_t i ) const { return symmetry_operators_[i]; }
+    const SymmetryOperator & symmetry_operator( const size_t i ) const { return symmetry_operators_[i]; }
     
-    std::vector< SymmetryOperator > symmetry_operators() const { return symmetry_operators_; }
-
-// The following would avoid the unnecessary copying of symmetry operators as forced by the member function SymmetryOperator symmetry_operator( const size_t i ) const; .
-//    Vector3D apply_symmetry_operator( const size_t i, const Vector3D & vector ) const { return symmetry_operators_[i] * vector; }
+    const std::vector< SymmetryOperator > & symmetry_operators() const { return symmetry_operators_; }
 
     std::string name() const { return name_; }
     void set_name( const std::string & name ) { name_ = name; }
@@ -94,15 +101,23 @@ public:
     void remove_duplicate_symmetry_operators();
 
     // The point group of a space group is the sum of all symmetry operators with the translations removed
-    PointGroup point_group() const;
+    // Calculated once by decompose().
+    const PointGroup & point_group() const { return point_group_; }
     
     // The point group augmented with the inversion.
-    PointGroup laue_class() const;
+    // Calculated once by decompose().
+    const PointGroup & laue_class() const { return laue_class_; }
 
     std::string crystal_system() const;
 
+    // True if a symmetry operator leaves (hkl) invariant but its translation gives a non-integer phase shift h.t.
+    bool is_systematic_absence( const MillerIndices & miller_indices ) const;
+
     // Does not include [ 0.0, 0.0, 0.0 ]
-    std::vector< Vector3D > centring_vectors() const { return centring_vectors_; }
+    const std::vector< Vector3D > & centring_vectors() const { return centring_vectors_; }
+
+    // One symmetry operator for each rotation, with the centrings and the inversion factored out.
+    const std::vector< SymmetryOperator > & representative_symmetry_operators() const { return representative_symmetry_operators_; }
 
 private:
     std::vector< SymmetryOperator > symmetry_operators_;
@@ -112,6 +127,8 @@ private:
     bool has_inversion_at_origin_;
     Vector3D position_of_inversion_;
     std::string name_;
+    PointGroup point_group_;
+    PointGroup laue_class_;
 
     void decompose();
 
@@ -125,7 +142,7 @@ std::ostream & operator<<( std::ostream & os, const SpaceGroup & space_group );
 bool same_symmetry_operators( const SpaceGroup & lhs, const SpaceGroup & rhs );
 
 // Multiplies all combinations (both ways) and checks that the result is in the symmetry operators
-// This can take a lot of time
+// If the symmetry operators can be represented as IntegerSymmetryOperators this is fast, otherwise it can take a lot of time
 // Currently throws if not successful, should probably return bool.
 // Should not only check if the result if a symmetry operator that is in the set, but should
 // calculate the entire multiplication table which has as an additional condition that each
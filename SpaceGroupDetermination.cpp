@@ -0,0 +1,263 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SpaceGroupDetermination.h"
+#include "MathConstants.h"
+#include "MathFunctions.h"
+#include "Matrix3D.h"
+#include "MillerIndices.h"
+#include "ReflectionList.h"
+#include "SpaceGroupTables.h"
+#include "SymmetryOperator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+
+// The reflections that are used for the local mean intensity are the 2 * local_window + 1 nearest ones.
+const size_t local_window = 10;
+
+// ln( Phi( x ) ), the logarithm of the standard normal cumulative distribution function, also for large negative x.
+double log_normal_cdf( const double x )
+{
+    if ( x > -30.0 )
+        return std::log( 0.5 * std::erfc( -x / std::sqrt( 2.0 ) ) );
+    // Asymptotic expansion, Phi( x ) = phi( x ) / |x| ( 1 - 1/x^2 + ... )
+    return -0.5 * x * x - std::log( -x ) - 0.5 * std::log( 2.0 * CONSTANT_PI ) + std::log1p( -1.0 / ( x * x ) );
+}
+
+// The transformation matrix in the convention of CrystalStructure::transform(): the rows are the new basis vectors in terms of the old ones.
+SpaceGroup transformed_space_group( const SpaceGroup & space_group, const Matrix3D & transformation_matrix )
+{
+    Matrix3D transformation_matrix_inverse_transpose( transformation_matrix );
+    transformation_matrix_inverse_transpose.invert();
+    transformation_matrix_inverse_transpose.transpose();
+    SpaceGroup result( space_group );
+    result.apply_similarity_transformation( SymmetryOperator( transformation_matrix_inverse_transpose, Vector3D() ) );
+    return result;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+SpaceGroupDetermination::SpaceGroupDetermination( const ReflectionList & reflection_list, const CrystalLattice::LatticeSystem lattice_system ):
+nreflections_( reflection_list.size() ),
+relative_ESD_( 0.1 ),
+overlap_tolerance_( 0.0005 ),
+ncandidates_( 0 )
+{
+    for ( size_t i( 0 ); i != nreflections_; ++i )
+    {
+        F_squared_.push_back( reflection_list.F_squared( i ) );
+        d_spacings_.push_back( reflection_list.d_spacing( i ) );
+    }
+    std::vector< std::string > crystal_systems;
+    switch ( lattice_system )
+    {
+        case CrystalLattice::TRICLINIC    : crystal_systems.push_back( "triclinic" ); break;
+        case CrystalLattice::MONOCLINIC   : crystal_systems.push_back( "monoclinic" ); break;
+        case CrystalLattice::ORTHORHOMBIC : crystal_systems.push_back( "orthorhombic" ); break;
+        case CrystalLattice::TETRAGONAL   : crystal_systems.push_back( "tetragonal" ); break;
+        case CrystalLattice::TRIGONAL     :
+        case CrystalLattice::HEXAGONAL    : crystal_systems.push_back( "trigonal" ); crystal_systems.push_back( "hexagonal" ); break;
+        case CrystalLattice::CUBIC        : crystal_systems.push_back( "cubic" ); break;
+        default : throw std::runtime_error( "SpaceGroupDetermination::SpaceGroupDetermination(): rhombohedral axes are not supported, use hexagonal axes." );
+    }
+    // Rows are the new basis vectors in terms of the old ones
+    const Matrix3D cell_choices[ 3 ] = { Matrix3D(),
+                                         Matrix3D( -1.0, 0.0, -1.0,  0.0, 1.0, 0.0,  1.0, 0.0,  0.0 ),
+                                         Matrix3D(  0.0, 0.0,  1.0,  0.0, 1.0, 0.0, -1.0, 0.0, -1.0 ) };
+    const std::string cell_choice_names[ 3 ] = { "", " (cell choice 2)", " (cell choice 3)" };
+    const Matrix3D axis_permutations[ 6 ] = { Matrix3D(),
+                                              Matrix3D(  0.0, 1.0, 0.0,  1.0,  0.0, 0.0, 0.0, 0.0, -1.0 ),
+                                              Matrix3D(  0.0, 0.0, 1.0,  1.0,  0.0, 0.0, 0.0, 1.0,  0.0 ),
+                                              Matrix3D(  0.0, 0.0, -1.0, 0.0,  1.0, 0.0, 1.0, 0.0,  0.0 ),
+                                              Matrix3D(  0.0, 1.0, 0.0,  0.0,  0.0, 1.0, 1.0, 0.0,  0.0 ),
+                                              Matrix3D(  1.0, 0.0, 0.0,  0.0,  0.0, -1.0, 0.0, 1.0, 0.0 ) };
+    const std::string axis_permutation_names[ 6 ] = { "", " (ba-c)", " (cab)", " (-cba)", " (bca)", " (a-cb)" };
+    for ( size_t i( 0 ); i != 230; ++i )
+    {
+        const std::string crystal_system = point_groups[ space_groups[i].point_group ].crystal_system;
+        if ( std::find( crystal_systems.begin(), crystal_systems.end(), crystal_system ) == crystal_systems.end() )
+            continue;
+        const SpaceGroup space_group = SpaceGroup::from_number( space_groups[i].number );
+        const std::string name = space_groups[i].Hermann_Mauguin;
+        if ( crystal_system == "monoclinic" )
+        {
+            for ( size_t j( 0 ); j != 3; ++j )
+                add_candidate( transformed_space_group( space_group, cell_choices[j] ), name + cell_choice_names[j], reflection_list );
+        }
+        else if ( crystal_system == "orthorhombic" )
+        {
+            for ( size_t j( 0 ); j != 6; ++j )
+                add_candidate( transformed_space_group( space_group, axis_permutations[j] ), name + axis_permutation_names[j], reflection_list );
+        }
+        else
+            add_candidate( space_group, name, reflection_list );
+    }
+}
+
+// ********************************************************************************
+
+void SpaceGroupDetermination::add_candidate( const SpaceGroup & space_group, const std::string & name, const ReflectionList & reflection_list )
+{
+    ++ncandidates_;
+    std::vector< uint64_t > absence_mask( ( nreflections_ + 63 ) / 64, 0 );
+    for ( size_t i( 0 ); i != nreflections_; ++i )
+    {
+        if ( space_group.is_systematic_absence( reflection_list.miller_indices( i ) ) )
+            absence_mask[ i / 64 ] |= uint64_t( 1 ) << ( i % 64 );
+    }
+    for ( size_t i( 0 ); i != absence_masks_.size(); ++i )
+    {
+        if ( absence_masks_[i] == absence_mask )
+        {
+            // Different settings of the same space group often have the same absences
+            if ( std::find( extinction_groups_[i].space_group_names_.begin(), extinction_groups_[i].space_group_names_.end(), name ) == extinction_groups_[i].space_group_names_.end() )
+            {
+                extinction_groups_[i].space_group_names_.push_back( name );
+                extinction_groups_[i].space_groups_.push_back( space_group );
+            }
+            return;
+        }
+    }
+    ExtinctionGroup extinction_group;
+    extinction_group.space_group_names_.push_back( name );
+    extinction_group.space_groups_.push_back( space_group );
+    for ( size_t j( 0 ); j != absence_mask.size(); ++j )
+        extinction_group.nabsent_ += __builtin_popcountll( absence_mask[j] );
+    extinction_groups_.push_back( extinction_group );
+    absence_masks_.push_back( absence_mask );
+}
+
+// ********************************************************************************
+
+void SpaceGroupDetermination::set_estimated_standard_deviations( const std::vector< double > & estimated_standard_deviations )
+{
+    if ( estimated_standard_deviations.size() != nreflections_ )
+        throw std::runtime_error( "SpaceGroupDetermination::set_estimated_standard_deviations(): wrong number of ESDs." );
+    estimated_standard_deviations_ = estimated_standard_deviations;
+}
+
+// ********************************************************************************
+
+std::vector< ExtinctionGroup > SpaceGroupDetermination::determine() const
+{
+    std::vector< ExtinctionGroup > result( extinction_groups_ );
+    if ( result.empty() || ( nreflections_ == 0 ) )
+        return result;
+    const size_t nwords = absence_masks_[0].size();
+    // Reflections that are absent in some candidate carry the information, the others give the local mean intensity
+    std::vector< uint64_t > absent_in_any( nwords, 0 );
+    for ( size_t i( 0 ); i != absence_masks_.size(); ++i )
+    {
+        for ( size_t j( 0 ); j != nwords; ++j )
+            absent_in_any[j] |= absence_masks_[i][j];
+    }
+    std::vector< uint64_t > usable( nwords, 0 );
+    for ( size_t i( 0 ); i != nreflections_; ++i )
+    {
+        const bool overlaps = ( ( i != 0 ) && ( std::abs( d_spacings_[i] - d_spacings_[i-1] ) <= overlap_tolerance_ * d_spacings_[i] ) ) ||
+                              ( ( i + 1 != nreflections_ ) && ( std::abs( d_spacings_[i+1] - d_spacings_[i] ) <= overlap_tolerance_ * d_spacings_[i] ) );
+        if ( ! overlaps )
+            usable[ i / 64 ] |= uint64_t( 1 ) << ( i % 64 );
+    }
+    std::vector< size_t > general_reflections;
+    for ( size_t i( 0 ); i != nreflections_; ++i )
+    {
+        if ( ! ( ( absent_in_any[ i / 64 ] >> ( i % 64 ) ) & 1 ) )
+            general_reflections.push_back( i );
+    }
+    if ( general_reflections.empty() )
+    {
+        for ( size_t i( 0 ); i != nreflections_; ++i )
+            general_reflections.push_back( i );
+    }
+    // The difference between the log-likelihoods of each reflection being absent and being present
+    std::vector< double > differences( nreflections_, 0.0 );
+    std::vector< bool > is_observed( nreflections_ );
+    double log_likelihood_all_present( 0.0 );
+    for ( size_t i( 0 ); i != nreflections_; ++i )
+    {
+        // The list is sorted by d-spacing, so the nearest general reflections in the list are the nearest in d-spacing
+        const size_t position = std::lower_bound( general_reflections.begin(), general_reflections.end(), i ) - general_reflections.begin();
+        const size_t begin = ( position > local_window ) ? position - local_window : 0;
+        const size_t end = std::min( begin + 2 * local_window + 1, general_reflections.size() );
+        double mean( 0.0 );
+        for ( size_t j( begin ); j != end; ++j )
+            mean += std::max( F_squared_[ general_reflections[j] ], 0.0 );
+        mean /= ( end - begin );
+        if ( ! ( mean > 0.0 ) )
+            mean = 1.0;
+        double sigma = estimated_standard_deviations_.empty() ? relative_ESD_ * mean : estimated_standard_deviations_[i];
+        if ( ! ( sigma > 0.0 ) )
+            sigma = relative_ESD_ * mean;
+        const double I = F_squared_[i];
+        is_observed[i] = ( I > 3.0 * sigma );
+        if ( ! ( ( usable[ i / 64 ] >> ( i % 64 ) ) & 1 ) )
+            continue;
+        const double log_absent = -0.5 * std::log( 2.0 * CONSTANT_PI ) - std::log( sigma ) - square( I / sigma ) / 2.0;
+        const double log_present = -std::log( mean ) + square( sigma / mean ) / 2.0 - I / mean + log_normal_cdf( ( I - square( sigma ) / mean ) / sigma );
+        differences[i] = log_absent - log_present;
+        log_likelihood_all_present += log_present;
+    }
+    // One pass over the set bits of each mask
+    double maximum_log_likelihood = -std::numeric_limits< double >::max();
+    for ( size_t k( 0 ); k != result.size(); ++k )
+    {
+        double log_likelihood = log_likelihood_all_present;
+        size_t nviolations( 0 );
+        for ( size_t j( 0 ); j != nwords; ++j )
+        {
+            for ( uint64_t word = absence_masks_[k][j]; word != 0; word &= word - 1 )
+            {
+                const size_t i = 64 * j + __builtin_ctzll( word );
+                log_likelihood += differences[i];
+                if ( is_observed[i] )
+                    ++nviolations;
+            }
+        }
+        result[k].log_likelihood_ = log_likelihood;
+        result[k].nviolations_ = nviolations;
+        maximum_log_likelihood = std::max( maximum_log_likelihood, log_likelihood );
+    }
+    double sum( 0.0 );
+    for ( size_t k( 0 ); k != result.size(); ++k )
+    {
+        result[k].probability_ = std::exp( result[k].log_likelihood_ - maximum_log_likelihood );
+        sum += result[k].probability_;
+    }
+    for ( size_t k( 0 ); k != result.size(); ++k )
+        result[k].probability_ /= sum;
+    std::stable_sort( result.begin(), result.end(), []( const ExtinctionGroup & lhs, const ExtinctionGroup & rhs ) { return lhs.probability_ > rhs.probability_; } );
+    return result;
+}
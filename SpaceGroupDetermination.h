@@ -0,0 +1,115 @@
+#ifndef SPACEGROUPDETERMINATION_H
+#define SPACEGROUPDETERMINATION_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class ReflectionList;
+
+#include "CrystalLattice.h"
+#include "SpaceGroup.h"
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The space groups that have the same systematic absences for a reflection list, i.e. one extinction symbol, and their score.
+struct ExtinctionGroup
+{
+    ExtinctionGroup(): nabsent_(0), nviolations_(0), log_likelihood_(0.0), probability_(0.0) {}
+
+    // The Hermann-Mauguin symbol of the standard setting, followed by the setting if it is not the standard one,
+    // e.g. "P21/c (cell choice 2)" for P21/n or "Pnma (bca)", in which the new a, b and c are the old b, c and a.
+    std::vector< std::string > space_group_names_;
+    std::vector< SpaceGroup > space_groups_; // In the setting of the reflection list
+    size_t nabsent_;     // The number of reflections in the list that are systematically absent
+    size_t nviolations_; // The number of those that are observed, I > 3 sigma
+    double log_likelihood_;
+    double probability_; // Normalised over all extinction groups, with equal prior probabilities
+};
+
+/*
+  Space-group determination from intensities extracted by e.g. Pawley or Le Bail, by scoring the systematic absences of
+  all space groups of a lattice system at once, after Markvardsen, David, Johnson and Shankland (2001).
+
+  The candidates are the space groups of the lattice system in their standard settings, plus the three cell choices for the
+  monoclinic space groups (unique axis b) and the six axis permutations for the orthorhombic space groups.
+  For each candidate, SpaceGroup::is_systematic_absence() is evaluated once per reflection and stored as a bit vector;
+  candidates with the same bit vector form one ExtinctionGroup, so they cannot be distinguished by their absences.
+
+  Each reflection contributes the log-likelihood of its intensity being absent (Gaussian around 0.0 with its ESD) or present
+  (an exponential, Wilson, distribution with the local mean intensity, convolved with the Gaussian), so the log-likelihood of an
+  extinction group is that of all reflections being present plus the sum of the differences over its absent reflections,
+  which is a pass over the set bits of its bit vector. The local mean intensity is that of the 21 nearest reflections in d-spacing
+  that are not absent in any candidate.
+  Reflections with another reflection within overlap_tolerance() in d-spacing are not used, because an extraction divides their
+  intensities arbitrarily.
+
+  The reflection list must be in the conventional cell of the lattice system, in the standard setting (c unique for tetragonal,
+  hexagonal axes for trigonal), and must include the reflections that are absent in any candidate.
+*/
+class SpaceGroupDetermination
+{
+public:
+
+    // TRICLINIC, MONOCLINIC, ORTHORHOMBIC, TETRAGONAL, TRIGONAL, HEXAGONAL (which includes the trigonal space groups) or CUBIC.
+    SpaceGroupDetermination( const ReflectionList & reflection_list, const CrystalLattice::LatticeSystem lattice_system );
+
+    // The ESDs of the F^2 values, in the order of the reflection list. If not given, relative_ESD() times the local mean intensity.
+    void set_estimated_standard_deviations( const std::vector< double > & estimated_standard_deviations );
+
+    // The default is 0.1.
+    double relative_ESD() const { return relative_ESD_; }
+    void set_relative_ESD( const double relative_ESD ) { relative_ESD_ = relative_ESD; }
+
+    // Relative to the d-spacing. The default is 0.0005.
+    double overlap_tolerance() const { return overlap_tolerance_; }
+    void set_overlap_tolerance( const double overlap_tolerance ) { overlap_tolerance_ = overlap_tolerance; }
+
+    size_t ncandidates() const { return ncandidates_; }
+    size_t nextinction_groups() const { return extinction_groups_.size(); }
+
+    // Highest probability first.
+    std::vector< ExtinctionGroup > determine() const;
+
+private:
+    size_t nreflections_;
+    std::vector< double > F_squared_;
+    std::vector< double > d_spacings_;
+    std::vector< double > estimated_standard_deviations_; // Empty if not given
+    double relative_ESD_;
+    double overlap_tolerance_;
+    size_t ncandidates_;
+    std::vector< ExtinctionGroup > extinction_groups_; // Without the scores
+    std::vector< std::vector< uint64_t > > absence_masks_; // One bit per reflection, for each extinction group
+
+    void add_candidate( const SpaceGroup & space_group, const std::string & name, const ReflectionList & reflection_list );
+};
+
+#endif // SPACEGROUPDETERMINATION_H
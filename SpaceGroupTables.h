@@ -0,0 +1,396 @@
+#ifndef SPACEGROUPTABLES_H
+#define SPACEGROUPTABLES_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <cstddef>
+#include <stdexcept>
+
+/*
+  Compile-time tables of the 230 space groups, the 32 crystallographic point groups and the 11 Laue classes.
+
+  The space groups are given by their Hall symbols in the standard settings of the International Tables:
+  unique axis b and cell choice 1 for monoclinic space groups, origin choice 2 (inversion at the origin) where
+  there are two origin choices, and hexagonal axes for rhombohedral space groups.
+  The Hermann-Mauguin symbols are written without spaces and with the older glide symbols (Cmca, not Cmce), as in most cifs.
+
+  SpaceGroup::from_number() and SpaceGroup::from_Hall_symbol() turn these into symmetry operators.
+*/
+
+struct LaueClassData
+{
+    const char * name;
+    size_t order;
+};
+
+struct PointGroupData
+{
+    const char * name;
+    size_t order;
+    size_t laue_class;         // Index into laue_classes
+    const char * crystal_system;
+    size_t first_space_group;
+    size_t last_space_group;
+};
+
+struct SpaceGroupData
+{
+    size_t number;
+    const char * Hermann_Mauguin;
+    const char * Hall;
+    size_t point_group;        // Index into point_groups
+};
+
+// The 11 Laue classes.
+constexpr LaueClassData laue_classes[ 11 ] =
+{
+    { "-1", 2 },
+    { "2/m", 4 },
+    { "mmm", 8 },
+    { "4/m", 8 },
+    { "4/mmm", 16 },
+    { "-3", 6 },
+    { "-3m", 12 },
+    { "6/m", 12 },
+    { "6/mmm", 24 },
+    { "m-3", 24 },
+    { "m-3m", 48 }
+};
+
+// The 32 crystallographic point groups, in the order of the International Tables.
+constexpr PointGroupData point_groups[ 32 ] =
+{
+    { "1",       1,  0, "triclinic",      1,   1 },
+    { "-1",      2,  0, "triclinic",      2,   2 },
+    { "2",       2,  1, "monoclinic",     3,   5 },
+    { "m",       2,  1, "monoclinic",     6,   9 },
+    { "2/m",     4,  1, "monoclinic",    10,  15 },
+    { "222",     4,  2, "orthorhombic",  16,  24 },
+    { "mm2",     4,  2, "orthorhombic",  25,  46 },
+    { "mmm",     8,  2, "orthorhombic",  47,  74 },
+    { "4",       4,  3, "tetragonal",    75,  80 },
+    { "-4",      4,  3, "tetragonal",    81,  82 },
+    { "4/m",     8,  3, "tetragonal",    83,  88 },
+    { "422",     8,  4, "tetragonal",    89,  98 },
+    { "4mm",     8,  4, "tetragonal",    99, 110 },
+    { "-42m",    8,  4, "tetragonal",   111, 122 },
+    { "4/mmm",  16,  4, "tetragonal",   123, 142 },
+    { "3",       3,  5, "trigonal",     143, 146 },
+    { "-3",      6,  5, "trigonal",     147, 148 },
+    { "32",      6,  6, "trigonal",     149, 155 },
+    { "3m",      6,  6, "trigonal",     156, 161 },
+    { "-3m",    12,  6, "trigonal",     162, 167 },
+    { "6",       6,  7, "hexagonal",    168, 173 },
+    { "-6",      6,  7, "hexagonal",    174, 174 },
+    { "6/m",    12,  7, "hexagonal",    175, 176 },
+    { "622",    12,  8, "hexagonal",    177, 182 },
+    { "6mm",    12,  8, "hexagonal",    183, 186 },
+    { "-6m2",   12,  8, "hexagonal",    187, 190 },
+    { "6/mmm",  24,  8, "hexagonal",    191, 194 },
+    { "23",     12,  9, "cubic",        195, 199 },
+    { "m-3",    24,  9, "cubic",        200, 206 },
+    { "432",    24, 10, "cubic",        207, 214 },
+    { "-43m",   24, 10, "cubic",        215, 220 },
+    { "m-3m",   48, 10, "cubic",        221, 230 }
+};
+
+// The 230 space groups in their standard settings, indexed by space-group number - 1.
+constexpr SpaceGroupData space_groups[ 230 ] =
+{
+    {   1, "P1",       "P 1",                  0 },
+    {   2, "P-1",      "-P 1",                 1 },
+    {   3, "P2",       "P 2y",                 2 },
+    {   4, "P21",      "P 2yb",                2 },
+    {   5, "C2",       "C 2y",                 2 },
+    {   6, "Pm",       "P -2y",                3 },
+    {   7, "Pc",       "P -2yc",               3 },
+    {   8, "Cm",       "C -2y",                3 },
+    {   9, "Cc",       "C -2yc",               3 },
+    {  10, "P2/m",     "-P 2y",                4 },
+    {  11, "P21/m",    "-P 2yb",               4 },
+    {  12, "C2/m",     "-C 2y",                4 },
+    {  13, "P2/c",     "-P 2yc",               4 },
+    {  14, "P21/c",    "-P 2ybc",              4 },
+    {  15, "C2/c",     "-C 2yc",               4 },
+    {  16, "P222",     "P 2 2",                5 },
+    {  17, "P2221",    "P 2c 2",               5 },
+    {  18, "P21212",   "P 2 2ab",              5 },
+    {  19, "P212121",  "P 2ac 2ab",            5 },
+    {  20, "C2221",    "C 2c 2",               5 },
+    {  21, "C222",     "C 2 2",                5 },
+    {  22, "F222",     "F 2 2",                5 },
+    {  23, "I222",     "I 2 2",                5 },
+    {  24, "I212121",  "I 2b 2c",              5 },
+    {  25, "Pmm2",     "P 2 -2",               6 },
+    {  26, "Pmc21",    "P 2c -2",              6 },
+    {  27, "Pcc2",     "P 2 -2c",              6 },
+    {  28, "Pma2",     "P 2 -2a",              6 },
+    {  29, "Pca21",    "P 2c -2ac",            6 },
+    {  30, "Pnc2",     "P 2 -2bc",             6 },
+    {  31, "Pmn21",    "P 2ac -2",             6 },
+    {  32, "Pba2",     "P 2 -2ab",             6 },
+    {  33, "Pna21",    "P 2c -2n",             6 },
+    {  34, "Pnn2",     "P 2 -2n",              6 },
+    {  35, "Cmm2",     "C 2 -2",               6 },
+    {  36, "Cmc21",    "C 2c -2",              6 },
+    {  37, "Ccc2",     "C 2 -2c",              6 },
+    {  38, "Amm2",     "A 2 -2",               6 },
+    {  39, "Abm2",     "A 2 -2c",              6 },
+    {  40, "Ama2",     "A 2 -2a",              6 },
+    {  41, "Aba2",     "A 2 -2ac",             6 },
+    {  42, "Fmm2",     "F 2 -2",               6 },
+    {  43, "Fdd2",     "F 2 -2d",              6 },
+    {  44, "Imm2",     "I 2 -2",               6 },
+    {  45, "Iba2",     "I 2 -2c",              6 },
+    {  46, "Ima2",     "I 2 -2a",              6 },
+    {  47, "Pmmm",     "-P 2 2",               7 },
+    {  48, "Pnnn",     "-P 2ab 2bc",           7 },
+    {  49, "Pccm",     "-P 2 2c",              7 },
+    {  50, "Pban",     "-P 2ab 2b",            7 },
+    {  51, "Pmma",     "-P 2a 2a",             7 },
+    {  52, "Pnna",     "-P 2a 2bc",            7 },
+    {  53, "Pmna",     "-P 2ac 2",             7 },
+    {  54, "Pcca",     "-P 2a 2ac",            7 },
+    {  55, "Pbam",     "-P 2 2ab",             7 },
+    {  56, "Pccn",     "-P 2ab 2ac",           7 },
+    {  57, "Pbcm",     "-P 2c 2b",             7 },
+    {  58, "Pnnm",     "-P 2 2n",              7 },
+    {  59, "Pmmn",     "-P 2ab 2a",            7 },
+    {  60, "Pbcn",     "-P 2n 2ab",            7 },
+    {  61, "Pbca",     "-P 2ac 2ab",           7 },
+    {  62, "Pnma",     "-P 2ac 2n",            7 },
+    {  63, "Cmcm",     "-C 2c 2",              7 },
+    {  64, "Cmca",     "-C 2bc 2",             7 },
+    {  65, "Cmmm",     "-C 2 2",               7 },
+    {  66, "Cccm",     "-C 2 2c",              7 },
+    {  67, "Cmma",     "-C 2b 2",              7 },
+    {  68, "Ccca",     "-C 2b 2bc",            7 },
+    {  69, "Fmmm",     "-F 2 2",               7 },
+    {  70, "Fddd",     "-F 2uv 2vw",           7 },
+    {  71, "Immm",     "-I 2 2",               7 },
+    {  72, "Ibam",     "-I 2 2c",              7 },
+    {  73, "Ibca",     "-I 2b 2c",             7 },
+    {  74, "Imma",     "-I 2b 2",              7 },
+    {  75, "P4",       "P 4",                  8 },
+    {  76, "P41",      "P 4w",                 8 },
+    {  77, "P42",      "P 4c",                 8 },
+    {  78, "P43",      "P 4cw",                8 },
+    {  79, "I4",       "I 4",                  8 },
+    {  80, "I41",      "I 4bw",                8 },
+    {  81, "P-4",      "P -4",                 9 },
+    {  82, "I-4",      "I -4",                 9 },
+    {  83, "P4/m",     "-P 4",                10 },
+    {  84, "P42/m",    "-P 4c",               10 },
+    {  85, "P4/n",     "-P 4a",               10 },
+    {  86, "P42/n",    "-P 4bc",              10 },
+    {  87, "I4/m",     "-I 4",                10 },
+    {  88, "I41/a",    "-I 4ad",              10 },
+    {  89, "P422",     "P 4 2",               11 },
+    {  90, "P4212",    "P 4ab 2ab",           11 },
+    {  91, "P4122",    "P 4w 2c",             11 },
+    {  92, "P41212",   "P 4abw 2nw",          11 },
+    {  93, "P4222",    "P 4c 2",              11 },
+    {  94, "P42212",   "P 4n 2n",             11 },
+    {  95, "P4322",    "P 4cw 2c",            11 },
+    {  96, "P43212",   "P 4nw 2abw",          11 },
+    {  97, "I422",     "I 4 2",               11 },
+    {  98, "I4122",    "I 4bw 2bw",           11 },
+    {  99, "P4mm",     "P 4 -2",              12 },
+    { 100, "P4bm",     "P 4 -2ab",            12 },
+    { 101, "P42cm",    "P 4c -2c",            12 },
+    { 102, "P42nm",    "P 4n -2n",            12 },
+    { 103, "P4cc",     "P 4 -2c",             12 },
+    { 104, "P4nc",     "P 4 -2n",             12 },
+    { 105, "P42mc",    "P 4c -2",             12 },
+    { 106, "P42bc",    "P 4c -2ab",           12 },
+    { 107, "I4mm",     "I 4 -2",              12 },
+    { 108, "I4cm",     "I 4 -2c",             12 },
+    { 109, "I41md",    "I 4bw -2",            12 },
+    { 110, "I41cd",    "I 4bw -2c",           12 },
+    { 111, "P-42m",    "P -4 2",              13 },
+    { 112, "P-42c",    "P -4 2c",             13 },
+    { 113, "P-421m",   "P -4 2ab",            13 },
+    { 114, "P-421c",   "P -4 2n",             13 },
+    { 115, "P-4m2",    "P -4 -2",             13 },
+    { 116, "P-4c2",    "P -4 -2c",            13 },
+    { 117, "P-4b2",    "P -4 -2ab",           13 },
+    { 118, "P-4n2",    "P -4 -2n",            13 },
+    { 119, "I-4m2",    "I -4 -2",             13 },
+    { 120, "I-4c2",    "I -4 -2c",            13 },
+    { 121, "I-42m",    "I -4 2",              13 },
+    { 122, "I-42d",    "I -4 2bw",            13 },
+    { 123, "P4/mmm",   "-P 4 2",              14 },
+    { 124, "P4/mcc",   "-P 4 2c",             14 },
+    { 125, "P4/nbm",   "-P 4a 2b",            14 },
+    { 126, "P4/nnc",   "-P 4a 2bc",           14 },
+    { 127, "P4/mbm",   "-P 4 2ab",            14 },
+    { 128, "P4/mnc",   "-P 4 2n",             14 },
+    { 129, "P4/nmm",   "-P 4a 2a",            14 },
+    { 130, "P4/ncc",   "-P 4a 2ac",           14 },
+    { 131, "P42/mmc",  "-P 4c 2",             14 },
+    { 132, "P42/mcm",  "-P 4c 2c",            14 },
+    { 133, "P42/nbc",  "-P 4ac 2b",           14 },
+    { 134, "P42/nnm",  "-P 4ac 2bc",          14 },
+    { 135, "P42/mbc",  "-P 4c 2ab",           14 },
+    { 136, "P42/mnm",  "-P 4n 2n",            14 },
+    { 137, "P42/nmc",  "-P 4ac 2a",           14 },
+    { 138, "P42/ncm",  "-P 4ac 2ac",          14 },
+    { 139, "I4/mmm",   "-I 4 2",              14 },
+    { 140, "I4/mcm",   "-I 4 2c",             14 },
+    { 141, "I41/amd",  "-I 4bd 2",            14 },
+    { 142, "I41/acd",  "-I 4bd 2c",           14 },
+    { 143, "P3",       "P 3",                 15 },
+    { 144, "P31",      "P 31",                15 },
+    { 145, "P32",      "P 32",                15 },
+    { 146, "R3",       "R 3",                 15 },
+    { 147, "P-3",      "-P 3",                16 },
+    { 148, "R-3",      "-R 3",                16 },
+    { 149, "P312",     "P 3 2",               17 },
+    { 150, "P321",     "P 3 2\"",             17 },
+    { 151, "P3112",    "P 31 2c (0 0 1)",     17 },
+    { 152, "P3121",    "P 31 2\"",            17 },
+    { 153, "P3212",    "P 32 2c (0 0 -1)",    17 },
+    { 154, "P3221",    "P 32 2\"",            17 },
+    { 155, "R32",      "R 3 2\"",             17 },
+    { 156, "P3m1",     "P 3 -2\"",            18 },
+    { 157, "P31m",     "P 3 -2",              18 },
+    { 158, "P3c1",     "P 3 -2\"c",           18 },
+    { 159, "P31c",     "P 3 -2c",             18 },
+    { 160, "R3m",      "R 3 -2\"",            18 },
+    { 161, "R3c",      "R 3 -2\"c",           18 },
+    { 162, "P-31m",    "-P 3 2",              19 },
+    { 163, "P-31c",    "-P 3 2c",             19 },
+    { 164, "P-3m1",    "-P 3 2\"",            19 },
+    { 165, "P-3c1",    "-P 3 2\"c",           19 },
+    { 166, "R-3m",     "-R 3 2\"",            19 },
+    { 167, "R-3c",     "-R 3 2\"c",           19 },
+    { 168, "P6",       "P 6",                 20 },
+    { 169, "P61",      "P 61",                20 },
+    { 170, "P65",      "P 65",                20 },
+    { 171, "P62",      "P 62",                20 },
+    { 172, "P64",      "P 64",                20 },
+    { 173, "P63",      "P 6c",                20 },
+    { 174, "P-6",      "P -6",                21 },
+    { 175, "P6/m",     "-P 6",                22 },
+    { 176, "P63/m",    "-P 6c",               22 },
+    { 177, "P622",     "P 6 2",               23 },
+    { 178, "P6122",    "P 61 2 (0 0 -1)",     23 },
+    { 179, "P6522",    "P 65 2 (0 0 1)",      23 },
+    { 180, "P6222",    "P 62 2c (0 0 1)",     23 },
+    { 181, "P6422",    "P 64 2c (0 0 -1)",    23 },
+    { 182, "P6322",    "P 6c 2c",             23 },
+    { 183, "P6mm",     "P 6 -2",              24 },
+    { 184, "P6cc",     "P 6 -2c",             24 },
+    { 185, "P63cm",    "P 6c -2",             24 },
+    { 186, "P63mc",    "P 6c -2c",            24 },
+    { 187, "P-6m2",    "P -6 2",              25 },
+    { 188, "P-6c2",    "P -6c 2",             25 },
+    { 189, "P-62m",    "P -6 -2",             25 },
+    { 190, "P-62c",    "P -6c -2c",           25 },
+    { 191, "P6/mmm",   "-P 6 2",              26 },
+    { 192, "P6/mcc",   "-P 6 2c",             26 },
+    { 193, "P63/mcm",  "-P 6c 2",             26 },
+    { 194, "P63/mmc",  "-P 6c 2c",            26 },
+    { 195, "P23",      "P 2 2 3",             27 },
+    { 196, "F23",      "F 2 2 3",             27 },
+    { 197, "I23",      "I 2 2 3",             27 },
+    { 198, "P213",     "P 2ac 2ab 3",         27 },
+    { 199, "I213",     "I 2b 2c 3",           27 },
+    { 200, "Pm-3",     "-P 2 2 3",            28 },
+    { 201, "Pn-3",     "-P 2ab 2bc 3",        28 },
+    { 202, "Fm-3",     "-F 2 2 3",            28 },
+    { 203, "Fd-3",     "-F 2uv 2vw 3",        28 },
+    { 204, "Im-3",     "-I 2 2 3",            28 },
+    { 205, "Pa-3",     "-P 2ac 2ab 3",        28 },
+    { 206, "Ia-3",     "-I 2b 2c 3",          28 },
+    { 207, "P432",     "P 4 2 3",             29 },
+    { 208, "P4232",    "P 4n 2 3",            29 },
+    { 209, "F432",     "F 4 2 3",             29 },
+    { 210, "F4132",    "F 4d 2 3",            29 },
+    { 211, "I432",     "I 4 2 3",             29 },
+    { 212, "P4332",    "P 4acd 2ab 3",        29 },
+    { 213, "P4132",    "P 4bd 2ab 3",         29 },
+    { 214, "I4132",    "I 4bd 2c 3",          29 },
+    { 215, "P-43m",    "P -4 2 3",            30 },
+    { 216, "F-43m",    "F -4 2 3",            30 },
+    { 217, "I-43m",    "I -4 2 3",            30 },
+    { 218, "P-43n",    "P -4n 2 3",           30 },
+    { 219, "F-43c",    "F -4c 2 3",           30 },
+    { 220, "I-43d",    "I -4bd 2c 3",         30 },
+    { 221, "Pm-3m",    "-P 4 2 3",            31 },
+    { 222, "Pn-3n",    "-P 4a 2bc 3",         31 },
+    { 223, "Pm-3n",    "-P 4n 2 3",           31 },
+    { 224, "Pn-3m",    "-P 4bc 2bc 3",        31 },
+    { 225, "Fm-3m",    "-F 4 2 3",            31 },
+    { 226, "Fm-3c",    "-F 4c 2 3",           31 },
+    { 227, "Fd-3m",    "-F 4vw 2vw 3",        31 },
+    { 228, "Fd-3c",    "-F 4cvw 2vw 3",       31 },
+    { 229, "Im-3m",    "-I 4 2 3",            31 },
+    { 230, "Ia-3d",    "-I 4bd 2c 3",         31 }
+};
+
+// O(1) look-up by space-group number (1-230).
+constexpr const SpaceGroupData & space_group_data( const size_t number )
+{
+    return ( ( number != 0 ) && ( number <= 230 ) ) ? space_groups[ number - 1 ] : throw std::runtime_error( "space_group_data(): space-group number must be between 1 and 230." );
+}
+
+constexpr const PointGroupData & point_group_data( const size_t space_group_number )
+{
+    return point_groups[ space_group_data( space_group_number ).point_group ];
+}
+
+constexpr const LaueClassData & laue_class_data( const size_t space_group_number )
+{
+    return laue_classes[ point_group_data( space_group_number ).laue_class ];
+}
+
+// Checked at compile time: the entries are numbered consecutively and the point groups cover exactly their ranges of space groups.
+constexpr bool space_group_tables_are_consistent()
+{
+    for ( size_t i( 0 ); i != 230; ++i )
+    {
+        if ( space_groups[i].number != i + 1 )
+            return false;
+        const PointGroupData & point_group = point_groups[ space_groups[i].point_group ];
+        if ( ( space_groups[i].number < point_group.first_space_group ) || ( point_group.last_space_group < space_groups[i].number ) )
+            return false;
+    }
+    for ( size_t i( 1 ); i != 32; ++i )
+    {
+        if ( point_groups[i].first_space_group != point_groups[i-1].last_space_group + 1 )
+            return false;
+        if ( laue_classes[ point_groups[i].laue_class ].order < point_groups[i].order )
+            return false;
+    }
+    return true;
+}
+
+static_assert( space_group_tables_are_consistent(), "SpaceGroupTables.h: inconsistent tables." );
+
+#endif // SPACEGROUPTABLES_H
@@ -0,0 +1,100 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SparseJacobian.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// ********************************************************************************
+
+SparseJacobian::SparseJacobian( const size_t nrows ):
+nrows_(nrows),
+column_offsets_( 1, 0 )
+{
+}
+
+// ********************************************************************************
+
+void SparseJacobian::append_column( const std::vector< size_t > & rows, const std::vector< double > & values )
+{
+    if ( rows.size() != values.size() )
+        throw std::runtime_error( "SparseJacobian::append_column(): number of rows and number of values differ." );
+    for ( size_t i( 0 ); i != rows.size(); ++i )
+    {
+        if ( rows[i] >= nrows_ )
+            throw std::runtime_error( "SparseJacobian::append_column(): row index out of range." );
+        if ( ( i != 0 ) && ( rows[i] <= rows[i-1] ) )
+            throw std::runtime_error( "SparseJacobian::append_column(): row indices must be strictly increasing." );
+    }
+    rows_.insert( rows_.end(), rows.begin(), rows.end() );
+    values_.insert( values_.end(), values.begin(), values.end() );
+    column_offsets_.push_back( rows_.size() );
+}
+
+// ********************************************************************************
+
+double SparseJacobian::value( const size_t row, const size_t column ) const
+{
+    std::vector< size_t >::const_iterator first = rows_.begin() + column_offsets_[column];
+    std::vector< size_t >::const_iterator last = rows_.begin() + column_offsets_[column+1];
+    std::vector< size_t >::const_iterator it = std::lower_bound( first, last, row );
+    if ( ( it == last ) || ( *it != row ) )
+        return 0.0;
+    return values_[ it - rows_.begin() ];
+}
+
+// ********************************************************************************
+
+std::vector< double > SparseJacobian::column( const size_t column ) const
+{
+    std::vector< double > result( nrows_, 0.0 );
+    for ( size_t i( column_offsets_[column] ); i != column_offsets_[column+1]; ++i )
+        result[ rows_[i] ] = values_[i];
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< double > SparseJacobian::transpose_times( const std::vector< double > & v ) const
+{
+    if ( v.size() != nrows_ )
+        throw std::runtime_error( "SparseJacobian::transpose_times(): vector has wrong size." );
+    std::vector< double > result( ncolumns(), 0.0 );
+    for ( size_t j( 0 ); j != ncolumns(); ++j )
+    {
+        double sum( 0.0 );
+        for ( size_t i( column_offsets_[j] ); i != column_offsets_[j+1]; ++i )
+            sum += values_[i] * v[ rows_[i] ];
+        result[j] = sum;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
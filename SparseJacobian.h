@@ -0,0 +1,75 @@
+#ifndef SPARSEJACOBIAN_H
+#define SPARSEJACOBIAN_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+/*
+  A Jacobian matrix J(i,j) = d y_i / d p_j stored column by column (compressed sparse column):
+  for each parameter only the rows (e.g. 2theta points) where the derivative is non-zero are stored.
+
+  The columns are appended in order, within a column the row indices must be strictly increasing.
+*/
+class SparseJacobian
+{
+public:
+
+    explicit SparseJacobian( const size_t nrows = 0 );
+
+    size_t nrows() const { return nrows_; }
+    size_t ncolumns() const { return column_offsets_.size() - 1; }
+    // The total number of stored entries.
+    size_t nnonzero() const { return rows_.size(); }
+
+    void append_column( const std::vector< size_t > & rows, const std::vector< double > & values );
+
+    // The number of stored entries in a column, i runs from 0 to column_size( column ).
+    size_t column_size( const size_t column ) const { return column_offsets_[column+1] - column_offsets_[column]; }
+    size_t row( const size_t column, const size_t i ) const { return rows_[ column_offsets_[column] + i ]; }
+    double entry( const size_t column, const size_t i ) const { return values_[ column_offsets_[column] + i ]; }
+
+    // Returns 0.0 if the entry is not stored.
+    double value( const size_t row, const size_t column ) const;
+
+    std::vector< double > column( const size_t column ) const;
+
+    // J^T v, e.g. the gradient of a sum of squares when v contains the residuals.
+    std::vector< double > transpose_times( const std::vector< double > & v ) const;
+
+private:
+    size_t nrows_;
+    std::vector< size_t > column_offsets_; // ncolumns() + 1 elements
+    std::vector< size_t > rows_;
+    std::vector< double > values_;
+};
+
+#endif // SPARSEJACOBIAN_H
+
@@ -28,51 +28,50 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "SmallVector.h"
+
 #include <stdexcept>
-#include <vector>
+#include <utility>
 
 /*
-
+  A last-in-first-out stack. The first N elements are stored inside the object, so a shallow stack of e.g. indices
+  never allocates memory. push() and pop() move when they can, so backtracking code that saves a whole state
+  (SudokuSolver saves the entire Sudoku) can std::move() it onto the stack and back.
 */
-template <class T>
+template < class T, size_t N = 8 >
 class Stack
 {
 public:
 
     // Default constructor
-    Stack():sp_(0) {}
+    Stack() {}
     
-    bool empty() const { return ( sp_ == 0 ); }
+    bool empty() const { return data_.empty(); }
     
-    size_t stack_pointer() const { return sp_; }
+    size_t stack_pointer() const { return data_.size(); }
     
     T pop()
     {
         if ( empty() )
             throw std::runtime_error( "Stack::pop(): stack empty." );
-        --sp_;
-        return data_[sp_];
+        T result( std::move( data_.back() ) );
+        data_.pop_back();
+        return result;
     }
     
-    T peek() const
+    const T & peek() const
     {
         if ( empty() )
             throw std::runtime_error( "Stack::peek(): stack empty." );
-        return data_[sp_-1];
+        return data_.back();
     }
     
-    void push( const T & value )
-    {
-        if ( sp_ < data_.size() )
-            data_[sp_] = value;
-        else
-            data_.push_back( value );
-        ++sp_;
-    }
+    void push( const T & value ) { data_.push_back( value ); }
+
+    void push( T && value ) { data_.push_back( std::move( value ) ); }
 
 private:
-    std::vector< T > data_;
-    size_t sp_;
+    SmallVector< T, N > data_;
 };
 
 #endif // STACK_H
@@ -0,0 +1,204 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "StructureDescriptors.h"
+#include "ChemicalFormula.h"
+#include "CrystalStructure.h"
+#include "Element.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "Logger.h"
+#include "MathFunctions.h"
+#include "PackedCrystalStructure.h"
+#include "ParallelFor.h"
+#include "PhysicalConstants.h"
+#include "ReadCif.h"
+#include "ScratchArena.h"
+#include "TextFileWriter.h"
+#include "Utilities.h"
+#include "VoidsFinder.h"
+
+#include <cmath>
+#include <stdexcept>
+
+// ********************************************************************************
+
+StructureDescriptors::StructureDescriptors():
+volume_(0.0),
+density_(0.0),
+packing_coefficient_(0.0),
+void_fraction_(0.0),
+Z_(0),
+Z_prime_(0.0),
+dipole_moment_(0.0)
+{
+}
+
+// ********************************************************************************
+
+StructureDescriptors::StructureDescriptors( const CrystalStructure & crystal_structure, const double grid_spacing ):
+volume_(0.0),
+density_(0.0),
+packing_coefficient_(0.0),
+void_fraction_(0.0),
+Z_(0),
+Z_prime_(0.0),
+dipole_moment_(0.0)
+{
+    // perceive_molecules() applies the space-group symmetry and makes the molecules whole, which is needed for the dipole moment.
+    CrystalStructure full_crystal_structure( crystal_structure );
+    full_crystal_structure.perceive_molecules();
+    const size_t nsymmetry_operators = full_crystal_structure.space_group().nsymmetry_operators();
+    volume_ = full_crystal_structure.crystal_lattice().volume();
+    Z_ = full_crystal_structure.nmolecules();
+    Z_prime_ = static_cast< double >( Z_ ) / nsymmetry_operators;
+    calculate_atom_descriptors( PackedCrystalStructure( full_crystal_structure ), nsymmetry_operators );
+    if ( grid_spacing > 0.0 )
+    {
+        packing_coefficient_ = ( volume_ - void_volume( full_crystal_structure, grid_spacing ) ) / volume_;
+        void_fraction_ = find_voids( full_crystal_structure, 1.2, grid_spacing ) / volume_;
+    }
+}
+
+// ********************************************************************************
+
+std::string StructureDescriptors::csv_header()
+{
+    return "volume,density,packing_coefficient,void_fraction,formula,Z,Z_prime,dipole_moment";
+}
+
+// ********************************************************************************
+
+std::string StructureDescriptors::to_csv() const
+{
+    return double2string( volume_, 3 ) + "," +
+           double2string( density_, 4 ) + "," +
+           double2string( packing_coefficient_, 4 ) + "," +
+           double2string( void_fraction_, 4 ) + "," +
+           formula_ + "," +
+           size_t2string( Z_ ) + "," +
+           double2string( Z_prime_, 3 ) + "," +
+           double2string( dipole_moment_, 4 );
+}
+
+// ********************************************************************************
+
+void StructureDescriptors::calculate_atom_descriptors( const PackedCrystalStructure & packed_crystal_structure, const size_t nsymmetry_operators )
+{
+    const size_t natoms = packed_crystal_structure.natoms();
+    const std::vector< double > & x = packed_crystal_structure.x();
+    const std::vector< double > & y = packed_crystal_structure.y();
+    const std::vector< double > & z = packed_crystal_structure.z();
+    const Matrix3D & f2o = packed_crystal_structure.crystal_lattice().fractional_to_orthogonal_matrix();
+    double molecular_weight( 0.0 );
+    ChemicalFormula chemical_formula;
+    double nett_charge( 0.0 );
+    // Sums of q_i and q_i * r_i in Cartesian coordinates, so that the nett charge can be subtracted afterwards
+    double sum_q_r[3] = { 0.0, 0.0, 0.0 };
+    double sum_r[3] = { 0.0, 0.0, 0.0 };
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        const Element element = packed_crystal_structure.element( i );
+        molecular_weight += element.atomic_weight();
+        chemical_formula.add_element( element );
+        const double charge = packed_crystal_structure.charge( i );
+        nett_charge += charge;
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            const double r = f2o.value( j, 0 ) * x[i] + f2o.value( j, 1 ) * y[i] + f2o.value( j, 2 ) * z[i];
+            sum_q_r[j] += charge * r;
+            sum_r[j] += r;
+        }
+    }
+    density_ = ( molecular_weight / volume_ ) / ( Avogadros_constant / 1.0E24 );
+    if ( natoms != 0 )
+    {
+        // sum ( q_i - nett_charge / natoms ) r_i
+        double dipole2( 0.0 );
+        for ( size_t j( 0 ); j != 3; ++j )
+            dipole2 += square( sum_q_r[j] - ( nett_charge / natoms ) * sum_r[j] );
+        dipole_moment_ = std::sqrt( dipole2 );
+    }
+    int divisor = static_cast< int >( nsymmetry_operators );
+    for ( size_t i( 0 ); i != chemical_formula.size(); ++i )
+        divisor = greatest_common_divisor( divisor, static_cast< int >( chemical_formula.number( i ) ) );
+    chemical_formula.multiply( Fraction( 1, divisor ) );
+    formula_ = chemical_formula.to_string();
+}
+
+// ********************************************************************************
+
+std::vector< StructureDescriptors > calculate_structure_descriptors( const FileList & file_list,
+                                                                     std::vector< std::string > & error_messages,
+                                                                     const double grid_spacing,
+                                                                     const size_t nthreads )
+{
+    const size_t nfiles = file_list.size();
+    std::vector< StructureDescriptors > result( nfiles );
+    error_messages = std::vector< std::string >( nfiles );
+    parallel_for( nfiles, nthreads, [&]( const size_t i )
+    {
+        ScratchArenaScope scratch_arena_scope;
+        try
+        {
+            CrystalStructure crystal_structure;
+            read_cif( file_list.value( i ), crystal_structure );
+            result[i] = StructureDescriptors( crystal_structure, grid_spacing );
+        }
+        catch ( std::exception & e )
+        {
+            error_messages[i] = e.what();
+            if ( error_messages[i].empty() )
+                error_messages[i] = "unknown error";
+            log_warning( "calculate_structure_descriptors(): skipping " + file_list.value( i ).full_name() + ": " + e.what() );
+        }
+    } );
+    return result;
+}
+
+// ********************************************************************************
+
+void write_structure_descriptors_csv( const FileName & file_name,
+                                      const FileList & file_list,
+                                      const std::vector< StructureDescriptors > & descriptors,
+                                      const std::vector< std::string > & error_messages )
+{
+    if ( ( descriptors.size() != file_list.size() ) || ( error_messages.size() != file_list.size() ) )
+        throw std::runtime_error( "write_structure_descriptors_csv(): sizes do not match." );
+    TextFileWriter text_file_writer( file_name );
+    text_file_writer.write_line( "file," + StructureDescriptors::csv_header() );
+    for ( size_t i( 0 ); i != file_list.size(); ++i )
+    {
+        if ( ! error_messages[i].empty() )
+            continue;
+        text_file_writer.write_line( FileName( "", file_list.value( i ).file_name(), file_list.value( i ).extension() ).full_name() + "," + descriptors[i].to_csv() );
+    }
+}
+
+// ********************************************************************************
+
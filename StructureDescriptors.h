@@ -0,0 +1,118 @@
+#ifndef STRUCTUREDESCRIPTORS_H
+#define STRUCTUREDESCRIPTORS_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+class FileList;
+class FileName;
+class PackedCrystalStructure;
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+/*
+  Cheap per-structure descriptors for filtering large sets of (e.g. predicted) crystal structures.
+
+  The descriptors that only need the atoms (weight, formula and charges) are accumulated in a single pass over the
+  arrays of a PackedCrystalStructure. Z needs the molecules, the packing coefficient and the void fraction need a grid;
+  set grid_spacing to 0.0 to skip the two grid-based descriptors, which are then reported as 0.0.
+*/
+class StructureDescriptors
+{
+public:
+
+    StructureDescriptors();
+
+    // The space-group symmetry is applied and the molecules are perceived on a copy of crystal_structure.
+    explicit StructureDescriptors( const CrystalStructure & crystal_structure, const double grid_spacing = 0.2 );
+
+    // Unit-cell volume in A^3
+    double volume() const { return volume_; }
+
+    // g/cm3, the same as CrystalStructure::density()
+    double density() const { return density_; }
+
+    // Fraction of the unit cell inside the Van der Waals spheres of the atoms
+    double packing_coefficient() const { return packing_coefficient_; }
+
+    // Fraction of the unit cell that is accessible to a probe with a radius of 1.2 A
+    double void_fraction() const { return void_fraction_; }
+
+    // The contents of the unit cell divided by the largest number that divides both all element counts and the number of symmetry operators,
+    // which is the formula of the asymmetric unit unless there are atoms on special positions.
+    std::string formula() const { return formula_; }
+
+    // Number of molecules in the unit cell
+    size_t Z() const { return Z_; }
+
+    // Z divided by the number of symmetry operators
+    double Z_prime() const { return Z_prime_; }
+
+    // Magnitude of the dipole moment of the unit cell with the molecules made whole, in eA.
+    // The nett charge is subtracted evenly from all atoms first. 0.0 if there are no charges.
+    double dipole_moment() const { return dipole_moment_; }
+
+    // The names of the columns written by to_csv(), separated by commas.
+    static std::string csv_header();
+
+    // The descriptors in the order of csv_header(), separated by commas.
+    std::string to_csv() const;
+
+private:
+    double volume_;
+    double density_;
+    double packing_coefficient_;
+    double void_fraction_;
+    std::string formula_;
+    size_t Z_;
+    double Z_prime_;
+    double dipole_moment_;
+
+    void calculate_atom_descriptors( const PackedCrystalStructure & packed_crystal_structure, const size_t nsymmetry_operators );
+};
+
+// Calculates the descriptors for each .cif file in file_list on nthreads threads (0 means one per core).
+// Files that cannot be read are skipped with a warning, their error message is stored in error_messages,
+// which is resized to the size of file_list and is empty for the files that were processed successfully.
+std::vector< StructureDescriptors > calculate_structure_descriptors( const FileList & file_list,
+                                                                     std::vector< std::string > & error_messages,
+                                                                     const double grid_spacing = 0.2,
+                                                                     const size_t nthreads = 0 );
+
+// Writes one line per file with the file name followed by the descriptors, comma separated, with a header line.
+// Files with an error message are left out.
+void write_structure_descriptors_csv( const FileName & file_name,
+                                      const FileList & file_list,
+                                      const std::vector< StructureDescriptors > & descriptors,
+                                      const std::vector< std::string > & error_messages );
+
+#endif // STRUCTUREDESCRIPTORS_H
+
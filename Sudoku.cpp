@@ -341,10 +341,8 @@ bool Sudoku::update_square( const size_t i, OneSudokuSquare square )
         return false;
     if ( values_[i] == square )
         return false;
-    SetOfNumbers new_values = square.values();
     // Check that we do not add values that before were impossible
-    new_values = new_values.in_common( values_[i].values() );
-    square = OneSudokuSquare( new_values );
+    square = OneSudokuSquare::from_candidates( square.candidates() & values_[i].candidates() );
     values_[i] = square;
     if ( square.solved() )
     {
@@ -423,12 +421,19 @@ bool Sudoku::solved() const
 
 bool Sudoku::there_are_contradictions() const
 {
+    // A solved value that was already seen in the slice is a contradiction
     for ( size_t i( 0 ); i != Sudoku::number_of_slices(); ++i )
     {
-        OneSudokuSlice slice = this->slice( i );
-        SetOfNumbers values = slice.collect_solved_numbers();
-        if ( values.contains_duplicates() )
-            return true;
+        unsigned int solved_values( 0 );
+        for ( size_t j( 0 ); j != 9; ++j )
+        {
+            const OneSudokuSquare & square = values_[ sudoku_slice_mapping[i][j] ];
+            if ( ! square.solved() )
+                continue;
+            if ( solved_values & square.candidates() )
+                return true;
+            solved_values |= square.candidates();
+        }
     }
     return false;
 }
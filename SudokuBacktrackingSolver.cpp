@@ -0,0 +1,211 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "SudokuBacktrackingSolver.h"
+#include "OneSudokuSquare.h"
+#include "ParallelFor.h"
+#include "Sudoku.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+class Bitboard
+{
+public:
+
+    // Returns false if the givens contradict each other.
+    bool initialise( const Sudoku & sudoku )
+    {
+        for ( size_t i( 0 ); i != 9; ++i )
+        {
+            row_used_[i] = 0;
+            column_used_[i] = 0;
+            block_used_[i] = 0;
+        }
+        for ( size_t i( 0 ); i != 81; ++i )
+        {
+            values_[i] = 0;
+            allowed_[i] = sudoku.square( i ).candidates();
+        }
+        for ( size_t i( 0 ); i != 81; ++i )
+        {
+            if ( sudoku.square( i ).solved() && ( ! place( i, sudoku.square( i ).value() ) ) )
+                return false;
+        }
+        return true;
+    }
+
+    // Returns false if value is already used in the row, column or block
+    bool place( const size_t i, const size_t value )
+    {
+        const unsigned int bit = sudoku_candidate( value );
+        if ( ( ( row_used_[row(i)] | column_used_[column(i)] | block_used_[block(i)] ) & bit ) || ( ( allowed_[i] & bit ) == 0 ) )
+            return false;
+        row_used_[row(i)] |= bit;
+        column_used_[column(i)] |= bit;
+        block_used_[block(i)] |= bit;
+        values_[i] = value;
+        return true;
+    }
+
+    void remove( const size_t i )
+    {
+        const unsigned int bit = sudoku_candidate( values_[i] );
+        row_used_[row(i)] &= ~bit;
+        column_used_[column(i)] &= ~bit;
+        block_used_[block(i)] &= ~bit;
+        values_[i] = 0;
+    }
+
+    unsigned int candidates( const size_t i ) const
+    {
+        return allowed_[i] & ~( row_used_[row(i)] | column_used_[column(i)] | block_used_[block(i)] );
+    }
+
+    size_t value( const size_t i ) const { return values_[i]; }
+
+    Sudoku to_Sudoku() const
+    {
+        std::vector< std::string > rows;
+        for ( size_t i( 0 ); i != 9; ++i )
+        {
+            std::string one_row;
+            for ( size_t j( 0 ); j != 9; ++j )
+                one_row += static_cast<char>( '0' + values_[9*i+j] );
+            rows.push_back( one_row );
+        }
+        return Sudoku( rows );
+    }
+
+private:
+    unsigned int row_used_[9];
+    unsigned int column_used_[9];
+    unsigned int block_used_[9];
+    unsigned int allowed_[81];
+    size_t values_[81];
+
+    static size_t row( const size_t i ) { return i / 9; }
+    static size_t column( const size_t i ) { return i % 9; }
+    static size_t block( const size_t i ) { return 3 * ( i / 27 ) + ( i % 9 ) / 3; }
+};
+
+// ********************************************************************************
+
+// Calls found( board ) for each solution until it returns false. Returns false if the search was stopped.
+template< class Found >
+bool search( Bitboard & board, Found & found )
+{
+    // The empty square with the fewest candidates
+    size_t best_square( 81 );
+    unsigned int best_candidates( 0 );
+    size_t best_number_of_candidates( 10 );
+    for ( size_t i( 0 ); i != 81; ++i )
+    {
+        if ( board.value( i ) != 0 )
+            continue;
+        const unsigned int candidates = board.candidates( i );
+        const size_t ncandidates = number_of_candidates( candidates );
+        if ( ncandidates == 0 )
+            return true; // Dead end, continue the search elsewhere
+        if ( ncandidates < best_number_of_candidates )
+        {
+            best_square = i;
+            best_candidates = candidates;
+            best_number_of_candidates = ncandidates;
+            if ( ncandidates == 1 )
+                break;
+        }
+    }
+    if ( best_square == 81 )
+        return found( board );
+    for ( unsigned int bits( best_candidates ); bits != 0; bits &= bits - 1 )
+    {
+        board.place( best_square, __builtin_ctz( bits ) + 1 );
+        const bool carry_on = search( board, found );
+        board.remove( best_square );
+        if ( ! carry_on )
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+size_t count_solutions( const Sudoku & sudoku, const size_t max_solutions )
+{
+    Bitboard board;
+    if ( ( max_solutions == 0 ) || ( ! board.initialise( sudoku ) ) )
+        return 0;
+    size_t nsolutions( 0 );
+    auto found = [&]( const Bitboard & ) { ++nsolutions; return ( nsolutions < max_solutions ); };
+    search( board, found );
+    return nsolutions;
+}
+
+// ********************************************************************************
+
+std::vector< Sudoku > enumerate_solutions( const Sudoku & sudoku, const size_t max_solutions )
+{
+    std::vector< Sudoku > result;
+    Bitboard board;
+    if ( ( max_solutions == 0 ) || ( ! board.initialise( sudoku ) ) )
+        return result;
+    auto found = [&]( const Bitboard & solution ) { result.push_back( solution.to_Sudoku() ); return ( result.size() < max_solutions ); };
+    search( board, found );
+    return result;
+}
+
+// ********************************************************************************
+
+Sudoku solve_by_backtracking( const Sudoku & sudoku )
+{
+    std::vector< Sudoku > solutions = enumerate_solutions( sudoku, 1 );
+    if ( solutions.empty() )
+        throw std::runtime_error( "solve_by_backtracking(): Sudoku has no solution." );
+    return solutions[0];
+}
+
+// ********************************************************************************
+
+std::vector< Sudoku > solve_by_backtracking( const std::vector< Sudoku > & sudokus, const size_t nthreads )
+{
+    std::vector< Sudoku > result( sudokus.size() );
+    parallel_for( sudokus.size(), nthreads, [&]( const size_t i )
+    {
+        result[i] = solve_by_backtracking( sudokus[i] );
+    } );
+    return result;
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,58 @@
+#ifndef SUDOKUBACKTRACKINGSOLVER_H
+#define SUDOKUBACKTRACKINGSOLVER_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class Sudoku;
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+/*
+  Exact Sudoku solver: depth-first backtracking on bitboards (one 9-bit candidate mask per row, column and block),
+  always branching on the empty square with the fewest candidates and placing naked singles without branching.
+
+  Unlike solve() in SudokuSolver.h, which uses propagation rules and guesses with copies of the whole Sudoku,
+  this does not need a unique solution, so it can count and enumerate solutions.
+  Candidates that have already been eliminated in the input Sudoku are respected.
+*/
+
+// Counts the solutions, stops counting at max_solutions. Use max_solutions = 2 to check that a solution is unique.
+size_t count_solutions( const Sudoku & sudoku, const size_t max_solutions = 2 );
+
+// Returns at most max_solutions solutions, in the order in which they are found.
+std::vector< Sudoku > enumerate_solutions( const Sudoku & sudoku, const size_t max_solutions );
+
+// Returns the first solution, throws if there is none.
+Sudoku solve_by_backtracking( const Sudoku & sudoku );
+
+// Solves each of the Sudokus on nthreads threads (0 means one thread per core). Throws if one of them has no solution.
+std::vector< Sudoku > solve_by_backtracking( const std::vector< Sudoku > & sudokus, const size_t nthreads = 0 );
+
+#endif // SUDOKUBACKTRACKINGSOLVER_H
+
@@ -0,0 +1,193 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "SudokuBenchmark.h"
+#include "FileName.h"
+#include "ParallelFor.h"
+#include "Sudoku.h"
+#include "SudokuBacktrackingSolver.h"
+#include "SudokuSolver.h"
+#include "TextFileReader.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+double seconds_since( const std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+}
+
+} // namespace
+
+// ********************************************************************************
+
+std::string SudokuSolverStrategy2string( const SudokuSolverStrategy strategy )
+{
+    switch ( strategy )
+    {
+        case PROPAGATION_RULES : return "propagation rules";
+        case BACKTRACKING      : return "backtracking";
+    }
+    throw std::runtime_error( "SudokuSolverStrategy2string(): unknown strategy." );
+}
+
+// ********************************************************************************
+
+Sudoku string2Sudoku( const std::string & input )
+{
+    if ( input.size() != 81 )
+        throw std::runtime_error( "string2Sudoku(): a Sudoku must have 81 squares: \"" + input + "\"." );
+    std::vector< std::string > rows;
+    for ( size_t i( 0 ); i != 9; ++i )
+    {
+        std::string row = input.substr( 9 * i, 9 );
+        for ( size_t j( 0 ); j != 9; ++j )
+        {
+            if ( row[j] == '.' )
+                row[j] = '0';
+            else if ( ( row[j] < '0' ) || ( row[j] > '9' ) )
+                throw std::runtime_error( "string2Sudoku(): unexpected character: \"" + input + "\"." );
+        }
+        rows.push_back( row );
+    }
+    return Sudoku( rows );
+}
+
+// ********************************************************************************
+
+std::string Sudoku2string( const Sudoku & sudoku )
+{
+    std::string result;
+    for ( size_t i( 0 ); i != sudoku.nsquares(); ++i )
+        result += sudoku.square( i ).solved() ? static_cast<char>( '0' + sudoku.square( i ).value() ) : '0';
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< Sudoku > read_sudokus( const FileName & file_name )
+{
+    std::vector< Sudoku > result;
+    TextFileReader text_file_reader( file_name );
+    std::vector< std::string > comment_identifiers;
+    comment_identifiers.push_back( "#" );
+    text_file_reader.set_comment_identifiers( comment_identifiers );
+    std::string line;
+    while ( text_file_reader.get_next_line( line ) )
+    {
+        line = strip( line );
+        if ( line.empty() )
+            continue;
+        result.push_back( string2Sudoku( line ) );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< Sudoku > benchmark_sudokus()
+{
+    std::vector< Sudoku > result;
+    result.push_back( string2Sudoku( "900428000486000209302090854108000730009374010007850090820000906090006107060189000" ) ); // Easy
+    result.push_back( string2Sudoku( "090000713000687000720039000060200537952700000000510020109046000000001409405000108" ) ); // Medium
+    result.push_back( string2Sudoku( "090000867000010302603009000040700000000300081020805000908040070004080500006900010" ) ); // Difficult
+    result.push_back( string2Sudoku( "200000008053020970070090030000007010700000004080600000020070050031050890500000002" ) ); // Meister 1
+    result.push_back( string2Sudoku( "010753040070894050400612008007461920094527080201938400100275004020140030040380010" ) ); // Meister 2
+    result.push_back( string2Sudoku( "006000082100400300003290106089000000054013000000000073260030800000005200000004705" ) ); // Schwer
+    result.push_back( string2Sudoku( "800000000003600000070090200050007000000045700000100030001000068008500010090000400" ) ); // Toughest
+    result.push_back( string2Sudoku( "080020561000100007000500000050090408007850003090010050204001805060085000000200100" ) ); // NYT
+    result.push_back( string2Sudoku( "800006305040000070000000000010038704000104000300070290000003000020000040506800002" ) ); // Empty Rectangle
+    result.push_back( string2Sudoku( "600090007040007100002800050800000090000070000030000008050002300004500020900030004" ) ); // X-Wing
+    result.push_back( string2Sudoku( "100007090030020008009600500005300900010080002600004000300000010040000007007000300" ) ); // AI Escargot
+    return result;
+}
+
+// ********************************************************************************
+
+double SudokuBenchmarkResult::solves_per_second() const
+{
+    return ( wall_time_ > 0.0 ) ? nsudokus() / wall_time_ : 0.0;
+}
+
+// ********************************************************************************
+
+double SudokuBenchmarkResult::latency_percentile( const double percentage ) const
+{
+    if ( latencies_.empty() )
+        throw std::runtime_error( "SudokuBenchmarkResult::latency_percentile(): no Sudokus." );
+    if ( ( percentage < 0.0 ) || ( percentage > 100.0 ) )
+        throw std::runtime_error( "SudokuBenchmarkResult::latency_percentile(): percentage must be in [0,100]." );
+    size_t rank = static_cast<size_t>( std::ceil( ( percentage / 100.0 ) * latencies_.size() ) );
+    if ( rank != 0 )
+        --rank;
+    return latencies_[ rank ];
+}
+
+// ********************************************************************************
+
+std::string SudokuBenchmarkResult::report() const
+{
+    return SudokuSolverStrategy2string( strategy_ ) + ": " + size_t2string( nsudokus() ) + " Sudokus, " +
+           size_t2string( nthreads_ ) + " threads, " + double2string( solves_per_second() ) + " solves/s, latency (ms)" +
+           " p50 = " + double2string( 1000.0 * latency_percentile( 50.0 ) ) +
+           " p90 = " + double2string( 1000.0 * latency_percentile( 90.0 ) ) +
+           " p99 = " + double2string( 1000.0 * latency_percentile( 99.0 ) ) +
+           " max = " + double2string( 1000.0 * latency_percentile( 100.0 ) );
+}
+
+// ********************************************************************************
+
+SudokuBenchmarkResult benchmark( const std::vector< Sudoku > & sudokus, const SudokuSolverStrategy strategy, const size_t nthreads )
+{
+    SudokuBenchmarkResult result;
+    result.strategy_ = strategy;
+    result.nthreads_ = std::max( size_t( 1 ), std::min( ( nthreads == 0 ) ? default_nthreads() : nthreads, sudokus.size() ) );
+    result.latencies_ = std::vector< double >( sudokus.size() );
+    result.solutions_ = std::vector< Sudoku >( sudokus.size() );
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    parallel_for( sudokus.size(), result.nthreads_, [&]( const size_t i )
+    {
+        std::chrono::steady_clock::time_point start_one = std::chrono::steady_clock::now();
+        result.solutions_[i] = ( strategy == BACKTRACKING ) ? solve_by_backtracking( sudokus[i] ) : solve( sudokus[i] );
+        result.latencies_[i] = seconds_since( start_one );
+        if ( ! result.solutions_[i].solved() )
+            throw std::runtime_error( "benchmark(): Sudoku " + size_t2string( i ) + " could not be solved." );
+    } );
+    result.wall_time_ = seconds_since( start );
+    std::sort( result.latencies_.begin(), result.latencies_.end() );
+    return result;
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,85 @@
+#ifndef SUDOKUBENCHMARK_H
+#define SUDOKUBENCHMARK_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class FileName;
+class Sudoku;
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+/*
+  Batch solving of Sudokus, used as a regression benchmark for the solvers.
+
+  A puzzle file contains one Sudoku per line as 81 characters, row by row, with '0' or '.' for an empty square.
+  Empty lines and lines starting with '#' are skipped.
+*/
+
+enum SudokuSolverStrategy { PROPAGATION_RULES, BACKTRACKING };
+
+std::string SudokuSolverStrategy2string( const SudokuSolverStrategy strategy );
+
+// Throws if a line is not a valid Sudoku.
+std::vector< Sudoku > read_sudokus( const FileName & file_name );
+
+// One Sudoku, 81 characters with '0' or '.' for an empty square.
+Sudoku string2Sudoku( const std::string & input );
+
+// 81 characters with '0' for an empty square.
+std::string Sudoku2string( const Sudoku & sudoku );
+
+// The puzzles from Main.cpp, from "Easy" to "AI Escargot".
+std::vector< Sudoku > benchmark_sudokus();
+
+struct SudokuBenchmarkResult
+{
+    SudokuSolverStrategy strategy_;
+    size_t nthreads_;
+    double wall_time_;             // In seconds, for the whole batch
+    std::vector< double > latencies_; // In seconds, one per Sudoku, sorted in ascending order
+    std::vector< Sudoku > solutions_; // In the order of the input
+
+    size_t nsudokus() const { return latencies_.size(); }
+
+    double solves_per_second() const;
+
+    // Nearest-rank percentile, percentage in [0,100]. Throws if there are no Sudokus.
+    double latency_percentile( const double percentage ) const;
+
+    // One line: strategy, number of Sudokus, threads, solves per second and the 50th, 90th, 99th and 100th percentile latencies.
+    std::string report() const;
+};
+
+// Solves each of the Sudokus on nthreads threads (0 means one thread per core) and times each solve.
+// Throws if one of them could not be solved.
+SudokuBenchmarkResult benchmark( const std::vector< Sudoku > & sudokus, const SudokuSolverStrategy strategy, const size_t nthreads = 0 );
+
+#endif // SUDOKUBENCHMARK_H
+
@@ -0,0 +1,187 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SudokuGenerator.h"
+#include "ParallelFor.h"
+#include "RandomNumberGenerator.h"
+#include "Sudoku.h"
+#include "SudokuBacktrackingSolver.h"
+#include "SudokuBenchmark.h"
+#include "SudokuSolver.h"
+#include "Utilities.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+
+// Fisher-Yates
+void shuffle( std::vector< size_t > & values, RandomNumberGenerator_integer & random_number_generator )
+{
+    for ( size_t i( values.size() ); i > 1; --i )
+        std::swap( values[i-1], values[ random_number_generator.next_number( 0, static_cast<int>( i ) - 1 ) ] );
+}
+
+// ********************************************************************************
+
+// A random permutation of the nine rows or columns that keeps the bands or stacks together.
+std::vector< size_t > random_line_permutation( RandomNumberGenerator_integer & random_number_generator )
+{
+    std::vector< size_t > bands;
+    for ( size_t i( 0 ); i != 3; ++i )
+        bands.push_back( i );
+    shuffle( bands, random_number_generator );
+    std::vector< size_t > result;
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        std::vector< size_t > lines( 3 );
+        for ( size_t j( 0 ); j != 3; ++j )
+            lines[j] = 3 * bands[i] + j;
+        shuffle( lines, random_number_generator );
+        result.insert( result.end(), lines.begin(), lines.end() );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+size_t number_of_clues( const std::string & sudoku )
+{
+    size_t result( 0 );
+    for ( size_t i( 0 ); i != sudoku.size(); ++i )
+    {
+        if ( sudoku[i] != '0' )
+            ++result;
+    }
+    return result;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+std::string random_complete_grid( RandomNumberGenerator_integer & random_number_generator )
+{
+    std::string diagonal_blocks( 81, '0' );
+    for ( size_t iBlock( 0 ); iBlock != 3; ++iBlock )
+    {
+        std::vector< size_t > values;
+        for ( size_t i( 1 ); i != 10; ++i )
+            values.push_back( i );
+        shuffle( values, random_number_generator );
+        for ( size_t i( 0 ); i != 9; ++i )
+            diagonal_blocks[ 9 * ( 3 * iBlock + i / 3 ) + 3 * iBlock + i % 3 ] = static_cast<char>( '0' + values[i] );
+    }
+    const std::string grid = Sudoku2string( solve_by_backtracking( string2Sudoku( diagonal_blocks ) ) );
+    const std::vector< size_t > rows = random_line_permutation( random_number_generator );
+    const std::vector< size_t > columns = random_line_permutation( random_number_generator );
+    const bool transpose = ( random_number_generator.next_number( 0, 1 ) == 1 );
+    std::string result( 81, '0' );
+    for ( size_t i( 0 ); i != 9; ++i )
+    {
+        for ( size_t j( 0 ); j != 9; ++j )
+            result[ transpose ? 9 * j + i : 9 * i + j ] = grid[ 9 * rows[i] + columns[j] ];
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::string remove_clues( const std::string & sudoku, RandomNumberGenerator_integer & random_number_generator )
+{
+    if ( count_solutions( string2Sudoku( sudoku ), 2 ) != 1 )
+        throw std::runtime_error( "remove_clues(): Sudoku does not have a unique solution." );
+    std::vector< size_t > squares;
+    for ( size_t i( 0 ); i != 81; ++i )
+    {
+        if ( sudoku[i] != '0' )
+            squares.push_back( i );
+    }
+    shuffle( squares, random_number_generator );
+    std::string result( sudoku );
+    for ( size_t i( 0 ); i != squares.size(); ++i )
+    {
+        const char clue = result[ squares[i] ];
+        result[ squares[i] ] = '0';
+        if ( count_solutions( string2Sudoku( result ), 2 ) != 1 )
+            result[ squares[i] ] = clue;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+SudokuGenerator::SudokuGenerator():
+target_difficulty_(0),
+max_attempts_(1000),
+seed_(1),
+nthreads_(0)
+{
+}
+
+// ********************************************************************************
+
+void SudokuGenerator::set_target_difficulty( const size_t target_difficulty )
+{
+    if ( target_difficulty > 5 )
+        throw std::runtime_error( "SudokuGenerator::set_target_difficulty(): difficulty must be between 0 and 5." );
+    target_difficulty_ = target_difficulty;
+}
+
+// ********************************************************************************
+
+std::vector< GeneratedSudoku > SudokuGenerator::generate( const size_t npuzzles ) const
+{
+    std::vector< RandomNumberGenerator_integer > random_number_generators = RandomNumberGenerator_integer( seed_, PHILOX4X32 ).split( npuzzles );
+    std::vector< GeneratedSudoku > result( npuzzles );
+    parallel_for( npuzzles, nthreads_, [&]( const size_t i )
+    {
+        for ( size_t iAttempt( 0 ); iAttempt != max_attempts_; ++iAttempt )
+        {
+            GeneratedSudoku generated_sudoku;
+            generated_sudoku.solution_ = random_complete_grid( random_number_generators[i] );
+            generated_sudoku.puzzle_ = remove_clues( generated_sudoku.solution_, random_number_generators[i] );
+            generated_sudoku.difficulty_ = number_of_rules_needed( string2Sudoku( generated_sudoku.puzzle_ ) );
+            if ( ( target_difficulty_ == 0 ) || ( generated_sudoku.difficulty_ == target_difficulty_ ) )
+            {
+                generated_sudoku.nclues_ = number_of_clues( generated_sudoku.puzzle_ );
+                result[i] = generated_sudoku;
+                return;
+            }
+        }
+    } );
+    for ( size_t i( 0 ); i != npuzzles; ++i )
+    {
+        if ( result[i].puzzle_.empty() )
+            throw std::runtime_error( "SudokuGenerator::generate(): no Sudoku with difficulty " + size_t2string( target_difficulty_ ) + " found in " + size_t2string( max_attempts_ ) + " attempts." );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
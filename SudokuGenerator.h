@@ -0,0 +1,104 @@
+#ifndef SUDOKUGENERATOR_H
+#define SUDOKUGENERATOR_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+class RandomNumberGenerator_integer;
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+/*
+  Generates Sudokus with a unique solution, e.g. as stress tests for the solvers.
+
+  Each puzzle starts from a random complete grid: the three blocks on the diagonal, which do not constrain each other, are filled with
+  random permutations, the rest is filled in by the backtracking solver of SudokuBacktrackingSolver.h, and the bands, stacks, rows within a band
+  and columns within a stack are shuffled. The clues are then removed in random order; a removal is undone if count_solutions() with a cutoff of 2
+  finds more than one solution, so the puzzle is minimal: no clue can be removed without losing uniqueness.
+
+  The difficulty is number_of_rules_needed() from SudokuSolver.h, 1 to 5. Puzzles that do not have the target difficulty are discarded and
+  a new grid is tried. Puzzle i is generated from its own random number stream, split() from one PHILOX4X32 generator,
+  so the puzzles depend on the seed but not on the number of threads.
+
+  Sudokus are represented as 81 characters, row by row, with '0' for an empty square, as in Sudoku2string(), because the constructor of Sudoku
+  already fills in some of the squares.
+*/
+
+struct GeneratedSudoku
+{
+    GeneratedSudoku(): nclues_(0), difficulty_(0) {}
+
+    std::string puzzle_;
+    std::string solution_;
+    size_t nclues_;
+    size_t difficulty_;
+};
+
+// A random complete grid.
+std::string random_complete_grid( RandomNumberGenerator_integer & random_number_generator );
+
+// Removes clues in random order as long as the solution stays unique. Throws if the input does not have a unique solution.
+std::string remove_clues( const std::string & sudoku, RandomNumberGenerator_integer & random_number_generator );
+
+class SudokuGenerator
+{
+public:
+
+    SudokuGenerator();
+
+    // 0 means any difficulty, otherwise 1 to 5, see number_of_rules_needed(). The default is 0.
+    size_t target_difficulty() const { return target_difficulty_; }
+    void set_target_difficulty( const size_t target_difficulty );
+
+    // The number of complete grids that are tried per puzzle before generate() gives up. The default is 1000.
+    size_t max_attempts() const { return max_attempts_; }
+    void set_max_attempts( const size_t max_attempts ) { max_attempts_ = max_attempts; }
+
+    // The default is 1.
+    int seed() const { return seed_; }
+    void set_seed( const int seed ) { seed_ = seed; }
+
+    // 0 means one thread per core. Default 0.
+    size_t nthreads() const { return nthreads_; }
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; }
+
+    // Throws if for one of the puzzles no grid with the target difficulty was found within max_attempts() attempts.
+    std::vector< GeneratedSudoku > generate( const size_t npuzzles ) const;
+
+private:
+    size_t target_difficulty_;
+    size_t max_attempts_;
+    int seed_;
+    size_t nthreads_;
+};
+
+#endif // SUDOKUGENERATOR_H
+
@@ -42,14 +42,56 @@ namespace {
 
 // ********************************************************************************
 
-bool contains( const std::vector< size_t > & values, const size_t target )
+// Returns the mask of the values that occur in exactly N of the squares marked in squares_mask.
+// The frequencies of all nine values are counted at once with a bit-sliced 4-bit counter per value.
+unsigned int candidates_with_frequency( const unsigned int candidates[9], const unsigned int squares_mask, const size_t N )
 {
-    for ( size_t i( 0 ); i != values.size(); ++i )
+    unsigned int bit_0( 0 );
+    unsigned int bit_1( 0 );
+    unsigned int bit_2( 0 );
+    unsigned int bit_3( 0 );
+    for ( size_t i( 0 ); i != 9; ++i )
     {
-        if ( values[i] == target )
-            return true;
+        if ( ( squares_mask & ( 1U << i ) ) == 0 )
+            continue;
+        unsigned int carry = candidates[i];
+        unsigned int next_carry = bit_0 & carry;
+        bit_0 ^= carry;
+        carry = next_carry;
+        next_carry = bit_1 & carry;
+        bit_1 ^= carry;
+        carry = next_carry;
+        next_carry = bit_2 & carry;
+        bit_2 ^= carry;
+        bit_3 ^= next_carry;
     }
-    return false;
+    return ALL_SUDOKU_CANDIDATES & ( ( N & 1 ) ? bit_0 : ~bit_0 ) &
+                                   ( ( N & 2 ) ? bit_1 : ~bit_1 ) &
+                                   ( ( N & 4 ) ? bit_2 : ~bit_2 ) &
+                                   ( ( N & 8 ) ? bit_3 : ~bit_3 );
+}
+
+// ********************************************************************************
+
+// Mask of the unsolved squares of a slice of nine
+unsigned int unsolved_squares_mask( const unsigned int candidates[9] )
+{
+    unsigned int result( 0 );
+    for ( size_t i( 0 ); i != 9; ++i )
+    {
+        if ( number_of_candidates( candidates[i] ) > 1 )
+            result |= ( 1U << i );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+// The candidate masks of the nine squares of a slice.
+void get_candidates( const OneSudokuSlice & slice, unsigned int candidates[9] )
+{
+    for ( size_t i( 0 ); i != 9; ++i )
+        candidates[i] = slice.square( i ).candidates();
 }
 
 // ********************************************************************************
@@ -57,125 +99,96 @@ bool contains( const std::vector< size_t > & values, const size_t target )
 // Returns true if a change was made
 bool check_if_we_are_the_only_possibility( OneSudokuSlice & slice )
 {
-    bool something_changed_on_first_pass( false );
-    bool something_changed( true );
- //   while ( something_changed ) // @@ Using this causes errors, I do not understand why
-    {
-        something_changed = false;
-        
-        // If there are N (or more) numbers with a frequency of N, and they are in the same N squares, regardless of what else is in those squares,
-        // those N numbers cannot be anywhere else, and those N squares can only contain those N numbers. E.g. | 12 | 129 | with no other squares with 1 or 2.
-        // This also includes the case where frequency is 1.
+    if ( slice.size() != 9 )
+        throw std::runtime_error( "check_if_we_are_the_only_possibility(): slice should have size() == 9." );
+    // All the set logic is done on the candidate masks of the nine squares, which are written back at the end
+    unsigned int candidates[9];
+    get_candidates( slice, candidates );
+    unsigned int original_candidates[9];
+    for ( size_t i( 0 ); i != 9; ++i )
+        original_candidates[i] = candidates[i];
 
-        for ( size_t N( 1 ); N != 8; ++N )
+    // If there are N (or more) numbers with a frequency of N, and they are in the same N squares, regardless of what else is in those squares,
+    // those N numbers cannot be anywhere else, and those N squares can only contain those N numbers. E.g. | 12 | 129 | with no other squares with 1 or 2.
+    // This also includes the case where frequency is 1.
+    for ( size_t N( 1 ); N != 8; ++N )
+    {
+        const unsigned int unsolved = unsolved_squares_mask( candidates );
+        if ( static_cast<int>( N ) > ( static_cast<int>( number_of_candidates( unsolved ) ) - 1 ) )
+            break;
+        const unsigned int frequency_is_N = candidates_with_frequency( candidates, unsolved, N );
+        if ( number_of_candidates( frequency_is_N ) < N )
+            continue;
+        // Each subset of N of those numbers. Because each number occurs in exactly N squares,
+        // the squares that contain all of them must be exactly N squares.
+        for ( unsigned int isolated_values( frequency_is_N ); isolated_values != 0; isolated_values = ( isolated_values - 1 ) & frequency_is_N )
         {
-            std::vector< size_t > unsolved_squares_indices = slice.indices_of_unsolved_squares();
-            if ( static_cast<int>( N ) > ( static_cast<int>( unsolved_squares_indices.size() ) - 1 ) )
-                break;
-                
-            // For each number present in an unsolved square, count how many occurrences there are.
-            SetOfNumbers values;
-            for ( size_t i( 0 ); i != unsolved_squares_indices.size(); ++i )
-            {
-                OneSudokuSquare square = slice.square( unsolved_squares_indices[i] );
-                values.add( square.values() );
-            }
-            std::vector< size_t > frequency_is_N;
-            for ( size_t i( 1 ); i != 10; ++i )
+            if ( number_of_candidates( isolated_values ) != N )
+                continue;
+            unsigned int squares( 0 );
+            for ( size_t i( 0 ); i != 9; ++i )
             {
-                if ( values.frequency( i ) == N )
-                    frequency_is_N.push_back( i );
+                if ( ( unsolved & ( 1U << i ) ) && ( ( candidates[i] & isolated_values ) == isolated_values ) )
+                    squares |= ( 1U << i );
             }
-            if ( ! ( frequency_is_N.size() < N ) )
+            if ( number_of_candidates( squares ) != N )
+                continue;
+            for ( size_t i( 0 ); i != 9; ++i )
             {
-                // The fastest is actually to just take all k-in-N and go through all of them and reject the ones that do not fit.
-                // There will be very few, and trying to generate exactly those few is going to be a nightmare.
-                GenerateCombinations generate_combinations( unsolved_squares_indices, N );
-                std::vector< size_t > combination;
-                while ( generate_combinations.next_combination( combination ) )
-                {
-                    GenerateCombinations generate_combinations_2( frequency_is_N, N );
-                    std::vector< size_t > combination_2;
-                    while ( generate_combinations_2.next_combination( combination_2 ) )
-                    {
-                        // Do all of the squares have all of the numbers?
-                        bool accept( true );
-                        for ( size_t i( 0 ); i != combination.size(); ++i )
-                        {
-                            for ( size_t j( 0 ); j != combination_2.size(); ++j )
-                            {
-                                if ( ! slice.square( combination[i] ).contains( combination_2[j] ) )
-                                    accept = false;
-                            }
-                        }
-                        if ( accept )
-                        {
-                            SetOfNumbers set_of_numbers( combination_2 );
-                            OneSudokuSquare isolated_values( set_of_numbers );
-                            // Find the squares
-                            for ( size_t i( 0 ); i != unsolved_squares_indices.size(); ++i )
-                            {
-                                OneSudokuSquare square = slice.square( unsolved_squares_indices[i] );
-                                if ( square.contains( combination_2[0] ) )
-                                {
-                                    if ( ! ( square == isolated_values ) )
-                                    {
-                                        slice.set_square( unsolved_squares_indices[i], isolated_values );
-                                        something_changed_on_first_pass = true;
-                                        something_changed = true;
-            //                            std::cout << "2. We did something for N = " << N << ", slice ID = " << slice.id() << ", values are ";
-            //                            isolated_values.show();
-            //                            std::cout << std::endl;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+                if ( squares & ( 1U << i ) )
+                    candidates[i] = isolated_values;
             }
         }
-        for ( size_t N( 2 ); N != 8; ++N )
+    }
+    for ( size_t N( 2 ); N != 8; ++N )
+    {
+        // If N squares contain exactly N numbers, those N numbers cannot be anywhere else. Their frequencies are irrelevant.
+        // e.g. | 459 | 45 | 45 | (two squares block 45) or | 12 | 19 | 29 | 14 | (three squares block 129).
+        const unsigned int unsolved = unsolved_squares_mask( candidates );
+        if ( static_cast<int>( N ) > ( static_cast<int>( number_of_candidates( unsolved ) ) - 1 ) )
+            break;
+        // Add the unknowns from any combination of N squares and check if there are N unknowns.
+        // The combinations are generated as N-in-k bit patterns over the k unsolved squares.
+        size_t unsolved_squares[9];
+        size_t k( 0 );
+        for ( size_t i( 0 ); i != 9; ++i )
         {
-            // If N squares contain exactly N numbers, those N numbers cannot be anywhere else. Their frequencies are irrelevant.
-            // e.g. | 459 | 45 | 45 | (two squares block 45) or | 12 | 19 | 29 | 14 | (three squares block 129).
-            // N == 1 never passes the merged.size() == N test so it is essentially ignored
-            std::vector< size_t > unsolved_squares_indices = slice.indices_of_unsolved_squares();
-            if ( static_cast<int>( N ) > ( static_cast<int>( unsolved_squares_indices.size() ) - 1 ) )
-                break;
-            // Add the unknowns from any combination of N squares and check if there are N unknowns
-            GenerateCombinations generate_combinations( unsolved_squares_indices, N );
-            std::vector< size_t > combination;
-            while ( generate_combinations.next_combination( combination ) )
+            if ( unsolved & ( 1U << i ) )
+                unsolved_squares[k++] = i;
+        }
+        for ( unsigned int compact_combination( ( 1U << N ) - 1 ); compact_combination < ( 1U << k ); compact_combination = static_cast<unsigned int>( next_combination_bitmask( compact_combination ) ) )
+        {
+            unsigned int combination( 0 );
+            unsigned int merged( 0 );
+            for ( unsigned int bits( compact_combination ); bits != 0; bits &= bits - 1 )
             {
-                OneSudokuSquare merged( slice.square( combination[0] ) );
-                for ( size_t i( 1 ); i != combination.size(); ++i )
-                    merged = merge( merged, slice.square( combination[i] ) );
-                if ( merged.size() == N )
-                {
-                    // Unset these values in the other squares
-                    for ( size_t i( 0 ); i != slice.size(); ++i )
-                    {
-                        OneSudokuSquare square = slice.square( i );
-                        if ( square.solved() )
-                            continue;
-                        if ( contains( combination, i ) )
-                            continue;
-                        if ( square.unset( merged ) )
-                        {
-                            slice.set_square( i, square );
-                            something_changed_on_first_pass = true;
-                            something_changed = true;
-        //                    std::cout << "3. We did something for N = " << N << ", slice ID = " << slice.id() << ", values are ";
-        //                    merged.show();
-        //                    std::cout << std::endl;
-                       //     std::cout << "Changed square = " << i << std::endl;
-                        }
-                    }
-                }
+                const size_t i = unsolved_squares[ __builtin_ctz( bits ) ];
+                combination |= ( 1U << i );
+                merged |= candidates[i];
+            }
+            if ( number_of_candidates( merged ) != N )
+                continue;
+            // Unset these values in the other unsolved squares
+            for ( size_t i( 0 ); i != 9; ++i )
+            {
+                if ( ( combination & ( 1U << i ) ) || ( number_of_candidates( candidates[i] ) == 1 ) )
+                    continue;
+                candidates[i] &= ~merged;
+                if ( candidates[i] == 0 )
+                    throw std::runtime_error( "check_if_we_are_the_only_possibility(): contradiction." );
             }
         }
     }
-    return something_changed_on_first_pass;
+    bool something_changed( false );
+    for ( size_t i( 0 ); i != 9; ++i )
+    {
+        if ( candidates[i] != original_candidates[i] )
+        {
+            slice.set_square( i, OneSudokuSquare::from_candidates( candidates[i] ) );
+            something_changed = true;
+        }
+    }
+    return something_changed;
 }
 
 // ********************************************************************************
@@ -204,12 +217,11 @@ bool holistic( Sudoku & sudoku )
         {
             TransSquareDependency tsd = sudoku.next_trans_square_dependency();
             OneSudokuSlice determining_values = tsd.determining_values();
-            SetOfNumbers all_possible_numbers = determining_values.collect_all_possible_numbers();
-            if ( all_possible_numbers.size() != 9 )
+            const unsigned int all_possible_numbers = determining_values.collect_all_candidates();
+            if ( all_possible_numbers != ALL_SUDOKU_CANDIDATES )
             {
                 // Invert the selection
-                OneSudokuSquare square; // Initialises to all 9 possibilities
-                square.unset( all_possible_numbers );
+                OneSudokuSquare square = OneSudokuSquare::from_candidates( ALL_SUDOKU_CANDIDATES & ~all_possible_numbers );
                 OneSudokuSlice values_to_be_changed = tsd.values_to_be_changed();
                 bool there_was_a_change( false );
                 for ( size_t j( 0 ); j != values_to_be_changed.size(); ++j )
@@ -248,22 +260,13 @@ bool apply_X_Wings_on_rows( Sudoku & sudoku, const size_t iRow_1, const size_t i
         std::vector< size_t > unsolved_squares_indices = slice_row_1.indices_of_unsolved_squares();
         if ( unsolved_squares_indices.size() < 2 )
             continue;
-        SetOfNumbers frequency_is_2_in_row_1( SetOfNumbers::THROW );
+        unsigned int frequency_is_2_in_row_1( 0 );
         { // Scoping brackets
-            // For each number present in an unsolved square, count how many occurrences there are.
-            SetOfNumbers values;
-            for ( size_t i( 0 ); i != unsolved_squares_indices.size(); ++i )
-            {
-                OneSudokuSquare square = slice_row_1.square( unsolved_squares_indices[i] );
-                values.add( square.values() );
-            }
-            for ( size_t i( 1 ); i != 10; ++i )
-            {
-                if ( values.frequency( i ) == 2 )
-                    frequency_is_2_in_row_1.add( i );
-            }
+            unsigned int candidates[9];
+            get_candidates( slice_row_1, candidates );
+            frequency_is_2_in_row_1 = candidates_with_frequency( candidates, unsolved_squares_mask( candidates ), 2 );
         } // Scoping brackets
-        if ( frequency_is_2_in_row_1.empty()  )
+        if ( frequency_is_2_in_row_1 == 0 )
             continue;
         for ( size_t row_2( iRow_2 ); row_2 != iRow_2+3; ++row_2 )
         {
@@ -271,30 +274,22 @@ bool apply_X_Wings_on_rows( Sudoku & sudoku, const size_t iRow_1, const size_t i
             unsolved_squares_indices = slice_row_2.indices_of_unsolved_squares();
             if ( unsolved_squares_indices.size() < 2 )
                 continue;
-            SetOfNumbers frequency_is_2_in_row_2( SetOfNumbers::THROW );
+            unsigned int frequency_is_2_in_row_2( 0 );
             { // Scoping brackets
-                // For each number present in an unsolved square, count how many occurrences there are.
-                SetOfNumbers values;
-                for ( size_t i( 0 ); i != unsolved_squares_indices.size(); ++i )
-                {
-                    OneSudokuSquare square = slice_row_2.square( unsolved_squares_indices[i] );
-                    values.add( square.values() );
-                }
-                for ( size_t i( 1 ); i != 10; ++i )
-                {
-                    if ( values.frequency( i ) == 2 )
-                        frequency_is_2_in_row_2.add( i );
-                }
+                unsigned int candidates[9];
+                get_candidates( slice_row_2, candidates );
+                frequency_is_2_in_row_2 = candidates_with_frequency( candidates, unsolved_squares_mask( candidates ), 2 );
             } // Scoping brackets
-            if ( frequency_is_2_in_row_2.empty()  )
+            if ( frequency_is_2_in_row_2 == 0 )
                 continue;
             // When we are here, both row 1 and row 2 have at least one number that occurs in exactly two unsolved squares.
             // First, check if they have any numbers in common.
-            SetOfNumbers intersection = frequency_is_2_in_row_1.in_common( frequency_is_2_in_row_2 );
+            const unsigned int intersection = frequency_is_2_in_row_1 & frequency_is_2_in_row_2;
             // Second, the numbers must occur in the same two columns.
-            for ( size_t i( 0 ); i != intersection.size(); ++i )
+            for ( size_t x_wing_value( 1 ); x_wing_value != 10; ++x_wing_value )
             {
-                size_t x_wing_value = intersection.value( i );
+                if ( ( intersection & sudoku_candidate( x_wing_value ) ) == 0 )
+                    continue;
                 size_t row_1_col_1( 9 );
                 size_t row_1_col_2( 9 );
                 size_t row_2_col_1( 9 );
@@ -387,22 +382,13 @@ bool apply_X_Wings_on_columns( Sudoku & sudoku, const size_t iCol_1, const size_
         std::vector< size_t > unsolved_squares_indices = slice_col_1.indices_of_unsolved_squares();
         if ( unsolved_squares_indices.size() < 2 )
             continue;
-        SetOfNumbers frequency_is_2_in_col_1( SetOfNumbers::THROW );
+        unsigned int frequency_is_2_in_col_1( 0 );
         { // Scoping brackets
-            // For each number present in an unsolved square, count how many occurrences there are.
-            SetOfNumbers values;
-            for ( size_t i( 0 ); i != unsolved_squares_indices.size(); ++i )
-            {
-                OneSudokuSquare square = slice_col_1.square( unsolved_squares_indices[i] );
-                values.add( square.values() );
-            }
-            for ( size_t i( 1 ); i != 10; ++i )
-            {
-                if ( values.frequency( i ) == 2 )
-                    frequency_is_2_in_col_1.add( i );
-            }
+            unsigned int candidates[9];
+            get_candidates( slice_col_1, candidates );
+            frequency_is_2_in_col_1 = candidates_with_frequency( candidates, unsolved_squares_mask( candidates ), 2 );
         } // Scoping brackets
-        if ( frequency_is_2_in_col_1.empty()  )
+        if ( frequency_is_2_in_col_1 == 0 )
             continue;
         for ( size_t col_2( iCol_2 ); col_2 != iCol_2+3; ++col_2 )
         {
@@ -410,30 +396,22 @@ bool apply_X_Wings_on_columns( Sudoku & sudoku, const size_t iCol_1, const size_
             unsolved_squares_indices = slice_col_2.indices_of_unsolved_squares();
             if ( unsolved_squares_indices.size() < 2 )
                 continue;
-            SetOfNumbers frequency_is_2_in_col_2( SetOfNumbers::THROW );
+            unsigned int frequency_is_2_in_col_2( 0 );
             { // Scoping brackets
-                // For each number present in an unsolved square, count how many occurrences there are.
-                SetOfNumbers values;
-                for ( size_t i( 0 ); i != unsolved_squares_indices.size(); ++i )
-                {
-                    OneSudokuSquare square = slice_col_2.square( unsolved_squares_indices[i] );
-                    values.add( square.values() );
-                }
-                for ( size_t i( 1 ); i != 10; ++i )
-                {
-                    if ( values.frequency( i ) == 2 )
-                        frequency_is_2_in_col_2.add( i );
-                }
+                unsigned int candidates[9];
+                get_candidates( slice_col_2, candidates );
+                frequency_is_2_in_col_2 = candidates_with_frequency( candidates, unsolved_squares_mask( candidates ), 2 );
             } // Scoping brackets
-            if ( frequency_is_2_in_col_2.empty()  )
+            if ( frequency_is_2_in_col_2 == 0 )
                 continue;
             // When we are here, both column 1 and column 2 have at least one number that occurs in exactly two unsolved squares.
             // First, check if they have any numbers in common.
-            SetOfNumbers intersection = frequency_is_2_in_col_1.in_common( frequency_is_2_in_col_2 );
+            const unsigned int intersection = frequency_is_2_in_col_1 & frequency_is_2_in_col_2;
             // Second, the numbers must occur in the same two rows.
-            for ( size_t i( 0 ); i != intersection.size(); ++i )
+            for ( size_t x_wing_value( 1 ); x_wing_value != 10; ++x_wing_value )
             {
-                size_t x_wing_value = intersection.value( i );
+                if ( ( intersection & sudoku_candidate( x_wing_value ) ) == 0 )
+                    continue;
                 size_t col_1_row_1( 9 );
                 size_t col_1_row_2( 9 );
                 size_t col_2_row_1( 9 );
@@ -615,7 +593,8 @@ bool empty_rectangle( Sudoku & sudoku )
 
 // ********************************************************************************
 
-void solve_without_guessing( Sudoku & result, bool & error_caught )
+// Only the first nrules of the propagation rules are applied, see number_of_rules_needed().
+void solve_without_guessing( Sudoku & result, bool & error_caught, const size_t nrules = 4 )
 {
     error_caught = false;
     try
@@ -644,7 +623,7 @@ void solve_without_guessing( Sudoku & result, bool & error_caught )
                     }
                 }
             }
-            if ( holistic( result ) )
+            if ( ( nrules >= 2 ) && holistic( result ) )
             {
                 there_were_changes = true;
                 for ( size_t i( 0 ); i != Sudoku::number_of_slices(); ++i )
@@ -660,7 +639,7 @@ void solve_without_guessing( Sudoku & result, bool & error_caught )
                     }
                 }
             }
-            if ( apply_X_Wings( result ) )
+            if ( ( nrules >= 3 ) && apply_X_Wings( result ) )
             {
                 there_were_changes = true;
                 for ( size_t i( 0 ); i != Sudoku::number_of_slices(); ++i )
@@ -676,7 +655,7 @@ void solve_without_guessing( Sudoku & result, bool & error_caught )
                     }
                 }
             }
-            if ( empty_rectangle( result ) )
+            if ( ( nrules >= 4 ) && empty_rectangle( result ) )
             {
                 there_were_changes = true;
                 for ( size_t i( 0 ); i != Sudoku::number_of_slices(); ++i )
@@ -707,20 +686,12 @@ void solve_without_guessing( Sudoku & result, bool & error_caught )
 Sudoku solve( const Sudoku & sudoku )
 {
     Sudoku result( sudoku );
-    size_t niterations( 0 );
     Stack< Sudoku > sudoku_guesses;
     Stack< size_t > square_indices;
     Stack< size_t > guessed_number_indices;
-    size_t nguesses( 0 );
     bool error_caught( false );
-    size_t max_sp( 0 );
     do
     {
-        if ( sudoku_guesses.stack_pointer() > max_sp )
-            max_sp = sudoku_guesses.stack_pointer();
- //       std::cout << "stack pointer = " << sudoku_guesses.stack_pointer() << ", max. stack pointer = " << max_sp << std::endl;
-        ++niterations;
-
         solve_without_guessing( result, error_caught );
 
     //    if ( false )
@@ -733,7 +704,7 @@ Sudoku solve( const Sudoku & sudoku )
             {
                 if ( result.square( square_index ).solved() )
                     continue;
-                if ( result.square( square_index ).values().size() > 2 )
+                if ( result.square( square_index ).size() > 2 )
                     continue;
                 // Try the first value
                 sudoku_guesses.push( result );
@@ -785,8 +756,6 @@ Sudoku solve( const Sudoku & sudoku )
         // 3. the sudoku has errors / contradictions
         if ( error_caught || ( ! result.solved() ) || result.there_are_contradictions() )
         {
-            ++nguesses;
-     //       std::cout << "nguesses = " << nguesses << std::endl;
             if ( error_caught || result.there_are_contradictions() )
             {
                 bool found( false );
@@ -852,10 +821,25 @@ Sudoku solve( const Sudoku & sudoku )
             }
         }
     } while ( ! result.solved() );
-    std::cout << "Number of iterations: " << niterations % 27 << std::endl;
-    std::cout << "stack pointer = " << sudoku_guesses.stack_pointer() << ", max. stack pointer = " << max_sp << std::endl;
     return result;
 }
 
 // ********************************************************************************
 
+size_t number_of_rules_needed( const Sudoku & sudoku )
+{
+    for ( size_t nrules( 1 ); nrules != 5; ++nrules )
+    {
+        Sudoku result( sudoku );
+        bool error_caught( false );
+        solve_without_guessing( result, error_caught, nrules );
+        if ( error_caught || result.there_are_contradictions() )
+            throw std::runtime_error( "number_of_rules_needed(): Sudoku has no solution." );
+        if ( result.solved() )
+            return nrules;
+    }
+    return 5;
+}
+
+// ********************************************************************************
+
@@ -30,7 +30,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 class Sudoku;
 
+#include <cstddef> // For definition of size_t
+
 Sudoku solve( const Sudoku & sudoku );
 
+// A difficulty rating: the number of propagation rules of solve() that are needed to solve the Sudoku without guessing. The rules are added in the order
+//     1 hidden and naked singles and subsets within a row, column or block
+//     2 holistic(), the interactions between a block and a row or column
+//     3 X-Wings
+//     4 empty rectangles
+// and 5 is returned if the Sudoku cannot be solved without guessing. Throws if a contradiction is found.
+size_t number_of_rules_needed( const Sudoku & sudoku );
+
 #endif // SUDOKUSOLVER_H
 
@@ -32,6 +32,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Utilities.h"
 
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <stdexcept>
 
 // ********************************************************************************
@@ -54,99 +56,92 @@ translation_vector_( translation_vector )
 
 // ********************************************************************************
 
-SymmetryOperator::SymmetryOperator( std::string input ) :
+SymmetryOperator::SymmetryOperator( const std::string & input ) :
 rotation_matrix_( 0.0, 0.0, 0.0,
                   0.0, 0.0, 0.0,
                   0.0, 0.0, 0.0 ),
 translation_vector_( 0.0, 0.0, 0.0 )
 {
-    std::string original_input( input );
-    // Remove all spaces
-    input = remove( input, ' ' );
-    // Split into three parts separated by commas
-    std::vector< std::string > parts;
-    // Find the position of the first comma
-    size_t iPos1 = input.find_first_of( "," );
-    if ( iPos1 == std::string::npos )
-        throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): symmetry line must contain two commas: " + original_input );
-    if ( iPos1 == 0 )
-        throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): symmetry line cannot contain empty field: " + original_input );
-    parts.push_back( input.substr( 0, iPos1 ) );
-    size_t iPos2 = input.find_first_of( ",", iPos1+1 );
-    if ( iPos2 == std::string::npos )
-        throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): symmetry line must contain two commas: " + original_input );
-    if ( ( iPos2 == iPos1+1 ) || ( iPos2 == input.length()-1 ) )
-        throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): symmetry line cannot contain empty field: " + original_input );
-    parts.push_back( input.substr( iPos1+1, iPos2 - (iPos1+1) ) );
-    parts.push_back( input.substr( iPos2+1 ) );
-    // For each part, separate into parts separated by "+" or "-"
-    // This can be made easier by replacing each "-" except the first by "+-" (this turns a binary minus into a unary minus)
-    size_t iPos;
+    // Single pass over the characters, nothing is copied or allocated unless an error is thrown.
+    // Each of the three comma-separated fields is a sum of signed terms, a term being x, y, z or a number such as 1/2 or 0.25.
+    const char * iPos = input.c_str();
     for ( size_t i( 0 ); i != 3; ++i )
     {
-        // Find reference to x
-        iPos = parts[i].find_first_of( "xX" );
-        if ( iPos != std::string::npos )
-        {
-            if ( ( iPos == 0 ) || ( parts[i][iPos-1] == '+' ) )
-                rotation_matrix_.set_value( i, 0, +1.0 );
-            else if ( parts[i][iPos-1] == '-' )
-                rotation_matrix_.set_value( i, 0, -1.0 );
-            else
-                throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): \"x\" cannot be preceded by character other than + or -: " + original_input );
-            parts[i].erase( iPos, 1 );
-            if ( iPos != 0 )
-                parts[i].erase( iPos-1, 1 );
-        }
-        // Find reference to y
-        iPos = parts[i].find_first_of( "yY" );
-        if ( iPos != std::string::npos )
-        {
-            if ( ( iPos == 0 ) || ( parts[i][iPos-1] == '+' ) )
-                rotation_matrix_.set_value( i, 1, +1.0 );
-            else if ( parts[i][iPos-1] == '-' )
-                rotation_matrix_.set_value( i, 1, -1.0 );
-            else
-                throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): \"y\" cannot be preceded by character other than + or -: " + original_input );
-            parts[i].erase( iPos, 1 );
-            if ( iPos != 0 )
-                parts[i].erase( iPos-1, 1 );
-        }
-        // Find reference to z
-        iPos = parts[i].find_first_of( "zZ" );
-        if ( iPos != std::string::npos )
-        {
-            if ( ( iPos == 0 ) || ( parts[i][iPos-1] == '+' ) )
-                rotation_matrix_.set_value( i, 2, +1.0 );
-            else if ( parts[i][iPos-1] == '-' )
-                rotation_matrix_.set_value( i, 2, -1.0 );
-            else
-                throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): \"z\" cannot be preceded by character other than + or -: " + original_input );
-            parts[i].erase( iPos, 1 );
-            if ( iPos != 0 )
-                parts[i].erase( iPos-1, 1 );
-        }
-        // Whatever is left must be the translational part
+        bool field_is_empty( true );
         double translational_part( 0.0 );
-        if ( parts[i].length() != 0 )
+        while ( true )
         {
-            // Is it expressed as a fraction?
-            iPos = parts[i].find_first_of( "//" );
-            if ( iPos == 0 )
-                throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): fractional part cannot start with // : " + original_input );
-            if ( iPos == parts[i].length() )
-                throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): fractional part cannot end with // : " + original_input );
-            if ( iPos != std::string::npos )
+            while ( *iPos == ' ' )
+                ++iPos;
+            if ( ( *iPos == ',' ) || ( *iPos == '\0' ) )
+                break;
+            double sign( 1.0 );
+            bool has_sign( false );
+            if ( ( *iPos == '+' ) || ( *iPos == '-' ) )
             {
-                int numerator = string2integer( parts[i].substr( 0, iPos ) );
-                if ( ( parts[i][iPos+1] == '+' ) || ( parts[i][iPos+1] == '-' ) )
-                    throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): could not parse //+ or //- : " + original_input );
-                int denominator = string2integer( parts[i].substr( iPos+1 ) );
-                translational_part = static_cast<double>(numerator) / static_cast<double>(denominator);
+                sign = ( *iPos == '-' ) ? -1.0 : 1.0;
+                has_sign = true;
+                ++iPos;
+                while ( *iPos == ' ' )
+                    ++iPos;
             }
+            else if ( ! field_is_empty )
+                throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): terms must be separated by + or -: " + input );
+            const char c = *iPos;
+            if ( ( c == 'x' ) || ( c == 'X' ) || ( c == 'y' ) || ( c == 'Y' ) || ( c == 'z' ) || ( c == 'Z' ) )
+            {
+                const size_t j = ( ( c == 'x' ) || ( c == 'X' ) ) ? 0 : ( ( ( c == 'y' ) || ( c == 'Y' ) ) ? 1 : 2 );
+                if ( rotation_matrix_.value( i, j ) != 0.0 )
+                    throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): \"" + std::string( 1, c ) + "\" occurs twice in the same field: " + input );
+                rotation_matrix_.set_value( i, j, sign );
+                ++iPos;
+            }
+            else if ( is_digit( c ) || ( c == '.' ) )
+            {
+                // Numbers are accumulated as integers, so that e.g. 0.5 and 1/2 are exact
+                double numerator( 0.0 );
+                double scale( 1.0 );
+                while ( is_digit( *iPos ) )
+                    numerator = 10.0 * numerator + ( *iPos++ - '0' );
+                if ( *iPos == '.' )
+                {
+                    ++iPos;
+                    while ( is_digit( *iPos ) )
+                    {
+                        numerator = 10.0 * numerator + ( *iPos++ - '0' );
+                        scale *= 10.0;
+                    }
+                }
+                double denominator( 1.0 );
+                if ( *iPos == '/' )
+                {
+                    ++iPos;
+                    if ( ! is_digit( *iPos ) )
+                        throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): / must be followed by an integer: " + input );
+                    denominator = 0.0;
+                    while ( is_digit( *iPos ) )
+                        denominator = 10.0 * denominator + ( *iPos++ - '0' );
+                    if ( denominator == 0.0 )
+                        throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): division by zero: " + input );
+                }
+                if ( ( *iPos == 'x' ) || ( *iPos == 'X' ) || ( *iPos == 'y' ) || ( *iPos == 'Y' ) || ( *iPos == 'z' ) || ( *iPos == 'Z' ) )
+                    throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): \"" + std::string( 1, *iPos ) + "\" cannot be preceded by character other than + or -: " + input );
+                translational_part += sign * numerator / ( scale * denominator );
+            }
+            else if ( has_sign )
+                throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): + or - must be followed by x, y, z or a number: " + input );
             else
-                translational_part = string2double( parts[i] );
+                throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): unexpected character: " + input );
+            field_is_empty = false;
         }
+        if ( field_is_empty )
+            throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): symmetry line cannot contain empty field: " + input );
+        if ( ( i != 2 ) && ( *iPos != ',' ) )
+            throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): symmetry line must contain two commas: " + input );
+        if ( ( i == 2 ) && ( *iPos != '\0' ) )
+            throw std::runtime_error( "SymmetryOperator::SymmetryOperator( std::string ): symmetry line must contain two commas: " + input );
+        if ( i != 2 )
+            ++iPos;
         translation_vector_.set_value( i, translational_part );
     }
     canonicalise();
@@ -281,3 +276,33 @@ Vector3D operator*( const SymmetryOperator & symmetry_operator, const Vector3D &
          
 // ********************************************************************************
 
+SymmetryOperator cached_symmetry_operator( const std::string & input )
+{
+    static std::mutex cache_mutex;
+    static std::map< std::string, SymmetryOperator > cache;
+    // The key is the canonical form of the string: no spaces and lower case.
+    // The buffer keeps its capacity, so after the first few calls no memory is allocated for a look-up.
+    static thread_local std::string key;
+    key.clear();
+    for ( size_t i( 0 ); i != input.size(); ++i )
+    {
+        if ( input[i] != ' ' )
+            key.push_back( to_lower( input[i] ) );
+    }
+    {
+        std::lock_guard< std::mutex > lock( cache_mutex );
+        std::map< std::string, SymmetryOperator >::const_iterator it = cache.find( key );
+        if ( it != cache.end() )
+            return it->second;
+    }
+    SymmetryOperator result( key );
+    std::lock_guard< std::mutex > lock( cache_mutex );
+    // The number of distinct operators is small, this only guards against pathological input
+    if ( cache.size() > 10000 )
+        cache.clear();
+    cache.insert( std::make_pair( key, result ) );
+    return result;
+}
+
+// ********************************************************************************
+
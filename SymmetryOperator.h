@@ -33,8 +33,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 //class Fraction;
 
-#include <vector>
 #include <iosfwd>
+#include <string>
+#include <vector>
 
 /*
   A SymmetryOperator.
@@ -60,7 +61,7 @@ public:
     SymmetryOperator( const Matrix3D & rotation_matrix, const Vector3D & translation_vector );
 
     // cif style symmetry-operator string, e.g. "0.5+x, -y -1/2, z"
-    explicit SymmetryOperator( std::string input );
+    explicit SymmetryOperator( const std::string & input );
 
     Matrix3D rotation() const { return rotation_matrix_; }
 
@@ -86,6 +87,10 @@ std::ostream & operator<<( std::ostream & os, const SymmetryOperator & symmetry_
 
 bool nearly_equal( const SymmetryOperator & lhs, const SymmetryOperator & rhs, const double tolerance = 0.0000001 );
 
+// As SymmetryOperator( std::string ), but each distinct operator string is only parsed once.
+// Strings that only differ in spaces or case share one entry. Thread-safe.
+SymmetryOperator cached_symmetry_operator( const std::string & input );
+
 SymmetryOperator operator*( const SymmetryOperator & lhs, const SymmetryOperator & rhs );
 
 // Careful: multiplication from the left and from the right is very different
@@ -0,0 +1,252 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SymmetryOrbits.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "MathFunctions.h"
+#include "SpaceGroup.h"
+#include "SymmetryOperator.h"
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+namespace
+{
+
+size_t find_root( std::vector< size_t > & parents, size_t i )
+{
+    while ( parents[i] != i )
+    {
+        parents[i] = parents[ parents[i] ];
+        i = parents[i];
+    }
+    return i;
+}
+
+// ********************************************************************************
+
+void merge( std::vector< size_t > & parents, const size_t i, const size_t j )
+{
+    const size_t root_i = find_root( parents, i );
+    const size_t root_j = find_root( parents, j );
+    // The smallest index becomes the root, so that the root is the first member
+    if ( root_i < root_j )
+        parents[ root_j ] = root_i;
+    else if ( root_j < root_i )
+        parents[ root_i ] = root_j;
+}
+
+// ********************************************************************************
+
+// Numbers the sets in the order of their first member, returns the number of sets
+size_t number_sets( std::vector< size_t > & parents, std::vector< size_t > & result )
+{
+    const size_t n = parents.size();
+    result.assign( n, n );
+    size_t nsets( 0 );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        const size_t root = find_root( parents, i );
+        if ( result[ root ] == n )
+            result[ root ] = nsets++;
+        result[i] = result[ root ];
+    }
+    return nsets;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+SymmetryOrbits::SymmetryOrbits( const CrystalStructure & crystal_structure, const double tolerance, const double special_position_tolerance ):
+nsymmetry_operators_( crystal_structure.space_group().nsymmetry_operators() ),
+norbits_(0),
+nmolecule_orbits_(0)
+{
+    const size_t natoms = crystal_structure.natoms();
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    const SpaceGroup & space_group = crystal_structure.space_group();
+    // Quantise the fractional coordinates modulo 1 into bins that are at least tolerance thick,
+    // so an image within tolerance of an atom is in the same bin as that atom or in a neighbouring bin.
+    size_t nbins[3];
+    const double reciprocal_lengths[3] = { crystal_lattice.a_star(), crystal_lattice.b_star(), crystal_lattice.c_star() };
+    for ( size_t k( 0 ); k != 3; ++k )
+    {
+        const double bin_width = tolerance * reciprocal_lengths[k];
+        nbins[k] = ( bin_width >= 1.0 ) ? 1 : std::min( static_cast< size_t >( 1.0 / bin_width ), static_cast< size_t >( 1 ) << 20 );
+    }
+    const double tolerance2 = square( tolerance );
+    std::vector< Vector3D > positions( natoms );
+    std::unordered_multimap< std::uint64_t, size_t > bins;
+    bins.reserve( natoms );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        positions[i] = crystal_structure.atom( i ).position();
+        std::uint64_t key( 0 );
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            const double f = positions[i].value( k ) - std::floor( positions[i].value( k ) );
+            key = key * nbins[k] + std::min( static_cast< size_t >( f * nbins[k] ), nbins[k] - 1 );
+        }
+        bins.insert( std::make_pair( key, i ) );
+    }
+    // The bin offsets to search, without duplicates if there are fewer than three bins
+    std::vector< int > offsets[3];
+    for ( size_t k( 0 ); k != 3; ++k )
+    {
+        offsets[k].push_back( 0 );
+        if ( nbins[k] > 1 )
+            offsets[k].push_back( 1 );
+        if ( nbins[k] > 2 )
+            offsets[k].push_back( -1 );
+    }
+    std::vector< size_t > parents( natoms );
+    for ( size_t i( 0 ); i != natoms; ++i )
+        parents[i] = i;
+    images_.assign( natoms * nsymmetry_operators_, natoms );
+    site_stabiliser_orders_.assign( natoms, 0 );
+    for ( size_t j( 0 ); j != nsymmetry_operators_; ++j )
+    {
+        const SymmetryOperator & symmetry_operator = space_group.symmetry_operator( j );
+        for ( size_t i( 0 ); i != natoms; ++i )
+        {
+            const Vector3D image_position = symmetry_operator * positions[i];
+            size_t & image = images_[ i * nsymmetry_operators_ + j ];
+            // All atoms within tolerance of the image are merged into the orbit, so duplicate atoms end up in the same orbit
+            const Element element = crystal_structure.atom( i ).element();
+            size_t bin[3];
+            for ( size_t k( 0 ); k != 3; ++k )
+            {
+                const double f = image_position.value( k ) - std::floor( image_position.value( k ) );
+                bin[k] = std::min( static_cast< size_t >( f * nbins[k] ), nbins[k] - 1 );
+            }
+            double smallest_distance2 = tolerance2;
+            for ( size_t o0( 0 ); o0 != offsets[0].size(); ++o0 )
+            {
+                for ( size_t o1( 0 ); o1 != offsets[1].size(); ++o1 )
+                {
+                    for ( size_t o2( 0 ); o2 != offsets[2].size(); ++o2 )
+                    {
+                        const std::uint64_t key = ( ( ( bin[0] + nbins[0] + offsets[0][o0] ) % nbins[0] ) * nbins[1] +
+                                                      ( bin[1] + nbins[1] + offsets[1][o1] ) % nbins[1] ) * nbins[2] +
+                                                      ( bin[2] + nbins[2] + offsets[2][o2] ) % nbins[2];
+                        const auto range = bins.equal_range( key );
+                        for ( auto it( range.first ); it != range.second; ++it )
+                        {
+                            const size_t candidate = it->second;
+                            if ( crystal_structure.atom( candidate ).element() != element )
+                                continue;
+                            const double distance2 = crystal_lattice.shortest_distance2( image_position, positions[ candidate ] );
+                            if ( distance2 < tolerance2 )
+                                merge( parents, i, candidate );
+                            if ( distance2 < smallest_distance2 )
+                            {
+                                smallest_distance2 = distance2;
+                                image = candidate;
+                            }
+                        }
+                    }
+                }
+            }
+            if ( crystal_lattice.shortest_distance2( positions[i], image_position ) < square( special_position_tolerance ) )
+            {
+                image = i;
+                ++site_stabiliser_orders_[i];
+            }
+        }
+    }
+    norbits_ = number_sets( parents, orbits_ );
+    // Molecules
+    const size_t nmolecules = crystal_structure.nmolecules();
+    if ( ( nmolecules == 0 ) || ( natoms == 0 ) )
+        return;
+    molecule_stabiliser_orders_.assign( nmolecules, 0 );
+    std::vector< size_t > molecule_parents( nmolecules );
+    for ( size_t m( 0 ); m != nmolecules; ++m )
+        molecule_parents[m] = m;
+    // For each symmetry operator, the molecule that each molecule is mapped onto, nmolecules if there is no consistent image
+    const size_t undefined = nmolecules + 1;
+    std::vector< size_t > targets( nmolecules );
+    for ( size_t j( 0 ); j != nsymmetry_operators_; ++j )
+    {
+        targets.assign( nmolecules, undefined );
+        for ( size_t i( 0 ); i != natoms; ++i )
+        {
+            const size_t m = crystal_structure.molecule_index( i );
+            const size_t image = images_[ i * nsymmetry_operators_ + j ];
+            const size_t target = ( image == natoms ) ? nmolecules : crystal_structure.molecule_index( image );
+            if ( targets[m] == undefined )
+                targets[m] = target;
+            else if ( targets[m] != target )
+                targets[m] = nmolecules;
+        }
+        for ( size_t m( 0 ); m != nmolecules; ++m )
+        {
+            if ( targets[m] == m )
+                ++molecule_stabiliser_orders_[m];
+            else if ( targets[m] < nmolecules )
+                merge( molecule_parents, m, targets[m] );
+        }
+    }
+    nmolecule_orbits_ = number_sets( molecule_parents, molecule_orbits_ );
+}
+
+// ********************************************************************************
+
+std::vector< size_t > SymmetryOrbits::asymmetric_unit() const
+{
+    std::vector< size_t > result;
+    result.reserve( norbits_ );
+    for ( size_t i( 0 ); i != orbits_.size(); ++i )
+    {
+        if ( orbits_[i] == result.size() )
+            result.push_back( i );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+double SymmetryOrbits::Z_prime() const
+{
+    double result( 0.0 );
+    size_t norbits_seen( 0 );
+    for ( size_t m( 0 ); m != molecule_orbits_.size(); ++m )
+    {
+        if ( molecule_orbits_[m] != norbits_seen )
+            continue;
+        result += 1.0 / molecule_stabiliser_orders_[m];
+        ++norbits_seen;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
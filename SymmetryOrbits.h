@@ -0,0 +1,105 @@
+#ifndef SYMMETRYORBITS_H
+#define SYMMETRYORBITS_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+/*
+  Assigns every atom of a crystal structure to its orbit under the space group, in one pass.
+
+  For each atom and each symmetry operator, the image of the atom is looked up in a hash table of quantised fractional
+  coordinates (modulo 1), so the time is O( natoms * nsymmetry_operators ) instead of O( natoms^2 * nsymmetry_operators ).
+  Two atoms are the same site if they have the same element and are less than tolerance A apart (taking lattice translations into account).
+  A symmetry operator belongs to the site stabiliser of an atom if it moves the atom by less than special_position_tolerance A,
+  the same criterion that CrystalStructure::apply_space_group_symmetry() uses to discard copies on special positions.
+
+  image( i, j ) is the atom that symmetry operator j maps atom i onto. If the image is not present, e.g. because only the
+  asymmetric unit has been given, image( i, j ) is natoms().
+
+  The molecule-based functions require CrystalStructure::perceive_molecules() to have been called before the constructor.
+*/
+class SymmetryOrbits
+{
+public:
+
+    explicit SymmetryOrbits( const CrystalStructure & crystal_structure, const double tolerance = 0.001, const double special_position_tolerance = 0.1 );
+
+    size_t natoms() const { return orbits_.size(); }
+    size_t nsymmetry_operators() const { return nsymmetry_operators_; }
+
+    size_t image( const size_t i, const size_t j ) const { return images_[ i * nsymmetry_operators_ + j ]; }
+
+    size_t norbits() const { return norbits_; }
+
+    // Orbits are numbered in the order of their first atom
+    size_t orbit( const size_t i ) const { return orbits_[i]; }
+
+    // Number of symmetry operators that leave atom i in place, including the identity
+    size_t site_stabiliser_order( const size_t i ) const { return site_stabiliser_orders_[i]; }
+
+    // The site multiplicity, the number of symmetry operators divided by the order of the site stabiliser
+    size_t multiplicity( const size_t i ) const { return nsymmetry_operators_ / site_stabiliser_orders_[i]; }
+
+    // The first atom of each orbit, in ascending order. This is the asymmetric unit.
+    std::vector< size_t > asymmetric_unit() const;
+
+    // The molecule functions below use the molecules of the crystal structure, as found by perceive_molecules().
+
+    size_t nmolecules() const { return molecule_stabiliser_orders_.size(); }
+
+    // Number of symmetry operators that map molecule i onto itself, including the identity
+    size_t molecule_stabiliser_order( const size_t i ) const { return molecule_stabiliser_orders_[i]; }
+
+    bool molecule_is_on_special_position( const size_t i ) const { return molecule_stabiliser_orders_[i] > 1; }
+
+    // Molecular orbits are numbered in the order of their first molecule
+    size_t molecule_orbit( const size_t i ) const { return molecule_orbits_[i]; }
+
+    size_t nmolecule_orbits() const { return nmolecule_orbits_; }
+
+    // The sum over the symmetry-independent molecules of 1 / molecule_stabiliser_order(), e.g. 0.5 for a molecule on an inversion centre.
+    double Z_prime() const;
+
+private:
+    size_t nsymmetry_operators_;
+    std::vector< size_t > images_;
+    std::vector< size_t > orbits_;
+    size_t norbits_;
+    std::vector< size_t > site_stabiliser_orders_;
+    std::vector< size_t > molecule_stabiliser_orders_;
+    std::vector< size_t > molecule_orbits_;
+    size_t nmolecule_orbits_;
+};
+
+#endif // SYMMETRYORBITS_H
+
@@ -0,0 +1,291 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "TLSFit.h"
+#include "AnisotropicDisplacementParameters.h"
+#include "CrystalStructure.h"
+#include "Eigenvalue.h"
+#include "MathFunctions.h"
+#include "MoleculeInCrystal.h"
+#include "ParallelFor.h"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+const size_t nparameters = 20;
+
+// The six independent elements of a symmetric matrix, in the same order as u11 etc. in a .cif file.
+const size_t row_indices[6]    = { 0, 1, 2, 0, 0, 1 };
+const size_t column_indices[6] = { 0, 1, 2, 1, 2, 2 };
+// The off-diagonal elements occur twice in the Frobenius norm.
+const double weights[6] = { 1.0, 1.0, 1.0, 2.0, 2.0, 2.0 };
+
+// S11, S12, S13, S21, S22, S23, S31, S32; S33 = -S11 - S22.
+const size_t S_row_indices[8]    = { 0, 0, 0, 1, 1, 1, 2, 2 };
+const size_t S_column_indices[8] = { 0, 1, 2, 0, 1, 2, 0, 1 };
+
+// The derivatives of the six Uij of an atom at r with respect to the 20 parameters, in the order T11, T22, T33, T12, T13, T23,
+// L11, L22, L33, L12, L13, L23, S11, S12, S13, S21, S22, S23, S31, S32.
+void design_matrix( const Vector3D & r, double result[6][nparameters] )
+{
+    const double A[3][3] = { {      0.0,  r.z(), -r.y() },
+                             { -r.z(),      0.0,  r.x() },
+                             {  r.y(), -r.x(),      0.0 } };
+    for ( size_t c( 0 ); c != 6; ++c )
+    {
+        const size_t i = row_indices[c];
+        const size_t j = column_indices[c];
+        for ( size_t p( 0 ); p != 6; ++p )
+        {
+            const size_t k = row_indices[p];
+            const size_t l = column_indices[p];
+            // T
+            result[c][p] = ( ( i == k ) && ( j == l ) ) ? 1.0 : 0.0;
+            // L: ( A L A^T )ij
+            result[c][6+p] = A[i][k] * A[j][l];
+            if ( k != l )
+                result[c][6+p] += A[i][l] * A[j][k];
+        }
+        // S: ( A S + S^T A^T )ij
+        double S33 = 0.0;
+        if ( j == 2 )
+            S33 += A[i][2];
+        if ( i == 2 )
+            S33 += A[j][2];
+        for ( size_t p( 0 ); p != 8; ++p )
+        {
+            const size_t k = S_row_indices[p];
+            const size_t l = S_column_indices[p];
+            double value = 0.0;
+            if ( l == j )
+                value += A[i][k];
+            if ( l == i )
+                value += A[j][k];
+            if ( k == l )
+                value -= S33;
+            result[c][12+p] = value;
+        }
+    }
+}
+
+// Solves a x = b in place for a symmetric positive-definite a, only the lower triangle of a is used.
+// Returns false if a pivot is not positive relative to the original diagonal element.
+bool Cholesky_solve( double a[nparameters][nparameters], double b[nparameters] )
+{
+    double diagonal[nparameters];
+    for ( size_t i( 0 ); i != nparameters; ++i )
+        diagonal[i] = a[i][i];
+    for ( size_t j( 0 ); j != nparameters; ++j )
+    {
+        double pivot = a[j][j];
+        for ( size_t k( 0 ); k != j; ++k )
+            pivot -= a[j][k] * a[j][k];
+        if ( ! ( pivot > 1.0E-10 * diagonal[j] ) )
+            return false;
+        a[j][j] = std::sqrt( pivot );
+        for ( size_t i( j + 1 ); i != nparameters; ++i )
+        {
+            double value = a[i][j];
+            for ( size_t k( 0 ); k != j; ++k )
+                value -= a[i][k] * a[j][k];
+            a[i][j] = value / a[j][j];
+        }
+    }
+    // Forward substitution with L, back substitution with L^T
+    for ( size_t i( 0 ); i != nparameters; ++i )
+    {
+        for ( size_t k( 0 ); k != i; ++k )
+            b[i] -= a[i][k] * b[k];
+        b[i] /= a[i][i];
+    }
+    for ( size_t i( nparameters ); i != 0; --i )
+    {
+        for ( size_t k( i ); k != nparameters; ++k )
+            b[i-1] -= a[k][i-1] * b[k];
+        b[i-1] /= a[i-1][i-1];
+    }
+    return true;
+}
+
+// Everything except the libration axes.
+TLSTensors fit_TLS_tensors( const TLSRigidBody & rigid_body )
+{
+    TLSTensors result;
+    const size_t natoms = rigid_body.positions_.size();
+    if ( rigid_body.U_carts_.size() != natoms )
+        throw std::runtime_error( "fit_TLS(): number of positions and number of ADPs are not the same." );
+    if ( natoms == 0 )
+        return result;
+    Vector3D origin;
+    for ( size_t i( 0 ); i != natoms; ++i )
+        origin += rigid_body.positions_[i];
+    origin /= natoms;
+    result.origin_ = origin;
+    double normal_matrix[nparameters][nparameters] = {};
+    double rhs[nparameters] = {};
+    double sum_of_squares( 0.0 );
+    double design[6][nparameters];
+    for ( size_t a( 0 ); a != natoms; ++a )
+    {
+        design_matrix( rigid_body.positions_[a] - origin, design );
+        for ( size_t c( 0 ); c != 6; ++c )
+        {
+            const double U = rigid_body.U_carts_[a].value( row_indices[c], column_indices[c] );
+            sum_of_squares += weights[c] * U * U;
+            for ( size_t i( 0 ); i != nparameters; ++i )
+            {
+                const double weighted = weights[c] * design[c][i];
+                if ( weighted == 0.0 )
+                    continue;
+                rhs[i] += weighted * U;
+                for ( size_t j( 0 ); j <= i; ++j )
+                    normal_matrix[i][j] += weighted * design[c][j];
+            }
+        }
+    }
+    if ( ! Cholesky_solve( normal_matrix, rhs ) )
+        return result;
+    result.determined_ = true;
+    result.T_ = SymmetricMatrix3D( rhs[0], rhs[1], rhs[2], rhs[3], rhs[4], rhs[5] );
+    result.L_ = SymmetricMatrix3D( rhs[6], rhs[7], rhs[8], rhs[9], rhs[10], rhs[11] );
+    result.S_ = Matrix3D( rhs[12], rhs[13], rhs[14],
+                          rhs[15], rhs[16], rhs[17],
+                          rhs[18], rhs[19], -rhs[12] - rhs[16] );
+    double sum_of_residuals( 0.0 );
+    for ( size_t a( 0 ); a != natoms; ++a )
+    {
+        const SymmetricMatrix3D U_TLS = TLS_U_cart( result, rigid_body.positions_[a] );
+        for ( size_t c( 0 ); c != 6; ++c )
+            sum_of_residuals += weights[c] * square( rigid_body.U_carts_[a].value( row_indices[c], column_indices[c] ) - U_TLS.value( row_indices[c], column_indices[c] ) );
+    }
+    result.R_ = ( sum_of_squares == 0.0 ) ? 0.0 : std::sqrt( sum_of_residuals / sum_of_squares );
+    return result;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+TLSTensors fit_TLS( const TLSRigidBody & rigid_body )
+{
+    TLSTensors result = fit_TLS_tensors( rigid_body );
+    if ( ! result.determined_ )
+        return result;
+    std::vector< double > eigenvalues;
+    std::vector< NormalisedVector3D > eigenvectors;
+    calculate_eigenvalues_analytical( result.L_, eigenvalues, eigenvectors );
+    for ( size_t k( 0 ); k != 3; ++k )
+    {
+        result.libration_eigenvalues_[k] = eigenvalues[k];
+        result.libration_axes_[k] = eigenvectors[k];
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< TLSTensors > fit_TLS( const std::vector< TLSRigidBody > & rigid_bodies, const size_t nthreads )
+{
+    std::vector< TLSTensors > result( rigid_bodies.size() );
+    parallel_for( rigid_bodies.size(), nthreads, [&]( const size_t i )
+    {
+        result[i] = fit_TLS_tensors( rigid_bodies[i] );
+    }, 16 );
+    std::vector< size_t > determined;
+    std::vector< SymmetricMatrix3D > Ls;
+    for ( size_t i( 0 ); i != result.size(); ++i )
+    {
+        if ( result[i].determined_ )
+        {
+            determined.push_back( i );
+            Ls.push_back( result[i].L_ );
+        }
+    }
+    std::vector< double > eigenvalues;
+    std::vector< double > eigenvectors;
+    calculate_eigenvalues( Ls, eigenvalues, eigenvectors );
+    const size_t n = Ls.size();
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        TLSTensors & tensors = result[ determined[i] ];
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            tensors.libration_eigenvalues_[k] = eigenvalues[ k * n + i ];
+            tensors.libration_axes_[k] = NormalisedVector3D( eigenvectors[ ( 3 * k + 0 ) * n + i ],
+                                                             eigenvectors[ ( 3 * k + 1 ) * n + i ],
+                                                             eigenvectors[ ( 3 * k + 2 ) * n + i ] );
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+std::vector< TLSRigidBody > TLS_rigid_bodies( const CrystalStructure & crystal_structure )
+{
+    std::vector< TLSRigidBody > result( crystal_structure.nmolecules() );
+    for ( size_t i( 0 ); i != crystal_structure.nmolecules(); ++i )
+    {
+        const MoleculeInCrystal molecule = crystal_structure.molecule_in_crystal( i );
+        for ( size_t j( 0 ); j != molecule.natoms(); ++j )
+        {
+            const Atom & atom = molecule.atom( j );
+            if ( atom.element().is_H_or_D() || ( atom.ADPs_type() != Atom::ANISOTROPIC ) )
+                continue;
+            result[i].positions_.push_back( crystal_structure.crystal_lattice().fractional_to_orthogonal( atom.position() ) );
+            result[i].U_carts_.push_back( atom.anisotropic_displacement_parameters().U_cart() );
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+SymmetricMatrix3D TLS_U_cart( const TLSTensors & tensors, const Vector3D & position )
+{
+    double design[6][nparameters];
+    design_matrix( position - tensors.origin_, design );
+    const double parameters[nparameters] = { tensors.T_.value( 0, 0 ), tensors.T_.value( 1, 1 ), tensors.T_.value( 2, 2 ),
+                                             tensors.T_.value( 0, 1 ), tensors.T_.value( 0, 2 ), tensors.T_.value( 1, 2 ),
+                                             tensors.L_.value( 0, 0 ), tensors.L_.value( 1, 1 ), tensors.L_.value( 2, 2 ),
+                                             tensors.L_.value( 0, 1 ), tensors.L_.value( 0, 2 ), tensors.L_.value( 1, 2 ),
+                                             tensors.S_.value( 0, 0 ), tensors.S_.value( 0, 1 ), tensors.S_.value( 0, 2 ),
+                                             tensors.S_.value( 1, 0 ), tensors.S_.value( 1, 1 ), tensors.S_.value( 1, 2 ),
+                                             tensors.S_.value( 2, 0 ), tensors.S_.value( 2, 1 ) };
+    double U[6];
+    for ( size_t c( 0 ); c != 6; ++c )
+    {
+        U[c] = 0.0;
+        for ( size_t p( 0 ); p != nparameters; ++p )
+            U[c] += design[c][p] * parameters[p];
+    }
+    return SymmetricMatrix3D( U[0], U[1], U[2], U[3], U[4], U[5] );
+}
+
@@ -0,0 +1,92 @@
+#ifndef TLSFIT_H
+#define TLSFIT_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+class CrystalStructure;
+
+#include "Matrix3D.h"
+#include "NormalisedVector3D.h"
+#include "SymmetricMatrix3D.h"
+#include "Vector3D.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+// The atoms of one rigid body, Cartesian coordinates in A and U_cart in A^2.
+struct TLSRigidBody
+{
+    std::vector< Vector3D > positions_;
+    std::vector< SymmetricMatrix3D > U_carts_;
+};
+
+// The TLS tensors of one rigid body, in a Cartesian frame with the origin at the centroid of its atoms.
+struct TLSTensors
+{
+    TLSTensors(): determined_(false), R_(0.0) {}
+
+    // False if the atoms do not determine all 20 parameters, e.g. fewer than four atoms or all atoms on one line.
+    // The tensors are then zero.
+    bool determined_;
+    Vector3D origin_; // Cartesian
+    SymmetricMatrix3D T_; // A^2
+    SymmetricMatrix3D L_; // rad^2
+    Matrix3D S_;          // A rad, the trace is zero
+    // The eigenvalues of L, smallest first, and the libration axes, in rad^2.
+    double libration_eigenvalues_[3];
+    NormalisedVector3D libration_axes_[3];
+    // Goodness of fit sqrt( sum |U_obs - U_TLS|^2 / sum |U_obs|^2 ), with the Frobenius norm, so it is independent of the orientation.
+    double R_;
+};
+
+/*
+  Least-squares fit of the rigid-body model U = T + A L A^T + A S + S^T A^T (Schomaker & Trueblood, Acta Cryst. B24, 63-76 (1968))
+  to the ADPs of a rigid body, with A = [ 0 z -y; -z 0 x; y -x 0 ] for an atom at ( x, y, z ) relative to the origin.
+  The trace of S cannot be determined from ADPs and is set to zero, which leaves 20 parameters: six of T, six of L and eight of S.
+  The 20 x 20 normal equations are accumulated in fixed-size arrays and solved by Cholesky decomposition, each atom contributes
+  its six Uij with the off-diagonal elements counted twice.
+
+  Where TLSWriter() writes a TLS model for TOPAS to refine, this fits it directly to known ADPs, e.g. those of
+  every molecule in thousands of refined structures or MD trajectories.
+*/
+TLSTensors fit_TLS( const TLSRigidBody & rigid_body );
+
+// All rigid bodies, in parallel on nthreads threads (0 means one thread per core).
+// The eigenvalues and libration axes of all L are calculated in one batch with the batched calculate_eigenvalues().
+std::vector< TLSTensors > fit_TLS( const std::vector< TLSRigidBody > & rigid_bodies, const size_t nthreads = 0 );
+
+// One rigid body per molecule with the non-H atoms that have anisotropic ADPs, requires perceive_molecules().
+std::vector< TLSRigidBody > TLS_rigid_bodies( const CrystalStructure & crystal_structure );
+
+// U_cart of an atom at position predicted by tensors.
+SymmetricMatrix3D TLS_U_cart( const TLSTensors & tensors, const Vector3D & position );
+
+#endif // TLSFIT_H
+
@@ -27,6 +27,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "TLSWriter.h"
 #include "CrystalStructure.h"
+#include "ParallelFor.h"
 #include "ReadCif.h"
 #include "TextFileReader_2.h"
 #include "TextFileWriter.h"
@@ -35,15 +36,373 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <iostream>
 #include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+
+// The output is formatted into one string and written to file in one go at the end.
+inline void append_line( std::string & output, const std::string & line )
+{
+    output += line;
+    output += '\n';
+}
+
+inline void append_line( std::string & output )
+{
+    output += '\n';
+}
+
+// Maps each atom label to its index. Throws if a label occurs more than once, because the labels are used as TOPAS parameter names.
+std::unordered_map< std::string, size_t > label_index( const CrystalStructure & crystal_structure )
+{
+    std::unordered_map< std::string, size_t > result;
+    result.reserve( crystal_structure.natoms() );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        if ( ! result.insert( std::make_pair( crystal_structure.atom( i ).label(), i ) ).second )
+            throw std::runtime_error( "TLS .inp writer: duplicate atom label " + crystal_structure.atom( i ).label() );
+    }
+    return result;
+}
+
+void check_labels( const std::unordered_map< std::string, size_t > & label_index, const std::vector< std::string > & labels )
+{
+    for ( size_t i( 0 ); i != labels.size(); ++i )
+    {
+        if ( label_index.find( labels[i] ) == label_index.end() )
+            throw std::runtime_error( "TLS .inp writer: restraint refers to unknown atom label " + labels[i] );
+    }
+}
+
+// We must find the unique combinations, e.g.:
+// angle r1-r2-r3 and bond r3-r2 only require two combinations: r1-r2 and r3-r2
+// The order in which the combinations are first encountered is kept.
+void find_unique_bonds( const std::vector< std::string > & angle_labels_1,
+                        const std::vector< std::string > & angle_labels_2,
+                        const std::vector< std::string > & angle_labels_3,
+                        std::vector< std::string > & unique_labels_1,
+                        std::vector< std::string > & unique_labels_2 )
+{
+    std::unordered_set< std::string > found;
+    found.reserve( 2 * angle_labels_1.size() );
+    for ( size_t i( 0 ); i != angle_labels_1.size(); ++i )
+    {
+        // Labels cannot contain spaces
+        if ( found.insert( angle_labels_1[i] + " " + angle_labels_2[i] ).second )
+        {
+            unique_labels_1.push_back( angle_labels_1[i] );
+            unique_labels_2.push_back( angle_labels_2[i] );
+        }
+        if ( found.insert( angle_labels_3[i] + " " + angle_labels_2[i] ).second )
+        {
+            unique_labels_1.push_back( angle_labels_3[i] );
+            unique_labels_2.push_back( angle_labels_2[i] );
+        }
+    }
+}
+
+// Everything from the origin of the molecule up to and including the Uij values in the cif framework.
+void append_TLS_parameters( const CrystalStructure & crystal_structure, std::string & output )
+{
+    append_line( output, "    ' Origin of the molecule (fractional coordinates)." );
+    Vector3D c_o_m = crystal_structure.centre_of_mass();
+    append_line( output, "    prm centx " + double2string( c_o_m.x() ) );
+    append_line( output, "    prm centy " + double2string( c_o_m.y() ) );
+    append_line( output, "    prm centz " + double2string( c_o_m.z() ) );
+    append_line( output );
+    append_line( output, "    ' T11 etc. are elements of the T, L and S tensors." );
+    append_line( output, "    prm T11  0.05" );
+    append_line( output, "    prm T22  0.05" );
+    append_line( output, "    prm T33  0.05" );
+    append_line( output, "    prm T12  0.0" );
+    append_line( output, "    prm T13  0.0" );
+    append_line( output, "    prm T23  0.0" );
+    append_line( output, "    prm L11  0.0" );
+    append_line( output, "    prm L22  0.0" );
+    append_line( output, "    prm L33  0.0" );
+    append_line( output, "    prm L12  0.0" );
+    append_line( output, "    prm L13  0.0" );
+    append_line( output, "    prm L23  0.0" );
+    append_line( output, "    prm S11  0.0" );
+    append_line( output, "    prm S12  0.0" );
+    append_line( output, "    prm S13  0.0" );
+    append_line( output, "    prm S22  0.0" );
+    append_line( output, "    prm S23  0.0" );
+    append_line( output );
+    append_line( output, "    ' Choice of origin to make S symmetric (Downs, p80-81)." );
+    append_line( output, "    prm S21 = S12;" );
+    append_line( output, "    prm S31 = S13;" );
+    append_line( output, "    prm S32 = S23;" );
+    append_line( output );
+    append_line( output, "    ' Standard constraint to make equations determinate." );
+    append_line( output, "    prm S33 = -S11 - S22; : 0.0" );
+    append_line( output );
+    append_line( output, "    ' The libration is sqrt(trace(L))." );
+    append_line( output, "    prm libration = Sqrt(L11 + L22 + L33) * Rad; : 0.0" );
+    append_line( output );
+    append_line( output, "    ' Conversion of fractional coordinates to Cartesian." );
+    append_line( output, "    ' xN1   = fractional x coordinate of atom N1" );
+    append_line( output, "    ' rxN1  = Cartesian coordinate x of atom N1. 'r' always indicates a Cartesian coordinate." );
+    append_line( output, "    ' drxN1 = Correction for libration to Cartesian x coordinate of atom N1." );
+    append_line( output, "    ' crxN1 = Cartesian x coordinate of atom N1 corrected for libration:" );
+    append_line( output, "    ' crxN1 = rxN1 + drxN1" );
+    append_line( output );
+    append_line( output, "    ' Unit-cell parameters are assumed to be constant." );
+    append_line( output );
+    Matrix3D f2c = crystal_structure.crystal_lattice().fractional_to_orthogonal_matrix();
+    Matrix3D c2f = crystal_structure.crystal_lattice().orthogonal_to_fractional_matrix();
+    // Many matrix elements evaluate to e.g. -1.0E-18, these are set to 0.0 here.
+    for ( size_t i( 0 ); i < 3; ++i )
+    {
+        for ( size_t j( 0 ); j < 3; ++j )
+        {
+            if ( nearly_equal( f2c.value( i, j ), 0.0 ) )
+                f2c.set_value( i, j, 0.0 );
+            if ( nearly_equal( c2f.value( i, j ), 0.0 ) )
+                c2f.set_value( i, j, 0.0 );
+        }
+    }
+    // The matrix elements are the same for every atom, so they are formatted only once.
+    const std::string f2c_00 = double2string( f2c.value(0,0) );
+    const std::string f2c_01 = double2string( f2c.value(0,1) );
+    const std::string f2c_02 = double2string( f2c.value(0,2) );
+    const std::string f2c_11 = double2string( f2c.value(1,1) );
+    const std::string f2c_12 = double2string( f2c.value(1,2) );
+    const std::string f2c_22 = double2string( f2c.value(2,2) );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        const std::string & label = crystal_structure.atom( i ).label();
+        append_line( output, "    prm !rx" + label + " = (x" + label + " - centx)*" + f2c_00 + " + (y" + label + " - centy)*" + f2c_01 + " + (z" + label + " - centz)*" + f2c_02 + ";" );
+        append_line( output, "    prm !ry" + label + " = (y" + label + " - centy)*" + f2c_11 + " + (z" + label + " - centz)*" + f2c_12 + ";" );
+        append_line( output, "    prm !rz" + label + " = (z" + label + " - centz)*" + f2c_22 + ";" );
+    }
+    append_line( output );
+    append_line( output, "    ' Calculation of Uij values in Cartesian framework. See Dunitz page 251, Eqn 5.42 and Table 5.1 page 252." );
+    append_line( output );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        const std::string & label = crystal_structure.atom( i ).label();
+        append_line( output, "    prm ru11" + label + " = L22*rz" + label + "^2 + L33*ry" + label + "^2 - 2*ry" + label + "*rz" + label + "*L23 - 2*ry" + label + "*S31 + 2*rz" + label + "*S21 + T11; : 0.0" );
+        append_line( output, "    prm ru22" + label + " = L11*rz" + label + "^2 + L33*rx" + label + "^2 - 2*rx" + label + "*rz" + label + "*L13 - 2*rz" + label + "*S12 + 2*rx" + label + "*S32 + T22; : 0.0" );
+        append_line( output, "    prm ru33" + label + " = L11*ry" + label + "^2 + L22*rx" + label + "^2 - 2*rx" + label + "*ry" + label + "*L12 - 2*rx" + label + "*S23 + 2*ry" + label + "*S13 + T33; : 0.0" );
+        append_line( output, "    prm ru12" + label + " = -rx" + label + "*ry" + label + "*L33 + rx" + label + "*rz" + label + "*L23 + ry" + label + "*rz" + label + "*L13 - rz" + label + "^2*L12 - rz" + label +
+                             "*S11 + rz" + label + "*S22 + rx" + label + "*S31 - ry" + label + "*S32 + T12; : 0.0" );
+        append_line( output, "    prm ru13" + label + " = -rx" + label + "*rz" + label + "*L22 + rx" + label + "*ry" + label + "*L23 - ry" + label + "^2*L13 + ry" + label + "*rz" + label + "*L12 + ry" + label +
+                             "*S11 - ry" + label + "*S33 + rz" + label + "*S23 - rx" + label + "*S21 + T13; : 0.0" );
+        append_line( output, "    prm ru23" + label + " = -ry" + label + "*rz" + label + "*L11 - rx" + label + "^2*L23 + rx" + label + "*ry" + label + "*L13 + rx" + label + "*rz" + label + "*L12 - rx" + label +
+                             "*S22 + rx" + label + "*S33 + ry" + label + "*S12 - rz" + label + "*S13 + T23; : 0.0" );
+        append_line( output );
+    }
+    append_line( output, "    ' ru11N1 = u11 of atom N1 in Cartesian coordinates." );
+    append_line( output, "    ' u11N1 = u11 of atom N1 in cif coordinates." );
+    append_line( output, "    ' See R. W. Grosse-Kunstleve & P. D. Adams (2002). J. Appl. Cryst. 35, 477-480." );
+    append_line( output );
+    double k[3];
+    k[0] = 1.0 / crystal_structure.crystal_lattice().a_star();
+    k[1] = 1.0 / crystal_structure.crystal_lattice().b_star();
+    k[2] = 1.0 / crystal_structure.crystal_lattice().c_star();
+    // TOPAS cannot cope with "prm n = 4 + -2;", a workaround is to write "prm n = 4 + (-2);".
+    const size_t r_s[6] = { 1, 2, 3, 1, 1, 2 }; // "r's", multiple of "r"
+    const size_t s_s[6] = { 1, 2, 3, 2, 3, 3 }; // "s's", multiple of "s"
+    for ( size_t i( 0 ); i < crystal_structure.natoms(); ++i )
+    {
+        const std::string & label = crystal_structure.atom( i ).label();
+        for ( size_t j( 0 ); j != 6; ++j )
+        {
+            size_t r = r_s[j];
+            size_t s = s_s[j];
+            append_line( output, "    prm u" + size_t2string(r) + size_t2string(s) + label + " = " + double2string( k[r-1] * k[s-1] ) + " * ( " );
+            append_line( output, "        "  + double2string( c2f.value(r-1,0) ) + "  * ( ru11" + label + " * " + double2string( c2f.value(s-1,0) ) + " + ru12" + label + " * " + double2string( c2f.value(s-1,1) ) + " + ru13" + label + " * " + double2string( c2f.value(s-1,2) ) + " ) + " );
+            append_line( output, "        (" + double2string( c2f.value(r-1,1) ) + ") * ( ru12" + label + " * " + double2string( c2f.value(s-1,0) ) + " + ru22" + label + " * " + double2string( c2f.value(s-1,1) ) + " + ru23" + label + " * " + double2string( c2f.value(s-1,2) ) + " ) + " );
+            append_line( output, "        (" + double2string( c2f.value(r-1,2) ) + ") * ( ru13" + label + " * " + double2string( c2f.value(s-1,0) ) + " + ru23" + label + " * " + double2string( c2f.value(s-1,1) ) + " + ru33" + label + " * " + double2string( c2f.value(s-1,2) ) + " ) ); : 0.0" );
+        }
+        append_line( output );
+    }
+}
+
+void append_libration_corrections( const CrystalStructure & crystal_structure, std::string & output )
+{
+    for ( size_t i( 0 ); i < crystal_structure.natoms(); ++i )
+    {
+        const std::string & label = crystal_structure.atom( i ).label();
+        append_line( output, "    prm !drx" + label + " = 0.5*( (L22+L33)*rx" + label + "        -L12*ry" + label + "        -L13*rz" + label + " ) ; : 0.0" );
+        append_line( output, "    prm !dry" + label + " = 0.5*(      -L12*rx" + label + " + (L11+L33)*ry" + label + "        -L23*rz" + label + " ) ; : 0.0" );
+        append_line( output, "    prm !drz" + label + " = 0.5*(      -L13*rx" + label + "        -L23*ry" + label + " + (L11+L22)*rz" + label + " ) ; : 0.0" );
+        append_line( output, "    prm !crx" + label + " =                 rx" + label + " +          drx" + label + " ; : 0.0" );
+        append_line( output, "    prm !cry" + label + " =                 ry" + label + " +          dry" + label + " ; : 0.0" );
+        append_line( output, "    prm !crz" + label + " =                 rz" + label + " +          drz" + label + " ; : 0.0" );
+    }
+    append_line( output );
+}
+
+void append_current_and_corrected_distances( const std::vector< std::string > & bond_labels_1,
+                                             const std::vector< std::string > & bond_labels_2,
+                                             const bool include_note,
+                                             std::string & output )
+{
+    append_line( output, "    ' Calculate current bond lengths." );
+    for ( size_t i( 0 ); i < bond_labels_1.size(); ++i )
+    {
+        const std::string & l1 = bond_labels_1[i];
+        const std::string & l2 = bond_labels_2[i];
+        append_line( output, "    prm !curr_dist_" + l1 + "_" + l2 + " = Sqrt( (rx" + l1 + "-rx" + l2 + ")^2 + (ry" + l1 + "-ry" + l2 + ")^2 + (rz" + l1 + "-rz" + l2 + ")^2 ); : 0.0" );
+    }
+    append_line( output );
+    append_line( output, "    ' Calculate corrected relative Cartesian coordinates. See Downs, page 83." );
+    if ( include_note )
+        append_line( output, "    ' Note that only intramolecular corrected distances can be trusted, the intermolecular corrected distances have no physical meaning." );
+    for ( size_t i( 0 ); i < bond_labels_1.size(); ++i )
+    {
+        const std::string & l1 = bond_labels_1[i];
+        const std::string & l2 = bond_labels_2[i];
+        append_line( output, "    prm !corr_dist_" + l1 + "_" + l2 + " = Sqrt( (crx" + l1 + "-crx" + l2 + ")^2 + (cry" + l1 + "-cry" + l2 + ")^2 + (crz" + l1 + "-crz" + l2 + ")^2 ); : 0.0" );
+    }
+    append_line( output );
+}
+
+void append_distance_restraints( const std::vector< std::string > & bond_labels_1,
+                                 const std::vector< std::string > & bond_labels_2,
+                                 const std::vector< double > & bond_target_values,
+                                 std::string & output )
+{
+    append_line( output, "    ' Restrain the corrected bond lengths." );
+    for ( size_t i( 0 ); i < bond_labels_1.size(); ++i )
+        append_line( output, "    Angle_Distance_Restrain( corr_dist_" + bond_labels_1[i] + "_" + bond_labels_2[i] + ", " + double2string( bond_target_values[i] ) + ", 0.0, bond_width, bond_weight )" );
+    append_line( output );
+}
+
+void append_corrected_angles( const std::vector< std::string > & unique_labels_1,
+                              const std::vector< std::string > & unique_labels_2,
+                              const std::vector< std::string > & angle_labels_1,
+                              const std::vector< std::string > & angle_labels_2,
+                              const std::vector< std::string > & angle_labels_3,
+                              std::string & output )
+{
+    append_line( output, "    ' Calculate corrected valence angles." );
+    for ( size_t i( 0 ); i < unique_labels_1.size(); ++i )
+    {
+        const std::string pair = unique_labels_1[i] + "_" + unique_labels_2[i];
+        append_line( output, "    prm !diff_x_" + pair + " = crx" + unique_labels_1[i] + " - crx" + unique_labels_2[i] + "; : 0.0" );
+        append_line( output, "    prm !diff_y_" + pair + " = cry" + unique_labels_1[i] + " - cry" + unique_labels_2[i] + "; : 0.0" );
+        append_line( output, "    prm !diff_z_" + pair + " = crz" + unique_labels_1[i] + " - crz" + unique_labels_2[i] + "; : 0.0" );
+    }
+    for ( size_t i( 0 ); i < angle_labels_1.size(); ++i )
+    {
+        const std::string p1 = angle_labels_1[i] + "_" + angle_labels_2[i];
+        const std::string p2 = angle_labels_3[i] + "_" + angle_labels_2[i];
+        append_line( output, "    prm !corr_ang_" + p1 + "_" + angle_labels_3[i] + " = Rad * ArcCos( ( diff_x_" + p1 + " * diff_x_" + p2 + " + " +
+                                                                                                  "diff_y_" + p1 + " * diff_y_" + p2 + " + " +
+                                                                                                  "diff_z_" + p1 + " * diff_z_" + p2 + " ) /" +
+                                                                                           " (Sqrt(diff_x_" + p1 + "^2+" +
+                                                                                                  "diff_y_" + p1 + "^2+" +
+                                                                                                  "diff_z_" + p1 + "^2) * " +
+                                                                                             "Sqrt(diff_x_" + p2 + "^2+" +
+                                                                                                  "diff_y_" + p2 + "^2+" +
+                                                                                                  "diff_z_" + p2 + "^2)) ); : 0.0" );
+    }
+    append_line( output );
+}
+
+void append_angle_restraints( const std::vector< std::string > & angle_labels_1,
+                              const std::vector< std::string > & angle_labels_2,
+                              const std::vector< std::string > & angle_labels_3,
+                              const std::vector< double > & angle_target_values,
+                              std::string & output )
+{
+    append_line( output, "    ' Restrain the corrected valence angles." );
+    for ( size_t i( 0 ); i < angle_labels_1.size(); ++i )
+        append_line( output, "    Angle_Distance_Restrain( corr_ang_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "_" + angle_labels_3[i] + ", " + double2string( angle_target_values[i] ) + ", 0.0, angle_width, angle_weight )" );
+}
+
+const char * const Out_CIF_ADPs_TLS_macro =
+    "    macro Out_CIF_ADPs_TLS( file )\n"
+    "    {\n"
+    "        out file\n"
+    "        Out_String(\"data_\\n\")\n"
+    "        Out(Get(a), \"_cell_length_a  %V\")\n"
+    "        Out(Get(b), \"\\n_cell_length_b  %V\")\n"
+    "        Out(Get(c), \"\\n_cell_length_c  %V\")\n"
+    "        Out(Get(al), \"\\n_cell_angle_alpha %V\")\n"
+    "        Out(Get(be), \"\\n_cell_angle_beta  %V\")\n"
+    "        Out(Get(ga), \"\\n_cell_angle_gamma %V\")\n"
+    "        Out(Get(cell_volume), \"\\n_cell_volume %V\")\n"
+    "        Out(Get(sp_grp_char), \"\\n_symmetry_space_group_name_H-M %s\")\n"
+    "        Out_String(\"\\nloop_\")\n"
+    "        Out_String(\"\\n_symmetry_equiv_pos_as_xyz\")\n"
+    "            Out(Get(sp_xyzs_txt),  \"%s\")\n"
+    "        Out_String(\"\\nloop_\")\n"
+    "        Out_String(\"\\n_atom_site_label\")\n"
+    "        Out_String(\"\\n_atom_site_type_symbol\")\n"
+    "        Out_String(\"\\n_atom_site_symmetry_multiplicity\")\n"
+    "        Out_String(\"\\n_atom_site_fract_x\")\n"
+    "        Out_String(\"\\n_atom_site_fract_y\")\n"
+    "        Out_String(\"\\n_atom_site_fract_z\")\n"
+    "        Out_String(\"\\n_atom_site_occupancy\")\n"
+    "        atom_out file append\n"
+    "            load out_record out_fmt out_eqn\n"
+    "            {\n"
+    "                \"\\n%s\" = Get_From_String(Get(current_atom), site);\n"
+    "                \" %s\" = Get_From_String(Get(current_atom), atom);\n"
+    "                \" %3.0f\" = Get_From_String(Get(current_atom), num_posns);\n"
+    "                \" %V\" = Get_From_String(Get(current_atom), x);\n"
+    "                \" %V\" = Get_From_String(Get(current_atom), y);\n"
+    "                \" %V\" = Get_From_String(Get(current_atom), z);\n"
+    "                \" %V\" = Get_From_String(Get(current_atom), occ);\n"
+    "            }\n"
+    "        out file append\n"
+    "        Out_String(\"\\nloop_\")\n"
+    "        Out_String(\"\\n_atom_site_aniso_label\")\n"
+    "        Out_String(\"\\n_atom_site_aniso_U_11\")\n"
+    "        Out_String(\"\\n_atom_site_aniso_U_22\")\n"
+    "        Out_String(\"\\n_atom_site_aniso_U_33\")\n"
+    "        Out_String(\"\\n_atom_site_aniso_U_12\")\n"
+    "        Out_String(\"\\n_atom_site_aniso_U_13\")\n"
+    "        Out_String(\"\\n_atom_site_aniso_U_23\")\n"
+    "        atom_out file append adps\n"
+    "            load out_record out_fmt out_eqn\n"
+    "            {\n"
+    "                \"\\n%s\" = Get_From_String(Get(current_atom), site);\n"
+    "                \" %V\" = Get_From_String(Get(current_atom), u11);\n"
+    "                \" %V\" = Get_From_String(Get(current_atom), u22);\n"
+    "                \" %V\" = Get_From_String(Get(current_atom), u33);\n"
+    "                \" %V\" = Get_From_String(Get(current_atom), u12);\n"
+    "                \" %V\" = Get_From_String(Get(current_atom), u13);\n"
+    "                \" %V\" = Get_From_String(Get(current_atom), u23);\n"
+    "            }\n"
+    "        out file append\n"
+    "        Out_String(\"\\n\")\n"
+    "    }\n";
+
+// Runs tls_writer() for each file, prefixing any error message with the name of the file.
+template< class Writer >
+void for_each_input_file( const std::vector< FileName > & input_file_names, const size_t nthreads, Writer tls_writer )
+{
+    parallel_for( input_file_names.size(), nthreads, [&]( const size_t i )
+    {
+        try
+        {
+            tls_writer( input_file_names[i] );
+        }
+        catch ( std::exception & e )
+        {
+            throw std::runtime_error( input_file_names[i].full_name() + ": " + e.what() );
+        }
+    } );
+}
+
+} // namespace
 
 // ********************************************************************************
 
 // From .cif file
 void TLSWriter( const FileName & input_file_name )
 {
-    TextFileWriter text_file_writer( replace_extension( append_to_file_name( input_file_name, "_TLS" ), "inp" ) );
-    bool write_bond_restraints = FileName( input_file_name.directory(), input_file_name.file_name() + "_bond_restraints", "txt" ).exists();
-    bool write_angle_restraints = FileName( input_file_name.directory(), input_file_name.file_name() + "_angle_restraints", "txt" ).exists();
+    FileName bond_restraints_file_name( input_file_name.directory(), input_file_name.file_name() + "_bond_restraints", "txt" );
+    FileName angle_restraints_file_name( input_file_name.directory(), input_file_name.file_name() + "_angle_restraints", "txt" );
+    bool write_bond_restraints = bond_restraints_file_name.exists();
+    bool write_angle_restraints = angle_restraints_file_name.exists();
     std::vector< std::string > bond_labels_1;
     std::vector< std::string > bond_labels_2;
     std::vector< double > bond_target_values;
@@ -54,7 +413,7 @@ void TLSWriter( const FileName & input_file_name )
     if ( write_bond_restraints )
     {
         std::cout << "Bond restraints file found, bond restraints will be written out." << std::endl;
-        TextFileReader_2 file_bond_restraints( FileName( input_file_name.directory(), input_file_name.file_name() + "_bond_restraints", "txt" ) );
+        TextFileReader_2 file_bond_restraints( bond_restraints_file_name );
         std::vector< std::string > words;
         for ( size_t i( 0 ); i != file_bond_restraints.size(); ++i )
         {
@@ -71,7 +430,7 @@ void TLSWriter( const FileName & input_file_name )
     if ( write_angle_restraints )
     {
         std::cout << "Angle restraints file found, angle restraints will be written out." << std::endl;
-        TextFileReader_2 file_angle_restraints( FileName( input_file_name.directory(), input_file_name.file_name() + "_angle_restraints", "txt" ) );
+        TextFileReader_2 file_angle_restraints( angle_restraints_file_name );
         std::vector< std::string > words;
         for ( size_t i( 0 ); i != file_angle_restraints.size(); ++i )
         {
@@ -86,369 +445,78 @@ void TLSWriter( const FileName & input_file_name )
     }
     else
         std::cout << "No angle restraints file found, no angle restraints will be written out." << std::endl;
-    // We must find the unique combinations, e.g.:
-    // angle r1-r2-r3 and bond r3-r2 only require two combinations: r1-r2 and r3-r2
-    // Create list of unique bonds
     std::vector< std::string > unique_labels_1;
     std::vector< std::string > unique_labels_2;
-    for ( size_t i( 0 ); i != angle_labels_1.size(); ++i )
-    {
-        bool found( false );
-        // Find bond 1
-        for ( size_t j( 0 ); j != unique_labels_1.size(); ++j )
-        {
-            if ( ( unique_labels_1[j] == angle_labels_1[i] ) && ( unique_labels_2[j] == angle_labels_2[i] ) )
-            {
-                 found = true;
-                 break;
-            }
-        }
-        if ( ! found )
-        {
-            unique_labels_1.push_back( angle_labels_1[i] );
-            unique_labels_2.push_back( angle_labels_2[i] );
-        }
-        found = false;
-        // Find bond 2
-        for ( size_t j( 0 ); j != unique_labels_1.size(); ++j )
-        {
-            if ( ( unique_labels_1[j] == angle_labels_3[i] ) && ( unique_labels_2[j] == angle_labels_2[i] ) )
-            {
-                 found = true;
-                 break;
-            }
-        }
-        if ( ! found )
-        {
-            unique_labels_1.push_back( angle_labels_3[i] );
-            unique_labels_2.push_back( angle_labels_2[i] );
-        }
-    }
-//    for ( size_t i( 0 ); i != bond_labels_1.size(); ++i )
-//    {
-//        bool found( false );
-//        // Find bond
-//        for ( size_t j( 0 ); j != unique_labels_1.size(); ++j )
-//        {
-//            if ( ( unique_labels_1[j] == bond_labels_1[i] ) && ( unique_labels_2[j] == bond_labels_2[i] ) )
-//            {
-//                 found = true;
-//                 break;
-//            }
-//        }
-//        if ( ! found )
-//        {
-//            unique_labels_1.push_back( bond_labels_1[i] );
-//            unique_labels_2.push_back( bond_labels_2[i] );
-//        }
-//        found = false;
-//
-//    }
+    find_unique_bonds( angle_labels_1, angle_labels_2, angle_labels_3, unique_labels_1, unique_labels_2 );
     CrystalStructure crystal_structure;
     std::cout << "Now reading cif... " + input_file_name.full_name() << std::endl;
     read_cif( input_file_name, crystal_structure );
-    text_file_writer.write_line( "    ' Origin of the molecule (fractional coordinates)." );
-    Vector3D c_o_m = crystal_structure.centre_of_mass();
-    text_file_writer.write_line( "    prm centx " + double2string( c_o_m.x() ) );
-    text_file_writer.write_line( "    prm centy " + double2string( c_o_m.y() ) );
-    text_file_writer.write_line( "    prm centz " + double2string( c_o_m.z() ) );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' T11 etc. are elements of the T, L and S tensors." );
-    text_file_writer.write_line( "    prm T11  0.05" );
-    text_file_writer.write_line( "    prm T22  0.05" );
-    text_file_writer.write_line( "    prm T33  0.05" );
-    text_file_writer.write_line( "    prm T12  0.0" );
-    text_file_writer.write_line( "    prm T13  0.0" );
-    text_file_writer.write_line( "    prm T23  0.0" );
-    text_file_writer.write_line( "    prm L11  0.0" );
-    text_file_writer.write_line( "    prm L22  0.0" );
-    text_file_writer.write_line( "    prm L33  0.0" );
-    text_file_writer.write_line( "    prm L12  0.0" );
-    text_file_writer.write_line( "    prm L13  0.0" );
-    text_file_writer.write_line( "    prm L23  0.0" );
-    text_file_writer.write_line( "    prm S11  0.0" );
-    text_file_writer.write_line( "    prm S12  0.0" );
-    text_file_writer.write_line( "    prm S13  0.0" );
-    text_file_writer.write_line( "    prm S22  0.0" );
-    text_file_writer.write_line( "    prm S23  0.0" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Choice of origin to make S symmetric (Downs, p80-81)." );
-    text_file_writer.write_line( "    prm S21 = S12;" );
-    text_file_writer.write_line( "    prm S31 = S13;" );
-    text_file_writer.write_line( "    prm S32 = S23;" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Standard constraint to make equations determinate." );
-    text_file_writer.write_line( "    prm S33 = -S11 - S22; : 0.0" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' The libration is sqrt(trace(L))." );
-    text_file_writer.write_line( "    prm libration = Sqrt(L11 + L22 + L33) * Rad; : 0.0" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Conversion of fractional coordinates to Cartesian." );
-    text_file_writer.write_line( "    ' xN1   = fractional x coordinate of atom N1" );
-    text_file_writer.write_line( "    ' rxN1  = Cartesian coordinate x of atom N1. 'r' always indicates a Cartesian coordinate." );
-    text_file_writer.write_line( "    ' drxN1 = Correction for libration to Cartesian x coordinate of atom N1." );
-    text_file_writer.write_line( "    ' crxN1 = Cartesian x coordinate of atom N1 corrected for libration:" );
-    text_file_writer.write_line( "    ' crxN1 = rxN1 + drxN1" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Unit-cell parameters are assumed to be constant." );
-    text_file_writer.write_line();
-    Matrix3D f2c = crystal_structure.crystal_lattice().fractional_to_orthogonal_matrix();
-    
-    // Many matrix elements evaluate to e.g. -1.0E-18, these are set to 0.0 here.
-    for ( size_t i( 0 ); i < 3; ++i )
-    {
-        for ( size_t j( 0 ); j < 3; ++j )
-        {
-            if ( nearly_equal( f2c.value( i, j ), 0.0 ) )
-                f2c.set_value( i, j, 0.0 );
-        }
-    }
-    
-    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
-    {
-        std::string label = crystal_structure.atom( i ).label();
-        text_file_writer.write_line( "    prm !rx" + label + " = (x" + label + " - centx)*" + double2string( f2c.value(0,0) ) + " + (y" + label + " - centy)*" + double2string( f2c.value(0,1) ) + " + (z" + label + " - centz)*" + double2string( f2c.value(0,2) ) + ";" );
-        text_file_writer.write_line( "    prm !ry" + label + " = (y" + label + " - centy)*" + double2string( f2c.value(1,1) ) + " + (z" + label + " - centz)*" + double2string( f2c.value(1,2) ) + ";" );
-        text_file_writer.write_line( "    prm !rz" + label + " = (z" + label + " - centz)*" + double2string( f2c.value(2,2) ) + ";" );
-    }
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Calculation of Uij values in Cartesian framework. See Dunitz page 251, Eqn 5.42 and Table 5.1 page 252." );
-    text_file_writer.write_line();
-    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
-    {
-        std::string label = crystal_structure.atom( i ).label();
-        text_file_writer.write_line( "    prm ru11" + label + " = L22*rz" + label + "^2 + L33*ry" + label + "^2 - 2*ry" + label + "*rz" + label + "*L23 - 2*ry" + label + "*S31 + 2*rz" + label + "*S21 + T11; : 0.0" );
-        text_file_writer.write_line( "    prm ru22" + label + " = L11*rz" + label + "^2 + L33*rx" + label + "^2 - 2*rx" + label + "*rz" + label + "*L13 - 2*rz" + label + "*S12 + 2*rx" + label + "*S32 + T22; : 0.0" );
-        text_file_writer.write_line( "    prm ru33" + label + " = L11*ry" + label + "^2 + L22*rx" + label + "^2 - 2*rx" + label + "*ry" + label + "*L12 - 2*rx" + label + "*S23 + 2*ry" + label + "*S13 + T33; : 0.0" );
-        text_file_writer.write_line( "    prm ru12" + label + " = -rx" + label + "*ry" + label + "*L33 + rx" + label + "*rz" + label + "*L23 + ry" + label + "*rz" + label + "*L13 - rz" + label + "^2*L12 - rz" + label +
-                                     "*S11 + rz" + label + "*S22 + rx" + label + "*S31 - ry" + label + "*S32 + T12; : 0.0" );
-        text_file_writer.write_line( "    prm ru13" + label + " = -rx" + label + "*rz" + label + "*L22 + rx" + label + "*ry" + label + "*L23 - ry" + label + "^2*L13 + ry" + label + "*rz" + label + "*L12 + ry" + label +
-                                     "*S11 - ry" + label + "*S33 + rz" + label + "*S23 - rx" + label + "*S21 + T13; : 0.0" );
-        text_file_writer.write_line( "    prm ru23" + label + " = -ry" + label + "*rz" + label + "*L11 - rx" + label + "^2*L23 + rx" + label + "*ry" + label + "*L13 + rx" + label + "*rz" + label + "*L12 - rx" + label +
-                                     "*S22 + rx" + label + "*S33 + ry" + label + "*S12 - rz" + label + "*S13 + T23; : 0.0" );
-        text_file_writer.write_line();
-    }
-    text_file_writer.write_line( "    ' ru11N1 = u11 of atom N1 in Cartesian coordinates." );
-    text_file_writer.write_line( "    ' u11N1 = u11 of atom N1 in cif coordinates." );
-    text_file_writer.write_line( "    ' See R. W. Grosse-Kunstleve & P. D. Adams (2002). J. Appl. Cryst. 35, 477-480." );
-    text_file_writer.write_line();
-    for ( size_t i( 0 ); i < crystal_structure.natoms(); ++i )
-    {
-        std::string label = crystal_structure.atom( i ).label();
-        std::vector<double> k;
-        k.push_back( 1.0 / crystal_structure.crystal_lattice().a_star() );
-        k.push_back( 1.0 / crystal_structure.crystal_lattice().b_star() );
-        k.push_back( 1.0 / crystal_structure.crystal_lattice().c_star() );
-        Matrix3D c2f = crystal_structure.crystal_lattice().orthogonal_to_fractional_matrix();
-        size_t r;
-        size_t s;
-        // Many matrix elements evaluate to e.g. -1.0E-18, these are set to 0.0 here.
-        for ( r = 0; r < 3; ++r )
-        {
-            for ( s = 0; s < 3; ++s )
-            {
-                if ( nearly_equal( c2f.value( r, s ), 0.0 ) )
-                    c2f.set_value( r, s, 0.0 );
-            }
-        }
-        // TOPAS cannot cope with "prm n = 4 + -2;", a workaround is to write "prm n = 4 + (-2);".
-        std::vector< size_t > r_s; // "r's", multiple of "r"
-        std::vector< size_t > s_s; // "s's", multiple of "s"
-        r_s.push_back( 1 );
-        s_s.push_back( 1 );
-        r_s.push_back( 2 );
-        s_s.push_back( 2 );
-        r_s.push_back( 3 );
-        s_s.push_back( 3 );
-        r_s.push_back( 1 );
-        s_s.push_back( 2 );
-        r_s.push_back( 1 );
-        s_s.push_back( 3 );
-        r_s.push_back( 2 );
-        s_s.push_back( 3 );
-        for ( size_t j(0); j != r_s.size(); ++j )
-        {
-            r = r_s[j];
-            s = s_s[j];
-            text_file_writer.write_line( "    prm u" + size_t2string(r) + size_t2string(s) + label + " = " + double2string( k[r-1] * k[s-1] ) + " * ( " );
-            text_file_writer.write_line( "        " + double2string( c2f.value(r-1,0) ) + " * ( ru11" + label + " * " + double2string( c2f.value(s-1,0) ) + " + ru12" + label + " * " + double2string( c2f.value(s-1,1) ) + " + ru13" + label + " * " + double2string( c2f.value(s-1,2) ) + " ) + " );
-            text_file_writer.write_line( "        (" + double2string( c2f.value(r-1,1) ) + ") * ( ru12" + label + " * " + double2string( c2f.value(s-1,0) ) + " + ru22" + label + " * " + double2string( c2f.value(s-1,1) ) + " + ru23" + label + " * " + double2string( c2f.value(s-1,2) ) + " ) + " );
-            text_file_writer.write_line( "        (" + double2string( c2f.value(r-1,2) ) + ") * ( ru13" + label + " * " + double2string( c2f.value(s-1,0) ) + " + ru23" + label + " * " + double2string( c2f.value(s-1,1) ) + " + ru33" + label + " * " + double2string( c2f.value(s-1,2) ) + " ) ); : 0.0" );
-        }
-        text_file_writer.write_line();
-    }
-
-//Matrix3D AnisotropicDisplacementParameters::U_star( const CrystalLattice & crystal_lattice ) const
-//{
-//    return crystal_lattice.orthogonal_to_fractional_matrix() * U_cart() * transpose( crystal_lattice.orthogonal_to_fractional_matrix() );
-//}
-//
-//Matrix3D AnisotropicDisplacementParameters::U_cif( const CrystalLattice & crystal_lattice ) const
-//{
-//    Matrix3D N;
-//    N.set_value( 0, 0 , 1.0 / crystal_lattice.a_star() );
-//    N.set_value( 1, 1 , 1.0 / crystal_lattice.b_star() );
-//    N.set_value( 2, 2 , 1.0 / crystal_lattice.c_star() );
-//    return N * U_star( crystal_lattice ) * N;
-//}
-
-    for ( size_t i( 0 ); i < crystal_structure.natoms(); ++i )
     {
-        std::string label = crystal_structure.atom( i ).label();
-        text_file_writer.write_line( "    site " + label + " x x" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().x(), 5, ' ' ) +
-                                                           " y y" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().y(), 5, ' ' ) +
-                                                           " z z" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().z(), 5, ' ' ) +
-                                     " occ " + crystal_structure.atom( i ).element().symbol() + " 1 ADPs_Keep_PD u11=u11" + label + "; u22=u22" + label + "; u33=u33" + label + "; u12=u12" + label + "; u13=u13" + label + "; u23=u23" + label + ";" );
-    }
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Calculate corrected Cartesian coordinates. See Downs, page 83." );
-    text_file_writer.write_line( "    ' Note that only intramolecular corrected distances can be trusted, the intermolecular corrected distances have no physical meaning." );
+    const std::unordered_map< std::string, size_t > labels = label_index( crystal_structure );
+    check_labels( labels, bond_labels_1 );
+    check_labels( labels, bond_labels_2 );
+    check_labels( labels, angle_labels_1 );
+    check_labels( labels, angle_labels_2 );
+    check_labels( labels, angle_labels_3 );
+    }
+    std::string output;
+    // About 3 kB per atom and 0.5 kB per restraint
+    output.reserve( 8192 + 3072 * crystal_structure.natoms() + 512 * ( bond_labels_1.size() + angle_labels_1.size() ) );
+    append_TLS_parameters( crystal_structure, output );
     for ( size_t i( 0 ); i < crystal_structure.natoms(); ++i )
     {
-        std::string label = crystal_structure.atom( i ).label();
-        text_file_writer.write_line( "    prm !drx" + label + " = 0.5*( (L22+L33)*rx" + label + "        -L12*ry" + label + "        -L13*rz" + label + " ) ; : 0.0" );
-        text_file_writer.write_line( "    prm !dry" + label + " = 0.5*(      -L12*rx" + label + " + (L11+L33)*ry" + label + "        -L23*rz" + label + " ) ; : 0.0" );
-        text_file_writer.write_line( "    prm !drz" + label + " = 0.5*(      -L13*rx" + label + "        -L23*ry" + label + " + (L11+L22)*rz" + label + " ) ; : 0.0" );
-        text_file_writer.write_line( "    prm !crx" + label + " =                 rx" + label + " +          drx" + label + " ; : 0.0" );
-        text_file_writer.write_line( "    prm !cry" + label + " =                 ry" + label + " +          dry" + label + " ; : 0.0" );
-        text_file_writer.write_line( "    prm !crz" + label + " =                 rz" + label + " +          drz" + label + " ; : 0.0" );
+        const std::string & label = crystal_structure.atom( i ).label();
+        append_line( output, "    site " + label + " x x" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().x(), 5, ' ' ) +
+                                                " y y" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().y(), 5, ' ' ) +
+                                                " z z" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().z(), 5, ' ' ) +
+                             " occ " + crystal_structure.atom( i ).element().symbol() + " 1 ADPs_Keep_PD u11=u11" + label + "; u22=u22" + label + "; u33=u33" + label + "; u12=u12" + label + "; u13=u13" + label + "; u23=u23" + label + ";" );
     }
-    text_file_writer.write_line();
+    append_line( output );
+    append_line( output, "    ' Calculate corrected Cartesian coordinates. See Downs, page 83." );
+    append_line( output, "    ' Note that only intramolecular corrected distances can be trusted, the intermolecular corrected distances have no physical meaning." );
+    append_libration_corrections( crystal_structure, output );
     if ( write_bond_restraints )
     {
-        text_file_writer.write_line( "    ' Calculate current bond lengths." );
-        for ( size_t i( 0 ); i < bond_labels_1.size(); ++i )
-        {
-            text_file_writer.write_line( "    prm !curr_dist_" + bond_labels_1[i] + "_" + bond_labels_2[i] + " = Sqrt( (rx" + bond_labels_1[i] + "-rx" + bond_labels_2[i] + ")^2 + " +
-                                                                                                                     "(ry" + bond_labels_1[i] + "-ry" + bond_labels_2[i] + ")^2 + " +
-                                                                                                                     "(rz" + bond_labels_1[i] + "-rz" + bond_labels_2[i] + ")^2 ); : 0.0" );
-        }
-        text_file_writer.write_line();
-        text_file_writer.write_line( "    ' Calculate corrected relative Cartesian coordinates. See Downs, page 83." );
-        for ( size_t i( 0 ); i < bond_labels_1.size(); ++i )
-        {
-            text_file_writer.write_line( "    prm !corr_dist_" + bond_labels_1[i] + "_" + bond_labels_2[i] + " = Sqrt( (crx" + bond_labels_1[i] + "-crx" + bond_labels_2[i] + ")^2 + " +
-                                                                                                                     "(cry" + bond_labels_1[i] + "-cry" + bond_labels_2[i] + ")^2 + " +
-                                                                                                                     "(crz" + bond_labels_1[i] + "-crz" + bond_labels_2[i] + ")^2 ); : 0.0" );
-        }
-        text_file_writer.write_line();
-        text_file_writer.write_line( "    prm !bond_width   0" );
-        text_file_writer.write_line( "    prm !bond_weight  10000" );
-        text_file_writer.write_line();
-        text_file_writer.write_line( "    ' Restrain the corrected bond lengths." );
-        for ( size_t i( 0 ); i < bond_labels_1.size(); ++i )
-        {
-            text_file_writer.write_line( "    Angle_Distance_Restrain( corr_dist_" + bond_labels_1[i] + "_" + bond_labels_2[i] + ", " + double2string( bond_target_values[i] ) + ", 0.0, bond_width, bond_weight )" );
-        }
-        text_file_writer.write_line();
+        append_current_and_corrected_distances( bond_labels_1, bond_labels_2, false, output );
+        append_line( output, "    prm !bond_width   0" );
+        append_line( output, "    prm !bond_weight  10000" );
+        append_line( output );
+        append_distance_restraints( bond_labels_1, bond_labels_2, bond_target_values, output );
     }
     if ( write_angle_restraints )
     {
+        append_corrected_angles( unique_labels_1, unique_labels_2, angle_labels_1, angle_labels_2, angle_labels_3, output );
+        append_line( output, "    prm !angle_width  0" );
+        append_line( output, "    prm !angle_weight 1" );
+        append_line( output );
+        append_angle_restraints( angle_labels_1, angle_labels_2, angle_labels_3, angle_target_values, output );
+    }
+    append_line( output );
+    append_line( output, "    Out_CIF_ADPs_TLS( \"filename.cif\" )" );
+    append_line( output );
+    append_line( output, "    xdd_out \"filename_profile.txt\" load out_record out_fmt out_eqn" );
+    append_line( output, "    {" );
+    append_line( output, "        \" %11.5f \" = X;" );
+    append_line( output, "        \" %11.5f \" = Yobs;" );
+    append_line( output, "        \" %11.5f \" = Ycalc;" );
+    append_line( output, "        \" %11.5f\\n\" = SigmaYobs;" );
+    append_line( output, "    }" );
+    append_line( output );
+    append_line( output, "    phase_out \"filename_tickmarks.txt\" load out_record out_fmt out_eqn" );
+    append_line( output, "    {" );
+    append_line( output, "        \" %11.5f -200\\n\" = 2.0 * Rad * Th;" );
+    append_line( output, "    }" );
+    append_line( output );
+    output += Out_CIF_ADPs_TLS_macro;
+    TextFileWriter text_file_writer( replace_extension( append_to_file_name( input_file_name, "_TLS" ), "inp" ) );
+    text_file_writer.write( output );
+}
 
-        text_file_writer.write_line( "    ' Calculate corrected valence angles." );
-        for ( size_t i( 0 ); i < unique_labels_1.size(); ++i )
-        {
-            text_file_writer.write_line( "    prm !diff_x_" + unique_labels_1[i] + "_" + unique_labels_2[i] + " = crx" + unique_labels_1[i] + " - crx" + unique_labels_2[i] + "; : 0.0" );
-            text_file_writer.write_line( "    prm !diff_y_" + unique_labels_1[i] + "_" + unique_labels_2[i] + " = cry" + unique_labels_1[i] + " - cry" + unique_labels_2[i] + "; : 0.0" );
-            text_file_writer.write_line( "    prm !diff_z_" + unique_labels_1[i] + "_" + unique_labels_2[i] + " = crz" + unique_labels_1[i] + " - crz" + unique_labels_2[i] + "; : 0.0" );
-        }
-        for ( size_t i( 0 ); i < angle_labels_1.size(); ++i )
-        {
-            text_file_writer.write_line( "    prm !corr_ang_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "_" + angle_labels_3[i] + " = Rad * ArcCos( ( diff_x_" + angle_labels_1[i] + "_" + angle_labels_2[i] + " * diff_x_" + angle_labels_3[i] + "_" + angle_labels_2[i] + " + " +
-                                                                                                                                                           "diff_y_" + angle_labels_1[i] + "_" + angle_labels_2[i] + " * diff_y_" + angle_labels_3[i] + "_" + angle_labels_2[i] + " + " +
-                                                                                                                                                           "diff_z_" + angle_labels_1[i] + "_" + angle_labels_2[i] + " * diff_z_" + angle_labels_3[i] + "_" + angle_labels_2[i] + " ) /" +
-                                                                                                                                                    " (Sqrt(diff_x_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "^2+" +
-                                                                                                                                                           "diff_y_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "^2+" +
-                                                                                                                                                           "diff_z_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "^2) * " +
-                                                                                                                                                      "Sqrt(diff_x_" + angle_labels_3[i] + "_" + angle_labels_2[i] + "^2+" +
-                                                                                                                                                           "diff_y_" + angle_labels_3[i] + "_" + angle_labels_2[i] + "^2+" +
-                                                                                                                                                           "diff_z_" + angle_labels_3[i] + "_" + angle_labels_2[i] + "^2)) ); : 0.0" );
-        }
-        text_file_writer.write_line();
-        text_file_writer.write_line( "    prm !angle_width  0" );
-        text_file_writer.write_line( "    prm !angle_weight 1" );
-        text_file_writer.write_line();
-        text_file_writer.write_line( "    ' Restrain the corrected valence angles." );
-        for ( size_t i( 0 ); i < angle_labels_1.size(); ++i )
-        {
-           text_file_writer.write_line( "    Angle_Distance_Restrain( corr_ang_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "_" + angle_labels_3[i] + ", " + double2string( angle_target_values[i] ) + ", 0.0, angle_width, angle_weight )" );
-        }
-    }
-
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    Out_CIF_ADPs_TLS( \"filename.cif\" )" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    xdd_out \"filename_profile.txt\" load out_record out_fmt out_eqn" );
-    text_file_writer.write_line( "    {" );
-    text_file_writer.write_line( "        \" %11.5f \" = X;" );
-    text_file_writer.write_line( "        \" %11.5f \" = Yobs;" );
-    text_file_writer.write_line( "        \" %11.5f \" = Ycalc;" );
-    text_file_writer.write_line( "        \" %11.5f\\n\" = SigmaYobs;" );
-    text_file_writer.write_line( "    }" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    phase_out \"filename_tickmarks.txt\" load out_record out_fmt out_eqn" );
-    text_file_writer.write_line( "    {" );
-    text_file_writer.write_line( "        \" %11.5f -200\\n\" = 2.0 * Rad * Th;" );
-    text_file_writer.write_line( "    }" );
-    text_file_writer.write_line();
+// ********************************************************************************
 
-    text_file_writer.write_line( "    macro Out_CIF_ADPs_TLS( file )" );
-    text_file_writer.write_line( "    {" );
-    text_file_writer.write_line( "        out file" );
-    text_file_writer.write_line( "        Out_String(\"data_\\n\")" );
-    text_file_writer.write_line( "        Out(Get(a), \"_cell_length_a  %V\")" );
-    text_file_writer.write_line( "        Out(Get(b), \"\\n_cell_length_b  %V\")" );
-    text_file_writer.write_line( "        Out(Get(c), \"\\n_cell_length_c  %V\")" );
-    text_file_writer.write_line( "        Out(Get(al), \"\\n_cell_angle_alpha %V\")" );
-    text_file_writer.write_line( "        Out(Get(be), \"\\n_cell_angle_beta  %V\")" );
-    text_file_writer.write_line( "        Out(Get(ga), \"\\n_cell_angle_gamma %V\")" );
-    text_file_writer.write_line( "        Out(Get(cell_volume), \"\\n_cell_volume %V\")" );
-    text_file_writer.write_line( "        Out(Get(sp_grp_char), \"\\n_symmetry_space_group_name_H-M %s\")" );
-    text_file_writer.write_line( "        Out_String(\"\\nloop_\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_symmetry_equiv_pos_as_xyz\")" );
-    text_file_writer.write_line( "            Out(Get(sp_xyzs_txt),  \"%s\")" );
-    text_file_writer.write_line( "        Out_String(\"\\nloop_\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_label\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_type_symbol\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_symmetry_multiplicity\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_fract_x\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_fract_y\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_fract_z\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_occupancy\")" );
-    text_file_writer.write_line( "        atom_out file append" );
-    text_file_writer.write_line( "            load out_record out_fmt out_eqn" );
-    text_file_writer.write_line( "            {" );
-    text_file_writer.write_line( "                \"\\n%s\" = Get_From_String(Get(current_atom), site);" );
-    text_file_writer.write_line( "                \" %s\" = Get_From_String(Get(current_atom), atom);" );
-    text_file_writer.write_line( "                \" %3.0f\" = Get_From_String(Get(current_atom), num_posns);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), x);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), y);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), z);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), occ);" );
-    text_file_writer.write_line( "            }" );
-    text_file_writer.write_line( "        out file append" );
-    text_file_writer.write_line( "        Out_String(\"\\nloop_\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_label\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_11\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_22\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_33\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_12\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_13\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_23\")" );
-    text_file_writer.write_line( "        atom_out file append adps" );
-    text_file_writer.write_line( "            load out_record out_fmt out_eqn" );
-    text_file_writer.write_line( "            {" );
-    text_file_writer.write_line( "                \"\\n%s\" = Get_From_String(Get(current_atom), site);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u11);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u22);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u33);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u12);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u13);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u23);" );
-    text_file_writer.write_line( "            }" );
-    text_file_writer.write_line( "        out file append" );
-    text_file_writer.write_line( "        Out_String(\"\\n\")" );
-    text_file_writer.write_line( "    }" );
+void TLSWriter( const std::vector< FileName > & input_file_names, const size_t nthreads )
+{
+    for_each_input_file( input_file_names, nthreads, []( const FileName & input_file_name ) { TLSWriter( input_file_name ); } );
 }
 
 // ********************************************************************************
@@ -457,21 +525,22 @@ void TLSWriter( const FileName & input_file_name )
 void TLSWriter_2( const FileName & input_file_name )
 {
     TextFileReader_2 input_file( input_file_name );
-    TextFileWriter text_file_writer( append_to_file_name( input_file_name, "_TLS" ) );
-    text_file_writer.write_line( "/* TLS refinement." );
-    text_file_writer.write_line( "Based on code by Simon Parsons, University of Edinburgh." );
-    text_file_writer.write_line( "Generalised by Jacco van de Streek, University of Frankfurt." );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "References are" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "R.T. Downs. High Temperature and High Pressure Crystal Chemistry. Rev. In Mineralogy & Geochemistry. Vol 41. Pages 61-87." );
-    text_file_writer.write_line( "This excellent paper can be downloaded from http://www.geo.arizona.edu/xtal/group/pdf/chapter7.pdf" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "J. Dunitz: X-Ray Analysis and the Structures of Organic Molecules. Ch. 5" );
-    text_file_writer.write_line( "This book has been republished by Wiley, and contains a nice introduction" );
-    text_file_writer.write_line( "to TLS analysis applied to molecular systems. Highly recommended." );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "*/" );
+    std::string output;
+    output.reserve( 2 * input_file.size() * 80 + 8192 );
+    append_line( output, "/* TLS refinement." );
+    append_line( output, "Based on code by Simon Parsons, University of Edinburgh." );
+    append_line( output, "Generalised by Jacco van de Streek, University of Frankfurt." );
+    append_line( output );
+    append_line( output, "References are" );
+    append_line( output );
+    append_line( output, "R.T. Downs. High Temperature and High Pressure Crystal Chemistry. Rev. In Mineralogy & Geochemistry. Vol 41. Pages 61-87." );
+    append_line( output, "This excellent paper can be downloaded from http://www.geo.arizona.edu/xtal/group/pdf/chapter7.pdf" );
+    append_line( output );
+    append_line( output, "J. Dunitz: X-Ray Analysis and the Structures of Organic Molecules. Ch. 5" );
+    append_line( output, "This book has been republished by Wiley, and contains a nice introduction" );
+    append_line( output, "to TLS analysis applied to molecular systems. Highly recommended." );
+    append_line( output );
+    append_line( output, "*/" );
     bool found( false );
     size_t iLine( 0 );
     std::vector< std::string > words;
@@ -504,7 +573,7 @@ void TLSWriter_2( const FileName & input_file_name )
         }
         if ( ! found )
         {
-            text_file_writer.write_line( input_file.line( iLine ) );
+            append_line( output, input_file.line( iLine ) );
             ++iLine;
         }
     }
@@ -531,7 +600,7 @@ void TLSWriter_2( const FileName & input_file_name )
     }
     else
         throw std::runtime_error( "TLSWriter_2(): could not find lattice parameters." );
-    text_file_writer.write_line( input_file.line( iLine ) );
+    append_line( output, input_file.line( iLine ) );
     ++iLine;
     words = split_2( input_file.line( iLine ) );
     if ( words.size() == 2 )
@@ -546,7 +615,7 @@ void TLSWriter_2( const FileName & input_file_name )
     }
     else
         throw std::runtime_error( "TLSWriter_2(): could not find lattice parameters." );
-    text_file_writer.write_line( input_file.line( iLine ) );
+    append_line( output, input_file.line( iLine ) );
 
     ++iLine;
     words = split_2( input_file.line( iLine ) );
@@ -562,7 +631,7 @@ void TLSWriter_2( const FileName & input_file_name )
     }
     else
         throw std::runtime_error( "TLSWriter_2(): could not find lattice parameters." );
-    text_file_writer.write_line( input_file.line( iLine ) );
+    append_line( output, input_file.line( iLine ) );
 
     ++iLine;
     words = split_2( input_file.line( iLine ) );
@@ -578,7 +647,7 @@ void TLSWriter_2( const FileName & input_file_name )
     }
     else
         throw std::runtime_error( "TLSWriter_2(): could not find lattice parameters." );
-    text_file_writer.write_line( input_file.line( iLine ) );
+    append_line( output, input_file.line( iLine ) );
 
     ++iLine;
     words = split_2( input_file.line( iLine ) );
@@ -594,7 +663,7 @@ void TLSWriter_2( const FileName & input_file_name )
     }
     else
         throw std::runtime_error( "TLSWriter_2(): could not find lattice parameters." );
-    text_file_writer.write_line( input_file.line( iLine ) );
+    append_line( output, input_file.line( iLine ) );
 
     ++iLine;
     words = split_2( input_file.line( iLine ) );
@@ -610,7 +679,7 @@ void TLSWriter_2( const FileName & input_file_name )
     }
     else
         throw std::runtime_error( "TLSWriter_2(): could not find lattice parameters." );
-    text_file_writer.write_line( input_file.line( iLine ) );
+    append_line( output, input_file.line( iLine ) );
     // Read the lines between the lattice parameters and the "site"s
     ++iLine;
     found = false;
@@ -621,7 +690,7 @@ void TLSWriter_2( const FileName & input_file_name )
             found = true;
         else
         {
-            text_file_writer.write_line( input_file.line( iLine ) );
+            append_line( output, input_file.line( iLine ) );
             ++iLine;
         }
     }
@@ -643,165 +712,26 @@ void TLSWriter_2( const FileName & input_file_name )
         else
             found = false;
     }
-    text_file_writer.write_line( "    ' Origin of the molecule (fractional coordinates)." );
-    Vector3D c_o_m = crystal_structure.centre_of_mass();
-    text_file_writer.write_line( "    prm centx " + double2string( c_o_m.x() ) );
-    text_file_writer.write_line( "    prm centy " + double2string( c_o_m.y() ) );
-    text_file_writer.write_line( "    prm centz " + double2string( c_o_m.z() ) );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' T11 etc. are elements of the T, L and S tensors." );
-    text_file_writer.write_line( "    prm T11  0.05" );
-    text_file_writer.write_line( "    prm T22  0.05" );
-    text_file_writer.write_line( "    prm T33  0.05" );
-    text_file_writer.write_line( "    prm T12  0.0" );
-    text_file_writer.write_line( "    prm T13  0.0" );
-    text_file_writer.write_line( "    prm T23  0.0" );
-    text_file_writer.write_line( "    prm L11  0.0" );
-    text_file_writer.write_line( "    prm L22  0.0" );
-    text_file_writer.write_line( "    prm L33  0.0" );
-    text_file_writer.write_line( "    prm L12  0.0" );
-    text_file_writer.write_line( "    prm L13  0.0" );
-    text_file_writer.write_line( "    prm L23  0.0" );
-    text_file_writer.write_line( "    prm S11  0.0" );
-    text_file_writer.write_line( "    prm S12  0.0" );
-    text_file_writer.write_line( "    prm S13  0.0" );
-    text_file_writer.write_line( "    prm S22  0.0" );
-    text_file_writer.write_line( "    prm S23  0.0" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Choice of origin to make S symmetric (Downs, p80-81)." );
-    text_file_writer.write_line( "    prm S21 = S12;" );
-    text_file_writer.write_line( "    prm S31 = S13;" );
-    text_file_writer.write_line( "    prm S32 = S23;" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Standard constraint to make equations determinate." );
-    text_file_writer.write_line( "    prm S33 = -S11 - S22; : 0.0" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' The libration is sqrt(trace(L))." );
-    text_file_writer.write_line( "    prm libration = Sqrt(L11 + L22 + L33) * Rad; : 0.0" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Conversion of fractional coordinates to Cartesian." );
-    text_file_writer.write_line( "    ' xN1   = fractional x coordinate of atom N1" );
-    text_file_writer.write_line( "    ' rxN1  = Cartesian coordinate x of atom N1. 'r' always indicates a Cartesian coordinate." );
-    text_file_writer.write_line( "    ' drxN1 = Correction for libration to Cartesian x coordinate of atom N1." );
-    text_file_writer.write_line( "    ' crxN1 = Cartesian x coordinate of atom N1 corrected for libration:" );
-    text_file_writer.write_line( "    ' crxN1 = rxN1 + drxN1" );
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Unit-cell parameters are assumed to be constant." );
-    text_file_writer.write_line();
-    Matrix3D f2c = crystal_structure.crystal_lattice().fractional_to_orthogonal_matrix();
-    
-    // Many matrix elements evaluate to e.g. -1.0E-18, these are set to 0.0 here.
-    for ( size_t i( 0 ); i < 3; ++i )
-    {
-        for ( size_t j( 0 ); j < 3; ++j )
-        {
-            if ( nearly_equal( f2c.value( i, j ), 0.0 ) )
-                f2c.set_value( i, j, 0.0 );
-        }
-    }
-    
-    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
-    {
-        std::string label = crystal_structure.atom( i ).label();
-        text_file_writer.write_line( "    prm !rx" + label + " = (x" + label + " - centx)*" + double2string( f2c.value(0,0) ) + " + (y" + label + " - centy)*" + double2string( f2c.value(0,1) ) + " + (z" + label + " - centz)*" + double2string( f2c.value(0,2) ) + ";" );
-        text_file_writer.write_line( "    prm !ry" + label + " = (y" + label + " - centy)*" + double2string( f2c.value(1,1) ) + " + (z" + label + " - centz)*" + double2string( f2c.value(1,2) ) + ";" );
-        text_file_writer.write_line( "    prm !rz" + label + " = (z" + label + " - centz)*" + double2string( f2c.value(2,2) ) + ";" );
-    }
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Calculation of Uij values in Cartesian framework. See Dunitz page 251, Eqn 5.42 and Table 5.1 page 252." );
-    text_file_writer.write_line();
+    append_TLS_parameters( crystal_structure, output );
     for ( size_t i( 0 ); i < crystal_structure.natoms(); ++i )
     {
-        std::string label = crystal_structure.atom( i ).label();
-        text_file_writer.write_line( "    prm ru11" + label + " = L22*rz" + label + "^2 + L33*ry" + label + "^2 - 2*ry" + label + "*rz" + label + "*L23 - 2*ry" + label + "*S31 + 2*rz" + label + "*S21 + T11; : 0.0" );
-        text_file_writer.write_line( "    prm ru22" + label + " = L11*rz" + label + "^2 + L33*rx" + label + "^2 - 2*rx" + label + "*rz" + label + "*L13 - 2*rz" + label + "*S12 + 2*rx" + label + "*S32 + T22; : 0.0" );
-        text_file_writer.write_line( "    prm ru33" + label + " = L11*ry" + label + "^2 + L22*rx" + label + "^2 - 2*rx" + label + "*ry" + label + "*L12 - 2*rx" + label + "*S23 + 2*ry" + label + "*S13 + T33; : 0.0" );
-        text_file_writer.write_line( "    prm ru12" + label + " = -rx" + label + "*ry" + label + "*L33 + rx" + label + "*rz" + label + "*L23 + ry" + label + "*rz" + label + "*L13 - rz" + label + "^2*L12 - rz" + label +
-                                     "*S11 + rz" + label + "*S22 + rx" + label + "*S31 - ry" + label + "*S32 + T12; : 0.0" );
-        text_file_writer.write_line( "    prm ru13" + label + " = -rx" + label + "*rz" + label + "*L22 + rx" + label + "*ry" + label + "*L23 - ry" + label + "^2*L13 + ry" + label + "*rz" + label + "*L12 + ry" + label +
-                                     "*S11 - ry" + label + "*S33 + rz" + label + "*S23 - rx" + label + "*S21 + T13; : 0.0" );
-        text_file_writer.write_line( "    prm ru23" + label + " = -ry" + label + "*rz" + label + "*L11 - rx" + label + "^2*L23 + rx" + label + "*ry" + label + "*L13 + rx" + label + "*rz" + label + "*L12 - rx" + label +
-                                     "*S22 + rx" + label + "*S33 + ry" + label + "*S12 - rz" + label + "*S13 + T23; : 0.0" );
-        text_file_writer.write_line();
-    }
-    text_file_writer.write_line( "    ' ru11N1 = u11 of atom N1 in Cartesian coordinates." );
-    text_file_writer.write_line( "    ' u11N1 = u11 of atom N1 in cif coordinates." );
-    text_file_writer.write_line( "    ' See R. W. Grosse-Kunstleve & P. D. Adams (2002). J. Appl. Cryst. 35, 477-480." );
-    text_file_writer.write_line();
-    for ( size_t i( 0 ); i < crystal_structure.natoms(); ++i )
-    {
-        std::string label = crystal_structure.atom( i ).label();
-        std::vector<double> k;
-        k.push_back( 1.0 / crystal_structure.crystal_lattice().a_star() );
-        k.push_back( 1.0 / crystal_structure.crystal_lattice().b_star() );
-        k.push_back( 1.0 / crystal_structure.crystal_lattice().c_star() );
-        Matrix3D c2f = crystal_structure.crystal_lattice().orthogonal_to_fractional_matrix();
-        size_t r;
-        size_t s;
-        // Many matrix elements evaluate to e.g. -1.0E-18, these are set to 0.0 here.
-        for ( r = 0; r < 3; ++r )
-        {
-            for ( s = 0; s < 3; ++s )
-            {
-                if ( nearly_equal( c2f.value( r, s ), 0.0 ) )
-                    c2f.set_value( r, s, 0.0 );
-            }
-        }
-        // TOPAS cannot cope with "prm n = 4 + -2;", a workaround is to write "prm n = 4 + (-2);".
-        std::vector< size_t > r_s; // "r's", multiple of "r"
-        std::vector< size_t > s_s; // "s's", multiple of "s"
-        r_s.push_back( 1 );
-        s_s.push_back( 1 );
-        r_s.push_back( 2 );
-        s_s.push_back( 2 );
-        r_s.push_back( 3 );
-        s_s.push_back( 3 );
-        r_s.push_back( 1 );
-        s_s.push_back( 2 );
-        r_s.push_back( 1 );
-        s_s.push_back( 3 );
-        r_s.push_back( 2 );
-        s_s.push_back( 3 );
-        for ( size_t j(0); j != r_s.size(); ++j )
-        {
-            r = r_s[j];
-            s = s_s[j];
-            text_file_writer.write_line( "    prm u" + size_t2string(r) + size_t2string(s) + label + " = " + double2string( k[r-1] * k[s-1] ) + " * ( " );
-            text_file_writer.write_line( "        "  + double2string( c2f.value(r-1,0) ) + "  * ( ru11" + label + " * " + double2string( c2f.value(s-1,0) ) + " + ru12" + label + " * " + double2string( c2f.value(s-1,1) ) + " + ru13" + label + " * " + double2string( c2f.value(s-1,2) ) + " ) + " );
-            text_file_writer.write_line( "        (" + double2string( c2f.value(r-1,1) ) + ") * ( ru12" + label + " * " + double2string( c2f.value(s-1,0) ) + " + ru22" + label + " * " + double2string( c2f.value(s-1,1) ) + " + ru23" + label + " * " + double2string( c2f.value(s-1,2) ) + " ) + " );
-            text_file_writer.write_line( "        (" + double2string( c2f.value(r-1,2) ) + ") * ( ru13" + label + " * " + double2string( c2f.value(s-1,0) ) + " + ru23" + label + " * " + double2string( c2f.value(s-1,1) ) + " + ru33" + label + " * " + double2string( c2f.value(s-1,2) ) + " ) ); : 0.0" );
-        }
-        text_file_writer.write_line();
-    }
-    for ( size_t i( 0 ); i < crystal_structure.natoms(); ++i )
-    {
-        std::string label = crystal_structure.atom( i ).label();
+        const std::string & label = crystal_structure.atom( i ).label();
         bool keep_ADPs_positive_definite = false;
         if ( keep_ADPs_positive_definite )
-            text_file_writer.write_line( "    site " + label + " x x" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().x(), 5, ' ' ) +
-                                                               " y y" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().y(), 5, ' ' ) +
-                                                               " z z" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().z(), 5, ' ' ) +
-                                         " occ " + crystal_structure.atom( i ).element().symbol() + " 1 ADPs_Keep_PD u11=u11" + label + "; u22=u22" + label + "; u33=u33" + label + "; u12=u12" + label + "; u13=u13" + label + "; u23=u23" + label + ";" );
+            append_line( output, "    site " + label + " x x" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().x(), 5, ' ' ) +
+                                                    " y y" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().y(), 5, ' ' ) +
+                                                    " z z" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().z(), 5, ' ' ) +
+                                 " occ " + crystal_structure.atom( i ).element().symbol() + " 1 ADPs_Keep_PD u11=u11" + label + "; u22=u22" + label + "; u33=u33" + label + "; u12=u12" + label + "; u13=u13" + label + "; u23=u23" + label + ";" );
         else
-            text_file_writer.write_line( "    site " + label + " x x" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().x(), 5, ' ' ) +
-                                                               " y y" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().y(), 5, ' ' ) +
-                                                               " z z" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().z(), 5, ' ' ) +
-                                         " occ " + crystal_structure.atom( i ).element().symbol() + " 1 ADPs { =u11" + label + "; =u22" + label + "; =u33" + label + "; =u12" + label + "; =u13" + label + "; =u23" + label + "; }" );
-    }
-    text_file_writer.write_line();
-    text_file_writer.write_line( "    ' Calculate corrected relative Cartesian coordinates. See Downs, page 83." );
-    text_file_writer.write_line( "    ' Note that only intramolecular corrected distances can be trusted, the intermolecular corrected distances have no physical meaning." );
-    for ( size_t i( 0 ); i < crystal_structure.natoms(); ++i )
-    {
-        std::string label = crystal_structure.atom( i ).label();
-        text_file_writer.write_line( "    prm !drx" + label + " = 0.5*( (L22+L33)*rx" + label + "        -L12*ry" + label + "        -L13*rz" + label + " ) ; : 0.0" );
-        text_file_writer.write_line( "    prm !dry" + label + " = 0.5*(      -L12*rx" + label + " + (L11+L33)*ry" + label + "        -L23*rz" + label + " ) ; : 0.0" );
-        text_file_writer.write_line( "    prm !drz" + label + " = 0.5*(      -L13*rx" + label + "        -L23*ry" + label + " + (L11+L22)*rz" + label + " ) ; : 0.0" );
-        text_file_writer.write_line( "    prm !crx" + label + " =                 rx" + label + " +          drx" + label + " ; : 0.0" );
-        text_file_writer.write_line( "    prm !cry" + label + " =                 ry" + label + " +          dry" + label + " ; : 0.0" );
-        text_file_writer.write_line( "    prm !crz" + label + " =                 rz" + label + " +          drz" + label + " ; : 0.0" );
-    }
-    text_file_writer.write_line();
+            append_line( output, "    site " + label + " x x" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().x(), 5, ' ' ) +
+                                                    " y y" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().y(), 5, ' ' ) +
+                                                    " z z" + label + " " + double2string_pad_plus( crystal_structure.atom( i ).position().z(), 5, ' ' ) +
+                                 " occ " + crystal_structure.atom( i ).element().symbol() + " 1 ADPs { =u11" + label + "; =u22" + label + "; =u33" + label + "; =u12" + label + "; =u13" + label + "; =u23" + label + "; }" );
+    }
+    append_line( output );
+    append_line( output, "    ' Calculate corrected relative Cartesian coordinates. See Downs, page 83." );
+    append_line( output, "    ' Note that only intramolecular corrected distances can be trusted, the intermolecular corrected distances have no physical meaning." );
+    append_libration_corrections( crystal_structure, output );
     // Read the lines between the "site" and "restrain". This should be:
 
 //    site H75 x ref_flag -0.04362`_0.00021 y ref_flag -0.24684`_0.00184 z ref_flag  1.35597`_0.00243 occ H 1 beq = bh;
@@ -822,12 +752,12 @@ void TLSWriter_2( const FileName & input_file_name )
         else
             ++iLine;
     }
-    text_file_writer.write_line( "    prm !bond_width 0" );
-    text_file_writer.write_line( "    prm !bond_weight 1000" );
-    text_file_writer.write_line( "    prm !angle_width 0" );
-    text_file_writer.write_line( "    prm !angle_weight 1" );
-    text_file_writer.write_line( "    prm !flatten_width 0" );
-    text_file_writer.write_line( "    prm !flatten_weight 100000" );
+    append_line( output, "    prm !bond_width 0" );
+    append_line( output, "    prm !bond_weight 1000" );
+    append_line( output, "    prm !angle_width 0" );
+    append_line( output, "    prm !angle_weight 1" );
+    append_line( output, "    prm !flatten_width 0" );
+    append_line( output, "    prm !flatten_weight 100000" );
     // When we are here, either we are at the end of the file or we are at the line "Restrain".
     // Read the "restrain" lines
     std::vector< std::string > bond_labels_1;
@@ -884,169 +814,41 @@ void TLSWriter_2( const FileName & input_file_name )
             ++iLine;
         }
     }
-
-    // We must find the unique combinations, e.g.:
-    // angle r1-r2-r3 and bond r3-r2 only require two combinations: r1-r2 and r3-r2
-    // Create list of unique bonds
     std::vector< std::string > unique_labels_1;
     std::vector< std::string > unique_labels_2;
-    for ( size_t i( 0 ); i != angle_labels_1.size(); ++i )
-    {
-        bool found( false );
-        // Find bond 1
-        for ( size_t j( 0 ); j != unique_labels_1.size(); ++j )
-        {
-            if ( ( unique_labels_1[j] == angle_labels_1[i] ) && ( unique_labels_2[j] == angle_labels_2[i] ) )
-            {
-                 found = true;
-                 break;
-            }
-        }
-        if ( ! found )
-        {
-            unique_labels_1.push_back( angle_labels_1[i] );
-            unique_labels_2.push_back( angle_labels_2[i] );
-        }
-        found = false;
-        // Find bond 2
-        for ( size_t j( 0 ); j != unique_labels_1.size(); ++j )
-        {
-            if ( ( unique_labels_1[j] == angle_labels_3[i] ) && ( unique_labels_2[j] == angle_labels_2[i] ) )
-            {
-                 found = true;
-                 break;
-            }
-        }
-        if ( ! found )
-        {
-            unique_labels_1.push_back( angle_labels_3[i] );
-            unique_labels_2.push_back( angle_labels_2[i] );
-        }
-    }
-
-//    if ( write_bond_restraints )
-    {
-        text_file_writer.write_line( "    ' Calculate current bond lengths." );
-        for ( size_t i( 0 ); i < bond_labels_1.size(); ++i )
-        {
-            text_file_writer.write_line( "    prm !curr_dist_" + bond_labels_1[i] + "_" + bond_labels_2[i] + " = Sqrt( (rx" + bond_labels_1[i] + "-rx" + bond_labels_2[i] + ")^2 + " +
-                                                                                                                      "(ry" + bond_labels_1[i] + "-ry" + bond_labels_2[i] + ")^2 + " +
-                                                                                                                      "(rz" + bond_labels_1[i] + "-rz" + bond_labels_2[i] + ")^2 ); : 0.0" );
-        }
-        text_file_writer.write_line();
-        text_file_writer.write_line( "    ' Calculate corrected relative Cartesian coordinates. See Downs, page 83." );
-        text_file_writer.write_line( "    ' Note that only intramolecular corrected distances can be trusted, the intermolecular corrected distances have no physical meaning." );
-        for ( size_t i( 0 ); i < bond_labels_1.size(); ++i )
-        {
-            text_file_writer.write_line( "    prm !corr_dist_" + bond_labels_1[i] + "_" + bond_labels_2[i] + " = Sqrt( (crx" + bond_labels_1[i] + "-crx" + bond_labels_2[i] + ")^2 + " +
-                                                                                                                      "(cry" + bond_labels_1[i] + "-cry" + bond_labels_2[i] + ")^2 + " +
-                                                                                                                      "(crz" + bond_labels_1[i] + "-crz" + bond_labels_2[i] + ")^2 ); : 0.0" );
-        }
-        text_file_writer.write_line();
-        text_file_writer.write_line( "    ' Restrain the corrected bond lengths." );
-        for ( size_t i( 0 ); i < bond_labels_1.size(); ++i )
-        {
-            text_file_writer.write_line( "    Angle_Distance_Restrain( corr_dist_" + bond_labels_1[i] + "_" + bond_labels_2[i] + ", " + double2string( bond_target_values[i] ) + ", 0.0, bond_width, bond_weight )" );
-        }
-        text_file_writer.write_line();
-    }
-//    if ( write_angle_restraints )
-    {
-
-        text_file_writer.write_line( "    ' Calculate corrected valence angles." );
-        for ( size_t i( 0 ); i < unique_labels_1.size(); ++i )
-        {
-            text_file_writer.write_line( "    prm !diff_x_" + unique_labels_1[i] + "_" + unique_labels_2[i] + " = crx" + unique_labels_1[i] + " - crx" + unique_labels_2[i] + "; : 0.0" );
-            text_file_writer.write_line( "    prm !diff_y_" + unique_labels_1[i] + "_" + unique_labels_2[i] + " = cry" + unique_labels_1[i] + " - cry" + unique_labels_2[i] + "; : 0.0" );
-            text_file_writer.write_line( "    prm !diff_z_" + unique_labels_1[i] + "_" + unique_labels_2[i] + " = crz" + unique_labels_1[i] + " - crz" + unique_labels_2[i] + "; : 0.0" );
-        }
-        for ( size_t i( 0 ); i < angle_labels_1.size(); ++i )
-        {
-            text_file_writer.write_line( "    prm !corr_ang_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "_" + angle_labels_3[i] + " = Rad * ArcCos( ( diff_x_" + angle_labels_1[i] + "_" + angle_labels_2[i] + " * diff_x_" + angle_labels_3[i] + "_" + angle_labels_2[i] + " + " +
-                                                                                                                                                           "diff_y_" + angle_labels_1[i] + "_" + angle_labels_2[i] + " * diff_y_" + angle_labels_3[i] + "_" + angle_labels_2[i] + " + " +
-                                                                                                                                                           "diff_z_" + angle_labels_1[i] + "_" + angle_labels_2[i] + " * diff_z_" + angle_labels_3[i] + "_" + angle_labels_2[i] + " ) /" +
-                                                                                                                                                    " (Sqrt(diff_x_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "^2+" +
-                                                                                                                                                           "diff_y_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "^2+" +
-                                                                                                                                                           "diff_z_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "^2) * " +
-                                                                                                                                                      "Sqrt(diff_x_" + angle_labels_3[i] + "_" + angle_labels_2[i] + "^2+" +
-                                                                                                                                                           "diff_y_" + angle_labels_3[i] + "_" + angle_labels_2[i] + "^2+" +
-                                                                                                                                                           "diff_z_" + angle_labels_3[i] + "_" + angle_labels_2[i] + "^2)) ); : 0.0" );
-        }
-        text_file_writer.write_line();
-        text_file_writer.write_line( "    ' Restrain the corrected valence angles." );
-        for ( size_t i( 0 ); i < angle_labels_1.size(); ++i )
-        {
-           text_file_writer.write_line( "    Angle_Distance_Restrain( corr_ang_" + angle_labels_1[i] + "_" + angle_labels_2[i] + "_" + angle_labels_3[i] + ", " + double2string( angle_target_values[i] ) + ", 0.0, angle_width, angle_weight )" );
-        }
-    }
-    
+    find_unique_bonds( angle_labels_1, angle_labels_2, angle_labels_3, unique_labels_1, unique_labels_2 );
+    {
+    const std::unordered_map< std::string, size_t > labels = label_index( crystal_structure );
+    check_labels( labels, bond_labels_1 );
+    check_labels( labels, bond_labels_2 );
+    check_labels( labels, angle_labels_1 );
+    check_labels( labels, angle_labels_2 );
+    check_labels( labels, angle_labels_3 );
+    }
+    append_current_and_corrected_distances( bond_labels_1, bond_labels_2, true, output );
+    append_distance_restraints( bond_labels_1, bond_labels_2, bond_target_values, output );
+    append_corrected_angles( unique_labels_1, unique_labels_2, angle_labels_1, angle_labels_2, angle_labels_3, output );
+    append_angle_restraints( angle_labels_1, angle_labels_2, angle_labels_3, angle_target_values, output );
     while ( iLine != input_file.size() )
     {
         // Find Out_CIF_STR_Uiso and replace by Out_CIF_ADPs_TLS
         size_t iPos = input_file.line( iLine ).find( "Out_CIF_STR_Uiso" );
         if ( iPos == std::string::npos )
-            text_file_writer.write_line( input_file.line( iLine ) );
+            append_line( output, input_file.line( iLine ) );
         else
-            text_file_writer.write_line( input_file.line( iLine ).substr( 0, iPos ) + "Out_CIF_ADPs_TLS" + input_file.line( iLine ).substr( iPos + 16 ) );
+            append_line( output, input_file.line( iLine ).substr( 0, iPos ) + "Out_CIF_ADPs_TLS" + input_file.line( iLine ).substr( iPos + 16 ) );
         ++iLine;
     }
-    text_file_writer.write_line( "    macro Out_CIF_ADPs_TLS( file )" );
-    text_file_writer.write_line( "    {" );
-    text_file_writer.write_line( "        out file" );
-    text_file_writer.write_line( "        Out_String(\"data_\\n\")" );
-    text_file_writer.write_line( "        Out(Get(a), \"_cell_length_a  %V\")" );
-    text_file_writer.write_line( "        Out(Get(b), \"\\n_cell_length_b  %V\")" );
-    text_file_writer.write_line( "        Out(Get(c), \"\\n_cell_length_c  %V\")" );
-    text_file_writer.write_line( "        Out(Get(al), \"\\n_cell_angle_alpha %V\")" );
-    text_file_writer.write_line( "        Out(Get(be), \"\\n_cell_angle_beta  %V\")" );
-    text_file_writer.write_line( "        Out(Get(ga), \"\\n_cell_angle_gamma %V\")" );
-    text_file_writer.write_line( "        Out(Get(cell_volume), \"\\n_cell_volume %V\")" );
-    text_file_writer.write_line( "        Out(Get(sp_grp_char), \"\\n_symmetry_space_group_name_H-M %s\")" );
-    text_file_writer.write_line( "        Out_String(\"\\nloop_\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_symmetry_equiv_pos_as_xyz\")" );
-    text_file_writer.write_line( "            Out(Get(sp_xyzs_txt),  \"%s\")" );
-    text_file_writer.write_line( "        Out_String(\"\\nloop_\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_label\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_type_symbol\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_symmetry_multiplicity\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_fract_x\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_fract_y\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_fract_z\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_occupancy\")" );
-    text_file_writer.write_line( "        atom_out file append" );
-    text_file_writer.write_line( "            load out_record out_fmt out_eqn" );
-    text_file_writer.write_line( "            {" );
-    text_file_writer.write_line( "                \"\\n%s\" = Get_From_String(Get(current_atom), site);" );
-    text_file_writer.write_line( "                \" %s\" = Get_From_String(Get(current_atom), atom);" );
-    text_file_writer.write_line( "                \" %3.0f\" = Get_From_String(Get(current_atom), num_posns);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), x);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), y);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), z);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), occ);" );
-    text_file_writer.write_line( "            }" );
-    text_file_writer.write_line( "        out file append" );
-    text_file_writer.write_line( "        Out_String(\"\\nloop_\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_label\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_11\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_22\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_33\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_12\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_13\")" );
-    text_file_writer.write_line( "        Out_String(\"\\n_atom_site_aniso_U_23\")" );
-    text_file_writer.write_line( "        atom_out file append adps" );
-    text_file_writer.write_line( "            load out_record out_fmt out_eqn" );
-    text_file_writer.write_line( "            {" );
-    text_file_writer.write_line( "                \"\\n%s\" = Get_From_String(Get(current_atom), site);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u11);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u22);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u33);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u12);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u13);" );
-    text_file_writer.write_line( "                \" %V\" = Get_From_String(Get(current_atom), u23);" );
-    text_file_writer.write_line( "            }" );
-    text_file_writer.write_line( "        out file append" );
-    text_file_writer.write_line( "        Out_String(\"\\n\")" );
-    text_file_writer.write_line( "    }" );
+    output += Out_CIF_ADPs_TLS_macro;
+    TextFileWriter text_file_writer( append_to_file_name( input_file_name, "_TLS" ) );
+    text_file_writer.write( output );
+}
+
+// ********************************************************************************
+
+void TLSWriter_2( const std::vector< FileName > & input_file_names, const size_t nthreads )
+{
+    for_each_input_file( input_file_names, nthreads, []( const FileName & input_file_name ) { TLSWriter_2( input_file_name ); } );
 }
 
 // ********************************************************************************
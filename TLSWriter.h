@@ -30,11 +30,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 class FileName;
 
+#include <cstddef> // For definition of size_t
+#include <vector>
+
 // From .cif file
 void TLSWriter( const FileName & input_file_name );
 
 // From .inp file
 void TLSWriter_2( const FileName & input_file_name );
 
+// The files are processed concurrently on nthreads threads (0 means one thread per core).
+// Error messages are prefixed with the name of the file that caused them.
+void TLSWriter( const std::vector< FileName > & input_file_names, const size_t nthreads = 0 );
+
+void TLSWriter_2( const std::vector< FileName > & input_file_names, const size_t nthreads = 0 );
+
 #endif // TLSWRITER_H
 
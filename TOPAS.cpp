@@ -29,9 +29,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Angle.h"
 #include "CrystalLattice.h"
+#include "FileName.h"
 #include "TextFileReader_2.h"
+#include "TextFileWriter.h"
 #include "Utilities.h"
 
+#include <algorithm>
 #include <iostream> // For debugging
 #include <stdexcept>
 
@@ -49,272 +52,192 @@ std::string insert_at_sign( std::string input )
 
 // ********************************************************************************
 
-// Not allowed: "prm!a 1", "prm ! a 1", it must be "prm !a 1" or "prm a 1"
-double read_keyword( const std::string & keyword, TextFileReader_2 & input_file )
+TOPASInputFile::TOPASInputFile( const FileName & file_name )
+{
+    TextFileReader_2 input_file( file_name );
+    *this = TOPASInputFile( input_file );
+}
+
+// ********************************************************************************
+
+TOPASInputFile::TOPASInputFile( const TextFileReader_2 & input_file )
+{
+    lines_.reserve( input_file.size() );
+    token_starts_.reserve( input_file.size() );
+    token_lengths_.reserve( input_file.size() );
+    for ( size_t i( 0 ); i != input_file.size(); ++i )
+        add_line( input_file.line( i ) );
+}
+
+// ********************************************************************************
+
+void TOPASInputFile::add_line( const std::string & line )
 {
-    size_t iLine( 0 );
-    // First try to find "!keyword", then "keyword"
-    do
+    const size_t iLine = lines_.size();
+    lines_.push_back( line );
+    token_starts_.push_back( std::vector< size_t >() );
+    token_lengths_.push_back( std::vector< size_t >() );
+    const size_t comment_start = std::min( line.find( '\'' ), line.size() );
+    size_t iPos( 0 );
+    while ( true )
     {
-        iLine = input_file.find_whole_word( "!" + keyword, iLine+1 );
-        if ( iLine == std::string::npos )
+        while ( ( iPos != comment_start ) && ( ( line[iPos] == ' ' ) || ( line[iPos] == '\t' ) ) )
+            ++iPos;
+        if ( iPos == comment_start )
             break;
-        // Remove the bit that has been commented out
-        std::string line = input_file.line( iLine );
-        size_t iPos = line.find( "'" );
-        line = line.substr( 0, iPos );
-        iPos = line.find( "!" + keyword );
-        if ( iPos == std::string::npos )
-            continue;
-        std::vector< std::string > words = split( line );
-        if ( words.size() < 3 )
-            continue;
-        if ( ( words[0] == "prm" ) && ( words[1] == "!" + keyword ) )
-            return TOPASstring2double( words[2] );
+        const size_t start = iPos;
+        while ( ( iPos != comment_start ) && ( line[iPos] != ' ' ) && ( line[iPos] != '\t' ) )
+            ++iPos;
+        keywords_[ line.substr( start, iPos - start ) ].push_back( Position( iLine, token_starts_[iLine].size() ) );
+        token_starts_[iLine].push_back( start );
+        token_lengths_[iLine].push_back( iPos - start );
     }
-    while ( true );
-    iLine = 0;
-    do
-    {
-        iLine = input_file.find_whole_word( keyword, iLine+1 );
-        if ( iLine == std::string::npos )
-            throw std::runtime_error( "read_keyword(): keyword not found." );
-        // Remove the bit that has been commented out
-        std::string line = input_file.line( iLine );
-        size_t iPos = line.find( "'" );
-        line = line.substr( 0, iPos );
-        iPos = line.find( keyword );
-        if ( iPos == std::string::npos )
-            continue;
-        std::vector< std::string > words = split( line );
-        if ( words.size() < 3 )
-            continue;
-        if ( ( words[0] == "prm" ) && ( words[1] == keyword ) )
-            return TOPASstring2double( words[2] );
-    }
-    while ( true );
+    if ( ( ntokens( iLine ) < 3 ) || ( token( iLine, 0 ) != "prm" ) )
+        return;
+    std::string name = token( iLine, 1 );
+    const bool fixed = ( name[0] == '!' );
+    if ( fixed )
+        name.erase( 0, 1 );
+    if ( name.empty() )
+        return;
+    std::map< std::string, Position >::iterator it = prms_.find( name );
+    if ( it == prms_.end() )
+        prms_.insert( std::make_pair( name, Position( iLine, 2 ) ) );
+    else if ( fixed && ( token( it->second.line_, 1 )[0] != '!' ) )
+        it->second = Position( iLine, 2 );
+}
+
+// ********************************************************************************
+
+const std::vector< TOPASInputFile::Position > & TOPASInputFile::find( const std::string & keyword ) const
+{
+    static const std::vector< Position > not_found;
+    std::map< std::string, std::vector< Position > >::const_iterator it = keywords_.find( keyword );
+    return ( it == keywords_.end() ) ? not_found : it->second;
+}
+
+// ********************************************************************************
+
+double TOPASInputFile::prm( const std::string & name ) const
+{
+    std::map< std::string, Position >::const_iterator it = prms_.find( name );
+    if ( it == prms_.end() )
+        throw std::runtime_error( "TOPASInputFile::prm(): keyword not found: >" + name + "<" );
+    return TOPASstring2double( token( it->second.line_, it->second.token_ ) );
+}
+
+// ********************************************************************************
+
+void TOPASInputFile::set_prm( const std::string & name, const double value )
+{
+    std::map< std::string, Position >::const_iterator it = prms_.find( name );
+    if ( it == prms_.end() )
+        throw std::runtime_error( "TOPASInputFile::set_prm(): keyword not found: >" + name + "<" );
+    set_token( it->second, double2string( value ) );
+}
+
+// ********************************************************************************
+
+// The keyword index is not updated, so this is meant for values, not for keywords.
+void TOPASInputFile::set_token( const Position position, const std::string & new_value )
+{
+    if ( ( position.line_ >= size() ) || ( position.token_ >= ntokens( position.line_ ) ) )
+        throw std::runtime_error( "TOPASInputFile::set_token(): position out of range." );
+    if ( new_value.empty() || ( new_value.find_first_of( " \t'" ) != std::string::npos ) )
+        throw std::runtime_error( "TOPASInputFile::set_token(): new value must be a single token: >" + new_value + "<" );
+    std::vector< size_t > & starts = token_starts_[position.line_];
+    std::vector< size_t > & lengths = token_lengths_[position.line_];
+    lines_[position.line_].replace( starts[position.token_], lengths[position.token_], new_value );
+    const size_t old_length = lengths[position.token_];
+    lengths[position.token_] = new_value.length();
+    for ( size_t j( position.token_ + 1 ); j != starts.size(); ++j )
+        starts[j] = starts[j] + new_value.length() - old_length;
+}
+
+// ********************************************************************************
+
+void TOPASInputFile::save( const FileName & file_name ) const
+{
+    TextFileWriter text_file_writer( file_name );
+    for ( size_t i( 0 ); i != size(); ++i )
+        text_file_writer.write_line( lines_[i] );
+}
+
+// ********************************************************************************
+
+double read_keyword( const std::string & keyword, TextFileReader_2 & input_file )
+{
+    return TOPASInputFile( input_file ).prm( keyword );
 }
 
 // ********************************************************************************
 
 CrystalLattice read_lattice_parameters( TextFileReader_2 & input_file )
 {
-    bool found( false );
-    size_t iLine( 0 );
-    std::vector< std::string > words;
-    while ( ( ! found ) && ( iLine != input_file.size() ) )
-    {
-        words = split_2( input_file.line( iLine ) );
-        if ( words.size() > 1 )
-        {
-            if ( words[0] == "a" )
-            {
-                if ( words[1] == "@" )
-                {
-                    if ( words.size() > 2 )
-                    {
-                        try
-                        {
-                            /* double dummy = */ TOPASstring2double( words[2] );
-                            found = true;
-                        }
-                        catch ( std::exception & e ) {}
-                    }
-                }
-                else
-                {
-                    try
-                    {
-                        /* double dummy = */ TOPASstring2double( words[1] );
-                        found = true;
-                    }
-                    catch ( std::exception & e ) {}
-                }
-            }
-        }
-        if ( ! found )
-            ++iLine;
-    }
-    // When we are here, either we are at the end of the file or we are at the line "a @ 8.743".
-    if ( ! found )
-        throw std::runtime_error( "read_lattice_parameters(): could not find lattice parameter a." );
-    // Assume that the following lines are a, b, c, al, be and ga
-    double a( 0.0 ); // Stupid initialisation to silence compiler warnings
-    double b( 0.0 ); // Stupid initialisation to silence compiler warnings
-    double c( 0.0 ); // Stupid initialisation to silence compiler warnings
-    double al( 0.0 ); // Stupid initialisation to silence compiler warnings
-    double be( 0.0 ); // Stupid initialisation to silence compiler warnings
-    double ga( 0.0 ); // Stupid initialisation to silence compiler warnings
-    found = false;
-    words = split_2( input_file.line( iLine ) );
-    if ( words.size() > 1 )
-    {
-        if ( words[0] == "a" )
-        {
-            if ( words[1] == "@" )
-            {
-                if ( words.size() > 2 )
-                {
-                    a = TOPASstring2double( words[2] );
-                    found = true;
-                }
-            }
-            else
-            {
-                a = TOPASstring2double( words[1] );
-                found = true;
-            }
-        }
-    }
-    if ( ! found )
-        throw std::runtime_error( "read_lattice_parameters(): could not find lattice parameter a." );
-    ++iLine;
-    found = false;
-    words = split_2( input_file.line( iLine ) );
-    if ( words.size() > 1 )
-    {
-        if ( words[0] == "b" )
-        {
-            if ( words[1] == "@" )
-            {
-                if ( words.size() > 2 )
-                {
-                    b = TOPASstring2double( words[2] );
-                    found = true;
-                }
-            }
-            else
-            {
-                b = TOPASstring2double( words[1] );
-                found = true;
-            }
-        }
-    }
-    if ( ! found )
-        throw std::runtime_error( "read_lattice_parameters(): could not find lattice parameter b." );
-    ++iLine;
-    found = false;
-    words = split_2( input_file.line( iLine ) );
-    if ( words.size() > 1 )
-    {
-        if ( words[0] == "c" )
-        {
-            if ( words[1] == "@" )
-            {
-                if ( words.size() > 2 )
-                {
-                    c = TOPASstring2double( words[2] );
-                    found = true;
-                }
-            }
-            else
-            {
-                c = TOPASstring2double( words[1] );
-                found = true;
-            }
-        }
-    }
-    if ( ! found )
-        throw std::runtime_error( "read_lattice_parameters(): could not find lattice parameter c." );
-    ++iLine;
-    found = false;
-    words = split_2( input_file.line( iLine ) );
-    if ( words.size() > 1 )
-    {
-        if ( words[0] == "al" )
-        {
-            if ( words[1] == "@" )
-            {
-                if ( words.size() > 2 )
-                {
-                    al = TOPASstring2double( words[2] );
-                    found = true;
-                }
-            }
-            else
-            {
-                al = TOPASstring2double( words[1] );
-                found = true;
-            }
-        }
-    }
-    if ( ! found )
-        throw std::runtime_error( "read_lattice_parameters(): could not find lattice parameter al." );
-    ++iLine;
-    found = false;
-    words = split_2( input_file.line( iLine ) );
-    if ( words.size() > 1 )
-    {
-        if ( words[0] == "be" )
-        {
-            if ( words[1] == "@" )
-            {
-                if ( words.size() > 2 )
-                {
-                    be = TOPASstring2double( words[2] );
-                    found = true;
-                }
-            }
-            else
-            {
-                be = TOPASstring2double( words[1] );
-                found = true;
-            }
-        }
-    }
-    if ( ! found )
-        throw std::runtime_error( "read_lattice_parameters(): could not find lattice parameter be." );
-    ++iLine;
-    found = false;
-    words = split_2( input_file.line( iLine ) );
-    if ( words.size() > 1 )
+    return read_lattice_parameters( TOPASInputFile( input_file ) );
+}
+
+// ********************************************************************************
+
+CrystalLattice read_lattice_parameters( const TOPASInputFile & input_file )
+{
+    const char * names[] = { "a", "b", "c", "al", "be", "ga" };
+    const std::vector< TOPASInputFile::Position > & candidates = input_file.find( "a" );
+    for ( size_t i( 0 ); i != candidates.size(); ++i )
     {
-        if ( words[0] == "ga" )
+        const size_t iLine = candidates[i].line_;
+        if ( ( candidates[i].token_ != 0 ) || ( iLine + 6 > input_file.size() ) )
+            continue;
+        double values[6];
+        bool found( true );
+        for ( size_t j( 0 ); found && ( j != 6 ); ++j )
         {
-            if ( words[1] == "@" )
-            {
-                if ( words.size() > 2 )
-                {
-                    ga = TOPASstring2double( words[2] );
-                    found = true;
-                }
-            }
-            else
+            const size_t jLine = iLine + j;
+            found = false;
+            if ( ( input_file.ntokens( jLine ) < 2 ) || ( input_file.token( jLine, 0 ) != names[j] ) )
+                break;
+            const size_t iValue = ( input_file.token( jLine, 1 ) == "@" ) ? 2 : 1;
+            if ( iValue >= input_file.ntokens( jLine ) )
+                break;
+            try
             {
-                ga = TOPASstring2double( words[1] );
+                values[j] = TOPASstring2double( input_file.token( jLine, iValue ) );
                 found = true;
             }
+            catch ( std::exception & e ) {}
         }
+        if ( found )
+            return CrystalLattice( values[0], values[1], values[2],
+                                   Angle::from_degrees( values[3] ),
+                                   Angle::from_degrees( values[4] ),
+                                   Angle::from_degrees( values[5] ) );
     }
-    if ( ! found )
-        throw std::runtime_error( "read_lattice_parameters(): could not find lattice parameter ga." );
-    return CrystalLattice( a, b, c,
-                           Angle::from_degrees( al ),
-                           Angle::from_degrees( be ),
-                           Angle::from_degrees( ga ) );
+    throw std::runtime_error( "read_lattice_parameters(): could not find lattice parameters." );
 }
 
 // ********************************************************************************
 
 // Understands "118.34201`_0.68292", "118.34201`" and "118.34201".
-double TOPASstring2double( std::string input )
+double TOPASstring2double( const std::string_view input )
 {
-    size_t iPos = input.find_first_of( "_" );
+    std::string_view value = input;
+    const size_t iPos = input.find( '_' );
     // Check that the string is formatted properly
-    if ( iPos != std::string::npos )
+    if ( iPos != std::string_view::npos )
     {
-        /*double dummy =*/ string2double_2( input.substr( iPos+1 ), true );
-        input.erase( iPos );
-        if ( input.size() == 0 )
-            throw std::runtime_error( "TOPASstring2double(): no number before ESD :  >" + input + "<" );
-        if ( input[input.length()-1] != '`' )
-            throw std::runtime_error( "TOPASstring2double(): no '' after number with ESD :  >" + input + "<" );
+        const std::string_view esd = input.substr( iPos + 1 );
+        /*double dummy =*/ string2double_2( esd.data(), esd.data() + esd.size(), true );
+        value = input.substr( 0, iPos );
+        if ( value.empty() )
+            throw std::runtime_error( "TOPASstring2double(): no number before ESD :  >" + std::string( input ) + "<" );
+        if ( value.back() != '`' )
+            throw std::runtime_error( "TOPASstring2double(): no '' after number with ESD :  >" + std::string( input ) + "<" );
     }
-    if ( input.size() == 0 )
-        throw std::runtime_error( "TOPASstring2double(): empty number : " + input );
-    if ( input[input.length()-1] == '`' )
-        input.erase( input.length()-1 );
-    return string2double_2( input, true );
+    if ( value.empty() )
+        throw std::runtime_error( "TOPASstring2double(): empty number : " + std::string( input ) );
+    if ( value.back() == '`' )
+        value.remove_suffix( 1 );
+    return string2double_2( value.data(), value.data() + value.size(), true );
 }
 
 // ********************************************************************************
@@ -29,18 +29,88 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 class CrystalLattice;
+class FileName;
 class TextFileReader_2;
 
+#include <map>
 #include <string>
+#include <string_view>
+#include <vector>
 
 std::string insert_at_sign( std::string input );
 
+/*
+  A TOPAS .inp file, tokenised in one pass.
+
+  Everything after a "'" is a comment and is not tokenised. Tokens are separated by spaces and tabs.
+  The index maps every token to all of its occurrences, so looking up a keyword does not scan the file.
+  "prm name value" and "prm !name value" lines are also indexed by the name of the parameter;
+  if a name occurs more than once, the fixed ("!") one is used, otherwise the first one.
+
+  Values can be rewritten in place, the rest of the line (including spacing and comments) is left intact.
+*/
+class TOPASInputFile
+{
+public:
+
+    struct Position
+    {
+        Position( const size_t line, const size_t token ): line_(line), token_(token) {}
+        size_t line_;
+        size_t token_;
+    };
+
+    explicit TOPASInputFile( const FileName & file_name );
+
+    explicit TOPASInputFile( const TextFileReader_2 & input_file );
+
+    size_t size() const { return lines_.size(); }
+
+    // The line as it would be written, including comments.
+    const std::string & line( const size_t i ) const { return lines_[i]; }
+
+    size_t ntokens( const size_t i ) const { return token_starts_[i].size(); }
+    std::string token( const size_t i, const size_t j ) const { return lines_[i].substr( token_starts_[i][j], token_lengths_[i][j] ); }
+
+    // All occurrences of keyword as a whole token, in the order in which they occur in the file. Empty if not found.
+    const std::vector< Position > & find( const std::string & keyword ) const;
+
+    bool has_prm( const std::string & name ) const { return prms_.find( name ) != prms_.end(); }
+
+    // Throws if the parameter is not present.
+    double prm( const std::string & name ) const;
+
+    // Replaces the value of the parameter.
+    void set_prm( const std::string & name, const double value );
+
+    // Replaces a single token.
+    void set_token( const Position position, const std::string & new_value );
+
+    void save( const FileName & file_name ) const;
+
+private:
+    std::vector< std::string > lines_;
+    std::vector< std::vector< size_t > > token_starts_;
+    std::vector< std::vector< size_t > > token_lengths_;
+    std::map< std::string, std::vector< Position > > keywords_;
+    std::map< std::string, Position > prms_; // Position of the value
+
+    void add_line( const std::string & line );
+};
+
+// Not allowed: "prm!a 1", "prm ! a 1", it must be "prm !a 1" or "prm a 1"
+// Tokenises the whole file, so for more than one keyword, construct a TOPASInputFile once.
 double read_keyword( const std::string & keyword, TextFileReader_2 & input_file );
 
+inline double read_keyword( const std::string & keyword, const TOPASInputFile & input_file ) { return input_file.prm( keyword ); }
+
 CrystalLattice read_lattice_parameters( TextFileReader_2 & input_file );
 
-// Understands "118.34201`_0.68292", "118.34201`" and "118.34201".
-double TOPASstring2double( std::string input );
+// Finds the first line starting with "a" or "a @" followed by a value, the following lines must be b, c, al, be and ga.
+CrystalLattice read_lattice_parameters( const TOPASInputFile & input_file );
+
+// Understands "118.34201`_0.68292", "118.34201`" and "118.34201". The ESD is checked but not returned.
+double TOPASstring2double( const std::string_view input );
 
 #endif // TOPAS_H
 
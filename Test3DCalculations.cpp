@@ -27,12 +27,23 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "TestSuite.h"
 #include "3DCalculations.h"
+#include "Angle.h"
 #include "AnisotropicDisplacementParameters.h"
+#include "CollectionOfPoints.h"
 #include "CrystalLattice.h"
 #include "Eigenvalue.h"
+#include "MathConstants.h"
+#include "MillerIndices.h"
 #include "NormalisedVector3D.h"
+#include "Plane.h"
+#include "SymmetricMatrix3D.h"
+#include "Utilities.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <vector>
 
 void test_3D_calculations( TestSuite & test_suite )
 {
@@ -50,6 +61,53 @@ void test_3D_calculations( TestSuite & test_suite )
         test_suite.test_equality_double( eigenvectors[0].value(2),  0.735874, "calculate_eigenvalues() vector 2" );
     }
 
+    {
+        // The closed-form solver against tred2() and tql2(), the eigenvectors are only determined up to their sign
+        std::vector< SymmetricMatrix3D > matrices;
+        matrices.push_back( SymmetricMatrix3D( 0.01038, 0.01333, 0.01294, -0.00184, 0.00248, -0.00623 ) );
+        for ( size_t i( 1 ); i != 50; ++i )
+            matrices.push_back( SymmetricMatrix3D( 0.02 + 0.01 * sin( 1.0 * i ), 0.03 + 0.01 * sin( 2.0 * i ), 0.025 + 0.01 * sin( 3.0 * i ),
+                                                   0.005 * sin( 4.0 * i ), 0.005 * sin( 5.0 * i ), 0.005 * sin( 6.0 * i ) ) );
+        // Degenerate: these must go to the fall-back
+        matrices.push_back( SymmetricMatrix3D( 0.02 ) );
+        matrices.push_back( SymmetricMatrix3D( 0.02, 0.02, 0.03, 0.0, 0.0, 0.0 ) );
+        matrices.push_back( SymmetricMatrix3D( 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 ) );
+        std::vector< double > batch_eigenvalues;
+        std::vector< double > batch_eigenvectors;
+        const size_t nfallbacks = calculate_eigenvalues( matrices, batch_eigenvalues, batch_eigenvectors );
+        test_suite.test_equality( nfallbacks, size_t( 3 ), "calculate_eigenvalues() batched fall-back" );
+        const size_t n = matrices.size();
+        bool values_equal( true );
+        bool vectors_equal( true );
+        bool batch_equal( true );
+        for ( size_t i( 0 ); i != n; ++i )
+        {
+            std::vector< double > eigenvalues;
+            std::vector< NormalisedVector3D > eigenvectors;
+            calculate_eigenvalues( matrices[i], eigenvalues, eigenvectors );
+            std::vector< double > analytical_eigenvalues;
+            std::vector< NormalisedVector3D > analytical_eigenvectors;
+            calculate_eigenvalues_analytical( matrices[i], analytical_eigenvalues, analytical_eigenvectors );
+            for ( size_t k( 0 ); k != 3; ++k )
+            {
+                if ( fabs( eigenvalues[k] - analytical_eigenvalues[k] ) > 1.0E-12 )
+                    values_equal = false;
+                if ( fabs( eigenvalues[k] - batch_eigenvalues[ k * n + i ] ) > 1.0E-12 )
+                    batch_equal = false;
+                if ( fabs( fabs( eigenvectors[k] * analytical_eigenvectors[k] ) - 1.0 ) > 1.0E-9 )
+                    vectors_equal = false;
+                double dot( 0.0 );
+                for ( size_t j( 0 ); j != 3; ++j )
+                    dot += analytical_eigenvectors[k].value( j ) * batch_eigenvectors[ ( 3 * k + j ) * n + i ];
+                if ( fabs( fabs( dot ) - 1.0 ) > 1.0E-9 )
+                    batch_equal = false;
+            }
+        }
+        test_suite.test_equality( values_equal, true, "calculate_eigenvalues_analytical() values" );
+        test_suite.test_equality( vectors_equal, true, "calculate_eigenvalues_analytical() vectors" );
+        test_suite.test_equality( batch_equal, true, "calculate_eigenvalues() batched" );
+    }
+
     {
         SymmetricMatrix3D U_cif( 0.04682, 0.02399, 0.05938, 0.00258, -0.00735, -0.00165 );
 
@@ -73,5 +131,88 @@ void test_3D_calculations( TestSuite & test_suite )
         test_suite.test_equality_double( U_cif_new.value( 1, 2 ), -0.00165, "transform_adps() element 1 2", 0.00001 );
     }
 
+    {
+        // A slightly puckered ring far from the origin, the moments are relative to the first point so there is no cancellation
+        std::vector< Vector3D > points;
+        for ( size_t i( 0 ); i != 6; ++i )
+            points.push_back( Vector3D( 1000.0 + 1.4 * cos( 1.0472 * i ), -500.0 + 1.4 * sin( 1.0472 * i ), 250.0 + ( ( i % 2 == 0 ) ? 0.2 : -0.2 ) ) );
+        const PointMoments point_moments( points );
+        Vector3D centroid;
+        for ( size_t i( 0 ); i != points.size(); ++i )
+            centroid += points[i];
+        centroid /= static_cast<double>( points.size() );
+        test_suite.test_equality_double( ( point_moments.centroid() - centroid ).length(), 0.0, "PointMoments::centroid()" );
+        SymmetricMatrix3D covariance( 0.0 );
+        for ( size_t i( 0 ); i != points.size(); ++i )
+        {
+            const Vector3D d = points[i] - centroid;
+            for ( size_t j( 0 ); j != 3; ++j )
+            {
+                for ( size_t k( j ); k != 3; ++k )
+                    covariance.set_value( j, k, covariance.value( j, k ) + d.value( j ) * d.value( k ) / points.size() );
+            }
+        }
+        double largest_difference( 0.0 );
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            for ( size_t k( 0 ); k != 3; ++k )
+                largest_difference = std::max( largest_difference, std::abs( point_moments.covariance_matrix().value( j, k ) - covariance.value( j, k ) ) );
+        }
+        test_suite.test_equality_double( largest_difference, 0.0, "PointMoments::covariance_matrix()", 1.0E-9 );
+        Plane plane;
+        double rmsd;
+        point_moments.best_plane( plane, rmsd );
+        test_suite.test_equality_double( std::abs( plane.normal().z() ), 1.0, "PointMoments::best_plane() normal" );
+        test_suite.test_equality_double( rmsd, 0.2, "PointMoments::best_plane() RMSD 1" );
+        test_suite.test_equality_double( rmsd, root_mean_square_devation_from_mean_plane( points, plane ), "PointMoments::best_plane() RMSD 2" );
+        test_suite.test_equality_double( point_moments.root_mean_square_deviation_from_best_plane(), rmsd, "PointMoments::root_mean_square_deviation_from_best_plane()" );
+        // CollectionOfPoints keeps the moments up to date as points are added
+        CollectionOfPoints collection_of_points;
+        collection_of_points.add_point( points[0] );
+        test_suite.test_equality_double( collection_of_points.point_wrt_com( 0 ).length(), 0.0, "CollectionOfPoints::point_wrt_com() 1" );
+        for ( size_t i( 1 ); i != points.size(); ++i )
+            collection_of_points.add_point( points[i] );
+        test_suite.test_equality_double( ( collection_of_points.average() - centroid ).length(), 0.0, "CollectionOfPoints::average()" );
+        test_suite.test_equality_double( ( collection_of_points.point_wrt_com( 3 ) - ( points[3] - centroid ) ).length(), 0.0, "CollectionOfPoints::point_wrt_com() 2" );
+        test_suite.test_equality_double( collection_of_points.moments().root_mean_square_deviation_from_best_plane(), 0.2, "CollectionOfPoints::moments()" );
+        test_suite.test_equality_double( root_mean_square_devation_from_mean_plane( collection_of_points, plane ), 0.2, "root_mean_square_devation_from_mean_plane()" );
+    }
+
+    {
+        // ReciprocalBasis and the batch kernels against reciprocal_lattice_point()
+        const CrystalLattice crystal_lattice( 7.1, 9.3, 11.7, Angle::from_degrees( 84.0 ), Angle::from_degrees( 103.4 ), Angle::from_degrees( 96.5 ) );
+        const ReciprocalBasis reciprocal_basis( crystal_lattice );
+        const MillerIndices miller_indices( 3, -2, 5 );
+        test_suite.test_equality_double( ( reciprocal_basis.point( miller_indices ) - reciprocal_lattice_point( miller_indices, crystal_lattice ) ).length(), 0.0, "ReciprocalBasis::point()", 1.0E-12 );
+        test_suite.test_equality_double( reciprocal_basis.length2( 3, -2, 5 ), reciprocal_lattice_point( miller_indices, crystal_lattice ).norm2(), "ReciprocalBasis::length2()" );
+        std::vector< double > row( 9 );
+        reciprocal_basis.lengths2( -1, 4, -4, row.size(), &row[0] );
+        bool row_is_correct( true );
+        for ( size_t i( 0 ); i != row.size(); ++i )
+            row_is_correct = row_is_correct && nearly_equal( row[i], reciprocal_lattice_point( MillerIndices( -1, 4, -4 + static_cast< int >( i ) ), crystal_lattice ).norm2(), 1.0E-12 );
+        test_suite.test_equality( row_is_correct, true, "ReciprocalBasis::lengths2()" );
+        int h;
+        int k;
+        int l;
+        unpack_miller_indices( packed_miller_indices( MillerIndices( -1048575, 0, 1048575 ) ), h, k, l );
+        test_suite.test_equality( ( h == -1048575 ) && ( k == 0 ) && ( l == 1048575 ), true, "unpack_miller_indices()" );
+        const MillerIndices reflections[3] = { MillerIndices( 1, 0, 0 ), MillerIndices( -2, 3, 1 ), MillerIndices( 20, -20, 20 ) };
+        std::vector< std::uint64_t > packed_hkl;
+        for ( size_t i( 0 ); i != 3; ++i )
+            packed_hkl.push_back( packed_miller_indices( reflections[i] ) );
+        std::vector< double > lengths2( 3 );
+        std::vector< double > d_spacings( 3 );
+        std::vector< double > two_thetas( 3 );
+        const double wavelength( 1.54056 );
+        d_spacings_and_two_thetas( reciprocal_basis, &packed_hkl[0], 3, wavelength, &lengths2[0], &d_spacings[0], &two_thetas[0] );
+        for ( size_t i( 0 ); i != 2; ++i )
+        {
+            const double d = 1.0 / reciprocal_lattice_point( reflections[i], crystal_lattice ).length();
+            test_suite.test_equality_double( d_spacings[i], d, "d_spacings_and_two_thetas() d " + reflections[i].to_string() );
+            test_suite.test_equality_double( two_thetas[i], 2.0 * std::asin( wavelength / ( 2.0 * d ) ) * 180.0 / CONSTANT_PI, "d_spacings_and_two_thetas() 2theta " + reflections[i].to_string() );
+        }
+        test_suite.test_equality_double( two_thetas[2], -1.0, "d_spacings_and_two_thetas() wavelength > 2d" );
+    }
+
 }
 
@@ -0,0 +1,149 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "AnalyseRings.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "MathConstants.h"
+#include "Utilities.h"
+#include "Vector3D.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// A ring with the given puckering, numbered clockwise when viewed from the side the Cremer-Pople normal points to.
+void puckered_ring( const size_t n, const double q2, const Angle phi2, const double q3, Vector3D * points )
+{
+    const double radius = 1.4;
+    for ( size_t j( 0 ); j != n; ++j )
+    {
+        const double angle = -2.0 * CONSTANT_PI * j / n;
+        double z = sqrt( 2.0 / n ) * q2 * cos( phi2.value_in_radians() + 4.0 * CONSTANT_PI * j / n );
+        if ( n == 6 )
+            z += sqrt( 1.0 / 6.0 ) * q3 * ( ( j % 2 == 0 ) ? 1.0 : -1.0 );
+        points[j] = Vector3D( radius * cos( angle ), radius * sin( angle ), z );
+    }
+}
+
+// A chair cyclohexane and a planar cyclopentane in a large P1 cell, origin is the centre of the first ring in Cartesian coordinates.
+CrystalStructure two_rings( const Vector3D & origin )
+{
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 20.0, 20.0, 20.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    for ( size_t j( 0 ); j != 6; ++j )
+    {
+        const double angle = 2.0 * CONSTANT_PI * j / 6.0;
+        const Vector3D position = origin + Vector3D( 1.456 * cos( angle ), 1.456 * sin( angle ), ( j % 2 == 0 ) ? 0.25 : -0.25 );
+        crystal_structure.add_atom( Atom( Element( "C" ), position / 20.0, "C" + size_t2string( j + 1 ) ) );
+    }
+    for ( size_t j( 0 ); j != 5; ++j )
+    {
+        const double angle = 2.0 * CONSTANT_PI * j / 5.0;
+        const Vector3D position = Vector3D( 10.0, 10.0, 10.0 ) + Vector3D( 1.31 * cos( angle ), 1.31 * sin( angle ), 0.0 );
+        crystal_structure.add_atom( Atom( Element( "C" ), position / 20.0, "C" + size_t2string( j + 7 ) ) );
+    }
+    return crystal_structure;
+}
+
+} // namespace
+
+void test_analyse_rings( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for AnalyseRings." << std::endl;
+    {
+    Vector3D points[6];
+    puckered_ring( 6, 0.3, Angle::from_degrees( 100.0 ), 0.4, points );
+    RingPuckering ring_puckering = Cremer_Pople( points, 6 );
+    test_suite.test_equality_double( ring_puckering.q2_, 0.3, "Cremer_Pople() 01" );
+    test_suite.test_equality_double( ring_puckering.phi2_.value_in_degrees(), 100.0, "Cremer_Pople() 02" );
+    test_suite.test_equality_double( ring_puckering.q3_, 0.4, "Cremer_Pople() 03" );
+    test_suite.test_equality_double( ring_puckering.Q_, 0.5, "Cremer_Pople() 04" );
+    test_suite.test_equality_double( ring_puckering.theta_.value_in_degrees(), atan2( 0.3, 0.4 ) * 180.0 / CONSTANT_PI, "Cremer_Pople() 05" );
+    puckered_ring( 6, 0.0, Angle(), 0.6, points );
+    test_suite.test_equality( Cremer_Pople( points, 6 ).conformation(), std::string( "chair" ), "RingPuckering::conformation() 01" );
+    puckered_ring( 6, 0.7, Angle::from_degrees( 120.0 ), 0.0, points );
+    test_suite.test_equality( Cremer_Pople( points, 6 ).conformation(), std::string( "boat" ), "RingPuckering::conformation() 02" );
+    puckered_ring( 6, 0.7, Angle::from_degrees( 90.0 ), 0.0, points );
+    test_suite.test_equality( Cremer_Pople( points, 6 ).conformation(), std::string( "twist-boat" ), "RingPuckering::conformation() 03" );
+    puckered_ring( 5, 0.4, Angle::from_degrees( 252.0 ), 0.0, points );
+    ring_puckering = Cremer_Pople( points, 5 );
+    test_suite.test_equality_double( ring_puckering.q2_, 0.4, "Cremer_Pople() 06" );
+    test_suite.test_equality_double( ring_puckering.phi2_.value_in_degrees(), 252.0, "Cremer_Pople() 07" );
+    test_suite.test_equality( ring_puckering.conformation(), std::string( "envelope" ), "RingPuckering::conformation() 04" );
+    puckered_ring( 5, 0.4, Angle::from_degrees( 270.0 ), 0.0, points );
+    test_suite.test_equality( Cremer_Pople( points, 5 ).conformation(), std::string( "twist" ), "RingPuckering::conformation() 05" );
+    }
+    {
+    // The cyclohexane straddles the cell corner
+    CrystalStructure crystal_structure = two_rings( Vector3D( 0.5, 0.5, 0.0 ) );
+    crystal_structure.perceive_molecules();
+    const std::vector< std::vector< size_t > > rings = find_five_and_six_membered_rings( crystal_structure );
+    test_suite.test_equality( rings.size(), size_t( 2 ), "find_five_and_six_membered_rings() 01" );
+    for ( size_t i( 0 ); i != rings.size(); ++i )
+    {
+        Vector3D points[6];
+        ring_coordinates( crystal_structure, rings[i], points );
+        const RingPuckering ring_puckering = Cremer_Pople( points, rings[i].size() );
+        test_suite.test_equality( ring_puckering.conformation(), std::string( ( rings[i].size() == 6 ) ? "chair" : "planar" ), "ring_coordinates() " + size_t2string( i + 1 ) );
+    }
+    }
+    {
+    std::vector< FileName > file_names;
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        file_names.push_back( FileName( "", "test_analyse_rings_" + size_t2string( i ), "cif" ) );
+        two_rings( Vector3D( 2.0 + i, 2.0, 2.0 ) ).save_cif( file_names.back() );
+    }
+    const FileList file_list( file_names );
+    const std::vector< RingConformation > serial = analyse_ring_conformations( file_list, 1 );
+    const std::vector< RingConformation > parallel = analyse_ring_conformations( file_list, 3 );
+    test_suite.test_equality( serial.size(), size_t( 6 ), "analyse_ring_conformations() 01" );
+    test_suite.test_equality( parallel.size(), serial.size(), "analyse_ring_conformations() 02" );
+    bool same( true );
+    for ( size_t i( 0 ); i != std::min( serial.size(), parallel.size() ); ++i )
+    {
+        if ( ( serial[i].file_index_ != parallel[i].file_index_ ) || ( serial[i].labels_ != parallel[i].labels_ ) ||
+             ( std::abs( serial[i].puckering_.Q_ - parallel[i].puckering_.Q_ ) > 1.0E-12 ) )
+            same = false;
+        if ( serial[i].file_index_ != i / 2 )
+            same = false;
+    }
+    test_suite.test_equality( same, true, "analyse_ring_conformations() 03" );
+    for ( size_t i( 0 ); i != file_names.size(); ++i )
+        std::remove( file_names[i].full_name().c_str() );
+    }
+}
+
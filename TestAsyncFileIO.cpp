@@ -0,0 +1,175 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "AsyncFileIO.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "ReadCif.h"
+#include "TextFileReader.h"
+#include "TextFileReader_2.h"
+#include "Utilities.h"
+
+#include "TestFixtures.h"
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+void test_async_file_IO( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for AsyncFileIO." << std::endl;
+    const std::string directory( "test_async_file_IO" );
+    mkdir( directory.c_str(), 0755 );
+    const size_t nfiles( 20 );
+    FileList file_list;
+    {
+    BackgroundFileWriter background_file_writer( 4 );
+    for ( size_t i( 0 ); i != nfiles; ++i )
+    {
+        std::string contents;
+        for ( size_t j( 0 ); j != i; ++j )
+            contents += "line " + size_t2string( j ) + "\r\n";
+        const FileName file_name( directory, "file_" + size_t2string( i ), "txt" );
+        background_file_writer.write( file_name, contents );
+        file_list.push_back( file_name );
+    }
+    background_file_writer.wait();
+    }
+    {
+    // Prefetched in order, also with fewer files ahead than there are threads
+    FilePrefetcher file_prefetcher( file_list, 3, 5 );
+    test_suite.test_equality( file_prefetcher.size(), nfiles, "FilePrefetcher::size()" );
+    FileName file_name;
+    std::vector< char > contents;
+    bool are_equal( true );
+    size_t i( 0 );
+    while ( file_prefetcher.next( file_name, contents ) )
+    {
+        are_equal = are_equal && ( file_name.full_name() == file_list.value( i ).full_name() );
+        TextFileReader_2 text_file_reader_2;
+        text_file_reader_2.read_buffer( contents );
+        are_equal = are_equal && ( text_file_reader_2.size() == i );
+        if ( i != 0 )
+            are_equal = are_equal && ( text_file_reader_2.line( i - 1 ) == "line " + size_t2string( i - 1 ) );
+        ++i;
+    }
+    test_suite.test_equality( i, nfiles, "FilePrefetcher::next() 01" );
+    if ( ! are_equal )
+        test_suite.log_error( "FilePrefetcher::next() 02" );
+    }
+    {
+    // TextFileReader over a buffer gives the same lines as over the file
+    std::vector< char > contents;
+    read_whole_file( file_list.value( 5 ), contents );
+    TextFileReader text_file_reader_1( file_list.value( 5 ) );
+    TextFileReader text_file_reader_2( contents );
+    std::string line_1;
+    std::string line_2;
+    bool are_equal( true );
+    size_t nlines( 0 );
+    while ( text_file_reader_1.get_next_line( line_1 ) )
+    {
+        are_equal = are_equal && text_file_reader_2.get_next_line( line_2 ) && ( line_1 == line_2 );
+        ++nlines;
+    }
+    are_equal = are_equal && ( ! text_file_reader_2.get_next_line( line_2 ) );
+    test_suite.test_equality( nlines, size_t( 5 ), "TextFileReader( std::vector< char > ) 01" );
+    if ( ! are_equal )
+        test_suite.log_error( "TextFileReader( std::vector< char > ) 02" );
+    }
+    {
+    // A missing file is reported when it is taken, the files after it are still read
+    FileList file_list_2;
+    file_list_2.push_back( file_list.value( 1 ) );
+    file_list_2.push_back( FileName( directory, "does_not_exist", "txt" ) );
+    file_list_2.push_back( file_list.value( 2 ) );
+    FilePrefetcher file_prefetcher( file_list_2, 2, 2 );
+    FileName file_name;
+    std::vector< char > contents;
+    test_suite.test_equality( file_prefetcher.next( file_name, contents ), true, "FilePrefetcher::next() 03" );
+    bool has_thrown( false );
+    try
+    {
+        file_prefetcher.next( file_name, contents );
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "FilePrefetcher::next() 04" );
+    test_suite.test_equality( file_name.file_name(), std::string( "does_not_exist" ), "FilePrefetcher::next() 05" );
+    test_suite.test_equality( file_prefetcher.next( file_name, contents ), true, "FilePrefetcher::next() 06" );
+    test_suite.test_equality( contents.size(), size_t( 16 ), "FilePrefetcher::next() 07" );
+    test_suite.test_equality( file_prefetcher.next( file_name, contents ), false, "FilePrefetcher::next() 08" );
+    }
+    {
+    // A prefetcher that is destroyed before all files have been taken
+    FilePrefetcher file_prefetcher( file_list, 2, 2 );
+    FileName file_name;
+    std::vector< char > contents;
+    file_prefetcher.next( file_name, contents );
+    }
+    {
+    // read_cif() over a buffer
+    const CrystalStructure crystal_structure = P21c_test_asymmetric_unit( CrystalLattice( 7.1, 9.3, 11.7, Angle::angle_90_degrees(), Angle::from_degrees( 103.4 ), Angle::angle_90_degrees() ) );
+    const FileName cif_file_name( directory, "structure", "cif" );
+    crystal_structure.save_cif( cif_file_name );
+    std::vector< char > contents;
+    read_whole_file( cif_file_name, contents );
+    CrystalStructure crystal_structure_2;
+    read_cif( contents, crystal_structure_2 );
+    test_suite.test_equality( crystal_structure_2.natoms(), crystal_structure.natoms(), "read_cif( std::vector< char > ) 01" );
+    test_suite.test_equality( crystal_structure_2.atom( 1 ).label(), crystal_structure.atom( 1 ).label(), "read_cif( std::vector< char > ) 02" );
+    test_suite.test_equality( nearly_equal( crystal_structure_2.crystal_lattice().b(), crystal_structure.crystal_lattice().b() ), true, "read_cif( std::vector< char > ) 03" );
+    std::remove( cif_file_name.full_name().c_str() );
+    }
+    {
+    // Errors are reported by wait()
+    BackgroundFileWriter background_file_writer;
+    background_file_writer.write( FileName( directory + "/no_such_directory", "file", "txt" ), "text" );
+    bool has_thrown( false );
+    try
+    {
+        background_file_writer.wait();
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "BackgroundFileWriter::wait()" );
+    }
+    for ( size_t i( 0 ); i != nfiles; ++i )
+        std::remove( file_list.value( i ).full_name().c_str() );
+    rmdir( directory.c_str() );
+}
+
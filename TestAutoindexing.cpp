@@ -0,0 +1,149 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+
+#include "Autoindexing.h"
+#include "3DCalculations.h"
+#include "MillerIndices.h"
+#include "NiggliReduction.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// The 2theta values of the first npeaks distinct lines of a primitive lattice, each shifted by up to 0.005 degrees
+std::vector< Angle > peak_positions( const CrystalLattice & crystal_lattice, const double wavelength, const size_t npeaks )
+{
+    std::vector< double > two_thetas;
+    for ( int h( -8 ); h <= 8; ++h )
+    {
+        for ( int k( -8 ); k <= 8; ++k )
+        {
+            for ( int l( -8 ); l <= 8; ++l )
+            {
+                if ( ( h == 0 ) && ( k == 0 ) && ( l == 0 ) )
+                    continue;
+                const double sine_theta = wavelength * reciprocal_lattice_point( MillerIndices( h, k, l ), crystal_lattice ).length() / 2.0;
+                if ( sine_theta < 1.0 )
+                    two_thetas.push_back( 2.0 * std::asin( sine_theta ) * 180.0 / CONSTANT_PI );
+            }
+        }
+    }
+    std::sort( two_thetas.begin(), two_thetas.end() );
+    std::vector< Angle > result;
+    for ( size_t i( 0 ); ( i != two_thetas.size() ) && ( result.size() != npeaks ); ++i )
+    {
+        if ( ( i != 0 ) && ( two_thetas[i] - two_thetas[i-1] < 1.0E-6 ) )
+            continue;
+        const double shift = 0.005 * ( ( result.size() % 3 ) - 1.0 );
+        result.push_back( Angle::from_degrees( two_thetas[i] + shift ) );
+    }
+    return result;
+}
+
+} // namespace
+
+void test_autoindexing( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for Autoindexing." << std::endl;
+    const double wavelength = 1.54056;
+    {
+        const CrystalLattice crystal_lattice( 8.5, 8.5, 8.5, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+        Autoindexing autoindexing( peak_positions( crystal_lattice, wavelength, 20 ), wavelength );
+        const std::vector< IndexingSolution > solutions = autoindexing.index( CrystalLattice::CUBIC );
+        if ( solutions.empty() )
+            test_suite.log_error( "Autoindexing::index() cubic no solutions" );
+        else
+        {
+            test_suite.test_equality_double( solutions[0].crystal_lattice_.a(), 8.5, "Autoindexing::index() cubic a", 1.0E-3 );
+            test_suite.test_equality( solutions[0].crystal_lattice_.lattice_system(), CrystalLattice::CUBIC, "Autoindexing::index() cubic lattice system" );
+            test_suite.test_equality( solutions[0].nunindexed_, size_t( 0 ), "Autoindexing::index() cubic nunindexed" );
+        }
+        // The first line of a primitive cubic lattice is 100
+        const IndexingSolution solution = autoindexing.evaluate( crystal_lattice );
+        test_suite.test_equality( solution.nunindexed_, size_t( 0 ), "Autoindexing::evaluate() nunindexed" );
+        test_suite.test_equality( solution.miller_indices_[0].h() + solution.miller_indices_[0].k() + solution.miller_indices_[0].l(), 1, "Autoindexing::evaluate() Miller indices" );
+        if ( ! ( solution.M_ > 20.0 ) )
+            test_suite.log_error( "Autoindexing::evaluate() M20 too low" );
+        // Half the cell leaves peaks unindexed
+        const CrystalLattice half_lattice( 4.25, 4.25, 4.25, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+        if ( autoindexing.evaluate( half_lattice ).nunindexed_ == 0 )
+            test_suite.log_error( "Autoindexing::evaluate() half cell" );
+    }
+    {
+        // Tetragonal, searched in all lattice systems: the highest symmetry is kept
+        const CrystalLattice crystal_lattice( 6.3, 6.3, 9.4, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+        Autoindexing autoindexing( peak_positions( crystal_lattice, wavelength, 20 ), wavelength );
+        autoindexing.set_maximum_length( 12.0 );
+        autoindexing.set_maximum_volume( 1000.0 );
+        const std::vector< IndexingSolution > solutions = autoindexing.index();
+        if ( solutions.empty() )
+            test_suite.log_error( "Autoindexing::index() tetragonal no solutions" );
+        else
+        {
+            test_suite.test_equality( solutions[0].crystal_lattice_.lattice_system(), CrystalLattice::TETRAGONAL, "Autoindexing::index() tetragonal lattice system" );
+            test_suite.test_equality_double( solutions[0].crystal_lattice_.a(), 6.3, "Autoindexing::index() tetragonal a", 2.0E-3 );
+            test_suite.test_equality_double( solutions[0].crystal_lattice_.c(), 9.4, "Autoindexing::index() tetragonal c", 2.0E-3 );
+        }
+    }
+    {
+        const CrystalLattice crystal_lattice( 5.1, 7.3, 9.7, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+        Autoindexing autoindexing( peak_positions( crystal_lattice, wavelength, 20 ), wavelength );
+        autoindexing.set_maximum_length( 15.0 );
+        const std::vector< IndexingSolution > solutions = autoindexing.index( CrystalLattice::ORTHORHOMBIC );
+        if ( solutions.empty() )
+            test_suite.log_error( "Autoindexing::index() orthorhombic no solutions" );
+        else
+        {
+            test_suite.test_equality_double( solutions[0].crystal_lattice_.a(), 5.1, "Autoindexing::index() orthorhombic a", 2.0E-3 );
+            test_suite.test_equality_double( solutions[0].crystal_lattice_.b(), 7.3, "Autoindexing::index() orthorhombic b", 2.0E-3 );
+            test_suite.test_equality_double( solutions[0].crystal_lattice_.c(), 9.7, "Autoindexing::index() orthorhombic c", 2.0E-3 );
+        }
+    }
+    {
+        const CrystalLattice crystal_lattice( 6.2, 7.9, 9.1, Angle::angle_90_degrees(), Angle::from_degrees( 103.0 ), Angle::angle_90_degrees() );
+        Autoindexing autoindexing( peak_positions( crystal_lattice, wavelength, 20 ), wavelength );
+        autoindexing.set_maximum_length( 12.0 );
+        autoindexing.set_maximum_volume( 600.0 );
+        const std::vector< IndexingSolution > solutions = autoindexing.index( CrystalLattice::MONOCLINIC );
+        if ( solutions.empty() )
+            test_suite.log_error( "Autoindexing::index() monoclinic no solutions" );
+        else
+        {
+            if ( G6_distance( solutions[0].crystal_lattice_, crystal_lattice ) > 0.1 )
+                test_suite.log_error( "Autoindexing::index() monoclinic lattice" );
+            test_suite.test_equality_double( solutions[0].crystal_lattice_.volume(), crystal_lattice.volume(), "Autoindexing::index() monoclinic volume", 0.5 );
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "BagOfNumbers.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+void test_BagOfNumbers( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for BagOfNumbers." << std::endl;
+
+    {
+    BagOfNumbers bag_of_numbers( 100, 1359 );
+    std::vector< size_t > values = bag_of_numbers.draw( 10 );
+    test_suite.test_equality( bag_of_numbers.size(), size_t( 90 ), "BagOfNumbers::draw() 01" );
+    std::vector< size_t > rest = bag_of_numbers.draw_all();
+    test_suite.test_equality( bag_of_numbers.size(), size_t( 0 ), "BagOfNumbers::draw_all() 01" );
+    values.insert( values.end(), rest.begin(), rest.end() );
+    test_suite.test_equality( ( values != std::vector< size_t >( SetOfNumbers( 100 ).values() ) ), true, "BagOfNumbers::draw_all() 02" );
+    std::sort( values.begin(), values.end() );
+    test_suite.test_equality( ( values == SetOfNumbers( 100 ).values() ), true, "BagOfNumbers::draw_all() 03" );
+    try
+    {
+        bag_of_numbers.draw();
+        test_suite.log_error( "BagOfNumbers::draw() should have thrown." );
+    }
+    catch ( std::exception & e ) {}
+    }
+
+    {
+    // Duplicates are drawn as often as they are present
+    BagOfNumbers bag_of_numbers( 1359 );
+    for ( size_t i( 0 ); i != 18; ++i )
+        bag_of_numbers.add( 13 );
+    for ( size_t j( 1 ); j != 13; ++j )
+        bag_of_numbers.add( j );
+    std::vector< size_t > values = bag_of_numbers.draw_all();
+    test_suite.test_equality( static_cast<size_t>( std::count( values.begin(), values.end(), 13 ) ), size_t( 18 ), "BagOfNumbers::draw() 02" );
+    try
+    {
+        BagOfNumbers bag_of_numbers_2( 3, 1359 );
+        bag_of_numbers_2.draw( 4 );
+        test_suite.log_error( "BagOfNumbers::draw( n ) should have thrown." );
+    }
+    catch ( std::exception & e ) {}
+    }
+
+    {
+    // Every position is equally likely for every number
+    const size_t ntrials( 6000 );
+    std::vector< size_t > counts( 9, 0 );
+    BagOfNumbers bag_of_numbers( 42 );
+    for ( size_t i( 0 ); i != ntrials; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+            bag_of_numbers.add( j );
+        std::vector< size_t > values = bag_of_numbers.draw_all();
+        for ( size_t j( 0 ); j != 3; ++j )
+            ++counts[ 3 * j + values[j] ];
+    }
+    bool all_close( true );
+    for ( size_t i( 0 ); i != counts.size(); ++i )
+        all_close = all_close && ( counts[i] > 1800 ) && ( counts[i] < 2200 );
+    test_suite.test_equality( all_close, true, "BagOfNumbers::draw_all() 04" );
+    }
+
+}
+
@@ -0,0 +1,72 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Benchmark.h"
+#include "CrystalStructure.h"
+#include "RunBenchmarks.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+void test_benchmark( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for Benchmark." << std::endl;
+
+    {
+    size_t ncalls( 0 );
+    BenchmarkResult result = run_benchmark( "test", 5, [&]() { ++ncalls; }, 4, 3 );
+    test_suite.test_equality( ncalls, size_t( 7 ), "run_benchmark() 01" );
+    test_suite.test_equality( result.nrepetitions(), size_t( 4 ), "run_benchmark() 02" );
+    test_suite.test_equality( result.minimum() <= result.maximum(), true, "run_benchmark() 03" );
+    }
+    {
+    BenchmarkResult result;
+    result.name_ = "test";
+    result.size_ = 12;
+    result.nwarmups_ = 1;
+    result.timings_.push_back( 1.0 );
+    result.timings_.push_back( 2.0 );
+    result.timings_.push_back( 4.0 );
+    result.timings_.push_back( 9.0 );
+    test_suite.test_equality_double( result.median(), 3.0, "BenchmarkResult::median() 01" );
+    test_suite.test_equality_double( result.mean(), 4.0, "BenchmarkResult::mean()" );
+    test_suite.test_equality_double( result.standard_deviation(), std::sqrt( 38.0 / 3.0 ), "BenchmarkResult::standard_deviation()" );
+    test_suite.test_equality( result.to_JSON(), std::string( "{\"name\":\"test\",\"size\":12,\"nwarmups\":1,\"nrepetitions\":4,\"median\":3,\"mean\":4,\"standard_deviation\":3.55902608,\"minimum\":1,\"maximum\":9}" ), "BenchmarkResult::to_JSON()" );
+    result.timings_.pop_back();
+    test_suite.test_equality_double( result.median(), 2.0, "BenchmarkResult::median() 02" );
+    }
+    {
+    CrystalStructure crystal_structure = synthetic_molecular_crystal( 2 );
+    test_suite.test_equality( crystal_structure.natoms(), size_t( 96 ), "synthetic_molecular_crystal() 01" );
+    crystal_structure.perceive_molecules();
+    test_suite.test_equality( crystal_structure.nmolecules(), size_t( 8 ), "synthetic_molecular_crystal() 02" );
+    }
+}
+
@@ -0,0 +1,90 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "BondGraph.h"
+#include "ConnectivityTable.h"
+
+#include "TestSuite.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+void test_bond_graph( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for BondGraph." << std::endl;
+    {
+    std::vector< std::pair< size_t, size_t > > bonds;
+    bonds.push_back( std::make_pair( 3, 1 ) );
+    bonds.push_back( std::make_pair( 1, 3 ) ); // Duplicate
+    bonds.push_back( std::make_pair( 2, 2 ) ); // Self
+    bonds.push_back( std::make_pair( 0, 4 ) );
+    bonds.push_back( std::make_pair( 4, 5 ) );
+    BondGraph bond_graph( 7, bonds );
+    test_suite.test_equality( bond_graph.size(), size_t( 7 ), "BondGraph::size()" );
+    test_suite.test_equality( bond_graph.nbonds(), size_t( 3 ), "BondGraph::nbonds()" );
+    test_suite.test_equality( bond_graph.degree( 4 ), size_t( 2 ), "BondGraph::degree() 01" );
+    test_suite.test_equality( bond_graph.degree( 2 ), size_t( 0 ), "BondGraph::degree() 02" );
+    test_suite.test_equality( bond_graph.neighbour( 4, 0 ), size_t( 0 ), "BondGraph::neighbour() 01" );
+    test_suite.test_equality( bond_graph.neighbour( 4, 1 ), size_t( 5 ), "BondGraph::neighbour() 02" );
+    test_suite.test_equality( bond_graph.are_bonded( 1, 3 ), true, "BondGraph::are_bonded() 01" );
+    test_suite.test_equality( bond_graph.are_bonded( 3, 1 ), true, "BondGraph::are_bonded() 02" );
+    test_suite.test_equality( bond_graph.are_bonded( 1, 2 ), false, "BondGraph::are_bonded() 03" );
+    std::vector< std::vector< size_t > > molecules = split( bond_graph );
+    test_suite.test_equality( molecules.size(), size_t( 4 ), "split( BondGraph ) 01" );
+    test_suite.test_equality( molecules[0].size(), size_t( 3 ), "split( BondGraph ) 02" );
+    test_suite.test_equality( molecules[0][2], size_t( 5 ), "split( BondGraph ) 03" );
+    test_suite.test_equality( molecules[3][0], size_t( 6 ), "split( BondGraph ) 04" );
+    }
+    {
+    // Random sparse graphs must give exactly the same molecules as the dense connectivity table
+    srand( 4321 );
+    bool all_equal( true );
+    for ( size_t iTrial( 0 ); iTrial != 20; ++iTrial )
+    {
+        const size_t natoms = 1 + rand() % 150;
+        const size_t nbonds = rand() % ( natoms + 1 );
+        std::vector< std::pair< size_t, size_t > > bonds;
+        ConnectivityTable connectivity_table( natoms );
+        for ( size_t i( 0 ); i != nbonds; ++i )
+        {
+            size_t j = rand() % natoms;
+            size_t k = rand() % natoms;
+            bonds.push_back( std::make_pair( j, k ) );
+            connectivity_table.set_value( j, k, 1 );
+        }
+        if ( split( BondGraph( natoms, bonds ) ) != split( connectivity_table ) )
+            all_equal = false;
+        if ( split( BondGraph( connectivity_table ) ) != split( connectivity_table ) )
+            all_equal = false;
+    }
+    test_suite.test_equality( all_equal, true, "split( BondGraph ) 05" );
+    }
+}
+
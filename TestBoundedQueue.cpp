@@ -0,0 +1,85 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "BoundedQueue.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void test_bounded_queue( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for BoundedQueue." << std::endl;
+
+    {
+    BoundedQueue< int > queue( 2 );
+    test_suite.test_equality( queue.push( 1 ), true, "BoundedQueue::push() 01" );
+    test_suite.test_equality( queue.push( 2 ), true, "BoundedQueue::push() 02" );
+    queue.close();
+    test_suite.test_equality( queue.push( 3 ), false, "BoundedQueue::push() 03" );
+    int value( 0 );
+    test_suite.test_equality( queue.pop( value ), true, "BoundedQueue::pop() 01" );
+    test_suite.test_equality( value, 1, "BoundedQueue::pop() 02" );
+    test_suite.test_equality( queue.pop( value ), true, "BoundedQueue::pop() 03" );
+    test_suite.test_equality( value, 2, "BoundedQueue::pop() 04" );
+    test_suite.test_equality( queue.pop( value ), false, "BoundedQueue::pop() 05" );
+    }
+    {
+    // Several producers and consumers through a queue that is much smaller than the number of items.
+    BoundedQueue< size_t > queue( 3 );
+    const size_t nitems_per_producer( 1000 );
+    std::vector< size_t > sums( 3, 0 );
+    std::vector< std::thread > consumers;
+    for ( size_t t( 0 ); t != sums.size(); ++t )
+    {
+        consumers.push_back( std::thread( [&queue, &sums, t]()
+        {
+            size_t value;
+            while ( queue.pop( value ) )
+                sums[t] += value;
+        } ) );
+    }
+    std::vector< std::thread > producers;
+    for ( size_t t( 0 ); t != 2; ++t )
+    {
+        producers.push_back( std::thread( [&queue, nitems_per_producer]()
+        {
+            for ( size_t i( 1 ); i <= nitems_per_producer; ++i )
+                queue.push( i );
+        } ) );
+    }
+    for ( size_t t( 0 ); t != producers.size(); ++t )
+        producers[t].join();
+    queue.close();
+    for ( size_t t( 0 ); t != consumers.size(); ++t )
+        consumers[t].join();
+    test_suite.test_equality( sums[0] + sums[1] + sums[2], size_t( 2 * 500500 ), "BoundedQueue multithreaded" );
+    }
+}
+
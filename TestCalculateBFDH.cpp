@@ -26,6 +26,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "CalculateBFDH.h"
+#include "CrystalLattice.h"
+#include "SpaceGroup.h"
 
 #include "TestSuite.h"
 
@@ -34,11 +36,50 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 void test_CalculateBFDH( TestSuite & test_suite )
 {
     std::cout << "Now running tests for CalculateBFDH." << std::endl;
-
     {
- //   CalculateBFDH dummy();
- //   test_suite.test_equality( dummy, , "CalculateBFDH()" );
+    // Primitive cubic: a cube
+    CalculateBFDH BFDH( CrystalLattice( 10.0, 10.0, 10.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ), SpaceGroup() );
+    test_suite.test_equality( BFDH.nfaces(), size_t( 6 ), "CalculateBFDH::nfaces() cube" );
+    test_suite.test_equality( BFDH.miller_indices( 0 ).h() * BFDH.miller_indices( 0 ).h() +
+                              BFDH.miller_indices( 0 ).k() * BFDH.miller_indices( 0 ).k() +
+                              BFDH.miller_indices( 0 ).l() * BFDH.miller_indices( 0 ).l(), 1, "CalculateBFDH::miller_indices() cube" );
+    test_suite.test_equality_double( BFDH.d_spacing( 0 ), 10.0, "CalculateBFDH::d_spacing() cube" );
+    test_suite.test_equality_double( BFDH.face( 0 ).area(), 0.04, "CalculateBFDH::face() cube" );
+    test_suite.test_equality_double( BFDH.volume(), 0.008, "CalculateBFDH::volume() cube" );
+    }
+    {
+    // Body-centred cubic: (100) is absent in first order, which gives the rhombic dodecahedron of the {110} faces
+    CalculateBFDH BFDH( CrystalLattice( 10.0, 10.0, 10.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ), SpaceGroup::from_number( 229 ) );
+    test_suite.test_equality( BFDH.nfaces(), size_t( 12 ), "CalculateBFDH::nfaces() rhombic dodecahedron" );
+    bool all_110( true );
+    for ( size_t i( 0 ); i != BFDH.nfaces(); ++i )
+    {
+        const MillerIndices miller_indices = BFDH.miller_indices( i );
+        if ( miller_indices.h() * miller_indices.h() + miller_indices.k() * miller_indices.k() + miller_indices.l() * miller_indices.l() != 2 )
+            all_110 = false;
+    }
+    test_suite.test_equality( all_110, true, "CalculateBFDH::miller_indices() rhombic dodecahedron" );
+    // The three-fold vertices are at ( +-0.1, +-0.1, +-0.1 ), the volume is twice that of the cube they span
+    test_suite.test_equality_double( BFDH.volume(), 0.016, "CalculateBFDH::volume() rhombic dodecahedron" );
+    }
+    {
+    // P21/c: (001) is only present in second order because of the c glide
+    CalculateBFDH BFDH( CrystalLattice( 7.1, 9.3, 11.7, Angle::angle_90_degrees(), Angle::from_degrees( 103.4 ), Angle::angle_90_degrees() ), SpaceGroup::P21c() );
+    bool found( false );
+    for ( size_t i( 0 ); i != BFDH.nfaces(); ++i )
+    {
+        if ( BFDH.miller_indices( i ) == MillerIndices( 0, 0, 1 ) )
+        {
+            found = true;
+            test_suite.test_equality_double( BFDH.d_spacing( i ), 11.7 * Angle::from_degrees( 103.4 ).sine() / 2.0, "CalculateBFDH::d_spacing() Donnay-Harker" );
+        }
+    }
+    test_suite.test_equality( found, true, "CalculateBFDH() (001)" );
+    // The habit is closed: the vector sum of the face normals weighted by their areas is zero
+    Vector3D sum;
+    for ( size_t i( 0 ); i != BFDH.nfaces(); ++i )
+        sum += BFDH.face( i ).n();
+    test_suite.test_equality_double( sum.length(), 0.0, "CalculateBFDH() closed habit", 1.0E-10 );
     }
-
 }
 
@@ -0,0 +1,103 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "CellList.h"
+#include "CrystalLattice.h"
+#include "Vector3D.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+double random_fraction()
+{
+    return static_cast< double >( rand() ) / static_cast< double >( RAND_MAX );
+}
+
+// Checks that every pair within cutoff, as found by brute force, is among the candidates.
+size_t count_missed_pairs( const CrystalLattice & crystal_lattice, const std::vector< Vector3D > & positions, const double cutoff )
+{
+    CellList cell_list( crystal_lattice, positions, cutoff );
+    size_t nmissed( 0 );
+    std::vector< size_t > candidates;
+    for ( size_t i( 0 ); i != positions.size(); ++i )
+    {
+        cell_list.candidates( i, candidates );
+        for ( size_t j( 0 ); j != positions.size(); ++j )
+        {
+            if ( j == i )
+                continue;
+            if ( crystal_lattice.shortest_distance2( positions[i], positions[j] ) < cutoff * cutoff )
+            {
+                if ( ! std::binary_search( candidates.begin(), candidates.end(), j ) )
+                    ++nmissed;
+            }
+        }
+    }
+    return nmissed;
+}
+
+} // namespace
+
+void test_cell_list( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for CellList." << std::endl;
+    srand( 1234 );
+    std::vector< Vector3D > positions;
+    for ( size_t i( 0 ); i != 400; ++i )
+        positions.push_back( Vector3D( 3.0 * random_fraction() - 1.0, random_fraction(), random_fraction() ) );
+    {
+    CrystalLattice crystal_lattice( 23.0, 17.0, 31.0, Angle::from_degrees( 90.0 ), Angle::from_degrees( 90.0 ), Angle::from_degrees( 90.0 ) );
+    CellList cell_list( crystal_lattice, positions, 3.0 );
+    test_suite.test_equality( cell_list.nbins( 0 ), size_t( 7 ), "CellList::nbins() 01" );
+    test_suite.test_equality( cell_list.nbins( 1 ), size_t( 5 ), "CellList::nbins() 02" );
+    test_suite.test_equality( cell_list.nbins( 2 ), size_t( 10 ), "CellList::nbins() 03" );
+    test_suite.test_equality( count_missed_pairs( crystal_lattice, positions, 3.0 ), size_t( 0 ), "CellList::candidates() 01" );
+    }
+    {
+    CrystalLattice crystal_lattice( 13.1, 24.5, 19.7, Angle::from_degrees( 101.0 ), Angle::from_degrees( 76.0 ), Angle::from_degrees( 115.0 ) );
+    test_suite.test_equality( count_missed_pairs( crystal_lattice, positions, 2.5 ), size_t( 0 ), "CellList::candidates() 02" );
+    }
+    {
+    // Very acute cell
+    CrystalLattice crystal_lattice( 3.9, 15.0, 7.1, Angle::from_degrees( 80.0 ), Angle::from_degrees( 95.0 ), Angle::from_degrees( 25.0 ) );
+    test_suite.test_equality( count_missed_pairs( crystal_lattice, positions, 1.8 ), size_t( 0 ), "CellList::candidates() 03" );
+    }
+    {
+    // Cutoff larger than the cell
+    CrystalLattice crystal_lattice( 5.0, 6.0, 7.0, Angle::from_degrees( 90.0 ), Angle::from_degrees( 100.0 ), Angle::from_degrees( 90.0 ) );
+    test_suite.test_equality( count_missed_pairs( crystal_lattice, positions, 8.0 ), size_t( 0 ), "CellList::candidates() 04" );
+    }
+}
+
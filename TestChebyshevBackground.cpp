@@ -31,7 +31,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "TestSuite.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <vector>
 
 void test_Chebyshev_background( TestSuite & test_suite )
 {
@@ -109,5 +112,58 @@ void test_Chebyshev_background( TestSuite & test_suite )
         test_suite.test_equality_double( back_ground_calculated.intensity( i ), back_ground_target.intensity( i ), "ChebyshevBackground " + size_t2string(i), 0.001 );
     }
 
+    std::vector< double > B;
+    B.push_back( 173.697413 );
+    B.push_back(  -3.44529792 );
+    B.push_back(  12.3258236 );
+    B.push_back( -18.1777706 );
+    B.push_back(  29.4247509 );
+    B.push_back( -20.9786348 );
+    B.push_back(  16.7415553 );
+    B.push_back( -14.0710459 );
+    B.push_back(  10.4740022 );
+    B.push_back(  -4.10834492 );
+    B.push_back(   4.86598724 );
+    {
+    // Clenshaw must agree with the explicit polynomials, and with the TOPAS values
+    for ( size_t i( 0 ); i != 21; ++i )
+    {
+        const double x = -1.0 + 0.1 * i;
+        double sum( 0.0 );
+        for ( size_t order( 0 ); order != B.size(); ++order )
+            sum += B[order] * Chebyshev( order, x );
+        test_suite.test_equality_double( Chebyshev_series( B, x ), sum, "Chebyshev_series() " + size_t2string( i ), 1.0E-9 );
+    }
+    const std::vector< double > background = Chebyshev_background( B, powder_pattern );
+    for ( size_t i( 0 ); i != powder_pattern.size(); ++i )
+        test_suite.test_equality_double( background[i], back_ground_target.intensity( i ), "Chebyshev_background() " + size_t2string( i ), 0.001 );
+    }
+    {
+    // The basis by the recurrence, and a least-squares fit that recovers the coefficients of a noise-free background
+    const size_t nterms = B.size();
+    const std::vector< double > basis = Chebyshev_basis( nterms, powder_pattern );
+    double largest_difference( 0.0 );
+    for ( size_t i( 0 ); i != powder_pattern.size(); ++i )
+    {
+        const double x = ( ( 2.0 * ( powder_pattern.two_theta( i ) - powder_pattern.two_theta_start() ) ) / ( powder_pattern.two_theta_end() - powder_pattern.two_theta_start() ) ) - 1.0;
+        for ( size_t j( 0 ); j != nterms; ++j )
+            largest_difference = std::max( largest_difference, std::abs( basis[ i * nterms + j ] - Chebyshev( j, x ) ) );
+    }
+    test_suite.test_equality_double( largest_difference, 0.0, "Chebyshev_basis()", 1.0E-9 );
+    PowderPattern background_pattern( Angle::from_degrees( 3.0 ), Angle::from_degrees( 43.0 ), Angle::from_degrees( 0.02 ) );
+    const std::vector< double > background = Chebyshev_background( B, background_pattern );
+    for ( size_t i( 0 ); i != background_pattern.size(); ++i )
+    {
+        background_pattern.set_intensity( i, background[i] );
+        background_pattern.set_estimated_standard_deviation( i, std::sqrt( background[i] ) );
+    }
+    const std::vector< double > fitted = fit_Chebyshev_background( background_pattern, nterms );
+    for ( size_t j( 0 ); j != nterms; ++j )
+        test_suite.test_equality_double( fitted[j], B[j], "fit_Chebyshev_background() " + size_t2string( j ), 1.0E-6 );
+    // Beyond order 10, where Chebyshev() stops
+    std::vector< double > coefficients( 25, 0.0 );
+    coefficients[24] = 1.0;
+    test_suite.test_equality_double( Chebyshev_series( coefficients, std::cos( 0.3 ) ), std::cos( 24.0 * 0.3 ), "Chebyshev_series() order 24", 1.0E-9 );
+    }
 }
 
@@ -0,0 +1,204 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Checkpoint.h"
+#include "AnalyseTrajectory.h"
+#include "Atom.h"
+#include "CrystalStructure.h"
+#include "Element.h"
+#include "FileName.h"
+#include "Logger.h"
+#include "RunningAverageAndESD.h"
+#include "RunningCovariance.h"
+#include "TimeCorrelation.h"
+#include "TrajectorySource.h"
+#include "Utilities.h"
+#include "Vector3D.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Ten frames of a small structure. Reading frame nframes_readable or later throws, as if the process had been stopped.
+class TestTrajectory : public TrajectorySource
+{
+public:
+
+    explicit TestTrajectory( const size_t nframes_readable = 10 ): nframes_readable_(nframes_readable) {}
+
+    size_t nframes() const { return 10; }
+
+    void read_frame( const size_t i, CrystalStructure & crystal_structure ) const
+    {
+        if ( i >= nframes_readable_ )
+            throw std::runtime_error( "TestTrajectory::read_frame(): stopped." );
+        crystal_structure = CrystalStructure();
+        crystal_structure.set_crystal_lattice( CrystalLattice( 10.0 + 0.01 * i, 11.0 - 0.02 * ( i % 3 ), 12.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+        crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.1 + 0.001 * ( ( i * i ) % 7 ), 0.2, 0.3 ), "C1" ) );
+        crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 0.4, 0.5 - 0.002 * ( i % 4 ), 0.6 + 0.001 * i ), "O1" ) );
+    }
+
+    std::string frame_name( const size_t i ) const { return "test_frame_" + size_t2string( i ); }
+
+    std::string directory() const { return ""; }
+
+private:
+    size_t nframes_readable_;
+};
+
+} // namespace
+
+void test_checkpoint( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for Checkpoint." << std::endl;
+    const FileName file_name( "", "test_checkpoint", "bin" );
+    {
+    CheckpointWriter checkpoint_writer;
+    checkpoint_writer.write( size_t( 3 ) );
+    checkpoint_writer.write( std::string( "C1" ) );
+    checkpoint_writer.write( std::vector< Vector3D >( 2, Vector3D( 1.0, 2.0, 3.0 ) ) );
+    RunningAverageAndESD< double > average;
+    average.add_value( 1.0 );
+    average.add_value( 4.0 );
+    average.save( checkpoint_writer );
+    RunningAverageAndESD< Angle > average_angle;
+    average_angle.add_value( Angle::from_degrees( 89.0 ) );
+    average_angle.add_value( Angle::from_degrees( 91.0 ) );
+    average_angle.save( checkpoint_writer );
+    RunningAverageAndESDArray average_positions( 2 );
+    average_positions.add_values( std::vector< Vector3D >( 2, Vector3D( 0.5, 0.5, 0.5 ) ) );
+    average_positions.add_values( std::vector< Vector3D >( 2, Vector3D( 0.7, 0.5, 0.3 ) ) );
+    average_positions.save( checkpoint_writer );
+    RunningCovariance covariance;
+    covariance.add_value( Vector3D( 0.0, 0.0, 1.0 ) );
+    covariance.add_value( Vector3D( 1.0, 0.0, 0.0 ) );
+    covariance.save( checkpoint_writer );
+    AutocorrelationAccumulator autocorrelation( 1, 2 );
+    autocorrelation.add_values( std::vector< Vector3D >( 1, Vector3D( 1.0, 0.0, 0.0 ) ) );
+    autocorrelation.save( checkpoint_writer );
+    checkpoint_writer.save( file_name, "test key" );
+    CheckpointReader checkpoint_reader;
+    test_suite.test_equality( checkpoint_reader.load( file_name, "other key" ), false, "CheckpointReader::load() different key" );
+    test_suite.test_equality( checkpoint_reader.load( FileName( "", "test_checkpoint_does_not_exist", "bin" ), "test key" ), false, "CheckpointReader::load() no file" );
+    test_suite.test_equality( checkpoint_reader.load( file_name, "test key" ), true, "CheckpointReader::load()" );
+    size_t n;
+    checkpoint_reader.read( n );
+    test_suite.test_equality( n, size_t( 3 ), "CheckpointReader::read() size_t" );
+    std::string label;
+    checkpoint_reader.read( label );
+    test_suite.test_equality( label, std::string( "C1" ), "CheckpointReader::read() std::string" );
+    std::vector< Vector3D > points;
+    checkpoint_reader.read( points );
+    test_suite.test_equality( points.size(), size_t( 2 ), "CheckpointReader::read() std::vector" );
+    test_suite.test_equality( nearly_equal( points[1], Vector3D( 1.0, 2.0, 3.0 ) ), true, "CheckpointReader::read() Vector3D" );
+    RunningAverageAndESD< double > average_2;
+    average_2.load( checkpoint_reader );
+    // Adding a value after loading must give the same result as adding it to the original
+    average.add_value( 7.0 );
+    average_2.add_value( 7.0 );
+    test_suite.test_equality( average_2.nvalues(), size_t( 3 ), "RunningAverageAndESD::load() nvalues" );
+    test_suite.test_equality_double( average_2.average(), average.average(), "RunningAverageAndESD::load() average", 0.0 );
+    test_suite.test_equality_double( average_2.estimated_standard_deviation(), average.estimated_standard_deviation(), "RunningAverageAndESD::load() ESD", 0.0 );
+    RunningAverageAndESD< Angle > average_angle_2;
+    average_angle_2.load( checkpoint_reader );
+    test_suite.test_equality_double( average_angle_2.average().value_in_degrees(), 90.0, "RunningAverageAndESD< Angle >::load()" );
+    RunningAverageAndESDArray average_positions_2;
+    average_positions_2.load( checkpoint_reader );
+    test_suite.test_equality( average_positions_2.size(), size_t( 2 ), "RunningAverageAndESDArray::load() size" );
+    test_suite.test_equality( nearly_equal( average_positions_2.average( 1 ), Vector3D( 0.6, 0.5, 0.4 ) ), true, "RunningAverageAndESDArray::load() average" );
+    RunningCovariance covariance_2;
+    covariance_2.load( checkpoint_reader );
+    test_suite.test_equality_double( covariance_2.covariance_matrix().value( 0, 2 ), covariance.covariance_matrix().value( 0, 2 ), "RunningCovariance::load()", 0.0 );
+    AutocorrelationAccumulator autocorrelation_2;
+    autocorrelation_2.load( checkpoint_reader );
+    autocorrelation.add_values( std::vector< Vector3D >( 1, Vector3D( 0.0, 2.0, 0.0 ) ) );
+    autocorrelation_2.add_values( std::vector< Vector3D >( 1, Vector3D( 0.0, 2.0, 0.0 ) ) );
+    test_suite.test_equality( autocorrelation_2.correlation_function() == autocorrelation.correlation_function(), true, "AutocorrelationAccumulator::load()" );
+    test_suite.test_equality( checkpoint_reader.at_end(), true, "CheckpointReader::at_end()" );
+    bool thrown( false );
+    try
+    {
+        checkpoint_reader.read( n );
+    }
+    catch ( std::exception & )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "CheckpointReader::read() past the end" );
+    // A file that is not a checkpoint
+    {
+    std::ofstream output_file( file_name.full_name().c_str() );
+    output_file << "data_test" << std::endl;
+    }
+    thrown = false;
+    try
+    {
+        checkpoint_reader.load( file_name, "test key" );
+    }
+    catch ( std::exception & )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "CheckpointReader::load() not a checkpoint" );
+    remove_checkpoint( file_name );
+    test_suite.test_equality( file_name.exists(), false, "remove_checkpoint()" );
+    }
+    {
+    // An analysis that is stopped after six frames and then resumed gives the same results as an uninterrupted one
+    const Logger::Level level = Logger::instance().level();
+    Logger::instance().set_level( Logger::WARNING );
+    AnalyseTrajectory uninterrupted( TestTrajectory(), 1, 1, 1, SpaceGroup(), Matrix3D(), 1 );
+    const FileName checkpoint_file_name( "", "trajectory_checkpoint", "bin" );
+    bool thrown( false );
+    try
+    {
+        AnalyseTrajectory stopped( TestTrajectory( 6 ), 1, 1, 1, SpaceGroup(), Matrix3D(), 1, 2 );
+    }
+    catch ( std::exception & )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "AnalyseTrajectory stopped" );
+    test_suite.test_equality( checkpoint_file_name.exists(), true, "AnalyseTrajectory checkpoint written" );
+    AnalyseTrajectory resumed( TestTrajectory(), 1, 1, 1, SpaceGroup(), Matrix3D(), 1, 2 );
+    Logger::instance().set_level( level );
+    test_suite.test_equality( checkpoint_file_name.exists(), false, "AnalyseTrajectory checkpoint removed" );
+    test_suite.test_equality( resumed.centres_of_mass().size(), size_t( 10 ), "AnalyseTrajectory resumed centres of mass" );
+    test_suite.test_equality( nearly_equal( resumed.centres_of_mass()[9], uninterrupted.centres_of_mass()[9] ), true, "AnalyseTrajectory resumed drift" );
+    test_suite.test_equality_double( resumed.average_crystal_lattice().a(), uninterrupted.average_crystal_lattice().a(), "AnalyseTrajectory resumed a", 1.0E-12 );
+    test_suite.test_equality_double( resumed.average_crystal_lattice().b(), uninterrupted.average_crystal_lattice().b(), "AnalyseTrajectory resumed b", 1.0E-12 );
+    std::remove( FileName( "", "average_adps", "cif" ).full_name().c_str() );
+    }
+}
@@ -0,0 +1,93 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ChemicalFormula.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+void test_chemical_formula( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for ChemicalFormula." << std::endl;
+    {
+    ChemicalFormula chemical_formula( "C6H12O6" );
+    test_suite.test_equality( chemical_formula.size(), size_t( 3 ), "ChemicalFormula::size()" );
+    test_suite.test_equality( chemical_formula.number( Element( "C" ) ), size_t( 6 ), "ChemicalFormula::number( Element ) 01" );
+    test_suite.test_equality( chemical_formula.number( Element( "N" ) ), size_t( 0 ), "ChemicalFormula::number( Element ) 02" );
+    test_suite.test_equality( chemical_formula.contains( Element( "O" ) ), true, "ChemicalFormula::contains()" );
+    test_suite.test_equality( chemical_formula.nelectrons(), size_t( 96 ), "ChemicalFormula::nelectrons()" );
+    test_suite.test_equality_double( chemical_formula.molecular_weight(), 6 * 12.011 + 12 * 1.008 + 6 * 15.999, "ChemicalFormula::molecular_weight()" );
+    test_suite.test_equality( chemical_formula.to_string(), std::string( "C6H12O6" ), "ChemicalFormula::to_string() 01" );
+    test_suite.test_equality( chemical_formula.to_string( true ), std::string( "C6 H12 O6" ), "ChemicalFormula::to_string() 02" );
+    chemical_formula.set_sort_by_atomic_number( true );
+    test_suite.test_equality( chemical_formula.to_string(), std::string( "H12C6O6" ), "ChemicalFormula::to_string() 03" );
+    test_suite.test_equality( chemical_formula.element( 1 ).symbol(), std::string( "C" ), "ChemicalFormula::element()" );
+    test_suite.test_equality( chemical_formula.number( size_t( 1 ) ), size_t( 6 ), "ChemicalFormula::number( size_t )" );
+    chemical_formula.multiply( Fraction( 1, 6 ) );
+    chemical_formula.set_sort_by_atomic_number( false );
+    test_suite.test_equality( chemical_formula.to_string( false, true ), std::string( "C1H2O1" ), "ChemicalFormula::multiply()" );
+    }
+    {
+    // Two-letter symbols, the "usual" order, D and the output of to_string( true )
+    const ChemicalFormula chemical_formula( "ClNa2BrD3C" );
+    test_suite.test_equality( chemical_formula.to_string( true ), std::string( "C D3 Br Cl Na2" ), "ChemicalFormula::ChemicalFormula() 01" );
+    test_suite.test_equality( ChemicalFormula( chemical_formula.to_string( true ) ).to_string(), chemical_formula.to_string(), "ChemicalFormula::ChemicalFormula() 02" );
+    test_suite.test_equality( ChemicalFormula( "" ).size(), size_t( 0 ), "ChemicalFormula::ChemicalFormula() 03" );
+    const char * invalid[] = { "c6H6", "C6H6C", "HCL", "C6-H6" };
+    for ( size_t i( 0 ); i != 4; ++i )
+    {
+        bool caught( false );
+        try
+        {
+            ChemicalFormula( std::string( invalid[i] ) );
+        }
+        catch ( std::runtime_error & )
+        {
+            caught = true;
+        }
+        test_suite.test_equality( caught, true, std::string( "ChemicalFormula::ChemicalFormula() " ) + invalid[i] );
+    }
+    }
+    {
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 10.0, 10.0, 10.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 0.90, 0.50, 0.50 ), "O1" ) );
+    crystal_structure.add_atom( Atom( Element( "H" ), Vector3D( 0.99, 0.50, 0.50 ), "H1" ) );
+    crystal_structure.add_atom( Atom( Element( "H" ), Vector3D( 0.87, 0.59, 0.50 ), "H2" ) );
+    ChemicalFormula chemical_formula;
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+        chemical_formula.add_element( crystal_structure.atom( i ).element() );
+    test_suite.test_equality( ChemicalFormula( crystal_structure ).to_string(), std::string( "H2O" ), "ChemicalFormula::ChemicalFormula( CrystalStructure )" );
+    test_suite.test_equality( chemical_formula.to_string(), std::string( "H2O" ), "ChemicalFormula::add_element()" );
+    }
+}
+
@@ -0,0 +1,144 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Clustering.h"
+#include "CorrelationMatrix.h"
+#include "Xoshiro256StarStar.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// O(N^3) average linkage, straight from the definition: the two clusters with the highest average similarity are merged.
+std::vector< double > naive_average_linkage_similarities( const CorrelationMatrix & correlation_matrix )
+{
+    const size_t n = correlation_matrix.size();
+    std::vector< std::vector< size_t > > clusters( n );
+    for ( size_t i( 0 ); i != n; ++i )
+        clusters[i].push_back( i );
+    std::vector< double > result;
+    while ( clusters.size() > 1 )
+    {
+        size_t best_a( 0 );
+        size_t best_b( 1 );
+        double best_similarity( -1.0E30 );
+        for ( size_t a( 0 ); a != clusters.size(); ++a )
+        {
+            for ( size_t b( a + 1 ); b != clusters.size(); ++b )
+            {
+                double sum( 0.0 );
+                for ( size_t k( 0 ); k != clusters[a].size(); ++k )
+                {
+                    for ( size_t l( 0 ); l != clusters[b].size(); ++l )
+                        sum += correlation_matrix.value( clusters[a][k], clusters[b][l] );
+                }
+                const double similarity = sum / ( clusters[a].size() * clusters[b].size() );
+                if ( similarity > best_similarity )
+                {
+                    best_similarity = similarity;
+                    best_a = a;
+                    best_b = b;
+                }
+            }
+        }
+        result.push_back( best_similarity );
+        clusters[ best_a ].insert( clusters[ best_a ].end(), clusters[ best_b ].begin(), clusters[ best_b ].end() );
+        clusters.erase( clusters.begin() + best_b );
+    }
+    return result;
+}
+
+} // namespace
+
+void test_clustering( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for Clustering." << std::endl;
+    // Two groups of near-duplicates, { 0, 2, 4 } and { 1, 3 }, and 5 on its own
+    CorrelationMatrix correlation_matrix( 6 );
+    for ( size_t i( 0 ); i != 6; ++i )
+    {
+        for ( size_t j( i + 1 ); j != 6; ++j )
+            correlation_matrix.set_value( i, j, 0.5 );
+    }
+    correlation_matrix.set_value( 0, 2, 0.99 );
+    correlation_matrix.set_value( 2, 4, 0.98 );
+    correlation_matrix.set_value( 1, 3, 0.97 );
+    correlation_matrix.set_value( 3, 5, 0.8 );
+{
+    std::vector< size_t > groups = group_duplicates( correlation_matrix, 0.95 );
+    std::vector< size_t > expected_groups;
+    expected_groups.push_back( 0 );
+    expected_groups.push_back( 1 );
+    expected_groups.push_back( 0 );
+    expected_groups.push_back( 1 );
+    expected_groups.push_back( 0 );
+    expected_groups.push_back( 2 );
+    test_suite.test_equality( groups == expected_groups, true, "group_duplicates() 1" );
+    DuplicateGroups duplicate_groups( 6, 0.95 );
+    duplicate_groups.add( correlation_matrix );
+    test_suite.test_equality( duplicate_groups.ngroups(), size_t( 3 ), "DuplicateGroups::ngroups()" );
+    test_suite.test_equality( duplicate_groups.representatives()[2], size_t( 5 ), "DuplicateGroups::representatives()" );
+}
+{
+    Dendrogram dendrogram = average_linkage_clustering( correlation_matrix );
+    test_suite.test_equality( dendrogram.merges().size(), size_t( 5 ), "average_linkage_clustering() 1" );
+    test_suite.test_equality( dendrogram.merges()[0].cluster_1_, size_t( 0 ), "average_linkage_clustering() 2" );
+    test_suite.test_equality( dendrogram.merges()[0].cluster_2_, size_t( 2 ), "average_linkage_clustering() 3" );
+    // After 1 and 3, 4 joins the cluster of 0 and 2, which is cluster 6
+    test_suite.test_equality( dendrogram.merges()[2].cluster_1_, size_t( 4 ), "average_linkage_clustering() 4" );
+    test_suite.test_equality( dendrogram.merges()[2].cluster_2_, size_t( 6 ), "average_linkage_clustering() 5" );
+    test_suite.test_equality_double( dendrogram.merges()[2].similarity_, ( 0.5 + 0.98 ) / 2.0, "average_linkage_clustering() 6", 1.0E-12 );
+    test_suite.test_equality( dendrogram.merges()[4].size_, size_t( 6 ), "average_linkage_clustering() 7" );
+    // Average linkage only takes 4 into { 0, 2 } at ( 0.5 + 0.98 ) / 2
+    test_suite.test_equality( dendrogram.clusters( 0.7 ) == group_duplicates( correlation_matrix, 0.95 ), true, "Dendrogram::clusters() 1" );
+    test_suite.test_equality( dendrogram.clusters( size_t( 1 ) ) == std::vector< size_t >( 6, 0 ), true, "Dendrogram::clusters() 2" );
+    test_suite.test_equality( dendrogram.clusters( size_t( 2 ) )[5], size_t( 1 ), "Dendrogram::clusters() 3" );
+}
+{
+    // Random similarities against the definition
+    Xoshiro256StarStar rng( 5 );
+    const size_t n = 40;
+    CorrelationMatrix random_matrix( n );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        for ( size_t j( i + 1 ); j != n; ++j )
+            random_matrix.set_value( i, j, rng.next_double() );
+    }
+    Dendrogram dendrogram = average_linkage_clustering( random_matrix );
+    std::vector< double > expected = naive_average_linkage_similarities( random_matrix );
+    bool are_equal( dendrogram.merges().size() == expected.size() );
+    for ( size_t k( 0 ); are_equal && ( k != expected.size() ); ++k )
+        are_equal = ( std::abs( dendrogram.merges()[k].similarity_ - expected[k] ) < 1.0E-12 );
+    test_suite.test_equality( are_equal, true, "average_linkage_clustering() against definition" );
+}
+}
+
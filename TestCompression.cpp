@@ -0,0 +1,170 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Compression.h"
+#include "CrystalStructure.h"
+#include "FileName.h"
+#include "PowderPattern.h"
+#include "ReadCif.h"
+#include "TextFileReader.h"
+#include "TextFileReader_2.h"
+#include "TextFileWriter.h"
+#include "Utilities.h"
+
+#include "TestFixtures.h"
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::vector< char > file_contents( const FileName & file_name )
+{
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    return std::vector< char >( ( std::istreambuf_iterator< char >( input_file ) ), std::istreambuf_iterator< char >() );
+}
+
+// Writes nlines numbered lines, more than one block of the stream buffers
+void write_numbered_lines( const FileName & file_name, const size_t nlines )
+{
+    TextFileWriter text_file_writer( file_name );
+    for ( size_t i( 0 ); i != nlines; ++i )
+    {
+        text_file_writer.write_line( "line " + size_t2string( i ) + " 0123456789 abcdefghijklmnopqrstuvwxyz" );
+        if ( i == nlines / 2 )
+            text_file_writer.flush();
+    }
+}
+
+bool has_numbered_lines( const FileName & file_name, const size_t nlines )
+{
+    TextFileReader text_file_reader( file_name );
+    std::string line;
+    size_t i( 0 );
+    while ( text_file_reader.get_next_line( line ) )
+    {
+        if ( line != "line " + size_t2string( i ) + " 0123456789 abcdefghijklmnopqrstuvwxyz" )
+            return false;
+        ++i;
+    }
+    return ( i == nlines );
+}
+
+} // namespace
+
+void test_compression( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for Compression." << std::endl;
+    const size_t nlines( 5000 );
+    const FileName gzip_file_name( "test_compression.txt.gz" );
+    {
+    test_suite.test_equality( compression_from_extension( gzip_file_name ) == GZIP, true, "compression_from_extension() 01" );
+    test_suite.test_equality( compression_from_extension( FileName( "test.ZST" ) ) == ZSTD, true, "compression_from_extension() 02" );
+    test_suite.test_equality( compression_from_extension( FileName( "test.xye" ) ) == NO_COMPRESSION, true, "compression_from_extension() 03" );
+    write_numbered_lines( gzip_file_name, nlines );
+    test_suite.test_equality( detect_compression( gzip_file_name ) == GZIP, true, "detect_compression()" );
+    test_suite.test_equality( has_numbered_lines( gzip_file_name, nlines ), true, "TextFileReader gzip" );
+    TextFileReader_2 text_file_reader_2( gzip_file_name );
+    test_suite.test_equality( text_file_reader_2.size(), nlines, "TextFileReader_2 gzip 01" );
+    test_suite.test_equality( text_file_reader_2.line( 1234 ), std::string( "line 1234 0123456789 abcdefghijklmnopqrstuvwxyz" ), "TextFileReader_2 gzip 02" );
+    }
+    {
+    // Concatenated gzip members are one stream, as for gunzip
+    std::vector< char > contents = file_contents( gzip_file_name );
+    const size_t compressed_size = contents.size();
+    contents.insert( contents.end(), contents.begin(), contents.end() );
+    decompress_if_compressed( contents );
+    TextFileReader_2 text_file_reader_2;
+    text_file_reader_2.read_buffer( contents );
+    test_suite.test_equality( text_file_reader_2.size(), 2 * nlines, "decompress_if_compressed() 01" );
+    test_suite.test_equality( compressed_size < contents.size() / 10, true, "decompress_if_compressed() 02" );
+    }
+    {
+    // A truncated file is an error, not a shorter file
+    std::vector< char > contents = file_contents( gzip_file_name );
+    contents.resize( contents.size() / 2 );
+    bool has_thrown( false );
+    try
+    {
+        decompress_if_compressed( contents );
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "decompress_if_compressed() 03" );
+    }
+    std::remove( gzip_file_name.full_name().c_str() );
+    {
+    // A compressed cif and a compressed .xye file
+    const CrystalStructure crystal_structure = P21c_test_asymmetric_unit( CrystalLattice( 7.1, 9.3, 11.7, Angle::angle_90_degrees(), Angle::from_degrees( 103.4 ), Angle::angle_90_degrees() ) );
+    const FileName cif_file_name( "test_compression.cif.gz" );
+    crystal_structure.save_cif( cif_file_name );
+    CrystalStructure crystal_structure_2;
+    read_cif( cif_file_name, crystal_structure_2 );
+    test_suite.test_equality( crystal_structure_2.natoms(), crystal_structure.natoms(), "read_cif() gzip 01" );
+    test_suite.test_equality( nearly_equal( crystal_structure_2.crystal_lattice().c(), crystal_structure.crystal_lattice().c() ), true, "read_cif() gzip 02" );
+    std::remove( cif_file_name.full_name().c_str() );
+    PowderPattern powder_pattern( Angle::from_degrees( 5.0 ), Angle::from_degrees( 10.0 ), Angle::from_degrees( 0.5 ) );
+    for ( size_t i( 0 ); i != powder_pattern.size(); ++i )
+        powder_pattern.set_intensity( i, 100.0 + i );
+    const FileName xye_file_name( "test_compression.xye.gz" );
+    powder_pattern.save_xye( xye_file_name, false );
+    PowderPattern powder_pattern_2;
+    powder_pattern_2.read_xye( xye_file_name );
+    test_suite.test_equality( powder_pattern_2.size(), powder_pattern.size(), "PowderPattern::read_xye() gzip 01" );
+    test_suite.test_equality( nearly_equal( powder_pattern_2.intensity( 3 ), 103.0 ), true, "PowderPattern::read_xye() gzip 02" );
+    std::remove( xye_file_name.full_name().c_str() );
+    }
+    {
+    const FileName zstd_file_name( "test_compression.txt.zst" );
+#ifdef FOURIER_ZSTD
+    write_numbered_lines( zstd_file_name, nlines );
+    test_suite.test_equality( detect_compression( zstd_file_name ) == ZSTD, true, "TextFileWriter zstd" );
+    test_suite.test_equality( has_numbered_lines( zstd_file_name, nlines ), true, "TextFileReader zstd" );
+#else
+    bool has_thrown( false );
+    try
+    {
+        TextFileWriter text_file_writer( zstd_file_name );
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "TextFileWriter zstd" );
+#endif
+    std::remove( zstd_file_name.full_name().c_str() );
+    }
+}
+
@@ -0,0 +1,117 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ContactAnalysis.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// Two water molecules in a 10 A cubic P1 cell, O1-H1...O2 is a linear hydrogen bond that crosses the cell boundary along a.
+CrystalStructure water_dimer()
+{
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 10.0, 10.0, 10.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 9.00, 5.00, 5.00 ) / 10.0, "O1" ) );
+    crystal_structure.add_atom( Atom( Element( "H" ), Vector3D( 9.96, 5.00, 5.00 ) / 10.0, "H1" ) );
+    crystal_structure.add_atom( Atom( Element( "H" ), Vector3D( 8.76, 5.93, 5.00 ) / 10.0, "H2" ) );
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 1.80, 5.00, 5.00 ) / 10.0, "O2" ) );
+    crystal_structure.add_atom( Atom( Element( "H" ), Vector3D( 2.04, 5.00, 5.93 ) / 10.0, "H3" ) );
+    crystal_structure.add_atom( Atom( Element( "H" ), Vector3D( 2.04, 5.00, 4.07 ) / 10.0, "H4" ) );
+    return crystal_structure;
+}
+
+} // namespace
+
+void test_contact_analysis( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for ContactAnalysis." << std::endl;
+    {
+    CrystalStructure crystal_structure = water_dimer();
+    crystal_structure.perceive_molecules();
+    test_suite.test_equality( crystal_structure.nmolecules(), size_t( 2 ), "ContactAnalysis 01" );
+    const ContactAnalysis contact_analysis( crystal_structure );
+    bool found_O_O_contact( false );
+    for ( size_t i( 0 ); i != contact_analysis.ncontacts(); ++i )
+    {
+        const Contact & contact = contact_analysis.contact( i );
+        // No intramolecular contacts
+        if ( crystal_structure.molecule_index( contact.atom_1_ ) == crystal_structure.molecule_index( contact.atom_2_ ) )
+            test_suite.log_error( "ContactAnalysis: intramolecular contact " + contact_analysis.label( contact.atom_1_ ) + " " + contact_analysis.label( contact.atom_2_ ) );
+        if ( contact.distance_ > contact.sum_of_Van_der_Waals_radii_ )
+            test_suite.log_error( "ContactAnalysis: contact too long" );
+        if ( ( contact_analysis.label( contact.atom_1_ ) == "O1" ) && ( contact_analysis.label( contact.atom_2_ ) == "O2" ) )
+        {
+            found_O_O_contact = true;
+            test_suite.test_equality_double( contact.distance_, 2.8, "ContactAnalysis 02" );
+            test_suite.test_equality_double( ( contact.translation_ - Vector3D( 1.0, 0.0, 0.0 ) ).length(), 0.0, "ContactAnalysis 03" );
+        }
+    }
+    test_suite.test_equality( found_O_O_contact, true, "ContactAnalysis 04" );
+    test_suite.test_equality( contact_analysis.nhydrogen_bonds(), size_t( 1 ), "ContactAnalysis 05" );
+    if ( contact_analysis.nhydrogen_bonds() == 1 )
+    {
+        const HydrogenBond & hydrogen_bond = contact_analysis.hydrogen_bond( 0 );
+        test_suite.test_equality( contact_analysis.label( hydrogen_bond.donor_ ), std::string( "O1" ), "ContactAnalysis 06" );
+        test_suite.test_equality( contact_analysis.label( hydrogen_bond.hydrogen_ ), std::string( "H1" ), "ContactAnalysis 07" );
+        test_suite.test_equality( contact_analysis.label( hydrogen_bond.acceptor_ ), std::string( "O2" ), "ContactAnalysis 08" );
+        test_suite.test_equality_double( hydrogen_bond.H_A_distance_, 1.84, "ContactAnalysis 09" );
+        test_suite.test_equality_double( hydrogen_bond.D_A_distance_, 2.8, "ContactAnalysis 10" );
+        test_suite.test_equality_double( hydrogen_bond.D_H_A_angle_.value_in_degrees(), 180.0, "ContactAnalysis 11" );
+    }
+    // A stricter angle criterion than 180 degrees is impossible, a larger delta only adds contacts
+    test_suite.test_equality( ContactAnalysis( crystal_structure, 0.0, Angle::from_degrees( 180.1 ) ).nhydrogen_bonds(), size_t( 0 ), "ContactAnalysis 12" );
+    test_suite.test_equality( ContactAnalysis( crystal_structure, 1.0 ).ncontacts() > contact_analysis.ncontacts(), true, "ContactAnalysis 13" );
+    }
+    {
+    std::vector< FileName > file_names;
+    for ( size_t i( 0 ); i != 2; ++i )
+    {
+        file_names.push_back( FileName( "", "test_contact_analysis_" + size_t2string( i ), "cif" ) );
+        water_dimer().save_cif( file_names.back() );
+    }
+    const FileList file_list( file_names );
+    std::vector< std::string > error_messages;
+    const std::vector< ContactAnalysis > contact_analyses = analyse_contacts( file_list, error_messages, 0.0, Angle::from_degrees( 120.0 ), 2 );
+    test_suite.test_equality( contact_analyses.size(), size_t( 2 ), "analyse_contacts() 01" );
+    test_suite.test_equality( error_messages[0].empty() && error_messages[1].empty(), true, "analyse_contacts() 02" );
+    test_suite.test_equality( contact_analyses[1].nhydrogen_bonds(), size_t( 1 ), "analyse_contacts() 03" );
+    for ( size_t i( 0 ); i != file_names.size(); ++i )
+        std::remove( file_names[i].full_name().c_str() );
+    }
+}
+
@@ -30,15 +30,26 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TestSuite.h"
 
 #include <iostream>
+#include <vector>
 
 void test_ConvexPolygon( TestSuite & test_suite )
 {
     std::cout << "Now running tests for ConvexPolygon." << std::endl;
-
     {
-    ConvexPolygon dummy;
-  //  test_suite.test_equality( dummy, , "ConvexPolygon()" );
+    std::vector< Vector3D > vertices;
+    vertices.push_back( Vector3D( 0.0, 0.0, 1.0 ) );
+    vertices.push_back( Vector3D( 2.0, 0.0, 1.0 ) );
+    vertices.push_back( Vector3D( 2.0, 1.0, 1.0 ) );
+    vertices.push_back( Vector3D( 0.0, 1.0, 1.0 ) );
+    ConvexPolygon rectangle( vertices );
+    test_suite.test_equality( rectangle.nvertices(), size_t( 4 ), "ConvexPolygon::nvertices()" );
+    test_suite.test_equality_double( rectangle.area(), 2.0, "ConvexPolygon::area()" );
+    test_suite.test_equality_double( ( rectangle.n() - Vector3D( 0.0, 0.0, 4.0 ) ).length(), 0.0, "ConvexPolygon::n()" );
+    test_suite.test_equality_double( ( rectangle.centroid() - Vector3D( 1.0, 0.5, 1.0 ) ).length(), 0.0, "ConvexPolygon::centroid()" );
+    const std::vector< Triangle > triangles = rectangle.triangles();
+    test_suite.test_equality( triangles.size(), size_t( 4 ), "ConvexPolygon::triangles()" );
+    test_suite.test_equality_double( total_area( triangles ), 2.0, "ConvexPolygon::triangles() area" );
+    test_suite.test_equality_double( ( triangles[1].vertex( 2 ) - Vector3D( 1.0, 0.5, 1.0 ) ).length(), 0.0, "ConvexPolygon::triangles() centroid" );
     }
-
 }
 
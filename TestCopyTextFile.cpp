@@ -0,0 +1,99 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "CopyTextFile.h"
+#include "FileName.h"
+#include "TextFileReader.h"
+#include "TextFileWriter.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+
+void test_copy_text_file( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for CopyTextFile." << std::endl;
+    const std::string directory( "test_copy_text_file" );
+    const std::string copy_directory( "test_copy_text_file_copy" );
+    mkdir( directory.c_str(), 0755 );
+    mkdir( ( directory + "/subdirectory" ).c_str(), 0755 );
+    const char * names[] = { "a.txt", "b.cif", "subdirectory/c.txt" };
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        TextFileWriter text_file_writer( FileName( directory + "/" + names[i] ) );
+        text_file_writer.write_line( "data_" + std::string( names[i] ) );
+        for ( size_t j( 0 ); j != 1000 * i; ++j )
+            text_file_writer.write_line( "0123456789" );
+    }
+{
+    copy_file( FileName( directory + "/a.txt" ), FileName( directory + "/a_copy.txt" ) );
+    FileStatus original( FileName( directory + "/a.txt" ) );
+    FileStatus copy( FileName( directory + "/a_copy.txt" ) );
+    test_suite.test_equality( copy.size(), original.size(), "copy_file() 1" );
+    test_suite.test_equality( copy.modification_time(), original.modification_time(), "copy_file() 2" );
+    std::remove( ( directory + "/a_copy.txt" ).c_str() );
+}
+{
+    CopyStatistics statistics = copy_directory_tree( directory, copy_directory, 2 );
+    test_suite.test_equality( statistics.nfiles_copied_, size_t( 3 ), "copy_directory_tree() 1" );
+    test_suite.test_equality( statistics.nfiles_skipped_, size_t( 0 ), "copy_directory_tree() 2" );
+    TextFileReader text_file_reader( FileName( copy_directory + "/subdirectory/c.txt" ) );
+    std::string line;
+    size_t nlines( 0 );
+    while ( text_file_reader.get_next_line( line ) )
+        ++nlines;
+    test_suite.test_equality( nlines, size_t( 2001 ), "copy_directory_tree() 3" );
+    test_suite.test_equality( FileStatus( FileName( copy_directory + "/b.cif" ) ).size(), FileStatus( FileName( directory + "/b.cif" ) ).size(), "copy_directory_tree() 4" );
+    // Nothing has changed, so nothing is copied
+    statistics = copy_directory_tree( directory, copy_directory, 2 );
+    test_suite.test_equality( statistics.nfiles_copied_, size_t( 0 ), "copy_directory_tree() 5" );
+    test_suite.test_equality( statistics.nfiles_skipped_, size_t( 3 ), "copy_directory_tree() 6" );
+    {
+        TextFileWriter text_file_writer( FileName( directory + "/a.txt" ) );
+        text_file_writer.write_line( "data_changed" );
+    }
+    statistics = copy_directory_tree( directory, copy_directory, 2 );
+    test_suite.test_equality( statistics.nfiles_copied_, size_t( 1 ), "copy_directory_tree() 7" );
+    test_suite.test_equality( statistics.nbytes_copied_, FileStatus( FileName( directory + "/a.txt" ) ).size(), "copy_directory_tree() 8" );
+    statistics = copy_directory_tree( directory, copy_directory, 1, false );
+    test_suite.test_equality( statistics.nfiles_copied_, size_t( 3 ), "copy_directory_tree() 9" );
+}
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        std::remove( ( directory + "/" + names[i] ).c_str() );
+        std::remove( ( copy_directory + "/" + names[i] ).c_str() );
+    }
+    std::remove( ( directory + "/subdirectory" ).c_str() );
+    std::remove( ( copy_directory + "/subdirectory" ).c_str() );
+    std::remove( directory.c_str() );
+    std::remove( copy_directory.c_str() );
+}
+
@@ -26,8 +26,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "CorrelationMatrix.h"
+#include "FileName.h"
 #include "TestSuite.h"
 
+#include <cstdio>
 #include <iostream>
 
 void test_correlation_matrix( TestSuite & test_suite )
@@ -129,5 +131,43 @@ void test_correlation_matrix( TestSuite & test_suite )
     catch ( std::exception & e ) {}
 }
 
+{
+    // Single precision, copies, and saving and memory-mapping the lower triangle
+    CorrelationMatrix correlation_matrix( 4, CorrelationMatrix::SINGLE_PRECISION );
+    for ( size_t i( 0 ); i != 4; ++i )
+    {
+        for ( size_t j( 0 ); j != i; ++j )
+            correlation_matrix.set_value( i, j, 0.1 * i + 0.01 * j );
+    }
+    correlation_matrix.set_value_on_diagonal( 0.5 );
+    test_suite.test_equality_double( correlation_matrix.value( 1, 3 ), 0.31, "CorrelationMatrix SINGLE_PRECISION", 0.000001 );
+    CorrelationMatrix copy( correlation_matrix );
+    copy.set_value( 1, 3, 0.9 );
+    test_suite.test_equality_double( correlation_matrix.value( 1, 3 ), 0.31, "CorrelationMatrix copy constructor", 0.000001 );
+    FileName file_name( "TestCorrelationMatrix.tmp" );
+    correlation_matrix.save_lower_triangle( file_name );
+    {
+    CorrelationMatrix mapped_matrix( file_name );
+    test_suite.test_equality( mapped_matrix.size(), size_t( 4 ), "CorrelationMatrix( FileName ) size()" );
+    test_suite.test_equality( mapped_matrix.is_memory_mapped(), true, "CorrelationMatrix( FileName ) is_memory_mapped()" );
+    test_suite.test_equality_double( mapped_matrix.value( 0, 0 ), 0.5, "CorrelationMatrix( FileName ) diagonal" );
+    test_suite.test_equality_double( mapped_matrix.value( 2, 3 ), 0.32, "CorrelationMatrix( FileName ) value()", 0.000001 );
+    mapped_matrix.set_value( 2, 3, 0.75 );
+    }
+    {
+    CorrelationMatrix mapped_matrix( file_name );
+    test_suite.test_equality_double( mapped_matrix.value( 3, 2 ), 0.75, "CorrelationMatrix( FileName ) set_value()", 0.000001 );
+    }
+    {
+    CorrelationMatrix mapped_matrix( 3, file_name );
+    mapped_matrix.set_value( 0, 2, 0.25 );
+    mapped_matrix.save_lower_triangle( file_name );
+    CorrelationMatrix mapped_matrix_2( file_name );
+    test_suite.test_equality( mapped_matrix_2.precision(), CorrelationMatrix::DOUBLE_PRECISION, "CorrelationMatrix( size_t, FileName ) precision()" );
+    test_suite.test_equality_double( mapped_matrix_2.value( 2, 0 ), 0.25, "CorrelationMatrix( size_t, FileName )" );
+    test_suite.test_equality_double( mapped_matrix_2.value( 1, 0 ), 0.0, "CorrelationMatrix( size_t, FileName ) initialisation" );
+    }
+    std::remove( file_name.full_name().c_str() );
 }
 
+}
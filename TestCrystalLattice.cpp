@@ -26,10 +26,66 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "CrystalLattice.h"
+#include "3DCalculations.h"
+#include "Utilities.h"
 
 #include "TestSuite.h"
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
+
+namespace
+{
+
+// The original iterative search over the 27 neighbouring cells, as a reference
+double shortest_distance2_reference( const CrystalLattice & crystal_lattice, const Vector3D & lhs, const Vector3D & rhs )
+{
+    Vector3D difference_vector = adjust_for_translations( rhs - lhs );
+    double shortest_distance2 = crystal_lattice.fractional_to_orthogonal( difference_vector ).norm2();
+    bool shortest_distance_changed( false );
+    do
+    {
+        shortest_distance_changed = false;
+        for ( int i( -1 ); i != 2; ++i )
+        {
+            for ( int j( -1 ); j != 2; ++j )
+            {
+                for ( int k( -1 ); k != 2; ++k )
+                {
+                    Vector3D new_difference_vector = difference_vector + Vector3D( i, j, k );
+                    double distance2 = crystal_lattice.fractional_to_orthogonal( new_difference_vector ).norm2();
+                    if ( distance2 < shortest_distance2 )
+                    {
+                        difference_vector = new_difference_vector;
+                        shortest_distance2 = distance2;
+                        shortest_distance_changed = true;
+                    }
+                }
+            }
+        }
+    }
+    while ( shortest_distance_changed );
+    return shortest_distance2;
+}
+
+// Brute force over a large number of lattice translations
+double shortest_distance2_brute_force( const CrystalLattice & crystal_lattice, const Vector3D & lhs, const Vector3D & rhs )
+{
+    Vector3D difference_vector = adjust_for_translations( rhs - lhs );
+    double shortest_distance2 = crystal_lattice.fractional_to_orthogonal( difference_vector ).norm2();
+    for ( int i( -4 ); i != 5; ++i )
+    {
+        for ( int j( -4 ); j != 5; ++j )
+        {
+            for ( int k( -4 ); k != 5; ++k )
+                shortest_distance2 = std::min( shortest_distance2, crystal_lattice.fractional_to_orthogonal( difference_vector + Vector3D( i, j, k ) ).norm2() );
+        }
+    }
+    return shortest_distance2;
+}
+
+} // namespace
 
 void test_crystal_lattice( TestSuite & test_suite )
 {
@@ -71,5 +127,86 @@ void test_crystal_lattice( TestSuite & test_suite )
     CrystalLattice crystal_lattice( 10.2, 10.2, 10.2, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
     test_suite.test_equality( deduce_lattice_system( crystal_lattice ), CrystalLattice::CUBIC, "deduce_lattice_system() cubic" );
     }
+    {
+    // The last cell has a very acute angle, the nearest image in fractional coordinates is then often not the shortest
+    // and the original search could get stuck in a local minimum
+    std::vector< CrystalLattice > crystal_lattices;
+    crystal_lattices.push_back( CrystalLattice( 4.56, 10.2, 12.34, Angle::from_degrees( 89.0 ), Angle::from_degrees( 92.0 ), Angle::from_degrees( 75.6 ) ) );
+    crystal_lattices.push_back( CrystalLattice( 5.0, 5.0, 5.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    crystal_lattices.push_back( CrystalLattice( 3.9, 15.0, 7.1, Angle::from_degrees( 80.0 ), Angle::from_degrees( 95.0 ), Angle::from_degrees( 25.0 ) ) );
+    size_t ndifferences( 0 );
+    unsigned int seed( 12345 );
+    for ( size_t l( 0 ); l != crystal_lattices.size(); ++l )
+    {
+        std::vector< Vector3D > lhs;
+        std::vector< Vector3D > rhs;
+        for ( size_t i( 0 ); i != 1000; ++i )
+        {
+            double values[6];
+            for ( size_t j( 0 ); j != 6; ++j )
+            {
+                seed = 1103515245 * seed + 12345;
+                values[j] = 4.0 * ( ( seed >> 8 ) % 100000 ) / 100000.0 - 2.0;
+            }
+            lhs.push_back( Vector3D( values[0], values[1], values[2] ) );
+            rhs.push_back( Vector3D( values[3], values[4], values[5] ) );
+        }
+        std::vector< double > distances2 = crystal_lattices[l].shortest_distances2( lhs, rhs );
+        for ( size_t i( 0 ); i != lhs.size(); ++i )
+        {
+            double distance2 = crystal_lattices[l].shortest_distance2( lhs[i], rhs[i] );
+            if ( ( l != 2 ) && ( distance2 != shortest_distance2_reference( crystal_lattices[l], lhs[i], rhs[i] ) ) )
+                ++ndifferences;
+            if ( ! nearly_equal( distance2, shortest_distance2_brute_force( crystal_lattices[l], lhs[i], rhs[i] ), 1.0E-12 ) )
+                ++ndifferences;
+            if ( distances2[i] != crystal_lattices[l].shortest_distance2( lhs[i], rhs[i] ) )
+                ++ndifferences;
+        }
+    }
+    test_suite.test_equality( ndifferences, static_cast<size_t>( 0 ), "CrystalLattice::shortest_distance2()" );
+    }
+    {
+    std::vector< CrystalLattice > crystal_lattices;
+    crystal_lattices.push_back( CrystalLattice( 4.56, 10.2, 12.34, Angle::from_degrees( 89.0 ), Angle::from_degrees( 92.0 ), Angle::from_degrees( 75.6 ) ) );
+    crystal_lattices.push_back( CrystalLattice( 4.56, 4.56, 12.34, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_120_degrees() ) );
+    size_t ndifferences( 0 );
+    unsigned int seed( 54321 );
+    for ( size_t l( 0 ); l != crystal_lattices.size(); ++l )
+    {
+        std::vector< Vector3D > positions;
+        std::vector< double > xyz;
+        for ( size_t i( 0 ); i != 100; ++i )
+        {
+            double values[3];
+            for ( size_t j( 0 ); j != 3; ++j )
+            {
+                seed = 1103515245 * seed + 12345;
+                values[j] = 4.0 * ( ( seed >> 8 ) % 100000 ) / 100000.0 - 2.0;
+                xyz.push_back( values[j] );
+            }
+            positions.push_back( Vector3D( values[0], values[1], values[2] ) );
+        }
+        std::vector< Vector3D > orthogonal( positions );
+        crystal_lattices[l].fractional_to_orthogonal( orthogonal );
+        crystal_lattices[l].fractional_to_orthogonal( &xyz[0], positions.size() );
+        for ( size_t i( 0 ); i != positions.size(); ++i )
+        {
+            Vector3D expected = crystal_lattices[l].fractional_to_orthogonal( positions[i] );
+            if ( ( orthogonal[i].x() != expected.x() ) || ( orthogonal[i].y() != expected.y() ) || ( orthogonal[i].z() != expected.z() ) )
+                ++ndifferences;
+            if ( ! nearly_equal( Vector3D( xyz[3*i], xyz[3*i+1], xyz[3*i+2] ), expected, 1.0E-12 ) )
+                ++ndifferences;
+        }
+        crystal_lattices[l].orthogonal_to_fractional( orthogonal );
+        crystal_lattices[l].orthogonal_to_fractional( &xyz[0], positions.size() );
+        for ( size_t i( 0 ); i != positions.size(); ++i )
+        {
+            if ( ! nearly_equal( orthogonal[i], positions[i], 1.0E-12 ) )
+                ++ndifferences;
+            if ( ! nearly_equal( Vector3D( xyz[3*i], xyz[3*i+1], xyz[3*i+2] ), orthogonal[i], 1.0E-12 ) )
+                ++ndifferences;
+        }
+    }
+    test_suite.test_equality( ndifferences, static_cast<size_t>( 0 ), "CrystalLattice batch conversions" );
+    }
 }
-
@@ -26,10 +26,55 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "CrystalStructure.h"
+#include "SymmetryOrbits.h"
+#include "Utilities.h"
 
 #include "TestSuite.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <vector>
+
+namespace
+{
+
+// The original implementation of CrystalStructure::apply_space_group_symmetry(), as a reference
+std::vector< Atom > apply_space_group_symmetry_reference( const CrystalStructure & crystal_structure )
+{
+    std::vector< Atom > result = crystal_structure.atoms();
+    const SpaceGroup & space_group = crystal_structure.space_group();
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        Vector3D original_position = crystal_structure.atom( i ).position();
+        for ( size_t j( 1 ); j != space_group.nsymmetry_operators(); ++j )
+        {
+            Vector3D new_position = space_group.symmetry_operator( j ) * original_position;
+            if ( crystal_structure.crystal_lattice().shortest_distance( original_position, new_position ) > 0.1 )
+            {
+                Atom new_atom = crystal_structure.atom( i );
+                new_atom.set_position( new_position );
+                result.push_back( new_atom );
+            }
+        }
+    }
+    return result;
+}
+
+bool same_positions( const std::vector< Atom > & lhs, const std::vector< Atom > & rhs )
+{
+    if ( lhs.size() != rhs.size() )
+        return false;
+    for ( size_t i( 0 ); i != lhs.size(); ++i )
+    {
+        if ( ( lhs[i].label() != rhs[i].label() ) || ( lhs[i].position().x() != rhs[i].position().x() ) || ( lhs[i].position().y() != rhs[i].position().y() ) || ( lhs[i].position().z() != rhs[i].position().z() ) )
+            return false;
+    }
+    return true;
+}
+
+} // namespace
 
 void test_crystal_structure( TestSuite & test_suite )
 {
@@ -63,5 +108,311 @@ void test_crystal_structure( TestSuite & test_suite )
     crystal_structure.reduce_to_asymmetric_unit();
     test_suite.test_equality( crystal_structure.natoms(), static_cast<size_t>(1), "CrystalStructure::reduce_to_asymmetric_unit() : Error 2." );
     }
+    {
+    // The read accessors must return references to the stored objects, not copies
+    CrystalStructure crystal_structure;
+    SpaceGroup space_group;
+    space_group.add_inversion_at_origin();
+    crystal_structure.set_space_group( space_group );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.1, 0.2, 0.3 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 0.2, 0.3, 0.4 ), "O1" ) );
+    test_suite.test_equality( &crystal_structure.atom( 1 ) == &crystal_structure.atoms()[1], true, "CrystalStructure::atom() returns a reference" );
+    test_suite.test_equality( &crystal_structure.crystal_lattice() == &crystal_structure.crystal_lattice(), true, "CrystalStructure::crystal_lattice() returns a reference" );
+    test_suite.test_equality( &crystal_structure.space_group() == &crystal_structure.space_group(), true, "CrystalStructure::space_group() returns a reference" );
+    const SpaceGroup & stored_space_group = crystal_structure.space_group();
+    test_suite.test_equality( &stored_space_group.symmetry_operator( 1 ) == &stored_space_group.symmetry_operators()[1], true, "SpaceGroup::symmetry_operator() returns a reference" );
+    }
+    {
+    // Special positions in P2_1/c in a cell where the lower bound for the distance is far from the real distance
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 5.1, 7.3, 19.5, Angle::angle_90_degrees(), Angle::from_degrees( 145.0 ), Angle::angle_90_degrees() ) );
+    crystal_structure.set_space_group( SpaceGroup::P21c() );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.0, 0.0, 0.0 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.5, 0.0, 0.5 ), "C2" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.003, 0.002, 0.001 ), "C3" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.51, 0.005, 0.509 ), "C4" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.1, 0.2, 0.3 ), "C5" ) );
+    std::vector< Atom > reference = apply_space_group_symmetry_reference( crystal_structure );
+    crystal_structure.apply_space_group_symmetry();
+    test_suite.test_equality( crystal_structure.natoms(), reference.size(), "CrystalStructure::apply_space_group_symmetry() 01" );
+    test_suite.test_equality( same_positions( crystal_structure.atoms(), reference ), true, "CrystalStructure::apply_space_group_symmetry() 02" );
+    }
+    {
+    // Large enough to be expanded in parallel
+    srand( 2718 );
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 61.0, 73.0, 59.0, Angle::angle_90_degrees(), Angle::from_degrees( 101.0 ), Angle::angle_90_degrees() ) );
+    crystal_structure.set_space_group( SpaceGroup::P21c() );
+    for ( size_t i( 0 ); i != 30000; ++i )
+    {
+        Vector3D position( static_cast< double >( rand() ) / RAND_MAX, static_cast< double >( rand() ) / RAND_MAX, static_cast< double >( rand() ) / RAND_MAX );
+        if ( i % 100 == 0 )
+            position = Vector3D( 0.5, 0.0, 0.0 );
+        crystal_structure.add_atom( Atom( Element( "C" ), position, "C" + size_t2string( i ) ) );
+    }
+    std::vector< Atom > reference = apply_space_group_symmetry_reference( crystal_structure );
+    crystal_structure.apply_space_group_symmetry();
+    test_suite.test_equality( same_positions( crystal_structure.atoms(), reference ), true, "CrystalStructure::apply_space_group_symmetry() 03" );
+    }
+    {
+    // rhs is lhs inverted through the origin and shifted by ( 0.3, 0.7, 0.1 )
+    CrystalStructure lhs;
+    CrystalStructure rhs;
+    CrystalLattice crystal_lattice( 7.5, 9.2, 11.3, Angle::angle_90_degrees(), Angle::from_degrees( 98.0 ), Angle::angle_90_degrees() );
+    lhs.set_crystal_lattice( crystal_lattice );
+    rhs.set_crystal_lattice( crystal_lattice );
+    lhs.set_space_group( SpaceGroup::P21c() );
+    rhs.set_space_group( SpaceGroup::P21c() );
+    const Vector3D shift( 0.3, 0.7, 0.1 );
+    const char * elements[] = { "C", "C", "N", "O", "C", "H" };
+    srand( 1618 );
+    for ( size_t i( 0 ); i != 6; ++i )
+    {
+        Vector3D position( static_cast< double >( rand() ) / RAND_MAX, static_cast< double >( rand() ) / RAND_MAX, static_cast< double >( rand() ) / RAND_MAX );
+        lhs.add_atom( Atom( Element( elements[i] ), position, elements[i] + size_t2string( i ) ) );
+        rhs.add_atom( Atom( Element( elements[i] ), shift - position, elements[i] + size_t2string( i ) ) );
+    }
+    std::vector< int > integer_shifts;
+    SymmetryOperator symmetry_operator = find_match( lhs, rhs, 10, integer_shifts, false, false );
+    double largest_distance( 0.0 );
+    for ( size_t i( 0 ); i != 6; ++i )
+        largest_distance = std::max( largest_distance, crystal_lattice.shortest_distance( lhs.atom( i ).position(), symmetry_operator * rhs.atom( i ).position() ) );
+    test_suite.test_equality_double( largest_distance, 0.0, "find_match()" );
+    }
+    {
+    CrystalStructure crystal_structure;
+    CrystalLattice crystal_lattice( 6.1, 7.2, 8.3, Angle::from_degrees( 92.0 ), Angle::from_degrees( 103.0 ), Angle::from_degrees( 87.0 ) );
+    crystal_structure.set_crystal_lattice( crystal_lattice );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.1, 0.2, 0.3 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 0.4, 0.5, 0.9 ), "O1" ) );
+    crystal_structure.add_atom( Atom( Element( "N" ), Vector3D( 0.7, 0.1, 0.6 ), "N1" ) );
+    CrystalStructure original( crystal_structure );
+    crystal_structure.supercell( 2, 3, 2 );
+    test_suite.test_equality( crystal_structure.natoms(), size_t( 36 ), "CrystalStructure::supercell() 01" );
+    // Atom 1 in unit cell ( 1, 2, 0 ) is at index ( ( 1 * 3 + 2 ) * 2 + 0 ) * 3 + 1 = 31
+    test_suite.test_equality( crystal_structure.atom( 31 ).label(), std::string( "O1_1_2_0" ), "CrystalStructure::supercell() 02" );
+    test_suite.test_equality_double( crystal_structure.atom( 31 ).position().y(), ( 0.5 + 2.0 ) / 3.0, "CrystalStructure::supercell() 03" );
+    test_suite.test_equality( crystal_structure.atom( 1 ).label(), std::string( "O1_0_0_0" ), "CrystalStructure::supercell() 04" );
+    test_suite.test_equality_double( crystal_structure.crystal_lattice().b(), 3.0 * 7.2, "CrystalStructure::supercell() 05" );
+    CrystalStructure collapsed( crystal_structure );
+    collapsed.collapse_supercell( 2, 3, 2, size_t( 3 ) );
+    test_suite.test_equality( collapsed.natoms(), size_t( 3 ), "CrystalStructure::collapse_supercell() 01" );
+    double largest_distance( 0.0 );
+    for ( size_t i( 0 ); i != 3; ++i )
+        largest_distance = std::max( largest_distance, crystal_lattice.shortest_distance( collapsed.atom( i ).position(), original.atom( i ).position() ) );
+    test_suite.test_equality_double( largest_distance, 0.0, "CrystalStructure::collapse_supercell() 02" );
+    // The flat and the nested trajectory versions must agree
+    CrystalStructure copy_1( crystal_structure );
+    CrystalStructure copy_2( crystal_structure );
+    Matrix3D transformation;
+    Vector3D actual_centre;
+    std::vector< std::vector< Vector3D > > nested_positions;
+    std::vector< Vector3D > flat_positions;
+    copy_1.collapse_supercell( 2, 3, 2, 0, Vector3D(), transformation, actual_centre, nested_positions );
+    copy_2.collapse_supercell( 2, 3, 2, 0, Vector3D(), transformation, actual_centre, flat_positions );
+    bool all_equal( ( nested_positions.size() == 3 ) && ( flat_positions.size() == 36 ) );
+    for ( size_t i( 0 ); all_equal && ( i != 3 ); ++i )
+    {
+        for ( size_t j( 0 ); j != 12; ++j )
+        {
+            if ( ( nested_positions[i][j].x() != flat_positions[ i * 12 + j ].x() ) || ( nested_positions[i][j].z() != flat_positions[ i * 12 + j ].z() ) )
+                all_equal = false;
+        }
+    }
+    test_suite.test_equality( all_equal, true, "CrystalStructure::collapse_supercell() 03" );
+    // A rigid translation of the whole supercell is removed by the drift correction when only a subset of the atoms is tracked
+    std::vector< size_t > reference_atoms;
+    reference_atoms.push_back( 1 );
+    reference_atoms.push_back( 17 );
+    reference_atoms.push_back( 30 );
+    CrystalStructure copy_3( crystal_structure );
+    Vector3D reference_centre;
+    copy_3.collapse_supercell( 2, 3, 2, 0, Vector3D(), reference_atoms, transformation, reference_centre, flat_positions );
+    CrystalStructure translated( crystal_structure );
+    for ( size_t i( 0 ); i != translated.natoms(); ++i )
+    {
+        Atom atom( translated.atom( i ) );
+        atom.set_position( atom.position() + Vector3D( 0.013, -0.021, 0.008 ) );
+        translated.set_atom( i, atom );
+    }
+    std::vector< Vector3D > translated_positions;
+    translated.collapse_supercell( 2, 3, 2, 1, reference_centre, reference_atoms, transformation, actual_centre, translated_positions );
+    bool drift_removed( translated_positions.size() == flat_positions.size() );
+    for ( size_t i( 0 ); drift_removed && ( i != flat_positions.size() ); ++i )
+        drift_removed = nearly_equal( translated_positions[i], flat_positions[i], 1.0E-10 );
+    test_suite.test_equality( drift_removed, true, "CrystalStructure::collapse_supercell() 04" );
+    }
+    {
+    // Two C-C molecules, then a C atom is added that bridges them, then moved away again
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 10.0, 10.0, 10.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.10, 0.1, 0.1 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.25, 0.1, 0.1 ), "C2" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.55, 0.1, 0.1 ), "C3" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.70, 0.1, 0.1 ), "C4" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.50, 0.5, 0.98 ), "C5" ) );
+    crystal_structure.perceive_molecules();
+    test_suite.test_equality( crystal_structure.nmolecules(), size_t( 3 ), "CrystalStructure::update_molecules() 01" );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.40, 0.1, 0.1 ), "C6" ) );
+    // Bonded to C5 across the cell boundary
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.50, 0.5, 0.11 ), "C7" ) );
+    crystal_structure.update_molecules();
+    test_suite.test_equality( crystal_structure.nmolecules(), size_t( 2 ), "CrystalStructure::update_molecules() 02" );
+    size_t largest_molecule = ( crystal_structure.molecule_in_crystal( 0 ).natoms() > crystal_structure.molecule_in_crystal( 1 ).natoms() ) ? 0 : 1;
+    test_suite.test_equality( crystal_structure.molecule_in_crystal( largest_molecule ).natoms(), size_t( 5 ), "CrystalStructure::update_molecules() 03" );
+    test_suite.test_equality_double( crystal_structure.atom( 6 ).position().z(), 1.11, "CrystalStructure::update_molecules() 04" );
+    Atom moved_atom( crystal_structure.atom( 5 ) );
+    moved_atom.set_position( Vector3D( 0.4, 0.6, 0.6 ) );
+    crystal_structure.set_atom( 5, moved_atom );
+    crystal_structure.update_molecules( std::vector< size_t >( 1, 5 ) );
+    test_suite.test_equality( crystal_structure.nmolecules(), size_t( 4 ), "CrystalStructure::update_molecules() 05" );
+    }
+    {
+    // Molecule views: one molecule on the inversion centre, one on a general position, which is duplicated by the inversion centre
+    CrystalStructure crystal_structure;
+    std::vector< SymmetryOperator > symmetry_operators;
+    symmetry_operators.push_back( SymmetryOperator( "x,y,z" ) );
+    symmetry_operators.push_back( SymmetryOperator( "-x,-y,-z" ) );
+    crystal_structure.set_space_group( SpaceGroup( symmetry_operators, "P-1" ) );
+    crystal_structure.set_crystal_lattice( CrystalLattice( 10.0, 10.0, 10.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.10, 0.2, 0.3 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.425, 0.5, 0.5 ), "C2" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.25, 0.2, 0.3 ), "C3" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.575, 0.5, 0.5 ), "C4" ) );
+    crystal_structure.perceive_molecules();
+    test_suite.test_equality( crystal_structure.nmolecules(), size_t( 3 ), "CrystalStructure::molecule_in_crystal() 01" );
+    SymmetryOrbits symmetry_orbits( crystal_structure );
+    size_t nspecial( 0 );
+    size_t general( crystal_structure.nmolecules() );
+    bool same_as_symmetry_orbits( true );
+    for ( size_t i( 0 ); i != crystal_structure.nmolecules(); ++i )
+    {
+        const bool is_special = crystal_structure.molecule_is_on_special_position( i );
+        same_as_symmetry_orbits = same_as_symmetry_orbits && ( is_special == symmetry_orbits.molecule_is_on_special_position( i ) );
+        if ( is_special )
+            ++nspecial;
+        else
+            general = i;
+    }
+    test_suite.test_equality( same_as_symmetry_orbits, true, "CrystalStructure::molecule_is_on_special_position() 01" );
+    test_suite.test_equality( nspecial, size_t( 1 ), "CrystalStructure::molecule_is_on_special_position() 02" );
+    MoleculeInCrystal molecule_in_crystal = crystal_structure.molecule_in_crystal( general );
+    test_suite.test_equality( molecule_in_crystal.natoms(), size_t( 2 ), "CrystalStructure::molecule_in_crystal() 02" );
+    const Vector3D old_position = molecule_in_crystal.atom( 1 ).position();
+    const Vector3D old_centre_of_mass = crystal_structure.molecular_centre_of_mass( general );
+    const Vector3D shift( 0.0, 0.1, 0.0 );
+    crystal_structure.move_molecule( general, shift );
+    test_suite.test_equality( nearly_equal( crystal_structure.molecular_centre_of_mass( general ), old_centre_of_mass + shift ), true, "CrystalStructure::move_molecule() 01" );
+    // The view sees the moved atoms
+    test_suite.test_equality( nearly_equal( molecule_in_crystal.atom( 1 ).position(), old_position + shift ), true, "CrystalStructure::move_molecule() 02" );
+    bool view_agrees( true );
+    for ( size_t i( 0 ); i != molecule_in_crystal.natoms(); ++i )
+    {
+        const Atom & atom = crystal_structure.atom( molecule_in_crystal.atom_index( i ) );
+        view_agrees = view_agrees && ( &molecule_in_crystal.atom( i ) == &atom ) && ( crystal_structure.molecule_index( molecule_in_crystal.atom_index( i ) ) == general );
+    }
+    test_suite.test_equality( view_agrees, true, "CrystalStructure::molecule_in_crystal() 03" );
+    // Moving the molecule onto the inversion centre at the origin puts it on a special position
+    crystal_structure.move_molecule( general, -crystal_structure.molecular_centre_of_mass( general ) );
+    test_suite.test_equality( crystal_structure.molecule_is_on_special_position( general ), true, "CrystalStructure::molecule_is_on_special_position() 03" );
+    }
+    {
+    // Binary snapshot round trip
+    CrystalStructure crystal_structure;
+    crystal_structure.set_name( "snapshot" );
+    std::vector< SymmetryOperator > symmetry_operators;
+    symmetry_operators.push_back( SymmetryOperator( "x,y,z" ) );
+    symmetry_operators.push_back( SymmetryOperator( "-x,-y,-z" ) );
+    crystal_structure.set_space_group( SpaceGroup( symmetry_operators, "P-1" ) );
+    crystal_structure.set_crystal_lattice( CrystalLattice( 10.0, 11.0, 12.0, Angle::from_degrees( 91.0 ), Angle::from_degrees( 92.0 ), Angle::from_degrees( 93.0 ) ) );
+    Atom atom_1( Element( "C" ), Vector3D( 0.1, 0.2, 0.3 ), "C1" );
+    atom_1.set_Uiso( 0.025 );
+    atom_1.set_charge( -0.25 );
+    crystal_structure.add_atom( atom_1 );
+    crystal_structure.add_atom( Atom( Element( "D" ), Vector3D( 0.1 + 1.0 / 30.0, 0.2, 0.3 ), "D1", AnisotropicDisplacementParameters( SymmetricMatrix3D( 0.01, 0.02, 0.03, 0.001, 0.002, 0.003 ) ) ) );
+    Atom atom_3( Element( "Cl" ), Vector3D( 0.6, 0.6, 0.6 ), "Cl1" );
+    atom_3.set_occupancy( 0.5 );
+    crystal_structure.add_atom( atom_3 );
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 0.9, 0.1, 0.5 ), "O1" ) );
+    crystal_structure.set_suppressed( 3, true );
+    crystal_structure.perceive_molecules();
+    FileName file_name( "", "test_crystal_structure_snapshot", "csbin" );
+    crystal_structure.save_binary( file_name );
+    CrystalStructure restored;
+    restored.read_binary( file_name );
+    std::remove( file_name.full_name().c_str() );
+    test_suite.test_equality( restored.name(), std::string( "snapshot" ), "CrystalStructure::read_binary() 01" );
+    test_suite.test_equality( restored.space_group().nsymmetry_operators(), size_t( 2 ), "CrystalStructure::read_binary() 02" );
+    test_suite.test_equality( restored.space_group().name(), std::string( "P-1" ), "CrystalStructure::read_binary() 03" );
+    test_suite.test_equality( restored.crystal_lattice().gamma().value_in_radians(), crystal_structure.crystal_lattice().gamma().value_in_radians(), "CrystalStructure::read_binary() 04" );
+    test_suite.test_equality( restored.natoms(), crystal_structure.natoms(), "CrystalStructure::read_binary() 05" );
+    test_suite.test_equality( restored.suppressed( 3 ), true, "CrystalStructure::read_binary() 06" );
+    test_suite.test_equality( restored.atom( 1 ).element(), Element( "D" ), "CrystalStructure::read_binary() 07" );
+    test_suite.test_equality( restored.atom( 1 ).position().x(), crystal_structure.atom( 1 ).position().x(), "CrystalStructure::read_binary() 08" );
+    test_suite.test_equality( restored.atom( 1 ).ADPs_type(), Atom::ANISOTROPIC, "CrystalStructure::read_binary() 09" );
+    test_suite.test_equality( restored.atom( 1 ).anisotropic_displacement_parameters().value( 1, 2 ), 0.003, "CrystalStructure::read_binary() 10" );
+    test_suite.test_equality( restored.atom( 0 ).Uiso(), 0.025, "CrystalStructure::read_binary() 11" );
+    test_suite.test_equality( restored.atom( 0 ).charge(), -0.25, "CrystalStructure::read_binary() 12" );
+    test_suite.test_equality( restored.atom( 2 ).occupancy(), 0.5, "CrystalStructure::read_binary() 13" );
+    test_suite.test_equality( restored.nmolecules(), crystal_structure.nmolecules(), "CrystalStructure::read_binary() 14" );
+    test_suite.test_equality( restored.molecule_in_crystal( 0 ).natoms(), crystal_structure.molecule_in_crystal( 0 ).natoms(), "CrystalStructure::read_binary() 15" );
+    // The bonds must have been restored as well, so update_molecules() must give the same result
+    Atom moved_atom( crystal_structure.atom( 2 ) );
+    moved_atom.set_position( Vector3D( 0.1, 0.2 + 1.0 / 22.0, 0.3 ) );
+    crystal_structure.set_atom( 2, moved_atom );
+    restored.set_atom( 2, moved_atom );
+    crystal_structure.update_molecules( std::vector< size_t >( 1, 2 ) );
+    restored.update_molecules( std::vector< size_t >( 1, 2 ) );
+    test_suite.test_equality( restored.nmolecules(), crystal_structure.nmolecules(), "CrystalStructure::read_binary() 16" );
+    bool exception_thrown( false );
+    try
+    {
+        FileName not_a_snapshot( "", "test_crystal_structure_snapshot", "txt" );
+        crystal_structure.save_xyz( not_a_snapshot );
+        try { restored.read_binary( not_a_snapshot ); } catch ( std::exception & ) { exception_thrown = true; }
+        std::remove( not_a_snapshot.full_name().c_str() );
+    }
+    catch ( std::exception & ) {}
+    test_suite.test_equality( exception_thrown, true, "CrystalStructure::read_binary() 17" );
+    test_suite.test_equality( restored.natoms(), size_t( 8 ), "CrystalStructure::read_binary() 18" );
+    }
+    {
+    // Label index and unique labels
+    CrystalStructure crystal_structure;
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.1, 0.1, 0.1 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.2, 0.1, 0.1 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "N" ), Vector3D( 0.3, 0.1, 0.1 ), "N1" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.4, 0.1, 0.1 ), "C2" ) );
+    crystal_structure.add_atom( Atom( Element( "N" ), Vector3D( 0.5, 0.1, 0.1 ), "N1" ) );
+    test_suite.test_equality( crystal_structure.find_label( "C1" ), size_t( 0 ), "CrystalStructure::find_label() 01" );
+    test_suite.test_equality( crystal_structure.find_label( "C11" ), crystal_structure.natoms(), "CrystalStructure::find_label() 02" );
+    test_suite.test_equality( crystal_structure.atom( "C2" ), size_t( 3 ), "CrystalStructure::atom( label ) 01" );
+    // The index must follow changes to the atoms
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 0.6, 0.1, 0.1 ), "O1" ) );
+    test_suite.test_equality( crystal_structure.find_label( "O1" ), size_t( 5 ), "CrystalStructure::find_label() 03" );
+    Atom relabelled_atom( crystal_structure.atom( 5 ) );
+    relabelled_atom.set_label( "O2" );
+    crystal_structure.set_atom( 5, relabelled_atom );
+    test_suite.test_equality( crystal_structure.find_label( "O1" ), crystal_structure.natoms(), "CrystalStructure::find_label() 04" );
+    test_suite.test_equality( crystal_structure.find_label( "O2" ), size_t( 5 ), "CrystalStructure::find_label() 05" );
+    bool exception_thrown( false );
+    try { crystal_structure.atom( "O1" ); } catch ( std::exception & ) { exception_thrown = true; }
+    test_suite.test_equality( exception_thrown, true, "CrystalStructure::atom( label ) 02" );
+    crystal_structure.make_atom_labels_unique();
+    test_suite.test_equality( crystal_structure.atom( 0 ).label(), std::string( "C1" ), "CrystalStructure::make_atom_labels_unique() 01" );
+    // C1 and C2 are in use
+    test_suite.test_equality( crystal_structure.atom( 1 ).label(), std::string( "C3" ), "CrystalStructure::make_atom_labels_unique() 02" );
+    test_suite.test_equality( crystal_structure.atom( 2 ).label(), std::string( "N1" ), "CrystalStructure::make_atom_labels_unique() 03" );
+    test_suite.test_equality( crystal_structure.atom( 3 ).label(), std::string( "C2" ), "CrystalStructure::make_atom_labels_unique() 04" );
+    test_suite.test_equality( crystal_structure.atom( 4 ).label(), std::string( "N2" ), "CrystalStructure::make_atom_labels_unique() 05" );
+    test_suite.test_equality( crystal_structure.atom( 5 ).label(), std::string( "O2" ), "CrystalStructure::make_atom_labels_unique() 06" );
+    test_suite.test_equality( crystal_structure.find_label( "C3" ), size_t( 1 ), "CrystalStructure::make_atom_labels_unique() 07" );
+    test_suite.test_equality( crystal_structure.find_label( "N2" ), size_t( 4 ), "CrystalStructure::make_atom_labels_unique() 08" );
+    // The copy has its own index
+    CrystalStructure copy( crystal_structure );
+    copy.supercell( 1, 1, 2 );
+    test_suite.test_equality( copy.find_label( "C3_0_0_1" ), size_t( 7 ), "CrystalStructure::find_label() 06" );
+    test_suite.test_equality( crystal_structure.find_label( "C3_0_0_1" ), crystal_structure.natoms(), "CrystalStructure::find_label() 07" );
+    }
 }
 
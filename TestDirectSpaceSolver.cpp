@@ -0,0 +1,143 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "DirectSpaceSolver.h"
+#include "CrystalStructure.h"
+#include "FileName.h"
+#include "FlexibleMolecule.h"
+#include "Logger.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+FlexibleMolecule test_molecule()
+{
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 20.0, 20.0, 20.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    const char * elements[] = { "C", "C", "C", "C", "O", "N" };
+    const double coordinates[] = { 0.0, 0.0, 0.0, 1.5, 0.0, 0.0, 2.0, 1.41, 0.0, 3.5, 1.41, 0.0, 4.0, 2.82, 0.0, -0.5, -1.41, 0.0 };
+    for ( size_t i( 0 ); i != 6; ++i )
+    {
+        Atom atom( Element( elements[i] ), Vector3D( coordinates[3*i] / 20.0, coordinates[3*i+1] / 20.0, coordinates[3*i+2] / 20.0 ), std::string( elements[i] ) + size_t2string( i + 1 ) );
+        atom.set_Uiso( 0.03 );
+        crystal_structure.add_atom( atom );
+    }
+    return FlexibleMolecule( crystal_structure );
+}
+
+} // namespace
+
+void test_direct_space_solver( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for DirectSpaceSolver." << std::endl;
+    const CrystalLattice crystal_lattice( 9.1, 6.3, 11.7, Angle::angle_90_degrees(), Angle::from_degrees( 103.0 ), Angle::angle_90_degrees() );
+    {
+    FlexibleMolecule molecule = test_molecule();
+    molecule.add_rotatable_bonds();
+    std::vector< MoleculeState > true_states( 1 );
+    true_states[0].position_ = Vector3D( 0.23, 0.61, 0.14 );
+    true_states[0].orientation_ = Quaternion( 0.8, 0.3, -0.4, 0.2 );
+    true_states[0].torsion_changes_.push_back( Angle::from_degrees( 20.0 ) );
+    true_states[0].torsion_changes_.push_back( Angle::from_degrees( 70.0 ) );
+    true_states[0].torsion_changes_.push_back( Angle::from_degrees( -40.0 ) );
+    // The "experimental" pattern is calculated by PowderPatternCalculator for the true structure
+    PowderPattern experimental_pattern;
+    {
+    DirectSpaceSolver solver( crystal_lattice, SpaceGroup::P21c(), PowderPattern( Angle::from_degrees( 5.0 ), Angle::from_degrees( 30.0 ), Angle::from_degrees( 0.02 ) ) );
+    solver.add_molecule( molecule );
+    CrystalStructure asymmetric_unit = solver.crystal_structure( true_states );
+    test_suite.test_equality( asymmetric_unit.natoms(), size_t( 6 ), "DirectSpaceSolver::crystal_structure()" );
+    PowderPatternCalculator powder_pattern_calculator( asymmetric_unit, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 35.0 ) );
+    powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    powder_pattern_calculator.calculate( experimental_pattern );
+    }
+    DirectSpaceSolver solver( crystal_lattice, SpaceGroup::P21c(), experimental_pattern );
+    solver.add_molecule( molecule );
+    test_suite.test_equality_double( solver.Rwp( true_states ), 0.0, "DirectSpaceSolver::Rwp() true structure", 0.001 );
+    solver.set_nruns( 2 );
+    solver.set_ntrials( 2000 );
+    solver.set_nthreads( 1 );
+    // The timings would make the output of the tests differ from run to run
+    const Logger::Level level = Logger::instance().level();
+    Logger::instance().set_level( Logger::WARNING );
+    solver.solve();
+    test_suite.test_equality( solver.ntrials_total(), size_t( 4000 ), "DirectSpaceSolver::ntrials_total()" );
+    // The incremental updates during the annealing must agree with a calculation from scratch
+    test_suite.test_equality_double( solver.best_Rwp(), solver.Rwp( solver.best_states() ), "DirectSpaceSolver::solve() incremental updates", 1.0E-9 );
+    const double Rwp_one_thread = solver.best_Rwp();
+    solver.set_nthreads( 2 );
+    solver.solve();
+    test_suite.test_equality_double( solver.best_Rwp(), Rwp_one_thread, "DirectSpaceSolver::solve() independent of the number of threads", 0.0 );
+    // The finished runs are saved, solving again with the same settings only reads them back
+    const FileName checkpoint_file_name( "", "test_DirectSpaceSolver_checkpoint", "bin" );
+    solver.set_checkpoint( checkpoint_file_name );
+    solver.solve();
+    test_suite.test_equality( checkpoint_file_name.exists(), true, "DirectSpaceSolver::solve() checkpoint written" );
+    solver.solve();
+    test_suite.test_equality_double( solver.best_Rwp(), Rwp_one_thread, "DirectSpaceSolver::solve() resumed from checkpoint", 0.0 );
+    test_suite.test_equality_double( solver.trials_per_second_per_thread(), 0.0, "DirectSpaceSolver::solve() no runs left", 0.0 );
+    std::remove( checkpoint_file_name.full_name().c_str() );
+    Logger::instance().set_level( level );
+    }
+    {
+    // A rigid molecule, long enough to find the structure
+    const FlexibleMolecule molecule = test_molecule();
+    std::vector< MoleculeState > true_states( 1 );
+    true_states[0].position_ = Vector3D( 0.23, 0.61, 0.14 );
+    true_states[0].orientation_ = Quaternion( 0.8, 0.3, -0.4, 0.2 );
+    PowderPattern experimental_pattern;
+    {
+    DirectSpaceSolver solver( crystal_lattice, SpaceGroup::P21c(), PowderPattern( Angle::from_degrees( 5.0 ), Angle::from_degrees( 30.0 ), Angle::from_degrees( 0.02 ) ) );
+    solver.add_molecule( molecule );
+    CrystalStructure asymmetric_unit = solver.crystal_structure( true_states );
+    PowderPatternCalculator powder_pattern_calculator( asymmetric_unit, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 35.0 ) );
+    powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    powder_pattern_calculator.calculate( experimental_pattern );
+    }
+    DirectSpaceSolver solver( crystal_lattice, SpaceGroup::P21c(), experimental_pattern );
+    solver.add_molecule( molecule );
+    solver.set_nruns( 2 );
+    solver.set_ntrials( 50000 );
+    const Logger::Level level = Logger::instance().level();
+    Logger::instance().set_level( Logger::WARNING );
+    solver.solve();
+    Logger::instance().set_level( level );
+    test_suite.test_equality( solver.best_Rwp() < 0.05, true, "DirectSpaceSolver::solve() structure found" );
+    }
+}
+
@@ -0,0 +1,91 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "DrunkardsWalk.h"
+#include "Histogram.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+
+void test_DrunkardsWalk( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for DrunkardsWalk." << std::endl;
+
+    {
+    // Infinite grid: the mean squared displacement after n steps is n
+    DrunkardsWalkEnsemble ensemble( 10000, GridPoint2D( 5, -3 ) );
+    ensemble.set_first_passage_distance( 1.0 );
+    ensemble.run( 100 );
+    test_suite.test_equality( ensemble.nsteps(), size_t( 100 ), "DrunkardsWalkEnsemble 01" );
+    test_suite.test_equality( std::abs( ensemble.mean_squared_displacement() - 100.0 ) < 5.0, true, "DrunkardsWalkEnsemble 02" );
+    bool all_one( true );
+    bool parity_correct( true );
+    for ( size_t i( 0 ); i != ensemble.nwalkers(); ++i )
+    {
+        all_one = all_one && ( ensemble.first_passage_time( i ) == 1 );
+        // After an even number of steps, x + y has the same parity as at the start
+        parity_correct = parity_correct && ( ( ( ensemble.position( i ).x_ + ensemble.position( i ).y_ ) % 2 ) == 0 );
+    }
+    test_suite.test_equality( all_one, true, "DrunkardsWalkEnsemble 03" );
+    test_suite.test_equality( parity_correct, true, "DrunkardsWalkEnsemble 04" );
+    Histogram histogram( 0.0, 50.0, 50 );
+    ensemble.add_displacements( histogram );
+    size_t total( histogram.lower_than_start() + histogram.greater_than_finish() );
+    for ( size_t i( 0 ); i != histogram.size(); ++i )
+        total += histogram.bin( i );
+    test_suite.test_equality( total, size_t( 10000 ), "DrunkardsWalkEnsemble 05" );
+    }
+
+    {
+    // 3x3 grid, a move off the grid is redrawn, so this is a random walk on a graph and the
+    // stationary distribution is proportional to the number of neighbours: 1/12 for a corner, 1/8 for an edge and 1/6 for the centre
+    DrunkardsWalkEnsemble ensemble( 20000, GridPoint2D( 0, 0 ), GridPoint2D( 2, 2 ), GridPoint2D( 0, 0 ), 17 );
+    ensemble.run( 50 );
+    size_t ncentre( 0 );
+    size_t nedge( 0 );
+    bool inside( true );
+    for ( size_t i( 0 ); i != ensemble.nwalkers(); ++i )
+    {
+        const GridPoint2D p = ensemble.position( i );
+        inside = inside && ( p.x_ >= 0 ) && ( p.x_ <= 2 ) && ( p.y_ >= 0 ) && ( p.y_ <= 2 );
+        if ( ( p.x_ == 1 ) && ( p.y_ == 1 ) )
+            ++ncentre;
+        if ( ( ( p.x_ + p.y_ ) % 2 ) == 1 )
+            ++nedge;
+    }
+    test_suite.test_equality( inside, true, "DrunkardsWalkEnsemble 06" );
+    // The grid is bipartite, after an even number of steps only the corners and the centre are occupied
+    test_suite.test_equality( nedge, size_t( 0 ), "DrunkardsWalkEnsemble 07" );
+    // The centre has 4 / ( 4 + 4 * 2 ) = 1/3 of the weight of the corners and the centre
+    test_suite.test_equality( std::abs( static_cast<double>( ncentre ) / ensemble.nwalkers() - 1.0 / 3.0 ) < 0.015, true, "DrunkardsWalkEnsemble 08" );
+    }
+
+}
+
@@ -0,0 +1,86 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "DuplicateFinder.h"
+#include "CrystalStructure.h"
+
+#include "TestFixtures.h"
+#include "TestSuite.h"
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+CrystalStructure test_structure( const double a, const Vector3D & shift, const bool move_atom )
+{
+    CrystalStructure crystal_structure = P21c_test_asymmetric_unit( CrystalLattice( a, 9.3, 11.7, Angle::angle_90_degrees(), Angle::from_degrees( 103.4 ), Angle::angle_90_degrees() ) );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    {
+        Atom atom = crystal_structure.atom( i );
+        atom.set_position( atom.position() + shift );
+        if ( move_atom && ( i == 2 ) )
+            atom.set_position( Vector3D( 0.71, 0.47, 0.83 ) );
+        crystal_structure.set_atom( i, atom );
+    }
+    crystal_structure.apply_space_group_symmetry();
+    return crystal_structure;
+}
+
+} // namespace
+
+void test_duplicate_finder( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for DuplicateFinder." << std::endl;
+    std::vector< CrystalStructure > crystal_structures;
+    crystal_structures.push_back( test_structure( 7.1, Vector3D(), false ) );
+    // Slightly perturbed copy
+    crystal_structures.push_back( test_structure( 7.1, Vector3D( 0.002, -0.001, 0.001 ), false ) );
+    // Different density
+    crystal_structures.push_back( test_structure( 8.1, Vector3D(), false ) );
+    // Same cell, different structure
+    crystal_structures.push_back( test_structure( 7.1, Vector3D(), true ) );
+    // Exact copy
+    crystal_structures.push_back( test_structure( 7.1, Vector3D(), false ) );
+    DuplicateFinder duplicate_finder;
+    duplicate_finder.set_nthreads( 2 );
+    std::vector< size_t > groups = duplicate_finder.find_duplicates( crystal_structures );
+    std::vector< size_t > target;
+    target.push_back( 0 );
+    target.push_back( 0 );
+    target.push_back( 1 );
+    target.push_back( 2 );
+    target.push_back( 0 );
+    test_suite.test_equality( groups == target, true, "DuplicateFinder::find_duplicates()" );
+    // Structure 2 is outside the density window of all others
+    test_suite.test_equality( duplicate_finder.npairs( DuplicateFinder::CANDIDATES ), size_t( 6 ), "DuplicateFinder::npairs() 01" );
+    // Every stage sees at most the pairs of the stage before it
+    test_suite.test_equality( duplicate_finder.npairs( DuplicateFinder::RMSCD ) <= duplicate_finder.npairs( DuplicateFinder::PATTERN ), true, "DuplicateFinder::npairs() 02" );
+    test_suite.test_equality( duplicate_finder.nduplicates() >= 2, true, "DuplicateFinder::nduplicates()" );
+}
+
@@ -0,0 +1,107 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "Element.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+void test_element( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for Element." << std::endl;
+    {
+    bool all_correct( true );
+    for ( size_t i( 1 ); i != 95; ++i )
+    {
+        Element element( i );
+        if ( Element( element.symbol() ).id() != i )
+            all_correct = false;
+    }
+    test_suite.test_equality( all_correct, true, "Element::Element( std::string ) all symbols" );
+    }
+    test_suite.test_equality( Element( "D" ).id(), size_t( 0 ), "Element::Element( std::string ) D" );
+    test_suite.test_equality( Element( "h" ).id(), size_t( 1 ), "Element::Element( std::string ) h" );
+    test_suite.test_equality( Element( "CL" ).id(), size_t( 17 ), "Element::Element( std::string ) CL" );
+    test_suite.test_equality( Element( "cN" ).id(), size_t( 112 ), "Element::Element( std::string ) cN" );
+    {
+    const std::string word( "xx Fe yy" );
+    test_suite.test_equality( Element( word.data() + 3, word.data() + 5 ).id(), size_t( 26 ), "Element::Element( const char *, const char * )" );
+    }
+    {
+    bool exception_thrown( false );
+    try { Element element( "Xx" ); } catch ( std::runtime_error & ) { exception_thrown = true; }
+    test_suite.test_equality( exception_thrown, true, "Element::Element( std::string ) Xx" );
+    exception_thrown = false;
+    try { Element element( "C1" ); } catch ( std::runtime_error & ) { exception_thrown = true; }
+    test_suite.test_equality( exception_thrown, true, "Element::Element( std::string ) C1" );
+    exception_thrown = false;
+    try { Element element( "Fe3+" ); } catch ( std::runtime_error & ) { exception_thrown = true; }
+    test_suite.test_equality( exception_thrown, true, "Element::Element( std::string ) Fe3+" );
+    }
+    test_suite.test_equality( element_from_atom_label( "C3  " ), Element( "C" ), "element_from_atom_label() C3" );
+    test_suite.test_equality( element_from_atom_label( " Cl12" ), Element( "Cl" ), "element_from_atom_label() Cl12" );
+    test_suite.test_equality( element_from_atom_label( "C_3" ), Element( "C" ), "element_from_atom_label() C_3" );
+    test_suite.test_equality( element_from_atom_label( "Ow14" ), Element( "O" ), "element_from_atom_label() Ow14" );
+    test_suite.test_equality( element_from_atom_label( "D1" ), Element( "D" ), "element_from_atom_label() D1" );
+    {
+    const std::string word( "N12 extra" );
+    test_suite.test_equality( element_from_atom_label( word.data(), word.data() + 3 ), Element( "N" ), "element_from_atom_label( const char *, const char * )" );
+    }
+    {
+    // Neutron scattering lengths do not depend on sin(theta)/lambda, H is negative and H and D are different
+    test_suite.test_equality_double( Element( "C" ).scattering_factor( 0.0, NEUTRONS ), 6.646, "Element::scattering_factor() neutrons C" );
+    test_suite.test_equality_double( Element( "C" ).scattering_factor( 0.5, NEUTRONS ), 6.646, "Element::scattering_factor() neutrons C 0.5" );
+    test_suite.test_equality_double( Element( "H" ).scattering_factor( 0.3, NEUTRONS ), -3.739, "Element::scattering_factor() neutrons H" );
+    test_suite.test_equality_double( Element( "D" ).scattering_factor( 0.3, NEUTRONS ), 6.671, "Element::scattering_factor() neutrons D" );
+    test_suite.test_equality_double( Element( "D" ).scattering_factor_derivative( 0.3, NEUTRONS ), 0.0, "Element::scattering_factor_derivative() neutrons D" );
+    bool exception_thrown( false );
+    try { Element( "Pu" ).scattering_factor( 0.0, NEUTRONS ); } catch ( std::runtime_error & ) { exception_thrown = true; }
+    test_suite.test_equality( exception_thrown, true, "Element::scattering_factor() neutrons Pu" );
+    // Electrons: the Mott-Bethe formula is continuous at sin(theta)/lambda = 0 and the derivative matches a finite difference
+    const Element elements[3] = { Element( "H" ), Element( "C" ), Element( "Cl" ) };
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        const std::string name = elements[i].symbol();
+        test_suite.test_equality_double( elements[i].scattering_factor( 0.0, ELECTRONS ), elements[i].scattering_factor( 1.0E-5, ELECTRONS ), "Element::scattering_factor() electrons s = 0 " + name, 1.0E-6 );
+        test_suite.test_equality( elements[i].scattering_factor( 0.0, ELECTRONS ) > elements[i].scattering_factor( 0.5, ELECTRONS ), true, "Element::scattering_factor() electrons decreasing " + name );
+        const double s_values[3] = { 0.001, 0.2, 0.8 };
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            const double h = 1.0E-6;
+            const double numerical = ( elements[i].scattering_factor( s_values[j] + h, ELECTRONS ) - elements[i].scattering_factor( s_values[j] - h, ELECTRONS ) ) / ( 2.0 * h );
+            test_suite.test_equality_double( elements[i].scattering_factor_derivative( s_values[j], ELECTRONS ), numerical, "Element::scattering_factor_derivative() electrons " + name + " " + double2string( s_values[j] ), 1.0E-4 );
+        }
+    }
+    // The electron scattering factor of C at sin(theta)/lambda = 0 is about 2.5 Angstrom
+    test_suite.test_equality( nearly_equal( elements[1].scattering_factor( 0.0, ELECTRONS ), 2.5, 0.2 ), true, "Element::scattering_factor() electrons C" );
+    }
+}
@@ -0,0 +1,112 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "EwaldSummation.h"
+#include "CrystalLattice.h"
+#include "PhysicalConstants.h"
+#include "RandomNumberGenerator.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <vector>
+
+void test_Ewald_summation( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for EwaldSummation." << std::endl;
+    {
+    // Rock salt, Madelung constant 1.747564594633 for the nearest-neighbour distance a/2
+    const double a = 5.64;
+    const CrystalLattice crystal_lattice( a, a, a, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+    std::vector< Vector3D > positions;
+    std::vector< double > charges;
+    const Vector3D centring[] = { Vector3D( 0.0, 0.0, 0.0 ), Vector3D( 0.0, 0.5, 0.5 ), Vector3D( 0.5, 0.0, 0.5 ), Vector3D( 0.5, 0.5, 0.0 ) };
+    for ( size_t i( 0 ); i != 4; ++i )
+    {
+        positions.push_back( centring[i] );
+        charges.push_back( 1.0 );
+        positions.push_back( centring[i] + Vector3D( 0.5, 0.0, 0.0 ) );
+        charges.push_back( -1.0 );
+    }
+    const double expected = -4.0 * 1.747564594633 * Coulomb_constant / ( 0.5 * a );
+    EwaldSummation Ewald_summation( crystal_lattice, positions, charges );
+    Ewald_summation.set_reciprocal_space_method( EwaldSummation::EWALD );
+    test_suite.test_equality_double( Ewald_summation.energy().total() / expected, 1.0, "EwaldSummation::energy() NaCl EWALD", 1.0E-5 );
+    Ewald_summation.set_reciprocal_space_method( EwaldSummation::SMOOTH_PME );
+    test_suite.test_equality_double( Ewald_summation.energy().total() / expected, 1.0, "EwaldSummation::energy() NaCl SMOOTH_PME", 1.0E-5 );
+    // A cutoff of less than half the unit cell, the larger alpha needs a finer grid
+    Ewald_summation.set_real_space_cutoff( 2.5 );
+    Ewald_summation.set_grid_spacing( 0.3 );
+    test_suite.test_equality_double( Ewald_summation.energy().total() / expected, 1.0, "EwaldSummation::energy() NaCl short cutoff SMOOTH_PME", 1.0E-5 );
+    Ewald_summation.set_reciprocal_space_method( EwaldSummation::EWALD );
+    test_suite.test_equality_double( Ewald_summation.energy().total() / expected, 1.0, "EwaldSummation::energy() NaCl short cutoff EWALD", 1.0E-5 );
+    }
+    {
+    // A neutral triclinic cell with random charges: both methods and all cutoffs must agree, the split between the terms must not matter
+    const CrystalLattice crystal_lattice( 7.3, 9.1, 11.8, Angle::from_degrees( 82.0 ), Angle::from_degrees( 103.0 ), Angle::from_degrees( 95.0 ) );
+    RandomNumberGenerator_double random_number_generator;
+    std::vector< Vector3D > positions;
+    std::vector< double > charges;
+    double sum_of_charges( 0.0 );
+    for ( size_t i( 0 ); i != 40; ++i )
+    {
+        positions.push_back( Vector3D( random_number_generator.next_number(), random_number_generator.next_number(), random_number_generator.next_number() ) );
+        charges.push_back( random_number_generator.next_number() - 0.5 );
+        sum_of_charges += charges.back();
+    }
+    for ( size_t i( 0 ); i != charges.size(); ++i )
+        charges[i] -= sum_of_charges / charges.size();
+    EwaldSummation Ewald_summation( crystal_lattice, positions, charges );
+    Ewald_summation.set_reciprocal_space_method( EwaldSummation::EWALD );
+    const double reference = Ewald_summation.energy().total();
+    Ewald_summation.set_real_space_cutoff( 14.0 );
+    test_suite.test_equality_double( Ewald_summation.energy().total(), reference, "EwaldSummation::energy() EWALD cutoff", 1.0E-5 * std::abs( reference ) );
+    Ewald_summation.set_reciprocal_space_method( EwaldSummation::SMOOTH_PME );
+    Ewald_summation.set_real_space_cutoff( 9.0 );
+    Ewald_summation.set_nthreads( 1 );
+    const EwaldEnergy PME_energy = Ewald_summation.energy();
+    test_suite.test_equality_double( PME_energy.total(), reference, "EwaldSummation::energy() SMOOTH_PME", 1.0E-5 * std::abs( reference ) );
+    Ewald_summation.set_nthreads( 3 );
+    test_suite.test_equality( Ewald_summation.energy().total(), PME_energy.total(), "EwaldSummation::energy() number of threads" );
+    Ewald_summation.set_summation_mode( REPRODUCIBLE_SUMMATION );
+    const double reproducible_total = Ewald_summation.energy().total();
+    test_suite.test_equality_double( reproducible_total, PME_energy.total(), "EwaldSummation::energy() REPRODUCIBLE_SUMMATION", 1.0E-10 * std::abs( reference ) );
+    Ewald_summation.set_nthreads( 1 );
+    test_suite.test_equality( Ewald_summation.energy().total(), reproducible_total, "EwaldSummation::energy() REPRODUCIBLE_SUMMATION number of threads" );
+    }
+    {
+    // A net charge is compensated by a uniform background, the total does not depend on alpha
+    const CrystalLattice crystal_lattice( 6.0, 7.0, 8.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+    const std::vector< Vector3D > positions( 1, Vector3D( 0.1, 0.2, 0.3 ) );
+    const std::vector< double > charges( 1, 1.0 );
+    EwaldSummation Ewald_summation( crystal_lattice, positions, charges );
+    Ewald_summation.set_reciprocal_space_method( EwaldSummation::EWALD );
+    const double reference = Ewald_summation.energy().total();
+    Ewald_summation.set_real_space_cutoff( 5.0 );
+    test_suite.test_equality_double( Ewald_summation.energy().total(), reference, "EwaldSummation::energy() net charge", 1.0E-5 * std::abs( reference ) );
+    }
+}
@@ -0,0 +1,85 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "FileList.h"
+#include "FileName.h"
+#include "TextFileWriter.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+void test_file_list( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for FileList." << std::endl;
+    const std::string directory( "test_file_list" );
+    mkdir( directory.c_str(), 0755 );
+    const char * names[] = { "frame_10.cif", "frame_9.cif", "frame_1.cif", "notes.txt", ".hidden.cif" };
+    for ( size_t i( 0 ); i != 5; ++i )
+    {
+        TextFileWriter text_file_writer( FileName( directory + "/" + names[i] ) );
+        text_file_writer.write_line( "data_test" );
+    }
+    mkdir( ( directory + "/subdirectory.cif" ).c_str(), 0755 );
+    FileList file_list;
+    file_list.initialise_from_directory( directory, "*.cif" );
+    test_suite.test_equality( file_list.size(), size_t( 3 ), "FileList::initialise_from_directory() 1" );
+    test_suite.test_equality( file_list.value( 0 ).file_name(), std::string( "frame_1" ), "FileList::initialise_from_directory() 2" );
+    test_suite.test_equality( file_list.value( 1 ).file_name(), std::string( "frame_9" ), "FileList::initialise_from_directory() 3" );
+    test_suite.test_equality( file_list.value( 2 ).file_name(), std::string( "frame_10" ), "FileList::initialise_from_directory() 4" );
+    file_list.push_back( FileName( "does_not_exist.cif" ) );
+    std::vector< FileStatus > status = file_list.status( 2 );
+    test_suite.test_equality( status.size(), size_t( 4 ), "FileList::status() 1" );
+    test_suite.test_equality( status[2].exists(), true, "FileList::status() 2" );
+    test_suite.test_equality( status[2].size(), size_t( 10 ), "FileList::status() 3" );
+    test_suite.test_equality( status[3].exists(), false, "FileList::status() 4" );
+    test_suite.test_equality( is_up_to_date( file_list.value( 0 ), file_list.value( 3 ) ), true, "is_up_to_date() 1" );
+    test_suite.test_equality( is_up_to_date( file_list.value( 3 ), file_list.value( 0 ) ), false, "is_up_to_date() 2" );
+    FileList unsorted;
+    unsorted.push_back( FileName( "b_2.cif" ) );
+    unsorted.push_back( FileName( "a_10.cif" ) );
+    unsorted.push_back( FileName( "a_2.cif" ) );
+    unsorted.sort_naturally();
+    test_suite.test_equality( unsorted.value( 0 ).file_name(), std::string( "a_2" ), "FileList::sort_naturally() 1" );
+    test_suite.test_equality( unsorted.value( 2 ).file_name(), std::string( "b_2" ), "FileList::sort_naturally() 2" );
+    FileList with_base_directory( "base", std::vector< FileName >( 1, FileName( "file.cif" ) ) );
+    with_base_directory.push_back( FileName( "other/file.cif" ) );
+    test_suite.test_equality( with_base_directory.value( 0 ).full_name(), std::string( "base/file.cif" ), "FileList::value() 1" );
+    test_suite.test_equality( with_base_directory.value( 1 ).full_name(), std::string( "other/file.cif" ), "FileList::value() 2" );
+    with_base_directory.set_prepend_file_name_with_basedirectory( false );
+    test_suite.test_equality( with_base_directory.value( 0 ).full_name(), std::string( "file.cif" ), "FileList::value() 3" );
+    for ( size_t i( 0 ); i != 5; ++i )
+        std::remove( ( directory + "/" + names[i] ).c_str() );
+    std::remove( ( directory + "/subdirectory.cif" ).c_str() );
+    std::remove( directory.c_str() );
+}
+
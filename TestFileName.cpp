@@ -40,5 +40,26 @@ void test_file_name( TestSuite & test_suite )
         test_suite.test_equality( result, std::string( "C:\\dir1\\file.txt" ), "FileName::FileName() 01" );
     }
 
+    {
+        FileName file_name( "dir1/./dir2/file.txt" );
+        test_suite.test_equality( file_name.full_name(), std::string( "dir1/dir2/file.txt" ), "FileName::FileName() 02" );
+        file_name.set_extension( "cif" );
+        test_suite.test_equality( file_name.full_name(), std::string( "dir1/dir2/file.cif" ), "FileName::set_extension() 01" );
+        file_name.set_file_name( "my file" );
+        test_suite.test_equality( file_name.full_name(), std::string( "\"dir1/dir2/my file.cif\"" ), "FileName::set_file_name() 01" );
+        file_name.set_directory( "" );
+        test_suite.test_equality( file_name.full_name(), std::string( "\"my file.cif\"" ), "FileName::set_directory() 01" );
+        file_name.set_slash_character( '\\' );
+        file_name.set_full_name( "a/b.c" );
+        test_suite.test_equality( file_name.full_name(), std::string( "a/b.c" ), "FileName::set_full_name() 01" );
+    }
+
+    {
+        FileName file_name( "a/b", "c", "d" );
+        file_name.set_slash_character( '\\' );
+        test_suite.test_equality( file_name.full_name(), std::string( "a\\b\\c.d" ), "FileName::set_slash_character() 01" );
+        test_suite.test_equality( FileName().full_name(), std::string( "" ), "FileName::FileName() 03" );
+    }
+
 }
 
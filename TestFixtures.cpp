@@ -0,0 +1,74 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "TestFixtures.h"
+#include "CrystalStructure.h"
+#include "PowderPattern.h"
+#include "SpaceGroup.h"
+#include "Utilities.h"
+
+#include <string>
+
+// ********************************************************************************
+
+CrystalStructure P21c_test_asymmetric_unit( const CrystalLattice & crystal_lattice )
+{
+    CrystalStructure result;
+    result.set_crystal_lattice( crystal_lattice );
+    result.set_space_group( SpaceGroup::P21c() );
+    const char * elements[] = { "C", "N", "O", "C", "C" };
+    const double coordinates[] = { 0.11, 0.23, 0.37, 0.62, 0.08, 0.29, 0.41, 0.77, 0.13, 0.86, 0.52, 0.68, 0.27, 0.44, 0.91 };
+    for ( size_t i( 0 ); i != 5; ++i )
+        result.add_atom( Atom( Element( elements[i] ), Vector3D( coordinates[3*i], coordinates[3*i+1], coordinates[3*i+2] ), std::string( elements[i] ) + size_t2string( i + 1 ) ) );
+    return result;
+}
+
+// ********************************************************************************
+
+CrystalStructure P21c_test_structure( const CrystalLattice & crystal_lattice )
+{
+    CrystalStructure result = P21c_test_asymmetric_unit( crystal_lattice );
+    result.apply_space_group_symmetry();
+    return result;
+}
+
+// ********************************************************************************
+
+PowderPattern crop_to_two_theta_end( const PowderPattern & powder_pattern, const Angle two_theta_end )
+{
+    PowderPattern result( powder_pattern.two_theta_start(), two_theta_end, powder_pattern.average_two_theta_step() );
+    for ( size_t i( 0 ); i != result.size(); ++i )
+    {
+        result.set_intensity( i, powder_pattern.intensity( i ) );
+        result.set_estimated_standard_deviation( i, powder_pattern.estimated_standard_deviation( i ) );
+    }
+    result.set_wavelength( powder_pattern.wavelength() );
+    return result;
+}
+
+// ********************************************************************************
+
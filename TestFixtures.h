@@ -0,0 +1,52 @@
+#ifndef TESTFIXTURES_H
+#define TESTFIXTURES_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+class Angle;
+class CrystalLattice;
+class CrystalStructure;
+class PowderPattern;
+
+/*
+  Test data shared by the tests of more than one class.
+*/
+
+// Five atoms on general positions in P2_1/c, without the space-group symmetry applied.
+CrystalStructure P21c_test_asymmetric_unit( const CrystalLattice & crystal_lattice );
+
+// P21c_test_asymmetric_unit() with the space-group symmetry applied.
+CrystalStructure P21c_test_structure( const CrystalLattice & crystal_lattice );
+
+// The points of powder_pattern from its start up to two_theta_end, with their ESDs and the wavelength.
+PowderPattern crop_to_two_theta_end( const PowderPattern & powder_pattern, const Angle two_theta_end );
+
+#endif // TESTFIXTURES_H
+
@@ -0,0 +1,82 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "FlexibleMolecule.h"
+#include "CrystalStructure.h"
+#include "Matrix3D.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+void test_flexible_molecule( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for FlexibleMolecule." << std::endl;
+    // N6-C1-C2-C3-C4-O5, planar zigzag
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 20.0, 20.0, 20.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    const char * elements[] = { "C", "C", "C", "C", "O", "N" };
+    const double coordinates[] = { 0.0, 0.0, 0.0, 1.5, 0.0, 0.0, 2.0, 1.41, 0.0, 3.5, 1.41, 0.0, 4.0, 2.82, 0.0, -0.5, -1.41, 0.0 };
+    for ( size_t i( 0 ); i != 6; ++i )
+        crystal_structure.add_atom( Atom( Element( elements[i] ), Vector3D( coordinates[3*i] / 20.0, coordinates[3*i+1] / 20.0, coordinates[3*i+2] / 20.0 ), std::string( elements[i] ) + size_t2string( i + 1 ) ) );
+    {
+    FlexibleMolecule molecule( crystal_structure );
+    test_suite.test_equality( molecule.natoms(), size_t( 6 ), "FlexibleMolecule::natoms()" );
+    test_suite.test_equality_double( ( molecule.atom( 0 ).position() - molecule.atom( 1 ).position() ).length(), 1.5, "FlexibleMolecule::FlexibleMolecule() Cartesian" );
+    molecule.add_rotatable_bonds();
+    test_suite.test_equality( molecule.ntorsions(), size_t( 3 ), "FlexibleMolecule::add_rotatable_bonds() 01" );
+    test_suite.test_equality( molecule.moving_atoms( 1 ).size(), size_t( 2 ), "FlexibleMolecule::add_rotatable_bonds() 02" );
+    std::vector< Angle > torsion_changes( 3 );
+    std::vector< Vector3D > before;
+    molecule.generate( Matrix3D(), torsion_changes, before );
+    torsion_changes[1] = Angle::angle_180_degrees();
+    std::vector< Vector3D > after;
+    molecule.generate( Matrix3D(), torsion_changes, after );
+    test_suite.test_equality_double( ( after[3] - after[2] ).length(), 1.5, "FlexibleMolecule::generate() bond length" );
+    test_suite.test_equality_double( ( after[1] - after[2] ).length(), ( before[1] - before[2] ).length(), "FlexibleMolecule::generate() fixed atoms" );
+    test_suite.test_equality( ( ( after[0] - after[3] ).length() < ( before[0] - before[3] ).length() - 0.5 ), true, "FlexibleMolecule::generate() torsion" );
+    }
+    {
+    FlexibleMolecule molecule( crystal_structure );
+    bool thrown( false );
+    try
+    {
+        molecule.add_torsion( 0, 2 );
+    }
+    catch ( std::exception & e )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "FlexibleMolecule::add_torsion() not bonded" );
+    molecule.add_torsion( 1, 0 );
+    test_suite.test_equality( molecule.moving_atoms( 0 ).size(), size_t( 1 ), "FlexibleMolecule::add_torsion()" );
+    }
+}
+
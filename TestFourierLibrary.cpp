@@ -0,0 +1,99 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "CrystalStructure.h"
+#include "FileName.h"
+#include "FourierLibrary.h"
+#include "RunBenchmarks.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void test_Fourier_library( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for FourierLibrary." << std::endl;
+
+    std::vector< std::string > cif_file_names;
+    for ( size_t n( 1 ); n != 3; ++n )
+    {
+        FileName file_name( "", "test_Fourier_library_" + size_t2string( n, 1 ), "cif" );
+        synthetic_molecular_crystal( n ).save_cif( file_name );
+        cif_file_names.push_back( file_name.full_name() );
+    }
+    {
+    PowderPatternEngine powder_pattern_engine;
+    powder_pattern_engine.set_two_theta_range( 5.0, 25.0, 0.02 );
+    powder_pattern_engine.set_nthreads( 2 );
+    powder_pattern_engine.calculate( cif_file_names );
+    test_suite.test_equality( powder_pattern_engine.npatterns(), size_t( 2 ), "PowderPatternEngine::npatterns()" );
+    test_suite.test_equality( powder_pattern_engine.npoints(), size_t( 1001 ), "PowderPatternEngine::npoints()" );
+    test_suite.test_equality_double( powder_pattern_engine.two_theta( 1000 ), 25.0, "PowderPatternEngine::two_theta()" );
+    test_suite.test_equality( powder_pattern_engine.intensities( 1 ).size(), size_t( 1001 ), "PowderPatternEngine::intensities()" );
+    std::vector< double > similarity_matrix = powder_pattern_engine.similarity_matrix();
+    test_suite.test_equality( similarity_matrix.size(), size_t( 4 ), "PowderPatternEngine::similarity_matrix() 01" );
+    test_suite.test_equality_double( similarity_matrix[0], 1.0, "PowderPatternEngine::similarity_matrix() 02" );
+    test_suite.test_equality_double( similarity_matrix[1], similarity_matrix[2], "PowderPatternEngine::similarity_matrix() 03" );
+    test_suite.test_equality( similarity_matrix[1] < 1.0, true, "PowderPatternEngine::similarity_matrix() 04" );
+    const double * intensity_matrix = powder_pattern_engine.intensity_matrix();
+    test_suite.test_equality_double( intensity_matrix[ 1001 + 500 ], powder_pattern_engine.intensities( 1 )[500], "PowderPatternEngine::intensity_matrix()" );
+    std::vector< double > result( 4 );
+    ::similarity_matrix( intensity_matrix, 2, 1001, 0.02, 1.0, &result[0] );
+    test_suite.test_equality_double( result[0], 1.0, "similarity_matrix() 01" );
+    test_suite.test_equality_double( result[1], result[2], "similarity_matrix() 02" );
+    test_suite.test_equality( std::abs( result[1] - similarity_matrix[1] ) < 0.01, true, "similarity_matrix() 03" );
+    }
+    {
+    CrystalStructureEngine crystal_structure_engine;
+    crystal_structure_engine.read( cif_file_names );
+    test_suite.test_equality( crystal_structure_engine.size(), size_t( 2 ), "CrystalStructureEngine::size()" );
+    test_suite.test_equality( crystal_structure_engine.natoms( 1 ), size_t( 96 ), "CrystalStructureEngine::natoms()" );
+    test_suite.test_equality_double( crystal_structure_engine.density( 0 ), crystal_structure_engine.density( 1 ), "CrystalStructureEngine::density()" );
+    std::vector< double > void_volumes = crystal_structure_engine.void_volumes( 1.2, 0.3 );
+    test_suite.test_equality( void_volumes.size(), size_t( 2 ), "CrystalStructureEngine::void_volumes()" );
+    std::vector< double > lattice_parameters( 6 );
+    crystal_structure_engine.lattice_parameters( 0, &lattice_parameters[0] );
+    test_suite.test_equality( ( lattice_parameters[0] > 0.0 ) && ( lattice_parameters[3] > 0.0 ) && ( lattice_parameters[3] < 180.0 ), true, "CrystalStructureEngine::lattice_parameters()" );
+    std::vector< double > fractional_coordinates( 3 * crystal_structure_engine.natoms( 1 ) );
+    crystal_structure_engine.fractional_coordinates( 1, &fractional_coordinates[0] );
+    test_suite.test_equality( ( fractional_coordinates.back() >= 0.0 ) && ( fractional_coordinates.back() < 1.0 ), true, "CrystalStructureEngine::fractional_coordinates()" );
+    test_suite.test_equality( crystal_structure_engine.element( 1, 0 ).empty(), false, "CrystalStructureEngine::element()" );
+    test_suite.test_equality_double( crystal_structure_engine.RMSCD( 1, 1 ), 0.0, "CrystalStructureEngine::RMSCD()" );
+    std::vector< double > RMSCD_matrix( 4 );
+    crystal_structure_engine.RMSCD_matrix( &RMSCD_matrix[0] );
+    test_suite.test_equality_double( RMSCD_matrix[3], 0.0, "CrystalStructureEngine::RMSCD_matrix() 01" );
+    test_suite.test_equality_double( RMSCD_matrix[1], RMSCD_matrix[2], "CrystalStructureEngine::RMSCD_matrix() 02" );
+    }
+    for ( size_t i( 0 ); i != cif_file_names.size(); ++i )
+        std::remove( cif_file_names[i].c_str() );
+}
+
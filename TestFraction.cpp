@@ -26,9 +26,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "Fraction.h"
+#include "MathFunctions.h"
+#include "UnreducedFraction.h"
 #include "TestSuite.h"
 
+#include <climits>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 
 namespace
@@ -47,11 +51,6 @@ namespace
         test_suite.test_equality( fraction.denominator(),  denominator,  error_message + " (denominator)" );
     }
 
-    int round_to_int( double x )
-    {
-        return ( x < 0 ) ? static_cast<int>( x - 0.5 ) : static_cast<int>( x + 0.5 );
-    }
-
 }
 
 void test_fraction( TestSuite & test_suite )
@@ -1084,5 +1083,91 @@ void test_fraction( TestSuite & test_suite )
     }
 }
 
+// binary_greatest_common_divisor()
+{
+    bool all_correct( true );
+    for ( int i( 0 ); i != 200; ++i )
+    {
+        for ( int j( 0 ); j < 200; j += 7 )
+        {
+            if ( binary_greatest_common_divisor( i, j ) != static_cast< uint64_t >( greatest_common_divisor( i, j ) ) )
+                all_correct = false;
+        }
+    }
+    test_suite.test_equality( all_correct, true, "binary_greatest_common_divisor() 01" );
+    test_suite.test_equality( binary_greatest_common_divisor( 0, 0 ), uint64_t( 0 ), "binary_greatest_common_divisor() 02" );
+    test_suite.test_equality( binary_greatest_common_divisor( uint64_t( 3 ) << 40, uint64_t( 9 ) << 35 ), uint64_t( 3 ) << 35, "binary_greatest_common_divisor() 03" );
+}
+// UnreducedFraction
+{
+    // A chain of operations gives the same result as Fraction (with more steps, the intermediate results of Fraction overflow an int)
+    Fraction fraction( 1, 3 );
+    UnreducedFraction unreduced_fraction( fraction );
+    for ( int i( 1 ); i != 7; ++i )
+    {
+        fraction += Fraction( i, 4 * i + 2 );
+        fraction *= Fraction( 2 * i + 1, i + 1 );
+        fraction -= Fraction( 5, 7 );
+        fraction /= Fraction( 3, 2 );
+        unreduced_fraction += UnreducedFraction( i, 4 * i + 2 );
+        unreduced_fraction *= UnreducedFraction( 2 * i + 1, i + 1 );
+        unreduced_fraction -= UnreducedFraction( 5, 7 );
+        unreduced_fraction /= UnreducedFraction( 3, 2 );
+    }
+    test_suite.test_equality( unreduced_fraction.to_fraction() == fraction, true, "UnreducedFraction 01" );
+    test_suite.test_equality( unreduced_fraction == UnreducedFraction( fraction ), true, "UnreducedFraction 02" );
+    // Products that would overflow without reducing
+    UnreducedFraction product( 1 );
+    for ( int i( 0 ); i != 100; ++i )
+    {
+        product *= UnreducedFraction( 1000003, 999983 );
+        product *= UnreducedFraction( 999983, 1000003 );
+    }
+    test_one_fraction( test_suite, product.to_fraction(), 1, 0, 1, "UnreducedFraction 03" );
+    UnreducedFraction sum( 0 );
+    for ( int i( 0 ); i != 100; ++i )
+    {
+        sum += UnreducedFraction( 1, 6 );
+        sum -= UnreducedFraction( 1, 12 );
+    }
+    test_one_fraction( test_suite, sum.to_fraction(), 8, 1, 3, "UnreducedFraction 04" );
+    test_one_fraction( test_suite, UnreducedFraction( -22, 6 ).to_fraction(), -3, -2, 3, "UnreducedFraction 05" );
+    test_one_fraction( test_suite, UnreducedFraction( 22, -6 ).to_fraction(), -3, -2, 3, "UnreducedFraction 06" );
+    UnreducedFraction power( -2, 3 );
+    power.power( -5 );
+    test_one_fraction( test_suite, power.to_fraction(), -7, -19, 32, "UnreducedFraction power() 01" );
+    power = UnreducedFraction( 0 );
+    power.power( 0 );
+    test_one_fraction( test_suite, power.to_fraction(), 1, 0, 1, "UnreducedFraction power() 02" );
+    test_suite.test_equality( UnreducedFraction( 2, 6 ) == UnreducedFraction( 1, 3 ), true, "UnreducedFraction operator==()" );
+    test_suite.test_equality( UnreducedFraction( -1, 3 ) < UnreducedFraction( -1, 4 ), true, "UnreducedFraction operator<()" );
+    test_suite.test_equality( UnreducedFraction( 9, 3 ).is_integer(), true, "UnreducedFraction is_integer()" );
+    try
+    {
+        UnreducedFraction( 0 ).reciprocal();
+        test_suite.log_error( "UnreducedFraction::reciprocal() should have thrown" );
+    }
+    catch ( std::exception & e )
+    {
+    }
+    try
+    {
+        UnreducedFraction large( INT64_MAX / 3, 1 );
+        large *= UnreducedFraction( 5, 1 );
+        test_suite.log_error( "UnreducedFraction::operator*=() should have thrown" );
+    }
+    catch ( std::exception & e )
+    {
+    }
+    try
+    {
+        UnreducedFraction( int64_t( INT_MAX ) + 1, 1 ).to_fraction();
+        test_suite.log_error( "UnreducedFraction::to_fraction() should have thrown" );
+    }
+    catch ( std::exception & e )
+    {
+    }
+}
+
 }
 
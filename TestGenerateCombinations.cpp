@@ -28,16 +28,87 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "GenerateCombinations.h"
 
 #include "TestSuite.h"
+#include "Utilities.h"
 
 #include <iostream>
+#include <set>
+#include <vector>
 
 void test_GenerateCombinations( TestSuite & test_suite )
 {
     std::cout << "Now running tests for GenerateCombinations." << std::endl;
 
     {
- //   GenerateCombinations dummy();
- //   test_suite.test_equality( dummy, , "GenerateCombinations()" );
+    std::vector< size_t > values;
+    values.push_back( 3 );
+    values.push_back( 5 );
+    values.push_back( 7 );
+    GenerateCombinations generate_combinations( values, 2 );
+    std::vector< size_t > combination;
+    size_t ncombinations( 0 );
+    while ( generate_combinations.next_combination( combination ) )
+        ++ncombinations;
+    test_suite.test_equality( ncombinations, size_t( 3 ), "GenerateCombinations 01" );
+    }
+
+    {
+    test_suite.test_equality( binomial_coefficient( 9, 4 ), uint64_t( 126 ), "binomial_coefficient() 01" );
+    test_suite.test_equality( binomial_coefficient( 64, 32 ), uint64_t( 1832624140942590534ULL ), "binomial_coefficient() 02" );
+    test_suite.test_equality( binomial_coefficient( 5, 6 ), uint64_t( 0 ), "binomial_coefficient() 03" );
+    test_suite.test_equality( next_combination_bitmask( 0x7 ), uint64_t( 0xB ), "next_combination_bitmask() 01" );
+    test_suite.test_equality( next_combination_bitmask( 0xE ), uint64_t( 0x13 ), "next_combination_bitmask() 02" );
+    }
+
+    {
+    // Both orders: all C(n,k) distinct k-subsets, ranks 0, 1, 2, ..., revolving door swaps exactly one element
+    const size_t n( 10 );
+    const size_t k( 4 );
+    for ( size_t order( 0 ); order != 2; ++order )
+    {
+        CombinationBitmasks combinations( n, k, ( order == 0 ) ? CombinationBitmasks::LEXICOGRAPHIC : CombinationBitmasks::REVOLVING_DOOR );
+        std::set< uint64_t > seen;
+        uint64_t combination;
+        uint64_t removed;
+        uint64_t added;
+        uint64_t previous( 0 );
+        bool all_correct( combinations.size() == binomial_coefficient( n, k ) );
+        for ( uint64_t rank( 0 ); combinations.next_combination( combination, removed, added ); ++rank )
+        {
+            all_correct = all_correct && ( __builtin_popcountll( combination ) == static_cast<int>( k ) ) && ( combination < ( uint64_t( 1 ) << n ) );
+            all_correct = all_correct && ( combinations.rank( combination ) == rank ) && ( combinations.unrank( rank ) == combination );
+            all_correct = all_correct && ( ( ( previous & ~removed ) | added ) == combination );
+            if ( order == 0 )
+                all_correct = all_correct && ( combination > previous );
+            else if ( rank != 0 )
+                all_correct = all_correct && ( __builtin_popcountll( removed ) == 1 ) && ( __builtin_popcountll( added ) == 1 );
+            seen.insert( combination );
+            previous = combination;
+        }
+        test_suite.test_equality( all_correct, true, "CombinationBitmasks " + size_t2string( order, 2 ) + " 01" );
+        test_suite.test_equality( static_cast<uint64_t>( seen.size() ), binomial_coefficient( n, k ), "CombinationBitmasks " + size_t2string( order, 2 ) + " 02" );
+    }
+    }
+
+    {
+    // Splitting a range over three workers gives the same combinations as one worker
+    const size_t n( 20 );
+    const size_t k( 7 );
+    std::vector< uint64_t > all;
+    CombinationBitmasks combinations( n, k, CombinationBitmasks::REVOLVING_DOOR );
+    uint64_t combination;
+    while ( combinations.next_combination( combination ) )
+        all.push_back( combination );
+    const uint64_t total = binomial_coefficient( n, k );
+    std::vector< uint64_t > in_parts;
+    for ( uint64_t part( 0 ); part != 3; ++part )
+    {
+        CombinationBitmasks combinations_part( n, k, ( part * total ) / 3, ( ( part + 1 ) * total ) / 3, CombinationBitmasks::REVOLVING_DOOR );
+        while ( combinations_part.next_combination( combination ) )
+            in_parts.push_back( combination );
+    }
+    test_suite.test_equality( ( in_parts == all ), true, "CombinationBitmasks 03" );
+    test_suite.test_equality( unrank_combination_lexicographic( binomial_coefficient( 64, 3 ) - 1, 64, 3 ), uint64_t( 0xE000000000000000ULL ), "unrank_combination_lexicographic() 01" );
+    test_suite.test_equality( rank_combination_revolving_door( unrank_combination_revolving_door( 123456789, 64, 10 ), 64, 10 ), uint64_t( 123456789 ), "rank_combination_revolving_door() 01" );
     }
 
 }
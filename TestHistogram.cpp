@@ -0,0 +1,99 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "Histogram.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <vector>
+
+void test_Histogram( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for Histogram." << std::endl;
+
+    {
+    Histogram histogram( 0.0, 10.0, 10 );
+    histogram.add_data( 0.0 );
+    histogram.add_data( 0.999 );
+    histogram.add_data( 1.0 );
+    histogram.add_data( 9.999 );
+    histogram.add_data( 10.0 );
+    histogram.add_data( -0.001 );
+    histogram.add_data( 10.001 );
+    test_suite.test_equality( histogram.bin( 0 ), size_t( 2 ), "Histogram::add_data() 01" );
+    test_suite.test_equality( histogram.bin( 1 ), size_t( 1 ), "Histogram::add_data() 02" );
+    test_suite.test_equality( histogram.bin( 9 ), size_t( 2 ), "Histogram::add_data() 03" );
+    test_suite.test_equality( histogram.lower_than_start(), size_t( 1 ), "Histogram::add_data() 04" );
+    test_suite.test_equality( histogram.greater_than_finish(), size_t( 1 ), "Histogram::add_data() 05" );
+    test_suite.test_equality( histogram.number_of_data_points(), size_t( 7 ), "Histogram::number_of_data_points() 01" );
+    }
+
+    {
+    // Serial, batch and parallel versions must give identical counts
+    std::vector< double > data;
+    for ( size_t i( 0 ); i != 100000; ++i )
+        data.push_back( ( ( i * 7919 ) % 100003 ) / 1000.0 - 10.0 );
+    Histogram serial( -5.0, 85.0, 37 );
+    for ( size_t i( 0 ); i != data.size(); ++i )
+        serial.add_data( data[i] );
+    Histogram batch( -5.0, 85.0, 37 );
+    batch.add_data( data );
+    Histogram parallel( -5.0, 85.0, 37 );
+    parallel.add_data_in_parallel( &data[0], data.size(), 4 );
+    bool identical( true );
+    for ( size_t i( 0 ); i != serial.size(); ++i )
+    {
+        if ( ( serial.bin( i ) != batch.bin( i ) ) || ( serial.bin( i ) != parallel.bin( i ) ) )
+            identical = false;
+    }
+    test_suite.test_equality( identical, true, "Histogram::add_data_in_parallel() 01" );
+    test_suite.test_equality( parallel.lower_than_start(), serial.lower_than_start(), "Histogram::add_data_in_parallel() 02" );
+    test_suite.test_equality( parallel.greater_than_finish(), serial.greater_than_finish(), "Histogram::add_data_in_parallel() 03" );
+    test_suite.test_equality( parallel.number_of_data_points(), data.size(), "Histogram::add_data_in_parallel() 04" );
+    }
+
+    {
+    Histogram lhs( 0.0, 1.0, 4 );
+    Histogram rhs( 0.0, 1.0, 4 );
+    lhs.add_data( 0.1 );
+    rhs.add_data( 0.1 );
+    rhs.add_data( 0.9 );
+    lhs.merge( rhs );
+    test_suite.test_equality( lhs.bin( 0 ), size_t( 2 ), "Histogram::merge() 01" );
+    test_suite.test_equality( lhs.bin( 3 ), size_t( 1 ), "Histogram::merge() 02" );
+    try
+    {
+        lhs.merge( Histogram( 0.0, 1.0, 5 ) );
+        test_suite.log_error( "Histogram::merge() should have thrown." );
+    }
+    catch ( std::exception & e ) {}
+    }
+
+}
+
@@ -0,0 +1,114 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Instrumentation.h"
+#include "FileName.h"
+#include "ParallelFor.h"
+#include "TextFileReader_2.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+void test_instrumentation( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for Instrumentation." << std::endl;
+
+    // The classes are always available, only the macros depend on FOURIER_INSTRUMENTATION.
+    Instrumentation & instrumentation = Instrumentation::instance();
+    instrumentation.clear();
+    {
+    ScopedTimer scoped_timer( "test outer" );
+    parallel_for( 8, 4, [&]( const size_t )
+    {
+        ScopedTimer scoped_timer( "test inner" );
+        instrumentation.add_count( "test items", 2 );
+    } );
+    }
+    test_suite.test_equality( instrumentation.ncalls( "test outer" ), size_t( 1 ), "Instrumentation::ncalls() 01" );
+    test_suite.test_equality( instrumentation.ncalls( "test inner" ), size_t( 8 ), "Instrumentation::ncalls() 02" );
+    test_suite.test_equality( instrumentation.ncalls( "not a timer" ), size_t( 0 ), "Instrumentation::ncalls() 03" );
+    test_suite.test_equality( instrumentation.count( "test items" ), size_t( 16 ), "Instrumentation::count()" );
+    test_suite.test_equality( instrumentation.total_seconds( "test outer" ) >= 0.0, true, "Instrumentation::total_seconds()" );
+    const std::string summary = instrumentation.summary();
+    test_suite.test_equality( ( summary.find( "test inner" ) != std::string::npos ) && ( summary.find( "test items" ) != std::string::npos ), true, "Instrumentation::summary()" );
+    FileName file_name( "test_instrumentation_trace.json" );
+    instrumentation.save_Chrome_trace( file_name );
+    TextFileReader_2 trace( file_name );
+    // Header, 9 events, the counters, footer
+    test_suite.test_equality( trace.size(), size_t( 12 ), "Instrumentation::save_Chrome_trace() 01" );
+    test_suite.test_equality( trace.line( 0 ), std::string( "{\"traceEvents\":[" ), "Instrumentation::save_Chrome_trace() 02" );
+    test_suite.test_equality( trace.line( 10 ).substr( 0, 30 ), std::string( "{\"name\":\"counters\",\"ph\":\"C\",\"p" ), "Instrumentation::save_Chrome_trace() 03" );
+    std::remove( file_name.full_name().c_str() );
+    // Memory accounting
+    instrumentation.clear();
+    instrumentation.add_memory( "test subsystem", 3000 );
+    instrumentation.add_memory( "test subsystem", -1000 );
+    instrumentation.add_memory( "test subsystem", 500 );
+    test_suite.test_equality( instrumentation.current_memory( "test subsystem" ), 2500LL, "Instrumentation::current_memory()" );
+    test_suite.test_equality( instrumentation.peak_memory( "test subsystem" ), 3000LL, "Instrumentation::peak_memory()" );
+    test_suite.test_equality( instrumentation.peak_memory( "not a subsystem" ), 0LL, "Instrumentation::peak_memory() 02" );
+    instrumentation.add_memory_checkpoint( "test checkpoint" );
+    test_suite.test_equality( instrumentation.nmemory_checkpoints(), size_t( 1 ), "Instrumentation::nmemory_checkpoints()" );
+    const std::string memory_summary = instrumentation.summary();
+    test_suite.test_equality( ( memory_summary.find( "test subsystem" ) != std::string::npos ) && ( memory_summary.find( "test checkpoint" ) != std::string::npos ), true, "Instrumentation::summary() memory" );
+    instrumentation.save_Chrome_trace( file_name );
+    TextFileReader_2 memory_trace( file_name );
+    // Header, the checkpoint, footer
+    test_suite.test_equality( memory_trace.size(), size_t( 3 ), "Instrumentation::save_Chrome_trace() memory 01" );
+    test_suite.test_equality( memory_trace.line( 1 ).substr( 0, 25 ), std::string( "{\"name\":\"memory\",\"ph\":\"C\"" ), "Instrumentation::save_Chrome_trace() memory 02" );
+    std::remove( file_name.full_name().c_str() );
+#ifdef __linux__
+    test_suite.test_equality( resident_set_size() > 0, true, "resident_set_size()" );
+    test_suite.test_equality( peak_resident_set_size() >= resident_set_size(), true, "peak_resident_set_size()" );
+#endif
+    {
+    TrackedMemory tracked_memory( "test tracked" );
+    tracked_memory.set( 100 );
+    TrackedMemory copy( tracked_memory );
+    TrackedMemory other( "test tracked" );
+    other.set( 40 );
+    other.swap( copy );
+    test_suite.test_equality( copy.nbytes() + other.nbytes(), size_t( 140 ), "TrackedMemory::swap()" );
+    copy = tracked_memory;
+    test_suite.test_equality( copy.nbytes(), size_t( 100 ), "TrackedMemory::operator=()" );
+#ifdef FOURIER_INSTRUMENTATION
+    test_suite.test_equality( instrumentation.current_memory( "test tracked" ), 300LL, "TrackedMemory::set()" );
+#else
+    test_suite.test_equality( instrumentation.current_memory( "test tracked" ), 0LL, "TrackedMemory::set() without instrumentation" );
+#endif
+    }
+#ifdef FOURIER_INSTRUMENTATION
+    test_suite.test_equality( instrumentation.current_memory( "test tracked" ), 0LL, "TrackedMemory::~TrackedMemory()" );
+    test_suite.test_equality( instrumentation.peak_memory( "test tracked" ), 300LL, "TrackedMemory peak" );
+#endif
+    instrumentation.clear();
+    test_suite.test_equality( instrumentation.summary(), std::string( "" ), "Instrumentation::clear()" );
+}
+
@@ -0,0 +1,95 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "IntegerSymmetryOperator.h"
+#include "SpaceGroup.h"
+#include "SymmetryOperator.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+void test_integer_symmetry_operator( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for IntegerSymmetryOperator." << std::endl;
+    {
+    IntegerSymmetryOperator identity;
+    test_suite.test_equality( identity, IntegerSymmetryOperator( SymmetryOperator() ), "IntegerSymmetryOperator() 01" );
+    IntegerSymmetryOperator symmetry_operator( SymmetryOperator( "-y,x-y,z+1/3" ) );
+    test_suite.test_equality( symmetry_operator.rotation( 1, 0 ), 1, "IntegerSymmetryOperator() 02" );
+    test_suite.test_equality( symmetry_operator.rotation( 1, 1 ), -1, "IntegerSymmetryOperator() 03" );
+    test_suite.test_equality( symmetry_operator.translation( 2 ), 8, "IntegerSymmetryOperator() 04" );
+    test_suite.test_equality( symmetry_operator.to_symmetry_operator().to_string(), std::string( "-y,x-y,z+1/3" ), "IntegerSymmetryOperator() 05" );
+    // Three times a 31 screw axis is a lattice translation
+    test_suite.test_equality( symmetry_operator * symmetry_operator * symmetry_operator, identity, "IntegerSymmetryOperator operator*() 01" );
+    IntegerSymmetryOperator lhs( SymmetryOperator( "-x+1/2,y+1/2,-z+1/2" ) );
+    IntegerSymmetryOperator rhs( SymmetryOperator( "-x,-y,-z" ) );
+    test_suite.test_equality( ( lhs * rhs ) * symmetry_operator, lhs * ( rhs * symmetry_operator ), "IntegerSymmetryOperator operator*() 02" );
+    test_suite.test_equality( ( lhs * rhs ).to_symmetry_operator().to_string(), ( SymmetryOperator( "-x+1/2,y+1/2,-z+1/2" ) * SymmetryOperator( "-x,-y,-z" ) ).to_string(), "IntegerSymmetryOperator operator*() 03" );
+    bool thrown( false );
+    try
+    {
+        IntegerSymmetryOperator( SymmetryOperator( "x,y,z+0.1" ) );
+    }
+    catch ( std::exception & )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "IntegerSymmetryOperator() 06" );
+    }
+    {
+    SpaceGroup space_group = SpaceGroup::from_number( 230 );
+    std::vector< IntegerSymmetryOperator > symmetry_operators;
+    test_suite.test_equality( to_integer_symmetry_operators( space_group.symmetry_operators(), symmetry_operators ), true, "to_integer_symmetry_operators() 01" );
+    test_suite.test_equality( is_closed( symmetry_operators ), true, "is_closed() 01" );
+    std::unordered_set< IntegerSymmetryOperator, IntegerSymmetryOperatorHash > unique( symmetry_operators.begin(), symmetry_operators.end() );
+    test_suite.test_equality( unique.size(), size_t( 96 ), "IntegerSymmetryOperatorHash 01" );
+    std::vector< size_t > table = multiplication_table( symmetry_operators );
+    test_suite.test_equality( table.size(), size_t( 96 * 96 ), "multiplication_table() 01" );
+    // The identity is the first symmetry operator
+    test_suite.test_equality( table[ 5 * 96 + 0 ], size_t( 5 ), "multiplication_table() 02" );
+    test_suite.test_equality( table[ 0 * 96 + 7 ], size_t( 7 ), "multiplication_table() 03" );
+    symmetry_operators.pop_back();
+    test_suite.test_equality( is_closed( symmetry_operators ), false, "is_closed() 02" );
+    bool thrown( false );
+    try
+    {
+        multiplication_table( symmetry_operators );
+    }
+    catch ( std::exception & )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "multiplication_table() 04" );
+    }
+}
+
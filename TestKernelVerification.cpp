@@ -0,0 +1,98 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "KernelVerification.h"
+#include "CrystalStructure.h"
+#include "PowderPatternCalculator.h"
+#include "ReflectionList.h"
+#include "SpaceGroup.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+void test_kernel_verification( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for KernelVerification." << std::endl;
+
+    {
+    test_suite.test_equality( ulp_distance( 1.0, 1.0 ), uint64_t(0), "ulp_distance() 01" );
+    test_suite.test_equality( ulp_distance( 0.0, -0.0 ), uint64_t(0), "ulp_distance() 02" );
+    test_suite.test_equality( ulp_distance( 1.0, std::nextafter( 1.0, 2.0 ) ), uint64_t(1), "ulp_distance() 03" );
+    test_suite.test_equality( ulp_distance( std::nextafter( 0.0, -1.0 ), std::nextafter( 0.0, 1.0 ) ), uint64_t(2), "ulp_distance() 04" );
+    test_suite.test_equality( ulp_distance( -2.0, std::nextafter( -2.0, -3.0 ) ), uint64_t(1), "ulp_distance() 05" );
+    }
+
+    {
+    // The same seed gives the same inputs and therefore the same errors
+    const std::vector< KernelComparison > comparisons = verify_kernels( 3, 17 );
+    const std::vector< KernelComparison > comparisons_2 = verify_kernels( 3, 17 );
+    test_suite.test_equality( comparisons.size(), size_t(5), "verify_kernels() 01" );
+    for ( size_t i( 0 ); i != comparisons.size(); ++i )
+    {
+        if ( ! comparisons[i].passed() )
+            test_suite.log_error( "verify_kernels() 02: " + comparisons[i].report() );
+        if ( comparisons[i].ncomparisons_ == 0 )
+            test_suite.log_error( "verify_kernels() 03: " + comparisons[i].name_ );
+        if ( comparisons[i].maximum_error_ != comparisons_2[i].maximum_error_ )
+            test_suite.log_error( "verify_kernels() 04: " + comparisons[i].name_ );
+    }
+    }
+
+    {
+    // The reference summation can be selected at run time
+    CrystalStructure asymmetric_unit;
+    asymmetric_unit.set_crystal_lattice( CrystalLattice( 7.1, 9.3, 11.7, Angle::angle_90_degrees(), Angle::from_degrees( 103.4 ), Angle::angle_90_degrees() ) );
+    asymmetric_unit.set_space_group( SpaceGroup::P21c() );
+    asymmetric_unit.add_atom( Atom( Element( "C" ), Vector3D( 0.123, 0.234, 0.345 ), "C1" ) );
+    asymmetric_unit.add_atom( Atom( Element( "O" ), Vector3D( 0.311, 0.087, 0.412 ), "O1" ) );
+    PowderPatternCalculator powder_pattern_calculator( asymmetric_unit, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    const ReflectionList optimised = powder_pattern_calculator.reflection_list();
+    powder_pattern_calculator.set_structure_factor_summation( PowderPatternCalculator::REFERENCE );
+    test_suite.test_equality( powder_pattern_calculator.structure_factor_summation() == PowderPatternCalculator::REFERENCE, true, "PowderPatternCalculator::set_structure_factor_summation() 01" );
+    powder_pattern_calculator.calculate_structure_factors();
+    const ReflectionList reference = powder_pattern_calculator.reflection_list();
+    double maximum_F_squared( 0.0 );
+    double maximum_difference( 0.0 );
+    for ( size_t i( 0 ); i != optimised.size(); ++i )
+    {
+        maximum_F_squared = std::max( maximum_F_squared, optimised.F_squared( i ) );
+        maximum_difference = std::max( maximum_difference, std::abs( optimised.F_squared( i ) - reference.F_squared( i ) ) );
+    }
+    test_suite.test_equality( optimised.size() > 10, true, "PowderPatternCalculator::set_structure_factor_summation() 02" );
+    test_suite.test_equality( maximum_difference < 1.0E-9 * maximum_F_squared, true, "PowderPatternCalculator::set_structure_factor_summation() 03" );
+    }
+
+}
+
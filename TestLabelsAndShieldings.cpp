@@ -0,0 +1,88 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "LabelsAndShieldings.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void test_labels_and_shieldings( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for LabelsAndShieldings." << std::endl;
+
+    std::vector< std::string > labels;
+    labels.push_back( "C1" );
+    labels.push_back( "C2" );
+    labels.push_back( "N3" );
+    ShieldingTable shielding_table( labels );
+    test_suite.test_equality( shielding_table.label_index( "N3" ), size_t( 2 ), "ShieldingTable::label_index()" );
+    {
+    std::vector< double > shieldings;
+    shieldings.push_back( 10.0 );
+    shieldings.push_back( 20.0 );
+    shieldings.push_back( 30.0 );
+    shielding_table.add_structure( "s1", shieldings );
+    }
+    {
+    // Different order, matched by label
+    LabelsAndShieldings labels_and_shieldings;
+    labels_and_shieldings.push_back( "N3", 35.0 );
+    labels_and_shieldings.push_back( "C1", 10.0 );
+    labels_and_shieldings.push_back( "C2", 21.0 );
+    shielding_table.add_structure( "s2", labels_and_shieldings );
+    }
+    test_suite.test_equality( shielding_table.nstructures(), size_t( 2 ), "ShieldingTable::add_structure() 01" );
+    test_suite.test_equality_double( shielding_table.shielding( 1, 2 ), 35.0, "ShieldingTable::add_structure() 02" );
+    test_suite.test_equality_double( shielding_table.shielding( 1, 1 ), 21.0, "ShieldingTable::add_structure() 03" );
+
+    // The measured values are s1 with slope 2 and intercept 1, plus a label that is not in the table
+    LabelsAndShieldings measured;
+    measured.push_back( "C2", 41.0 );
+    measured.push_back( "C1", 21.0 );
+    measured.push_back( "O4", 100.0 );
+    measured.push_back( "N3", 61.0 );
+    std::vector< double > RMSDs = shielding_table.RMSDs_after_linear_fit( measured );
+    test_suite.test_equality_double( RMSDs[0], 0.0, "ShieldingTable::RMSDs_after_linear_fit() 01" );
+    test_suite.test_equality( RMSDs[1] > 0.0, true, "ShieldingTable::RMSDs_after_linear_fit() 02" );
+    shielding_table.scale( 2.0, 1.0 );
+    RMSDs = shielding_table.RMSDs( measured );
+    test_suite.test_equality_double( RMSDs[0], 0.0, "ShieldingTable::RMSDs() 01" );
+    // s2 is now 21, 43, 71: differences 0, 2, 10
+    test_suite.test_equality_double( RMSDs[1], std::sqrt( 104.0 / 3.0 ), "ShieldingTable::RMSDs() 02" );
+    // A linear transform does not change the fitted RMSDs
+    std::vector< double > RMSDs_2 = shielding_table.RMSDs_after_linear_fit( measured );
+    test_suite.test_equality_double( RMSDs_2[0], 0.0, "ShieldingTable::RMSDs_after_linear_fit() 03" );
+    // Referencing one structure only
+    shielding_table.scale( 1, 1, -1.0, 100.0 );
+    test_suite.test_equality_double( shielding_table.shielding( 1, 0 ), 79.0, "ShieldingTable::scale() 01" );
+    test_suite.test_equality_double( shielding_table.shielding( 0, 0 ), 21.0, "ShieldingTable::scale() 02" );
+}
+
@@ -0,0 +1,98 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "LatticeIndex.h"
+#include "Angle.h"
+#include "CrystalLattice.h"
+#include "Matrix3D.h"
+#include "NiggliReduction.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <vector>
+
+void test_lattice_index( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for LatticeIndex." << std::endl;
+    // Lattices from a simple linear congruential generator, so that the test is reproducible
+    std::vector< CrystalLattice > lattices;
+    unsigned int seed( 11 );
+    for ( size_t i( 0 ); i != 200; ++i )
+    {
+        double values[6];
+        for ( size_t j( 0 ); j != 6; ++j )
+        {
+            seed = 1103515245 * seed + 12345;
+            const double fraction = ( ( seed >> 8 ) % 10000 ) / 10000.0;
+            values[j] = ( j < 3 ) ? 5.0 + 5.0 * fraction : 80.0 + 20.0 * fraction;
+        }
+        lattices.push_back( CrystalLattice( values[0], values[1], values[2], Angle::from_degrees( values[3] ), Angle::from_degrees( values[4] ), Angle::from_degrees( values[5] ) ) );
+    }
+    LatticeIndex lattice_index;
+    lattice_index.reserve( lattices.size() );
+    for ( size_t i( 0 ); i != lattices.size(); ++i )
+        lattice_index.push_back( lattices[i] );
+    test_suite.test_equality( lattice_index.size(), lattices.size(), "LatticeIndex 01" );
+    // The same lattice in a different setting is found back
+    CrystalLattice query( lattices[17] );
+    query.transform( Matrix3D( 1.0, 0.0, 0.0, 1.0, 1.0, 0.0, -1.0, 0.0, 1.0 ) );
+    std::vector< double > distances;
+    std::vector< size_t > nearest = lattice_index.find_nearest( query, 3, distances );
+    test_suite.test_equality( nearest.size(), static_cast<size_t>(3), "LatticeIndex 02" );
+    test_suite.test_equality( nearest[0], static_cast<size_t>(17), "LatticeIndex 03" );
+    test_suite.test_equality_double( distances[0], 0.0, "LatticeIndex 04", 1.0E-6 );
+    test_suite.test_equality( distances[1] <= distances[2], true, "LatticeIndex 05" );
+    // find_nearest() and find_within() agree with a brute-force search
+    const std::vector< double > query_G6 = G6_vector( Niggli_reduce( lattices[42] ) );
+    std::vector< double > all_distances;
+    for ( size_t i( 0 ); i != lattices.size(); ++i )
+        all_distances.push_back( G6_distance( query_G6, lattice_index.G6( i ) ) );
+    nearest = lattice_index.find_nearest( lattices[42], 5, distances );
+    for ( size_t i( 0 ); i != nearest.size(); ++i )
+    {
+        size_t ncloser( 0 );
+        for ( size_t j( 0 ); j != all_distances.size(); ++j )
+        {
+            if ( all_distances[j] < all_distances[ nearest[i] ] )
+                ++ncloser;
+        }
+        test_suite.test_equality( ncloser, i, "LatticeIndex 06" );
+    }
+    const double radius( 15.0 );
+    std::vector< size_t > within = lattice_index.find_within( lattices[42], radius );
+    std::vector< size_t > brute_force;
+    for ( size_t i( 0 ); i != all_distances.size(); ++i )
+    {
+        if ( all_distances[i] <= radius )
+            brute_force.push_back( i );
+    }
+    test_suite.test_equality( within.size(), brute_force.size(), "LatticeIndex 07" );
+    test_suite.test_equality( within == brute_force, true, "LatticeIndex 08" );
+    test_suite.test_equality( brute_force.size() > 1, true, "LatticeIndex 09" );
+}
+
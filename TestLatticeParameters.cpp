@@ -0,0 +1,100 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "LatticeParameters.h"
+#include "CrystalLattice.h"
+#include "MillerIndices.h"
+#include "3DCalculations.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+
+void test_lattice_parameters( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for LatticeParameters." << std::endl;
+    const CrystalLattice crystal_lattice( 7.3, 9.1, 11.8, Angle::from_degrees( 82.0 ), Angle::from_degrees( 103.0 ), Angle::from_degrees( 95.0 ) );
+    LatticeParameters lattice_parameters( crystal_lattice );
+    test_suite.test_equality_double( lattice_parameters.volume(), crystal_lattice.volume(), "LatticeParameters::volume()" );
+    test_suite.test_equality( sizeof( LatticeParameters ), 6 * sizeof( double ), "sizeof( LatticeParameters )" );
+    {
+    // The derived quantities must be those of CrystalLattice
+    const Matrix3D G = crystal_lattice.metric_matrix();
+    const Matrix3D G_star = inverse( G );
+    bool are_equal( true );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            are_equal = are_equal && nearly_equal( lattice_parameters.metric_tensor().value( i, j ), G.value( i, j ) );
+            are_equal = are_equal && nearly_equal( lattice_parameters.reciprocal_metric_tensor().value( i, j ), G_star.value( i, j ) );
+            are_equal = are_equal && nearly_equal( lattice_parameters.fractional_to_orthogonal_matrix().value( i, j ), crystal_lattice.fractional_to_orthogonal_matrix().value( i, j ) );
+            are_equal = are_equal && nearly_equal( lattice_parameters.orthogonal_to_fractional_matrix().value( i, j ), crystal_lattice.orthogonal_to_fractional_matrix().value( i, j ) );
+        }
+    }
+    if ( ! are_equal )
+        test_suite.log_error( "LatticeParameters derived quantities" );
+    const Vector3D H = -2.0 * crystal_lattice.a_star_vector() + 3.0 * crystal_lattice.b_star_vector() + 1.0 * crystal_lattice.c_star_vector();
+    test_suite.test_equality_double( lattice_parameters.inverse_d_squared( MillerIndices( -2, 3, 1 ) ), H.norm2(), "LatticeParameters::inverse_d_squared()" );
+    }
+    {
+    // The derived quantities follow the parameters
+    LatticeParameters changed( lattice_parameters );
+    changed.set_parameters( 5.0, 6.0, 7.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+    test_suite.test_equality_double( changed.metric_tensor().value( 1, 1 ), 36.0, "LatticeParameters::set_parameters()" );
+    test_suite.test_equality_double( changed.volume(), 210.0, "LatticeParameters::set_parameters() volume" );
+    // The round trip through the metric tensor
+    changed.set_metric_tensor( lattice_parameters.metric_tensor() );
+    test_suite.test_equality_double( changed.c(), crystal_lattice.c(), "LatticeParameters::set_metric_tensor() c" );
+    test_suite.test_equality_double( changed.beta().value_in_degrees(), 103.0, "LatticeParameters::set_metric_tensor() beta" );
+    }
+    {
+    // An isotropic strain scales the axes and keeps the angles, a general strain changes the volume by det( 1 + strain )
+    LatticeParameters strained( lattice_parameters );
+    strained.apply_strain( SymmetricMatrix3D( 0.01, 0.01, 0.01, 0.0, 0.0, 0.0 ) );
+    test_suite.test_equality_double( strained.a(), 1.01 * crystal_lattice.a(), "LatticeParameters::apply_strain() a" );
+    test_suite.test_equality_double( strained.alpha().value_in_degrees(), 82.0, "LatticeParameters::apply_strain() alpha" );
+    const SymmetricMatrix3D strain( 0.02, -0.01, 0.005, 0.003, -0.004, 0.006 );
+    strained = lattice_parameters;
+    strained.apply_strain( strain );
+    test_suite.test_equality_double( strained.volume(), ( SymmetricMatrix3D() + strain ).determinant() * crystal_lattice.volume(), "LatticeParameters::apply_strain() volume" );
+    // The same as deforming the basis vectors of a CrystalLattice
+    Matrix3D deformation( 1.0 );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+            deformation.set_value( i, j, deformation.value( i, j ) + strain.value( i, j ) );
+    }
+    const Vector3D a = deformation * crystal_lattice.a_vector();
+    const Vector3D b = deformation * crystal_lattice.b_vector();
+    const Vector3D c = deformation * crystal_lattice.c_vector();
+    test_suite.test_equality_double( strained.b(), b.length(), "LatticeParameters::apply_strain() b" );
+    test_suite.test_equality_double( strained.gamma().value_in_degrees(), angle( a, b ).value_in_degrees(), "LatticeParameters::apply_strain() gamma" );
+    test_suite.test_equality_double( strained.crystal_lattice().alpha().value_in_degrees(), angle( b, c ).value_in_degrees(), "LatticeParameters::crystal_lattice()" );
+    }
+}
@@ -0,0 +1,114 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Logger.h"
+#include "ParallelFor.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+void test_logger( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for Logger." << std::endl;
+
+    {
+    std::ostringstream sink;
+    Logger logger( sink, Logger::INFO );
+    logger.set_flush_interval( 1000.0 );
+    logger.log( Logger::DEBUG, "debug" );
+    logger.log( Logger::INFO, "info" );
+    logger.log( Logger::WARNING, "warning" );
+    test_suite.test_equality( sink.str(), std::string( "" ), "Logger::log() 01" ); // Still buffered
+    logger.flush();
+    test_suite.test_equality( sink.str(), std::string( "info\nwarning\n" ), "Logger::log() 02" );
+    logger.log( Logger::ERROR, "error" );
+    test_suite.test_equality( sink.str(), std::string( "info\nwarning\nerror\n" ), "Logger::log() 03" ); // Errors are not held back
+    logger.set_level( Logger::SILENT );
+    logger.log( Logger::ERROR, "error" );
+    logger.flush();
+    test_suite.test_equality( sink.str(), std::string( "info\nwarning\nerror\n" ), "Logger::set_level()" );
+    }
+    {
+    std::ostringstream sink;
+    {
+    Logger logger( sink );
+    logger.set_flush_interval( 1000.0 );
+    logger.log( Logger::INFO, "info" );
+    }
+    test_suite.test_equality( sink.str(), std::string( "info\n" ), "Logger::~Logger()" );
+    }
+    {
+    // With a long interval, only the first and the last item are reported
+    std::ostringstream sink;
+    Logger logger( sink );
+    ProgressReporter progress( "Reading ", 3, 1000.0, logger );
+    progress.tick( "a" );
+    progress.tick( "b" );
+    progress.tick( "c" );
+    logger.flush();
+    test_suite.test_equality( sink.str(), std::string( "Reading a (1 of 3)\nReading c (3 of 3)\n" ), "ProgressReporter::tick() 01" );
+    }
+    {
+    std::ostringstream sink;
+    Logger logger( sink );
+    ProgressReporter progress( "Reading ", 2, 0.0, logger );
+    progress.tick( "a" );
+    progress.tick( "b" );
+    logger.flush();
+    test_suite.test_equality( sink.str(), std::string( "Reading a (1 of 2)\nReading b (2 of 2)\n" ), "ProgressReporter::tick() 02" );
+    }
+    {
+    // Lines from different threads are never interleaved
+    std::ostringstream sink;
+    Logger logger( sink );
+    logger.set_flush_interval( 0.0 );
+    ProgressReporter progress( "", 1000, 0.0, logger );
+    parallel_for( 1000, 4, [&]( const size_t ) { logger.log( Logger::INFO, "0123456789" ); progress.tick(); } );
+    logger.flush();
+    test_suite.test_equality( progress.ndone(), size_t( 1000 ), "ProgressReporter::ndone()" );
+    std::istringstream lines( sink.str() );
+    std::string line;
+    size_t nlines( 0 );
+    bool all_lines_intact( true );
+    bool last_item_reported( false );
+    while ( std::getline( lines, line ) )
+    {
+        ++nlines;
+        if ( line == " (1000 of 1000)" )
+            last_item_reported = true;
+        else if ( ( line != "0123456789" ) && ( line.substr( 0, 2 ) != " (" ) )
+            all_lines_intact = false;
+    }
+    test_suite.test_equality( all_lines_intact, true, "Logger::log() threads 01" );
+    test_suite.test_equality( last_item_reported, true, "Logger::log() threads 02" );
+    test_suite.test_equality( nlines >= 1001, true, "Logger::log() threads 03" );
+    }
+}
+
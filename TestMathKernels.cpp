@@ -0,0 +1,139 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "MathKernels.h"
+#include "MathConstants.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+void test_math_kernels( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for MathKernels." << std::endl;
+    {
+    std::vector< double > x;
+    for ( int i( -20000 ); i != 20001; ++i )
+        x.push_back( i * 0.00731 );
+    x.push_back( 0.5 * CONSTANT_PI );
+    x.push_back( CONSTANT_PI );
+    x.push_back( -CONSTANT_PI );
+    x.push_back( 99999.9 );
+    x.push_back( -54321.0 );
+    std::vector< double > sines;
+    std::vector< double > cosines;
+    sincos( x, sines, cosines );
+    test_suite.test_equality( sines.size(), x.size(), "sincos() 01" );
+    double max_error( 0.0 );
+    for ( size_t i( 0 ); i != x.size(); ++i )
+    {
+        const double scale = std::max( 1.0, std::abs( x[i] ) );
+        max_error = std::max( max_error, std::abs( sines[i] - std::sin( x[i] ) ) / scale );
+        max_error = std::max( max_error, std::abs( cosines[i] - std::cos( x[i] ) ) / scale );
+    }
+    test_suite.test_equality_double( max_error, 0.0, "sincos() 02", 1.0E-15 );
+    }
+    {
+    std::vector< double > x;
+    for ( int i( -1000 ); i != 1001; ++i )
+        x.push_back( i * ( CONSTANT_PI / 1000.0 ) );
+    std::vector< double > sines;
+    std::vector< double > cosines;
+    sincos_reduced( x, sines, cosines );
+    double max_error( 0.0 );
+    for ( size_t i( 0 ); i != x.size(); ++i )
+    {
+        max_error = std::max( max_error, std::abs( sines[i] - std::sin( x[i] ) ) );
+        max_error = std::max( max_error, std::abs( cosines[i] - std::cos( x[i] ) ) );
+    }
+    test_suite.test_equality_double( max_error, 0.0, "sincos_reduced() 01", 1.0E-15 );
+    }
+    {
+    // Multiples of 1/8 of a cycle must be exact or very nearly so
+    std::vector< double > t;
+    for ( int i( -80 ); i != 81; ++i )
+        t.push_back( i * 0.125 );
+    std::vector< double > sines;
+    std::vector< double > cosines;
+    sincos_2pi( t, sines, cosines );
+    test_suite.test_equality( sines[ 80 + 4 ], 0.0, "sincos_2pi() 01" );
+    test_suite.test_equality( cosines[ 80 + 4 ], -1.0, "sincos_2pi() 02" );
+    test_suite.test_equality( sines[ 80 - 6 ], 1.0, "sincos_2pi() 03" );
+    test_suite.test_equality( cosines[ 80 + 10 ], 0.0, "sincos_2pi() 04" );
+    test_suite.test_equality( cosines[ 80 + 80 ], 1.0, "sincos_2pi() 05" );
+    test_suite.test_equality_double( sines[ 80 + 1 ], std::sqrt( 0.5 ), "sincos_2pi() 06", 2.0E-16 );
+    // General arguments, the reference values have an error of about 1.0E-16 * 2*pi*|t| from the multiplication
+    t.clear();
+    for ( int i( -20000 ); i != 20001; ++i )
+        t.push_back( i * 0.000373 );
+    sincos_2pi( t, sines, cosines );
+    double max_error( 0.0 );
+    for ( size_t i( 0 ); i != t.size(); ++i )
+    {
+        const double x = 2.0 * CONSTANT_PI * t[i];
+        const double scale = std::max( 1.0, std::abs( x ) );
+        max_error = std::max( max_error, std::abs( sines[i] - std::sin( x ) ) / scale );
+        max_error = std::max( max_error, std::abs( cosines[i] - std::cos( x ) ) / scale );
+    }
+    test_suite.test_equality_double( max_error, 0.0, "sincos_2pi() 07", 1.0E-15 );
+    std::vector< double > cosines_only;
+    cos_2pi( t, cosines_only );
+    test_suite.test_equality( cosines_only, cosines, "cos_2pi() 01" );
+    // In place
+    cos_2pi( t, t );
+    test_suite.test_equality( t, cosines, "cos_2pi() 02" );
+    }
+    {
+    std::vector< double > x;
+    for ( int i( -7000 ); i != 7001; ++i )
+        x.push_back( i * 0.1011 );
+    std::vector< double > result;
+    exp( x, result );
+    double max_error( 0.0 );
+    for ( size_t i( 0 ); i != x.size(); ++i )
+        max_error = std::max( max_error, std::abs( result[i] - std::exp( x[i] ) ) / std::exp( x[i] ) );
+    test_suite.test_equality_double( max_error, 0.0, "exp() 01", 1.0E-13 );
+    x.clear();
+    x.push_back( 0.0 );
+    x.push_back( -800.0 );
+    x.push_back( 800.0 );
+    x.push_back( -708.0 );
+    x.push_back( 709.0 );
+    exp( x, x );
+    test_suite.test_equality( x[0], 1.0, "exp() 02" );
+    test_suite.test_equality( x[1], 0.0, "exp() 03" );
+    test_suite.test_equality( x[2], std::numeric_limits< double >::infinity(), "exp() 04" );
+    test_suite.test_equality_double( x[3] / std::exp( -708.0 ), 1.0, "exp() 05", 1.0E-13 );
+    test_suite.test_equality_double( x[4] / std::exp( 709.0 ), 1.0, "exp() 06", 1.0E-13 );
+    }
+}
+
@@ -87,5 +87,28 @@ void test_matrix3D( TestSuite & test_suite )
                                                           0.0, 0.0, 1.0, "Matrix3D::invert() 2" );
 
     }
+    {
+    // The arithmetic can be evaluated at compile time
+    constexpr Matrix3D lhs( 1.0, 2.0, 3.0,
+                            4.0, 5.0, 6.0,
+                            7.0, 8.0, 9.0 );
+    constexpr Matrix3D rhs( 0.0, 1.0, 0.0,
+                            0.0, 0.0, 1.0,
+                            1.0, 0.0, 0.0 );
+    constexpr Matrix3D product = lhs * rhs;
+    static_assert( product.value( 0, 0 ) == 3.0, "Matrix3D * Matrix3D is not constexpr" );
+    constexpr Vector3D v = lhs * Vector3D( 1.0, 0.0, -1.0 );
+    static_assert( v.z() == -2.0, "Matrix3D * Vector3D is not constexpr" );
+    test_one_matrix3D( test_suite, product, 3.0, 1.0, 2.0,
+                                            6.0, 4.0, 5.0,
+                                            9.0, 7.0, 8.0, "Matrix3D * Matrix3D" );
+    test_one_matrix3D( test_suite, lhs + 2.0 * rhs - lhs / 2.0, 0.5, 3.0, 1.5,
+                                                                2.0, 2.5, 5.0,
+                                                                5.5, 4.0, 4.5, "Matrix3D arithmetic" );
+    const Vector3D w = Vector3D( 1.0, 0.0, -1.0 ) * lhs;
+    test_suite.test_equality_double( w.x(), -6.0, "Vector3D * Matrix3D x" );
+    test_suite.test_equality_double( w.z(), -6.0, "Vector3D * Matrix3D z" );
+    test_suite.test_equality_double( v.x(), -2.0, "Matrix3D * Vector3D" );
+    }
 }
 
@@ -26,17 +26,55 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "ModelBuilding.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "Utilities.h"
 
 #include "TestSuite.h"
 
 #include <iostream>
+#include <stdexcept>
 
 void test_ModelBuilding( TestSuite & test_suite )
 {
     std::cout << "Now running tests for ModelBuilding." << std::endl;
 
     {
-   
+    // Monoclinic cell, the C-H bond crosses the cell boundary
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 7.0, 8.0, 9.0, Angle::angle_90_degrees(), Angle::from_degrees( 105.0 ), Angle::angle_90_degrees() ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.01, 0.50, 0.50 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "N" ), Vector3D( 0.50, 0.10, 0.50 ), "N1" ) );
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 0.50, 0.50, 0.20 ), "O1" ) );
+    crystal_structure.add_atom( Atom( Element( "H" ), Vector3D( 0.86, 0.52, 0.49 ), "H1" ) );
+    crystal_structure.add_atom( Atom( Element( "H" ), Vector3D( 0.50, 0.25, 0.51 ), "H2" ) );
+    crystal_structure.add_atom( Atom( Element( "D" ), Vector3D( 0.55, 0.50, 0.30 ), "D3" ) );
+    const CrystalStructure original( crystal_structure );
+    normalise_X_H_bonds( crystal_structure );
+    const double target_bond_lengths[3] = { 1.089, 1.015, 0.993 };
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        double distance;
+        Vector3D difference_vector;
+        crystal_structure.crystal_lattice().shortest_distance( crystal_structure.atom( i ).position(), crystal_structure.atom( i + 3 ).position(), distance, difference_vector );
+        test_suite.test_equality_double( distance, target_bond_lengths[i], "normalise_X_H_bonds() " + size_t2string( 2 * i + 1 ) );
+        // The direction of the X-H bond must not change
+        double original_distance;
+        Vector3D original_difference_vector;
+        original.crystal_lattice().shortest_distance( original.atom( i ).position(), original.atom( i + 3 ).position(), original_distance, original_difference_vector );
+        test_suite.test_equality_double( ( ( original_distance / distance ) * difference_vector - original_difference_vector ).length(), 0.0, "normalise_X_H_bonds() " + size_t2string( 2 * i + 2 ) );
+    }
+    crystal_structure.add_atom( Atom( Element( "H" ), Vector3D( 0.0, 0.0, 0.0 ), "H4" ) );
+    bool thrown( false );
+    try
+    {
+        normalise_X_H_bonds( crystal_structure );
+    }
+    catch ( std::runtime_error & )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "normalise_X_H_bonds() 07" );
     }
 
 }
@@ -0,0 +1,149 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "MolecularSurface.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "MathConstants.h"
+#include "MathFunctions.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+// Carbon atoms in a cubic P1 cell, each atom is its own molecule.
+CrystalStructure carbon_atoms( const double a, const std::vector< Vector3D > & positions )
+{
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( a, a, a, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    for ( size_t i( 0 ); i != positions.size(); ++i )
+        crystal_structure.add_atom( Atom( Element( "C" ), positions[i], "C" + std::to_string( i + 1 ) ) );
+    crystal_structure.perceive_molecules();
+    return crystal_structure;
+}
+
+} // namespace
+
+void test_molecular_surface( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for MolecularSurface." << std::endl;
+    {
+    // An isolated atom: the Van der Waals surface is a sphere
+    const CrystalStructure crystal_structure = carbon_atoms( 20.0, std::vector< Vector3D >( 1, Vector3D( 0.3, 0.4, 0.5 ) ) );
+    const double radius = Element( "C" ).Van_der_Waals_radius();
+    const MolecularSurface molecular_surface( crystal_structure, 0, MolecularSurface::VAN_DER_WAALS, 0.1 );
+    test_suite.test_equality_double( molecular_surface.area() / ( 4.0 * CONSTANT_PI * square( radius ) ), 1.0, "MolecularSurface::area() sphere", 0.02 );
+    test_suite.test_equality_double( molecular_surface.volume() / ( ( 4.0 / 3.0 ) * CONSTANT_PI * ( radius * radius * radius ) ), 1.0, "MolecularSurface::volume() sphere", 0.02 );
+    bool d_i_is_radius( true );
+    bool d_e_is_infinite( true );
+    for ( size_t i( 0 ); i != molecular_surface.ntriangles(); ++i )
+    {
+        if ( std::abs( molecular_surface.d_i( i ) - radius ) > 0.01 )
+            d_i_is_radius = false;
+        if ( molecular_surface.d_e( i ) != std::numeric_limits< double >::infinity() )
+            d_e_is_infinite = false;
+    }
+    test_suite.test_equality( d_i_is_radius, true, "MolecularSurface::d_i() sphere" );
+    test_suite.test_equality( d_e_is_infinite, true, "MolecularSurface::d_e() sphere" );
+    // Nothing within range of d_e
+    test_suite.test_equality( molecular_surface.fingerprint_plot().total_area(), 0.0, "MolecularSurface::fingerprint_plot() sphere" );
+    }
+    {
+    // Two atoms in contact: where the densities of two identical atoms are equal, they are equally far away
+    std::vector< Vector3D > positions;
+    positions.push_back( Vector3D( 0.5, 0.5, 0.5 ) );
+    positions.push_back( Vector3D( 0.65, 0.5, 0.5 ) );
+    const CrystalStructure crystal_structure = carbon_atoms( 20.0, positions );
+    const MolecularSurface molecular_surface( crystal_structure, 0, MolecularSurface::HIRSHFELD, 0.1 );
+    size_t ncontact_triangles( 0 );
+    bool d_i_is_d_e( true );
+    for ( size_t i( 0 ); i != molecular_surface.ntriangles(); ++i )
+    {
+        if ( molecular_surface.d_e( i ) > 2.0 )
+            continue;
+        ++ncontact_triangles;
+        if ( std::abs( molecular_surface.d_i( i ) - molecular_surface.d_e( i ) ) > 0.01 )
+            d_i_is_d_e = false;
+    }
+    test_suite.test_equality( ncontact_triangles != 0, true, "MolecularSurface contact" );
+    test_suite.test_equality( d_i_is_d_e, true, "MolecularSurface::d_i() == d_e()" );
+    }
+    {
+    // Body-centred cubic: the two atoms are related by a translation, and the surface does not depend on the origin.
+    // A Hirshfeld surface encloses the region where the molecule contributes more than all other molecules together,
+    // so the surfaces do not fill space.
+    std::vector< Vector3D > positions;
+    positions.push_back( Vector3D( 0.0, 0.0, 0.0 ) );
+    positions.push_back( Vector3D( 0.5, 0.5, 0.5 ) );
+    const double a = 3.6;
+    const CrystalStructure crystal_structure = carbon_atoms( a, positions );
+    test_suite.test_equality( crystal_structure.nmolecules(), size_t( 2 ), "MolecularSurface nmolecules()" );
+    const MolecularSurface molecular_surface_1( crystal_structure, 0, MolecularSurface::HIRSHFELD, 0.1 );
+    const MolecularSurface molecular_surface_2( crystal_structure, 1, MolecularSurface::HIRSHFELD, 0.1 );
+    test_suite.test_equality_double( molecular_surface_1.volume(), molecular_surface_2.volume(), "MolecularSurface::volume() Hirshfeld", 0.01 * molecular_surface_1.volume() );
+    test_suite.test_equality_double( molecular_surface_1.area(), molecular_surface_2.area(), "MolecularSurface::area() Hirshfeld", 0.01 * molecular_surface_1.area() );
+    test_suite.test_equality( molecular_surface_1.volume() < 0.5 * ( a * a * a ), true, "MolecularSurface::volume() Hirshfeld gaps" );
+    const Vector3D shift( 0.13, 0.21, 0.05 );
+    const CrystalStructure shifted_crystal_structure = carbon_atoms( a, std::vector< Vector3D >( { positions[0] + shift, positions[1] + shift } ) );
+    const MolecularSurface shifted_molecular_surface( shifted_crystal_structure, 0, MolecularSurface::HIRSHFELD, 0.1 );
+    test_suite.test_equality_double( shifted_molecular_surface.volume(), molecular_surface_1.volume(), "MolecularSurface::volume() shifted", 0.01 * molecular_surface_1.volume() );
+    const FingerprintPlot fingerprint_plot = molecular_surface_1.fingerprint_plot( FingerprintPlot( 0.4, 2.6, 0.1 ) );
+    test_suite.test_equality_double( fingerprint_plot.total_area(), molecular_surface_1.area(), "MolecularSurface::fingerprint_plot() total_area()", 1.0E-6 );
+    // The Van der Waals spheres overlap with the neighbours, but only the molecule itself counts
+    const MolecularSurface Van_der_Waals_surface( crystal_structure, 0, MolecularSurface::VAN_DER_WAALS, 0.1 );
+    test_suite.test_equality_double( Van_der_Waals_surface.volume() / ( ( 4.0 / 3.0 ) * CONSTANT_PI * std::pow( Element( "C" ).Van_der_Waals_radius(), 3 ) ), 1.0, "MolecularSurface::volume() Van der Waals", 0.02 );
+    // Batch
+    std::vector< CrystalStructure > crystal_structures;
+    crystal_structures.push_back( crystal_structure );
+    crystal_structures.push_back( carbon_atoms( 20.0, std::vector< Vector3D >( 1, Vector3D( 0.3, 0.4, 0.5 ) ) ) );
+    const std::vector< MolecularSurfaceProperties > properties = molecular_surface_properties( crystal_structures, MolecularSurface::HIRSHFELD, 0.1, 2 );
+    test_suite.test_equality( properties.size(), size_t( 3 ), "molecular_surface_properties() size()" );
+    test_suite.test_equality( properties[1].crystal_structure_, size_t( 0 ), "molecular_surface_properties() crystal_structure_" );
+    test_suite.test_equality( properties[1].molecule_, size_t( 1 ), "molecular_surface_properties() molecule_" );
+    test_suite.test_equality( properties[1].area_, molecular_surface_2.area(), "molecular_surface_properties() area_" );
+    test_suite.test_equality( properties[1].volume_, molecular_surface_2.volume(), "molecular_surface_properties() volume_" );
+    test_suite.test_equality( properties[2].crystal_structure_, size_t( 1 ), "molecular_surface_properties() crystal_structure_ 2" );
+    bool caught( false );
+    try
+    {
+        const MolecularSurface molecular_surface( crystal_structure, 2 );
+    }
+    catch ( std::runtime_error & )
+    {
+        caught = true;
+    }
+    test_suite.test_equality( caught, true, "MolecularSurface::MolecularSurface() molecule index" );
+    }
+}
+
@@ -0,0 +1,149 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "NiggliReduction.h"
+#include "Angle.h"
+#include "CrystalLattice.h"
+#include "Matrix3D.h"
+#include "SpaceGroup.h"
+#include "SymmetryOperator.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// A triclinic lattice from a simple linear congruential generator, so that the test is reproducible
+CrystalLattice synthetic_lattice( unsigned int & seed )
+{
+    double values[6];
+    for ( size_t i( 0 ); i != 6; ++i )
+    {
+        seed = 1103515245 * seed + 12345;
+        const double fraction = ( ( seed >> 8 ) % 10000 ) / 10000.0;
+        values[i] = ( i < 3 ) ? 4.0 + 16.0 * fraction : 70.0 + 40.0 * fraction;
+    }
+    return CrystalLattice( values[0], values[1], values[2], Angle::from_degrees( values[3] ), Angle::from_degrees( values[4] ), Angle::from_degrees( values[5] ) );
+}
+
+// ********************************************************************************
+
+// A product of integer shears, determinant 1
+Matrix3D synthetic_unimodular_matrix( unsigned int & seed )
+{
+    Matrix3D result;
+    for ( size_t k( 0 ); k != 4; ++k )
+    {
+        seed = 1103515245 * seed + 12345;
+        const size_t i = ( seed >> 8 ) % 3;
+        const size_t j = ( i + 1 + ( seed >> 12 ) % 2 ) % 3;
+        const double factor = static_cast< double >( static_cast< int >( ( seed >> 16 ) % 5 ) - 2 );
+        Matrix3D shear;
+        shear.set_value( i, j, factor );
+        result = shear * result;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+bool satisfies_Niggli_conditions( const std::vector< double > & g6 )
+{
+    const double e = 1.0E-6 * g6[2];
+    const bool type_I = ( g6[3] > 0.0 ) && ( g6[4] > 0.0 ) && ( g6[5] > 0.0 );
+    const bool type_II = ( g6[3] <= e ) && ( g6[4] <= e ) && ( g6[5] <= e );
+    return ( g6[0] <= g6[1] + e ) && ( g6[1] <= g6[2] + e ) &&
+           ( std::abs( g6[3] ) <= g6[1] + e ) && ( std::abs( g6[4] ) <= g6[0] + e ) && ( std::abs( g6[5] ) <= g6[0] + e ) &&
+           ( g6[3] + g6[4] + g6[5] + g6[0] + g6[1] >= -e ) &&
+           ( type_I || type_II );
+}
+
+} // namespace
+
+void test_Niggli_reduction( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for NiggliReduction." << std::endl;
+    {
+    // A cubic lattice in a skewed setting
+    CrystalLattice cubic( 10.0, 10.0, 10.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+    CrystalLattice skewed( cubic );
+    skewed.transform( Matrix3D( 1.0, 1.0, 0.0, 0.0, 1.0, 0.0, 1.0, 0.0, 1.0 ) );
+    test_suite.test_equality_double( skewed.b(), 10.0, "Niggli_reduce() 01" );
+    CrystalLattice reduced = Niggli_reduce( skewed );
+    test_suite.test_equality_double( reduced.a(), 10.0, "Niggli_reduce() 02" );
+    test_suite.test_equality_double( reduced.c(), 10.0, "Niggli_reduce() 03" );
+    test_suite.test_equality_double( reduced.alpha().value_in_degrees(), 90.0, "Niggli_reduce() 04" );
+    test_suite.test_equality_double( reduced.gamma().value_in_degrees(), 90.0, "Niggli_reduce() 05" );
+    test_suite.test_equality_double( reduced.volume(), cubic.volume(), "Niggli_reduce() 06" );
+    test_suite.test_equality_double( G6_distance( skewed, cubic ), 0.0, "G6_distance() 01" );
+    }
+    {
+    // I-centred cubic, the primitive cell is rhombohedral with a = sqrt(3)/2 a_cubic and alpha = 109.47 degrees
+    std::vector< SymmetryOperator > symmetry_operators;
+    symmetry_operators.push_back( SymmetryOperator( "x,y,z" ) );
+    symmetry_operators.push_back( SymmetryOperator( "x+1/2,y+1/2,z+1/2" ) );
+    const SpaceGroup space_group( symmetry_operators );
+    const CrystalLattice crystal_lattice( 10.0, 10.0, 10.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+    test_suite.test_equality_double( primitive_basis_matrix( space_group ).determinant(), 0.5, "primitive_basis_matrix() 01" );
+    const CrystalLattice reduced = Niggli_reduce( primitive_cell( crystal_lattice, space_group ) );
+    test_suite.test_equality_double( reduced.volume(), 500.0, "primitive_basis_matrix() 02" );
+    test_suite.test_equality_double( reduced.a(), 5.0 * std::sqrt( 3.0 ), "primitive_basis_matrix() 03" );
+    test_suite.test_equality_double( reduced.c(), 5.0 * std::sqrt( 3.0 ), "primitive_basis_matrix() 04" );
+    test_suite.test_equality_double( reduced.alpha().value_in_degrees(), 109.4712206, "primitive_basis_matrix() 05", 1.0E-5 );
+    test_suite.test_equality( primitive_basis_matrix( SpaceGroup() ) == Matrix3D(), true, "primitive_basis_matrix() 06" );
+    }
+    {
+    unsigned int seed( 7 );
+    for ( size_t i( 0 ); i != 50; ++i )
+    {
+        const CrystalLattice crystal_lattice = synthetic_lattice( seed );
+        const Matrix3D transformation_matrix = Niggli_reduction_matrix( crystal_lattice );
+        test_suite.test_equality_double( transformation_matrix.determinant(), 1.0, "Niggli_reduction_matrix() 01" );
+        bool is_integer( true );
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            for ( size_t k( 0 ); k != 3; ++k )
+                is_integer = is_integer && ( transformation_matrix.value( j, k ) == std::round( transformation_matrix.value( j, k ) ) );
+        }
+        test_suite.test_equality( is_integer, true, "Niggli_reduction_matrix() 02" );
+        const CrystalLattice reduced = Niggli_reduce( crystal_lattice );
+        test_suite.test_equality_double( reduced.volume(), crystal_lattice.volume(), "Niggli_reduce() 07", 1.0E-6 * crystal_lattice.volume() );
+        test_suite.test_equality( satisfies_Niggli_conditions( G6_vector( reduced ) ), true, "Niggli_reduce() 08" );
+        // The same lattice in a different setting has the same Niggli cell
+        CrystalLattice transformed( crystal_lattice );
+        transformed.transform( synthetic_unimodular_matrix( seed ) );
+        test_suite.test_equality_double( G6_distance( crystal_lattice, transformed ), 0.0, "G6_distance() 02", 1.0E-6 * reduced.c() * reduced.c() );
+        // A reduced cell is its own Niggli cell
+        test_suite.test_equality_double( G6_distance( G6_vector( Niggli_reduce( reduced ) ), G6_vector( reduced ) ), 0.0, "Niggli_reduce() 09", 1.0E-6 * reduced.c() * reduced.c() );
+    }
+    }
+}
+
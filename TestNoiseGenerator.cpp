@@ -0,0 +1,162 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "NoiseGenerator.h"
+#include "Philox.h"
+#include "PowderPattern.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+
+// Sample mean and variance of the values
+void mean_and_variance( const std::vector< double > & values, double & mean, double & variance )
+{
+    mean = 0.0;
+    for ( size_t i( 0 ); i != values.size(); ++i )
+        mean += values[i];
+    mean /= values.size();
+    variance = 0.0;
+    for ( size_t i( 0 ); i != values.size(); ++i )
+        variance += ( values[i] - mean ) * ( values[i] - mean );
+    variance /= ( values.size() - 1.0 );
+}
+
+} // namespace
+
+void test_noise_generator( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for NoiseGenerator." << std::endl;
+    // Known-answer tests from the Random123 distribution
+    {
+        uint32_t counter[4] = { 0, 0, 0, 0 };
+        uint32_t key[2] = { 0, 0 };
+        uint32_t result[4];
+        Philox4x32::block( counter, key, result );
+        test_suite.test_equality( ( result[0] == 0x6627e8d5 ) && ( result[1] == 0xe169c58d ) && ( result[2] == 0xbc57ac4c ) && ( result[3] == 0x9b00dbd8 ), true, "Philox4x32::block() 01" );
+    }
+    {
+        uint32_t counter[4] = { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 };
+        uint32_t key[2] = { 0xa4093822, 0x299f31d0 };
+        uint32_t result[4];
+        Philox4x32::block( counter, key, result );
+        test_suite.test_equality( ( result[0] == 0xd16cfe09 ) && ( result[1] == 0x94fdcceb ) && ( result[2] == 0x5001e420 ) && ( result[3] == 0x24126ea1 ), true, "Philox4x32::block() 02" );
+    }
+    {
+        Philox4x32 Philox( 12345, 7 );
+        std::vector< double > values( 1001 );
+        Philox.fill( values );
+        bool all_in_range( true );
+        for ( size_t i( 0 ); i != values.size(); ++i )
+        {
+            if ( ( values[i] <= 0.0 ) || ( values[i] >= 1.0 ) )
+                all_in_range = false;
+        }
+        test_suite.test_equality( all_in_range, true, "Philox4x32::fill() 01" );
+        test_suite.test_equality( Philox.position(), static_cast<uint64_t>( 501 ), "Philox4x32::fill() 02" );
+        Philox4x32 Philox_2( 12345, 7 );
+        Philox_2.set_position( 10 );
+        double u1;
+        double u2;
+        Philox_2.next_doubles( u1, u2 );
+        test_suite.test_equality( ( u1 == values[20] ) && ( u2 == values[21] ), true, "Philox4x32::set_position()" );
+    }
+    // Mean and variance of the Poisson deviates for the three methods
+    {
+        const double means[3] = { 3.7, 42.0, 5000.0 };
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            NoiseGenerator noise_generator( 2024, j );
+            std::vector< double > values( 20000, means[j] );
+            noise_generator.Poisson( values, values );
+            double mean;
+            double variance;
+            mean_and_variance( values, mean, variance );
+            // Five standard errors
+            test_suite.test_equality( std::abs( mean - means[j] ) < 5.0 * std::sqrt( means[j] / values.size() ), true, "NoiseGenerator::Poisson() mean " + size_t2string( j ) );
+            test_suite.test_equality( std::abs( variance / means[j] - 1.0 ) < 5.0 * std::sqrt( 2.0 / values.size() ), true, "NoiseGenerator::Poisson() variance " + size_t2string( j ) );
+        }
+    }
+    {
+        NoiseGenerator noise_generator( 2024 );
+        std::vector< double > values( 20001 );
+        noise_generator.normal( values );
+        double mean;
+        double variance;
+        mean_and_variance( values, mean, variance );
+        test_suite.test_equality( ( std::abs( mean ) < 0.04 ) && ( std::abs( variance - 1.0 ) < 0.05 ), true, "NoiseGenerator::normal()" );
+    }
+    {
+        NoiseGenerator noise_generator( 1 );
+        bool exception_thrown( false );
+        try
+        {
+            noise_generator.Poisson( -1.0 );
+        }
+        catch ( std::exception & e )
+        {
+            exception_thrown = true;
+        }
+        test_suite.test_equality( exception_thrown, true, "NoiseGenerator::Poisson() negative mean" );
+    }
+    // The noise must not depend on the number of threads
+    {
+        std::vector< PowderPattern > powder_patterns;
+        for ( size_t i( 0 ); i != 8; ++i )
+        {
+            PowderPattern powder_pattern( Angle::from_degrees( 5.0 ), Angle::from_degrees( 35.0 ), Angle::from_degrees( 0.02 ) );
+            for ( size_t j( 0 ); j != powder_pattern.size(); ++j )
+                powder_pattern.set_intensity( j, 20.0 + 10.0 * i + ( j % 300 ) * ( j % 7 ) );
+            powder_patterns.push_back( powder_pattern );
+        }
+        std::vector< PowderPattern > powder_patterns_2( powder_patterns );
+        add_Poisson_noise( powder_patterns, 99, 1 );
+        add_Poisson_noise( powder_patterns_2, 99, 4 );
+        bool identical( true );
+        bool different_streams( false );
+        for ( size_t i( 0 ); i != powder_patterns.size(); ++i )
+        {
+            for ( size_t j( 0 ); j != powder_patterns[i].size(); ++j )
+            {
+                if ( powder_patterns[i].intensity( j ) != powder_patterns_2[i].intensity( j ) )
+                    identical = false;
+                if ( ( i != 0 ) && ( powder_patterns[i].noise( j ) != powder_patterns[0].noise( j ) ) )
+                    different_streams = true;
+            }
+        }
+        test_suite.test_equality( identical, true, "add_Poisson_noise() 01" );
+        test_suite.test_equality( different_streams, true, "add_Poisson_noise() 02" );
+    }
+}
+
@@ -30,14 +30,37 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TestSuite.h"
 
 #include <iostream>
+#include <stdexcept>
 
 void test_OneSudokuSquare( TestSuite & test_suite )
 {
     std::cout << "Now running tests for OneSudokuSquare." << std::endl;
 
     {
- //   OneSudokuSquare dummy();
- //   test_suite.test_equality( dummy, , "OneSudokuSquare()" );
+    OneSudokuSquare square;
+    test_suite.test_equality( square.candidates(), 0x1FFU, "OneSudokuSquare() 01" );
+    test_suite.test_equality( square.size(), static_cast<size_t>( 9 ), "OneSudokuSquare() 02" );
+    test_suite.test_equality( square.unset( 4 ), true, "OneSudokuSquare::unset( size_t ) 01" );
+    test_suite.test_equality( square.unset( 4 ), false, "OneSudokuSquare::unset( size_t ) 02" );
+    test_suite.test_equality( square.contains( 4 ), false, "OneSudokuSquare::contains() 01" );
+    test_suite.test_equality( square.contains( 5 ), true, "OneSudokuSquare::contains() 02" );
+    test_suite.test_equality( square.value( 3 ), static_cast<size_t>( 5 ), "OneSudokuSquare::value( size_t )" );
+    test_suite.test_equality( square.unset( OneSudokuSquare::from_candidates( 0x0FF ) ), true, "OneSudokuSquare::unset( OneSudokuSquare )" );
+    test_suite.test_equality( square.solved(), true, "OneSudokuSquare::solved()" );
+    test_suite.test_equality( square.value(), static_cast<size_t>( 9 ), "OneSudokuSquare::value()" );
+    test_suite.test_equality( merge( square, OneSudokuSquare( 2 ) ).candidates(), 0x102U, "merge()" );
+    test_suite.test_equality( OneSudokuSquare( square.values() ) == square, true, "OneSudokuSquare::values()" );
+    // A square can never become empty
+    bool exception_thrown( false );
+    try
+    {
+        square.unset( 9 );
+    }
+    catch ( std::exception & e )
+    {
+        exception_thrown = true;
+    }
+    test_suite.test_equality( exception_thrown, true, "OneSudokuSquare::unset() empty" );
     }
 
 }
@@ -0,0 +1,76 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "PackedCrystalStructure.h"
+#include "AnisotropicDisplacementParameters.h"
+#include "CrystalStructure.h"
+#include "SymmetricMatrix3D.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+
+void test_packed_crystal_structure( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PackedCrystalStructure." << std::endl;
+    CrystalStructure crystal_structure;
+    crystal_structure.set_name( "test" );
+    crystal_structure.set_crystal_lattice( CrystalLattice( 5.0, 6.0, 7.0, Angle::angle_90_degrees(), Angle::from_degrees( 95.0 ), Angle::angle_90_degrees() ) );
+    crystal_structure.set_space_group( SpaceGroup::P21c() );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.1, 0.2, 0.3 ), "C1" ) );
+    Atom oxygen( Element( "O" ), Vector3D( 0.4, 0.5, 0.6 ), "O1", AnisotropicDisplacementParameters( SymmetricMatrix3D( 0.01, 0.02, 0.03, 0.001, 0.002, 0.003 ) ) );
+    oxygen.set_occupancy( 0.5 );
+    crystal_structure.add_atom( oxygen );
+    Atom deuterium( Element( "D" ), Vector3D( 0.7, 0.8, 0.9 ), "C1" );
+    deuterium.set_Uiso( 0.05 );
+    deuterium.set_charge( 0.25 );
+    crystal_structure.add_atom( deuterium );
+    PackedCrystalStructure packed( crystal_structure );
+    test_suite.test_equality( packed.natoms(), size_t( 3 ), "PackedCrystalStructure::natoms()" );
+    test_suite.test_equality( packed.nlabels(), size_t( 2 ), "PackedCrystalStructure::nlabels()" );
+    test_suite.test_equality( packed.label( 2 ), std::string( "C1" ), "PackedCrystalStructure::label()" );
+    test_suite.test_equality( packed.space_group().nsymmetry_operators(), size_t( 4 ), "PackedCrystalStructure::space_group()" );
+    test_suite.test_equality_double( packed.y()[1], 0.5, "PackedCrystalStructure::y()" );
+    CrystalStructure unpacked = packed.crystal_structure();
+    test_suite.test_equality( unpacked.name(), std::string( "test" ), "PackedCrystalStructure::crystal_structure() 01" );
+    test_suite.test_equality( unpacked.natoms(), size_t( 3 ), "PackedCrystalStructure::crystal_structure() 02" );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        const Atom & original = crystal_structure.atom( i );
+        const Atom & atom = unpacked.atom( i );
+        test_suite.test_equality( atom.label(), original.label(), "PackedCrystalStructure::atom() label" );
+        test_suite.test_equality( atom.element().id(), original.element().id(), "PackedCrystalStructure::atom() element" );
+        test_suite.test_equality( atom.ADPs_type(), original.ADPs_type(), "PackedCrystalStructure::atom() ADPs type" );
+        test_suite.test_equality_double( atom.position().z(), original.position().z(), "PackedCrystalStructure::atom() position" );
+        test_suite.test_equality_double( atom.occupancy(), original.occupancy(), "PackedCrystalStructure::atom() occupancy" );
+        test_suite.test_equality_double( atom.charge(), original.charge(), "PackedCrystalStructure::atom() charge" );
+        test_suite.test_equality_double( atom.Uiso(), original.Uiso(), "PackedCrystalStructure::atom() Uiso" );
+        test_suite.test_equality_double( atom.anisotropic_displacement_parameters().value( 1, 2 ), original.anisotropic_displacement_parameters().value( 1, 2 ), "PackedCrystalStructure::atom() ADPs" );
+    }
+}
+
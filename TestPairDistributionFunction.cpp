@@ -0,0 +1,169 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PairDistributionFunction.h"
+#include "Angle.h"
+#include "Atom.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "Element.h"
+#include "MathConstants.h"
+#include "Utilities.h"
+#include "Vector3D.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Average number of atoms of element b within [r1, r2> of an atom of element a.
+double coordination_number( const PairDistributionFunction & pdf, const size_t a, const size_t b, const double r1, const double r2 )
+{
+    const double rho_b = pdf.concentration( b ) * pdf.number_density();
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != pdf.nbins(); ++i )
+    {
+        if ( ( pdf.r( i ) < r1 ) || ( pdf.r( i ) > r2 ) )
+            continue;
+        const double inner = i * pdf.dr();
+        const double outer = ( i + 1 ) * pdf.dr();
+        result += pdf.partial_g( a, b, i ) * rho_b * ( 4.0 / 3.0 ) * CONSTANT_PI * ( outer * outer * outer - inner * inner * inner );
+    }
+    return result;
+}
+
+} // namespace
+
+void test_pair_distribution_function( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PairDistributionFunction." << std::endl;
+    // Simple cubic, r_max larger than half the unit cell
+    {
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 2.505, 2.505, 2.505, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    crystal_structure.add_atom( Atom( Element( "Cu" ), Vector3D(), "Cu1" ) );
+    PairDistributionFunction pdf( 6.0, 0.01 );
+    pdf.add_frame( crystal_structure );
+    test_suite.test_equality( pdf.nbins(), size_t( 600 ), "PairDistributionFunction::nbins()" );
+    test_suite.test_equality( pdf.elements().size(), size_t( 1 ), "PairDistributionFunction::elements()" );
+    test_suite.test_equality_double( coordination_number( pdf, 0, 0, 0.0, 2.4 ), 0.0, "PairDistributionFunction nothing below first neighbours" );
+    test_suite.test_equality_double( coordination_number( pdf, 0, 0, 2.4, 2.6 ), 6.0, "PairDistributionFunction first neighbours", 1.0E-9 );
+    test_suite.test_equality_double( coordination_number( pdf, 0, 0, 3.4, 3.6 ), 12.0, "PairDistributionFunction second neighbours", 1.0E-9 );
+    test_suite.test_equality_double( coordination_number( pdf, 0, 0, 4.9, 5.1 ), 6.0, "PairDistributionFunction neighbours beyond half the unit cell", 1.0E-9 );
+    test_suite.test_equality_double( pdf.partial_g( 0, 0, 250 ), pdf.g( 250 ), "PairDistributionFunction::g() one element" );
+    // S(Q) from the FFT against the direct sum
+    std::vector< double > Q;
+    std::vector< double > S;
+    pdf.structure_factor( Q, S );
+    test_suite.test_equality( Q.size(), size_t( 1024 ), "PairDistributionFunction::structure_factor() size" );
+    for ( size_t k( 0 ); k < Q.size(); k += 97 )
+    {
+        double integral( 0.0 );
+        for ( size_t i( 0 ); i != pdf.nbins(); ++i )
+            integral += pdf.G( i ) * ( ( k == 0 ) ? pdf.r( i ) : sin( Q[k] * pdf.r( i ) ) / Q[k] ) * pdf.dr();
+        test_suite.test_equality_double( S[k], 1.0 + integral, "PairDistributionFunction::structure_factor() Q = " + double2string( Q[k] ), 1.0E-9 );
+    }
+    }
+    // CsCl, two elements; threads; repeated frames; explicit supercell
+    {
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 4.0, 4.0, 4.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    crystal_structure.add_atom( Atom( Element( "Cs" ), Vector3D( 0.0, 0.0, 0.0 ), "Cs1" ) );
+    crystal_structure.add_atom( Atom( Element( "Cl" ), Vector3D( 0.5, 0.5, 0.5 ), "Cl1" ) );
+    PairDistributionFunction pdf( 5.0, 0.02, NEUTRONS );
+    pdf.add_frame( crystal_structure );
+    const size_t Cl = ( pdf.elements()[0] == Element( "Cl" ) ) ? 0 : 1;
+    const size_t Cs = 1 - Cl;
+    test_suite.test_equality_double( pdf.concentration( Cs ), 0.5, "PairDistributionFunction::concentration()" );
+    test_suite.test_equality_double( pdf.number_density(), 2.0 / 64.0, "PairDistributionFunction::number_density()" );
+    test_suite.test_equality_double( coordination_number( pdf, Cs, Cl, 3.3, 3.6 ), 8.0, "PairDistributionFunction Cs-Cl", 1.0E-9 );
+    test_suite.test_equality_double( coordination_number( pdf, Cl, Cs, 3.3, 3.6 ), 8.0, "PairDistributionFunction Cl-Cs", 1.0E-9 );
+    test_suite.test_equality_double( coordination_number( pdf, Cs, Cs, 3.3, 3.6 ), 0.0, "PairDistributionFunction Cs-Cs", 1.0E-9 );
+    test_suite.test_equality_double( coordination_number( pdf, Cs, Cs, 3.9, 4.1 ), 6.0, "PairDistributionFunction Cs-Cs second shell", 1.0E-9 );
+    // Faber-Ziman weights with the neutron scattering lengths
+    const double b_Cs = Element( "Cs" ).scattering_factor( 0.0, NEUTRONS );
+    const double b_Cl = Element( "Cl" ).scattering_factor( 0.0, NEUTRONS );
+    const size_t i = 173; // r = 3.47
+    const double expected_g = ( b_Cs * b_Cs * pdf.partial_g( Cs, Cs, i ) + b_Cl * b_Cl * pdf.partial_g( Cl, Cl, i ) +
+                                2.0 * b_Cs * b_Cl * pdf.partial_g( Cs, Cl, i ) ) / ( ( b_Cs + b_Cl ) * ( b_Cs + b_Cl ) );
+    test_suite.test_equality_double( pdf.g( i ), expected_g, "PairDistributionFunction::g() Faber-Ziman", 1.0E-9 );
+    // Threads
+    PairDistributionFunction pdf_threads( 5.0, 0.02, NEUTRONS );
+    pdf_threads.add_frame( crystal_structure, 4 );
+    bool identical( true );
+    for ( size_t i( 0 ); i != pdf.nbins(); ++i )
+        identical = identical && ( pdf.g( i ) == pdf_threads.g( i ) );
+    test_suite.test_equality( identical, true, "PairDistributionFunction threads" );
+    // The same frame twice must not change the average
+    pdf_threads.add_frame( crystal_structure, 4 );
+    test_suite.test_equality( pdf_threads.nframes(), size_t( 2 ), "PairDistributionFunction::nframes()" );
+    for ( size_t i( 0 ); i != pdf.nbins(); ++i )
+        identical = identical && nearly_equal( pdf.g( i ), pdf_threads.g( i ) );
+    test_suite.test_equality( identical, true, "PairDistributionFunction two identical frames" );
+    // A frame with different elements
+    CrystalStructure other;
+    other.set_crystal_lattice( crystal_structure.crystal_lattice() );
+    other.add_atom( Atom( Element( "Na" ), Vector3D(), "Na1" ) );
+    try
+    {
+        pdf_threads.add_frame( other );
+        test_suite.log_error( "PairDistributionFunction::add_frame() should throw for different elements" );
+    }
+    catch ( std::runtime_error & ) {}
+    }
+    // Triclinic: the automatic supercell must give the same result as an explicit supercell
+    {
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 3.113, 4.217, 3.729, Angle::from_degrees( 81.0 ), Angle::from_degrees( 97.0 ), Angle::from_degrees( 104.0 ) ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.11, 0.23, 0.37 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 0.41, 0.67, 0.29 ), "O1" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.83, 0.05, 0.71 ), "C2" ) );
+    PairDistributionFunction pdf( 7.0, 0.05 );
+    pdf.add_frame( crystal_structure );
+    CrystalStructure supercell( crystal_structure );
+    supercell.supercell( 2, 3, 2 );
+    PairDistributionFunction pdf_supercell( 7.0, 0.05 );
+    pdf_supercell.add_frame( supercell, 2 );
+    bool identical( true );
+    for ( size_t a( 0 ); a != 2; ++a )
+    {
+        for ( size_t b( 0 ); b != 2; ++b )
+        {
+            for ( size_t i( 0 ); i != pdf.nbins(); ++i )
+                identical = identical && nearly_equal( pdf.partial_g( a, b, i ), pdf_supercell.partial_g( a, b, i ), 1.0E-9 );
+        }
+    }
+    test_suite.test_equality( identical, true, "PairDistributionFunction explicit supercell" );
+    }
+}
+
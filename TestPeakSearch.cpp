@@ -0,0 +1,89 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+
+#include "PeakSearch.h"
+#include "PowderPattern.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+void test_peak_search( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PeakSearch." << std::endl;
+    // Gaussian peaks with an FWHM of 0.1 degrees on a sloping background; the two at 20.0 and 20.12 degrees overlap
+    const double positions[] = { 8.03, 14.517, 20.0, 20.12, 31.25 };
+    const double heights[] = { 1500.0, 400.0, 1000.0, 600.0, 250.0 };
+    const size_t npeaks = 5;
+    const double FWHM = 0.1;
+    PowderPattern powder_pattern( Angle::from_degrees( 5.0 ), Angle::from_degrees( 35.0 ), Angle::from_degrees( 0.01 ) );
+    for ( size_t i( 0 ); i != powder_pattern.size(); ++i )
+    {
+        const double two_theta = powder_pattern.two_theta( i ).value_in_degrees();
+        double intensity = 200.0 - 2.0 * two_theta;
+        for ( size_t j( 0 ); j != npeaks; ++j )
+            intensity += heights[j] * std::exp( -4.0 * std::log( 2.0 ) * std::pow( ( two_theta - positions[j] ) / FWHM, 2 ) );
+        powder_pattern.set_intensity( i, intensity );
+    }
+    powder_pattern.recalculate_estimated_standard_deviations();
+    PeakSearch peak_search;
+    const PeakSearch::BackgroundMethod background_methods[] = { PeakSearch::BRUECKNER, PeakSearch::CHEBYSHEV };
+    const std::string background_method_names[] = { "Brueckner", "Chebyshev" };
+    for ( size_t k( 0 ); k != 2; ++k )
+    {
+        peak_search.set_background_method( background_methods[k] );
+        const PowderPattern background = peak_search.background( powder_pattern );
+        // Between the peaks the background is recovered
+        test_suite.test_equality_double( background.intensity( powder_pattern.find_two_theta( Angle::from_degrees( 25.0 ) ) ), 150.0, "PeakSearch::background() " + background_method_names[k], 5.0 );
+        const std::vector< PowderPatternPeak > peaks = peak_search.find_peaks( powder_pattern );
+        if ( peaks.size() != npeaks )
+        {
+            test_suite.log_error( "PeakSearch::find_peaks() " + background_method_names[k] + " number of peaks" );
+            continue;
+        }
+        for ( size_t j( 0 ); j != npeaks; ++j )
+        {
+            // The second derivatives of the two overlapping peaks still overlap a little, which pulls them apart
+            const double tolerance = ( ( j == 2 ) || ( j == 3 ) ) ? 0.015 : 0.002;
+            test_suite.test_equality_double( peaks[j].two_theta_.value_in_degrees(), positions[j], "PeakSearch::find_peaks() " + background_method_names[k] + " position", tolerance );
+            test_suite.test_equality_double( peaks[j].intensity_, heights[j], "PeakSearch::find_peaks() " + background_method_names[k] + " intensity", 0.15 * heights[j] );
+        }
+        const std::vector< Angle > first_peaks = peak_positions( peaks, 2 );
+        test_suite.test_equality( first_peaks.size(), size_t( 2 ), "peak_positions() size" );
+        test_suite.test_equality( first_peaks[1], peaks[1].two_theta_, "peak_positions()" );
+    }
+    // A flat pattern has no peaks
+    PowderPattern flat_pattern( Angle::from_degrees( 5.0 ), Angle::from_degrees( 35.0 ), Angle::from_degrees( 0.01 ) );
+    for ( size_t i( 0 ); i != flat_pattern.size(); ++i )
+        flat_pattern.set_intensity( i, 100.0 );
+    flat_pattern.recalculate_estimated_standard_deviations();
+    test_suite.test_equality( peak_search.find_peaks( flat_pattern ).size(), size_t( 0 ), "PeakSearch::find_peaks() flat pattern" );
+}
@@ -0,0 +1,96 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PeakShapeFunction.h"
+#include "Angle.h"
+#include "MathFunctions.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+
+namespace
+{
+
+// Integrates over [-range, +range] with the trapezium rule.
+double area( const PeakShapeFunction & peak_shape_function, const Angle two_theta, const double range )
+{
+    const double step = 0.0005;
+    const size_t npoints = round_to_size_t( 2.0 * range / step );
+    double result( 0.0 );
+    for ( size_t i( 0 ); i <= npoints; ++i )
+    {
+        double value = peak_shape_function.value( -range + i * step, two_theta );
+        result += ( ( i == 0 ) || ( i == npoints ) ) ? 0.5 * value : value;
+    }
+    return result * step;
+}
+
+} // namespace
+
+void test_peak_shape_function( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PeakShapeFunction." << std::endl;
+    Angle two_theta = Angle::from_degrees( 20.0 );
+    {
+    GaussianPeakShape peak_shape_function( 0.1 );
+    test_suite.test_equality_double( area( peak_shape_function, two_theta, 1.0 ), 1.0, "GaussianPeakShape area", 0.0001 );
+    test_suite.test_equality_double( peak_shape_function.value( 0.05, two_theta ), 0.5 * peak_shape_function.value( 0.0, two_theta ), "GaussianPeakShape FWHM", 0.0001 );
+    test_suite.test_equality_double( peak_shape_function.value( 0.0123, two_theta ), peak_shape_function.value( -0.0123, two_theta ), "GaussianPeakShape symmetry", 0.0000001 );
+    double range = peak_shape_function.range( 0.1, 0.0 );
+    test_suite.test_equality_double( peak_shape_function.value( range, two_theta ), 0.001 * peak_shape_function.value( 0.0, two_theta ), "GaussianPeakShape range", 0.0001 );
+    }
+    {
+    LorentzianPeakShape peak_shape_function( 0.1 );
+    // The tails of a Lorentzian are long: 1 - (2/pi) atan( 2*range/FWHM )
+    test_suite.test_equality_double( area( peak_shape_function, two_theta, 100.0 ), 1.0, "LorentzianPeakShape area", 0.001 );
+    test_suite.test_equality_double( peak_shape_function.value( 0.05, two_theta ), 0.5 * peak_shape_function.value( 0.0, two_theta ), "LorentzianPeakShape FWHM", 0.0000001 );
+    }
+    {
+    PseudoVoigtPeakShape peak_shape_function( 0.1, 0.5 );
+    test_suite.test_equality_double( peak_shape_function.value( 0.05, two_theta ), 0.5 * peak_shape_function.value( 0.0, two_theta ), "PseudoVoigtPeakShape FWHM", 0.0001 );
+    }
+    {
+    // Without Lorentzian broadening the TCH function is a Gaussian with FWHM^2 = U tan^2(theta) + V tan(theta) + W
+    ThompsonCoxHastingsPeakShape peak_shape_function( 0.01, -0.002, 0.003, 0.0, 0.0 );
+    double tangent = Angle::from_degrees( 10.0 ).tangent();
+    double FWHM = sqrt( 0.01 * square( tangent ) - 0.002 * tangent + 0.003 );
+    test_suite.test_equality_double( peak_shape_function.FWHM( two_theta ), FWHM, "ThompsonCoxHastingsPeakShape FWHM Gaussian", 0.0000001 );
+    test_suite.test_equality_double( peak_shape_function.eta( two_theta ), 0.0, "ThompsonCoxHastingsPeakShape eta Gaussian", 0.0000001 );
+    GaussianPeakShape Gaussian_peak_shape( FWHM );
+    test_suite.test_equality_double( peak_shape_function.value( 0.02, two_theta ), Gaussian_peak_shape.value( 0.02, two_theta ), "ThompsonCoxHastingsPeakShape value Gaussian", 0.0000001 );
+    }
+    {
+    // Without Gaussian broadening the TCH function is a Lorentzian with FWHM = X tan(theta) + Y / cos(theta)
+    ThompsonCoxHastingsPeakShape peak_shape_function( 0.0, 0.0, 0.0, 0.05, 0.02 );
+    double FWHM = 0.05 * Angle::from_degrees( 10.0 ).tangent() + 0.02 / Angle::from_degrees( 10.0 ).cosine();
+    test_suite.test_equality_double( peak_shape_function.FWHM( two_theta ), FWHM, "ThompsonCoxHastingsPeakShape FWHM Lorentzian", 0.0000001 );
+    test_suite.test_equality_double( peak_shape_function.eta( two_theta ), 1.0, "ThompsonCoxHastingsPeakShape eta Lorentzian", 0.0001 );
+    }
+}
+
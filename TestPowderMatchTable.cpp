@@ -26,19 +26,92 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "PowderMatchTable.h"
+#include "CrystalLattice.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "Vector3D.h"
 
 #include "TestSuite.h"
 
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
 
-void test_PowderMatchTable( TestSuite & test_suite )
+void test_powder_match_table( TestSuite & test_suite )
 {
     std::cout << "Now running tests for PowderMatchTable." << std::endl;
-
+    FileName file_name( "test_powder_match_table.txt" );
     {
- //   PowderMatchTable dummy();
- //   test_suite.test_equality( dummy, , "PowderMatchTable()" );
+    std::ofstream output_file( file_name.full_name().c_str() );
+    output_file << " set_name | structure_name | directory | status | comment | energy | density | cell_volume | reduced_cell_volume | space_group | number_of_dof | penalty | energy_with_penalty | FOM | B | MarchDollase | h | k | l | CellDeformation | a | b | c | alpha | beta | gamma\n";
+    output_file << "          |                |           |        |         | [kcal/mol/atom] | [g/cm3] | [A3] | [A3] | | | [kcal/mol/atom] | [kcal/mol/atom] | | | | | | | | | | | | |\n";
+    output_file << "-----------------------------------------------------------------------------------\n";
+    output_file << "   set1   | structure_000001 | jobs/job0 |  done  |  none   | 0    | 1.25 | 1795.88 | 1795.88 | P 2_1 2_1 2_1 | 60 | 0.575 | 0.575 | 0.43 | -0.0377 | 1.55 | -0.36 | 0.93 | 0 | 0.0136 | 8.259 | 13.576 | 15.471 | 90 | 90 | 90\n";
+    output_file << "   set1   | structure_000002 | jobs/job0 |  done  |  none   | 0.2  | 1.31 | 1700.00 | 1700.00 | P 2_1/c       | 60 | 0.100 | 0.300 | 0.12 | +0.5    | 1.00 | 0     | 1    | 0 | 0.0    | 10.0  | 12.0   | 14.0   | 90 | 100.5 | 90\n";
+    output_file << "\n";
+    output_file << "   set1   | structure_000003 | jobs/job1 | failed |  none   | -0.1 | 1.40 | 1600.00 | 1600.00 | P -1          | 60 | 0.000 | -0.100 | 0.80 | 1.0   | 1.00 | 1     | 0    | 0 | 0.0    | 7.0   | 8.0    | 9.0    | 80 | 85 | 95\n";
+    output_file << "   set1   | structure_000004 | jobs/job1 |  done  |  none   | 0.1  | 1.20 | 1800.00 | 1800.00 | P 2_1/c       | 60 | 0.200 | 0.300 | 0.55 | 1.0   | 1.00 | 0     | 0    | 1 | 0.0    | 10.0  | 12.0   | 15.0   | 90 | 95 | 90\n";
     }
-
+    PowderMatchTable table( file_name );
+    test_suite.test_equality( table.size(), size_t( 4 ), "PowderMatchTable 01" );
+    test_suite.test_equality( table.name( 0 ), std::string( "structure_000001" ), "PowderMatchTable 02" );
+    test_suite.test_equality( table.space_group_name( 0 ), std::string( "P 2_1 2_1 2_1" ), "PowderMatchTable 03" );
+    test_suite.test_equality( table.status( 2 ), std::string( "failed" ), "PowderMatchTable 04" );
+    test_suite.test_equality_double( table.density( 1 ), 1.31, "PowderMatchTable 05" );
+    test_suite.test_equality_double( table.Biso( 1 ), 0.5, "PowderMatchTable 06" );
+    test_suite.test_equality_double( table.PO_direction( 0 ).x(), -0.36, "PowderMatchTable 07" );
+    test_suite.test_equality_double( table.energy_with_penalty( 2 ), -0.1, "PowderMatchTable 08" );
+    test_suite.test_equality_double( table.crystal_lattice( 1 ).beta().value_in_degrees(), 100.5, "PowderMatchTable 09" );
+    test_suite.test_equality_double( table.crystal_lattice( 2 ).c(), 9.0, "PowderMatchTable 10" );
+    {
+    PowderMatchTableQuery query;
+    test_suite.test_equality( table.select( query ).size(), size_t( 4 ), "PowderMatchTable::select() 01" );
+    query.density_min_ = 1.25;
+    query.FOM_max_ = 0.5;
+    std::vector< size_t > expected;
+    expected.push_back( 0 );
+    expected.push_back( 1 );
+    test_suite.test_equality( table.select( query ), expected, "PowderMatchTable::select() 02" );
+    query = PowderMatchTableQuery();
+    query.status_ = "done";
+    query.energy_min_ = 0.1;
+    expected.clear();
+    expected.push_back( 1 );
+    expected.push_back( 3 );
+    test_suite.test_equality( table.select( query ), expected, "PowderMatchTable::select() 03" );
+    }
+    {
+    // Rows 1 and 3 have the same energy_with_penalty, the tie is broken by row index
+    std::vector< size_t > expected;
+    expected.push_back( 2 );
+    expected.push_back( 1 );
+    expected.push_back( 3 );
+    test_suite.test_equality( table.top_k( 3 ), expected, "PowderMatchTable::top_k() 01" );
+    test_suite.test_equality( table.top_k( 10 ).size(), size_t( 4 ), "PowderMatchTable::top_k() 02" );
+    PowderMatchTableQuery query;
+    query.status_ = "done";
+    expected.clear();
+    expected.push_back( 1 );
+    test_suite.test_equality( table.top_k( 1, table.select( query ) ), expected, "PowderMatchTable::top_k() 03" );
+    }
+    {
+    test_suite.test_equality( table.structure_file( 2 ).file_name(), std::string( "structure_000003" ), "PowderMatchTable::structure_file() 01" );
+    test_suite.test_equality( table.structure_file( 2 ).extension(), std::string( "cif" ), "PowderMatchTable::structure_file() 02" );
+    std::vector< FileName > file_names;
+    file_names.push_back( FileName( "other/structure_000003.cif" ) );
+    file_names.push_back( FileName( "other/structure_000001.cif" ) );
+    file_names.push_back( FileName( "duplicate/structure_000001.cif" ) );
+    const std::vector< size_t > indices = table.join( FileList( file_names ) );
+    std::vector< size_t > expected;
+    expected.push_back( 1 );
+    expected.push_back( std::numeric_limits< size_t >::max() );
+    expected.push_back( 0 );
+    expected.push_back( std::numeric_limits< size_t >::max() );
+    test_suite.test_equality( indices, expected, "PowderMatchTable::join()" );
+    }
+    std::remove( file_name.full_name().c_str() );
 }
 
@@ -0,0 +1,267 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPattern.h"
+#include "Angle.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "MathFunctions.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// The original double loop, as a reference
+double weighted_cross_correlation_reference( const PowderPattern & lhs, const PowderPattern & rhs, const int m )
+{
+    double result( 0.0 );
+    for ( int i( 0 ); i != static_cast<int>( lhs.size() ); ++i )
+    {
+        for ( int j( -m + 1 ); j != m; ++j )
+        {
+            if ( ( ( i + j ) >= 0 ) && ( ( i + j ) < static_cast<int>( lhs.size() ) ) )
+                result += ( 1.0 - static_cast<double>( std::abs( j ) ) / m ) * ( lhs.intensity( i ) / lhs.estimated_standard_deviation( i ) ) * ( rhs.intensity( i + j ) / rhs.estimated_standard_deviation( i + j ) );
+        }
+    }
+    return result;
+}
+
+// The original implementation, as a reference
+PowderPattern Brueckner_background_reference( const PowderPattern & powder_pattern, const size_t niterations, const size_t window, const size_t smoothing_window )
+{
+    PowderPattern pp_new( powder_pattern );
+    size_t size( powder_pattern.size() );
+    for ( size_t i( 0 ); i < size; ++i )
+    {
+        double new_value = powder_pattern.intensity( i );
+        for ( size_t j( 1 ); j <= smoothing_window; ++j )
+        {
+            new_value += powder_pattern.intensity( std::max( int(i)-int(j), int(0) ) );
+            new_value += powder_pattern.intensity( std::min( i+j, size-1 ) );
+        }
+        pp_new.set_intensity( i, new_value / ( 2.0 * smoothing_window + 1.0 ) );
+    }
+    double I_average( 0.0 );
+    double I_minimum = pp_new.intensity( 0 );
+    for ( size_t i( 0 ); i < size; ++i )
+    {
+        I_minimum = std::min( I_minimum, pp_new.intensity( i ) );
+        I_average += pp_new.intensity( i );
+    }
+    I_average /= size;
+    for ( size_t i( 0 ); i < size; ++i )
+        pp_new.set_intensity( i, std::min( pp_new.intensity( i ), I_average + 2.0 * ( I_average - I_minimum ) ) );
+    for ( size_t iter( 0 ); iter < niterations; ++iter )
+    {
+        PowderPattern pp_old = pp_new;
+        for ( size_t i( 0 ); i < size; ++i )
+        {
+            double average_value( 0.0 );
+            for ( size_t j( 1 ); j <= window; ++j )
+            {
+                average_value += pp_old.intensity( std::max( int(i)-int(j), int(0) ) );
+                average_value += pp_old.intensity( std::min( i+j, size-1 ) );
+            }
+            pp_new.set_intensity( i, std::min( pp_old.intensity( i ), average_value / ( 2.0 * window ) ) );
+        }
+    }
+    return pp_new;
+}
+
+} // namespace
+
+void test_powder_pattern( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PowderPattern." << std::endl;
+    PowderPattern lhs( Angle::from_degrees( 5.0 ), Angle::from_degrees( 15.0 ), Angle::from_degrees( 0.02 ) );
+    PowderPattern rhs( Angle::from_degrees( 5.0 ), Angle::from_degrees( 15.0 ), Angle::from_degrees( 0.02 ) );
+    for ( size_t i( 0 ); i != lhs.size(); ++i )
+    {
+        lhs.set_intensity( i, 1000.0 * square( sin( 0.037 * i ) ) + 5.0 * i );
+        rhs.set_intensity( i, 1000.0 * square( sin( 0.041 * i + 0.3 ) ) + 100.0 );
+    }
+    lhs.recalculate_estimated_standard_deviations();
+    rhs.recalculate_estimated_standard_deviations();
+    // Window narrower than the pattern, 3 degrees, and wider than the pattern
+    const double ls[] = { 0.02, 0.5, 3.0, 25.0 };
+    for ( size_t k( 0 ); k != 4; ++k )
+    {
+        Angle l = Angle::from_degrees( ls[k] );
+        double reference = weighted_cross_correlation_reference( lhs, rhs, weighted_cross_correlation_window( lhs, l ) );
+        test_suite.test_equality_double( weighted_cross_correlation( lhs, rhs, l ) / reference, 1.0, "weighted_cross_correlation()", 0.0000000001 );
+        // Single precision
+        const std::vector< double > lhs_over_ESDs = intensities_over_ESDs( lhs );
+        const std::vector< double > rhs_over_ESDs = intensities_over_ESDs( rhs );
+        const std::vector< float > lhs_single_precision( lhs_over_ESDs.begin(), lhs_over_ESDs.end() );
+        const std::vector< float > rhs_single_precision( rhs_over_ESDs.begin(), rhs_over_ESDs.end() );
+        test_suite.test_equality_double( weighted_cross_correlation( &lhs_single_precision[0], &rhs_single_precision[0], lhs.size(), weighted_cross_correlation_window( lhs, l ) ) / reference, 1.0, "weighted_cross_correlation() single precision", 0.000001 );
+    }
+    test_suite.test_equality_double( normalised_weighted_cross_correlation( lhs, lhs ), 1.0, "normalised_weighted_cross_correlation() self" );
+    // Rwp() and cumulative_intensity() against the original scalar loops
+    double numerator( 0.0 );
+    double denominator( 0.0 );
+    double cumulative_intensity( 0.0 );
+    for ( size_t i( 0 ); i != lhs.size(); ++i )
+    {
+        numerator   += square( lhs.intensity( i ) - rhs.intensity( i ) ) / square( lhs.estimated_standard_deviation( i ) );
+        denominator += square( lhs.intensity( i ) ) / square( lhs.estimated_standard_deviation( i ) );
+        cumulative_intensity += lhs.intensity( i );
+    }
+    test_suite.test_equality_double( Rwp( lhs, rhs ), sqrt( numerator / denominator ), "Rwp()", 0.000000000001 );
+    test_suite.test_equality_double( Rwp( lhs, rhs, true ), sqrt( numerator / denominator ), "Rwp() compensated", 0.000000000001 );
+    test_suite.test_equality_double( lhs.cumulative_intensity( true ) / cumulative_intensity, 1.0, "PowderPattern::cumulative_intensity() compensated", 0.000000000001 );
+    test_suite.test_equality_double( lhs.cumulative_intensity() / cumulative_intensity, 1.0, "PowderPattern::cumulative_intensity()", 0.000000000001 );
+    PowderPattern reweighted( lhs );
+    reweighted.set_estimated_standard_deviation( 3, 2.0 );
+    test_suite.test_equality_double( reweighted.weights()[3], 0.25, "PowderPattern::weights()" );
+    // Constant 2theta step
+    test_suite.test_equality( lhs.has_constant_two_theta_step(), true, "PowderPattern::has_constant_two_theta_step() 01" );
+    test_suite.test_equality( lhs.size(), static_cast<size_t>( 501 ), "PowderPattern::size()" );
+    test_suite.test_equality_double( lhs.two_theta( 250 ).value_in_degrees(), 10.0, "PowderPattern::two_theta()" );
+    test_suite.test_equality_double( lhs.intensities()[7], lhs.intensity( 7 ), "PowderPattern::intensities()" );
+    PowderPattern shifted( lhs );
+    shifted.correct_zero_point_error( Angle::from_degrees( 0.1 ) );
+    test_suite.test_equality( shifted.has_constant_two_theta_step(), true, "PowderPattern::has_constant_two_theta_step() 02" );
+    test_suite.test_equality_double( shifted.two_theta_end().value_in_degrees(), 14.9, "PowderPattern::correct_zero_point_error()" );
+    shifted.set_two_theta( 3, Angle::from_degrees( 4.97 ) );
+    test_suite.test_equality( shifted.has_constant_two_theta_step(), false, "PowderPattern::has_constant_two_theta_step() 03" );
+    test_suite.test_equality_double( shifted.two_theta( 3 ).value_in_degrees(), 4.97, "PowderPattern::set_two_theta() 01" );
+    test_suite.test_equality_double( shifted.two_theta( 4 ).value_in_degrees(), 4.98, "PowderPattern::set_two_theta() 02" );
+    // The instrument file readers
+    {
+    FileName file_name( "TestPowderPattern.tmp" );
+    {
+    std::ofstream output_file( file_name.full_name().c_str() );
+    output_file << "<positions axis=\"2Theta\" unit=\"deg\">\n";
+    output_file << "  <startPosition>5.0</startPosition>\n";
+    output_file << "  <endPosition>5.3</endPosition>\n";
+    output_file << "</positions>\n";
+    output_file << "<intensities unit=\"counts\">10 20 30 40</intensities>\n";
+    }
+    PowderPattern powder_pattern;
+    powder_pattern.read_xrdml( file_name );
+    test_suite.test_equality( powder_pattern.size(), static_cast<size_t>( 4 ), "PowderPattern::read_xrdml() size" );
+    test_suite.test_equality_double( powder_pattern.two_theta( 2 ).value_in_degrees(), 5.2, "PowderPattern::read_xrdml() 2theta" );
+    test_suite.test_equality_double( powder_pattern.intensity( 3 ), 40.0, "PowderPattern::read_xrdml() intensity" );
+    {
+    std::ofstream output_file( file_name.full_name().c_str() );
+    output_file << "Title\n";
+    output_file << "BANK       1       3       1  CONST   500.00    2.00     0.0     0.0         ESD\n";
+    output_file << "      10       3      20     4.5\r\n";
+    output_file << "    30.5       6\n";
+    }
+    powder_pattern.read_raw( file_name );
+    test_suite.test_equality( powder_pattern.size(), static_cast<size_t>( 3 ), "PowderPattern::read_raw() size" );
+    test_suite.test_equality_double( powder_pattern.two_theta( 2 ).value_in_degrees(), 5.04, "PowderPattern::read_raw() 2theta" );
+    test_suite.test_equality_double( powder_pattern.intensity( 2 ), 30.5, "PowderPattern::read_raw() intensity" );
+    test_suite.test_equality_double( powder_pattern.estimated_standard_deviation( 1 ), 4.5, "PowderPattern::read_raw() ESD" );
+    {
+    std::ofstream output_file( file_name.full_name().c_str() );
+    output_file << "      <Datum>260,1,2,1,662</Datum>\n";
+    output_file << "      <datum>260,1,2.0409,1.0205,599</datum>\n";
+    }
+    powder_pattern.read_brml( file_name );
+    test_suite.test_equality( powder_pattern.size(), static_cast<size_t>( 2 ), "PowderPattern::read_brml() size" );
+    test_suite.test_equality_double( powder_pattern.two_theta( 1 ).value_in_degrees(), 2.0409, "PowderPattern::read_brml() 2theta" );
+    test_suite.test_equality_double( powder_pattern.intensity( 1 ), 599.0, "PowderPattern::read_brml() intensity" );
+    std::remove( file_name.full_name().c_str() );
+    }
+    // The binary .ppb format
+    {
+    FileName file_name( "TestPowderPattern.ppb" );
+    lhs.save_ppb( file_name );
+    PowderPattern powder_pattern( file_name );
+    test_suite.test_equality( powder_pattern.has_constant_two_theta_step(), true, "PowderPattern::read_ppb() constant 2theta step" );
+    test_suite.test_equality( powder_pattern.size(), lhs.size(), "PowderPattern::read_ppb() size" );
+    test_suite.test_equality( powder_pattern.two_theta_end() == lhs.two_theta_end(), true, "PowderPattern::read_ppb() 2theta" );
+    test_suite.test_equality( powder_pattern.intensity( 123 ) == lhs.intensity( 123 ), true, "PowderPattern::read_ppb() intensity" );
+    test_suite.test_equality( powder_pattern.estimated_standard_deviation( 123 ) == lhs.estimated_standard_deviation( 123 ), true, "PowderPattern::read_ppb() ESD" );
+    shifted.save_ppb( file_name, true );
+    powder_pattern.read_ppb( file_name );
+    test_suite.test_equality( powder_pattern.has_constant_two_theta_step(), false, "PowderPattern::read_ppb() explicit 2theta" );
+    test_suite.test_equality( powder_pattern.two_theta( 3 ) == shifted.two_theta( 3 ), true, "PowderPattern::read_ppb() explicit 2theta values" );
+    test_suite.test_equality_double( powder_pattern.intensity( 123 ), shifted.intensity( 123 ), "PowderPattern::read_ppb() single precision", 0.0001 );
+    // The cache is preferred over the .xye file when it is up to date
+    FileName xye_file_name( "TestPowderPattern.xye" );
+    rhs.save_xye( xye_file_name, true );
+    std::remove( file_name.full_name().c_str() );
+    std::vector< FileName > file_names( 1, xye_file_name );
+    build_ppb_caches( FileList( file_names ) );
+    test_suite.test_equality( file_name.exists(), true, "build_ppb_caches()" );
+    lhs.save_ppb( file_name );
+    powder_pattern = PowderPattern( xye_file_name );
+    test_suite.test_equality( powder_pattern.intensity( 123 ) == lhs.intensity( 123 ), true, "PowderPattern( FileName ) cache" );
+    std::remove( file_name.full_name().c_str() );
+    std::remove( xye_file_name.full_name().c_str() );
+    }
+    // Windows both smaller and larger than the pattern
+    const size_t windows[] = { 1, 50, 600 };
+    for ( size_t k( 0 ); k != 3; ++k )
+    {
+        PowderPattern background = calculate_Brueckner_background( lhs, 20, windows[k], true, 3 );
+        PowderPattern reference = Brueckner_background_reference( lhs, 20, windows[k], 3 );
+        double maximum_difference( 0.0 );
+        for ( size_t i( 0 ); i != lhs.size(); ++i )
+            maximum_difference = std::max( maximum_difference, std::abs( background.intensity( i ) - reference.intensity( i ) ) );
+        test_suite.test_equality_double( maximum_difference, 0.0, "calculate_Brueckner_background()", 0.000001 );
+    }
+    {
+    // Segments: constructed explicitly and recovered from 2theta values rounded to four decimals as in an .xye file
+    std::vector< TwoThetaSegment > segments;
+    segments.push_back( TwoThetaSegment( Angle::from_degrees( 5.0 ), Angle::from_degrees( 10.0 ), Angle::from_degrees( 0.01 ) ) );
+    segments.push_back( TwoThetaSegment( Angle::from_degrees( 10.02 ), Angle::from_degrees( 20.0 ), Angle::from_degrees( 0.02 ) ) );
+    segments.push_back( TwoThetaSegment( Angle::from_degrees( 25.0 ), Angle::from_degrees( 30.0 ), Angle::from_degrees( 0.0167 ) ) );
+    PowderPattern powder_pattern( segments );
+    test_suite.test_equality( powder_pattern.size(), size_t( 501 + 500 + 300 ), "PowderPattern( std::vector< TwoThetaSegment > ) size" );
+    test_suite.test_equality_double( powder_pattern.two_theta( 501 ).value_in_degrees(), 10.02, "PowderPattern( std::vector< TwoThetaSegment > ) 2theta" );
+    PowderPattern rounded;
+    for ( size_t i( 0 ); i != powder_pattern.size(); ++i )
+        rounded.push_back( Angle::from_degrees( round_to_int( powder_pattern.two_theta( i ).value_in_degrees() * 10000.0 ) / 10000.0 ), 1.0 );
+    const std::vector< TwoThetaSegment > found = rounded.two_theta_segments();
+    test_suite.test_equality( found.size(), size_t( 3 ), "PowderPattern::two_theta_segments() 01" );
+    for ( size_t i( 0 ); ( i != found.size() ) && ( i != 3 ); ++i )
+    {
+        test_suite.test_equality( found[i].npoints_, segments[i].npoints_, "PowderPattern::two_theta_segments() 02" );
+        test_suite.test_equality_double( found[i].two_theta_step_.value_in_degrees(), segments[i].two_theta_step_.value_in_degrees(), "PowderPattern::two_theta_segments() 03", 0.00001 );
+        test_suite.test_equality_double( found[i].two_theta_start_.value_in_degrees(), segments[i].two_theta_start_.value_in_degrees(), "PowderPattern::two_theta_segments() 04", 0.0001 );
+    }
+    test_suite.test_equality( found.back().first_point_, size_t( 1001 ), "PowderPattern::two_theta_segments() 05" );
+    test_suite.test_equality( lhs.two_theta_segments().size(), size_t( 1 ), "PowderPattern::two_theta_segments() 06" );
+    std::swap( segments[0], segments[1] );
+    bool exception_thrown( false );
+    try { PowderPattern overlapping( segments ); } catch ( std::runtime_error & ) { exception_thrown = true; }
+    test_suite.test_equality( exception_thrown, true, "PowderPattern( std::vector< TwoThetaSegment > ) overlap" );
+    }
+}
@@ -0,0 +1,107 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "PowderPattern.h"
+#include "PowderPatternCache.h"
+#include "PowderPatternCalculator.h"
+#include "ReflectionList.h"
+#include "RunBenchmarks.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+
+void test_powder_pattern_cache( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PowderPatternCache." << std::endl;
+
+    const std::string directory( "test_powder_pattern_cache" );
+    mkdir( directory.c_str(), 0755 );
+    {
+    CrystalStructure crystal_structure = synthetic_molecular_crystal( 1 );
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_start( Angle( 5.0, Angle::DEGREES ) );
+    powder_pattern_calculator.set_two_theta_end( Angle( 25.0, Angle::DEGREES ) );
+    powder_pattern_calculator.set_two_theta_step( Angle( 0.02, Angle::DEGREES ) );
+    powder_pattern_calculator.set_FWHM( 0.1 );
+    PowderPatternCache powder_pattern_cache( directory, 0 );
+    PowderPattern calculated_powder_pattern;
+    ReflectionList calculated_reflection_list;
+    test_suite.test_equality( powder_pattern_cache.calculate( crystal_structure, powder_pattern_calculator, calculated_powder_pattern, calculated_reflection_list ), false, "PowderPatternCache::calculate() 01" );
+    PowderPattern cached_powder_pattern;
+    ReflectionList cached_reflection_list;
+    test_suite.test_equality( powder_pattern_cache.calculate( crystal_structure, powder_pattern_calculator, cached_powder_pattern, cached_reflection_list ), true, "PowderPatternCache::calculate() 02" );
+    test_suite.test_equality( powder_pattern_cache.nhits(), size_t( 1 ), "PowderPatternCache::nhits()" );
+    test_suite.test_equality( powder_pattern_cache.nmisses(), size_t( 1 ), "PowderPatternCache::nmisses()" );
+    test_suite.test_equality( cached_powder_pattern.size(), calculated_powder_pattern.size(), "PowderPatternCache::find() 01" );
+    bool all_equal( true );
+    for ( size_t i( 0 ); i != calculated_powder_pattern.size(); ++i )
+    {
+        if ( ( cached_powder_pattern.intensity( i ) != calculated_powder_pattern.intensity( i ) ) ||
+             ( cached_powder_pattern.estimated_standard_deviation( i ) != calculated_powder_pattern.estimated_standard_deviation( i ) ) )
+            all_equal = false;
+    }
+    test_suite.test_equality( all_equal, true, "PowderPatternCache::find() 02" );
+    test_suite.test_equality_double( cached_powder_pattern.two_theta( 1000 ).value_in_degrees(), 25.0, "PowderPatternCache::find() 03" );
+    test_suite.test_equality( cached_reflection_list.size(), calculated_reflection_list.size(), "PowderPatternCache::find() 04" );
+    test_suite.test_equality( cached_reflection_list.F_squared( 3 ), calculated_reflection_list.F_squared( 3 ), "PowderPatternCache::find() 05" );
+    test_suite.test_equality( cached_reflection_list.miller_indices( 3 ), calculated_reflection_list.miller_indices( 3 ), "PowderPatternCache::find() 06" );
+    // The order of the atoms is not part of the key, the settings are.
+    const std::string key = PowderPatternCache::key( crystal_structure, powder_pattern_calculator );
+    CrystalStructure reordered( crystal_structure );
+    reordered.set_atom( 0, crystal_structure.atom( 1 ) );
+    reordered.set_atom( 1, crystal_structure.atom( 0 ) );
+    test_suite.test_equality( PowderPatternCache::key( reordered, powder_pattern_calculator ), key, "PowderPatternCache::key() 01" );
+    powder_pattern_calculator.set_FWHM( 0.2 );
+    test_suite.test_equality( PowderPatternCache::key( crystal_structure, powder_pattern_calculator ) != key, true, "PowderPatternCache::key() 02" );
+    // A file with the right name but another key is a miss.
+    test_suite.test_equality( std::rename( powder_pattern_cache.file_name( key ).full_name().c_str(), powder_pattern_cache.file_name( "other" ).full_name().c_str() ), 0, "PowderPatternCache::find() 07" );
+    test_suite.test_equality( powder_pattern_cache.find( "other", cached_powder_pattern, cached_reflection_list ), false, "PowderPatternCache::find() 08" );
+    std::remove( powder_pattern_cache.file_name( "other" ).full_name().c_str() );
+    }
+    {
+    PowderPattern powder_pattern( Angle( 5.0, Angle::DEGREES ), Angle( 25.0, Angle::DEGREES ), Angle( 0.02, Angle::DEGREES ) );
+    PowderPatternCache powder_pattern_cache( directory, 24000 );
+    // Each file is a little over 16 kB, so one of the two files is evicted.
+    powder_pattern_cache.store( "1", powder_pattern, ReflectionList() );
+    powder_pattern_cache.store( "2", powder_pattern, ReflectionList() );
+    powder_pattern_cache.evict();
+    FileList file_list;
+    file_list.initialise_from_directory( directory, "*.ppcache" );
+    test_suite.test_equality( file_list.size(), size_t( 1 ), "PowderPatternCache::evict()" );
+    std::remove( powder_pattern_cache.file_name( "1" ).full_name().c_str() );
+    std::remove( powder_pattern_cache.file_name( "2" ).full_name().c_str() );
+    }
+    std::remove( directory.c_str() );
+}
+
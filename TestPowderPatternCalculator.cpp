@@ -0,0 +1,545 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternCalculator.h"
+#include "3DCalculations.h"
+#include "BatchPowderPatternCalculator.h"
+#include "CrystalStructure.h"
+#include "KernelVerification.h"
+#include "MathFunctions.h"
+#include "PeakShapeFunction.h"
+#include "PointGroup.h"
+#include "PowderPattern.h"
+#include "ReflectionList.h"
+#include "SpaceGroup.h"
+#include "SymmetricMatrix3D.h"
+#include "SymmetryOperator.h"
+#include "Utilities.h"
+#include "Wavelength.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Asymmetric unit with a mix of elements, occupancies and ADP types, all atoms on general positions.
+CrystalStructure test_asymmetric_unit( const SpaceGroup & space_group )
+{
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 7.1, 9.3, 11.7, Angle::angle_90_degrees(), Angle::from_degrees( 103.4 ), Angle::angle_90_degrees() ) );
+    crystal_structure.set_space_group( space_group );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.123, 0.234, 0.345 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "N" ), Vector3D( 0.311, 0.087, 0.412 ), "N1" ) );
+    crystal_structure.add_atom( Atom( Element( "H" ), Vector3D( 0.051, 0.298, 0.277 ), "H1" ) );
+    Atom Cl1( Element( "Cl" ), Vector3D( 0.702, 0.143, 0.906 ), "Cl1" );
+    Cl1.set_Uiso( 0.035 );
+    crystal_structure.add_atom( Cl1 );
+    Atom O1( Element( "O" ), Vector3D( 0.456, 0.789, 0.012 ), "O1" );
+    O1.set_Uiso( 0.021 );
+    O1.set_occupancy( 0.5 );
+    crystal_structure.add_atom( O1 );
+    crystal_structure.add_atom( Atom( Element( "S" ), Vector3D( 0.871, 0.612, 0.233 ), "S1", AnisotropicDisplacementParameters( SymmetricMatrix3D( 0.031, 0.045, 0.027, 0.004, -0.006, 0.002 ) ) ) );
+    return crystal_structure;
+}
+
+// ********************************************************************************
+
+// Shifts the given atoms, each by a different amount.
+void move_atoms( CrystalStructure & crystal_structure, const std::vector< size_t > & atoms )
+{
+    for ( size_t i( 0 ); i != atoms.size(); ++i )
+    {
+        Atom atom = crystal_structure.atom( atoms[i] );
+        atom.set_position( atom.position() + Vector3D( 0.013 * ( i + 1 ), -0.021, 0.008 * ( i + 2 ) ) );
+        crystal_structure.set_atom( atoms[i], atom );
+    }
+}
+
+// ********************************************************************************
+
+// Compares the F^2 values in the reflection list against the reference implementation.
+void check_F_squared( const CrystalStructure & crystal_structure, const ReflectionList & reflection_list, const std::string & message, TestSuite & test_suite, const RadiationType radiation_type = X_RAYS )
+{
+    if ( reflection_list.size() == 0 )
+        test_suite.log_error( message + ": no reflections." );
+    for ( size_t i( 0 ); i != reflection_list.size(); ++i )
+    {
+        double target = reference_F_squared( crystal_structure, reflection_list.miller_indices( i ), reflection_list.d_spacing( i ), radiation_type );
+        if ( fabs( reflection_list.F_squared( i ) - target ) > 0.000001 * std::max( 1.0, target ) )
+        {
+            test_suite.log_error( message + ": F^2 wrong for " + reflection_list.miller_indices( i ).to_string() );
+            return;
+        }
+    }
+}
+
+// ********************************************************************************
+
+// Brute-force enumeration of the reflection list: full box, equivalents generated as a std::set.
+std::map< MillerIndices, size_t > reference_reflections( const CrystalStructure & crystal_structure, const double wavelength, const Angle two_theta_end, const int max_index )
+{
+    std::map< MillerIndices, size_t > result;
+    PointGroup laue_class = crystal_structure.space_group().laue_class();
+    SpaceGroup space_group = crystal_structure.space_group();
+    for ( int h( -max_index ); h <= max_index; ++h )
+    {
+        for ( int k( -max_index ); k <= max_index; ++k )
+        {
+            for ( int l( -max_index ); l <= max_index; ++l )
+            {
+                MillerIndices miller_indices( h, k, l );
+                if ( miller_indices.is_000() )
+                    continue;
+                double d = 1.0 / reciprocal_lattice_point( miller_indices, crystal_structure.crystal_lattice() ).length();
+                if ( wavelength > 2.0 * d )
+                    continue;
+                if ( 2.0 * arcsine( wavelength / ( 2.0 * d ) ) >= two_theta_end + Angle::from_degrees( 0.1 ) )
+                    continue;
+                std::set< MillerIndices > equivalent_reflections;
+                for ( size_t i( 0 ); i != laue_class.nsymmetry_operators(); ++i )
+                    equivalent_reflections.insert( miller_indices * laue_class.symmetry_operator( i ) );
+                if ( ! ( miller_indices == *equivalent_reflections.begin() ) )
+                    continue;
+                bool is_absent( false );
+                for ( size_t i( 1 ); i != space_group.nsymmetry_operators(); ++i )
+                {
+                    if ( miller_indices * space_group.symmetry_operator( i ).rotation() == miller_indices )
+                    {
+                        double HT = miller_indices * space_group.symmetry_operator( i ).translation();
+                        if ( ! nearly_equal( HT, round_to_int( HT ), 0.05 ) )
+                            is_absent = true;
+                    }
+                }
+                if ( ! is_absent )
+                    result[ miller_indices ] = equivalent_reflections.size();
+            }
+        }
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+void check_reflection_list( const CrystalStructure & crystal_structure, const std::string & message, TestSuite & test_suite )
+{
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 35.0 ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    ReflectionList reflection_list = powder_pattern_calculator.reflection_list();
+    std::map< MillerIndices, size_t > target = reference_reflections( crystal_structure, powder_pattern_calculator.wavelength(), powder_pattern_calculator.two_theta_end(), 15 );
+    if ( reflection_list.size() != target.size() )
+    {
+        test_suite.log_error( message + ": number of reflections wrong." );
+        return;
+    }
+    for ( size_t i( 0 ); i != reflection_list.size(); ++i )
+    {
+        std::map< MillerIndices, size_t >::const_iterator it = target.find( reflection_list.miller_indices( i ) );
+        if ( ( it == target.end() ) || ( it->second != reflection_list.multiplicity( i ) ) )
+        {
+            test_suite.log_error( message + ": reflection or multiplicity wrong for " + reflection_list.miller_indices( i ).to_string() );
+            return;
+        }
+    }
+}
+
+} // namespace
+
+void test_powder_pattern_calculator( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PowderPatternCalculator." << std::endl;
+    std::vector< SymmetryOperator > symmetry_operators;
+    symmetry_operators.push_back( SymmetryOperator( "x,y,z" ) );
+    symmetry_operators.push_back( SymmetryOperator( "-x,y+1/2,-z" ) );
+    SpaceGroup P21( symmetry_operators, "P21" );
+    {
+    CrystalStructure crystal_structure = test_asymmetric_unit( SpaceGroup::P21c() );
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 40.0 ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    check_F_squared( crystal_structure, powder_pattern_calculator.reflection_list(), "PowderPatternCalculator::calculate_structure_factors() unit cell", test_suite );
+    }
+    {
+    CrystalStructure asymmetric_unit = test_asymmetric_unit( SpaceGroup::P21c() );
+    CrystalStructure crystal_structure( asymmetric_unit );
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( asymmetric_unit, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 40.0 ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    check_F_squared( crystal_structure, powder_pattern_calculator.reflection_list(), "PowderPatternCalculator::calculate_structure_factors() asymmetric unit centrosymmetric", test_suite );
+    }
+    {
+    CrystalStructure asymmetric_unit = test_asymmetric_unit( P21 );
+    CrystalStructure crystal_structure( asymmetric_unit );
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( asymmetric_unit, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 40.0 ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    check_F_squared( crystal_structure, powder_pattern_calculator.reflection_list(), "PowderPatternCalculator::calculate_structure_factors() asymmetric unit non-centrosymmetric", test_suite );
+    }
+    {
+    // Moving a few atoms and updating incrementally must give the same F^2 values as a full calculation
+    CrystalStructure asymmetric_unit = test_asymmetric_unit( SpaceGroup::P21c() );
+    CrystalStructure crystal_structure( asymmetric_unit );
+    crystal_structure.apply_space_group_symmetry();
+    CrystalStructure asymmetric_unit_P21 = test_asymmetric_unit( P21 );
+    std::vector< size_t > moved_atoms;
+    moved_atoms.push_back( 0 );
+    moved_atoms.push_back( 5 );
+    std::vector< size_t > moved_atoms_unit_cell;
+    moved_atoms_unit_cell.push_back( 1 );
+    moved_atoms_unit_cell.push_back( 14 );
+    moved_atoms_unit_cell.push_back( 23 );
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    PowderPatternCalculator powder_pattern_calculator_centrosymmetric( asymmetric_unit, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    PowderPatternCalculator powder_pattern_calculator_non_centrosymmetric( asymmetric_unit_P21, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    powder_pattern_calculator_centrosymmetric.calculate_reflection_list();
+    powder_pattern_calculator_centrosymmetric.calculate_structure_factors();
+    powder_pattern_calculator_non_centrosymmetric.calculate_reflection_list();
+    powder_pattern_calculator_non_centrosymmetric.calculate_structure_factors();
+    move_atoms( crystal_structure, moved_atoms_unit_cell );
+    move_atoms( asymmetric_unit, moved_atoms );
+    move_atoms( asymmetric_unit_P21, moved_atoms );
+    powder_pattern_calculator.update_structure_factors( moved_atoms_unit_cell );
+    powder_pattern_calculator_centrosymmetric.update_structure_factors( moved_atoms );
+    powder_pattern_calculator_non_centrosymmetric.update_structure_factors( moved_atoms );
+    check_F_squared( crystal_structure, powder_pattern_calculator.reflection_list(), "PowderPatternCalculator::update_structure_factors() unit cell", test_suite );
+    CrystalStructure unit_cell( asymmetric_unit );
+    unit_cell.apply_space_group_symmetry();
+    check_F_squared( unit_cell, powder_pattern_calculator_centrosymmetric.reflection_list(), "PowderPatternCalculator::update_structure_factors() asymmetric unit centrosymmetric", test_suite );
+    CrystalStructure unit_cell_P21( asymmetric_unit_P21 );
+    unit_cell_P21.apply_space_group_symmetry();
+    check_F_squared( unit_cell_P21, powder_pattern_calculator_non_centrosymmetric.reflection_list(), "PowderPatternCalculator::update_structure_factors() asymmetric unit non-centrosymmetric", test_suite );
+    }
+    {
+    // Neutrons and electrons, full calculation and incremental update
+    const RadiationType radiation_types[2] = { NEUTRONS, ELECTRONS };
+    const std::string names[2] = { "neutrons", "electrons" };
+    for ( size_t i( 0 ); i != 2; ++i )
+    {
+        CrystalStructure asymmetric_unit = test_asymmetric_unit( SpaceGroup::P21c() );
+        PowderPatternCalculator powder_pattern_calculator( asymmetric_unit, PowderPatternCalculator::ASYMMETRIC_UNIT );
+        powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 40.0 ) );
+        PowderPattern powder_pattern;
+        powder_pattern_calculator.calculate( powder_pattern );
+        // Must invalidate the X-ray structure factors
+        powder_pattern_calculator.set_radiation_type( radiation_types[i] );
+        test_suite.test_equality( powder_pattern_calculator.radiation_type() == radiation_types[i], true, "PowderPatternCalculator::set_radiation_type() " + names[i] );
+        powder_pattern_calculator.calculate( powder_pattern );
+        CrystalStructure unit_cell( asymmetric_unit );
+        unit_cell.apply_space_group_symmetry();
+        check_F_squared( unit_cell, powder_pattern_calculator.reflection_list(), "PowderPatternCalculator::calculate_structure_factors() " + names[i], test_suite, radiation_types[i] );
+        std::vector< size_t > moved_atoms;
+        moved_atoms.push_back( 2 );
+        move_atoms( asymmetric_unit, moved_atoms );
+        powder_pattern_calculator.update_structure_factors( moved_atoms );
+        unit_cell = asymmetric_unit;
+        unit_cell.apply_space_group_symmetry();
+        check_F_squared( unit_cell, powder_pattern_calculator.reflection_list(), "PowderPatternCalculator::update_structure_factors() " + names[i], test_suite, radiation_types[i] );
+    }
+    }
+    {
+    CrystalStructure crystal_structure = test_asymmetric_unit( SpaceGroup::P21c() );
+    crystal_structure.apply_space_group_symmetry();
+    check_reflection_list( crystal_structure, "PowderPatternCalculator::calculate_reflection_list() P21/c", test_suite );
+    }
+    {
+    std::vector< SymmetryOperator > symmetry_operators;
+    symmetry_operators.push_back( SymmetryOperator( "x,y,z" ) );
+    symmetry_operators.push_back( SymmetryOperator( "-x,-y,z" ) );
+    symmetry_operators.push_back( SymmetryOperator( "y,-x,-z" ) );
+    symmetry_operators.push_back( SymmetryOperator( "-y,x,-z" ) );
+    symmetry_operators.push_back( SymmetryOperator( "x+1/2,y+1/2,z+1/2" ) );
+    symmetry_operators.push_back( SymmetryOperator( "-x+1/2,-y+1/2,z+1/2" ) );
+    symmetry_operators.push_back( SymmetryOperator( "y+1/2,-x+1/2,-z+1/2" ) );
+    symmetry_operators.push_back( SymmetryOperator( "-y+1/2,x+1/2,-z+1/2" ) );
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 8.3, 8.3, 6.1, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    crystal_structure.set_space_group( SpaceGroup( symmetry_operators, "I-4" ) );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.123, 0.234, 0.345 ), "C1" ) );
+    crystal_structure.apply_space_group_symmetry();
+    check_reflection_list( crystal_structure, "PowderPatternCalculator::calculate_reflection_list() I-4", test_suite );
+    }
+    {
+    CrystalStructure crystal_structure = test_asymmetric_unit( SpaceGroup::P21c() );
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    PowderPattern powder_pattern;
+    powder_pattern_calculator.calculate( powder_pattern );
+    size_t nreflections = powder_pattern_calculator.reflection_list().size();
+    // Only the convolution should be redone
+    powder_pattern_calculator.set_FWHM( 0.2 );
+    powder_pattern_calculator.calculate( powder_pattern );
+    test_suite.test_equality( powder_pattern_calculator.reflection_list().size(), nreflections, "PowderPatternCalculator::calculate() reflection list duplicated" );
+    PowderPatternCalculator powder_pattern_calculator_2( crystal_structure );
+    powder_pattern_calculator_2.set_FWHM( 0.2 );
+    PowderPattern powder_pattern_2;
+    powder_pattern_calculator_2.calculate( powder_pattern_2 );
+    bool are_equal = ( powder_pattern.size() == powder_pattern_2.size() );
+    for ( size_t i( 0 ); are_equal && ( i != powder_pattern.size() ); ++i )
+        are_equal = nearly_equal( powder_pattern.intensity( i ), powder_pattern_2.intensity( i ) );
+    if ( ! are_equal )
+        test_suite.log_error( "PowderPatternCalculator::calculate() cached reflection list" );
+    // Changing the wavelength must regenerate the reflection list
+    powder_pattern_calculator.set_wavelength( 0.7093 );
+    powder_pattern_calculator.calculate( powder_pattern );
+    if ( powder_pattern_calculator.reflection_list().size() <= nreflections )
+        test_suite.log_error( "PowderPatternCalculator::set_wavelength() did not invalidate the reflection list" );
+    }
+    {
+    // With a coarse 2theta step the peaks must not be shifted to the nearest 2theta point
+    CrystalStructure crystal_structure = test_asymmetric_unit( SpaceGroup::P21c() );
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    GaussianPeakShape peak_shape_function( 0.15 );
+    powder_pattern_calculator.set_peak_shape_function( peak_shape_function );
+    powder_pattern_calculator.set_two_theta_start( Angle::from_degrees( 10.0 ) );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 15.0 ) );
+    powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.03 ) );
+    PowderPattern powder_pattern;
+    powder_pattern_calculator.calculate_for_testing( powder_pattern );
+    double sum( 0.0 );
+    double weighted_sum( 0.0 );
+    for ( size_t i( 0 ); i != powder_pattern.size(); ++i )
+    {
+        sum += powder_pattern.intensity( i );
+        weighted_sum += powder_pattern.intensity( i ) * powder_pattern.two_theta( i ).value_in_degrees();
+    }
+    test_suite.test_equality_double( weighted_sum / sum, 12.5, "PowderPatternCalculator::calculate_for_testing() peak position", 0.0001 );
+    }
+    {
+    // The FFT convolution must reproduce the direct summation. The highest peak is normalised to 10000 and both methods
+    // cut the peaks off at 0.1% of their maximum, which does not happen at exactly the same 2theta values.
+    CrystalStructure crystal_structure = test_asymmetric_unit( SpaceGroup::P21c() );
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    ThompsonCoxHastingsPeakShape peak_shape_function( 0.01, -0.002, 0.003, 0.02, 0.01 );
+    powder_pattern_calculator.set_peak_shape_function( peak_shape_function );
+    powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    PowderPattern powder_pattern;
+    powder_pattern_calculator.calculate( powder_pattern );
+    powder_pattern_calculator.set_peak_convolution( PowderPatternCalculator::FFT, Angle::from_degrees( 1.0 ) );
+    PowderPattern powder_pattern_2;
+    powder_pattern_calculator.calculate( powder_pattern_2 );
+    bool are_equal = ( powder_pattern.size() == powder_pattern_2.size() );
+    for ( size_t i( 0 ); are_equal && ( i != powder_pattern.size() ); ++i )
+        are_equal = nearly_equal( powder_pattern.intensity( i ), powder_pattern_2.intensity( i ), 20.0 );
+    if ( ! are_equal )
+        test_suite.log_error( "PowderPatternCalculator::calculate() FFT" );
+    }
+    {
+    // The F^2 values must not depend on the number of threads, for a full calculation and for an update
+    CrystalStructure asymmetric_unit = test_asymmetric_unit( SpaceGroup::P21c() );
+    CrystalStructure asymmetric_unit_2( asymmetric_unit );
+    PowderPatternCalculator powder_pattern_calculator( asymmetric_unit, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    PowderPatternCalculator powder_pattern_calculator_2( asymmetric_unit_2, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    powder_pattern_calculator_2.set_nthreads( 4 );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    powder_pattern_calculator_2.calculate_reflection_list();
+    powder_pattern_calculator_2.calculate_structure_factors();
+    std::vector< size_t > moved_atoms;
+    moved_atoms.push_back( 1 );
+    move_atoms( asymmetric_unit, moved_atoms );
+    move_atoms( asymmetric_unit_2, moved_atoms );
+    for ( size_t k( 0 ); k != 2; ++k )
+    {
+        bool are_equal = ( powder_pattern_calculator.reflection_list().size() == powder_pattern_calculator_2.reflection_list().size() );
+        for ( size_t i( 0 ); are_equal && ( i != powder_pattern_calculator.reflection_list().size() ); ++i )
+            are_equal = ( powder_pattern_calculator.reflection_list().F_squared( i ) == powder_pattern_calculator_2.reflection_list().F_squared( i ) );
+        test_suite.test_equality( are_equal, true, "PowderPatternCalculator::set_nthreads() " + size_t2string( k ) );
+        powder_pattern_calculator.update_structure_factors( moved_atoms );
+        powder_pattern_calculator_2.update_structure_factors( moved_atoms );
+    }
+    }
+    {
+    // Calculating on a grid of two ranges with different steps must give the same intensities as a uniform grid that contains all its points
+    CrystalStructure crystal_structure = test_asymmetric_unit( SpaceGroup::P21c() );
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 40.0 ) );
+    PowderPattern uniform;
+    powder_pattern_calculator.calculate( uniform );
+    std::vector< TwoThetaSegment > segments;
+    segments.push_back( TwoThetaSegment( Angle::from_degrees( 5.0 ), Angle::from_degrees( 20.0 ), Angle::from_degrees( 0.01 ) ) );
+    segments.push_back( TwoThetaSegment( Angle::from_degrees( 20.02 ), Angle::from_degrees( 40.0 ), Angle::from_degrees( 0.02 ) ) );
+    PowderPattern experimental( segments );
+    powder_pattern_calculator.set_two_theta_grid( experimental );
+    test_suite.test_equality( powder_pattern_calculator.has_two_theta_grid(), true, "PowderPatternCalculator::set_two_theta_grid() 01" );
+    PowderPattern on_grid;
+    powder_pattern_calculator.calculate( on_grid );
+    test_suite.test_equality( on_grid.size(), experimental.size(), "PowderPatternCalculator::set_two_theta_grid() 02" );
+    // The patterns are normalised on their own highest points, so fit a scale factor
+    std::vector< size_t > uniform_indices;
+    for ( size_t i( 0 ); i != on_grid.size(); ++i )
+        uniform_indices.push_back( ( i < segments[0].npoints_ ) ? i : 1502 + 2 * ( i - segments[0].npoints_ ) );
+    double sum_gu( 0.0 );
+    double sum_uu( 0.0 );
+    for ( size_t i( 0 ); i != on_grid.size(); ++i )
+    {
+        sum_gu += on_grid.intensity( i ) * uniform.intensity( uniform_indices[i] );
+        sum_uu += square( uniform.intensity( uniform_indices[i] ) );
+    }
+    const double scale = sum_gu / sum_uu;
+    bool are_equal( true );
+    for ( size_t i( 0 ); are_equal && ( i != on_grid.size() ); ++i )
+        are_equal = nearly_equal( on_grid.two_theta( i ), uniform.two_theta( uniform_indices[i] ) ) &&
+                    nearly_equal( on_grid.intensity( i ), scale * uniform.intensity( uniform_indices[i] ), 0.001 );
+    test_suite.test_equality( are_equal, true, "PowderPatternCalculator::set_two_theta_grid() 03" );
+    // With the FFT each range is convoluted separately
+    powder_pattern_calculator.set_peak_convolution( PowderPatternCalculator::FFT, Angle::from_degrees( 1.0 ) );
+    PowderPattern on_grid_FFT;
+    powder_pattern_calculator.calculate( on_grid_FFT );
+    are_equal = ( on_grid_FFT.size() == on_grid.size() );
+    for ( size_t i( 0 ); are_equal && ( i != on_grid.size() ); ++i )
+        are_equal = nearly_equal( on_grid.intensity( i ), on_grid_FFT.intensity( i ), 20.0 );
+    test_suite.test_equality( are_equal, true, "PowderPatternCalculator::set_two_theta_grid() FFT" );
+    // Back to a uniform grid
+    powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.01 ) );
+    test_suite.test_equality( powder_pattern_calculator.has_two_theta_grid(), false, "PowderPatternCalculator::set_two_theta_grid() 04" );
+    }
+    {
+    // The batch calculator must give the same patterns as one calculator per structure, in the same order
+    std::vector< CrystalStructure > crystal_structures;
+    crystal_structures.push_back( test_asymmetric_unit( SpaceGroup::P21c() ) );
+    crystal_structures.push_back( test_asymmetric_unit( SpaceGroup() ) );
+    crystal_structures.push_back( test_asymmetric_unit( SpaceGroup::P21c() ) );
+    crystal_structures[2].set_crystal_lattice( CrystalLattice( 7.3, 9.1, 11.9, Angle::angle_90_degrees(), Angle::from_degrees( 98.0 ), Angle::angle_90_degrees() ) );
+    for ( size_t i( 0 ); i != crystal_structures.size(); ++i )
+        crystal_structures[i].apply_space_group_symmetry();
+    BatchPowderPatternCalculator batch_powder_pattern_calculator;
+    batch_powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    batch_powder_pattern_calculator.set_nthreads( 2 );
+    batch_powder_pattern_calculator.calculate( crystal_structures );
+    test_suite.test_equality( batch_powder_pattern_calculator.npatterns(), crystal_structures.size(), "BatchPowderPatternCalculator::npatterns()" );
+    bool are_equal( true );
+    for ( size_t i( 0 ); i != crystal_structures.size(); ++i )
+    {
+        PowderPatternCalculator powder_pattern_calculator( crystal_structures[i] );
+        powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+        PowderPattern powder_pattern;
+        powder_pattern_calculator.calculate( powder_pattern );
+        are_equal = are_equal && ( powder_pattern.size() == batch_powder_pattern_calculator.npoints() );
+        for ( size_t j( 0 ); are_equal && ( j != powder_pattern.size() ); ++j )
+            are_equal = nearly_equal( powder_pattern.intensity( j ), batch_powder_pattern_calculator.intensity( i, j ) );
+    }
+    if ( ! are_equal )
+        test_suite.log_error( "BatchPowderPatternCalculator::calculate()" );
+    }
+    {
+    // Preferred orientation from the stored equivalent directions must be the same as from the equivalent reflections
+    CrystalStructure crystal_structure = test_asymmetric_unit( SpaceGroup::P21c() );
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_preferred_orientation( MillerIndices( 1, 0, 2 ), 0.8 );
+    PowderPattern powder_pattern;
+    powder_pattern_calculator.calculate( powder_pattern );
+    ReflectionList reflection_list = powder_pattern_calculator.reflection_list();
+    ReflectionList reflection_list_2;
+    for ( size_t i( 0 ); i != reflection_list.size(); ++i )
+    {
+        if ( reflection_list.nequivalent_directions( i ) != reflection_list.multiplicity( i ) )
+            test_suite.log_error( "ReflectionList::nequivalent_directions()" );
+        reflection_list_2.push_back( reflection_list.miller_indices( i ), reflection_list.F_squared( i ), reflection_list.d_spacing( i ), reflection_list.multiplicity( i ) );
+    }
+    PowderPattern powder_pattern_2;
+    powder_pattern_calculator.calculate( reflection_list_2, powder_pattern_2 );
+    bool are_equal = ( powder_pattern.size() == powder_pattern_2.size() );
+    for ( size_t i( 0 ); are_equal && ( i != powder_pattern.size() ); ++i )
+        are_equal = nearly_equal( powder_pattern.intensity( i ), powder_pattern_2.intensity( i ) );
+    if ( ! are_equal )
+        test_suite.log_error( "PowderPatternCalculator::calculate() preferred orientation" );
+    }
+    {
+    // A doublet is a linear combination of the two single-wavelength patterns, with an intensity ratio of 0 it is the first one
+    CrystalStructure crystal_structure = test_asymmetric_unit( SpaceGroup::P21c() );
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 40.0 ) );
+    PowderPattern single_1;
+    PowderPattern single_2;
+    PowderPattern doublet_0;
+    PowderPattern doublet;
+    powder_pattern_calculator.set_wavelength( 1.54056 );
+    powder_pattern_calculator.calculate( single_1 );
+    powder_pattern_calculator.set_wavelength( 1.54439 );
+    powder_pattern_calculator.calculate( single_2 );
+    powder_pattern_calculator.set_wavelength( Wavelength( 1.54056, 1.54439 ), 0.0 );
+    powder_pattern_calculator.calculate( doublet_0 );
+    powder_pattern_calculator.set_wavelength( Wavelength( 1.54056, 1.54439 ) );
+    test_suite.test_equality( powder_pattern_calculator.has_doublet(), true, "PowderPatternCalculator doublet 01" );
+    test_suite.test_equality_double( powder_pattern_calculator.wavelength_2(), 1.54439, "PowderPatternCalculator doublet 02" );
+    powder_pattern_calculator.calculate( doublet );
+    // Fit doublet = a * single_1 + b * single_2 below 38 degrees, away from where the peaks are cut off at the end of the reflection list
+    double s11( 0.0 ), s12( 0.0 ), s22( 0.0 ), s1d( 0.0 ), s2d( 0.0 ), sdd( 0.0 );
+    bool are_equal( true );
+    for ( size_t i( 0 ); i != doublet.size(); ++i )
+    {
+        are_equal = are_equal && nearly_equal( doublet_0.intensity( i ), single_1.intensity( i ) );
+        if ( doublet.two_theta( i ) > Angle::from_degrees( 38.0 ) )
+            continue;
+        s11 += single_1.intensity( i ) * single_1.intensity( i );
+        s12 += single_1.intensity( i ) * single_2.intensity( i );
+        s22 += single_2.intensity( i ) * single_2.intensity( i );
+        s1d += single_1.intensity( i ) * doublet.intensity( i );
+        s2d += single_2.intensity( i ) * doublet.intensity( i );
+        sdd += doublet.intensity( i ) * doublet.intensity( i );
+    }
+    test_suite.test_equality( are_equal, true, "PowderPatternCalculator doublet 03" );
+    const double determinant = s11 * s22 - s12 * s12;
+    const double a = ( s22 * s1d - s12 * s2d ) / determinant;
+    const double b = ( s11 * s2d - s12 * s1d ) / determinant;
+    const double residual = sdd - 2.0 * a * s1d - 2.0 * b * s2d + a * a * s11 + 2.0 * a * b * s12 + b * b * s22;
+    test_suite.test_equality( residual < 1.0E-8 * sdd, true, "PowderPatternCalculator doublet 04" );
+    test_suite.test_equality( ( a > 0.0 ) && ( b > 0.0 ) && ( b < a ), true, "PowderPatternCalculator doublet 05" );
+    powder_pattern_calculator.set_wavelength( 1.54056 );
+    test_suite.test_equality( powder_pattern_calculator.has_doublet(), false, "PowderPatternCalculator doublet 06" );
+    }
+
+    {
+    // Performance assertion, takes a few milliseconds
+    CrystalStructure crystal_structure = test_asymmetric_unit( SpaceGroup::P21c() );
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 60.0 ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    test_suite.test_timing( [&]() { powder_pattern_calculator.calculate_structure_factors(); }, 0.5, "PowderPatternCalculator::calculate_structure_factors() timing" );
+    }
+}
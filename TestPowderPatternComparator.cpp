@@ -0,0 +1,95 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternComparator.h"
+#include "PowderPattern.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+
+// Gaussian peaks on a flat background of 10.0 from 5 to 45 degrees, falling off with 2theta. The ESDs are sqrt( I ).
+PowderPattern synthetic_pattern( const double shift, const double scale )
+{
+    PowderPattern result( Angle::from_degrees( 5.0 ), Angle::from_degrees( 45.0 ), Angle::from_degrees( 0.01 ) );
+    const double positions[] = { 6.3, 9.1, 11.7, 12.4, 15.8, 18.2, 21.5, 23.9, 26.6, 30.1, 33.4, 37.8, 41.2 };
+    for ( size_t i( 0 ); i != result.size(); ++i )
+    {
+        const double two_theta = result.two_theta( i ).value_in_degrees();
+        double intensity( 10.0 );
+        for ( size_t j( 0 ); j != sizeof( positions ) / sizeof( positions[0] ); ++j )
+            intensity += scale * ( 5000.0 / ( 1.0 + 0.5 * j ) ) * std::exp( -0.5 * std::pow( ( two_theta - positions[j] - shift ) / 0.05, 2 ) );
+        result.set_intensity( i, intensity );
+        result.set_estimated_standard_deviation( i, std::sqrt( intensity ) );
+    }
+    return result;
+}
+
+} // namespace
+
+void test_powder_pattern_comparator( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PowderPatternComparator." << std::endl;
+    const PowderPattern experimental = synthetic_pattern( 0.0, 1.0 );
+    const PowderPattern good = synthetic_pattern( 0.005, 1.02 );
+    const PowderPattern bad = synthetic_pattern( 0.3, 1.0 );
+    PowderPatternComparator comparator( experimental );
+    {
+    const double good_Rwp = Rwp( experimental, good );
+    const double bad_Rwp = Rwp( experimental, bad );
+    // Not worse than the threshold: the full value
+    test_suite.test_equality_double( comparator.Rwp( good, 1.1 * good_Rwp ), good_Rwp, "PowderPatternComparator::Rwp() good" );
+    test_suite.test_equality_double( comparator.Rwp( bad, 1.0E6 ), bad_Rwp, "PowderPatternComparator::Rwp() bad, high threshold" );
+    // Worse: a lower bound above the threshold, strictly below the full value because the sum stopped early
+    const double bound = comparator.Rwp( bad, good_Rwp );
+    if ( ! ( ( good_Rwp < bound ) && ( bound < bad_Rwp ) ) )
+        test_suite.log_error( "PowderPatternComparator::Rwp() bad did not stop early" );
+    comparator.set_coarse_bin_size( 16 );
+    test_suite.test_equality_double( comparator.Rwp( good, 1.1 * good_Rwp ), good_Rwp, "PowderPatternComparator::Rwp() coarse good" );
+    const double coarse_bound = comparator.Rwp( bad, good_Rwp );
+    if ( ! ( ( good_Rwp < coarse_bound ) && ( coarse_bound < bad_Rwp ) ) )
+        test_suite.log_error( "PowderPatternComparator::Rwp() coarse bad did not stop early" );
+    }
+    {
+    // A different pattern rather than a shifted one: with l = 1 degree the bound proves it within the first block
+    const PowderPattern different = synthetic_pattern( 1.5, 1.0 );
+    const Angle l = Angle::from_degrees( 1.0 );
+    const PowderPatternComparator comparator_1( experimental, l );
+    const double good_similarity = normalised_weighted_cross_correlation( experimental, good, l );
+    const double different_similarity = normalised_weighted_cross_correlation( experimental, different, l );
+    test_suite.test_equality_double( comparator_1.normalised_weighted_cross_correlation( good, 0.9 * good_similarity ), good_similarity, "PowderPatternComparator::normalised_weighted_cross_correlation() good", 1.0E-10 );
+    test_suite.test_equality_double( comparator_1.normalised_weighted_cross_correlation( different, 0.0 ), different_similarity, "PowderPatternComparator::normalised_weighted_cross_correlation() different, no threshold", 1.0E-10 );
+    test_suite.test_equality_double( comparator.normalised_weighted_cross_correlation( bad, 0.0 ), normalised_weighted_cross_correlation( experimental, bad ), "PowderPatternComparator::normalised_weighted_cross_correlation() l = 3", 1.0E-10 );
+    const double bound = comparator_1.normalised_weighted_cross_correlation( different, 0.9 );
+    if ( ! ( ( different_similarity + 0.1 < bound ) && ( bound < 0.9 ) ) )
+        test_suite.log_error( "PowderPatternComparator::normalised_weighted_cross_correlation() different did not stop early" );
+    }
+}
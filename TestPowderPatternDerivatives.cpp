@@ -0,0 +1,208 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternDerivatives.h"
+#include "CrystalStructure.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "SpaceGroup.h"
+#include "SparseJacobian.h"
+#include "Utilities.h"
+
+#include "TestFixtures.h"
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+CrystalStructure test_crystal_structure()
+{
+    CrystalStructure result = P21c_test_asymmetric_unit( CrystalLattice( 7.1, 8.3, 9.2, Angle::from_degrees( 84.0 ), Angle::from_degrees( 97.0 ), Angle::from_degrees( 101.0 ) ) );
+    result.set_space_group( SpaceGroup() );
+    for ( size_t i( 0 ); i != result.natoms(); ++i )
+    {
+        Atom atom = result.atom( i );
+        atom.set_Uiso( 0.02 + 0.01 * i );
+        result.set_atom( i, atom );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+double parameter( const CrystalStructure & crystal_structure, const PowderPatternCalculator & powder_pattern_calculator, const PowderPatternDerivatives & powder_pattern_derivatives, const size_t p )
+{
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    switch ( p )
+    {
+        case PowderPatternDerivatives::PARAMETER_A          : return crystal_lattice.a();
+        case PowderPatternDerivatives::PARAMETER_B          : return crystal_lattice.b();
+        case PowderPatternDerivatives::PARAMETER_C          : return crystal_lattice.c();
+        case PowderPatternDerivatives::PARAMETER_ALPHA      : return crystal_lattice.alpha().value_in_degrees();
+        case PowderPatternDerivatives::PARAMETER_BETA       : return crystal_lattice.beta().value_in_degrees();
+        case PowderPatternDerivatives::PARAMETER_GAMMA      : return crystal_lattice.gamma().value_in_degrees();
+        case PowderPatternDerivatives::PARAMETER_ZERO_POINT : return powder_pattern_derivatives.zero_point().value_in_degrees();
+        case PowderPatternDerivatives::PARAMETER_FWHM       : return powder_pattern_calculator.FWHM();
+        case PowderPatternDerivatives::PARAMETER_R          : return powder_pattern_calculator.preferred_orientation_r();
+    }
+    const Atom & atom = crystal_structure.atom( ( p - PowderPatternDerivatives::NGLOBAL_PARAMETERS ) / 4 );
+    switch ( ( p - PowderPatternDerivatives::NGLOBAL_PARAMETERS ) % 4 )
+    {
+        case 0 : return atom.position().x();
+        case 1 : return atom.position().y();
+        case 2 : return atom.position().z();
+    }
+    return atom.Uiso();
+}
+
+// ********************************************************************************
+
+void set_parameter( CrystalStructure & crystal_structure, PowderPatternCalculator & powder_pattern_calculator, PowderPatternDerivatives & powder_pattern_derivatives, const size_t p, const double value )
+{
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    double lattice_parameters[6] = { crystal_lattice.a(), crystal_lattice.b(), crystal_lattice.c(),
+                                     crystal_lattice.alpha().value_in_degrees(), crystal_lattice.beta().value_in_degrees(), crystal_lattice.gamma().value_in_degrees() };
+    if ( p < 6 )
+    {
+        lattice_parameters[p] = value;
+        crystal_structure.set_crystal_lattice( CrystalLattice( lattice_parameters[0], lattice_parameters[1], lattice_parameters[2],
+                                                               Angle::from_degrees( lattice_parameters[3] ), Angle::from_degrees( lattice_parameters[4] ), Angle::from_degrees( lattice_parameters[5] ) ) );
+        return;
+    }
+    if ( p == PowderPatternDerivatives::PARAMETER_ZERO_POINT )
+        powder_pattern_derivatives.set_zero_point( Angle::from_degrees( value ) );
+    else if ( p == PowderPatternDerivatives::PARAMETER_FWHM )
+        powder_pattern_calculator.set_FWHM( value );
+    else if ( p == PowderPatternDerivatives::PARAMETER_R )
+        powder_pattern_calculator.set_preferred_orientation( powder_pattern_calculator.preferred_orientation_direction(), value );
+    else
+    {
+        const size_t i = ( p - PowderPatternDerivatives::NGLOBAL_PARAMETERS ) / 4;
+        Atom atom = crystal_structure.atom( i );
+        Vector3D position = atom.position();
+        switch ( ( p - PowderPatternDerivatives::NGLOBAL_PARAMETERS ) % 4 )
+        {
+            case 0 : position = Vector3D( value, position.y(), position.z() ); break;
+            case 1 : position = Vector3D( position.x(), value, position.z() ); break;
+            case 2 : position = Vector3D( position.x(), position.y(), value ); break;
+            case 3 : atom.set_Uiso( value ); break;
+        }
+        atom.set_position( position );
+        crystal_structure.set_atom( i, atom );
+    }
+}
+
+// ********************************************************************************
+
+// Compares each column of the Jacobian with central finite differences.
+void check_derivatives( CrystalStructure & crystal_structure, PowderPatternCalculator & powder_pattern_calculator, PowderPatternDerivatives & powder_pattern_derivatives,
+                        const std::string & message, TestSuite & test_suite )
+{
+    PowderPattern powder_pattern;
+    SparseJacobian jacobian;
+    powder_pattern_derivatives.calculate( powder_pattern, jacobian );
+    test_suite.test_equality( jacobian.ncolumns(), powder_pattern_derivatives.nparameters(), message + " ncolumns()" );
+    test_suite.test_equality( jacobian.nrows(), powder_pattern.size(), message + " nrows()" );
+    for ( size_t p( 0 ); p != powder_pattern_derivatives.nparameters(); ++p )
+    {
+        if ( ( p == PowderPatternDerivatives::PARAMETER_R ) && ( ! powder_pattern_calculator.has_preferred_orientation() ) )
+        {
+            test_suite.test_equality( jacobian.column_size( p ), size_t( 0 ), message + " r without preferred orientation" );
+            continue;
+        }
+        const double value = parameter( crystal_structure, powder_pattern_calculator, powder_pattern_derivatives, p );
+        const double delta = ( p < 3 ) ? 1.0E-5 : 1.0E-6;
+        PowderPattern plus;
+        PowderPattern minus;
+        SparseJacobian dummy;
+        set_parameter( crystal_structure, powder_pattern_calculator, powder_pattern_derivatives, p, value + delta );
+        powder_pattern_derivatives.calculate( plus, dummy );
+        set_parameter( crystal_structure, powder_pattern_calculator, powder_pattern_derivatives, p, value - delta );
+        powder_pattern_derivatives.calculate( minus, dummy );
+        set_parameter( crystal_structure, powder_pattern_calculator, powder_pattern_derivatives, p, value );
+        const std::vector< double > column = jacobian.column( p );
+        double largest( 0.0 );
+        double largest_difference( 0.0 );
+        for ( size_t i( 0 ); i != powder_pattern.size(); ++i )
+        {
+            const double finite_difference = ( plus.intensity( i ) - minus.intensity( i ) ) / ( 2.0 * delta );
+            largest = std::max( largest, std::abs( finite_difference ) );
+            largest_difference = std::max( largest_difference, std::abs( finite_difference - column[i] ) );
+        }
+        if ( ( largest == 0.0 ) || ( largest_difference > 1.0E-4 * largest ) )
+            test_suite.log_error( message + ": derivative wrong for " + powder_pattern_derivatives.parameter_name( p ) );
+    }
+}
+
+} // namespace
+
+void test_powder_pattern_derivatives( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PowderPatternDerivatives." << std::endl;
+    {
+    CrystalStructure crystal_structure = test_crystal_structure();
+    crystal_structure.apply_space_group_symmetry();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 35.0 ) );
+    powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    powder_pattern_calculator.set_FWHM( 0.15 );
+    PowderPatternDerivatives powder_pattern_derivatives( crystal_structure, powder_pattern_calculator );
+    test_suite.test_equality( powder_pattern_derivatives.nparameters(), size_t( 29 ), "PowderPatternDerivatives::nparameters()" );
+    test_suite.test_equality( powder_pattern_derivatives.parameter_name( PowderPatternDerivatives::y_index( 2 ) ), std::string( "y(O3)" ), "PowderPatternDerivatives::parameter_name()" );
+    // Without a zero point, the normalised pattern must be that of PowderPatternCalculator
+    PowderPattern powder_pattern;
+    SparseJacobian jacobian;
+    powder_pattern_derivatives.calculate( powder_pattern, jacobian );
+    powder_pattern.normalise_highest_peak();
+    PowderPattern reference;
+    powder_pattern_calculator.calculate( reference );
+    double largest_difference( 0.0 );
+    for ( size_t i( 0 ); i != reference.size(); ++i )
+        largest_difference = std::max( largest_difference, std::abs( powder_pattern.intensity( i ) - reference.intensity( i ) ) );
+    test_suite.test_equality_double( largest_difference / 10000.0, 0.0, "PowderPatternDerivatives::calculate() pattern", 1.0E-4 );
+    powder_pattern_derivatives.set_zero_point( Angle::from_degrees( 0.05 ) );
+    check_derivatives( crystal_structure, powder_pattern_calculator, powder_pattern_derivatives, "PowderPatternDerivatives::calculate() P1", test_suite );
+    powder_pattern_calculator.set_preferred_orientation( MillerIndices( 0, 1, 1 ), 0.85 );
+    check_derivatives( crystal_structure, powder_pattern_calculator, powder_pattern_derivatives, "PowderPatternDerivatives::calculate() P1 preferred orientation", test_suite );
+    }
+    {
+    CrystalStructure asymmetric_unit = test_crystal_structure();
+    asymmetric_unit.set_crystal_lattice( CrystalLattice( 7.1, 8.3, 9.2, Angle::angle_90_degrees(), Angle::from_degrees( 97.0 ), Angle::angle_90_degrees() ) );
+    asymmetric_unit.set_space_group( SpaceGroup::P21c() );
+    PowderPatternCalculator powder_pattern_calculator( asymmetric_unit, PowderPatternCalculator::ASYMMETRIC_UNIT );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 30.0 ) );
+    powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    powder_pattern_calculator.set_preferred_orientation( MillerIndices( 1, 0, 0 ), 1.1 );
+    PowderPatternDerivatives powder_pattern_derivatives( asymmetric_unit, powder_pattern_calculator );
+    check_derivatives( asymmetric_unit, powder_pattern_calculator, powder_pattern_derivatives, "PowderPatternDerivatives::calculate() P21/c asymmetric unit", test_suite );
+    }
+}
+
@@ -0,0 +1,107 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternIndex.h"
+#include "PowderPattern.h"
+#include "Angle.h"
+#include "MathFunctions.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// Ten Gaussian peaks at positions from a simple linear congruential generator, so that the test is reproducible
+PowderPattern synthetic_powder_pattern( unsigned int seed, const double shift )
+{
+    PowderPattern result( Angle::from_degrees( 5.0 ), Angle::from_degrees( 35.0 ), Angle::from_degrees( 0.02 ) );
+    std::vector< double > positions;
+    std::vector< double > heights;
+    for ( size_t i( 0 ); i != 10; ++i )
+    {
+        seed = 1103515245 * seed + 12345;
+        positions.push_back( 6.0 + 28.0 * ( ( seed >> 8 ) % 10000 ) / 10000.0 + shift );
+        seed = 1103515245 * seed + 12345;
+        heights.push_back( 100.0 + ( ( seed >> 8 ) % 1000 ) );
+    }
+    for ( size_t j( 0 ); j != result.size(); ++j )
+    {
+        double intensity( 10.0 );
+        for ( size_t i( 0 ); i != positions.size(); ++i )
+            intensity += heights[i] * exp( -square( ( result.two_theta( j ).value_in_degrees() - positions[i] ) / 0.1 ) );
+        result.set_intensity( j, intensity );
+    }
+    result.recalculate_estimated_standard_deviations();
+    return result;
+}
+
+} // namespace
+
+void test_powder_pattern_index( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PowderPatternIndex." << std::endl;
+    std::vector< PowderPattern > powder_patterns;
+    PowderPatternIndex index;
+    for ( unsigned int i( 0 ); i != 50; ++i )
+    {
+        // Every pattern has a close relative with slightly shifted peaks
+        powder_patterns.push_back( synthetic_powder_pattern( i / 2, ( i % 2 ) * 0.05 ) );
+        index.push_back( powder_patterns.back() );
+    }
+    test_suite.test_equality( index.size(), static_cast<size_t>( 50 ), "PowderPatternIndex::size()" );
+    double maximum_error( 0.0 );
+    for ( size_t i( 0 ); i != 10; ++i )
+    {
+        PowderPattern query = synthetic_powder_pattern( static_cast<unsigned int>( i ), 0.02 );
+        // Brute force
+        std::vector< std::pair< double, size_t > > reference;
+        for ( size_t j( 0 ); j != index.size(); ++j )
+        {
+            double estimate = index.estimated_similarity( query, j );
+            reference.push_back( std::make_pair( -estimate, j ) );
+            maximum_error = std::max( maximum_error, std::abs( estimate - normalised_weighted_cross_correlation( query, powder_patterns[j] ) ) );
+        }
+        std::sort( reference.begin(), reference.end() );
+        std::vector< double > estimated_similarities;
+        std::vector< size_t > most_similar = index.find_most_similar( query, 5, estimated_similarities );
+        test_suite.test_equality( most_similar.size(), static_cast<size_t>( 5 ), "PowderPatternIndex::find_most_similar() size" );
+        for ( size_t j( 0 ); j != most_similar.size(); ++j )
+        {
+            test_suite.test_equality( most_similar[j], reference[j].second, "PowderPatternIndex::find_most_similar()" );
+            test_suite.test_equality_double( estimated_similarities[j], -reference[j].first, "PowderPatternIndex::find_most_similar() estimate" );
+        }
+        // The pattern it was generated from and its relative
+        test_suite.test_equality( std::min( most_similar[0], most_similar[1] ), 2 * i, "PowderPatternIndex::find_most_similar() relatives" );
+    }
+    test_suite.test_equality( maximum_error < 0.02, true, "PowderPatternIndex::estimated_similarity()" );
+}
+
@@ -0,0 +1,103 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternMixer.h"
+#include "FileName.h"
+#include "PowderPattern.h"
+#include "MathFunctions.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+void test_powder_pattern_mixer( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PowderPatternMixer." << std::endl;
+    const size_t nphases( 3 );
+    std::vector< PowderPattern > phases;
+    for ( size_t k( 0 ); k != nphases; ++k )
+    {
+        PowderPattern phase( Angle::from_degrees( 5.0 ), Angle::from_degrees( 25.0 ), Angle::from_degrees( 0.02 ) );
+        for ( size_t j( 0 ); j != phase.size(); ++j )
+            phase.set_intensity( j, 1000.0 * exp( -0.001 * square( j - 200.0 * k - 150.0 ) ) );
+        phases.push_back( phase );
+    }
+    PowderPatternMixer powder_pattern_mixer( phases );
+    powder_pattern_mixer.set_constant_background( 20.0 );
+    test_suite.test_equality( powder_pattern_mixer.npoints(), phases[0].size(), "PowderPatternMixer::npoints()" );
+    // 37 mixtures, so that the last block is incomplete
+    const size_t nmixtures( 37 );
+    std::vector< double > weights;
+    for ( size_t i( 0 ); i != nmixtures; ++i )
+    {
+        for ( size_t k( 0 ); k != nphases; ++k )
+            weights.push_back( ( ( i + k ) % 4 ) * 0.25 );
+    }
+    std::vector< double > intensities;
+    powder_pattern_mixer.set_nthreads( 3 );
+    powder_pattern_mixer.mix( weights, intensities );
+    double maximum_difference( 0.0 );
+    for ( size_t i( 0 ); i != nmixtures; ++i )
+    {
+        PowderPattern reference( phases[0] );
+        for ( size_t j( 0 ); j != reference.size(); ++j )
+            reference.set_intensity( j, 20.0 );
+        for ( size_t k( 0 ); k != nphases; ++k )
+        {
+            PowderPattern scaled( phases[k] );
+            for ( size_t j( 0 ); j != scaled.size(); ++j )
+                scaled.set_intensity( j, weights[ i * nphases + k ] * scaled.intensity( j ) );
+            reference += scaled;
+        }
+        for ( size_t j( 0 ); j != reference.size(); ++j )
+            maximum_difference = std::max( maximum_difference, std::abs( intensities[ i * reference.size() + j ] - reference.intensity( j ) ) );
+    }
+    test_suite.test_equality_double( maximum_difference, 0.0, "PowderPatternMixer::mix()" );
+    // The noise must not depend on the number of threads
+    powder_pattern_mixer.set_Poisson_noise( true, 17 );
+    std::vector< double > noisy_intensities_1;
+    powder_pattern_mixer.mix( weights, noisy_intensities_1 );
+    powder_pattern_mixer.set_nthreads( 1 );
+    std::vector< double > noisy_intensities_2;
+    powder_pattern_mixer.mix( weights, noisy_intensities_2 );
+    test_suite.test_equality( noisy_intensities_1 == noisy_intensities_2, true, "PowderPatternMixer::mix() reproducible noise" );
+    test_suite.test_equality( noisy_intensities_1 == intensities, false, "PowderPatternMixer::mix() noise" );
+    PowderPattern mixture = powder_pattern_mixer.mix( weights, 5 );
+    test_suite.test_equality_double( mixture.intensity( 100 ), noisy_intensities_1[ 5 * mixture.size() + 100 ], "PowderPatternMixer::mix( weights, i )" );
+    FileName file_name( "TestPowderPatternMixer.tmp" );
+    powder_pattern_mixer.mix_to_file( weights, file_name, false );
+    test_suite.test_equality( nmixtures_in_file( file_name ), nmixtures, "nmixtures_in_file()" );
+    mixture = read_mixture( file_name, 36 );
+    test_suite.test_equality_double( mixture.intensity( 123 ), noisy_intensities_1[ 36 * mixture.size() + 123 ], "read_mixture()" );
+    test_suite.test_equality_double( mixture.two_theta_end().value_in_degrees(), 25.0, "read_mixture() 2theta" );
+    std::remove( file_name.full_name().c_str() );
+}
+
@@ -0,0 +1,110 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "PowderPatternSeries.h"
+#include "CrystalStructure.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "SpaceGroup.h"
+#include "Temperature.h"
+#include "Utilities.h"
+
+#include "TestFixtures.h"
+#include "TestSuite.h"
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+PowderPattern calculate_pattern( const CrystalStructure & crystal_structure )
+{
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 35.0 ) );
+    PowderPattern result;
+    powder_pattern_calculator.calculate( result );
+    return result;
+}
+
+} // namespace
+
+void test_powder_pattern_series( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PowderPatternSeries." << std::endl;
+    const CrystalLattice crystal_lattice( 7.1, 8.3, 9.2, Angle::angle_90_degrees(), Angle::from_degrees( 97.0 ), Angle::angle_90_degrees() );
+    const LatticeExpansion lattice_expansion( crystal_lattice, 293.0, Vector3D( 1.0E-4, 5.0E-5, 2.0E-4 ), Vector3D(), Vector3D( 0.0, 0.002, 0.0 ) );
+    {
+    const CrystalLattice expanded = lattice_expansion.crystal_lattice( 393.0 );
+    test_suite.test_equality_double( expanded.a(), 7.1 * 1.01, "LatticeExpansion::crystal_lattice() a" );
+    test_suite.test_equality_double( expanded.c(), 9.2 * 1.02, "LatticeExpansion::crystal_lattice() c" );
+    test_suite.test_equality_double( expanded.beta().value_in_degrees(), 97.2, "LatticeExpansion::crystal_lattice() beta" );
+    std::vector< double > values;
+    values.push_back( 100.0 );
+    values.push_back( 200.0 );
+    values.push_back( 300.0 );
+    std::vector< CrystalLattice > crystal_lattices;
+    for ( size_t i( 0 ); i != values.size(); ++i )
+        crystal_lattices.push_back( lattice_expansion.crystal_lattice( values[i] ) );
+    const LatticeExpansion interpolation( values, crystal_lattices );
+    // The expansion is linear in a, so interpolation and extrapolation reproduce it
+    test_suite.test_equality_double( interpolation.crystal_lattice( 150.0 ).a(), lattice_expansion.crystal_lattice( 150.0 ).a(), "LatticeExpansion::crystal_lattice() interpolated" );
+    test_suite.test_equality_double( interpolation.crystal_lattice( 393.0 ).b(), lattice_expansion.crystal_lattice( 393.0 ).b(), "LatticeExpansion::crystal_lattice() extrapolated" );
+    }
+    const CrystalStructure crystal_structure = P21c_test_structure( crystal_lattice );
+    PowderPatternSeries powder_pattern_series( crystal_structure, lattice_expansion, 293.0 );
+    powder_pattern_series.powder_pattern_calculator().set_two_theta_end( Angle::from_degrees( 35.0 ) );
+    std::vector< Temperature > temperatures;
+    temperatures.push_back( Temperature::from_Kelvin( 293.0 ) );
+    temperatures.push_back( Temperature::from_Kelvin( 393.0 ) );
+    temperatures.push_back( Temperature::from_Kelvin( 93.0 ) );
+    const std::vector< PowderPattern > cached = powder_pattern_series.calculate( temperatures );
+    powder_pattern_series.set_structure_factors( PowderPatternSeries::RECALCULATED );
+    const std::vector< PowderPattern > recalculated = powder_pattern_series.calculate( temperatures );
+    test_suite.test_equality( cached.size(), size_t( 3 ), "PowderPatternSeries::calculate() number of patterns" );
+    // The calculator only includes the reflections up to just beyond 35 degrees, the series includes those that could move into the range,
+    // so the patterns are only compared up to 33 degrees.
+    const Angle compare_end = Angle::from_degrees( 33.0 );
+    for ( size_t i( 0 ); i != temperatures.size(); ++i )
+    {
+        // A structure with the expanded unit cell, calculated from scratch
+        CrystalStructure expanded( crystal_structure );
+        expanded.set_crystal_lattice( lattice_expansion.crystal_lattice( temperatures[i].value_in_Kelvin() ) );
+        const PowderPattern reference = crop_to_two_theta_end( calculate_pattern( expanded ), compare_end );
+        // RECALCULATED is the same calculation, CACHED ignores the change of the scattering factors with d, about 1% Rwp for a change of 3% in d
+        test_suite.test_equality_double( Rwp( reference, crop_to_two_theta_end( recalculated[i], compare_end ) ), 0.0, "PowderPatternSeries::calculate() RECALCULATED " + size_t2string( i ), 1.0E-10 );
+        if ( Rwp( reference, crop_to_two_theta_end( cached[i], compare_end ) ) > 0.02 )
+            test_suite.log_error( "PowderPatternSeries::calculate() CACHED " + size_t2string( i ) + " Rwp = " + double2string( Rwp( reference, crop_to_two_theta_end( cached[i], compare_end ) ) ) );
+    }
+    // An increasing B weakens the high-angle peaks: the strongest peak stays at 100, the pattern as a whole loses intensity
+    powder_pattern_series.set_structure_factors( PowderPatternSeries::CACHED );
+    powder_pattern_series.set_dB_dx( 0.01 );
+    const std::vector< PowderPattern > with_B = powder_pattern_series.calculate( temperatures );
+    test_suite.test_equality_double( Rwp( cached[0], with_B[0] ), 0.0, "PowderPatternSeries::calculate() B at reference", 1.0E-10 );
+    if ( ! ( with_B[1].cumulative_intensity() < cached[1].cumulative_intensity() ) )
+        test_suite.log_error( "PowderPatternSeries::calculate() B correction" );
+}
@@ -0,0 +1,103 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "CrystalStructure.h"
+#include "FileName.h"
+#include "PowderPatternServer.h"
+#include "RunBenchmarks.h"
+
+#include "TestSuite.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+void test_powder_pattern_server( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for PowderPatternServer." << std::endl;
+
+    std::vector< CrystalStructure > crystal_structures;
+    crystal_structures.push_back( synthetic_molecular_crystal( 1 ) );
+    crystal_structures.push_back( synthetic_molecular_crystal( 2 ) );
+    std::vector< std::string > names;
+    names.push_back( "small" );
+    names.push_back( "large" );
+    PowderPatternServer powder_pattern_server( crystal_structures, names );
+    test_suite.test_equality( powder_pattern_server.size(), size_t( 2 ), "PowderPatternServer::size()" );
+    test_suite.test_equality( powder_pattern_server.handle_request( "ping" ), std::string( "{\"status\":\"ok\",\"npatterns\":2}" ), "PowderPatternServer::handle_request() 01" );
+    test_suite.test_equality( powder_pattern_server.handle_request( "  " ), std::string( "{\"status\":\"error\",\"message\":\"Empty request.\"}" ), "PowderPatternServer::handle_request() 02" );
+    test_suite.test_equality( powder_pattern_server.handle_request( "calculate x.cif" ), std::string( "{\"status\":\"error\",\"message\":\"Unknown request: calculate\"}" ), "PowderPatternServer::handle_request() 03" );
+    FileName file_name( "", "test_powder_pattern_server", "cif" );
+    crystal_structures[0].save_cif( file_name );
+    std::string response = powder_pattern_server.handle_request( "compare " + file_name.full_name() + " 1" );
+    test_suite.test_equality( response.substr( 0, 52 ), std::string( "{\"status\":\"ok\",\"matches\":[{\"index\":0,\"name\":\"small\"," ), "PowderPatternServer::handle_request() 04" );
+    test_suite.test_equality( response.find( "\"similarity\":1" ) != std::string::npos, true, "PowderPatternServer::handle_request() 05" );
+    response = powder_pattern_server.handle_request( "rmscd " + file_name.full_name() + " " + file_name.full_name() );
+    test_suite.test_equality( response, std::string( "{\"status\":\"ok\",\"rmscd\":0}" ), "PowderPatternServer::handle_request() 06" );
+    std::remove( file_name.full_name().c_str() );
+
+#ifndef _WIN32
+    {
+    FileName socket_file_name( "", "test_powder_pattern_server", "socket" );
+    std::thread server_thread( &PowderPatternServer::run, &powder_pattern_server, socket_file_name );
+    sockaddr_un address;
+    std::memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    std::strcpy( address.sun_path, socket_file_name.full_name().c_str() );
+    int client = socket( AF_UNIX, SOCK_STREAM, 0 );
+    // The server may not be listening yet.
+    bool connected( false );
+    for ( size_t i( 0 ); ( i != 100 ) && ( ! connected ); ++i )
+    {
+        connected = ( connect( client, reinterpret_cast< sockaddr * >( &address ), sizeof( address ) ) == 0 );
+        if ( ! connected )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    }
+    test_suite.test_equality( connected, true, "PowderPatternServer::run() 01" );
+    const std::string requests( "ping\nshutdown\n" );
+    send( client, requests.data(), requests.size(), 0 );
+    std::string responses;
+    char data[256];
+    ssize_t nbytes;
+    while ( ( nbytes = recv( client, data, sizeof( data ), 0 ) ) > 0 )
+        responses.append( data, nbytes );
+    close( client );
+    server_thread.join();
+    test_suite.test_equality( responses, std::string( "{\"status\":\"ok\",\"npatterns\":2}\n{\"status\":\"ok\"}\n" ), "PowderPatternServer::run() 02" );
+    }
+#endif
+}
+
@@ -26,11 +26,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "Quaternion.h"
+#include "Matrix3D.h"
+#include "Utilities.h"
+#include "Vector3D.h"
 
 #include "TestSuite.h"
 
+#include <cmath>
 #include <string>
 #include <iostream>
+#include <vector>
 
 void test_one_quaternion( TestSuite & test_suite,
                           const Quaternion & actual_value,
@@ -73,6 +78,73 @@ void test_quaternion( TestSuite & test_suite )
     if ( ! nearly_equal( q1, q2 ) )
         test_suite.log_error( "Quaternion power()" );
     }
+    {
+    // 90 degrees around z
+    Quaternion q( 1.0, 0.0, 0.0, 1.0 );
+    Matrix3D R = q.rotation_matrix();
+    if ( ! nearly_equal( R, Matrix3D( 0.0, -1.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0 ) ) )
+        test_suite.log_error( "Quaternion rotation_matrix()" );
+    }
+    {
+    std::vector< Quaternion > quaternions;
+    quaternions.push_back( Quaternion( 0.6, 0.7, 0.3, -0.1 ) );
+    quaternions.push_back( Quaternion( 0.1, 0.7, 0.3, -0.6 ) );
+    quaternions.push_back( Quaternion( 0.1, -0.3, 0.9, 0.2 ) );
+    quaternions.push_back( Quaternion( 0.1, 0.2, -0.3, 0.9 ) );
+    for ( size_t i( 0 ); i != quaternions.size(); ++i )
+    {
+        if ( ! nearly_equal( Quaternion( quaternions[i].rotation_matrix() ), quaternions[i] ) )
+            test_suite.log_error( "Quaternion( Matrix3D ) " + size_t2string( i + 1 ) );
+    }
+    QuaternionList quaternion_list;
+    for ( size_t i( 0 ); i != quaternions.size(); ++i )
+        quaternion_list.push_back( quaternions[i] );
+    std::vector< double > elements;
+    rotation_matrices( quaternion_list, elements );
+    test_suite.test_equality( elements.size(), size_t( 36 ), "rotation_matrices() 01" );
+    bool all_equal( true );
+    for ( size_t i( 0 ); i != quaternions.size(); ++i )
+    {
+        Matrix3D R = quaternions[i].rotation_matrix();
+        for ( size_t j( 0 ); j != 9; ++j )
+        {
+            if ( elements[ j * quaternions.size() + i ] != R.value( j / 3, j % 3 ) )
+                all_equal = false;
+        }
+    }
+    if ( ! all_equal )
+        test_suite.log_error( "rotation_matrices() 02" );
+    std::vector< Vector3D > points;
+    points.push_back( Vector3D( 1.0, 2.0, 3.0 ) );
+    points.push_back( Vector3D( -0.5, 0.0, 4.5 ) );
+    std::vector< Vector3D > rotated;
+    rotate( quaternions[0], points, rotated );
+    std::vector< double > x( 2 );
+    std::vector< double > y( 2 );
+    std::vector< double > z( 2 );
+    for ( size_t i( 0 ); i != points.size(); ++i )
+    {
+        x[i] = points[i].x();
+        y[i] = points[i].y();
+        z[i] = points[i].z();
+    }
+    rotate( quaternions[0], x, y, z );
+    for ( size_t i( 0 ); i != points.size(); ++i )
+    {
+        Vector3D expected = quaternions[0].rotation_matrix() * points[i];
+        if ( ! nearly_equal( rotated[i], expected ) )
+            test_suite.log_error( "rotate() 01" );
+        if ( ! nearly_equal( Vector3D( x[i], y[i], z[i] ), expected ) )
+            test_suite.log_error( "rotate() 02" );
+    }
+    // In place
+    rotate( quaternions[0], points, points );
+    for ( size_t i( 0 ); i != points.size(); ++i )
+    {
+        if ( ! nearly_equal( points[i], rotated[i], 1.0E-15 ) )
+            test_suite.log_error( "rotate() 03" );
+    }
+    }
 
     
 }
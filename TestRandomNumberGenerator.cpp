@@ -0,0 +1,150 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "RandomNumberGenerator.h"
+#include "Philox.h"
+#include "Xoshiro256StarStar.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <stdexcept>
+
+void test_random_number_generator( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for RandomNumberGenerator." << std::endl;
+    // The default engine must reproduce the sequences of existing seeds bit-for-bit
+    {
+        RandomNumberGenerator_double RNG;
+        test_suite.test_equality( RNG.next_number(), 0.99918046543856132, "RandomNumberGenerator_double LECUYER 01" );
+        test_suite.test_equality( RNG.next_number(), 0.25598462613238637, "RandomNumberGenerator_double LECUYER 02" );
+        test_suite.test_equality( RNG.next_number(), 0.5637113796153419 , "RandomNumberGenerator_double LECUYER 03" );
+        test_suite.test_equality( RNG.next_number(), 0.9494581724069755 , "RandomNumberGenerator_double LECUYER 04" );
+    }
+    {
+        RandomNumberGenerator_integer RNG( 12345 );
+        const int expected[6] = { 368, 94, 546, 937, 493, 499 };
+        bool all_equal( true );
+        for ( size_t i( 0 ); i != 6; ++i )
+        {
+            if ( RNG.next_number( 0, 999 ) != expected[i] )
+                all_equal = false;
+        }
+        test_suite.test_equality( all_equal, true, "RandomNumberGenerator_integer LECUYER" );
+        bool exception_thrown( false );
+        try
+        {
+            RNG.jump();
+        }
+        catch ( std::exception & e )
+        {
+            exception_thrown = true;
+        }
+        test_suite.test_equality( exception_thrown, true, "RandomNumberGenerator_integer::jump() LECUYER" );
+    }
+    // Reference values from the authors' C implementation with state { 1, 2, 3, 4 }
+    {
+        Xoshiro256StarStar xoshiro( 1, 2, 3, 4 );
+        test_suite.test_equality( xoshiro.next(), static_cast<uint64_t>( 11520 ), "Xoshiro256StarStar::next() 01" );
+        test_suite.test_equality( xoshiro.next(), static_cast<uint64_t>( 0 ), "Xoshiro256StarStar::next() 02" );
+        test_suite.test_equality( xoshiro.next(), static_cast<uint64_t>( 1509978240 ), "Xoshiro256StarStar::next() 03" );
+        test_suite.test_equality( xoshiro.next(), static_cast<uint64_t>( 1215971899390074240ULL ), "Xoshiro256StarStar::next() 04" );
+    }
+    // The jumps were checked against the 2^128th and 2^192th power of the transition matrix over GF(2)
+    {
+        Xoshiro256StarStar xoshiro( 1, 2, 3, 4 );
+        xoshiro.jump();
+        test_suite.test_equality( ( xoshiro.state( 0 ) == 0x8c7a153956b5f3d1ULL ) && ( xoshiro.state( 1 ) == 0x701f1a713401d85eULL ) &&
+                                  ( xoshiro.state( 2 ) == 0x6527f66a65469085ULL ) && ( xoshiro.state( 3 ) == 0x8386b786c4408050ULL ), true, "Xoshiro256StarStar::jump()" );
+        Xoshiro256StarStar xoshiro_2( 1, 2, 3, 4 );
+        xoshiro_2.long_jump();
+        test_suite.test_equality( ( xoshiro_2.state( 0 ) == 0x096a8eb71295a400ULL ) && ( xoshiro_2.state( 1 ) == 0xdbf84991e50f4516ULL ) &&
+                                  ( xoshiro_2.state( 2 ) == 0x534ee745810d2a0eULL ) && ( xoshiro_2.state( 3 ) == 0x31655ca1a2215bf1ULL ), true, "Xoshiro256StarStar::long_jump()" );
+    }
+    {
+        Xoshiro256StarStar xoshiro( 42 );
+        std::vector< Xoshiro256StarStar > generators = xoshiro.split( 3 );
+        Xoshiro256StarStar jumped( xoshiro );
+        jumped.jump();
+        jumped.jump();
+        test_suite.test_equality( ( generators.size() == 3 ) && ( generators[1].next() == jumped.next() ), true, "Xoshiro256StarStar::split()" );
+        std::vector< double > values( 100 );
+        Xoshiro256StarStar xoshiro_2( xoshiro );
+        xoshiro.fill( values );
+        bool all_equal( true );
+        for ( size_t i( 0 ); i != values.size(); ++i )
+        {
+            if ( ( values[i] != xoshiro_2.next_double() ) || ( values[i] <= 0.0 ) || ( values[i] >= 1.0 ) )
+                all_equal = false;
+        }
+        test_suite.test_equality( all_equal, true, "Xoshiro256StarStar::fill()" );
+    }
+    {
+        Philox4x32 Philox( 5, 3 );
+        std::vector< Philox4x32 > generators = Philox.split( 2 );
+        test_suite.test_equality( generators[1].position(), static_cast<uint64_t>( 2 ) << 48, "Philox4x32::split()" );
+        uint32_t words[6];
+        Philox.fill( words, 6 );
+        uint32_t block[4];
+        Philox.block( 1, block );
+        test_suite.test_equality( ( words[4] == block[0] ) && ( words[5] == block[1] ) && ( Philox.position() == 2 ), true, "Philox4x32::fill( uint32_t * )" );
+    }
+    // The modern engines through the existing interface
+    {
+        const RandomNumberEngine engines[2] = { XOSHIRO256STARSTAR, PHILOX4X32 };
+        for ( size_t e( 0 ); e != 2; ++e )
+        {
+            RandomNumberGenerator_double RNG( 7381, engines[e] );
+            std::vector< RandomNumberGenerator_double > RNGs = RNG.split( 2 );
+            RandomNumberGenerator_double RNG_2( RNG );
+            RNG_2.jump();
+            std::vector< double > values( 5 );
+            RNGs[0].fill( values );
+            bool all_equal( true );
+            for ( size_t i( 0 ); i != values.size(); ++i )
+            {
+                if ( values[i] != RNG_2.next_number() )
+                    all_equal = false;
+            }
+            test_suite.test_equality( all_equal, true, "RandomNumberGenerator_double::split() " + std::string( 1, '1' + e ) );
+            RandomNumberGenerator_integer RNG_int( 1539, engines[e] );
+            bool in_range( true );
+            int histogram[3] = { 0, 0, 0 };
+            for ( size_t i( 0 ); i != 3000; ++i )
+            {
+                int value = RNG_int.next_number( -1, 1 );
+                if ( ( value < -1 ) || ( value > 1 ) )
+                    in_range = false;
+                else
+                    ++histogram[value+1];
+            }
+            test_suite.test_equality( in_range && ( histogram[0] > 900 ) && ( histogram[1] > 900 ) && ( histogram[2] > 900 ), true, "RandomNumberGenerator_integer::next_number() " + std::string( 1, '1' + e ) );
+        }
+    }
+}
+
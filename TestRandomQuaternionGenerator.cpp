@@ -26,9 +26,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "RandomQuaternionGenerator.h"
+#include "Quaternion.h"
 
 #include "TestSuite.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 void test_RandomQuaternionGenerator( TestSuite & test_suite )
@@ -39,6 +42,31 @@ void test_RandomQuaternionGenerator( TestSuite & test_suite )
   //  RandomQuaternionGenerator dummy();
  //   test_suite.test_equality( dummy, , "RandomQuaternionGenerator()" );
     }
+    {
+    RandomQuaternionGenerator one_by_one;
+    RandomQuaternionGenerator batched;
+    QuaternionList quaternions;
+    batched.next_quaternions( 1000, quaternions );
+    test_suite.test_equality( quaternions.size(), size_t( 1000 ), "RandomQuaternionGenerator::next_quaternions() 01" );
+    bool all_equal( true );
+    double max_deviation( 0.0 );
+    for ( size_t i( 0 ); i != quaternions.size(); ++i )
+    {
+        if ( ! nearly_equal( Quaternion( quaternions.a()[i], quaternions.b()[i], quaternions.c()[i], quaternions.d()[i] ), one_by_one.next_quaternion(), 1.0E-14 ) )
+            all_equal = false;
+        double length = std::sqrt( quaternions.a()[i]*quaternions.a()[i] + quaternions.b()[i]*quaternions.b()[i] +
+                                   quaternions.c()[i]*quaternions.c()[i] + quaternions.d()[i]*quaternions.d()[i] );
+        max_deviation = std::max( max_deviation, std::abs( length - 1.0 ) );
+    }
+    if ( ! all_equal )
+        test_suite.log_error( "RandomQuaternionGenerator::next_quaternions() 02" );
+    test_suite.test_equality_double( max_deviation, 0.0, "RandomQuaternionGenerator::next_quaternions() 03", 1.0E-14 );
+    // The next batch continues the same sequence
+    batched.next_quaternions( 10, quaternions );
+    test_suite.test_equality( quaternions.size(), size_t( 10 ), "RandomQuaternionGenerator::next_quaternions() 04" );
+    if ( ! nearly_equal( quaternions.quaternion( 0 ), one_by_one.next_quaternion(), 1.0E-14 ) )
+        test_suite.log_error( "RandomQuaternionGenerator::next_quaternions() 05" );
+    }
 
 }
 
@@ -0,0 +1,313 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "ReadCif.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "TextFileWriter.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void test_read_cif( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for ReadCif." << std::endl;
+    FileName file_name( "TestReadCif.cif" );
+    {
+    // Windows line endings, a comment, an empty line, quotes, ESDs and no newline at the end of the file
+    std::ofstream output_file( file_name.full_name().c_str(), std::ios::binary );
+    output_file << "data_test\r\n";
+    output_file << "# A comment\r\n";
+    output_file << "_symmetry_space_group_name_H-M   'P -1'\r\n";
+    output_file << "_cell_length_a                   7.1234(5)\r\n";
+    output_file << "_cell_length_b                   8.0\r\n";
+    output_file << "_cell_length_c                   9.0\r\n";
+    output_file << "\r\n";
+    output_file << "_cell_angle_alpha                90\r\n";
+    output_file << "_cell_angle_beta                 100.5(2)\r\n";
+    output_file << "_cell_angle_gamma                90\r\n";
+    output_file << "loop_\r\n";
+    output_file << "_symmetry_equiv_pos_site_id\r\n";
+    output_file << "_symmetry_equiv_pos_as_xyz\r\n";
+    output_file << "1 x,y,z\r\n";
+    output_file << "2 '-x,-y,-z'\r\n";
+    output_file << "loop_\r\n";
+    output_file << "_atom_site_label\r\n";
+    output_file << "_atom_site_fract_x\r\n";
+    output_file << "_atom_site_fract_y\r\n";
+    output_file << "_atom_site_fract_z\r\n";
+    output_file << "Cl1 0.1(1) 0.25 -0.5e-1\r\n";
+    output_file << "C2 0.3 0.4 0.5\r\n";
+    output_file << "loop_\r\n";
+    output_file << "_atom_site_aniso_label\r\n";
+    output_file << "_atom_site_aniso_U_11\r\n";
+    output_file << "_atom_site_aniso_U_22\r\n";
+    output_file << "_atom_site_aniso_U_33\r\n";
+    output_file << "_atom_site_aniso_U_12\r\n";
+    output_file << "_atom_site_aniso_U_13\r\n";
+    output_file << "_atom_site_aniso_U_23\r\n";
+    output_file << "Cl1 0.1071(7) 0.1580(10) 0.0482(5) 0.0 0.0 0.0\r\n";
+    output_file << "#END";
+    }
+    CrystalStructure crystal_structure;
+    read_cif( file_name, crystal_structure );
+    test_suite.test_equality( crystal_structure.name(), std::string( "test" ), "read_cif() name" );
+    test_suite.test_equality( crystal_structure.space_group().name(), std::string( "P -1" ), "read_cif() space group name" );
+    test_suite.test_equality( crystal_structure.space_group().nsymmetry_operators(), size_t( 2 ), "read_cif() symmetry operators" );
+    test_suite.test_equality_double( crystal_structure.crystal_lattice().a(), 7.1234, "read_cif() a" );
+    test_suite.test_equality_double( crystal_structure.crystal_lattice().beta().value_in_degrees(), 100.5, "read_cif() beta" );
+    test_suite.test_equality( crystal_structure.natoms(), size_t( 2 ), "read_cif() natoms" );
+    test_suite.test_equality( crystal_structure.atom( 0 ).element().symbol(), std::string( "Cl" ), "read_cif() element 1" );
+    test_suite.test_equality( crystal_structure.atom( 1 ).element().symbol(), std::string( "C" ), "read_cif() element 2" );
+    test_suite.test_equality( crystal_structure.atom( 1 ).label(), std::string( "C2" ), "read_cif() label" );
+    test_suite.test_equality_double( crystal_structure.atom( 0 ).position().x(), 0.1, "read_cif() x" );
+    test_suite.test_equality_double( crystal_structure.atom( 0 ).position().z(), -0.05, "read_cif() z" );
+    test_suite.test_equality( crystal_structure.atom( 0 ).ADPs_type() == Atom::ANISOTROPIC, true, "read_cif() ADPs" );
+    std::remove( file_name.full_name().c_str() );
+    // Several data blocks in one file
+    {
+    {
+    TextFileWriter text_file_writer( file_name );
+    text_file_writer.write_line( "Text before the first block is ignored" );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        text_file_writer.write_line( "data_block_" + size_t2string( i ) );
+        text_file_writer.write_line( "_cell_length_a " + size_t2string( 10 + i ) );
+        text_file_writer.write_line( "_cell_length_b 10" );
+        text_file_writer.write_line( "_cell_length_c 10" );
+        text_file_writer.write_line( "_cell_angle_alpha 90" );
+        text_file_writer.write_line( "_cell_angle_beta 90" );
+        text_file_writer.write_line( "_cell_angle_gamma 90" );
+        text_file_writer.write_line( "loop_" );
+        text_file_writer.write_line( "_atom_site_label" );
+        text_file_writer.write_line( "_atom_site_fract_x" );
+        text_file_writer.write_line( "_atom_site_fract_y" );
+        text_file_writer.write_line( "_atom_site_fract_z" );
+        for ( size_t j( 0 ); j != i + 1; ++j )
+            text_file_writer.write_line( "O" + size_t2string( j + 1 ) + " 0.1 0.2 0.3" );
+    }
+    }
+    CifBlockReader cif_block_reader( file_name, true );
+    test_suite.test_equality( cif_block_reader.nblocks(), size_t( 3 ), "CifBlockReader::nblocks()" );
+    cif_block_reader.read_block( 1, crystal_structure );
+    test_suite.test_equality( crystal_structure.name(), std::string( "block_1" ), "CifBlockReader::read_block() name" );
+    test_suite.test_equality( crystal_structure.natoms(), size_t( 2 ), "CifBlockReader::read_block() natoms" );
+    test_suite.test_equality_double( crystal_structure.crystal_lattice().a(), 11.0, "CifBlockReader::read_block() a" );
+    bool all_correct( true );
+    size_t nblocks( 0 );
+    for_each_cif_block( file_name, [&]( const CrystalStructure & block, const size_t i )
+    {
+        ++nblocks;
+        if ( ( block.natoms() != i + 1 ) || ( block.name() != "block_" + size_t2string( i ) ) )
+            all_correct = false;
+    } );
+    test_suite.test_equality( nblocks, size_t( 3 ), "for_each_cif_block() nblocks" );
+    test_suite.test_equality( all_correct, true, "for_each_cif_block()" );
+    std::remove( file_name.full_name().c_str() );
+    }
+    // read_cifs() and for_each_cif(): a file that cannot be read must not stop the others
+    {
+    std::vector< FileName > file_names;
+    for ( size_t i( 0 ); i != 5; ++i )
+        file_names.push_back( FileName( "", "test_read_cifs_" + size_t2string( i ), "cif" ) );
+    for ( size_t i( 0 ); i != file_names.size(); ++i )
+    {
+        if ( i == 3 ) // File 3 does not exist
+            continue;
+        TextFileWriter text_file_writer( file_names[i] );
+        text_file_writer.write_line( "data_file_" + size_t2string( i ) );
+        text_file_writer.write_line( "_cell_length_a 10" );
+        text_file_writer.write_line( "_cell_length_b 10" );
+        text_file_writer.write_line( "_cell_length_c 10" );
+        text_file_writer.write_line( "_cell_angle_alpha 90" );
+        text_file_writer.write_line( "_cell_angle_beta 90" );
+        text_file_writer.write_line( "_cell_angle_gamma 90" );
+        text_file_writer.write_line( "loop_" );
+        text_file_writer.write_line( "_atom_site_label" );
+        text_file_writer.write_line( "_atom_site_fract_x" );
+        text_file_writer.write_line( "_atom_site_fract_y" );
+        text_file_writer.write_line( "_atom_site_fract_z" );
+        for ( size_t j( 0 ); j != i + 1; ++j )
+            text_file_writer.write_line( "C" + size_t2string( j + 1 ) + " 0.1 0.2 0.3" );
+    }
+    FileList file_list( file_names );
+    std::vector< CrystalStructure > crystal_structures;
+    std::vector< std::string > error_messages;
+    size_t nerrors = read_cifs( file_list, crystal_structures, error_messages, 3 );
+    test_suite.test_equality( nerrors, size_t( 1 ), "read_cifs() nerrors" );
+    test_suite.test_equality( crystal_structures.size(), size_t( 5 ), "read_cifs() size" );
+    test_suite.test_equality( error_messages[3].empty(), false, "read_cifs() error message" );
+    test_suite.test_equality( crystal_structures[3].natoms(), size_t( 0 ), "read_cifs() failed file" );
+    test_suite.test_equality( crystal_structures[4].natoms(), size_t( 5 ), "read_cifs() natoms" );
+    test_suite.test_equality( crystal_structures[4].name(), std::string( "file_4" ), "read_cifs() name" );
+    std::vector< size_t > order;
+    bool all_correct( true );
+    for_each_cif( file_list, [&]( const CrystalStructure & crystal_structure, const size_t i, const std::string & error_message )
+    {
+        order.push_back( i );
+        if ( i == 3 )
+        {
+            if ( error_message.empty() )
+                all_correct = false;
+        }
+        else if ( ( ! error_message.empty() ) || ( crystal_structure.natoms() != i + 1 ) )
+            all_correct = false;
+    }, 2, 2 );
+    test_suite.test_equality( order.size(), size_t( 5 ), "for_each_cif() nfiles" );
+    for ( size_t i( 0 ); i != order.size(); ++i )
+        test_suite.test_equality( order[i], i, "for_each_cif() order" );
+    test_suite.test_equality( all_correct, true, "for_each_cif()" );
+    // With the binary cache: the first pass writes the snapshots, the second pass reads them
+    for ( size_t pass( 0 ); pass != 2; ++pass )
+    {
+        nerrors = read_cifs( file_list, crystal_structures, error_messages, 3, true );
+        test_suite.test_equality( nerrors, size_t( 1 ), "read_cifs() with cache nerrors" );
+        test_suite.test_equality( crystal_structures[4].natoms(), size_t( 5 ), "read_cifs() with cache natoms" );
+        test_suite.test_equality( crystal_structures[4].name(), std::string( "file_4" ), "read_cifs() with cache name" );
+        test_suite.test_equality( binary_cache_file_name( file_names[4] ).exists(), true, "read_cifs() cache file written" );
+        test_suite.test_equality( binary_cache_file_name( file_names[3] ).exists(), false, "read_cifs() no cache file for missing cif" );
+    }
+    for ( size_t i( 0 ); i != file_names.size(); ++i )
+    {
+        std::remove( file_names[i].full_name().c_str() );
+        std::remove( binary_cache_file_name( file_names[i] ).full_name().c_str() );
+    }
+    }
+    // strip_hydrogen_atoms(): only the H and D rows of the atom loops go, everything else is copied byte for byte
+    {
+    const std::string header = "data_block_0\r\n"
+                               "# H1 comment\n"
+                               "_publ_section_title\n"
+                               ";\n"
+                               "H1 H 0.1 0.2 0.3\n"
+                               ";\n"
+                               "_cell_length_a 10\n"
+                               "_cell_length_b 10\n"
+                               "_cell_length_c 10\n"
+                               "_cell_angle_alpha 90\n"
+                               "_cell_angle_beta 90\n"
+                               "_cell_angle_gamma 90\n"
+                               "loop_\n"
+                               "_symmetry_equiv_pos_as_xyz\n"
+                               "x,y,z\n";
+    const std::string input = header +
+                              "loop_\n"
+                              "_atom_site_label\n"
+                              "_atom_site_type_symbol\n"
+                              "_atom_site_fract_x\n"
+                              "_atom_site_fract_y\n"
+                              "_atom_site_fract_z\n"
+                              "C1 C 0.1 0.2 0.3\r\n"
+                              "H1 H 0.1 0.2 0.3\r\n"
+                              "Hg1 Hg 0.5 0.5 0.5\n"
+                              "HX D 0.1 0.2 0.3\n"
+                              "\n"
+                              "loop_\n"
+                              "_atom_site_aniso_label\n"
+                              "_atom_site_aniso_U_11\n"
+                              "_atom_site_aniso_U_22\n"
+                              "_atom_site_aniso_U_33\n"
+                              "_atom_site_aniso_U_12\n"
+                              "_atom_site_aniso_U_13\n"
+                              "_atom_site_aniso_U_23\n"
+                              "C1 0.01 0.01 0.01 0 0 0\n"
+                              "HX 0.01 0.01 0.01 0 0 0\n"
+                              "Hg1 0.01 0.01 0.01 0 0 0\n"
+                              "data_block_1\n"
+                              "loop_\n"
+                              "_atom_site_label\n"
+                              "_atom_site_fract_x\n"
+                              "_atom_site_fract_y\n"
+                              "_atom_site_fract_z\n"
+                              "O1 0.1 0.2 0.3\n"
+                              "H2 0.1 0.2 0.3";
+    const std::string expected = header +
+                                 "loop_\n"
+                                 "_atom_site_label\n"
+                                 "_atom_site_type_symbol\n"
+                                 "_atom_site_fract_x\n"
+                                 "_atom_site_fract_y\n"
+                                 "_atom_site_fract_z\n"
+                                 "C1 C 0.1 0.2 0.3\r\n"
+                                 "Hg1 Hg 0.5 0.5 0.5\n"
+                                 "\n"
+                                 "loop_\n"
+                                 "_atom_site_aniso_label\n"
+                                 "_atom_site_aniso_U_11\n"
+                                 "_atom_site_aniso_U_22\n"
+                                 "_atom_site_aniso_U_33\n"
+                                 "_atom_site_aniso_U_12\n"
+                                 "_atom_site_aniso_U_13\n"
+                                 "_atom_site_aniso_U_23\n"
+                                 "C1 0.01 0.01 0.01 0 0 0\n"
+                                 "Hg1 0.01 0.01 0.01 0 0 0\n"
+                                 "data_block_1\n"
+                                 "loop_\n"
+                                 "_atom_site_label\n"
+                                 "_atom_site_fract_x\n"
+                                 "_atom_site_fract_y\n"
+                                 "_atom_site_fract_z\n"
+                                 "O1 0.1 0.2 0.3\n";
+    std::string output;
+    const size_t nremoved = strip_hydrogen_atoms( input.data(), input.data() + input.size(), output );
+    test_suite.test_equality( nremoved, size_t( 3 ), "strip_hydrogen_atoms() nremoved" );
+    test_suite.test_equality( output, expected, "strip_hydrogen_atoms()" );
+    // FileList, a file that cannot be read must not stop the others. read_cif() only reads the first block.
+    std::vector< FileName > file_names;
+    for ( size_t i( 0 ); i != 3; ++i )
+        file_names.push_back( FileName( "", "test_strip_hydrogen_atoms_" + size_t2string( i ), "cif" ) );
+    for ( size_t i( 0 ); i != file_names.size(); ++i )
+    {
+        if ( i == 1 ) // File 1 does not exist
+            continue;
+        std::ofstream output_file( file_names[i].full_name().c_str(), std::ios::binary );
+        output_file << input.substr( 0, input.find( "data_block_1" ) );
+    }
+    std::vector< std::string > error_messages;
+    const size_t nerrors = strip_hydrogen_atoms( FileList( file_names ), error_messages, 2 );
+    test_suite.test_equality( nerrors, size_t( 1 ), "strip_hydrogen_atoms( FileList ) nerrors" );
+    test_suite.test_equality( error_messages[1].empty(), false, "strip_hydrogen_atoms( FileList ) error message" );
+    for ( size_t i( 0 ); i < file_names.size(); i += 2 )
+    {
+        const FileName output_file_name = append_to_file_name( file_names[i], "_noH" );
+        CrystalStructure crystal_structure;
+        read_cif( output_file_name, crystal_structure );
+        test_suite.test_equality( crystal_structure.natoms(), size_t( 2 ), "strip_hydrogen_atoms( FileList ) natoms" );
+        std::remove( file_names[i].full_name().c_str() );
+        std::remove( output_file_name.full_name().c_str() );
+    }
+    }
+}
+
@@ -26,10 +26,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "ReadXSD.h"
+#include "CrystalStructure.h"
+#include "FileName.h"
+#include "TextFileWriter.h"
 
 #include "TestSuite.h"
 
+#include <cstdio>
 #include <iostream>
+#include <string>
 
 void test_ReadXSD( TestSuite & test_suite )
 {
@@ -37,6 +42,32 @@ void test_ReadXSD( TestSuite & test_suite )
 
     {
         // read_xsd( const FileName & file_name, CrystalStructure & crystal_structure );
+        FileName file_name( "", "test_read_xsd", "xsd" );
+        {
+        TextFileWriter text_file_writer( file_name );
+        text_file_writer.write_line( "<?xml version=\"1.0\" encoding=\"latin1\"?>" );
+        text_file_writer.write_line( "<!DOCTYPE XSD []>" );
+        text_file_writer.write_line( "<XSD Version=\"6.0\">" );
+        text_file_writer.write_line( "  <AtomisticTreeRoot ID=\"1\">" );
+        text_file_writer.write_line( "    <Atom3d ID=\"4\" Name=\"Cl1\" XYZ=\"0.1,0.2,0.3\" Components=\"Cl\">" );
+        text_file_writer.write_line( "      <Properties NMRShielding=\"8.93\"/>" );
+        text_file_writer.write_line( "    </Atom3d>" );
+        text_file_writer.write_line( "    <Atom3d ID=\"5\" Name=\"C2\" XYZ=\"0.5,0.25,-0.125\" Components=\"C\"/>" );
+        text_file_writer.write_line( "    <Atom3d ID=\"566\" Mapping=\"952\" ImageOf=\"4\"/>" );
+        text_file_writer.write_line( "    <SpaceGroup ID=\"352\" Name=\"P1\"" );
+        text_file_writer.write_line( "     AVector=\"10,0,0\" BVector=\"0,11,0\" CVector=\"0,0,12\" GroupName=\"P1\"/>" );
+        text_file_writer.write_line( "  </AtomisticTreeRoot>" );
+        text_file_writer.write_line( "</XSD>" );
+        }
+        CrystalStructure crystal_structure;
+        read_xsd( file_name, crystal_structure );
+        std::remove( file_name.full_name().c_str() );
+        test_suite.test_equality( crystal_structure.natoms(), size_t( 2 ), "read_xsd() natoms" );
+        test_suite.test_equality( crystal_structure.atom( 0 ).label(), std::string( "Cl1" ), "read_xsd() label" );
+        test_suite.test_equality( crystal_structure.atom( 0 ).element(), Element( "Cl" ), "read_xsd() element" );
+        test_suite.test_equality_double( crystal_structure.atom( 1 ).position().z(), -0.125, "read_xsd() position" );
+        test_suite.test_equality_double( crystal_structure.crystal_lattice().b(), 11.0, "read_xsd() b" );
+        test_suite.test_equality_double( crystal_structure.crystal_lattice().gamma().value_in_degrees(), 90.0, "read_xsd() gamma" );
     }
 
 }
@@ -0,0 +1,106 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "ReadXYZ.h"
+#include "Atom.h"
+#include "Element.h"
+#include "FileName.h"
+#include "Vector3D.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void test_read_xyz( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for ReadXYZ." << std::endl;
+    FileName file_name( "", "test_read_xyz", "xyz" );
+    {
+    std::ofstream output_file( file_name.full_name().c_str(), std::ios::binary );
+    output_file << "2\r\nframe 1\r\nC 1.0 2.0 3.0\r\nO 4.0 5.0 6.0\r\n";
+    output_file << "\n3\nframe 2\nC 1.5 2.0 3.0\nO 4.0 5.5 6.0 0.1\nH\t7.0\t8.0\t9.0\n";
+    output_file << "1\nframe 3\nN 0.0 0.0 -1.0e1";
+    }
+    {
+    Atom atom;
+    xyz_line_to_atom( "  Cl  1.0 -2.5(3)  3.0  extra", 7, atom );
+    test_suite.test_equality( atom.element().symbol(), std::string( "Cl" ), "xyz_line_to_atom() element" );
+    test_suite.test_equality( atom.label(), std::string( "Cl7" ), "xyz_line_to_atom() label" );
+    test_suite.test_equality_double( atom.position().y(), -2.5, "xyz_line_to_atom() position" );
+    }
+    // Sequential
+    {
+    XYZFrameReader frame_reader( file_name );
+    std::vector< Atom > atoms;
+    test_suite.test_equality( frame_reader.read_next_frame( atoms ), true, "XYZFrameReader::read_next_frame() 1" );
+    test_suite.test_equality( atoms.size(), size_t( 2 ), "XYZFrameReader::read_next_frame() natoms 1" );
+    test_suite.test_equality( frame_reader.comment(), std::string( "frame 1" ), "XYZFrameReader::comment()" );
+    test_suite.test_equality_double( atoms[1].position().z(), 6.0, "XYZFrameReader::read_next_frame() position" );
+    test_suite.test_equality( frame_reader.read_next_frame( atoms ), true, "XYZFrameReader::read_next_frame() 2" );
+    test_suite.test_equality( atoms.size(), size_t( 3 ), "XYZFrameReader::read_next_frame() natoms 2" );
+    test_suite.test_equality( atoms[2].element().symbol(), std::string( "H" ), "XYZFrameReader::read_next_frame() element" );
+    test_suite.test_equality( atoms[2].label(), std::string( "H3" ), "XYZFrameReader::read_next_frame() label" );
+    test_suite.test_equality( frame_reader.read_next_frame( atoms ), true, "XYZFrameReader::read_next_frame() 3" );
+    test_suite.test_equality_double( atoms[0].position().z(), -10.0, "XYZFrameReader::read_next_frame() last line" );
+    test_suite.test_equality( frame_reader.read_next_frame( atoms ), false, "XYZFrameReader::read_next_frame() end" );
+    test_suite.test_equality( atoms.size(), size_t( 1 ), "XYZFrameReader::read_next_frame() end natoms" );
+    test_suite.test_equality( frame_reader.nframes(), size_t( 3 ), "XYZFrameReader::nframes() 1" );
+    }
+    // Random access
+    {
+    XYZFrameReader frame_reader( file_name );
+    std::vector< Atom > atoms;
+    frame_reader.read_frame( 1, atoms );
+    test_suite.test_equality( frame_reader.comment(), std::string( "frame 2" ), "XYZFrameReader::read_frame() 1" );
+    test_suite.test_equality( frame_reader.next_frame(), size_t( 2 ), "XYZFrameReader::next_frame()" );
+    test_suite.test_equality( frame_reader.read_next_frame( atoms ), true, "XYZFrameReader::read_frame() 2" );
+    test_suite.test_equality( frame_reader.comment(), std::string( "frame 3" ), "XYZFrameReader::read_frame() 3" );
+    frame_reader.read_frame( 0, atoms );
+    test_suite.test_equality( frame_reader.comment(), std::string( "frame 1" ), "XYZFrameReader::read_frame() 4" );
+    test_suite.test_equality( frame_reader.nframes(), size_t( 3 ), "XYZFrameReader::nframes() 2" );
+    test_suite.test_equality( frame_reader.read_next_frame( atoms ), true, "XYZFrameReader::read_frame() 5" );
+    test_suite.test_equality( frame_reader.comment(), std::string( "frame 2" ), "XYZFrameReader::read_frame() 6" );
+    bool thrown( false );
+    try
+    {
+        frame_reader.read_frame( 3, atoms );
+    }
+    catch ( std::exception & )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "XYZFrameReader::read_frame() beyond end" );
+    }
+    std::remove( file_name.full_name().c_str() );
+}
+
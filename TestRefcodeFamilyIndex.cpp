@@ -0,0 +1,84 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "RefcodeFamilyIndex.h"
+#include "FileList.h"
+#include "FileName.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+void test_refcode_family_index( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for RefcodeFamilyIndex." << std::endl;
+    {
+    std::vector< std::string > refcodes;
+    refcodes.push_back( "ABCDEF" );
+    refcodes.push_back( "abcdef01" );
+    refcodes.push_back( "XYZXYZ02" );
+    refcodes.push_back( "ABCDEF03_optimised" );
+    refcodes.push_back( "12ABCD" );
+    refcodes.push_back( "XYZXYZ" );
+    refcodes.push_back( "QQQQQQ" );
+    RefcodeFamilyIndex refcode_family_index( refcodes );
+    test_suite.test_equality( refcode_family_index.nentries(), static_cast<size_t>(7), "RefcodeFamilyIndex 01" );
+    test_suite.test_equality( refcode_family_index.nfamilies(), static_cast<size_t>(3), "RefcodeFamilyIndex 02" );
+    test_suite.test_equality( refcode_family_index.family( 0 ), std::string( "ABCDEF" ), "RefcodeFamilyIndex 03" );
+    test_suite.test_equality( refcode_family_index.family( 1 ), std::string( "XYZXYZ" ), "RefcodeFamilyIndex 04" );
+    test_suite.test_equality( refcode_family_index.family( 2 ), std::string( "QQQQQQ" ), "RefcodeFamilyIndex 05" );
+    std::vector< size_t > members = refcode_family_index.members( 0 );
+    test_suite.test_equality( members.size(), static_cast<size_t>(3), "RefcodeFamilyIndex 06" );
+    test_suite.test_equality( members[2], static_cast<size_t>(3), "RefcodeFamilyIndex 07" );
+    test_suite.test_equality( refcode_family_index.family_size( 1 ), static_cast<size_t>(2), "RefcodeFamilyIndex 08" );
+    test_suite.test_equality( refcode_family_index.family_of_entry( 4 ), refcode_family_index.nfamilies(), "RefcodeFamilyIndex 09" );
+    test_suite.test_equality( refcode_family_index.family_of_entry( 5 ), static_cast<size_t>(1), "RefcodeFamilyIndex 10" );
+    test_suite.test_equality( refcode_family_index.find( "Abcdef07" ), static_cast<size_t>(0), "RefcodeFamilyIndex 11" );
+    test_suite.test_equality( refcode_family_index.find( "ZZZZZZ" ), refcode_family_index.nfamilies(), "RefcodeFamilyIndex 12" );
+    test_suite.test_equality( refcode_family_index.find( "ABC" ), refcode_family_index.nfamilies(), "RefcodeFamilyIndex 13" );
+    std::vector< std::pair< size_t, size_t > > pairs = refcode_family_index.within_family_pairs();
+    test_suite.test_equality( pairs.size(), static_cast<size_t>(4), "RefcodeFamilyIndex 14" );
+    test_suite.test_equality( pairs[3] == std::make_pair( static_cast<size_t>(2), static_cast<size_t>(5) ), true, "RefcodeFamilyIndex 15" );
+    }
+    {
+    std::vector< FileName > file_names;
+    file_names.push_back( FileName( "", "KAXXAI", "cif" ) );
+    file_names.push_back( FileName( "", "KAXXAI01", "cif" ) );
+    RefcodeFamilyIndex refcode_family_index( ( FileList( file_names ) ) );
+    test_suite.test_equality( refcode_family_index.nfamilies(), static_cast<size_t>(1), "RefcodeFamilyIndex 16" );
+    test_suite.test_equality( refcode_family_index.family_size( 0 ), static_cast<size_t>(2), "RefcodeFamilyIndex 17" );
+    }
+    {
+    RefcodeFamilyIndex refcode_family_index;
+    test_suite.test_equality( refcode_family_index.nfamilies(), static_cast<size_t>(0), "RefcodeFamilyIndex 18" );
+    test_suite.test_equality( refcode_family_index.within_family_pairs().empty(), true, "RefcodeFamilyIndex 19" );
+    }
+}
+
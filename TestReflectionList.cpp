@@ -0,0 +1,128 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ReflectionList.h"
+#include "Matrix3D.h"
+#include "MillerIndices.h"
+#include "ParallelFor.h"
+#include "PointGroup.h"
+#include "Vector3D.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+void test_reflection_list( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for ReflectionList." << std::endl;
+    {
+    // Added in arbitrary order, read back in order of decreasing d-spacing, equal d-spacings keep their order
+    ReflectionList reflection_list;
+    reflection_list.push_back( MillerIndices( 1, 1, 0 ), 10.0, 3.0, 4 );
+    reflection_list.push_back( MillerIndices( 1, 0, 0 ), 20.0, 5.0, 2, std::vector< Vector3D >( 2, Vector3D( 1.0, 0.0, 0.0 ) ) );
+    reflection_list.push_back( MillerIndices( 2, 0, 0 ), 30.0, 2.5, 2 );
+    reflection_list.push_back( MillerIndices( 0, 1, 0 ), 40.0, 5.0, 2 );
+    reflection_list.finalise();
+    test_suite.test_equality( reflection_list.size(), static_cast<size_t>(4), "ReflectionList 01" );
+    test_suite.test_equality( reflection_list.miller_indices( 0 ) == MillerIndices( 1, 0, 0 ), true, "ReflectionList 02" );
+    test_suite.test_equality( reflection_list.miller_indices( 1 ) == MillerIndices( 0, 1, 0 ), true, "ReflectionList 03" );
+    test_suite.test_equality_double( reflection_list.d_spacing( 2 ), 3.0, "ReflectionList 04" );
+    test_suite.test_equality_double( reflection_list.F_squared( 3 ), 30.0, "ReflectionList 05" );
+    test_suite.test_equality( reflection_list.nequivalent_directions( 0 ), static_cast<size_t>(2), "ReflectionList 06" );
+    test_suite.test_equality( reflection_list.nequivalent_directions( 1 ), static_cast<size_t>(0), "ReflectionList 07" );
+    // Adding without finalise() sorts lazily
+    reflection_list.push_back( MillerIndices( 0, 0, 1 ), 50.0, 10.0, 2 );
+    test_suite.test_equality( reflection_list.miller_indices( 0 ) == MillerIndices( 0, 0, 1 ), true, "ReflectionList 08" );
+    test_suite.test_equality( reflection_list.index( MillerIndices( 2, 0, 0 ) ), static_cast<size_t>(4), "ReflectionList 09" );
+    // Changing a d-spacing moves the reflection
+    reflection_list.set_d_spacing( 4, 20.0 );
+    test_suite.test_equality( reflection_list.miller_indices( 0 ) == MillerIndices( 2, 0, 0 ), true, "ReflectionList 10" );
+    test_suite.test_equality_double( reflection_list.F_squared( 0 ), 30.0, "ReflectionList 11" );
+    }
+    {
+    // Added in order of decreasing d-spacing, with a copy taken half way
+    ReflectionList reflection_list;
+    reflection_list.reserve( 100 );
+    for ( size_t i( 0 ); i != 50; ++i )
+        reflection_list.push_back( MillerIndices( static_cast< int >( i ), 0, 0 ), static_cast< double >( i ), 100.0 - i, 2 );
+    ReflectionList copy( reflection_list );
+    for ( size_t i( 50 ); i != 100; ++i )
+        reflection_list.push_back( MillerIndices( static_cast< int >( i ), 0, 0 ), static_cast< double >( i ), 100.0 - i, 2 );
+    bool in_order( true );
+    for ( size_t i( 0 ); i != reflection_list.size(); ++i )
+        in_order = in_order && ( reflection_list.miller_indices( i ).h() == static_cast< int >( i ) );
+    test_suite.test_equality( in_order, true, "ReflectionList 12" );
+    test_suite.test_equality( copy.size(), static_cast<size_t>(50), "ReflectionList 13" );
+    test_suite.test_equality_double( copy.d_spacing( 49 ), 51.0, "ReflectionList 14" );
+    }
+    {
+    // Hashed and equivalence-aware look-up, Laue class 2/m with the unique axis along b
+    std::vector< Matrix3D > symmetry_operators;
+    symmetry_operators.push_back( Matrix3D() );
+    symmetry_operators.push_back( Matrix3D( -1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, -1.0 ) );
+    symmetry_operators.push_back( Matrix3D( -1.0, 0.0, 0.0, 0.0, -1.0, 0.0, 0.0, 0.0, -1.0 ) );
+    symmetry_operators.push_back( Matrix3D( 1.0, 0.0, 0.0, 0.0, -1.0, 0.0, 0.0, 0.0, 1.0 ) );
+    const PointGroup laue_class( symmetry_operators );
+    ReflectionList reflection_list;
+    reflection_list.push_back( MillerIndices( 1, 2, 3 ), 1.0, 2.0, 4 );
+    reflection_list.push_back( MillerIndices( 1, 0, 0 ), 2.0, 8.0, 2 );
+    reflection_list.push_back( MillerIndices( 1, 2, -3 ), 3.0, 1.5, 4 );
+    reflection_list.push_back( MillerIndices( 1, 0, 0 ), 4.0, 8.0, 2 );
+    reflection_list.finalise( true );
+    test_suite.test_equality( reflection_list.index( MillerIndices( 1, 2, 3 ) ), static_cast<size_t>(2), "ReflectionList 15" );
+    test_suite.test_equality( reflection_list.index( MillerIndices( 1, 0, 0 ) ), static_cast<size_t>(0), "ReflectionList 16" );
+    test_suite.test_equality( reflection_list.index( MillerIndices( -1, 0, 0 ) ), reflection_list.size(), "ReflectionList 17" );
+    test_suite.test_equality( reflection_list.index( MillerIndices( -1, 0, 0 ), laue_class ), static_cast<size_t>(0), "ReflectionList 18" );
+    test_suite.test_equality( reflection_list.index( MillerIndices( -1, 2, -3 ), laue_class ), static_cast<size_t>(2), "ReflectionList 19" );
+    test_suite.test_equality( reflection_list.index( MillerIndices( -1, -2, 3 ), laue_class ), static_cast<size_t>(3), "ReflectionList 20" );
+    test_suite.test_equality( reflection_list.index( MillerIndices( 3, 2, 1 ), laue_class ), reflection_list.size(), "ReflectionList 21" );
+    // The index is rebuilt after the list has changed
+    reflection_list.push_back( MillerIndices( 0, 0, 1 ), 5.0, 10.0, 2 );
+    test_suite.test_equality( reflection_list.index( MillerIndices( 1, 2, 3 ) ), static_cast<size_t>(3), "ReflectionList 22" );
+    test_suite.test_equality( reflection_list.index( MillerIndices( 0, 0, 1 ) ), static_cast<size_t>(0), "ReflectionList 23" );
+    reflection_list.set_miller_indices( 0, MillerIndices( 0, 0, 2 ) );
+    test_suite.test_equality( reflection_list.index( MillerIndices( 0, 0, 1 ) ), reflection_list.size(), "ReflectionList 24" );
+    test_suite.test_equality( Laue_class_representative( MillerIndices( -1, -2, 3 ), laue_class ) == MillerIndices( 1, 2, -3 ), true, "ReflectionList 25" );
+    test_suite.test_equality( Laue_class_representative( MillerIndices( 0, -1, 0 ), laue_class ) == MillerIndices( 0, 1, 0 ), true, "ReflectionList 26" );
+    }
+    {
+    // Several threads reading an unsorted list: exactly one of them sorts it and builds the index, the others wait
+    ReflectionList reflection_list;
+    for ( size_t i( 0 ); i != 200; ++i )
+        reflection_list.push_back( MillerIndices( static_cast< int >( i ), 0, 0 ), static_cast< double >( i ), 1.0 + i, 2 );
+    std::vector< char > correct( 200, 0 );
+    parallel_for( 200, 4, [ & ]( const size_t i )
+        {
+            correct[i] = ( reflection_list.miller_indices( 199 - i ).h() == static_cast< int >( i ) ) &&
+                         ( reflection_list.index( MillerIndices( static_cast< int >( i ), 0, 0 ) ) == 199 - i );
+        } );
+    test_suite.test_equality( std::count( correct.begin(), correct.end(), 1 ), static_cast< std::ptrdiff_t >( 200 ), "ReflectionList 27" );
+    }
+}
@@ -0,0 +1,97 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ReproducibleSum.h"
+#include "ParallelFor.h"
+#include "RandomNumberGenerator.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+void test_reproducible_sum( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for ReproducibleSum." << std::endl;
+    {
+    // Exact, where ordinary summation loses the small value
+    ReproducibleSum reproducible_sum;
+    reproducible_sum.add( 1.0E100 );
+    reproducible_sum.add( 1.0 );
+    reproducible_sum.add( -1.0E100 );
+    test_suite.test_equality( reproducible_sum.sum(), 1.0, "ReproducibleSum::sum() 01" );
+    test_suite.test_equality( ReproducibleSum().sum(), 0.0, "ReproducibleSum::sum() 02" );
+    reproducible_sum.add( -3.0 );
+    test_suite.test_equality( reproducible_sum.sum(), -2.0, "ReproducibleSum::sum() 03" );
+    }
+    {
+    // Subnormals and the largest double
+    const double smallest = std::numeric_limits< double >::denorm_min();
+    ReproducibleSum reproducible_sum;
+    for ( size_t i( 0 ); i != 5; ++i )
+        reproducible_sum.add( smallest );
+    test_suite.test_equality( reproducible_sum.sum(), 5.0 * smallest, "ReproducibleSum::sum() subnormals" );
+    ReproducibleSum largest;
+    largest.add( std::numeric_limits< double >::max() );
+    largest.add( std::numeric_limits< double >::max() );
+    largest.add( -std::numeric_limits< double >::max() );
+    test_suite.test_equality( largest.sum(), std::numeric_limits< double >::max(), "ReproducibleSum::sum() overflow" );
+    largest.add( std::numeric_limits< double >::infinity() );
+    test_suite.test_equality( largest.sum(), std::numeric_limits< double >::infinity(), "ReproducibleSum::sum() infinity" );
+    }
+    {
+    // Values of very different magnitudes and signs: the same sum in any order, also when split over several accumulators
+    RandomNumberGenerator_double random_number_generator;
+    std::vector< double > values;
+    for ( size_t i( 0 ); i != 10000; ++i )
+        values.push_back( ( random_number_generator.next_number() - 0.5 ) * std::pow( 10.0, 30.0 * random_number_generator.next_number() - 15.0 ) );
+    ReproducibleSum forward;
+    for ( size_t i( 0 ); i != values.size(); ++i )
+        forward.add( values[i] );
+    ReproducibleSum backward;
+    for ( size_t i( values.size() ); i != 0; --i )
+        backward.add( values[i-1] );
+    std::vector< double > sorted( values );
+    std::sort( sorted.begin(), sorted.end() );
+    ReproducibleSum first_half;
+    ReproducibleSum second_half;
+    for ( size_t i( 0 ); i != sorted.size(); ++i )
+        ( ( i < sorted.size() / 2 ) ? first_half : second_half ).add( sorted[i] );
+    second_half.add( first_half );
+    test_suite.test_equality( forward.sum() == backward.sum(), true, "ReproducibleSum::sum() order 01" );
+    test_suite.test_equality( forward.sum() == second_half.sum(), true, "ReproducibleSum::sum() order 02" );
+    // parallel_sum() does not depend on the grain size either
+    const double reference = parallel_sum( values.size(), 1, 1, [&]( const size_t i ) { return values[i]; }, REPRODUCIBLE_SUMMATION );
+    test_suite.test_equality( reference == forward.sum(), true, "parallel_sum() 01" );
+    test_suite.test_equality( parallel_sum( values.size(), 4, 37, [&]( const size_t i ) { return values[i]; }, REPRODUCIBLE_SUMMATION ) == reference, true, "parallel_sum() 02" );
+    test_suite.test_equality( parallel_sum( values.size(), 3, 1000, [&]( const size_t i ) { return values[i]; }, REPRODUCIBLE_SUMMATION ) == reference, true, "parallel_sum() 03" );
+    test_suite.test_equality_double( parallel_sum( values.size(), 4, 64, [&]( const size_t i ) { return values[i]; } ), reference, "parallel_sum() FAST_SUMMATION", 1.0E-6 * std::abs( reference ) );
+    }
+}
@@ -0,0 +1,159 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ResultsContainer.h"
+#include "CorrelationMatrix.h"
+#include "FileName.h"
+#include "MillerIndices.h"
+#include "ParallelFor.h"
+#include "PowderPattern.h"
+#include "ReflectionList.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void test_results_container( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for ResultsContainer." << std::endl;
+    const FileName file_name( "test_results_container.frc" );
+    const size_t nstructures( 7 );
+    const Angle two_theta_start = Angle::from_degrees( 5.0 );
+    const Angle two_theta_step = Angle::from_degrees( 0.02 );
+    const size_t npoints( 1001 );
+    CorrelationMatrix similarity_matrix( nstructures );
+    for ( size_t i( 0 ); i != nstructures; ++i )
+    {
+        for ( size_t j( 0 ); j != i; ++j )
+            similarity_matrix.set_value( i, j, 1.0 / ( 1.0 + i + 2 * j ) );
+    }
+    {
+    ResultsContainerWriter results_container_writer( file_name, nstructures, two_theta_start, two_theta_step, npoints, 1.2 );
+    // In parallel and in any order, structure 3 has no pattern and no reflection list
+    parallel_for( nstructures, 4, [&]( const size_t i )
+    {
+        results_container_writer.write_identifier( i, "structure_" + size_t2string( i ) );
+        if ( i == 3 )
+            return;
+        PowderPattern powder_pattern( two_theta_start, two_theta_start + ( npoints - 1 ) * two_theta_step, two_theta_step );
+        for ( size_t j( 0 ); j != npoints; ++j )
+            powder_pattern.set_intensity( j, ( j % ( 10 + i ) == 0 ) ? 100.0 * i : 0.0 );
+        results_container_writer.write_powder_pattern( i, powder_pattern );
+        ReflectionList reflection_list;
+        for ( size_t j( 0 ); j != i + 1; ++j )
+            reflection_list.push_back( MillerIndices( j, -1, 2 ), 10.0 * j, 10.0 / ( j + 1 ), 2 * j + 1 );
+        results_container_writer.write_reflection_list( i, reflection_list );
+    } );
+    results_container_writer.write_similarity_matrix( similarity_matrix );
+    bool has_thrown( false );
+    try
+    {
+        results_container_writer.write_identifier( 2, "again" );
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "ResultsContainerWriter::write_identifier()" );
+    PowderPattern wrong_grid( two_theta_start + two_theta_step, two_theta_start + npoints * two_theta_step, two_theta_step );
+    has_thrown = false;
+    try
+    {
+        results_container_writer.write_powder_pattern( 3, wrong_grid );
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "ResultsContainerWriter::write_powder_pattern()" );
+    results_container_writer.close();
+    }
+    {
+    ResultsContainer results_container( file_name );
+    test_suite.test_equality( results_container.nstructures(), nstructures, "ResultsContainer::nstructures()" );
+    test_suite.test_equality( results_container.npoints(), npoints, "ResultsContainer::npoints()" );
+    test_suite.test_equality( nearly_equal( results_container.wavelength(), 1.2 ), true, "ResultsContainer::wavelength()" );
+    test_suite.test_equality( results_container.identifier( 5 ), std::string( "structure_5" ), "ResultsContainer::identifier()" );
+    test_suite.test_equality( results_container.has_powder_pattern( 3 ), false, "ResultsContainer::has_powder_pattern() 01" );
+    test_suite.test_equality( results_container.has_powder_pattern( 4 ), true, "ResultsContainer::has_powder_pattern() 02" );
+    test_suite.test_equality( results_container.has_reflection_list( 3 ), false, "ResultsContainer::has_reflection_list()" );
+    PowderPattern powder_pattern = results_container.powder_pattern( 4 );
+    test_suite.test_equality( powder_pattern.size(), npoints, "ResultsContainer::powder_pattern() 01" );
+    test_suite.test_equality( nearly_equal( powder_pattern.two_theta( npoints - 1 ).value_in_degrees(), 25.0 ), true, "ResultsContainer::powder_pattern() 02" );
+    test_suite.test_equality( nearly_equal( powder_pattern.intensity( 14 ), 400.0 ), true, "ResultsContainer::powder_pattern() 03" );
+    test_suite.test_equality( nearly_equal( powder_pattern.intensity( 15 ), 0.0 ), true, "ResultsContainer::powder_pattern() 04" );
+    ReflectionList reflection_list = results_container.reflection_list( 6 );
+    test_suite.test_equality( reflection_list.size(), size_t( 7 ), "ResultsContainer::reflection_list() 01" );
+    bool are_equal( true );
+    for ( size_t j( 0 ); j != reflection_list.size(); ++j )
+    {
+        // Sorted by d-spacing, so the same order as written
+        are_equal = are_equal && ( reflection_list.miller_indices( j ) == MillerIndices( j, -1, 2 ) );
+        are_equal = are_equal && nearly_equal( reflection_list.F_squared( j ), 10.0 * j );
+        are_equal = are_equal && ( reflection_list.multiplicity( j ) == 2 * j + 1 );
+    }
+    if ( ! are_equal )
+        test_suite.log_error( "ResultsContainer::reflection_list() 02" );
+    CorrelationMatrix similarity_matrix_2 = results_container.similarity_matrix();
+    are_equal = ( similarity_matrix_2.size() == nstructures );
+    for ( size_t i( 0 ); i != nstructures; ++i )
+    {
+        for ( size_t j( 0 ); j != nstructures; ++j )
+            are_equal = are_equal && ( similarity_matrix_2.value( i, j ) == similarity_matrix.value( i, j ) );
+    }
+    if ( ! are_equal )
+        test_suite.log_error( "ResultsContainer::similarity_matrix()" );
+    bool has_thrown( false );
+    try
+    {
+        results_container.powder_pattern( 3 );
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "ResultsContainer::powder_pattern() 05" );
+    }
+    {
+    // An empty identifier, no patterns and no similarity matrix
+    {
+    ResultsContainerWriter results_container_writer( file_name, 1, two_theta_start, two_theta_step, npoints );
+    results_container_writer.write_identifier( 0, "" );
+    results_container_writer.close();
+    ResultsContainer results_container( file_name );
+    test_suite.test_equality( results_container.identifier( 0 ), std::string(), "ResultsContainer::identifier() empty" );
+    test_suite.test_equality( results_container.has_similarity_matrix(), false, "ResultsContainer::has_similarity_matrix()" );
+    }
+    std::remove( file_name.full_name().c_str() );
+    }
+}
+
@@ -0,0 +1,122 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "RunningAverageAndESD.h"
+#include "Angle.h"
+#include "Vector3D.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <vector>
+
+void test_running_average_and_ESD( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for RunningAverageAndESD." << std::endl;
+    std::vector< double > values;
+    for ( size_t i( 0 ); i != 17; ++i )
+        values.push_back( 1000.0 + 0.37 * i - 0.011 * i * i );
+    RunningAverageAndESD< double > sequential( values );
+    // Merge
+    {
+    RunningAverageAndESD< double > lhs;
+    RunningAverageAndESD< double > rhs;
+    for ( size_t i( 0 ); i != values.size(); ++i )
+    {
+        if ( i < 5 )
+            lhs.add_value( values[i] );
+        else
+            rhs.add_value( values[i] );
+    }
+    lhs.merge( rhs );
+    lhs.merge( RunningAverageAndESD< double >() );
+    test_suite.test_equality( lhs.nvalues(), values.size(), "RunningAverageAndESD::merge() nvalues" );
+    test_suite.test_equality_double( lhs.average(), sequential.average(), "RunningAverageAndESD::merge() average", 1.0E-10 );
+    test_suite.test_equality_double( lhs.estimated_standard_deviation(), sequential.estimated_standard_deviation(), "RunningAverageAndESD::merge() ESD", 1.0E-10 );
+    }
+    // Batch add for a contiguous array
+    {
+    RunningAverageAndESD< double > batch( values[0] );
+    batch.add_values( &values[1], values.size() - 1 );
+    test_suite.test_equality( batch.nvalues(), values.size(), "RunningAverageAndESD::add_values() nvalues" );
+    test_suite.test_equality_double( batch.average(), sequential.average(), "RunningAverageAndESD::add_values() average", 1.0E-10 );
+    test_suite.test_equality_double( batch.estimated_standard_deviation(), sequential.estimated_standard_deviation(), "RunningAverageAndESD::add_values() ESD", 1.0E-10 );
+    }
+    // Angle
+    {
+    RunningAverageAndESD< Angle > lhs( Angle::from_degrees( 89.0 ) );
+    RunningAverageAndESD< Angle > rhs( Angle::from_degrees( 90.0 ) );
+    rhs.add_value( Angle::from_degrees( 91.0 ) );
+    lhs.merge( rhs );
+    test_suite.test_equality_double( lhs.average().value_in_degrees(), 90.0, "RunningAverageAndESD< Angle >::merge() average" );
+    test_suite.test_equality_double( lhs.estimated_standard_deviation().value_in_degrees(), 1.0, "RunningAverageAndESD< Angle >::merge() ESD" );
+    }
+    // The structure-of-arrays version must be identical to a std::vector of RunningAverageAndESD< Vector3D >
+    {
+    const size_t natoms( 3 );
+    const size_t multiplicity( 2 );
+    std::vector< RunningAverageAndESD< Vector3D > > expected( natoms );
+    RunningAverageAndESDArray calculated( natoms );
+    RunningAverageAndESDArray first_half( natoms );
+    RunningAverageAndESDArray second_half( natoms );
+    for ( size_t frame( 0 ); frame != 4; ++frame )
+    {
+        std::vector< Vector3D > positions;
+        for ( size_t i( 0 ); i != natoms; ++i )
+        {
+            for ( size_t j( 0 ); j != multiplicity; ++j )
+            {
+                positions.push_back( Vector3D( 0.1 * i + 0.01 * frame, 0.2 + 0.003 * j * frame, 0.5 - 0.02 * frame * frame ) );
+                expected[i].add_value( positions.back() );
+            }
+        }
+        calculated.add_values( positions, multiplicity );
+        if ( frame < 2 )
+            first_half.add_values( positions, multiplicity );
+        else
+            second_half.add_values( positions, multiplicity );
+    }
+    first_half.merge( second_half );
+    test_suite.test_equality( calculated.nvalues(), size_t( 8 ), "RunningAverageAndESDArray::nvalues()" );
+    bool identical( true );
+    bool merged_equal( true );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        // With -Ofast the division by n may become a multiplication by 1/n in the vectorised loop, so allow for the last digit
+        if ( ( ! nearly_equal( calculated.average( i ), expected[i].average(), 1.0E-12 ) ) ||
+             ( ! nearly_equal( calculated.estimated_standard_deviation( i ), expected[i].estimated_standard_deviation(), 1.0E-12 ) ) )
+            identical = false;
+        if ( ( ! nearly_equal( first_half.average( i ), expected[i].average(), 1.0E-12 ) ) ||
+             ( ! nearly_equal( first_half.estimated_standard_deviation( i ), expected[i].estimated_standard_deviation(), 1.0E-12 ) ) )
+            merged_equal = false;
+    }
+    test_suite.test_equality( identical, true, "RunningAverageAndESDArray::add_values()" );
+    test_suite.test_equality( merged_equal, true, "RunningAverageAndESDArray::merge()" );
+    }
+}
+
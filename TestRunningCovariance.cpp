@@ -0,0 +1,82 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "RunningCovariance.h"
+#include "3DCalculations.h"
+#include "Utilities.h"
+#include "Vector3DCalculations.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <vector>
+
+void test_running_covariance( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for RunningCovariance." << std::endl;
+    std::vector< Vector3D > points;
+    points.push_back( Vector3D( 1.0, 2.0, 3.0 ) );
+    points.push_back( Vector3D( 1.5, 2.5, 2.0 ) );
+    points.push_back( Vector3D( 0.5, 1.0, 3.5 ) );
+    points.push_back( Vector3D( 1.2, 2.2, 3.1 ) );
+    // A large offset, which would cause cancellation in the naive sum-of-squares formula
+    for ( size_t i( 0 ); i != points.size(); ++i )
+        points[i] += Vector3D( 1000.0, -1000.0, 1000.0 );
+    RunningCovariance running_covariance;
+    for ( size_t i( 0 ); i != points.size(); ++i )
+        running_covariance.add_value( points[i] );
+    test_suite.test_equality( running_covariance.nvalues(), points.size(), "RunningCovariance::nvalues()" );
+    test_suite.test_equality( nearly_equal( running_covariance.average(), average( points ) ), true, "RunningCovariance::average()" );
+    SymmetricMatrix3D expected = covariance_matrix( points );
+    SymmetricMatrix3D calculated = running_covariance.covariance_matrix();
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( i ); j != 3; ++j )
+            test_suite.test_equality_double( calculated.value( i, j ), expected.value( i, j ), "RunningCovariance::covariance_matrix() " + size_t2string( i ) + size_t2string( j ), 1.0E-9 );
+    }
+    // Merging two halves must give the same as adding all values to one object
+    RunningCovariance first_half;
+    RunningCovariance second_half;
+    for ( size_t i( 0 ); i != points.size(); ++i )
+    {
+        if ( i < 1 )
+            first_half.add_value( points[i] );
+        else
+            second_half.add_value( points[i] );
+    }
+    first_half.merge( second_half );
+    test_suite.test_equality( first_half.nvalues(), points.size(), "RunningCovariance::merge() nvalues" );
+    test_suite.test_equality( nearly_equal( first_half.average(), average( points ) ), true, "RunningCovariance::merge() average" );
+    calculated = first_half.covariance_matrix();
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        for ( size_t j( i ); j != 3; ++j )
+            test_suite.test_equality_double( calculated.value( i, j ), expected.value( i, j ), "RunningCovariance::merge() " + size_t2string( i ) + size_t2string( j ), 1.0E-9 );
+    }
+}
+
@@ -0,0 +1,98 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ScratchArena.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+void test_scratch_arena( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for ScratchArena." << std::endl;
+
+    {
+    test_suite.test_equality( scratch_resource() == std::pmr::new_delete_resource(), true, "ScratchArena 01" );
+    std::pmr::memory_resource * arena( nullptr );
+    {
+    ScratchArenaScope scratch_arena_scope;
+    arena = scratch_resource();
+    test_suite.test_equality( arena != std::pmr::new_delete_resource(), true, "ScratchArena 02" );
+    {
+    ScratchArenaScope inner_scope;
+    test_suite.test_equality( scratch_resource() == arena, true, "ScratchArena 03" );
+    }
+    // The inner scope must not have released anything
+    test_suite.test_equality( scratch_resource() == arena, true, "ScratchArena 04" );
+    }
+    test_suite.test_equality( scratch_resource() == std::pmr::new_delete_resource(), true, "ScratchArena 05" );
+    }
+
+    {
+    // The memory is released at the end of each structure and the first block is reused by the next one
+    std::vector< const void * > first_addresses;
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        ScratchArenaScope scratch_arena_scope;
+        std::pmr::vector< double > values( 1000, static_cast<double>( i ), scratch_resource() );
+        // More than one block
+        std::pmr::vector< char > large( 2 * scratch_arena_block_size, 0, scratch_resource() );
+        first_addresses.push_back( values.data() );
+        test_suite.test_equality( values[999], static_cast<double>( i ), "ScratchArena 06" );
+    }
+    test_suite.test_equality( first_addresses[1] == first_addresses[0], true, "ScratchArena 07" );
+    test_suite.test_equality( first_addresses[2] == first_addresses[0], true, "ScratchArena 08" );
+    }
+
+    {
+    // Each thread has its own arena
+    ScratchArenaScope scratch_arena_scope;
+    const void * main_resource = scratch_resource();
+    const void * thread_resource( nullptr );
+    size_t sum( 0 );
+    std::thread thread( [&thread_resource, &sum]()
+    {
+        ScratchArenaScope thread_scope;
+        thread_resource = scratch_resource();
+        std::pmr::vector< size_t > values( scratch_resource() );
+        for ( size_t j( 0 ); j != 10000; ++j )
+            values.push_back( j );
+        for ( size_t j( 0 ); j != values.size(); ++j )
+            sum += values[j];
+    } );
+    thread.join();
+    test_suite.test_equality( thread_resource != main_resource, true, "ScratchArena 09" );
+    test_suite.test_equality( thread_resource != static_cast< const void * >( std::pmr::new_delete_resource() ), true, "ScratchArena 10" );
+    test_suite.test_equality( sum, size_t(49995000), "ScratchArena 11" );
+    }
+
+}
+
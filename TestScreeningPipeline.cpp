@@ -0,0 +1,86 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "PowderPatternCalculator.h"
+#include "RunBenchmarks.h"
+#include "ScreeningPipeline.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void test_screening_pipeline( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for ScreeningPipeline." << std::endl;
+
+    std::vector< FileName > file_names;
+    file_names.push_back( FileName( "", "test_screening_pipeline_1", "cif" ) );
+    file_names.push_back( FileName( "", "test_screening_pipeline_2", "cif" ) );
+    file_names.push_back( FileName( "", "test_screening_pipeline_does_not_exist", "cif" ) );
+    file_names.push_back( FileName( "", "test_screening_pipeline_3", "cif" ) );
+    synthetic_molecular_crystal( 2 ).save_cif( file_names[0] );
+    CrystalStructure target_crystal_structure = synthetic_molecular_crystal( 1 );
+    target_crystal_structure.save_cif( file_names[1] );
+    synthetic_molecular_crystal( 1 ).save_cif( file_names[3] );
+    PowderPattern target;
+    PowderPatternCalculator powder_pattern_calculator( target_crystal_structure );
+    powder_pattern_calculator.set_two_theta_start( Angle( 5.0, Angle::DEGREES ) );
+    powder_pattern_calculator.set_two_theta_end( Angle( 25.0, Angle::DEGREES ) );
+    powder_pattern_calculator.set_two_theta_step( Angle( 0.02, Angle::DEGREES ) );
+    powder_pattern_calculator.set_FWHM( 0.1 );
+    powder_pattern_calculator.calculate( target );
+    ScreeningPipeline screening_pipeline( target );
+    screening_pipeline.set_nworkers( ScreeningPipeline::READ, 2 );
+    screening_pipeline.set_nworkers( ScreeningPipeline::PATTERN, 2 );
+    screening_pipeline.set_nworkers( ScreeningPipeline::COMPARE, 2 );
+    screening_pipeline.set_queue_capacity( 1 );
+    std::vector< double > similarities;
+    std::vector< std::string > error_messages;
+    size_t nfailed = screening_pipeline.run( FileList( file_names ), similarities, error_messages );
+    for ( size_t i( 0 ); i != file_names.size(); ++i )
+        std::remove( file_names[i].full_name().c_str() );
+    test_suite.test_equality( nfailed, size_t( 1 ), "ScreeningPipeline::run() 01" );
+    test_suite.test_equality( error_messages[2].empty(), false, "ScreeningPipeline::run() 02" );
+    test_suite.test_equality_double( similarities[1], 1.0, "ScreeningPipeline::run() 03" );
+    test_suite.test_equality_double( similarities[3], 1.0, "ScreeningPipeline::run() 04" );
+    test_suite.test_equality( similarities[0] < 0.99, true, "ScreeningPipeline::run() 05" );
+    test_suite.test_equality( screening_pipeline.statistics()[ ScreeningPipeline::READ ].nitems_, size_t( 3 ), "ScreeningPipeline::statistics() 01" );
+    test_suite.test_equality( screening_pipeline.statistics()[ ScreeningPipeline::COMPARE ].nitems_, size_t( 3 ), "ScreeningPipeline::statistics() 02" );
+    test_suite.test_equality( screening_pipeline.statistics()[ ScreeningPipeline::PATTERN ].nworkers_, size_t( 2 ), "ScreeningPipeline::statistics() 03" );
+    std::vector< size_t > ranking = rank( similarities );
+    test_suite.test_equality( ranking[0], size_t( 1 ), "rank() 01" );
+    test_suite.test_equality( ranking[1], size_t( 3 ), "rank() 02" );
+    test_suite.test_equality( ranking[2], size_t( 0 ), "rank() 03" );
+    test_suite.test_equality( ranking[3], size_t( 2 ), "rank() 04" );
+}
+
@@ -30,10 +30,75 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TestSuite.h"
 
 #include <iostream>
+#include <string>
+
+namespace
+{
+
+// The same tests for each of the storage policies
+template< class Storage >
+void test_storage( TestSuite & test_suite, const std::string & name )
+{
+    typedef BasicSetOfNumbers< Storage > Set;
+    std::vector< size_t > values;
+    values.push_back( 7 );
+    values.push_back( 2 );
+    values.push_back( 4 );
+    values.push_back( 2 );
+    values.push_back( 0 );
+    {
+    Set dummy( values );
+    test_suite.test_equality( dummy.values() == std::vector< size_t >( { 0, 2, 2, 4, 7 } ), true, name + " 01" );
+    test_suite.test_equality( dummy.frequency( 2 ), size_t( 2 ), name + " 02" );
+    test_suite.test_equality( dummy.frequency( 3 ), size_t( 0 ), name + " 03" );
+    test_suite.test_equality( dummy.contains_duplicates(), true, name + " 04" );
+    dummy.add( 3 );
+    dummy.remove( 2 );
+    dummy.remove( 5 );
+    test_suite.test_equality( dummy.values() == std::vector< size_t >( { 0, 2, 3, 4, 7 } ), true, name + " 05" );
+    test_suite.test_equality( dummy.contains( 3 ) && ( ! dummy.contains( 1 ) ) && ( ! dummy.contains( 100 ) ), true, name + " 06" );
+    Set other( std::vector< size_t >( { 2, 2, 7, 9 } ) );
+    test_suite.test_equality( dummy.in_common( other ).values() == std::vector< size_t >( { 2, 7 } ), true, name + " 07" );
+    test_suite.test_equality( merge( dummy, other ).size(), size_t( 9 ), name + " 08" );
+    test_suite.test_equality( ( Set( 3 ) == Set( std::vector< size_t >( { 2, 0, 1 } ) ) ), true, name + " 09" );
+    test_suite.test_equality( ( Set( 3 ) != Set( 1, 3 ) ), true, name + " 10" );
+    }
+    {
+    Set dummy( values, SetOfNumbersPolicy::AUTO_REMOVE );
+    test_suite.test_equality( dummy.values() == std::vector< size_t >( { 0, 2, 4, 7 } ), true, name + " 11" );
+    dummy.add( 4 );
+    test_suite.test_equality( dummy.size(), size_t( 4 ), name + " 12" );
+    Set with_duplicates( values );
+    with_duplicates.set_duplicates_policy( SetOfNumbersPolicy::AUTO_REMOVE );
+    test_suite.test_equality( ( with_duplicates.values() == dummy.values() ), true, name + " 13" );
+    }
+    try
+    {
+    Set dummy( values, SetOfNumbersPolicy::THROW );
+    test_suite.log_error( name + " should have thrown " );
+    }
+    catch ( std::exception & e )
+    {
+    }
+    try
+    {
+    Set dummy( std::vector< size_t >( { 1, 2 } ), SetOfNumbersPolicy::THROW );
+    dummy.add( 2 );
+    test_suite.log_error( name + " should have thrown " );
+    }
+    catch ( std::exception & e )
+    {
+    }
+}
+
+} // namespace
 
 void test_SetOfNumbers( TestSuite & test_suite )
 {
     std::cout << "Now running tests for SetOfNumbers." << std::endl;
+    test_storage< UnsortedNumbers >( test_suite, "SetOfNumbers UnsortedNumbers" );
+    test_storage< SortedNumbers >( test_suite, "SetOfNumbers SortedNumbers" );
+    test_storage< CountedNumbers >( test_suite, "SetOfNumbers CountedNumbers" );
     std::vector< size_t > values;
     values.push_back( 1 );
     values.push_back( 2 );
@@ -0,0 +1,150 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SimilarityAnalysis.h"
+#include "BatchPowderPatternCalculator.h"
+#include "Clustering.h"
+#include "CorrelationMatrix.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "Logger.h"
+#include "PowderPattern.h"
+#include "Utilities.h"
+
+#include "TestFixtures.h"
+#include "TestSuite.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sys/stat.h>
+#include <vector>
+
+void test_similarity_analysis( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for SimilarityAnalysis." << std::endl;
+    // A series of structures with slowly changing unit cells, so that there are both similar and dissimilar pairs
+    std::vector< CrystalStructure > crystal_structures;
+    for ( size_t i( 0 ); i != 5; ++i )
+        crystal_structures.push_back( P21c_test_structure( CrystalLattice( 7.1 + 0.05 * i, 9.3, 11.7 - 0.1 * i, Angle::angle_90_degrees(), Angle::from_degrees( 103.4 ), Angle::angle_90_degrees() ) ) );
+    BatchPowderPatternCalculator batch_powder_pattern_calculator;
+    batch_powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    batch_powder_pattern_calculator.calculate( crystal_structures );
+    Angle l = Angle::from_degrees( 1.0 );
+    {
+    CorrelationMatrix correlation_matrix = calculate_correlation_matrix( batch_powder_pattern_calculator, l, 0.0, 2 );
+    bool are_equal( true );
+    for ( size_t i( 0 ); i != crystal_structures.size(); ++i )
+    {
+        for ( size_t j( i + 1 ); j != crystal_structures.size(); ++j )
+            are_equal = are_equal && nearly_equal( correlation_matrix.value( i, j ), normalised_weighted_cross_correlation( batch_powder_pattern_calculator.powder_pattern( i ), batch_powder_pattern_calculator.powder_pattern( j ), l ), 0.0000001 );
+    }
+    if ( ! are_equal )
+        test_suite.log_error( "calculate_correlation_matrix()" );
+    }
+    {
+    // Patterns stored as floats
+    BatchPowderPatternCalculator single_precision_calculator;
+    single_precision_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    single_precision_calculator.set_precision( BatchPowderPatternCalculator::SINGLE_PRECISION );
+    single_precision_calculator.calculate( crystal_structures );
+    test_suite.test_equality_double( single_precision_calculator.intensity( 2, 100 ), batch_powder_pattern_calculator.intensity( 2, 100 ), "BatchPowderPatternCalculator SINGLE_PRECISION", 1.0E-4 );
+    CorrelationMatrix correlation_matrix = calculate_correlation_matrix( single_precision_calculator, l, 0.0, 2 );
+    test_suite.test_equality( correlation_matrix.precision() == CorrelationMatrix::SINGLE_PRECISION, true, "calculate_correlation_matrix() SINGLE_PRECISION matrix" );
+    bool are_equal( true );
+    for ( size_t i( 0 ); i != crystal_structures.size(); ++i )
+    {
+        for ( size_t j( i + 1 ); j != crystal_structures.size(); ++j )
+            are_equal = are_equal && nearly_equal( correlation_matrix.value( i, j ), normalised_weighted_cross_correlation( batch_powder_pattern_calculator.powder_pattern( i ), batch_powder_pattern_calculator.powder_pattern( j ), l ), 0.00001 );
+    }
+    if ( ! are_equal )
+        test_suite.log_error( "calculate_correlation_matrix() SINGLE_PRECISION" );
+    }
+    {
+    // Duplicates found while the matrix is calculated must be those found afterwards
+    DuplicateGroups duplicate_groups( crystal_structures.size(), 0.9 );
+    CorrelationMatrix correlation_matrix = calculate_correlation_matrix( batch_powder_pattern_calculator, l, 0.0, 2, &duplicate_groups );
+    test_suite.test_equality( duplicate_groups.groups() == group_duplicates( correlation_matrix, 0.9 ), true, "calculate_correlation_matrix() duplicates" );
+    }
+    {
+    // With a cutoff above 1.0 all values are estimates
+    CorrelationMatrix correlation_matrix = calculate_correlation_matrix( batch_powder_pattern_calculator, l, 2.0, 2 );
+    bool are_equal( true );
+    for ( size_t i( 0 ); i != crystal_structures.size(); ++i )
+    {
+        for ( size_t j( i + 1 ); j != crystal_structures.size(); ++j )
+            are_equal = are_equal && nearly_equal( correlation_matrix.value( i, j ), normalised_weighted_cross_correlation( batch_powder_pattern_calculator.powder_pattern( i ), batch_powder_pattern_calculator.powder_pattern( j ), l ), 0.01 );
+    }
+    if ( ! are_equal )
+        test_suite.log_error( "calculate_correlation_matrix() cutoff" );
+    }
+    {
+    // Three parts with tiles of 2 x 2 patterns, run one after the other, must give the same matrix as one calculation
+    const std::string directory( "test_similarity_analysis" );
+    mkdir( directory.c_str(), 0755 );
+    FileList file_list;
+    for ( size_t i( 0 ); i != crystal_structures.size(); ++i )
+    {
+        FileName file_name( directory, "structure_" + size_t2string( i ), "cif" );
+        crystal_structures[i].save_cif( file_name );
+        file_list.push_back( file_name );
+    }
+    const FileName matrix_file_name( directory, "matrix", "bin" );
+    const Logger::Level level = Logger::instance().level();
+    Logger::instance().set_level( Logger::WARNING );
+    size_t ntiles( 0 );
+    for ( size_t ipart( 0 ); ipart != 3; ++ipart )
+        ntiles += calculate_correlation_matrix_part( file_list, matrix_file_name, ipart, 3, 2, 2 );
+    test_suite.test_equality( ntiles, size_t( 5 ), "calculate_correlation_matrix_part() 1" );
+    // Everything has been recorded in the checkpoint files, so nothing is calculated again
+    ntiles = 0;
+    for ( size_t ipart( 0 ); ipart != 3; ++ipart )
+        ntiles += calculate_correlation_matrix_part( file_list, matrix_file_name, ipart, 3, 2, 2 );
+    test_suite.test_equality( ntiles, size_t( 0 ), "calculate_correlation_matrix_part() 2" );
+    {
+    CorrelationMatrix parts( matrix_file_name );
+    CorrelationMatrix whole = calculate_correlation_matrix( file_list );
+    bool are_equal( parts.size() == whole.size() );
+    for ( size_t i( 0 ); are_equal && ( i != whole.size() ); ++i )
+    {
+        for ( size_t j( i + 1 ); j != whole.size(); ++j )
+            are_equal = are_equal && nearly_equal( parts.value( i, j ), whole.value( i, j ), 0.0000001 );
+    }
+    if ( ! are_equal )
+        test_suite.log_error( "calculate_correlation_matrix_part() 3" );
+    }
+    Logger::instance().set_level( level );
+    for ( size_t i( 0 ); i != file_list.size(); ++i )
+        std::remove( file_list.value( i ).full_name().c_str() );
+    std::remove( matrix_file_name.full_name().c_str() );
+    for ( size_t ipart( 0 ); ipart != 3; ++ipart )
+        std::remove( append_to_file_name( matrix_file_name, "_part_" + size_t2string( ipart ) ).full_name().c_str() );
+    std::remove( directory.c_str() );
+    }
+}
+
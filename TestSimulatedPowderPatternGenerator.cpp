@@ -0,0 +1,176 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SimulatedPowderPatternGenerator.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "PowderPatternCalculator.h"
+#include "Utilities.h"
+
+#include "TestFixtures.h"
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::string file_contents( const FileName & file_name )
+{
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    return std::string( std::istreambuf_iterator< char >( input_file ), std::istreambuf_iterator< char >() );
+}
+
+} // namespace
+
+void test_simulated_powder_pattern_generator( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for SimulatedPowderPatternGenerator." << std::endl;
+    const CrystalStructure crystal_structure = P21c_test_structure( CrystalLattice( 7.1, 9.3, 11.7, Angle::angle_90_degrees(), Angle::from_degrees( 103.4 ), Angle::angle_90_degrees() ) );
+    SimulatedPowderPatternGenerator generator;
+    generator.set_two_theta_start( Angle::from_degrees( 5.0 ) );
+    generator.set_two_theta_end( Angle::from_degrees( 30.0 ) );
+    generator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    generator.set_zero_point_error( ParameterRange( -0.1, 0.1 ) );
+    generator.set_FWHM( ParameterRange( 0.1, 0.3 ) );
+    generator.set_PO_probability( 0.5 );
+    generator.set_PO_r( ParameterRange( 0.6, 1.0 ) );
+    generator.set_samples_per_structure( 3 );
+    // Parameters and reproducibility
+    {
+    std::vector< PowderPattern > powder_patterns;
+    std::vector< SimulatedPowderPatternParameters > parameters;
+    generator.simulate( crystal_structure, 7, powder_patterns, parameters );
+    test_suite.test_equality( powder_patterns.size(), size_t( 3 ), "SimulatedPowderPatternGenerator::simulate() number of patterns" );
+    test_suite.test_equality( powder_patterns[0].size(), generator.npoints(), "SimulatedPowderPatternGenerator::simulate() number of points" );
+    test_suite.test_equality_double( powder_patterns[1].two_theta( 0 ).value_in_degrees(), 5.0, "SimulatedPowderPatternGenerator::simulate() common 2theta grid" );
+    bool in_range( true );
+    for ( size_t j( 0 ); j != parameters.size(); ++j )
+    {
+        in_range = in_range && ( parameters[j].structure_ == 7 ) && ( parameters[j].sample_ == j );
+        in_range = in_range && ( parameters[j].zero_point_error_ >= -0.1 ) && ( parameters[j].zero_point_error_ <= 0.1 );
+        in_range = in_range && ( parameters[j].FWHM_ >= 0.1 ) && ( parameters[j].FWHM_ <= 0.3 );
+        in_range = in_range && ( parameters[j].PO_r_ >= 0.6 ) && ( parameters[j].PO_r_ <= 1.0 );
+        in_range = in_range && ( parameters[j].PO_direction_ == MillerIndices( 0, 1, 0 ) );
+    }
+    test_suite.test_equality( in_range, true, "SimulatedPowderPatternGenerator::simulate() parameters" );
+    std::vector< PowderPattern > powder_patterns_2;
+    std::vector< SimulatedPowderPatternParameters > parameters_2;
+    generator.simulate( crystal_structure, 7, powder_patterns_2, parameters_2 );
+    bool identical( true );
+    for ( size_t i( 0 ); i != powder_patterns[2].size(); ++i )
+        identical = identical && ( powder_patterns[2].intensity( i ) == powder_patterns_2[2].intensity( i ) );
+    test_suite.test_equality( identical, true, "SimulatedPowderPatternGenerator::simulate() reproducible" );
+    generator.simulate( crystal_structure, 8, powder_patterns_2, parameters_2 );
+    test_suite.test_equality( parameters[0].FWHM_ != parameters_2[0].FWHM_, true, "SimulatedPowderPatternGenerator::simulate() structures use different random numbers" );
+    }
+    // Without noise and background, a sample is the calculated pattern on the shifted 2theta grid
+    {
+    SimulatedPowderPatternGenerator clean_generator( generator );
+    clean_generator.set_PO_probability( 0.0 );
+    clean_generator.set_amorphous_total_signal( 0.0 );
+    clean_generator.set_constant_background( 0.0 );
+    clean_generator.set_highest_peak( 1000.0 );
+    clean_generator.set_add_noise( false );
+    clean_generator.set_subtract_background( false );
+    std::vector< PowderPattern > powder_patterns;
+    std::vector< SimulatedPowderPatternParameters > parameters;
+    clean_generator.simulate( crystal_structure, 0, powder_patterns, parameters );
+    const Angle zero_point_error = Angle::from_degrees( parameters[1].zero_point_error_ );
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_wavelength( clean_generator.wavelength() );
+    powder_pattern_calculator.set_two_theta_start( Angle::from_degrees( 5.0 ) - zero_point_error );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 30.0 ) - zero_point_error );
+    powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    powder_pattern_calculator.set_FWHM( parameters[1].FWHM_ );
+    PowderPattern reference;
+    powder_pattern_calculator.calculate( reference );
+    reference.normalise_highest_peak( 1000.0 );
+    bool same( reference.size() == powder_patterns[1].size() );
+    for ( size_t i( 0 ); same && ( i != reference.size() ); ++i )
+        same = nearly_equal( reference.intensity( i ), powder_patterns[1].intensity( i ), 1.0E-6 );
+    test_suite.test_equality( same, true, "SimulatedPowderPatternGenerator::simulate() zero-point error" );
+    }
+    // Shards
+    {
+    std::vector< CrystalStructure > crystal_structures( 2, crystal_structure );
+    generator.set_nthreads( 1 );
+    const FileName base_name_1( "", "test_shards_1", "pps" );
+    const size_t nshards = generator.write_shards( crystal_structures, base_name_1, 4 );
+    test_suite.test_equality( nshards, size_t( 2 ), "SimulatedPowderPatternGenerator::write_shards() number of shards" );
+    generator.set_nthreads( 3 );
+    const FileName base_name_2( "", "test_shards_2", "pps" );
+    generator.write_shards( crystal_structures, base_name_2, 4 );
+    for ( size_t s( 0 ); s != 2; ++s )
+    {
+        const FileName shard_1( "", "test_shards_1_" + size_t2string( s, 6 ), "pps" );
+        const FileName shard_2( "", "test_shards_2_" + size_t2string( s, 6 ), "pps" );
+        test_suite.test_equality( file_contents( shard_1 ) == file_contents( shard_2 ), true, "SimulatedPowderPatternGenerator::write_shards() independent of threads" );
+    }
+    std::vector< SimulatedPowderPatternParameters > parameters;
+    std::vector< float > intensities;
+    size_t npoints;
+    double wavelength;
+    double two_theta_start;
+    double two_theta_step;
+    read_pps( FileName( "", "test_shards_1_000001", "pps" ), parameters, intensities, npoints, wavelength, two_theta_start, two_theta_step );
+    test_suite.test_equality( parameters.size(), size_t( 2 ), "read_pps() number of patterns" );
+    test_suite.test_equality( npoints, generator.npoints(), "read_pps() number of points" );
+    test_suite.test_equality_double( two_theta_step, 0.02, "read_pps() 2theta step" );
+    // Patterns 4 and 5 are samples 1 and 2 of structure 1
+    test_suite.test_equality( ( parameters[1].structure_ == 1 ) && ( parameters[1].sample_ == 2 ), true, "read_pps() structure and sample" );
+    std::vector< PowderPattern > powder_patterns;
+    std::vector< SimulatedPowderPatternParameters > reference_parameters;
+    generator.simulate( crystal_structure, 1, powder_patterns, reference_parameters );
+    test_suite.test_equality_double( parameters[1].FWHM_, reference_parameters[2].FWHM_, "read_pps() FWHM" );
+    test_suite.test_equality( parameters[1].include_PO_, reference_parameters[2].include_PO_, "read_pps() PO" );
+    bool same( true );
+    for ( size_t i( 0 ); i != npoints; ++i )
+        same = same && ( intensities[ npoints + i ] == static_cast< float >( powder_patterns[2].intensity( i ) ) );
+    test_suite.test_equality( same, true, "read_pps() intensities" );
+    for ( size_t s( 0 ); s != 2; ++s )
+    {
+        std::remove( FileName( "", "test_shards_1_" + size_t2string( s, 6 ), "pps" ).full_name().c_str() );
+        std::remove( FileName( "", "test_shards_2_" + size_t2string( s, 6 ), "pps" ).full_name().c_str() );
+    }
+    }
+    // No preferred orientation for cubic lattices
+    {
+    MillerIndices PO_direction( 0, 0, 1 );
+    const CrystalLattice cubic( 5.0, 5.0, 5.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+    test_suite.test_equality( default_PO_direction( cubic, PO_direction ), false, "default_PO_direction() cubic" );
+    const CrystalLattice orthorhombic( 8.0, 5.0, 6.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+    test_suite.test_equality( default_PO_direction( orthorhombic, PO_direction ), true, "default_PO_direction() orthorhombic" );
+    test_suite.test_equality( PO_direction == MillerIndices( 0, 1, 0 ), true, "default_PO_direction() shortest axis" );
+    }
+}
+
@@ -0,0 +1,120 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SingleCrystalData.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "FileName.h"
+#include "PowderPatternCalculator.h"
+#include "SpaceGroup.h"
+#include "Utilities.h"
+
+#include "TestFixtures.h"
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+// One line of a SHELX .hkl file, (3I4,2F8.2,I4)
+std::string hkl_line( const MillerIndices & miller_indices, const double F_squared, const double sigma, const int batch )
+{
+    return int2string( miller_indices.h(), 4, ' ' ) + int2string( miller_indices.k(), 4, ' ' ) + int2string( miller_indices.l(), 4, ' ' ) +
+           double2string( F_squared, 2, 8 ) + double2string( sigma, 2, 8 ) + int2string( batch, 4, ' ' ) + "\n";
+}
+
+} // namespace
+
+void test_single_crystal_data( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for SingleCrystalData." << std::endl;
+    const CrystalStructure crystal_structure = P21c_test_structure( CrystalLattice( 7.1, 9.3, 11.7, Angle::angle_90_degrees(), Angle::from_degrees( 103.4 ), Angle::angle_90_degrees() ) );
+    const PointGroup laue_class = crystal_structure.space_group().laue_class();
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 30.0 ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    const ReflectionList calculated = powder_pattern_calculator.reflection_list();
+    double maximum( 0.0 );
+    for ( size_t i( 0 ); i != calculated.size(); ++i )
+        maximum = std::max( maximum, calculated.F_squared( i ) );
+    // Each reflection is written twice, as ( h, k, l ) and as its equivalent ( -h, k, -l ), on half the scale of the calculated F^2.
+    // HKLF 5 additionally has a reflection of the second component and an overlapping pair, which must all be skipped.
+    const double scale = 5000.0 / maximum;
+    FileName file_name( "test_single_crystal_data.hkl" );
+    {
+    std::ofstream output_file( file_name.full_name().c_str() );
+    for ( size_t i( 0 ); i != calculated.size(); ++i )
+    {
+        const MillerIndices miller_indices = calculated.miller_indices( i );
+        const double F_squared = scale * calculated.F_squared( i );
+        const double sigma = 1.0 + 0.01 * F_squared;
+        output_file << hkl_line( miller_indices, F_squared, sigma, 1 );
+        output_file << hkl_line( MillerIndices( -miller_indices.h(), miller_indices.k(), -miller_indices.l() ), F_squared, sigma, 1 );
+    }
+    output_file << hkl_line( MillerIndices( 1, 1, 1 ), 9999.0, 1.0, 2 );
+    output_file << hkl_line( MillerIndices( 1, 1, 1 ), 9999.0, 1.0, -2 );
+    output_file << hkl_line( MillerIndices( 1, 1, 1 ), 9999.0, 1.0, 1 );
+    output_file << hkl_line( MillerIndices( 0, 0, 0 ), 0.0, 0.0, 0 );
+    output_file << hkl_line( MillerIndices( 1, 1, 1 ), 9999.0, 1.0, 1 );
+    }
+    SingleCrystalData observed( file_name, crystal_structure.crystal_lattice(), laue_class, SingleCrystalData::HKLF5 );
+    test_suite.test_equality( observed.size(), calculated.size(), "SingleCrystalData 01" );
+    test_suite.test_equality( observed.nobservations(), 2 * calculated.size(), "SingleCrystalData 02" );
+    bool is_sorted( true );
+    bool d_spacings_are_correct( true );
+    for ( size_t i( 0 ); i != observed.size(); ++i )
+    {
+        if ( ( i != 0 ) && ( observed.d_spacing( i ) > observed.d_spacing( i - 1 ) ) )
+            is_sorted = false;
+        const size_t j = calculated.index( observed.miller_indices( i ) );
+        if ( ( j == calculated.size() ) || ! nearly_equal( observed.d_spacing( i ), calculated.d_spacing( j ), 1.0E-9 ) || ( observed.nmerged( i ) != 2 ) )
+            d_spacings_are_correct = false;
+    }
+    test_suite.test_equality( is_sorted, true, "SingleCrystalData 03" );
+    test_suite.test_equality( d_spacings_are_correct, true, "SingleCrystalData 04" );
+    // Two observations with the same sigma: sigma / sqrt( 2 )
+    test_suite.test_equality_double( observed.sigma_F_squared( 0 ), ( 1.0 + 0.01 * observed.F_squared( 0 ) ) / std::sqrt( 2.0 ), "SingleCrystalData 05", 0.01 );
+    // F^2 calculated for the observed reflections: only the rounding to two decimals remains
+    powder_pattern_calculator.set_reflection_list( observed.reflection_list() );
+    powder_pattern_calculator.calculate_structure_factors();
+    RFactors R_factors = calculate_R_factors( observed, powder_pattern_calculator.reflection_list() );
+    test_suite.test_equality( R_factors.nunmatched_, size_t( 0 ), "calculate_R_factors() 01" );
+    test_suite.test_equality( R_factors.nreflections_, observed.size(), "calculate_R_factors() 02" );
+    test_suite.test_equality_double( R_factors.scale_, scale, "calculate_R_factors() 03", 1.0E-4 * scale );
+    test_suite.test_equality( R_factors.wR2_ < 1.0E-4, true, "calculate_R_factors() 04" );
+    test_suite.test_equality( R_factors.R1_ < 1.0E-3, true, "calculate_R_factors() 05" );
+    // HKLF 4 keeps all reflections before the 0 0 0 line and merges them
+    SingleCrystalData observed_HKLF4( file_name, crystal_structure.crystal_lattice(), laue_class );
+    test_suite.test_equality( observed_HKLF4.nobservations(), 2 * calculated.size() + 3, "SingleCrystalData HKLF 4" );
+    std::remove( file_name.full_name().c_str() );
+}
+
@@ -0,0 +1,126 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "SkipBoTournament.h"
+#include "Xoshiro256StarStar.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// Plays like the greedy strategy and checks that no cards get lost, for single-threaded use only.
+class CheckingStrategy : public SkipBoStrategy
+{
+public:
+    CheckingStrategy(): nerrors_(0), ncalls_(0) {}
+    std::string name() const { return "checking"; }
+    SkipBoMove choose_move( const SkipBoState & state, Xoshiro256StarStar & rng ) const
+    {
+        ++ncalls_;
+        if ( state.ncards() != SKIP_BO_NCARDS )
+            ++nerrors_;
+        return greedy_.choose_move( state, rng );
+    }
+    mutable size_t nerrors_;
+    mutable size_t ncalls_;
+private:
+    SkipBoGreedyStrategy greedy_;
+};
+
+class IllegalStrategy : public SkipBoStrategy
+{
+public:
+    std::string name() const { return "illegal"; }
+    SkipBoMove choose_move( const SkipBoState &, Xoshiro256StarStar & ) const { return SkipBoMove( SkipBoMove::DISCARD, SkipBoMove::STOCK_PILE, 0, 0 ); }
+};
+
+} // namespace
+
+void test_SkipBoTournament( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for SkipBoTournament." << std::endl;
+
+    SkipBoGreedyStrategy greedy;
+    SkipBoRandomStrategy random;
+
+    {
+    Xoshiro256StarStar rng( 4 );
+    SkipBoState state;
+    deal_skip_bo( state, 4, 30, 2, rng );
+    test_suite.test_equality( state.ncards(), SKIP_BO_NCARDS, "deal_skip_bo() 01" );
+    test_suite.test_equality( state.draw_pile_size_, size_t( 162 - 4 * 30 ), "deal_skip_bo() 02" );
+    test_suite.test_equality( state.current_player_, size_t( 2 ), "deal_skip_bo() 03" );
+    }
+
+    {
+    CheckingStrategy checking;
+    std::vector< const SkipBoStrategy * > strategies;
+    strategies.push_back( &checking );
+    strategies.push_back( &random );
+    strategies.push_back( &checking );
+    bool all_finished( true );
+    for ( size_t i( 0 ); i != 20; ++i )
+    {
+        Xoshiro256StarStar rng( i + 1 );
+        size_t nturns;
+        all_finished = all_finished && ( play_skip_bo_game( strategies, 20, i % 3, rng, 10000, nturns ) <= 3 ) && ( nturns < 10000 );
+    }
+    test_suite.test_equality( all_finished, true, "play_skip_bo_game() 01" );
+    test_suite.test_equality( ( checking.ncalls_ > 100 ) && ( checking.nerrors_ == 0 ), true, "play_skip_bo_game() 02" );
+    }
+
+    {
+    std::vector< const SkipBoStrategy * > strategies;
+    strategies.push_back( &random );
+    strategies.push_back( &greedy );
+    SkipBoTournamentResult result_1 = skip_bo_tournament( strategies, 10, 600, 1359, 1 );
+    SkipBoTournamentResult result_3 = skip_bo_tournament( strategies, 10, 600, 1359, 3 );
+    test_suite.test_equality( result_1.ngames_, size_t( 600 ), "skip_bo_tournament() 01" );
+    test_suite.test_equality( ( result_1.win_rates_[1].average() == result_3.win_rates_[1].average() ) &&
+                              ( result_1.nturns_.average() == result_3.nturns_.average() ), true, "skip_bo_tournament() 02" );
+    test_suite.test_equality( result_1.win_rates_[1].average() > 0.8, true, "skip_bo_tournament() 03" );
+    test_suite.test_equality_double( result_1.win_rates_[0].average() + result_1.win_rates_[1].average() + result_1.nunfinished_games_ / 600.0, 1.0, "skip_bo_tournament() 04" );
+    }
+
+    try
+    {
+        IllegalStrategy illegal;
+        std::vector< const SkipBoStrategy * > strategies( 2, &illegal );
+        Xoshiro256StarStar rng;
+        size_t nturns;
+        play_skip_bo_game( strategies, 10, 0, rng, 100, nturns );
+        test_suite.log_error( "play_skip_bo_game() should have thrown." );
+    }
+    catch ( std::exception & e ) {}
+
+}
+
@@ -0,0 +1,118 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SmallVector.h"
+#include "MillerIndices.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <utility>
+
+void test_small_vector( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for SmallVector." << std::endl;
+
+    {
+    SmallVector< size_t, 4 > values;
+    test_suite.test_equality( values.empty(), true, "SmallVector 01" );
+    for ( size_t i( 0 ); i != 4; ++i )
+        values.push_back( 10 * i );
+    test_suite.test_equality( values.is_inline(), true, "SmallVector 02" );
+    values.push_back( 40 );
+    test_suite.test_equality( values.is_inline(), false, "SmallVector 03" );
+    test_suite.test_equality( values.size(), size_t(5), "SmallVector 04" );
+    bool correct( true );
+    for ( size_t i( 0 ); i != values.size(); ++i )
+    {
+        if ( values[i] != 10 * i )
+            correct = false;
+    }
+    test_suite.test_equality( correct, true, "SmallVector 05" );
+    // push_back() of one of its own elements while growing
+    for ( size_t i( 0 ); i != 3; ++i )
+        values.push_back( values[0] );
+    values.push_back( values.back() );
+    test_suite.test_equality( values.size(), size_t(9), "SmallVector 06" );
+    test_suite.test_equality( values.back(), size_t(0), "SmallVector 07" );
+    values.erase( std::remove( values.begin(), values.end(), size_t(0) ), values.end() );
+    test_suite.test_equality( values.size(), size_t(4), "SmallVector 08" );
+    test_suite.test_equality( values.front(), size_t(10), "SmallVector 09" );
+    }
+
+    {
+    // Copy and move, both inline and on the heap
+    SmallVector< std::string, 2 > small;
+    small.push_back( "A string that is too long for the small-string optimisation" );
+    SmallVector< std::string, 2 > large( small );
+    large.emplace_back( 3, 'x' );
+    large.push_back( large[0] );
+    SmallVector< std::string, 2 > small_copy( small );
+    SmallVector< std::string, 2 > large_copy;
+    large_copy = large;
+    SmallVector< std::string, 2 > small_moved( std::move( small_copy ) );
+    SmallVector< std::string, 2 > large_moved;
+    large_moved = std::move( large_copy );
+    test_suite.test_equality( small_copy.empty(), true, "SmallVector 10" );
+    test_suite.test_equality( large_copy.empty(), true, "SmallVector 11" );
+    test_suite.test_equality( small_moved.size(), size_t(1), "SmallVector 12" );
+    test_suite.test_equality( small_moved[0], small[0], "SmallVector 13" );
+    test_suite.test_equality( large_moved.size(), size_t(3), "SmallVector 14" );
+    test_suite.test_equality( large_moved[1], std::string( "xxx" ), "SmallVector 15" );
+    test_suite.test_equality( large_moved[2], small[0], "SmallVector 16" );
+    large_moved.pop_back();
+    large_moved.resize( 1 );
+    test_suite.test_equality( large_moved.size(), size_t(1), "SmallVector 17" );
+    bool exception_thrown( false );
+    try
+    {
+        large_moved.at( 1 );
+    }
+    catch ( std::runtime_error & )
+    {
+        exception_thrown = true;
+    }
+    test_suite.test_equality( exception_thrown, true, "SmallVector 18" );
+    }
+
+    {
+    // T without a default constructor
+    SmallVector< MillerIndices, 2 > reflections;
+    reflections.push_back( MillerIndices( 1, 0, 0 ) );
+    reflections.push_back( MillerIndices( 0, 1, 0 ) );
+    reflections.emplace_back( 1, 0, 0 );
+    std::sort( reflections.begin(), reflections.end() );
+    reflections.erase( std::unique( reflections.begin(), reflections.end() ), reflections.end() );
+    test_suite.test_equality( reflections.size(), size_t(2), "SmallVector 19" );
+    test_suite.test_equality( reflections[0], MillerIndices( 1, 0, 0 ), "SmallVector 20" );
+    }
+
+}
+
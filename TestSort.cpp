@@ -29,7 +29,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "TestSuite.h"
 
+#include <algorithm>
 #include <iostream>
+#include <string>
+#include <vector>
 
 void test_sort( TestSuite & test_suite )
 {
@@ -70,6 +73,44 @@ void test_sort( TestSuite & test_suite )
     test_suite.test_equality( objects[ sorted_map[ 7 ] ], -1,  "Sort() 17" );
     test_suite.test_equality( objects[ sorted_map[ 8 ] ], -5,  "Sort() 18" );
     }
+    // argsort() and parallel_argsort() against std::stable_sort() on the indices, with many ties, -0.0 and both radix-sorted key types
+    {
+    std::vector< double > doubles;
+    std::vector< size_t > size_ts;
+    for ( size_t i( 0 ); i != 30011; ++i )
+    {
+        const size_t j = ( 7919 * i ) % 2003;
+        doubles.push_back( ( j % 5 == 0 ) ? -0.0 : ( static_cast< double >( j ) - 1000.0 ) * 0.37 );
+        size_ts.push_back( j % 499 );
+    }
+    std::vector< size_t > expected( doubles.size() );
+    for ( size_t i( 0 ); i != expected.size(); ++i )
+        expected[i] = i;
+    std::stable_sort( expected.begin(), expected.end(), [&doubles]( const size_t lhs, const size_t rhs ) { return doubles[rhs] < doubles[lhs]; } );
+    test_suite.test_equality( argsort< true >( doubles ), expected, "argsort() 01" );
+    test_suite.test_equality( parallel_argsort< true >( doubles, 3 ), expected, "parallel_argsort() 01" );
+    for ( size_t i( 0 ); i != expected.size(); ++i )
+        expected[i] = i;
+    std::stable_sort( expected.begin(), expected.end(), [&size_ts]( const size_t lhs, const size_t rhs ) { return size_ts[lhs] < size_ts[rhs]; } );
+    test_suite.test_equality( argsort< false >( size_ts ), expected, "argsort() 02" );
+    test_suite.test_equality( parallel_argsort< false >( size_ts, 4 ), expected, "parallel_argsort() 02" );
+    const std::vector< double > short_list( doubles.begin(), doubles.begin() + 100 );
+    test_suite.test_equality( argsort< false >( short_list ), sort( short_list ), "argsort() 03" );
+    test_suite.test_equality( argsort< false >( std::vector< double >() ).empty(), true, "argsort() 04" );
+    }
+    {
+    std::vector< std::string > strings;
+    strings.push_back( "b" );
+    strings.push_back( "a" );
+    strings.push_back( "b" );
+    strings.push_back( "c" );
+    std::vector< size_t > expected;
+    expected.push_back( 3 );
+    expected.push_back( 0 );
+    expected.push_back( 2 );
+    expected.push_back( 1 );
+    test_suite.test_equality( argsort< true >( strings ), expected, "argsort() 05" );
+    }
 
 }
 
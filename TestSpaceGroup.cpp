@@ -0,0 +1,130 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "SpaceGroup.h"
+#include "PointGroup.h"
+#include "SpaceGroupTables.h"
+#include "SymmetryOperator.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+void test_space_group( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for SpaceGroup." << std::endl;
+    {
+    SpaceGroup space_group = SpaceGroup::from_number( 14 );
+    test_suite.test_equality( space_group.name(), std::string( "P21/c" ), "SpaceGroup::from_number() 01" );
+    test_suite.test_equality( same_symmetry_operators( space_group, SpaceGroup::P21c() ), true, "SpaceGroup::from_number() 02" );
+    test_suite.test_equality( space_group.has_inversion_at_origin(), true, "SpaceGroup::from_number() 03" );
+    }
+    {
+    SpaceGroup space_group = SpaceGroup::from_number( 225 );
+    test_suite.test_equality( space_group.centring_vectors().size(), size_t( 3 ), "SpaceGroup::centring_vectors() 01" );
+    test_suite.test_equality( space_group.representative_symmetry_operators().size(), size_t( 24 ), "SpaceGroup::representative_symmetry_operators() 01" );
+    test_suite.test_equality( space_group.point_group().has_inversion(), true, "SpaceGroup::point_group() 01" );
+    // Cached
+    test_suite.test_equality( &space_group.laue_class(), &space_group.laue_class(), "SpaceGroup::laue_class() 01" );
+    space_group = SpaceGroup::from_number( 19 );
+    test_suite.test_equality( space_group.point_group().nsymmetry_operators(), size_t( 4 ), "SpaceGroup::point_group() 02" );
+    test_suite.test_equality( space_group.laue_class().nsymmetry_operators(), size_t( 8 ), "SpaceGroup::laue_class() 02" );
+    space_group.add_inversion_at_origin();
+    test_suite.test_equality( space_group.point_group().nsymmetry_operators(), size_t( 8 ), "SpaceGroup::point_group() 03" );
+    }
+    {
+    // The origin shift of P3112 puts the two-fold axes at z = 1/3
+    SpaceGroup space_group = SpaceGroup::from_number( 151 );
+    bool found( false );
+    for ( size_t i( 0 ); i != space_group.nsymmetry_operators(); ++i )
+    {
+        if ( nearly_equal( space_group.symmetry_operator( i ), SymmetryOperator( "-y,-x,-z+2/3" ) ) )
+            found = true;
+    }
+    test_suite.test_equality( found, true, "SpaceGroup::from_Hall_symbol() 01" );
+    }
+    {
+    SpaceGroup space_group = SpaceGroup::from_Hall_symbol( "-P 2ac 2n" );
+    test_suite.test_equality( space_group.nsymmetry_operators(), size_t( 8 ), "SpaceGroup::from_Hall_symbol() 02" );
+    test_suite.test_equality( space_group.crystal_system(), std::string( "orthorhombic" ), "SpaceGroup::from_Hall_symbol() 03" );
+    const char * invalid[] = { "", "Q 2", "P 5", "P 2 2 (0 0", "P 2y 2q", "-P 3*1" };
+    for ( size_t i( 0 ); i != sizeof( invalid ) / sizeof( invalid[0] ); ++i )
+    {
+        bool thrown( false );
+        try
+        {
+            SpaceGroup::from_Hall_symbol( invalid[i] );
+        }
+        catch ( std::exception & )
+        {
+            thrown = true;
+        }
+        if ( ! thrown )
+            test_suite.log_error( "SpaceGroup::from_Hall_symbol() invalid: " + std::string( invalid[i] ) );
+    }
+    }
+    // All 230 space groups must have the right number of symmetry operators, point group and crystal system
+    for ( size_t number( 1 ); number != 231; ++number )
+    {
+        const SpaceGroupData & data = space_group_data( number );
+        const PointGroupData & point_group = point_group_data( number );
+        size_t ncentring_vectors( 1 );
+        switch ( data.Hall[ ( data.Hall[0] == '-' ) ? 1 : 0 ] )
+        {
+            case 'A' :
+            case 'B' :
+            case 'C' :
+            case 'I' : ncentring_vectors = 2; break;
+            case 'R' : ncentring_vectors = 3; break;
+            case 'F' : ncentring_vectors = 4; break;
+        }
+        SpaceGroup space_group = SpaceGroup::from_number( number );
+        if ( space_group.nsymmetry_operators() != point_group.order * ncentring_vectors )
+            test_suite.log_error( "SpaceGroup::from_number() number of symmetry operators " + size_t2string( number ) );
+        if ( space_group.point_group().nsymmetry_operators() != point_group.order )
+            test_suite.log_error( "SpaceGroup::from_number() point group " + size_t2string( number ) );
+        if ( space_group.laue_class().nsymmetry_operators() != laue_class_data( number ).order )
+            test_suite.log_error( "SpaceGroup::from_number() Laue class " + size_t2string( number ) );
+        if ( space_group.crystal_system() != point_group.crystal_system )
+            test_suite.log_error( "SpaceGroup::from_number() crystal system " + size_t2string( number ) );
+    }
+    bool thrown( false );
+    try
+    {
+        SpaceGroup::from_number( 231 );
+    }
+    catch ( std::exception & )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "SpaceGroup::from_number() 04" );
+}
+
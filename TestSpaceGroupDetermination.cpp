@@ -0,0 +1,135 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+
+#include "SpaceGroupDetermination.h"
+#include "3DCalculations.h"
+#include "MillerIndices.h"
+#include "ReflectionList.h"
+#include "SpaceGroup.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <vector>
+
+namespace
+{
+
+// All reflections up to |h|, |k|, |l| = 6 that are unique under the Laue class of laue_space_group, with F^2 of about 100-600 units
+// unless they are absent in true_space_group, in which case F^2 is a small "noise" value.
+ReflectionList test_reflection_list( const CrystalLattice & crystal_lattice, const SpaceGroup & laue_space_group, const SpaceGroup & true_space_group )
+{
+    ReflectionList result;
+    std::set< std::uint64_t > seen;
+    for ( int h( -6 ); h <= 6; ++h )
+    {
+        for ( int k( -6 ); k <= 6; ++k )
+        {
+            for ( int l( -6 ); l <= 6; ++l )
+            {
+                if ( ( h == 0 ) && ( k == 0 ) && ( l == 0 ) )
+                    continue;
+                const MillerIndices representative = Laue_class_representative( MillerIndices( h, k, l ), laue_space_group.laue_class() );
+                if ( ! seen.insert( packed_miller_indices( representative ) ).second )
+                    continue;
+                const double noise = ( ( 7 * h + 11 * k + 5 * l + 100 ) % 9 ) - 4.0;
+                const double F_squared = true_space_group.is_systematic_absence( representative ) ? noise : 100.0 + 50.0 * ( ( 3 * h + 5 * k + 7 * l + 100 ) % 11 );
+                const double d_spacing = 1.0 / reciprocal_lattice_point( representative, crystal_lattice ).length();
+                result.push_back( representative, F_squared, d_spacing, 1 );
+            }
+        }
+    }
+    return result;
+}
+
+bool contains( const ExtinctionGroup & extinction_group, const std::string & name )
+{
+    return std::find( extinction_group.space_group_names_.begin(), extinction_group.space_group_names_.end(), name ) != extinction_group.space_group_names_.end();
+}
+
+} // namespace
+
+void test_space_group_determination( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for SpaceGroupDetermination." << std::endl;
+    {
+        const CrystalLattice crystal_lattice( 7.1, 8.3, 9.2, Angle::angle_90_degrees(), Angle::from_degrees( 97.0 ), Angle::angle_90_degrees() );
+        const ReflectionList reflection_list = test_reflection_list( crystal_lattice, SpaceGroup::P21c(), SpaceGroup::P21c() );
+        const SpaceGroupDetermination space_group_determination( reflection_list, CrystalLattice::MONOCLINIC );
+        // 13 monoclinic space groups in three cell choices
+        test_suite.test_equality( space_group_determination.ncandidates(), size_t( 39 ), "SpaceGroupDetermination::ncandidates() monoclinic" );
+        const std::vector< ExtinctionGroup > extinction_groups = space_group_determination.determine();
+        test_suite.test_equality( extinction_groups.size(), space_group_determination.nextinction_groups(), "SpaceGroupDetermination::determine() size" );
+        if ( ! contains( extinction_groups[0], "P21/c" ) )
+            test_suite.log_error( "SpaceGroupDetermination::determine() P21/c" );
+        if ( ! ( extinction_groups[0].probability_ > 0.9 ) )
+            test_suite.log_error( "SpaceGroupDetermination::determine() P21/c probability" );
+        test_suite.test_equality( extinction_groups[0].nviolations_, size_t( 0 ), "SpaceGroupDetermination::determine() P21/c violations" );
+        // P2/m, P2 and Pm have no absences at all and are therefore one extinction group
+        for ( size_t i( 0 ); i != extinction_groups.size(); ++i )
+        {
+            if ( contains( extinction_groups[i], "P2/m" ) && ! ( contains( extinction_groups[i], "P2" ) && contains( extinction_groups[i], "Pm" ) ) )
+                test_suite.log_error( "SpaceGroupDetermination::determine() P2/m" );
+        }
+    }
+    {
+        // P21/n is P21/c in cell choice 2
+        const CrystalLattice crystal_lattice( 7.1, 8.3, 9.2, Angle::angle_90_degrees(), Angle::from_degrees( 97.0 ), Angle::angle_90_degrees() );
+        const SpaceGroup P21n = SpaceGroup::from_Hall_symbol( "-P 2yn" );
+        const ReflectionList reflection_list = test_reflection_list( crystal_lattice, P21n, P21n );
+        const std::vector< ExtinctionGroup > extinction_groups = SpaceGroupDetermination( reflection_list, CrystalLattice::MONOCLINIC ).determine();
+        if ( ! contains( extinction_groups[0], "P21/c (cell choice 2)" ) )
+            test_suite.log_error( "SpaceGroupDetermination::determine() P21/n" );
+    }
+    {
+        // Pnma and Pn21a (Pna21 with the axes permuted) have the same absences
+        const CrystalLattice crystal_lattice( 5.1, 7.3, 9.7, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+        const SpaceGroup Pnma = SpaceGroup::from_number( 62 );
+        const ReflectionList reflection_list = test_reflection_list( crystal_lattice, Pnma, Pnma );
+        const SpaceGroupDetermination space_group_determination( reflection_list, CrystalLattice::ORTHORHOMBIC );
+        test_suite.test_equality( space_group_determination.ncandidates(), size_t( 6 * 59 ), "SpaceGroupDetermination::ncandidates() orthorhombic" );
+        const std::vector< ExtinctionGroup > extinction_groups = space_group_determination.determine();
+        if ( ! contains( extinction_groups[0], "Pnma" ) )
+            test_suite.log_error( "SpaceGroupDetermination::determine() Pnma" );
+        bool has_Pna21( false );
+        for ( size_t i( 0 ); i != extinction_groups[0].space_group_names_.size(); ++i )
+        {
+            if ( extinction_groups[0].space_group_names_[i].substr( 0, 5 ) == "Pna21" )
+                has_Pna21 = true;
+        }
+        if ( ! has_Pna21 )
+            test_suite.log_error( "SpaceGroupDetermination::determine() Pn21a" );
+        double sum( 0.0 );
+        for ( size_t i( 0 ); i != extinction_groups.size(); ++i )
+            sum += extinction_groups[i].probability_;
+        test_suite.test_equality_double( sum, 1.0, "SpaceGroupDetermination::determine() sum of probabilities" );
+    }
+}
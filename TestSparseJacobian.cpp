@@ -0,0 +1,87 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SparseJacobian.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+void test_sparse_jacobian( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for SparseJacobian." << std::endl;
+    SparseJacobian jacobian( 5 );
+    std::vector< size_t > rows;
+    std::vector< double > values;
+    rows.push_back( 1 );
+    values.push_back( 2.0 );
+    rows.push_back( 3 );
+    values.push_back( -1.0 );
+    jacobian.append_column( rows, values );
+    jacobian.append_column( std::vector< size_t >(), std::vector< double >() );
+    rows.clear();
+    values.clear();
+    rows.push_back( 0 );
+    values.push_back( 4.0 );
+    rows.push_back( 4 );
+    values.push_back( 0.5 );
+    jacobian.append_column( rows, values );
+    test_suite.test_equality( jacobian.nrows(), size_t( 5 ), "SparseJacobian::nrows()" );
+    test_suite.test_equality( jacobian.ncolumns(), size_t( 3 ), "SparseJacobian::ncolumns()" );
+    test_suite.test_equality( jacobian.nnonzero(), size_t( 4 ), "SparseJacobian::nnonzero()" );
+    test_suite.test_equality( jacobian.column_size( 1 ), size_t( 0 ), "SparseJacobian::column_size()" );
+    test_suite.test_equality( jacobian.row( 2, 1 ), size_t( 4 ), "SparseJacobian::row()" );
+    test_suite.test_equality_double( jacobian.value( 3, 0 ), -1.0, "SparseJacobian::value() 01" );
+    test_suite.test_equality_double( jacobian.value( 2, 0 ),  0.0, "SparseJacobian::value() 02" );
+    test_suite.test_equality_double( jacobian.value( 4, 2 ),  0.5, "SparseJacobian::value() 03" );
+    std::vector< double > column = jacobian.column( 0 );
+    test_suite.test_equality( column.size(), size_t( 5 ), "SparseJacobian::column() 01" );
+    test_suite.test_equality_double( column[1], 2.0, "SparseJacobian::column() 02" );
+    std::vector< double > v( 5, 1.0 );
+    v[4] = 2.0;
+    std::vector< double > result = jacobian.transpose_times( v );
+    test_suite.test_equality_double( result[0], 1.0, "SparseJacobian::transpose_times() 01" );
+    test_suite.test_equality_double( result[1], 0.0, "SparseJacobian::transpose_times() 02" );
+    test_suite.test_equality_double( result[2], 5.0, "SparseJacobian::transpose_times() 03" );
+    bool thrown( false );
+    try
+    {
+        rows.clear();
+        rows.push_back( 2 );
+        rows.push_back( 2 );
+        values.assign( 2, 1.0 );
+        jacobian.append_column( rows, values );
+    }
+    catch ( std::exception & e )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "SparseJacobian::append_column() rows not increasing" );
+}
+
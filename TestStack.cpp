@@ -30,14 +30,59 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TestSuite.h"
 
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 void test_Stack( TestSuite & test_suite )
 {
     std::cout << "Now running tests for Stack." << std::endl;
 
     {
-  //  Stack dummy();
-  //  test_suite.test_equality( dummy, , "Stack()" );
+    Stack< size_t, 2 > stack;
+    test_suite.test_equality( stack.empty(), true, "Stack 01" );
+    for ( size_t i( 0 ); i != 5; ++i )
+        stack.push( i );
+    test_suite.test_equality( stack.stack_pointer(), size_t(5), "Stack 02" );
+    test_suite.test_equality( stack.peek(), size_t(4), "Stack 03" );
+    bool correct( true );
+    for ( size_t i( 5 ); i != 0; --i )
+    {
+        if ( stack.pop() != i-1 )
+            correct = false;
+    }
+    test_suite.test_equality( correct, true, "Stack 04" );
+    test_suite.test_equality( stack.empty(), true, "Stack 05" );
+    bool exception_thrown( false );
+    try
+    {
+        stack.pop();
+    }
+    catch ( std::runtime_error & )
+    {
+        exception_thrown = true;
+    }
+    test_suite.test_equality( exception_thrown, true, "Stack 06" );
+    }
+
+    {
+    // push() moves from an rvalue, pop() hands the object back
+    Stack< std::vector< double > > stack;
+    std::vector< double > state( 1000, 1.0 );
+    const double * storage = state.data();
+    stack.push( std::move( state ) );
+    std::vector< double > restored = stack.pop();
+    test_suite.test_equality( restored.size(), size_t(1000), "Stack 07" );
+    test_suite.test_equality( restored.data() == storage, true, "Stack 08" );
+    }
+
+    {
+    Stack< std::string > stack;
+    const std::string value( "A string that is too long for the small-string optimisation" );
+    stack.push( value );
+    stack.push( value + "2" );
+    test_suite.test_equality( stack.pop(), value + "2", "Stack 09" );
+    test_suite.test_equality( stack.pop(), value, "Stack 10" );
     }
 
 }
@@ -0,0 +1,122 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "StructureDescriptors.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+#include "PhysicalConstants.h"
+#include "SpaceGroup.h"
+#include "TextFileReader_2.h"
+#include "VoidsFinder.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// One carbon monoxide molecule in the asymmetric unit, with charges
+CrystalStructure carbon_monoxide( const bool centrosymmetric )
+{
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 8.0, 9.0, 10.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    if ( centrosymmetric )
+    {
+        SpaceGroup space_group;
+        space_group.add_inversion_at_origin();
+        crystal_structure.set_space_group( space_group );
+    }
+    Atom atom_C( Element( "C" ), Vector3D( 0.2, 0.3, 0.4 ), "C1" );
+    atom_C.set_charge( 0.5 );
+    crystal_structure.add_atom( atom_C );
+    Atom atom_O( Element( "O" ), Vector3D( 0.2 + 1.13 / 8.0, 0.3, 0.4 ), "O1" );
+    atom_O.set_charge( -0.5 );
+    crystal_structure.add_atom( atom_O );
+    return crystal_structure;
+}
+
+} // namespace
+
+void test_structure_descriptors( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for StructureDescriptors." << std::endl;
+    {
+    const CrystalStructure crystal_structure = carbon_monoxide( false );
+    const StructureDescriptors descriptors( crystal_structure, 0.0 );
+    test_suite.test_equality_double( descriptors.volume(), 720.0, "StructureDescriptors::volume()" );
+    test_suite.test_equality_double( descriptors.density(), ( ( 12.011 + 15.999 ) / 720.0 ) / ( Avogadros_constant / 1.0E24 ), "StructureDescriptors::density() 01", 0.001 );
+    test_suite.test_equality( descriptors.formula(), std::string( "CO" ), "StructureDescriptors::formula() 01" );
+    test_suite.test_equality( descriptors.Z(), size_t( 1 ), "StructureDescriptors::Z() 01" );
+    test_suite.test_equality_double( descriptors.Z_prime(), 1.0, "StructureDescriptors::Z_prime() 01" );
+    test_suite.test_equality_double( descriptors.dipole_moment(), 0.5 * 1.13, "StructureDescriptors::dipole_moment() 01" );
+    test_suite.test_equality_double( descriptors.packing_coefficient(), 0.0, "StructureDescriptors::packing_coefficient() 01" );
+    }
+    {
+    CrystalStructure crystal_structure = carbon_monoxide( true );
+    const StructureDescriptors descriptors( crystal_structure, 0.2 );
+    crystal_structure.apply_space_group_symmetry();
+    test_suite.test_equality_double( descriptors.density(), crystal_structure.density(), "StructureDescriptors::density() 02" );
+    test_suite.test_equality( descriptors.formula(), std::string( "CO" ), "StructureDescriptors::formula() 02" );
+    test_suite.test_equality( descriptors.Z(), size_t( 2 ), "StructureDescriptors::Z() 02" );
+    test_suite.test_equality_double( descriptors.Z_prime(), 1.0, "StructureDescriptors::Z_prime() 02" );
+    // The two molecules are related by the inversion centre, so their dipole moments cancel
+    test_suite.test_equality_double( descriptors.dipole_moment(), 0.0, "StructureDescriptors::dipole_moment() 02" );
+    test_suite.test_equality_double( descriptors.packing_coefficient(), ( 720.0 - void_volume( crystal_structure, 0.2 ) ) / 720.0, "StructureDescriptors::packing_coefficient() 02" );
+    test_suite.test_equality_double( descriptors.void_fraction(), find_voids( crystal_structure, 1.2, 0.2 ) / 720.0, "StructureDescriptors::void_fraction()" );
+    test_suite.test_equality( ( 0.0 < descriptors.packing_coefficient() ) && ( descriptors.packing_coefficient() + descriptors.void_fraction() < 1.0 ), true, "StructureDescriptors::packing_coefficient() 03" );
+    }
+    {
+    std::vector< FileName > file_names;
+    file_names.push_back( FileName( "", "test_structure_descriptors_0", "cif" ) );
+    file_names.push_back( FileName( "", "test_structure_descriptors_does_not_exist", "cif" ) );
+    file_names.push_back( FileName( "", "test_structure_descriptors_2", "cif" ) );
+    carbon_monoxide( false ).save_cif( file_names[0] );
+    carbon_monoxide( true ).save_cif( file_names[2] );
+    const FileList file_list( file_names );
+    std::vector< std::string > error_messages;
+    const std::vector< StructureDescriptors > descriptors = calculate_structure_descriptors( file_list, error_messages, 0.0, 2 );
+    test_suite.test_equality( descriptors.size(), size_t( 3 ), "calculate_structure_descriptors() 01" );
+    test_suite.test_equality( error_messages[0].empty() && ( ! error_messages[1].empty() ) && error_messages[2].empty(), true, "calculate_structure_descriptors() 02" );
+    test_suite.test_equality( descriptors[2].Z(), size_t( 2 ), "calculate_structure_descriptors() 03" );
+    const FileName csv_file_name( "", "test_structure_descriptors", "csv" );
+    write_structure_descriptors_csv( csv_file_name, file_list, descriptors, error_messages );
+    TextFileReader_2 text_file_reader( csv_file_name );
+    test_suite.test_equality( text_file_reader.size(), size_t( 3 ), "write_structure_descriptors_csv() 01" );
+    test_suite.test_equality( text_file_reader.line( 0 ), "file," + StructureDescriptors::csv_header(), "write_structure_descriptors_csv() 02" );
+    test_suite.test_equality( text_file_reader.line( 2 ).substr( 0, 31 ), std::string( "test_structure_descriptors_2.ci" ), "write_structure_descriptors_csv() 03" );
+    std::remove( csv_file_name.full_name().c_str() );
+    std::remove( file_names[0].full_name().c_str() );
+    std::remove( file_names[2].full_name().c_str() );
+    }
+}
+
@@ -25,20 +25,155 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "SudokuBacktrackingSolver.h"
+#include "SudokuBenchmark.h"
+#include "SudokuGenerator.h"
 #include "SudokuSolver.h"
+#include "Sudoku.h"
 
+#include "RandomNumberGenerator.h"
 #include "TestSuite.h"
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 void test_SudokuSolver( TestSuite & test_suite )
 {
     std::cout << "Now running tests for SudokuSolver." << std::endl;
 
     {
- //   SudokuSolver dummy();
- //   test_suite.test_equality( dummy, , "SudokuSolver()" );
+    // Needs guessing
+    std::vector< std::string > sudoku_string;
+    sudoku_string.push_back( "200000008" );
+    sudoku_string.push_back( "053020970" );
+    sudoku_string.push_back( "070090030" );
+    sudoku_string.push_back( "000007010" );
+    sudoku_string.push_back( "700000004" );
+    sudoku_string.push_back( "080600000" );
+    sudoku_string.push_back( "020070050" );
+    sudoku_string.push_back( "031050890" );
+    sudoku_string.push_back( "500000002" );
+    Sudoku solved_sudoku = solve( Sudoku( sudoku_string ) );
+    std::string solution;
+    for ( size_t i( 0 ); i != solved_sudoku.nsquares(); ++i )
+        solution += static_cast<char>( '0' + solved_sudoku.square( i ).value() );
+    test_suite.test_equality( solution, std::string( "219763548853421976476598231392847615765912384184635729928176453631254897547389162" ), "solve() 01" );
     }
 
-}
+    {
+    std::vector< std::string > sudoku_string;
+    sudoku_string.push_back( "200000008" );
+    sudoku_string.push_back( "053020970" );
+    sudoku_string.push_back( "070090030" );
+    sudoku_string.push_back( "000007010" );
+    sudoku_string.push_back( "700000004" );
+    sudoku_string.push_back( "080600000" );
+    sudoku_string.push_back( "020070050" );
+    sudoku_string.push_back( "031050890" );
+    sudoku_string.push_back( "500000002" );
+    Sudoku sudoku( sudoku_string );
+    const std::string solution( "219763548853421976476598231392847615765912384184635729928176453631254897547389162" );
+    test_suite.test_equality( Sudoku2string( solve_by_backtracking( sudoku ) ), solution, "solve_by_backtracking() 01" );
+    test_suite.test_equality( count_solutions( sudoku ), size_t( 1 ), "count_solutions() 01" );
+    std::vector< Sudoku > sudokus( 5, sudoku );
+    std::vector< Sudoku > solutions = solve_by_backtracking( sudokus, 2 );
+    bool all_correct( solutions.size() == 5 );
+    for ( size_t i( 0 ); i != solutions.size(); ++i )
+        all_correct = all_correct && ( Sudoku2string( solutions[i] ) == solution );
+    test_suite.test_equality( all_correct, true, "solve_by_backtracking() 02" );
+    // Two givens removed: no longer unique
+    sudoku_string[0] = "000000008";
+    sudoku_string[8] = "000000002";
+    test_suite.test_equality( count_solutions( Sudoku( sudoku_string ), 1000 ) > 1, true, "count_solutions() 02" );
+    }
+
+    {
+    std::vector< std::string > sudoku_string( 9, "000000000" );
+    Sudoku sudoku( sudoku_string );
+    test_suite.test_equality( count_solutions( sudoku, 10 ), size_t( 10 ), "count_solutions() 03" );
+    std::vector< Sudoku > solutions = enumerate_solutions( sudoku, 3 );
+    test_suite.test_equality( solutions.size(), size_t( 3 ), "enumerate_solutions() 01" );
+    test_suite.test_equality( count_solutions( solutions[2] ), size_t( 1 ), "enumerate_solutions() 02" );
+    test_suite.test_equality( ( solutions[0].solved() && solutions[1].solved() && ( Sudoku2string( solutions[0] ) != Sudoku2string( solutions[1] ) ) ), true, "enumerate_solutions() 03" );
+    }
+
+    {
+    const std::string input( "2.......8.53.2.97..7..9..3......7.1.7.......4.8.6......2..7..5..31.5.89.5.......2" );
+    // The constructor of Sudoku already fills in some of the squares, so compare with a Sudoku constructed as well
+    test_suite.test_equality( Sudoku2string( string2Sudoku( input ) ), Sudoku2string( string2Sudoku( "200000008053020970070090030000007010700000004080600000020070050031050890500000002" ) ), "string2Sudoku() 01" );
+    std::vector< Sudoku > sudokus = benchmark_sudokus();
+    test_suite.test_equality( sudokus.size(), size_t( 11 ), "benchmark_sudokus() 01" );
+    SudokuBenchmarkResult result = benchmark( sudokus, BACKTRACKING, 3 );
+    test_suite.test_equality( result.nsudokus(), size_t( 11 ), "benchmark() 01" );
+    test_suite.test_equality( result.nthreads_, size_t( 3 ), "benchmark() 02" );
+    test_suite.test_equality( Sudoku2string( result.solutions_[3] ), std::string( "219763548853421976476598231392847615765912384184635729928176453631254897547389162" ), "benchmark() 03" );
+    test_suite.test_equality( ( result.latency_percentile( 0.0 ) <= result.latency_percentile( 50.0 ) ) &&
+                              ( result.latency_percentile( 50.0 ) <= result.latency_percentile( 100.0 ) ), true, "benchmark() 04" );
+    // The propagation rules are too slow for the hardest puzzles to be part of the tests
+    sudokus.resize( 4 );
+    SudokuBenchmarkResult result_2 = benchmark( sudokus, PROPAGATION_RULES, 2 );
+    bool all_equal( true );
+    for ( size_t i( 0 ); i != sudokus.size(); ++i )
+        all_equal = all_equal && ( Sudoku2string( result_2.solutions_[i] ) == Sudoku2string( result.solutions_[i] ) );
+    test_suite.test_equality( all_equal, true, "benchmark() 05" );
+    result.latencies_.clear();
+    for ( size_t i( 0 ); i != 10; ++i )
+        result.latencies_.push_back( i + 1.0 );
+    test_suite.test_equality_double( result.latency_percentile( 50.0 ), 5.0, "latency_percentile() 01" );
+    test_suite.test_equality_double( result.latency_percentile( 91.0 ), 10.0, "latency_percentile() 02" );
+    test_suite.test_equality_double( result.latency_percentile( 0.0 ), 1.0, "latency_percentile() 03" );
+    }
+
+    {
+    // Easy, needs only the rules within one slice
+    test_suite.test_equality( number_of_rules_needed( string2Sudoku( "900428000486000209302090854108000730009374010007850090820000906090006107060189000" ) ), size_t( 1 ), "number_of_rules_needed() 01" );
+    test_suite.test_equality( number_of_rules_needed( string2Sudoku( "200000008053020970070090030000007010700000004080600000020070050031050890500000002" ) ), size_t( 3 ), "number_of_rules_needed() 02" );
+    // Needs guessing
+    test_suite.test_equality( number_of_rules_needed( string2Sudoku( "800000000003600000070090200050007000000045700000100030001000068008500010090000400" ) ), size_t( 5 ), "number_of_rules_needed() 03" );
+    }
+
+    {
+    RandomNumberGenerator_integer random_number_generator( 17, PHILOX4X32 );
+    const std::string grid = random_complete_grid( random_number_generator );
+    test_suite.test_equality( grid.find( '0' ) == std::string::npos, true, "random_complete_grid() 01" );
+    test_suite.test_equality( Sudoku2string( solve_by_backtracking( string2Sudoku( grid ) ) ), grid, "random_complete_grid() 02" );
+    const std::string puzzle = remove_clues( grid, random_number_generator );
+    test_suite.test_equality( count_solutions( string2Sudoku( puzzle ) ), size_t( 1 ), "remove_clues() 01" );
+    // Minimal: removing any one of the remaining clues gives more than one solution
+    bool is_minimal( true );
+    for ( size_t i( 0 ); i != 81; ++i )
+    {
+        if ( puzzle[i] == '0' )
+            continue;
+        std::string one_less( puzzle );
+        one_less[i] = '0';
+        is_minimal = is_minimal && ( count_solutions( string2Sudoku( one_less ) ) == 2 );
+    }
+    test_suite.test_equality( is_minimal, true, "remove_clues() 02" );
+    SudokuGenerator generator;
+    generator.set_seed( 5 );
+    generator.set_nthreads( 1 );
+    const std::vector< GeneratedSudoku > generated = generator.generate( 4 );
+    bool all_correct( generated.size() == 4 );
+    for ( size_t i( 0 ); i != generated.size(); ++i )
+    {
+        all_correct = all_correct && ( count_solutions( string2Sudoku( generated[i].puzzle_ ) ) == 1 ) &&
+                                     ( Sudoku2string( solve_by_backtracking( string2Sudoku( generated[i].puzzle_ ) ) ) == generated[i].solution_ ) &&
+                                     ( generated[i].difficulty_ == number_of_rules_needed( string2Sudoku( generated[i].puzzle_ ) ) );
+    }
+    test_suite.test_equality( all_correct, true, "SudokuGenerator::generate() 01" );
+    // Independent random number streams: the same puzzles on more threads
+    generator.set_nthreads( 3 );
+    const std::vector< GeneratedSudoku > generated_2 = generator.generate( 4 );
+    bool all_equal( generated_2.size() == 4 );
+    for ( size_t i( 0 ); i != generated_2.size(); ++i )
+        all_equal = all_equal && ( generated_2[i].puzzle_ == generated[i].puzzle_ );
+    test_suite.test_equality( all_equal, true, "SudokuGenerator::generate() 02" );
+    test_suite.test_equality( generated[0].puzzle_ != generated[1].puzzle_, true, "SudokuGenerator::generate() 03" );
+    generator.set_target_difficulty( 5 );
+    const std::vector< GeneratedSudoku > generated_3 = generator.generate( 2 );
+    test_suite.test_equality( ( generated_3[0].difficulty_ == 5 ) && ( generated_3[1].difficulty_ == 5 ), true, "SudokuGenerator::generate() 04" );
+    }
 
+}
@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TestSuite.h"
 
 #include <iostream>
+#include <sstream>
 
 void TestSuite::report() const
 {
@@ -35,3 +36,12 @@ void TestSuite::report() const
         std::cout << *it << std::endl;
 }
 
+void TestSuite::check_timing( const double seconds, const double maximum_seconds, const std::string & error_message )
+{
+    if ( seconds <= maximum_seconds )
+        return;
+    std::ostringstream message;
+    message << error_message << ": took " << seconds << " s, limit is " << maximum_seconds << " s";
+    error_messages_.push_back( message.str() );
+}
+
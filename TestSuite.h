@@ -28,6 +28,8 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "Benchmark.h"
+
 #include <vector>
 #include <string>
 #include <cmath>
@@ -41,7 +43,7 @@ class TestSuite
 {
 public:
 
-    TestSuite() {}
+    TestSuite(): check_timings_(true) {}
 
     template< class T >
     void test_equality( const T & lhs, const T & rhs, const std::string & error_message )
@@ -60,11 +62,31 @@ public:
     {
         error_messages_.push_back( error_message );
     }
+
+    // Performance assertion: logs an error if the median wall time of job() over nrepetitions runs (after one warm-up run)
+    // exceeds maximum_seconds. Limits should be a few times what a slow machine needs, so that only real regressions trip them.
+    template< class Job >
+    void test_timing( Job job, const double maximum_seconds, const std::string & error_message, const size_t nrepetitions = 5 )
+    {
+        if ( check_timings_ )
+            check_timing( run_benchmark( error_message, 0, job, nrepetitions, 1 ).median(), maximum_seconds, error_message );
+    }
+
+    // Off for e.g. debug or sanitiser builds, where the performance assertions are meaningless.
+    void set_check_timings( const bool check_timings ) { check_timings_ = check_timings; }
+
+    size_t nerrors() const { return error_messages_.size(); }
+
+    // Appends the errors of another test suite, e.g. one that ran on another thread.
+    void append( const TestSuite & other ) { error_messages_.insert( error_messages_.end(), other.error_messages_.begin(), other.error_messages_.end() ); }
     
     void report() const;
 
 private:
     std::vector< std::string > error_messages_;
+    bool check_timings_;
+
+    void check_timing( const double seconds, const double maximum_seconds, const std::string & error_message );
 };
 
 #endif // TESTSUITE_H
@@ -0,0 +1,98 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "SymmetryOperator.h"
+#include "Matrix3D.h"
+#include "Vector3D.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+void test_symmetry_operator( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for SymmetryOperator." << std::endl;
+    {
+    SymmetryOperator symmetry_operator( "0.5+x, -y -1/2, Z" );
+    test_suite.test_equality( symmetry_operator.rotation(), Matrix3D( 1.0, 0.0, 0.0, 0.0, -1.0, 0.0, 0.0, 0.0, 1.0 ), "SymmetryOperator( std::string ) 01" );
+    if ( ! nearly_equal( symmetry_operator.translation(), Vector3D( 0.5, 0.5, 0.0 ) ) )
+        test_suite.log_error( "SymmetryOperator( std::string ) 02" );
+    test_suite.test_equality( symmetry_operator.to_string(), std::string( "x+1/2,-y+1/2,z" ), "SymmetryOperator( std::string ) 03" );
+    }
+    {
+    SymmetryOperator symmetry_operator( "-z+1/4,x+y+z+1/4,-x+1/4" );
+    test_suite.test_equality( symmetry_operator.rotation(), Matrix3D( 0.0, 0.0, -1.0, 1.0, 1.0, 1.0, -1.0, 0.0, 0.0 ), "SymmetryOperator( std::string ) 04" );
+    if ( ! nearly_equal( symmetry_operator.translation(), Vector3D( 0.25, 0.25, 0.25 ) ) )
+        test_suite.log_error( "SymmetryOperator( std::string ) 05" );
+    }
+    {
+    SymmetryOperator symmetry_operator( "y-x,-x+2/3,z+1/6" );
+    test_suite.test_equality( symmetry_operator.rotation(), Matrix3D( -1.0, 1.0, 0.0, -1.0, 0.0, 0.0, 0.0, 0.0, 1.0 ), "SymmetryOperator( std::string ) 06" );
+    if ( ! nearly_equal( symmetry_operator.translation(), Vector3D( 0.0, 2.0/3.0, 1.0/6.0 ) ) )
+        test_suite.log_error( "SymmetryOperator( std::string ) 07" );
+    }
+    {
+    const char * invalid[] = { "x,y", "x,,z", "x,y,z,", "2x,y,z", "x+,y,z", "x,y,z+1/", "x,y,z+1/0", "x,x-x,z", "x,y,a", "x y,y,z", "x,y,z,x" };
+    for ( size_t i( 0 ); i != sizeof( invalid ) / sizeof( invalid[0] ); ++i )
+    {
+        bool thrown( false );
+        try
+        {
+            SymmetryOperator symmetry_operator( invalid[i] );
+        }
+        catch ( std::exception & )
+        {
+            thrown = true;
+        }
+        if ( ! thrown )
+            test_suite.log_error( "SymmetryOperator( std::string ) invalid: " + std::string( invalid[i] ) );
+    }
+    }
+    {
+    SymmetryOperator symmetry_operator_1 = cached_symmetry_operator( "-x,1/2+y,1/2-z" );
+    SymmetryOperator symmetry_operator_2 = cached_symmetry_operator( " -X, 1/2+Y, 1/2-Z" );
+    SymmetryOperator symmetry_operator_3( "-x,1/2+y,1/2-z" );
+    if ( ! nearly_equal( symmetry_operator_1, symmetry_operator_3 ) )
+        test_suite.log_error( "cached_symmetry_operator() 01" );
+    if ( ! nearly_equal( symmetry_operator_2, symmetry_operator_3 ) )
+        test_suite.log_error( "cached_symmetry_operator() 02" );
+    bool thrown( false );
+    try
+    {
+        cached_symmetry_operator( "x,y" );
+    }
+    catch ( std::exception & )
+    {
+        thrown = true;
+    }
+    test_suite.test_equality( thrown, true, "cached_symmetry_operator() 03" );
+    }
+}
+
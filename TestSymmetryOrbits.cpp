@@ -0,0 +1,112 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "SymmetryOrbits.h"
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "SpaceGroup.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+CrystalStructure P_1_structure()
+{
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 10.0, 10.0, 10.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ) );
+    SpaceGroup space_group;
+    space_group.add_inversion_at_origin();
+    crystal_structure.set_space_group( space_group );
+    return crystal_structure;
+}
+
+} // namespace
+
+void test_symmetry_orbits( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for SymmetryOrbits." << std::endl;
+    {
+    // One atom on a general position, one on the inversion centre
+    CrystalStructure crystal_structure = P_1_structure();
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.1, 0.2, 0.3 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "N" ), Vector3D( 0.0, 1.0, 0.0 ), "N1" ) );
+    SymmetryOrbits symmetry_orbits_1( crystal_structure );
+    test_suite.test_equality( symmetry_orbits_1.norbits(), static_cast<size_t>(2), "SymmetryOrbits 01" );
+    test_suite.test_equality( symmetry_orbits_1.image( 0, 1 ), static_cast<size_t>(2), "SymmetryOrbits 02" );
+    test_suite.test_equality( symmetry_orbits_1.image( 1, 1 ), static_cast<size_t>(1), "SymmetryOrbits 03" );
+    crystal_structure.apply_space_group_symmetry();
+    test_suite.test_equality( crystal_structure.natoms(), static_cast<size_t>(3), "SymmetryOrbits 04" );
+    SymmetryOrbits symmetry_orbits_2( crystal_structure );
+    test_suite.test_equality( symmetry_orbits_2.norbits(), static_cast<size_t>(2), "SymmetryOrbits 05" );
+    test_suite.test_equality( symmetry_orbits_2.image( 0, 1 ), static_cast<size_t>(2), "SymmetryOrbits 06" );
+    test_suite.test_equality( symmetry_orbits_2.image( 2, 1 ), static_cast<size_t>(0), "SymmetryOrbits 07" );
+    test_suite.test_equality( symmetry_orbits_2.orbit( 2 ), static_cast<size_t>(0), "SymmetryOrbits 08" );
+    test_suite.test_equality( symmetry_orbits_2.site_stabiliser_order( 0 ), static_cast<size_t>(1), "SymmetryOrbits 09" );
+    test_suite.test_equality( symmetry_orbits_2.site_stabiliser_order( 1 ), static_cast<size_t>(2), "SymmetryOrbits 10" );
+    test_suite.test_equality( symmetry_orbits_2.multiplicity( 0 ), static_cast<size_t>(2), "SymmetryOrbits 11" );
+    test_suite.test_equality( symmetry_orbits_2.multiplicity( 1 ), static_cast<size_t>(1), "SymmetryOrbits 12" );
+    std::vector< size_t > asymmetric_unit = symmetry_orbits_2.asymmetric_unit();
+    test_suite.test_equality( asymmetric_unit.size(), static_cast<size_t>(2), "SymmetryOrbits 13" );
+    test_suite.test_equality( asymmetric_unit[1], static_cast<size_t>(1), "SymmetryOrbits 14" );
+    // A duplicated atom is removed as well
+    crystal_structure.add_atom( Atom( Element( "N" ), Vector3D( 0.0, 0.0, 0.00005 ), "N2" ) );
+    crystal_structure.reduce_to_asymmetric_unit();
+    test_suite.test_equality( crystal_structure.natoms(), static_cast<size_t>(2), "SymmetryOrbits 15" );
+    }
+    {
+    // A C2 dumbbell on the inversion centre and an isolated atom on a general position
+    CrystalStructure crystal_structure = P_1_structure();
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.07, 0.0, 0.0 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 0.3, 0.3, 0.3 ), "O1" ) );
+    crystal_structure.perceive_molecules();
+    test_suite.test_equality( crystal_structure.nmolecules(), static_cast<size_t>(3), "SymmetryOrbits 16" );
+    SymmetryOrbits symmetry_orbits( crystal_structure );
+    test_suite.test_equality( symmetry_orbits.nmolecule_orbits(), static_cast<size_t>(2), "SymmetryOrbits 17" );
+    test_suite.test_equality_double( symmetry_orbits.Z_prime(), 1.5, "SymmetryOrbits 18" );
+    test_suite.test_equality_double( crystal_structure.Z_prime(), 1.5, "SymmetryOrbits 19" );
+    size_t nspecial( 0 );
+    for ( size_t i( 0 ); i != crystal_structure.nmolecules(); ++i )
+    {
+        if ( crystal_structure.molecule_is_on_special_position( i ) )
+        {
+            ++nspecial;
+            test_suite.test_equality( crystal_structure.molecule_in_crystal( i ).natoms(), static_cast<size_t>(2), "SymmetryOrbits 20" );
+        }
+    }
+    test_suite.test_equality( nspecial, static_cast<size_t>(1), "SymmetryOrbits 21" );
+    crystal_structure.remove_symmetry_related_molecules();
+    test_suite.test_equality( crystal_structure.nmolecules(), static_cast<size_t>(2), "SymmetryOrbits 22" );
+    test_suite.test_equality( crystal_structure.natoms(), static_cast<size_t>(3), "SymmetryOrbits 23" );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+        test_suite.test_equality( crystal_structure.molecule_in_crystal( crystal_structure.molecule_index( i ) ).natoms(), ( crystal_structure.atom( i ).element() == Element( "O" ) ) ? static_cast<size_t>(1) : static_cast<size_t>(2), "SymmetryOrbits 24" );
+    }
+}
+
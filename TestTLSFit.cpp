@@ -0,0 +1,172 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "TLSFit.h"
+#include "Eigenvalue.h"
+#include "RandomNumberGenerator.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+
+Matrix3D to_Matrix3D( const SymmetricMatrix3D & input )
+{
+    return Matrix3D( input.value( 0, 0 ), input.value( 0, 1 ), input.value( 0, 2 ),
+                     input.value( 1, 0 ), input.value( 1, 1 ), input.value( 1, 2 ),
+                     input.value( 2, 0 ), input.value( 2, 1 ), input.value( 2, 2 ) );
+}
+
+// U = T + A L A^T + A S + S^T A^T, calculated with 3 x 3 matrices.
+SymmetricMatrix3D U_from_TLS( const SymmetricMatrix3D & T, const SymmetricMatrix3D & L, const Matrix3D & S, const Vector3D & r )
+{
+    const Matrix3D A(    0.0,  r.z(), -r.y(),
+                      -r.z(),    0.0,  r.x(),
+                       r.y(), -r.x(),    0.0 );
+    const Matrix3D U = to_Matrix3D( T ) + A * to_Matrix3D( L ) * transpose( A ) + A * S + transpose( S ) * transpose( A );
+    return SymmetricMatrix3D( U.value( 0, 0 ), U.value( 1, 1 ), U.value( 2, 2 ), U.value( 0, 1 ), U.value( 0, 2 ), U.value( 1, 2 ) );
+}
+
+double random_number( RandomNumberGenerator_double & random_number_generator, const double range )
+{
+    return range * ( 2.0 * random_number_generator.next_number() - 1.0 );
+}
+
+// A rigid body with exact TLS ADPs, the positions are centred on the origin so that S is that of the centroid.
+TLSRigidBody random_rigid_body( RandomNumberGenerator_double & random_number_generator, const size_t natoms, SymmetricMatrix3D & T, SymmetricMatrix3D & L, Matrix3D & S )
+{
+    T = SymmetricMatrix3D( 0.03 + random_number( random_number_generator, 0.01 ), 0.03 + random_number( random_number_generator, 0.01 ), 0.03 + random_number( random_number_generator, 0.01 ),
+                           random_number( random_number_generator, 0.005 ), random_number( random_number_generator, 0.005 ), random_number( random_number_generator, 0.005 ) );
+    L = SymmetricMatrix3D( 0.002 + random_number( random_number_generator, 0.001 ), 0.004 + random_number( random_number_generator, 0.001 ), 0.006 + random_number( random_number_generator, 0.001 ),
+                           random_number( random_number_generator, 0.0005 ), random_number( random_number_generator, 0.0005 ), random_number( random_number_generator, 0.0005 ) );
+    S = Matrix3D( random_number( random_number_generator, 0.001 ), random_number( random_number_generator, 0.001 ), random_number( random_number_generator, 0.001 ),
+                  random_number( random_number_generator, 0.001 ), random_number( random_number_generator, 0.001 ), random_number( random_number_generator, 0.001 ),
+                  random_number( random_number_generator, 0.001 ), random_number( random_number_generator, 0.001 ), 0.0 );
+    S.set_value( 2, 2, -S.value( 0, 0 ) - S.value( 1, 1 ) );
+    TLSRigidBody result;
+    Vector3D centroid;
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        result.positions_.push_back( Vector3D( random_number( random_number_generator, 4.0 ), random_number( random_number_generator, 3.0 ), random_number( random_number_generator, 2.0 ) ) );
+        centroid += result.positions_.back();
+    }
+    centroid /= natoms;
+    // Shifted away from the origin, the fit must use the centroid
+    const Vector3D shift( 10.0, -5.0, 3.0 );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        result.positions_[i] -= centroid;
+        result.U_carts_.push_back( U_from_TLS( T, L, S, result.positions_[i] ) );
+        result.positions_[i] += shift;
+    }
+    return result;
+}
+
+} // namespace
+
+void test_TLS_fit( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for TLSFit." << std::endl;
+    RandomNumberGenerator_double random_number_generator;
+    {
+    SymmetricMatrix3D T;
+    SymmetricMatrix3D L;
+    Matrix3D S;
+    const TLSRigidBody rigid_body = random_rigid_body( random_number_generator, 12, T, L, S );
+    const TLSTensors tensors = fit_TLS( rigid_body );
+    test_suite.test_equality( tensors.determined_, true, "fit_TLS() determined" );
+    test_suite.test_equality( nearly_equal( tensors.origin_, Vector3D( 10.0, -5.0, 3.0 ) ), true, "fit_TLS() origin" );
+    test_suite.test_equality( nearly_equal( tensors.T_, T, 1.0E-10 ), true, "fit_TLS() T" );
+    test_suite.test_equality( nearly_equal( tensors.L_, L, 1.0E-10 ), true, "fit_TLS() L" );
+    test_suite.test_equality( nearly_equal( tensors.S_, S, 1.0E-10 ), true, "fit_TLS() S" );
+    test_suite.test_equality_double( tensors.R_, 0.0, "fit_TLS() R", 1.0E-8 );
+    test_suite.test_equality( nearly_equal( TLS_U_cart( tensors, rigid_body.positions_[3] ), rigid_body.U_carts_[3], 1.0E-10 ), true, "TLS_U_cart()" );
+    std::vector< double > eigenvalues;
+    std::vector< NormalisedVector3D > eigenvectors;
+    calculate_eigenvalues( L, eigenvalues, eigenvectors );
+    for ( size_t k( 0 ); k != 3; ++k )
+        test_suite.test_equality_double( tensors.libration_eigenvalues_[k], eigenvalues[k], "fit_TLS() libration eigenvalues", 1.0E-10 );
+    // Noise on the ADPs
+    TLSRigidBody noisy( rigid_body );
+    for ( size_t i( 0 ); i != noisy.U_carts_.size(); ++i )
+        noisy.U_carts_[i] += SymmetricMatrix3D( random_number( random_number_generator, 0.002 ), random_number( random_number_generator, 0.002 ), random_number( random_number_generator, 0.002 ), 0.0, 0.0, 0.0 );
+    const TLSTensors noisy_tensors = fit_TLS( noisy );
+    test_suite.test_equality( ( noisy_tensors.R_ > 0.001 ) && ( noisy_tensors.R_ < 0.1 ), true, "fit_TLS() R with noise" );
+    }
+    // Too few atoms, and all atoms on one line
+    {
+    SymmetricMatrix3D T;
+    SymmetricMatrix3D L;
+    Matrix3D S;
+    test_suite.test_equality( fit_TLS( random_rigid_body( random_number_generator, 3, T, L, S ) ).determined_, false, "fit_TLS() three atoms" );
+    TLSRigidBody linear;
+    for ( size_t i( 0 ); i != 6; ++i )
+    {
+        linear.positions_.push_back( Vector3D( 1.2 * i, 0.0, 0.0 ) );
+        linear.U_carts_.push_back( SymmetricMatrix3D( 0.03 ) );
+    }
+    test_suite.test_equality( fit_TLS( linear ).determined_, false, "fit_TLS() linear" );
+    }
+    // Batch
+    {
+    std::vector< TLSRigidBody > rigid_bodies;
+    std::vector< SymmetricMatrix3D > Ls;
+    for ( size_t i( 0 ); i != 50; ++i )
+    {
+        SymmetricMatrix3D T;
+        SymmetricMatrix3D L;
+        Matrix3D S;
+        rigid_bodies.push_back( random_rigid_body( random_number_generator, ( i == 7 ) ? 2 : 5 + i % 20, T, L, S ) );
+        Ls.push_back( L );
+    }
+    const std::vector< TLSTensors > tensors = fit_TLS( rigid_bodies, 3 );
+    test_suite.test_equality( tensors.size(), rigid_bodies.size(), "fit_TLS() batch size" );
+    test_suite.test_equality( tensors[7].determined_, false, "fit_TLS() batch undetermined" );
+    bool all_correct( true );
+    for ( size_t i( 0 ); i != tensors.size(); ++i )
+    {
+        if ( i == 7 )
+            continue;
+        const TLSTensors single = fit_TLS( rigid_bodies[i] );
+        if ( ( ! tensors[i].determined_ ) || ( ! nearly_equal( tensors[i].L_, Ls[i], 1.0E-10 ) ) || ( ! ( tensors[i].T_ == single.T_ ) ) )
+            all_correct = false;
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            if ( std::abs( tensors[i].libration_eigenvalues_[k] - single.libration_eigenvalues_[k] ) > 1.0E-12 )
+                all_correct = false;
+            // The sign of an eigenvector is arbitrary
+            if ( std::abs( std::abs( tensors[i].libration_axes_[k] * single.libration_axes_[k] ) - 1.0 ) > 1.0E-8 )
+                all_correct = false;
+        }
+    }
+    test_suite.test_equality( all_correct, true, "fit_TLS() batch" );
+    }
+}
+
@@ -30,7 +30,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "3DCalculations.h"
 #include "AnisotropicDisplacementParameters.h"
 #include "CrystalLattice.h"
+#include "Matrix3D.h"
 #include "MathFunctions.h"
+#include "Utilities.h"
 
 #include <iostream>
 
@@ -64,5 +66,90 @@ void test_TLS_ADPs( TestSuite & test_suite )
         test_suite.test_equality_double( mu2_v, 0.00693478, "mu2_v" );
     }
 
+    // Conversions and their batch versions
+    {
+        CrystalLattice crystal_lattice( 7.1, 9.3, 11.7, Angle::from_degrees( 81.0 ), Angle::from_degrees( 104.5 ), Angle::from_degrees( 95.2 ) );
+        std::vector< SymmetricMatrix3D > U_carts;
+        U_carts.push_back( SymmetricMatrix3D( 0.0468, 0.0240, 0.0594, 0.0026, -0.0074, -0.0017 ) );
+        U_carts.push_back( SymmetricMatrix3D( 0.0210, 0.0335, 0.0187, -0.0041, 0.0012, 0.0063 ) );
+        std::vector< double > packed;
+        for ( size_t i( 0 ); i != U_carts.size(); ++i )
+        {
+            packed.push_back( U_carts[i].value( 0, 0 ) );
+            packed.push_back( U_carts[i].value( 1, 1 ) );
+            packed.push_back( U_carts[i].value( 2, 2 ) );
+            packed.push_back( U_carts[i].value( 0, 1 ) );
+            packed.push_back( U_carts[i].value( 0, 2 ) );
+            packed.push_back( U_carts[i].value( 1, 2 ) );
+        }
+        Matrix3D rotation( 0.0, -1.0, 0.0,
+                           1.0, -1.0, 0.0,
+                           0.0,  0.0, 1.0 );
+        std::vector< double > U_cifs;
+        U_cart_2_U_cif( packed, crystal_lattice, U_cifs );
+        std::vector< double > U_stars;
+        U_cart_2_U_star( packed, crystal_lattice, U_stars );
+        std::vector< double > rotated;
+        rotate_adps( packed, rotation, crystal_lattice, rotated );
+        std::vector< double > round_trip( U_cifs );
+        U_cif_2_U_star( round_trip, crystal_lattice, round_trip );
+        U_star_2_U_cif( round_trip, crystal_lattice, round_trip );
+        U_cif_2_U_cart( round_trip, crystal_lattice, round_trip );
+        bool all_ok( true );
+        for ( size_t i( 0 ); i != U_carts.size(); ++i )
+        {
+            AnisotropicDisplacementParameters ADPs( U_carts[i] );
+            // Reference values using the definitions with full matrices
+            Matrix3D U_star_reference = crystal_lattice.orthogonal_to_fractional_matrix() * U_carts[i] * transpose( crystal_lattice.orthogonal_to_fractional_matrix() );
+            SymmetricMatrix3D N( 1.0 / crystal_lattice.a_star(), 1.0 / crystal_lattice.b_star(), 1.0 / crystal_lattice.c_star(), 0.0, 0.0, 0.0 );
+            Matrix3D U_cif_reference = N * U_star_reference * N;
+            Matrix3D rotated_reference = crystal_lattice.fractional_to_orthogonal_matrix() * rotation * U_star_reference * transpose( rotation ) * transpose( crystal_lattice.fractional_to_orthogonal_matrix() );
+            if ( ! nearly_equal( ADPs.U_star( crystal_lattice ), Matrix3D2SymmetricMatrix3D( U_star_reference ), 1.0e-12 ) )
+                all_ok = false;
+            if ( ! nearly_equal( ADPs.U_cif( crystal_lattice ), Matrix3D2SymmetricMatrix3D( U_cif_reference ), 1.0e-12 ) )
+                all_ok = false;
+            if ( ! nearly_equal( rotate_adps( ADPs, rotation, crystal_lattice ).U_cart(), Matrix3D2SymmetricMatrix3D( rotated_reference ), 1.0e-12 ) )
+                all_ok = false;
+            for ( size_t k( 0 ); k != 3; ++k )
+            {
+                for ( size_t l( k ); l != 3; ++l )
+                {
+                    size_t j = ( k == l ) ? k : k + l + 2; // 01 -> 3, 02 -> 4, 12 -> 5
+                    if ( ! nearly_equal( U_stars[6*i+j], U_star_reference.value( k, l ), 1.0e-12 ) )
+                        all_ok = false;
+                    if ( ! nearly_equal( U_cifs[6*i+j], U_cif_reference.value( k, l ), 1.0e-12 ) )
+                        all_ok = false;
+                    if ( ! nearly_equal( rotated[6*i+j], rotated_reference.value( k, l ), 1.0e-12 ) )
+                        all_ok = false;
+                    if ( ! nearly_equal( round_trip[6*i+j], U_carts[i].value( k, l ), 1.0e-12 ) )
+                        all_ok = false;
+                }
+            }
+        }
+        test_suite.test_equality( all_ok, true, "Batch ADP conversions" );
+    }
+    // transform_adps(): transforming the ADPs with the unit cell must leave U_cart unchanged
+    {
+        CrystalLattice crystal_lattice( 5.3, 8.1, 12.2, Angle::angle_90_degrees(), Angle::from_degrees( 98.3 ), Angle::angle_90_degrees() );
+        SymmetricMatrix3D U_cart( 0.0468, 0.0240, 0.0594, 0.0026, -0.0074, -0.0017 );
+        Matrix3D transformation_matrix( 1.0, 0.0, 1.0,
+                                        0.0, 1.0, 0.0,
+                                       -1.0, 0.0, 0.0 );
+        CrystalLattice new_crystal_lattice( crystal_lattice );
+        new_crystal_lattice.transform( transformation_matrix );
+        SymmetricMatrix3D U_cif_new = transform_adps( U_cart_2_U_cif( U_cart, crystal_lattice ), transformation_matrix, crystal_lattice );
+        // The new lattice is set up with a along x again, so U_cart is rotated
+        Matrix3D rotation = new_crystal_lattice.fractional_to_orthogonal_matrix() * transpose( inverse( transformation_matrix ) ) * crystal_lattice.orthogonal_to_fractional_matrix();
+        SymmetricMatrix3D U_cart_new = Matrix3D2SymmetricMatrix3D( rotation * U_cart * transpose( rotation ) );
+        test_suite.test_equality( nearly_equal( U_cif_2_U_cart( U_cif_new, new_crystal_lattice ), U_cart_new, 1.0e-10 ), true, "transform_adps() 01" );
+        std::vector< double > U_cifs( 12, 0.0 );
+        SymmetricMatrix3D U_cif = U_cart_2_U_cif( U_cart, crystal_lattice );
+        U_cifs[6] = U_cif.value( 0, 0 ); U_cifs[7] = U_cif.value( 1, 1 ); U_cifs[8] = U_cif.value( 2, 2 );
+        U_cifs[9] = U_cif.value( 0, 1 ); U_cifs[10] = U_cif.value( 0, 2 ); U_cifs[11] = U_cif.value( 1, 2 );
+        transform_adps( U_cifs, transformation_matrix, crystal_lattice, U_cifs );
+        SymmetricMatrix3D U_cif_batch( U_cifs[6], U_cifs[7], U_cifs[8], U_cifs[9], U_cifs[10], U_cifs[11] );
+        test_suite.test_equality( nearly_equal( U_cif_batch, U_cif_new, 1.0e-14 ) && ( U_cifs[0] == 0.0 ), true, "transform_adps() 02" );
+    }
+
 }
 
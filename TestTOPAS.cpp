@@ -0,0 +1,85 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "TOPAS.h"
+#include "CrystalLattice.h"
+#include "FileName.h"
+#include "TextFileReader_2.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+void test_TOPAS( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for TOPAS." << std::endl;
+    FileName file_name( "", "test_TOPAS", "inp" );
+    {
+    std::ofstream output_file( file_name.full_name().c_str(), std::ios::binary );
+    output_file << "prm centx 0.5 ' prm !centx 9.0\n"
+                   "  prm  !centy   0.25`_0.01  VV\n"
+                   "prm centx 1.5\n"
+                   "prm !centx 2.5\n"
+                   "   a  8.5\n"
+                   "   b @ 9.5`_0.001\n"
+                   "   c  10.5\n"
+                   "   al 90\n"
+                   "   be 100.5\n"
+                   "   ga 90\n";
+    }
+    TextFileReader_2 text_file_reader( file_name );
+    TOPASInputFile input_file( text_file_reader );
+    test_suite.test_equality( input_file.size(), size_t( 10 ), "TOPASInputFile::size()" );
+    test_suite.test_equality( input_file.ntokens( 0 ), size_t( 3 ), "TOPASInputFile::ntokens()" );
+    test_suite.test_equality( input_file.find( "centx" ).size(), size_t( 2 ), "TOPASInputFile::find() 1" );
+    test_suite.test_equality( input_file.find( "VV" )[0].line_, size_t( 1 ), "TOPASInputFile::find() 2" );
+    test_suite.test_equality( input_file.find( "VV" )[0].token_, size_t( 3 ), "TOPASInputFile::find() 3" );
+    test_suite.test_equality( input_file.find( "9.0" ).empty(), true, "TOPASInputFile::find() 4" );
+    // The fixed parameter takes precedence
+    test_suite.test_equality_double( read_keyword( "centx", input_file ), 2.5, "read_keyword() 1" );
+    test_suite.test_equality_double( read_keyword( "centy", text_file_reader ), 0.25, "read_keyword() 2" );
+    test_suite.test_equality( input_file.has_prm( "centz" ), false, "TOPASInputFile::has_prm()" );
+    try
+    {
+        input_file.prm( "centz" );
+        test_suite.log_error( "TOPASInputFile::prm() should have thrown." );
+    }
+    catch ( std::exception & e ) {}
+    CrystalLattice crystal_lattice = read_lattice_parameters( input_file );
+    test_suite.test_equality_double( crystal_lattice.b(), 9.5, "read_lattice_parameters() 1" );
+    test_suite.test_equality_double( crystal_lattice.beta().value_in_degrees(), 100.5, "read_lattice_parameters() 2" );
+    input_file.set_prm( "centy", 0.75 );
+    test_suite.test_equality( input_file.line( 1 ), std::string( "  prm  !centy   0.75  VV" ), "TOPASInputFile::set_prm() 1" );
+    test_suite.test_equality_double( input_file.prm( "centy" ), 0.75, "TOPASInputFile::set_prm() 2" );
+    test_suite.test_equality( input_file.token( 1, 3 ), std::string( "VV" ), "TOPASInputFile::set_prm() 3" );
+    std::remove( file_name.full_name().c_str() );
+}
+
@@ -0,0 +1,66 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "TextFileReader_2.h"
+#include "FileName.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+void test_text_file_reader_2( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for TextFileReader_2." << std::endl;
+    FileName file_name( "", "test_text_file_reader_2", "txt" );
+    {
+    std::ofstream output_file( file_name.full_name().c_str(), std::ios::binary );
+    output_file << "first line\r\n\r\nr_wp 12.5\r\nprm rwp_2 1\nlast line without newline";
+    }
+    TextFileReader_2 text_file_reader( file_name );
+    test_suite.test_equality( text_file_reader.size(), size_t( 5 ), "TextFileReader_2::size()" );
+    test_suite.test_equality( text_file_reader.line( 0 ), std::string( "first line" ), "TextFileReader_2::line() 0" );
+    test_suite.test_equality( text_file_reader.line( 1 ), std::string( "" ), "TextFileReader_2::line() 1" );
+    test_suite.test_equality( text_file_reader.line( 4 ), std::string( "last line without newline" ), "TextFileReader_2::line() 4" );
+    test_suite.test_equality( text_file_reader.line_length( 2 ), size_t( 9 ), "TextFileReader_2::line_length()" );
+    test_suite.test_equality( std::string( text_file_reader.line_begin( 3 ), text_file_reader.line_end( 3 ) ), std::string( "prm rwp_2 1" ), "TextFileReader_2::line_begin()" );
+    test_suite.test_equality( text_file_reader.find( "line" ), size_t( 0 ), "TextFileReader_2::find() 1" );
+    test_suite.test_equality( text_file_reader.find( "line", 1 ), size_t( 4 ), "TextFileReader_2::find() 2" );
+    test_suite.test_equality( text_file_reader.find( "line\nr" ), std::string::npos, "TextFileReader_2::find() 3" );
+    test_suite.test_equality( text_file_reader.find( "" ), std::string::npos, "TextFileReader_2::find() 4" );
+    test_suite.test_equality( text_file_reader.find( "rwp" ), size_t( 3 ), "TextFileReader_2::find() 5" );
+    test_suite.test_equality( text_file_reader.find_whole_word( "rwp" ), std::string::npos, "TextFileReader_2::find_whole_word() 1" );
+    test_suite.test_equality( text_file_reader.find_whole_word( "r_wp" ), size_t( 2 ), "TextFileReader_2::find_whole_word() 2" );
+    test_suite.test_equality( text_file_reader.find_whole_word( "newline" ), size_t( 4 ), "TextFileReader_2::find_whole_word() 3" );
+    test_suite.test_equality( text_file_reader.find_whole_word( "first" ), size_t( 0 ), "TextFileReader_2::find_whole_word() 4" );
+    test_suite.test_equality( text_file_reader.find_whole_word( "line", 1 ), size_t( 4 ), "TextFileReader_2::find_whole_word() 5" );
+    std::remove( file_name.full_name().c_str() );
+}
+
@@ -0,0 +1,182 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ThreadPool.h"
+#include "ParallelFor.h"
+
+#include "TestSuite.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+void test_thread_pool( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for ThreadPool." << std::endl;
+
+    test_suite.test_equality( available_cpus() >= 1, true, "available_cpus()" );
+    test_suite.test_equality( max_concurrency() >= 1, true, "max_concurrency()" );
+    {
+    ThreadPool thread_pool( 3 );
+    test_suite.test_equality( thread_pool.nworkers(), size_t( 3 ), "ThreadPool::nworkers()" );
+    std::atomic< size_t > sum( 0 );
+    TaskGroup task_group( thread_pool );
+    for ( size_t i( 1 ); i <= 100; ++i )
+        task_group.run( [&sum, i]() { sum += i; } );
+    task_group.wait();
+    test_suite.test_equality( sum.load(), size_t( 5050 ), "TaskGroup::wait() 01" );
+    // Tasks that start tasks and wait for them
+    sum = 0;
+    for ( size_t i( 0 ); i != 10; ++i )
+    {
+        task_group.run( [&]()
+        {
+            TaskGroup inner_task_group( thread_pool );
+            for ( size_t j( 1 ); j <= 10; ++j )
+                inner_task_group.run( [&sum, j]() { sum += j; } );
+            inner_task_group.wait();
+        } );
+    }
+    task_group.wait();
+    test_suite.test_equality( sum.load(), size_t( 550 ), "TaskGroup::wait() 02" );
+    task_group.run( []() { throw std::runtime_error( "test" ); } );
+    bool has_thrown( false );
+    try
+    {
+        task_group.wait();
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "TaskGroup::wait() 03" );
+    }
+    {
+    // Without workers the waiting thread runs the tasks
+    ThreadPool thread_pool( 0 );
+    size_t sum( 0 );
+    TaskGroup task_group( thread_pool );
+    for ( size_t i( 1 ); i <= 10; ++i )
+        task_group.run( [&sum, i]() { sum += i; } );
+    task_group.wait();
+    test_suite.test_equality( sum, size_t( 55 ), "ThreadPool( 0 )" );
+    }
+    {
+    std::vector< size_t > counts( 1000, 0 );
+    parallel_for( counts.size(), 4, [&]( const size_t i ) { ++counts[i]; }, 7 );
+    size_t nwrong( 0 );
+    for ( size_t i( 0 ); i != counts.size(); ++i )
+    {
+        if ( counts[i] != 1 )
+            ++nwrong;
+    }
+    test_suite.test_equality( nwrong, size_t( 0 ), "parallel_for() grain_size" );
+    // Nested
+    std::atomic< size_t > sum( 0 );
+    parallel_for( 10, 0, [&]( const size_t )
+    {
+        parallel_for( 100, 0, [&]( const size_t j ) { sum += j; } );
+    } );
+    test_suite.test_equality( sum.load(), size_t( 49500 ), "parallel_for() nested" );
+    }
+    {
+    std::vector< double > values( 10000 );
+    for ( size_t i( 0 ); i != values.size(); ++i )
+        values[i] = 1.0 / ( i + 1.0 );
+    const double serial_sum = parallel_reduce( values.size(), 1, 64, 0.0, [&]( const size_t i ) { return values[i]; }, std::plus< double >() );
+    const double parallel_sum = parallel_reduce( values.size(), 4, 64, 0.0, [&]( const size_t i ) { return values[i]; }, std::plus< double >() );
+    test_suite.test_equality( serial_sum == parallel_sum, true, "parallel_reduce() 01" );
+    test_suite.test_equality_double( parallel_sum, 9.787606036044, "parallel_reduce() 02" );
+    const size_t maximum = parallel_reduce( size_t( 1000 ), 0, 10, size_t( 0 ), []( const size_t i ) { return ( i * 37 ) % 1000; },
+                                            []( const size_t a, const size_t b ) { return std::max( a, b ); } );
+    test_suite.test_equality( maximum, size_t( 999 ), "parallel_reduce() 03" );
+    }
+    {
+    // A diamond: 0 -> 1, 0 -> 2, 1 -> 3, 2 -> 3
+    std::mutex mutex;
+    std::vector< size_t > order;
+    TaskGraph task_graph;
+    for ( size_t i( 0 ); i != 4; ++i )
+        task_graph.add_task( [&, i]() { std::lock_guard< std::mutex > lock( mutex ); order.push_back( i ); } );
+    task_graph.add_dependency( 0, 1 );
+    task_graph.add_dependency( 0, 2 );
+    task_graph.add_dependency( 1, 3 );
+    task_graph.add_dependency( 2, 3 );
+    task_graph.run();
+    test_suite.test_equality( order.size(), size_t( 4 ), "TaskGraph::run() 01" );
+    test_suite.test_equality( ( order[0] == 0 ) && ( order[3] == 3 ), true, "TaskGraph::run() 02" );
+    order.clear();
+    task_graph.run();
+    test_suite.test_equality( order.size(), size_t( 4 ), "TaskGraph::run() 03" );
+    // A task that throws: the task that depends on it is not run
+    order.clear();
+    const size_t failing_task = task_graph.add_task( []() { throw std::runtime_error( "test" ); } );
+    const size_t skipped_task = task_graph.add_task( [&]() { std::lock_guard< std::mutex > lock( mutex ); order.push_back( 99 ); } );
+    task_graph.add_dependency( failing_task, skipped_task );
+    bool has_thrown( false );
+    try
+    {
+        task_graph.run();
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "TaskGraph::run() 04" );
+    test_suite.test_equality( std::find( order.begin(), order.end(), size_t( 99 ) ) == order.end(), true, "TaskGraph::run() 05" );
+    // A cycle
+    task_graph.add_dependency( 3, 0 );
+    has_thrown = false;
+    try
+    {
+        task_graph.run();
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "TaskGraph::run() 06" );
+    }
+    {
+    // The global pool is in use by now
+    bool has_thrown( false );
+    try
+    {
+        set_max_concurrency( 2 );
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "set_max_concurrency()" );
+    }
+}
+
@@ -0,0 +1,100 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "TimeCorrelation.h"
+#include "Utilities.h"
+#include "Vector3D.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+std::vector< double > direct_autocorrelation_function( const std::vector< double > & signal )
+{
+    std::vector< double > result( signal.size(), 0.0 );
+    for ( size_t tau( 0 ); tau != signal.size(); ++tau )
+    {
+        for ( size_t t( 0 ); t + tau < signal.size(); ++t )
+            result[tau] += signal[t] * signal[t+tau];
+        result[tau] /= ( signal.size() - tau );
+    }
+    return result;
+}
+
+} // namespace
+
+void test_time_correlation( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for TimeCorrelation." << std::endl;
+    std::vector< double > signal;
+    for ( size_t i( 0 ); i != 13; ++i )
+        signal.push_back( std::sin( 0.7 * i ) + 0.1 * i );
+    {
+    std::vector< double > expected = direct_autocorrelation_function( signal );
+    std::vector< double > calculated = autocorrelation_function( signal );
+    test_suite.test_equality( calculated.size(), expected.size(), "autocorrelation_function() size" );
+    for ( size_t i( 0 ); i != expected.size(); ++i )
+        test_suite.test_equality_double( calculated[i], expected[i], "autocorrelation_function() " + size_t2string( i ), 1.0E-10 );
+    }
+    // Two series, the same signal in x for the first and in z for the second, window = stride = 5 gives two windows.
+    {
+    const size_t window( 5 );
+    AutocorrelationAccumulator accumulator( 2, window, window, true );
+    std::vector< Vector3D > values( 2 );
+    for ( size_t i( 0 ); i != 2 * window + 2; ++i )
+    {
+        values[0] = Vector3D( signal[i], 0.0, 0.0 );
+        values[1] = Vector3D( 0.0, 0.0, signal[i] );
+        accumulator.add_values( values );
+    }
+    test_suite.test_equality( accumulator.nwindows(), size_t( 2 ), "AutocorrelationAccumulator::nwindows()" );
+    std::vector< double > expected( window, 0.0 );
+    for ( size_t w( 0 ); w != 2; ++w )
+    {
+        std::vector< double > window_signal( signal.begin() + w * window, signal.begin() + ( w + 1 ) * window );
+        double mean( 0.0 );
+        for ( size_t t( 0 ); t != window; ++t )
+            mean += window_signal[t];
+        mean /= window;
+        for ( size_t t( 0 ); t != window; ++t )
+            window_signal[t] -= mean;
+        std::vector< double > window_result = direct_autocorrelation_function( window_signal );
+        for ( size_t tau( 0 ); tau != window; ++tau )
+            expected[tau] += window_result[tau] / 2.0;
+    }
+    std::vector< double > calculated = accumulator.correlation_function();
+    for ( size_t tau( 0 ); tau != window; ++tau )
+        test_suite.test_equality_double( calculated[tau], expected[tau], "AutocorrelationAccumulator::correlation_function() " + size_t2string( tau ), 1.0E-10 );
+    }
+}
+
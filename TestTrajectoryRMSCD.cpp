@@ -0,0 +1,149 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "TrajectoryRMSCD.h"
+#include "3DCalculations.h"
+#include "Atom.h"
+#include "FileName.h"
+#include "MathFunctions.h"
+#include "RandomNumberGenerator.h"
+#include "TextFileReader_2.h"
+#include "TextFileWriter.h"
+#include "TrajectorySource.h"
+#include "Utilities.h"
+
+#include "TestSuite.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <string>
+
+void test_trajectory_RMSCD( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for TrajectoryRMSCD." << std::endl;
+    const char * symbols[] = { "C", "N", "O", "H" };
+    RandomNumberGenerator_double random_number_generator;
+    CrystalStructure reference;
+    reference.set_crystal_lattice( CrystalLattice( 9.0, 10.0, 11.0, Angle::from_degrees( 88.0 ), Angle::from_degrees( 97.0 ), Angle::from_degrees( 91.0 ) ) );
+    for ( size_t i( 0 ); i != 60; ++i )
+        reference.add_atom( Atom( Element( symbols[ i % 4 ] ), Vector3D( random_number_generator.next_number(), random_number_generator.next_number(), random_number_generator.next_number() ), "A" + size_t2string( i ) ) );
+    CrystalStructure frame;
+    frame.set_crystal_lattice( CrystalLattice( 9.1, 10.0, 10.9, Angle::from_degrees( 88.0 ), Angle::from_degrees( 97.5 ), Angle::from_degrees( 91.0 ) ) );
+    for ( size_t i( 0 ); i != reference.natoms(); ++i )
+    {
+        const Vector3D shift( 0.02 * ( random_number_generator.next_number() - 0.5 ), 0.02 * ( random_number_generator.next_number() - 0.5 ), 0.02 * ( random_number_generator.next_number() - 0.5 ) );
+        Atom atom( reference.atom( i ) );
+        atom.set_position( atom.position() + shift );
+        frame.add_atom( atom );
+    }
+    {
+    TrajectoryRMSCD trajectory_RMSCD( reference );
+    test_suite.test_equality_double( trajectory_RMSCD.RMSCD( frame ), root_mean_square_Cartesian_displacement( reference, frame ), "TrajectoryRMSCD::RMSCD() SAME_ORDER" );
+    test_suite.test_equality_double( trajectory_RMSCD.RMSCD( reference ), 0.0, "TrajectoryRMSCD::RMSCD() SAME_ORDER identity" );
+    }
+    {
+    // Reversed order, whole lattice translations, all within the lattice of the reference: each atom is still nearest to itself
+    TrajectoryRMSCD trajectory_RMSCD( reference, TrajectoryRMSCD::NEAREST_ATOM );
+    CrystalStructure shuffled;
+    shuffled.set_crystal_lattice( reference.crystal_lattice() );
+    double sum( 0.0 );
+    size_t nnon_H_atoms( 0 );
+    for ( size_t i( reference.natoms() ); i != 0; --i )
+    {
+        Atom atom( reference.atom( i - 1 ) );
+        const Vector3D shift( 0.01, -0.005, 0.002 );
+        atom.set_position( atom.position() + shift + Vector3D( static_cast< double >( i % 3 ) - 1.0, 2.0, -1.0 ) );
+        shuffled.add_atom( atom );
+        if ( ! atom.element().is_H_or_D() )
+        {
+            sum += reference.crystal_lattice().fractional_to_orthogonal( shift ).norm2();
+            ++nnon_H_atoms;
+        }
+    }
+    test_suite.test_equality_double( trajectory_RMSCD.RMSCD( shuffled ), std::sqrt( sum / nnon_H_atoms ), "TrajectoryRMSCD::RMSCD() NEAREST_ATOM" );
+    test_suite.test_equality_double( trajectory_RMSCD.RMSCD( reference ), 0.0, "TrajectoryRMSCD::RMSCD() NEAREST_ATOM identity" );
+    shuffled.add_atom( Atom( Element( "S" ), Vector3D( 0.5, 0.5, 0.5 ), "S1" ) );
+    test_suite.test_equality( trajectory_RMSCD.RMSCD( shuffled ), std::numeric_limits< double >::infinity(), "TrajectoryRMSCD::RMSCD() NEAREST_ATOM missing element" );
+    // Against a brute-force search over the 27 images
+    double brute_force_sum( 0.0 );
+    for ( size_t i( 0 ); i != frame.natoms(); ++i )
+    {
+        if ( frame.atom( i ).element().is_H_or_D() )
+            continue;
+        double minimum = std::numeric_limits< double >::infinity();
+        for ( size_t j( 0 ); j != reference.natoms(); ++j )
+        {
+            if ( reference.atom( j ).element() != frame.atom( i ).element() )
+                continue;
+            const Vector3D difference = adjust_for_translations( frame.atom( i ).position() ) - adjust_for_translations( reference.atom( j ).position() );
+            for ( int u( -1 ); u != 2; ++u )
+            {
+                for ( int v( -1 ); v != 2; ++v )
+                {
+                    for ( int w( -1 ); w != 2; ++w )
+                        minimum = std::min( minimum, reference.crystal_lattice().fractional_to_orthogonal( difference + Vector3D( u, v, w ) ).norm2() );
+                }
+            }
+        }
+        brute_force_sum += minimum;
+    }
+    test_suite.test_equality_double( trajectory_RMSCD.RMSCD( frame ), std::sqrt( brute_force_sum / nnon_H_atoms ), "TrajectoryRMSCD::RMSCD() NEAREST_ATOM brute force" );
+    }
+    // Time series of an .xyz trajectory
+    {
+    FileName file_name( "", "test_trajectory_RMSCD", "xyz" );
+    {
+    TextFileWriter text_file_writer( file_name );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        text_file_writer.write_line( "2" );
+        text_file_writer.write_line( "Lattice=\"10.0 0.0 0.0 0.0 10.0 0.0 0.0 0.0 10.0\"" );
+        text_file_writer.write_line( "C " + double2string( 1.0 + 0.1 * i ) + " 2.0 3.0" );
+        text_file_writer.write_line( "O 5.0 5.0 5.0" );
+    }
+    }
+    XYZTrajectory trajectory( file_name );
+    CrystalStructure first_frame;
+    trajectory.read_frame( 0, first_frame );
+    TrajectoryRMSCD trajectory_RMSCD( first_frame );
+    trajectory_RMSCD.set_nthreads( 2 );
+    const std::vector< double > RMSCDs = trajectory_RMSCD.calculate( trajectory );
+    test_suite.test_equality( RMSCDs.size(), size_t( 3 ), "TrajectoryRMSCD::calculate() size" );
+    test_suite.test_equality_double( RMSCDs[0], 0.0, "TrajectoryRMSCD::calculate() frame 0" );
+    test_suite.test_equality_double( RMSCDs[2], std::sqrt( square( 0.2 ) / 2.0 ), "TrajectoryRMSCD::calculate() frame 2" );
+    FileName output_file_name( "", "test_trajectory_RMSCD", "txt" );
+    save_RMSCD_time_series( trajectory, RMSCDs, output_file_name );
+    TextFileReader_2 text_file_reader( output_file_name );
+    test_suite.test_equality( text_file_reader.size(), size_t( 3 ), "save_RMSCD_time_series() number of lines" );
+    test_suite.test_equality( text_file_reader.line( 1 ), trajectory.frame_name( 1 ) + " " + double2string( RMSCDs[1] ), "save_RMSCD_time_series() line" );
+    std::remove( file_name.full_name().c_str() );
+    std::remove( output_file_name.full_name().c_str() );
+    }
+}
+
@@ -0,0 +1,206 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "TrajectorySource.h"
+#include "Atom.h"
+#include "Element.h"
+#include "FileName.h"
+#include "TextFileWriter.h"
+#include "Utilities.h"
+#include "Vector3D.h"
+
+#include "TestSuite.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+void write_int( std::ofstream & output_file, const int value )
+{
+    output_file.write( reinterpret_cast< const char * >( &value ), 4 );
+}
+
+// Writes a small CHARMM-style .dcd file with a unit cell, in the native byte order.
+void write_dcd( const FileName & file_name, const std::vector< std::vector< Vector3D > > & frames, const double cell_lengths[3] )
+{
+    std::ofstream output_file( file_name.full_name().c_str(), std::ios::binary );
+    const int natoms = frames[0].size();
+    write_int( output_file, 84 );
+    output_file.write( "CORD", 4 );
+    for ( size_t i( 0 ); i != 20; ++i )
+    {
+        int value( 0 );
+        if ( i == 0 )
+            value = frames.size();
+        else if ( i == 10 )
+            value = 1;
+        else if ( i == 19 )
+            value = 24;
+        write_int( output_file, value );
+    }
+    write_int( output_file, 84 );
+    char title[80];
+    std::memset( title, ' ', 80 );
+    write_int( output_file, 84 );
+    write_int( output_file, 1 );
+    output_file.write( title, 80 );
+    write_int( output_file, 84 );
+    write_int( output_file, 4 );
+    write_int( output_file, natoms );
+    write_int( output_file, 4 );
+    for ( size_t i( 0 ); i != frames.size(); ++i )
+    {
+        // A, gamma, B, beta, alpha, C
+        const double cell[6] = { cell_lengths[0], 90.0, cell_lengths[1], 90.0, 90.0, cell_lengths[2] };
+        write_int( output_file, 48 );
+        output_file.write( reinterpret_cast< const char * >( cell ), 48 );
+        write_int( output_file, 48 );
+        for ( size_t k( 0 ); k != 3; ++k )
+        {
+            write_int( output_file, 4 * natoms );
+            for ( size_t j( 0 ); j != frames[i].size(); ++j )
+            {
+                const float value = frames[i][j].value( k );
+                output_file.write( reinterpret_cast< const char * >( &value ), 4 );
+            }
+            write_int( output_file, 4 * natoms );
+        }
+    }
+}
+
+} // namespace
+
+void test_trajectory_source( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for TrajectorySource." << std::endl;
+    // Multi-frame .xyz with extended-XYZ lattice
+    {
+    FileName file_name( "", "test_trajectory", "xyz" );
+    {
+    TextFileWriter text_file_writer( file_name );
+    text_file_writer.write_line( "2" );
+    text_file_writer.write_line( "Lattice=\"10.0 0.0 0.0 0.0 10.0 0.0 0.0 0.0 10.0\" Properties=species:S:1:pos:R:3" );
+    text_file_writer.write_line( "C 1.0 2.0 3.0" );
+    text_file_writer.write_line( "O 5.0 5.0 5.0" );
+    text_file_writer.write_line( "2" );
+    text_file_writer.write_line( "Lattice=\"10.0 0.0 0.0 0.0 10.0 0.0 0.0 0.0 12.0\"" );
+    text_file_writer.write_line( "C 1.0 2.0 3.0 0.1" );
+    text_file_writer.write_line( "O 5.0 5.0 6.0 0.1" );
+    }
+    XYZTrajectory trajectory( file_name );
+    test_suite.test_equality( trajectory.nframes(), size_t( 2 ), "XYZTrajectory::nframes()" );
+    CrystalStructure crystal_structure;
+    trajectory.read_frame( 1, crystal_structure );
+    test_suite.test_equality( crystal_structure.natoms(), size_t( 2 ), "XYZTrajectory::read_frame() natoms" );
+    test_suite.test_equality_double( crystal_structure.crystal_lattice().c(), 12.0, "XYZTrajectory::read_frame() c" );
+    test_suite.test_equality( nearly_equal( crystal_structure.atom( 1 ).position(), Vector3D( 0.5, 0.5, 0.5 ) ), true, "XYZTrajectory::read_frame() position" );
+    test_suite.test_equality( crystal_structure.atom( 1 ).element().symbol(), std::string( "O" ), "XYZTrajectory::read_frame() element" );
+    trajectory.read_frame( 0, crystal_structure );
+    test_suite.test_equality( nearly_equal( crystal_structure.atom( 0 ).position(), Vector3D( 0.1, 0.2, 0.3 ) ), true, "XYZTrajectory::read_frame() frame 1" );
+    std::remove( file_name.full_name().c_str() );
+    }
+    // .dcd
+    {
+    FileName file_name( "", "test_trajectory", "dcd" );
+    std::vector< std::vector< Vector3D > > frames( 3 );
+    for ( size_t i( 0 ); i != frames.size(); ++i )
+    {
+        frames[i].push_back( Vector3D( 1.0 + i, 2.0, 3.0 ) );
+        frames[i].push_back( Vector3D( 4.0, 5.0, 6.0 - i ) );
+    }
+    const double cell_lengths[3] = { 10.0, 20.0, 30.0 };
+    write_dcd( file_name, frames, cell_lengths );
+    CrystalStructure topology;
+    topology.add_atom( Atom( Element( "N" ), Vector3D(), "N1" ) );
+    topology.add_atom( Atom( Element( "H" ), Vector3D(), "H1" ) );
+    DCDTrajectory trajectory( file_name, topology );
+    test_suite.test_equality( trajectory.nframes(), size_t( 3 ), "DCDTrajectory::nframes()" );
+    CrystalStructure crystal_structure;
+    trajectory.read_frame( 2, crystal_structure );
+    test_suite.test_equality_double( crystal_structure.crystal_lattice().b(), 20.0, "DCDTrajectory::read_frame() b" );
+    test_suite.test_equality( nearly_equal( crystal_structure.atom( 0 ).position(), Vector3D( 0.3, 0.1, 0.1 ), 1.0E-6 ), true, "DCDTrajectory::read_frame() position 1" );
+    test_suite.test_equality( nearly_equal( crystal_structure.atom( 1 ).position(), Vector3D( 0.4, 0.25, 0.4/3.0 ), 1.0E-6 ), true, "DCDTrajectory::read_frame() position 2" );
+    test_suite.test_equality( crystal_structure.atom( 1 ).label(), std::string( "H1" ), "DCDTrajectory::read_frame() label" );
+    // A unit-cell record of the wrong length must not be read misaligned
+    {
+    std::fstream output_file( file_name.full_name().c_str(), std::ios::binary | std::ios::in | std::ios::out );
+    output_file.seekp( 196 );
+    const int wrong_length( 32 );
+    output_file.write( reinterpret_cast< const char * >( &wrong_length ), 4 );
+    }
+    bool has_thrown( false );
+    try
+    {
+        trajectory.read_frame( 0, crystal_structure );
+    }
+    catch ( std::exception & )
+    {
+        has_thrown = true;
+    }
+    test_suite.test_equality( has_thrown, true, "DCDTrajectory::read_frame() record length" );
+    std::remove( file_name.full_name().c_str() );
+    }
+    // DL_POLY HISTORY with velocities
+    {
+    FileName file_name( "", "test_HISTORY", "txt" );
+    {
+    TextFileWriter text_file_writer( file_name );
+    text_file_writer.write_line( "Test trajectory" );
+    text_file_writer.write_line( "         1         2         2" );
+    for ( size_t i( 0 ); i != 2; ++i )
+    {
+        text_file_writer.write_line( "timestep " + size_t2string( 100 * i ) + "         2         1         2    0.001000" );
+        text_file_writer.write_line( "    8.000000    0.000000    0.000000" );
+        text_file_writer.write_line( "    0.000000    8.000000    0.000000" );
+        text_file_writer.write_line( "    0.000000    0.000000    8.000000" );
+        text_file_writer.write_line( "Cl1              1   35.453000    0.000000" );
+        text_file_writer.write_line( "    1.000000    2.000000    " + double2string( 2.0 * i ) );
+        text_file_writer.write_line( "    0.100000    0.100000    0.100000" );
+        text_file_writer.write_line( "Na1              2   22.990000    0.000000" );
+        text_file_writer.write_line( "   -2.000000   -2.000000   -2.000000" );
+        text_file_writer.write_line( "    0.100000    0.100000    0.100000" );
+    }
+    }
+    DLPOLYHistoryTrajectory trajectory( file_name );
+    test_suite.test_equality( trajectory.nframes(), size_t( 2 ), "DLPOLYHistoryTrajectory::nframes()" );
+    CrystalStructure crystal_structure;
+    trajectory.read_frame( 1, crystal_structure );
+    test_suite.test_equality( crystal_structure.natoms(), size_t( 2 ), "DLPOLYHistoryTrajectory::read_frame() natoms" );
+    test_suite.test_equality( nearly_equal( crystal_structure.atom( 0 ).position(), Vector3D( 0.125, 0.25, 0.25 ) ), true, "DLPOLYHistoryTrajectory::read_frame() position 1" );
+    test_suite.test_equality( nearly_equal( crystal_structure.atom( 1 ).position(), Vector3D( -0.25, -0.25, -0.25 ) ), true, "DLPOLYHistoryTrajectory::read_frame() position 2" );
+    test_suite.test_equality( crystal_structure.atom( 1 ).element().symbol(), std::string( "Na" ), "DLPOLYHistoryTrajectory::read_frame() element" );
+    std::remove( file_name.full_name().c_str() );
+    }
+}
+
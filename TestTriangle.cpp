@@ -26,19 +26,69 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "Triangle.h"
+#include "ConvexPolygon.h"
 
 #include "TestSuite.h"
 
+#include <cmath>
 #include <iostream>
+#include <vector>
 
 void test_Triangle( TestSuite & test_suite )
 {
     std::cout << "Now running tests for Triangle." << std::endl;
-
     {
-    Triangle dummy;
- //   test_suite.test_equality( dummy, , "Triangle()" );
+    const Triangle triangle( Vector3D( 1.0, 1.0, 2.0 ), Vector3D( 4.0, 1.0, 2.0 ), Vector3D( 1.0, 3.0, 2.0 ) );
+    test_suite.test_equality_double( triangle.area(), 3.0, "Triangle::area()" );
+    test_suite.test_equality_double( ( triangle.n() - Vector3D( 0.0, 0.0, 6.0 ) ).length(), 0.0, "Triangle::n()" );
+    test_suite.test_equality_double( ( triangle.centroid() - Vector3D( 2.0, 5.0 / 3.0, 2.0 ) ).length(), 0.0, "Triangle::centroid()" );
+    test_suite.test_equality_double( Triangle().area(), 0.0, "Triangle()" );
+    }
+    // The surface of the unit cube, shifted away from the origin, as a triangle soup
+    {
+    std::vector< Triangle > triangles;
+    for ( size_t axis( 0 ); axis != 3; ++axis )
+    {
+        for ( size_t side( 0 ); side != 2; ++side )
+        {
+            std::vector< Vector3D > vertices( 4 );
+            const size_t u = ( axis + 1 ) % 3;
+            const size_t v = ( axis + 2 ) % 3;
+            const double corners[4][2] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 1.0, 1.0 }, { 0.0, 1.0 } };
+            for ( size_t i( 0 ); i != 4; ++i )
+            {
+                vertices[i] = Vector3D( 3.0, -2.0, 5.0 );
+                vertices[i].set_value( axis, vertices[i].value( axis ) + side );
+                // The order of the vertices makes the normals point outwards
+                const size_t corner = ( side == 1 ) ? i : 3 - i;
+                vertices[i].set_value( u, vertices[i].value( u ) + corners[corner][0] );
+                vertices[i].set_value( v, vertices[i].value( v ) + corners[corner][1] );
+            }
+            ConvexPolygon( vertices ).append_triangles( triangles );
+        }
+    }
+    test_suite.test_equality( triangles.size(), size_t( 24 ), "ConvexPolygon::append_triangles()" );
+    test_suite.test_equality_double( total_area( triangles ), 6.0, "total_area()" );
+    test_suite.test_equality_double( enclosed_volume( triangles ), 1.0, "enclosed_volume()" );
+    std::vector< double > vertices;
+    for ( size_t i( 0 ); i != triangles.size(); ++i )
+    {
+        for ( size_t j( 0 ); j != 3; ++j )
+        {
+            for ( size_t k( 0 ); k != 3; ++k )
+                vertices.push_back( triangles[i].vertex( j ).value( k ) );
+        }
+    }
+    std::vector< double > areas( triangles.size() );
+    triangle_areas( vertices.data(), triangles.size(), areas.data() );
+    bool all_correct( true );
+    for ( size_t i( 0 ); i != triangles.size(); ++i )
+    {
+        if ( std::abs( areas[i] - triangles[i].area() ) > 1.0E-12 )
+            all_correct = false;
+    }
+    test_suite.test_equality( all_correct, true, "triangle_areas()" );
+    test_suite.test_equality_double( enclosed_volume( vertices.data(), triangles.size() ), 1.0, "enclosed_volume() array" );
     }
-
 }
 
@@ -34,11 +34,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 void test_TriangularPyramid( TestSuite & test_suite )
 {
     std::cout << "Now running tests for TriangularPyramid." << std::endl;
-
     {
-    TriangularPyramid dummy;
-  //  test_suite.test_equality( dummy, , "TriangularPyramid()" );
+    const Triangle base( Vector3D( 0.0, 0.0, 0.0 ), Vector3D( 2.0, 0.0, 0.0 ), Vector3D( 0.0, 3.0, 0.0 ) );
+    const TriangularPyramid pyramid( base, Vector3D( 0.5, 0.5, -4.0 ) );
+    test_suite.test_equality_double( pyramid.volume(), 4.0, "TriangularPyramid::volume()" );
+    test_suite.test_equality_double( pyramid.height(), 4.0, "TriangularPyramid::height()" );
+    test_suite.test_equality_double( TriangularPyramid().volume(), 0.0, "TriangularPyramid()" );
+    test_suite.test_equality_double( TriangularPyramid().height(), 0.0, "TriangularPyramid() height()" );
     }
-
 }
 
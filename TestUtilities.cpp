@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TestSuite.h"
 
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
 void test_utilities( TestSuite & test_suite )
@@ -124,13 +125,125 @@ void test_utilities( TestSuite & test_suite )
 // @@ We need to allow escaped quotes, e.g. "He said \"yes\"."
 // This kind of configurability suggests that this could be a class.
 // std::vector< std::string > split( const std::string & input );
+    {
+        std::vector< std::string > expected;
+        expected.push_back( "one" );
+        expected.push_back( "two three" );
+        expected.push_back( "four" );
+        expected.push_back( "0.1071(7)" );
+        const std::string line( "  one \"two three\"\t'four'  \"\" 0.1071(7) " );
+        test_suite.test_equality( split( line ), expected, "split() 01" );
+        Tokens tokens;
+        tokenise( "a b c d e f g h", tokens ); // The contents must be replaced, not appended to
+        tokenise( line, tokens );
+        test_suite.test_equality( tokens.strings(), expected, "tokenise() 01" );
+        test_suite.test_equality( tokens[1] == "two three", true, "tokenise() 02" );
+        // The tokens point into the line
+        test_suite.test_equality( tokens[0].data() == line.data() + 2, true, "tokenise() 03" );
+        test_suite.test_equality_double( tokens.to_double( 3 ), 0.1071, "Tokens::to_double()" );
+        tokenise( "", tokens );
+        test_suite.test_equality( tokens.empty(), true, "tokenise() 04" );
+        // Single quotes are ordinary characters for split_2()
+        tokenise_2( "'a b' c", tokens );
+        test_suite.test_equality( tokens.size(), size_t( 3 ), "tokenise_2() 01" );
+        test_suite.test_equality( split_2( "'a b' c" ), tokens.strings(), "split_2() 01" );
+        bool exception_thrown( false );
+        try { tokenise( "one \"two three", tokens ); }
+        catch ( std::exception & ) { exception_thrown = true; }
+        test_suite.test_equality( exception_thrown, true, "tokenise() 05" );
+        exception_thrown = false;
+        try { split( "one \"two\"three" ); }
+        catch ( std::exception & ) { exception_thrown = true; }
+        test_suite.test_equality( exception_thrown, true, "split() 02" );
+    }
+    {
+        Splitter splitter( "," );
+        std::vector< std::string > expected;
+        expected.push_back( "a" );
+        expected.push_back( "b c" );
+        test_suite.test_equality( splitter.split( "a,,b c" ), expected, "Splitter::split() 01" );
+        splitter.set_merge_delimiters( false );
+        expected.insert( expected.begin() + 1, "" );
+        test_suite.test_equality( splitter.split( "a,,b c" ), expected, "Splitter::split() 02" );
+        Tokens tokens;
+        splitter.tokenise( "a,,\"b c\"", tokens );
+        test_suite.test_equality( tokens.strings(), expected, "Splitter::tokenise() 01" );
+        splitter.split_by_length( 2 );
+        splitter.tokenise( "abcde", tokens );
+        test_suite.test_equality( tokens.size(), size_t( 3 ), "Splitter::tokenise() 02" );
+        test_suite.test_equality( tokens[2] == "e", true, "Splitter::tokenise() 03" );
+    }
 
 // Recognises scientific notation with "E" or "e" such as -.234e-45
 // double string2double( std::string input );
 
 // int string2integer( const std::string & input );
+    {
+        ParsedNumber parsed_number = parse_number( "0.2611(2)" );
+        test_suite.test_equality_double( parsed_number.value_, 0.2611, "parse_number() 01" );
+        test_suite.test_equality_double( parsed_number.estimated_standard_deviation_, 0.0002, "parse_number() 02", 1.0E-12 );
+        test_suite.test_equality( parsed_number.has_esd_, true, "parse_number() 03" );
+        parsed_number = parse_number( "+.5" );
+        test_suite.test_equality( parsed_number.value_, 0.5, "parse_number() 04" );
+        test_suite.test_equality( parsed_number.has_esd_, false, "parse_number() 05" );
+        test_suite.test_equality_double( parse_number( "1234(15)" ).estimated_standard_deviation_, 15.0, "parse_number() 06" );
+        test_suite.test_equality_double( parse_number( "-1.2E-3(4)" ).estimated_standard_deviation_, 0.0004, "parse_number() 07", 1.0E-12 );
+        test_suite.test_equality( parse_number( "-1.2e+3" ).value_, -1200.0, "parse_number() 08" );
+        // from_chars() rounds correctly, 0.1 must be the same double as the literal
+        test_suite.test_equality( parse_number( "0.1" ).value_, 0.1, "parse_number() 09" );
+        const char * invalid[] = { "", " 1", "1 ", "+-1", "inf", "nan", ".", "1.2.3", "1e", "0.1(2", "0.1()", "0.1(-2)", "0.1(2)3", "0.1x" };
+        for ( size_t i( 0 ); i != sizeof( invalid ) / sizeof( invalid[0] ); ++i )
+        {
+            bool exception_thrown( false );
+            try { parse_number( invalid[i] ); }
+            catch ( std::exception & ) { exception_thrown = true; }
+            if ( ! exception_thrown )
+                test_suite.log_error( std::string( "parse_number() should have rejected \"" ) + invalid[i] + "\"" );
+        }
+        test_suite.test_equality( string2double( "0.1071(7)" ), 0.1071, "string2double() 01" );
+        test_suite.test_equality( string2integer( "-12" ), -12, "string2integer() 01" );
+        bool exception_thrown( false );
+        try { string2integer( "1.5" ); }
+        catch ( std::exception & ) { exception_thrown = true; }
+        test_suite.test_equality( exception_thrown, true, "string2integer() 02" );
+    }
 
 // std::string double2string( const double input );
+    {
+        test_suite.test_equality( double2string( 0.1 ), std::string( "0.1" ), "double2string() 01" );
+        test_suite.test_equality( double2string( 1234567.0 ), std::string( "1.23457e+06" ), "double2string() 02" );
+        test_suite.test_equality( double2string( -1.5, 3, 8 ), std::string( "  -1.500" ), "double2string() 03" );
+        test_suite.test_equality( double2string( 1.0e30, 1 ).length(), size_t( 33 ), "double2string() 04" );
+        test_suite.test_equality( double2string_pad_plus( 0.25, 2 ), std::string( " 0.25" ), "double2string_pad_plus() 01" );
+        test_suite.test_equality( double2string_pad_plus( -0.25, 2 ), std::string( "-0.25" ), "double2string_pad_plus() 02" );
+        test_suite.test_equality( size_t2string( 7, 3 ), std::string( "007" ), "size_t2string() 01" );
+        test_suite.test_equality( size_t2string( 1234, 3 ), std::string( "1234" ), "size_t2string() 02" );
+        test_suite.test_equality( size_t2string( 0 ), std::string( "0" ), "size_t2string() 03" );
+    }
+    {
+        std::string line( "C1" );
+        append_double( line, 0.5, 3, 7 );
+        append_double_pad_plus( line, 0.25, 2 );
+        append_size_t( line, 12, 4, ' ' );
+        append_double( line, 2.0 );
+        test_suite.test_equality( line, std::string( "C1  0.500 0.25  122" ), "append_double() 01" );
+    }
+    {
+        test_suite.test_equality( glob_match( "*.cif", "frame_10.cif" ), true, "glob_match() 01" );
+        test_suite.test_equality( glob_match( "*.cif", "frame_10.cif.bak" ), false, "glob_match() 02" );
+        test_suite.test_equality( glob_match( "frame_?.cif", "frame_1.cif" ), true, "glob_match() 03" );
+        test_suite.test_equality( glob_match( "frame_?.cif", "frame_10.cif" ), false, "glob_match() 04" );
+        test_suite.test_equality( glob_match( "*a*b*", "xaybzb" ), true, "glob_match() 05" );
+        test_suite.test_equality( glob_match( "", "" ), true, "glob_match() 06" );
+        test_suite.test_equality( glob_match( "", "a" ), false, "glob_match() 07" );
+        test_suite.test_equality( natural_less( "frame_9.cif", "frame_10.cif" ), true, "natural_less() 01" );
+        test_suite.test_equality( natural_less( "frame_10.cif", "frame_9.cif" ), false, "natural_less() 02" );
+        test_suite.test_equality( natural_less( "frame_010.cif", "frame_9.cif" ), false, "natural_less() 03" );
+        test_suite.test_equality( natural_less( "a", "a1" ), true, "natural_less() 04" );
+        test_suite.test_equality( natural_less( "a01", "a1" ), true, "natural_less() 05" );
+        test_suite.test_equality( natural_less( "a1", "a01" ), false, "natural_less() 06" );
+        test_suite.test_equality( natural_less( "a1b", "a1b" ), false, "natural_less() 07" );
+    }
 
 // Pads the string to e.g. "0001"
 // If the length of the input value is longer than the padded length, a string with
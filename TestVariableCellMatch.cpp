@@ -0,0 +1,131 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "VariableCellMatch.h"
+#include "CrystalStructure.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "ReflectionList.h"
+#include "SpaceGroup.h"
+#include "Utilities.h"
+
+#include "TestFixtures.h"
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// From 5 to 35 degrees. The calculator only includes the reflections up to its end, so the pattern is calculated to 40 degrees
+// to include the tails of the peaks just beyond 35 degrees, as in a measured pattern.
+PowderPattern experimental_pattern( const CrystalStructure & crystal_structure, const Angle zero_point )
+{
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_start( Angle::from_degrees( 5.0 ) );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 40.0 ) );
+    powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    powder_pattern_calculator.set_FWHM( 0.1 );
+    PowderPattern full_range;
+    powder_pattern_calculator.calculate( full_range );
+    PowderPattern result = crop_to_two_theta_end( full_range, Angle::from_degrees( 35.0 ) );
+    // The peaks appear at 2theta + zero point
+    result.correct_zero_point_error( -zero_point );
+    return result;
+}
+
+} // namespace
+
+void test_variable_cell_match( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for VariableCellMatch." << std::endl;
+    const CrystalLattice crystal_lattice( 7.1, 8.3, 9.2, Angle::angle_90_degrees(), Angle::from_degrees( 97.0 ), Angle::angle_90_degrees() );
+    const CrystalLattice deformed_crystal_lattice( 7.16, 8.25, 9.25, Angle::angle_90_degrees(), Angle::from_degrees( 97.4 ), Angle::angle_90_degrees() );
+    const CrystalStructure crystal_structure = P21c_test_structure( crystal_lattice );
+    const PowderPattern target = experimental_pattern( P21c_test_structure( deformed_crystal_lattice ), Angle::from_degrees( 0.03 ) );
+    VariableCellMatch variable_cell_match( target );
+    {
+    // The allowed deformations follow the rotations of the space group
+    test_suite.test_equality( variable_cell_match.nparameters( crystal_lattice, SpaceGroup() ), size_t( 7 ), "VariableCellMatch::nparameters() P1" );
+    test_suite.test_equality( variable_cell_match.nparameters( crystal_lattice, SpaceGroup::P21c() ), size_t( 5 ), "VariableCellMatch::nparameters() P21/c" );
+    const CrystalLattice cubic_lattice( 9.0, 9.0, 9.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() );
+    test_suite.test_equality( variable_cell_match.nparameters( cubic_lattice, SpaceGroup::from_number( 198 ) ), size_t( 2 ), "VariableCellMatch::nparameters() P213" );
+    }
+    {
+    // Analytical derivatives against central finite differences
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 40.0 ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    const ReflectionList reflection_list = powder_pattern_calculator.reflection_list();
+    std::vector< double > parameters( variable_cell_match.nparameters( crystal_lattice, crystal_structure.space_group() ) );
+    for ( size_t j( 0 ); j != parameters.size(); ++j )
+        parameters[j] = 0.004 * ( j + 1 ) * ( ( j % 2 == 0 ) ? 1.0 : -1.0 );
+    std::vector< double > derivatives;
+    const double similarity = variable_cell_match.similarity( crystal_lattice, crystal_structure.space_group(), reflection_list, parameters, derivatives );
+    test_suite.test_equality( derivatives.size(), parameters.size(), "VariableCellMatch::similarity() number of derivatives" );
+    if ( ( similarity <= 0.0 ) || ( similarity > 1.0 ) )
+        test_suite.log_error( "VariableCellMatch::similarity() out of range" );
+    const double delta = 1.0E-6;
+    std::vector< double > dummy;
+    for ( size_t j( 0 ); j != parameters.size(); ++j )
+    {
+        std::vector< double > plus( parameters );
+        std::vector< double > minus( parameters );
+        plus[j] += delta;
+        minus[j] -= delta;
+        const double finite_difference = ( variable_cell_match.similarity( crystal_lattice, crystal_structure.space_group(), reflection_list, plus, dummy ) -
+                                           variable_cell_match.similarity( crystal_lattice, crystal_structure.space_group(), reflection_list, minus, dummy ) ) / ( 2.0 * delta );
+        if ( std::abs( finite_difference - derivatives[j] ) > 1.0E-4 * std::max( 1.0, std::abs( finite_difference ) ) )
+            test_suite.log_error( "VariableCellMatch::similarity() derivative " + size_t2string( j ) + " wrong" );
+    }
+    }
+    {
+    // The deformation and the zero point are recovered. The F^2 values are those of the original cell, which limits the accuracy.
+    const VariableCellMatchResult result = variable_cell_match.match( crystal_structure );
+    if ( result.similarity_ <= result.similarity_before_ )
+        test_suite.log_error( "VariableCellMatch::match() similarity did not improve" );
+    test_suite.test_equality_double( result.similarity_, 1.0, "VariableCellMatch::match() similarity", 1.0E-3 );
+    test_suite.test_equality_double( result.crystal_lattice_.a(), deformed_crystal_lattice.a(), "VariableCellMatch::match() a", 5.0E-3 );
+    test_suite.test_equality_double( result.crystal_lattice_.b(), deformed_crystal_lattice.b(), "VariableCellMatch::match() b", 5.0E-3 );
+    test_suite.test_equality_double( result.crystal_lattice_.c(), deformed_crystal_lattice.c(), "VariableCellMatch::match() c", 5.0E-3 );
+    test_suite.test_equality_double( result.crystal_lattice_.beta().value_in_degrees(), deformed_crystal_lattice.beta().value_in_degrees(), "VariableCellMatch::match() beta", 2.0E-2 );
+    test_suite.test_equality_double( result.crystal_lattice_.alpha().value_in_degrees(), 90.0, "VariableCellMatch::match() alpha" );
+    test_suite.test_equality_double( result.zero_point_.value_in_degrees(), 0.03, "VariableCellMatch::match() zero point", 5.0E-3 );
+    if ( ( result.cell_deformation_ < 0.005 ) || ( result.cell_deformation_ > 0.05 ) )
+        test_suite.log_error( "VariableCellMatch::match() cell deformation out of range" );
+    // Nothing moves if the structure already matches
+    VariableCellMatch exact_match( experimental_pattern( crystal_structure, Angle() ) );
+    const VariableCellMatchResult exact_result = exact_match.match( crystal_structure );
+    test_suite.test_equality_double( exact_result.similarity_before_, exact_result.similarity_, "VariableCellMatch::match() exact similarity", 1.0E-6 );
+    test_suite.test_equality_double( exact_result.crystal_lattice_.a(), crystal_lattice.a(), "VariableCellMatch::match() exact a", 1.0E-4 );
+    test_suite.test_equality_double( exact_result.zero_point_.value_in_degrees(), 0.0, "VariableCellMatch::match() exact zero point", 1.0E-4 );
+    }
+}
@@ -26,19 +26,96 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "VoidsFinder.h"
+#include "CrystalStructure.h"
+#include "MathConstants.h"
 
 #include "TestSuite.h"
 
+#include <cmath>
 #include <iostream>
 
-void test_VoidsFinder( TestSuite & test_suite )
+namespace
+{
+
+CrystalStructure single_atom( const CrystalLattice & crystal_lattice, const Vector3D & position )
 {
-   // std::cout << "Now running tests for VoidsFinder." << std::endl;
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( crystal_lattice );
+    crystal_structure.add_atom( Atom( Element( "C" ), position, "C1" ) );
+    crystal_structure.apply_space_group_symmetry();
+    return crystal_structure;
+}
+
+} // namespace
 
+void test_VoidsFinder( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for VoidsFinder." << std::endl;
+    const double atom_volume = ( 4.0 / 3.0 ) * CONSTANT_PI * std::pow( Element( "C" ).Van_der_Waals_radius(), 3 );
     {
-   // VoidsFinder dummy();
-   // test_suite.test_equality( dummy, , "VoidsFinder()" );
+    // Every point outside the atom can be reached by the probe
+    CrystalStructure crystal_structure = single_atom( CrystalLattice( 8.0, 8.0, 8.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ), Vector3D( 0.5, 0.5, 0.5 ) );
+    test_suite.test_equality_double( find_voids( crystal_structure, 1.2 ), crystal_structure.crystal_lattice().volume() - atom_volume, "find_voids() 01", 1.0 );
+    }
+    {
+    // Atom on the origin in a monoclinic cell, the spheres wrap around all faces
+    CrystalStructure crystal_structure = single_atom( CrystalLattice( 8.0, 9.0, 10.0, Angle::angle_90_degrees(), Angle::from_degrees( 100.0 ), Angle::angle_90_degrees() ), Vector3D( 0.0, 0.0, 0.0 ) );
+    test_suite.test_equality_double( find_voids( crystal_structure, 1.2 ), crystal_structure.crystal_lattice().volume() - atom_volume, "find_voids() 02", 1.0 );
+    }
+    {
+    // The probe does not fit anywhere
+    CrystalStructure crystal_structure = single_atom( CrystalLattice( 3.0, 3.0, 3.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ), Vector3D( 0.5, 0.5, 0.5 ) );
+    test_suite.test_equality_double( find_voids( crystal_structure, 1.2 ), 0.0, "find_voids() 03" );
+    }
+    {
+    CrystalStructure crystal_structure = single_atom( CrystalLattice( 8.0, 9.0, 10.0, Angle::angle_90_degrees(), Angle::from_degrees( 100.0 ), Angle::angle_90_degrees() ), Vector3D( 0.1, 0.2, 0.3 ) );
+    test_suite.test_equality_double( void_volume( crystal_structure ), crystal_structure.crystal_lattice().volume() - atom_volume, "void_volume() 01", 0.5 );
+    }
+    {
+    // Sampling one point per orbit must give the same answer as sampling the whole cell
+    CrystalStructure crystal_structure;
+    crystal_structure.set_crystal_lattice( CrystalLattice( 5.0, 6.0, 7.0, Angle::angle_90_degrees(), Angle::from_degrees( 95.0 ), Angle::angle_90_degrees() ) );
+    crystal_structure.set_space_group( SpaceGroup::P21c() );
+    crystal_structure.add_atom( Atom( Element( "C" ), Vector3D( 0.1, 0.2, 0.3 ), "C1" ) );
+    crystal_structure.add_atom( Atom( Element( "O" ), Vector3D( 0.3, 0.1, 0.2 ), "O1" ) );
+    crystal_structure.apply_space_group_symmetry();
+    const double volume = void_volume( crystal_structure );
+    crystal_structure.set_space_group( SpaceGroup() );
+    test_suite.test_equality_double( void_volume( crystal_structure ), volume, "void_volume() 02", 0.01 );
+    }
+    {
+    // A single void that percolates in three dimensions
+    CrystalStructure crystal_structure = single_atom( CrystalLattice( 8.0, 8.0, 8.0, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ), Vector3D( 0.5, 0.5, 0.5 ) );
+    std::vector< VoidDescription > voids = analyse_voids( crystal_structure );
+    test_suite.test_equality( voids.size(), size_t( 1 ), "analyse_voids() 01" );
+    test_suite.test_equality( voids[0].dimensionality(), size_t( 3 ), "analyse_voids() 02" );
+    test_suite.test_equality_double( voids[0].volume(), find_voids( crystal_structure ), "analyse_voids() 03" );
+    }
+    {
+    // Rods of atoms along c with channels in between
+    CrystalStructure crystal_structure = single_atom( CrystalLattice( 4.8, 4.8, 1.5, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ), Vector3D( 0.0, 0.0, 0.0 ) );
+    std::vector< VoidDescription > voids = analyse_voids( crystal_structure );
+    test_suite.test_equality( voids.size(), size_t( 1 ), "analyse_voids() 04" );
+    test_suite.test_equality( voids[0].dimensionality(), size_t( 1 ), "analyse_voids() 05" );
+    test_suite.test_equality_double( std::abs( voids[0].percolation_directions()[0].z() ), 1.0, "analyse_voids() 06" );
+    test_suite.test_equality_double( voids[0].percolation_directions()[0].x(), 0.0, "analyse_voids() 07" );
+    }
+    {
+    // Isolated cages
+    CrystalStructure crystal_structure = single_atom( CrystalLattice( 3.6, 3.6, 3.6, Angle::angle_90_degrees(), Angle::angle_90_degrees(), Angle::angle_90_degrees() ), Vector3D( 0.0, 0.0, 0.0 ) );
+    std::vector< VoidDescription > voids = analyse_voids( crystal_structure );
+    test_suite.test_equality( voids.size(), size_t( 1 ), "analyse_voids() 08" );
+    test_suite.test_equality( voids[0].dimensionality(), size_t( 0 ), "analyse_voids() 09" );
+    test_suite.test_equality( nearly_equal( voids[0].centroid(), Vector3D( 0.5, 0.5, 0.5 ), 0.05 ), true, "analyse_voids() 10" );
+    }
+    {
+    CrystalStructure crystal_structure = single_atom( CrystalLattice( 8.0, 9.0, 10.0, Angle::angle_90_degrees(), Angle::from_degrees( 100.0 ), Angle::angle_90_degrees() ), Vector3D( 0.1, 0.2, 0.3 ) );
+    DoubleWithESD serial = void_volume_quasi_Monte_Carlo( crystal_structure, 100.0, 1 );
+    DoubleWithESD parallel = void_volume_quasi_Monte_Carlo( crystal_structure, 100.0, 4 );
+    test_suite.test_equality_double( serial.value(), crystal_structure.crystal_lattice().volume() - atom_volume, "void_volume_quasi_Monte_Carlo() 01", 1.0 );
+    test_suite.test_equality( serial.value() == parallel.value(), true, "void_volume_quasi_Monte_Carlo() 02" );
+    test_suite.test_equality( serial.estimated_standard_deviation() == parallel.estimated_standard_deviation(), true, "void_volume_quasi_Monte_Carlo() 03" );
+    test_suite.test_equality( serial.estimated_standard_deviation() < 1.0, true, "void_volume_quasi_Monte_Carlo() 04" );
     }
-
 }
 
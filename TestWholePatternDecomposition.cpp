@@ -0,0 +1,115 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "WholePatternDecomposition.h"
+#include "CrystalStructure.h"
+#include "PeakShapeFunction.h"
+#include "PowderPattern.h"
+#include "PowderPatternCalculator.h"
+#include "ReflectionList.h"
+
+#include "TestFixtures.h"
+#include "TestSuite.h"
+
+#include <cmath>
+#include <iostream>
+
+void test_whole_pattern_decomposition( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for WholePatternDecomposition." << std::endl;
+    const CrystalStructure crystal_structure = P21c_test_structure( CrystalLattice( 7.1, 9.3, 11.7, Angle::angle_90_degrees(), Angle::from_degrees( 103.4 ), Angle::angle_90_degrees() ) );
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_two_theta_end( Angle::from_degrees( 35.0 ) );
+    powder_pattern_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    PowderPattern powder_pattern;
+    powder_pattern_calculator.calculate( powder_pattern );
+    powder_pattern.add_constant_background( 200.0 );
+    powder_pattern.recalculate_estimated_standard_deviations();
+    const ReflectionList reflection_list = powder_pattern_calculator.reflection_list();
+    const PseudoVoigtPeakShape peak_shape_function( 0.1, 0.9 );
+    {
+    WholePatternDecomposition whole_pattern_decomposition( powder_pattern, reflection_list, peak_shape_function );
+    whole_pattern_decomposition.set_nbackground_terms( 3 );
+    whole_pattern_decomposition.set_nthreads( 1 );
+    whole_pattern_decomposition.Pawley();
+    // The model is exact, so the fit must be perfect
+    test_suite.test_equality_double( whole_pattern_decomposition.Rwp(), 0.0, "WholePatternDecomposition::Pawley() Rwp", 1.0E-6 );
+    test_suite.test_equality_double( whole_pattern_decomposition.background_coefficient( 0 ), 200.0, "WholePatternDecomposition::Pawley() background", 1.0E-3 );
+    // The extracted F^2 values are proportional to the true ones, the strongest reflection fixes the scale
+    ReflectionList extracted = whole_pattern_decomposition.reflection_list();
+    size_t strongest( 0 );
+    for ( size_t i( 0 ); i != reflection_list.size(); ++i )
+    {
+        if ( reflection_list.F_squared( i ) * reflection_list.multiplicity( i ) > reflection_list.F_squared( strongest ) * reflection_list.multiplicity( strongest ) )
+            strongest = i;
+    }
+    const double scale = extracted.F_squared( strongest ) / reflection_list.F_squared( strongest );
+    bool all_correct( true );
+    for ( size_t i( 0 ); i != reflection_list.size(); ++i )
+    {
+        if ( reflection_list.d_spacing( i ) < 1.6 ) // Beyond 2theta = 35 degrees
+            continue;
+        if ( fabs( extracted.F_squared( i ) - scale * reflection_list.F_squared( i ) ) > 1.0E-4 * scale * reflection_list.F_squared( strongest ) )
+            all_correct = false;
+    }
+    test_suite.test_equality( all_correct, true, "WholePatternDecomposition::Pawley() intensities" );
+    // The same result on more threads
+    std::vector< double > intensities;
+    for ( size_t i( 0 ); i != whole_pattern_decomposition.nreflections(); ++i )
+        intensities.push_back( whole_pattern_decomposition.intensity( i ) );
+    whole_pattern_decomposition.set_nthreads( 2 );
+    whole_pattern_decomposition.Pawley();
+    bool are_equal( true );
+    for ( size_t i( 0 ); i != whole_pattern_decomposition.nreflections(); ++i )
+        are_equal = are_equal && ( whole_pattern_decomposition.intensity( i ) == intensities[i] );
+    test_suite.test_equality( are_equal, true, "WholePatternDecomposition::Pawley() independent of the number of threads" );
+    }
+    {
+    WholePatternDecomposition whole_pattern_decomposition( powder_pattern, reflection_list, peak_shape_function );
+    whole_pattern_decomposition.set_nbackground_terms( 3 );
+    whole_pattern_decomposition.le_bail( 50 );
+    test_suite.test_equality( whole_pattern_decomposition.Rwp() < 0.01, true, "WholePatternDecomposition::le_bail() Rwp" );
+    }
+    {
+    // Two reflections at exactly the same position share their intensity equally
+    ReflectionList coinciding;
+    coinciding.push_back( MillerIndices( 1, 0, 0 ), 2.0, 5.0, 2 );
+    coinciding.push_back( MillerIndices( 0, 1, 0 ), 2.0, 5.0, 2 );
+    coinciding.push_back( MillerIndices( 0, 0, 1 ), 1.0, 4.0, 2 );
+    PowderPatternCalculator coinciding_calculator( crystal_structure );
+    coinciding_calculator.set_two_theta_end( Angle::from_degrees( 30.0 ) );
+    coinciding_calculator.set_two_theta_step( Angle::from_degrees( 0.02 ) );
+    PowderPattern coinciding_pattern;
+    coinciding_calculator.calculate( coinciding, coinciding_pattern );
+    WholePatternDecomposition whole_pattern_decomposition( coinciding_pattern, coinciding, peak_shape_function );
+    whole_pattern_decomposition.Pawley();
+    test_suite.test_equality( whole_pattern_decomposition.nreflections(), size_t( 3 ), "WholePatternDecomposition::nreflections()" );
+    test_suite.test_equality_double( whole_pattern_decomposition.intensity( 0 ), whole_pattern_decomposition.intensity( 1 ), "WholePatternDecomposition::Pawley() coinciding reflections", 1.0E-6 * whole_pattern_decomposition.intensity( 0 ) );
+    test_suite.test_equality_double( whole_pattern_decomposition.Rwp(), 0.0, "WholePatternDecomposition::Pawley() coinciding reflections Rwp", 1.0E-6 );
+    }
+}
+
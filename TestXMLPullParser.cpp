@@ -0,0 +1,99 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "XMLPullParser.h"
+
+#include "TestSuite.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+void test_XML_pull_parser( TestSuite & test_suite )
+{
+    std::cout << "Now running tests for XMLPullParser." << std::endl;
+    {
+    XMLPullParser parser( "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                          "<!DOCTYPE XSD []>\n"
+                          "<!-- comment <with> tags -->\n"
+                          "<xrdMeasurement status = 'Completed'>\n"
+                          "  <positions axis=\"2Theta\" unit=\"deg\"><startPosition>5.0</startPosition></positions>\n"
+                          "  <Atom3d ID=\"566\" Mapping=\"952\" ImageOf=\"4\"/>\n"
+                          "  <comment><![CDATA[a < b]]></comment>\n"
+                          "  <entry>x &lt; y &amp;&#65;</entry>\n"
+                          "</xrdMeasurement>\n" );
+    XMLString value;
+    test_suite.test_equality( parser.next(), XMLPullParser::START_ELEMENT, "XMLPullParser::next() 01" );
+    test_suite.test_equality( parser.name() == "xrdMeasurement", true, "XMLPullParser::name() 01" );
+    test_suite.test_equality( parser.attribute( "status", value ), true, "XMLPullParser::attribute() 01" );
+    test_suite.test_equality( value.str(), std::string( "Completed" ), "XMLPullParser::attribute() 02" );
+    test_suite.test_equality( parser.next(), XMLPullParser::START_ELEMENT, "XMLPullParser::next() 02" );
+    test_suite.test_equality( parser.nattributes(), size_t( 2 ), "XMLPullParser::nattributes()" );
+    test_suite.test_equality( parser.attribute_value( 1 ).str(), std::string( "deg" ), "XMLPullParser::attribute_value()" );
+    test_suite.test_equality( parser.attribute( "ID", value ), false, "XMLPullParser::attribute() 03" );
+    test_suite.test_equality( parser.next(), XMLPullParser::START_ELEMENT, "XMLPullParser::next() 03" );
+    test_suite.test_equality( parser.depth(), size_t( 3 ), "XMLPullParser::depth()" );
+    test_suite.test_equality( parser.next(), XMLPullParser::TEXT, "XMLPullParser::next() 04" );
+    test_suite.test_equality( parser.text().str(), std::string( "5.0" ), "XMLPullParser::text() 01" );
+    test_suite.test_equality( parser.next(), XMLPullParser::END_ELEMENT, "XMLPullParser::next() 05" );
+    test_suite.test_equality( parser.name() == "startPosition", true, "XMLPullParser::name() 02" );
+    test_suite.test_equality( parser.next(), XMLPullParser::END_ELEMENT, "XMLPullParser::next() 06" );
+    // Empty-element tag
+    test_suite.test_equality( parser.next(), XMLPullParser::START_ELEMENT, "XMLPullParser::next() 07" );
+    test_suite.test_equality( parser.attribute( "ImageOf", value ), true, "XMLPullParser::attribute() 04" );
+    test_suite.test_equality( parser.next(), XMLPullParser::END_ELEMENT, "XMLPullParser::next() 08" );
+    test_suite.test_equality( parser.depth(), size_t( 1 ), "XMLPullParser::depth() empty element" );
+    test_suite.test_equality( parser.next(), XMLPullParser::START_ELEMENT, "XMLPullParser::next() 09" );
+    test_suite.test_equality( parser.next(), XMLPullParser::TEXT, "XMLPullParser::next() 10" );
+    test_suite.test_equality( parser.text().str(), std::string( "a < b" ), "XMLPullParser::text() CDATA" );
+    test_suite.test_equality( parser.next(), XMLPullParser::END_ELEMENT, "XMLPullParser::next() 11" );
+    test_suite.test_equality( parser.next(), XMLPullParser::START_ELEMENT, "XMLPullParser::next() 12" );
+    test_suite.test_equality( parser.next(), XMLPullParser::TEXT, "XMLPullParser::next() 13" );
+    test_suite.test_equality( parser.text().decoded(), std::string( "x < y &A" ), "XMLString::decoded()" );
+    test_suite.test_equality( parser.next(), XMLPullParser::END_ELEMENT, "XMLPullParser::next() 14" );
+    test_suite.test_equality( parser.next(), XMLPullParser::END_ELEMENT, "XMLPullParser::next() 15" );
+    test_suite.test_equality( parser.depth(), size_t( 0 ), "XMLPullParser::depth() end" );
+    test_suite.test_equality( parser.next(), XMLPullParser::END_OF_DOCUMENT, "XMLPullParser::next() 16" );
+    test_suite.test_equality( parser.next(), XMLPullParser::END_OF_DOCUMENT, "XMLPullParser::next() 17" );
+    }
+    {
+    XMLPullParser parser( "<a>\n<b c=\"1></a>" );
+    bool exception_thrown( false );
+    try
+    {
+        while ( parser.next() != XMLPullParser::END_OF_DOCUMENT )
+            ;
+    }
+    catch ( std::runtime_error & e )
+    {
+        exception_thrown = ( std::string( e.what() ).find( "line 2" ) != std::string::npos );
+    }
+    test_suite.test_equality( exception_thrown, true, "XMLPullParser unterminated attribute" );
+    }
+}
+
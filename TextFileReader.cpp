@@ -26,16 +26,21 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "TextFileReader.h"
+#include "Compression.h"
 #include "FileName.h"
 #include "Utilities.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
 // ********************************************************************************
 
 TextFileReader::TextFileReader( const FileName & file_name ):
-input_file_( file_name.full_name().c_str() ),
+input_file_( file_name.full_name().c_str(), std::ios::binary ),
+decompressing_buffer_(0),
+decompressed_input_(0),
+input_( &input_file_ ),
 line_number_(0),
 skip_empty_lines_(false),
 allow_single_quotes_(false),
@@ -43,14 +48,53 @@ push_back_last_line_(false)
 {
     if ( ! input_file_ )
        throw std::runtime_error( std::string( "TextFileReader::TextFileReader(): Could not open file " ) + file_name.full_name() );
+    char magic[4];
+    input_file_.read( magic, 4 );
+    const Compression compression = detect_compression( magic, static_cast< size_t >( input_file_.gcount() ) );
+    input_file_.clear();
+    input_file_.seekg( 0 );
+    if ( compression != NO_COMPRESSION )
+    {
+        decompressing_buffer_ = new DecompressingStreamBuffer( input_file_, compression );
+        decompressed_input_.rdbuf( decompressing_buffer_ );
+        input_ = &decompressed_input_;
+    }
+}
+
+// ********************************************************************************
+
+TextFileReader::TextFileReader( const std::vector< char > & contents ):
+input_buffer_( std::string( contents.begin(), contents.end() ) ),
+decompressing_buffer_(0),
+decompressed_input_(0),
+input_( &input_buffer_ ),
+line_number_(0),
+skip_empty_lines_(false),
+allow_single_quotes_(false),
+push_back_last_line_(false)
+{
+    const Compression compression = detect_compression( contents.data(), contents.size() );
+    if ( compression != NO_COMPRESSION )
+    {
+        decompressing_buffer_ = new DecompressingStreamBuffer( input_buffer_, compression );
+        decompressed_input_.rdbuf( decompressing_buffer_ );
+        input_ = &decompressed_input_;
+    }
+}
+
+// ********************************************************************************
+
+TextFileReader::~TextFileReader()
+{
+    delete decompressing_buffer_;
+    input_file_.close();
 }
 
 // ********************************************************************************
 
 bool TextFileReader::get_next_line( std::vector< std::string > & words )
 {
-    std::string line;
-    bool return_code = get_next_line( line );
+    bool return_code = read_next_line();
     if ( return_code )
     {
         if ( allow_single_quotes_ )
@@ -63,20 +107,44 @@ bool TextFileReader::get_next_line( std::vector< std::string > & words )
 
 // ********************************************************************************
 
+bool TextFileReader::get_next_line( Tokens & words )
+{
+    bool return_code = read_next_line();
+    if ( return_code )
+    {
+        if ( allow_single_quotes_ )
+            tokenise_2( line_, words );
+        else
+            tokenise( line_, words );
+    }
+    return return_code;
+}
+
+// ********************************************************************************
+
 bool TextFileReader::get_next_line( std::string & line )
+{
+    bool return_code = read_next_line();
+    if ( return_code )
+        line = line_;
+    return return_code;
+}
+
+// ********************************************************************************
+
+bool TextFileReader::read_next_line()
 {
     if ( push_back_last_line_ )
     {
-        line = line_;
         push_back_last_line_ = false;
         return true;
     }
     do
     {
-        if ( ! getline( input_file_, line_ ) )
+        if ( ! getline( *input_, line_ ) )
             return false;
-        // remove \r
-        line_ = remove( line_, '\r');
+        // remove \r, in place so that the capacity of line_ is reused
+        line_.erase( std::remove( line_.begin(), line_.end(), '\r' ), line_.end() );
         ++line_number_;
         // Skip comments
         bool is_comment( false );
@@ -84,7 +152,7 @@ bool TextFileReader::get_next_line( std::string & line )
         {
             if ( comment_identifiers_[i].size() <= line_.size() )
             {
-                 if ( line_.substr( 0, comment_identifiers_[i].size() ) == comment_identifiers_[i] )
+                 if ( line_.compare( 0, comment_identifiers_[i].size(), comment_identifiers_[i] ) == 0 )
                  {
                     is_comment = true;
                     break;
@@ -95,7 +163,6 @@ bool TextFileReader::get_next_line( std::string & line )
             continue;
         if ( skip_empty_lines_ && line_.empty() )
             continue;
-        line = line_;
         return true;
     }
     while ( true );
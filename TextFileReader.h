@@ -28,9 +28,12 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+class DecompressingStreamBuffer;
 class FileName;
+class Tokens;
 
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -42,6 +45,7 @@ class FileName;
 // MacOS >= 10   : \n
 // C++ in principle uses (e.g. absorbs upon reading) \n
 // This class deletes all \r characters from all input.
+// gzip- and zstd-compressed files are decompressed on the fly, see Compression.h.
 class TextFileReader
 {
 public:
@@ -50,10 +54,16 @@ public:
 
     explicit TextFileReader( const FileName & file_name );
 
-    ~TextFileReader() { input_file_.close(); }
+    // Reads from the contents of a file that has already been read, e.g. by FilePrefetcher.
+    explicit TextFileReader( const std::vector< char > & contents );
+
+    ~TextFileReader();
 
     bool get_next_line( std::vector< std::string > & words );
 
+    // As above, but without copying the words: they point into the current line and are valid until the next read.
+    bool get_next_line( Tokens & words );
+
     bool get_next_line( std::string & line );
 
     // Returns the current line (e.g. for error reporting)
@@ -74,16 +84,23 @@ public:
     // after the last line has been read
     // Perhaps we should instead add a function "peek_next_line()",
     // which allows you to look at the following line without going to the next line on the next read.
-    void push_back_last_line() const { push_back_last_line_ = true; }
+    void push_back_last_line() { push_back_last_line_ = true; }
 
 private:
     std::ifstream input_file_;
+    std::istringstream input_buffer_;
+    DecompressingStreamBuffer * decompressing_buffer_; // Only for compressed input
+    std::istream decompressed_input_;
+    std::istream * input_; // input_file_, input_buffer_ or decompressed_input_
     std::string line_;
     size_t line_number_;
     bool skip_empty_lines_;
     bool allow_single_quotes_; // Ugly name and quick hack to allow reading of .inp files without trying to interpret "'"
     std::vector< std::string > comment_identifiers_;
-    mutable bool push_back_last_line_;
+    bool push_back_last_line_;
+
+    // Reads the next line that is not skipped into line_.
+    bool read_next_line();
 };
 
 #endif // TEXTFILEREADER_H
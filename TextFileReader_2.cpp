@@ -26,15 +26,19 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "TextFileReader_2.h"
+#include "Compression.h"
 #include "FileName.h"
 #include "Utilities.h"
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <iostream>
 
 // ********************************************************************************
 
-TextFileReader_2::TextFileReader_2( const FileName & file_name )
+TextFileReader_2::TextFileReader_2( const FileName & file_name ):
+tracked_memory_("TextFileReader_2")
 {
     read_file( file_name );
 }
@@ -43,38 +47,95 @@ TextFileReader_2::TextFileReader_2( const FileName & file_name )
 
 void TextFileReader_2::read_file( const FileName & file_name )
 {
-    std::ifstream input_file( file_name.full_name().c_str() );
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
     if ( ! input_file )
        throw std::runtime_error( std::string( "TextFileReader::read_file(): Could not open file " ) + file_name.full_name() );
-    lines_.clear();
-    std::string line;
-    do
+    buffer_.clear();
+    line_starts_.clear();
+    input_file.seekg( 0, std::ios::end );
+    const std::streamoff file_size = input_file.tellg();
+    input_file.seekg( 0, std::ios::beg );
+    if ( file_size > 0 )
     {
-        if ( ! getline( input_file, line ) )
-        {
-            input_file.close();
-            return;
-        }
-        // remove \r
-        line = remove( line, '\r');
-        lines_.push_back( line );
+        buffer_.resize( static_cast<size_t>( file_size ) );
+        input_file.read( &buffer_[0], file_size );
+        buffer_.resize( static_cast<size_t>( input_file.gcount() ) );
     }
-    while ( true );
+    input_file.close();
+    const Compression compression = detect_compression( buffer_.data(), buffer_.size() );
+    if ( compression != NO_COMPRESSION )
+    {
+        std::vector< char > contents( buffer_.begin(), buffer_.end() );
+        std::string().swap( buffer_ );
+        decompress_if_compressed( contents );
+        buffer_.assign( contents.begin(), contents.end() );
+    }
+    index_lines();
+}
+
+// ********************************************************************************
+
+void TextFileReader_2::read_buffer( const std::vector< char > & contents )
+{
+    line_starts_.clear();
+    if ( detect_compression( contents.data(), contents.size() ) != NO_COMPRESSION )
+    {
+        std::vector< char > decompressed( contents );
+        decompress_if_compressed( decompressed );
+        buffer_.assign( decompressed.begin(), decompressed.end() );
+    }
+    else
+        buffer_.assign( contents.begin(), contents.end() );
+    index_lines();
+}
+
+// ********************************************************************************
+
+void TextFileReader_2::index_lines()
+{
+    // remove \r
+    buffer_.erase( std::remove( buffer_.begin(), buffer_.end(), '\r' ), buffer_.end() );
+    if ( buffer_.empty() )
+    {
+        tracked_memory_.set( buffer_.capacity() );
+        return;
+    }
+    if ( buffer_[ buffer_.size() - 1 ] != '\n' )
+        buffer_ += '\n';
+    line_starts_.push_back( 0 );
+    const char * begin = buffer_.data();
+    const char * end = begin + buffer_.size();
+    const char * newline = static_cast< const char * >( std::memchr( begin, '\n', end - begin ) );
+    while ( newline != 0 )
+    {
+        line_starts_.push_back( ( newline - begin ) + 1 );
+        newline = static_cast< const char * >( std::memchr( newline + 1, '\n', end - ( newline + 1 ) ) );
+    }
+    tracked_memory_.set( buffer_.capacity() + line_starts_.capacity() * sizeof( size_t ) );
+}
+
+// ********************************************************************************
+
+size_t TextFileReader_2::line_number( const size_t position ) const
+{
+    return ( std::upper_bound( line_starts_.begin(), line_starts_.end(), position ) - line_starts_.begin() ) - 1;
 }
 
 // ********************************************************************************
 
 // Starts search from line i
+// The whole buffer is searched at once rather than line by line, a word cannot match across lines
+// because lines never contain a newline.
 size_t TextFileReader_2::find( const std::string & word, const size_t i_start ) const
 {
     if ( word == "" )
        return std::string::npos;
-    for ( size_t i( i_start ); i != lines_.size(); ++i )
-    {
-        if ( lines_[i].find( word ) != std::string::npos )
-            return i;
-    }
-    return std::string::npos;
+    if ( ( i_start >= size() ) || ( word.find( '\n' ) != std::string::npos ) )
+       return std::string::npos;
+    const size_t position = buffer_.find( word, line_starts_[i_start] );
+    if ( position == std::string::npos )
+        return std::string::npos;
+    return line_number( position );
 }
 
 // ********************************************************************************
@@ -84,24 +145,25 @@ size_t TextFileReader_2::find_whole_word( const std::string & word, const size_t
 {
     if ( word == "" )
        return std::string::npos;
-    for ( size_t iLine( i_start ); iLine != lines_.size(); ++iLine )
+    if ( ( i_start >= size() ) || ( word.find( '\n' ) != std::string::npos ) )
+       return std::string::npos;
+    // @@ I probably need a "find_whole_word" class (so that "whole word characters" can be configured).
+    // If you get a match, and that turns out not to be a whole word, you still have to scan the rest
+    // of the string to see if a "whole word" match occurs later in the string.
+    // The newline that ends every line is not a whole-word character, so line boundaries are word boundaries
+    // and buffer_[iPos+word.length()] always exists.
+    size_t iPos = buffer_.find( word, line_starts_[i_start] );
+    while ( iPos != std::string::npos )
     {
-        // @@ I probably need a "find_whole_word" class (so that "whole word characters" can be configured).
-        // If you get a match, and that turns out not to be a whole word, you still have to scan the rest
-        // of the string to see if a "whole word" match occurs later in the string.
-        size_t iPos = lines_[iLine].find( word );
-        while ( iPos != std::string::npos )
-        {
-            bool start_ok( false );
-            bool end_ok( false );
-            if ( ( iPos == 0 ) || ( ! is_whole_word_character( lines_[iLine][iPos-1] ) ) )
-                start_ok = true;
-            if ( ( (iPos+word.length()) == lines_[iLine].length() ) || ( ! is_whole_word_character( lines_[iLine][iPos+word.length()] ) ) )
-                end_ok = true;
-            if ( start_ok && end_ok )
-                return iLine;
-            iPos = lines_[iLine].find( word, iPos+1 );
-        }
+        bool start_ok( false );
+        bool end_ok( false );
+        if ( ( iPos == 0 ) || ( ! is_whole_word_character( buffer_[iPos-1] ) ) )
+            start_ok = true;
+        if ( ! is_whole_word_character( buffer_[iPos+word.length()] ) )
+            end_ok = true;
+        if ( start_ok && end_ok )
+            return line_number( iPos );
+        iPos = buffer_.find( word, iPos+1 );
     }
     return std::string::npos;
 }
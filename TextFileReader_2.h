@@ -30,12 +30,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 class FileName;
 
+#include "Instrumentation.h"
+
 #include <fstream>
 #include <string>
 #include <vector>
 
 // Reads whole file and keeps it in memory
-// Only suitable for small files!
+// The file is stored as one block of characters plus the offsets of the starts of the lines,
+// so the memory used is little more than the size of the file itself.
 // Pretty much entirely identical in behaviour to a std::vector< std::string >
 // In keeping with C++ convention: zero-based.
 // New lines:
@@ -45,20 +48,30 @@ class FileName;
 // MacOS >= 10   : \n
 // C++ in principle uses (e.g. absorbs upon reading) \n
 // This class deletes all \r characters from all input.
+// gzip- and zstd-compressed files are decompressed, see Compression.h.
 class TextFileReader_2
 {
 public:
 
-    TextFileReader_2() {}
+    TextFileReader_2(): tracked_memory_("TextFileReader_2") {}
 
     explicit TextFileReader_2( const FileName & file_name );
 
     void read_file( const FileName & file_name );
 
-    size_t size() const { return lines_.size(); }
+    // As read_file(), for the contents of a file that has already been read, e.g. by FilePrefetcher.
+    void read_buffer( const std::vector< char > & contents );
+
+    size_t size() const { return line_starts_.empty() ? 0 : line_starts_.size() - 1; }
 
     // In keeping with C++ convention: zero-based.
-    std::string line( const size_t i ) const { return lines_[i]; }
+    std::string line( const size_t i ) const { return std::string( line_begin( i ), line_end( i ) ); }
+
+    // Access to the characters of line i without copying them, the range [line_begin( i ), line_end( i ) ) does not include the newline.
+    // The pointers are valid until the next call to read_file().
+    const char * line_begin( const size_t i ) const { return buffer_.data() + line_starts_[i]; }
+    const char * line_end( const size_t i ) const { return buffer_.data() + line_starts_[i+1] - 1; }
+    size_t line_length( const size_t i ) const { return line_starts_[i+1] - line_starts_[i] - 1; }
 
     // Starts search from line i
     // return a line number or std::string::npos
@@ -71,7 +84,15 @@ public:
     size_t find_whole_word( const std::string & word, const size_t i_start = 0 ) const;
 
 private:
-    std::vector< std::string > lines_;
+    std::string buffer_; // The whole file without \r, every line including the last one is terminated by \n
+    std::vector< size_t > line_starts_; // Offsets into buffer_, one more than there are lines: the last one is buffer_.size()
+    TrackedMemory tracked_memory_;
+
+    // Removes the \r characters from buffer_ and finds the starts of the lines, updates tracked_memory_.
+    void index_lines();
+
+    // Returns the line that contains the character at offset position in buffer_
+    size_t line_number( const size_t position ) const;
 };
 
 #endif // TEXTFILEREADER_2_H
@@ -26,24 +26,57 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "TextFileWriter.h"
+#include "Compression.h"
 #include "FileName.h"
 
 #include <stdexcept>
 
 // ********************************************************************************
 
-TextFileWriter::TextFileWriter( const FileName & file_name )
+TextFileWriter::TextFileWriter( const FileName & file_name ):
+buffer_( 1 << 16 ),
+compressing_buffer_(0),
+compressed_output_(0),
+output_( &output_file_ )
 {
-    output_file_.open( file_name.full_name().c_str() );
+    // Must be called before the file is opened
+    output_file_.rdbuf()->pubsetbuf( &buffer_[0], buffer_.size() );
+    const Compression compression = compression_from_extension( file_name );
+    output_file_.open( file_name.full_name().c_str(), ( compression == NO_COMPRESSION ) ? std::ios::out : ( std::ios::out | std::ios::binary ) );
     if ( ! output_file_ )
        throw std::runtime_error( std::string( "Could not open file " ) + file_name.full_name() );
+    if ( compression != NO_COMPRESSION )
+    {
+        compressing_buffer_ = new CompressingStreamBuffer( output_file_, compression );
+        compressed_output_.rdbuf( compressing_buffer_ );
+        output_ = &compressed_output_;
+    }
+}
+
+// ********************************************************************************
+
+TextFileWriter::~TextFileWriter()
+{
+    if ( compressing_buffer_ != 0 )
+    {
+        try
+        {
+            compressing_buffer_->finish();
+        }
+        catch ( std::exception & )
+        {
+            // Destructors must not throw, a truncated file is detected when it is read
+        }
+        delete compressing_buffer_;
+    }
+    output_file_.close();
 }
 
 // ********************************************************************************
 
 bool TextFileWriter::write_line( const std::string & line )
 {
-    output_file_ << line << std::endl;
+    *output_ << line << '\n';
     return true;
 }
 
@@ -51,7 +84,7 @@ bool TextFileWriter::write_line( const std::string & line )
 
 bool TextFileWriter::write_line()
 {
-    output_file_ << std::endl;
+    *output_ << '\n';
     return true;
 }
 
@@ -59,7 +92,7 @@ bool TextFileWriter::write_line()
 
 bool TextFileWriter::write( const std::string & text )
 {
-    output_file_ << text;
+    *output_ << text;
     return true;
 }
 
@@ -28,11 +28,16 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+class CompressingStreamBuffer;
 class FileName;
 
 #include <fstream>
 #include <string>
+#include <vector>
 
+// Output is buffered in a large buffer and only flushed when the buffer is full, when flush() is called
+// or when the writer goes out of scope.
+// A file name with the extension "gz" or "zst" gives gzip or zstd output, see Compression.h.
 class TextFileWriter
 {
 public:
@@ -41,7 +46,7 @@ public:
 
     explicit TextFileWriter( const FileName & file_name );
 
-    ~TextFileWriter() { output_file_.close(); }
+    ~TextFileWriter();
 
     // Adds newline at end of line.
     bool write_line( const std::string & line );
@@ -52,8 +57,15 @@ public:
     // No newline is added.
     bool write( const std::string & text );
 
+    // For compressed output, everything written so far can be decompressed after a flush(), at some cost in compression.
+    void flush() { output_->flush(); }
+
 private:
+    std::vector< char > buffer_; // Must be declared before output_file_
     std::ofstream output_file_;
+    CompressingStreamBuffer * compressing_buffer_; // Only for compressed output
+    std::ostream compressed_output_;
+    std::ostream * output_; // output_file_ or compressed_output_
 };
 
 #endif // TEXTFILEWRITER_H
@@ -0,0 +1,396 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "ThreadPool.h"
+
+#include <cmath>
+#include <fstream>
+#include <sched.h>
+#include <stdexcept>
+
+namespace
+{
+
+// 0 until it has been determined.
+std::atomic< size_t > global_max_concurrency( 0 );
+std::atomic< bool > global_thread_pool_created( false );
+
+// The queue of the worker that is running on this thread, to submit tasks of tasks to.
+thread_local ThreadPool * current_thread_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+// The CPU quota of the cgroup as a number of CPUs, 0.0 if there is no limit. Inside a container the cgroup
+// namespace makes the container's own cgroup appear at /sys/fs/cgroup.
+double cgroup_CPU_quota()
+{
+    // cgroup v2: "max 100000" or "<quota> <period>"
+    {
+    std::ifstream input( "/sys/fs/cgroup/cpu.max" );
+    std::string quota;
+    double period;
+    if ( input >> quota >> period )
+        return ( ( quota == "max" ) || ( period <= 0.0 ) ) ? 0.0 : std::stod( quota ) / period;
+    }
+    // cgroup v1: the quota is -1 if there is no limit
+    const char * directories[] = { "/sys/fs/cgroup/cpu/", "/sys/fs/cgroup/cpu,cpuacct/" };
+    for ( size_t i( 0 ); i != 2; ++i )
+    {
+        std::ifstream quota_input( std::string( directories[i] ) + "cpu.cfs_quota_us" );
+        std::ifstream period_input( std::string( directories[i] ) + "cpu.cfs_period_us" );
+        double quota;
+        double period;
+        if ( ( quota_input >> quota ) && ( period_input >> period ) )
+            return ( ( quota <= 0.0 ) || ( period <= 0.0 ) ) ? 0.0 : quota / period;
+    }
+    return 0.0;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+size_t available_cpus()
+{
+    size_t result = std::thread::hardware_concurrency();
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    if ( sched_getaffinity( 0, sizeof( cpu_set ), &cpu_set ) == 0 )
+        result = CPU_COUNT( &cpu_set );
+#endif
+    const double quota = cgroup_CPU_quota();
+    if ( quota > 0.0 )
+        result = std::min( result, static_cast< size_t >( std::ceil( quota ) ) );
+    return std::max( result, size_t( 1 ) );
+}
+
+// ********************************************************************************
+
+size_t max_concurrency()
+{
+    size_t result = global_max_concurrency;
+    if ( result == 0 )
+    {
+        result = available_cpus();
+        size_t expected( 0 );
+        if ( ! global_max_concurrency.compare_exchange_strong( expected, result ) )
+            result = expected;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+void set_max_concurrency( const size_t max_concurrency )
+{
+    if ( max_concurrency == 0 )
+        throw std::runtime_error( "set_max_concurrency(): the limit must be at least 1." );
+    if ( global_thread_pool_created )
+        throw std::runtime_error( "set_max_concurrency(): the global thread pool is already in use." );
+    global_max_concurrency = max_concurrency;
+}
+
+// ********************************************************************************
+
+ThreadPool::ThreadPool( const size_t nworkers ):
+queues_( nworkers + 1 ),
+nqueued_(0),
+next_queue_(0),
+stop_(false)
+{
+    workers_.reserve( nworkers );
+    for ( size_t i( 0 ); i != nworkers; ++i )
+        workers_.push_back( std::thread( &ThreadPool::work, this, i ) );
+}
+
+// ********************************************************************************
+
+ThreadPool::~ThreadPool()
+{
+    {
+    std::lock_guard< std::mutex > lock( sleep_mutex_ );
+    stop_ = true;
+    }
+    wake_up_.notify_all();
+    for ( size_t i( 0 ); i != workers_.size(); ++i )
+        workers_[i].join();
+    // Without workers, the remaining tasks are run here
+    while ( run_one_task() )
+        ;
+}
+
+// ********************************************************************************
+
+void ThreadPool::submit( Task task )
+{
+    // Counted before it is queued, so that a worker that sees the count may have to look twice but never sleeps while there is a task
+    {
+    std::lock_guard< std::mutex > lock( sleep_mutex_ );
+    ++nqueued_;
+    }
+    size_t iqueue = workers_.size();
+    if ( current_thread_pool == this )
+        iqueue = current_queue;
+    {
+    std::lock_guard< std::mutex > lock( queues_[ iqueue ].mutex_ );
+    queues_[ iqueue ].tasks_.push_back( std::move( task ) );
+    }
+    wake_up_.notify_one();
+}
+
+// ********************************************************************************
+
+bool ThreadPool::run_one_task()
+{
+    Task task;
+    if ( ! take_task( ( current_thread_pool == this ) ? current_queue : workers_.size(), task ) )
+        return false;
+    task();
+    return true;
+}
+
+// ********************************************************************************
+
+ThreadPool & ThreadPool::global()
+{
+    // Never destroyed, so that parallel_for() can still be used while static objects are destroyed at exit.
+    static ThreadPool * thread_pool = new ThreadPool( max_concurrency() - 1 );
+    global_thread_pool_created = true;
+    return *thread_pool;
+}
+
+// ********************************************************************************
+
+bool ThreadPool::take_task( const size_t iqueue, Task & task )
+{
+    if ( nqueued_ == 0 )
+        return false;
+    if ( pop_back( queues_[ iqueue ], task ) )
+        return true;
+    const size_t shared_queue = workers_.size();
+    if ( ( iqueue != shared_queue ) && pop_front( queues_[ shared_queue ], task ) )
+        return true;
+    // Steal, starting at a different worker each time
+    const size_t start = next_queue_++;
+    for ( size_t i( 0 ); i != workers_.size(); ++i )
+    {
+        const size_t victim = ( start + i ) % workers_.size();
+        if ( ( victim != iqueue ) && pop_front( queues_[ victim ], task ) )
+            return true;
+    }
+    return false;
+}
+
+// ********************************************************************************
+
+bool ThreadPool::pop_back( Queue & queue, Task & task )
+{
+    std::lock_guard< std::mutex > lock( queue.mutex_ );
+    if ( queue.tasks_.empty() )
+        return false;
+    task = std::move( queue.tasks_.back() );
+    queue.tasks_.pop_back();
+    --nqueued_;
+    return true;
+}
+
+// ********************************************************************************
+
+bool ThreadPool::pop_front( Queue & queue, Task & task )
+{
+    std::lock_guard< std::mutex > lock( queue.mutex_ );
+    if ( queue.tasks_.empty() )
+        return false;
+    task = std::move( queue.tasks_.front() );
+    queue.tasks_.pop_front();
+    --nqueued_;
+    return true;
+}
+
+// ********************************************************************************
+
+void ThreadPool::work( const size_t iqueue )
+{
+    current_thread_pool = this;
+    current_queue = iqueue;
+    for (;;)
+    {
+        Task task;
+        if ( take_task( iqueue, task ) )
+        {
+            task();
+            continue;
+        }
+        std::unique_lock< std::mutex > lock( sleep_mutex_ );
+        wake_up_.wait( lock, [this]() { return stop_ || ( nqueued_ != 0 ); } );
+        if ( stop_ && ( nqueued_ == 0 ) )
+            return;
+    }
+}
+
+// ********************************************************************************
+
+TaskGroup::TaskGroup( ThreadPool & thread_pool ):
+thread_pool_(thread_pool),
+npending_(0),
+error_occurred_(false)
+{
+}
+
+// ********************************************************************************
+
+TaskGroup::~TaskGroup()
+{
+    wait_without_throwing();
+}
+
+// ********************************************************************************
+
+void TaskGroup::run( const ThreadPool::Task & task )
+{
+    ++npending_;
+    thread_pool_.submit( [this, task]()
+    {
+        if ( ! error_occurred_ )
+        {
+            try
+            {
+                task();
+            }
+            catch ( std::exception & e )
+            {
+                if ( ! error_occurred_.exchange( true ) )
+                    error_message_ = e.what();
+            }
+        }
+        // The last access to this object, wait() may return as soon as npending_ is 0
+        std::lock_guard< std::mutex > lock( mutex_ );
+        if ( --npending_ == 0 )
+            finished_.notify_all();
+    } );
+}
+
+// ********************************************************************************
+
+void TaskGroup::wait()
+{
+    wait_without_throwing();
+    if ( error_occurred_ )
+    {
+        error_occurred_ = false;
+        throw std::runtime_error( error_message_ );
+    }
+}
+
+// ********************************************************************************
+
+void TaskGroup::wait_without_throwing()
+{
+    while ( npending_ != 0 )
+    {
+        if ( thread_pool_.run_one_task() )
+            continue;
+        // All tasks of this group have been taken and are running on other threads
+        std::unique_lock< std::mutex > lock( mutex_ );
+        finished_.wait( lock, [this]() { return npending_ == 0; } );
+    }
+    // The task that decremented npending_ to 0 may still hold mutex_
+    std::lock_guard< std::mutex > lock( mutex_ );
+}
+
+// ********************************************************************************
+
+size_t TaskGraph::add_task( const ThreadPool::Task & task )
+{
+    tasks_.push_back( task );
+    successors_.push_back( std::vector< size_t >() );
+    npredecessors_.push_back( 0 );
+    return tasks_.size() - 1;
+}
+
+// ********************************************************************************
+
+void TaskGraph::add_dependency( const size_t before, const size_t after )
+{
+    if ( ( before >= size() ) || ( after >= size() ) || ( before == after ) )
+        throw std::runtime_error( "TaskGraph::add_dependency(): invalid task index." );
+    successors_[ before ].push_back( after );
+    ++npredecessors_[ after ];
+}
+
+// ********************************************************************************
+
+void TaskGraph::run( ThreadPool & thread_pool )
+{
+    // Check for cycles by removing tasks without predecessors until none are left
+    {
+    std::vector< size_t > npredecessors( npredecessors_ );
+    std::vector< size_t > ready;
+    for ( size_t i( 0 ); i != size(); ++i )
+    {
+        if ( npredecessors[i] == 0 )
+            ready.push_back( i );
+    }
+    size_t nremoved( 0 );
+    while ( ! ready.empty() )
+    {
+        const size_t i = ready.back();
+        ready.pop_back();
+        ++nremoved;
+        for ( size_t j( 0 ); j != successors_[i].size(); ++j )
+        {
+            if ( --npredecessors[ successors_[i][j] ] == 0 )
+                ready.push_back( successors_[i][j] );
+        }
+    }
+    if ( nremoved != size() )
+        throw std::runtime_error( "TaskGraph::run(): the dependencies contain a cycle." );
+    }
+    std::vector< std::atomic< size_t > > npredecessors_left( size() );
+    for ( size_t i( 0 ); i != size(); ++i )
+        npredecessors_left[i] = npredecessors_[i];
+    TaskGroup task_group( thread_pool );
+    std::function< void( size_t ) > start = [&]( const size_t i )
+    {
+        task_group.run( [&, i]()
+        {
+            tasks_[i]();
+            // Only reached if the task did not throw
+            for ( size_t j( 0 ); j != successors_[i].size(); ++j )
+            {
+                if ( --npredecessors_left[ successors_[i][j] ] == 0 )
+                    start( successors_[i][j] );
+            }
+        } );
+    };
+    for ( size_t i( 0 ); i != size(); ++i )
+    {
+        if ( npredecessors_[i] == 0 )
+            start( i );
+    }
+    task_group.wait();
+}
+
@@ -0,0 +1,170 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef> // For definition of size_t
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The number of CPUs this process may use: the CPUs in its affinity mask, limited by the CPU quota of its cgroup
+// (cpu.max for cgroup v2, cpu.cfs_quota_us / cpu.cfs_period_us for v1), rounded up. At least 1.
+size_t available_cpus();
+
+// The global limit on the number of threads that work at the same time in parallel_for(), parallel_reduce(), TaskGroup and TaskGraph,
+// including the calling thread. The default is available_cpus(). Can only be changed before the global thread pool is first used.
+size_t max_concurrency();
+void set_max_concurrency( const size_t max_concurrency );
+
+/*
+  A pool of worker threads with work stealing. Each worker has its own deque of tasks: it takes tasks from the back of its own
+  deque, tasks submitted from outside the pool go to a shared deque, and a worker that runs out of tasks steals from the front
+  of the other deques. Tasks that are submitted by a task therefore tend to run on the same thread, while the oldest (usually the
+  largest) tasks are the ones that are stolen.
+
+  A thread that waits for tasks (TaskGroup::wait()) runs queued tasks in the meantime, so tasks can start and wait for
+  other tasks without deadlocking the pool, but tasks must not block on anything else that only another task can provide
+  (use dedicated threads with BoundedQueue for that, as ScreeningPipeline does).
+*/
+class ThreadPool
+{
+public:
+    typedef std::function< void() > Task;
+
+    // nworkers can be 0, then all tasks are run by the threads that wait for them.
+    explicit ThreadPool( const size_t nworkers );
+
+    // Runs the tasks that are still queued, then stops the workers.
+    ~ThreadPool();
+
+    size_t nworkers() const { return workers_.size(); }
+
+    // Thread-safe. Exceptions must be caught by the task itself, TaskGroup does that.
+    void submit( Task task );
+
+    // Runs one queued task in the calling thread. Returns false if there was none.
+    bool run_one_task();
+
+    // The pool that parallel_for() etc. use, with max_concurrency() - 1 workers because the calling thread also works.
+    static ThreadPool & global();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex_;
+        std::deque< Task > tasks_;
+    };
+
+    // One per worker, the last one is for tasks submitted from outside the pool.
+    std::vector< Queue > queues_;
+    std::vector< std::thread > workers_;
+    std::atomic< size_t > nqueued_;
+    std::atomic< size_t > next_queue_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_;
+    bool stop_;
+
+    // Own deque first (from the back), then the shared deque, then the other workers (from the front).
+    bool take_task( const size_t iqueue, Task & task );
+    bool pop_back( Queue & queue, Task & task );
+    bool pop_front( Queue & queue, Task & task );
+    void work( const size_t iqueue );
+
+    // Not copyable
+    ThreadPool( const ThreadPool & );
+    ThreadPool & operator=( const ThreadPool & );
+};
+
+/*
+  A set of tasks that are run on a ThreadPool and waited for together.
+  If a task throws, wait() re-throws the first exception as std::runtime_error once all tasks have finished.
+*/
+class TaskGroup
+{
+public:
+
+    explicit TaskGroup( ThreadPool & thread_pool = ThreadPool::global() );
+
+    // Waits for the tasks that are still running, exceptions are discarded.
+    ~TaskGroup();
+
+    void run( const ThreadPool::Task & task );
+
+    // Runs queued tasks of the pool in the calling thread until all tasks of this group have finished.
+    void wait();
+
+private:
+    ThreadPool & thread_pool_;
+    std::atomic< size_t > npending_;
+    std::atomic< bool > error_occurred_;
+    std::string error_message_;
+    std::mutex mutex_;
+    std::condition_variable finished_;
+
+    void wait_without_throwing();
+
+    // Not copyable
+    TaskGroup( const TaskGroup & );
+    TaskGroup & operator=( const TaskGroup & );
+};
+
+/*
+  Tasks with dependencies, e.g. the stages of a pipeline for a number of batches. Each task is submitted to the thread pool
+  as soon as all tasks that it depends on have finished. If a task throws, the tasks that depend on it are not run and
+  run() re-throws the first exception as std::runtime_error once the tasks that had already been started have finished.
+*/
+class TaskGraph
+{
+public:
+
+    // Returns the index of the task.
+    size_t add_task( const ThreadPool::Task & task );
+
+    // Task after is not started before task before has finished.
+    void add_dependency( const size_t before, const size_t after );
+
+    size_t size() const { return tasks_.size(); }
+
+    // Runs all tasks and returns when they have finished. Can be called more than once. Throws if the dependencies contain a cycle.
+    void run( ThreadPool & thread_pool = ThreadPool::global() );
+
+private:
+    std::vector< ThreadPool::Task > tasks_;
+    std::vector< std::vector< size_t > > successors_;
+    std::vector< size_t > npredecessors_;
+};
+
+#endif // THREADPOOL_H
+
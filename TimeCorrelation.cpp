@@ -0,0 +1,186 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "TimeCorrelation.h"
+#include "Checkpoint.h"
+#include "FFT.h"
+
+#include <algorithm>
+#include <complex>
+#include <stdexcept>
+
+// ********************************************************************************
+
+std::vector< double > autocorrelation_function( const std::vector< double > & signal )
+{
+    const size_t n = signal.size();
+    // Zero-padding to at least 2N prevents the circular correlation from wrapping around
+    std::vector< std::complex< double > > data( next_power_of_two( 2 * n ), std::complex< double >( 0.0, 0.0 ) );
+    for ( size_t i( 0 ); i != n; ++i )
+        data[i] = std::complex< double >( signal[i], 0.0 );
+    fast_Fourier_transform( data );
+    for ( size_t i( 0 ); i != data.size(); ++i )
+        data[i] = std::complex< double >( std::norm( data[i] ), 0.0 );
+    fast_Fourier_transform( data, true );
+    std::vector< double > result( n );
+    for ( size_t i( 0 ); i != n; ++i )
+        result[i] = data[i].real() / ( n - i );
+    return result;
+}
+
+// ********************************************************************************
+
+AutocorrelationAccumulator::AutocorrelationAccumulator():
+nseries_(0),
+window_(0),
+stride_(0),
+subtract_mean_(false),
+nvalues_(0),
+nwindows_(0),
+npadded_(0),
+tracked_memory_("AutocorrelationAccumulator")
+{
+}
+
+// ********************************************************************************
+
+AutocorrelationAccumulator::AutocorrelationAccumulator( const size_t nseries, const size_t window, const size_t stride, const bool subtract_mean ):
+nseries_(nseries),
+window_(window),
+stride_( ( stride == 0 ) ? std::max( window / 2, static_cast<size_t>( 1 ) ) : stride ),
+subtract_mean_(subtract_mean),
+nvalues_(0),
+nwindows_(0),
+npadded_( next_power_of_two( 2 * window ) ),
+buffer_( 3 * nseries * window, 0.0 ),
+sum_( window, 0.0 ),
+tracked_memory_("AutocorrelationAccumulator")
+{
+    if ( window == 0 )
+        throw std::runtime_error( "AutocorrelationAccumulator::AutocorrelationAccumulator(): window must be at least 1." );
+    tracked_memory_.set( ( buffer_.capacity() + sum_.capacity() ) * sizeof( double ) );
+}
+
+// ********************************************************************************
+
+void AutocorrelationAccumulator::add_values( const std::vector< Vector3D > & values )
+{
+    if ( values.size() != nseries_ )
+        throw std::runtime_error( "AutocorrelationAccumulator::add_values(): wrong number of values." );
+    const size_t t = nvalues_ % window_;
+    for ( size_t i( 0 ); i != nseries_; ++i )
+    {
+        for ( size_t k( 0 ); k != 3; ++k )
+            buffer_[ ( 3 * i + k ) * window_ + t ] = values[i].value( k );
+    }
+    ++nvalues_;
+    if ( ( nvalues_ >= window_ ) && ( ( ( nvalues_ - window_ ) % stride_ ) == 0 ) )
+        analyse_window();
+}
+
+// ********************************************************************************
+
+// The correlation functions of all series and components are summed, so only the power spectra
+// have to be summed and a single inverse transform is needed per window.
+void AutocorrelationAccumulator::analyse_window()
+{
+    const size_t first = nvalues_ % window_; // Oldest value in the ring buffer
+    std::vector< std::complex< double > > data( npadded_ );
+    std::vector< double > power_spectrum( npadded_, 0.0 );
+    for ( size_t i( 0 ); i != 3 * nseries_; ++i )
+    {
+        const double * series = &buffer_[ i * window_ ];
+        double mean( 0.0 );
+        if ( subtract_mean_ )
+        {
+            for ( size_t t( 0 ); t != window_; ++t )
+                mean += series[t];
+            mean /= window_;
+        }
+        for ( size_t t( 0 ); t != window_; ++t )
+            data[t] = std::complex< double >( series[ ( first + t ) % window_ ] - mean, 0.0 );
+        for ( size_t t( window_ ); t != npadded_; ++t )
+            data[t] = std::complex< double >( 0.0, 0.0 );
+        fast_Fourier_transform( data );
+        for ( size_t j( 0 ); j != npadded_; ++j )
+            power_spectrum[j] += std::norm( data[j] );
+    }
+    for ( size_t j( 0 ); j != npadded_; ++j )
+        data[j] = std::complex< double >( power_spectrum[j], 0.0 );
+    fast_Fourier_transform( data, true );
+    for ( size_t tau( 0 ); tau != window_; ++tau )
+        sum_[tau] += data[tau].real() / ( window_ - tau );
+    ++nwindows_;
+}
+
+// ********************************************************************************
+
+std::vector< double > AutocorrelationAccumulator::correlation_function() const
+{
+    if ( nwindows_ == 0 )
+        throw std::runtime_error( "AutocorrelationAccumulator::correlation_function(): fewer values than the window length have been added." );
+    std::vector< double > result( sum_ );
+    const double factor = 1.0 / ( static_cast<double>( nwindows_ ) * static_cast<double>( nseries_ ) );
+    for ( size_t tau( 0 ); tau != window_; ++tau )
+        result[tau] *= factor;
+    return result;
+}
+
+// ********************************************************************************
+
+void AutocorrelationAccumulator::save( CheckpointWriter & checkpoint_writer ) const
+{
+    checkpoint_writer.write( nseries_ );
+    checkpoint_writer.write( window_ );
+    checkpoint_writer.write( stride_ );
+    checkpoint_writer.write( subtract_mean_ );
+    checkpoint_writer.write( nvalues_ );
+    checkpoint_writer.write( nwindows_ );
+    checkpoint_writer.write( npadded_ );
+    checkpoint_writer.write( buffer_ );
+    checkpoint_writer.write( sum_ );
+}
+
+// ********************************************************************************
+
+void AutocorrelationAccumulator::load( CheckpointReader & checkpoint_reader )
+{
+    checkpoint_reader.read( nseries_ );
+    checkpoint_reader.read( window_ );
+    checkpoint_reader.read( stride_ );
+    checkpoint_reader.read( subtract_mean_ );
+    checkpoint_reader.read( nvalues_ );
+    checkpoint_reader.read( nwindows_ );
+    checkpoint_reader.read( npadded_ );
+    checkpoint_reader.read( buffer_ );
+    checkpoint_reader.read( sum_ );
+    tracked_memory_.set( ( buffer_.capacity() + sum_.capacity() ) * sizeof( double ) );
+}
+
+// ********************************************************************************
+
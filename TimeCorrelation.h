@@ -0,0 +1,93 @@
+#ifndef TIMECORRELATION_H
+#define TIMECORRELATION_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CheckpointReader;
+class CheckpointWriter;
+
+#include "Instrumentation.h"
+#include "Vector3D.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+// Returns C(tau) = < x(t) x(t+tau) > for tau = 0 ... N-1, averaged over all N-tau available pairs of x.
+// Calculated with a zero-padded FFT, so the cost is O( N log N ) instead of O( N^2 ).
+std::vector< double > autocorrelation_function( const std::vector< double > & signal );
+
+/*
+  Time autocorrelation function of a set of 3D vectors series, e.g. the velocities of all atoms in an MD trajectory,
+  accumulated over a sliding window so that the trajectory does not have to be stored.
+  
+  Only the last window frames are kept. Every stride frames the autocorrelation functions of the window are calculated
+  with an FFT. The result is C(tau) = < v_i(t) . v_i(t+tau) >, averaged over all series i, all windows and all available t.
+  With subtract_mean, the average of each series over the window is subtracted first, which is what is needed for
+  displacements from an average position.
+*/
+class AutocorrelationAccumulator
+{
+public:
+
+    AutocorrelationAccumulator();
+
+    // stride = 0 means window/2.
+    AutocorrelationAccumulator( const size_t nseries, const size_t window, const size_t stride = 0, const bool subtract_mean = false );
+
+    // values must contain exactly one vector per series.
+    void add_values( const std::vector< Vector3D > & values );
+
+    size_t window() const { return window_; }
+
+    // The number of windows that have been analysed.
+    size_t nwindows() const { return nwindows_; }
+
+    // C(tau) for tau = 0 ... window-1, in units of frames.
+    // Throws std::runtime_error if fewer than window values have been added.
+    std::vector< double > correlation_function() const;
+
+    // The state, for a checkpoint of a long calculation.
+    void save( CheckpointWriter & checkpoint_writer ) const;
+    void load( CheckpointReader & checkpoint_reader );
+
+private:
+    size_t nseries_;
+    size_t window_;
+    size_t stride_;
+    bool subtract_mean_;
+    size_t nvalues_;
+    size_t nwindows_;
+    size_t npadded_;
+    std::vector< double > buffer_; // Ring buffer, [ series ][ x, y, z ][ time ]
+    std::vector< double > sum_;
+    TrackedMemory tracked_memory_;
+
+    void analyse_window();
+};
+
+#endif // TIMECORRELATION_H
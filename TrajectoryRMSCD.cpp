@@ -0,0 +1,275 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "TrajectoryRMSCD.h"
+#include "3DCalculations.h"
+#include "FileName.h"
+#include "MathFunctions.h"
+#include "ParallelFor.h"
+#include "TextFileWriter.h"
+#include "TrajectorySource.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+/*
+  A static 3D k-d tree for nearest-neighbour queries. The points are stored as arrays of x, y and z, sorted such that
+  the tree is implicit: the root of a range [begin,end> is the point in the middle, the smaller coordinates along
+  its axis are to its left.
+*/
+class TrajectoryRMSCD::KDTree
+{
+public:
+
+    explicit KDTree( const std::vector< Vector3D > & points )
+    {
+        std::vector< Vector3D > sorted( points );
+        axes_.assign( sorted.size(), 0 );
+        build( sorted, 0, sorted.size() );
+        for ( size_t i( 0 ); i != sorted.size(); ++i )
+        {
+            coordinates_[0].push_back( sorted[i].x() );
+            coordinates_[1].push_back( sorted[i].y() );
+            coordinates_[2].push_back( sorted[i].z() );
+        }
+    }
+
+    // The squared distance to the nearest point, infinity if there are no points.
+    double nearest_distance2( const Vector3D & point ) const
+    {
+        const double query[3] = { point.x(), point.y(), point.z() };
+        double result = std::numeric_limits< double >::infinity();
+        search( query, 0, axes_.size(), result );
+        return result;
+    }
+
+private:
+    // Ranges of at most this many points are searched point by point
+    static const size_t leaf_size = 8;
+    std::vector< double > coordinates_[3];
+    std::vector< unsigned char > axes_; // Split axis of the root of each range, stored at the index of that root
+
+    void build( std::vector< Vector3D > & points, const size_t begin, const size_t end )
+    {
+        if ( end - begin <= leaf_size )
+            return;
+        // Split along the axis with the largest spread
+        Vector3D minimum = points[begin];
+        Vector3D maximum = points[begin];
+        for ( size_t i( begin + 1 ); i != end; ++i )
+        {
+            for ( size_t k( 0 ); k != 3; ++k )
+            {
+                minimum.set_value( k, std::min( minimum.value( k ), points[i].value( k ) ) );
+                maximum.set_value( k, std::max( maximum.value( k ), points[i].value( k ) ) );
+            }
+        }
+        const Vector3D spread = maximum - minimum;
+        const size_t axis = ( spread.x() >= spread.y() ) ? ( ( spread.x() >= spread.z() ) ? 0 : 2 ) : ( ( spread.y() >= spread.z() ) ? 1 : 2 );
+        const size_t middle = begin + ( end - begin ) / 2;
+        std::nth_element( points.begin() + begin, points.begin() + middle, points.begin() + end,
+                          [axis]( const Vector3D & lhs, const Vector3D & rhs ) { return lhs.value( axis ) < rhs.value( axis ); } );
+        axes_[middle] = static_cast< unsigned char >( axis );
+        build( points, begin, middle );
+        build( points, middle + 1, end );
+    }
+
+    double distance2( const double query[3], const size_t i ) const
+    {
+        return square( query[0] - coordinates_[0][i] ) + square( query[1] - coordinates_[1][i] ) + square( query[2] - coordinates_[2][i] );
+    }
+
+    void search( const double query[3], const size_t begin, const size_t end, double & result ) const
+    {
+        if ( end - begin <= leaf_size )
+        {
+            for ( size_t i( begin ); i != end; ++i )
+                result = std::min( result, distance2( query, i ) );
+            return;
+        }
+        const size_t middle = begin + ( end - begin ) / 2;
+        result = std::min( result, distance2( query, middle ) );
+        const size_t axis = axes_[middle];
+        const double difference = query[axis] - coordinates_[axis][middle];
+        if ( difference < 0.0 )
+        {
+            search( query, begin, middle, result );
+            if ( square( difference ) < result )
+                search( query, middle + 1, end, result );
+        }
+        else
+        {
+            search( query, middle + 1, end, result );
+            if ( square( difference ) < result )
+                search( query, begin, middle, result );
+        }
+    }
+};
+
+// ********************************************************************************
+
+TrajectoryRMSCD::TrajectoryRMSCD( const CrystalStructure & reference, const Matching matching ):
+matching_(matching),
+nthreads_(0),
+reference_lattice_(reference.crystal_lattice())
+{
+    const size_t natoms = reference.natoms();
+    if ( matching_ == SAME_ORDER )
+    {
+        x_.reserve( natoms );
+        y_.reserve( natoms );
+        z_.reserve( natoms );
+        elements_.reserve( natoms );
+        for ( size_t i( 0 ); i != natoms; ++i )
+        {
+            const Vector3D position = reference.atom( i ).position();
+            x_.push_back( position.x() );
+            y_.push_back( position.y() );
+            z_.push_back( position.z() );
+            elements_.push_back( reference.atom( i ).element() );
+        }
+        return;
+    }
+    // The atoms in the unit cell and their images in the 26 neighbouring cells, grouped by element
+    std::vector< std::vector< Vector3D > > points;
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        const Element element = reference.atom( i ).element();
+        if ( element.is_H_or_D() )
+            continue;
+        const size_t index = std::find( tree_elements_.begin(), tree_elements_.end(), element ) - tree_elements_.begin();
+        if ( index == tree_elements_.size() )
+        {
+            tree_elements_.push_back( element );
+            points.push_back( std::vector< Vector3D >() );
+        }
+        const Vector3D position = adjust_for_translations( reference.atom( i ).position() );
+        for ( int u( -1 ); u != 2; ++u )
+        {
+            for ( int v( -1 ); v != 2; ++v )
+            {
+                for ( int w( -1 ); w != 2; ++w )
+                    points[index].push_back( reference_lattice_.fractional_to_orthogonal( position + Vector3D( u, v, w ) ) );
+            }
+        }
+    }
+    for ( size_t i( 0 ); i != points.size(); ++i )
+        trees_.push_back( new KDTree( points[i] ) );
+}
+
+// ********************************************************************************
+
+TrajectoryRMSCD::~TrajectoryRMSCD()
+{
+    for ( size_t i( 0 ); i != trees_.size(); ++i )
+        delete trees_[i];
+}
+
+// ********************************************************************************
+
+double TrajectoryRMSCD::RMSCD( const CrystalStructure & frame ) const
+{
+    return ( matching_ == SAME_ORDER ) ? RMSCD_same_order( frame ) : RMSCD_nearest_atom( frame );
+}
+
+// ********************************************************************************
+
+std::vector< double > TrajectoryRMSCD::calculate( const TrajectorySource & trajectory_source ) const
+{
+    std::vector< double > result( trajectory_source.nframes() );
+    parallel_for( trajectory_source.nframes(), nthreads_, [&]( const size_t i )
+    {
+        CrystalStructure frame;
+        trajectory_source.read_frame( i, frame );
+        result[i] = RMSCD( frame );
+    } );
+    return result;
+}
+
+// ********************************************************************************
+
+double TrajectoryRMSCD::RMSCD_same_order( const CrystalStructure & frame ) const
+{
+    const size_t natoms = x_.size();
+    if ( frame.natoms() != natoms )
+        throw std::runtime_error( "TrajectoryRMSCD::RMSCD(): number of atoms is not the same." );
+    const Matrix3D & A_reference = reference_lattice_.fractional_to_orthogonal_matrix();
+    const Matrix3D & A_frame = frame.crystal_lattice().fractional_to_orthogonal_matrix();
+    double sum( 0.0 );
+    size_t nnon_H_atoms( 0 );
+    for ( size_t i( 0 ); i != natoms; ++i )
+    {
+        const Element & element = frame.atom( i ).element();
+        if ( element.is_H_or_D() && elements_[i].is_H_or_D() )
+            continue;
+        if ( element != elements_[i] )
+            throw std::runtime_error( "TrajectoryRMSCD::RMSCD(): elements are not the same." );
+        ++nnon_H_atoms;
+        const Vector3D difference = Vector3D( x_[i], y_[i], z_[i] ) - frame.atom( i ).position();
+        sum += square( ( ( A_reference * difference ).length() + ( A_frame * difference ).length() ) / 2.0 );
+    }
+    if ( nnon_H_atoms == 0 )
+        return 0.0;
+    return sqrt( sum / nnon_H_atoms );
+}
+
+// ********************************************************************************
+
+double TrajectoryRMSCD::RMSCD_nearest_atom( const CrystalStructure & frame ) const
+{
+    double sum( 0.0 );
+    size_t nnon_H_atoms( 0 );
+    for ( size_t i( 0 ); i != frame.natoms(); ++i )
+    {
+        const Element & element = frame.atom( i ).element();
+        if ( element.is_H_or_D() )
+            continue;
+        ++nnon_H_atoms;
+        const size_t index = std::find( tree_elements_.begin(), tree_elements_.end(), element ) - tree_elements_.begin();
+        if ( index == tree_elements_.size() )
+            return std::numeric_limits< double >::infinity();
+        sum += trees_[index]->nearest_distance2( reference_lattice_.fractional_to_orthogonal( adjust_for_translations( frame.atom( i ).position() ) ) );
+    }
+    if ( nnon_H_atoms == 0 )
+        return 0.0;
+    return sqrt( sum / nnon_H_atoms );
+}
+
+// ********************************************************************************
+
+void save_RMSCD_time_series( const TrajectorySource & trajectory_source, const std::vector< double > & RMSCDs, const FileName & file_name )
+{
+    if ( RMSCDs.size() != trajectory_source.nframes() )
+        throw std::runtime_error( "save_RMSCD_time_series(): number of values is not the number of frames." );
+    TextFileWriter text_file_writer( file_name );
+    for ( size_t i( 0 ); i != RMSCDs.size(); ++i )
+        text_file_writer.write_line( trajectory_source.frame_name( i ) + " " + double2string( RMSCDs[i] ) );
+}
+
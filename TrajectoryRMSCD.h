@@ -0,0 +1,107 @@
+#ifndef TRAJECTORYRMSCD_H
+#define TRAJECTORYRMSCD_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class FileName;
+class TrajectorySource;
+
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "Element.h"
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+/*
+  The root mean square Cartesian displacement (RMSCD) of every frame of a trajectory against one fixed reference structure,
+  e.g. the first frame or the averaged structure of AnalyseTrajectory, to follow structural drift without writing the frames
+  to cif files. The reference is prepared once, the frames are read from a TrajectorySource in parallel.
+
+  Matching:
+      SAME_ORDER    as root_mean_square_Cartesian_displacement(): atom i of a frame against atom i of the reference,
+                    the frame must have the same atoms in the same order. Pairs of H or D atoms are skipped, the displacement
+                    is the average of those in the lattice of the reference and in that of the frame. The reference is
+                    stored as arrays of x, y and z.
+      NEAREST_ATOM  each non-H atom of a frame is matched to the nearest reference atom of the same element, over all lattice
+                    translations, so the atoms of a frame may be in any order and may have been wrapped into the unit cell.
+                    Distances are in the lattice of the reference. The reference atoms of each element, and their images in
+                    the 26 neighbouring unit cells, are stored in a k-d tree, so each match costs O(log N). The unit cell
+                    of the reference should be reduced, so that the nearest image is in one of the neighbouring cells.
+                    Infinite if a frame contains an element that the reference does not.
+  The result is 0.0 if there are no non-H atoms.
+*/
+class TrajectoryRMSCD
+{
+public:
+
+    enum Matching { SAME_ORDER, NEAREST_ATOM };
+
+    explicit TrajectoryRMSCD( const CrystalStructure & reference, const Matching matching = SAME_ORDER );
+
+    ~TrajectoryRMSCD();
+
+    // 0 means one thread per core. Default 0.
+    size_t nthreads() const { return nthreads_; }
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; }
+
+    // In A.
+    double RMSCD( const CrystalStructure & frame ) const;
+
+    // The time series: RMSCD() of frames 0 ... nframes()-1, in A.
+    std::vector< double > calculate( const TrajectorySource & trajectory_source ) const;
+
+private:
+    class KDTree;
+
+    Matching matching_;
+    size_t nthreads_;
+    CrystalLattice reference_lattice_;
+    // SAME_ORDER
+    std::vector< double > x_;
+    std::vector< double > y_;
+    std::vector< double > z_;
+    std::vector< Element > elements_;
+    // NEAREST_ATOM, one tree per element
+    std::vector< Element > tree_elements_;
+    std::vector< KDTree * > trees_;
+
+    double RMSCD_same_order( const CrystalStructure & frame ) const;
+    double RMSCD_nearest_atom( const CrystalStructure & frame ) const;
+
+    // Not copyable
+    TrajectoryRMSCD( const TrajectoryRMSCD & );
+    TrajectoryRMSCD & operator=( const TrajectoryRMSCD & );
+};
+
+// Writes "frame_name RMSCD" per line.
+void save_RMSCD_time_series( const TrajectorySource & trajectory_source, const std::vector< double > & RMSCDs, const FileName & file_name );
+
+#endif // TRAJECTORYRMSCD_H
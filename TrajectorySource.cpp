@@ -0,0 +1,385 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "TrajectorySource.h"
+#include "3DCalculations.h"
+#include "Atom.h"
+#include "Element.h"
+#include "Matrix3D.h"
+#include "ReadCif.h"
+#include "ReadXYZ.h"
+#include "Utilities.h"
+#include "Vector3D.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+
+// The lattice defined by three lattice vectors in an arbitrary Cartesian frame, and the matrix that converts
+// Cartesian coordinates in that frame to fractional coordinates.
+void cell_vectors_to_lattice( const Vector3D & a, const Vector3D & b, const Vector3D & c, CrystalLattice & crystal_lattice, Matrix3D & orthogonal_to_fractional )
+{
+    crystal_lattice = CrystalLattice( a.length(), b.length(), c.length(), angle( b, c ), angle( a, c ), angle( a, b ) );
+    orthogonal_to_fractional = inverse( Matrix3D( a.x(), b.x(), c.x(),
+                                                  a.y(), b.y(), c.y(),
+                                                  a.z(), b.z(), c.z() ) );
+}
+
+void open_at( const FileName & file_name, const std::streampos position, std::ifstream & input_file )
+{
+    input_file.open( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+        throw std::runtime_error( "open_at(): Could not open file " + file_name.full_name() );
+    input_file.seekg( position );
+}
+
+// The words point into line, which is reused for every line of a frame.
+void get_words( std::istream & input_file, std::string & line, Tokens & words, const char * caller )
+{
+    if ( ! std::getline( input_file, line ) )
+        throw std::runtime_error( std::string( caller ) + ": unexpected end of file." );
+    tokenise( line, words );
+}
+
+template< class T >
+T read_value( const char * data, const bool swap_bytes )
+{
+    char bytes[ sizeof( T ) ];
+    std::memcpy( bytes, data, sizeof( T ) );
+    if ( swap_bytes )
+    {
+        for ( size_t i( 0 ); i != sizeof( T ) / 2; ++i )
+            std::swap( bytes[i], bytes[ sizeof( T ) - 1 - i ] );
+    }
+    T result;
+    std::memcpy( &result, bytes, sizeof( T ) );
+    return result;
+}
+
+// Reads one Fortran unformatted record of known length. Throws if the record markers do not match that length,
+// e.g. for a file with a different number of atoms or without the unit-cell records.
+void read_record( std::istream & input_file, const bool swap_bytes, char * data, const size_t nbytes )
+{
+    char leading_marker[4];
+    char trailing_marker[4];
+    input_file.read( leading_marker, 4 );
+    input_file.read( data, nbytes );
+    input_file.read( trailing_marker, 4 );
+    if ( ! input_file )
+        throw std::runtime_error( "read_record(): unexpected end of .dcd file." );
+    if ( ( read_value< int32_t >( leading_marker, swap_bytes ) != static_cast<int32_t>( nbytes ) ) ||
+         ( read_value< int32_t >( trailing_marker, swap_bytes ) != static_cast<int32_t>( nbytes ) ) )
+        throw std::runtime_error( "read_record(): record length in .dcd file is not " + size_t2string( nbytes ) + "." );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+CifTrajectory::CifTrajectory( const FileList & file_list ):
+file_list_(file_list)
+{
+    file_list_.set_prepend_file_name_with_basedirectory( true );
+}
+
+// ********************************************************************************
+
+void CifTrajectory::read_frame( const size_t i, CrystalStructure & crystal_structure ) const
+{
+    crystal_structure = CrystalStructure();
+    read_cif( file_list_.value( i ), crystal_structure );
+}
+
+// ********************************************************************************
+
+std::string CifTrajectory::frame_name( const size_t i ) const
+{
+    return file_list_.value( i ).file_name();
+}
+
+// ********************************************************************************
+// ********************************************************************************
+// ********************************************************************************
+
+XYZTrajectory::XYZTrajectory( const FileName & file_name, const CrystalLattice & crystal_lattice ):
+file_name_(file_name),
+crystal_lattice_(crystal_lattice)
+{
+    XYZFrameReader frame_reader( file_name_ );
+    offsets_ = frame_reader.frame_offsets();
+}
+
+// ********************************************************************************
+
+void XYZTrajectory::read_frame( const size_t i, CrystalStructure & crystal_structure ) const
+{
+    std::ifstream input_file;
+    open_at( file_name_, offsets_.at( i ), input_file );
+    std::string line;
+    Tokens words;
+    get_words( input_file, line, words, "XYZTrajectory::read_frame()" );
+    if ( words.empty() )
+        throw std::runtime_error( "XYZTrajectory::read_frame(): number of atoms expected." );
+    const size_t natoms = words.to_integer( 0 );
+    std::string comment;
+    std::getline( input_file, comment );
+    CrystalLattice crystal_lattice( crystal_lattice_ );
+    Matrix3D orthogonal_to_fractional = crystal_lattice_.orthogonal_to_fractional_matrix();
+    const size_t iPos = comment.find( "Lattice=\"" );
+    if ( iPos != std::string::npos )
+    {
+        const size_t start = iPos + 9;
+        const size_t end = comment.find( '"', start );
+        if ( end == std::string::npos )
+            throw std::runtime_error( "XYZTrajectory::read_frame(): Lattice is not terminated." );
+        Tokens values;
+        tokenise( std::string_view( comment ).substr( start, end - start ), values );
+        if ( values.size() != 9 )
+            throw std::runtime_error( "XYZTrajectory::read_frame(): Lattice must contain nine values." );
+        cell_vectors_to_lattice( Vector3D( values.to_double( 0 ), values.to_double( 1 ), values.to_double( 2 ) ),
+                                 Vector3D( values.to_double( 3 ), values.to_double( 4 ), values.to_double( 5 ) ),
+                                 Vector3D( values.to_double( 6 ), values.to_double( 7 ), values.to_double( 8 ) ),
+                                 crystal_lattice, orthogonal_to_fractional );
+    }
+    crystal_structure = CrystalStructure();
+    crystal_structure.set_name( frame_name( i ) );
+    crystal_structure.set_crystal_lattice( crystal_lattice );
+    crystal_structure.reserve_natoms( natoms );
+    Atom atom;
+    for ( size_t j( 0 ); j != natoms; ++j )
+    {
+        if ( ! std::getline( input_file, line ) )
+            throw std::runtime_error( "XYZTrajectory::read_frame(): unexpected end of file." );
+        xyz_line_to_atom( line, j + 1, atom );
+        atom.set_position( orthogonal_to_fractional * atom.position() );
+        crystal_structure.add_atom( atom );
+    }
+}
+
+// ********************************************************************************
+
+std::string XYZTrajectory::frame_name( const size_t i ) const
+{
+    return file_name_.file_name() + "_" + size_t2string( i + 1 );
+}
+
+// ********************************************************************************
+// ********************************************************************************
+// ********************************************************************************
+
+DCDTrajectory::DCDTrajectory( const FileName & file_name, const CrystalStructure & topology ):
+file_name_(file_name),
+topology_(topology),
+swap_bytes_(false),
+has_unit_cell_(false),
+natoms_(0),
+nframes_(0),
+header_size_(0),
+frame_size_(0)
+{
+    std::ifstream input_file;
+    open_at( file_name_, 0, input_file );
+    char buffer[84];
+    input_file.read( buffer, 4 );
+    if ( ! input_file )
+        throw std::runtime_error( "DCDTrajectory::DCDTrajectory(): file is empty: " + file_name_.full_name() );
+    if ( read_value< int >( buffer, false ) != 84 )
+    {
+        if ( read_value< int >( buffer, true ) != 84 )
+            throw std::runtime_error( "DCDTrajectory::DCDTrajectory(): not a .dcd file: " + file_name_.full_name() );
+        swap_bytes_ = true;
+    }
+    input_file.read( buffer, 84 );
+    if ( ( ! input_file ) || ( std::strncmp( buffer, "CORD", 4 ) != 0 ) )
+        throw std::runtime_error( "DCDTrajectory::DCDTrajectory(): not a .dcd file: " + file_name_.full_name() );
+    // The 20 control integers follow "CORD"
+    int control[20];
+    for ( size_t i( 0 ); i != 20; ++i )
+        control[i] = read_value< int >( buffer + 4 + 4 * i, swap_bytes_ );
+    if ( control[8] != 0 )
+        throw std::runtime_error( "DCDTrajectory::DCDTrajectory(): fixed atoms are not supported." );
+    const bool charmm = ( control[19] != 0 );
+    if ( charmm && ( control[11] != 0 ) )
+        throw std::runtime_error( "DCDTrajectory::DCDTrajectory(): four-dimensional coordinates are not supported." );
+    has_unit_cell_ = charmm && ( control[10] != 0 );
+    input_file.read( buffer, 4 ); // End of the first record
+    // Title record
+    input_file.read( buffer, 4 );
+    const int title_size = read_value< int >( buffer, swap_bytes_ );
+    input_file.seekg( title_size + 4, std::ios::cur );
+    // Number of atoms
+    input_file.read( buffer, 12 );
+    if ( ! input_file )
+        throw std::runtime_error( "DCDTrajectory::DCDTrajectory(): header is incomplete: " + file_name_.full_name() );
+    natoms_ = read_value< int >( buffer + 4, swap_bytes_ );
+    if ( natoms_ != topology_.natoms() )
+        throw std::runtime_error( "DCDTrajectory::DCDTrajectory(): number of atoms in .dcd file is not equal to that in the topology." );
+    header_size_ = input_file.tellg();
+    frame_size_ = ( has_unit_cell_ ? 56 : 0 ) + 3 * ( 4 * static_cast<std::streamoff>( natoms_ ) + 8 );
+    // The number of frames in the header is not always updated when a simulation is extended, so use the size of the file
+    input_file.seekg( 0, std::ios::end );
+    const std::streamoff file_size = input_file.tellg();
+    nframes_ = ( file_size - header_size_ ) / frame_size_;
+}
+
+// ********************************************************************************
+
+void DCDTrajectory::read_frame( const size_t i, CrystalStructure & crystal_structure ) const
+{
+    if ( i >= nframes_ )
+        throw std::runtime_error( "DCDTrajectory::read_frame(): frame index out of range." );
+    std::ifstream input_file;
+    open_at( file_name_, header_size_ + static_cast<std::streamoff>( i ) * frame_size_, input_file );
+    CrystalLattice crystal_lattice = topology_.crystal_lattice();
+    if ( has_unit_cell_ )
+    {
+        // A, gamma, B, beta, alpha, C. Angles are either in degrees or stored as cosines.
+        char data[48];
+        read_record( input_file, swap_bytes_, data, 48 );
+        double cell[6];
+        for ( size_t j( 0 ); j != 6; ++j )
+            cell[j] = read_value< double >( data + 8 * j, swap_bytes_ );
+        const bool cosines = ( std::abs( cell[1] ) <= 1.0 ) && ( std::abs( cell[3] ) <= 1.0 ) && ( std::abs( cell[4] ) <= 1.0 );
+        const Angle alpha = cosines ? arccosine( cell[4] ) : Angle::from_degrees( cell[4] );
+        const Angle beta  = cosines ? arccosine( cell[3] ) : Angle::from_degrees( cell[3] );
+        const Angle gamma = cosines ? arccosine( cell[1] ) : Angle::from_degrees( cell[1] );
+        crystal_lattice = CrystalLattice( cell[0], cell[2], cell[5], alpha, beta, gamma );
+    }
+    std::vector< char > data( 4 * natoms_ );
+    std::vector< double > xyz( 3 * natoms_ );
+    for ( size_t k( 0 ); k != 3; ++k )
+    {
+        read_record( input_file, swap_bytes_, &data[0], data.size() );
+        for ( size_t j( 0 ); j != natoms_; ++j )
+            xyz[ 3 * j + k ] = read_value< float >( &data[ 4 * j ], swap_bytes_ );
+    }
+    crystal_lattice.orthogonal_to_fractional( &xyz[0], natoms_ );
+    crystal_structure = CrystalStructure();
+    crystal_structure.set_name( frame_name( i ) );
+    crystal_structure.set_crystal_lattice( crystal_lattice );
+    crystal_structure.reserve_natoms( natoms_ );
+    for ( size_t j( 0 ); j != natoms_; ++j )
+    {
+        Atom atom( topology_.atom( j ) );
+        atom.set_position( Vector3D( xyz[ 3 * j ], xyz[ 3 * j + 1 ], xyz[ 3 * j + 2 ] ) );
+        crystal_structure.add_atom( atom );
+    }
+}
+
+// ********************************************************************************
+
+std::string DCDTrajectory::frame_name( const size_t i ) const
+{
+    return file_name_.file_name() + "_" + size_t2string( i + 1 );
+}
+
+// ********************************************************************************
+// ********************************************************************************
+// ********************************************************************************
+
+DLPOLYHistoryTrajectory::DLPOLYHistoryTrajectory( const FileName & file_name ):
+file_name_(file_name)
+{
+    std::ifstream input_file;
+    open_at( file_name_, 0, input_file );
+    std::string line;
+    // Title and "keytrj imcon natms" header
+    if ( ( ! std::getline( input_file, line ) ) || ( ! std::getline( input_file, line ) ) )
+        throw std::runtime_error( "DLPOLYHistoryTrajectory::DLPOLYHistoryTrajectory(): header is incomplete: " + file_name_.full_name() );
+    while ( true )
+    {
+        const std::streampos offset = input_file.tellg();
+        if ( ! std::getline( input_file, line ) )
+            break;
+        if ( line.compare( 0, 8, "timestep" ) == 0 )
+            offsets_.push_back( offset );
+    }
+}
+
+// ********************************************************************************
+
+void DLPOLYHistoryTrajectory::read_frame( const size_t i, CrystalStructure & crystal_structure ) const
+{
+    std::ifstream input_file;
+    open_at( file_name_, offsets_.at( i ), input_file );
+    std::string line;
+    Tokens words;
+    // timestep nstep natms keytrj imcon tstep
+    get_words( input_file, line, words, "DLPOLYHistoryTrajectory::read_frame()" );
+    if ( ( words.size() < 5 ) || ( words[0] != "timestep" ) )
+        throw std::runtime_error( "DLPOLYHistoryTrajectory::read_frame(): timestep line expected." );
+    const size_t natoms = words.to_integer( 2 );
+    const int keytrj = words.to_integer( 3 );
+    const int imcon = words.to_integer( 4 );
+    if ( imcon == 0 )
+        throw std::runtime_error( "DLPOLYHistoryTrajectory::read_frame(): frame has no periodic boundary conditions." );
+    Vector3D cell_vectors[3];
+    for ( size_t j( 0 ); j != 3; ++j )
+    {
+        get_words( input_file, line, words, "DLPOLYHistoryTrajectory::read_frame()" );
+        if ( words.size() < 3 )
+            throw std::runtime_error( "DLPOLYHistoryTrajectory::read_frame(): cell vector expected." );
+        cell_vectors[j] = Vector3D( words.to_double( 0 ), words.to_double( 1 ), words.to_double( 2 ) );
+    }
+    CrystalLattice crystal_lattice;
+    Matrix3D orthogonal_to_fractional;
+    cell_vectors_to_lattice( cell_vectors[0], cell_vectors[1], cell_vectors[2], crystal_lattice, orthogonal_to_fractional );
+    crystal_structure = CrystalStructure();
+    crystal_structure.set_name( frame_name( i ) );
+    crystal_structure.set_crystal_lattice( crystal_lattice );
+    crystal_structure.reserve_natoms( natoms );
+    for ( size_t j( 0 ); j != natoms; ++j )
+    {
+        get_words( input_file, line, words, "DLPOLYHistoryTrajectory::read_frame()" );
+        if ( words.empty() )
+            throw std::runtime_error( "DLPOLYHistoryTrajectory::read_frame(): atom label expected." );
+        const std::string label = words.string( 0 );
+        get_words( input_file, line, words, "DLPOLYHistoryTrajectory::read_frame()" );
+        if ( words.size() < 3 )
+            throw std::runtime_error( "DLPOLYHistoryTrajectory::read_frame(): atom position expected." );
+        const Vector3D position( words.to_double( 0 ), words.to_double( 1 ), words.to_double( 2 ) );
+        crystal_structure.add_atom( Atom( element_from_atom_label( label ), orthogonal_to_fractional * position, label ) );
+        // Velocities and forces
+        for ( int k( 0 ); k != keytrj; ++k )
+            get_words( input_file, line, words, "DLPOLYHistoryTrajectory::read_frame()" );
+    }
+}
+
+// ********************************************************************************
+
+std::string DLPOLYHistoryTrajectory::frame_name( const size_t i ) const
+{
+    return file_name_.file_name() + "_" + size_t2string( i + 1 );
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,156 @@
+#ifndef TRAJECTORYSOURCE_H
+#define TRAJECTORYSOURCE_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "CrystalLattice.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "FileName.h"
+
+#include <cstddef> // For definition of size_t
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+  A source of MD trajectory frames. Each frame is a crystal structure in P1 with the atoms in fractional coordinates,
+  the atoms must be in the same order in every frame.
+
+  Frames can be read in any order, and read_frame() is const and opens its own file handle,
+  so several threads can read different frames of the same source at the same time.
+*/
+class TrajectorySource
+{
+public:
+
+    virtual ~TrajectorySource() {}
+
+    virtual size_t nframes() const = 0;
+
+    // Replaces crystal_structure by frame i.
+    virtual void read_frame( const size_t i, CrystalStructure & crystal_structure ) const = 0;
+
+    // For screen output and for the names of files derived from frame i. Does not include the extension.
+    virtual std::string frame_name( const size_t i ) const = 0;
+
+    // The directory in which output files should be written.
+    virtual std::string directory() const = 0;
+};
+
+/*
+  One cif file per frame.
+*/
+class CifTrajectory : public TrajectorySource
+{
+public:
+
+    explicit CifTrajectory( const FileList & file_list );
+
+    size_t nframes() const { return file_list_.size(); }
+    void read_frame( const size_t i, CrystalStructure & crystal_structure ) const;
+    std::string frame_name( const size_t i ) const;
+    std::string directory() const { return file_list_.base_directory(); }
+
+private:
+    FileList file_list_;
+};
+
+/*
+  A multi-frame .xyz file: number of atoms, comment, one line "El x y z" per atom, repeated for every frame.
+  Coordinates are Cartesian. Extra columns after x y z are ignored.
+  If the comment line contains extended-XYZ Lattice="ax ay az bx by bz cx cy cz", the unit cell is read from it,
+  otherwise the fixed crystal_lattice is used, which then assumes the usual a-along-x orientation.
+*/
+class XYZTrajectory : public TrajectorySource
+{
+public:
+
+    explicit XYZTrajectory( const FileName & file_name, const CrystalLattice & crystal_lattice = CrystalLattice() );
+
+    size_t nframes() const { return offsets_.size(); }
+    void read_frame( const size_t i, CrystalStructure & crystal_structure ) const;
+    std::string frame_name( const size_t i ) const;
+    std::string directory() const { return file_name_.directory(); }
+
+private:
+    FileName file_name_;
+    CrystalLattice crystal_lattice_;
+    std::vector< std::streampos > offsets_; // Start of each frame
+};
+
+/*
+  CHARMM / NAMD binary .dcd file, either byte order.
+  A .dcd file only contains coordinates, the elements and labels are taken from topology, which must have the same number of atoms.
+  If the file contains no unit cell, the unit cell of topology is used.
+  The Cartesian coordinates are assumed to use the a-along-x, b-in-xy-plane orientation.
+  Files with fixed atoms or four-dimensional coordinates are not supported.
+*/
+class DCDTrajectory : public TrajectorySource
+{
+public:
+
+    DCDTrajectory( const FileName & file_name, const CrystalStructure & topology );
+
+    size_t nframes() const { return nframes_; }
+    void read_frame( const size_t i, CrystalStructure & crystal_structure ) const;
+    std::string frame_name( const size_t i ) const;
+    std::string directory() const { return file_name_.directory(); }
+
+private:
+    FileName file_name_;
+    CrystalStructure topology_;
+    bool swap_bytes_;
+    bool has_unit_cell_;
+    size_t natoms_;
+    size_t nframes_;
+    std::streamoff header_size_;
+    std::streamoff frame_size_;
+};
+
+/*
+  DL_POLY HISTORY file (the formatted version). Velocities and forces, if present, are skipped.
+  The elements are deduced from the atom labels.
+*/
+class DLPOLYHistoryTrajectory : public TrajectorySource
+{
+public:
+
+    explicit DLPOLYHistoryTrajectory( const FileName & file_name );
+
+    size_t nframes() const { return offsets_.size(); }
+    void read_frame( const size_t i, CrystalStructure & crystal_structure ) const;
+    std::string frame_name( const size_t i ) const;
+    std::string directory() const { return file_name_.directory(); }
+
+private:
+    FileName file_name_;
+    std::vector< std::streampos > offsets_; // Position of the "timestep" line of each frame
+};
+
+#endif // TRAJECTORYSOURCE_H
@@ -27,12 +27,83 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Triangle.h"
 
+#include <cmath>
+#include <type_traits>
+
+static_assert( std::is_trivially_copyable< Triangle >::value, "Triangle must be trivially copyable." );
+
+// ********************************************************************************
+
+Triangle::Triangle():
+area_(0.0)
+{
+}
+
+// ********************************************************************************
+
+Triangle::Triangle( const Vector3D & vertex_0, const Vector3D & vertex_1, const Vector3D & vertex_2 ):
+n_( cross_product( vertex_1 - vertex_0, vertex_2 - vertex_0 ) )
+{
+    vertices_[0] = vertex_0;
+    vertices_[1] = vertex_1;
+    vertices_[2] = vertex_2;
+    area_ = n_.length() / 2.0;
+}
+
 // ********************************************************************************
 
-Triangle::Triangle()
+void triangle_areas( const double * vertices, const size_t ntriangles, double * areas )
 {
+    // Written out so that the loop can be vectorised
+    for ( size_t i( 0 ); i != ntriangles; ++i )
+    {
+        const double * v = vertices + 9 * i;
+        const double ax = v[3] - v[0];
+        const double ay = v[4] - v[1];
+        const double az = v[5] - v[2];
+        const double bx = v[6] - v[0];
+        const double by = v[7] - v[1];
+        const double bz = v[8] - v[2];
+        const double nx = ay * bz - az * by;
+        const double ny = az * bx - ax * bz;
+        const double nz = ax * by - ay * bx;
+        areas[i] = 0.5 * std::sqrt( nx * nx + ny * ny + nz * nz );
+    }
+}
+
+// ********************************************************************************
+
+double total_area( const std::vector< Triangle > & triangles )
+{
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != triangles.size(); ++i )
+        result += triangles[i].area();
+    return result;
+}
 
+// ********************************************************************************
+
+double enclosed_volume( const std::vector< Triangle > & triangles )
+{
+    // v0 . ( v1 x v2 ) = v0 . n, because v0 . ( v1 - v0 ) x ( v2 - v0 ) = v0 . ( v1 x v2 )
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != triangles.size(); ++i )
+        result += triangles[i].vertex( 0 ) * triangles[i].n();
+    return result / 6.0;
 }
 
 // ********************************************************************************
 
+double enclosed_volume( const double * vertices, const size_t ntriangles )
+{
+    double result( 0.0 );
+    for ( size_t i( 0 ); i != ntriangles; ++i )
+    {
+        const double * v = vertices + 9 * i;
+        result += v[0] * ( v[4] * v[8] - v[5] * v[7] ) +
+                  v[1] * ( v[5] * v[6] - v[3] * v[8] ) +
+                  v[2] * ( v[3] * v[7] - v[4] * v[6] );
+    }
+    return result / 6.0;
+}
+
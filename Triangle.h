@@ -30,29 +30,52 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Vector3D.h"
 
+#include <cstddef> // For definition of size_t
 #include <vector>
 
 /*
-  Pretty much a copy of ConvexPolygon with the number of vertices fixed to three.
-  So the vertices are points in 3D and perhaps this class should be called "Triangle3D".
+  A triangle with its vertices in 3D, ConvexPolygon with the number of vertices fixed to three.
+
+  The vertices are stored in a fixed-size array and the normal and the area are calculated once, in the constructor,
+  so a Triangle is trivially copyable and can be stored by the million, e.g. for a triangulated molecular surface.
 */
 class Triangle
 {
 public:
 
-    // Default constructor
+    // Default constructor, all three vertices at the origin.
     Triangle();
 
-    // The normal to the plane.
-    Vector3D n() const;
+    // The sign of n() follows from the order of the vertices.
+    Triangle( const Vector3D & vertex_0, const Vector3D & vertex_1, const Vector3D & vertex_2 );
+
+    Vector3D vertex( const size_t i ) const { return vertices_[i]; }
 
-    double area() const;
+    // The normal to the plane, its length is twice the area and its sign follows from the order of the vertices, as ConvexPolygon::n().
+    Vector3D n() const { return n_; }
 
-    Vector3D centroid() const;
+    double area() const { return area_; }
+
+    Vector3D centroid() const { return ( vertices_[0] + vertices_[1] + vertices_[2] ) / 3.0; }
 
 private:
-    std::vector< Vector3D > vertices_;
+    Vector3D vertices_[3];
+    Vector3D n_;
+    double area_;
 };
 
+// The areas of ntriangles triangles stored as nine consecutive doubles each: x, y and z of the three vertices.
+void triangle_areas( const double * vertices, const size_t ntriangles, double * areas );
+
+double total_area( const std::vector< Triangle > & triangles );
+
+// The volume enclosed by a closed triangulated surface with all normals pointing outwards, from the divergence theorem:
+// the sum of the signed volumes of the tetrahedra spanned by the origin and each triangle.
+// Negative if the normals point inwards, meaningless if the surface is not closed.
+double enclosed_volume( const std::vector< Triangle > & triangles );
+
+// As enclosed_volume() for triangles stored as for triangle_areas().
+double enclosed_volume( const double * vertices, const size_t ntriangles );
+
 #endif // TRIANGLE_H
 
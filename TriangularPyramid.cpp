@@ -27,11 +27,24 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "TriangularPyramid.h"
 
+#include <cmath>
+#include <type_traits>
+
+static_assert( std::is_trivially_copyable< TriangularPyramid >::value, "TriangularPyramid must be trivially copyable." );
+
 // ********************************************************************************
 
-TriangularPyramid::TriangularPyramid()
+TriangularPyramid::TriangularPyramid():
+volume_(0.0)
 {
 }
 
 // ********************************************************************************
 
+TriangularPyramid::TriangularPyramid( const Triangle & base, const Vector3D & apex ):
+base_(base),
+apex_(apex),
+volume_( std::abs( base.n() * ( apex - base.vertex( 0 ) ) ) / 6.0 )
+{
+}
+
@@ -32,22 +32,32 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Vector3D.h"
 
 /*
-  Derived properties such as volume() or height() are recalculated every time the function is called.
+  A tetrahedron: a triangular base and an apex.
+
+  The volume is calculated once, in the constructor, so a TriangularPyramid is trivially copyable, as Triangle.
 */
 class TriangularPyramid
 {
 public:
 
-    // Default constructor
+    // Default constructor, everything at the origin.
     TriangularPyramid();
-    
-    double volume() const;
-    
-    double height() const;
+
+    TriangularPyramid( const Triangle & base, const Vector3D & apex );
+
+    Triangle base() const { return base_; }
+
+    Vector3D apex() const { return apex_; }
+
+    double volume() const { return volume_; }
+
+    // The distance from the apex to the plane of the base, 0.0 if the base is degenerate.
+    double height() const { return ( base_.area() == 0.0 ) ? 0.0 : 3.0 * volume_ / base_.area(); }
 
 private:
-    Triangle triangle_;
+    Triangle base_;
     Vector3D apex_;
+    double volume_;
 };
 
 #endif // TRIANGULARPYRAMID_H
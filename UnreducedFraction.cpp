@@ -0,0 +1,254 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "UnreducedFraction.h"
+#include "MathFunctions.h"
+
+#include <climits>
+#include <stdexcept>
+
+namespace
+{
+
+uint64_t absolute( const int64_t value )
+{
+    return ( value < 0 ) ? -static_cast< uint64_t >( value ) : static_cast< uint64_t >( value );
+}
+
+// Returns false if the result overflows.
+inline bool add( const int64_t lhs, const int64_t rhs, int64_t & result )
+{
+    return ! __builtin_add_overflow( lhs, rhs, &result );
+}
+
+inline bool multiply( const int64_t lhs, const int64_t rhs, int64_t & result )
+{
+    return ! __builtin_mul_overflow( lhs, rhs, &result );
+}
+
+// lhs_numerator / lhs_denominator + rhs_numerator / rhs_denominator, without reducing. Returns false if anything overflows.
+bool add( const int64_t lhs_numerator, const int64_t lhs_denominator, const int64_t rhs_numerator, const int64_t rhs_denominator, int64_t & numerator, int64_t & denominator )
+{
+    if ( lhs_denominator == rhs_denominator )
+    {
+        denominator = lhs_denominator;
+        return add( lhs_numerator, rhs_numerator, numerator );
+    }
+    int64_t lhs_term;
+    int64_t rhs_term;
+    return multiply( lhs_numerator, rhs_denominator, lhs_term ) &&
+           multiply( rhs_numerator, lhs_denominator, rhs_term ) &&
+           add( lhs_term, rhs_term, numerator ) &&
+           multiply( lhs_denominator, rhs_denominator, denominator );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+UnreducedFraction::UnreducedFraction( const int64_t numerator, const int64_t denominator ):
+numerator_(numerator),
+denominator_(denominator)
+{
+    if ( denominator_ == 0 )
+        throw std::runtime_error( "UnreducedFraction::UnreducedFraction(): denominator is 0." );
+    if ( denominator_ < 0 )
+    {
+        if ( ( numerator_ == INT64_MIN ) || ( denominator_ == INT64_MIN ) )
+        {
+            normalise();
+            if ( ( numerator_ == INT64_MIN ) || ( denominator_ == INT64_MIN ) )
+                throw std::runtime_error( "UnreducedFraction::UnreducedFraction(): overflow." );
+        }
+        numerator_ = -numerator_;
+        denominator_ = -denominator_;
+    }
+}
+
+// ********************************************************************************
+
+UnreducedFraction::UnreducedFraction( const Fraction & fraction ):
+numerator_( static_cast< int64_t >( fraction.integer_part() ) * fraction.denominator() + fraction.numerator() ),
+denominator_( fraction.denominator() )
+{
+}
+
+// ********************************************************************************
+
+void UnreducedFraction::normalise()
+{
+    const uint64_t common_factor = binary_greatest_common_divisor( absolute( numerator_ ), absolute( denominator_ ) );
+    if ( common_factor > 1 )
+    {
+        numerator_ /= static_cast< int64_t >( common_factor );
+        denominator_ /= static_cast< int64_t >( common_factor );
+    }
+}
+
+// ********************************************************************************
+
+Fraction UnreducedFraction::to_fraction() const
+{
+    UnreducedFraction reduced( *this );
+    reduced.normalise();
+    // Integer division truncates towards zero, so the integer part and the remainder have the same sign, as in Fraction.
+    const int64_t integer_part = reduced.numerator_ / reduced.denominator_;
+    const int64_t numerator = reduced.numerator_ % reduced.denominator_;
+    if ( ( integer_part < INT_MIN ) || ( INT_MAX < integer_part ) || ( INT_MAX < reduced.denominator_ ) )
+        throw std::runtime_error( "UnreducedFraction::to_fraction(): value does not fit in a Fraction." );
+    return Fraction( static_cast< int >( integer_part ), static_cast< int >( numerator ), static_cast< int >( reduced.denominator_ ) );
+}
+
+// ********************************************************************************
+
+void UnreducedFraction::reciprocal()
+{
+    if ( numerator_ == 0 )
+        throw std::runtime_error( "UnreducedFraction::reciprocal(): fraction is 0." );
+    *this = UnreducedFraction( denominator_, numerator_ );
+}
+
+// ********************************************************************************
+
+void UnreducedFraction::square()
+{
+    *this *= *this;
+}
+
+// ********************************************************************************
+
+void UnreducedFraction::power( const int n )
+{
+    if ( n == 0 )
+    {
+        *this = UnreducedFraction( 1 );
+        return;
+    }
+    if ( n < 0 )
+        reciprocal();
+    UnreducedFraction base( *this );
+    UnreducedFraction result( 1 );
+    for ( unsigned int exponent( absolute( n ) ); exponent != 0; exponent >>= 1 )
+    {
+        if ( exponent & 1 )
+            result *= base;
+        if ( exponent > 1 )
+            base.square();
+    }
+    *this = result;
+}
+
+// ********************************************************************************
+
+UnreducedFraction UnreducedFraction::operator-() const
+{
+    if ( numerator_ == INT64_MIN )
+        throw std::runtime_error( "UnreducedFraction::operator-(): overflow." );
+    UnreducedFraction result;
+    result.numerator_ = -numerator_;
+    result.denominator_ = denominator_;
+    return result;
+}
+
+// ********************************************************************************
+
+UnreducedFraction & UnreducedFraction::operator+=( const UnreducedFraction & rhs )
+{
+    int64_t numerator;
+    int64_t denominator;
+    if ( ! add( numerator_, denominator_, rhs.numerator_, rhs.denominator_, numerator, denominator ) )
+    {
+        // Reduce both, then add over the least common multiple of the denominators
+        UnreducedFraction lhs_reduced( *this );
+        lhs_reduced.normalise();
+        UnreducedFraction rhs_reduced( rhs );
+        rhs_reduced.normalise();
+        const int64_t common_factor = binary_greatest_common_divisor( lhs_reduced.denominator_, rhs_reduced.denominator_ );
+        if ( ! add( lhs_reduced.numerator_, lhs_reduced.denominator_ / common_factor, rhs_reduced.numerator_, rhs_reduced.denominator_ / common_factor, numerator, denominator ) ||
+             ! multiply( denominator, common_factor, denominator ) )
+            throw std::runtime_error( "UnreducedFraction::operator+=(): overflow." );
+    }
+    numerator_ = numerator;
+    denominator_ = denominator;
+    return *this;
+}
+
+// ********************************************************************************
+
+UnreducedFraction & UnreducedFraction::operator-=( const UnreducedFraction & rhs )
+{
+    return *this += -rhs;
+}
+
+// ********************************************************************************
+
+UnreducedFraction & UnreducedFraction::operator*=( const UnreducedFraction & rhs )
+{
+    int64_t numerator;
+    int64_t denominator;
+    if ( ! multiply( numerator_, rhs.numerator_, numerator ) || ! multiply( denominator_, rhs.denominator_, denominator ) )
+    {
+        // Cancel the common factors crosswise, then multiply
+        UnreducedFraction lhs_reduced( *this );
+        lhs_reduced.normalise();
+        UnreducedFraction rhs_reduced( rhs );
+        rhs_reduced.normalise();
+        const int64_t factor_1 = binary_greatest_common_divisor( absolute( lhs_reduced.numerator_ ), rhs_reduced.denominator_ );
+        const int64_t factor_2 = binary_greatest_common_divisor( absolute( rhs_reduced.numerator_ ), lhs_reduced.denominator_ );
+        if ( ! multiply( lhs_reduced.numerator_ / factor_1, rhs_reduced.numerator_ / factor_2, numerator ) ||
+             ! multiply( lhs_reduced.denominator_ / factor_2, rhs_reduced.denominator_ / factor_1, denominator ) )
+            throw std::runtime_error( "UnreducedFraction::operator*=(): overflow." );
+    }
+    numerator_ = numerator;
+    denominator_ = denominator;
+    return *this;
+}
+
+// ********************************************************************************
+
+UnreducedFraction & UnreducedFraction::operator/=( const UnreducedFraction & rhs )
+{
+    UnreducedFraction inverse( rhs );
+    inverse.reciprocal();
+    return *this *= inverse;
+}
+
+// ********************************************************************************
+
+bool UnreducedFraction::operator==( const UnreducedFraction & rhs ) const
+{
+    // The denominators are positive, so the products of 64-bit integers cannot overflow 128 bits
+    return ( static_cast< __int128 >( numerator_ ) * rhs.denominator_ == static_cast< __int128 >( rhs.numerator_ ) * denominator_ );
+}
+
+// ********************************************************************************
+
+bool UnreducedFraction::operator<( const UnreducedFraction & rhs ) const
+{
+    return ( static_cast< __int128 >( numerator_ ) * rhs.denominator_ < static_cast< __int128 >( rhs.numerator_ ) * denominator_ );
+}
+
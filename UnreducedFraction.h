@@ -0,0 +1,110 @@
+#ifndef UNREDUCEDFRACTION_H
+#define UNREDUCEDFRACTION_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "Fraction.h"
+
+#include <cstdint>
+
+/*
+  A fraction numerator / denominator that is not reduced after every operation, for long chains of arithmetic such as
+  composing symmetry operators. Fraction reduces with Euclid's algorithm and splits off the integer part after every
+  operation; here the numerator and denominator are 64-bit integers that are only reduced, with the binary GCD, when
+  normalise() or to_fraction() is called or when the next operation would overflow. If an operation still overflows after
+  reducing, it throws, it never wraps around.
+
+  Fraction remains the canonical type, convert with UnreducedFraction( fraction ) and to_fraction() at the ends of the calculation.
+
+  The denominator is always positive. numerator() and denominator() are not reduced, so two equal fractions can have
+  different numerators; the comparison operators compare values.
+*/
+class UnreducedFraction
+{
+public:
+
+    UnreducedFraction(): numerator_(0), denominator_(1) {}
+
+    explicit UnreducedFraction( const int integer ): numerator_(integer), denominator_(1) {}
+
+    // Throws if denominator is 0.
+    UnreducedFraction( const int64_t numerator, const int64_t denominator );
+
+    explicit UnreducedFraction( const Fraction & fraction );
+
+    int64_t numerator() const { return numerator_; }
+    int64_t denominator() const { return denominator_; }
+
+    double to_double() const { return static_cast< double >( numerator_ ) / static_cast< double >( denominator_ ); }
+
+    bool is_zero() const { return ( numerator_ == 0 ); }
+
+    bool is_integer() const { return ( ( numerator_ % denominator_ ) == 0 ); }
+
+    // Divides numerator and denominator by their greatest common divisor.
+    void normalise();
+
+    // Normalises and splits off the integer part. Throws if the result does not fit in a Fraction.
+    Fraction to_fraction() const;
+
+    // Throws if the fraction is 0.
+    void reciprocal();
+
+    void square();
+
+    // By repeated squaring. power( 0 ) is 1, also for 0. Throws if the fraction is 0 and n is negative.
+    void power( const int n );
+
+    UnreducedFraction operator+( const UnreducedFraction & rhs ) const { return UnreducedFraction( *this ) += rhs; }
+    UnreducedFraction operator-( const UnreducedFraction & rhs ) const { return UnreducedFraction( *this ) -= rhs; }
+    UnreducedFraction operator*( const UnreducedFraction & rhs ) const { return UnreducedFraction( *this ) *= rhs; }
+    UnreducedFraction operator/( const UnreducedFraction & rhs ) const { return UnreducedFraction( *this ) /= rhs; }
+
+    UnreducedFraction operator-() const;
+
+    UnreducedFraction & operator+=( const UnreducedFraction & rhs );
+    UnreducedFraction & operator-=( const UnreducedFraction & rhs );
+    UnreducedFraction & operator*=( const UnreducedFraction & rhs );
+    UnreducedFraction & operator/=( const UnreducedFraction & rhs );
+
+    bool operator==( const UnreducedFraction & rhs ) const;
+    bool operator!=( const UnreducedFraction & rhs ) const { return ! ( *this == rhs ); }
+    bool operator< ( const UnreducedFraction & rhs ) const;
+    bool operator> ( const UnreducedFraction & rhs ) const { return ( rhs < *this ); }
+    bool operator>=( const UnreducedFraction & rhs ) const { return ! ( *this < rhs ); }
+    bool operator<=( const UnreducedFraction & rhs ) const { return ! ( rhs < *this ); }
+
+private:
+    int64_t numerator_;
+    int64_t denominator_; // Always positive.
+};
+
+#endif // UNREDUCEDFRACTION_H
+
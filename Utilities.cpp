@@ -28,6 +28,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Utilities.h"
 #include "MathFunctions.h" // For round_to_int(), but this has got to lead to circular references sooner or later
 
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -256,118 +259,211 @@ std::string replace( const std::string & input, const std::string & old_str, con
 
 // ********************************************************************************
 
-std::vector< std::string > split( const std::string & input )
+bool glob_match( const std::string & pattern, const std::string & input )
 {
-    std::vector< std::string > result;
-    std::string current_word;
+    size_t p( 0 );
     size_t i( 0 );
-    while ( i < input.length() )
+    size_t star( std::string::npos ); // Position of the last * in pattern
+    size_t star_i( 0 );               // Position in input where that * started matching
+    while ( i != input.size() )
     {
-        // Absorb white space
-        while ( (i < input.length()) && ( (input[i] == ' ') || (input[i] == '\t') ) )
-            ++i;
-        // Parse "one word"
-        if ( (i < input.length()) && (input[i] == '"') )
+        if ( ( p != pattern.size() ) && ( pattern[p] == '*' ) )
         {
-            ++i;
-            while ( ( i < input.length() ) && ( input[i] != '"' ) )
-            {
-                current_word += input[i];
-                ++i;
-            }
-            if ( i == input.length() )
-                throw std::runtime_error( "split(): double quote is not terminated properly: |" + input + "|" );
-            ++i; // Read past the quote
-            // We must now hit the end of the line or whitespace
-            if ( ( i < input.length() ) && ( ( input[i] != ' ' ) && ( input[i] != '\t' ) ) )
-                throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
+            star = p;
+            ++p;
+            star_i = i;
         }
-        // Parse 'one word'
-        else if ( ( i < input.length() ) && ( input[i] == '\'' ) )
+        else if ( ( p != pattern.size() ) && ( ( pattern[p] == '?' ) || ( pattern[p] == input[i] ) ) )
         {
+            ++p;
             ++i;
-            while ( ( i < input.length() ) && ( input[i] != '\'' ) )
-            {
-                current_word += input[i];
-                ++i;
-            }
-            if ( i == input.length() )
-                throw std::runtime_error( "split(): single quote is not terminated properly: |" + input + "|" );
-            ++i; // Read past the quote
-            // We must now hit the end of the line or whitespace
-            if ( (i < input.length() ) && ( ( input[i] != ' ' ) && ( input[i] != '\t' ) ) )
-                throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
         }
-        // Collect non-quoted characters
+        else if ( star != std::string::npos )
+        {
+            // Let the last * absorb one more character
+            p = star + 1;
+            ++star_i;
+            i = star_i;
+        }
         else
+            return false;
+    }
+    while ( ( p != pattern.size() ) && ( pattern[p] == '*' ) )
+        ++p;
+    return ( p == pattern.size() );
+}
+
+// ********************************************************************************
+
+bool natural_less( const std::string & lhs, const std::string & rhs )
+{
+    size_t i( 0 );
+    size_t j( 0 );
+    while ( ( i != lhs.size() ) && ( j != rhs.size() ) )
+    {
+        if ( is_digit( lhs[i] ) && is_digit( rhs[j] ) )
         {
-            while ( ( i < input.length() ) && ( ( input[i] != ' ' ) && ( input[i] != '\t' ) ) )
-            {
-//                if ( ( input[i] == '"' ) || ( input[i] == '\'' ) )
-//                    throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
-                current_word += input[i];
+            while ( ( i != lhs.size() ) && ( lhs[i] == '0' ) )
                 ++i;
+            while ( ( j != rhs.size() ) && ( rhs[j] == '0' ) )
+                ++j;
+            size_t i_end( i );
+            while ( ( i_end != lhs.size() ) && is_digit( lhs[i_end] ) )
+                ++i_end;
+            size_t j_end( j );
+            while ( ( j_end != rhs.size() ) && is_digit( rhs[j_end] ) )
+                ++j_end;
+            // More significant digits means a larger number
+            if ( ( i_end - i ) != ( j_end - j ) )
+                return ( ( i_end - i ) < ( j_end - j ) );
+            for ( ; i != i_end; ++i, ++j )
+            {
+                if ( lhs[i] != rhs[j] )
+                    return ( lhs[i] < rhs[j] );
             }
         }
-        if ( current_word.length() != 0 )
+        else
         {
-            result.push_back( current_word );
-            current_word = "";
+            if ( lhs[i] != rhs[j] )
+                return ( lhs[i] < rhs[j] );
+            ++i;
+            ++j;
         }
     }
-    return result;
+    if ( ( i == lhs.size() ) != ( j == rhs.size() ) )
+        return ( i == lhs.size() );
+    // Only differ in leading zeros
+    return ( lhs < rhs );
 }
 
 // ********************************************************************************
 
-std::vector< std::string > split_2( const std::string & input )
+namespace
 {
-    std::vector< std::string > result;
-    std::string current_word;
+
+// The one implementation behind split(), split_2() and Splitter.
+// Quoted words are only recognised at the start of a word, the quotes are stripped and the closing quote must be followed by a delimiter.
+// With merge_delimiters, consecutive delimiters count as one and empty words are not retained;
+// without, every delimiter ends a word, so empty words are retained.
+template< class IsDelimiter >
+void tokenise_implementation( const std::string_view input, const IsDelimiter & is_delimiter, const bool single_quotes, const bool merge_delimiters, Tokens & tokens )
+{
+    tokens.clear();
+    const size_t n = input.size();
     size_t i( 0 );
-    while ( i < input.length() )
+    while ( i < n )
     {
-        // Absorb white space
-        while ( ( i < input.length() ) && ( ( input[i] == ' ' ) || ( input[i] == '\t' ) ) )
-            ++i;
-        // Parse "one word"
-        if ( ( i < input.length() ) && ( input[i] == '"' ) )
+        // Absorb delimiters
+        if ( merge_delimiters )
         {
+            while ( ( i < n ) && is_delimiter( input[i] ) )
+                ++i;
+        }
+        size_t word_begin = i;
+        size_t word_end;
+        // Parse "one word" or 'one word'
+        if ( ( i < n ) && ( ( input[i] == '"' ) || ( single_quotes && ( input[i] == '\'' ) ) ) )
+        {
+            const char quote = input[i];
             ++i;
-            while ( ( i < input.length() ) && ( input[i] != '"' ) )
-            {
-                current_word += input[i];
+            word_begin = i;
+            while ( ( i < n ) && ( input[i] != quote ) )
                 ++i;
-            }
-            if ( i == input.length() )
-                throw std::runtime_error( "split(): double quote is not terminated properly: |" + input + "|" );
+            if ( i == n )
+                throw std::runtime_error( std::string( "split(): " ) + ( quote == '"' ? "double" : "single" ) + " quote is not terminated properly: |" + std::string( input ) + "|" );
+            word_end = i;
             ++i; // Read past the quote
-            // We must now hit the end of the line or whitespace
-            if ( ( i < input.length() ) && ( ( input[i] != ' ' ) && ( input[i] != '\t' ) ) )
-                throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
+            // We must now hit the end of the line or a delimiter
+            if ( ( i < n ) && ( ! is_delimiter( input[i] ) ) )
+                throw std::runtime_error( "split(): quote inside string is not allowed: |" + std::string( input ) + "|" );
         }
         // Collect non-quoted characters
         else
         {
-            while ( ( i < input.length() ) && ( (input[i] != ' ' ) && ( input[i] != '\t' ) ) )
-            {
-//                if ( ( input[i] == '"' ) || ( input[i] == '\'' ) )
-//                    throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
-                current_word += input[i];
+            while ( ( i < n ) && ( ! is_delimiter( input[i] ) ) )
                 ++i;
-            }
+            word_end = i;
         }
-        if ( current_word.length() != 0 )
+        if ( merge_delimiters )
         {
-            result.push_back( current_word );
-            current_word = "";
+            if ( word_end != word_begin )
+                tokens.push_back( input.substr( word_begin, word_end - word_begin ) );
+        }
+        else
+        {
+            tokens.push_back( input.substr( word_begin, word_end - word_begin ) );
+            // When we are here, either i == n or input[i] is a delimiter.
+            ++i; // Read the delimiter
         }
     }
+}
+
+inline bool is_space_or_tab( const char c )
+{
+    return ( c == ' ' ) || ( c == '\t' );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+std::vector< std::string > Tokens::strings() const
+{
+    std::vector< std::string > result;
+    result.reserve( tokens_.size() );
+    for ( size_t i( 0 ); i != tokens_.size(); ++i )
+        result.push_back( std::string( tokens_[i] ) );
     return result;
 }
 
 // ********************************************************************************
 
+double Tokens::to_double( const size_t i ) const
+{
+    return string2double( tokens_[i].data(), tokens_[i].data() + tokens_[i].size() );
+}
+
+// ********************************************************************************
+
+int Tokens::to_integer( const size_t i ) const
+{
+    return round_to_int( string2double_2( tokens_[i].data(), tokens_[i].data() + tokens_[i].size(), false ) );
+}
+
+// ********************************************************************************
+
+void tokenise( const std::string_view input, Tokens & tokens )
+{
+    tokenise_implementation( input, is_space_or_tab, true, true, tokens );
+}
+
+// ********************************************************************************
+
+void tokenise_2( const std::string_view input, Tokens & tokens )
+{
+    tokenise_implementation( input, is_space_or_tab, false, true, tokens );
+}
+
+// ********************************************************************************
+
+std::vector< std::string > split( const std::string & input )
+{
+    Tokens tokens;
+    tokenise( input, tokens );
+    return tokens.strings();
+}
+
+// ********************************************************************************
+
+std::vector< std::string > split_2( const std::string & input )
+{
+    Tokens tokens;
+    tokenise_2( input, tokens );
+    return tokens.strings();
+}
+
+// ********************************************************************************
+
 Splitter::Splitter(): merge_delimiters_(true),split_by_length_(false),split_length_(0)
 {
     delimiters_.push_back( ' ' );
@@ -396,135 +492,29 @@ Splitter::Splitter( const char* delimiters ): merge_delimiters_(true),split_by_l
 
 std::vector< std::string > Splitter::split( const std::string & input ) const
 {
-    std::vector< std::string > result;
+    Tokens tokens;
+    tokenise( input, tokens );
+    return tokens.strings();
+}
+
+// ********************************************************************************
+
+void Splitter::tokenise( const std::string_view input, Tokens & tokens ) const
+{
     if ( split_by_length_ )
     {
         if ( split_length_ == 0 )
             throw std::runtime_error( "Splitter::split(): programming error." );
+        tokens.clear();
         size_t iStart( 0 );
         while ( iStart < input.length() )
         {
-            result.push_back( input.substr( iStart, split_length_) );
+            tokens.push_back( input.substr( iStart, split_length_ ) );
             iStart += split_length_;
         }
-        return result;
-    }
-    std::string current_word;
-    size_t i( 0 );
-    if ( ! merge_delimiters_ )
-    {
-
-//N1      C2     ,   1.47566, 1.47769`, bond_width, bond_weight
-
-        while ( i < input.length() )
-        {
-            // Parse "one word"
-            if ( ( i < input.length() ) && (input[i] == '"') )
-            {
-                ++i;
-                while ( ( i < input.length() ) && (input[i] != '"') )
-                {
-                    current_word += input[i];
-                    ++i;
-                }
-                if ( i == input.length() )
-                    throw std::runtime_error( "split(): double quote is not terminated properly: |" + input + "|" );
-                ++i; // Read past the quote
-                // We must now hit the end of the line or whitespace
-                if ( ( i < input.length() ) && ( ! is_delimiter( input[i] ) ) )
-                    throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
-            }
-            // Parse 'one word'
-            else if ( ( i < input.length() ) && ( input[i] == '\'' ) )
-            {
-                ++i;
-                while ( ( i < input.length() ) && ( input[i] != '\'' ) )
-                {
-                    current_word += input[i];
-                    ++i;
-                }
-                if ( i == input.length() )
-                    throw std::runtime_error( "split(): single quote is not terminated properly: |" + input + "|" );
-                ++i; // Read past the quote
-                // We must now hit the end of the line or whitespace
-                if ( ( i < input.length() ) && ( ! is_delimiter( input[i] ) ) )
-                    throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
-            }
-            // Collect non-quoted characters
-            else
-            {
-                while ( ( i < input.length() ) && ( ! is_delimiter( input[i] ) ) )
-                {
-    //                if ( ( input[i] == '"' ) || ( input[i] == '\'' ) )
-    //                    throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
-                    current_word += input[i];
-                    ++i;
-                }
-            }
-            result.push_back( current_word );
-            current_word = "";
-            // When we are here, either i == input.length() or input[i] is a delimiter.
-            ++i; // Read the delimiter
-        }
-    }
-    else // Merge delimiters
-    {
-        while ( i < input.length() )
-        {
-            // Absorb white space
-            while ( ( i < input.length() ) && is_delimiter( input[i] ) )
-                ++i;
-            // Parse "one word"
-            if ( ( i < input.length() ) && ( input[i] == '"' ) )
-            {
-                ++i;
-                while ( ( i < input.length() ) && ( input[i] != '"' ) )
-                {
-                    current_word += input[i];
-                    ++i;
-                }
-                if ( i == input.length() )
-                    throw std::runtime_error( "split(): double quote is not terminated properly: |" + input + "|" );
-                ++i; // Read past the quote
-                // We must now hit the end of the line or whitespace
-                if ( ( i < input.length() ) && ( ! is_delimiter( input[i] ) ) )
-                    throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
-            }
-            // Parse 'one word'
-            else if ( ( i < input.length() ) && ( input[i] == '\'' ) )
-            {
-                ++i;
-                while ( ( i < input.length() ) && ( input[i] != '\'' ) )
-                {
-                    current_word += input[i];
-                    ++i;
-                }
-                if ( i == input.length() )
-                    throw std::runtime_error( "split(): single quote is not terminated properly: |" + input + "|" );
-                ++i; // Read past the quote
-                // We must now hit the end of the line or whitespace
-                if ( ( i < input.length() ) && ( ! is_delimiter( input[i] ) ) )
-                    throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
-            }
-            // Collect non-quoted characters
-            else
-            {
-                while ( ( i < input.length() ) && ( ! is_delimiter( input[i] ) ) )
-                {
-    //                if ( ( input[i] == '"' ) || ( input[i] == '\'' ) )
-    //                    throw std::runtime_error( "split(): quote inside string is not allowed: |" + input + "|" );
-                    current_word += input[i];
-                    ++i;
-                }
-            }
-            if ( ! current_word.empty() )
-            {
-                result.push_back( current_word );
-                current_word = "";
-            }
-        }
+        return;
     }
-    return result;
+    tokenise_implementation( input, [this]( const char c ){ return is_delimiter( c ); }, true, merge_delimiters_, tokens );
 }
 
 // ********************************************************************************
@@ -561,92 +551,115 @@ std::string extract_delimited_text( const std::string & input, const std::string
 
 // ********************************************************************************
 
-double string2double_2( const std::string & input, const bool float_allowed )
+namespace
 {
-    if ( input.empty() )
-        throw std::runtime_error( "string2double_2(): input string is empty" );
-    double result( 0.0 );
-    bool is_negative( false );
-    size_t iPos( 0 );
-    if ( input[iPos] == '+' )
-        ++iPos;
-    else if ( input[iPos] == '-' )
-    {
-        is_negative = true;
+
+// 10^-i
+const double negative_powers_of_ten[] = { 1.0, 1.0E-1, 1.0E-2, 1.0E-3, 1.0E-4, 1.0E-5, 1.0E-6, 1.0E-7, 1.0E-8, 1.0E-9,
+                                          1.0E-10, 1.0E-11, 1.0E-12, 1.0E-13, 1.0E-14, 1.0E-15, 1.0E-16, 1.0E-17, 1.0E-18, 1.0E-19 };
+
+} // namespace
+
+// ********************************************************************************
+
+ParsedNumber parse_number( const std::string_view input )
+{
+    const char * begin = input.data();
+    const char * end = begin + input.size();
+    // from_chars() does not accept a leading '+', but it does accept "inf" and "nan", which we do not want
+    const char * iPos = begin;
+    if ( ( iPos != end ) && ( ( *iPos == '+' ) || ( *iPos == '-' ) ) )
         ++iPos;
-    }
-    bool after_period( false );
-    bool at_least_one_digit_found( false );
-    double power( 1.0 );
-    double exponent( 0.0 );
-    bool exponent_found( false );
-    while ( iPos < input.length() )
+    if ( ( iPos == end ) || ( ! is_digit( *iPos ) && ( *iPos != '.' ) ) )
+        throw std::runtime_error( "parse_number(): cannot interpret >" + std::string( input ) + "<" );
+    ParsedNumber result;
+    const std::from_chars_result value_end = std::from_chars( ( *begin == '+' ) ? begin + 1 : begin, end, result.value_ );
+    if ( value_end.ec != std::errc() )
+        throw std::runtime_error( "parse_number(): cannot interpret >" + std::string( input ) + "<" );
+    result.estimated_standard_deviation_ = 0.0;
+    result.has_esd_ = false;
+    if ( value_end.ptr == end )
+        return result;
+    // "0.2611(2)"
+    if ( ( *value_end.ptr != '(' ) || ( *(end-1) != ')' ) || ( value_end.ptr + 2 >= end ) )
+        throw std::runtime_error( "parse_number(): parentheses not closed properly : >" + std::string( input ) + "<" );
+    unsigned long long esd_digits;
+    const std::from_chars_result esd_end = std::from_chars( value_end.ptr + 1, end - 1, esd_digits );
+    if ( ( esd_end.ec != std::errc() ) || ( esd_end.ptr != end - 1 ) )
+        throw std::runtime_error( "parse_number(): cannot interpret ESD in >" + std::string( input ) + "<" );
+    // The ESD applies to the last digit of the value, so we need the number of decimals and the exponent
+    int scale( 0 );
+    const char * iPos2 = iPos;
+    while ( ( iPos2 != value_end.ptr ) && ( *iPos2 != '.' ) && ( *iPos2 != 'e' ) && ( *iPos2 != 'E' ) )
+        ++iPos2;
+    if ( ( iPos2 != value_end.ptr ) && ( *iPos2 == '.' ) )
     {
-        if ( input[iPos] == '.' )
+        ++iPos2;
+        while ( ( iPos2 != value_end.ptr ) && is_digit( *iPos2 ) )
         {
-            if ( ! float_allowed )
-                throw std::runtime_error( "string2double_2(): period found in integer value : >" + input + "<" );
-            if ( after_period )
-                throw std::runtime_error( "string2double_2(): second period found : >" + input + "<" );
-            after_period = true;
-            ++iPos;
-            continue;
+            --scale;
+            ++iPos2;
         }
-        if ( ( input[iPos] == 'E' ) || ( input[iPos] == 'e' ) )
-//        if ( ( input[iPos] == 'E' ) || ( input[iPos] == 'e' ) || ( input[iPos] == 'D' ) || ( input[iPos] == 'd' ) )
-        {
-            if ( ! float_allowed )
-                throw std::runtime_error( "string2double_2(): exponent found in integer value : >" + input + "<" );
-            if ( ! at_least_one_digit_found )
-                throw std::runtime_error( "string2double(): no digits before exponent : >" + input + "<" );
+    }
+    if ( iPos2 != value_end.ptr ) // Exponent
+    {
+        ++iPos2;
+        if ( *iPos2 == '+' )
+            ++iPos2;
+        int exponent( 0 );
+        std::from_chars( iPos2, value_end.ptr, exponent );
+        scale += exponent;
+    }
+    result.estimated_standard_deviation_ = static_cast< double >( esd_digits ) * ( ( ( scale <= 0 ) && ( scale > -20 ) ) ? negative_powers_of_ten[ -scale ] : std::pow( 10.0, scale ) );
+    result.has_esd_ = true;
+    return result;
+}
+
+// ********************************************************************************
+
+double string2double_2( const std::string & input, const bool float_allowed )
+{
+    return string2double_2( input.data(), input.data() + input.length(), float_allowed );
+}
+
+// ********************************************************************************
+
+double string2double_2( const char * begin, const char * end, const bool float_allowed )
+{
+    if ( begin == end )
+        throw std::runtime_error( "string2double_2(): input string is empty" );
+    if ( ! float_allowed )
+    {
+        // Only a sign and digits
+        const char * iPos = begin;
+        if ( ( *iPos == '+' ) || ( *iPos == '-' ) )
             ++iPos;
-            if ( iPos == input.length() )
-                throw std::runtime_error( "string2double(): no digits after exponent : >" + input + "<" );
-            exponent_found = true;
-            exponent = string2double_2( input.substr( iPos ), false );
-            break;
-        }
-        if ( ( input[iPos] >= '0' ) && ( input[iPos] <= '9' ) )
+        if ( iPos == end )
+            throw std::runtime_error( "string2double_2(): no digits found : >" + std::string( begin, end ) + "<" );
+        for ( ; iPos != end; ++iPos )
         {
-            at_least_one_digit_found = true;
-            double value = double( int( input[iPos] ) - int( '0' ) );
-            if ( after_period )
-                power /= 10.0;
-            else
-                result *= 10.0;
-            result += value * power;
-            ++iPos;
-            continue;
+            if ( ( *iPos < '0' ) || ( *iPos > '9' ) )
+                throw std::runtime_error( "string2double_2(): invalid character found : >" + std::string( begin, end ) + "<" );
         }
-        throw std::runtime_error( "string2double_2(): invalid character found : >" + input + "<" );
     }
-    if ( ! at_least_one_digit_found )
-        throw std::runtime_error( "string2double_2(): no digits found : >" + input + "<" );
-    if ( exponent_found )
-        result *= std::pow( 10.0, exponent );
-    if ( is_negative )
-        result = -result;
-    return result;
+    const ParsedNumber result = parse_number( std::string_view( begin, end - begin ) );
+    if ( result.has_esd_ )
+        throw std::runtime_error( "string2double_2(): invalid character found : >" + std::string( begin, end ) + "<" );
+    return result.value_;
 }
 
 // ********************************************************************************
 
 double string2double( std::string input )
 {
-    size_t iPos1 = input.find_first_of( "(" );
-    size_t iPos2 = input.find_first_of( ")" );
-    if ( iPos1 == std::string::npos )
-    {
-        if ( iPos2 != std::string::npos )
-            throw std::runtime_error( "string2double(): parentheses not closed properly :  >" + input + "<" );
-    }
-    else
-    {
-        if ( iPos2 != input.length()-1 )
-            throw std::runtime_error( "string2double(): parentheses not closed properly :  >" + input + "<" );
-        input.erase( iPos1 );
-    }
-    return string2double_2( input, true );
+    return string2double( input.data(), input.data() + input.length() );
+}
+
+// ********************************************************************************
+
+double string2double( const char * begin, const char * end )
+{
+    return parse_number( std::string_view( begin, end - begin ) ).value_;
 }
 
 // ********************************************************************************
@@ -660,33 +673,26 @@ int string2integer( const std::string & input )
 
 std::string double2string( const double input )
 {
-    std::stringstream string_stream;
-    string_stream << input;
-    return string_stream.str();
+    std::string result;
+    append_double( result, input );
+    return result;
 }
 
 // ********************************************************************************
 
 std::string double2string_2( const double input, const size_t ndecimals )
 {
-    std::stringstream string_stream;
-    string_stream << std::fixed;
-    string_stream.precision( ndecimals );
-    string_stream << input;
-    return string_stream.str();
+    std::string result;
+    append_double( result, input, ndecimals );
+    return result;
 }
 
 // ********************************************************************************
 
 std::string double2string( const double input, const size_t precision, const size_t padded_length, const char padding_character )
 {
-    std::stringstream string_stream;
-    string_stream << std::fixed;
-    string_stream.precision( precision );
-    string_stream << input;
-    std::string result = string_stream.str();
-    while ( result.size() < padded_length )
-        result = padding_character + result;
+    std::string result;
+    append_double( result, input, precision, padded_length, padding_character );
     return result;
 }
 
@@ -694,13 +700,8 @@ std::string double2string( const double input, const size_t precision, const siz
 
 std::string double2string_pad_plus( const double input, const size_t precision, const char padding_character )
 {
-    std::stringstream string_stream;
-    string_stream << std::fixed;
-    string_stream.precision( precision );
-    string_stream << input;
-    std::string result = string_stream.str();
-    if ( input >= 0.0 )
-        result = padding_character + result;
+    std::string result;
+    append_double_pad_plus( result, input, precision, padding_character );
     return result;
 }
 
@@ -719,11 +720,8 @@ std::string make_multiple( const std::string & input, const size_t number )
 
 std::string size_t2string( const size_t input, const size_t padded_length, const char padding_character )
 {
-    std::stringstream string_stream;
-    string_stream << input;
-    std::string result = string_stream.str();
-    while ( result.size() < padded_length )
-        result = padding_character + result;
+    std::string result;
+    append_size_t( result, input, padded_length, padding_character );
     return result;
 }
 
@@ -741,6 +739,85 @@ std::string int2string( const int input, const size_t padded_length, const char
 
 // ********************************************************************************
 
+namespace
+{
+
+// Appends snprintf( format, precision, input ) to output, format must be "%.*f" or "%.*g".
+// This is what std::ostream uses internally for fixed and default floating-point output.
+void append_formatted( std::string & output, const char * format, const int precision, const double input )
+{
+    char buffer[64];
+    const int n = std::snprintf( buffer, sizeof( buffer ), format, precision, input );
+    if ( n < 0 )
+        throw std::runtime_error( "append_formatted(): formatting error." );
+    if ( static_cast<size_t>( n ) < sizeof( buffer ) )
+    {
+        output.append( buffer, n );
+        return;
+    }
+    // Only fixed-point output of very large values ends up here
+    const size_t old_size = output.size();
+    output.resize( old_size + n + 1 );
+    std::snprintf( &output[old_size], n + 1, format, precision, input );
+    output.resize( old_size + n );
+}
+
+// Inserts padding characters in front of the characters appended since start, up to a total of padded_length
+void pad_front( std::string & output, const size_t start, const size_t padded_length, const char padding_character )
+{
+    const size_t length = output.size() - start;
+    if ( length < padded_length )
+        output.insert( start, padded_length - length, padding_character );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+void append_double( std::string & output, const double input )
+{
+    append_formatted( output, "%.*g", 6, input );
+}
+
+// ********************************************************************************
+
+void append_double( std::string & output, const double input, const size_t precision, const size_t padded_length, const char padding_character )
+{
+    const size_t start = output.size();
+    append_formatted( output, "%.*f", static_cast<int>( precision ), input );
+    pad_front( output, start, padded_length, padding_character );
+}
+
+// ********************************************************************************
+
+void append_double_pad_plus( std::string & output, const double input, const size_t precision, const char padding_character )
+{
+    if ( input >= 0.0 )
+        output += padding_character;
+    append_formatted( output, "%.*f", static_cast<int>( precision ), input );
+}
+
+// ********************************************************************************
+
+void append_size_t( std::string & output, const size_t input, const size_t padded_length, const char padding_character )
+{
+    char buffer[24];
+    size_t n( 0 );
+    size_t value( input );
+    do
+    {
+        buffer[n++] = static_cast<char>( '0' + ( value % 10 ) );
+        value /= 10;
+    }
+    while ( value != 0 );
+    if ( n < padded_length )
+        output.append( padded_length - n, padding_character );
+    while ( n != 0 )
+        output += buffer[--n];
+}
+
+// ********************************************************************************
+
 void check_if_quotes_correct( const std::string & input )
 {
 }
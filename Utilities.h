@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cmath>
 
 // We must have a separate StringFunctions.h
@@ -110,6 +111,14 @@ std::string pad( const std::string & input, const size_t padded_length = 0, cons
 // The second string can be empty
 std::string replace( const std::string & input, const std::string & old_str, const std::string & new_str );
 
+// Shell-style wildcard matching: * matches any sequence of characters, ? matches exactly one character.
+// Case sensitive. glob_match( "*.cif", "frame_10.cif" ) is true.
+bool glob_match( const std::string & pattern, const std::string & input );
+
+// "Natural" ordering in which runs of digits are compared by their numerical value,
+// so that "frame_9.cif" comes before "frame_10.cif". Leading zeros are ignored except to break ties.
+bool natural_less( const std::string & lhs, const std::string & rhs );
+
 // Splits a line into individual words, currently the separator is hard-coded to be a space or a tab
 // "one word" and 'one word' are recognised as one word, the quotes are stripped.
 // Empty words (either multiple spaces or e.g. "") are not retained.
@@ -125,6 +134,39 @@ std::vector< std::string > split( const std::string & input );
 // Necessary to read files where a single quote is a comment identifier (such as TOPAS .inp files)
 std::vector< std::string > split_2( const std::string & input );
 
+// The words of one line as std::string_view into that line, filled by tokenise(), tokenise_2() and Splitter::tokenise().
+// Meant to be reused for every line of a file: clear() keeps the storage, so after the first few lines
+// tokenising does not allocate memory. The tokens are only valid as long as the line they point into is alive and unchanged.
+class Tokens
+{
+public:
+
+    size_t size() const { return tokens_.size(); }
+    bool empty() const { return tokens_.empty(); }
+
+    std::string_view operator[]( const size_t i ) const { return tokens_[i]; }
+
+    // Copies
+    std::string string( const size_t i ) const { return std::string( tokens_[i] ); }
+    std::vector< std::string > strings() const;
+
+    // string2double() and string2integer() without copying the token
+    double to_double( const size_t i ) const;
+    int to_integer( const size_t i ) const;
+
+    void clear() { tokens_.clear(); }
+    void push_back( const std::string_view token ) { tokens_.push_back( token ); }
+
+private:
+    std::vector< std::string_view > tokens_;
+};
+
+// Same rules and errors as split(), but the words are written into tokens without copying them.
+void tokenise( const std::string_view input, Tokens & tokens );
+
+// Same rules and errors as split_2().
+void tokenise_2( const std::string_view input, Tokens & tokens );
+
 // We really have a problem here with empty words: allow or not? What should split( ",", "," ); return: two empty words?
 // There should be an option to remove quotes from quoted fields
 // There should be an option to configure what is used to delimit a quote
@@ -145,6 +187,9 @@ public:
 
     std::vector< std::string > split( const std::string & input ) const;
 
+    // Same as split(), but the words are written into tokens without copying them.
+    void tokenise( const std::string_view input, Tokens & tokens ) const;
+
 private:
     std::vector< char > delimiters_;
     bool merge_delimiters_;
@@ -161,12 +206,30 @@ private:
 // Returns empty string if delimiters not found or if the extracted string just happens to be empty.
 std::string extract_delimited_text( const std::string & input, const std::string & start_delimiter, const std::string & end_delimiter );
 
+// A number as found in .cif and TOPAS files, e.g. "0.2611(2)": the value is 0.2611 and the ESD is 0.0002.
+// Without parentheses, has_esd_ is false and the ESD is 0.0.
+struct ParsedNumber
+{
+    double value_;
+    double estimated_standard_deviation_;
+    bool has_esd_;
+};
+
+// Parses "-1.5", "+.5", "1.2E-3", "0.2611(2)", "1234(5)" (ESD 5) and "1.2E-3(4)" (ESD 0.0004) in one pass, with std::from_chars()
+// and without allocating memory. White space, "inf", "nan" and trailing characters are errors.
+ParsedNumber parse_number( const std::string_view input );
+
 // For internal use only.
 double string2double_2( const std::string & input, const bool float_allowed );
+double string2double_2( const char * begin, const char * end, const bool float_allowed );
 
 // Recognises scientific notation with "E" or "e" such as -.234e-45
+// An ESD in parentheses at the end, as in 0.1071(7), is ignored.
 double string2double( std::string input );
 
+// As above, for the characters [begin, end) in a buffer, without copying them.
+double string2double( const char * begin, const char * end );
+
 int string2integer( const std::string & input );
 
 // The configurability of double2string() suggests that a class is called for.
@@ -224,6 +287,13 @@ std::string size_t2string( const size_t input, const size_t padded_length = 0, c
 // the length of the input value is returned (so the value is never corrupted).
 std::string int2string( const int input, const size_t padded_length = 0, const char padding_character = '0' );
 
+// Append-style versions of the conversions above: the result is appended to output, so that a line can be built up
+// in a single string that is reused for all lines, without creating temporaries. The output is identical.
+void append_double( std::string & output, const double input );
+void append_double( std::string & output, const double input, const size_t precision, const size_t padded_length = 0, const char padding_character = ' ' );
+void append_double_pad_plus( std::string & output, const double input, const size_t precision, const char padding_character = ' ' );
+void append_size_t( std::string & output, const size_t input, const size_t padded_length = 0, const char padding_character = '0' );
+
 inline bool nearly_equal( const double lhs, const double rhs, const double tolerance = 0.0000001 )
 {
     return ( std::abs( rhs - lhs ) < tolerance );
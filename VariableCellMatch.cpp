@@ -0,0 +1,585 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "VariableCellMatch.h"
+#include "CrystalStructure.h"
+#include "FileList.h"
+#include "Instrumentation.h"
+#include "MathFunctions.h"
+#include "Matrix3D.h"
+#include "MillerIndices.h"
+#include "ParallelFor.h"
+#include "PeakShapeFunction.h"
+#include "PowderPatternCalculator.h"
+#include "ReadCif.h"
+#include "ReflectionList.h"
+#include "ScratchArena.h"
+#include "SpaceGroup.h"
+#include "SymmetryOperator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+// The six independent elements of a symmetric 3x3 matrix, in the order 00, 11, 22, 12, 02, 01.
+const size_t row_of_element[ 6 ]    = { 0, 1, 2, 1, 0, 0 };
+const size_t column_of_element[ 6 ] = { 0, 1, 2, 2, 2, 1 };
+
+// ********************************************************************************
+
+// A basis for the symmetric matrices D with W D W^T = D for all rotations W of the space group. These are the changes of G*
+// that leave d(hW) = d(h), because the rotations also leave G* itself invariant. Each basis matrix is scaled such that
+// its largest element relative to sqrt( G*_rr G*_ss ) is 1.0, so a parameter is a relative change of the elements of G*.
+std::vector< std::vector< double > > strain_basis( const Matrix3D & reciprocal_metric, const SpaceGroup & space_group )
+{
+    std::vector< std::vector< double > > result;
+    for ( size_t j( 0 ); j != 6; ++j )
+    {
+        Matrix3D unit( 0.0 );
+        unit.set_value( row_of_element[j], column_of_element[j], 1.0 );
+        unit.set_value( column_of_element[j], row_of_element[j], 1.0 );
+        Matrix3D average( 0.0 );
+        for ( size_t i( 0 ); i != space_group.nsymmetry_operators(); ++i )
+        {
+            const Matrix3D W = space_group.symmetry_operator( i ).rotation();
+            Matrix3D W_transpose( W );
+            W_transpose.transpose();
+            average += W * unit * W_transpose;
+        }
+        std::vector< double > candidate( 6 );
+        for ( size_t k( 0 ); k != 6; ++k )
+            candidate[k] = average.value( row_of_element[k], column_of_element[k] ) / space_group.nsymmetry_operators();
+        // Gram-Schmidt against the basis so far
+        for ( size_t b( 0 ); b != result.size(); ++b )
+        {
+            double dot( 0.0 );
+            double norm2( 0.0 );
+            for ( size_t k( 0 ); k != 6; ++k )
+            {
+                dot += candidate[k] * result[b][k];
+                norm2 += square( result[b][k] );
+            }
+            for ( size_t k( 0 ); k != 6; ++k )
+                candidate[k] -= ( dot / norm2 ) * result[b][k];
+        }
+        double norm2( 0.0 );
+        for ( size_t k( 0 ); k != 6; ++k )
+            norm2 += square( candidate[k] );
+        if ( norm2 < 1.0E-12 )
+            continue;
+        result.push_back( candidate );
+    }
+    // The scaling does not change the span, so it is done after the orthogonalisation
+    for ( size_t b( 0 ); b != result.size(); ++b )
+    {
+        double largest( 0.0 );
+        for ( size_t k( 0 ); k != 6; ++k )
+            largest = std::max( largest, std::abs( result[b][k] ) / sqrt( reciprocal_metric.value( row_of_element[k], row_of_element[k] ) * reciprocal_metric.value( column_of_element[k], column_of_element[k] ) ) );
+        for ( size_t k( 0 ); k != 6; ++k )
+            result[b][k] /= largest;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+Matrix3D reciprocal_metric_matrix( const CrystalLattice & crystal_lattice )
+{
+    return inverse( crystal_lattice.metric_matrix() );
+}
+
+// ********************************************************************************
+
+CrystalLattice crystal_lattice_from_reciprocal_metric( const Matrix3D & reciprocal_metric )
+{
+    const Matrix3D G = inverse( reciprocal_metric );
+    const double a = sqrt( G.value( 0, 0 ) );
+    const double b = sqrt( G.value( 1, 1 ) );
+    const double c = sqrt( G.value( 2, 2 ) );
+    return CrystalLattice( a, b, c, arccosine( G.value( 1, 2 ) / ( b * c ) ), arccosine( G.value( 0, 2 ) / ( a * c ) ), arccosine( G.value( 0, 1 ) / ( a * b ) ) );
+}
+
+// ********************************************************************************
+
+// The experimental pattern prepared for the weighted cross correlation: I/sigma and its triangle-filtered version.
+struct ExperimentalData
+{
+    ExperimentalData( const PowderPattern & powder_pattern, const Angle l ):
+    two_theta_start_( powder_pattern.two_theta_start().value_in_degrees() ),
+    two_theta_step_( powder_pattern.average_two_theta_step().value_in_degrees() ),
+    m_( weighted_cross_correlation_window( powder_pattern, l ) ),
+    intensities_over_ESDs_( intensities_over_ESDs( powder_pattern ) ),
+    one_over_ESDs_( powder_pattern.size() ),
+    filtered_( powder_pattern.size() ),
+    norm_(0.0)
+    {
+        for ( size_t i( 0 ); i != one_over_ESDs_.size(); ++i )
+            one_over_ESDs_[i] = 1.0 / powder_pattern.estimated_standard_deviation( i );
+        triangle_filter( &intensities_over_ESDs_[0], intensities_over_ESDs_.size(), m_, &filtered_[0] );
+        for ( size_t i( 0 ); i != filtered_.size(); ++i )
+            norm_ += intensities_over_ESDs_[i] * filtered_[i];
+    }
+
+    size_t npoints() const { return filtered_.size(); }
+
+    double two_theta_start_; // In degrees
+    double two_theta_step_;  // In degrees
+    int m_;
+    std::vector< double > intensities_over_ESDs_;
+    std::vector< double > one_over_ESDs_;
+    std::vector< double > filtered_;
+    double norm_; // weighted_cross_correlation( e, e )
+};
+
+// ********************************************************************************
+
+// The similarity as a function of the parameters for one structure. 1/d^2 of reflection k is Q0_k + sum_j coefficient_kj p_j.
+class VariableCellProblem
+{
+public:
+
+    VariableCellProblem( const ExperimentalData & experimental_data, const double wavelength, const double FWHM,
+                         const CrystalLattice & crystal_lattice, const SpaceGroup & space_group, const ReflectionList & reflection_list ):
+    experimental_data_( experimental_data ),
+    wavelength_( wavelength ),
+    FWHM_( FWHM ),
+    peak_shape_function_( FWHM, 0.9 ),
+    reciprocal_metric_( reciprocal_metric_matrix( crystal_lattice ) ),
+    basis_( strain_basis( reciprocal_metric_, space_group ) )
+    {
+        intensities_.reserve( reflection_list.size() );
+        Q0_.reserve( reflection_list.size() );
+        coefficients_.reserve( reflection_list.size() * basis_.size() );
+        for ( size_t k( 0 ); k != reflection_list.size(); ++k )
+        {
+            const double d = reflection_list.d_spacing( k );
+            if ( wavelength_ >= 2.0 * d )
+                continue;
+            const double F_squared_times_multiplicity = reflection_list.F_squared( k ) * reflection_list.multiplicity( k );
+            if ( F_squared_times_multiplicity == 0.0 )
+                continue;
+            const Angle theta = arcsine( wavelength_ / ( 2.0 * d ) );
+            const Angle two_theta = 2.0 * theta;
+            const double LP_factor = ( 1.0 + square( two_theta.cosine() ) ) / ( 2.0 * two_theta.sine() * theta.sine() );
+            intensities_.push_back( F_squared_times_multiplicity * LP_factor );
+            Q0_.push_back( 1.0 / square( d ) );
+            const MillerIndices hkl = reflection_list.miller_indices( k );
+            const double h[ 3 ] = { static_cast<double>( hkl.h() ), static_cast<double>( hkl.k() ), static_cast<double>( hkl.l() ) };
+            for ( size_t j( 0 ); j != basis_.size(); ++j )
+            {
+                double coefficient( 0.0 );
+                for ( size_t e( 0 ); e != 6; ++e )
+                    coefficient += ( ( e < 3 ) ? 1.0 : 2.0 ) * h[ row_of_element[e] ] * h[ column_of_element[e] ] * basis_[j][e];
+                coefficients_.push_back( coefficient );
+            }
+        }
+    }
+
+    // The strains followed by the zero point in degrees
+    size_t nparameters() const { return basis_.size() + 1; }
+
+    // Returns the similarity, derivatives must have nparameters() elements.
+    double evaluate( const std::vector< double > & parameters, std::vector< double > & derivatives ) const
+    {
+        const size_t nstrains = basis_.size();
+        const size_t npoints = experimental_data_.npoints();
+        const double start = experimental_data_.two_theta_start_;
+        const double step = experimental_data_.two_theta_step_;
+        const double half_width = peak_shape_function_.range( FWHM_, 0.9 );
+        const double zero_point = parameters[ nstrains ];
+        positions_.assign( intensities_.size(), 0.0 );
+        position_derivatives_.assign( intensities_.size(), 0.0 );
+        calculated_.assign( npoints, 0.0 );
+        double value;
+        double d_delta;
+        double d_FWHM;
+        for ( size_t k( 0 ); k != intensities_.size(); ++k )
+        {
+            double Q = Q0_[k];
+            for ( size_t j( 0 ); j != nstrains; ++j )
+                Q += coefficients_[ k * nstrains + j ] * parameters[j];
+            const double sine_theta = ( Q > 0.0 ) ? 0.5 * wavelength_ * sqrt( Q ) : 1.0;
+            if ( sine_theta >= 1.0 )
+            {
+                positions_[k] = -1.0; // Marks a reflection that does not exist
+                continue;
+            }
+            positions_[k] = 2.0 * asin( sine_theta ) * radians2degrees + zero_point;
+            // d(2theta)/dQ, in degrees
+            position_derivatives_[k] = radians2degrees * wavelength_ / ( 2.0 * sqrt( Q ) * sqrt( 1.0 - square( sine_theta ) ) );
+            size_t first;
+            size_t last;
+            if ( ! window( positions_[k], half_width, first, last ) )
+                continue;
+            for ( size_t i( first ); i != last; ++i )
+            {
+                peak_shape_function_.value_and_derivatives( start + i * step - positions_[k], FWHM_, 0.9, value, d_delta, d_FWHM );
+                calculated_[i] += intensities_[k] * value;
+            }
+        }
+        // The calculated pattern is weighted with the ESDs of the experimental pattern
+        for ( size_t i( 0 ); i != npoints; ++i )
+            calculated_[i] *= experimental_data_.one_over_ESDs_[i];
+        filtered_.resize( npoints );
+        triangle_filter( &calculated_[0], npoints, experimental_data_.m_, &filtered_[0] );
+        double cross( 0.0 );
+        double norm( 0.0 );
+        for ( size_t i( 0 ); i != npoints; ++i )
+        {
+            cross += experimental_data_.filtered_[i] * calculated_[i];
+            norm += calculated_[i] * filtered_[i];
+        }
+        derivatives.assign( nparameters(), 0.0 );
+        if ( ( cross <= 0.0 ) || ( norm <= 0.0 ) || ( experimental_data_.norm_ <= 0.0 ) )
+            return 0.0;
+        const double result = cross / sqrt( experimental_data_.norm_ * norm );
+        // The derivative with respect to the unweighted calculated intensity at point i, the triangle filter is symmetric
+        gradient_.resize( npoints );
+        for ( size_t i( 0 ); i != npoints; ++i )
+            gradient_[i] = result * ( experimental_data_.filtered_[i] / cross - filtered_[i] / norm ) * experimental_data_.one_over_ESDs_[i];
+        for ( size_t k( 0 ); k != intensities_.size(); ++k )
+        {
+            if ( positions_[k] < 0.0 )
+                continue;
+            size_t first;
+            size_t last;
+            if ( ! window( positions_[k], half_width, first, last ) )
+                continue;
+            double sum( 0.0 );
+            for ( size_t i( first ); i != last; ++i )
+            {
+                peak_shape_function_.value_and_derivatives( start + i * step - positions_[k], FWHM_, 0.9, value, d_delta, d_FWHM );
+                sum += gradient_[i] * d_delta;
+            }
+            // delta = 2theta_i - position
+            const double d_position = -intensities_[k] * sum;
+            for ( size_t j( 0 ); j != nstrains; ++j )
+                derivatives[j] += d_position * position_derivatives_[k] * coefficients_[ k * nstrains + j ];
+            derivatives[ nstrains ] += d_position;
+        }
+        return result;
+    }
+
+    Matrix3D reciprocal_metric( const std::vector< double > & parameters ) const
+    {
+        Matrix3D result( reciprocal_metric_ );
+        for ( size_t j( 0 ); j != basis_.size(); ++j )
+        {
+            for ( size_t e( 0 ); e != 6; ++e )
+            {
+                result.set_value( row_of_element[e], column_of_element[e], result.value( row_of_element[e], column_of_element[e] ) + parameters[j] * basis_[j][e] );
+                if ( e > 2 )
+                    result.set_value( column_of_element[e], row_of_element[e], result.value( row_of_element[e], column_of_element[e] ) );
+            }
+        }
+        return result;
+    }
+
+    double cell_deformation( const std::vector< double > & parameters ) const
+    {
+        const Matrix3D G = inverse( reciprocal_metric_ );
+        const Matrix3D difference = inverse( reciprocal_metric( parameters ) ) - G;
+        double numerator( 0.0 );
+        double denominator( 0.0 );
+        for ( size_t i( 0 ); i != 3; ++i )
+        {
+            for ( size_t j( 0 ); j != 3; ++j )
+            {
+                numerator += square( difference.value( i, j ) );
+                denominator += square( G.value( i, j ) );
+            }
+        }
+        return sqrt( numerator / denominator );
+    }
+
+private:
+    const ExperimentalData & experimental_data_;
+    double wavelength_;
+    double FWHM_;
+    PseudoVoigtPeakShape peak_shape_function_;
+    Matrix3D reciprocal_metric_;
+    std::vector< std::vector< double > > basis_;
+    std::vector< double > intensities_; // F^2 * multiplicity * LP
+    std::vector< double > Q0_;
+    std::vector< double > coefficients_; // nstrains per reflection
+    // Work space, so that an evaluation does not allocate
+    mutable std::vector< double > positions_;
+    mutable std::vector< double > position_derivatives_;
+    mutable std::vector< double > calculated_;
+    mutable std::vector< double > filtered_;
+    mutable std::vector< double > gradient_;
+
+    // The points [first, last> within half_width of the position, returns false if there are none.
+    bool window( const double position, const double half_width, size_t & first, size_t & last ) const
+    {
+        const double start = experimental_data_.two_theta_start_;
+        const double step = experimental_data_.two_theta_step_;
+        const double lower = std::ceil( ( position - half_width - start ) / step );
+        const double upper = std::floor( ( position + half_width - start ) / step ) + 1.0;
+        if ( ( upper <= 0.0 ) || ( lower >= static_cast<double>( experimental_data_.npoints() ) ) )
+            return false;
+        first = ( lower < 0.0 ) ? 0 : static_cast<size_t>( lower );
+        last = std::min( static_cast<size_t>( upper ), experimental_data_.npoints() );
+        return first < last;
+    }
+};
+
+// ********************************************************************************
+
+// Maximises the similarity with BFGS within the bounds -half_ranges[j] <= p[j] <= half_ranges[j], starting from parameters.
+// The parameters are scaled to [-1,1] so that the bounds of the strains and of the zero point are comparable.
+// A parameter with a half range of 0.0 is kept at 0.0. Returns the number of iterations.
+size_t maximise( const VariableCellProblem & problem, const std::vector< double > & half_ranges, const size_t maximum_niterations,
+                 std::vector< double > & parameters, double & similarity )
+{
+    const size_t n = parameters.size();
+    std::vector< double > u( n, 0.0 );
+    std::vector< double > derivatives;
+    // We minimise -similarity as a function of u
+    auto evaluate = [&]( const std::vector< double > & point, std::vector< double > & gradient )
+    {
+        for ( size_t j( 0 ); j != n; ++j )
+            parameters[j] = point[j] * half_ranges[j];
+        const double result = -problem.evaluate( parameters, derivatives );
+        gradient.resize( n );
+        for ( size_t j( 0 ); j != n; ++j )
+            gradient[j] = -derivatives[j] * half_ranges[j];
+        return result;
+    };
+    std::vector< double > gradient;
+    double F = evaluate( u, gradient );
+    std::vector< double > H;
+    auto reset_H = [&]()
+    {
+        double largest( 0.0 );
+        for ( size_t j( 0 ); j != n; ++j )
+            largest = std::max( largest, std::abs( gradient[j] ) );
+        H.assign( n * n, 0.0 );
+        for ( size_t j( 0 ); j != n; ++j )
+            H[ j * n + j ] = ( largest > 0.0 ) ? 0.1 / largest : 0.0;
+    };
+    reset_H();
+    std::vector< double > direction( n );
+    std::vector< double > new_u( n );
+    std::vector< double > new_gradient;
+    size_t iteration( 0 );
+    for ( ; iteration != maximum_niterations; ++iteration )
+    {
+        double slope( 0.0 );
+        for ( size_t attempt( 0 ); attempt != 2; ++attempt )
+        {
+            slope = 0.0;
+            for ( size_t j( 0 ); j != n; ++j )
+            {
+                direction[j] = 0.0;
+                for ( size_t k( 0 ); k != n; ++k )
+                    direction[j] -= H[ j * n + k ] * gradient[k];
+                // Parameters at a bound that would be pushed further out are kept
+                if ( ( half_ranges[j] == 0.0 ) || ( ( u[j] >=  1.0 ) && ( direction[j] > 0.0 ) ) || ( ( u[j] <= -1.0 ) && ( direction[j] < 0.0 ) ) )
+                    direction[j] = 0.0;
+                slope += direction[j] * gradient[j];
+            }
+            if ( slope < 0.0 )
+                break;
+            reset_H();
+        }
+        if ( slope >= 0.0 )
+            break;
+        double step( 1.0 );
+        double new_F( F );
+        bool accepted( false );
+        for ( size_t halving( 0 ); halving != 30; ++halving )
+        {
+            double predicted( 0.0 );
+            for ( size_t j( 0 ); j != n; ++j )
+            {
+                new_u[j] = std::max( -1.0, std::min( 1.0, u[j] + step * direction[j] ) );
+                predicted += gradient[j] * ( new_u[j] - u[j] );
+            }
+            new_F = evaluate( new_u, new_gradient );
+            if ( new_F <= F + 1.0E-4 * predicted )
+            {
+                accepted = true;
+                break;
+            }
+            step *= 0.5;
+        }
+        if ( ! accepted )
+            break;
+        // BFGS update of the inverse Hessian: H = ( I - rho s y^T ) H ( I - rho y s^T ) + rho s s^T
+        std::vector< double > s( n );
+        std::vector< double > y( n );
+        double sy( 0.0 );
+        for ( size_t j( 0 ); j != n; ++j )
+        {
+            s[j] = new_u[j] - u[j];
+            y[j] = new_gradient[j] - gradient[j];
+            sy += s[j] * y[j];
+        }
+        if ( sy > 1.0E-16 )
+        {
+            const double rho = 1.0 / sy;
+            std::vector< double > Hy( n, 0.0 );
+            double yHy( 0.0 );
+            for ( size_t j( 0 ); j != n; ++j )
+            {
+                for ( size_t k( 0 ); k != n; ++k )
+                    Hy[j] += H[ j * n + k ] * y[k];
+                yHy += y[j] * Hy[j];
+            }
+            for ( size_t j( 0 ); j != n; ++j )
+            {
+                for ( size_t k( 0 ); k != n; ++k )
+                    H[ j * n + k ] += -rho * ( Hy[j] * s[k] + s[j] * Hy[k] ) + ( rho * rho * yHy + rho ) * s[j] * s[k];
+            }
+        }
+        const double improvement = F - new_F;
+        u = new_u;
+        gradient = new_gradient;
+        F = new_F;
+        if ( improvement < 1.0E-10 * std::max( 1.0, std::abs( F ) ) )
+        {
+            ++iteration;
+            break;
+        }
+    }
+    for ( size_t j( 0 ); j != n; ++j )
+        parameters[j] = u[j] * half_ranges[j];
+    similarity = -F;
+    return iteration;
+}
+
+} // namespace
+
+// ********************************************************************************
+
+VariableCellMatch::VariableCellMatch( const PowderPattern & experimental_pattern ):
+experimental_pattern_(experimental_pattern),
+FWHM_(0.1),
+l_(3.0,Angle::DEGREES),
+maximum_strain_(0.05),
+maximum_zero_point_(0.1,Angle::DEGREES),
+maximum_niterations_(100),
+nthreads_(0)
+{
+    if ( ! experimental_pattern_.has_constant_two_theta_step() )
+        throw std::runtime_error( "VariableCellMatch::VariableCellMatch(): the experimental pattern must have a constant 2theta step." );
+    if ( experimental_pattern_.size() < 2 )
+        throw std::runtime_error( "VariableCellMatch::VariableCellMatch(): the experimental pattern must have at least two points." );
+}
+
+// ********************************************************************************
+
+VariableCellMatchResult VariableCellMatch::match( const CrystalStructure & crystal_structure ) const
+{
+    PowderPatternCalculator powder_pattern_calculator( crystal_structure );
+    powder_pattern_calculator.set_wavelength( experimental_pattern_.wavelength() );
+    powder_pattern_calculator.set_two_theta_start( experimental_pattern_.two_theta_start() );
+    // A reflection beyond the end can move in: sin(theta) changes by at most about a factor sqrt( 1 + 3 * maximum_strain ),
+    // and the tail of a peak reaches into the pattern from up to the range of the peak shape beyond the end.
+    const Angle theta_end = ( experimental_pattern_.two_theta_end() + maximum_zero_point_ ) / 2.0;
+    const double sine_theta_end = std::min( 1.0, theta_end.sine() * sqrt( 1.0 + 3.0 * maximum_strain_ ) );
+    const Angle peak_range = Angle::from_degrees( PseudoVoigtPeakShape( FWHM_, 0.9 ).range( FWHM_, 0.9 ) );
+    powder_pattern_calculator.set_two_theta_end( std::min( 2.0 * arcsine( sine_theta_end ) + peak_range, Angle::from_degrees( 179.0 ) ) );
+    powder_pattern_calculator.calculate_reflection_list();
+    powder_pattern_calculator.calculate_structure_factors();
+    return match( crystal_structure.crystal_lattice(), crystal_structure.space_group(), powder_pattern_calculator.reflection_list() );
+}
+
+// ********************************************************************************
+
+VariableCellMatchResult VariableCellMatch::match( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group, const ReflectionList & reflection_list ) const
+{
+    MACRO_SCOPED_TIMER( "VariableCellMatch::match()" );
+    const ExperimentalData experimental_data( experimental_pattern_, l_ );
+    const VariableCellProblem problem( experimental_data, experimental_pattern_.wavelength(), FWHM_, crystal_lattice, space_group, reflection_list );
+    const size_t nparameters = problem.nparameters();
+    std::vector< double > half_ranges( nparameters, maximum_strain_ );
+    half_ranges[ nparameters - 1 ] = maximum_zero_point_.value_in_degrees();
+    std::vector< double > parameters( nparameters, 0.0 );
+    std::vector< double > derivatives;
+    VariableCellMatchResult result;
+    result.similarity_before_ = problem.evaluate( parameters, derivatives );
+    result.niterations_ = maximise( problem, half_ranges, maximum_niterations_, parameters, result.similarity_ );
+    result.crystal_lattice_ = crystal_lattice_from_reciprocal_metric( problem.reciprocal_metric( parameters ) );
+    result.zero_point_ = Angle::from_degrees( parameters[ nparameters - 1 ] );
+    result.cell_deformation_ = problem.cell_deformation( parameters );
+    return result;
+}
+
+// ********************************************************************************
+
+size_t VariableCellMatch::match( const FileList & file_list, std::vector< VariableCellMatchResult > & results, std::vector< std::string > & error_messages ) const
+{
+    const size_t nfiles = file_list.size();
+    results = std::vector< VariableCellMatchResult >( nfiles );
+    error_messages = std::vector< std::string >( nfiles );
+    parallel_for( nfiles, nthreads_, [&]( const size_t i )
+    {
+        ScratchArenaScope scratch_arena_scope;
+        try
+        {
+            CrystalStructure crystal_structure;
+            read_cif( file_list.value( i ), crystal_structure );
+            crystal_structure.apply_space_group_symmetry();
+            results[i] = match( crystal_structure );
+        }
+        catch ( std::exception & e )
+        {
+            error_messages[i] = e.what();
+        }
+    } );
+    size_t nfailed( 0 );
+    for ( size_t i( 0 ); i != nfiles; ++i )
+    {
+        if ( ! error_messages[i].empty() )
+            ++nfailed;
+    }
+    return nfailed;
+}
+
+// ********************************************************************************
+
+size_t VariableCellMatch::nparameters( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group ) const
+{
+    return strain_basis( reciprocal_metric_matrix( crystal_lattice ), space_group ).size() + 1;
+}
+
+// ********************************************************************************
+
+double VariableCellMatch::similarity( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group, const ReflectionList & reflection_list,
+                                      const std::vector< double > & parameters, std::vector< double > & derivatives ) const
+{
+    const ExperimentalData experimental_data( experimental_pattern_, l_ );
+    const VariableCellProblem problem( experimental_data, experimental_pattern_.wavelength(), FWHM_, crystal_lattice, space_group, reflection_list );
+    if ( parameters.size() != problem.nparameters() )
+        throw std::runtime_error( "VariableCellMatch::similarity(): wrong number of parameters." );
+    return problem.evaluate( parameters, derivatives );
+}
@@ -0,0 +1,136 @@
+#ifndef VARIABLECELLMATCH_H
+#define VARIABLECELLMATCH_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class CrystalStructure;
+class FileList;
+class ReflectionList;
+class SpaceGroup;
+
+#include "Angle.h"
+#include "CrystalLattice.h"
+#include "PowderPattern.h"
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+struct VariableCellMatchResult
+{
+    VariableCellMatchResult(): similarity_before_(0.0), similarity_(0.0), cell_deformation_(0.0), niterations_(0) {}
+
+    double similarity_before_; // For the unit cell as given and a zero point of 0.0
+    double similarity_;
+    CrystalLattice crystal_lattice_; // The deformed unit cell
+    Angle zero_point_;
+    // The relative change of the metric tensor, | G' - G | / | G | with the Frobenius norm.
+    double cell_deformation_;
+    size_t niterations_;
+};
+
+/*
+  Compares a calculated powder pattern with an experimental one while allowing small deformations of the unit cell and a zero-point error,
+  e.g. for a structure from a crystal structure prediction at 0 K against a pattern measured at room temperature.
+  This is the variable-cell match behind the CellDeformation column of a PowderMatchTable.
+
+  The F^2 values are calculated once, only the peak positions move. The deformation is applied to the reciprocal metric tensor G*,
+  so that 1/d^2 = h G* h^T is linear in the parameters. Only deformations that are invariant under the rotations of the space group are
+  allowed, so the equivalent reflections that are stored as one reflection stay together and e.g. a tetragonal cell stays tetragonal.
+  Each parameter is bounded by maximum_strain(), a relative change of the elements of G*; the relative change of a, b and c is about half that.
+
+  The similarity is normalised_weighted_cross_correlation() of the experimental pattern and a calculated pattern that is not normalised
+  and whose ESDs are all 1.0, so that it is a smooth function of the peak positions. It is maximised with BFGS with analytical derivatives
+  within the bounds. A calculated pattern is the same as that of PowderPatternCalculator::calculate() without a peak shape function,
+  except that the LP factor is that of the original peak positions and the Gaussian is evaluated exactly.
+  The preferred orientation and a wavelength doublet are not modelled.
+
+  A match costs a few tens of pattern calculations, without the structure factors.
+*/
+class VariableCellMatch
+{
+public:
+
+    // The experimental pattern must have a constant 2theta step, its wavelength is used.
+    explicit VariableCellMatch( const PowderPattern & experimental_pattern );
+
+    double FWHM() const { return FWHM_; }
+    void set_FWHM( const double FWHM ) { FWHM_ = FWHM; }
+
+    // l as in normalised_weighted_cross_correlation(), the default is 3.0 degrees. A wider window gives a smoother function that
+    // converges from further away.
+    Angle l() const { return l_; }
+    void set_l( const Angle l ) { l_ = l; }
+
+    // The default is 0.05.
+    double maximum_strain() const { return maximum_strain_; }
+    void set_maximum_strain( const double maximum_strain ) { maximum_strain_ = maximum_strain; }
+
+    // The default is 0.1 degrees. 0.0 fixes the zero point at 0.0.
+    Angle maximum_zero_point() const { return maximum_zero_point_; }
+    void set_maximum_zero_point( const Angle maximum_zero_point ) { maximum_zero_point_ = maximum_zero_point; }
+
+    // The default is 100.
+    size_t maximum_niterations() const { return maximum_niterations_; }
+    void set_maximum_niterations( const size_t maximum_niterations ) { maximum_niterations_ = maximum_niterations; }
+
+    // Only used by match( FileList ), 0 means one thread per core. Default 0.
+    size_t nthreads() const { return nthreads_; }
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; }
+
+    // The space-group symmetry must have been applied. Calculates the F^2 values for the range of the experimental pattern
+    // plus the furthest that a reflection can move.
+    VariableCellMatchResult match( const CrystalStructure & crystal_structure ) const;
+
+    // reflection_list must contain the F^2 values and the d-spacings for crystal_lattice. The space group only provides the rotations.
+    VariableCellMatchResult match( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group, const ReflectionList & reflection_list ) const;
+
+    // Expects file_list to contain .cif files, the space-group symmetry is applied after reading. The files are matched in parallel.
+    // results are in the order of file_list. If a file fails, its error message is stored, its similarities are 0.0,
+    // and the other files are processed as normal. Returns the number of files that failed.
+    size_t match( const FileList & file_list, std::vector< VariableCellMatchResult > & results, std::vector< std::string > & error_messages ) const;
+
+    // The number of parameters for a space group: the deformations that are allowed plus the zero point, which is the last parameter.
+    size_t nparameters( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group ) const;
+
+    // The similarity and its derivatives with respect to the parameters, at the given parameters. For testing.
+    double similarity( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group, const ReflectionList & reflection_list,
+                       const std::vector< double > & parameters, std::vector< double > & derivatives ) const;
+
+private:
+    PowderPattern experimental_pattern_;
+    double FWHM_;
+    Angle l_;
+    double maximum_strain_;
+    Angle maximum_zero_point_;
+    size_t maximum_niterations_;
+    size_t nthreads_;
+};
+
+#endif // VARIABLECELLMATCH_H
@@ -34,24 +34,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // ********************************************************************************
 
-Vector3D::Vector3D()
-{
-    data_[0] = 0.0;
-    data_[1] = 0.0;
-    data_[2] = 0.0;
-}
-
-// ********************************************************************************
-
-Vector3D::Vector3D( const double x, const double y, const double z )
-{
-    data_[0] = x;
-    data_[1] = y;
-    data_[2] = z;
-}
-
-// ********************************************************************************
-
 void Vector3D::set_length( const double value )
 {
     throw_if_zero_vector();
@@ -78,66 +60,6 @@ void Vector3D::throw_if_zero_vector( const double tolerance ) const
 
 // ********************************************************************************
 
-Vector3D & Vector3D::operator+=( const Vector3D & rhs )
-{
-    *this = Vector3D( x()+rhs.x(), y()+rhs.y(), z()+rhs.z() );
-    return *this;
-}
-
-// ********************************************************************************
-
-Vector3D & Vector3D::operator-=( const Vector3D & rhs )
-{
-    *this = Vector3D( x()-rhs.x(), y()-rhs.y(), z()-rhs.z() );
-    return *this;
-}
-
-// ********************************************************************************
-
-Vector3D & Vector3D::operator/=( const double rhs )
-{
-    *this = Vector3D( x() / rhs, y() / rhs, z() / rhs );
-    return *this;
-}
-
-// ********************************************************************************
-
-Vector3D & Vector3D::operator*=( const double rhs )
-{
-    *this = Vector3D( x() * rhs, y() * rhs, z() * rhs );
-    return *this;
-}
-
-// ********************************************************************************
-
-Vector3D Vector3D::operator-() const
-{
-    return Vector3D( -data_[0], -data_[1], -data_[2] );
-}
-
-// ********************************************************************************
-
-Vector3D Vector3D::operator+() const
-{
-    return Vector3D( data_[0], data_[1], data_[2] );
-}
-
-// ********************************************************************************
-
-double Vector3D::norm2() const
-{
-    return data_[0]*data_[0] + data_[1]*data_[1] + data_[2]*data_[2];
-}
-
-// ********************************************************************************
-
-double Vector3D::length() const
-{
-    return sqrt( norm2() );
-}
-
-// ********************************************************************************
-
 void Vector3D::orthogonalise( const Vector3D & other )
 {
     double c = -(*this*other)/other.norm2();
@@ -188,64 +110,6 @@ bool nearly_equal( const Vector3D & lhs, const Vector3D & rhs, const double tole
 
 // ********************************************************************************
 
-Vector3D operator+( const Vector3D & lhs, const Vector3D & rhs )
-{
-    return Vector3D( lhs.x() + rhs.x(), lhs.y() + rhs.y(), lhs.z() + rhs.z() );
-}
-
-// ********************************************************************************
-
-Vector3D operator-( const Vector3D & lhs, const Vector3D & rhs )
-{
-    return Vector3D( lhs.x() - rhs.x(), lhs.y() - rhs.y(), lhs.z() - rhs.z() );
-}
-
-// ********************************************************************************
-
-double operator*( const Vector3D & lhs, const Vector3D & rhs )
-{
-    return ( lhs.x() * rhs.x() + lhs.y() * rhs.y() + lhs.z() * rhs.z() );
-}
-
-// ********************************************************************************
-
-Vector3D operator*( const Vector3D & lhs, const double rhs )
-{
-    return Vector3D( lhs.x()*rhs, lhs.y()*rhs, lhs.z()*rhs );
-}
-
-// ********************************************************************************
-
-Vector3D operator/( const Vector3D & lhs, const double rhs )
-{
-    return Vector3D( lhs.x()/rhs, lhs.y()/rhs, lhs.z()/rhs );
-}
-
-// ********************************************************************************
-
-Vector3D operator*( const double lhs, const Vector3D & rhs )
-{
-    return Vector3D( rhs.x()*lhs, rhs.y()*lhs, rhs.z()*lhs );
-}
-
-// ********************************************************************************
-
-Vector3D cross_product( const Vector3D & lhs, const Vector3D & rhs )
-{
-    return Vector3D( lhs.y() * rhs.z() - lhs.z() * rhs.y(),
-                     lhs.z() * rhs.x() - lhs.x() * rhs.z(),
-                     lhs.x() * rhs.y() - lhs.y() * rhs.x() );
-}
-
-// ********************************************************************************
-
-Vector3D square( const Vector3D & vector3d )
-{
-    return Vector3D( vector3d.x()*vector3d.x(), vector3d.y()*vector3d.y(), vector3d.z()*vector3d.z() );
-}
-
-// ********************************************************************************
-
 Vector3D sqrt( const Vector3D & vector3d )
 {
     return Vector3D( std::sqrt( vector3d.x() ), std::sqrt( vector3d.y() ), std::sqrt( vector3d.z() ) );
@@ -28,31 +28,36 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include <cmath>
 #include <cstddef> // For definition of size_t
 #include <iosfwd>
+#include <string>
 
 /*
   A vector of dimension 3.
   
   There is no member function normalise(), instead use NormalisedVector3D n = normalised_vector( r );
+
+  The arithmetic is defined inline in this header, and is constexpr where <cmath> allows it, because it is called
+  in the innermost loops and the Makefile does not use link-time optimisation.
 */
 class Vector3D
 {
 public:
 
     // Default constructor: zero vector
-    Vector3D();
-
-    Vector3D( const double x, const double y, const double z );
-
-    double x() const { return data_[0]; }
-    double y() const { return data_[1]; }
-    double z() const { return data_[2]; }
-    void set_x( const double value ) { data_[0] = value; }
-    void set_y( const double value ) { data_[1] = value; }
-    void set_z( const double value ) { data_[2] = value; }
-    double value( const size_t i ) const { return data_[i]; }
-    void set_value( const size_t i, const double value ) { data_[i] = value; }
+    constexpr Vector3D(): data_{ 0.0, 0.0, 0.0 } {}
+
+    constexpr Vector3D( const double x, const double y, const double z ): data_{ x, y, z } {}
+
+    constexpr double x() const { return data_[0]; }
+    constexpr double y() const { return data_[1]; }
+    constexpr double z() const { return data_[2]; }
+    constexpr void set_x( const double value ) { data_[0] = value; }
+    constexpr void set_y( const double value ) { data_[1] = value; }
+    constexpr void set_z( const double value ) { data_[2] = value; }
+    constexpr double value( const size_t i ) const { return data_[i]; }
+    constexpr void set_value( const size_t i, const double value ) { data_[i] = value; }
     
     void set_length( const double value );
 
@@ -64,17 +69,44 @@ public:
     // (To avoid the sqrt of length() .)
     void throw_if_zero_vector( const double tolerance = 0.000001 ) const;
 
-    Vector3D & operator+=( const Vector3D & rhs );
-    Vector3D & operator-=( const Vector3D & rhs );
-    Vector3D & operator/=( const double rhs );
-    Vector3D & operator*=( const double rhs );
-
-    Vector3D operator-() const;
-    Vector3D operator+() const;
-
-    double norm2() const;
-
-    double length() const;
+    constexpr Vector3D & operator+=( const Vector3D & rhs )
+    {
+        data_[0] += rhs.data_[0];
+        data_[1] += rhs.data_[1];
+        data_[2] += rhs.data_[2];
+        return *this;
+    }
+
+    constexpr Vector3D & operator-=( const Vector3D & rhs )
+    {
+        data_[0] -= rhs.data_[0];
+        data_[1] -= rhs.data_[1];
+        data_[2] -= rhs.data_[2];
+        return *this;
+    }
+
+    constexpr Vector3D & operator/=( const double rhs )
+    {
+        data_[0] /= rhs;
+        data_[1] /= rhs;
+        data_[2] /= rhs;
+        return *this;
+    }
+
+    constexpr Vector3D & operator*=( const double rhs )
+    {
+        data_[0] *= rhs;
+        data_[1] *= rhs;
+        data_[2] *= rhs;
+        return *this;
+    }
+
+    constexpr Vector3D operator-() const { return Vector3D( -data_[0], -data_[1], -data_[2] ); }
+    constexpr Vector3D operator+() const { return *this; }
+
+    constexpr double norm2() const { return data_[0]*data_[0] + data_[1]*data_[1] + data_[2]*data_[2]; }
+
+    double length() const { return std::sqrt( norm2() ); }
 
     void orthogonalise( const Vector3D & other );
     
@@ -92,17 +124,48 @@ std::ostream & operator<<( std::ostream & os, const Vector3D & vector3d );
 
 bool nearly_equal( const Vector3D & lhs, const Vector3D & rhs, const double tolerance = 0.0000001 );
 
-Vector3D operator+( const Vector3D & lhs, const Vector3D & rhs );
-Vector3D operator-( const Vector3D & lhs, const Vector3D & rhs );
+constexpr Vector3D operator+( const Vector3D & lhs, const Vector3D & rhs )
+{
+    return Vector3D( lhs.x() + rhs.x(), lhs.y() + rhs.y(), lhs.z() + rhs.z() );
+}
+
+constexpr Vector3D operator-( const Vector3D & lhs, const Vector3D & rhs )
+{
+    return Vector3D( lhs.x() - rhs.x(), lhs.y() - rhs.y(), lhs.z() - rhs.z() );
+}
+
 // The transposition is implied
-double operator*( const Vector3D & lhs, const Vector3D & rhs );
-Vector3D operator*( const Vector3D & lhs, const double rhs );
-Vector3D operator/( const Vector3D & lhs, const double rhs );
-Vector3D operator*( const double lhs, const Vector3D & rhs );
+constexpr double operator*( const Vector3D & lhs, const Vector3D & rhs )
+{
+    return ( lhs.x() * rhs.x() + lhs.y() * rhs.y() + lhs.z() * rhs.z() );
+}
 
-Vector3D cross_product( const Vector3D & lhs, const Vector3D & rhs );
+constexpr Vector3D operator*( const Vector3D & lhs, const double rhs )
+{
+    return Vector3D( lhs.x()*rhs, lhs.y()*rhs, lhs.z()*rhs );
+}
+
+constexpr Vector3D operator/( const Vector3D & lhs, const double rhs )
+{
+    return Vector3D( lhs.x()/rhs, lhs.y()/rhs, lhs.z()/rhs );
+}
+
+constexpr Vector3D operator*( const double lhs, const Vector3D & rhs )
+{
+    return Vector3D( rhs.x()*lhs, rhs.y()*lhs, rhs.z()*lhs );
+}
+
+constexpr Vector3D cross_product( const Vector3D & lhs, const Vector3D & rhs )
+{
+    return Vector3D( lhs.y() * rhs.z() - lhs.z() * rhs.y(),
+                     lhs.z() * rhs.x() - lhs.x() * rhs.z(),
+                     lhs.x() * rhs.y() - lhs.y() * rhs.x() );
+}
 
-Vector3D square( const Vector3D & vector3d );
+constexpr Vector3D square( const Vector3D & vector3d )
+{
+    return Vector3D( vector3d.x()*vector3d.x(), vector3d.y()*vector3d.y(), vector3d.z()*vector3d.z() );
+}
 Vector3D sqrt( const Vector3D & vector3d );
 
 #endif // VECTOR3D_H
@@ -27,145 +27,452 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "VoidsFinder.h"
 #include "3DCalculations.h"
+#include "CellList.h"
 #include "CrystalStructure.h"
+#include "FileName.h"
+#include "Instrumentation.h"
 #include "MathFunctions.h"
+#include "ParallelFor.h"
 #include "Plane.h"
-#include "RandomNumberGenerator.h"
+#include "RunningAverageAndESD.h"
+#include "ScratchArena.h"
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <memory_resource>
 #include <stdexcept>
 
 namespace {
 
-// Position is in Fractional coordinates
-bool intersects_atoms( const CrystalStructure & crystal_structure, const Vector3D & position, const std::vector< double > & distances2 )
+int modulo( const int i, const int n )
 {
-    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+    const int result = i % n;
+    return ( result < 0 ) ? result + n : result;
+}
+
+// A periodic grid over the unit cell, the grid points are at fractional coordinates ( i/na, j/nb, k/nc ).
+// The u index runs fastest. The grid is a temporary, so it lives in the scratch arena.
+class PeriodicGrid
+{
+public:
+
+    PeriodicGrid( const CrystalLattice & crystal_lattice, const double grid_spacing ):
+        crystal_lattice_(crystal_lattice),
+        metric_(crystal_lattice.metric_matrix()),
+        data_( scratch_resource() )
+    {
+        if ( grid_spacing <= 0.0 )
+            throw std::runtime_error( "PeriodicGrid::PeriodicGrid(): grid spacing must be positive." );
+        n_[0] = std::max( 1, static_cast<int>( std::ceil( crystal_lattice.a() / grid_spacing ) ) );
+        n_[1] = std::max( 1, static_cast<int>( std::ceil( crystal_lattice.b() / grid_spacing ) ) );
+        n_[2] = std::max( 1, static_cast<int>( std::ceil( crystal_lattice.c() / grid_spacing ) ) );
+        data_.assign( static_cast<size_t>( n_[0] ) * n_[1] * n_[2], 0 );
+    }
+
+    int n( const size_t i ) const { return n_[i]; }
+    size_t size() const { return data_.size(); }
+    size_t index( const int i, const int j, const int k ) const { return ( static_cast<size_t>( k ) * n_[1] + j ) * n_[0] + i; }
+    char value( const size_t i ) const { return data_[i]; }
+    size_t count( const char value ) const { return static_cast<size_t>( std::count( data_.begin(), data_.end(), value ) ); }
+
+    // Sets all grid points inside a sphere to value. The centre is in fractional coordinates and
+    // need not be inside the unit cell, the radius is in Angstrom.
+    // Each row along a is filled as a single interval, found by solving the quadratic equation in u.
+    void rasterise_sphere( const Vector3D & centre, const double radius, const char value )
+    {
+        const double radius2 = radius * radius;
+        const int k_min = static_cast<int>( std::ceil( ( centre.z() - radius * crystal_lattice_.c_star() ) * n_[2] ) );
+        const int k_max = static_cast<int>( std::floor( ( centre.z() + radius * crystal_lattice_.c_star() ) * n_[2] ) );
+        const int j_min = static_cast<int>( std::ceil( ( centre.y() - radius * crystal_lattice_.b_star() ) * n_[1] ) );
+        const int j_max = static_cast<int>( std::floor( ( centre.y() + radius * crystal_lattice_.b_star() ) * n_[1] ) );
+        const double g00 = metric_.value( 0, 0 );
+        for ( int k( k_min ); k <= k_max; ++k )
+        {
+            const double dw = static_cast<double>( k ) / n_[2] - centre.z();
+            for ( int j( j_min ); j <= j_max; ++j )
+            {
+                const double dv = static_cast<double>( j ) / n_[1] - centre.y();
+                const double b = metric_.value( 0, 1 ) * dv + metric_.value( 0, 2 ) * dw;
+                const double c = metric_.value( 1, 1 ) * dv * dv + 2.0 * metric_.value( 1, 2 ) * dv * dw + metric_.value( 2, 2 ) * dw * dw - radius2;
+                const double discriminant = b * b - g00 * c;
+                if ( discriminant < 0.0 )
+                    continue;
+                const double root = std::sqrt( discriminant );
+                const int i_min = static_cast<int>( std::ceil( ( centre.x() + ( -b - root ) / g00 ) * n_[0] ) );
+                const int i_max = static_cast<int>( std::floor( ( centre.x() + ( -b + root ) / g00 ) * n_[0] ) );
+                fill_row( i_min, i_max, modulo( j, n_[1] ), modulo( k, n_[2] ), value );
+            }
+        }
+    }
+
+    // Sets the grid points i_min...i_max (inclusive, may lie outside the unit cell) in row j, k to value.
+    void fill_row( const int i_min, const int i_max, const int j, const int k, const char value )
+    {
+        if ( i_max < i_min )
+            return;
+        char * row = &data_[ index( 0, j, k ) ];
+        if ( i_max - i_min + 1 >= n_[0] )
+        {
+            std::fill( row, row + n_[0], value );
+            return;
+        }
+        const int begin = modulo( i_min, n_[0] );
+        const int end = begin + ( i_max - i_min ) + 1;
+        if ( end <= n_[0] )
+            std::fill( row + begin, row + end, value );
+        else
+        {
+            std::fill( row + begin, row + n_[0], value );
+            std::fill( row, row + end - n_[0], value );
+        }
+    }
+
+    // For the sphere centred on a grid point: for each row dj, dk the inclusive range of di.
+    void sphere_stencil( const double radius, std::vector< int > & stencil ) const
+    {
+        stencil.clear();
+        const double radius2 = radius * radius;
+        const int dk_max = static_cast<int>( std::floor( radius * crystal_lattice_.c_star() * n_[2] ) );
+        const int dj_max = static_cast<int>( std::floor( radius * crystal_lattice_.b_star() * n_[1] ) );
+        const double g00 = metric_.value( 0, 0 );
+        for ( int dk( -dk_max ); dk <= dk_max; ++dk )
+        {
+            const double dw = static_cast<double>( dk ) / n_[2];
+            for ( int dj( -dj_max ); dj <= dj_max; ++dj )
+            {
+                const double dv = static_cast<double>( dj ) / n_[1];
+                const double b = metric_.value( 0, 1 ) * dv + metric_.value( 0, 2 ) * dw;
+                const double c = metric_.value( 1, 1 ) * dv * dv + 2.0 * metric_.value( 1, 2 ) * dv * dw + metric_.value( 2, 2 ) * dw * dw - radius2;
+                const double discriminant = b * b - g00 * c;
+                if ( discriminant < 0.0 )
+                    continue;
+                const double root = std::sqrt( discriminant );
+                const int di_min = static_cast<int>( std::ceil( ( ( -b - root ) / g00 ) * n_[0] ) );
+                const int di_max = static_cast<int>( std::floor( ( ( -b + root ) / g00 ) * n_[0] ) );
+                if ( di_max < di_min )
+                    continue;
+                stencil.push_back( dj );
+                stencil.push_back( dk );
+                stencil.push_back( di_min );
+                stencil.push_back( di_max );
+            }
+        }
+    }
+
+private:
+    CrystalLattice crystal_lattice_;
+    Matrix3D metric_;
+    int n_[3];
+    std::pmr::vector< char > data_;
+};
+
+// Chooses a grid of n[0] x n[1] x n[2] points in fractional coordinates with a spacing of at most grid_spacing
+// that is mapped onto itself by all symmetry operators, so that the grid point ( i, j, k ) is mapped onto
+// ( o0*i + o1*j + o2*k + o9, o3*i + o4*j + o5*k + o10, o6*i + o7*j + o8*k + o11 ) modulo n, with o0...o11 stored per operator in operators.
+// If no such grid can be found, only the identity is returned.
+void symmetry_adapted_grid( const CrystalLattice & crystal_lattice, const SpaceGroup & space_group, const double grid_spacing, int n[3], std::vector< int > & operators )
+{
+    if ( grid_spacing <= 0.0 )
+        throw std::runtime_error( "symmetry_adapted_grid(): grid spacing must be positive." );
+    // All translations in space groups are multiples of 1/12
+    const double lengths[3] = { crystal_lattice.a(), crystal_lattice.b(), crystal_lattice.c() };
+    for ( size_t i( 0 ); i != 3; ++i )
+        n[i] = 12 * std::max( 1, static_cast<int>( std::ceil( lengths[i] / ( 12.0 * grid_spacing ) ) ) );
+    // Operators that mix two axes (e.g. a three-fold axis) require the same number of grid points along both axes
+    for ( size_t iteration( 0 ); iteration != 3; ++iteration )
     {
-        if ( crystal_structure.crystal_lattice().shortest_distance2( crystal_structure.atom( i ).position(), position ) < distances2[i] )
-            return true;
+        for ( size_t s( 0 ); s != space_group.nsymmetry_operators(); ++s )
+        {
+            const Matrix3D rotation = space_group.symmetry_operator( s ).rotation();
+            for ( size_t i( 0 ); i != 3; ++i )
+            {
+                for ( size_t j( 0 ); j != 3; ++j )
+                {
+                    if ( ( i != j ) && ( rotation.value( i, j ) != 0.0 ) )
+                        n[i] = n[j] = std::max( n[i], n[j] );
+                }
+            }
+        }
+    }
+    operators.clear();
+    operators.reserve( 12 * space_group.nsymmetry_operators() );
+    for ( size_t s( 0 ); s != space_group.nsymmetry_operators(); ++s )
+    {
+        const SymmetryOperator & symmetry_operator = space_group.symmetry_operator( s );
+        const Matrix3D rotation = symmetry_operator.rotation();
+        const Vector3D translation = symmetry_operator.translation();
+        double values[12];
+        for ( size_t i( 0 ); i != 3; ++i )
+        {
+            for ( size_t j( 0 ); j != 3; ++j )
+                values[3*i+j] = rotation.value( i, j ) * n[i] / n[j];
+        }
+        values[ 9] = translation.x() * n[0];
+        values[10] = translation.y() * n[1];
+        values[11] = translation.z() * n[2];
+        for ( size_t i( 0 ); i != 12; ++i )
+        {
+            const int value = round_to_int( values[i] );
+            if ( std::abs( values[i] - value ) > 0.000001 )
+            {
+                const int identity[12] = { 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0 };
+                operators.assign( identity, identity + 12 );
+                return;
+            }
+            operators.push_back( value );
+        }
     }
-    return false;
 }
 
-double calculate_volume( const CrystalStructure & crystal_structure, const std::vector< Vector3D > & void_spheres, const double probe_radius )
+const char blocked( 1 );
+const char void_point( 2 );
+
+// The grid points inside the voids are set to void_point, all other grid points are 0.
+PeriodicGrid void_grid( const CrystalStructure & crystal_structure, const double probe_radius, const double grid_spacing, const std::string & caller )
 {
-    std::cout << "Now calculating the volume." << std::endl;
-    if ( void_spheres.empty() )
-        return 0.0;
-    RandomNumberGenerator_double random_number_generator;
-    const size_t nprobes( ( crystal_structure.crystal_lattice().volume() * 1000.0 ) / crystal_structure.space_group().nsymmetry_operators() ); // 1000 sampling points per A^3
-    size_t ninside_voids( 0 );
-    double probe_radius2 = square( probe_radius );
-    for ( size_t ix( 0 ); ix != nprobes; ++ix )
+    if ( ! crystal_structure.space_group_symmetry_has_been_applied() )
+        throw std::runtime_error( caller + ": space-group symmetry has not been applied for input crystal structure." );
+    MACRO_SCOPED_TIMER( "void_grid()" );
+    MACRO_COUNT( "atoms rasterised", crystal_structure.natoms() );
+    // All grid points where the centre of the probe would overlap with an atom
+    PeriodicGrid probe_centres( crystal_structure.crystal_lattice(), grid_spacing );
+    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+        probe_centres.rasterise_sphere( crystal_structure.atom( i ).position(), crystal_structure.atom( i ).element().Van_der_Waals_radius() + probe_radius, blocked );
+    // The voids are the union of all probes that fit. The probe is centred on a grid point, so the sphere
+    // is the same stencil everywhere, and for a run of consecutive probe centres along a the rows of the
+    // stencil merge into a single interval per row.
+    std::vector< int > stencil;
+    probe_centres.sphere_stencil( probe_radius, stencil );
+    PeriodicGrid voids( crystal_structure.crystal_lattice(), grid_spacing );
+    const int na = probe_centres.n( 0 );
+    for ( int k( 0 ); k != probe_centres.n( 2 ); ++k )
     {
-        Vector3D random_vector( random_number_generator.next_number(), random_number_generator.next_number(), random_number_generator.next_number() );
-        random_vector = crystal_structure.crystal_lattice().fractional_to_orthogonal( random_vector );
-        for ( size_t i( 0 ); i != void_spheres.size(); ++i )
+        for ( int j( 0 ); j != probe_centres.n( 1 ); ++j )
         {
-            Vector3D difference_vector = random_vector - void_spheres[i];
-            if ( difference_vector.norm2() < probe_radius2 )
+            int i( 0 );
+            while ( i != na )
             {
-                ++ninside_voids;
-                break;
+                if ( probe_centres.value( probe_centres.index( i, j, k ) ) == blocked )
+                {
+                    ++i;
+                    continue;
+                }
+                const int run_begin( i );
+                while ( ( i != na ) && ( probe_centres.value( probe_centres.index( i, j, k ) ) != blocked ) )
+                    ++i;
+                const int run_end( i - 1 );
+                for ( size_t s( 0 ); s != stencil.size(); s += 4 )
+                {
+                    voids.fill_row( run_begin + stencil[s+2], run_end + stencil[s+3], modulo( j + stencil[s], probe_centres.n( 1 ) ), modulo( k + stencil[s+1], probe_centres.n( 2 ) ), void_point );
+                }
             }
         }
     }
-    return ( static_cast<double>( ninside_voids ) / static_cast<double>( nprobes ) ) * crystal_structure.crystal_lattice().volume();
+    return voids;
+}
+
+// Adds the integer lattice translation t to basis if it is linearly independent of the translations already in basis.
+void add_if_independent( const int t[3], std::vector< int > & basis )
+{
+    if ( ( t[0] == 0 ) && ( t[1] == 0 ) && ( t[2] == 0 ) )
+        return;
+    const size_t nbasis = basis.size() / 3;
+    if ( nbasis == 3 )
+        return;
+    if ( nbasis == 1 )
+    {
+        const int * b = &basis[0];
+        if ( ( b[1] * t[2] - b[2] * t[1] == 0 ) && ( b[2] * t[0] - b[0] * t[2] == 0 ) && ( b[0] * t[1] - b[1] * t[0] == 0 ) )
+            return;
+    }
+    else if ( nbasis == 2 )
+    {
+        const int * b0 = &basis[0];
+        const int * b1 = &basis[3];
+        const int determinant = t[0] * ( b0[1] * b1[2] - b0[2] * b1[1] ) +
+                                t[1] * ( b0[2] * b1[0] - b0[0] * b1[2] ) +
+                                t[2] * ( b0[0] * b1[1] - b0[1] * b1[0] );
+        if ( determinant == 0 )
+            return;
+    }
+    const int divisor = std::abs( greatest_common_divisor( greatest_common_divisor( t[0], t[1] ), t[2] ) );
+    for ( size_t i( 0 ); i != 3; ++i )
+        basis.push_back( t[i] / divisor );
+}
+
+// Tests if a position lies inside the Van der Waals sphere of any of the atoms, using a cell list.
+class AtomOverlapTester
+{
+public:
+
+    explicit AtomOverlapTester( const CrystalStructure & crystal_structure ):
+        crystal_lattice_(crystal_structure.crystal_lattice()),
+        positions_(atom_positions( crystal_structure )),
+        distances2_(Van_der_Waals_radii2( crystal_structure )),
+        cell_list_(crystal_lattice_, positions_, std::sqrt( *std::max_element( distances2_.begin(), distances2_.end() ) ))
+    {
+    }
+
+    // Position in fractional coordinates. candidates is workspace, so that it need not be reallocated for every call.
+    bool intersects_atoms( const Vector3D & position, std::vector< size_t > & candidates ) const
+    {
+        cell_list_.candidates( position, candidates );
+        for ( size_t i( 0 ); i != candidates.size(); ++i )
+        {
+            if ( crystal_lattice_.shortest_distance2( positions_[ candidates[i] ], position ) < distances2_[ candidates[i] ] )
+                return true;
+        }
+        return false;
+    }
+
+private:
+    CrystalLattice crystal_lattice_;
+    std::vector< Vector3D > positions_;
+    std::vector< double > distances2_;
+    CellList cell_list_;
+
+    static std::vector< Vector3D > atom_positions( const CrystalStructure & crystal_structure )
+    {
+        std::vector< Vector3D > result;
+        result.reserve( crystal_structure.natoms() );
+        for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+            result.push_back( crystal_structure.atom( i ).position() );
+        return result;
+    }
+
+    static std::vector< double > Van_der_Waals_radii2( const CrystalStructure & crystal_structure )
+    {
+        std::vector< double > result;
+        result.reserve( crystal_structure.natoms() );
+        for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+            result.push_back( square( crystal_structure.atom( i ).element().Van_der_Waals_radius() ) );
+        return result;
+    }
+};
+
+// The radical inverse of index in the given base, i.e. the index-th element of the van der Corput sequence.
+double radical_inverse( size_t index, const size_t base )
+{
+    const double inverse_base = 1.0 / base;
+    double factor = inverse_base;
+    double result( 0.0 );
+    while ( index != 0 )
+    {
+        result += ( index % base ) * factor;
+        index /= base;
+        factor *= inverse_base;
+    }
+    return result;
 }
 
 } // namespace
 
 // ********************************************************************************
 
-// @@ Must use symmetry and we must somehow order the spheres to speed things up.
-
-double find_voids( const CrystalStructure & crystal_structure, const double probe_radius )
+double find_voids( const CrystalStructure & crystal_structure, const double probe_radius, const double grid_spacing )
 {
+    MACRO_SCOPED_TIMER( "find_voids()" );
     if ( crystal_structure.natoms() == 0 )
         return crystal_structure.crystal_lattice().volume();
-    if ( ! crystal_structure.space_group_symmetry_has_been_applied() )
-        throw std::runtime_error( "find_voids(): space-group symmetry has not been applied for input crystal structure." );
-    double grid_spacing( 0.15 );
-    double probe_reduction = probe_radius * 0.05;
-    double probe_radius_intermediate = probe_radius - probe_reduction;
-    std::vector< Vector3D > void_spheres_intermediate;
-    std::vector< double > distances2;
-    // For each atom, precalculate square( VdW radius + probe_radius )
-    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
-        distances2.push_back( square( crystal_structure.atom( i ).element().Van_der_Waals_radius() + probe_radius_intermediate ) );
-    // Our CrystalLattice class uses the a-along-x convention
+    PeriodicGrid voids = void_grid( crystal_structure, probe_radius, grid_spacing, "find_voids()" );
+    MACRO_COUNT( "void grid points", voids.size() );
+    return ( static_cast<double>( voids.count( void_point ) ) / static_cast<double>( voids.size() ) ) * crystal_structure.crystal_lattice().volume();
+}
 
-    // We need the enclosing box / bounding box
-    Vector3D min_min_min;
-    Vector3D max_max_max;
-    crystal_structure.crystal_lattice().enclosing_box( min_min_min, max_max_max );
+// ********************************************************************************
 
-    for ( int ix = round_to_int( min_min_min.x() / grid_spacing ) - 1; ix != round_to_int( max_max_max.x() / grid_spacing ) + 1; ++ix )
+std::vector< VoidDescription > analyse_voids( const CrystalStructure & crystal_structure, const double probe_radius, const double grid_spacing )
+{
+    PeriodicGrid voids = void_grid( crystal_structure, probe_radius, grid_spacing, "analyse_voids()" );
+    const int n[3] = { voids.n( 0 ), voids.n( 1 ), voids.n( 2 ) };
+    const double volume_per_point = crystal_structure.crystal_lattice().volume() / voids.size();
+    // For every void grid point that has been reached: the lattice translation of the image that was reached
+    std::pmr::vector< int > offsets( 3 * voids.size(), 0, scratch_resource() );
+    std::pmr::vector< char > visited( voids.size(), 0, scratch_resource() );
+    std::pmr::vector< size_t > queue( scratch_resource() );
+    std::vector< VoidDescription > result;
+    for ( size_t seed( 0 ); seed != voids.size(); ++seed )
     {
-        for ( int iy = round_to_int( min_min_min.y() / grid_spacing ) - 1; iy != round_to_int( max_max_max.y() / grid_spacing ) + 1; ++iy )
+        if ( ( voids.value( seed ) != void_point ) || visited[seed] )
+            continue;
+        visited[seed] = 1;
+        queue.clear();
+        queue.push_back( seed );
+        std::vector< int > basis;
+        double sum[3] = { 0.0, 0.0, 0.0 };
+        // The queue is not shrunk, so that it also serves as the list of all grid points in this void
+        for ( size_t q( 0 ); q != queue.size(); ++q )
         {
-            for ( int iz = round_to_int( min_min_min.z() / grid_spacing ) - 1; iz != round_to_int( max_max_max.z() / grid_spacing ) + 1; ++iz )
+            const size_t current = queue[q];
+            const int index[3] = { static_cast<int>( current % n[0] ), static_cast<int>( ( current / n[0] ) % n[1] ), static_cast<int>( current / ( static_cast<size_t>( n[0] ) * n[1] ) ) };
+            const int * offset = &offsets[ 3 * current ];
+            for ( size_t d( 0 ); d != 3; ++d )
+                sum[d] += static_cast<double>( index[d] ) / n[d] + offset[d];
+            for ( size_t d( 0 ); d != 3; ++d )
             {
-                Vector3D position( ix * grid_spacing, iy * grid_spacing, iz * grid_spacing ); // Cartesian coordinates
-                // Check that the probe point lies within the unit cell
-                Vector3D fractional_position = crystal_structure.crystal_lattice().orthogonal_to_fractional( position );
-                if ( ( fractional_position.x() < 0.0 ) || ( fractional_position.x() > 1.0 ) ||
-                     ( fractional_position.y() < 0.0 ) || ( fractional_position.y() > 1.0 ) ||
-                     ( fractional_position.z() < 0.0 ) || ( fractional_position.z() > 1.0 ) )
-                    continue;
-                if ( ! intersects_atoms( crystal_structure, fractional_position, distances2 ) )
-                    void_spheres_intermediate.push_back( position ); // Cartesian coordinates
+                for ( int step( -1 ); step <= 1; step += 2 )
+                {
+                    int neighbour[3] = { index[0], index[1], index[2] };
+                    int neighbour_offset[3] = { offset[0], offset[1], offset[2] };
+                    neighbour[d] += step;
+                    if ( neighbour[d] == -1 )
+                    {
+                        neighbour[d] = n[d] - 1;
+                        --neighbour_offset[d];
+                    }
+                    else if ( neighbour[d] == n[d] )
+                    {
+                        neighbour[d] = 0;
+                        ++neighbour_offset[d];
+                    }
+                    const size_t neighbour_index = voids.index( neighbour[0], neighbour[1], neighbour[2] );
+                    if ( voids.value( neighbour_index ) != void_point )
+                        continue;
+                    int * stored_offset = &offsets[ 3 * neighbour_index ];
+                    if ( visited[neighbour_index] )
+                    {
+                        // Reached again, but possibly as a different periodic image
+                        const int translation[3] = { neighbour_offset[0] - stored_offset[0], neighbour_offset[1] - stored_offset[1], neighbour_offset[2] - stored_offset[2] };
+                        add_if_independent( translation, basis );
+                        continue;
+                    }
+                    visited[neighbour_index] = 1;
+                    for ( size_t i( 0 ); i != 3; ++i )
+                        stored_offset[i] = neighbour_offset[i];
+                    queue.push_back( neighbour_index );
+                }
             }
         }
+        Vector3D centroid( sum[0] / queue.size(), sum[1] / queue.size(), sum[2] / queue.size() );
+        centroid = Vector3D( centroid.x() - std::floor( centroid.x() ), centroid.y() - std::floor( centroid.y() ), centroid.z() - std::floor( centroid.z() ) );
+        std::vector< Vector3D > percolation_directions;
+        for ( size_t i( 0 ); i != basis.size(); i += 3 )
+            percolation_directions.push_back( Vector3D( basis[i], basis[i+1], basis[i+2] ) );
+        result.push_back( VoidDescription( queue.size() * volume_per_point, centroid, percolation_directions ) );
     }
-    std::cout << "Number of intermediate spheres = " << void_spheres_intermediate.size() << std::endl;
-    // Above was with smaller radius (-0.05). Now for every point try again, this time with the real radius, but on nine different points (vertices + centre of a cube).
-    std::vector< Vector3D > void_spheres_final;
-    // For each atom, precalculate square( VdW radius + probe_radius )
-    distances2.clear();
-    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
-        distances2.push_back( square( crystal_structure.atom( i ).element().Van_der_Waals_radius() + probe_radius ) );
-    double delta = probe_reduction / sqrt(3.0); // 0.028868 Cartesian coordinates
-    for ( size_t i( 0 ); i != void_spheres_intermediate.size(); ++i )
-    {
-        Vector3D position( void_spheres_intermediate[i] ); // Cartesian coordinates
-        if ( ! intersects_atoms( crystal_structure, crystal_structure.crystal_lattice().orthogonal_to_fractional( position ), distances2 ) )
-            void_spheres_final.push_back( position ); // Cartesian coordinates
-        position = Vector3D( void_spheres_intermediate[i] + Vector3D( -delta, -delta, -delta ) ); // Cartesian coordinates
-        if ( ! intersects_atoms( crystal_structure, crystal_structure.crystal_lattice().orthogonal_to_fractional( position ), distances2 ) )
-            void_spheres_final.push_back( position ); // Cartesian coordinates
-        position = Vector3D( void_spheres_intermediate[i] + Vector3D( -delta, -delta, +delta ) ); // Cartesian coordinates
-        if ( ! intersects_atoms( crystal_structure, crystal_structure.crystal_lattice().orthogonal_to_fractional( position ), distances2 ) )
-            void_spheres_final.push_back( position ); // Cartesian coordinates
-        position = Vector3D( void_spheres_intermediate[i] + Vector3D( -delta, +delta, -delta ) ); // Cartesian coordinates
-        if ( ! intersects_atoms( crystal_structure, crystal_structure.crystal_lattice().orthogonal_to_fractional( position ), distances2 ) )
-            void_spheres_final.push_back( position ); // Cartesian coordinates
-        position = Vector3D( void_spheres_intermediate[i] + Vector3D( -delta, +delta, +delta ) ); // Cartesian coordinates
-        if ( ! intersects_atoms( crystal_structure, crystal_structure.crystal_lattice().orthogonal_to_fractional( position ), distances2 ) )
-            void_spheres_final.push_back( position ); // Cartesian coordinates
-        position = Vector3D( void_spheres_intermediate[i] + Vector3D( +delta, -delta, -delta ) ); // Cartesian coordinates
-        if ( ! intersects_atoms( crystal_structure, crystal_structure.crystal_lattice().orthogonal_to_fractional( position ), distances2 ) )
-            void_spheres_final.push_back( position ); // Cartesian coordinates
-        position = Vector3D( void_spheres_intermediate[i] + Vector3D( +delta, -delta, +delta ) ); // Cartesian coordinates
-        if ( ! intersects_atoms( crystal_structure, crystal_structure.crystal_lattice().orthogonal_to_fractional( position ), distances2 ) )
-            void_spheres_final.push_back( position ); // Cartesian coordinates
-        position = Vector3D( void_spheres_intermediate[i] + Vector3D( +delta, +delta, -delta ) ); // Cartesian coordinates
-        if ( ! intersects_atoms( crystal_structure, crystal_structure.crystal_lattice().orthogonal_to_fractional( position ), distances2 ) )
-            void_spheres_final.push_back( position ); // Cartesian coordinates
-        position = Vector3D( void_spheres_intermediate[i] + Vector3D( +delta, +delta, +delta ) ); // Cartesian coordinates
-        if ( ! intersects_atoms( crystal_structure, crystal_structure.crystal_lattice().orthogonal_to_fractional( position ), distances2 ) )
-            void_spheres_final.push_back( position ); // Cartesian coordinates
-    }
-    std::cout << "Number of final spheres = " << void_spheres_final.size() << std::endl;
-
-    // Calculate the volume of the void
-    double volume = calculate_volume( crystal_structure, void_spheres_final, probe_radius );
-
-//    for ( size_t i( 0 ); i != void_spheres_final.size(); ++i )
-//        void_spheres_final[i].show();
-
-    return volume;
+    return result;
+}
+
+// ********************************************************************************
+
+void save_void_grid( const CrystalStructure & crystal_structure, const FileName & file_name, const double probe_radius, const double grid_spacing )
+{
+    PeriodicGrid voids = void_grid( crystal_structure, probe_radius, grid_spacing, "save_void_grid()" );
+    std::ofstream output_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! output_file )
+        throw std::runtime_error( "save_void_grid(): Could not open file " + file_name.full_name() );
+    output_file.write( "VOIDGRID", 8 );
+    for ( size_t i( 0 ); i != 3; ++i )
+    {
+        const unsigned long long value = voids.n( i );
+        output_file.write( reinterpret_cast< const char * >( &value ), sizeof( value ) );
+    }
+    std::vector< char > data( voids.size() );
+    for ( size_t i( 0 ); i != voids.size(); ++i )
+        data[i] = ( voids.value( i ) == void_point ) ? 1 : 0;
+    output_file.write( &data[0], data.size() );
 }
 
 // ********************************************************************************
@@ -173,58 +480,91 @@ double find_voids( const CrystalStructure & crystal_structure, const double prob
 // This gives the wrong answer
 double find_voids_2( const CrystalStructure & crystal_structure )
 {
- //   double probe_radius( 1.2 );
-    // For each atom, precalculate square( VdW radius + probe_radius )
-    std::vector< double > distances2;
-//    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
-//        distances2.push_back( square( crystal_structure.atom( i ).element().Van_der_Waals_radius() + probe_radius ) );
-    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
-        distances2.push_back( square( crystal_structure.atom( i ).element().Van_der_Waals_radius() ) );
-    RandomNumberGenerator_double random_number_generator;
-    const size_t nprobes( crystal_structure.crystal_lattice().volume() * 100 ); // 5000 sampling points per A^3
+    return void_volume_quasi_Monte_Carlo( crystal_structure ).value();
+}
+
+// ********************************************************************************
+
+double void_volume( const CrystalStructure & crystal_structure, const double grid_spacing )
+{
+    if ( crystal_structure.natoms() == 0 )
+        return crystal_structure.crystal_lattice().volume();
+    if ( ! crystal_structure.space_group_symmetry_has_been_applied() )
+        throw std::runtime_error( "void_volume(): space-group symmetry has not been applied for input crystal structure." );
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
+    int n[3];
+    std::vector< int > operators;
+    symmetry_adapted_grid( crystal_lattice, crystal_structure.space_group(), grid_spacing, n, operators );
+    AtomOverlapTester atom_overlap_tester( crystal_structure );
+    // Only one grid point of each orbit under the space group is tested, it is counted once for each member of its orbit.
+    std::pmr::vector< char > visited( static_cast<size_t>( n[0] ) * n[1] * n[2], 0, scratch_resource() );
+    std::vector< size_t > candidates;
     size_t ninside_voids( 0 );
-    for ( size_t ix( 0 ); ix != nprobes; ++ix )
+    for ( int k( 0 ); k != n[2]; ++k )
     {
-        Vector3D random_vector( random_number_generator.next_number(), random_number_generator.next_number(), random_number_generator.next_number() );
-        bool intersection_found( false );
-        for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
+        for ( int j( 0 ); j != n[1]; ++j )
         {
-            // Both arguments to CrystalLattice::shortest_distance2() must be in fractional coordinates
-            if ( crystal_structure.crystal_lattice().shortest_distance2( crystal_structure.atom( i ).position(), random_vector ) < distances2[i] )
+            for ( int i( 0 ); i != n[0]; ++i )
             {
-                intersection_found = true;
-                break;
+                if ( visited[ ( static_cast<size_t>( k ) * n[1] + j ) * n[0] + i ] )
+                    continue;
+                size_t norbit( 0 );
+                for ( size_t s( 0 ); s != operators.size(); s += 12 )
+                {
+                    const int * o = &operators[s];
+                    const int ii = modulo( o[0] * i + o[1] * j + o[ 2] * k + o[ 9], n[0] );
+                    const int jj = modulo( o[3] * i + o[4] * j + o[ 5] * k + o[10], n[1] );
+                    const int kk = modulo( o[6] * i + o[7] * j + o[ 8] * k + o[11], n[2] );
+                    char & image = visited[ ( static_cast<size_t>( kk ) * n[1] + jj ) * n[0] + ii ];
+                    if ( ! image )
+                    {
+                        image = 1;
+                        ++norbit;
+                    }
+                }
+                const Vector3D probe( static_cast<double>( i ) / n[0], static_cast<double>( j ) / n[1], static_cast<double>( k ) / n[2] );
+                if ( ! atom_overlap_tester.intersects_atoms( probe, candidates ) )
+                    ninside_voids += norbit;
             }
         }
-        if ( ! intersection_found )
-            ++ninside_voids;
     }
-    return ( static_cast<double>( ninside_voids ) / static_cast<double>( nprobes ) ) * crystal_structure.crystal_lattice().volume();
+    return ( static_cast<double>( ninside_voids ) / static_cast<double>( visited.size() ) ) * crystal_lattice.volume();
 }
 
 // ********************************************************************************
 
-double void_volume( const CrystalStructure & crystal_structure )
+DoubleWithESD void_volume_quasi_Monte_Carlo( const CrystalStructure & crystal_structure, const double nprobes_per_A3, const size_t nthreads )
 {
+    const CrystalLattice & crystal_lattice = crystal_structure.crystal_lattice();
     if ( crystal_structure.natoms() == 0 )
-        return crystal_structure.crystal_lattice().volume();
+        return DoubleWithESD( crystal_lattice.volume(), 0.0 );
     if ( ! crystal_structure.space_group_symmetry_has_been_applied() )
-        throw std::runtime_error( "molecular_volume(): space-group symmetry has not been applied for input crystal structure." );
-    RandomNumberGenerator_double random_number_generator;
-    const size_t nprobes( ( crystal_structure.crystal_lattice().volume() * 1000.0 ) / crystal_structure.space_group().nsymmetry_operators() ); // 1000 sampling points per A^3
-    // For each atom, precalculate square( VdW radius )
-    std::vector< double > distances2;
-    for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
-        distances2.push_back( square( crystal_structure.atom( i ).element().Van_der_Waals_radius() ) );
-    size_t ninside_voids( 0 );
-    for ( size_t ix( 0 ); ix != nprobes; ++ix )
+        throw std::runtime_error( "void_volume_quasi_Monte_Carlo(): space-group symmetry has not been applied for input crystal structure." );
+    // The number of chunks is fixed, not the number of threads, so that the result does not depend on the number of threads.
+    const size_t nchunks( 32 );
+    const size_t nprobes_per_chunk = std::max( static_cast<size_t>( 1 ), static_cast<size_t>( std::ceil( ( crystal_lattice.volume() * nprobes_per_A3 ) / nchunks ) ) );
+    AtomOverlapTester atom_overlap_tester( crystal_structure );
+    std::vector< size_t > ninside_voids( nchunks, 0 );
+    parallel_for( nchunks, nthreads, [&]( const size_t chunk )
     {
-        Vector3D random_vector( random_number_generator.next_number(), random_number_generator.next_number(), random_number_generator.next_number() );
-        random_vector = crystal_structure.crystal_lattice().fractional_to_orthogonal( random_vector );
-        if ( ! intersects_atoms( crystal_structure, random_vector, distances2 ) )
-                ++ninside_voids;
-    }
-    return ( static_cast<double>( ninside_voids ) / static_cast<double>( nprobes ) ) * crystal_structure.crystal_lattice().volume();
+        std::vector< size_t > candidates;
+        size_t result( 0 );
+        // Index 0 of the Halton sequence is the origin, so start at 1
+        const size_t first = chunk * nprobes_per_chunk + 1;
+        for ( size_t i( first ); i != first + nprobes_per_chunk; ++i )
+        {
+            if ( ! atom_overlap_tester.intersects_atoms( Vector3D( radical_inverse( i, 2 ), radical_inverse( i, 3 ), radical_inverse( i, 5 ) ), candidates ) )
+                ++result;
+        }
+        ninside_voids[chunk] = result;
+    } );
+    std::vector< double > void_fractions( nchunks );
+    for ( size_t i( 0 ); i != nchunks; ++i )
+        void_fractions[i] = static_cast<double>( ninside_voids[i] ) / static_cast<double>( nprobes_per_chunk );
+    RunningAverageAndESD< double > void_fraction;
+    void_fraction.add_values( &void_fractions[0], nchunks );
+    return DoubleWithESD( void_fraction.average() * crystal_lattice.volume(),
+                          ( void_fraction.estimated_standard_deviation() / std::sqrt( static_cast<double>( nchunks ) ) ) * crystal_lattice.volume() );
 }
 
 // ********************************************************************************
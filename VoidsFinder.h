@@ -28,15 +28,55 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
+#include "DoubleWithESD.h"
+#include "Vector3D.h"
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
 class CrystalStructure;
-/*
+class FileName;
 
+/*
+  A single connected void, as found by analyse_voids().
 */
+class VoidDescription
+{
+public:
 
-// Currently only returns the percentage voids
-// Uses the old algorithm, based on first finding the set of spheres that determine the voids followed by
-// determining the volume of the set of spheres.
-double find_voids( const CrystalStructure & crystal_structure, const double probe_radius = 1.2 );
+    VoidDescription( const double volume, const Vector3D & centroid, const std::vector< Vector3D > & percolation_directions ):
+        volume_(volume), centroid_(centroid), percolation_directions_(percolation_directions) {}
+
+    // In A^3
+    double volume() const { return volume_; }
+
+    // In fractional coordinates, in [0,1>. Not meaningful if the void percolates.
+    Vector3D centroid() const { return centroid_; }
+
+    // 0 for an isolated pocket, 1 for a channel, 2 for a layer, 3 for a three-dimensional network.
+    size_t dimensionality() const { return percolation_directions_.size(); }
+
+    // Linearly independent lattice translations that connect the void to its own periodic images.
+    const std::vector< Vector3D > & percolation_directions() const { return percolation_directions_; }
+
+private:
+    double volume_;
+    Vector3D centroid_;
+    std::vector< Vector3D > percolation_directions_;
+};
+
+// Returns the total volume, in A^3, of all voids in the unit cell that are accessible to a spherical probe of radius probe_radius.
+// The void is the union of all probe spheres that do not overlap with any atom.
+// Atom spheres and probe spheres are rasterised on a periodic grid in fractional coordinates with the given spacing (in Angstrom).
+double find_voids( const CrystalStructure & crystal_structure, const double probe_radius = 1.2, const double grid_spacing = 0.15 );
+
+// Splits the voids as calculated by find_voids() into connected components (grid points sharing a face are connected,
+// with periodic boundary conditions). Voids are ordered by their first grid point.
+std::vector< VoidDescription > analyse_voids( const CrystalStructure & crystal_structure, const double probe_radius = 1.2, const double grid_spacing = 0.15 );
+
+// Writes the void grid of find_voids() as a binary file: the eight characters "VOIDGRID", the number of grid points
+// along a, b and c as three 64-bit unsigned integers, then one byte per grid point (1 for void, 0 otherwise), with the index along a running fastest.
+void save_void_grid( const CrystalStructure & crystal_structure, const FileName & file_name, const double probe_radius = 1.2, const double grid_spacing = 0.15 );
 
 // Currently only returns the percentage voids
 // Uses the new algorithm that samples the unit cell and for each sample point determines if it is
@@ -46,7 +86,14 @@ double find_voids( const CrystalStructure & crystal_structure, const double prob
 double find_voids_2( const CrystalStructure & crystal_structure );
 
 // Probe size is 0.0, this is useful for calculating e.g. the packing coefficient.
-double void_volume( const CrystalStructure & crystal_structure );
+// Returns the volume, in A^3, of all grid points outside the Van der Waals spheres of all atoms.
+// The grid is chosen such that it is invariant under the space group, so only one point per orbit has to be tested.
+double void_volume( const CrystalStructure & crystal_structure, const double grid_spacing = 0.1 );
+
+// Same as void_volume(), but samples the unit cell with the Halton sequence in bases 2, 3 and 5.
+// The sequence is split into a fixed number of consecutive chunks that are distributed over nthreads threads (0 means one per core),
+// so the result is the same for any number of threads. The ESD is calculated from the spread of the chunk averages.
+DoubleWithESD void_volume_quasi_Monte_Carlo( const CrystalStructure & crystal_structure, const double nprobes_per_A3 = 100.0, const size_t nthreads = 0 );
 
 #endif // VOIDSFINDER_H
 
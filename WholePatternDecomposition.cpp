@@ -0,0 +1,439 @@
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "WholePatternDecomposition.h"
+#include "ChebyshevBackground.h"
+#include "MathFunctions.h"
+#include "ParallelFor.h"
+#include "PeakShapeFunction.h"
+#include "Sort.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+
+// ********************************************************************************
+
+// Solves matrix * x = rhs for a dense symmetric positive-definite matrix of size n * n by Cholesky decomposition.
+// Both matrix and rhs are overwritten, rhs on output contains x.
+void solve_positive_definite( std::vector< double > & matrix, std::vector< double > & rhs )
+{
+    const size_t n = rhs.size();
+    for ( size_t k( 0 ); k != n; ++k )
+    {
+        double pivot = matrix[k*n+k];
+        for ( size_t j( 0 ); j != k; ++j )
+            pivot -= square( matrix[k*n+j] );
+        if ( pivot <= 0.0 )
+            throw std::runtime_error( "solve_positive_definite(): matrix is not positive definite." );
+        matrix[k*n+k] = sqrt( pivot );
+        for ( size_t i( k+1 ); i != n; ++i )
+        {
+            double value = matrix[i*n+k];
+            for ( size_t j( 0 ); j != k; ++j )
+                value -= matrix[i*n+j] * matrix[k*n+j];
+            matrix[i*n+k] = value / matrix[k*n+k];
+        }
+    }
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        for ( size_t j( 0 ); j != i; ++j )
+            rhs[i] -= matrix[i*n+j] * rhs[j];
+        rhs[i] /= matrix[i*n+i];
+    }
+    for ( size_t i( n ); i-- != 0; )
+    {
+        for ( size_t j( i+1 ); j != n; ++j )
+            rhs[i] -= matrix[j*n+i] * rhs[j];
+        rhs[i] /= matrix[i*n+i];
+    }
+}
+
+// ********************************************************************************
+
+// A symmetric banded matrix stored as its upper band: element ( k, l ) with k <= l <= k + bandwidth is at k * ( bandwidth + 1 ) + l - k.
+// decompose() overwrites it with the upper-triangular U of the Cholesky decomposition U^T U.
+class BandedMatrix
+{
+public:
+
+    BandedMatrix( const size_t n, const size_t bandwidth ) : n_(n), bandwidth_(bandwidth), values_( n * ( bandwidth + 1 ), 0.0 ) {}
+
+    double & operator()( const size_t k, const size_t l ) { return values_[ k * ( bandwidth_ + 1 ) + l - k ]; }
+
+    void decompose()
+    {
+        for ( size_t k( 0 ); k != n_; ++k )
+        {
+            const size_t j_start = ( k > bandwidth_ ) ? k - bandwidth_ : 0;
+            double pivot = (*this)( k, k );
+            for ( size_t j( j_start ); j != k; ++j )
+                pivot -= square( (*this)( j, k ) );
+            if ( pivot <= 0.0 )
+                throw std::runtime_error( "BandedMatrix::decompose(): matrix is not positive definite." );
+            const double diagonal = sqrt( pivot );
+            (*this)( k, k ) = diagonal;
+            const size_t l_end = std::min( n_, k + bandwidth_ + 1 );
+            for ( size_t l( k+1 ); l != l_end; ++l )
+            {
+                double value = (*this)( k, l );
+                // U( j, l ) is only in the band for j >= l - bandwidth
+                for ( size_t j( std::max( j_start, ( l > bandwidth_ ) ? l - bandwidth_ : 0 ) ); j != k; ++j )
+                    value -= (*this)( j, k ) * (*this)( j, l );
+                (*this)( k, l ) = value / diagonal;
+            }
+        }
+    }
+
+    // Solves U^T U x = rhs after decompose(), rhs on output contains x.
+    void solve( std::vector< double > & rhs )
+    {
+        for ( size_t k( 0 ); k != n_; ++k )
+        {
+            const size_t j_start = ( k > bandwidth_ ) ? k - bandwidth_ : 0;
+            for ( size_t j( j_start ); j != k; ++j )
+                rhs[k] -= (*this)( j, k ) * rhs[j];
+            rhs[k] /= (*this)( k, k );
+        }
+        for ( size_t k( n_ ); k-- != 0; )
+        {
+            const size_t l_end = std::min( n_, k + bandwidth_ + 1 );
+            for ( size_t l( k+1 ); l != l_end; ++l )
+                rhs[k] -= (*this)( k, l ) * rhs[l];
+            rhs[k] /= (*this)( k, k );
+        }
+    }
+
+private:
+    size_t n_;
+    size_t bandwidth_;
+    std::vector< double > values_;
+};
+
+} // namespace
+
+// ********************************************************************************
+
+WholePatternDecomposition::WholePatternDecomposition( const PowderPattern & experimental_pattern, const ReflectionList & reflection_list, const PeakShapeFunction & peak_shape_function ):
+experimental_pattern_(experimental_pattern),
+reflection_list_(reflection_list),
+nthreads_(0)
+{
+    if ( experimental_pattern_.size() < 2 )
+        throw std::runtime_error( "WholePatternDecomposition::WholePatternDecomposition(): experimental pattern has too few points." );
+    const double wavelength = experimental_pattern_.wavelength();
+    std::vector< double > point_two_thetas( experimental_pattern_.size() );
+    for ( size_t i( 0 ); i != experimental_pattern_.size(); ++i )
+        point_two_thetas[i] = experimental_pattern_.two_theta( i ).value_in_degrees();
+    // Only the reflections that have part of their profile inside the pattern are kept
+    std::vector< double > two_thetas;
+    std::vector< size_t > reflection_indices;
+    for ( size_t i( 0 ); i != reflection_list_.size(); ++i )
+    {
+        const double d = reflection_list_.d_spacing( i );
+        if ( wavelength > 2.0 * d )
+            continue;
+        const Angle two_theta = 2.0 * arcsine( wavelength / ( 2.0 * d ) );
+        const double range = peak_shape_function.range( peak_shape_function.FWHM( two_theta ), peak_shape_function.eta( two_theta ) );
+        if ( ( two_theta.value_in_degrees() + range < point_two_thetas.front() ) || ( two_theta.value_in_degrees() - range > point_two_thetas.back() ) )
+            continue;
+        two_thetas.push_back( two_theta.value_in_degrees() );
+        reflection_indices.push_back( i );
+    }
+    const std::vector< size_t > sorted_map = sort( two_thetas );
+    profile_offsets_.push_back( 0 );
+    for ( size_t i( 0 ); i != sorted_map.size(); ++i )
+    {
+        const Angle two_theta = Angle::from_degrees( two_thetas[ sorted_map[i] ] );
+        reflection_indices_.push_back( reflection_indices[ sorted_map[i] ] );
+        two_thetas_.push_back( two_theta );
+        const Angle theta = two_theta / 2.0;
+        LP_factors_.push_back( ( 1.0 + square( two_theta.cosine() ) ) / ( 2.0 * two_theta.sine() * theta.sine() ) );
+        // The FWHM and eta are evaluated once, at the peak position
+        const double FWHM = peak_shape_function.FWHM( two_theta );
+        const double eta = peak_shape_function.eta( two_theta );
+        const double range = peak_shape_function.range( FWHM, eta );
+        const size_t first = std::lower_bound( point_two_thetas.begin(), point_two_thetas.end(), two_theta.value_in_degrees() - range ) - point_two_thetas.begin();
+        const size_t end = std::upper_bound( point_two_thetas.begin(), point_two_thetas.end(), two_theta.value_in_degrees() + range ) - point_two_thetas.begin();
+        profile_first_.push_back( first );
+        for ( size_t j( first ); j != end; ++j )
+            profile_values_.push_back( peak_shape_function.value( point_two_thetas[j] - two_theta.value_in_degrees(), FWHM, eta ) );
+        profile_offsets_.push_back( profile_values_.size() );
+    }
+    intensities_.assign( nreflections(), 0.0 );
+}
+
+// ********************************************************************************
+
+void WholePatternDecomposition::set_nbackground_terms( const size_t nbackground_terms )
+{
+    background_coefficients_.assign( nbackground_terms, 0.0 );
+    calculate_background_values();
+}
+
+// ********************************************************************************
+
+void WholePatternDecomposition::calculate_background_values()
+{
+    background_values_ = Chebyshev_basis( background_coefficients_.size(), experimental_pattern_ );
+}
+
+// ********************************************************************************
+
+std::vector< double > WholePatternDecomposition::calculate_pattern() const
+{
+    const size_t nterms = background_coefficients_.size();
+    std::vector< double > result( experimental_pattern_.size(), 0.0 );
+    for ( size_t i( 0 ); i != result.size(); ++i )
+    {
+        for ( size_t j( 0 ); j != nterms; ++j )
+            result[i] += background_coefficients_[j] * background_values_[i*nterms+j];
+    }
+    for ( size_t k( 0 ); k != nreflections(); ++k )
+    {
+        const double * profile = &profile_values_[ profile_offsets_[k] ];
+        double * pattern = &result[ profile_first_[k] ];
+        for ( size_t j( 0 ); j != profile_size( k ); ++j )
+            pattern[j] += intensities_[k] * profile[j];
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+void WholePatternDecomposition::refine_background()
+{
+    const size_t nterms = background_coefficients_.size();
+    if ( nterms == 0 )
+        return;
+    std::fill( background_coefficients_.begin(), background_coefficients_.end(), 0.0 );
+    const std::vector< double > peaks = calculate_pattern();
+    std::vector< double > matrix( nterms * nterms, 0.0 );
+    std::vector< double > rhs( nterms, 0.0 );
+    for ( size_t i( 0 ); i != experimental_pattern_.size(); ++i )
+    {
+        const double * values = &background_values_[i*nterms];
+        const double weight = experimental_pattern_.weights()[i];
+        const double residual = experimental_pattern_.intensity( i ) - peaks[i];
+        for ( size_t j( 0 ); j != nterms; ++j )
+        {
+            rhs[j] += weight * values[j] * residual;
+            for ( size_t l( 0 ); l != nterms; ++l )
+                matrix[j*nterms+l] += weight * values[j] * values[l];
+        }
+    }
+    solve_positive_definite( matrix, rhs );
+    background_coefficients_ = rhs;
+}
+
+// ********************************************************************************
+
+void WholePatternDecomposition::le_bail( const size_t niterations )
+{
+    // Start from equal intensities unless there is a previous result to start from
+    if ( std::find_if( intensities_.begin(), intensities_.end(), []( const double intensity ) { return intensity > 0.0; } ) == intensities_.end() )
+        std::fill( intensities_.begin(), intensities_.end(), 1.0 );
+    const size_t nterms = background_coefficients_.size();
+    std::vector< double > new_intensities( nreflections() );
+    for ( size_t iteration( 0 ); iteration != niterations; ++iteration )
+    {
+        const std::vector< double > calculated = calculate_pattern();
+        // The observed pattern minus the background, and the calculated peaks alone
+        std::vector< double > observed( experimental_pattern_.size() );
+        std::vector< double > peaks( experimental_pattern_.size() );
+        for ( size_t i( 0 ); i != observed.size(); ++i )
+        {
+            double background( 0.0 );
+            for ( size_t j( 0 ); j != nterms; ++j )
+                background += background_coefficients_[j] * background_values_[i*nterms+j];
+            observed[i] = experimental_pattern_.intensity( i ) - background;
+            peaks[i] = calculated[i] - background;
+        }
+        // Each reflection gets its share of the observed intensity at every point it contributes to.
+        // Normalising by the sum of the profile makes the correct intensities a fixed point even though the profiles are truncated.
+        parallel_for( nreflections(), nthreads_, [&]( const size_t k )
+        {
+            const double * profile = &profile_values_[ profile_offsets_[k] ];
+            const size_t first = profile_first_[k];
+            double numerator( 0.0 );
+            double denominator( 0.0 );
+            for ( size_t j( 0 ); j != profile_size( k ); ++j )
+            {
+                if ( peaks[first+j] <= 0.0 )
+                    continue;
+                numerator += profile[j] * observed[first+j] / peaks[first+j];
+                denominator += profile[j];
+            }
+            new_intensities[k] = ( denominator > 0.0 ) ? std::max( 0.0, intensities_[k] * numerator / denominator ) : 0.0;
+        } );
+        intensities_.swap( new_intensities );
+        refine_background();
+    }
+}
+
+// ********************************************************************************
+
+void WholePatternDecomposition::Pawley()
+{
+    const size_t n = nreflections();
+    const size_t nterms = background_coefficients_.size();
+    const double * weights = experimental_pattern_.weights();
+    // The bandwidth: the largest distance in the sorted list between two reflections whose profiles overlap
+    size_t bandwidth( 0 );
+    for ( size_t k( 0 ); k != n; ++k )
+    {
+        const size_t last = profile_first_[k] + profile_size( k );
+        size_t l( k+1 );
+        while ( ( l != n ) && ( profile_first_[l] < last ) )
+            ++l;
+        bandwidth = std::max( bandwidth, l - k - 1 );
+    }
+    // The normal equations, the intensities first, then the background coefficients
+    BandedMatrix normal_matrix( n, bandwidth );
+    std::vector< double > coupling( n * nterms, 0.0 ); // Intensity-background block
+    std::vector< double > rhs( n, 0.0 );
+    // Each row is independent, so the rows are assembled in parallel
+    parallel_for( n, nthreads_, [&]( const size_t k )
+    {
+        const double * profile_k = &profile_values_[ profile_offsets_[k] ];
+        const size_t first_k = profile_first_[k];
+        const size_t end_k = first_k + profile_size( k );
+        for ( size_t i( first_k ); i != end_k; ++i )
+        {
+            const double weighted = weights[i] * profile_k[i-first_k];
+            rhs[k] += weighted * experimental_pattern_.intensity( i );
+            for ( size_t j( 0 ); j != nterms; ++j )
+                coupling[k*nterms+j] += weighted * background_values_[i*nterms+j];
+        }
+        const size_t l_end = std::min( n, k + bandwidth + 1 );
+        for ( size_t l( k ); l != l_end; ++l )
+        {
+            const size_t first_l = profile_first_[l];
+            const size_t begin = std::max( first_k, first_l );
+            const size_t end = std::min( end_k, first_l + profile_size( l ) );
+            const double * profile_l = &profile_values_[ profile_offsets_[l] ];
+            double sum( 0.0 );
+            for ( size_t i( begin ); i < end; ++i )
+                sum += weights[i] * profile_k[i-first_k] * profile_l[i-first_l];
+            normal_matrix( k, l ) = sum;
+        }
+        // A small ridge term so that exactly coinciding reflections do not make the matrix singular
+        if ( normal_matrix( k, k ) > 0.0 )
+            normal_matrix( k, k ) *= 1.0 + 1.0E-9;
+        else
+            normal_matrix( k, k ) = 1.0;
+    } );
+    normal_matrix.decompose();
+    normal_matrix.solve( rhs );
+    if ( nterms == 0 )
+    {
+        intensities_ = rhs;
+        return;
+    }
+    // The background coefficients follow from the Schur complement D - C^T N^-1 C
+    std::vector< double > schur( nterms * nterms, 0.0 );
+    std::vector< double > background_rhs( nterms, 0.0 );
+    for ( size_t i( 0 ); i != experimental_pattern_.size(); ++i )
+    {
+        const double * values = &background_values_[i*nterms];
+        for ( size_t j( 0 ); j != nterms; ++j )
+        {
+            background_rhs[j] += weights[i] * values[j] * experimental_pattern_.intensity( i );
+            for ( size_t l( 0 ); l != nterms; ++l )
+                schur[j*nterms+l] += weights[i] * values[j] * values[l];
+        }
+    }
+    std::vector< std::vector< double > > N_inverse_C( nterms, std::vector< double >( n ) );
+    for ( size_t j( 0 ); j != nterms; ++j )
+    {
+        for ( size_t k( 0 ); k != n; ++k )
+            N_inverse_C[j][k] = coupling[k*nterms+j];
+        normal_matrix.solve( N_inverse_C[j] );
+    }
+    for ( size_t j( 0 ); j != nterms; ++j )
+    {
+        for ( size_t k( 0 ); k != n; ++k )
+        {
+            background_rhs[j] -= coupling[k*nterms+j] * rhs[k];
+            for ( size_t l( 0 ); l != nterms; ++l )
+                schur[j*nterms+l] -= coupling[k*nterms+j] * N_inverse_C[l][k];
+        }
+    }
+    solve_positive_definite( schur, background_rhs );
+    background_coefficients_ = background_rhs;
+    intensities_ = rhs;
+    for ( size_t k( 0 ); k != n; ++k )
+    {
+        for ( size_t j( 0 ); j != nterms; ++j )
+            intensities_[k] -= N_inverse_C[j][k] * background_coefficients_[j];
+    }
+}
+
+// ********************************************************************************
+
+double WholePatternDecomposition::Rwp() const
+{
+    const std::vector< double > calculated = calculate_pattern();
+    double numerator( 0.0 );
+    double denominator( 0.0 );
+    for ( size_t i( 0 ); i != calculated.size(); ++i )
+    {
+        numerator += experimental_pattern_.weights()[i] * square( experimental_pattern_.intensity( i ) - calculated[i] );
+        denominator += experimental_pattern_.weights()[i] * square( experimental_pattern_.intensity( i ) );
+    }
+    return sqrt( numerator / denominator );
+}
+
+// ********************************************************************************
+
+PowderPattern WholePatternDecomposition::calculated_pattern() const
+{
+    PowderPattern result( experimental_pattern_ );
+    const std::vector< double > calculated = calculate_pattern();
+    for ( size_t i( 0 ); i != calculated.size(); ++i )
+        result.set_intensity( i, calculated[i] );
+    return result;
+}
+
+// ********************************************************************************
+
+ReflectionList WholePatternDecomposition::reflection_list() const
+{
+    ReflectionList result( reflection_list_ );
+    for ( size_t i( 0 ); i != result.size(); ++i )
+        result.set_F_squared( i, 0.0 );
+    for ( size_t k( 0 ); k != nreflections(); ++k )
+        result.set_F_squared( reflection_indices_[k], intensities_[k] / ( reflection_list_.multiplicity( reflection_indices_[k] ) * LP_factors_[k] ) );
+    return result;
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,114 @@
+#ifndef WHOLEPATTERNDECOMPOSITION_H
+#define WHOLEPATTERNDECOMPOSITION_H
+
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include "Angle.h"
+#include "PowderPattern.h"
+#include "ReflectionList.h"
+
+class PeakShapeFunction;
+
+#include <cstddef> // For definition of size_t
+#include <vector>
+
+/*
+  Extraction of integrated intensities from an experimental powder pattern for a known unit cell, without a structural model.
+
+  The peak positions follow from the d-spacings in the reflection list and the wavelength of the experimental pattern,
+  the peak shape is given by a PeakShapeFunction. Both are fixed, so each reflection has a fixed profile that is tabulated
+  once on the 2theta points of the pattern. The background is a Chebyshev polynomial over the 2theta range of the pattern.
+
+  le_bail(): iterative partitioning of the observed intensity over the overlapping reflections according to the current
+  estimates of their intensities; the background is refined by linear least squares after each iteration.
+
+  Pawley(): because the profiles are fixed, the pattern is linear in the intensities and the background coefficients and the
+  least-squares problem is solved in one step. A reflection only overlaps with its neighbours in 2theta, so the normal matrix
+  of the intensities is banded; it is assembled row by row on several threads, and solved by a banded Cholesky decomposition,
+  with the background terms eliminated through their Schur complement. A small ridge term keeps the normal matrix positive definite
+  when reflections coincide exactly, their intensity is then shared equally. As always with Pawley, strongly overlapping
+  reflections can get negative intensities.
+
+  The intensities are peak areas in the units of the pattern times degrees 2theta and include multiplicity and LP factor,
+  reflection_list() returns F^2 = intensity / ( multiplicity * LP ).
+*/
+class WholePatternDecomposition
+{
+public:
+
+    // The peak shape function is not copied and must outlive this object.
+    WholePatternDecomposition( const PowderPattern & experimental_pattern, const ReflectionList & reflection_list, const PeakShapeFunction & peak_shape_function );
+
+    // The number of Chebyshev terms of the background, 0 means that the pattern has been background subtracted. Default 0.
+    void set_nbackground_terms( const size_t nbackground_terms );
+    void set_nthreads( const size_t nthreads ) { nthreads_ = nthreads; } // 0 means one per core
+
+    size_t nreflections() const { return two_thetas_.size(); }
+
+    void le_bail( const size_t niterations = 20 );
+
+    void Pawley();
+
+    // Sorted by 2theta.
+    Angle two_theta( const size_t i ) const { return two_thetas_[i]; }
+    double intensity( const size_t i ) const { return intensities_[i]; }
+    double background_coefficient( const size_t i ) const { return background_coefficients_[i]; }
+
+    // Of the last fit.
+    double Rwp() const;
+
+    PowderPattern calculated_pattern() const;
+
+    ReflectionList reflection_list() const;
+
+private:
+    PowderPattern experimental_pattern_;
+    ReflectionList reflection_list_;
+    size_t nthreads_;
+    std::vector< size_t > reflection_indices_; // Into reflection_list_, sorted by 2theta
+    std::vector< Angle > two_thetas_;
+    std::vector< double > LP_factors_;
+    std::vector< double > intensities_;
+    std::vector< double > background_coefficients_;
+    // Tabulated profiles, with unit area, on the points profile_first_[i] ... profile_first_[i] + profile_size( i ) - 1
+    std::vector< size_t > profile_first_;
+    std::vector< size_t > profile_offsets_;
+    std::vector< double > profile_values_;
+    // The Chebyshev polynomials at each point, index point * nbackground_terms + term
+    std::vector< double > background_values_;
+
+    size_t profile_size( const size_t i ) const { return profile_offsets_[i+1] - profile_offsets_[i]; }
+    void calculate_background_values();
+    // The sum of the peaks and the background at each point.
+    std::vector< double > calculate_pattern() const;
+    // Least squares for the background coefficients against the experimental pattern minus the peaks.
+    void refine_background();
+};
+
+#endif // WHOLEPATTERNDECOMPOSITION_H
@@ -26,10 +26,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************* */
 
 #include "WriteCASTEPFile.h"
+#include "ParallelFor.h"
 #include "TextFileWriter.h"
 
 #include <stdexcept>
 
+#ifdef _WIN32
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+#endif
+
 // ********************************************************************************
 
 WriteCASTEPFile::WriteCASTEPFile() :
@@ -58,7 +65,54 @@ void WriteCASTEPFile::write() const
 {
     if ( base_name_.empty() )
         throw std::runtime_error( "WriteCASTEPFile::write(): base_name not defined." );
-    TextFileWriter text_file_writer( FileName( directory_, base_name_, "cell" ) );
+    write_cell_file( crystal_structure_, FileName( directory_, base_name_, "cell" ) );
+    write_param_file( FileName( directory_, base_name_, "param" ) );
+}
+
+// ********************************************************************************
+
+void WriteCASTEPFile::write( const std::vector< CrystalStructure > & crystal_structures,
+                             const std::vector< std::string > & base_names,
+                             const size_t nthreads,
+                             const size_t jobs_per_directory ) const
+{
+    if ( crystal_structures.size() != base_names.size() )
+        throw std::runtime_error( "WriteCASTEPFile::write(): number of structures and number of base names differ." );
+    for ( size_t i( 0 ); i != base_names.size(); ++i )
+    {
+        if ( base_names[i].empty() )
+            throw std::runtime_error( "WriteCASTEPFile::write(): base_name not defined." );
+    }
+    std::vector< std::string > directories( crystal_structures.size(), directory_ );
+    if ( jobs_per_directory != 0 )
+    {
+        for ( size_t i( 0 ); i != directories.size(); ++i )
+            directories[i] = append_backslash( directory_ + "batch_" + size_t2string( i / jobs_per_directory, 4, '0' ) );
+        // The subdirectories are created up front, on one thread. Already existing ones are fine.
+        for ( size_t i( 0 ); i < directories.size(); i += jobs_per_directory )
+        {
+            const std::string subdirectory = FileName( directories[i], "", "" ).full_name();
+#ifdef _WIN32
+            _mkdir( subdirectory.c_str() );
+#else
+            mkdir( subdirectory.c_str(), 0755 );
+#endif
+        }
+    }
+    parallel_for( crystal_structures.size(), nthreads, [&]( const size_t i )
+    {
+        CrystalStructure crystal_structure( crystal_structures[i] );
+        crystal_structure.apply_space_group_symmetry();
+        write_cell_file( crystal_structure, FileName( directories[i], base_names[i], "cell" ) );
+        write_param_file( FileName( directories[i], base_names[i], "param" ) );
+    } );
+}
+
+// ********************************************************************************
+
+void WriteCASTEPFile::write_cell_file( const CrystalStructure & crystal_structure, const FileName & file_name ) const
+{
+    TextFileWriter text_file_writer( file_name );
 
 // MEXZOG
 //a 5.10141(12) b 5.53079(13) c 9.0323(2)
@@ -69,7 +123,7 @@ void WriteCASTEPFile::write() const
 //       0.000000000000000       0.000000000000000       9.032299999999999
 //%ENDBLOCK LATTICE_CART
 
-    Matrix3D lattice = crystal_structure_.crystal_lattice().for_CASTEP();
+    Matrix3D lattice = crystal_structure.crystal_lattice().for_CASTEP();
     text_file_writer.write_line( "%BLOCK LATTICE_CART" );
     text_file_writer.write_line( "       " + double2string( lattice.value( 0, 0 ), 5, 9 ) +
                                        " " + double2string( lattice.value( 0, 1 ), 5, 9 ) +
@@ -81,18 +135,24 @@ void WriteCASTEPFile::write() const
                                        " " + double2string( lattice.value( 2, 1 ), 5, 9 ) +
                                        " " + double2string( lattice.value( 2, 2 ), 5, 9 ) );
     text_file_writer.write_line( "%ENDBLOCK LATTICE_CART" );
-    std::set< Element > elements = crystal_structure_.elements();
+    std::set< Element > elements = crystal_structure.elements();
     text_file_writer.write_line();
     text_file_writer.write_line( "%BLOCK POSITIONS_FRAC" );
+    std::string line;
     for ( std::set< Element >::const_iterator it( elements.begin() ); it != elements.end(); ++it )
     {
-        for ( size_t i( 0 ); i != crystal_structure_.natoms(); ++i )
+        for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
         {
-            if ( *it == crystal_structure_.atom( i ).element() )
-                text_file_writer.write_line( "  " + crystal_structure_.atom( i ).element().symbol() + " " +
-                                             double2string_pad_plus( crystal_structure_.atom( i ).position().x(), 5 ) + " " +
-                                             double2string_pad_plus( crystal_structure_.atom( i ).position().y(), 5 ) + " " +
-                                             double2string_pad_plus( crystal_structure_.atom( i ).position().z(), 5 ) + " " );
+            if ( *it != crystal_structure.atom( i ).element() )
+                continue;
+            line = "  " + crystal_structure.atom( i ).element().symbol() + " ";
+            append_double_pad_plus( line, crystal_structure.atom( i ).position().x(), 5 );
+            line += ' ';
+            append_double_pad_plus( line, crystal_structure.atom( i ).position().y(), 5 );
+            line += ' ';
+            append_double_pad_plus( line, crystal_structure.atom( i ).position().z(), 5 );
+            line += ' ';
+            text_file_writer.write_line( line );
         }
     }
     text_file_writer.write_line( "%ENDBLOCK POSITIONS_FRAC" );
@@ -100,10 +160,10 @@ void WriteCASTEPFile::write() const
     text_file_writer.write_line( "KPOINTS_MP_SPACING 0.07" );
     text_file_writer.write_line();
     text_file_writer.write_line( "%BLOCK SYMMETRY_OPS" );
-    for ( size_t i( 0 ); i != crystal_structure_.space_group().nsymmetry_operators(); ++i )
+    for ( size_t i( 0 ); i != crystal_structure.space_group().nsymmetry_operators(); ++i )
     {
-        Matrix3D rotation = crystal_structure_.space_group().symmetry_operator( i ).rotation();
-        Vector3D translation = crystal_structure_.space_group().symmetry_operator( i ).translation();
+        Matrix3D rotation = crystal_structure.space_group().symmetry_operator( i ).rotation();
+        Vector3D translation = crystal_structure.space_group().symmetry_operator( i ).translation();
         text_file_writer.write_line( " " + double2string_pad_plus( rotation.value( 0, 0 ), 5 ) +
                                      " " + double2string_pad_plus( rotation.value( 0, 1 ), 5 ) +
                                      " " + double2string_pad_plus( rotation.value( 0, 2 ), 5 ) );
@@ -135,24 +195,24 @@ void WriteCASTEPFile::write() const
             if ( it->is_H_or_D() )
                 continue;
             size_t counter_2( 0 );
-            for ( size_t i( 0 ); i != crystal_structure_.natoms(); ++i )
+            for ( size_t i( 0 ); i != crystal_structure.natoms(); ++i )
             {
-                if ( *it == crystal_structure_.atom( i ).element() )
+                if ( *it == crystal_structure.atom( i ).element() )
                 {
                     ++counter_2;
                     ++counter_1;
                     text_file_writer.write_line( "  " + size_t2string( counter_1, 4, ' ' ) + " " +
-                                                 crystal_structure_.atom( i ).element().symbol() + " " +
+                                                 crystal_structure.atom( i ).element().symbol() + " " +
                                                  size_t2string( counter_2, 4, ' ' ) + " " +
                                                  "1.00000   0.00000   0.00000" );
                     ++counter_1;
                     text_file_writer.write_line( "  " + size_t2string( counter_1, 4, ' ' ) + " " +
-                                                 crystal_structure_.atom( i ).element().symbol() + " " +
+                                                 crystal_structure.atom( i ).element().symbol() + " " +
                                                  size_t2string( counter_2, 4, ' ' ) + " " +
                                                  "0.00000   1.00000   0.00000" );
                     ++counter_1;
                     text_file_writer.write_line( "  " + size_t2string( counter_1, 4, ' ' ) + " " +
-                                                 crystal_structure_.atom( i ).element().symbol() + " " +
+                                                 crystal_structure.atom( i ).element().symbol() + " " +
                                                  size_t2string( counter_2, 4, ' ' ) + " " +
                                                  "0.00000   0.00000   1.00000" );
                 }
@@ -188,8 +248,13 @@ void WriteCASTEPFile::write() const
         }
     }
     text_file_writer.write_line( "%ENDBLOCK SPECIES_LCAO_STATES" );
+}
 
-    TextFileWriter text_file_writer_2( FileName( directory_, base_name_, "param" ) );
+// ********************************************************************************
+
+void WriteCASTEPFile::write_param_file( const FileName & file_name ) const
+{
+    TextFileWriter text_file_writer_2( file_name );
     if ( job_type_ != SS_NMR )
         text_file_writer_2.write_line( "task : GeometryOptimization" );
     text_file_writer_2.write_line( "xc_functional : PBE" );
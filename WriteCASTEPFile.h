@@ -32,8 +32,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Utilities.h"
 
 #include <string>
+#include <vector>
 
 /*
+  Writes the .cell and .param files for a CASTEP dispersion-corrected geometry optimisation.
+
+  For many structures at once, use the batch write(), which expands the symmetry of each structure
+  exactly once and writes the jobs on several threads.
 */
 class WriteCASTEPFile
 {
@@ -57,10 +62,19 @@ public:
     void set_base_name( const std::string & base_name ) { base_name_ = base_name; }
 
     CrystalStructure crystal_structure() const { return crystal_structure_; }
-    void set_crystal_structure( const CrystalStructure crystal_structure ) { crystal_structure_ = crystal_structure; crystal_structure_.apply_space_group_symmetry(); }
+    void set_crystal_structure( const CrystalStructure & crystal_structure ) { crystal_structure_ = crystal_structure; crystal_structure_.apply_space_group_symmetry(); }
 
     void write() const;
 
+    // Writes one job per structure to directory(), with the current job type; the crystal structure and base name of this object are not used.
+    // The structures are written on nthreads threads (0 means one per core).
+    // If jobs_per_directory is not 0, the jobs are distributed over subdirectories batch_0000, batch_0001, ... of directory()
+    // with jobs_per_directory jobs each, to keep directories small.
+    void write( const std::vector< CrystalStructure > & crystal_structures,
+                const std::vector< std::string > & base_names,
+                const size_t nthreads = 0,
+                const size_t jobs_per_directory = 0 ) const;
+
 private:
     JobType job_type_;
     std::string directory_;
@@ -68,6 +82,10 @@ private:
     CrystalStructure crystal_structure_;
     double cut_off_energy_;
     bool dummy_; // To test if I can check in on GitHub
+
+    // The space-group symmetry must already have been applied to crystal_structure.
+    void write_cell_file( const CrystalStructure & crystal_structure, const FileName & file_name ) const;
+    void write_param_file( const FileName & file_name ) const;
 };
 
 #endif // WRITECASTEPFILE_H
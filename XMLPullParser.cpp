@@ -0,0 +1,327 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "XMLPullParser.h"
+#include "FileName.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+
+inline bool is_white_space( const char c )
+{
+    return ( c == ' ' ) || ( c == '\t' ) || ( c == '\n' ) || ( c == '\r' );
+}
+
+// Characters that end a name
+inline bool is_name_terminator( const char c )
+{
+    return is_white_space( c ) || ( c == '=' ) || ( c == '/' ) || ( c == '>' );
+}
+
+inline bool starts_with( const char * begin, const char * end, const char * prefix )
+{
+    const size_t n = std::strlen( prefix );
+    return ( static_cast< size_t >( end - begin ) >= n ) && ( std::strncmp( begin, prefix, n ) == 0 );
+}
+
+} // namespace
+
+// ********************************************************************************
+
+bool XMLString::operator==( const char * rhs ) const
+{
+    const size_t n = std::strlen( rhs );
+    return ( n == length() ) && ( std::strncmp( begin_, rhs, n ) == 0 );
+}
+
+// ********************************************************************************
+
+std::string XMLString::decoded() const
+{
+    std::string result;
+    result.reserve( length() );
+    for ( const char * c = begin_; c != end_; ++c )
+    {
+        if ( *c != '&' )
+        {
+            result += *c;
+            continue;
+        }
+        const char * semicolon = std::find( c, end_, ';' );
+        if ( semicolon == end_ )
+            throw std::runtime_error( "XMLString::decoded(): entity not terminated: " + str() );
+        const std::string entity( c + 1, semicolon );
+        if ( entity == "lt" )
+            result += '<';
+        else if ( entity == "gt" )
+            result += '>';
+        else if ( entity == "amp" )
+            result += '&';
+        else if ( entity == "quot" )
+            result += '"';
+        else if ( entity == "apos" )
+            result += '\'';
+        else if ( ( entity.length() > 1 ) && ( entity[0] == '#' ) )
+        {
+            const bool hexadecimal = ( entity[1] == 'x' ) || ( entity[1] == 'X' );
+            const unsigned long value = std::strtoul( entity.c_str() + ( hexadecimal ? 2 : 1 ), 0, hexadecimal ? 16 : 10 );
+            if ( ( value == 0 ) || ( value > 127 ) )
+                throw std::runtime_error( "XMLString::decoded(): only ASCII character references are supported: " + entity );
+            result += static_cast< char >( value );
+        }
+        else
+            throw std::runtime_error( "XMLString::decoded(): unknown entity: " + entity );
+        c = semicolon;
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+XMLPullParser::XMLPullParser( const FileName & file_name )
+{
+    std::ifstream input_file( file_name.full_name().c_str(), std::ios::binary );
+    if ( ! input_file )
+        throw std::runtime_error( "XMLPullParser::XMLPullParser(): Could not open file " + file_name.full_name() );
+    input_file.seekg( 0, std::ios::end );
+    buffer_.resize( static_cast< size_t >( input_file.tellg() ) );
+    input_file.seekg( 0, std::ios::beg );
+    if ( ! buffer_.empty() )
+        input_file.read( &buffer_[0], buffer_.size() );
+    initialise();
+}
+
+// ********************************************************************************
+
+XMLPullParser::XMLPullParser( const std::string & text ): buffer_( text.begin(), text.end() )
+{
+    initialise();
+}
+
+// ********************************************************************************
+
+void XMLPullParser::initialise()
+{
+    current_ = buffer_.empty() ? 0 : &buffer_[0];
+    end_ = current_ + buffer_.size();
+    event_ = END_OF_DOCUMENT;
+    nattributes_ = 0;
+    depth_ = 0;
+    pending_end_element_ = false;
+}
+
+// ********************************************************************************
+
+XMLPullParser::Event XMLPullParser::next()
+{
+    nattributes_ = 0;
+    if ( pending_end_element_ )
+    {
+        pending_end_element_ = false;
+        --depth_;
+        event_ = END_ELEMENT;
+        return event_;
+    }
+    while ( current_ != end_ )
+    {
+        if ( *current_ != '<' )
+        {
+            const char * begin = current_;
+            current_ = std::find( current_, end_, '<' );
+            const char * c = begin;
+            while ( ( c != current_ ) && is_white_space( *c ) )
+                ++c;
+            if ( c == current_ )
+                continue;
+            text_ = XMLString( begin, current_ );
+            event_ = TEXT;
+            return event_;
+        }
+        if ( starts_with( current_, end_, "<?" ) )
+            skip_past( "?>", "processing instruction" );
+        else if ( starts_with( current_, end_, "<!--" ) )
+            skip_past( "-->", "comment" );
+        else if ( starts_with( current_, end_, "<![CDATA[" ) )
+        {
+            const char * begin = current_ + 9;
+            skip_past( "]]>", "CDATA section" );
+            text_ = XMLString( begin, current_ - 3 );
+            event_ = TEXT;
+            return event_;
+        }
+        else if ( starts_with( current_, end_, "<!" ) )
+        {
+            // DOCTYPE, possibly with an internal subset in square brackets
+            size_t nbrackets( 0 );
+            while ( ( current_ != end_ ) && ( ( *current_ != '>' ) || ( nbrackets != 0 ) ) )
+            {
+                if ( *current_ == '[' )
+                    ++nbrackets;
+                else if ( ( *current_ == ']' ) && ( nbrackets != 0 ) )
+                    --nbrackets;
+                ++current_;
+            }
+            if ( current_ == end_ )
+                throw_error( "DOCTYPE not terminated" );
+            ++current_;
+        }
+        else if ( starts_with( current_, end_, "</" ) )
+        {
+            current_ += 2;
+            const char * begin = current_;
+            while ( ( current_ != end_ ) && ( ! is_name_terminator( *current_ ) ) )
+                ++current_;
+            name_ = XMLString( begin, current_ );
+            while ( ( current_ != end_ ) && is_white_space( *current_ ) )
+                ++current_;
+            if ( ( current_ == end_ ) || ( *current_ != '>' ) )
+                throw_error( "end tag not terminated" );
+            ++current_;
+            if ( depth_ == 0 )
+                throw_error( "end tag without start tag" );
+            --depth_;
+            event_ = END_ELEMENT;
+            return event_;
+        }
+        else
+        {
+            parse_start_tag();
+            return event_;
+        }
+    }
+    event_ = END_OF_DOCUMENT;
+    return event_;
+}
+
+// ********************************************************************************
+
+void XMLPullParser::parse_start_tag()
+{
+    ++current_; // Skip '<'
+    const char * begin = current_;
+    while ( ( current_ != end_ ) && ( ! is_name_terminator( *current_ ) ) )
+        ++current_;
+    if ( current_ == begin )
+        throw_error( "element without name" );
+    name_ = XMLString( begin, current_ );
+    while ( true )
+    {
+        while ( ( current_ != end_ ) && is_white_space( *current_ ) )
+            ++current_;
+        if ( current_ == end_ )
+            throw_error( "start tag not terminated" );
+        if ( *current_ == '>' )
+        {
+            ++current_;
+            break;
+        }
+        if ( *current_ == '/' )
+        {
+            if ( ( current_ + 1 == end_ ) || ( current_[1] != '>' ) )
+                throw_error( "expected \"/>\"" );
+            current_ += 2;
+            pending_end_element_ = true;
+            break;
+        }
+        const char * attribute_name_begin = current_;
+        while ( ( current_ != end_ ) && ( ! is_name_terminator( *current_ ) ) )
+            ++current_;
+        const char * attribute_name_end = current_;
+        while ( ( current_ != end_ ) && is_white_space( *current_ ) )
+            ++current_;
+        if ( ( current_ == end_ ) || ( *current_ != '=' ) )
+            throw_error( "expected '=' after attribute name" );
+        ++current_;
+        while ( ( current_ != end_ ) && is_white_space( *current_ ) )
+            ++current_;
+        if ( ( current_ == end_ ) || ( ( *current_ != '"' ) && ( *current_ != '\'' ) ) )
+            throw_error( "attribute value must be quoted" );
+        const char quote = *current_;
+        ++current_;
+        const char * attribute_value_begin = current_;
+        current_ = std::find( current_, end_, quote );
+        if ( current_ == end_ )
+            throw_error( "attribute value not terminated" );
+        if ( nattributes_ == attribute_names_.size() )
+        {
+            attribute_names_.push_back( XMLString() );
+            attribute_values_.push_back( XMLString() );
+        }
+        attribute_names_[nattributes_] = XMLString( attribute_name_begin, attribute_name_end );
+        attribute_values_[nattributes_] = XMLString( attribute_value_begin, current_ );
+        ++nattributes_;
+        ++current_;
+    }
+    ++depth_;
+    event_ = START_ELEMENT;
+}
+
+// ********************************************************************************
+
+bool XMLPullParser::attribute( const char * name, XMLString & value ) const
+{
+    for ( size_t i( 0 ); i != nattributes_; ++i )
+    {
+        if ( attribute_names_[i] == name )
+        {
+            value = attribute_values_[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// ********************************************************************************
+
+void XMLPullParser::skip_past( const char * terminator, const char * what )
+{
+    const size_t n = std::strlen( terminator );
+    const char * position = std::search( current_, end_, terminator, terminator + n );
+    if ( position == end_ )
+        throw_error( std::string( what ) + " not terminated" );
+    current_ = position + n;
+}
+
+// ********************************************************************************
+
+void XMLPullParser::throw_error( const std::string & message ) const
+{
+    const char * begin = buffer_.empty() ? 0 : &buffer_[0];
+    const size_t line_number = std::count( begin, current_, '\n' ) + 1;
+    throw std::runtime_error( "XMLPullParser: " + message + " on line " + size_t2string( line_number ) + "." );
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,134 @@
+#ifndef XMLPULLPARSER_H
+#define XMLPULLPARSER_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+class FileName;
+
+#include <cstddef> // For definition of size_t
+#include <string>
+#include <vector>
+
+/*
+  A range of characters inside the buffer of an XMLPullParser. No copy is made,
+  the range is valid for as long as the parser exists.
+*/
+class XMLString
+{
+public:
+
+    XMLString(): begin_(0), end_(0) {}
+    XMLString( const char * begin, const char * end ): begin_(begin), end_(end) {}
+
+    const char * begin() const { return begin_; }
+    const char * end() const { return end_; }
+    size_t length() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+
+    bool operator==( const char * rhs ) const;
+    bool operator!=( const char * rhs ) const { return ! ( *this == rhs ); }
+
+    // The characters as they are in the file, entities are not replaced.
+    std::string str() const { return std::string( begin_, end_ ); }
+
+    // With the predefined entities (&lt; &gt; &amp; &quot; &apos;) and ASCII character references replaced.
+    std::string decoded() const;
+
+private:
+    const char * begin_;
+    const char * end_;
+};
+
+/*
+  A streaming (pull) XML parser: next() returns the next start tag, end tag or piece of text,
+  the name, attributes and text are only valid until the next call to next() (the characters
+  themselves stay valid for as long as the parser exists).
+
+  The whole file is read into memory in one go, but no DOM is built and no strings are created.
+  The XML declaration, processing instructions, comments and the DOCTYPE are skipped.
+  An empty-element tag such as <Atom3d ID="1"/> is reported as a START_ELEMENT followed by an END_ELEMENT.
+  Text that consists of white space only is not reported, CDATA sections are reported as TEXT.
+  Well-formedness is not checked beyond what is needed to parse the file.
+
+  Meant for the XML formats of Materials Studio (.xsd) and of diffractometers (.xrdml, .brml).
+*/
+class XMLPullParser
+{
+public:
+
+    enum Event { START_ELEMENT, END_ELEMENT, TEXT, END_OF_DOCUMENT };
+
+    explicit XMLPullParser( const FileName & file_name );
+
+    // Parses XML that is already in memory, the text is copied.
+    explicit XMLPullParser( const std::string & text );
+
+    Event next();
+
+    Event event() const { return event_; }
+
+    // The element name, for START_ELEMENT and END_ELEMENT.
+    XMLString name() const { return name_; }
+
+    // The attributes, for START_ELEMENT.
+    size_t nattributes() const { return nattributes_; }
+    XMLString attribute_name( const size_t i ) const { return attribute_names_[i]; }
+    XMLString attribute_value( const size_t i ) const { return attribute_values_[i]; }
+
+    // Returns false if the current start tag has no attribute with this name.
+    bool attribute( const char * name, XMLString & value ) const;
+
+    // The raw text, for TEXT.
+    XMLString text() const { return text_; }
+
+    // The number of elements that are currently open, including the current START_ELEMENT.
+    size_t depth() const { return depth_; }
+
+private:
+    std::vector< char > buffer_;
+    const char * current_;
+    const char * end_;
+    Event event_;
+    XMLString name_;
+    XMLString text_;
+    // Only ever grown, so that no memory is allocated once the largest tag has been seen
+    std::vector< XMLString > attribute_names_;
+    std::vector< XMLString > attribute_values_;
+    size_t nattributes_;
+    size_t depth_;
+    bool pending_end_element_;
+
+    void initialise();
+    void parse_start_tag();
+    // Moves current_ past the first occurrence of terminator, throws if not found.
+    void skip_past( const char * terminator, const char * what );
+    void throw_error( const std::string & message ) const;
+};
+
+#endif // XMLPULLPARSER_H
+
@@ -0,0 +1,138 @@
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+
+#include "Xoshiro256StarStar.h"
+
+#include <stdexcept>
+
+namespace
+{
+
+uint64_t SplitMix64( uint64_t & x )
+{
+    uint64_t z = ( x += 0x9e3779b97f4a7c15ULL );
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    return z ^ ( z >> 31 );
+}
+
+const uint64_t JUMP[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+const uint64_t LONG_JUMP[4] = { 0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+
+} // namespace
+
+// ********************************************************************************
+
+Xoshiro256StarStar::Xoshiro256StarStar( const uint64_t seed )
+{
+    uint64_t x = seed;
+    for ( size_t i( 0 ); i != 4; ++i )
+        s_[i] = SplitMix64( x );
+}
+
+// ********************************************************************************
+
+Xoshiro256StarStar::Xoshiro256StarStar( const uint64_t s0, const uint64_t s1, const uint64_t s2, const uint64_t s3 )
+{
+    if ( ( s0 == 0 ) && ( s1 == 0 ) && ( s2 == 0 ) && ( s3 == 0 ) )
+        throw std::runtime_error( "Xoshiro256StarStar::Xoshiro256StarStar(): state must not be all zeroes." );
+    s_[0] = s0;
+    s_[1] = s1;
+    s_[2] = s2;
+    s_[3] = s3;
+}
+
+// ********************************************************************************
+
+void Xoshiro256StarStar::jump()
+{
+    jump( JUMP );
+}
+
+// ********************************************************************************
+
+void Xoshiro256StarStar::long_jump()
+{
+    jump( LONG_JUMP );
+}
+
+// ********************************************************************************
+
+std::vector< Xoshiro256StarStar > Xoshiro256StarStar::split( const size_t n ) const
+{
+    std::vector< Xoshiro256StarStar > result;
+    result.reserve( n );
+    Xoshiro256StarStar generator( *this );
+    for ( size_t i( 0 ); i != n; ++i )
+    {
+        generator.jump();
+        result.push_back( generator );
+    }
+    return result;
+}
+
+// ********************************************************************************
+
+void Xoshiro256StarStar::fill( uint64_t * values, const size_t n )
+{
+    for ( size_t i( 0 ); i != n; ++i )
+        values[i] = next();
+}
+
+// ********************************************************************************
+
+void Xoshiro256StarStar::fill( double * values, const size_t n )
+{
+    for ( size_t i( 0 ); i != n; ++i )
+        values[i] = next_double();
+}
+
+// ********************************************************************************
+
+// The jump polynomial is applied by accumulating the states for which the corresponding bit is set
+void Xoshiro256StarStar::jump( const uint64_t polynomial[4] )
+{
+    uint64_t s[4] = { 0, 0, 0, 0 };
+    for ( size_t i( 0 ); i != 4; ++i )
+    {
+        for ( size_t b( 0 ); b != 64; ++b )
+        {
+            if ( polynomial[i] & ( static_cast<uint64_t>( 1 ) << b ) )
+            {
+                for ( size_t j( 0 ); j != 4; ++j )
+                    s[j] ^= s_[j];
+            }
+            next();
+        }
+    }
+    for ( size_t j( 0 ); j != 4; ++j )
+        s_[j] = s[j];
+}
+
+// ********************************************************************************
+
@@ -0,0 +1,94 @@
+#ifndef XOSHIRO256STARSTAR_H
+#define XOSHIRO256STARSTAR_H
+
+/* *********************************************
+Copyright (c) 2013-2020, Cornelis Jan (Jacco) van de Streek
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of my employers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL CORNELIS JAN VAN DE STREEK BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************* */
+
+#include <cstddef> // For definition of size_t
+#include <cstdint>
+#include <vector>
+
+/*
+  xoshiro256** by D. Blackman and S. Vigna (2018), a fast generator with 256 bits of state and period 2^256 - 1.
+
+  jump() advances the generator by 2^128 steps and long_jump() by 2^192 steps, so split( n ) hands out
+  n generators whose sequences do not overlap, e.g. one per thread. Combined with RandomNumberGenerator_double
+  and RandomNumberGenerator_integer (see RandomNumberGenerator.h), or directly for bulk generation with fill().
+*/
+class Xoshiro256StarStar
+{
+public:
+
+    // The state is initialised from the seed with SplitMix64, as recommended by the authors.
+    explicit Xoshiro256StarStar( const uint64_t seed = 1539 );
+
+    // Sets the state directly, the state must not be all zeroes.
+    Xoshiro256StarStar( const uint64_t s0, const uint64_t s1, const uint64_t s2, const uint64_t s3 );
+
+    uint64_t next()
+    {
+        const uint64_t result = rotate_left( s_[1] * 5, 7 ) * 9;
+        const uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotate_left( s_[3], 45 );
+        return result;
+    }
+
+    // A double in the open interval ( 0.0, 1.0 ) with 53 random bits.
+    double next_double() { return ( static_cast<double>( next() >> 11 ) + 0.5 ) * ( 1.0 / 9007199254740992.0 ); }
+
+    // Equivalent to 2^128 calls to next().
+    void jump();
+
+    // Equivalent to 2^192 calls to next().
+    void long_jump();
+
+    // Returns n generators, generator i is this generator jumped i+1 times. This generator is not changed,
+    // so call jump() n times (or long_jump() once) afterwards if it is to be used as well.
+    std::vector< Xoshiro256StarStar > split( const size_t n ) const;
+
+    void fill( uint64_t * values, const size_t n );
+    // Doubles in ( 0.0, 1.0 )
+    void fill( double * values, const size_t n );
+    void fill( std::vector< double > & values ) { if ( ! values.empty() ) fill( &values[0], values.size() ); }
+
+    uint64_t state( const size_t i ) const { return s_[i]; }
+
+private:
+    uint64_t s_[4];
+
+    static uint64_t rotate_left( const uint64_t x, const int k ) { return ( x << k ) | ( x >> ( 64 - k ) ); }
+
+    void jump( const uint64_t polynomial[4] );
+};
+
+#endif // XOSHIRO256STARSTAR_H
+